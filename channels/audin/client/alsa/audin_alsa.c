@@ -100,6 +100,15 @@ static BOOL audin_alsa_set_params(AudinALSADevice* alsa, snd_pcm_t* capture_hand
 	snd_pcm_hw_params_set_format(capture_handle, hw_params, format);
 	snd_pcm_hw_params_set_rate_near(capture_handle, hw_params, &alsa->aformat.nSamplesPerSec, NULL);
 	snd_pcm_hw_params_set_channels_near(capture_handle, hw_params, &channels);
+
+	/* The default period is often far longer than a packet, every read would wait for it */
+	if (alsa->frames_per_packet > 0)
+	{
+		snd_pcm_uframes_t period = alsa->frames_per_packet;
+		snd_pcm_uframes_t buffer = 4ull * period;
+		snd_pcm_hw_params_set_period_size_near(capture_handle, hw_params, &period, NULL);
+		snd_pcm_hw_params_set_buffer_size_near(capture_handle, hw_params, &buffer);
+	}
 	snd_pcm_hw_params(capture_handle, hw_params);
 	snd_pcm_hw_params_free(hw_params);
 	snd_pcm_prepare(capture_handle);
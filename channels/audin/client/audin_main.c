@@ -91,6 +91,7 @@ typedef struct
 	wStream* data;
 	AUDIO_FORMAT* format;
 	UINT32 FramesPerPacket;
+	UINT32 latency; /* capture packet duration in ms, 0 uses the server's FramesPerPacket */
 
 	FREERDP_DSP_CONTEXT* dsp_context;
 	wLog* log;
@@ -398,6 +399,17 @@ static UINT audin_receive_wave_data(const AUDIO_FORMAT* format, const BYTE* data
 	return audin_channel_write_and_free(callback, audin->data, FALSE);
 }
 
+static UINT32 audin_frames_per_packet(const AUDIN_PLUGIN* audin, UINT32 samplesPerSec)
+{
+	WINPR_ASSERT(audin);
+
+	if (audin->latency == 0)
+		return audin->FramesPerPacket;
+
+	const UINT64 frames = 1ull * samplesPerSec * audin->latency / 1000ull;
+	return (UINT32)MAX(1, MIN(frames, UINT32_MAX));
+}
+
 static BOOL audin_open_device(AUDIN_PLUGIN* audin, AUDIN_CHANNEL_CALLBACK* callback)
 {
 	UINT error = ERROR_INTERNAL_ERROR;
@@ -439,7 +451,10 @@ static BOOL audin_open_device(AUDIN_PLUGIN* audin, AUDIN_CHANNEL_CALLBACK* callb
 			return FALSE;
 	}
 
-	IFCALLRET(audin->device->SetFormat, error, audin->device, &format, audin->FramesPerPacket);
+	/* Short packets keep the voice latency down, the encoder frames them as they come */
+	const UINT32 FramesPerPacket = audin_frames_per_packet(audin, format.nSamplesPerSec);
+	WLog_Print(audin->log, WLOG_DEBUG, "capturing %" PRIu32 " frames per packet", FramesPerPacket);
+	IFCALLRET(audin->device->SetFormat, error, audin->device, &format, FramesPerPacket);
 
 	if (error != CHANNEL_RC_OK)
 	{
@@ -447,7 +462,8 @@ static BOOL audin_open_device(AUDIN_PLUGIN* audin, AUDIN_CHANNEL_CALLBACK* callb
 		return FALSE;
 	}
 
-	if (!freerdp_dsp_context_reset(audin->dsp_context, audin->format, audin->FramesPerPacket))
+	if (!freerdp_dsp_context_reset(audin->dsp_context, audin->format,
+	                               audin_frames_per_packet(audin, audin->format->nSamplesPerSec)))
 		return FALSE;
 
 	IFCALLRET(audin->device->Open, error, audin->device, audin_receive_wave_data, callback);
@@ -888,6 +904,7 @@ BOOL audin_process_addin_args(AUDIN_PLUGIN* audin, const ADDIN_ARGV* args)
 		{ "format", COMMAND_LINE_VALUE_REQUIRED, "<format>", NULL, NULL, -1, NULL, "format" },
 		{ "rate", COMMAND_LINE_VALUE_REQUIRED, "<rate>", NULL, NULL, -1, NULL, "rate" },
 		{ "channel", COMMAND_LINE_VALUE_REQUIRED, "<channel>", NULL, NULL, -1, NULL, "channel" },
+		{ "latency", COMMAND_LINE_VALUE_REQUIRED, "<latency>", NULL, NULL, -1, NULL, "latency" },
 		{ NULL, 0, NULL, NULL, NULL, -1, NULL, NULL }
 	};
 
@@ -955,6 +972,16 @@ BOOL audin_process_addin_args(AUDIN_PLUGIN* audin, const ADDIN_ARGV* args)
 			if ((errno != 0) || (val <= UINT16_MAX))
 				audin->fixed_format->nChannels = (UINT16)val;
 		}
+		CommandLineSwitchCase(arg, "latency")
+		{
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			/* opus frames are 2.5 to 60 ms long, 10 or 20 ms suit voice */
+			if ((errno != 0) || (val == 0) || (val > 1000))
+				return FALSE;
+
+			audin->latency = (UINT32)val;
+		}
 		CommandLineSwitchDefault(arg)
 		{
 		}
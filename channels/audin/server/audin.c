@@ -730,8 +730,12 @@ static UINT send_open(audin_server* audin)
 	SNDIN_OPEN open = { 0 };
 
 	WINPR_ASSERT(audin);
+	WINPR_ASSERT(audin->audin_negotiated_format);
 
-	open.FramesPerPacket = 441;
+	/* 10 ms packets, short enough for voice and a whole opus frame */
+	open.FramesPerPacket = audin->audin_negotiated_format->nSamplesPerSec / 100;
+	if (open.FramesPerPacket == 0)
+		open.FramesPerPacket = 441;
 	open.initialFormat = audin->audin_client_format_idx;
 	open.captureFormat.wFormatTag = WAVE_FORMAT_PCM;
 	open.captureFormat.nChannels = 2;
@@ -90,8 +90,8 @@ static UINT generic_dynvc_plugin_initialize(IWTSPlugin* pPlugin,
 	listener_callback->iface.OnNewChannelConnection = generic_on_new_channel_connection;
 	listener_callback->plugin = pPlugin;
 	listener_callback->channel_mgr = pChannelMgr;
-	rc = pChannelMgr->CreateListener(pChannelMgr, plugin->dynvc_name, 0, &listener_callback->iface,
-	                                 &plugin->listener);
+	rc = pChannelMgr->CreateListener(pChannelMgr, plugin->dynvc_name, plugin->listenerFlags,
+	                                 &listener_callback->iface, &plugin->listener);
 
 	plugin->listener->pInterface = plugin->iface.pInterface;
 	plugin->initialized = (rc == CHANNEL_RC_OK);
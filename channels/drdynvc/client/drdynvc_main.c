@@ -23,21 +23,45 @@
 
 #include <winpr/crt.h>
 #include <winpr/stream.h>
+#include <winpr/sysinfo.h>
 #include <winpr/interlocked.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/channels/drdynvc.h>
+#include <freerdp/channels/audin.h>
+#include <freerdp/channels/rdpecam.h>
+#include <freerdp/channels/rdpsnd.h>
+#include <freerdp/channels/urbdrc.h>
 #include <freerdp/utils/drdynvc.h>
 
 #include "drdynvc_main.h"
 
 #define TAG CHANNELS_TAG("drdynvc.client")
 
+/* messages a channel worker may lag behind before the drdynvc thread waits for it */
+#define DVCMAN_WORKER_QUEUE_LIMIT 64
+
+typedef struct
+{
+	const char* name;
+	const char* channels[3];
+} DVCMAN_DEFERRED_ADDIN;
+
+/* addins with costly backends (audio servers, device enumeration), their entry is only
+ * called once the server opens one of the listed channels */
+static const DVCMAN_DEFERRED_ADDIN dvcman_deferred_addins[] = {
+	{ RDPSND_CHANNEL_NAME, { RDPSND_DVC_CHANNEL_NAME, RDPSND_LOSSY_DVC_CHANNEL_NAME, NULL } },
+	{ AUDIN_CHANNEL_NAME, { AUDIN_DVC_CHANNEL_NAME, NULL } },
+	{ URBDRC_CHANNEL_NAME, { URBDRC_DVC_CHANNEL_NAME, NULL } },
+	{ RDPECAM_CHANNEL_NAME, { RDPECAM_CONTROL_DVC_CHANNEL_NAME, NULL } },
+};
+
 static void dvcman_channel_free(DVCMAN_CHANNEL* channel);
+static UINT dvcman_call_on_receive(DVCMAN_CHANNEL* channel, wStream* data);
 static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL fromHashTableFn);
 static void dvcman_free(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChannelMgr);
-static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const BYTE* data,
-                               UINT32 dataSize, BOOL* close);
+static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, UINT32 tunnelType,
+                               const BYTE* data, UINT32 dataSize, BOOL* close);
 static UINT drdynvc_send(drdynvcPlugin* drdynvc, wStream* s);
 
 static void dvcman_wtslistener_free(DVCMAN_LISTENER* listener)
@@ -333,6 +357,10 @@ static IWTSVirtualChannelManager* dvcman_new(drdynvcPlugin* plugin)
 	obj->fnObjectNew = winpr_ObjectStringClone;
 	obj->fnObjectFree = winpr_ObjectStringFree;
 
+	dvcman->deferred = ArrayList_New(TRUE);
+	if (!dvcman->deferred)
+		goto fail;
+
 	dvcman->plugins = ArrayList_New(TRUE);
 	if (!dvcman->plugins)
 		goto fail;
@@ -359,12 +387,14 @@ static UINT dvcman_load_addin(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager*
 
 	WLog_Print(drdynvc->log, WLOG_INFO, "Loading Dynamic Virtual Channel %s", args->argv[0]);
 
+	const UINT64 start = winpr_GetTickCount64NS();
 	PVIRTUALCHANNELENTRY pvce =
 	    freerdp_load_channel_addin_entry(args->argv[0], NULL, NULL, FREERDP_ADDIN_CHANNEL_DYNAMIC);
 	PDVC_PLUGIN_ENTRY pDVCPluginEntry = WINPR_FUNC_PTR_CAST(pvce, PDVC_PLUGIN_ENTRY);
 
 	if (pDVCPluginEntry)
 	{
+		UINT rc = 0;
 		DVCMAN_ENTRY_POINTS entryPoints = { 0 };
 
 		entryPoints.iface.RegisterPlugin = dvcman_register_plugin;
@@ -375,20 +405,233 @@ static UINT dvcman_load_addin(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager*
 		entryPoints.dvcman = (DVCMAN*)pChannelMgr;
 		entryPoints.args = args;
 		entryPoints.context = context;
-		return pDVCPluginEntry(&entryPoints.iface);
+		rc = pDVCPluginEntry(&entryPoints.iface);
+
+		WLog_Print(drdynvc->log, WLOG_DEBUG, "Dynamic Virtual Channel %s loaded in %" PRIu64 "us",
+		           args->argv[0], (winpr_GetTickCount64NS() - start) / 1000ull);
+		return rc;
 	}
 
 	return ERROR_INVALID_FUNCTION;
 }
 
+static const DVCMAN_DEFERRED_ADDIN* dvcman_find_deferred_addin(const char* name)
+{
+	for (size_t x = 0; x < ARRAYSIZE(dvcman_deferred_addins); x++)
+	{
+		const DVCMAN_DEFERRED_ADDIN* addin = &dvcman_deferred_addins[x];
+		if (strcmp(addin->name, name) == 0)
+			return addin;
+	}
+	return NULL;
+}
+
+static BOOL dvcman_deferred_addin_serves(const ADDIN_ARGV* args, const char* ChannelName)
+{
+	const DVCMAN_DEFERRED_ADDIN* addin = dvcman_find_deferred_addin(args->argv[0]);
+	if (!addin)
+		return FALSE;
+
+	for (size_t x = 0; (x < ARRAYSIZE(addin->channels)) && addin->channels[x]; x++)
+	{
+		/* [MS-RDPEUSB] uses the uppercase variant of the channel name */
+		if (_stricmp(addin->channels[x], ChannelName) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void dvcman_channel_worker_unref(DVCMAN_CHANNEL_WORKER* worker)
+{
+	if (!worker || InterlockedDecrement(&worker->refCounter))
+		return;
+
+	MessageQueue_Free(worker->queue);
+	if (worker->slots)
+		(void)CloseHandle(worker->slots);
+	if (worker->stopEvent)
+		(void)CloseHandle(worker->stopEvent);
+	if (worker->thread)
+		(void)CloseHandle(worker->thread);
+	free(worker);
+}
+
+static void dvcman_channel_worker_message_free(void* obj)
+{
+	wMessage* msg = obj;
+	if (!msg || (msg->id != 0))
+		return;
+
+	Stream_Release((wStream*)msg->wParam);
+}
+
+static DWORD WINAPI dvcman_channel_worker_thread(LPVOID arg)
+{
+	DVCMAN_CHANNEL_WORKER* worker = (DVCMAN_CHANNEL_WORKER*)arg;
+
+	WINPR_ASSERT(worker);
+	while (MessageQueue_Wait(worker->queue))
+	{
+		wMessage message = { 0 };
+
+		if (!MessageQueue_Peek(worker->queue, &message, TRUE))
+			continue;
+
+		if (message.id == WMQ_QUIT)
+			break;
+
+		/* the callback might close the channel, do not touch it afterwards */
+		DVCMAN_CHANNEL* channel = (DVCMAN_CHANNEL*)message.context;
+		wStream* s = (wStream*)message.wParam;
+		const UINT32 id = channel->channel_id;
+		const UINT error = dvcman_call_on_receive(channel, s);
+		if (error != CHANNEL_RC_OK)
+			WLog_WARN(TAG, "{%" PRIu32 "} OnDataReceived failed with error %" PRIu32, id, error);
+
+		Stream_Release(s);
+		(void)ReleaseSemaphore(worker->slots, 1, NULL);
+	}
+
+	dvcman_channel_worker_unref(worker);
+	return 0;
+}
+
+static BOOL dvcman_channel_worker_start(DVCMAN_CHANNEL* channel)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(!channel->worker);
+
+	DVCMAN_CHANNEL_WORKER* worker =
+	    (DVCMAN_CHANNEL_WORKER*)calloc(1, sizeof(DVCMAN_CHANNEL_WORKER));
+	if (!worker)
+		return FALSE;
+
+	/* one reference for the channel, one for the thread */
+	worker->refCounter = 2;
+	worker->queue = MessageQueue_NewEx(NULL, WMQ_FLAG_SINGLE_CONSUMER);
+	if (!worker->queue)
+		goto fail;
+
+	wObject* obj = MessageQueue_Object(worker->queue);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = dvcman_channel_worker_message_free;
+
+	worker->slots =
+	    CreateSemaphore(NULL, DVCMAN_WORKER_QUEUE_LIMIT, DVCMAN_WORKER_QUEUE_LIMIT, NULL);
+	worker->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!worker->slots || !worker->stopEvent)
+		goto fail;
+
+	worker->thread = CreateThread(NULL, 0, dvcman_channel_worker_thread, worker, CREATE_SUSPENDED,
+	                              &worker->threadId);
+	if (!worker->thread)
+		goto fail;
+
+	channel->worker = worker;
+	(void)ResumeThread(worker->thread);
+	return TRUE;
+
+fail:
+	worker->refCounter = 1;
+	dvcman_channel_worker_unref(worker);
+	return FALSE;
+}
+
+/**
+ * Lets the worker deliver what was received so far and waits for it to
+ * finish. Closing the channel from one of its own callbacks discards the
+ * data still queued instead.
+ */
+static void dvcman_channel_worker_stop(DVCMAN_CHANNEL* channel)
+{
+	WINPR_ASSERT(channel);
+
+	EnterCriticalSection(&(channel->lock));
+	DVCMAN_CHANNEL_WORKER* worker = channel->worker;
+	channel->worker = NULL;
+	LeaveCriticalSection(&(channel->lock));
+
+	if (!worker)
+		return;
+
+	const BOOL self = (GetCurrentThreadId() == worker->threadId);
+
+	(void)SetEvent(worker->stopEvent);
+	if (self)
+		(void)MessageQueue_Clear(worker->queue);
+	(void)MessageQueue_PostQuit(worker->queue, 0);
+
+	if (!self)
+		(void)WaitForSingleObject(worker->thread, INFINITE);
+	dvcman_channel_worker_unref(worker);
+}
+
+/**
+ * Queues a complete message for the channel worker, waits while the worker
+ * lags DVCMAN_WORKER_QUEUE_LIMIT messages behind. Takes ownership of s.
+ */
+static UINT dvcman_channel_worker_post(DVCMAN_CHANNEL* channel, wStream* s)
+{
+	UINT error = CHANNEL_RC_OK;
+
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(s);
+
+	EnterCriticalSection(&(channel->lock));
+	DVCMAN_CHANNEL_WORKER* worker = channel->worker;
+	if (worker)
+		(void)InterlockedIncrement(&worker->refCounter);
+	LeaveCriticalSection(&(channel->lock));
+
+	/* the channel is closing */
+	if (!worker)
+	{
+		Stream_Release(s);
+		return CHANNEL_RC_OK;
+	}
+
+	HANDLE events[] = { worker->slots, worker->stopEvent };
+	switch (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE))
+	{
+		case WAIT_OBJECT_0:
+			EnterCriticalSection(&(channel->lock));
+			if (channel->worker != worker)
+				(void)ReleaseSemaphore(worker->slots, 1, NULL);
+			else if (MessageQueue_Post(worker->queue, channel, 0, s, NULL))
+				s = NULL;
+			else
+			{
+				(void)ReleaseSemaphore(worker->slots, 1, NULL);
+				error = CHANNEL_RC_NO_MEMORY;
+			}
+			LeaveCriticalSection(&(channel->lock));
+			break;
+
+		case WAIT_OBJECT_0 + 1:
+			break;
+
+		default:
+			error = ERROR_INTERNAL_ERROR;
+			break;
+	}
+
+	if (s)
+		Stream_Release(s);
+	dvcman_channel_worker_unref(worker);
+	return error;
+}
+
 static void dvcman_channel_free(DVCMAN_CHANNEL* channel)
 {
 	if (!channel)
 		return;
 
+	dvcman_channel_worker_stop(channel);
+
 	if (channel->dvc_data)
 		Stream_Release(channel->dvc_data);
 
+	zgfx_context_free(channel->zgfx);
 	DeleteCriticalSection(&(channel->lock));
 	free(channel->channel_name);
 	free(channel);
@@ -484,6 +727,7 @@ static UINT dvcman_channel_close(DVCMAN_CHANNEL* channel, BOOL perRequest, BOOL
 				}
 			}
 
+			dvcman_channel_worker_stop(channel);
 			channel->state = DVC_CHANNEL_CLOSED;
 
 			IWTSVirtualChannelCallback* cb = channel->channel_callback;
@@ -553,6 +797,7 @@ static void dvcman_clear(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pCha
 	WINPR_UNUSED(drdynvc);
 
 	HashTable_Clear(dvcman->channelsById);
+	ArrayList_Clear(dvcman->deferred);
 	ArrayList_Clear(dvcman->plugins);
 	ArrayList_Clear(dvcman->plugin_names);
 	HashTable_Clear(dvcman->listeners);
@@ -565,6 +810,7 @@ static void dvcman_free(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChan
 	WINPR_UNUSED(drdynvc);
 
 	HashTable_Free(dvcman->channelsById);
+	ArrayList_Free(dvcman->deferred);
 	ArrayList_Free(dvcman->plugins);
 	ArrayList_Free(dvcman->plugin_names);
 	HashTable_Free(dvcman->listeners);
@@ -578,14 +824,15 @@ static void dvcman_free(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChan
  *
  * @return 0 on success, otherwise a Win32 error code
  */
-static UINT dvcman_init(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChannelMgr)
+static UINT dvcman_init(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChannelMgr,
+                        size_t first)
 {
 	DVCMAN* dvcman = (DVCMAN*)pChannelMgr;
 	UINT error = CHANNEL_RC_OK;
 
 	WINPR_ASSERT(dvcman);
 	ArrayList_Lock(dvcman->plugins);
-	for (size_t i = 0; i < ArrayList_Count(dvcman->plugins); i++)
+	for (size_t i = first; i < ArrayList_Count(dvcman->plugins); i++)
 	{
 		IWTSPlugin* pPlugin = ArrayList_GetItem(dvcman->plugins, i);
 
@@ -603,6 +850,51 @@ fail:
 	return error;
 }
 
+/**
+ * Load and initialize a deferred addin serving ChannelName
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT dvcman_load_deferred(drdynvcPlugin* drdynvc, IWTSVirtualChannelManager* pChannelMgr,
+                                 const char* ChannelName)
+{
+	DVCMAN* dvcman = (DVCMAN*)pChannelMgr;
+	const ADDIN_ARGV* args = NULL;
+	UINT error = ERROR_NOT_FOUND;
+
+	WINPR_ASSERT(dvcman);
+
+	ArrayList_Lock(dvcman->deferred);
+	for (size_t x = 0; x < ArrayList_Count(dvcman->deferred); x++)
+	{
+		const ADDIN_ARGV* cur = ArrayList_GetItem(dvcman->deferred, x);
+		if (dvcman_deferred_addin_serves(cur, ChannelName))
+		{
+			/* a failing addin is not retried on the next open */
+			ArrayList_RemoveAt(dvcman->deferred, x);
+			args = cur;
+			break;
+		}
+	}
+	ArrayList_Unlock(dvcman->deferred);
+
+	if (!args)
+		return ERROR_NOT_FOUND;
+
+	ArrayList_Lock(dvcman->plugins);
+	const size_t first = ArrayList_Count(dvcman->plugins);
+	error = dvcman_load_addin(drdynvc, pChannelMgr, args, drdynvc->rdpcontext);
+	if (error == CHANNEL_RC_OK)
+		error = dvcman_init(drdynvc, pChannelMgr, first);
+	ArrayList_Unlock(dvcman->plugins);
+
+	if (error != CHANNEL_RC_OK)
+		WLog_Print(drdynvc->log, WLOG_ERROR,
+		           "deferred Dynamic Virtual Channel %s failed with error %" PRIu32 "!",
+		           args->argv[0], error);
+	return error;
+}
+
 /**
  * Function description
  *
@@ -620,8 +912,8 @@ static UINT dvcman_write_channel(IWTSVirtualChannel* pChannel, ULONG cbSize, con
 		return CHANNEL_RC_BAD_CHANNEL;
 
 	EnterCriticalSection(&(channel->lock));
-	status =
-	    drdynvc_write_data(channel->dvcman->drdynvc, channel->channel_id, pBuffer, cbSize, &close);
+	status = drdynvc_write_data(channel->dvcman->drdynvc, channel->channel_id, channel->tunnelType,
+	                            pBuffer, cbSize, &close);
 	LeaveCriticalSection(&(channel->lock));
 	/* Close delayed, it removes the channel struct */
 	if (close)
@@ -665,6 +957,10 @@ static DVCMAN_CHANNEL* dvcman_create_channel(drdynvcPlugin* drdynvc,
 	WINPR_ASSERT(dvcman);
 	WINPR_ASSERT(res);
 
+	/* outside of the listener lock, plugin initialization registers listeners */
+	if (!HashTable_Contains(dvcman->listeners, ChannelName))
+		(void)dvcman_load_deferred(drdynvc, pChannelMgr, ChannelName);
+
 	HashTable_Lock(dvcman->listeners);
 	listener = (DVCMAN_LISTENER*)HashTable_GetItemValue(dvcman->listeners, ChannelName);
 	if (!listener)
@@ -745,6 +1041,14 @@ static DVCMAN_CHANNEL* dvcman_create_channel(drdynvcPlugin* drdynvc,
 	channel->pInterface = listener->iface.pInterface;
 	context = dvcman->drdynvc->context;
 
+	if ((listener->flags & DVC_LISTENER_FLAG_OWN_THREAD) && drdynvc->async)
+	{
+		if (!dvcman_channel_worker_start(channel))
+			WLog_Print(drdynvc->log, WLOG_WARN,
+			           "unable to start a worker for '%s', delivering its data inline",
+			           channel->channel_name);
+	}
+
 	IFCALLRET(context->OnChannelConnected, *res, context, ChannelName, listener->iface.pInterface);
 	if (*res != CHANNEL_RC_OK)
 	{
@@ -799,13 +1103,21 @@ out:
  *
  * @return 0 on success, otherwise a Win32 error code
  */
-static UINT dvcman_receive_channel_data_first(DVCMAN_CHANNEL* channel, UINT32 length)
+static UINT dvcman_receive_channel_data_first(DVCMAN_CHANNEL* channel, wStream* data,
+                                              UINT32 length)
 {
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(channel->dvcman);
+	WINPR_ASSERT(data);
 	if (channel->dvc_data)
 		Stream_Release(channel->dvc_data);
+	channel->dvc_data = NULL;
+
+	/* the message fits in the first fragment, pass it on without reassembly */
+	if (Stream_GetRemainingLength(data) == length)
+		return CHANNEL_RC_OK;
 
+	/* sized for the whole message, the following fragments never grow it */
 	channel->dvc_data = StreamPool_Take(channel->dvcman->pool, length);
 
 	if (!channel->dvc_data)
@@ -850,13 +1162,36 @@ static UINT dvcman_receive_channel_data(DVCMAN_CHANNEL* channel, wStream* data,
 
 		if (Stream_GetPosition(channel->dvc_data) >= channel->dvc_data_length)
 		{
-			Stream_SealLength(channel->dvc_data);
-			Stream_SetPosition(channel->dvc_data, 0);
-
-			status = dvcman_call_on_receive(channel, channel->dvc_data);
-			Stream_Release(channel->dvc_data);
+			wStream* s = channel->dvc_data;
 			channel->dvc_data = NULL;
+			Stream_SealLength(s);
+			Stream_SetPosition(s, 0);
+
+			if (channel->worker)
+				status = dvcman_channel_worker_post(channel, s);
+			else
+			{
+				status = dvcman_call_on_receive(channel, s);
+				Stream_Release(s);
+			}
+		}
+	}
+	else if (channel->worker)
+	{
+		/* data points into the PDU, the worker needs a copy */
+		wStream* s = StreamPool_Take(channel->dvcman->pool, dataSize);
+		if (!s)
+		{
+			drdynvcPlugin* drdynvc = channel->dvcman->drdynvc;
+			WLog_Print(drdynvc->log, WLOG_ERROR, "StreamPool_Take failed!");
+			status = CHANNEL_RC_NO_MEMORY;
+			goto out;
 		}
+
+		Stream_Copy(data, s, dataSize);
+		Stream_SealLength(s);
+		Stream_SetPosition(s, 0);
+		status = dvcman_channel_worker_post(channel, s);
 	}
 	else
 		status = dvcman_call_on_receive(channel, data);
@@ -865,6 +1200,43 @@ out:
 	return status;
 }
 
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT dvcman_decompress_channel_data(DVCMAN_CHANNEL* channel, wStream* s, BYTE** ppData,
+                                          UINT32* pSize)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->dvcman);
+	drdynvcPlugin* drdynvc = channel->dvcman->drdynvc;
+
+	if (!channel->zgfx)
+	{
+		channel->zgfx = zgfx_context_new(FALSE);
+		if (!channel->zgfx)
+		{
+			WLog_Print(drdynvc->log, WLOG_ERROR, "zgfx_context_new failed!");
+			return CHANNEL_RC_NO_MEMORY;
+		}
+	}
+
+	const size_t size = Stream_GetRemainingLength(s);
+	if (size > UINT32_MAX)
+		return ERROR_INVALID_DATA;
+
+	if (zgfx_decompress(channel->zgfx, Stream_ConstPointer(s), (UINT32)size, ppData, pSize, 0) <
+	    0)
+	{
+		WLog_Print(drdynvc->log, WLOG_ERROR, "zgfx_decompress failed for ChannelId %" PRIu32,
+		           channel->channel_id);
+		return ERROR_INVALID_DATA;
+	}
+
+	return CHANNEL_RC_OK;
+}
+
 static UINT8 drdynvc_write_variable_uint(wStream* s, UINT32 val)
 {
 	UINT8 cb = 0;
@@ -935,8 +1307,32 @@ static UINT drdynvc_send(drdynvcPlugin* drdynvc, wStream* s)
  *
  * @return 0 on success, otherwise a Win32 error code
  */
-static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const BYTE* data,
-                               UINT32 dataSize, BOOL* close)
+static UINT drdynvc_send_tunnel(drdynvcPlugin* drdynvc, UINT32 tunnelType, wStream* s)
+{
+	WINPR_ASSERT(drdynvc);
+
+	if (tunnelType == 0)
+		return drdynvc_send(drdynvc, s);
+
+	if (!freerdp_multitransport_send_dvc(drdynvc->rdpcontext, tunnelType, Stream_Buffer(s),
+	                                     Stream_GetPosition(s)))
+	{
+		WLog_Print(drdynvc->log, WLOG_WARN, "multitransport tunnel 0x%08" PRIx32 " not available",
+		           tunnelType);
+		return drdynvc_send(drdynvc, s);
+	}
+
+	Stream_Release(s);
+	return CHANNEL_RC_OK;
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, UINT32 tunnelType,
+                               const BYTE* data, UINT32 dataSize, BOOL* close)
 {
 	wStream* data_out = NULL;
 	size_t pos = 0;
@@ -978,7 +1374,7 @@ static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const B
 		Stream_Write_UINT8(data_out, (DATA_PDU << 4) | cbChId);
 		Stream_SetPosition(data_out, pos);
 		Stream_Write(data_out, data, dataSize);
-		status = drdynvc_send(drdynvc, data_out);
+		status = drdynvc_send_tunnel(drdynvc, tunnelType, data_out);
 	}
 	else
 	{
@@ -992,7 +1388,7 @@ static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const B
 		Stream_Write(data_out, data, chunkLength);
 		data += chunkLength;
 		dataSize -= chunkLength;
-		status = drdynvc_send(drdynvc, data_out);
+		status = drdynvc_send_tunnel(drdynvc, tunnelType, data_out);
 
 		while (status == CHANNEL_RC_OK && dataSize > 0)
 		{
@@ -1018,7 +1414,7 @@ static UINT drdynvc_write_data(drdynvcPlugin* drdynvc, UINT32 ChannelId, const B
 			Stream_Write(data_out, data, chunkLength);
 			data += chunkLength;
 			dataSize -= chunkLength;
-			status = drdynvc_send(drdynvc, data_out);
+			status = drdynvc_send_tunnel(drdynvc, tunnelType, data_out);
 		}
 	}
 
@@ -1058,6 +1454,7 @@ static UINT drdynvc_send_capability_response(drdynvcPlugin* drdynvc)
 		return CHANNEL_RC_NO_MEMORY;
 	}
 
+	/* Echoing version 3 accepts compressed data PDUs, they are decompressed per channel */
 	Stream_Write_UINT16(s, 0x0050); /* Cmd+Sp+cbChId+Pad. Note: MSTSC sends 0x005c */
 	Stream_Write_UINT16(s, drdynvc->version);
 	status = drdynvc_send(drdynvc, s);
@@ -1262,12 +1659,14 @@ static UINT drdynvc_process_create_request(drdynvcPlugin* drdynvc, int Sp, int c
  * @return 0 on success, otherwise a Win32 error code
  */
 static UINT drdynvc_process_data_first(drdynvcPlugin* drdynvc, int Sp, int cbChId, wStream* s,
-                                       UINT32 ThreadingFlags)
+                                       UINT32 ThreadingFlags, BOOL compressed)
 {
 	UINT status = CHANNEL_RC_OK;
 	UINT32 Length = 0;
 	UINT32 ChannelId = 0;
 	DVCMAN_CHANNEL* channel = NULL;
+	wStream sbuffer = { 0 };
+	BYTE* data = NULL;
 
 	WINPR_ASSERT(drdynvc);
 	if (!Stream_CheckAndLogRequiredLength(
@@ -1277,8 +1676,9 @@ static UINT drdynvc_process_data_first(drdynvcPlugin* drdynvc, int Sp, int cbChI
 	ChannelId = drdynvc_read_variable_uint(s, cbChId);
 	Length = drdynvc_read_variable_uint(s, Sp);
 	WLog_Print(drdynvc->log, WLOG_TRACE,
-	           "process_data_first: Sp=%d cbChId=%d, ChannelId=%" PRIu32 " Length=%" PRIu32 "", Sp,
-	           cbChId, ChannelId, Length);
+	           "process_data_first: Sp=%d cbChId=%d, ChannelId=%" PRIu32 " Length=%" PRIu32
+	           " compressed=%d",
+	           Sp, cbChId, ChannelId, Length, compressed);
 
 	channel = dvcman_get_channel_by_id(drdynvc->channel_mgr, ChannelId, TRUE);
 	if (!channel)
@@ -1295,7 +1695,15 @@ static UINT drdynvc_process_data_first(drdynvcPlugin* drdynvc, int Sp, int cbChI
 	if (channel->state != DVC_CHANNEL_RUNNING)
 		goto out;
 
-	status = dvcman_receive_channel_data_first(channel, Length);
+	if (compressed)
+	{
+		UINT32 size = 0;
+		status = dvcman_decompress_channel_data(channel, s, &data, &size);
+		s = Stream_StaticConstInit(&sbuffer, data, size);
+	}
+
+	if (status == CHANNEL_RC_OK)
+		status = dvcman_receive_channel_data_first(channel, s, Length);
 
 	if (status == CHANNEL_RC_OK)
 		status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
@@ -1304,6 +1712,7 @@ static UINT drdynvc_process_data_first(drdynvcPlugin* drdynvc, int Sp, int cbChI
 		status = dvcman_channel_close(channel, FALSE, FALSE);
 
 out:
+	free(data);
 	dvcman_channel_unref(channel);
 	return status;
 }
@@ -1314,19 +1723,22 @@ out:
  * @return 0 on success, otherwise a Win32 error code
  */
 static UINT drdynvc_process_data(drdynvcPlugin* drdynvc, int Sp, int cbChId, wStream* s,
-                                 UINT32 ThreadingFlags)
+                                 UINT32 ThreadingFlags, BOOL compressed)
 {
 	UINT32 ChannelId = 0;
 	DVCMAN_CHANNEL* channel = NULL;
 	UINT status = CHANNEL_RC_OK;
+	wStream sbuffer = { 0 };
+	BYTE* data = NULL;
 
 	WINPR_ASSERT(drdynvc);
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, drdynvc_cblen_to_bytes(cbChId)))
 		return ERROR_INVALID_DATA;
 
 	ChannelId = drdynvc_read_variable_uint(s, cbChId);
-	WLog_Print(drdynvc->log, WLOG_TRACE, "process_data: Sp=%d cbChId=%d, ChannelId=%" PRIu32 "", Sp,
-	           cbChId, ChannelId);
+	WLog_Print(drdynvc->log, WLOG_TRACE,
+	           "process_data: Sp=%d cbChId=%d, ChannelId=%" PRIu32 " compressed=%d", Sp, cbChId,
+	           ChannelId, compressed);
 
 	channel = dvcman_get_channel_by_id(drdynvc->channel_mgr, ChannelId, TRUE);
 	if (!channel)
@@ -1343,11 +1755,21 @@ static UINT drdynvc_process_data(drdynvcPlugin* drdynvc, int Sp, int cbChId, wSt
 	if (channel->state != DVC_CHANNEL_RUNNING)
 		goto out;
 
-	status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
+	if (compressed)
+	{
+		UINT32 size = 0;
+		status = dvcman_decompress_channel_data(channel, s, &data, &size);
+		s = Stream_StaticConstInit(&sbuffer, data, size);
+	}
+
+	if (status == CHANNEL_RC_OK)
+		status = dvcman_receive_channel_data(channel, s, ThreadingFlags);
+
 	if (status != CHANNEL_RC_OK)
 		status = dvcman_channel_close(channel, FALSE, FALSE);
 
 out:
+	free(data);
 	dvcman_channel_unref(channel);
 	return status;
 }
@@ -1384,6 +1806,98 @@ static UINT drdynvc_process_close_request(drdynvcPlugin* drdynvc, int Sp, int cb
 	return CHANNEL_RC_OK;
 }
 
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT drdynvc_send_soft_sync_response(drdynvcPlugin* drdynvc, const UINT32* tunnels,
+                                            UINT32 count)
+{
+	WINPR_ASSERT(drdynvc);
+
+	DVCMAN* dvcman = (DVCMAN*)drdynvc->channel_mgr;
+	WINPR_ASSERT(dvcman);
+
+	wStream* s = StreamPool_Take(dvcman->pool, 6ull + 4ull * count);
+	if (!s)
+	{
+		WLog_Print(drdynvc->log, WLOG_ERROR, "StreamPool_Take failed!");
+		return CHANNEL_RC_NO_MEMORY;
+	}
+
+	Stream_Write_UINT8(s, (SOFT_SYNC_RESPONSE_PDU << 4)); /* Cmd+Sp+cbChId */
+	Stream_Write_UINT8(s, 0);                             /* Pad (1 byte) */
+	Stream_Write_UINT32(s, count);                        /* NumberOfTunnels (4 bytes) */
+	for (UINT32 x = 0; x < count; x++)
+		Stream_Write_UINT32(s, tunnels[x]); /* TunnelsToSwitch (4 bytes) */
+
+	return drdynvc_send(drdynvc, s);
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT drdynvc_process_soft_sync_request(drdynvcPlugin* drdynvc, wStream* s)
+{
+	UINT32 tunnels[2] = { 0 };
+	UINT32 count = 0;
+
+	WINPR_ASSERT(drdynvc);
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 9))
+		return ERROR_INVALID_DATA;
+
+	Stream_Seek_UINT8(s);                                /* Pad (1 byte) */
+	Stream_Seek_UINT32(s);                               /* Length (4 bytes) */
+	const UINT16 flags = Stream_Get_UINT16(s);           /* Flags (2 bytes) */
+	const UINT16 numberOfTunnels = Stream_Get_UINT16(s); /* NumberOfTunnels (2 bytes) */
+	WLog_Print(drdynvc->log, WLOG_DEBUG,
+	           "process_soft_sync_request: Flags=0x%04" PRIx16 " NumberOfTunnels=%" PRIu16, flags,
+	           numberOfTunnels);
+
+	if (!(flags & SOFT_SYNC_CHANNEL_LIST_PRESENT))
+		return drdynvc_send_soft_sync_response(drdynvc, tunnels, 0);
+
+	for (UINT16 x = 0; x < numberOfTunnels; x++)
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 6))
+			return ERROR_INVALID_DATA;
+
+		const UINT32 tunnelType = Stream_Get_UINT32(s);   /* TunnelType (4 bytes) */
+		const UINT16 numberOfDVCs = Stream_Get_UINT16(s); /* NumberOfDVCs (2 bytes) */
+		if (!Stream_CheckAndLogRequiredLengthOfSize(TAG, s, numberOfDVCs, 4ull))
+			return ERROR_INVALID_DATA;
+
+		/* channels stay on TCP unless the client has the tunnel the server moves them to */
+		const BOOL available =
+		    freerdp_multitransport_has_tunnel(drdynvc->rdpcontext, tunnelType) &&
+		    (count < ARRAYSIZE(tunnels));
+		if (available)
+			tunnels[count++] = tunnelType;
+
+		for (UINT16 y = 0; y < numberOfDVCs; y++)
+		{
+			const UINT32 ChannelId = Stream_Get_UINT32(s); /* ListOfDVCIds (4 bytes) */
+			if (!available)
+				continue;
+
+			DVCMAN_CHANNEL* channel =
+			    dvcman_get_channel_by_id(drdynvc->channel_mgr, ChannelId, TRUE);
+			if (!channel)
+				continue;
+
+			EnterCriticalSection(&(channel->lock));
+			channel->tunnelType = tunnelType;
+			LeaveCriticalSection(&(channel->lock));
+			dvcman_channel_unref(channel);
+		}
+	}
+
+	return drdynvc_send_soft_sync_response(drdynvc, tunnels, count);
+}
+
 /**
  * Function description
  *
@@ -1413,14 +1927,23 @@ static UINT drdynvc_order_recv(drdynvcPlugin* drdynvc, wStream* s, UINT32 Thread
 			return drdynvc_process_create_request(drdynvc, Sp, cbChId, s);
 
 		case DATA_FIRST_PDU:
-			return drdynvc_process_data_first(drdynvc, Sp, cbChId, s, ThreadingFlags);
+			return drdynvc_process_data_first(drdynvc, Sp, cbChId, s, ThreadingFlags, FALSE);
 
 		case DATA_PDU:
-			return drdynvc_process_data(drdynvc, Sp, cbChId, s, ThreadingFlags);
+			return drdynvc_process_data(drdynvc, Sp, cbChId, s, ThreadingFlags, FALSE);
+
+		case DATA_FIRST_COMPRESSED_PDU:
+			return drdynvc_process_data_first(drdynvc, Sp, cbChId, s, ThreadingFlags, TRUE);
+
+		case DATA_COMPRESSED_PDU:
+			return drdynvc_process_data(drdynvc, Sp, cbChId, s, ThreadingFlags, TRUE);
 
 		case CLOSE_REQUEST_PDU:
 			return drdynvc_process_close_request(drdynvc, Sp, cbChId, s);
 
+		case SOFT_SYNC_REQUEST_PDU:
+			return drdynvc_process_soft_sync_request(drdynvc, s);
+
 		default:
 			WLog_Print(drdynvc->log, WLOG_ERROR, "unknown drdynvc cmd 0x%x", Cmd);
 			return ERROR_INTERNAL_ERROR;
@@ -1702,13 +2225,25 @@ static UINT drdynvc_virtual_channel_event_connected(drdynvcPlugin* drdynvc, LPVO
 	{
 		const ADDIN_ARGV* args =
 		    freerdp_settings_get_pointer_array(settings, FreeRDP_DynamicChannelArray, index);
+
+		if (dvcman_find_deferred_addin(args->argv[0]))
+		{
+			DVCMAN* dvcman = (DVCMAN*)drdynvc->channel_mgr;
+			if (!ArrayList_Append(dvcman->deferred, args))
+			{
+				error = CHANNEL_RC_NO_MEMORY;
+				goto error;
+			}
+			continue;
+		}
+
 		error = dvcman_load_addin(drdynvc, drdynvc->channel_mgr, args, drdynvc->rdpcontext);
 
 		if (CHANNEL_RC_OK != error)
 			goto error;
 	}
 
-	if ((error = dvcman_init(drdynvc, drdynvc->channel_mgr)))
+	if ((error = dvcman_init(drdynvc, drdynvc->channel_mgr, 0)))
 	{
 		WLog_Print(drdynvc->log, WLOG_ERROR, "dvcman_init failed with error %" PRIu32 "!", error);
 		goto error;
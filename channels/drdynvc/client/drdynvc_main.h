@@ -33,6 +33,7 @@
 #include <freerdp/addin.h>
 #include <freerdp/channels/log.h>
 #include <freerdp/client/drdynvc.h>
+#include <freerdp/codec/zgfx.h>
 #include <freerdp/freerdp.h>
 
 typedef struct drdynvc_plugin drdynvcPlugin;
@@ -45,6 +46,7 @@ typedef struct
 
 	wArrayList* plugin_names;
 	wArrayList* plugins;
+	wArrayList* deferred; /* ADDIN_ARGV* of addins loaded on first channel open */
 
 	wHashTable* listeners;
 	wHashTable* channelsById;
@@ -77,6 +79,16 @@ typedef enum
 	DVC_CHANNEL_CLOSED
 } DVC_CHANNEL_STATE;
 
+typedef struct
+{
+	volatile LONG refCounter;
+	HANDLE thread;
+	DWORD threadId;
+	wMessageQueue* queue;
+	HANDLE slots;
+	HANDLE stopEvent;
+} DVCMAN_CHANNEL_WORKER;
+
 typedef struct
 {
 	IWTSVirtualChannel iface;
@@ -92,6 +104,15 @@ typedef struct
 	wStream* dvc_data;
 	UINT32 dvc_data_length;
 	CRITICAL_SECTION lock;
+
+	/* the multitransport tunnel the server switched the channel to, 0 for TCP */
+	UINT32 tunnelType;
+
+	/* history of the compressed data PDUs, created on the first one received */
+	ZGFX_CONTEXT* zgfx;
+
+	/* delivers the received data if the listener asked for a thread of its own */
+	DVCMAN_CHANNEL_WORKER* worker;
 } DVCMAN_CHANNEL;
 
 typedef enum
@@ -0,0 +1,272 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * File System Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/string.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+#include <winpr/collections.h>
+
+#include "drive_cache.h"
+
+/* listings are reused for this long, in ms, to catch changes made outside the session */
+#define DRIVE_DIR_CACHE_TTL 2000
+
+/* larger directories are enumerated for every query */
+#define DRIVE_DIR_CACHE_MAX_ENTRIES 4096
+
+#define DRIVE_DIR_CACHE_MAX_LISTINGS 64
+
+typedef struct
+{
+	DWORD dwFileAttributes;
+	FILETIME ftCreationTime;
+	FILETIME ftLastAccessTime;
+	FILETIME ftLastWriteTime;
+	DWORD nFileSizeHigh;
+	DWORD nFileSizeLow;
+	size_t nameLength;
+	WCHAR* cFileName;
+} DRIVE_DIR_ENTRY;
+
+struct s_DRIVE_DIR_LISTING
+{
+	LONG volatile refcount;
+	UINT64 timestamp;
+
+	size_t count;
+	size_t size;
+	DRIVE_DIR_ENTRY* entries;
+};
+
+struct s_DRIVE_DIR_CACHE
+{
+	wHashTable* listings;
+};
+
+static void drive_dir_listing_free(DRIVE_DIR_LISTING* listing)
+{
+	if (!listing)
+		return;
+
+	for (size_t x = 0; x < listing->count; x++)
+		free(listing->entries[x].cFileName);
+	free(listing->entries);
+	free(listing);
+}
+
+static BOOL drive_dir_listing_add(DRIVE_DIR_LISTING* listing, const WIN32_FIND_DATAW* data)
+{
+	WINPR_ASSERT(listing);
+	WINPR_ASSERT(data);
+
+	if (listing->count == listing->size)
+	{
+		const size_t size = listing->size ? listing->size * 2 : 32;
+		DRIVE_DIR_ENTRY* entries =
+		    (DRIVE_DIR_ENTRY*)realloc(listing->entries, size * sizeof(DRIVE_DIR_ENTRY));
+
+		if (!entries)
+			return FALSE;
+
+		listing->entries = entries;
+		listing->size = size;
+	}
+
+	DRIVE_DIR_ENTRY* entry = &listing->entries[listing->count];
+	entry->nameLength = _wcsnlen(data->cFileName, ARRAYSIZE(data->cFileName) - 1);
+	entry->cFileName = (WCHAR*)calloc(entry->nameLength + 1, sizeof(WCHAR));
+	if (!entry->cFileName)
+		return FALSE;
+
+	memcpy(entry->cFileName, data->cFileName, entry->nameLength * sizeof(WCHAR));
+	entry->dwFileAttributes = data->dwFileAttributes;
+	entry->ftCreationTime = data->ftCreationTime;
+	entry->ftLastAccessTime = data->ftLastAccessTime;
+	entry->ftLastWriteTime = data->ftLastWriteTime;
+	entry->nFileSizeHigh = data->nFileSizeHigh;
+	entry->nFileSizeLow = data->nFileSizeLow;
+	listing->count++;
+	return TRUE;
+}
+
+/* enumerates the search path, preserves the last error of FindFirstFileW on failure */
+static DRIVE_DIR_LISTING* drive_dir_listing_new(const WCHAR* searchPath)
+{
+	WIN32_FIND_DATAW data = { 0 };
+	HANDLE find = FindFirstFileW(searchPath, &data);
+
+	if (find == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	DRIVE_DIR_LISTING* listing = (DRIVE_DIR_LISTING*)calloc(1, sizeof(DRIVE_DIR_LISTING));
+	if (!listing)
+		goto fail;
+
+	listing->refcount = 1;
+	listing->timestamp = GetTickCount64();
+
+	do
+	{
+		if (!drive_dir_listing_add(listing, &data))
+			goto fail;
+	} while (FindNextFileW(find, &data));
+
+	FindClose(find);
+	return listing;
+
+fail:
+	FindClose(find);
+	drive_dir_listing_free(listing);
+	SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+	return NULL;
+}
+
+void drive_dir_listing_release(DRIVE_DIR_LISTING* listing)
+{
+	if (!listing)
+		return;
+
+	if (InterlockedDecrement(&listing->refcount) == 0)
+		drive_dir_listing_free(listing);
+}
+
+static void drive_dir_listing_objfree(void* obj)
+{
+	drive_dir_listing_release((DRIVE_DIR_LISTING*)obj);
+}
+
+BOOL drive_dir_listing_get_entry(const DRIVE_DIR_LISTING* listing, size_t index,
+                                 WIN32_FIND_DATAW* data)
+{
+	if (!listing || !data)
+	{
+		SetLastError(ERROR_INVALID_HANDLE);
+		return FALSE;
+	}
+
+	if (index >= listing->count)
+	{
+		SetLastError(ERROR_NO_MORE_FILES);
+		return FALSE;
+	}
+
+	const DRIVE_DIR_ENTRY* entry = &listing->entries[index];
+	data->dwFileAttributes = entry->dwFileAttributes;
+	data->ftCreationTime = entry->ftCreationTime;
+	data->ftLastAccessTime = entry->ftLastAccessTime;
+	data->ftLastWriteTime = entry->ftLastWriteTime;
+	data->nFileSizeHigh = entry->nFileSizeHigh;
+	data->nFileSizeLow = entry->nFileSizeLow;
+	memcpy(data->cFileName, entry->cFileName, (entry->nameLength + 1) * sizeof(WCHAR));
+	return TRUE;
+}
+
+DRIVE_DIR_LISTING* drive_dir_cache_get(DRIVE_DIR_CACHE* cache, const WCHAR* searchPath)
+{
+	char* key = NULL;
+	DRIVE_DIR_LISTING* listing = NULL;
+
+	if (!searchPath)
+		return NULL;
+
+	if (cache)
+		key = ConvertWCharToUtf8Alloc(searchPath, NULL);
+
+	if (key)
+	{
+		HashTable_Lock(cache->listings);
+		listing = (DRIVE_DIR_LISTING*)HashTable_GetItemValue(cache->listings, key);
+
+		if (listing && (GetTickCount64() - listing->timestamp <= DRIVE_DIR_CACHE_TTL))
+			(void)InterlockedIncrement(&listing->refcount);
+		else
+		{
+			if (listing)
+				(void)HashTable_Remove(cache->listings, key);
+			listing = NULL;
+		}
+		HashTable_Unlock(cache->listings);
+
+		if (listing)
+		{
+			free(key);
+			return listing;
+		}
+	}
+
+	/* enumerate without holding the lock, other workers keep using the cache */
+	listing = drive_dir_listing_new(searchPath);
+
+	if (listing && key && (listing->count <= DRIVE_DIR_CACHE_MAX_ENTRIES))
+	{
+		HashTable_Lock(cache->listings);
+		if (HashTable_Count(cache->listings) >= DRIVE_DIR_CACHE_MAX_LISTINGS)
+			HashTable_Clear(cache->listings);
+
+		/* the cache holds a reference of its own */
+		(void)InterlockedIncrement(&listing->refcount);
+		if (!HashTable_Insert(cache->listings, key, listing))
+			(void)InterlockedDecrement(&listing->refcount);
+		HashTable_Unlock(cache->listings);
+	}
+
+	free(key);
+	return listing;
+}
+
+void drive_dir_cache_invalidate(DRIVE_DIR_CACHE* cache)
+{
+	if (!cache)
+		return;
+
+	HashTable_Lock(cache->listings);
+	if (HashTable_Count(cache->listings) > 0)
+		HashTable_Clear(cache->listings);
+	HashTable_Unlock(cache->listings);
+}
+
+DRIVE_DIR_CACHE* drive_dir_cache_new(void)
+{
+	DRIVE_DIR_CACHE* cache = (DRIVE_DIR_CACHE*)calloc(1, sizeof(DRIVE_DIR_CACHE));
+
+	if (!cache)
+		return NULL;
+
+	cache->listings = HashTable_New(TRUE);
+	if (!cache->listings || !HashTable_SetupForStringData(cache->listings, FALSE))
+		goto fail;
+
+	HashTable_ValueObject(cache->listings)->fnObjectFree = drive_dir_listing_objfree;
+	return cache;
+
+fail:
+	drive_dir_cache_free(cache);
+	return NULL;
+}
+
+void drive_dir_cache_free(DRIVE_DIR_CACHE* cache)
+{
+	if (!cache)
+		return;
+
+	HashTable_Free(cache->listings);
+	free(cache);
+}
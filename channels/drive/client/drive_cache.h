@@ -0,0 +1,39 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * File System Virtual Channel
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H
+#define FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H
+
+#include <winpr/file.h>
+
+typedef struct s_DRIVE_DIR_LISTING DRIVE_DIR_LISTING;
+typedef struct s_DRIVE_DIR_CACHE DRIVE_DIR_CACHE;
+
+DRIVE_DIR_CACHE* drive_dir_cache_new(void);
+void drive_dir_cache_free(DRIVE_DIR_CACHE* cache);
+
+/* drops all cached listings, called whenever the drive is modified */
+void drive_dir_cache_invalidate(DRIVE_DIR_CACHE* cache);
+
+/* returns a referenced listing for a search path, cache may be NULL */
+DRIVE_DIR_LISTING* drive_dir_cache_get(DRIVE_DIR_CACHE* cache, const WCHAR* searchPath);
+
+void drive_dir_listing_release(DRIVE_DIR_LISTING* listing);
+BOOL drive_dir_listing_get_entry(const DRIVE_DIR_LISTING* listing, size_t index,
+                                 WIN32_FIND_DATAW* data);
+
+#endif /* FREERDP_CHANNEL_DRIVE_CLIENT_CACHE_H */
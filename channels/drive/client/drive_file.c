@@ -35,6 +35,7 @@
 
 #include <winpr/wtypes.h>
 #include <winpr/crt.h>
+#include <winpr/assert.h>
 #include <winpr/string.h>
 #include <winpr/path.h>
 #include <winpr/file.h>
@@ -59,6 +60,12 @@
 	} while (0)
 #endif
 
+/* size of the per file read-ahead / write-behind buffer */
+#define DRIVE_FILE_CACHE_SIZE (1024ull * 1024ull)
+
+/* number of back to back accesses before a file is considered sequential */
+#define DRIVE_FILE_SEQUENTIAL_THRESHOLD 2
+
 static BOOL drive_file_fix_path(WCHAR* path, size_t length)
 {
 	if ((length == 0) || (length > UINT32_MAX))
@@ -331,7 +338,6 @@ DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 Pat
 	}
 
 	file->file_handle = INVALID_HANDLE_VALUE;
-	file->find_handle = INVALID_HANDLE_VALUE;
 	file->id = id;
 	file->basepath = base_path;
 	file->FileAttributes = FileAttributes;
@@ -359,17 +365,17 @@ BOOL drive_file_free(DRIVE_FILE* file)
 	if (!file)
 		return FALSE;
 
+	/* pending write-behind data, a failure is reported with the close */
+	const BOOL flushed = drive_file_flush(file);
+
 	if (file->file_handle != INVALID_HANDLE_VALUE)
 	{
 		(void)CloseHandle(file->file_handle);
 		file->file_handle = INVALID_HANDLE_VALUE;
 	}
 
-	if (file->find_handle != INVALID_HANDLE_VALUE)
-	{
-		FindClose(file->find_handle);
-		file->find_handle = INVALID_HANDLE_VALUE;
-	}
+	drive_dir_listing_release(file->listing);
+	file->listing = NULL;
 
 	if (file->delete_pending)
 	{
@@ -381,21 +387,23 @@ BOOL drive_file_free(DRIVE_FILE* file)
 		else if (!DeleteFileW(file->fullpath))
 			goto fail;
 	}
+	else if (!flushed)
+		goto fail;
 
 	rc = TRUE;
 fail:
 	DEBUG_WSTR("Free %s", file->fullpath);
+	free(file->cache);
 	free(file->fullpath);
 	free(file);
 	return rc;
 }
 
-BOOL drive_file_seek(DRIVE_FILE* file, UINT64 Offset)
+static BOOL drive_file_set_pointer(DRIVE_FILE* file, UINT64 Offset)
 {
 	LARGE_INTEGER loffset;
 
-	if (!file)
-		return FALSE;
+	WINPR_ASSERT(file);
 
 	if (Offset > INT64_MAX)
 		return FALSE;
@@ -404,42 +412,198 @@ BOOL drive_file_seek(DRIVE_FILE* file, UINT64 Offset)
 	return SetFilePointerEx(file->file_handle, loffset, NULL, FILE_BEGIN);
 }
 
+/* reads until Length bytes are read or the end of the file is reached */
+static BOOL drive_file_read_at(DRIVE_FILE* file, UINT64 Offset, BYTE* buffer, size_t Length,
+                               size_t* pRead)
+{
+	size_t total = 0;
+
+	WINPR_ASSERT(file);
+	WINPR_ASSERT(pRead);
+
+	if (!drive_file_set_pointer(file, Offset))
+		return FALSE;
+
+	while (total < Length)
+	{
+		DWORD read = 0;
+		const size_t chunk = Length - total;
+
+		if (!ReadFile(file->file_handle, &buffer[total], (DWORD)chunk, &read, NULL))
+			return FALSE;
+
+		if (read == 0)
+			break;
+
+		total += read;
+	}
+
+	*pRead = total;
+	return TRUE;
+}
+
+static BOOL drive_file_write_at(DRIVE_FILE* file, UINT64 Offset, const BYTE* buffer,
+                                size_t Length)
+{
+	WINPR_ASSERT(file);
+
+	if (!drive_file_set_pointer(file, Offset))
+		return FALSE;
+
+	while (Length > 0)
+	{
+		DWORD written = 0;
+
+		if (!WriteFile(file->file_handle, buffer, (DWORD)Length, &written, NULL))
+			return FALSE;
+
+		Length -= written;
+		buffer += written;
+	}
+
+	return TRUE;
+}
+
+static BOOL drive_file_cache_alloc(DRIVE_FILE* file)
+{
+	WINPR_ASSERT(file);
+
+	if (!file->cache)
+		file->cache = malloc(DRIVE_FILE_CACHE_SIZE);
+	return file->cache != NULL;
+}
+
+/**
+ * Writes pending write-behind data and drops the read-ahead data. Must be
+ * called before anything that looks at the file through another path.
+ */
+BOOL drive_file_flush(DRIVE_FILE* file)
+{
+	BOOL rc = TRUE;
+
+	if (!file)
+		return FALSE;
+
+	if (file->cacheDirty && (file->cacheLength > 0))
+		rc = drive_file_write_at(file, file->cacheOffset, file->cache, file->cacheLength);
+
+	file->cacheDirty = FALSE;
+	file->cacheLength = 0;
+	return rc;
+}
+
+BOOL drive_file_seek(DRIVE_FILE* file, UINT64 Offset)
+{
+	if (!file)
+		return FALSE;
+
+	if (Offset > INT64_MAX)
+		return FALSE;
+
+	/* the handle is positioned lazily, only track the access pattern here */
+	if (Offset != file->offset)
+		file->sequential = 0;
+	else if (file->sequential < UINT32_MAX)
+		file->sequential++;
+
+	file->offset = Offset;
+	return TRUE;
+}
+
 BOOL drive_file_read(DRIVE_FILE* file, BYTE* buffer, UINT32* Length)
 {
-	DWORD read = 0;
+	size_t total = 0;
 
 	if (!file || !buffer || !Length)
 		return FALSE;
 
 	DEBUG_WSTR("Read file %s", file->fullpath);
 
-	if (ReadFile(file->file_handle, buffer, *Length, &read, NULL))
+	if (file->cacheDirty && !drive_file_flush(file))
+		return FALSE;
+
+	while (total < *Length)
 	{
-		*Length = read;
-		return TRUE;
+		const size_t remaining = *Length - total;
+
+		if ((file->offset >= file->cacheOffset) &&
+		    (file->offset < file->cacheOffset + file->cacheLength))
+		{
+			const size_t start = (size_t)(file->offset - file->cacheOffset);
+			size_t chunk = file->cacheLength - start;
+
+			if (chunk > remaining)
+				chunk = remaining;
+
+			memcpy(&buffer[total], &file->cache[start], chunk);
+			file->offset += chunk;
+			total += chunk;
+			continue;
+		}
+
+		if ((file->sequential < DRIVE_FILE_SEQUENTIAL_THRESHOLD) ||
+		    (remaining >= DRIVE_FILE_CACHE_SIZE) || !drive_file_cache_alloc(file))
+		{
+			size_t read = 0;
+
+			if (!drive_file_read_at(file, file->offset, &buffer[total], remaining, &read))
+				return FALSE;
+
+			file->offset += read;
+			total += read;
+			break;
+		}
+
+		/* sequential reader, fetch ahead of what was asked for */
+		file->cacheOffset = file->offset;
+		file->cacheLength = 0;
+		if (!drive_file_read_at(file, file->offset, file->cache, DRIVE_FILE_CACHE_SIZE,
+		                        &file->cacheLength))
+			return FALSE;
+
+		if (file->cacheLength == 0)
+			break;
 	}
 
-	return FALSE;
+	*Length = (UINT32)total;
+	return TRUE;
 }
 
 BOOL drive_file_write(DRIVE_FILE* file, const BYTE* buffer, UINT32 Length)
 {
-	DWORD written = 0;
-
 	if (!file || !buffer)
 		return FALSE;
 
 	DEBUG_WSTR("Write file %s", file->fullpath);
 
-	while (Length > 0)
+	/* append to the pending data if this continues it */
+	if (file->cacheDirty && (file->offset == file->cacheOffset + file->cacheLength) &&
+	    (file->cacheLength + Length <= DRIVE_FILE_CACHE_SIZE))
 	{
-		if (!WriteFile(file->file_handle, buffer, Length, &written, NULL))
-			return FALSE;
+		memcpy(&file->cache[file->cacheLength], buffer, Length);
+		file->cacheLength += Length;
+		file->offset += Length;
+		return TRUE;
+	}
 
-		Length -= written;
-		buffer += written;
+	if (!drive_file_flush(file))
+		return FALSE;
+
+	if ((file->sequential >= DRIVE_FILE_SEQUENTIAL_THRESHOLD) &&
+	    (Length < DRIVE_FILE_CACHE_SIZE) && drive_file_cache_alloc(file))
+	{
+		memcpy(file->cache, buffer, Length);
+		file->cacheOffset = file->offset;
+		file->cacheLength = Length;
+		file->cacheDirty = TRUE;
+		file->offset += Length;
+		return TRUE;
 	}
 
+	if (!drive_file_write_at(file, file->offset, buffer, Length))
+		return FALSE;
+
+	file->offset += Length;
 	return TRUE;
 }
 
@@ -580,6 +744,10 @@ BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, w
 	if (!file || !output)
 		return FALSE;
 
+	/* sizes and times must include the write-behind data */
+	if (!drive_file_flush(file))
+		goto out_fail;
+
 	hFile = CreateFileW(file->fullpath, 0, FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
 	                    FILE_ATTRIBUTE_NORMAL, NULL);
 	if (hFile != INVALID_HANDLE_VALUE)
@@ -636,6 +804,9 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 	if (!file || !input)
 		return FALSE;
 
+	if (!drive_file_flush(file))
+		return FALSE;
+
 	switch (FsInformationClass)
 	{
 		case FileBasicInformation:
@@ -822,8 +993,9 @@ BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UIN
 	return TRUE;
 }
 
-BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYTE InitialQuery,
-                                const WCHAR* path, UINT32 PathWCharLength, wStream* output)
+BOOL drive_file_query_directory(DRIVE_FILE* file, DRIVE_DIR_CACHE* cache,
+                                UINT32 FsInformationClass, BYTE InitialQuery, const WCHAR* path,
+                                UINT32 PathWCharLength, wStream* output)
 {
 	size_t length = 0;
 	WCHAR* ent_path = NULL;
@@ -833,21 +1005,24 @@ BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYT
 
 	if (InitialQuery != 0)
 	{
-		/* release search handle */
-		if (file->find_handle != INVALID_HANDLE_VALUE)
-			FindClose(file->find_handle);
+		/* release the previous listing */
+		drive_dir_listing_release(file->listing);
+		file->listingIndex = 0;
 
 		ent_path = drive_file_combine_fullpath(file->basepath, path, PathWCharLength);
-		/* open new search handle and retrieve the first entry */
-		file->find_handle = FindFirstFileW(ent_path, &file->find_data);
+		/* take a (possibly cached) snapshot of the directory, entries are returned from it */
+		file->listing = drive_dir_cache_get(cache, ent_path);
 		free(ent_path);
 
-		if (file->find_handle == INVALID_HANDLE_VALUE)
+		if (!file->listing)
 			goto out_fail;
 	}
-	else if (!FindNextFileW(file->find_handle, &file->find_data))
+
+	if (!drive_dir_listing_get_entry(file->listing, file->listingIndex, &file->find_data))
 		goto out_fail;
 
+	file->listingIndex++;
+
 	length = _wcslen(file->find_data.cFileName) * 2;
 
 	switch (FsInformationClass)
@@ -30,6 +30,8 @@
 #include <winpr/file.h>
 #include <freerdp/channels/log.h>
 
+#include "drive_cache.h"
+
 #define TAG CHANNELS_TAG("drive.client")
 
 typedef struct
@@ -37,7 +39,8 @@ typedef struct
 	UINT32 id;
 	BOOL is_dir;
 	HANDLE file_handle;
-	HANDLE find_handle;
+	DRIVE_DIR_LISTING* listing;
+	size_t listingIndex;
 	WIN32_FIND_DATAW find_data;
 	const WCHAR* basepath;
 	WCHAR* fullpath;
@@ -47,6 +50,16 @@ typedef struct
 	UINT32 DesiredAccess;
 	UINT32 CreateDisposition;
 	UINT32 CreateOptions;
+
+	/* position of the next read or write and the number of sequential accesses so far */
+	UINT64 offset;
+	UINT32 sequential;
+
+	/* read-ahead data or, if dirty, pending write-behind data starting at cacheOffset */
+	BYTE* cache;
+	UINT64 cacheOffset;
+	size_t cacheLength;
+	BOOL cacheDirty;
 } DRIVE_FILE;
 
 DRIVE_FILE* drive_file_new(const WCHAR* base_path, const WCHAR* path, UINT32 PathWCharLength,
@@ -58,10 +71,12 @@ BOOL drive_file_open(DRIVE_FILE* file);
 BOOL drive_file_seek(DRIVE_FILE* file, UINT64 Offset);
 BOOL drive_file_read(DRIVE_FILE* file, BYTE* buffer, UINT32* Length);
 BOOL drive_file_write(DRIVE_FILE* file, const BYTE* buffer, UINT32 Length);
+BOOL drive_file_flush(DRIVE_FILE* file);
 BOOL drive_file_query_information(DRIVE_FILE* file, UINT32 FsInformationClass, wStream* output);
 BOOL drive_file_set_information(DRIVE_FILE* file, UINT32 FsInformationClass, UINT32 Length,
                                 wStream* input);
-BOOL drive_file_query_directory(DRIVE_FILE* file, UINT32 FsInformationClass, BYTE InitialQuery,
-                                const WCHAR* path, UINT32 PathWCharLength, wStream* output);
+BOOL drive_file_query_directory(DRIVE_FILE* file, DRIVE_DIR_CACHE* cache,
+                                UINT32 FsInformationClass, BYTE InitialQuery, const WCHAR* path,
+                                UINT32 PathWCharLength, wStream* output);
 
 #endif /* FREERDP_CHANNEL_DRIVE_FILE_H */
@@ -46,7 +46,19 @@
 
 #include "drive_file.h"
 
+/* number of I/O workers per drive, the first one only handles IRPs without a file */
+#define DRIVE_IO_WORKERS 4
+
+typedef struct s_DRIVE_DEVICE DRIVE_DEVICE;
+
 typedef struct
+{
+	DRIVE_DEVICE* drive;
+	HANDLE thread;
+	wMessageQueue* IrpQueue;
+} DRIVE_WORKER;
+
+struct s_DRIVE_DEVICE
 {
 	DEVICE device;
 
@@ -54,14 +66,14 @@ typedef struct
 	BOOL automount;
 	UINT32 PathLength;
 	wListDictionary* files;
+	DRIVE_DIR_CACHE* dircache;
 
-	HANDLE thread;
-	wMessageQueue* IrpQueue;
+	DRIVE_WORKER workers[DRIVE_IO_WORKERS];
 
 	DEVMAN* devman;
 
 	rdpContext* rdpcontext;
-} DRIVE_DEVICE;
+};
 
 static DWORD drive_map_windows_err(DWORD fs_errno)
 {
@@ -193,6 +205,9 @@ static UINT drive_process_irp_create(DRIVE_DEVICE* drive, IRP* irp)
 	{
 		void* key = (void*)(size_t)file->id;
 
+		if (CreateDisposition != FILE_OPEN)
+			drive_dir_cache_invalidate(drive->dircache);
+
 		if (!ListDictionary_Add(drive->files, key, file))
 		{
 			WLog_ERR(TAG, "ListDictionary_Add failed!");
@@ -249,6 +264,10 @@ static UINT drive_process_irp_close(DRIVE_DEVICE* drive, IRP* irp)
 	{
 		ListDictionary_Take(drive->files, key);
 
+		/* deletes the file or flushes pending writes */
+		if (file->delete_pending || file->cacheDirty)
+			drive_dir_cache_invalidate(drive->dircache);
+
 		if (drive_file_free(file))
 			irp->IoStatus = STATUS_SUCCESS;
 		else
@@ -341,6 +360,7 @@ static UINT drive_process_irp_write(DRIVE_DEVICE* drive, IRP* irp)
 	if (!Stream_SafeSeek(irp->input, Length))
 		return ERROR_INVALID_DATA;
 	file = drive_get_file_by_id(drive, irp->FileId);
+	drive_dir_cache_invalidate(drive->dircache);
 
 	if (!file)
 	{
@@ -415,6 +435,7 @@ static UINT drive_process_irp_set_information(DRIVE_DEVICE* drive, IRP* irp)
 	Stream_Read_UINT32(irp->input, Length);
 	Stream_Seek(irp->input, 24); /* Padding */
 	file = drive_get_file_by_id(drive, irp->FileId);
+	drive_dir_cache_invalidate(drive->dircache);
 
 	if (!file)
 	{
@@ -633,8 +654,8 @@ static UINT drive_process_irp_query_directory(DRIVE_DEVICE* drive, IRP* irp)
 		irp->IoStatus = STATUS_UNSUCCESSFUL;
 		Stream_Write_UINT32(irp->output, 0); /* Length */
 	}
-	else if (!drive_file_query_directory(file, FsInformationClass, InitialQuery, path,
-	                                     PathLength / sizeof(WCHAR), irp->output))
+	else if (!drive_file_query_directory(file, drive->dircache, FsInformationClass, InitialQuery,
+	                                     path, PathLength / sizeof(WCHAR), irp->output))
 	{
 		irp->IoStatus = drive_map_windows_err(GetLastError());
 	}
@@ -752,7 +773,8 @@ static DWORD WINAPI drive_thread_func(LPVOID arg)
 {
 	IRP* irp = NULL;
 	wMessage message = { 0 };
-	DRIVE_DEVICE* drive = (DRIVE_DEVICE*)arg;
+	DRIVE_WORKER* worker = (DRIVE_WORKER*)arg;
+	DRIVE_DEVICE* drive = worker ? worker->drive : NULL;
 	UINT error = CHANNEL_RC_OK;
 
 	if (!drive)
@@ -763,14 +785,14 @@ static DWORD WINAPI drive_thread_func(LPVOID arg)
 
 	while (1)
 	{
-		if (!MessageQueue_Wait(drive->IrpQueue))
+		if (!MessageQueue_Wait(worker->IrpQueue))
 		{
 			WLog_ERR(TAG, "MessageQueue_Wait failed!");
 			error = ERROR_INTERNAL_ERROR;
 			break;
 		}
 
-		if (!MessageQueue_Peek(drive->IrpQueue, &message, TRUE))
+		if (!MessageQueue_Peek(worker->IrpQueue, &message, TRUE))
 		{
 			WLog_ERR(TAG, "MessageQueue_Peek failed!");
 			error = ERROR_INTERNAL_ERROR;
@@ -801,6 +823,23 @@ fail:
 	return error;
 }
 
+/**
+ * IRPs for the same file are always handled by the same worker, so they
+ * complete in order. IRPs for different files run concurrently and a slow
+ * share only stalls the files sharing its worker.
+ */
+static DRIVE_WORKER* drive_get_worker(DRIVE_DEVICE* drive, const IRP* irp)
+{
+	WINPR_ASSERT(drive);
+	WINPR_ASSERT(irp);
+
+	/* create requests do not reference a file yet */
+	if (irp->FileId == 0)
+		return &drive->workers[0];
+
+	return &drive->workers[1 + (irp->FileId % (DRIVE_IO_WORKERS - 1))];
+}
+
 /**
  * Function description
  *
@@ -810,10 +849,12 @@ static UINT drive_irp_request(DEVICE* device, IRP* irp)
 {
 	DRIVE_DEVICE* drive = (DRIVE_DEVICE*)device;
 
-	if (!drive)
+	if (!drive || !irp)
 		return ERROR_INVALID_PARAMETER;
 
-	if (!MessageQueue_Post(drive->IrpQueue, NULL, 0, (void*)irp, NULL))
+	DRIVE_WORKER* worker = drive_get_worker(drive, irp);
+
+	if (!MessageQueue_Post(worker->IrpQueue, NULL, 0, (void*)irp, NULL))
 	{
 		WLog_ERR(TAG, "MessageQueue_Post failed!");
 		return ERROR_INTERNAL_ERROR;
@@ -829,9 +870,16 @@ static UINT drive_free_int(DRIVE_DEVICE* drive)
 	if (!drive)
 		return ERROR_INVALID_PARAMETER;
 
-	(void)CloseHandle(drive->thread);
+	for (size_t x = 0; x < DRIVE_IO_WORKERS; x++)
+	{
+		DRIVE_WORKER* worker = &drive->workers[x];
+
+		(void)CloseHandle(worker->thread);
+		MessageQueue_Free(worker->IrpQueue);
+	}
+
 	ListDictionary_Free(drive->files);
-	MessageQueue_Free(drive->IrpQueue);
+	drive_dir_cache_free(drive->dircache);
 	Stream_Free(drive->device.data, TRUE);
 	free(drive->path);
 	free(drive);
@@ -851,12 +899,25 @@ static UINT drive_free(DEVICE* device)
 	if (!drive)
 		return ERROR_INVALID_PARAMETER;
 
-	if (MessageQueue_PostQuit(drive->IrpQueue, 0) &&
-	    (WaitForSingleObject(drive->thread, INFINITE) == WAIT_FAILED))
+	/* stop all workers first, they share the file list */
+	for (size_t x = 0; x < DRIVE_IO_WORKERS; x++)
 	{
-		error = GetLastError();
-		WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "", error);
-		return error;
+		DRIVE_WORKER* worker = &drive->workers[x];
+
+		if (worker->thread)
+			(void)MessageQueue_PostQuit(worker->IrpQueue, 0);
+	}
+
+	for (size_t x = 0; x < DRIVE_IO_WORKERS; x++)
+	{
+		DRIVE_WORKER* worker = &drive->workers[x];
+
+		if (worker->thread && (WaitForSingleObject(worker->thread, INFINITE) == WAIT_FAILED))
+		{
+			error = GetLastError();
+			WLog_ERR(TAG, "WaitForSingleObject failed with error %" PRIu32 "", error);
+			return error;
+		}
 	}
 
 	return drive_free_int(drive);
@@ -976,38 +1037,60 @@ static UINT drive_register_drive_path(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints,
 		}
 
 		ListDictionary_ValueObject(drive->files)->fnObjectFree = drive_file_objfree;
-		drive->IrpQueue = MessageQueue_New(NULL);
+		drive->dircache = drive_dir_cache_new();
 
-		if (!drive->IrpQueue)
+		if (!drive->dircache)
 		{
-			WLog_ERR(TAG, "ListDictionary_New failed!");
+			WLog_ERR(TAG, "drive_dir_cache_new failed!");
 			error = CHANNEL_RC_NO_MEMORY;
 			goto out_error;
 		}
 
-		wObject* obj = MessageQueue_Object(drive->IrpQueue);
-		WINPR_ASSERT(obj);
-		obj->fnObjectFree = drive_message_free;
+		for (size_t x = 0; x < DRIVE_IO_WORKERS; x++)
+		{
+			DRIVE_WORKER* worker = &drive->workers[x];
 
-		if ((error = pEntryPoints->RegisterDevice(pEntryPoints->devman, (DEVICE*)drive)))
+			worker->drive = drive;
+			worker->IrpQueue = MessageQueue_NewEx(NULL, WMQ_FLAG_SINGLE_CONSUMER);
+
+			if (!worker->IrpQueue)
+			{
+				WLog_ERR(TAG, "MessageQueue_NewEx failed!");
+				error = CHANNEL_RC_NO_MEMORY;
+				goto out_error;
+			}
+
+			wObject* obj = MessageQueue_Object(worker->IrpQueue);
+			WINPR_ASSERT(obj);
+			obj->fnObjectFree = drive_message_free;
+		}
+
+		for (size_t x = 0; x < DRIVE_IO_WORKERS; x++)
 		{
-			WLog_ERR(TAG, "RegisterDevice failed with error %" PRIu32 "!", error);
-			goto out_error;
+			DRIVE_WORKER* worker = &drive->workers[x];
+
+			if (!(worker->thread =
+			          CreateThread(NULL, 0, drive_thread_func, worker, CREATE_SUSPENDED, NULL)))
+			{
+				WLog_ERR(TAG, "CreateThread failed!");
+				error = ERROR_INTERNAL_ERROR;
+				goto out_error;
+			}
+
+			ResumeThread(worker->thread);
 		}
 
-		if (!(drive->thread =
-		          CreateThread(NULL, 0, drive_thread_func, drive, CREATE_SUSPENDED, NULL)))
+		if ((error = pEntryPoints->RegisterDevice(pEntryPoints->devman, (DEVICE*)drive)))
 		{
-			WLog_ERR(TAG, "CreateThread failed!");
+			WLog_ERR(TAG, "RegisterDevice failed with error %" PRIu32 "!", error);
 			goto out_error;
 		}
-
-		ResumeThread(drive->thread);
 	}
 
 	return CHANNEL_RC_OK;
 out_error:
-	drive_free_int(drive);
+	/* stops the workers already started */
+	drive_free((DEVICE*)drive);
 	return error;
 }
 
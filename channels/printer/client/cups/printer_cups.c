@@ -94,6 +94,7 @@ typedef struct
 
 	http_t* printjob_object;
 	int printjob_id;
+	bool failed; /* the document stream broke, the job is cancelled on close */
 } rdpCupsPrintJob;
 
 typedef struct
@@ -135,10 +136,18 @@ static UINT write_printjob(rdpPrintJob* printjob, const BYTE* data, size_t size)
 
 	WINPR_ASSERT(cups_printjob);
 
+	/* every further write would wait for the connection timeout, drop the data right away */
+	if (cups_printjob->failed)
+		return CHANNEL_RC_OK;
+
 	http_status_t rc =
 	    cupsWriteRequestData(cups_printjob->printjob_object, (const char*)data, size);
 	if (!http_status_ok(rc))
-		WLog_WARN(TAG, "cupsWriteRequestData returned %s", httpStatus(rc));
+	{
+		WLog_WARN(TAG, "cupsWriteRequestData returned %s, cancelling job %d", httpStatus(rc),
+		          cups_printjob->printjob_id);
+		cups_printjob->failed = true;
+	}
 
 	return CHANNEL_RC_OK;
 }
@@ -159,9 +168,21 @@ static void printer_cups_close_printjob(rdpPrintJob* printjob)
 
 	WINPR_ASSERT(cups_printjob);
 
-	ipp_status_t rc = cupsFinishDocument(cups_printjob->printjob_object, printjob->printer->name);
-	if (rc != IPP_OK)
-		WLog_WARN(TAG, "cupsFinishDocument returned %s", ippErrorString(rc));
+	if (cups_printjob->failed)
+	{
+		/* do not print a truncated document */
+		ipp_status_t rc = cupsCancelJob2(cups_printjob->printjob_object, printjob->printer->name,
+		                                 cups_printjob->printjob_id, 0);
+		if (rc != IPP_OK)
+			WLog_WARN(TAG, "cupsCancelJob2 returned %s", ippErrorString(rc));
+	}
+	else
+	{
+		ipp_status_t rc =
+		    cupsFinishDocument(cups_printjob->printjob_object, printjob->printer->name);
+		if (rc != IPP_OK)
+			WLog_WARN(TAG, "cupsFinishDocument returned %s", ippErrorString(rc));
+	}
 
 	cups_printjob->printjob_id = 0;
 	httpClose(cups_printjob->printjob_object);
@@ -226,8 +247,15 @@ static rdpPrintJob* printer_cups_create_printjob(rdpPrinter* printer, UINT32 id)
 		http_status_t rc = cupsStartDocument(cups_printjob->printjob_object, printer->name,
 		                                     cups_printjob->printjob_id, buf, CUPS_FORMAT_AUTO, 1);
 		if (!http_status_ok(rc))
+		{
 			WLog_WARN(TAG, "cupsStartDocument [printer '%s', driver '%s'] returned %s",
 			          printer->name, printer->driver, httpStatus(rc));
+			(void)cupsCancelJob2(cups_printjob->printjob_object, printer->name,
+			                     cups_printjob->printjob_id, 0);
+			httpClose(cups_printjob->printjob_object);
+			free(cups_printjob);
+			return NULL;
+		}
 	}
 
 	cups_printer->printjob = cups_printjob;
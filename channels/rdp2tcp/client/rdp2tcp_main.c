@@ -33,17 +33,22 @@
 
 static int const debug = 0;
 
+/* size of a single read from the addin */
+#define RDP2TCP_READ_SIZE (64ULL * 1024ULL)
+
+/* number of channel writes that may be in flight before reading stalls */
+#define RDP2TCP_MAX_PENDING_WRITES 16
+
 typedef struct
 {
 	HANDLE hStdOutputRead;
 	HANDLE hStdInputWrite;
 	HANDLE hProcess;
 	HANDLE copyThread;
-	HANDLE writeComplete;
+	HANDLE writeSlots;
 	DWORD openHandle;
 	void* initHandle;
 	CHANNEL_ENTRY_POINTS_FREERDP_EX channelEntryPoints;
-	char buffer[16 * 1024];
 	char* commandline;
 } Plugin;
 
@@ -134,23 +139,28 @@ static DWORD WINAPI copyThread(void* data)
 {
 	DWORD status = WAIT_OBJECT_0;
 	Plugin* plugin = (Plugin*)data;
-	size_t const bufsize = 16ULL * 1024ULL;
+	size_t const bufsize = RDP2TCP_READ_SIZE;
 
 	while (status == WAIT_OBJECT_0)
 	{
-
 		HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
 		DWORD dwRead = 0;
-		char* buffer = malloc(bufsize);
+		char* buffer = NULL;
+
+		/* keep several writes queued instead of waiting for each one to complete */
+		handles[0] = plugin->writeSlots;
+		handles[1] = freerdp_abort_event(plugin->channelEntryPoints.context);
+		status = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+		if (status != WAIT_OBJECT_0)
+			break;
 
+		buffer = malloc(bufsize);
 		if (!buffer)
 		{
 			(void)fprintf(stderr, "rdp2tcp copyThread: malloc failed\n");
 			goto fail;
 		}
 
-		// if (!ReadFile(plugin->hStdOutputRead, plugin->buffer, sizeof plugin->buffer, &dwRead,
-		// NULL))
 		if (!ReadFile(plugin->hStdOutputRead, buffer, bufsize, &dwRead, NULL))
 		{
 			free(buffer);
@@ -163,6 +173,7 @@ static DWORD WINAPI copyThread(void* data)
 			dumpData(buffer, dwRead);
 		}
 
+		/* the buffer is handed over to the channel and released on write completion */
 		if (plugin->channelEntryPoints.pVirtualChannelWriteEx(
 		        plugin->initHandle, plugin->openHandle, buffer, dwRead, buffer) != CHANNEL_RC_OK)
 		{
@@ -170,12 +181,6 @@ static DWORD WINAPI copyThread(void* data)
 			(void)fprintf(stderr, "rdp2tcp copyThread failed %i\n", (int)dwRead);
 			goto fail;
 		}
-
-		handles[0] = plugin->writeComplete;
-		handles[1] = freerdp_abort_event(plugin->channelEntryPoints.context);
-		status = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
-		if (status == WAIT_OBJECT_0)
-			(void)ResetEvent(plugin->writeComplete);
 	}
 
 fail:
@@ -243,10 +248,8 @@ static void VCAPITYPE VirtualChannelOpenEventEx(LPVOID lpUserParam, DWORD openHa
 			break;
 
 		case CHANNEL_EVENT_WRITE_CANCELLED:
-			free(pData);
-			break;
 		case CHANNEL_EVENT_WRITE_COMPLETE:
-			(void)SetEvent(plugin->writeComplete);
+			(void)ReleaseSemaphore(plugin->writeSlots, 1, NULL);
 			free(pData);
 			break;
 	}
@@ -262,8 +265,8 @@ static void channel_terminated(Plugin* plugin)
 
 	if (plugin->copyThread)
 		(void)TerminateThread(plugin->copyThread, 0);
-	if (plugin->writeComplete)
-		(void)CloseHandle(plugin->writeComplete);
+	if (plugin->writeSlots)
+		(void)CloseHandle(plugin->writeSlots);
 
 	(void)CloseHandle(plugin->hStdInputWrite);
 	(void)CloseHandle(plugin->hStdOutputRead);
@@ -275,7 +278,8 @@ static void channel_terminated(Plugin* plugin)
 
 static void channel_initialized(Plugin* plugin)
 {
-	plugin->writeComplete = CreateEvent(NULL, TRUE, FALSE, NULL);
+	plugin->writeSlots =
+	    CreateSemaphore(NULL, RDP2TCP_MAX_PENDING_WRITES, RDP2TCP_MAX_PENDING_WRITES, NULL);
 	plugin->copyThread = CreateThread(NULL, 0, copyThread, plugin, 0, NULL);
 }
 
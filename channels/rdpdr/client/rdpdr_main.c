@@ -2133,11 +2133,12 @@ static UINT rdpdr_virtual_channel_event_connected(rdpdrPlugin* rdpdr, LPVOID pDa
 
 	if (rdpdr->async)
 	{
-		rdpdr->queue = MessageQueue_New(NULL);
+		/* only rdpdr_virtual_channel_client_thread reads from the queue */
+		rdpdr->queue = MessageQueue_NewEx(NULL, WMQ_FLAG_SINGLE_CONSUMER);
 
 		if (!rdpdr->queue)
 		{
-			WLog_Print(rdpdr->log, WLOG_ERROR, "MessageQueue_New failed!");
+			WLog_Print(rdpdr->log, WLOG_ERROR, "MessageQueue_NewEx failed!");
 			return CHANNEL_RC_NO_MEMORY;
 		}
 
@@ -2327,8 +2328,8 @@ FREERDP_ENTRY_POINT(BOOL VCAPITYPE VirtualChannelEntryEx(PCHANNEL_ENTRY_POINTS p
 		return FALSE;
 	}
 
-	rdpdr->channelDef.options =
-	    CHANNEL_OPTION_INITIALIZED | CHANNEL_OPTION_ENCRYPT_RDP | CHANNEL_OPTION_COMPRESS_RDP;
+	rdpdr->channelDef.options = CHANNEL_OPTION_INITIALIZED | CHANNEL_OPTION_ENCRYPT_RDP |
+	                            CHANNEL_OPTION_COMPRESS_RDP | CHANNEL_OPTION_PRI_LOW;
 	(void)sprintf_s(rdpdr->channelDef.name, ARRAYSIZE(rdpdr->channelDef.name),
 	                RDPDR_SVC_CHANNEL_NAME);
 	rdpdr->sequenceId = 0;
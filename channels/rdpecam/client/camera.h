@@ -25,6 +25,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <libavcodec/avcodec.h>
 #include <libswscale/swscale.h>
 #include <libavutil/imgutils.h>
 
@@ -97,6 +98,11 @@ typedef struct
 	struct SwsContext* sws;
 	int srcLineSizes[4];
 
+	/* decoder for compressed (MJPG) camera input */
+	AVCodecContext* avContext;
+	AVPacket* avInputPkt;
+	AVFrame* avOutFrame;
+
 } CameraDeviceStream;
 
 static INLINE CAM_MEDIA_FORMAT streamInputFormat(CameraDeviceStream* stream)
@@ -86,6 +86,43 @@ static enum AVPixelFormat ecamToAVPixFormat(CAM_MEDIA_FORMAT ecamFormat)
 	}
 }
 
+/**
+ * Function description
+ *
+ * @return decoded frame or NULL on frame drop/failure
+ */
+static AVFrame* ecam_encoder_decode_mjpg(CameraDeviceStream* stream, const BYTE* srcData,
+                                         size_t srcSize)
+{
+	WINPR_ASSERT(stream);
+
+	if (srcSize > INT32_MAX)
+		return NULL;
+
+	/* the decoder reads past the end of the input, the capture buffer has no padding */
+	av_packet_unref(stream->avInputPkt);
+	if (av_new_packet(stream->avInputPkt, (int)srcSize) < 0)
+		return NULL;
+	memcpy(stream->avInputPkt->data, srcData, srcSize);
+
+	int ret = avcodec_send_packet(stream->avContext, stream->avInputPkt);
+	if (ret < 0)
+	{
+		WLog_ERR(TAG, "avcodec_send_packet failed with %d", ret);
+		return NULL;
+	}
+
+	ret = avcodec_receive_frame(stream->avContext, stream->avOutFrame);
+	if (ret < 0)
+	{
+		if (ret != AVERROR(EAGAIN))
+			WLog_ERR(TAG, "avcodec_receive_frame failed with %d", ret);
+		return NULL;
+	}
+
+	return stream->avOutFrame;
+}
+
 /**
  * Function description
  *
@@ -96,27 +133,63 @@ static BOOL ecam_encoder_compress_h264(CameraDeviceStream* stream, const BYTE* s
 {
 	UINT32 dstSize = 0;
 	BYTE* srcSlice[4] = { 0 };
+	int srcLineSizes[4] = { 0 };
 	BYTE* yuv420pData[3] = { 0 };
 	UINT32 yuv420pStride[3] = { 0 };
 	prim_size_t size = { 0 };
 	size.width = stream->currMediaType.Width;
 	size.height = stream->currMediaType.Height;
 	CAM_MEDIA_FORMAT inputFormat = streamInputFormat(stream);
-	enum AVPixelFormat pixFormat = ecamToAVPixFormat(inputFormat);
 
 	/* get buffers for YUV420P */
 	if (h264_get_yuv_buffer(stream->h264, stream->srcLineSizes[0], size.width, size.height,
 	                        yuv420pData, yuv420pStride) < 0)
 		return FALSE;
 
-	/* convert from source format to YUV420P */
-	BYTE* ptr = WINPR_CAST_CONST_PTR_AWAY(srcData, BYTE*);
-	if (av_image_fill_pointers(srcSlice, pixFormat, (int)size.height, ptr, stream->srcLineSizes) <
-	    0)
-		return FALSE;
+	if (inputFormat == CAM_MEDIA_FORMAT_MJPG)
+	{
+		/* decode JPEG, the pixel format is only known from the decoded frame */
+		AVFrame* frame = ecam_encoder_decode_mjpg(stream, srcData, srcSize);
+		if (!frame)
+			return FALSE;
+
+		if (((UINT32)frame->width != size.width) || ((UINT32)frame->height != size.height))
+		{
+			WLog_ERR(TAG, "Decoded frame %dx%d does not match stream %" PRIu32 "x%" PRIu32,
+			         frame->width, frame->height, size.width, size.height);
+			return FALSE;
+		}
+
+		stream->sws = sws_getCachedContext(stream->sws, frame->width, frame->height,
+		                                   (enum AVPixelFormat)frame->format, frame->width,
+		                                   frame->height, AV_PIX_FMT_YUV420P, 0, NULL, NULL, NULL);
+		if (!stream->sws)
+		{
+			WLog_ERR(TAG, "sws_getCachedContext failed");
+			return FALSE;
+		}
+
+		for (size_t x = 0; x < ARRAYSIZE(srcSlice); x++)
+		{
+			srcSlice[x] = frame->data[x];
+			srcLineSizes[x] = frame->linesize[x];
+		}
+	}
+	else
+	{
+		/* convert from source format to YUV420P */
+		enum AVPixelFormat pixFormat = ecamToAVPixFormat(inputFormat);
+		BYTE* ptr = WINPR_CAST_CONST_PTR_AWAY(srcData, BYTE*);
+		if (av_image_fill_pointers(srcSlice, pixFormat, (int)size.height, ptr,
+		                           stream->srcLineSizes) < 0)
+			return FALSE;
+
+		for (size_t x = 0; x < ARRAYSIZE(srcLineSizes); x++)
+			srcLineSizes[x] = stream->srcLineSizes[x];
+	}
 
 	const BYTE* cSrcSlice[4] = { srcSlice[0], srcSlice[1], srcSlice[2], srcSlice[3] };
-	if (sws_scale(stream->sws, cSrcSlice, stream->srcLineSizes, 0, (int)size.height, yuv420pData,
+	if (sws_scale(stream->sws, cSrcSlice, srcLineSizes, 0, (int)size.height, yuv420pData,
 	              (int*)yuv420pStride) <= 0)
 		return FALSE;
 
@@ -129,6 +202,79 @@ static BOOL ecam_encoder_compress_h264(CameraDeviceStream* stream, const BYTE* s
 	return TRUE;
 }
 
+/**
+ * Function description
+ *
+ */
+static void ecam_encoder_context_free_mjpg(CameraDeviceStream* stream)
+{
+	WINPR_ASSERT(stream);
+
+	if (stream->avOutFrame)
+		av_frame_free(&stream->avOutFrame);
+
+	if (stream->avInputPkt)
+		av_packet_free(&stream->avInputPkt);
+
+	if (stream->avContext)
+		avcodec_free_context(&stream->avContext);
+}
+
+/**
+ * Function description
+ *
+ * @return success/failure
+ */
+static BOOL ecam_encoder_context_init_mjpg(CameraDeviceStream* stream)
+{
+	WINPR_ASSERT(stream);
+
+	const AVCodec* avcodec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+	if (!avcodec)
+	{
+		WLog_ERR(TAG, "avcodec_find_decoder failed to find MJPEG codec");
+		return FALSE;
+	}
+
+	stream->avContext = avcodec_alloc_context3(avcodec);
+	if (!stream->avContext)
+	{
+		WLog_ERR(TAG, "avcodec_alloc_context3 failed");
+		goto fail;
+	}
+
+	stream->avContext->width = (int)stream->currMediaType.Width;
+	stream->avContext->height = (int)stream->currMediaType.Height;
+	/* every JPEG is a key frame, there is nothing to gain from frame threading but latency */
+	stream->avContext->thread_count = 1;
+
+	if (avcodec_open2(stream->avContext, avcodec, NULL) < 0)
+	{
+		WLog_ERR(TAG, "avcodec_open2 failed");
+		goto fail;
+	}
+
+	stream->avInputPkt = av_packet_alloc();
+	if (!stream->avInputPkt)
+	{
+		WLog_ERR(TAG, "av_packet_alloc failed");
+		goto fail;
+	}
+
+	stream->avOutFrame = av_frame_alloc();
+	if (!stream->avOutFrame)
+	{
+		WLog_ERR(TAG, "av_frame_alloc failed");
+		goto fail;
+	}
+
+	return TRUE;
+
+fail:
+	ecam_encoder_context_free_mjpg(stream);
+	return FALSE;
+}
+
 /**
  * Function description
  *
@@ -142,6 +288,8 @@ static void ecam_encoder_context_free_h264(CameraDeviceStream* stream)
 		stream->sws = NULL;
 	}
 
+	ecam_encoder_context_free_mjpg(stream);
+
 	if (stream->h264)
 	{
 		h264_context_free(stream->h264);
@@ -190,7 +338,14 @@ static BOOL ecam_encoder_context_init_h264(CameraDeviceStream* stream)
 	if (!h264_context_set_option(stream->h264, H264_CONTEXT_OPTION_QP, 0))
 		goto fail;
 
-	/* initialize libswscale */
+	if (streamInputFormat(stream) == CAM_MEDIA_FORMAT_MJPG)
+	{
+		/* libswscale is set up once the first frame was decoded */
+		memset(stream->srcLineSizes, 0, sizeof(stream->srcLineSizes));
+		if (!ecam_encoder_context_init_mjpg(stream))
+			goto fail;
+	}
+	else /* initialize libswscale */
 	{
 		const int width = (int)stream->currMediaType.Width;
 		const int height = (int)stream->currMediaType.Height;
@@ -66,6 +66,12 @@
 #define MAX_CONTACTS 64
 #define MAX_PEN_CONTACTS 4
 
+/* contacts are collected and sent every RDPEI_FRAME_INTERVAL ms */
+#define RDPEI_FRAME_INTERVAL 20
+
+/* frames collected within one interval, sent together in one event PDU */
+#define MAX_PENDING_FRAMES 16
+
 typedef struct
 {
 	GENERIC_DYNVC_PLUGIN base;
@@ -75,15 +81,23 @@ typedef struct
 	UINT32 version;
 	UINT32 features; /* SC_READY_MULTIPEN_INJECTION_SUPPORTED */
 	UINT16 maxTouchContacts;
-	UINT64 currentFrameTime;
 	UINT64 previousFrameTime;
 	RDPINPUT_CONTACT_POINT contactPoints[MAX_CONTACTS];
 
-	UINT64 currentPenFrameTime;
+	RDPINPUT_TOUCH_FRAME touchFrames[MAX_PENDING_FRAMES];
+	RDPINPUT_CONTACT_DATA touchFrameContacts[MAX_PENDING_FRAMES][MAX_CONTACTS];
+	UINT16 touchFrameCount;
+	UINT64 firstTouchFrameTime;
+
 	UINT64 previousPenFrameTime;
 	UINT16 maxPenContacts;
 	RDPINPUT_PEN_CONTACT_POINT penContactPoints[MAX_PEN_CONTACTS];
 
+	RDPINPUT_PEN_FRAME penFrames[MAX_PENDING_FRAMES];
+	RDPINPUT_PEN_CONTACT penFrameContacts[MAX_PENDING_FRAMES][MAX_PEN_CONTACTS];
+	UINT16 penFrameCount;
+	UINT64 firstPenFrameTime;
+
 	CRITICAL_SECTION lock;
 	rdpContext* rdpcontext;
 
@@ -95,12 +109,9 @@ typedef struct
 	BOOL async;
 } RDPEI_PLUGIN;
 
-/**
- * Function description
- *
- * @return 0 on success, otherwise a Win32 error code
- */
-static UINT rdpei_send_frame(RdpeiClientContext* context, RDPINPUT_TOUCH_FRAME* frame);
+static UINT rdpei_send_touch_event_pdu(GENERIC_CHANNEL_CALLBACK* callback,
+                                       RDPINPUT_TOUCH_FRAME* frames, UINT16 count,
+                                       UINT32 encodeTime);
 
 #ifdef WITH_DEBUG_RDPEI
 static const char* rdpei_eventid_string(UINT16 event)
@@ -151,21 +162,19 @@ static RDPINPUT_CONTACT_POINT* rdpei_contact(RDPEI_PLUGIN* rdpei, INT32 external
 }
 
 /**
- * Function description
- *
- * @return 0 on success, otherwise a Win32 error code
+ * Takes the current contact state as the next frame of the pending touch
+ * event, the caller holds the lock and made room for it.
  */
-static UINT rdpei_add_frame(RdpeiClientContext* context)
+static void rdpei_collect_touch_frame(RDPEI_PLUGIN* rdpei, UINT64 now)
 {
-	RDPEI_PLUGIN* rdpei = NULL;
-	RDPINPUT_TOUCH_FRAME frame = { 0 };
-	RDPINPUT_CONTACT_DATA contacts[MAX_CONTACTS] = { 0 };
+	WINPR_ASSERT(rdpei);
+	WINPR_ASSERT(rdpei->touchFrameCount < MAX_PENDING_FRAMES);
 
-	if (!context || !context->handle)
-		return ERROR_INTERNAL_ERROR;
+	RDPINPUT_TOUCH_FRAME* frame = &rdpei->touchFrames[rdpei->touchFrameCount];
+	RDPINPUT_CONTACT_DATA* contacts = rdpei->touchFrameContacts[rdpei->touchFrameCount];
 
-	rdpei = (RDPEI_PLUGIN*)context->handle;
-	frame.contacts = contacts;
+	frame->contactCount = 0;
+	frame->contacts = contacts;
 
 	for (UINT16 i = 0; i < rdpei->maxTouchContacts; i++)
 	{
@@ -174,9 +183,9 @@ static UINT rdpei_add_frame(RdpeiClientContext* context)
 
 		if (contactPoint->dirty)
 		{
-			contacts[frame.contactCount] = *contact;
+			contacts[frame->contactCount] = *contact;
 			rdpei->contactPoints[i].dirty = FALSE;
-			frame.contactCount++;
+			frame->contactCount++;
 		}
 		else if (contactPoint->active)
 		{
@@ -187,8 +196,8 @@ static UINT rdpei_add_frame(RdpeiClientContext* context)
 				contact->contactFlags |= RDPINPUT_CONTACT_FLAG_INCONTACT;
 			}
 
-			contacts[frame.contactCount] = *contact;
-			frame.contactCount++;
+			contacts[frame->contactCount] = *contact;
+			frame->contactCount++;
 		}
 		if (contact->contactFlags & RDPINPUT_CONTACT_FLAG_UP)
 		{
@@ -198,17 +207,60 @@ static UINT rdpei_add_frame(RdpeiClientContext* context)
 		}
 	}
 
-	if (frame.contactCount > 0)
-	{
-		UINT error = rdpei_send_frame(context, &frame);
-		if (error != CHANNEL_RC_OK)
-		{
-			WLog_Print(rdpei->base.log, WLOG_ERROR,
-			           "rdpei_send_frame failed with error %" PRIu32 "!", error);
-			return error;
-		}
-	}
-	return CHANNEL_RC_OK;
+	if (frame->contactCount == 0)
+		return;
+
+	/* the first frame transmitted has no predecessor */
+	frame->frameOffset = rdpei->previousFrameTime ? now - rdpei->previousFrameTime : 0;
+	rdpei->previousFrameTime = now;
+
+	if (rdpei->touchFrameCount++ == 0)
+		rdpei->firstTouchFrameTime = now;
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpei_send_touch_frames(RDPEI_PLUGIN* rdpei, UINT64 now)
+{
+	WINPR_ASSERT(rdpei);
+
+	const UINT16 count = rdpei->touchFrameCount;
+	rdpei->touchFrameCount = 0;
+	if (count == 0)
+		return CHANNEL_RC_OK;
+
+	GENERIC_CHANNEL_CALLBACK* callback = rdpei->base.listener_callback->channel_callback;
+
+	/* Just ignore the event if the channel is not connected */
+	if (!callback)
+		return CHANNEL_RC_OK;
+
+	const UINT error = rdpei_send_touch_event_pdu(callback, rdpei->touchFrames, count,
+	                                              (UINT32)(now - rdpei->firstTouchFrameTime));
+	if (error != CHANNEL_RC_OK)
+		WLog_Print(rdpei->base.log, WLOG_ERROR,
+		           "rdpei_send_touch_event_pdu failed with error %" PRIu32 "!", error);
+	return error;
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpei_add_frame(RdpeiClientContext* context)
+{
+	if (!context || !context->handle)
+		return ERROR_INTERNAL_ERROR;
+
+	RDPEI_PLUGIN* rdpei = (RDPEI_PLUGIN*)context->handle;
+	const UINT64 now = GetTickCount64();
+
+	rdpei_collect_touch_frame(rdpei, now);
+	return rdpei_send_touch_frames(rdpei, now);
 }
 
 /**
@@ -249,7 +301,8 @@ static UINT rdpei_write_pen_frame(wStream* s, const RDPINPUT_PEN_FRAME* frame)
 
 	if (!rdpei_write_2byte_unsigned(s, frame->contactCount))
 		return ERROR_OUTOFMEMORY;
-	if (!rdpei_write_8byte_unsigned(s, frame->frameOffset))
+	/* frameOffset is in microseconds */
+	if (!rdpei_write_8byte_unsigned(s, frame->frameOffset * 1000))
 		return ERROR_OUTOFMEMORY;
 	for (UINT16 x = 0; x < frame->contactCount; x++)
 	{
@@ -295,7 +348,7 @@ static UINT rdpei_write_pen_frame(wStream* s, const RDPINPUT_PEN_FRAME* frame)
 	return CHANNEL_RC_OK;
 }
 
-static UINT rdpei_send_pen_event_pdu(GENERIC_CHANNEL_CALLBACK* callback, UINT32 frameOffset,
+static UINT rdpei_send_pen_event_pdu(GENERIC_CHANNEL_CALLBACK* callback, UINT32 encodeTime,
                                      const RDPINPUT_PEN_FRAME* frames, UINT16 count)
 {
 	UINT status = 0;
@@ -323,7 +376,7 @@ static UINT rdpei_send_pen_event_pdu(GENERIC_CHANNEL_CALLBACK* callback, UINT32
 	 * the time that has elapsed (in milliseconds) from when the oldest touch frame
 	 * was generated to when it was encoded for transmission by the client.
 	 */
-	rdpei_write_4byte_unsigned(s, frameOffset); /* encodeTime (FOUR_BYTE_UNSIGNED_INTEGER) */
+	rdpei_write_4byte_unsigned(s, encodeTime); /* encodeTime (FOUR_BYTE_UNSIGNED_INTEGER) */
 	rdpei_write_2byte_unsigned(s, count);       /* (frameCount) TWO_BYTE_UNSIGNED_INTEGER */
 
 	for (UINT16 x = 0; x < count; x++)
@@ -343,58 +396,43 @@ static UINT rdpei_send_pen_event_pdu(GENERIC_CHANNEL_CALLBACK* callback, UINT32
 	return status;
 }
 
-static UINT rdpei_send_pen_frame(RdpeiClientContext* context, RDPINPUT_PEN_FRAME* frame)
+static UINT rdpei_send_pen_frames(RDPEI_PLUGIN* rdpei, UINT64 now)
 {
-	const UINT64 currentTime = GetTickCount64();
-	RDPEI_PLUGIN* rdpei = NULL;
-	GENERIC_CHANNEL_CALLBACK* callback = NULL;
-	UINT error = 0;
+	WINPR_ASSERT(rdpei);
 
-	if (!context)
-		return ERROR_INTERNAL_ERROR;
-	rdpei = (RDPEI_PLUGIN*)context->handle;
-	if (!rdpei || !rdpei->base.listener_callback)
-		return ERROR_INTERNAL_ERROR;
-	if (!rdpei || !rdpei->rdpcontext)
+	const UINT16 count = rdpei->penFrameCount;
+	rdpei->penFrameCount = 0;
+	if (count == 0)
+		return CHANNEL_RC_OK;
+
+	if (!rdpei->base.listener_callback || !rdpei->rdpcontext)
 		return ERROR_INTERNAL_ERROR;
 	if (freerdp_settings_get_bool(rdpei->rdpcontext->settings, FreeRDP_SuspendInput))
 		return CHANNEL_RC_OK;
 
-	callback = rdpei->base.listener_callback->channel_callback;
+	GENERIC_CHANNEL_CALLBACK* callback = rdpei->base.listener_callback->channel_callback;
 	/* Just ignore the event if the channel is not connected */
 	if (!callback)
 		return CHANNEL_RC_OK;
 
-	if (!rdpei->previousPenFrameTime && !rdpei->currentPenFrameTime)
-	{
-		rdpei->currentPenFrameTime = currentTime;
-		frame->frameOffset = 0;
-	}
-	else
-	{
-		rdpei->currentPenFrameTime = currentTime;
-		frame->frameOffset = rdpei->currentPenFrameTime - rdpei->previousPenFrameTime;
-	}
-
-	if ((error = rdpei_send_pen_event_pdu(callback, frame->frameOffset, frame, 1)))
-		return error;
-
-	rdpei->previousPenFrameTime = rdpei->currentPenFrameTime;
-	return error;
+	return rdpei_send_pen_event_pdu(callback, (UINT32)(now - rdpei->firstPenFrameTime),
+	                                rdpei->penFrames, count);
 }
 
-static UINT rdpei_add_pen_frame(RdpeiClientContext* context)
+/**
+ * Takes the current pen state as the next frame of the pending pen event,
+ * the caller holds the lock and made room for it.
+ */
+static void rdpei_collect_pen_frame(RDPEI_PLUGIN* rdpei, UINT64 now)
 {
-	RDPEI_PLUGIN* rdpei = NULL;
-	RDPINPUT_PEN_FRAME penFrame = { 0 };
-	RDPINPUT_PEN_CONTACT penContacts[MAX_PEN_CONTACTS] = { 0 };
-
-	if (!context || !context->handle)
-		return ERROR_INTERNAL_ERROR;
+	WINPR_ASSERT(rdpei);
+	WINPR_ASSERT(rdpei->penFrameCount < MAX_PENDING_FRAMES);
 
-	rdpei = (RDPEI_PLUGIN*)context->handle;
+	RDPINPUT_PEN_FRAME* penFrame = &rdpei->penFrames[rdpei->penFrameCount];
+	RDPINPUT_PEN_CONTACT* penContacts = rdpei->penFrameContacts[rdpei->penFrameCount];
 
-	penFrame.contacts = penContacts;
+	penFrame->contactCount = 0;
+	penFrame->contacts = penContacts;
 
 	for (UINT16 i = 0; i < rdpei->maxPenContacts; i++)
 	{
@@ -402,7 +440,7 @@ static UINT rdpei_add_pen_frame(RdpeiClientContext* context)
 
 		if (contact->dirty)
 		{
-			penContacts[penFrame.contactCount++] = contact->data;
+			penContacts[penFrame->contactCount++] = contact->data;
 			contact->dirty = FALSE;
 		}
 		else if (contact->active)
@@ -414,7 +452,7 @@ static UINT rdpei_add_pen_frame(RdpeiClientContext* context)
 				contact->data.contactFlags |= RDPINPUT_CONTACT_FLAG_INCONTACT;
 			}
 
-			penContacts[penFrame.contactCount++] = contact->data;
+			penContacts[penFrame->contactCount++] = contact->data;
 		}
 		if (contact->data.contactFlags & RDPINPUT_CONTACT_FLAG_CANCELED)
 		{
@@ -423,9 +461,27 @@ static UINT rdpei_add_pen_frame(RdpeiClientContext* context)
 		}
 	}
 
-	if (penFrame.contactCount > 0)
-		return rdpei_send_pen_frame(context, &penFrame);
-	return CHANNEL_RC_OK;
+	if (penFrame->contactCount == 0)
+		return;
+
+	/* the first frame transmitted has no predecessor */
+	penFrame->frameOffset = rdpei->previousPenFrameTime ? now - rdpei->previousPenFrameTime : 0;
+	rdpei->previousPenFrameTime = now;
+
+	if (rdpei->penFrameCount++ == 0)
+		rdpei->firstPenFrameTime = now;
+}
+
+static UINT rdpei_add_pen_frame(RdpeiClientContext* context)
+{
+	if (!context || !context->handle)
+		return ERROR_INTERNAL_ERROR;
+
+	RDPEI_PLUGIN* rdpei = (RDPEI_PLUGIN*)context->handle;
+	const UINT64 now = GetTickCount64();
+
+	rdpei_collect_pen_frame(rdpei, now);
+	return rdpei_send_pen_frames(rdpei, now);
 }
 
 static UINT rdpei_update(wLog* log, RdpeiClientContext* context)
@@ -449,7 +505,8 @@ static BOOL rdpei_poll_run_unlocked(rdpContext* context, void* userdata)
 	const UINT64 now = GetTickCount64();
 
 	/* Send an event every ~20ms */
-	if ((now < rdpei->lastPollEventTime) || (now - rdpei->lastPollEventTime < 20ULL))
+	if ((now < rdpei->lastPollEventTime) ||
+	    (now - rdpei->lastPollEventTime < RDPEI_FRAME_INTERVAL))
 		return TRUE;
 
 	rdpei->lastPollEventTime = now;
@@ -503,7 +560,7 @@ static DWORD WINAPI rdpei_periodic_update(LPVOID arg)
 
 	while (rdpei->running)
 	{
-		status = WaitForSingleObject(rdpei->event, 20);
+		status = WaitForSingleObject(rdpei->event, RDPEI_FRAME_INTERVAL);
 
 		if (status == WAIT_FAILED)
 		{
@@ -513,6 +570,12 @@ static DWORD WINAPI rdpei_periodic_update(LPVOID arg)
 			break;
 		}
 
+		/* let the contacts of the interval accumulate instead of spinning on the event */
+		const UINT64 now = GetTickCount64();
+		const UINT64 next = rdpei->lastPollEventTime + RDPEI_FRAME_INTERVAL;
+		if ((now < next) && (next - now <= RDPEI_FRAME_INTERVAL))
+			Sleep((DWORD)(next - now));
+
 		error = rdpei_poll_run(rdpei->rdpcontext, rdpei);
 	}
 
@@ -693,11 +756,12 @@ static UINT rdpei_write_touch_frame(wLog* log, wStream* s, RDPINPUT_TOUCH_FRAME*
  * @return 0 on success, otherwise a Win32 error code
  */
 static UINT rdpei_send_touch_event_pdu(GENERIC_CHANNEL_CALLBACK* callback,
-                                       RDPINPUT_TOUCH_FRAME* frame)
+                                       RDPINPUT_TOUCH_FRAME* frames, UINT16 count,
+                                       UINT32 encodeTime)
 {
 	UINT status = 0;
 	wStream* s = NULL;
-	UINT32 pduLength = 0;
+	size_t pduLength = 64;
 	RDPEI_PLUGIN* rdpei = NULL;
 
 	WINPR_ASSERT(callback);
@@ -708,10 +772,11 @@ static UINT rdpei_send_touch_event_pdu(GENERIC_CHANNEL_CALLBACK* callback,
 	if (freerdp_settings_get_bool(rdpei->rdpcontext->settings, FreeRDP_SuspendInput))
 		return CHANNEL_RC_OK;
 
-	if (!frame)
+	if (!frames || (count == 0))
 		return ERROR_INTERNAL_ERROR;
 
-	pduLength = 64 + (frame->contactCount * 64);
+	for (UINT16 x = 0; x < count; x++)
+		pduLength += 16 + (frames[x].contactCount * 64ull);
 	s = Stream_New(NULL, pduLength);
 
 	if (!s)
@@ -725,22 +790,23 @@ static UINT rdpei_send_touch_event_pdu(GENERIC_CHANNEL_CALLBACK* callback,
 	 * the time that has elapsed (in milliseconds) from when the oldest touch frame
 	 * was generated to when it was encoded for transmission by the client.
 	 */
-	rdpei_write_4byte_unsigned(
-	    s, (UINT32)frame->frameOffset); /* encodeTime (FOUR_BYTE_UNSIGNED_INTEGER) */
-	rdpei_write_2byte_unsigned(s, 1);   /* (frameCount) TWO_BYTE_UNSIGNED_INTEGER */
+	rdpei_write_4byte_unsigned(s, encodeTime); /* encodeTime (FOUR_BYTE_UNSIGNED_INTEGER) */
+	rdpei_write_2byte_unsigned(s, count);      /* (frameCount) TWO_BYTE_UNSIGNED_INTEGER */
 
-	status = rdpei_write_touch_frame(rdpei->base.log, s, frame);
-	if (status)
+	for (UINT16 x = 0; x < count; x++)
 	{
-		WLog_Print(rdpei->base.log, WLOG_ERROR,
-		           "rdpei_write_touch_frame failed with error %" PRIu32 "!", status);
-		Stream_Free(s, TRUE);
-		return status;
+		status = rdpei_write_touch_frame(rdpei->base.log, s, &frames[x]);
+		if (status)
+		{
+			WLog_Print(rdpei->base.log, WLOG_ERROR,
+			           "rdpei_write_touch_frame failed with error %" PRIu32 "!", status);
+			Stream_Free(s, TRUE);
+			return status;
+		}
 	}
 
 	Stream_SealLength(s);
-	pduLength = Stream_Length(s);
-	status = rdpei_send_pdu(callback, s, EVENTID_TOUCH, pduLength);
+	status = rdpei_send_pdu(callback, s, EVENTID_TOUCH, (UINT32)Stream_Length(s));
 	Stream_Free(s, TRUE);
 	return status;
 }
@@ -976,46 +1042,6 @@ static UINT32 rdpei_get_features(RdpeiClientContext* context)
 	return rdpei->features;
 }
 
-/**
- * Function description
- *
- * @return 0 on success, otherwise a Win32 error code
- */
-UINT rdpei_send_frame(RdpeiClientContext* context, RDPINPUT_TOUCH_FRAME* frame)
-{
-	UINT64 currentTime = GetTickCount64();
-	RDPEI_PLUGIN* rdpei = (RDPEI_PLUGIN*)context->handle;
-	GENERIC_CHANNEL_CALLBACK* callback = NULL;
-	UINT error = 0;
-
-	callback = rdpei->base.listener_callback->channel_callback;
-
-	/* Just ignore the event if the channel is not connected */
-	if (!callback)
-		return CHANNEL_RC_OK;
-
-	if (!rdpei->previousFrameTime && !rdpei->currentFrameTime)
-	{
-		rdpei->currentFrameTime = currentTime;
-		frame->frameOffset = 0;
-	}
-	else
-	{
-		rdpei->currentFrameTime = currentTime;
-		frame->frameOffset = rdpei->currentFrameTime - rdpei->previousFrameTime;
-	}
-
-	if ((error = rdpei_send_touch_event_pdu(callback, frame)))
-	{
-		WLog_Print(rdpei->base.log, WLOG_ERROR,
-		           "rdpei_send_touch_event_pdu failed with error %" PRIu32 "!", error);
-		return error;
-	}
-
-	rdpei->previousFrameTime = rdpei->currentFrameTime;
-	return error;
-}
-
 /**
  * Function description
  *
@@ -1025,6 +1051,7 @@ static UINT rdpei_add_contact(RdpeiClientContext* context, const RDPINPUT_CONTAC
 {
 	RDPINPUT_CONTACT_POINT* contactPoint = NULL;
 	RDPEI_PLUGIN* rdpei = NULL;
+	UINT error = CHANNEL_RC_OK;
 	if (!context || !contact || !context->handle)
 		return ERROR_INTERNAL_ERROR;
 
@@ -1032,12 +1059,22 @@ static UINT rdpei_add_contact(RdpeiClientContext* context, const RDPINPUT_CONTAC
 
 	EnterCriticalSection(&rdpei->lock);
 	contactPoint = &rdpei->contactPoints[contact->contactId];
+
+	/* changed again within the interval, the unsent state goes to a frame of its own */
+	if (contactPoint->dirty)
+	{
+		const UINT64 now = GetTickCount64();
+		rdpei_collect_touch_frame(rdpei, now);
+		if (rdpei->touchFrameCount >= MAX_PENDING_FRAMES)
+			error = rdpei_send_touch_frames(rdpei, now);
+	}
+
 	contactPoint->data = *contact;
 	contactPoint->dirty = TRUE;
 	(void)SetEvent(rdpei->event);
 	LeaveCriticalSection(&rdpei->lock);
 
-	return CHANNEL_RC_OK;
+	return error;
 }
 
 static UINT rdpei_touch_process(RdpeiClientContext* context, INT32 externalId, UINT32 contactFlags,
@@ -1234,6 +1271,7 @@ static UINT rdpei_add_pen(RdpeiClientContext* context, INT32 externalId,
 {
 	RDPEI_PLUGIN* rdpei = NULL;
 	RDPINPUT_PEN_CONTACT_POINT* contactPoint = NULL;
+	UINT error = CHANNEL_RC_OK;
 
 	if (!context || !contact || !context->handle)
 		return ERROR_INTERNAL_ERROR;
@@ -1244,13 +1282,22 @@ static UINT rdpei_add_pen(RdpeiClientContext* context, INT32 externalId,
 	contactPoint = rdpei_pen_contact(rdpei, externalId, TRUE);
 	if (contactPoint)
 	{
+		/* changed again within the interval, the unsent state goes to a frame of its own */
+		if (contactPoint->dirty)
+		{
+			const UINT64 now = GetTickCount64();
+			rdpei_collect_pen_frame(rdpei, now);
+			if (rdpei->penFrameCount >= MAX_PENDING_FRAMES)
+				error = rdpei_send_pen_frames(rdpei, now);
+		}
+
 		contactPoint->data = *contact;
 		contactPoint->dirty = TRUE;
 		(void)SetEvent(rdpei->event);
 	}
 	LeaveCriticalSection(&rdpei->lock);
 
-	return CHANNEL_RC_OK;
+	return error;
 }
 
 static UINT rdpei_pen_process(RdpeiClientContext* context, INT32 externalId, UINT32 contactFlags,
@@ -1449,8 +1496,6 @@ static UINT init_plugin_cb(GENERIC_DYNVC_PLUGIN* base, rdpContext* rcontext, rdp
 	WINPR_UNUSED(settings);
 
 	rdpei->version = RDPINPUT_PROTOCOL_V300;
-	rdpei->currentFrameTime = 0;
-	rdpei->previousFrameTime = 0;
 	rdpei->maxTouchContacts = MAX_CONTACTS;
 	rdpei->maxPenContacts = MAX_PEN_CONTACTS;
 	rdpei->rdpcontext = rcontext;
@@ -22,8 +22,12 @@
 #include <freerdp/config.h>
 
 #include <winpr/crt.h>
+#include <winpr/pool.h>
+#include <winpr/synch.h>
 #include <winpr/stream.h>
+#include <winpr/collections.h>
 #include <freerdp/log.h>
+#include <freerdp/settings.h>
 #include <freerdp/utils/profiler.h>
 
 #include "rdpgfx_common.h"
@@ -256,7 +260,7 @@ fail:
  *
  * @return 0 on success, otherwise a Win32 error code
  */
-UINT rdpgfx_decode(RDPGFX_PLUGIN* gfx, RDPGFX_SURFACE_COMMAND* cmd)
+static UINT rdpgfx_decode_command(RDPGFX_PLUGIN* gfx, RDPGFX_SURFACE_COMMAND* cmd)
 {
 	UINT error = CHANNEL_RC_OK;
 	RdpgfxClientContext* context = gfx->context;
@@ -292,3 +296,321 @@ UINT rdpgfx_decode(RDPGFX_PLUGIN* gfx, RDPGFX_SURFACE_COMMAND* cmd)
 	PROFILER_EXIT(context->SurfaceProfiler)
 	return error;
 }
+
+typedef struct
+{
+	RDPGFX_PLUGIN* gfx;
+	CRITICAL_SECTION lock;
+	wQueue* commands;
+	PTP_WORK work;
+	HANDLE idle;
+	BOOL running;
+	UINT error;
+} RDPGFX_DECODE_QUEUE;
+
+static void rdpgfx_decode_queue_free(void* obj)
+{
+	RDPGFX_DECODE_QUEUE* queue = obj;
+
+	if (!queue)
+		return;
+
+	/* The callback might still be returning after it signalled idle */
+	if (queue->work)
+	{
+		WaitForThreadpoolWorkCallbacks(queue->work, FALSE);
+		CloseThreadpoolWork(queue->work);
+	}
+
+	Queue_Free(queue->commands);
+	if (queue->idle)
+		(void)CloseHandle(queue->idle);
+	DeleteCriticalSection(&queue->lock);
+	free(queue);
+}
+
+static VOID CALLBACK rdpgfx_decode_work_callback(PTP_CALLBACK_INSTANCE instance, void* context,
+                                                 PTP_WORK work)
+{
+	RDPGFX_DECODE_QUEUE* queue = context;
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+	WINPR_ASSERT(queue);
+
+	for (;;)
+	{
+		EnterCriticalSection(&queue->lock);
+		RDPGFX_SURFACE_COMMAND* cmd = Queue_Dequeue(queue->commands);
+
+		if (!cmd)
+		{
+			queue->running = FALSE;
+			(void)SetEvent(queue->idle);
+			LeaveCriticalSection(&queue->lock);
+			break;
+		}
+
+		LeaveCriticalSection(&queue->lock);
+
+		const UINT error = rdpgfx_decode_command(queue->gfx, cmd);
+		free(cmd);
+
+		if (error)
+		{
+			EnterCriticalSection(&queue->lock);
+			if (!queue->error)
+				queue->error = error;
+			LeaveCriticalSection(&queue->lock);
+		}
+	}
+}
+
+static RDPGFX_DECODE_QUEUE* rdpgfx_decode_queue_new(RDPGFX_PLUGIN* gfx)
+{
+	RDPGFX_DECODE_QUEUE* queue = calloc(1, sizeof(RDPGFX_DECODE_QUEUE));
+
+	if (!queue)
+		return NULL;
+
+	queue->gfx = gfx;
+
+	if (!InitializeCriticalSectionAndSpinCount(&queue->lock, 4000))
+	{
+		free(queue);
+		return NULL;
+	}
+
+	queue->commands = Queue_New(FALSE, -1, -1);
+	if (!queue->commands)
+		goto fail;
+
+	wObject* obj = Queue_Object(queue->commands);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = free;
+
+	queue->idle = CreateEventA(NULL, TRUE, TRUE, NULL);
+	if (!queue->idle)
+		goto fail;
+
+	queue->work = CreateThreadpoolWork(rdpgfx_decode_work_callback, queue, &gfx->DecodeEnv);
+	if (!queue->work)
+		goto fail;
+
+	return queue;
+
+fail:
+	rdpgfx_decode_queue_free(queue);
+	return NULL;
+}
+
+static RDPGFX_DECODE_QUEUE* rdpgfx_decode_get_queue(RDPGFX_PLUGIN* gfx, UINT16 surfaceId,
+                                                    BOOL create)
+{
+	const ULONG_PTR key = ((ULONG_PTR)surfaceId) + 1;
+	RDPGFX_DECODE_QUEUE* queue = HashTable_GetItemValue(gfx->DecodeQueues, (void*)key);
+
+	if (queue || !create)
+		return queue;
+
+	queue = rdpgfx_decode_queue_new(gfx);
+	if (!queue)
+		return NULL;
+
+	if (!HashTable_Insert(gfx->DecodeQueues, (void*)key, queue))
+	{
+		rdpgfx_decode_queue_free(queue);
+		return NULL;
+	}
+
+	return queue;
+}
+
+static UINT rdpgfx_decode_queue_wait(RDPGFX_DECODE_QUEUE* queue)
+{
+	WINPR_ASSERT(queue);
+
+	if (WaitForSingleObject(queue->idle, INFINITE) != WAIT_OBJECT_0)
+		return ERROR_INTERNAL_ERROR;
+
+	EnterCriticalSection(&queue->lock);
+	const UINT error = queue->error;
+	queue->error = CHANNEL_RC_OK;
+	LeaveCriticalSection(&queue->lock);
+	return error;
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpgfx_decode_submit(RDPGFX_PLUGIN* gfx, const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	RDPGFX_DECODE_QUEUE* queue =
+	    rdpgfx_decode_get_queue(gfx, (UINT16)MIN(UINT16_MAX, cmd->surfaceId), TRUE);
+
+	if (!queue)
+		return CHANNEL_RC_NO_MEMORY;
+
+	/* The PDU is only valid during the call, the command keeps a copy of the bitmap data */
+	RDPGFX_SURFACE_COMMAND* copy = malloc(sizeof(RDPGFX_SURFACE_COMMAND) + cmd->length);
+
+	if (!copy)
+		return CHANNEL_RC_NO_MEMORY;
+
+	*copy = *cmd;
+	copy->data = (BYTE*)&copy[1];
+	copy->extra = NULL;
+	memcpy(copy->data, cmd->data, cmd->length);
+
+	EnterCriticalSection(&queue->lock);
+	if (!Queue_Enqueue(queue->commands, copy))
+	{
+		LeaveCriticalSection(&queue->lock);
+		free(copy);
+		return CHANNEL_RC_NO_MEMORY;
+	}
+
+	if (!queue->running)
+	{
+		queue->running = TRUE;
+		(void)ResetEvent(queue->idle);
+		SubmitThreadpoolWork(queue->work);
+	}
+	LeaveCriticalSection(&queue->lock);
+	return CHANNEL_RC_OK;
+}
+
+static BOOL rdpgfx_decode_is_async(RDPGFX_PLUGIN* gfx, const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	if (!gfx->DecodePool || !gfx->inFrame)
+		return FALSE;
+
+	/* Only the H.264 decoders keep their state per surface, all others share their codec */
+	switch (cmd->codecId)
+	{
+		case RDPGFX_CODECID_AVC420:
+		case RDPGFX_CODECID_AVC444:
+		case RDPGFX_CODECID_AVC444v2:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+/**
+ * Function description
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+UINT rdpgfx_decode(RDPGFX_PLUGIN* gfx, RDPGFX_SURFACE_COMMAND* cmd)
+{
+	WINPR_ASSERT(gfx);
+	WINPR_ASSERT(cmd);
+
+	if (rdpgfx_decode_is_async(gfx, cmd))
+		return rdpgfx_decode_submit(gfx, cmd);
+
+	const UINT error = rdpgfx_decode_wait(gfx, (UINT16)MIN(UINT16_MAX, cmd->surfaceId));
+	if (error)
+		return error;
+
+	return rdpgfx_decode_command(gfx, cmd);
+}
+
+UINT rdpgfx_decode_wait(RDPGFX_PLUGIN* gfx, UINT16 surfaceId)
+{
+	WINPR_ASSERT(gfx);
+
+	if (!gfx->DecodeQueues)
+		return CHANNEL_RC_OK;
+
+	RDPGFX_DECODE_QUEUE* queue = rdpgfx_decode_get_queue(gfx, surfaceId, FALSE);
+	if (!queue)
+		return CHANNEL_RC_OK;
+
+	return rdpgfx_decode_queue_wait(queue);
+}
+
+static BOOL rdpgfx_decode_wait_cb(const void* key, void* value, void* arg)
+{
+	UINT* perror = arg;
+	WINPR_UNUSED(key);
+	WINPR_ASSERT(perror);
+
+	const UINT error = rdpgfx_decode_queue_wait(value);
+	if (error && !*perror)
+		*perror = error;
+	return TRUE;
+}
+
+UINT rdpgfx_decode_wait_all(RDPGFX_PLUGIN* gfx)
+{
+	UINT error = CHANNEL_RC_OK;
+	WINPR_ASSERT(gfx);
+
+	if (!gfx->DecodeQueues)
+		return CHANNEL_RC_OK;
+
+	HashTable_Foreach(gfx->DecodeQueues, rdpgfx_decode_wait_cb, &error);
+	return error;
+}
+
+UINT rdpgfx_decode_remove(RDPGFX_PLUGIN* gfx, UINT16 surfaceId)
+{
+	const UINT error = rdpgfx_decode_wait(gfx, surfaceId);
+
+	if (gfx->DecodeQueues)
+	{
+		const ULONG_PTR key = ((ULONG_PTR)surfaceId) + 1;
+		HashTable_Remove(gfx->DecodeQueues, (void*)key);
+	}
+
+	return error;
+}
+
+BOOL rdpgfx_decode_pipeline_init(RDPGFX_PLUGIN* gfx)
+{
+	WINPR_ASSERT(gfx);
+	WINPR_ASSERT(gfx->rdpcontext);
+
+	if (!freerdp_settings_get_bool(gfx->rdpcontext->settings, FreeRDP_GfxParallelDecode))
+		return TRUE;
+
+	gfx->DecodeQueues = HashTable_New(TRUE);
+	if (!gfx->DecodeQueues)
+		goto fail;
+
+	wObject* obj = HashTable_ValueObject(gfx->DecodeQueues);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = rdpgfx_decode_queue_free;
+
+	gfx->DecodePool = CreateThreadpool(NULL);
+	if (!gfx->DecodePool)
+		goto fail;
+
+	InitializeThreadpoolEnvironment(&gfx->DecodeEnv);
+	SetThreadpoolCallbackPool(&gfx->DecodeEnv, gfx->DecodePool);
+	return TRUE;
+
+fail:
+	WLog_Print(gfx->log, WLOG_ERROR, "failed to create the decode pool, decoding serially");
+	rdpgfx_decode_pipeline_uninit(gfx);
+	return FALSE;
+}
+
+void rdpgfx_decode_pipeline_uninit(RDPGFX_PLUGIN* gfx)
+{
+	WINPR_ASSERT(gfx);
+
+	(void)rdpgfx_decode_wait_all(gfx);
+	HashTable_Free(gfx->DecodeQueues);
+	gfx->DecodeQueues = NULL;
+
+	if (gfx->DecodePool)
+	{
+		CloseThreadpool(gfx->DecodePool);
+		DestroyThreadpoolEnvironment(&gfx->DecodeEnv);
+		gfx->DecodePool = NULL;
+	}
+}
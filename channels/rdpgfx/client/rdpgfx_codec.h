@@ -32,4 +32,14 @@
 
 FREERDP_LOCAL UINT rdpgfx_decode(RDPGFX_PLUGIN* gfx, RDPGFX_SURFACE_COMMAND* cmd);
 
+FREERDP_LOCAL BOOL rdpgfx_decode_pipeline_init(RDPGFX_PLUGIN* gfx);
+FREERDP_LOCAL void rdpgfx_decode_pipeline_uninit(RDPGFX_PLUGIN* gfx);
+
+/* Waits until the queued surface commands of a surface are decoded, returns their first error */
+FREERDP_LOCAL UINT rdpgfx_decode_wait(RDPGFX_PLUGIN* gfx, UINT16 surfaceId);
+FREERDP_LOCAL UINT rdpgfx_decode_wait_all(RDPGFX_PLUGIN* gfx);
+
+/* Waits for the surface and drops its queue */
+FREERDP_LOCAL UINT rdpgfx_decode_remove(RDPGFX_PLUGIN* gfx, UINT16 surfaceId);
+
 #endif /* FREERDP_CHANNEL_RDPGFX_CLIENT_CODEC_H */
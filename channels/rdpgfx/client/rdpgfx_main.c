@@ -26,6 +26,7 @@
 #include <winpr/assert.h>
 
 #include <winpr/crt.h>
+#include <winpr/file.h>
 #include <winpr/wlog.h>
 #include <winpr/print.h>
 #include <winpr/synch.h>
@@ -45,6 +46,11 @@
 
 #define TAG CHANNELS_TAG("rdpgfx.client")
 
+#define RDPGFX_MAX_QUEUE_DEPTH 16
+
+/* size budget of the persistent cache file, the maximum cache size of a gfx session */
+#define RDPGFX_PERSISTENT_CACHE_MAX_SIZE (100ull * 1024ull * 1024ull)
+
 static BOOL delete_surface(const void* key, void* value, void* arg)
 {
 	const UINT16 id = (UINT16)(uintptr_t)(key);
@@ -358,6 +364,62 @@ static UINT rdpgfx_send_supported_caps(GENERIC_CHANNEL_CALLBACK* callback)
 	return IFCALLRESULT(ERROR_BAD_CONFIGURATION, context->CapsAdvertise, context, &pdu);
 }
 
+static void rdpgfx_reset_queue_depth(RDPGFX_PLUGIN* gfx)
+{
+	WINPR_ASSERT(gfx);
+	gfx->FrameStartTime = 0;
+	gfx->FrameEndTime = 0;
+	gfx->FrameBusyTime = 0;
+	gfx->FrameIdleTime = 0;
+}
+
+/* Smooths the time spent decoding and presenting a frame and the time waiting for the next one */
+static void rdpgfx_update_queue_depth(RDPGFX_PLUGIN* gfx)
+{
+	WINPR_ASSERT(gfx);
+
+	const UINT64 now = winpr_GetTickCount64NS() / 1000;
+	const UINT64 start = gfx->FrameStartTime;
+	if ((start == 0) || (start > now))
+		return;
+
+	const UINT64 busy = now - start;
+	if ((gfx->FrameEndTime != 0) && (gfx->FrameEndTime <= start))
+	{
+		const UINT64 idle = start - gfx->FrameEndTime;
+
+		if (gfx->FrameBusyTime == 0)
+		{
+			gfx->FrameBusyTime = MAX(busy, 1);
+			gfx->FrameIdleTime = idle;
+		}
+		else
+		{
+			gfx->FrameBusyTime = (7 * gfx->FrameBusyTime + busy) / 8;
+			gfx->FrameIdleTime = (7 * gfx->FrameIdleTime + idle) / 8;
+		}
+	}
+	gfx->FrameEndTime = now;
+}
+
+/**
+ * Frames are decoded and presented one after the other, those arriving in the meantime wait in
+ * the channel. With the utilization rho = busy / (busy + idle) the mean number of waiting frames
+ * is rho / (1 - rho) = busy / idle. A client that falls behind starts the next frame right after
+ * the previous one, the idle time goes to 0 and the advertised depth grows.
+ */
+static UINT32 rdpgfx_queue_depth(RDPGFX_PLUGIN* gfx)
+{
+	WINPR_ASSERT(gfx);
+
+	if (gfx->FrameBusyTime == 0)
+		return QUEUE_DEPTH_UNAVAILABLE;
+
+	const UINT64 idle = MAX(gfx->FrameIdleTime, 1);
+	const UINT64 depth = (gfx->FrameBusyTime + idle / 2) / idle;
+	return (UINT32)MIN(depth, RDPGFX_MAX_QUEUE_DEPTH);
+}
+
 /**
  * Function description
  *
@@ -382,6 +444,7 @@ static UINT rdpgfx_recv_caps_confirm_pdu(GENERIC_CHANNEL_CALLBACK* callback, wSt
 	Stream_Read_UINT32(s, capsSet.length);  /* capsDataLength (4 bytes) */
 	Stream_Read_UINT32(s, capsSet.flags);   /* capsData (4 bytes) */
 	gfx->TotalDecodedFrames = 0;
+	rdpgfx_reset_queue_depth(gfx);
 	gfx->ConnectionCaps = capsSet;
 	DEBUG_RDPGFX(gfx->log,
 	             "RecvCapsConfirmPdu: version: %s [0x%08" PRIX32 "] flags: 0x%08" PRIX32 "",
@@ -577,7 +640,10 @@ static UINT rdpgfx_recv_reset_graphics_pdu(GENERIC_CHANNEL_CALLBACK* callback, w
 	}
 #endif
 
-	if (context)
+	/* Surface commands still decoding in the background must finish first */
+	error = rdpgfx_decode_wait_all(gfx);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->ResetGraphics, error, context, &pdu);
 
@@ -691,7 +757,7 @@ static UINT rdpgfx_load_cache_import_offer(RDPGFX_PLUGIN* gfx, RDPGFX_CACHE_IMPO
 
 	for (int idx = 0; idx < count; idx++)
 	{
-		if (persistent_cache_read_entry(persistent, &entry) < 1)
+		if (persistent_cache_read_key(persistent, &entry) < 1)
 		{
 			error = ERROR_INVALID_DATA;
 			goto fail;
@@ -709,6 +775,60 @@ fail:
 	return error;
 }
 
+static int rdpgfx_cache_key_compare(const void* a, const void* b)
+{
+	const UINT64 ka = *(const UINT64*)a;
+	const UINT64 kb = *(const UINT64*)b;
+
+	if (ka < kb)
+		return -1;
+	return (ka > kb) ? 1 : 0;
+}
+
+/**
+ * Append the entries of the previous cache file that were not written yet, in their old
+ * order. Entries that fall outside the budget are dropped, so bitmaps unused for the
+ * longest time age out first.
+ */
+static void rdpgfx_merge_persistent_cache(rdpPersistentCache* persistent, const char* filename,
+                                          UINT64* keys, size_t* pCount, UINT64* pSize)
+{
+	PERSISTENT_CACHE_ENTRY entry = { 0 };
+	size_t written = *pCount;
+	rdpPersistentCache* previous = persistent_cache_new();
+
+	if (!previous)
+		return;
+
+	if ((persistent_cache_open(previous, filename, FALSE, 3) < 1) ||
+	    (persistent_cache_get_version(previous) != 3))
+		goto out;
+
+	qsort(keys, written, sizeof(UINT64), rdpgfx_cache_key_compare);
+
+	while (*pCount < RDPGFX_CACHE_ENTRY_MAX_COUNT - 1)
+	{
+		if (persistent_cache_read_entry(previous, &entry) < 1)
+			break;
+
+		if (*pSize + entry.size > RDPGFX_PERSISTENT_CACHE_MAX_SIZE)
+			continue;
+
+		/* the cache is content addressed, the current session copy wins */
+		if (bsearch(&entry.key64, keys, written, sizeof(UINT64), rdpgfx_cache_key_compare))
+			continue;
+
+		if (persistent_cache_write_entry(persistent, &entry) < 1)
+			break;
+
+		keys[(*pCount)++] = entry.key64;
+		*pSize += entry.size;
+	}
+
+out:
+	persistent_cache_free(previous);
+}
+
 /**
  * Function description
  *
@@ -719,6 +839,10 @@ static UINT rdpgfx_save_persistent_cache(RDPGFX_PLUGIN* gfx)
 	UINT error = CHANNEL_RC_OK;
 	PERSISTENT_CACHE_ENTRY cacheEntry;
 	rdpPersistentCache* persistent = NULL;
+	char* tmpFile = NULL;
+	UINT64* keys = NULL;
+	size_t count = 0;
+	UINT64 size = 0;
 	WINPR_ASSERT(gfx);
 	WINPR_ASSERT(gfx->rdpcontext);
 	rdpSettings* settings = gfx->rdpcontext->settings;
@@ -738,17 +862,25 @@ static UINT rdpgfx_save_persistent_cache(RDPGFX_PLUGIN* gfx)
 	if (!context->ExportCacheEntry)
 		return CHANNEL_RC_INITIALIZATION_ERROR;
 
+	size_t tmpLen = 0;
+	(void)winpr_asprintf(&tmpFile, &tmpLen, "%s.tmp", BitmapCachePersistFile);
+	keys = calloc(RDPGFX_CACHE_ENTRY_MAX_COUNT, sizeof(UINT64));
 	persistent = persistent_cache_new();
 
-	if (!persistent)
-		return CHANNEL_RC_NO_MEMORY;
+	if (!tmpFile || !keys || !persistent)
+	{
+		error = CHANNEL_RC_NO_MEMORY;
+		goto fail;
+	}
 
-	if (persistent_cache_open(persistent, BitmapCachePersistFile, TRUE, 3) < 1)
+	/* write a new file, the previous one still provides the older entries */
+	if (persistent_cache_open(persistent, tmpFile, TRUE, 3) < 1)
 	{
 		error = CHANNEL_RC_INITIALIZATION_ERROR;
 		goto fail;
 	}
 
+	/* entries of this session first, they are offered first on the next connect */
 	for (UINT16 idx = 0; idx < gfx->MaxCacheSlots; idx++)
 	{
 		if (gfx->CacheSlots[idx])
@@ -758,15 +890,33 @@ static UINT rdpgfx_save_persistent_cache(RDPGFX_PLUGIN* gfx)
 			if (context->ExportCacheEntry(context, cacheSlot, &cacheEntry) != CHANNEL_RC_OK)
 				continue;
 
-			persistent_cache_write_entry(persistent, &cacheEntry);
+			if ((count >= RDPGFX_CACHE_ENTRY_MAX_COUNT - 1) ||
+			    (size + cacheEntry.size > RDPGFX_PERSISTENT_CACHE_MAX_SIZE))
+				continue;
+
+			if (persistent_cache_write_entry(persistent, &cacheEntry) < 1)
+				continue;
+
+			keys[count++] = cacheEntry.key64;
+			size += cacheEntry.size;
 		}
 	}
 
-	persistent_cache_free(persistent);
+	rdpgfx_merge_persistent_cache(persistent, BitmapCachePersistFile, keys, &count, &size);
+	persistent_cache_close(persistent);
+
+	if (!MoveFileExA(tmpFile, BitmapCachePersistFile, MOVEFILE_REPLACE_EXISTING))
+	{
+		WLog_Print(gfx->log, WLOG_WARN, "Failed to replace persistent cache %s",
+		           BitmapCachePersistFile);
+		(void)DeleteFileA(tmpFile);
+		error = ERROR_INTERNAL_ERROR;
+	}
 
-	return error;
 fail:
 	persistent_cache_free(persistent);
+	free(keys);
+	free(tmpFile);
 	return error;
 }
 
@@ -908,7 +1058,7 @@ static UINT rdpgfx_send_cache_offer(RDPGFX_PLUGIN* gfx)
 
 	for (int idx = 0; idx < count; idx++)
 	{
-		if (persistent_cache_read_entry(persistent, &entry) < 1)
+		if (persistent_cache_read_key(persistent, &entry) < 1)
 		{
 			error = ERROR_INVALID_DATA;
 			goto fail;
@@ -1092,6 +1242,7 @@ static UINT rdpgfx_recv_create_surface_pdu(GENERIC_CHANNEL_CALLBACK* callback, w
 		 * manually.
 		 */
 		RDPGFX_DELETE_SURFACE_PDU deletePdu = { pdu.surfaceId };
+		(void)rdpgfx_decode_remove(gfx, pdu.surfaceId);
 		IFCALL(context->DeleteSurface, context, &deletePdu);
 
 		IFCALLRET(context->CreateSurface, error, context, &pdu);
@@ -1124,7 +1275,9 @@ static UINT rdpgfx_recv_delete_surface_pdu(GENERIC_CHANNEL_CALLBACK* callback, w
 	Stream_Read_UINT16(s, pdu.surfaceId); /* surfaceId (2 bytes) */
 	DEBUG_RDPGFX(gfx->log, "RecvDeleteSurfacePdu: surfaceId: %" PRIu16 "", pdu.surfaceId);
 
-	if (context)
+	error = rdpgfx_decode_remove(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->DeleteSurface, error, context, &pdu);
 
@@ -1158,6 +1311,8 @@ static UINT rdpgfx_recv_start_frame_pdu(GENERIC_CHANNEL_CALLBACK* callback, wStr
 	DEBUG_RDPGFX(gfx->log, "RecvStartFramePdu: frameId: %" PRIu32 " timestamp: 0x%08" PRIX32 "",
 	             pdu.frameId, pdu.timestamp);
 	gfx->StartDecodingTime = GetTickCount64();
+	gfx->FrameStartTime = winpr_GetTickCount64NS() / 1000;
+	gfx->inFrame = TRUE;
 
 	if (context)
 	{
@@ -1194,7 +1349,10 @@ static UINT rdpgfx_recv_end_frame_pdu(GENERIC_CHANNEL_CALLBACK* callback, wStrea
 	DEBUG_RDPGFX(gfx->log, "RecvEndFramePdu: frameId: %" PRIu32 "", pdu.frameId);
 
 	const UINT64 start = GetTickCount64();
-	if (context)
+	gfx->inFrame = FALSE;
+	error = rdpgfx_decode_wait_all(gfx);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->EndFrame, error, context, &pdu);
 
@@ -1207,7 +1365,9 @@ static UINT rdpgfx_recv_end_frame_pdu(GENERIC_CHANNEL_CALLBACK* callback, wStrea
 	}
 	const UINT64 end = GetTickCount64();
 	const UINT64 EndFrameTime = end - start;
+	freerdp_connection_trace_graphics_update(gfx->rdpcontext);
 	gfx->TotalDecodedFrames++;
+	rdpgfx_update_queue_depth(gfx);
 
 	if (!gfx->sendFrameAcks)
 		return error;
@@ -1227,7 +1387,7 @@ static UINT rdpgfx_recv_end_frame_pdu(GENERIC_CHANNEL_CALLBACK* callback, wStrea
 	}
 	else
 	{
-		ack.queueDepth = QUEUE_DEPTH_UNAVAILABLE;
+		ack.queueDepth = rdpgfx_queue_depth(gfx);
 
 		if ((error = rdpgfx_send_frame_acknowledge_pdu(context, &ack)))
 			WLog_Print(gfx->log, WLOG_ERROR,
@@ -1424,7 +1584,9 @@ static UINT rdpgfx_recv_wire_to_surface_2_pdu(GENERIC_CHANNEL_CALLBACK* callback
 	cmd.data = pdu.bitmapData;
 	cmd.extra = NULL;
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->SurfaceCommand, error, context, &cmd);
 
@@ -1460,7 +1622,9 @@ static UINT rdpgfx_recv_delete_encoding_context_pdu(GENERIC_CHANNEL_CALLBACK* ca
 	             "RecvDeleteEncodingContextPdu: surfaceId: %" PRIu16 " codecContextId: %" PRIu32 "",
 	             pdu.surfaceId, pdu.codecContextId);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->DeleteEncodingContext, error, context, &pdu);
 
@@ -1527,7 +1691,9 @@ static UINT rdpgfx_recv_solid_fill_pdu(GENERIC_CHANNEL_CALLBACK* callback, wStre
 	DEBUG_RDPGFX(gfx->log, "RecvSolidFillPdu: surfaceId: %" PRIu16 " fillRectCount: %" PRIu16 "",
 	             pdu.surfaceId, pdu.fillRectCount);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->SolidFill, error, context, &pdu);
 
@@ -1601,7 +1767,11 @@ static UINT rdpgfx_recv_surface_to_surface_pdu(GENERIC_CHANNEL_CALLBACK* callbac
 	             pdu.surfaceIdSrc, pdu.surfaceIdDest, pdu.rectSrc.left, pdu.rectSrc.top,
 	             pdu.rectSrc.right, pdu.rectSrc.bottom, pdu.destPtsCount);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceIdSrc);
+	if (!error)
+		error = rdpgfx_decode_wait(gfx, pdu.surfaceIdDest);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->SurfaceToSurface, error, context, &pdu);
 
@@ -1650,7 +1820,9 @@ static UINT rdpgfx_recv_surface_to_cache_pdu(GENERIC_CHANNEL_CALLBACK* callback,
 	             pdu.surfaceId, pdu.cacheKey, pdu.cacheSlot, pdu.rectSrc.left, pdu.rectSrc.top,
 	             pdu.rectSrc.right, pdu.rectSrc.bottom);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->SurfaceToCache, error, context, &pdu);
 
@@ -1714,7 +1886,9 @@ static UINT rdpgfx_recv_cache_to_surface_pdu(GENERIC_CHANNEL_CALLBACK* callback,
 	             " destPtsCount: %" PRIu16 "",
 	             pdu.cacheSlot, pdu.surfaceId, pdu.destPtsCount);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->CacheToSurface, error, context, &pdu);
 
@@ -1754,7 +1928,9 @@ static UINT rdpgfx_recv_map_surface_to_output_pdu(GENERIC_CHANNEL_CALLBACK* call
 	             " outputOriginY: %" PRIu32 "",
 	             pdu.surfaceId, pdu.outputOriginX, pdu.outputOriginY);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->MapSurfaceToOutput, error, context, &pdu);
 
@@ -1792,7 +1968,9 @@ static UINT rdpgfx_recv_map_surface_to_scaled_output_pdu(GENERIC_CHANNEL_CALLBAC
 	             pdu.surfaceId, pdu.outputOriginX, pdu.outputOriginY, pdu.targetWidth,
 	             pdu.targetHeight);
 
-	if (context)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error)
 	{
 		IFCALLRET(context->MapSurfaceToScaledOutput, error, context, &pdu);
 
@@ -1831,7 +2009,9 @@ static UINT rdpgfx_recv_map_surface_to_window_pdu(GENERIC_CHANNEL_CALLBACK* call
 	             " mappedWidth: %" PRIu32 " mappedHeight: %" PRIu32 "",
 	             pdu.surfaceId, pdu.windowId, pdu.mappedWidth, pdu.mappedHeight);
 
-	if (context && context->MapSurfaceToWindow)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error && context->MapSurfaceToWindow)
 	{
 		IFCALLRET(context->MapSurfaceToWindow, error, context, &pdu);
 
@@ -1869,7 +2049,9 @@ static UINT rdpgfx_recv_map_surface_to_scaled_window_pdu(GENERIC_CHANNEL_CALLBAC
 	             pdu.surfaceId, pdu.windowId, pdu.mappedWidth, pdu.mappedHeight, pdu.targetWidth,
 	             pdu.targetHeight);
 
-	if (context && context->MapSurfaceToScaledWindow)
+	error = rdpgfx_decode_wait(gfx, pdu.surfaceId);
+
+	if (context && !error && context->MapSurfaceToScaledWindow)
 	{
 		IFCALLRET(context->MapSurfaceToScaledWindow, error, context, &pdu);
 
@@ -2194,12 +2376,15 @@ static UINT rdpgfx_on_close(IWTSVirtualChannelCallback* pChannelCallback)
 		           "rdpgfx_save_persistent_cache failed with error %" PRIu32 "", error);
 	}
 
+	(void)rdpgfx_decode_wait_all(gfx);
+	gfx->inFrame = FALSE;
 	free_surfaces(context, gfx->SurfaceTable);
 	evict_cache_slots(context, gfx->MaxCacheSlots, gfx->CacheSlots);
 
 	free(callback);
 	gfx->UnacknowledgedFrames = 0;
 	gfx->TotalDecodedFrames = 0;
+	rdpgfx_reset_queue_depth(gfx);
 
 	if (context)
 	{
@@ -2350,6 +2535,9 @@ static UINT init_plugin_cb(GENERIC_DYNVC_PLUGIN* base, rdpContext* rcontext, rdp
 	gfx->rdpcontext = rcontext;
 	gfx->log = WLog_Get(TAG);
 
+	/* decoding a frame takes long, do not let input and other channels wait for it */
+	base->listenerFlags = DVC_LISTENER_FLAG_OWN_THREAD;
+
 	gfx->SurfaceTable = HashTable_New(TRUE);
 	if (!gfx->SurfaceTable)
 	{
@@ -2381,6 +2569,9 @@ static UINT init_plugin_cb(GENERIC_DYNVC_PLUGIN* base, rdpContext* rcontext, rdp
 		return CHANNEL_RC_NO_MEMORY;
 	}
 
+	/* Without the decode pool all surface commands are decoded on the channel thread */
+	(void)rdpgfx_decode_pipeline_init(gfx);
+
 	context->handle = (void*)gfx;
 	context->GetSurfaceIds = rdpgfx_get_surface_ids;
 	context->SetSurfaceData = rdpgfx_set_surface_data;
@@ -2407,6 +2598,7 @@ void rdpgfx_client_context_free(RdpgfxClientContext* context)
 
 	gfx = (RDPGFX_PLUGIN*)context->handle;
 
+	rdpgfx_decode_pipeline_uninit(gfx);
 	free_surfaces(context, gfx->SurfaceTable);
 	evict_cache_slots(context, gfx->MaxCacheSlots, gfx->CacheSlots);
 
@@ -25,6 +25,7 @@
 #include <freerdp/addin.h>
 
 #include <winpr/wlog.h>
+#include <winpr/pool.h>
 #include <winpr/collections.h>
 
 #include <freerdp/client/channels.h>
@@ -42,11 +43,22 @@ typedef struct
 	UINT32 UnacknowledgedFrames;
 	UINT32 TotalDecodedFrames;
 	UINT64 StartDecodingTime;
+	/* Frame pacing in us, see rdpgfx_queue_depth */
+	UINT64 FrameStartTime;
+	UINT64 FrameEndTime;
+	UINT64 FrameBusyTime;
+	UINT64 FrameIdleTime;
 	BOOL suspendFrameAcks;
 	BOOL sendFrameAcks;
 
 	wHashTable* SurfaceTable;
 
+	/* Surface commands decoded on DecodePool, see rdpgfx_decode_wait */
+	BOOL inFrame;
+	PTP_POOL DecodePool;
+	TP_CALLBACK_ENVIRON DecodeEnv;
+	wHashTable* DecodeQueues;
+
 	UINT16 MaxCacheSlots;
 	void* CacheSlots[25600];
 	rdpPersistentCache* persistent;
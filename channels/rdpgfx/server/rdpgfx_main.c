@@ -28,6 +28,7 @@
 #include <winpr/synch.h>
 #include <winpr/thread.h>
 #include <winpr/stream.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/codec/color.h>
@@ -106,23 +107,26 @@ static INLINE BOOL rdpgfx_server_packet_complete_header(wStream* s, size_t start
 
 /**
  * Function description
- * Send the stream for rdpgfx server packet.
- * The packet would be compressed according to [MS-RDPEGFX].
+ * Compress one or more rdpgfx PDUs according to [MS-RDPEGFX] and write them to the channel.
  *
  * @return 0 on success, otherwise a Win32 error code
  */
-static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
+static UINT rdpgfx_server_write_compressed(RdpgfxServerContext* context, const BYTE* pSrcData,
+                                           size_t SrcSize)
 {
 	UINT error = 0;
 	UINT32 flags = 0;
-	ULONG written = 0;
-	BYTE* pSrcData = Stream_Buffer(s);
-	UINT32 SrcSize = Stream_GetPosition(s);
 	wStream* fs = NULL;
-	/* Allocate new stream with enough capacity. Additional overhead is
+
+	if (SrcSize > UINT32_MAX)
+		return ERROR_INVALID_DATA;
+
+	/* Take a stream with enough capacity. Additional overhead is
 	 * descriptor (1 bytes) + segmentCount (2 bytes) + uncompressedSize (4 bytes)
-	 * + segmentCount * size (4 bytes) */
-	fs = Stream_New(NULL, SrcSize + 7 + (SrcSize / ZGFX_SEGMENTED_MAXSIZE + 1) * 4);
+	 * + segmentCount * (size (4 bytes) + header (1 byte))
+	 * Not taken from the packet pool, the stream is queued until the peer thread sent it and
+	 * might outlive this context. */
+	fs = Stream_New(NULL, SrcSize + 7 + (SrcSize / ZGFX_SEGMENTED_MAXSIZE + 1) * 5);
 
 	if (!fs)
 	{
@@ -131,32 +135,97 @@ static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
 		goto out;
 	}
 
-	if (zgfx_compress_to_stream(context->priv->zgfx, fs, pSrcData, SrcSize, &flags) < 0)
+	if (zgfx_compress_to_stream(context->priv->zgfx, fs, pSrcData, (UINT32)SrcSize, &flags) < 0)
 	{
 		WLog_Print(context->priv->log, WLOG_ERROR, "zgfx_compress_to_stream failed!");
 		error = ERROR_INTERNAL_ERROR;
 		goto out;
 	}
 
-	if (!WTSVirtualChannelWrite(context->priv->rdpgfx_channel, Stream_BufferAs(fs, char),
-	                            Stream_GetPosition(fs), &written))
+	/* the channel takes over the stream, the PDUs reference it instead of a copy */
+	const BOOL rc = WTSVirtualChannelWriteStream(context->priv->rdpgfx_channel, fs);
+	fs = NULL;
+
+	if (!rc)
 	{
-		WLog_Print(context->priv->log, WLOG_ERROR, "WTSVirtualChannelWrite failed!");
+		WLog_Print(context->priv->log, WLOG_ERROR, "WTSVirtualChannelWriteStream failed!");
 		error = ERROR_INTERNAL_ERROR;
 		goto out;
 	}
 
-	if (written < Stream_GetPosition(fs))
-	{
-		WLog_Print(context->priv->log, WLOG_WARN,
-		           "Unexpected bytes written: %" PRIu32 "/%" PRIuz "", written,
-		           Stream_GetPosition(fs));
-	}
-
 	error = CHANNEL_RC_OK;
 out:
 	Stream_Free(fs, TRUE);
-	Stream_Free(s, TRUE);
+	return error;
+}
+
+/**
+ * Function description
+ * Send the stream for rdpgfx server packet, or append it to the open batch.
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpgfx_server_packet_send(RdpgfxServerContext* context, wStream* s)
+{
+	UINT error = CHANNEL_RC_OK;
+	wStream* batch = context->priv->batch;
+
+	if (batch)
+	{
+		if (Stream_EnsureRemainingCapacity(batch, Stream_GetPosition(s)))
+			Stream_Write(batch, Stream_Buffer(s), Stream_GetPosition(s));
+		else
+			error = CHANNEL_RC_NO_MEMORY;
+	}
+	else
+		error = rdpgfx_server_write_compressed(context, Stream_Buffer(s), Stream_GetPosition(s));
+
+	Stream_Release(s);
+	return error;
+}
+
+/**
+ * Function description
+ * Collect all PDUs until rdpgfx_server_end_batch into a single zgfx payload
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpgfx_server_begin_batch(RdpgfxServerContext* context)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(context->priv);
+
+	if (context->priv->batch)
+		return ERROR_INVALID_STATE;
+
+	context->priv->batch = StreamPool_Take(context->priv->packet_pool, 0);
+	if (!context->priv->batch)
+		return CHANNEL_RC_NO_MEMORY;
+	return CHANNEL_RC_OK;
+}
+
+/**
+ * Function description
+ * Compress and send the PDUs collected since rdpgfx_server_begin_batch
+ *
+ * @return 0 on success, otherwise a Win32 error code
+ */
+static UINT rdpgfx_server_end_batch(RdpgfxServerContext* context)
+{
+	UINT error = CHANNEL_RC_OK;
+
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(context->priv);
+
+	wStream* batch = context->priv->batch;
+	if (!batch)
+		return ERROR_INVALID_STATE;
+
+	context->priv->batch = NULL;
+	if (Stream_GetPosition(batch) > 0)
+		error =
+		    rdpgfx_server_write_compressed(context, Stream_Buffer(batch), Stream_GetPosition(batch));
+	Stream_Release(batch);
 	return error;
 }
 
@@ -172,16 +241,18 @@ out:
  *
  * @return new stream
  */
-static wStream* rdpgfx_server_single_packet_new(wLog* log, UINT16 cmdId, UINT32 dataLen)
+static wStream* rdpgfx_server_single_packet_new(RdpgfxServerContext* context, UINT16 cmdId,
+                                                UINT32 dataLen)
 {
 	UINT error = 0;
 	wStream* s = NULL;
+	wLog* log = context->priv->log;
 	UINT32 pduLength = rdpgfx_pdu_length(dataLen);
-	s = Stream_New(NULL, pduLength);
+	s = StreamPool_Take(context->priv->packet_pool, pduLength);
 
 	if (!s)
 	{
-		WLog_Print(log, WLOG_ERROR, "Stream_New failed!");
+		WLog_Print(log, WLOG_ERROR, "StreamPool_Take failed!");
 		goto error;
 	}
 
@@ -193,7 +264,8 @@ static wStream* rdpgfx_server_single_packet_new(wLog* log, UINT16 cmdId, UINT32
 
 	return s;
 error:
-	Stream_Free(s, TRUE);
+	if (s)
+		Stream_Release(s);
 	return NULL;
 }
 
@@ -229,7 +301,7 @@ static UINT rdpgfx_send_caps_confirm_pdu(RdpgfxServerContext* context,
 	capsSet = capsConfirm->capsSet;
 	WINPR_ASSERT(capsSet);
 
-	s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_CAPSCONFIRM,
+	s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_CAPSCONFIRM,
 	                                    RDPGFX_CAPSET_BASE_SIZE + capsSet->length);
 
 	if (!s)
@@ -277,7 +349,7 @@ static UINT rdpgfx_send_reset_graphics_pdu(RdpgfxServerContext* context,
 		return ERROR_INVALID_DATA;
 	}
 
-	s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_RESETGRAPHICS,
+	s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_RESETGRAPHICS,
 	                                    RDPGFX_RESET_GRAPHICS_PDU_SIZE - RDPGFX_HEADER_SIZE);
 
 	if (!s)
@@ -316,7 +388,7 @@ static UINT rdpgfx_send_evict_cache_entry_pdu(RdpgfxServerContext* context,
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
 	wStream* s =
-	    rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_EVICTCACHEENTRY, 2);
+	    rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_EVICTCACHEENTRY, 2);
 
 	if (!s)
 	{
@@ -342,7 +414,7 @@ static UINT rdpgfx_send_cache_import_reply_pdu(RdpgfxServerContext* context,
 	WINPR_ASSERT(pdu);
 
 	WLog_DBG(TAG, "reply with %" PRIu16 " entries", pdu->importedEntriesCount);
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_CACHEIMPORTREPLY,
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_CACHEIMPORTREPLY,
 	                                             2 + 2 * pdu->importedEntriesCount);
 
 	if (!s)
@@ -387,7 +459,7 @@ static UINT rdpgfx_send_create_surface_pdu(RdpgfxServerContext* context,
 {
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_CREATESURFACE, 7);
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_CREATESURFACE, 7);
 
 	WINPR_ASSERT(context);
 	WINPR_ASSERT(pdu);
@@ -417,7 +489,7 @@ static UINT rdpgfx_send_delete_surface_pdu(RdpgfxServerContext* context,
 {
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_DELETESURFACE, 2);
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_DELETESURFACE, 2);
 
 	if (!s)
 	{
@@ -456,7 +528,7 @@ static UINT rdpgfx_send_start_frame_pdu(RdpgfxServerContext* context,
 {
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_STARTFRAME,
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_STARTFRAME,
 	                                             RDPGFX_START_FRAME_PDU_SIZE);
 
 	if (!s)
@@ -478,7 +550,7 @@ static UINT rdpgfx_send_end_frame_pdu(RdpgfxServerContext* context, const RDPGFX
 {
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_ENDFRAME,
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_ENDFRAME,
 	                                             RDPGFX_END_FRAME_PDU_SIZE);
 
 	if (!s)
@@ -488,6 +560,11 @@ static UINT rdpgfx_send_end_frame_pdu(RdpgfxServerContext* context, const RDPGFX
 	}
 
 	rdpgfx_write_end_frame_pdu(s, pdu);
+
+	RdpgfxServerPrivate* priv = context->priv;
+	const size_t slot = pdu->frameId % RDPGFX_SERVER_PENDING_FRAMES;
+	priv->pendingFrameIds[slot] = pdu->frameId;
+	priv->pendingFrameSent[slot] = winpr_GetTickCount64NS();
 	return rdpgfx_server_single_packet_send(context, s);
 }
 
@@ -769,7 +846,7 @@ static UINT rdpgfx_send_surface_command(RdpgfxServerContext* context,
 		return CHANNEL_RC_NOT_INITIALIZED;
 	UINT error = CHANNEL_RC_OK;
 	wStream* s = NULL;
-	s = rdpgfx_server_single_packet_new(context->priv->log, rdpgfx_surface_command_cmdid(cmd),
+	s = rdpgfx_server_single_packet_new(context, rdpgfx_surface_command_cmdid(cmd),
 	                                    rdpgfx_estimate_surface_command(cmd));
 
 	if (!s)
@@ -788,7 +865,7 @@ static UINT rdpgfx_send_surface_command(RdpgfxServerContext* context,
 
 	return rdpgfx_server_single_packet_send(context, s);
 error:
-	Stream_Free(s, TRUE);
+	Stream_Release(s);
 	return error;
 }
 
@@ -823,11 +900,11 @@ static UINT rdpgfx_send_surface_frame_command(RdpgfxServerContext* context,
 		size += rdpgfx_pdu_length(RDPGFX_END_FRAME_PDU_SIZE);
 	}
 
-	s = Stream_New(NULL, size);
+	s = StreamPool_Take(context->priv->packet_pool, size);
 
 	if (!s)
 	{
-		WLog_Print(context->priv->log, WLOG_ERROR, "Stream_New failed!");
+		WLog_Print(context->priv->log, WLOG_ERROR, "StreamPool_Take failed!");
 		return CHANNEL_RC_NO_MEMORY;
 	}
 
@@ -892,7 +969,7 @@ static UINT rdpgfx_send_surface_frame_command(RdpgfxServerContext* context,
 
 	return rdpgfx_server_packet_send(context, s);
 error:
-	Stream_Free(s, TRUE);
+	Stream_Release(s);
 	return error;
 }
 
@@ -907,7 +984,7 @@ static UINT rdpgfx_send_delete_encoding_context_pdu(RdpgfxServerContext* context
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
 	wStream* s =
-	    rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_DELETEENCODINGCONTEXT, 6);
+	    rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_DELETEENCODINGCONTEXT, 6);
 
 	if (!s)
 	{
@@ -932,7 +1009,7 @@ static UINT rdpgfx_send_solid_fill_pdu(RdpgfxServerContext* context,
 		return CHANNEL_RC_NOT_INITIALIZED;
 	UINT error = CHANNEL_RC_OK;
 	RECTANGLE_16* fillRect = NULL;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_SOLIDFILL,
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_SOLIDFILL,
 	                                             8 + 8 * pdu->fillRectCount);
 
 	if (!s)
@@ -967,7 +1044,7 @@ static UINT rdpgfx_send_solid_fill_pdu(RdpgfxServerContext* context,
 
 	return rdpgfx_server_single_packet_send(context, s);
 error:
-	Stream_Free(s, TRUE);
+	Stream_Release(s);
 	return error;
 }
 
@@ -983,7 +1060,7 @@ static UINT rdpgfx_send_surface_to_surface_pdu(RdpgfxServerContext* context,
 		return CHANNEL_RC_NOT_INITIALIZED;
 	UINT error = CHANNEL_RC_OK;
 	RDPGFX_POINT16* destPt = NULL;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_SURFACETOSURFACE,
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_SURFACETOSURFACE,
 	                                             14 + 4 * pdu->destPtsCount);
 
 	if (!s)
@@ -1019,7 +1096,7 @@ static UINT rdpgfx_send_surface_to_surface_pdu(RdpgfxServerContext* context,
 
 	return rdpgfx_server_single_packet_send(context, s);
 error:
-	Stream_Free(s, TRUE);
+	Stream_Release(s);
 	return error;
 }
 
@@ -1035,7 +1112,7 @@ static UINT rdpgfx_send_surface_to_cache_pdu(RdpgfxServerContext* context,
 		return CHANNEL_RC_NOT_INITIALIZED;
 	UINT error = CHANNEL_RC_OK;
 	wStream* s =
-	    rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_SURFACETOCACHE, 20);
+	    rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_SURFACETOCACHE, 20);
 
 	if (!s)
 	{
@@ -1057,7 +1134,7 @@ static UINT rdpgfx_send_surface_to_cache_pdu(RdpgfxServerContext* context,
 
 	return rdpgfx_server_single_packet_send(context, s);
 error:
-	Stream_Free(s, TRUE);
+	Stream_Release(s);
 	return error;
 }
 
@@ -1073,7 +1150,7 @@ static UINT rdpgfx_send_cache_to_surface_pdu(RdpgfxServerContext* context,
 		return CHANNEL_RC_NOT_INITIALIZED;
 	UINT error = CHANNEL_RC_OK;
 	RDPGFX_POINT16* destPt = NULL;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_CACHETOSURFACE,
+	wStream* s = rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_CACHETOSURFACE,
 	                                             6 + 4 * pdu->destPtsCount);
 
 	if (!s)
@@ -1100,7 +1177,7 @@ static UINT rdpgfx_send_cache_to_surface_pdu(RdpgfxServerContext* context,
 
 	return rdpgfx_server_single_packet_send(context, s);
 error:
-	Stream_Free(s, TRUE);
+	Stream_Release(s);
 	return error;
 }
 
@@ -1115,7 +1192,7 @@ static UINT rdpgfx_send_map_surface_to_output_pdu(RdpgfxServerContext* context,
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
 	wStream* s =
-	    rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_MAPSURFACETOOUTPUT, 12);
+	    rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_MAPSURFACETOOUTPUT, 12);
 
 	if (!s)
 	{
@@ -1141,7 +1218,7 @@ static UINT rdpgfx_send_map_surface_to_window_pdu(RdpgfxServerContext* context,
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
 	wStream* s =
-	    rdpgfx_server_single_packet_new(context->priv->log, RDPGFX_CMDID_MAPSURFACETOWINDOW, 18);
+	    rdpgfx_server_single_packet_new(context, RDPGFX_CMDID_MAPSURFACETOWINDOW, 18);
 
 	if (!s)
 	{
@@ -1162,7 +1239,7 @@ rdpgfx_send_map_surface_to_scaled_window_pdu(RdpgfxServerContext* context,
 {
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log,
+	wStream* s = rdpgfx_server_single_packet_new(context,
 	                                             RDPGFX_CMDID_MAPSURFACETOSCALEDWINDOW, 26);
 
 	if (!s)
@@ -1201,6 +1278,17 @@ static UINT rdpgfx_recv_frame_acknowledge_pdu(RdpgfxServerContext* context, wStr
 
 	if (context)
 	{
+		RdpgfxServerPrivate* priv = context->priv;
+		const size_t slot = pdu.frameId % RDPGFX_SERVER_PENDING_FRAMES;
+
+		if (context->rdpcontext && (priv->pendingFrameSent[slot] != 0) &&
+		    (priv->pendingFrameIds[slot] == pdu.frameId))
+		{
+			metrics_frame_ack(context->rdpcontext->metrics,
+			                  winpr_GetTickCount64NS() - priv->pendingFrameSent[slot]);
+			priv->pendingFrameSent[slot] = 0;
+		}
+
 		IFCALLRET(context->FrameAcknowledge, error, context, &pdu);
 
 		if (error)
@@ -1360,7 +1448,7 @@ rdpgfx_send_map_surface_to_scaled_output_pdu(RdpgfxServerContext* context,
 {
 	if (!checkCapsAreExchanged(context))
 		return CHANNEL_RC_NOT_INITIALIZED;
-	wStream* s = rdpgfx_server_single_packet_new(context->priv->log,
+	wStream* s = rdpgfx_server_single_packet_new(context,
 	                                             RDPGFX_CMDID_MAPSURFACETOSCALEDOUTPUT, 20);
 
 	if (!s)
@@ -1647,6 +1735,12 @@ BOOL rdpgfx_server_close(RdpgfxServerContext* context)
 	zgfx_context_free(priv->zgfx);
 	priv->zgfx = NULL;
 
+	if (priv->batch)
+	{
+		Stream_Release(priv->batch);
+		priv->batch = NULL;
+	}
+
 	if (priv->rdpgfx_channel)
 	{
 		(void)WTSVirtualChannelClose(priv->rdpgfx_channel);
@@ -1715,6 +1809,8 @@ RdpgfxServerContext* rdpgfx_server_context_new(HANDLE vcm)
 	context->CapsConfirm = rdpgfx_send_caps_confirm_pdu;
 	context->FrameAcknowledge = NULL;
 	context->QoeFrameAcknowledge = NULL;
+	context->BeginBatch = rdpgfx_server_begin_batch;
+	context->EndBatch = rdpgfx_server_end_batch;
 	RdpgfxServerPrivate* priv = context->priv =
 	    (RdpgfxServerPrivate*)calloc(1, sizeof(RdpgfxServerPrivate));
 
@@ -1737,6 +1833,15 @@ RdpgfxServerContext* rdpgfx_server_context_new(HANDLE vcm)
 		goto fail;
 	}
 
+	/* PDUs and their compressed form are recycled, surface commands are large */
+	priv->packet_pool = StreamPool_New(TRUE, 65536);
+
+	if (!priv->packet_pool)
+	{
+		WLog_Print(context->priv->log, WLOG_ERROR, "StreamPool_New failed!");
+		goto fail;
+	}
+
 	priv->isOpened = FALSE;
 	priv->isReady = FALSE;
 	priv->ownThread = TRUE;
@@ -1760,7 +1865,10 @@ void rdpgfx_server_context_free(RdpgfxServerContext* context)
 	rdpgfx_server_close(context);
 
 	if (context->priv)
+	{
 		Stream_Free(context->priv->input_stream, TRUE);
+		StreamPool_Free(context->priv->packet_pool);
+	}
 
 	free(context->priv);
 	free(context);
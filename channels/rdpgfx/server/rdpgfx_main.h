@@ -23,6 +23,9 @@
 #include <freerdp/server/rdpgfx.h>
 #include <freerdp/codec/zgfx.h>
 
+/* end frame PDUs remembered for acknowledge round trip statistics */
+#define RDPGFX_SERVER_PENDING_FRAMES 16
+
 struct s_rdpgfx_server_private
 {
 	ZGFX_CONTEXT* zgfx;
@@ -33,10 +36,14 @@ struct s_rdpgfx_server_private
 	void* rdpgfx_channel;
 	DWORD SessionId;
 	wStream* input_stream;
+	wStreamPool* packet_pool;
+	wStream* batch;
 	BOOL isOpened;
 	BOOL isReady;
 	wLog* log;
 	RDPGFX_CAPSET activeCapSet;
+	UINT32 pendingFrameIds[RDPGFX_SERVER_PENDING_FRAMES];
+	UINT64 pendingFrameSent[RDPGFX_SERVER_PENDING_FRAMES];
 };
 
 #endif /* FREERDP_CHANNEL_RDPGFX_SERVER_MAIN_H */
@@ -116,6 +116,16 @@ static int rdpsnd_alsa_set_hw_params(rdpsndAlsaPlugin* alsa)
 	alsa->buffer_size = buffer_size_max;
 	alsa->period_size = (bytes_per_sec / interrupts_per_sec_near);
 
+	if (alsa->latency > 0)
+	{
+		/* keep no more than the requested latency queued, refilled in quarters */
+		const snd_pcm_uframes_t frames = 1ull * alsa->actual_rate * alsa->latency / 1000;
+
+		if ((frames > 0) && (frames < buffer_size_max))
+			alsa->buffer_size = frames;
+		alsa->period_size = alsa->buffer_size / 4;
+	}
+
 	if (alsa->period_size > buffer_size_max)
 	{
 		WLog_ERR(TAG, "Warning: requested sound buffer size %lu, got %lu instead\n",
@@ -454,11 +464,14 @@ static UINT rdpsnd_alsa_play(rdpsndDevicePlugin* device, const BYTE* data, size_
 		snd_pcm_sframes_t delay = 0;
 		int rc = snd_pcm_avail_delay(alsa->pcm_handle, &available, &delay);
 
-		if ((rc == 0) && (available == 0)) /* Get [ms] from number of samples */
+		/* the delay covers everything queued, fall back to the configured latency */
+		if ((rc == 0) && (delay >= 0)) /* Get [ms] from number of samples */
 			latency = (UINT32)MIN(UINT32_MAX, delay * 1000 / alsa->actual_rate);
+		else
+			latency = alsa->latency;
 	}
 
-	return latency + alsa->latency;
+	return latency;
 }
 
 /**
@@ -399,7 +399,8 @@ static BOOL rdpsnd_pulse_open_stream(rdpsndDevicePlugin* device)
 		buffer_attr.maxlength = UINT32_MAX;
 		buffer_attr.tlength = pa_usec_to_bytes(1000ULL * pulse->latency, &pulse->sample_spec);
 		buffer_attr.prebuf = UINT32_MAX;
-		buffer_attr.minreq = UINT32_MAX;
+		/* request refills in small chunks so the target latency is actually met */
+		buffer_attr.minreq = buffer_attr.tlength / 4;
 		buffer_attr.fragsize = UINT32_MAX;
 		flags |= PA_STREAM_ADJUST_LATENCY;
 	}
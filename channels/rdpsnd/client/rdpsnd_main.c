@@ -51,6 +51,12 @@
 #include "rdpsnd_common.h"
 #include "rdpsnd_main.h"
 
+/* backend latency requested by lowlatency mode unless latency is given, in ms */
+#define RDPSND_LOW_LATENCY 20
+
+/* upper bound of the adaptive jitter buffer, in ms */
+#define RDPSND_MAX_JITTER_BUFFER 200
+
 struct rdpsnd_plugin
 {
 	IWTSPlugin iface;
@@ -89,12 +95,18 @@ struct rdpsnd_plugin
 	UINT64 wArrivalTime;
 
 	UINT32 latency;
+	BOOL lowLatency;
 	BOOL isOpen;
 	AUDIO_FORMAT* fixed_format;
 
 	UINT32 startPlayTime;
 	size_t totalPlaySize;
 
+	/* arrival jitter of wave PDUs, in 1/16 ms */
+	UINT32 jitter;
+	UINT16 lastTimeStamp;
+	UINT64 lastArrivalTime;
+
 	char* subsystem;
 	char* device_name;
 
@@ -437,11 +449,54 @@ static BOOL rdpsnd_ensure_device_is_open(rdpsndPlugin* rdpsnd, UINT32 wFormatNo,
 		rdpsnd->wCurrentFormatNo = wFormatNo;
 		rdpsnd->startPlayTime = 0;
 		rdpsnd->totalPlaySize = 0;
+		rdpsnd->lastArrivalTime = 0;
 	}
 
 	return rdpsnd_apply_volume(rdpsnd);
 }
 
+/**
+ * Track the interarrival jitter of wave PDUs (RFC 3550 style) by comparing
+ * the spacing of the server timestamps with the spacing of their arrival.
+ */
+static void rdpsnd_update_jitter(rdpsndPlugin* rdpsnd)
+{
+	WINPR_ASSERT(rdpsnd);
+
+	if (rdpsnd->lastArrivalTime != 0)
+	{
+		const UINT16 sent = (UINT16)(rdpsnd->wTimeStamp - rdpsnd->lastTimeStamp);
+		const UINT64 arrived = rdpsnd->wArrivalTime - rdpsnd->lastArrivalTime;
+		UINT64 deviation = (arrived > sent) ? arrived - sent : sent - arrived;
+
+		/* a pause on the server side is not jitter */
+		if (deviation > RDPSND_MAX_JITTER_BUFFER)
+			deviation = RDPSND_MAX_JITTER_BUFFER;
+
+		rdpsnd->jitter += (UINT32)deviation;
+		rdpsnd->jitter -= (rdpsnd->jitter + 8) >> 4;
+	}
+
+	rdpsnd->lastTimeStamp = rdpsnd->wTimeStamp;
+	rdpsnd->lastArrivalTime = rdpsnd->wArrivalTime;
+}
+
+/* the amount of audio kept queued ahead of the playback position, in ms */
+static UINT32 rdpsnd_jitter_buffer(rdpsndPlugin* rdpsnd)
+{
+	WINPR_ASSERT(rdpsnd);
+
+	if (!rdpsnd->lowLatency)
+		return rdpsnd->latency;
+
+	UINT32 target = 3 * (rdpsnd->jitter >> 4);
+	if (target < rdpsnd->latency)
+		target = rdpsnd->latency;
+	if (target > RDPSND_MAX_JITTER_BUFFER)
+		target = RDPSND_MAX_JITTER_BUFFER;
+	return target;
+}
+
 /**
  * Function description
  *
@@ -460,6 +515,7 @@ static UINT rdpsnd_recv_wave_info_pdu(rdpsndPlugin* rdpsnd, wStream* s, UINT16 B
 	rdpsnd->wArrivalTime = GetTickCount64();
 	Stream_Read_UINT16(s, rdpsnd->wTimeStamp);
 	Stream_Read_UINT16(s, wFormatNo);
+	rdpsnd_update_jitter(rdpsnd);
 
 	if (wFormatNo >= rdpsnd->NumberOfClientFormats)
 		return ERROR_INVALID_DATA;
@@ -582,7 +638,10 @@ static BOOL rdpsnd_detect_overrun(rdpsndPlugin* rdpsnd, const AUDIO_FORMAT* form
 		remainingDuration = totalDuration - (now - rdpsnd->startPlayTime);
 
 		/* Maximum allow duration calculation */
-		maxDuration = duration * 2 + rdpsnd->latency;
+		if (rdpsnd->lowLatency)
+			maxDuration = duration + rdpsnd_jitter_buffer(rdpsnd);
+		else
+			maxDuration = duration * 2 + rdpsnd_jitter_buffer(rdpsnd);
 
 		if (remainingDuration + duration > maxDuration)
 		{
@@ -660,7 +719,8 @@ static UINT rdpsnd_treat_wave(rdpsndPlugin* rdpsnd, wStream* s, size_t size)
 
 	end = GetTickCount64();
 	diffMS = end - rdpsnd->wArrivalTime + latency;
-	ts = (rdpsnd->wTimeStamp + diffMS) % UINT16_MAX;
+	/* the timestamp wraps around like the server's 16 bit tick count */
+	ts = (rdpsnd->wTimeStamp + diffMS) & UINT16_MAX;
 
 	/*
 	 * Send the second WaveConfirm PDU. With the first WaveConfirm PDU,
@@ -711,6 +771,7 @@ static UINT rdpsnd_recv_wave2_pdu(rdpsndPlugin* rdpsnd, wStream* s, UINT16 BodyS
 	format = &rdpsnd->ClientFormats[wFormatNo];
 	rdpsnd->waveDataSize = BodySize - 12;
 	rdpsnd->wArrivalTime = GetTickCount64();
+	rdpsnd_update_jitter(rdpsnd);
 	WLog_Print(rdpsnd->log, WLOG_DEBUG,
 	           "%s Wave2PDU: cBlockNo: %" PRIu8 " wFormatNo: %" PRIu16 " [%s] , align=%hu",
 	           rdpsnd_is_dyn_str(rdpsnd->dynamic), rdpsnd->cBlockNo, wFormatNo,
@@ -904,6 +965,8 @@ static UINT rdpsnd_process_addin_args(rdpsndPlugin* rdpsnd, const ADDIN_ARGV* ar
 		{ "rate", COMMAND_LINE_VALUE_REQUIRED, "<rate>", NULL, NULL, -1, NULL, "rate" },
 		{ "channel", COMMAND_LINE_VALUE_REQUIRED, "<channel>", NULL, NULL, -1, NULL, "channel" },
 		{ "latency", COMMAND_LINE_VALUE_REQUIRED, "<latency>", NULL, NULL, -1, NULL, "latency" },
+		{ "lowlatency", COMMAND_LINE_VALUE_FLAG, "", NULL, BoolValueFalse, -1, NULL,
+		  "low latency playback" },
 		{ "quality", COMMAND_LINE_VALUE_REQUIRED, "<quality mode>", NULL, NULL, -1, NULL,
 		  "quality mode" },
 		{ NULL, 0, NULL, NULL, NULL, -1, NULL, NULL }
@@ -973,6 +1036,10 @@ static UINT rdpsnd_process_addin_args(rdpsndPlugin* rdpsnd, const ADDIN_ARGV* ar
 
 				rdpsnd->latency = val;
 			}
+			CommandLineSwitchCase(arg, "lowlatency")
+			{
+				rdpsnd->lowLatency = TRUE;
+			}
 			CommandLineSwitchCase(arg, "quality")
 			{
 				long wQualityMode = DYNAMIC_QUALITY;
@@ -1058,6 +1125,9 @@ static UINT rdpsnd_process_connect(rdpsndPlugin* rdpsnd)
 			return status;
 	}
 
+	if (rdpsnd->lowLatency && (rdpsnd->latency == 0))
+		rdpsnd->latency = RDPSND_LOW_LATENCY;
+
 	if (rdpsnd->subsystem)
 	{
 		if ((status = rdpsnd_load_device_plugin(rdpsnd, rdpsnd->subsystem, args)))
@@ -1578,7 +1648,8 @@ FREERDP_ENTRY_POINT(BOOL VCAPITYPE rdpsnd_VirtualChannelEntryEx(PCHANNEL_ENTRY_P
 	if (!rdpsnd)
 		return FALSE;
 
-	rdpsnd->channelDef.options = CHANNEL_OPTION_INITIALIZED | CHANNEL_OPTION_ENCRYPT_RDP;
+	rdpsnd->channelDef.options =
+	    CHANNEL_OPTION_INITIALIZED | CHANNEL_OPTION_ENCRYPT_RDP | CHANNEL_OPTION_PRI_HIGH;
 	(void)sprintf_s(rdpsnd->channelDef.name, ARRAYSIZE(rdpsnd->channelDef.name),
 	                RDPSND_CHANNEL_NAME);
 	pEntryPointsEx = (CHANNEL_ENTRY_POINTS_FREERDP_EX*)pEntryPoints;
@@ -392,6 +392,12 @@ static UINT rdpsnd_server_select_format(RdpsndServerContext* context, UINT16 cli
 				context->priv->out_frames = bs;
 
 			break;
+
+		case WAVE_FORMAT_OPUS:
+			/* send one 10 or 20 ms opus frame per PDU instead of latency sized blocks */
+			bs = (context->latency < 20) ? 10 : 20;
+			context->priv->out_frames = context->src_format->nSamplesPerSec * bs / 1000;
+			break;
 	}
 
 	context->priv->out_pending_frames = 0;
@@ -413,6 +419,17 @@ static UINT rdpsnd_server_select_format(RdpsndServerContext* context, UINT16 cli
 		context->priv->out_buffer_size = out_buffer_size;
 	}
 
+	if (context->rdpcontext)
+	{
+		const rdpSettings* settings = context->rdpcontext->settings;
+
+		if (!freerdp_dsp_context_set_encoder_params(
+		        context->priv->dsp_context,
+		        freerdp_settings_get_uint32(settings, FreeRDP_AudioEncoderBitrate),
+		        freerdp_settings_get_uint32(settings, FreeRDP_AudioEncoderComplexity)))
+			WLog_WARN(TAG, "invalid audio encoder settings, using the codec defaults");
+	}
+
 	freerdp_dsp_context_reset(context->priv->dsp_context, format, 0u);
 out:
 	LeaveCriticalSection(&context->priv->lock);
@@ -249,14 +249,42 @@ static void async_transfer_user_data_free(ASYNC_TRANSFER_USER_DATA* user_data)
 	}
 }
 
-static void LIBUSB_CALL func_iso_callback(struct libusb_transfer* transfer)
+/**
+ * Takes a completed transfer off the request queue. The completion data is handed to the caller
+ * in \b completed, so the completion can be sent without holding the queue lock, which would
+ * otherwise stall the submission of further URBs while the channel write is in progress.
+ *
+ * @return TRUE if the transfer was still queued (not yet cancelled or completed)
+ */
+static BOOL async_transfer_detach(wArrayList* list, struct libusb_transfer* transfer,
+                                  UINT32* streamID, ASYNC_TRANSFER_USER_DATA* completed)
 {
+	BOOL queued = FALSE;
 	ASYNC_TRANSFER_USER_DATA* user_data = (ASYNC_TRANSFER_USER_DATA*)transfer->user_data;
-	const UINT32 streamID = stream_id_from_buffer(transfer);
-	wArrayList* list = user_data->queue;
 
 	ArrayList_Lock(list);
-	switch (transfer->status)
+	*streamID = stream_id_from_buffer(transfer);
+	if (list_contains(list, *streamID))
+	{
+		*completed = *user_data;
+		user_data->data = NULL;
+		/* frees transfer and user_data */
+		ArrayList_Remove(list, transfer);
+		queued = TRUE;
+	}
+	ArrayList_Unlock(list);
+	return queued;
+}
+
+static void LIBUSB_CALL func_iso_callback(struct libusb_transfer* transfer)
+{
+	ASYNC_TRANSFER_USER_DATA* user_data = (ASYNC_TRANSFER_USER_DATA*)transfer->user_data;
+	ASYNC_TRANSFER_USER_DATA completed = { 0 };
+	UINT32 streamID = 0;
+	const int status = transfer->status;
+	const int num_iso_packets = transfer->num_iso_packets;
+
+	switch (status)
 	{
 		case LIBUSB_TRANSFER_COMPLETED:
 		{
@@ -297,29 +325,26 @@ static void LIBUSB_CALL func_iso_callback(struct libusb_transfer* transfer)
 			WINPR_FALLTHROUGH
 		case LIBUSB_TRANSFER_ERROR:
 		{
-			const UINT32 InterfaceId =
-			    ((STREAM_ID_PROXY << 30) | user_data->idev->get_ReqCompletion(user_data->idev));
+			if (!async_transfer_detach(user_data->queue, transfer, &streamID, &completed))
+				break;
 
-			if (list_contains(list, streamID))
+			if (!completed.noack)
 			{
-				if (!user_data->noack)
-				{
-					const UINT32 RequestID = streamID & INTERFACE_ID_MASK;
-					user_data->cb(user_data->idev, user_data->callback, user_data->data,
-					              InterfaceId, user_data->noack, user_data->MessageId, RequestID,
-					              transfer->num_iso_packets, transfer->status,
-					              user_data->StartFrame, user_data->ErrorCount,
-					              user_data->OutputBufferSize);
-					user_data->data = NULL;
-				}
-				ArrayList_Remove(list, transfer);
+				const UINT32 InterfaceId =
+				    ((STREAM_ID_PROXY << 30) | completed.idev->get_ReqCompletion(completed.idev));
+				const UINT32 RequestID = streamID & INTERFACE_ID_MASK;
+				completed.cb(completed.idev, completed.callback, completed.data, InterfaceId,
+				             completed.noack, completed.MessageId, RequestID,
+				             (UINT32)num_iso_packets, (UINT32)status, completed.StartFrame,
+				             completed.ErrorCount, completed.OutputBufferSize);
 			}
+			else
+				Stream_Free(completed.data, TRUE);
 		}
 		break;
 		default:
 			break;
 	}
-	ArrayList_Unlock(list);
 }
 
 static const LIBUSB_ENDPOINT_DESCEIPTOR* func_get_ep_desc(LIBUSB_CONFIG_DESCRIPTOR* LibusbConfig,
@@ -349,33 +374,30 @@ static const LIBUSB_ENDPOINT_DESCEIPTOR* func_get_ep_desc(LIBUSB_CONFIG_DESCRIPT
 static void LIBUSB_CALL func_bulk_transfer_cb(struct libusb_transfer* transfer)
 {
 	ASYNC_TRANSFER_USER_DATA* user_data = NULL;
-	uint32_t streamID = 0;
-	wArrayList* list = NULL;
+	ASYNC_TRANSFER_USER_DATA completed = { 0 };
+	UINT32 streamID = 0;
 
 	user_data = (ASYNC_TRANSFER_USER_DATA*)transfer->user_data;
 	if (!user_data)
 	{
-		WLog_ERR(TAG, "[%s]: Invalid transfer->user_data!");
+		WLog_ERR(TAG, "[%s]: Invalid transfer->user_data!", __func__);
 		return;
 	}
-	list = user_data->queue;
-	ArrayList_Lock(list);
-	streamID = stream_id_from_buffer(transfer);
 
-	if (list_contains(list, streamID))
-	{
-		const UINT32 InterfaceId =
-		    ((STREAM_ID_PROXY << 30) | user_data->idev->get_ReqCompletion(user_data->idev));
-		const UINT32 RequestID = streamID & INTERFACE_ID_MASK;
-
-		user_data->cb(user_data->idev, user_data->callback, user_data->data, InterfaceId,
-		              user_data->noack, user_data->MessageId, RequestID, transfer->num_iso_packets,
-		              transfer->status, user_data->StartFrame, user_data->ErrorCount,
-		              transfer->actual_length);
-		user_data->data = NULL;
-		ArrayList_Remove(list, transfer);
-	}
-	ArrayList_Unlock(list);
+	const int status = transfer->status;
+	const int num_iso_packets = transfer->num_iso_packets;
+	const int actual_length = transfer->actual_length;
+
+	if (!async_transfer_detach(user_data->queue, transfer, &streamID, &completed))
+		return;
+
+	const UINT32 InterfaceId =
+	    ((STREAM_ID_PROXY << 30) | completed.idev->get_ReqCompletion(completed.idev));
+	const UINT32 RequestID = streamID & INTERFACE_ID_MASK;
+
+	completed.cb(completed.idev, completed.callback, completed.data, InterfaceId, completed.noack,
+	             completed.MessageId, RequestID, (UINT32)num_iso_packets, (UINT32)status,
+	             completed.StartFrame, completed.ErrorCount, (UINT32)actual_length);
 }
 
 static BOOL func_set_usbd_status(URBDRC_PLUGIN* urbdrc, UDEVICE* pdev, UINT32* status,
@@ -1267,7 +1289,11 @@ static int libusb_udev_isoch_transfer(IUDEVICE* idev, GENERIC_CHANNEL_CALLBACK*
 	}
 	rc = libusb_submit_transfer(iso_transfer);
 	if (log_libusb_result(urbdrc->log, WLOG_ERROR, "libusb_submit_transfer", rc))
+	{
+		/* never completes, drop it from the queue again */
+		ArrayList_Remove(pdev->request_queue, iso_transfer);
 		return -1;
+	}
 	return rc;
 }
 
@@ -1386,7 +1412,11 @@ static int libusb_udev_bulk_or_interrupt_transfer(IUDEVICE* idev,
 	}
 	rc = libusb_submit_transfer(transfer);
 	if (log_libusb_result(urbdrc->log, WLOG_ERROR, "libusb_submit_transfer", rc))
+	{
+		/* never completes, drop it from the queue again */
+		ArrayList_Remove(pdev->request_queue, transfer);
 		return -1;
+	}
 	return rc;
 }
 
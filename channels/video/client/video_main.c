@@ -61,6 +61,10 @@ typedef struct
 
 #define XF_VIDEO_UNLIMITED_RATE 31
 
+/* late frames are decoded but not shown, unless nothing was shown for VIDEO_MAX_HIDDEN_MS */
+#define VIDEO_LATE_FRAME_MS 50
+#define VIDEO_MAX_HIDDEN_MS 200
+
 static const BYTE MFVideoFormat_H264[] = { 'H',  '2',  '6',  '4',  0x00, 0x00, 0x10, 0x00,
 	                                       0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
 
@@ -76,6 +80,7 @@ typedef struct
 	H264_CONTEXT* h264;
 	wStream* currentSample;
 	UINT64 lastPublishTime, nextPublishTime;
+	UINT64 lastShowTime;
 	volatile LONG refCounter;
 	VideoSurface* surface;
 } PresentationContext;
@@ -712,6 +717,7 @@ static void video_timer(VideoClientContext* video, UINT64 now)
 	presentation = frame->presentation;
 
 	priv->publishedFrames++;
+	presentation->lastShowTime = now;
 	memcpy(presentation->surface->data, frame->surfaceData, 1ull * frame->scanline * frame->h);
 
 	WINPR_ASSERT(video->showSurface);
@@ -850,16 +856,25 @@ static UINT video_VideoData(VideoClientContext* context, const TSMM_VIDEO_DATA*
 		Stream_SetPosition(presentation->currentSample, 0);
 
 		timeAfterH264 = GetTickCount64();
-		if (data->SampleNumber == 1)
+		if ((data->SampleNumber == 1) || (data->hnsTimestamp < presentation->startTimeStamp))
 		{
-			presentation->lastPublishTime = startTime;
+			presentation->startTimeStamp = data->hnsTimestamp;
+			presentation->publishOffset = startTime;
 		}
 
-		presentation->lastPublishTime += (data->hnsDuration / 10000);
+		/* derived from the sample timestamp, summing up durations accumulates rounding errors */
+		presentation->lastPublishTime =
+		    presentation->publishOffset +
+		    (data->hnsTimestamp - presentation->startTimeStamp + data->hnsDuration) / 10000;
 		if (presentation->lastPublishTime <= timeAfterH264 + 10)
 		{
 			int dropped = 0;
 
+			/* the decoder needs every sample, but showing one that is late only delays the next */
+			const BOOL late =
+			    (presentation->lastPublishTime + VIDEO_LATE_FRAME_MS < startTime) &&
+			    (presentation->lastShowTime + VIDEO_MAX_HIDDEN_MS > startTime);
+
 			/* if the frame is to be published in less than 10 ms, let's consider it's now */
 			status = avc420_decompress(h264, Stream_Pointer(presentation->currentSample),
 			                           Stream_Length(presentation->currentSample), surface->data,
@@ -869,11 +884,20 @@ static UINT video_VideoData(VideoClientContext* context, const TSMM_VIDEO_DATA*
 			if (status < 0)
 				return CHANNEL_RC_OK;
 
-			WINPR_ASSERT(context->showSurface);
-			context->showSurface(context, presentation->surface, presentation->ScaledWidth,
-			                     presentation->ScaledHeight);
+			if (late)
+			{
+				WLog_DBG(TAG, "not showing late frame @%" PRIu64, presentation->lastPublishTime);
+				priv->droppedFrames++;
+			}
+			else
+			{
+				WINPR_ASSERT(context->showSurface);
+				context->showSurface(context, presentation->surface, presentation->ScaledWidth,
+				                     presentation->ScaledHeight);
 
-			priv->publishedFrames++;
+				priv->publishedFrames++;
+				presentation->lastShowTime = GetTickCount64();
+			}
 
 			/* cleanup previously scheduled frames */
 			EnterCriticalSection(&priv->framesLock);
@@ -34,7 +34,9 @@
 #define TAG CLIENT_TAG("sdl.disp")
 
 static constexpr UINT64 RESIZE_MIN_DELAY = 200; /* minimum delay in ms between two resizes */
-static constexpr unsigned MAX_RETRIES = 5;
+/* maximum time in ms to wait for the server to apply a layout */
+static constexpr UINT64 RESIZE_RESET_TIMEOUT = 2000;
+static constexpr unsigned MAX_RETRIES = 25;
 
 BOOL sdlDispContext::settings_changed()
 {
@@ -92,14 +94,21 @@ BOOL sdlDispContext::sendResize()
 	if (!_activated || !_disp)
 		return TRUE;
 
-	if (GetTickCount64() - _lastSentDate < RESIZE_MIN_DELAY)
+	const UINT64 now = GetTickCount64();
+	if (now - _lastSentDate < RESIZE_MIN_DELAY)
 		return TRUE;
 
-	_lastSentDate = GetTickCount64();
+	/* the server reconfigures and re-encodes the whole desktop for every layout, so hold the
+	 * next one until the previous one was applied */
+	if (_waitingResize && (now - _lastSentDate < RESIZE_RESET_TIMEOUT))
+		return TRUE;
 
 	if (!settings_changed())
 		return TRUE;
 
+	_lastSentDate = now;
+	_waitingResize = TRUE;
+
 	const UINT32 mcount = freerdp_settings_get_uint32(settings, FreeRDP_MonitorCount);
 	if (_sdl->fullscreen && (mcount > 0))
 	{
@@ -110,7 +119,6 @@ BOOL sdlDispContext::sendResize()
 	}
 	else
 	{
-		_waitingResize = TRUE;
 		layout.Flags = DISPLAY_CONTROL_MONITOR_PRIMARY;
 		layout.Top = layout.Left = 0;
 		layout.Width = _targetWidth;
@@ -306,7 +314,7 @@ BOOL sdlDispContext::addTimer()
 
 	_timer_retries = 0;
 	sendResize();
-	_timer = SDL_AddTimer(1000, sdlDispContext::OnTimer, this);
+	_timer = SDL_AddTimer(static_cast<Uint32>(RESIZE_MIN_DELAY), sdlDispContext::OnTimer, this);
 	return TRUE;
 }
 
@@ -357,8 +365,12 @@ BOOL sdlDispContext::handle_window_event(const SDL_WindowEvent* ev)
 
 		case SDL_EVENT_WINDOW_RESIZED:
 		case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+			if ((_targetWidth == ev->data1) && (_targetHeight == ev->data2))
+				return TRUE;
+			/* send the layout once the window size settled */
 			_targetWidth = ev->data1;
 			_targetHeight = ev->data2;
+			_lastSentDate = GetTickCount64();
 			return addTimer();
 
 		case SDL_EVENT_WINDOW_MOUSE_LEAVE:
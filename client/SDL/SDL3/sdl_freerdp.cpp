@@ -397,8 +397,9 @@ static BOOL sdl_draw_to_window(SdlContext* sdl, SdlWindow& window,
 	auto gdi = context->gdi;
 
 	auto size = window.rect();
+	const auto smartSizing = freerdp_settings_get_bool(context->settings, FreeRDP_SmartSizing);
 
-	if (!freerdp_settings_get_bool(context->settings, FreeRDP_SmartSizing))
+	if (!smartSizing)
 	{
 		if (gdi->width < size.w)
 		{
@@ -408,7 +409,25 @@ static BOOL sdl_draw_to_window(SdlContext* sdl, SdlWindow& window,
 		{
 			window.setOffsetY((size.h - gdi->height) / 2);
 		}
+	}
+
+	if (window.hasRenderer())
+	{
+		auto surface = sdl->primary.get();
+		WINPR_ASSERT(surface);
+
+		SDL_Rect dstRect = { window.offsetX(), window.offsetY(), surface->w, surface->h };
+		if (smartSizing)
+		{
+			dstRect = { 0, 0, surface->w, surface->h };
+			sdl_scale_coordinates(sdl, window.id(), &dstRect.w, &dstRect.h, FALSE, TRUE);
+		}
 
+		if (!window.upload(surface, rects, dstRect))
+			return FALSE;
+	}
+	else if (!smartSizing)
+	{
 		auto surface = sdl->primary.get();
 		if (!sdl_draw_to_window_rect(sdl, window, surface, { window.offsetX(), window.offsetY() },
 		                             rects))
@@ -32,16 +32,32 @@ SdlWindow::SdlWindow(const std::string& title, Sint32 startupX, Sint32 startupY,
 	// SDL_SetProperty(props, SDL_PROP_WINDOW_CREATE_FL);
 	_window = SDL_CreateWindowWithProperties(props);
 	SDL_DestroyProperties(props);
+
+	if (_window)
+	{
+		/* Without a renderer (or with SDL_HINT_RENDER_DRIVER=software) the window surface is used */
+		_renderer = SDL_CreateRenderer(_window, nullptr);
+		if (!_renderer)
+			SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "SDL_CreateRenderer: %s, using the window surface",
+			            SDL_GetError());
+	}
 }
 
 SdlWindow::SdlWindow(SdlWindow&& other) noexcept
-    : _window(other._window), _offset_x(other._offset_x), _offset_y(other._offset_y)
+    : _window(other._window), _renderer(other._renderer), _texture(other._texture),
+      _textureFormat(other._textureFormat), _textureRect(other._textureRect),
+      _textureDst(other._textureDst), _fillColor(other._fillColor), _offset_x(other._offset_x),
+      _offset_y(other._offset_y)
 {
 	other._window = nullptr;
+	other._renderer = nullptr;
+	other._texture = nullptr;
 }
 
 SdlWindow::~SdlWindow()
 {
+	SDL_DestroyTexture(_texture);
+	SDL_DestroyRenderer(_renderer);
 	SDL_DestroyWindow(_window);
 }
 
@@ -169,6 +185,13 @@ void SdlWindow::minimize()
 
 bool SdlWindow::fill(Uint8 r, Uint8 g, Uint8 b, Uint8 a)
 {
+	if (_renderer)
+	{
+		/* The renderer clears with this color before presenting the texture */
+		_fillColor = { r, g, b, a };
+		return true;
+	}
+
 	auto surface = SDL_GetWindowSurface(_window);
 	if (!surface)
 		return false;
@@ -198,5 +221,81 @@ bool SdlWindow::blit(SDL_Surface* surface, const SDL_Rect& srcRect, SDL_Rect& ds
 
 void SdlWindow::updateSurface()
 {
-	SDL_UpdateWindowSurface(_window);
+	if (!_renderer)
+	{
+		SDL_UpdateWindowSurface(_window);
+		return;
+	}
+
+	SDL_SetRenderDrawColor(_renderer, _fillColor.r, _fillColor.g, _fillColor.b, _fillColor.a);
+	SDL_RenderClear(_renderer);
+	if (_texture)
+	{
+		SDL_FRect src = {};
+		SDL_FRect dst = {};
+		SDL_RectToFRect(&_textureRect, &src);
+		SDL_RectToFRect(&_textureDst, &dst);
+		if (!SDL_RenderTexture(_renderer, _texture, &src, &dst))
+			SDL_LogError(SDL_LOG_CATEGORY_RENDER, "SDL_RenderTexture: %s", SDL_GetError());
+	}
+	SDL_RenderPresent(_renderer);
+}
+
+bool SdlWindow::hasRenderer() const
+{
+	return _renderer != nullptr;
+}
+
+bool SdlWindow::updateTexture(SDL_Surface* surface, const SDL_Rect& rect)
+{
+	const auto bpp = static_cast<size_t>(SDL_BYTESPERPIXEL(surface->format));
+	const auto pitch = static_cast<size_t>(surface->pitch);
+	auto pixels = static_cast<const Uint8*>(surface->pixels) +
+	              pitch * static_cast<size_t>(rect.y) + bpp * static_cast<size_t>(rect.x);
+	if (!SDL_UpdateTexture(_texture, &rect, pixels, surface->pitch))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_RENDER, "SDL_UpdateTexture: %s", SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+bool SdlWindow::upload(SDL_Surface* surface, const std::vector<SDL_Rect>& rects,
+                       const SDL_Rect& dst)
+{
+	if (!_renderer || !surface || !surface->pixels)
+		return false;
+
+	bool full = rects.empty();
+	if (!_texture || (_textureFormat != surface->format) || (_textureRect.w != surface->w) ||
+	    (_textureRect.h != surface->h))
+	{
+		SDL_DestroyTexture(_texture);
+		_texture = SDL_CreateTexture(_renderer, surface->format, SDL_TEXTUREACCESS_STREAMING,
+		                             surface->w, surface->h);
+		if (!_texture)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_RENDER, "SDL_CreateTexture: %s", SDL_GetError());
+			return false;
+		}
+		SDL_SetTextureBlendMode(_texture, SDL_BLENDMODE_NONE);
+		SDL_SetTextureScaleMode(_texture, SDL_SCALEMODE_LINEAR);
+		_textureFormat = surface->format;
+		_textureRect = { 0, 0, surface->w, surface->h };
+		full = true;
+	}
+	_textureDst = dst;
+
+	if (full)
+		return updateTexture(surface, _textureRect);
+
+	for (const auto& rect : rects)
+	{
+		SDL_Rect clipped = {};
+		if (!SDL_GetRectIntersection(&rect, &_textureRect, &clipped))
+			continue;
+		if (!updateTexture(surface, clipped))
+			return false;
+	}
+	return true;
 }
@@ -20,6 +20,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <SDL3/SDL.h>
 
 class SdlWindow
@@ -57,8 +58,22 @@ class SdlWindow
 	bool blit(SDL_Surface* surface, const SDL_Rect& src, SDL_Rect& dst);
 	void updateSurface();
 
+	/* With a renderer the window presents a texture instead of blitting to the window surface.
+	 * upload copies the dirty rects (or everything if empty) to the texture, the GPU scales the
+	 * whole texture to dst when the window is updated. */
+	[[nodiscard]] bool hasRenderer() const;
+	bool upload(SDL_Surface* surface, const std::vector<SDL_Rect>& rects, const SDL_Rect& dst);
+
   private:
+	bool updateTexture(SDL_Surface* surface, const SDL_Rect& rect);
+
 	SDL_Window* _window = nullptr;
+	SDL_Renderer* _renderer = nullptr;
+	SDL_Texture* _texture = nullptr;
+	SDL_PixelFormat _textureFormat = SDL_PIXELFORMAT_UNKNOWN;
+	SDL_Rect _textureRect = {};
+	SDL_Rect _textureDst = {};
+	SDL_Color _fillColor = { 0x00, 0x00, 0x00, 0xff };
 	Sint32 _offset_x = 0;
 	Sint32 _offset_y = 0;
 };
@@ -40,6 +40,9 @@
 #include <winpr/crt.h>
 #include <winpr/assert.h>
 #include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/sysinfo.h>
+#include <winpr/cmdline.h>
 #include <freerdp/log.h>
 
 #include "tf_channels.h"
@@ -47,6 +50,25 @@
 
 #define TAG CLIENT_TAG("sample")
 
+/* upper bound for /sessions, every session runs its own connection thread */
+#define TF_MAX_SESSIONS 1024
+
+typedef struct
+{
+	UINT32 sessions;
+	tfInputEvent* script;
+	size_t scriptCount;
+} tfOptions;
+
+static COMMAND_LINE_ARGUMENT_A tf_args[] = {
+	{ "sessions", COMMAND_LINE_VALUE_REQUIRED, "<count>", "1", NULL, -1, NULL,
+	  "Number of concurrent sessions to open (load testing)" },
+	{ "input-script", COMMAND_LINE_VALUE_REQUIRED, "<file>", NULL, NULL, -1, NULL,
+	  "Play back input once connected. One event per line: '<delay-ms> key <scancode>', "
+	  "'<delay-ms> move <x> <y>' or '<delay-ms> click <x> <y>'" },
+	{ NULL, 0, NULL, NULL, NULL, -1, NULL, NULL }
+};
+
 /* This function is called whenever a new frame starts.
  * It can be used to reset invalidated areas. */
 static BOOL tf_begin_paint(rdpContext* context)
@@ -82,6 +104,8 @@ static BOOL tf_end_paint(rdpContext* context)
 	WINPR_ASSERT(gdi->primary->hdc->hwnd);
 	WINPR_ASSERT(gdi->primary->hdc->hwnd->invalid);
 
+	((tfContext*)context)->frames++;
+
 	if (gdi->primary->hdc->hwnd->invalid->null)
 		return TRUE;
 
@@ -228,6 +252,136 @@ static void tf_post_disconnect(freerdp* instance)
 	WINPR_UNUSED(context);
 }
 
+static BOOL tf_parse_input_line(const char* line, tfInputEvent* event)
+{
+	char action[16] = { 0 };
+	unsigned delay = 0;
+	int a = 0;
+	int b = 0;
+
+	WINPR_ASSERT(line);
+	WINPR_ASSERT(event);
+
+	const int count = sscanf(line, "%u %15s %i %i", &delay, action, &a, &b);
+	if (count < 3)
+		return FALSE;
+
+	event->delay = delay;
+	if ((a < 0) || (b < 0))
+		return FALSE;
+
+	if ((strcmp(action, "key") == 0) && (count == 3))
+	{
+		event->key = TRUE;
+		event->scancode = (UINT32)a;
+		return TRUE;
+	}
+
+	if (count != 4)
+		return FALSE;
+
+	event->x = (UINT16)MIN(a, UINT16_MAX);
+	event->y = (UINT16)MIN(b, UINT16_MAX);
+	if (strcmp(action, "move") == 0)
+		event->flags = PTR_FLAGS_MOVE;
+	else if (strcmp(action, "click") == 0)
+		event->flags = PTR_FLAGS_BUTTON1;
+	else
+		return FALSE;
+	return TRUE;
+}
+
+static BOOL tf_load_input_script(tfOptions* options, const char* file)
+{
+	char line[256] = { 0 };
+	size_t lineno = 0;
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(options);
+
+	FILE* fp = winpr_fopen(file, "r");
+	if (!fp)
+	{
+		WLog_ERR(TAG, "failed to open input script %s", file);
+		return FALSE;
+	}
+
+	while (fgets(line, sizeof(line), fp))
+	{
+		tfInputEvent event = { 0 };
+
+		lineno++;
+		if ((line[0] == '#') || (line[0] == '\n') || (line[0] == '\r'))
+			continue;
+
+		if (!tf_parse_input_line(line, &event))
+		{
+			WLog_ERR(TAG, "%s:%" PRIuz ": invalid input event '%s'", file, lineno, line);
+			goto fail;
+		}
+
+		tfInputEvent* tmp =
+		    realloc(options->script, (options->scriptCount + 1) * sizeof(tfInputEvent));
+		if (!tmp)
+			goto fail;
+		options->script = tmp;
+		options->script[options->scriptCount++] = event;
+	}
+
+	rc = TRUE;
+fail:
+	(void)fclose(fp);
+	return rc;
+}
+
+static int tf_handle_option(const COMMAND_LINE_ARGUMENT_A* arg, void* custom)
+{
+	tfOptions* options = custom;
+
+	WINPR_ASSERT(arg);
+	WINPR_ASSERT(options);
+
+	CommandLineSwitchStart(arg) CommandLineSwitchCase(arg, "sessions")
+	{
+		char* end = NULL;
+		errno = 0;
+		const unsigned long val = strtoul(arg->Value, &end, 0);
+		if ((errno != 0) || !end || (*end != '\0') || (val < 1) || (val > TF_MAX_SESSIONS))
+			return COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+		options->sessions = (UINT32)val;
+	}
+	CommandLineSwitchCase(arg, "input-script")
+	{
+		/* every session parses the command line, load the script only once */
+		if (!options->script && !tf_load_input_script(options, arg->Value))
+			return COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+	}
+	CommandLineSwitchEnd(arg)
+
+	    return 0;
+}
+
+static BOOL tf_send_input_event(rdpContext* context, const tfInputEvent* event)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(event);
+
+	rdpInput* input = context->input;
+	if (event->key)
+	{
+		return freerdp_input_send_keyboard_event_ex(input, TRUE, FALSE, event->scancode) &&
+		       freerdp_input_send_keyboard_event_ex(input, FALSE, FALSE, event->scancode);
+	}
+
+	if (event->flags & PTR_FLAGS_BUTTON1)
+	{
+		return freerdp_input_send_mouse_event(input, PTR_FLAGS_DOWN | PTR_FLAGS_BUTTON1,
+		                                      event->x, event->y) &&
+		       freerdp_input_send_mouse_event(input, PTR_FLAGS_BUTTON1, event->x, event->y);
+	}
+	return freerdp_input_send_mouse_event(input, event->flags, event->x, event->y);
+}
+
 /* RDP main loop.
  * Connects RDP, loops while running and handles event and dispatch, cleans up
  * after the connection ends. */
@@ -238,7 +392,15 @@ static DWORD WINAPI tf_client_thread_proc(LPVOID arg)
 	DWORD status = 0;
 	DWORD result = 0;
 	HANDLE handles[MAXIMUM_WAIT_OBJECTS] = { 0 };
+
+	WINPR_ASSERT(instance);
+	tfContext* tf = (tfContext*)instance->context;
+	WINPR_ASSERT(tf);
+
+	const UINT64 start = GetTickCount64();
 	BOOL rc = freerdp_connect(instance);
+	const UINT64 connected = GetTickCount64();
+	tf->connectTime = connected - start;
 
 	WINPR_ASSERT(instance->context);
 	WINPR_ASSERT(instance->context->settings);
@@ -247,6 +409,7 @@ static DWORD WINAPI tf_client_thread_proc(LPVOID arg)
 		result = freerdp_get_last_error(instance->context);
 		freerdp_abort_connect_context(instance->context);
 		WLog_ERR(TAG, "Authentication only, exit status 0x%08" PRIx32 "", result);
+		tf->result = result;
 		goto disconnect;
 	}
 
@@ -254,11 +417,32 @@ static DWORD WINAPI tf_client_thread_proc(LPVOID arg)
 	{
 		result = freerdp_get_last_error(instance->context);
 		WLog_ERR(TAG, "connection failure 0x%08" PRIx32, result);
+		tf->result = result;
 		return result;
 	}
 
+	size_t nextEvent = 0;
+	UINT64 due = connected + ((tf->scriptCount > 0) ? tf->script[0].delay : 0);
+
 	while (!freerdp_shall_disconnect_context(instance->context))
 	{
+		DWORD timeout = 100;
+
+		if (nextEvent < tf->scriptCount)
+		{
+			const UINT64 now = GetTickCount64();
+			if (now >= due)
+			{
+				if (!tf_send_input_event(instance->context, &tf->script[nextEvent]))
+					WLog_WARN(TAG, "failed to send scripted input event %" PRIuz, nextEvent);
+				if (++nextEvent < tf->scriptCount)
+					due = now + tf->script[nextEvent].delay;
+				timeout = 0;
+			}
+			else
+				timeout = (DWORD)MIN(due - now, timeout);
+		}
+
 		nCount = freerdp_get_event_handles(instance->context, handles, ARRAYSIZE(handles));
 
 		if (nCount == 0)
@@ -267,7 +451,7 @@ static DWORD WINAPI tf_client_thread_proc(LPVOID arg)
 			break;
 		}
 
-		status = WaitForMultipleObjects(nCount, handles, FALSE, 100);
+		status = WaitForMultipleObjects(nCount, handles, FALSE, timeout);
 
 		if (status == WAIT_FAILED)
 		{
@@ -284,6 +468,10 @@ static DWORD WINAPI tf_client_thread_proc(LPVOID arg)
 		}
 	}
 
+	tf->result = freerdp_get_last_error(instance->context);
+	tf->duration = GetTickCount64() - connected;
+	(void)freerdp_get_stats(instance->context->rdp, &tf->inBytes, &tf->outBytes, NULL, NULL);
+
 disconnect:
 	freerdp_disconnect(instance);
 	return result;
@@ -379,39 +567,150 @@ static int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints)
 	return 0;
 }
 
+static void tf_print_load_statistics(rdpContext** contexts, size_t count)
+{
+	size_t failed = 0;
+	UINT64 connectTotal = 0;
+	UINT64 connectMax = 0;
+	UINT64 frames = 0;
+	UINT64 inBytes = 0;
+	UINT64 outBytes = 0;
+	UINT64 duration = 0;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const tfContext* tf = (const tfContext*)contexts[x];
+		if (!tf)
+			continue;
+
+		if (tf->result != FREERDP_ERROR_SUCCESS)
+		{
+			failed++;
+			WLog_INFO(TAG, "session %" PRIuz " ended with %s [0x%08" PRIx32 "]", x,
+			          freerdp_get_last_error_name(tf->result), tf->result);
+		}
+
+		connectTotal += tf->connectTime;
+		connectMax = MAX(connectMax, tf->connectTime);
+		frames += tf->frames;
+		inBytes += tf->inBytes;
+		outBytes += tf->outBytes;
+		duration = MAX(duration, tf->duration);
+	}
+
+	WLog_INFO(TAG, "%" PRIuz " sessions, %" PRIuz " failed", count, failed);
+	WLog_INFO(TAG, "connect time avg %" PRIu64 "ms, max %" PRIu64 "ms", connectTotal / count,
+	          connectMax);
+	if (duration > 0)
+	{
+		WLog_INFO(TAG,
+		          "%" PRIu64 " frames (%" PRIu64 "/s), received %" PRIu64 " bytes (%" PRIu64
+		          " kbit/s), sent %" PRIu64 " bytes",
+		          frames, frames * 1000ull / duration, inBytes, inBytes * 8ull / duration,
+		          outBytes);
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	int rc = -1;
 	RDP_CLIENT_ENTRY_POINTS clientEntryPoints = { 0 };
+	tfOptions options = { 0 };
+	rdpContext** contexts = NULL;
+	HANDLE* threads = NULL;
+	size_t started = 0;
 
+	options.sessions = 1;
 	RdpClientEntry(&clientEntryPoints);
-	rdpContext* context = freerdp_client_context_new(&clientEntryPoints);
 
-	if (!context)
+	/* the first session parses the command line, the others repeat it once the count is known */
+	contexts = calloc(TF_MAX_SESSIONS, sizeof(rdpContext*));
+	threads = calloc(TF_MAX_SESSIONS, sizeof(HANDLE));
+	if (!contexts || !threads)
 		goto fail;
 
-	const int status =
-	    freerdp_client_settings_parse_command_line(context->settings, argc, argv, FALSE);
-	if (status)
+	for (size_t x = 0; x < options.sessions; x++)
 	{
-		rc = freerdp_client_settings_command_line_status_print(context->settings, status, argc,
-		                                                       argv);
-		goto fail;
+		rdpContext* context = freerdp_client_context_new(&clientEntryPoints);
+
+		if (!context)
+			goto fail;
+		contexts[x] = context;
+
+		const int status = freerdp_client_settings_parse_command_line_ex(
+		    context->settings, argc, argv, FALSE, tf_args, ARRAYSIZE(tf_args), tf_handle_option,
+		    &options);
+		if (status)
+		{
+			rc = freerdp_client_settings_command_line_status_print_ex(
+			    context->settings, status, argc, argv, tf_args);
+			goto fail;
+		}
+
+		tfContext* tf = (tfContext*)context;
+		tf->script = options.script;
+		tf->scriptCount = options.scriptCount;
+
+		if (!stream_dump_register_handlers(context, CONNECTION_STATE_MCS_CREATE_REQUEST, FALSE))
+			goto fail;
 	}
 
-	if (!stream_dump_register_handlers(context, CONNECTION_STATE_MCS_CREATE_REQUEST, FALSE))
-		goto fail;
+	for (size_t x = 0; x < options.sessions; x++)
+	{
+		rdpContext* context = contexts[x];
+		if (freerdp_client_start(context) != 0)
+			break;
 
-	if (freerdp_client_start(context) != 0)
-		goto fail;
+		/* a single session runs on the main thread, as before */
+		if (options.sessions > 1)
+		{
+			threads[x] = CreateThread(NULL, 0, tf_client_thread_proc, context->instance, 0, NULL);
+			if (!threads[x])
+			{
+				(void)freerdp_client_stop(context);
+				break;
+			}
+		}
+		started++;
+	}
 
-	const DWORD res = tf_client_thread_proc(context->instance);
-	rc = (int)res;
+	if (options.sessions == 1)
+	{
+		if (started == 1)
+		{
+			const DWORD res = tf_client_thread_proc(contexts[0]->instance);
+			rc = (int)res;
 
-	if (freerdp_client_stop(context) != 0)
-		rc = -1;
+			if (freerdp_client_stop(contexts[0]) != 0)
+				rc = -1;
+		}
+	}
+	else
+	{
+		rc = (started == options.sessions) ? 0 : -1;
+		for (size_t x = 0; x < started; x++)
+		{
+			DWORD res = 0;
+			(void)WaitForSingleObject(threads[x], INFINITE);
+			if (!GetExitCodeThread(threads[x], &res) || (res != 0))
+				rc = -1;
+			(void)CloseHandle(threads[x]);
+
+			if (freerdp_client_stop(contexts[x]) != 0)
+				rc = -1;
+		}
+
+		tf_print_load_statistics(contexts, started);
+	}
 
 fail:
-	freerdp_client_context_free(context);
+	if (contexts)
+	{
+		for (size_t x = 0; x < TF_MAX_SESSIONS; x++)
+			freerdp_client_context_free(contexts[x]);
+	}
+	free(contexts);
+	free(threads);
+	free(options.script);
 	return rc;
 }
@@ -27,10 +27,32 @@
 #include <freerdp/client/cliprdr.h>
 #include <freerdp/client/rdpgfx.h>
 
+typedef struct
+{
+	UINT32 delay;
+	UINT16 flags;
+	UINT16 x;
+	UINT16 y;
+	UINT32 scancode;
+	BOOL key;
+} tfInputEvent;
+
 typedef struct
 {
 	rdpClientContext common;
 
+	/* Scripted input, shared by all sessions of the process */
+	const tfInputEvent* script;
+	size_t scriptCount;
+
+	/* Load test statistics */
+	UINT64 connectTime;
+	UINT64 frames;
+	UINT64 inBytes;
+	UINT64 outBytes;
+	UINT64 duration;
+	DWORD result;
+
 	/* Channels */
 } tfContext;
 
@@ -51,6 +51,12 @@
 #include <X11/extensions/Xinerama.h>
 #endif
 
+#ifdef WITH_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#endif
+
 #include <X11/XKBlib.h>
 
 #include <errno.h>
@@ -99,6 +105,7 @@
 #include "xf_video.h"
 #include "xf_monitor.h"
 #include "xf_graphics.h"
+#include "xf_gfx.h"
 #include "xf_keyboard.h"
 #include "xf_channels.h"
 #include "xf_client.h"
@@ -906,6 +913,53 @@ static BOOL xf_play_sound(rdpContext* context, const PLAY_SOUND_UPDATE* play_sou
 	return TRUE;
 }
 
+#ifdef WITH_XSHM
+static BOOL xf_xshm_attach_failed = FALSE;
+
+static int xf_xshm_error_handler(Display* d, XErrorEvent* ev)
+{
+	WINPR_UNUSED(d);
+	WINPR_UNUSED(ev);
+	xf_xshm_attach_failed = TRUE;
+	return 0;
+}
+
+/* The extension is also announced by remote servers, only attaching a segment tells */
+static BOOL xf_check_xshm(xfContext* xfc)
+{
+	BOOL rc = FALSE;
+	XShmSegmentInfo shminfo = { 0 };
+
+	if (!XShmQueryExtension(xfc->display))
+		return FALSE;
+
+	shminfo.shmid = shmget(IPC_PRIVATE, 4096, IPC_CREAT | 0600);
+	if (shminfo.shmid < 0)
+		return FALSE;
+
+	shminfo.shmaddr = shmat(shminfo.shmid, NULL, 0);
+	if (shminfo.shmaddr != (char*)-1)
+	{
+		XSync(xfc->display, False);
+		xf_xshm_attach_failed = FALSE;
+		int (*handler)(Display*, XErrorEvent*) = XSetErrorHandler(xf_xshm_error_handler);
+		const Status status = XShmAttach(xfc->display, &shminfo);
+		XSync(xfc->display, False);
+		XSetErrorHandler(handler);
+
+		rc = status && !xf_xshm_attach_failed;
+		if (rc)
+		{
+			XShmDetach(xfc->display, &shminfo);
+			XSync(xfc->display, False);
+		}
+		shmdt(shminfo.shmaddr);
+	}
+	shmctl(shminfo.shmid, IPC_RMID, NULL);
+	return rc;
+}
+#endif
+
 static void xf_check_extensions(xfContext* context)
 {
 	int xkb_opcode = 0;
@@ -932,6 +986,11 @@ static void xf_check_extensions(xfContext* context)
 		}
 	}
 #endif
+
+#ifdef WITH_XSHM
+	context->xshmAvailable = xf_check_xshm(context);
+	WLog_DBG(TAG, "MIT-SHM presentation %s", context->xshmAvailable ? "enabled" : "not available");
+#endif
 }
 
 #ifdef WITH_XI
@@ -1598,6 +1657,7 @@ static DWORD WINAPI xf_client_thread(LPVOID param)
 		DWORD nCount = 0;
 		handles[nCount++] = timer;
 		handles[nCount++] = inputEvent;
+		handles[nCount++] = xfc->gfxPresentEvent;
 
 		/*
 		 * win8 and server 2k12 seem to have some timing issue/race condition
@@ -1658,6 +1718,14 @@ static DWORD WINAPI xf_client_thread(LPVOID param)
 		if (!handle_window_events(instance))
 			break;
 
+		/* Present the newest decoded state, frames decoded in between are not shown */
+		if (WaitForSingleObject(xfc->gfxPresentEvent, 0) == WAIT_OBJECT_0)
+		{
+			(void)ResetEvent(xfc->gfxPresentEvent);
+			if (xf_gfx_present(xfc) != CHANNEL_RC_OK)
+				WLog_WARN(TAG, "failed to present gfx surfaces");
+		}
+
 		if ((waitStatus != WAIT_TIMEOUT) && (waitStatus == WAIT_OBJECT_0))
 		{
 			timerEvent.now = GetTickCount64();
@@ -1837,6 +1905,12 @@ void xf_teardown_x11(xfContext* xfc)
 		xfc->x11event = NULL;
 	}
 
+	if (xfc->gfxPresentEvent)
+	{
+		(void)CloseHandle(xfc->gfxPresentEvent);
+		xfc->gfxPresentEvent = NULL;
+	}
+
 	if (xfc->mutex)
 	{
 		(void)CloseHandle(xfc->mutex);
@@ -2013,6 +2087,13 @@ BOOL xf_setup_x11(xfContext* xfc)
 		goto fail;
 	}
 
+	xfc->gfxPresentEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!xfc->gfxPresentEvent)
+	{
+		WLog_ERR(TAG, "Could not create gfx present event");
+		goto fail;
+	}
+
 	xf_check_extensions(xfc);
 
 	xfc->vscreen.monitors = calloc(16, sizeof(MONITOR_INFO));
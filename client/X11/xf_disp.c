@@ -38,6 +38,7 @@
 #include <freerdp/log.h>
 #define TAG CLIENT_TAG("x11disp")
 #define RESIZE_MIN_DELAY 200 /* minimum delay in ms between two resizes */
+#define RESIZE_RESET_TIMEOUT 2000 /* maximum time in ms to wait for the server to apply a layout */
 
 struct s_xfDispContext
 {
@@ -54,11 +55,11 @@ struct s_xfDispContext
 	UINT32 targetHeight;
 	BOOL activated;
 	BOOL fullscreen;
+	BOOL waitingResize;
 	UINT16 lastSentDesktopOrientation;
 	BYTE reserved2[2];
 	UINT32 lastSentDesktopScaleFactor;
 	UINT32 lastSentDeviceScaleFactor;
-	BYTE reserved3[4];
 };
 
 static UINT xf_disp_sendLayout(DispClientContext* disp, const rdpMonitor* monitors,
@@ -138,13 +139,20 @@ static BOOL xf_disp_sendResize(xfDispContext* xfDisp)
 	if (!xfDisp->activated || !xfDisp->disp)
 		return TRUE;
 
-	if (GetTickCount64() - xfDisp->lastSentDate < RESIZE_MIN_DELAY)
+	const UINT64 now = GetTickCount64();
+	if (now - xfDisp->lastSentDate < RESIZE_MIN_DELAY)
+		return TRUE;
+
+	/* the server reconfigures and re-encodes the whole desktop for every layout, so hold the
+	 * next one until the previous one was applied */
+	if (xfDisp->waitingResize && (now - xfDisp->lastSentDate < RESIZE_RESET_TIMEOUT))
 		return TRUE;
 
 	if (!xf_disp_settings_changed(xfDisp))
 		return TRUE;
 
-	xfDisp->lastSentDate = GetTickCount64();
+	xfDisp->lastSentDate = now;
+	xfDisp->waitingResize = TRUE;
 
 	const UINT32 mcount = freerdp_settings_get_uint32(settings, FreeRDP_MonitorCount);
 	if (xfc->fullscreen && (mcount > 0))
@@ -238,6 +246,8 @@ static void xf_disp_OnActivated(void* context, const ActivatedEventArgs* e)
 	if (!xf_disp_check_context(context, &xfc, &xfDisp, &settings))
 		return;
 
+	xfDisp->waitingResize = FALSE;
+
 	if (xfDisp->activated && !xfc->fullscreen)
 	{
 		xf_disp_set_window_resizable(xfDisp);
@@ -260,6 +270,8 @@ static void xf_disp_OnGraphicsReset(void* context, const GraphicsResetEventArgs*
 	if (!xf_disp_check_context(context, &xfc, &xfDisp, &settings))
 		return;
 
+	xfDisp->waitingResize = FALSE;
+
 	if (xfDisp->activated && !freerdp_settings_get_bool(settings, FreeRDP_Fullscreen))
 	{
 		xf_disp_set_window_resizable(xfDisp);
@@ -29,8 +29,30 @@
 
 #include <X11/Xutil.h>
 
+#ifdef WITH_XSHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
+
 #define TAG CLIENT_TAG("x11")
 
+static void xf_gfx_put_image(xfContext* xfc, xfGfxSurface* surface, Drawable d, int src_x,
+                             int src_y, int dest_x, int dest_y, unsigned int width,
+                             unsigned int height)
+{
+#ifdef WITH_XSHM
+	/* The server reads the segment asynchronously, xf_OutputUpdate syncs before returning */
+	if (surface->shminfo.shmaddr)
+	{
+		XShmPutImage(xfc->display, d, xfc->gc, surface->image, src_x, src_y, dest_x, dest_y, width,
+		             height, False);
+		return;
+	}
+#endif
+	XPutImage(xfc->display, d, xfc->gc, surface->image, src_x, src_y, dest_x, dest_y, width,
+	          height);
+}
+
 static UINT xf_OutputUpdate(xfContext* xfc, xfGfxSurface* surface)
 {
 	UINT rc = ERROR_INTERNAL_ERROR;
@@ -88,8 +110,8 @@ static UINT xf_OutputUpdate(xfContext* xfc, xfGfxSurface* surface)
 
 		if (xfc->remote_app)
 		{
-			XPutImage(xfc->display, xfc->primary, xfc->gc, surface->image, nXSrc, nYSrc, nXDst,
-			          nYDst, dwidth, dheight);
+			xf_gfx_put_image(xfc, surface, xfc->primary, nXSrc, nYSrc, nXDst, nYDst, dwidth,
+			                 dheight);
 			xf_lock_x11(xfc);
 			xf_rail_paint_surface(xfc, surface->gdi.windowId, rect);
 			xf_unlock_x11(xfc);
@@ -99,15 +121,15 @@ static UINT xf_OutputUpdate(xfContext* xfc, xfGfxSurface* surface)
 		    if (freerdp_settings_get_bool(settings, FreeRDP_SmartSizing) ||
 		        freerdp_settings_get_bool(settings, FreeRDP_MultiTouchGestures))
 		{
-			XPutImage(xfc->display, xfc->primary, xfc->gc, surface->image, nXSrc, nYSrc, nXDst,
-			          nYDst, dwidth, dheight);
+			xf_gfx_put_image(xfc, surface, xfc->primary, nXSrc, nYSrc, nXDst, nYDst, dwidth,
+			                 dheight);
 			xf_draw_screen(xfc, nXDst, nYDst, dwidth, dheight);
 		}
 		else
 #endif
 		{
-			XPutImage(xfc->display, xfc->drawable, xfc->gc, surface->image, nXSrc, nYSrc, nXDst,
-			          nYDst, dwidth, dheight);
+			xf_gfx_put_image(xfc, surface, xfc->drawable, nXSrc, nYSrc, nXDst, nYDst, dwidth,
+			                 dheight);
 		}
 	}
 
@@ -127,20 +149,39 @@ static UINT xf_WindowUpdate(RdpgfxClientContext* context, xfGfxSurface* surface)
 }
 
 static UINT xf_UpdateSurfaces(RdpgfxClientContext* context)
+{
+	rdpGdi* gdi = (rdpGdi*)context->custom;
+
+	if (!gdi)
+		return CHANNEL_RC_OK;
+
+	xfContext* xfc = (xfContext*)gdi->context;
+	WINPR_ASSERT(xfc);
+
+	/* Only mark the surfaces ready, the UI thread presents them. Updates arriving before it gets
+	 * to run collapse into a single present of the accumulated invalid regions. */
+	if (!SetEvent(xfc->gfxPresentEvent))
+		return ERROR_INTERNAL_ERROR;
+
+	return CHANNEL_RC_OK;
+}
+
+UINT xf_gfx_present(xfContext* xfc)
 {
 	UINT16 count = 0;
 	UINT status = CHANNEL_RC_OK;
 	UINT16* pSurfaceIds = NULL;
-	rdpGdi* gdi = (rdpGdi*)context->custom;
-	xfContext* xfc = NULL;
 
-	if (!gdi)
+	WINPR_ASSERT(xfc);
+
+	rdpGdi* gdi = xfc->common.context.gdi;
+	if (!gdi || !gdi->gfx)
 		return status;
 
 	if (gdi->suppressOutput)
 		return CHANNEL_RC_OK;
 
-	xfc = (xfContext*)gdi->context;
+	RdpgfxClientContext* context = gdi->gfx;
 	EnterCriticalSection(&context->mux);
 	context->GetSurfaceIds(context, &pSurfaceIds, &count);
 
@@ -256,6 +297,131 @@ static UINT32 x11_pad_scanline(UINT32 scanline, UINT32 inPad)
 	return scanline;
 }
 
+#ifdef WITH_XSHM
+static BYTE* xf_gfx_shm_image_new(xfContext* xfc, xfGfxSurface* surface, UINT32 scanline,
+                                  size_t size)
+{
+	XShmSegmentInfo* shminfo = &surface->shminfo;
+
+	WINPR_ASSERT(xfc->depth != 0);
+	XImage* image =
+	    XShmCreateImage(xfc->display, xfc->visual, xfc->depth, ZPixmap, NULL, shminfo,
+	                    surface->gdi.mappedWidth, surface->gdi.mappedHeight);
+	if (!image)
+		return NULL;
+
+	/* The codecs write with the surface scanline, the image has to use the same one */
+	if ((image->bytes_per_line < 0) || ((UINT32)image->bytes_per_line > scanline))
+		goto fail;
+	image->bytes_per_line = (int)scanline;
+
+	shminfo->shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+	if (shminfo->shmid < 0)
+		goto fail;
+
+	shminfo->shmaddr = shmat(shminfo->shmid, NULL, 0);
+	if (shminfo->shmaddr == (char*)-1)
+	{
+		shminfo->shmaddr = NULL;
+		goto fail_rmid;
+	}
+
+	shminfo->readOnly = False;
+	if (!XShmAttach(xfc->display, shminfo))
+		goto fail_detach;
+	XSync(xfc->display, False);
+
+	/* The segment is released as soon as both sides detached, new segments are zeroed */
+	shmctl(shminfo->shmid, IPC_RMID, NULL);
+	image->data = shminfo->shmaddr;
+	surface->image = image;
+	return (BYTE*)shminfo->shmaddr;
+
+fail_detach:
+	shmdt(shminfo->shmaddr);
+	shminfo->shmaddr = NULL;
+fail_rmid:
+	shmctl(shminfo->shmid, IPC_RMID, NULL);
+fail:
+	XDestroyImage(image);
+	return NULL;
+}
+#endif
+
+/* Allocates the buffer presented by the surface XImage and creates the image for it */
+static BYTE* xf_gfx_image_new(xfContext* xfc, xfGfxSurface* surface, UINT32 scanline)
+{
+	const size_t size = 1ull * scanline * surface->gdi.height;
+
+#ifdef WITH_XSHM
+	if (xfc->xshmAvailable)
+	{
+		BYTE* shm = xf_gfx_shm_image_new(xfc, surface, scanline, size);
+		if (shm)
+			return shm;
+		WLog_WARN(TAG, "unable to create a MIT-SHM image, falling back to XPutImage");
+	}
+#endif
+
+	BYTE* data = (BYTE*)winpr_aligned_malloc(size, 16);
+
+	if (!data)
+		return NULL;
+
+	ZeroMemory(data, size);
+	WINPR_ASSERT(xfc->depth != 0);
+	surface->image = XCreateImage(xfc->display, xfc->visual, xfc->depth, ZPixmap, 0, (char*)data,
+	                              surface->gdi.mappedWidth, surface->gdi.mappedHeight,
+	                              xfc->scanline_pad, scanline);
+
+	if (!surface->image)
+	{
+		winpr_aligned_free(data);
+		return NULL;
+	}
+
+	return data;
+}
+
+static void xf_gfx_image_free(xfContext* xfc, xfGfxSurface* surface, BYTE* data)
+{
+	if (surface->image)
+	{
+		surface->image->data = NULL;
+		XDestroyImage(surface->image);
+		surface->image = NULL;
+	}
+
+#ifdef WITH_XSHM
+	if (surface->shminfo.shmaddr)
+	{
+		XShmDetach(xfc->display, &surface->shminfo);
+		XSync(xfc->display, False);
+		shmdt(surface->shminfo.shmaddr);
+		surface->shminfo.shmaddr = NULL;
+		return;
+	}
+#else
+	WINPR_UNUSED(xfc);
+#endif
+	winpr_aligned_free(data);
+}
+
+static void xf_gfx_surface_free_data(xfContext* xfc, xfGfxSurface* surface)
+{
+	/* The image presents the stage buffer if there is one, the GDI data otherwise */
+	if (surface->stage)
+	{
+		xf_gfx_image_free(xfc, surface, surface->stage);
+		winpr_aligned_free(surface->gdi.data);
+	}
+	else
+		xf_gfx_image_free(xfc, surface, surface->gdi.data);
+
+	surface->stage = NULL;
+	surface->gdi.data = NULL;
+}
+
 /**
  * Function description
  *
@@ -308,52 +474,41 @@ static UINT xf_CreateSurface(RdpgfxClientContext* context,
 
 	surface->gdi.scanline = surface->gdi.width * FreeRDPGetBytesPerPixel(surface->gdi.format);
 	surface->gdi.scanline = x11_pad_scanline(surface->gdi.scanline, xfc->scanline_pad);
-	size = 1ull * surface->gdi.scanline * surface->gdi.height;
-	surface->gdi.data = (BYTE*)winpr_aligned_malloc(size, 16);
-
-	if (!surface->gdi.data)
-	{
-		WLog_ERR(TAG, "unable to allocate GDI data");
-		goto out_free;
-	}
-
-	ZeroMemory(surface->gdi.data, size);
 
 	if (FreeRDPAreColorFormatsEqualNoAlpha(gdi->dstFormat, surface->gdi.format))
 	{
-		WINPR_ASSERT(xfc->depth != 0);
-		surface->image =
-		    XCreateImage(xfc->display, xfc->visual, xfc->depth, ZPixmap, 0,
-		                 (char*)surface->gdi.data, surface->gdi.mappedWidth,
-		                 surface->gdi.mappedHeight, xfc->scanline_pad, surface->gdi.scanline);
+		surface->gdi.data = xf_gfx_image_new(xfc, surface, surface->gdi.scanline);
+
+		if (!surface->gdi.data)
+		{
+			WLog_ERR(TAG, "an error occurred when creating the XImage");
+			goto out_free;
+		}
 	}
 	else
 	{
+		size = 1ull * surface->gdi.scanline * surface->gdi.height;
+		surface->gdi.data = (BYTE*)winpr_aligned_malloc(size, 16);
+
+		if (!surface->gdi.data)
+		{
+			WLog_ERR(TAG, "unable to allocate GDI data");
+			goto out_free;
+		}
+
+		ZeroMemory(surface->gdi.data, size);
+
 		UINT32 width = surface->gdi.width;
 		UINT32 bytes = FreeRDPGetBytesPerPixel(gdi->dstFormat);
 		surface->stageScanline = width * bytes;
 		surface->stageScanline = x11_pad_scanline(surface->stageScanline, xfc->scanline_pad);
-		size = 1ull * surface->stageScanline * surface->gdi.height;
-		surface->stage = (BYTE*)winpr_aligned_malloc(size, 16);
+		surface->stage = xf_gfx_image_new(xfc, surface, surface->stageScanline);
 
 		if (!surface->stage)
 		{
-			WLog_ERR(TAG, "unable to allocate stage buffer");
+			WLog_ERR(TAG, "an error occurred when creating the XImage");
 			goto out_free_gdidata;
 		}
-
-		ZeroMemory(surface->stage, size);
-		WINPR_ASSERT(xfc->depth != 0);
-		surface->image =
-		    XCreateImage(xfc->display, xfc->visual, xfc->depth, ZPixmap, 0, (char*)surface->stage,
-		                 surface->gdi.mappedWidth, surface->gdi.mappedHeight, xfc->scanline_pad,
-		                 surface->stageScanline);
-	}
-
-	if (!surface->image)
-	{
-		WLog_ERR(TAG, "an error occurred when creating the XImage");
-		goto error_surface_image;
 	}
 
 	surface->image->byte_order = LSBFirst;
@@ -369,10 +524,8 @@ static UINT xf_CreateSurface(RdpgfxClientContext* context,
 
 	return CHANNEL_RC_OK;
 error_set_surface_data:
-	surface->image->data = NULL;
-	XDestroyImage(surface->image);
-error_surface_image:
-	winpr_aligned_free(surface->stage);
+	xf_gfx_surface_free_data(xfc, surface);
+	goto out_free;
 out_free_gdidata:
 	winpr_aligned_free(surface->gdi.data);
 out_free:
@@ -391,6 +544,8 @@ static UINT xf_DeleteSurface(RdpgfxClientContext* context,
 	rdpCodecs* codecs = NULL;
 	xfGfxSurface* surface = NULL;
 	UINT status = 0;
+	rdpGdi* gdi = (rdpGdi*)context->custom;
+	xfContext* xfc = (xfContext*)gdi->context;
 	EnterCriticalSection(&context->mux);
 	surface = (xfGfxSurface*)context->GetSurfaceData(context, deleteSurface->surfaceId);
 
@@ -402,10 +557,7 @@ static UINT xf_DeleteSurface(RdpgfxClientContext* context,
 #ifdef WITH_GFX_H264
 		h264_context_free(surface->gdi.h264);
 #endif
-		surface->image->data = NULL;
-		XDestroyImage(surface->image);
-		winpr_aligned_free(surface->gdi.data);
-		winpr_aligned_free(surface->stage);
+		xf_gfx_surface_free_data(xfc, surface);
 		region16_uninit(&surface->gdi.invalidRegion);
 		codecs = surface->gdi.codecs;
 		free(surface);
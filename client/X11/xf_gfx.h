@@ -27,17 +27,28 @@
 
 #include <freerdp/gdi/gfx.h>
 
+#ifdef WITH_XSHM
+#include <X11/extensions/XShm.h>
+#endif
+
 struct xf_gfx_surface
 {
 	gdiGfxSurface gdi;
 	BYTE* stage;
 	UINT32 stageScanline;
 	XImage* image;
+#ifdef WITH_XSHM
+	/* The image data is a shared memory segment if shmaddr is set */
+	XShmSegmentInfo shminfo;
+#endif
 };
 typedef struct xf_gfx_surface xfGfxSurface;
 
 UINT xf_OutputExpose(xfContext* xfc, UINT32 x, UINT32 y, UINT32 width, UINT32 height);
 
+/* Presents the surfaces decoded since the last call, runs on the UI thread */
+UINT xf_gfx_present(xfContext* xfc);
+
 void xf_graphics_pipeline_init(xfContext* xfc, RdpgfxClientContext* gfx);
 
 void xf_graphics_pipeline_uninit(xfContext* xfc, RdpgfxClientContext* gfx);
@@ -57,6 +57,7 @@ struct xf_rail_icon
 {
 	long* data;
 	int length;
+	UINT64 hash; /* of the ICON_INFO data was converted from */
 };
 typedef struct xf_rail_icon xfRailIcon;
 
@@ -636,6 +637,57 @@ static void RailIconCache_Free(xfRailIconCache* cache)
 	}
 }
 
+/* FNV-1a */
+static UINT64 rail_icon_hash_update(UINT64 hash, const BYTE* data, size_t length)
+{
+	for (size_t x = 0; x < length; x++)
+	{
+		hash ^= data[x];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static UINT64 rail_icon_hash(const ICON_INFO* iconInfo)
+{
+	const UINT32 header[] = { iconInfo->bpp, iconInfo->width, iconInfo->height,
+		                      iconInfo->cbBitsMask, iconInfo->cbColorTable, iconInfo->cbBitsColor };
+	UINT64 hash = 14695981039346656037ull;
+
+	hash = rail_icon_hash_update(hash, (const BYTE*)header, sizeof(header));
+	hash = rail_icon_hash_update(hash, iconInfo->bitsMask, iconInfo->cbBitsMask);
+	hash = rail_icon_hash_update(hash, iconInfo->colorTable, iconInfo->cbColorTable);
+	return rail_icon_hash_update(hash, iconInfo->bitsColor, iconInfo->cbBitsColor);
+}
+
+/* applications share icons between their windows, a server sends them again for each one */
+static const xfRailIcon* RailIconCache_FindByHash(const xfRailIconCache* cache, UINT64 hash)
+{
+	for (size_t x = 0; x < 1ull * cache->numCaches * cache->numCacheEntries; x++)
+	{
+		const xfRailIcon* icon = &cache->entries[x];
+		if (icon->data && (icon->hash == hash))
+			return icon;
+	}
+
+	if (cache->scratch.data && (cache->scratch.hash == hash))
+		return &cache->scratch;
+	return NULL;
+}
+
+static BOOL rail_icon_copy(xfRailIcon* dst, const xfRailIcon* src)
+{
+	long* pixels = realloc(dst->data, 1ull * src->length * sizeof(long));
+	if (!pixels)
+		return FALSE;
+
+	memcpy(pixels, src->data, 1ull * src->length * sizeof(long));
+	dst->data = pixels;
+	dst->length = src->length;
+	dst->hash = src->hash;
+	return TRUE;
+}
+
 static xfRailIcon* RailIconCache_Lookup(xfRailIconCache* cache, UINT8 cacheId, UINT16 cacheEntry)
 {
 	/*
@@ -744,10 +796,24 @@ static BOOL xf_rail_window_icon(rdpContext* context, const WINDOW_ORDER_INFO* or
 		return FALSE;
 	}
 
-	if (!convert_rail_icon(windowIcon->iconInfo, icon))
+	const UINT64 hash = rail_icon_hash(windowIcon->iconInfo);
+	if (!icon->data || (icon->hash != hash))
 	{
-		WLog_WARN(TAG, "failed to convert icon for window %08X", orderInfo->windowId);
-		return FALSE;
+		const xfRailIcon* same = RailIconCache_FindByHash(xfc->railIconCache, hash);
+		if (same)
+		{
+			if (!rail_icon_copy(icon, same))
+				return FALSE;
+		}
+		else
+		{
+			if (!convert_rail_icon(windowIcon->iconInfo, icon))
+			{
+				WLog_WARN(TAG, "failed to convert icon for window %08X", orderInfo->windowId);
+				return FALSE;
+			}
+			icon->hash = hash;
+		}
 	}
 
 	replaceIcon = !!(orderInfo->fieldFlags & WINDOW_ORDER_STATE_NEW);
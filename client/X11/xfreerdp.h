@@ -166,6 +166,7 @@ struct xf_context
 	BOOL unobscured;
 	BOOL debug;
 	HANDLE x11event;
+	HANDLE gfxPresentEvent; /* set when gfx surfaces are ready to present */
 	xfWindow* window;
 	xfAppWindow* appWindow;
 	xfPointer* pointer;
@@ -292,6 +293,7 @@ struct xf_context
 
 	BOOL xkbAvailable;
 	BOOL xrenderAvailable;
+	BOOL xshmAvailable;
 
 	/* value to be sent over wire for each logical client mouse button */
 	button_map button_map[NUM_BUTTONS_MAPPED];
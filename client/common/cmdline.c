@@ -1227,11 +1227,15 @@ static int freerdp_client_command_line_post_filter_int(void* context, COMMAND_LI
 
 		UINT32 flags = 0;
 		if (freerdp_settings_get_bool(settings, FreeRDP_SupportMultitransport))
-			flags =
-			    (TRANSPORT_TYPE_UDP_FECR | TRANSPORT_TYPE_UDP_FECL | TRANSPORT_TYPE_UDP_PREFERRED);
+			flags = (TRANSPORT_TYPE_UDP_FECR | TRANSPORT_TYPE_UDP_FECL |
+			         TRANSPORT_TYPE_UDP_PREFERRED | SOFTSYNC_TCP_TO_UDP);
 
 		if (!freerdp_settings_set_uint32(settings, FreeRDP_MultitransportFlags, flags))
 			return fail_at(arg, COMMAND_LINE_ERROR);
+
+		/* an explicit request also opens the UDP tunnels the server asks for */
+		if (!freerdp_settings_set_bool(settings, FreeRDP_MultitransportUdp, enable))
+			return fail_at(arg, COMMAND_LINE_ERROR);
 	}
 	CommandLineSwitchEnd(arg)
 
@@ -2342,6 +2346,24 @@ static int parse_gfx_options(rdpSettings* settings, const COMMAND_LINE_ARGUMENT_
 					                                    bval == PARSE_OFF))
 						rc = COMMAND_LINE_ERROR;
 				}
+				else if (option_starts_with("zero-copy", val))
+				{
+					const PARSE_ON_OFF_RESULT bval = parse_on_off_option(val);
+					if (bval == PARSE_FAIL)
+						rc = COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+					else if (!freerdp_settings_set_bool(settings, FreeRDP_GfxZeroCopyOutput,
+					                                    bval != PARSE_OFF))
+						rc = COMMAND_LINE_ERROR;
+				}
+				else if (option_starts_with("parallel", val))
+				{
+					const PARSE_ON_OFF_RESULT bval = parse_on_off_option(val);
+					if (bval == PARSE_FAIL)
+						rc = COMMAND_LINE_ERROR_UNEXPECTED_VALUE;
+					else if (!freerdp_settings_set_bool(settings, FreeRDP_GfxParallelDecode,
+					                                    bval != PARSE_OFF))
+						rc = COMMAND_LINE_ERROR;
+				}
 				else
 					rc = COMMAND_LINE_ERROR;
 			}
@@ -4652,6 +4674,11 @@ static int freerdp_client_settings_parse_command_line_arguments_int(
 			if (!freerdp_settings_set_bool(settings, FreeRDP_RedirectHomeDrive, enable))
 				return fail_at(arg, COMMAND_LINE_ERROR);
 		}
+		CommandLineSwitchCase(arg, "input-batching")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_FastPathInputBatching, enable))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
 		CommandLineSwitchCase(arg, "ipv4")
 		{
 			if (arg->Value != NULL && strncmp(arg->Value, str_force, ARRAYSIZE(str_force)) == 0)
@@ -5388,6 +5415,11 @@ static int freerdp_client_settings_parse_command_line_arguments_int(
 			if (!freerdp_settings_set_string(settings, FreeRDP_ActionScript, arg->Value))
 				return fail_at(arg, COMMAND_LINE_ERROR_MEMORY);
 		}
+		CommandLineSwitchCase(arg, "connection-trace")
+		{
+			if (!freerdp_settings_set_string(settings, FreeRDP_ConnectionTraceFile, arg->Value))
+				return fail_at(arg, COMMAND_LINE_ERROR_MEMORY);
+		}
 		CommandLineSwitchCase(arg, RDP2TCP_DVC_CHANNEL_NAME)
 		{
 			if (!freerdp_settings_set_string(settings, FreeRDP_RDP2TCPArgs, arg->Value))
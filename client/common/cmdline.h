@@ -115,6 +115,8 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	{ "connect-child-session", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, "",
 	  "connect to child session (win32)" },
 #endif
+	{ "connection-trace", COMMAND_LINE_VALUE_REQUIRED, "<file-name>", NULL, NULL, -1, NULL,
+	  "Write the timings of the connection sequence as JSON trace to <file-name>" },
 	{ "client-build-number", COMMAND_LINE_VALUE_REQUIRED, "<number>", NULL, NULL, -1, NULL,
 	  "Client Build Number sent to server (influences smartcard behaviour, see [MS-RDPESC])" },
 	{ "client-hostname", COMMAND_LINE_VALUE_REQUIRED, "<name>", NULL, NULL, -1, NULL,
@@ -202,7 +204,7 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	{ "gfx", COMMAND_LINE_VALUE_OPTIONAL,
 	  "[[progressive[:on|off]|RFX[:on|off]|AVC420[:on|off]AVC444[:on|off]],mask:<value>,small-"
 	  "cache[:on|off],thin-client[:on|off],progressive[:on|"
-	  "off],frame-ack[:on|off]]",
+	  "off],frame-ack[:on|off],zero-copy[:on|off],parallel[:on|off]]",
 	  NULL, NULL, -1, NULL, "RDP8 graphics pipeline" },
 #if defined(WITH_FREERDP_DEPRECATED_COMMANDLINE)
 	{ "gfx-h264", COMMAND_LINE_VALUE_OPTIONAL, "[[AVC420|AVC444],mask:<value>]", NULL, NULL, -1,
@@ -211,7 +213,8 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 #else
 	{ "gfx", COMMAND_LINE_VALUE_OPTIONAL,
 	  "[progressive[:on|off]|RFX[:on|off]|AVC420[:on|off]AVC444[:on|off]],mask:<value>,small-cache["
-	  ":on|off],thin-client[:on|off],progressive[:on|off]]",
+	  ":on|off],thin-client[:on|off],progressive[:on|off],zero-copy[:on|off],parallel[:on|"
+	  "off]]",
 	  NULL, NULL, -1, NULL, "RDP8 graphics pipeline" },
 #endif
 #if defined(WITH_FREERDP_DEPRECATED_COMMANDLINE)
@@ -248,6 +251,8 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  "Print help" },
 	{ "home-drive", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 	  "Redirect user home as share" },
+	{ "input-batching", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+	  "Pack fastpath input events into shared PDUs, merging mouse moves while sending blocks" },
 	{ "ipv4", COMMAND_LINE_VALUE_OPTIONAL, "[:force]", NULL, NULL, -1, "4",
 	  "Prefer IPv4 A record over IPv6 AAAA record" },
 	{ "ipv6", COMMAND_LINE_VALUE_OPTIONAL, "[:force]", NULL, NULL, -1, "6",
@@ -312,8 +317,9 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	{ "menu-anims", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 	  "menu animations" },
 	{ "microphone", COMMAND_LINE_VALUE_OPTIONAL,
-	  "[sys:<sys>,][dev:<dev>,][format:<format>,][rate:<rate>,][channel:<channel>]", NULL, NULL, -1,
-	  "mic", "Audio input (microphone)" },
+	  "[sys:<sys>,][dev:<dev>,][format:<format>,][rate:<rate>,][channel:<channel>,][latency:<"
+	  "latency>]",
+	  NULL, NULL, -1, "mic", "Audio input (microphone)" },
 #if defined(WITH_FREERDP_DEPRECATED_COMMANDLINE)
 	{ "smartcard-list", COMMAND_LINE_VALUE_FLAG | COMMAND_LINE_PRINT, NULL, NULL, NULL, -1, NULL,
 	  "[DEPRECATED, use /list:smartcard] List smartcard informations" },
@@ -440,7 +446,7 @@ static const COMMAND_LINE_ARGUMENT_A global_cmd_args[] = {
 	  -1, NULL, "Activates Smartcard (optional certificate) Logon authentication." },
 	{ "sound", COMMAND_LINE_VALUE_OPTIONAL,
 	  "[sys:<sys>,][dev:<dev>,][format:<format>,][rate:<rate>,][channel:<channel>,][latency:<"
-	  "latency>,][quality:<quality>]",
+	  "latency>,][lowlatency,][quality:<quality>]",
 	  NULL, NULL, -1, "audio", "Audio output (sound)" },
 	{ "span", COMMAND_LINE_VALUE_FLAG, NULL, NULL, NULL, -1, NULL,
 	  "Span screen over multiple monitors" },
@@ -11,6 +11,19 @@ if (WITH_VERBOSE_WINPR_ASSERT)
 	add_definitions(-DWITH_VERBOSE_WINPR_ASSERT)
 endif()
 
+# Log messages below this level are compiled out of the whole project
+set(WLOG_LEVEL_NAMES TRACE DEBUG INFO WARN ERROR FATAL OFF)
+set(WITH_WLOG_MIN_LEVEL "TRACE" CACHE STRING "Lowest WLog level compiled in, one of ${WLOG_LEVEL_NAMES}")
+set_property(CACHE WITH_WLOG_MIN_LEVEL PROPERTY STRINGS ${WLOG_LEVEL_NAMES})
+string(TOUPPER "${WITH_WLOG_MIN_LEVEL}" WLOG_MIN_LEVEL_NAME)
+list(FIND WLOG_LEVEL_NAMES "${WLOG_MIN_LEVEL_NAME}" WLOG_MIN_LEVEL)
+if (WLOG_MIN_LEVEL LESS 0)
+	message(FATAL_ERROR "WITH_WLOG_MIN_LEVEL=${WITH_WLOG_MIN_LEVEL} is invalid, use one of ${WLOG_LEVEL_NAMES}")
+endif()
+if (WLOG_MIN_LEVEL GREATER 0)
+	add_definitions(-DWINPR_WLOG_MIN_LEVEL=${WLOG_MIN_LEVEL})
+endif()
+
 # known issue on android, thus disabled until we support newer CMake
 # https://github.com/android/ndk/issues/1444
 if (NOT ANDROID)
@@ -40,6 +40,7 @@ if(NOT WIN32)
         "NOT WITH_VALGRIND_MEMCHECK; NOT WITH_SANITIZE_ADDRESS; NOT WITH_SANITIZE_THREAD" OFF)
 	CMAKE_DEPENDENT_OPTION(WITH_SANITIZE_THREAD "Compile with gcc/clang thread sanitizer." OFF
 		"NOT WITH_VALGRIND_MEMCHECK; NOT WITH_SANITIZE_ADDRESS; NOT WITH_SANITIZE_MEMORY" OFF)
+	option(WITH_USDT "Compile in USDT static probes (a nop unless a tracer attaches)." ON)
 else()
 	if(NOT UWP)
 		option(WITH_MEDIA_FOUNDATION "Enable H264 media foundation decoder." OFF)
@@ -137,6 +137,79 @@ extern "C"
 	};
 	FREERDP_API rdpAutoDetect* autodetect_get(rdpContext* context);
 
+	typedef enum
+	{
+		FREERDP_NETWORK_ESTIMATE_RTT = 0x01,
+		FREERDP_NETWORK_ESTIMATE_BANDWIDTH = 0x02,
+		FREERDP_NETWORK_ESTIMATE_GOODPUT = 0x04,
+		FREERDP_NETWORK_ESTIMATE_LOSS = 0x08,
+		FREERDP_NETWORK_ESTIMATE_FRAME_LATENCY = 0x10
+	} FREERDP_NETWORK_ESTIMATE_FLAGS;
+
+	/** \brief The continuously updated estimate of the connection.
+	 *
+	 *  Fed from the auto-detect PDUs, heartbeats, frame acknowledgements and the TCP_INFO of
+	 *  the socket where available.
+	 *
+	 *  \since version 3.9.0
+	 */
+	typedef struct
+	{
+		/* Specifies, which fields are valid, FREERDP_NETWORK_ESTIMATE_FLAGS */
+		UINT32 flags;
+		/* Smoothed round-trip time in milliseconds */
+		UINT32 smoothedRTT;
+		/* Lowest round-trip time seen in milliseconds */
+		UINT32 minRTT;
+		/* Mean deviation of the round-trip time in milliseconds */
+		UINT32 jitter;
+		/* Link bandwidth measured by auto-detect in kilobits per second */
+		UINT32 bandwidth;
+		/* Data actually delivered in kilobits per second, sent by servers, received by clients */
+		UINT32 goodput;
+		/* Retransmitted segments per 10000 sent, only known from TCP_INFO */
+		UINT32 loss;
+		/* Smoothed time from sending a frame to its acknowledgement in milliseconds */
+		UINT32 frameLatency;
+		/* GetTickCount64() of the last sample */
+		UINT64 updated;
+	} rdpNetworkEstimate;
+
+	/** \brief Returns the current network estimate of a connection.
+	 *
+	 *  \param context The RDP context
+	 *  \param estimate A pointer to the estimate to fill
+	 *
+	 *  \return TRUE if successful, check the flags for the valid fields
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_network_estimate_get(rdpContext* context,
+	                                              rdpNetworkEstimate* estimate);
+
+	/** \brief Adds a round-trip time measured outside of libfreerdp to the estimate.
+	 *
+	 *  \param context The RDP context
+	 *  \param rtt The round-trip time in milliseconds
+	 *
+	 *  \return TRUE if successful
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_network_estimate_add_rtt(rdpContext* context, UINT32 rtt);
+
+	/** \brief Adds the time between sending a frame and its acknowledgement to the estimate.
+	 *
+	 *  Encoders call this for RDPGFX or surface frame acknowledgements, the latency includes
+	 *  the decoding time of the peer and is kept apart from the round-trip time.
+	 *
+	 *  \param context The RDP context
+	 *  \param latency The latency in milliseconds
+	 *
+	 *  \return TRUE if successful
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_network_estimate_add_frame_latency(rdpContext* context,
+	                                                            UINT32 latency);
+
 #ifdef __cplusplus
 }
 #endif
@@ -81,6 +81,19 @@ extern "C"
 
 	FREERDP_API int persistent_cache_read_entry(rdpPersistentCache* persistent,
 	                                            PERSISTENT_CACHE_ENTRY* entry);
+	/** @brief Read the next entry without its bitmap data
+	 *
+	 *  Same as \b persistent_cache_read_entry but the bitmap data is skipped and
+	 *  \b entry->data set to \b NULL. Use this if only the cache keys are required.
+	 *
+	 *  @param persistent The persistent cache opened for reading
+	 *  @param entry The entry to fill
+	 *
+	 *  @return 1 for success, a value < 1 otherwise
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API int persistent_cache_read_key(rdpPersistentCache* persistent,
+	                                          PERSISTENT_CACHE_ENTRY* entry);
 	FREERDP_API int persistent_cache_write_entry(rdpPersistentCache* persistent,
 	                                             const PERSISTENT_CACHE_ENTRY* entry);
 
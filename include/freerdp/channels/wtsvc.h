@@ -38,6 +38,7 @@
 #include <winpr/winpr.h>
 #include <winpr/wtypes.h>
 #include <winpr/wtsapi.h>
+#include <winpr/stream.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -91,6 +92,22 @@ extern "C"
 
 	FREERDP_API UINT32 WTSChannelGetIdByHandle(HANDLE hChannelHandle);
 
+	/** \brief Writes the data of a stream to a channel without copying it.
+	 *
+	 *  The data written is everything up to the current stream position. The function takes
+	 *  ownership of the stream in any case, it is released with \b Stream_Release if it was
+	 *  taken from a \b wStreamPool and freed with \b Stream_Free otherwise. The stream must
+	 *  not be accessed after the call. As it is queued until sent, a pool the stream was
+	 *  taken from must outlive the channel manager.
+	 *
+	 *  \param hChannelHandle The channel handle to write to
+	 *  \param s The stream to send
+	 *
+	 *  \return \b TRUE for success, \b FALSE otherwise
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API BOOL WTSVirtualChannelWriteStream(HANDLE hChannelHandle, wStream* s);
+
 #ifdef __cplusplus
 }
 #endif
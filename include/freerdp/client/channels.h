@@ -65,6 +65,8 @@ extern "C"
 		size_t channelCallbackSize;
 		const IWTSVirtualChannelCallback* channel_callbacks;
 		DYNVC_PLUGIN_TERMINATE_FN terminatePluginFn;
+		/** DVC_LISTENER_FLAG_* passed to CreateListener @since version 3.9.0 */
+		UINT32 listenerFlags;
 	};
 
 #if defined(WITH_CHANNELS)
@@ -103,6 +103,47 @@ extern "C"
 	typedef UINT (*pcRdpgfxUpdateSurfaceArea)(RdpgfxClientContext* context, UINT16 surfaceId,
 	                                          UINT32 nrRects, const RECTANGLE_16* rects);
 
+	/** @since version 3.9.0 */
+	typedef struct
+	{
+		UINT16 surfaceId;
+		UINT32 width;
+		UINT32 height;
+		/* I420 planes of the decoded frame, the chroma planes are subsampled by 2 */
+		const BYTE* pYUVData[3];
+		UINT32 iStride[3];
+		UINT32 numRegionRects;
+		const RECTANGLE_16* regionRects;
+		/* With FreeRDP_GfxH264DmaBuf a hardware frame might stay on the GPU, the planes are NULL
+		 * then */
+		const H264_DMABUF_FRAME* dmabuf;
+		/* The decoder presented the frame on the window of GetOutputWindow, the planes are NULL
+		 * then */
+		BOOL rendered;
+	} RDPGFX_YUV_FRAME;
+
+	/**
+	 * @brief Hands out a decoded AVC420 frame before it is converted to RGB
+	 *
+	 * The planes are only valid during the call. If the callback returns CHANNEL_RC_OK the
+	 * frontend presented the regions itself, the RGB data of the surface is then not updated
+	 * and the regions are not invalidated. Any other return value lets the frame take the
+	 * regular path.
+	 *
+	 * @since version 3.9.0
+	 */
+	/**
+	 * @brief Queried once for every surface decoding AVC420, a frontend implementing
+	 * UpdateSurfaceYUV might return a native window (ANativeWindow on Android) the decoder
+	 * presents the frames of the surface on. NULL keeps decoding to memory.
+	 *
+	 * @since version 3.9.0
+	 */
+	typedef void* (*pcRdpgfxGetOutputWindow)(RdpgfxClientContext* context, UINT16 surfaceId);
+
+	typedef UINT (*pcRdpgfxUpdateSurfaceYUV)(RdpgfxClientContext* context,
+	                                         const RDPGFX_YUV_FRAME* frame);
+
 	typedef UINT (*pcRdpgfxOnOpen)(RdpgfxClientContext* context, BOOL* do_caps_advertise,
 	                               BOOL* do_frame_acks);
 	typedef UINT (*pcRdpgfxOnClose)(RdpgfxClientContext* context);
@@ -175,6 +216,10 @@ extern "C"
 		CRITICAL_SECTION mux;
 		rdpCodecs* codecs;
 		PROFILER_DEFINE(SurfaceProfiler)
+
+		/* No locking required, the surface is locked for the call */
+		pcRdpgfxUpdateSurfaceYUV UpdateSurfaceYUV; /** @since version 3.9.0 */
+		pcRdpgfxGetOutputWindow GetOutputWindow;   /** @since version 3.9.0 */
 	};
 
 	FREERDP_API void rdpgfx_client_context_free(RdpgfxClientContext* context);
@@ -36,4 +36,10 @@
 #define L1_COMPRESSED 0x01
 #define L1_INNER_COMPRESSION 0x10
 
+/* Compressor effort, FreeRDP_CompressionEffort */
+
+#define BULK_COMPRESSION_EFFORT_NORMAL 0
+#define BULK_COMPRESSION_EFFORT_FAST 1
+#define BULK_COMPRESSION_EFFORT_MAX 2
+
 #endif /* FREERDP_CODEC_BULK_H */
@@ -38,6 +38,27 @@ extern "C"
 	                               BYTE** WINPR_RESTRICT ppDstData,
 	                               UINT32* WINPR_RESTRICT pDstSize);
 
+	/** @brief Encode a bitmap as ClearCodec bitmap stream
+	 *
+	 *  Small bitmaps are added to the glyph cache, repeated ones are sent as glyph hits.
+	 *  The context must be created as compressor, its caches mirror the decoder side.
+	 *
+	 *  @param clear The compressor context
+	 *  @param s The stream to append the encoded data to
+	 *  @param pSrcData The bitmap to encode
+	 *  @param SrcFormat The color format of pSrcData
+	 *  @param nSrcStep The line length of pSrcData in bytes
+	 *  @param nWidth The width of the bitmap in pixels
+	 *  @param nHeight The height of the bitmap in pixels
+	 *
+	 *  @return TRUE for success, FALSE otherwise
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL clear_compress_to_stream(CLEAR_CONTEXT* WINPR_RESTRICT clear,
+	                                          wStream* WINPR_RESTRICT s,
+	                                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+	                                          UINT32 nSrcStep, UINT32 nWidth, UINT32 nHeight);
+
 	FREERDP_API INT32 clear_decompress(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 	                                   const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
 	                                   UINT32 nWidth, UINT32 nHeight, BYTE* WINPR_RESTRICT pDstData,
@@ -52,6 +73,14 @@ extern "C"
 	WINPR_ATTR_MALLOC(clear_context_free, 1)
 	FREERDP_API CLEAR_CONTEXT* clear_context_new(BOOL Compressor);
 
+	/** \brief Create a ClearCodec context that writes large band payloads on a thread pool
+	 *
+	 *  @param ThreadingFlags \b THREADING_FLAGS_DISABLE_THREADS to decode serially
+	 *  @since version 3.9.0
+	 */
+	WINPR_ATTR_MALLOC(clear_context_free, 1)
+	FREERDP_API CLEAR_CONTEXT* clear_context_new_ex(BOOL Compressor, UINT32 ThreadingFlags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -52,6 +52,14 @@ extern "C"
 	                                           const AUDIO_FORMAT* WINPR_RESTRICT targetFormat,
 	                                           UINT32 FramesPerPacket);
 
+	/** \brief Set the bitrate (bits per second) and complexity (0-10) of lossy encoders.
+	 *  Applied by the next freerdp_dsp_context_reset, 0 keeps the codec default.
+	 *
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_dsp_context_set_encoder_params(FREERDP_DSP_CONTEXT* context,
+	                                                        UINT32 bitrate, UINT32 complexity);
+
 #ifdef __cplusplus
 }
 #endif
@@ -61,8 +61,33 @@ extern "C"
 		H264_CONTEXT_OPTION_FRAMERATE,
 		H264_CONTEXT_OPTION_QP,
 		H264_CONTEXT_OPTION_USAGETYPE, /** @since version 3.6.0 */
+		H264_CONTEXT_OPTION_ROI,       /** @since version 3.9.0 */
+		H264_CONTEXT_OPTION_HW_FRAME_EXPORT, /** @since version 3.9.0 */
 	} H264_CONTEXT_OPTION;
 
+	/** @since version 3.9.0 */
+#define H264_DMABUF_MAX_PLANES 4
+
+	/**
+	 * @brief A decoded hardware frame exported as DMA-BUF
+	 *
+	 * The planes can be imported with EGL_EXT_image_dma_buf_import or linux-dmabuf. The file
+	 * descriptors belong to the decoder, import them while the frame is valid.
+	 *
+	 * @since version 3.9.0
+	 */
+	typedef struct
+	{
+		UINT32 width;
+		UINT32 height;
+		UINT32 fourcc; /* DRM_FORMAT_* of the frame, usually NV12 */
+		UINT32 numPlanes;
+		int fd[H264_DMABUF_MAX_PLANES];
+		UINT32 offset[H264_DMABUF_MAX_PLANES];
+		UINT32 pitch[H264_DMABUF_MAX_PLANES];
+		UINT64 modifier[H264_DMABUF_MAX_PLANES];
+	} H264_DMABUF_FRAME;
+
 	FREERDP_API void free_h264_metablock(RDPGFX_H264_METABLOCK* meta);
 
 	FREERDP_API BOOL h264_context_set_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option,
@@ -99,11 +124,105 @@ extern "C"
 	 */
 	FREERDP_API INT32 h264_compress(H264_CONTEXT* h264, BYTE** ppDstData, UINT32* pDstSize);
 
+	/**
+	 * @brief Compress the YUV I420 buffer filled by the user to a AVC420 stream
+	 *
+	 * Like \b avc420_compress but without the RGB to YUV conversion. The buffer must be
+	 * obtained with \b h264_get_yuv_buffer before every call and filled with the complete
+	 * image, as the encoder alternates between two buffers to detect changed regions.
+	 *
+	 * @param h264 The H264 context to use for compression
+	 * @param regionRect The region of the image to consider for change detection
+	 * @param ppDstData A pointer that will hold the allocated result buffer
+	 * @param pDstSize A pointer for the destination buffer size in bytes
+	 * @param meta The metablock filled with the changed regions
+	 * @return \b >0 for new data, \b 0 for no changes, \b <0 for an error
+	 * @since version 3.9.0
+	 */
+	FREERDP_API INT32 avc420_compress_yuv(H264_CONTEXT* h264, const RECTANGLE_16* regionRect,
+	                                      BYTE** ppDstData, UINT32* pDstSize,
+	                                      RDPGFX_H264_METABLOCK* meta);
+
 	FREERDP_API INT32 avc420_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize,
 	                                    BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep,
 	                                    UINT32 nDstWidth, UINT32 nDstHeight,
 	                                    const RECTANGLE_16* regionRects, UINT32 numRegionRect);
 
+	/**
+	 * @brief Decode an AVC420 stream without converting the result to RGB
+	 *
+	 * The planes belong to the decoder and stay valid until the next decode call on the context.
+	 *
+	 * @param h264 The H264 context to use for decompression
+	 * @param pSrcData The AVC420 stream
+	 * @param SrcSize The size of the stream in bytes
+	 * @param pYUVData A pointer to hold the I420 planes of the decoded frame
+	 * @param iStride A pointer to hold the byte length of a line of each plane
+	 * @return \b >0 for a new frame, \b 0 if the decoder did not output a frame, \b <0 for an
+	 * error
+	 * @since version 3.9.0
+	 */
+	FREERDP_API INT32 avc420_decompress_yuv(H264_CONTEXT* h264, const BYTE* pSrcData,
+	                                        UINT32 SrcSize, const BYTE* pYUVData[3],
+	                                        UINT32 iStride[3]);
+
+	/**
+	 * @brief Convert the regions of the frame decoded by \b avc420_decompress_yuv to RGB
+	 *
+	 * @param h264 The H264 context used for decompression
+	 * @param pDstData The destination image
+	 * @param DstFormat The pixel format of the destination image
+	 * @param nDstStep The byte length of a line of the destination image
+	 * @param regionRects The regions to convert
+	 * @param numRegionRects The number of regions
+	 * @return \b TRUE for success, \b FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL avc420_convert_yuv(H264_CONTEXT* h264, BYTE* pDstData, DWORD DstFormat,
+	                                    UINT32 nDstStep, const RECTANGLE_16* regionRects,
+	                                    UINT32 numRegionRects);
+
+	/**
+	 * @brief Get the frame decoded by \b avc420_decompress_yuv as DMA-BUF
+	 *
+	 * With \b H264_CONTEXT_OPTION_HW_FRAME_EXPORT enabled, a decoder that supports it leaves
+	 * hardware frames on the GPU. \b avc420_decompress_yuv then returns no planes and the frame
+	 * is only downloaded if \b avc420_convert_yuv is called. The frame stays valid until the next
+	 * decode call on the context.
+	 *
+	 * @param h264 The H264 context used for decompression
+	 * @param frame A pointer to hold the exported frame
+	 * @return \b TRUE if the last frame was exported, \b FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL h264_get_dmabuf_frame(H264_CONTEXT* h264, H264_DMABUF_FRAME* frame);
+
+	/**
+	 * @brief Set a window the decoder presents AVC420 frames on
+	 *
+	 * A decoder that supports it (MediaCodec with an \b ANativeWindow) renders the frames of
+	 * \b avc420_decompress_yuv straight to the window, without a copy to system memory.
+	 * \b avc420_decompress_yuv then returns no planes and \b h264_get_frame_rendered reports
+	 * the frame, it can not be converted with \b avc420_convert_yuv. Other decoders ignore the
+	 * window. The window must stay valid while it is set.
+	 *
+	 * @param h264 The H264 context used for decompression
+	 * @param window The native window or \b NULL to decode to memory again
+	 * @return \b TRUE for success, \b FALSE for an encoder context
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL h264_context_set_output_window(H264_CONTEXT* h264, void* window);
+
+	/**
+	 * @brief Check if the frame of the last \b avc420_decompress_yuv call was rendered to the
+	 * window of \b h264_context_set_output_window
+	 *
+	 * @param h264 The H264 context used for decompression
+	 * @return \b TRUE if the frame was rendered, \b FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL h264_get_frame_rendered(H264_CONTEXT* h264);
+
 	FREERDP_API INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 	                                  UINT32 nSrcStep, UINT32 nSrcWidth, UINT32 nSrcHeight,
 	                                  BYTE version, const RECTANGLE_16* regionRect, BYTE* op,
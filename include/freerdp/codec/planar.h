@@ -51,6 +51,30 @@ extern "C"
 	                                                 BYTE* WINPR_RESTRICT dstData,
 	                                                 UINT32* WINPR_RESTRICT pDstSize);
 
+	/** \brief Compress several rectangles of one image, each into its own planar bitstream
+	 *
+	 *  The rectangles are split among the thread pool of a context created with
+	 *  \b freerdp_bitmap_planar_context_new_ex, each thread using its own scratch planes.
+	 *  Like \b freerdp_bitmap_compress_planar a \b NULL entry in \b dstData is allocated and
+	 *  must be freed by the caller, a preset entry must be large enough for the result.
+	 *
+	 *  @param context The planar context, rectangles must not exceed its size
+	 *  @param data The image the rectangles refer to
+	 *  @param format The pixel format of \b data
+	 *  @param scanline The line stride of \b data in bytes
+	 *  @param rects The rectangles to compress
+	 *  @param count The number of entries in \b rects, \b dstData and \b dstSizes
+	 *  @param dstData The compressed bitstream of each rectangle
+	 *  @param dstSizes The size of each compressed bitstream
+	 *
+	 *  @return \b TRUE if all rectangles were compressed
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_bitmap_compress_planar_batch(
+	    BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT data,
+	    UINT32 format, UINT32 scanline, const RECTANGLE_16* WINPR_RESTRICT rects, size_t count,
+	    BYTE* dstData[], UINT32 dstSizes[]);
+
 	FREERDP_API BOOL freerdp_bitmap_planar_context_reset(
 	    BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context, UINT32 width, UINT32 height);
 
@@ -60,6 +84,19 @@ extern "C"
 	FREERDP_API BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new(DWORD flags, UINT32 width,
 	                                                                     UINT32 height);
 
+	/** \brief Create a planar context that can encode batches on a thread pool
+	 *
+	 *  Large RLE bitmaps have their color planes decoded concurrently as well.
+	 *
+	 *  @param ThreadingFlags \b THREADING_FLAGS_DISABLE_THREADS to encode and decode serially
+	 *  @since version 3.9.0
+	 */
+	WINPR_ATTR_MALLOC(freerdp_bitmap_planar_context_free, 1)
+	FREERDP_API BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new_ex(DWORD flags,
+	                                                                        UINT32 width,
+	                                                                        UINT32 height,
+	                                                                        UINT32 ThreadingFlags);
+
 	FREERDP_API void freerdp_planar_switch_bgr(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 	                                           BOOL bgr);
 	FREERDP_API void freerdp_planar_topdown_image(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
@@ -82,6 +82,32 @@ extern "C"
 	FREERDP_API BOOL progressive_rfx_write_message_progressive_simple(
 	    PROGRESSIVE_CONTEXT* progressive, wStream* s, const RFX_MESSAGE* msg);
 
+	/** Set the number of quality passes used by \b progressive_compress
+	 *
+	 *  With a single pass (the default) every tile is sent at full quality.
+	 *  With more passes tiles are first sent at reduced quality and refined by
+	 *  upgrade passes, one per call to \b progressive_compress with an empty
+	 *  invalid region.
+	 *
+	 *  @param progressive The progressive codec context
+	 *  @param passes The number of passes, 1 to 4
+	 *
+	 *  @since version 3.9.0
+	 *  @return \b TRUE in case of success, \b FALSE for any error
+	 */
+	FREERDP_API BOOL progressive_context_set_passes(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+	                                                UINT32 passes);
+
+	/** Get the number of tiles still waiting for an upgrade pass
+	 *
+	 *  @param progressive The progressive codec context
+	 *
+	 *  @since version 3.9.0
+	 *  @return The number of tiles not yet sent at full quality
+	 */
+	FREERDP_API UINT32
+	progressive_context_get_pending_upgrades(const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive);
+
 #ifdef __cplusplus
 }
 #endif
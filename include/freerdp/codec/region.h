@@ -120,6 +120,19 @@ extern "C"
 	FREERDP_API BOOL region16_union_rect(REGION16* dst, const REGION16* src,
 	                                     const RECTANGLE_16* rect);
 
+	/** adds several rectangles to src and stores the resulting region in dst.
+	 * The region is built in a single sweep, which is much cheaper than calling
+	 * region16_union_rect() for each rectangle of a large set (e.g. dirty tiles).
+	 * @param dst destination region
+	 * @param src source region
+	 * @param rects the rectangles to add
+	 * @param count the number of rectangles
+	 * @return if the operation was successful (false meaning out-of-memory)
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL region16_union_rects(REGION16* dst, const REGION16* src,
+	                                      const RECTANGLE_16* rects, UINT32 count);
+
 	/** returns if a rectangle intersects the region
 	 * @param src the region
 	 * @param arg2 the rectangle
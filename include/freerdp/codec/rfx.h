@@ -161,6 +161,23 @@ extern "C"
 
 	FREERDP_API UINT32 rfx_context_get_frame_idx(const RFX_CONTEXT* WINPR_RESTRICT context);
 
+	/** Enables content adaptive quantization of an encoder context.
+	 *
+	 *  Every tile is classified as flat, text or photographic content and quantized with a
+	 *  table of its own. Text and edges stay sharp while the rest is quantized coarser.
+	 *  The messages of the context reference its quantization tables, change this only
+	 *  before encoding or after all messages were freed.
+	 *
+	 *  @param context The RFX encoder context
+	 *  @param enable \b TRUE to enable, \b FALSE for a single table for all tiles
+	 *
+	 *  @since version 3.9.0
+	 *
+	 *  @return \b TRUE for success, \b FALSE for a decoder context
+	 */
+	FREERDP_API BOOL rfx_context_set_adaptive_quantization(RFX_CONTEXT* WINPR_RESTRICT context,
+	                                                       BOOL enable);
+
 	/** Write a RFX message as simple progressive message to a stream.
 	 *
 	 *  @param rfx The RFX codec context
@@ -54,6 +54,16 @@ extern "C"
 
 	FREERDP_API void zgfx_context_reset(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, BOOL flush);
 
+	/** @brief Set the compressor effort level
+	 *
+	 *  @param zgfx The context to configure, must be a compressor context
+	 *  @param CompressionLevel 0 sends segments uncompressed, 1 (fastest) to 9 (smallest)
+	 *
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API void zgfx_context_set_compression_level(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+	                                                    DWORD CompressionLevel);
+
 	FREERDP_API void zgfx_context_free(ZGFX_CONTEXT* zgfx);
 
 	WINPR_ATTR_MALLOC(zgfx_context_free, 1)
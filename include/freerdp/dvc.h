@@ -62,6 +62,15 @@ extern "C"
 {
 #endif
 
+/** @brief IWTSVirtualChannelManager::CreateListener flag: deliver the data of the channels
+ *  created by this listener on a worker thread of their own instead of the drdynvc thread, so a
+ *  slow channel does not delay the others. OnOpen and OnClose are still called from the drdynvc
+ *  thread, OnClose only after all data received before was delivered. Ignored with
+ *  FreeRDP_SynchronousDynamicChannels.
+ *  @since version 3.9.0
+ */
+#define DVC_LISTENER_FLAG_OWN_THREAD 0x80000000
+
 	typedef struct s_IWTSVirtualChannelManager IWTSVirtualChannelManager;
 	typedef struct s_IWTSListener IWTSListener;
 	typedef struct s_IWTSVirtualChannel IWTSVirtualChannel;
@@ -695,6 +695,27 @@ owned by rdpRdp */
 	FREERDP_API SECURITY_STATUS freerdp_nla_QueryContextAttributes(rdpContext* context,
 	                                                               DWORD ulAttr, PVOID pBuffer);
 
+	/** Checks if a multitransport UDP tunnel of the given type is established
+	 *
+	 *	\param context the RDP context
+	 *	\param tunnelType the tunnel type, TUNNELTYPE_UDPFECR or TUNNELTYPE_UDPFECL
+	 *	\returns TRUE if the tunnel can carry dynamic channel data
+	 *	\since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_multitransport_has_tunnel(rdpContext* context, UINT32 tunnelType);
+
+	/** Queues a dynamic channel PDU for sending through a multitransport UDP tunnel
+	 *
+	 *	\param context the RDP context
+	 *	\param tunnelType the tunnel type, TUNNELTYPE_UDPFECR or TUNNELTYPE_UDPFECL
+	 *	\param data the drdynvc PDU
+	 *	\param length the length of data in bytes
+	 *	\returns if the PDU was queued
+	 *	\since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_multitransport_send_dvc(rdpContext* context, UINT32 tunnelType,
+	                                                 const BYTE* data, size_t length);
+
 	FREERDP_API void clearChannelError(rdpContext* context);
 	FREERDP_API HANDLE getChannelErrorEventHandle(rdpContext* context);
 	FREERDP_API UINT getChannelError(rdpContext* context);
@@ -731,6 +752,66 @@ owned by rdpRdp */
 	 */
 	FREERDP_API BOOL freerdp_is_active_state(const rdpContext* context);
 
+	/** \brief A timed step of the connection sequence
+	 *  \since version 3.9.0
+	 */
+	typedef enum
+	{
+		FREERDP_CONNECTION_TRACE_STATE, /**< time spent in a \b CONNECTION_STATE */
+		FREERDP_CONNECTION_TRACE_PHASE, /**< a span inside of a state, e.g. a NLA round trip */
+		FREERDP_CONNECTION_TRACE_MARK   /**< a point in time, e.g. the first graphics update */
+	} FREERDP_CONNECTION_TRACE_TYPE;
+
+	typedef struct
+	{
+		FREERDP_CONNECTION_TRACE_TYPE type;
+		char name[64];
+		UINT64 start;    /**< ns since the connection was started */
+		UINT64 duration; /**< ns, 0 for marks */
+		BOOL complete;   /**< FALSE if the step did not end (yet) */
+	} rdpConnectionTraceEvent;
+
+	/** \brief returns the number of steps recorded for the current connection
+	 *
+	 *  \param context A pointer to the context to query
+	 *
+	 *  \return The number of steps that can be queried with \b freerdp_connection_trace_get
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API size_t freerdp_connection_trace_count(rdpContext* context);
+
+	/** \brief returns a step recorded for the current connection, in the order they started
+	 *
+	 *  \param context A pointer to the context to query
+	 *  \param index The index of the step, less than \b freerdp_connection_trace_count
+	 *  \param event A pointer to the step to fill in
+	 *
+	 *  \return \b TRUE for success, \b FALSE otherwise
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_connection_trace_get(rdpContext* context, size_t index,
+	                                              rdpConnectionTraceEvent* event);
+
+	/** \brief records a point in time of the connection sequence
+	 *
+	 *  \param context A pointer to the context to record to
+	 *  \param name The name of the mark, truncated to the size of \b rdpConnectionTraceEvent
+	 *
+	 *  \return \b TRUE for success, \b FALSE otherwise
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_connection_trace_mark(rdpContext* context, const char* name);
+
+	/** \brief notifies the trace about a graphics update.
+	 *
+	 *  The first call after a connection was established completes the trace of the connection
+	 *  sequence and reports it, later calls do nothing.
+	 *
+	 *  \param context A pointer to the context that received the update
+	 *  \since version 3.9.0
+	 */
+	FREERDP_API void freerdp_connection_trace_graphics_update(rdpContext* context);
+
 	FREERDP_API BOOL freerdp_channels_from_mcs(rdpSettings* settings, const rdpContext* context);
 
 	FREERDP_API BOOL freerdp_is_valid_mcs_create_request(const BYTE* data, size_t size);
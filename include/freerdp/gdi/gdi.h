@@ -452,6 +452,7 @@ extern "C"
 		INT32 ninvalid;
 		HGDI_RGN invalid;
 		HGDI_RGN cinvalid;
+		REGION16* region; /** @since version 3.9.0 */
 	} GDI_WND;
 	typedef GDI_WND* HGDI_WND;
 
@@ -49,6 +49,11 @@ extern "C"
 		UINT32 outputTargetHeight;
 		BOOL windowMapped;
 		BOOL handleInUpdateSurfaceArea;
+		/* The buffer of the surface while data is the primary buffer of the gdi
+		 * (FreeRDP_GfxZeroCopyOutput) */
+		BYTE* ownData; /** @since version 3.9.0 */
+		/* Cache entries still referencing an area of this surface instead of a copy */
+		struct gdi_gfx_cache_entry* cacheRefs; /** @since version 3.9.0 */
 	};
 	typedef struct gdi_gfx_surface gdiGfxSurface;
 
@@ -60,6 +65,12 @@ extern "C"
 		BYTE* data;
 		UINT32 scanline;
 		UINT32 format;
+		/* While source is set data is NULL and the entry is the sourceRect of that surface,
+		 * the copy is only made before the area is modified */
+		gdiGfxSurface* source;               /** @since version 3.9.0 */
+		RECTANGLE_16 sourceRect;             /** @since version 3.9.0 */
+		struct gdi_gfx_cache_entry* prevRef; /** @since version 3.9.0 */
+		struct gdi_gfx_cache_entry* nextRef; /** @since version 3.9.0 */
 	};
 	typedef struct gdi_gfx_cache_entry gdiGfxCacheEntry;
 
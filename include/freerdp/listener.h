@@ -76,6 +76,70 @@ extern "C"
 
 	FREERDP_API void freerdp_listener_free(freerdp_listener* instance);
 
+	/**
+	 * @brief freerdp_listener_set_accept_threads Accepts connections on multiple threads
+	 *
+	 * Must be called before opening the listener. Every TCP address is bound \b count times
+	 * with SO_REUSEPORT so the kernel balances new connections between the sockets, and every
+	 * listening socket is served by its own thread. PeerAccepted is then called concurrently
+	 * from these threads, GetEventHandles only returns an event that is set when an accept
+	 * thread failed, and CheckFileDescriptor reports that failure.
+	 *
+	 * @param instance The listener to configure. Must NOT be NULL.
+	 * @param count The number of sockets per address, 0 or 1 accepts on the caller thread.
+	 * @return TRUE for success, FALSE if the count is not supported
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_listener_set_accept_threads(freerdp_listener* instance,
+	                                                     UINT32 count);
+
+	/**
+	 * @brief freerdp_listener_set_handshake_limits Bounds the TLS handshakes of accepted peers
+	 *
+	 * At most \b concurrent peers of this listener run the TLS handshake at the same time,
+	 * up to \b queued more wait for a slot and any further peer is disconnected right away.
+	 * Must be called before opening the listener.
+	 *
+	 * @param instance The listener to configure. Must NOT be NULL.
+	 * @param concurrent The number of parallel handshakes, 0 for no limit
+	 * @param queued The number of peers allowed to wait for a handshake slot
+	 * @return TRUE for success, FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_listener_set_handshake_limits(freerdp_listener* instance,
+	                                                       UINT32 concurrent, UINT32 queued);
+
+	/**
+	 * @brief freerdp_listener_set_tls_session_tickets Issues TLS session tickets to peers
+	 *
+	 * The ticket keys are shared by all peers of the listener, so reconnecting clients can
+	 * resume their TLS session instead of doing a full handshake. Must be called before
+	 * opening the listener.
+	 *
+	 * @param instance The listener to configure. Must NOT be NULL.
+	 * @param enable TRUE to issue resumable tickets
+	 * @return TRUE for success, FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_listener_set_tls_session_tickets(freerdp_listener* instance,
+	                                                          BOOL enable);
+
+	/**
+	 * @brief freerdp_listener_set_tls_ecdsa_certificate Offers an ECDSA certificate for TLS
+	 *
+	 * The certificate is used in addition to the RSA certificate of the peer settings and
+	 * preferred for clients that support it. Must be called before opening the listener.
+	 *
+	 * @param instance The listener to configure. Must NOT be NULL.
+	 * @param certfile The PEM certificate file, NULL to remove a configured certificate
+	 * @param keyfile The PEM ECDSA private key file, NULL to remove a configured certificate
+	 * @return TRUE for success, FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL freerdp_listener_set_tls_ecdsa_certificate(freerdp_listener* instance,
+	                                                            const char* certfile,
+	                                                            const char* keyfile);
+
 	WINPR_ATTR_MALLOC(freerdp_listener_free, 1)
 	FREERDP_API freerdp_listener* freerdp_listener_new(void);
 
@@ -21,6 +21,7 @@
 #define FREERDP_METRICS_H
 
 #include <freerdp/api.h>
+#include <freerdp/types.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -37,9 +38,109 @@ extern "C"
 	};
 	typedef struct rdp_metrics rdpMetrics;
 
+/** @since version 3.9.0 */
+#define FREERDP_METRICS_MAX_CHANNELS 32
+/** @since version 3.9.0 */
+#define FREERDP_METRICS_PDU_TYPES 16
+/** @since version 3.9.0 */
+#define FREERDP_METRICS_CODECS 16
+/** @since version 3.9.0 */
+#define FREERDP_METRICS_BULK_TYPES 5
+/** @since version 3.9.0 */
+#define FREERDP_METRICS_HISTOGRAM_BUCKETS 16
+
+	/** @since version 3.9.0 */
+	typedef struct
+	{
+		UINT64 Count;
+		UINT64 Bytes;
+	} rdpMetricsCounter;
+
+	/** @brief Duration histogram, bucket n counts samples below (16 << n) microseconds, the
+	 * last bucket everything above.
+	 *  @since version 3.9.0
+	 */
+	typedef struct
+	{
+		UINT64 Count;
+		UINT64 TotalUs;
+		UINT64 MaxUs;
+		UINT64 Buckets[FREERDP_METRICS_HISTOGRAM_BUCKETS];
+	} rdpMetricsHistogram;
+
+	/** @since version 3.9.0 */
+	typedef struct
+	{
+		UINT16 ChannelId;
+		char Name[8];
+		rdpMetricsCounter In;
+		rdpMetricsCounter Out;
+	} rdpMetricsChannel;
+
+	/** @since version 3.9.0 */
+	typedef struct
+	{
+		UINT64 CompressedBytes;
+		UINT64 UncompressedBytes;
+	} rdpMetricsBulk;
+
+	/** @brief A snapshot of the session statistics.
+	 *
+	 *  FastpathUpdates is indexed by FASTPATH_UPDATETYPE_*, Decode and Encode by
+	 *  RDPGFX_CODECID_* and the bulk counters by PACKET_COMPR_TYPE_*.
+	 *  @since version 3.9.0
+	 */
+	typedef struct
+	{
+		UINT32 ChannelCount;
+		rdpMetricsChannel Channels[FREERDP_METRICS_MAX_CHANNELS];
+		rdpMetricsCounter FastpathUpdates[FREERDP_METRICS_PDU_TYPES];
+		rdpMetricsHistogram Decode[FREERDP_METRICS_CODECS];
+		rdpMetricsHistogram Encode[FREERDP_METRICS_CODECS];
+		rdpMetricsHistogram FrameAck;
+		rdpMetricsBulk BulkCompress[FREERDP_METRICS_BULK_TYPES];
+		rdpMetricsBulk BulkDecompress[FREERDP_METRICS_BULK_TYPES];
+	} rdpMetricsStats;
+
 	FREERDP_API double metrics_write_bytes(rdpMetrics* metrics, UINT32 UncompressedBytes,
 	                                       UINT32 CompressedBytes);
 
+	/** @brief Account bulk (de)compressed data per compression type
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API void metrics_write_bulk_bytes(rdpMetrics* metrics, UINT32 type, BOOL compress,
+	                                          UINT32 UncompressedBytes, UINT32 CompressedBytes);
+
+	/** @brief Account virtual channel traffic, the name is optional
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API void metrics_channel_bytes(rdpMetrics* metrics, UINT16 channelId,
+	                                       const char* name, size_t inBytes, size_t outBytes);
+
+	/** @since version 3.9.0 */
+	FREERDP_API void metrics_fastpath_update(rdpMetrics* metrics, BYTE updateCode, size_t bytes);
+
+	/** @brief Account the time spent decoding a surface command with the given codec
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API void metrics_codec_decode(rdpMetrics* metrics, UINT16 codecId, UINT64 durationNs);
+
+	/** @since version 3.9.0 */
+	FREERDP_API void metrics_codec_encode(rdpMetrics* metrics, UINT16 codecId, UINT64 durationNs);
+
+	/** @brief Account the time between sending an end frame PDU and its acknowledge
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API void metrics_frame_ack(rdpMetrics* metrics, UINT64 rttNs);
+
+	/** @brief Copy the current statistics, safe to call from any thread
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL metrics_get_stats(rdpMetrics* metrics, rdpMetricsStats* stats);
+
+	/** @since version 3.9.0 */
+	FREERDP_API void metrics_reset_stats(rdpMetrics* metrics);
+
 	FREERDP_API void metrics_free(rdpMetrics* metrics);
 
 	WINPR_ATTR_MALLOC(metrics_free, 1)
@@ -54,6 +54,10 @@ extern "C"
 	typedef BOOL (*psPeerIsWriteBlocked)(freerdp_peer* peer);
 	typedef int (*psPeerDrainOutputBuffer)(freerdp_peer* peer);
 	typedef BOOL (*psPeerHasMoreToRead)(freerdp_peer* peer);
+	typedef int (*psPeerGetSocket)(freerdp_peer* peer);
+	typedef int (*psPeerProcessInput)(freerdp_peer* peer, size_t maxPdus);
+	typedef int (*psPeerProcessOutput)(freerdp_peer* peer);
+	typedef BOOL (*psPeerWriteReady)(freerdp_peer* peer);
 	typedef BOOL (*psPeerClose)(freerdp_peer* peer);
 	typedef void (*psPeerDisconnect)(freerdp_peer* peer);
 	typedef BOOL (*psPeerRemoteCredentials)(freerdp_peer* peer, KERB_TICKET_LOGON* logonCreds,
@@ -193,6 +197,47 @@ extern "C"
 		 * and supplementary creds (NTLM).
 		 */
 		ALIGN64 psPeerRemoteCredentials RemoteCredentials;
+
+		/** Handshake limits and TLS options shared with the other peers of the listener that
+		 *  accepted this peer. Internal, managed by the listener.
+		 *  @since version 3.9.0 */
+		ALIGN64 void* HandshakePool;
+
+		/**
+		 * @brief GetSocket Returns the socket of the connection for registration with an
+		 * external event loop (epoll, kqueue, ...) or -1 if the transport has none.
+		 * @since version 3.9.0
+		 */
+		ALIGN64 psPeerGetSocket GetSocket;
+
+		/**
+		 * @brief ProcessInput Processes the input available without blocking, to be called
+		 * when the socket is readable. At most \b maxPdus PDUs are processed, 0 for no limit,
+		 * so a single busy peer can not starve the others served by the same thread.
+		 *
+		 * \return -1 on error, 0 if all input was consumed, 1 if the limit was reached and
+		 * there is more to process without waiting for the socket again.
+		 * @since version 3.9.0
+		 */
+		ALIGN64 psPeerProcessInput ProcessInput;
+
+		/**
+		 * @brief ProcessOutput Flushes pending output, to be called when the socket is
+		 * writable while \b IsWriteBlocked reported TRUE. Calls \b WriteReady once all output
+		 * is gone.
+		 *
+		 * \return -1 on error, 0 if the output was flushed, 1 if it is still blocked.
+		 * @since version 3.9.0
+		 */
+		ALIGN64 psPeerProcessOutput ProcessOutput;
+
+		/**
+		 * @brief WriteReady Set by the server application, called by \b ProcessOutput when
+		 * the output buffer drained so the application can resume producing output.
+		 * Returning FALSE fails the \b ProcessOutput call.
+		 * @since version 3.9.0
+		 */
+		ALIGN64 psPeerWriteReady WriteReady;
 	};
 
 	FREERDP_API void freerdp_peer_context_free(freerdp_peer* client);
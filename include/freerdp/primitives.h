@@ -190,6 +190,11 @@ typedef pstatus_t (*__YUV420CombineToYUV444_t)(avc444_frame_type type,
 	                                           UINT32 nHeight, BYTE* WINPR_RESTRICT pDst[3],
 	                                           const UINT32 dstStep[3],
 	                                           const RECTANGLE_16* WINPR_RESTRICT roi);
+typedef pstatus_t (*__YUV420CombineToRGB_8u_P3AC4R_t)(
+	avc444_frame_type type, const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
+	UINT32 nWidth, UINT32 nHeight, BYTE* WINPR_RESTRICT pYUVDst[3], const UINT32 yuvDstStep[3],
+	BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+	const RECTANGLE_16* WINPR_RESTRICT roi);
 typedef pstatus_t (*__YUV444SplitToYUV420_t)(
 	const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3], BYTE* WINPR_RESTRICT pMainDst[3],
 	const UINT32 dstMainStep[3], BYTE* WINPR_RESTRICT pAuxDst[3], const UINT32 srcAuxStep[3],
@@ -203,6 +208,31 @@ typedef pstatus_t (*__andC_32u_t)(const UINT32* WINPR_RESTRICT pSrc, UINT32 val,
 	                              UINT32* WINPR_RESTRICT pDst, INT32 len);
 typedef pstatus_t (*__orC_32u_t)(const UINT32* WINPR_RESTRICT pSrc, UINT32 val,
 	                             UINT32* WINPR_RESTRICT pDst, INT32 len);
+typedef pstatus_t (*__xorC_32u_t)(const UINT32* WINPR_RESTRICT pSrc, UINT32 val,
+	                              UINT32* WINPR_RESTRICT pDst, INT32 len);
+typedef pstatus_t (*__scale_8u_AC4R_t)(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                      const prim_size_t* WINPR_RESTRICT srcRoi,
+                                      BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                      const prim_size_t* WINPR_RESTRICT dstRoi);
+typedef pstatus_t (*__RGBToPlanes_8u_AC4P4R_t)(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                               UINT32 SrcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                               UINT32 dstStep,
+                                               const prim_size_t* WINPR_RESTRICT roi);
+typedef pstatus_t (*__PlanesToRGB_8u_P4AC4R_t)(const BYTE* WINPR_RESTRICT pSrc[4], UINT32 srcStep,
+                                               BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                               UINT32 DstFormat,
+                                               const prim_size_t* WINPR_RESTRICT roi);
+typedef pstatus_t (*__deltaSignEncode_8u_t)(const BYTE* WINPR_RESTRICT pSrc,
+                                            const BYTE* WINPR_RESTRICT pPrev,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 len);
+typedef pstatus_t (*__monoToStereo_16s_t)(const INT16* WINPR_RESTRICT pSrc,
+                                          INT16* WINPR_RESTRICT pDst, UINT32 frames);
+typedef pstatus_t (*__stereoToMono_16s_t)(const INT16* WINPR_RESTRICT pSrc,
+                                          INT16* WINPR_RESTRICT pDst, UINT32 frames);
+typedef pstatus_t (*__applyAlpha_8u_P1AC4R_t)(const BYTE* WINPR_RESTRICT pAlpha, UINT32 alphaStep,
+                                              BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                              UINT32 DstFormat,
+                                              const prim_size_t* WINPR_RESTRICT roi);
 typedef pstatus_t (*primitives_uninit_t)(void);
 
 typedef struct
@@ -256,6 +286,37 @@ typedef struct
 	__add_16s_inplace_t add_16s_inplace;         /** @since version 3.6.0 */
 	__lShiftC_16s_inplace_t lShiftC_16s_inplace; /** @since version 3.6.0 */
 	__copy_no_overlap_t copy_no_overlap;         /** @since version 3.6.0 */
+	__xorC_32u_t xorC_32u;                       /** @since version 3.9.0 */
+
+	/** \brief Combine an AVC444 luma or chroma frame into the YUV444 planes and convert the
+	 *  updated region to RGB in one go
+	 */
+	__YUV420CombineToRGB_8u_P3AC4R_t YUV420CombineToRGB_8u_P3AC4R; /** @since version 3.9.0 */
+
+	/** \brief Scale a 32bpp image, bilinear when enlarging and box filtered when shrinking.
+	 *  Channels are treated independently, so any 32bpp pixel format works as long as
+	 *  source and destination share it.
+	 */
+	__scale_8u_AC4R_t scale_8u_AC4R; /** @since version 3.9.0 */
+
+	/** \brief Split 32bpp pixels into R, G, B and A planes (in that order).
+	 *  Formats without alpha fill the A plane with 0xFF.
+	 */
+	__RGBToPlanes_8u_AC4P4R_t RGBToPlanes_8u_AC4P4R; /** @since version 3.9.0 */
+	/** \brief Merge R, G, B and A planes into 32bpp pixels.
+	 *  A \b NULL A plane writes 0xFF to the alpha (or padding) byte.
+	 */
+	__PlanesToRGB_8u_P4AC4R_t PlanesToRGB_8u_P4AC4R; /** @since version 3.9.0 */
+	/** \brief Planar codec delta encoding, pDst = sign-magnitude(pSrc - pPrev) */
+	__deltaSignEncode_8u_t deltaSignEncode_8u; /** @since version 3.9.0 */
+	/** \brief Duplicate 16bit mono samples into interleaved stereo frames */
+	__monoToStereo_16s_t monoToStereo_16s; /** @since version 3.9.0 */
+	/** \brief Mix interleaved 16bit stereo frames down to mono, averaging both channels */
+	__stereoToMono_16s_t stereoToMono_16s; /** @since version 3.9.0 */
+	/** \brief Write an alpha plane into the alpha (or trailing padding) byte of 32bpp pixels.
+	 *  Fails for formats without such a byte, the color channels are left untouched.
+	 */
+	__applyAlpha_8u_P1AC4R_t applyAlpha_8u_P1AC4R; /** @since version 3.9.0 */
 } primitives_t;
 
 typedef enum
@@ -117,6 +117,38 @@ extern "C"
 
 		/* target continued */
 		UINT32 TargetTlsSecLevel; /** @since version 3.2.0 */
+
+		/* server continued */
+		BOOL SharedSessionThread; /** @since version 3.9.0 */
+
+		/* metrics */
+		char* MetricsHost;  /** @since version 3.9.0 */
+		UINT16 MetricsPort; /** @since version 3.9.0 */
+
+		/* target continued */
+		UINT32 TargetConnectionPool; /** @since version 3.9.0 */
+
+		/* memory */
+		UINT32 SessionMemoryBudget; /** @since version 3.9.0 */
+
+		/* server continued */
+		UINT32 AcceptThreads; /** @since version 3.9.0 */
+
+		/* security continued */
+		UINT32 ServerHandshakeConcurrency; /** @since version 3.9.0 */
+		UINT32 ServerHandshakeQueue;       /** @since version 3.9.0 */
+		BOOL ServerTlsSessionTickets;      /** @since version 3.9.0 */
+
+		/* certificates continued */
+		char* EcdsaCertificateFile; /** @since version 3.9.0 */
+		char* EcdsaPrivateKeyFile;  /** @since version 3.9.0 */
+
+		/* security continued */
+		BOOL ServerTlsKernelOffload; /** @since version 3.9.0 */
+
+		/* server continued */
+		BOOL IoUring;            /** @since version 3.9.0 */
+		BOOL RoutingPassthrough; /** @since version 3.9.0 */
 	};
 
 	/**
@@ -41,6 +41,8 @@ extern "C"
 	typedef struct proxy_data proxyData;
 	typedef struct proxy_module proxyModule;
 	typedef struct p_server_static_channel_context pServerStaticChannelContext;
+	typedef struct proxy_session_metrics proxySessionMetrics; /** @since version 3.9.0 */
+	typedef struct proxy_channel_metrics proxyChannelMetrics; /** @since version 3.9.0 */
 
 	typedef struct s_InterceptContextMapEntry
 	{
@@ -67,6 +69,7 @@ extern "C"
 		proxyChannelDataFn onBackData;
 		proxyChannelContextDtor contextDtor;
 		void* context;
+		proxyChannelMetrics* metrics; /** @since version 3.9.0 */
 	};
 
 	void StaticChannelContext_free(pServerStaticChannelContext* ctx);
@@ -139,6 +142,8 @@ extern "C"
 			char* c;
 			void* v;
 		} computerName;
+
+		size_t gdi_memory; /** @since version 3.9.0 */
 	};
 
 	/**
@@ -161,11 +166,28 @@ extern "C"
 		/* used to external modules to store per-session info */
 		wHashTable* modules_info;
 		psPeerReceiveChannelData server_receive_channel_data_original;
+		proxySessionMetrics* metrics; /** @since version 3.9.0 */
+
+		/* memory accounted to the session in bytes, see proxy_data_account_memory */
+		LONGLONG memory_used; /** @since version 3.9.0 */
+		LONGLONG memory_peak; /** @since version 3.9.0 */
 	};
 
 	FREERDP_API BOOL pf_context_copy_settings(rdpSettings* dst, const rdpSettings* src);
 	FREERDP_API BOOL pf_context_init_server_context(freerdp_peer* client);
 
+	/**
+	 * @brief pf_context_init_server_context_ex Like pf_context_init_server_context, the peer
+	 * context starts from a copy of the given settings.
+	 *
+	 * @param client The peer to create the context for
+	 * @param settings The settings to start with, NULL for the defaults
+	 * @return TRUE for success, FALSE otherwise
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL pf_context_init_server_context_ex(freerdp_peer* client,
+	                                                   const rdpSettings* settings);
+
 	WINPR_ATTR_MALLOC(freerdp_client_context_free, 1)
 	FREERDP_API pClientContext* pf_context_create_client_context(const rdpSettings* clientSettings);
 
@@ -179,6 +201,27 @@ extern "C"
 	FREERDP_API BOOL proxy_data_shall_disconnect(proxyData* pdata);
 	FREERDP_API void proxy_data_abort_connect(proxyData* pdata);
 
+	/**
+	 * @brief proxy_data_account_memory Updates the memory accounted to a session
+	 *
+	 * @param pdata The session, NULL skips the accounting
+	 * @param accounted The size accounted so far for an allocation, updated to size
+	 * @param size The current size of the allocation, 0 when it is freed
+	 * @return FALSE if the allocation grew and the session now exceeds its memory budget,
+	 *         TRUE otherwise. The new size is accounted in both cases.
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL proxy_data_account_memory(proxyData* pdata, size_t* accounted, size_t size);
+
+	/**
+	 * @brief proxy_data_memory_exceeded Checks a session against its memory budget
+	 *
+	 * @param pdata The session, NULL is never over budget
+	 * @return TRUE if the session uses more memory than configured in [Memory] SessionBudget
+	 * @since version 3.9.0
+	 */
+	FREERDP_API BOOL proxy_data_memory_exceeded(const proxyData* pdata);
+
 #ifdef __cplusplus
 }
 #endif
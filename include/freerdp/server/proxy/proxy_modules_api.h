@@ -111,7 +111,19 @@ extern "C"
 		proxyFilterFn DynChannelToIntercept;    /* 138 */
 		proxyFilterFn DynChannelIntercept;      /* 139 */
 		proxyFilterFn StaticChannelToIntercept; /* 140 */
-		UINT64 reserved5[160 - 141];            /* 141-159 */
+
+		/* proxy asynchronous hooks:
+		 *
+		 * called from a per plugin worker thread with a copy of passthrough channel data
+		 * that passed all filters. The data is only valid during the call. Slow plugins
+		 * (recorders, scanners) do not delay the session, but data is dropped if the
+		 * plugin falls too far behind.
+		 *
+		 * @since version 3.9.0
+		 */
+		proxyHookFn ClientChannelDataAsync; /* 141 custom=proxyChannelDataEventInfo* */
+		proxyHookFn ServerChannelDataAsync; /* 142 custom=proxyChannelDataEventInfo* */
+		UINT64 reserved5[160 - 143];        /* 143-159 */
 
 		/* Runtime data fields */
 		proxyPluginsManager* mgr; /* 160 */ /** Set during plugin registration */
@@ -89,6 +89,8 @@ extern "C"
 	                                         const RDPGFX_FRAME_ACKNOWLEDGE_PDU* frameAcknowledge);
 	typedef UINT (*psRdpgfxQoeFrameAcknowledge)(
 	    RdpgfxServerContext* context, const RDPGFX_QOE_FRAME_ACKNOWLEDGE_PDU* qoeFrameAcknowledge);
+	typedef UINT (*psRdpgfxBeginBatch)(RdpgfxServerContext* context);
+	typedef UINT (*psRdpgfxEndBatch)(RdpgfxServerContext* context);
 
 	struct s_rdpgfx_server_context
 	{
@@ -137,6 +139,14 @@ extern "C"
 		 * Defaults to externalThread=FALSE
 		 */
 		psRdpgfxServerInitialize Initialize;
+		/**
+		 * Optional: Collect the PDUs sent between BeginBatch and EndBatch, e.g. a whole
+		 * frame, and write them as a single zgfx payload with one channel write on EndBatch.
+		 *
+		 * @since version 3.9.0
+		 */
+		psRdpgfxBeginBatch BeginBatch;
+		psRdpgfxEndBatch EndBatch;
 	};
 
 	FREERDP_API void rdpgfx_server_context_free(RdpgfxServerContext* context);
@@ -39,6 +39,7 @@
 #include <freerdp/server/rdpgfx.h>
 
 #include <freerdp/codec/color.h>
+#include <freerdp/codec/dsp.h>
 #include <freerdp/codec/region.h>
 
 #include <winpr/crt.h>
@@ -59,6 +60,9 @@ extern "C"
 	typedef struct rdp_shadow_capture rdpShadowCapture;
 	typedef struct rdp_shadow_subsystem rdpShadowSubsystem;
 	typedef struct rdp_shadow_multiclient_event rdpShadowMultiClientEvent;
+	typedef struct rdp_shadow_shared_encoder rdpShadowSharedEncoder; /** @since version 3.9.0 */
+	typedef struct rdp_shadow_surface_frames rdpShadowSurfaceFrames;  /** @since version 3.9.0 */
+	typedef struct rdp_shadow_codec_pool rdpShadowCodecPool;          /** @since version 3.9.0 */
 
 	typedef struct S_RDP_SHADOW_ENTRY_POINTS RDP_SHADOW_ENTRY_POINTS;
 	typedef int (*pfnShadowSubsystemEntry)(RDP_SHADOW_ENTRY_POINTS* pEntryPoints);
@@ -101,6 +105,47 @@ extern "C"
 	                                                          const AUDIO_FORMAT* format,
 	                                                          wStream* data);
 
+	/** Optional: write the current image of \b rect as YUV I420 directly into the given
+	 *  planes. Used instead of the RGB surface for AVC420 encoding when set.
+	 *  @since version 3.9.0
+	 */
+	typedef BOOL (*pfnShadowGetYUV420Frame)(rdpShadowSubsystem* subsystem,
+	                                        const RECTANGLE_16* rect, BYTE* pYUVData[3],
+	                                        const UINT32 stride[3]);
+
+	/** A block the capture copied within the surface, see \b shadow_surface_set_moves
+	 *  @since version 3.9.0
+	 */
+	typedef struct
+	{
+		RECTANGLE_16 src;
+		UINT16 x; /* destination left */
+		UINT16 y; /* destination top */
+	} SHADOW_SURFACE_MOVE;
+
+/** Number of per codec entries in SHADOW_CLIENT_STATS, indexed by the bit position of the
+ *  FREERDP_CODEC_* flag
+ *  @since version 3.9.0
+ */
+#define SHADOW_CLIENT_STATS_CODECS 9
+
+	/** Encoder statistics of a client, averages are moving averages in microseconds
+	 *  @since version 3.9.0
+	 */
+	typedef struct
+	{
+		char hostname[50];
+		UINT64 frames;        /* frames encoded and sent */
+		UINT64 droppedFrames; /* captured frames this client never encoded */
+		UINT64 bytes;         /* bytes written to the transport by frame updates */
+		UINT32 frameBytes;    /* average bytes per frame */
+		UINT32 captureToEncode;
+		UINT64 codecFrames[SHADOW_CLIENT_STATS_CODECS];
+		UINT32 codecEncodeTime[SHADOW_CLIENT_STATS_CODECS];
+		UINT32 inflightFrames;
+		UINT32 ackLatency; /* milliseconds */
+	} SHADOW_CLIENT_STATS;
+
 	struct rdp_shadow_client
 	{
 		rdpContext context;
@@ -136,6 +181,10 @@ extern "C"
 		UINT32 resizeWidth;
 		UINT32 resizeHeight;
 		BOOL areGfxCapsReady; /** @since version 3.3.0 */
+		BOOL captureConsumer; /** @since version 3.9.0 */
+		/** Decodes compressed microphone input for the subsystem, @since version 3.9.0 */
+		FREERDP_DSP_CONTEXT* audinDsp;
+		wStream* audinSamples; /** @since version 3.9.0 */
 	};
 
 	struct rdp_shadow_server
@@ -174,6 +223,44 @@ extern "C"
 		freerdp_listener* listener;
 
 		size_t maxClientsConnected;
+
+		/** Encode frames once for all clients using the same stateless codec
+		 *  @since version 3.9.0 */
+		BOOL shareEncoder;
+		rdpShadowSharedEncoder* sharedEncoder;
+
+		/** Switch GFX codecs and H264 bitrate according to the measured network conditions
+		 *  @since version 3.9.0 */
+		BOOL adaptiveCodec;
+
+		/** Send SolidFill and CacheToSurface instead of encoding repeated GFX tiles
+		 *  @since version 3.9.0 */
+		BOOL gfxCache;
+
+		/** Log the encoder statistics of all clients every statsInterval seconds, 0 to disable
+		 *  @since version 3.9.0 */
+		UINT32 statsInterval;
+
+		/** Resend GFX regions encoded with H264 losslessly after refineDelay ms without
+		 *  changes, 0 to disable
+		 *  @since version 3.9.0 */
+		UINT32 refineDelay;
+
+		/** Number of threads accepting connections on the listening port, 0 for the
+		 *  default single listener
+		 *  @since version 3.9.0 */
+		UINT32 acceptThreads;
+
+		/** Encode GFX frames on a separate thread per client while at most encodeDepth
+		 *  frames are unacknowledged, 0 to encode on the client thread
+		 *  @since version 3.9.0 */
+		UINT32 encodeDepth;
+
+		/** Keep up to codecPoolSize codec contexts of disconnected clients for reuse by new
+		 *  connections, 0 to disable
+		 *  @since version 3.9.0 */
+		UINT32 codecPoolSize;
+		rdpShadowCodecPool* codecPool;
 	};
 
 	struct rdp_shadow_surface
@@ -190,6 +277,8 @@ extern "C"
 
 		CRITICAL_SECTION lock;
 		REGION16 invalidRegion;
+
+		rdpShadowSurfaceFrames* frames; /** @since version 3.9.0 */
 	};
 
 	struct S_RDP_SHADOW_ENTRY_POINTS
@@ -243,6 +332,12 @@ extern "C"
 		pfnShadowClientCapabilities ClientCapabilities;
 
 		rdpShadowServer* server;
+
+		pfnShadowGetYUV420Frame GetYUV420Frame; /** @since version 3.9.0 */
+
+		/* Clients currently showing the capture, see shadow_subsystem_capture_wanted */
+		LONG captureConsumers; /** @since version 3.9.0 */
+		HANDLE captureEvent;   /** @since version 3.9.0 */
 	};
 
 /* Definition of message between subsystem and clients */
@@ -375,8 +470,73 @@ extern "C"
 	                                                   UINT32 format2, UINT32 nStep2,
 	                                                   RECTANGLE_16* WINPR_RESTRICT rect);
 
+	/** @brief Compare two framebuffer images of possibly different formats with each other
+	 *
+	 *  Like \b shadow_capture_compare_with_format but instead of the bounding rectangle the
+	 *  region covering every changed 16x16 tile is returned.
+	 *
+	 *  @param pData1  A pointer to the data of image 1
+	 *  @param format1 The format of image 1
+	 *  @param nStep1  The line width in bytes of image 1
+	 *  @param nWidth  The line width in pixels of image 1
+	 *  @param nHeight The height of image 1
+	 *  @param pData2  A pointer to the data of image 2
+	 *  @param format2 The format of image 2
+	 *  @param nStep2  The line width in bytes of image 2
+	 *  @param region A pointer to an initialized region receiving the changed tiles
+	 *
+	 *  @return \b 0 if equal, \b >0 if not equal and \b <0 for any error
+	 *
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API int shadow_capture_compare_region(const BYTE* WINPR_RESTRICT pData1,
+	                                              UINT32 format1, UINT32 nStep1, UINT32 nWidth,
+	                                              UINT32 nHeight, const BYTE* WINPR_RESTRICT pData2,
+	                                              UINT32 format2, UINT32 nStep2,
+	                                              REGION16* WINPR_RESTRICT region);
+
 	FREERDP_API void shadow_subsystem_frame_update(rdpShadowSubsystem* subsystem);
 
+	/** @brief Check if any client shows the captured screen
+	 *
+	 *  Clients that are not activated, suppress output or sit in the lobby do not.
+	 *  Subsystems should stop capturing while this returns \b FALSE and wait for the
+	 *  event returned by \b shadow_subsystem_capture_event instead.
+	 *
+	 *  @param subsystem The subsystem to check
+	 *  @return \b TRUE if the screen should be captured
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL shadow_subsystem_capture_wanted(rdpShadowSubsystem* subsystem);
+
+	/** @brief Get an event signaled while the screen should be captured
+	 *
+	 *  @param subsystem The subsystem to query
+	 *  @return A manual reset event or \b NULL
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API HANDLE shadow_subsystem_capture_event(rdpShadowSubsystem* subsystem);
+
+	/** @brief Report how the next capture changed the surface
+	 *
+	 *  The previous capture becomes the next one by applying \b moves in order and then
+	 *  updating the \b dirty rects. Encoders send the moves as copies on the client surface.
+	 *  The invalid region must still cover the move destinations and the dirty rects.
+	 *  Call before \b shadow_subsystem_frame_update, the hint is dropped if several captures
+	 *  are published as one frame.
+	 *
+	 *  @param surface The surface the capture is written to
+	 *  @param moves The moves in the order they were applied, may be \b NULL if \b numMoves is 0
+	 *  @param numMoves The number of entries in \b moves
+	 *  @param dirty The rects updated after the moves, may be \b NULL if \b numDirty is 0
+	 *  @param numDirty The number of entries in \b dirty
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL shadow_surface_set_moves(rdpShadowSurface* surface,
+	                                          const SHADOW_SURFACE_MOVE* moves, UINT32 numMoves,
+	                                          const RECTANGLE_16* dirty, UINT32 numDirty);
+
 	FREERDP_API BOOL shadow_client_post_msg(rdpShadowClient* client, void* context, UINT32 type,
 	                                        SHADOW_MSG_OUT* msg, void* lParam);
 	FREERDP_API int shadow_client_boardcast_msg(rdpShadowServer* server, void* context, UINT32 type,
@@ -386,6 +546,26 @@ extern "C"
 	FREERDP_API UINT32 shadow_encoder_preferred_fps(rdpShadowEncoder* encoder);
 	FREERDP_API UINT32 shadow_encoder_inflight_frames(rdpShadowEncoder* encoder);
 
+	/** @brief Get the encoder statistics of a client
+	 *
+	 *  @param client The client to query
+	 *  @param stats A pointer to hold the statistics
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API BOOL shadow_client_get_stats(rdpShadowClient* client, SHADOW_CLIENT_STATS* stats);
+
+	/** @brief Get the encoder statistics of all connected clients
+	 *
+	 *  @param server The server to query
+	 *  @param stats An array to hold the statistics, may be \b NULL if \b count is 0
+	 *  @param count The number of entries in \b stats
+	 *  @return The number of connected clients, entries beyond \b count are not filled
+	 *  @since version 3.9.0
+	 */
+	FREERDP_API size_t shadow_server_get_client_stats(rdpShadowServer* server,
+	                                                  SHADOW_CLIENT_STATS* stats, size_t count);
+
 	FREERDP_API BOOL shadow_screen_resize(rdpShadowScreen* screen);
 
 #ifdef __cplusplus
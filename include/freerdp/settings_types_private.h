@@ -173,7 +173,8 @@ struct rdp_settings
 	/* Client Multitransport Channel Data */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 MultitransportFlags); /* 512 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL SupportMultitransport); /* 513 */
-	UINT64 padding0576[576 - 514];                           /* 514 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL MultitransportUdp);     /* 514 */
+	UINT64 padding0576[576 - 515];                           /* 515 */
 	UINT64 padding0640[640 - 576];                           /* 576 */
 
 	/*
@@ -286,7 +287,10 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 BOOL AadSecurity);                  /* 1112 */
 	SETTINGS_DEPRECATED(ALIGN64 char* WinSCardModule);              /* 1113 */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL RemoteCredentialGuard);        /* 1114 */
-	UINT64 padding1152[1152 - 1115];                                /* 1115 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL TlsKernelOffload);             /* 1115 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL TransportIoUring);             /* 1116 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL TransportSendQueue);           /* 1117 */
+	UINT64 padding1152[1152 - 1118];                                /* 1118 */
 
 	/* Connection Cookie */
 	SETTINGS_DEPRECATED(ALIGN64 BOOL MstscCookieMode);      /* 1152 */
@@ -819,7 +823,23 @@ struct rdp_settings
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 Floatbar);                /* 5196 */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 TcpConnectTimeout);       /* 5197 */
 	SETTINGS_DEPRECATED(ALIGN64 UINT32 FakeMouseMotionInterval); /* 5198 */
-	UINT64 padding5312[5312 - 5199];                             /* 5199 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 TcpSendQueueLimit);       /* 5199 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 TcpNotSentLowat);         /* 5200 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 TcpBusyPoll);             /* 5201 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 TcpSendBufferSize);       /* 5202 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 TcpReceiveBufferSize);    /* 5203 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL TcpAdaptiveBuffers);        /* 5204 */
+	SETTINGS_DEPRECATED(ALIGN64 char* ConnectionTraceFile);      /* 5205 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL FastPathInputBatching);     /* 5206 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL GfxZeroCopyOutput);         /* 5207 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL GfxParallelDecode);         /* 5208 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL GfxH264DmaBuf);             /* 5209 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 CompressionEffort);       /* 5210 */
+	SETTINGS_DEPRECATED(ALIGN64 char* ThreadAffinity);           /* 5211 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 AudioEncoderBitrate);     /* 5212 */
+	SETTINGS_DEPRECATED(ALIGN64 UINT32 AudioEncoderComplexity);  /* 5213 */
+	SETTINGS_DEPRECATED(ALIGN64 BOOL DynamicChannelCompression); /* 5214 */
+	UINT64 padding5312[5312 - 5215];                             /* 5215 */
 
 	/**
 	 * WARNING: End of ABI stable zone!
@@ -228,6 +228,67 @@ int persistent_cache_read_entry(rdpPersistentCache* persistent, PERSISTENT_CACHE
 	return -1;
 }
 
+static int persistent_cache_read_key_v2(rdpPersistentCache* persistent,
+                                        PERSISTENT_CACHE_ENTRY* entry)
+{
+	PERSISTENT_CACHE_ENTRY_V2 entry2 = { 0 };
+
+	WINPR_ASSERT(persistent);
+	WINPR_ASSERT(entry);
+
+	if (fread((void*)&entry2, sizeof(entry2), 1, persistent->fp) != 1)
+		return -1;
+
+	entry->key64 = entry2.key64;
+	entry->width = entry2.width;
+	entry->height = entry2.height;
+	entry->size = entry2.width * entry2.height * 4;
+	entry->flags = entry2.flags;
+	entry->data = NULL;
+
+	if (fseek(persistent->fp, 0x4000, SEEK_CUR) != 0)
+		return -1;
+
+	return 1;
+}
+
+static int persistent_cache_read_key_v3(rdpPersistentCache* persistent,
+                                        PERSISTENT_CACHE_ENTRY* entry)
+{
+	PERSISTENT_CACHE_ENTRY_V3 entry3 = { 0 };
+
+	WINPR_ASSERT(persistent);
+	WINPR_ASSERT(entry);
+
+	if (fread(&entry3, sizeof(entry3), 1, persistent->fp) != 1)
+		return -1;
+
+	entry->key64 = entry3.key64;
+	entry->width = entry3.width;
+	entry->height = entry3.height;
+	entry->size = 4ul * entry3.width * entry3.height;
+	entry->flags = 0;
+	entry->data = NULL;
+
+	if (_fseeki64(persistent->fp, entry->size, SEEK_CUR) != 0)
+		return -1;
+
+	return 1;
+}
+
+int persistent_cache_read_key(rdpPersistentCache* persistent, PERSISTENT_CACHE_ENTRY* entry)
+{
+	WINPR_ASSERT(persistent);
+	WINPR_ASSERT(entry);
+
+	if (persistent->version == 3)
+		return persistent_cache_read_key_v3(persistent, entry);
+	else if (persistent->version == 2)
+		return persistent_cache_read_key_v2(persistent, entry);
+
+	return -1;
+}
+
 int persistent_cache_write_entry(rdpPersistentCache* persistent,
                                  const PERSISTENT_CACHE_ENTRY* entry)
 {
@@ -32,6 +32,9 @@
 
 #define TAG FREERDP_TAG("cache.pointer")
 
+/* Pointers no longer in a cache slot that are kept, servers often send the same few again */
+#define POINTER_CACHE_RETIRED_MAX 32
+
 static BOOL pointer_cache_put(rdpPointerCache* pointer_cache, UINT32 index, rdpPointer* pointer,
                               BOOL colorCache);
 static rdpPointer* pointer_cache_get(rdpPointerCache* pointer_cache, UINT32 index);
@@ -131,115 +134,264 @@ static BOOL upate_pointer_copy_andxor(rdpPointer* pointer, const BYTE* andMaskDa
 	return TRUE;
 }
 
-static BOOL update_pointer_color(rdpContext* context, const POINTER_COLOR_UPDATE* pointer_color)
+static UINT64 pointer_hash_update(UINT64 hash, const BYTE* data, size_t length)
 {
-	rdpPointer* pointer = NULL;
-	rdpCache* cache = NULL;
+	/* FNV-1a */
+	for (size_t x = 0; x < length; x++)
+	{
+		hash ^= data[x];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
 
-	WINPR_ASSERT(context);
-	WINPR_ASSERT(pointer_color);
+static UINT64 pointer_hash(const rdpPointer* pointer)
+{
+	WINPR_ASSERT(pointer);
 
-	cache = context->cache;
-	WINPR_ASSERT(cache);
+	const UINT32 attr[] = { pointer->xorBpp,        pointer->xPos,          pointer->yPos,
+		                    pointer->width,         pointer->height,        pointer->lengthAndMask,
+		                    pointer->lengthXorMask };
+	UINT64 hash = 0xcbf29ce484222325ULL;
+	hash = pointer_hash_update(hash, (const BYTE*)attr, sizeof(attr));
+	if (pointer->andMaskData)
+		hash = pointer_hash_update(hash, pointer->andMaskData, pointer->lengthAndMask);
+	if (pointer->xorMaskData)
+		hash = pointer_hash_update(hash, pointer->xorMaskData, pointer->lengthXorMask);
+	return hash;
+}
 
-	pointer = Pointer_Alloc(context);
+static BOOL pointer_equal(const rdpPointer* a, const rdpPointer* b)
+{
+	WINPR_ASSERT(a);
+	WINPR_ASSERT(b);
 
-	if (pointer == NULL)
+	if ((a->xorBpp != b->xorBpp) || (a->xPos != b->xPos) || (a->yPos != b->yPos) ||
+	    (a->width != b->width) || (a->height != b->height) ||
+	    (a->lengthAndMask != b->lengthAndMask) || (a->lengthXorMask != b->lengthXorMask))
 		return FALSE;
-	pointer->xorBpp = 24;
-	pointer->xPos = pointer_color->hotSpotX;
-	pointer->yPos = pointer_color->hotSpotY;
-	pointer->width = pointer_color->width;
-	pointer->height = pointer_color->height;
 
-	if (!upate_pointer_copy_andxor(pointer, pointer_color->andMaskData,
-	                               pointer_color->lengthAndMask, pointer_color->xorMaskData,
-	                               pointer_color->lengthXorMask))
-		goto out_fail;
+	if ((!a->andMaskData != !b->andMaskData) || (!a->xorMaskData != !b->xorMaskData))
+		return FALSE;
 
-	if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
-		goto out_fail;
+	if (a->andMaskData && (memcmp(a->andMaskData, b->andMaskData, a->lengthAndMask) != 0))
+		return FALSE;
 
-	if (!pointer_cache_put(cache->pointer, pointer_color->cacheIndex, pointer, TRUE))
-		goto out_fail;
+	return !a->xorMaskData || (memcmp(a->xorMaskData, b->xorMaskData, a->lengthXorMask) == 0);
+}
 
-	return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
+static rdpPointerCacheItem* pointer_cache_find_item(rdpPointerCache* pointer_cache,
+                                                    const rdpPointer* pointer)
+{
+	WINPR_ASSERT(pointer_cache);
 
-out_fail:
-	pointer_free(context, pointer);
-	return FALSE;
+	for (size_t x = 0; x < pointer_cache->itemCount; x++)
+	{
+		rdpPointerCacheItem* item = &pointer_cache->items[x];
+		if (item->pointer == pointer)
+			return item;
+	}
+	return NULL;
 }
 
-static BOOL update_pointer_large(rdpContext* context, const POINTER_LARGE_UPDATE* pointer_large)
+static rdpPointerCacheItem* pointer_cache_lookup(rdpPointerCache* pointer_cache,
+                                                 const rdpPointer* pointer, UINT64 hash)
 {
-	rdpPointer* pointer = NULL;
-	rdpCache* cache = NULL;
+	WINPR_ASSERT(pointer_cache);
 
-	WINPR_ASSERT(context);
-	WINPR_ASSERT(pointer_large);
+	for (size_t x = 0; x < pointer_cache->itemCount; x++)
+	{
+		rdpPointerCacheItem* item = &pointer_cache->items[x];
+		if ((item->hash == hash) && pointer_equal(item->pointer, pointer))
+			return item;
+	}
+	return NULL;
+}
 
-	cache = context->cache;
-	WINPR_ASSERT(cache);
+static void pointer_cache_remove_item(rdpPointerCache* pointer_cache, rdpPointerCacheItem* item)
+{
+	WINPR_ASSERT(pointer_cache);
+	WINPR_ASSERT(item);
+	WINPR_ASSERT(pointer_cache->itemCount > 0);
 
-	pointer = Pointer_Alloc(context);
-	if (pointer == NULL)
-		return FALSE;
-	pointer->xorBpp = pointer_large->xorBpp;
-	pointer->xPos = pointer_large->hotSpotX;
-	pointer->yPos = pointer_large->hotSpotY;
-	pointer->width = pointer_large->width;
-	pointer->height = pointer_large->height;
+	pointer_free(pointer_cache->context, item->pointer);
+	*item = pointer_cache->items[--pointer_cache->itemCount];
+}
+
+/* Drops a slot reference, the least recently used pointers without slot are freed */
+static void pointer_cache_release(rdpPointerCache* pointer_cache, rdpPointer* pointer)
+{
+	size_t retired = 0;
+	rdpPointerCacheItem* oldest = NULL;
 
-	if (!upate_pointer_copy_andxor(pointer, pointer_large->andMaskData,
-	                               pointer_large->lengthAndMask, pointer_large->xorMaskData,
-	                               pointer_large->lengthXorMask))
-		goto out_fail;
+	WINPR_ASSERT(pointer_cache);
 
-	if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
-		goto out_fail;
+	if (!pointer)
+		return;
 
-	if (!pointer_cache_put(cache->pointer, pointer_large->cacheIndex, pointer, FALSE))
-		goto out_fail;
+	rdpPointerCacheItem* item = pointer_cache_find_item(pointer_cache, pointer);
+	WINPR_ASSERT(item);
+	WINPR_ASSERT(item->refs > 0);
+	if (--item->refs > 0)
+		return;
 
-	return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
+	item->lastUse = ++pointer_cache->useCounter;
 
-out_fail:
-	pointer_free(context, pointer);
-	return FALSE;
+	for (size_t x = 0; x < pointer_cache->itemCount; x++)
+	{
+		rdpPointerCacheItem* cur = &pointer_cache->items[x];
+		if (cur->refs > 0)
+			continue;
+
+		retired++;
+		if (!oldest || (cur->lastUse < oldest->lastUse))
+			oldest = cur;
+	}
+
+	if (retired > POINTER_CACHE_RETIRED_MAX)
+		pointer_cache_remove_item(pointer_cache, oldest);
 }
 
-static BOOL update_pointer_new(rdpContext* context, const POINTER_NEW_UPDATE* pointer_new)
+static rdpPointerCacheItem* pointer_cache_add_item(rdpPointerCache* pointer_cache,
+                                                   rdpPointer* pointer, UINT64 hash)
 {
-	if (!context || !pointer_new)
-		return FALSE;
+	WINPR_ASSERT(pointer_cache);
+
+	if (pointer_cache->itemCount >= pointer_cache->itemSize)
+	{
+		const size_t size = MAX(pointer_cache->itemSize * 2, 32);
+		rdpPointerCacheItem* items = realloc(pointer_cache->items, size * sizeof(*items));
+		if (!items)
+			return NULL;
+		pointer_cache->items = items;
+		pointer_cache->itemSize = size;
+	}
+
+	rdpPointerCacheItem* item = &pointer_cache->items[pointer_cache->itemCount++];
+	item->pointer = pointer;
+	item->hash = hash;
+	item->refs = 0;
+	item->lastUse = 0;
+	return item;
+}
+
+/**
+ * Puts the pointer described by \b desc in a cache slot and sets it. The frontend only creates
+ * pointers of new content, a pointer seen before is taken from the cache even if the server
+ * sends it for another slot.
+ */
+static BOOL update_pointer_new_int(rdpContext* context, const rdpPointer* desc, UINT32 cacheIndex,
+                                   BOOL colorCache)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(desc);
 
 	rdpCache* cache = context->cache;
-	rdpPointer* pointer = Pointer_Alloc(context);
+	WINPR_ASSERT(cache);
+
+	rdpPointerCache* pointer_cache = cache->pointer;
+	WINPR_ASSERT(pointer_cache);
+
+	const UINT64 hash = pointer_hash(desc);
+	rdpPointerCacheItem* item = pointer_cache_lookup(pointer_cache, desc, hash);
+	rdpPointer* pointer = item ? item->pointer : NULL;
 
 	if (!pointer)
-		return FALSE;
+	{
+		pointer = Pointer_Alloc(context);
+		if (!pointer)
+			return FALSE;
 
-	pointer->xorBpp = pointer_new->xorBpp;
-	pointer->xPos = pointer_new->colorPtrAttr.hotSpotX;
-	pointer->yPos = pointer_new->colorPtrAttr.hotSpotY;
-	pointer->width = pointer_new->colorPtrAttr.width;
-	pointer->height = pointer_new->colorPtrAttr.height;
-	if (!upate_pointer_copy_andxor(
-	        pointer, pointer_new->colorPtrAttr.andMaskData, pointer_new->colorPtrAttr.lengthAndMask,
-	        pointer_new->colorPtrAttr.xorMaskData, pointer_new->colorPtrAttr.lengthXorMask))
-		goto out_fail;
+		pointer->xorBpp = desc->xorBpp;
+		pointer->xPos = desc->xPos;
+		pointer->yPos = desc->yPos;
+		pointer->width = desc->width;
+		pointer->height = desc->height;
 
-	if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
-		goto out_fail;
+		if (!upate_pointer_copy_andxor(pointer, desc->andMaskData, desc->lengthAndMask,
+		                               desc->xorMaskData, desc->lengthXorMask))
+		{
+			pointer_clear(pointer);
+			free(pointer);
+			return FALSE;
+		}
+
+		if (!IFCALLRESULT(TRUE, pointer->New, context, pointer))
+		{
+			pointer_free(context, pointer);
+			return FALSE;
+		}
 
-	if (!pointer_cache_put(cache->pointer, pointer_new->colorPtrAttr.cacheIndex, pointer, FALSE))
-		goto out_fail;
+		if (!pointer_cache_add_item(pointer_cache, pointer, hash))
+		{
+			pointer_free(context, pointer);
+			return FALSE;
+		}
+	}
+
+	if (!pointer_cache_put(pointer_cache, cacheIndex, pointer, colorCache))
+	{
+		/* a new pointer without slot is retired like any other */
+		item = pointer_cache_find_item(pointer_cache, pointer);
+		WINPR_ASSERT(item);
+		item->refs++;
+		pointer_cache_release(pointer_cache, pointer);
+		return FALSE;
+	}
 
 	return IFCALLRESULT(TRUE, pointer->Set, context, pointer);
+}
 
-out_fail:
-	pointer_free(context, pointer);
-	return FALSE;
+static BOOL update_pointer_color(rdpContext* context, const POINTER_COLOR_UPDATE* pointer_color)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(pointer_color);
+
+	const rdpPointer desc = { .xorBpp = 24,
+		                      .xPos = pointer_color->hotSpotX,
+		                      .yPos = pointer_color->hotSpotY,
+		                      .width = pointer_color->width,
+		                      .height = pointer_color->height,
+		                      .lengthAndMask = pointer_color->lengthAndMask,
+		                      .lengthXorMask = pointer_color->lengthXorMask,
+		                      .andMaskData = pointer_color->andMaskData,
+		                      .xorMaskData = pointer_color->xorMaskData };
+	return update_pointer_new_int(context, &desc, pointer_color->cacheIndex, TRUE);
+}
+
+static BOOL update_pointer_large(rdpContext* context, const POINTER_LARGE_UPDATE* pointer_large)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(pointer_large);
+
+	const rdpPointer desc = { .xorBpp = pointer_large->xorBpp,
+		                      .xPos = pointer_large->hotSpotX,
+		                      .yPos = pointer_large->hotSpotY,
+		                      .width = pointer_large->width,
+		                      .height = pointer_large->height,
+		                      .lengthAndMask = pointer_large->lengthAndMask,
+		                      .lengthXorMask = pointer_large->lengthXorMask,
+		                      .andMaskData = pointer_large->andMaskData,
+		                      .xorMaskData = pointer_large->xorMaskData };
+	return update_pointer_new_int(context, &desc, pointer_large->cacheIndex, FALSE);
+}
+
+static BOOL update_pointer_new(rdpContext* context, const POINTER_NEW_UPDATE* pointer_new)
+{
+	if (!context || !pointer_new)
+		return FALSE;
+
+	const POINTER_COLOR_UPDATE* attr = &pointer_new->colorPtrAttr;
+	const rdpPointer desc = { .xorBpp = pointer_new->xorBpp,
+		                      .xPos = attr->hotSpotX,
+		                      .yPos = attr->hotSpotY,
+		                      .width = attr->width,
+		                      .height = attr->height,
+		                      .lengthAndMask = attr->lengthAndMask,
+		                      .lengthXorMask = attr->lengthXorMask,
+		                      .andMaskData = attr->andMaskData,
+		                      .xorMaskData = attr->xorMaskData };
+	return update_pointer_new_int(context, &desc, attr->cacheIndex, FALSE);
 }
 
 static BOOL update_pointer_cached(rdpContext* context, const POINTER_CACHED_UPDATE* pointer_cached)
@@ -309,8 +461,14 @@ BOOL pointer_cache_put(rdpPointerCache* pointer_cache, UINT32 index, rdpPointer*
 
 	WINPR_ASSERT(pointer_cache->entries);
 	prevPointer = pointer_cache->entries[index];
-	pointer_free(pointer_cache->context, prevPointer);
+	if (prevPointer == pointer)
+		return TRUE;
+
+	rdpPointerCacheItem* item = pointer_cache_find_item(pointer_cache, pointer);
+	WINPR_ASSERT(item);
+	item->refs++;
 	pointer_cache->entries[index] = pointer;
+	pointer_cache_release(pointer_cache, prevPointer);
 	return TRUE;
 }
 
@@ -373,15 +531,11 @@ void pointer_cache_free(rdpPointerCache* pointer_cache)
 {
 	if (pointer_cache != NULL)
 	{
-		if (pointer_cache->entries)
-		{
-			for (UINT32 i = 0; i < pointer_cache->cacheSize; i++)
-			{
-				rdpPointer* pointer = pointer_cache->entries[i];
-				pointer_free(pointer_cache->context, pointer);
-			}
-		}
+		/* the slots only reference the items */
+		for (size_t i = 0; i < pointer_cache->itemCount; i++)
+			pointer_free(pointer_cache->context, pointer_cache->items[i].pointer);
 
+		free(pointer_cache->items);
 		free(pointer_cache->entries);
 		free(pointer_cache);
 	}
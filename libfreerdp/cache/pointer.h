@@ -26,6 +26,15 @@
 
 typedef struct rdp_pointer_cache rdpPointerCache;
 
+/* A converted pointer, shared by all cache slots holding the same content */
+typedef struct
+{
+	rdpPointer* pointer;
+	UINT64 hash;
+	UINT32 refs;
+	UINT64 lastUse;
+} rdpPointerCacheItem;
+
 struct rdp_pointer_cache
 {
 	UINT32 cacheSize;     /* 0 */
@@ -33,6 +42,12 @@ struct rdp_pointer_cache
 
 	/* internal */
 	rdpContext* context;
+
+	/* All pointers alive, the ones without slot are kept for a while to be sent again */
+	rdpPointerCacheItem* items;
+	size_t itemCount;
+	size_t itemSize;
+	UINT64 useCounter;
 };
 
 #ifdef __cplusplus
@@ -19,9 +19,12 @@
 
 #include <freerdp/config.h>
 
+#include <freerdp/log.h>
 #include <freerdp/codec/bitmap.h>
 #include <freerdp/codec/planar.h>
 
+#define TAG FREERDP_TAG("codec")
+
 static INLINE UINT16 GETPIXEL16(const void* WINPR_RESTRICT d, UINT32 x, UINT32 y, UINT32 w)
 {
 	const BYTE* WINPR_RESTRICT src = (const BYTE*)d + ((y * w + x) * sizeof(UINT16));
@@ -59,6 +62,86 @@ static INLINE UINT32 IN_PIXEL32(const void* WINPR_RESTRICT in_ptr, UINT32 in_x,
 		return in_last_pixel;
 }
 
+/*****************************************************************************/
+/* number of pixels at ptr equal to the pixel at ref, compares 8 bytes at a time */
+static INLINE UINT32 pixel_run_length(const BYTE* WINPR_RESTRICT ptr, UINT32 count,
+                                      const BYTE* WINPR_RESTRICT ref, size_t bpp)
+{
+	BYTE bytes[8] = { 0 };
+	UINT64 pattern = 0;
+	const UINT32 perWord = (UINT32)(sizeof(pattern) / bpp);
+	UINT32 n = 0;
+
+	/* most runs in text and UI content are short */
+	while ((n < count) && (n < perWord))
+	{
+		if (memcmp(&ptr[n * bpp], ref, bpp) != 0)
+			return n;
+		n++;
+	}
+
+	for (size_t x = 0; x < sizeof(bytes); x++)
+		bytes[x] = ref[x % bpp];
+
+	memcpy(&pattern, bytes, sizeof(pattern));
+
+	while (n + perWord <= count)
+	{
+		UINT64 value = 0;
+		memcpy(&value, &ptr[n * bpp], sizeof(value));
+
+		if (value != pattern)
+			break;
+
+		n += perWord;
+	}
+
+	while ((n < count) && (memcmp(&ptr[n * bpp], ref, bpp) == 0))
+		n++;
+
+	return n;
+}
+
+/*****************************************************************************/
+/* Length of the repeat following pixel x of line, which already repeats its
+ * predecessor, where the pixel above repeats as well */
+static INLINE UINT32 pixel_repeat_count(const char* WINPR_RESTRICT line,
+                                        const char* WINPR_RESTRICT last_line, UINT32 x,
+                                        UINT32 width, size_t bpp)
+{
+	if (x + 1 >= width)
+		return 0;
+
+	const BYTE* cur = (const BYTE*)line + x * bpp;
+	UINT32 n = pixel_run_length(cur + bpp, width - x - 1, cur, bpp);
+
+	if (last_line && (n > 0))
+	{
+		const BYTE* above = (const BYTE*)last_line + x * bpp;
+		n = pixel_run_length(above + bpp, n, above, bpp);
+	}
+
+	return n;
+}
+
+static INLINE void fom_mask_append(char* WINPR_RESTRICT fom_mask, size_t* WINPR_RESTRICT fom_mask_len,
+                                   UINT16* WINPR_RESTRICT fom_count, BOOL set, UINT32 n)
+{
+	for (UINT32 x = 0; x < n; x++)
+	{
+		if ((*fom_count % 8) == 0)
+		{
+			fom_mask[*fom_mask_len] = 0;
+			(*fom_mask_len)++;
+		}
+
+		if (set)
+			fom_mask[*fom_mask_len - 1] |= (1 << (*fom_count % 8));
+
+		(*fom_count)++;
+	}
+}
+
 /*****************************************************************************/
 /* color */
 static INLINE UINT16 out_color_count_2(UINT16 in_count, wStream* WINPR_RESTRICT in_s,
@@ -505,6 +588,7 @@ static INLINE SSIZE_T freerdp_bitmap_compress_24(const void* WINPR_RESTRICT srcD
 			/* read next pixel */
 			const UINT32 pixel = IN_PIXEL32(line, j, 0, width, last_pixel);
 			const UINT32 ypixel = IN_PIXEL32(last_line, j, 0, width, last_ypixel);
+			const BOOL repeat = (pixel == last_pixel) && (ypixel == last_ypixel);
 
 			if (!TEST_FILL)
 			{
@@ -642,6 +726,39 @@ static INLINE SSIZE_T freerdp_bitmap_compress_24(const void* WINPR_RESTRICT srcD
 			count++;
 			last_pixel = pixel;
 			last_ypixel = ypixel;
+
+			/* Once a pixel repeats its predecessor on both lines, further repeats cannot
+			 * end a run, they only extend the ones in progress: take them in one go */
+			if (repeat)
+			{
+				const UINT32 n = pixel_repeat_count(line, last_line, j, width, 4);
+
+				if (TEST_FILL)
+					fill_count = (UINT16)(fill_count + n);
+
+				if (TEST_MIX)
+					mix_count = (UINT16)(mix_count + n);
+
+				color_count = (UINT16)(color_count + n);
+
+				if (TEST_FOM)
+					fom_mask_append(fom_mask, &fom_mask_len, &fom_count, pixel == (ypixel ^ mix),
+					                n);
+
+				if (!Stream_CheckAndLogRequiredCapacity(TAG, temp_s, 3ull * n))
+					return -1;
+
+				BYTE* dst = Stream_Pointer(temp_s);
+				for (UINT32 x = 0; x < n; x++)
+				{
+					*dst++ = pixel & 0xff;
+					*dst++ = (pixel >> 8) & 0xff;
+					*dst++ = (pixel >> 16) & 0xff;
+				}
+				Stream_Seek(temp_s, 3ull * n);
+				count = (UINT16)(count + n);
+				j += n;
+			}
 		}
 
 		/* can't take fix, mix, or fom past first line */
@@ -811,6 +928,7 @@ static INLINE SSIZE_T freerdp_bitmap_compress_16(const void* WINPR_RESTRICT srcD
 			/* read next pixel */
 			const UINT16 pixel = IN_PIXEL16(line, j, 0, width, last_pixel);
 			const UINT16 ypixel = IN_PIXEL16(last_line, j, 0, width, last_ypixel);
+			const BOOL repeat = (pixel == last_pixel) && (ypixel == last_ypixel);
 
 			if (!TEST_FILL)
 			{
@@ -946,6 +1064,38 @@ static INLINE SSIZE_T freerdp_bitmap_compress_16(const void* WINPR_RESTRICT srcD
 			count++;
 			last_pixel = pixel;
 			last_ypixel = ypixel;
+
+			/* Once a pixel repeats its predecessor on both lines, further repeats cannot
+			 * end a run, they only extend the ones in progress: take them in one go */
+			if (repeat)
+			{
+				const UINT32 n = pixel_repeat_count(line, last_line, j, width, 2);
+
+				if (TEST_FILL)
+					fill_count = (UINT16)(fill_count + n);
+
+				if (TEST_MIX)
+					mix_count = (UINT16)(mix_count + n);
+
+				color_count = (UINT16)(color_count + n);
+
+				if (TEST_FOM)
+					fom_mask_append(fom_mask, &fom_mask_len, &fom_count, pixel == (ypixel ^ mix),
+					                n);
+
+				if (!Stream_CheckAndLogRequiredCapacity(TAG, temp_s, 2ull * n))
+					return -1;
+
+				BYTE* dst = Stream_Pointer(temp_s);
+				for (UINT32 x = 0; x < n; x++)
+				{
+					*dst++ = pixel & 0xff;
+					*dst++ = (pixel >> 8) & 0xff;
+				}
+				Stream_Seek(temp_s, 2ull * n);
+				count = (UINT16)(count + n);
+				j += n;
+			}
 		}
 
 		/* can't take fix, mix, or fom past first line */
@@ -83,6 +83,8 @@ static UINT32 bulk_compression_level(rdpBulk* WINPR_RESTRICT bulk)
 	bulk->CompressionLevel = (settings->CompressionLevel >= PACKET_COMPR_TYPE_RDP61)
 	                             ? PACKET_COMPR_TYPE_RDP61
 	                             : settings->CompressionLevel;
+	ncrush_set_compression_effort(bulk->ncrushSend,
+	                              freerdp_settings_get_uint32(settings, FreeRDP_CompressionEffort));
 	return bulk->CompressionLevel;
 }
 
@@ -94,6 +96,64 @@ UINT32 bulk_compression_max_size(rdpBulk* WINPR_RESTRICT bulk)
 	return bulk->CompressionMaxSize;
 }
 
+/* Sample 32 windows of 32 bytes spread over the payload */
+#define BULK_ENTROPY_WINDOWS 32
+#define BULK_ENTROPY_WINDOW_SIZE 32
+#define BULK_ENTROPY_SAMPLE_SIZE (BULK_ENTROPY_WINDOWS * BULK_ENTROPY_WINDOW_SIZE)
+
+/* Payloads whose sampled byte entropy exceeds this (bits per byte) are already
+ * compressed or encrypted. A uniform random sample of 1024 bytes measures ~7.8 */
+#define BULK_ENTROPY_THRESHOLD 7.5
+
+static double bulk_histogram_entropy(const UINT32 histogram[256], UINT32 total)
+{
+	/* H = log2(n) - 1/n * sum(c * log2(c)) */
+	double sum = 0.0;
+
+	for (size_t x = 0; x < 256; x++)
+	{
+		const double count = histogram[x];
+
+		if (count > 1.0)
+			sum += count * log2(count);
+	}
+
+	return log2((double)total) - sum / total;
+}
+
+BOOL bulk_is_compressible(const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize)
+{
+	UINT32 histogram[256] = { 0 };
+	UINT32 deltas[256] = { 0 };
+
+	WINPR_ASSERT(pSrcData || (SrcSize == 0));
+
+	/* too small for a meaningful estimate, compressing these is cheap anyway */
+	if (SrcSize < 2 * BULK_ENTROPY_SAMPLE_SIZE)
+		return TRUE;
+
+	const UINT32 stride = SrcSize / BULK_ENTROPY_WINDOWS;
+
+	for (UINT32 w = 0; w < BULK_ENTROPY_WINDOWS; w++)
+	{
+		const BYTE* window = &pSrcData[1ULL * w * stride];
+
+		for (UINT32 x = 0; x < BULK_ENTROPY_WINDOW_SIZE; x++)
+		{
+			const BYTE* cur = &window[x];
+			const BYTE prev = (cur > pSrcData) ? cur[-1] : 0;
+			histogram[*cur]++;
+			deltas[(BYTE)(*cur - prev)]++;
+		}
+	}
+
+	/* Gradients and periodic patterns have a flat byte histogram but are
+	 * trivially compressible, their byte to byte deltas are not flat. */
+	const double entropy = MIN(bulk_histogram_entropy(histogram, BULK_ENTROPY_SAMPLE_SIZE),
+	                           bulk_histogram_entropy(deltas, BULK_ENTROPY_SAMPLE_SIZE));
+	return entropy < BULK_ENTROPY_THRESHOLD;
+}
+
 #if defined(WITH_BULK_DEBUG)
 static INLINE int bulk_compress_validate(rdpBulk* bulk, const BYTE* pSrcData, UINT32 SrcSize,
                                          const BYTE* pDstData, UINT32 DstSize, UINT32 Flags)
@@ -214,6 +274,8 @@ int bulk_decompress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_RESTRICT pSr
 		const UINT32 UncompressedBytes = *pDstSize;
 		const double CompressionRatio =
 		    metrics_write_bytes(metrics, UncompressedBytes, CompressedBytes);
+		if (flags & BULK_COMPRESSION_FLAGS_MASK)
+			metrics_write_bulk_bytes(metrics, type, FALSE, UncompressedBytes, CompressedBytes);
 #ifdef WITH_BULK_DEBUG
 		{
 			WLog_DBG(TAG,
@@ -294,6 +356,8 @@ int bulk_compress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_RESTRICT pSrcD
 		const UINT32 UncompressedBytes = SrcSize;
 		const double CompressionRatio =
 		    metrics_write_bytes(metrics, UncompressedBytes, CompressedBytes);
+		metrics_write_bulk_bytes(metrics, bulk->CompressionLevel, TRUE, UncompressedBytes,
+		                         CompressedBytes);
 #ifdef WITH_BULK_DEBUG
 		{
 			WLog_DBG(TAG,
@@ -22,12 +22,48 @@
 
 typedef struct rdp_bulk rdpBulk;
 
+#include <winpr/crt.h>
+
 #include <freerdp/api.h>
 #include <freerdp/freerdp.h>
 
 #define BULK_COMPRESSION_FLAGS_MASK 0xE0
 #define BULK_COMPRESSION_TYPE_MASK 0x0F
 
+/** @brief Copies a match into the history buffer of a decompressor.
+ *
+ *  Follows LZ77 semantics: if the source starts less than length bytes before the
+ *  destination, the bytes in between are repeated. That is done with a fill for offset 1
+ *  and with doubling memcpy chunks otherwise, instead of a byte wise loop. A source after the
+ *  destination is a plain forward copy. */
+static INLINE void bulk_copy_match(BYTE* dst, const BYTE* src, size_t length)
+{
+	if (src >= dst)
+	{
+		MoveMemory(dst, src, length);
+		return;
+	}
+
+	size_t distance = (size_t)(dst - src);
+
+	if (distance == 1)
+	{
+		FillMemory(dst, length, *src);
+		return;
+	}
+
+	/* everything from src to dst repeats with the match offset, so every chunk may be as long
+	 * as everything produced so far without overlapping */
+	while (length > 0)
+	{
+		const size_t chunk = (distance < length) ? distance : length;
+		CopyMemory(dst, src, chunk);
+		dst += chunk;
+		length -= chunk;
+		distance += chunk;
+	}
+}
+
 FREERDP_LOCAL UINT32 bulk_compression_max_size(rdpBulk* WINPR_RESTRICT bulk);
 
 FREERDP_LOCAL int bulk_decompress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_RESTRICT pSrcData,
@@ -37,6 +73,12 @@ FREERDP_LOCAL int bulk_compress(rdpBulk* WINPR_RESTRICT bulk, const BYTE* WINPR_
                                 UINT32 SrcSize, const BYTE** WINPR_RESTRICT ppDstData,
                                 UINT32* WINPR_RESTRICT pDstSize, UINT32* WINPR_RESTRICT pFlags);
 
+/** @brief Cheap sampled entropy estimate of a payload.
+ *
+ *  @return FALSE if the payload looks already compressed or encrypted, in which case
+ *  bulk compression would only burn CPU and flush the history. */
+FREERDP_LOCAL BOOL bulk_is_compressible(const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize);
+
 FREERDP_LOCAL void bulk_reset(rdpBulk* WINPR_RESTRICT bulk);
 
 FREERDP_LOCAL void bulk_free(rdpBulk* bulk);
@@ -24,7 +24,10 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 #include <winpr/bitstream.h>
+#include <winpr/pool.h>
+#include <winpr/sysinfo.h>
 
+#include <freerdp/settings.h>
 #include <freerdp/codec/color.h>
 #include <freerdp/codec/clear.h>
 #include <freerdp/log.h>
@@ -38,6 +41,32 @@
 #define CLEARCODEC_VBAR_SIZE 32768
 #define CLEARCODEC_VBAR_SHORT_SIZE 16384
 
+#define CLEARCODEC_GLYPH_MAX_PIXELS 1024
+#define CLEARCODEC_GLYPH_HASH_SIZE 4096
+#define CLEARCODEC_VBAR_HASH_SIZE 65536
+#define CLEARCODEC_VBAR_SHORT_HASH_SIZE 32768
+#define CLEARCODEC_BAND_MAX_HEIGHT 52
+#define CLEARCODEC_CELL_WIDTH 64
+#define CLEARCODEC_RLEX_MAX_COLORS 127
+
+/* Surface commands this large have their bands written on the thread pool */
+#define CLEARCODEC_PARALLEL_MIN_PIXELS (128 * 128)
+
+typedef enum
+{
+	CLEAR_CELL_RESIDUAL,
+	CLEAR_CELL_BAND,
+	CLEAR_CELL_SUBCODEC
+} CLEAR_CELL_TYPE;
+
+typedef struct
+{
+	UINT32 count;
+	UINT32 colors[CLEARCODEC_RLEX_MAX_COLORS];
+	UINT32 hits[CLEARCODEC_RLEX_MAX_COLORS];
+	INT16 slots[256];
+} CLEAR_PALETTE;
+
 typedef struct
 {
 	UINT32 size;
@@ -52,6 +81,16 @@ typedef struct
 	BYTE* pixels;
 } CLEAR_VBAR_ENTRY;
 
+/* A decoded band, its vBars are stored column by column at offset in BandPixels */
+typedef struct
+{
+	UINT32 nXDst;
+	UINT32 nYDst;
+	UINT32 width;
+	UINT32 height;
+	size_t offset;
+} CLEAR_BAND;
+
 struct S_CLEAR_CONTEXT
 {
 	BOOL Compressor;
@@ -67,8 +106,44 @@ struct S_CLEAR_CONTEXT
 	CLEAR_VBAR_ENTRY VBarStorage[CLEARCODEC_VBAR_SIZE];
 	UINT32 ShortVBarStorageCursor;
 	CLEAR_VBAR_ENTRY ShortVBarStorage[CLEARCODEC_VBAR_SHORT_SIZE];
+
+	/* Compressor state, maps content hashes to cache indices (+1, 0 is empty) */
+	BOOL CacheResetPending;
+	UINT32 GlyphCursor;
+	UINT32* GlyphHashTable;
+	UINT32* VBarHashTable;
+	UINT32* ShortVBarHashTable;
+	BYTE* CellTypes;
+	size_t CellTypesSize;
+	wStream* ResidualStream;
+	wStream* BandsStream;
+	wStream* SubcodecStream;
+	wStream* CellStream;
+	UINT32 CellBuffer[CLEARCODEC_CELL_WIDTH * CLEARCODEC_BAND_MAX_HEIGHT];
+
+	/* Decompressor band output, written by row stripes on the thread pool */
+	BOOL UseThreads;
+	UINT32 nthreads;
+	PTP_POOL ThreadPool;
+	TP_CALLBACK_ENVIRON ThreadPoolEnv;
+	CLEAR_BAND* Bands;
+	size_t BandsCount;
+	size_t BandsSize;
+	BYTE* BandPixels;
+	size_t BandPixelsSize;
 };
 
+typedef struct
+{
+	const CLEAR_CONTEXT* clear;
+	BYTE* pDstData;
+	UINT32 DstFormat;
+	UINT32 nDstStep;
+	UINT32 yBegin;
+	UINT32 yEnd;
+	BOOL success;
+} CLEAR_BANDS_WORK_PARAM;
+
 static const UINT32 CLEAR_LOG2_FLOOR[256] = {
 	0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
 	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
@@ -588,6 +663,167 @@ static BOOL resize_vbar_entry(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 	return TRUE;
 }
 
+static BOOL clear_write_vbar(const CLEAR_CONTEXT* WINPR_RESTRICT clear,
+                             const BYTE* WINPR_RESTRICT pSrcPixel, UINT32 count,
+                             BYTE* WINPR_RESTRICT pDstData, UINT32 DstFormat, UINT32 nDstStep,
+                             UINT32 nXDst, UINT32 nYDst)
+{
+	for (UINT32 y = 0; y < count; y++)
+	{
+		BYTE* pDstPixel8 =
+		    &pDstData[((nYDst + y) * nDstStep) + (nXDst * FreeRDPGetBytesPerPixel(DstFormat))];
+		UINT32 color = FreeRDPReadColor(pSrcPixel, clear->format);
+		color = FreeRDPConvertColor(color, clear->format, DstFormat, NULL);
+
+		if (!FreeRDPWriteColor(pDstPixel8, DstFormat, color))
+			return FALSE;
+
+		pSrcPixel += FreeRDPGetBytesPerPixel(clear->format);
+	}
+
+	return TRUE;
+}
+
+static CLEAR_BAND* clear_add_band(CLEAR_CONTEXT* WINPR_RESTRICT clear, UINT32 nXDst, UINT32 nYDst,
+                                  UINT32 width, UINT32 height)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(clear->format);
+	size_t offset = 0;
+
+	if (clear->BandsCount > 0)
+	{
+		const CLEAR_BAND* last = &clear->Bands[clear->BandsCount - 1];
+		offset = last->offset + 1ull * last->width * last->height * bpp;
+	}
+
+	if (clear->BandsCount >= clear->BandsSize)
+	{
+		const size_t size = MAX(64, clear->BandsSize * 2);
+		CLEAR_BAND* tmp = (CLEAR_BAND*)realloc(clear->Bands, size * sizeof(CLEAR_BAND));
+
+		if (!tmp)
+			return NULL;
+
+		clear->Bands = tmp;
+		clear->BandsSize = size;
+	}
+
+	const size_t required = offset + 1ull * width * height * bpp;
+	if (required > clear->BandPixelsSize)
+	{
+		const size_t size = MAX(required, clear->BandPixelsSize * 2);
+		BYTE* tmp = (BYTE*)winpr_aligned_recalloc(clear->BandPixels, size, sizeof(BYTE), 32);
+
+		if (!tmp)
+		{
+			WLog_ERR(TAG, "clear->BandPixels winpr_aligned_recalloc failed for %" PRIuz " bytes",
+			         size);
+			return NULL;
+		}
+
+		clear->BandPixels = tmp;
+		clear->BandPixelsSize = size;
+	}
+
+	CLEAR_BAND* band = &clear->Bands[clear->BandsCount++];
+	band->nXDst = nXDst;
+	band->nYDst = nYDst;
+	band->width = width;
+	band->height = height;
+	band->offset = offset;
+	return band;
+}
+
+/* Writes the part of all bands within the stripe, in stream order */
+static void clear_write_bands(CLEAR_BANDS_WORK_PARAM* WINPR_RESTRICT param)
+{
+	WINPR_ASSERT(param);
+
+	const CLEAR_CONTEXT* clear = param->clear;
+	const size_t bpp = FreeRDPGetBytesPerPixel(clear->format);
+
+	param->success = TRUE;
+	for (size_t x = 0; x < clear->BandsCount; x++)
+	{
+		const CLEAR_BAND* band = &clear->Bands[x];
+		const UINT32 first = MAX(band->nYDst, param->yBegin);
+		const UINT32 last = MIN(band->nYDst + band->height, param->yEnd);
+
+		if (first >= last)
+			continue;
+
+		for (UINT32 i = 0; i < band->width; i++)
+		{
+			const size_t index = 1ull * i * band->height + (first - band->nYDst);
+			const BYTE* pSrcPixel = &clear->BandPixels[band->offset + index * bpp];
+
+			if (!clear_write_vbar(clear, pSrcPixel, last - first, param->pDstData,
+			                      param->DstFormat, param->nDstStep, band->nXDst + i, first))
+			{
+				param->success = FALSE;
+				return;
+			}
+		}
+	}
+}
+
+static void clear_write_bands_work_callback(PVOID context, size_t index)
+{
+	CLEAR_BANDS_WORK_PARAM* params = (CLEAR_BANDS_WORK_PARAM*)context;
+	WINPR_ASSERT(params);
+
+	clear_write_bands(&params[index]);
+}
+
+/**
+ * The vBar caches make band parsing sequential, writing the bands is not.
+ * The destination is split in row stripes, every stripe is written by one
+ * thread so overlapping bands still end up in stream order.
+ */
+static BOOL clear_write_bands_parallel(CLEAR_CONTEXT* WINPR_RESTRICT clear,
+                                       BYTE* WINPR_RESTRICT pDstData, UINT32 DstFormat,
+                                       UINT32 nDstStep, UINT32 yBegin, UINT32 yEnd)
+{
+	BOOL rc = TRUE;
+	const UINT32 rows = (yEnd > yBegin) ? yEnd - yBegin : 0;
+	const size_t nstripes = MIN(clear->nthreads, rows / CLEARCODEC_BAND_MAX_HEIGHT);
+
+	if (nstripes < 2)
+	{
+		CLEAR_BANDS_WORK_PARAM param = { clear, pDstData, DstFormat, nDstStep, yBegin, yEnd, FALSE };
+		clear_write_bands(&param);
+		return param.success;
+	}
+
+	CLEAR_BANDS_WORK_PARAM* params = calloc(nstripes, sizeof(CLEAR_BANDS_WORK_PARAM));
+	if (!params)
+		return FALSE;
+
+	for (size_t x = 0; x < nstripes; x++)
+	{
+		CLEAR_BANDS_WORK_PARAM* param = &params[x];
+		param->clear = clear;
+		param->pDstData = pDstData;
+		param->DstFormat = DstFormat;
+		param->nDstStep = nDstStep;
+		param->yBegin = yBegin + (UINT32)(x * rows / nstripes);
+		param->yEnd = yBegin + (UINT32)((x + 1) * rows / nstripes);
+	}
+
+	if (!winpr_SubmitThreadpoolWorkBatch(clear_write_bands_work_callback, params, nstripes,
+	                                     &clear->ThreadPoolEnv))
+		rc = FALSE;
+
+	for (size_t x = 0; x < nstripes; x++)
+	{
+		if (!params[x].success)
+			rc = FALSE;
+	}
+
+	free(params);
+	return rc;
+}
+
 static BOOL clear_decompress_bands_data(CLEAR_CONTEXT* WINPR_RESTRICT clear,
                                         wStream* WINPR_RESTRICT s, UINT32 bandsByteCount,
                                         UINT32 nWidth, UINT32 nHeight,
@@ -596,10 +832,16 @@ static BOOL clear_decompress_bands_data(CLEAR_CONTEXT* WINPR_RESTRICT clear,
                                         UINT32 nDstWidth, UINT32 nDstHeight)
 {
 	UINT32 suboffset = 0;
+	UINT32 bandsTop = UINT32_MAX;
+	UINT32 bandsBottom = 0;
+	const BOOL deferred =
+	    clear->UseThreads && ((1ull * nWidth * nHeight) >= CLEARCODEC_PARALLEL_MIN_PIXELS);
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, bandsByteCount))
 		return FALSE;
 
+	clear->BandsCount = 0;
+
 	while (suboffset < bandsByteCount)
 	{
 		BYTE cr = 0;
@@ -616,6 +858,8 @@ static BOOL clear_decompress_bands_data(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 		UINT32 vBarCount = 0;
 		UINT32 vBarPixelCount = 0;
 		UINT32 vBarShortPixelCount = 0;
+		UINT32 vBarHeight = 0;
+		CLEAR_BAND* band = NULL;
 
 		if (!Stream_CheckAndLogRequiredLength(TAG, s, 11))
 			return FALSE;
@@ -643,10 +887,29 @@ static BOOL clear_decompress_bands_data(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 		}
 
 		vBarCount = (xEnd - xStart) + 1;
+		vBarHeight = (yEnd - yStart + 1);
+
+		if (vBarHeight > 52)
+		{
+			WLog_ERR(TAG, "vBarHeight (%" PRIu32 ") > 52", vBarHeight);
+			return FALSE;
+		}
+
+		if (deferred)
+		{
+			const UINT32 nYDstRel = nYDst + yStart;
+			const UINT32 height = MIN(vBarHeight, nHeight);
+
+			band = clear_add_band(clear, nXDst + xStart, nYDstRel, MIN(vBarCount, nWidth), height);
+			if (!band)
+				return FALSE;
+
+			bandsTop = MIN(bandsTop, nYDstRel);
+			bandsBottom = MAX(bandsBottom, nYDstRel + height);
+		}
 
 		for (UINT32 i = 0; i < vBarCount; i++)
 		{
-			UINT32 vBarHeight = 0;
 			CLEAR_VBAR_ENTRY* vBarEntry = NULL;
 			CLEAR_VBAR_ENTRY* vBarShortEntry = NULL;
 			BOOL vBarUpdate = FALSE;
@@ -657,13 +920,6 @@ static BOOL clear_decompress_bands_data(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 
 			Stream_Read_UINT16(s, vBarHeader);
 			suboffset += 2;
-			vBarHeight = (yEnd - yStart + 1);
-
-			if (vBarHeight > 52)
-			{
-				WLog_ERR(TAG, "vBarHeight (%" PRIu32 ") > 52", vBarHeight);
-				return FALSE;
-			}
 
 			if ((vBarHeader & 0xC000) == 0x4000) /* SHORT_VBAR_CACHE_HIT */
 			{
@@ -870,34 +1126,31 @@ static BOOL clear_decompress_bands_data(CLEAR_CONTEXT* WINPR_RESTRICT clear,
 
 			if (i < nWidth)
 			{
-				UINT32 count = vBarEntry->count;
-
-				if (count > nHeight)
-					count = nHeight;
+				const UINT32 count = MIN(vBarEntry->count, nHeight);
 
 				if (nXDstRel + i > nDstWidth)
 					return FALSE;
 
-				for (UINT32 y = 0; y < count; y++)
-				{
-					if (nYDstRel + y > nDstHeight)
-						return FALSE;
-
-					BYTE* pDstPixel8 =
-					    &pDstData[((nYDstRel + y) * nDstStep) +
-					              ((nXDstRel + i) * FreeRDPGetBytesPerPixel(DstFormat))];
-					UINT32 color = FreeRDPReadColor(cpSrcPixel, clear->format);
-					color = FreeRDPConvertColor(color, clear->format, DstFormat, NULL);
-
-					if (!FreeRDPWriteColor(pDstPixel8, DstFormat, color))
-						return FALSE;
+				if ((count > 0) && (nYDstRel + count - 1 > nDstHeight))
+					return FALSE;
 
-					cpSrcPixel += FreeRDPGetBytesPerPixel(clear->format);
+				if (band)
+				{
+					const size_t bpp = FreeRDPGetBytesPerPixel(clear->format);
+					memcpy(&clear->BandPixels[band->offset + 1ull * i * band->height * bpp],
+					       cpSrcPixel, count * bpp);
 				}
+				else if (!clear_write_vbar(clear, cpSrcPixel, count, pDstData, DstFormat, nDstStep,
+				                           nXDstRel + i, nYDstRel))
+					return FALSE;
 			}
 		}
 	}
 
+	if (deferred)
+		return clear_write_bands_parallel(clear, pDstData, DstFormat, nDstStep, bandsTop,
+		                                  bandsBottom);
+
 	return TRUE;
 }
 
@@ -1150,11 +1403,749 @@ fail:
 	return rc;
 }
 
+static INLINE UINT32 clear_hash_pixels(const UINT32* WINPR_RESTRICT pixels, UINT32 count)
+{
+	UINT32 hash = 2166136261u; /* FNV-1a */
+
+	for (UINT32 x = 0; x < count; x++)
+		hash = (hash ^ pixels[x]) * 16777619u;
+
+	return hash ^ count;
+}
+
+static INLINE BOOL clear_write_bgr(wStream* WINPR_RESTRICT s, UINT32 color)
+{
+	BYTE bgrx[4] = { 0 };
+
+	if (!Stream_EnsureRemainingCapacity(s, 3))
+		return FALSE;
+
+	memcpy(bgrx, &color, sizeof(bgrx));
+	Stream_Write_UINT8(s, bgrx[0]);
+	Stream_Write_UINT8(s, bgrx[1]);
+	Stream_Write_UINT8(s, bgrx[2]);
+	return TRUE;
+}
+
+static INLINE size_t clear_run_length_size(UINT32 runLengthFactor)
+{
+	if (runLengthFactor < 0xFF)
+		return 1;
+
+	if (runLengthFactor < 0xFFFF)
+		return 3;
+
+	return 7;
+}
+
+static INLINE BOOL clear_write_run_length(wStream* WINPR_RESTRICT s, UINT32 runLengthFactor)
+{
+	if (!Stream_EnsureRemainingCapacity(s, 7))
+		return FALSE;
+
+	if (runLengthFactor < 0xFF)
+	{
+		Stream_Write_UINT8(s, (BYTE)runLengthFactor);
+	}
+	else if (runLengthFactor < 0xFFFF)
+	{
+		Stream_Write_UINT8(s, 0xFF);
+		Stream_Write_UINT16(s, (UINT16)runLengthFactor);
+	}
+	else
+	{
+		Stream_Write_UINT8(s, 0xFF);
+		Stream_Write_UINT16(s, 0xFFFF);
+		Stream_Write_UINT32(s, runLengthFactor);
+	}
+
+	return TRUE;
+}
+
+static INLINE INT16 clear_palette_find(const CLEAR_PALETTE* WINPR_RESTRICT palette, UINT32 color,
+                                       size_t* WINPR_RESTRICT pSlot)
+{
+	size_t slot = ((color * 2654435761u) >> 24) & 0xFF;
+
+	while (palette->slots[slot] >= 0)
+	{
+		if (palette->colors[palette->slots[slot]] == color)
+			break;
+
+		slot = (slot + 1) & 0xFF;
+	}
+
+	*pSlot = slot;
+	return palette->slots[slot];
+}
+
+/**
+ * Collect the colors of a cell in order of appearance.
+ *
+ * @return FALSE if the cell has more colors than RLEX can index
+ */
+static BOOL clear_palette_build(CLEAR_PALETTE* WINPR_RESTRICT palette,
+                                const UINT32* WINPR_RESTRICT pixels, UINT32 nStride, UINT32 nWidth,
+                                UINT32 nHeight)
+{
+	INT16 last = -1;
+	UINT32 lastColor = 0;
+
+	palette->count = 0;
+	memset(palette->slots, 0xFF, sizeof(palette->slots));
+
+	for (UINT32 y = 0; y < nHeight; y++)
+	{
+		const UINT32* row = &pixels[1ull * y * nStride];
+
+		for (UINT32 x = 0; x < nWidth; x++)
+		{
+			const UINT32 color = row[x];
+
+			if ((last < 0) || (color != lastColor))
+			{
+				size_t slot = 0;
+				last = clear_palette_find(palette, color, &slot);
+
+				if (last < 0)
+				{
+					if (palette->count >= CLEARCODEC_RLEX_MAX_COLORS)
+						return FALSE;
+
+					last = (INT16)palette->count++;
+					palette->slots[slot] = last;
+					palette->colors[last] = color;
+					palette->hits[last] = 0;
+				}
+
+				lastColor = color;
+			}
+
+			palette->hits[last]++;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL clear_compress_rlex(wStream* WINPR_RESTRICT s,
+                                const CLEAR_PALETTE* WINPR_RESTRICT palette,
+                                const UINT32* WINPR_RESTRICT pixels, UINT32 nStride, UINT32 nWidth,
+                                UINT32 nHeight)
+{
+	const UINT32 numBits = CLEAR_LOG2_FLOOR[palette->count - 1] + 1;
+	const UINT32 maxSuiteDepth = CLEAR_8BIT_MASKS[8 - numBits];
+	const size_t pixelCount = 1ull * nWidth * nHeight;
+	size_t pixelIndex = 0;
+	size_t slot = 0;
+
+	WINPR_ASSERT(palette->count > 0);
+
+	if (!Stream_EnsureRemainingCapacity(s, 1ull + 3ull * palette->count))
+		return FALSE;
+
+	Stream_Write_UINT8(s, (BYTE)palette->count);
+
+	for (UINT32 i = 0; i < palette->count; i++)
+	{
+		if (!clear_write_bgr(s, palette->colors[i]))
+			return FALSE;
+	}
+
+#define CLEAR_PIXEL_AT(index) pixels[((index) / nWidth) * nStride + ((index) % nWidth)]
+
+	while (pixelIndex < pixelCount)
+	{
+		const INT16 startIndex = clear_palette_find(palette, CLEAR_PIXEL_AT(pixelIndex), &slot);
+		UINT32 runLengthFactor = 0;
+		UINT32 suiteDepth = 0;
+
+		WINPR_ASSERT(startIndex >= 0);
+
+		/* The run is followed by at least one suite pixel of the same color */
+		while ((pixelIndex + runLengthFactor + 1 < pixelCount) &&
+		       (CLEAR_PIXEL_AT(pixelIndex + runLengthFactor + 1) ==
+		        palette->colors[startIndex]) &&
+		       (runLengthFactor < UINT32_MAX - 1))
+			runLengthFactor++;
+
+		pixelIndex += runLengthFactor + 1;
+
+		while ((suiteDepth < maxSuiteDepth) && (pixelIndex < pixelCount) &&
+		       (startIndex + suiteDepth + 1 < palette->count) &&
+		       (CLEAR_PIXEL_AT(pixelIndex) == palette->colors[startIndex + suiteDepth + 1]))
+		{
+			suiteDepth++;
+			pixelIndex++;
+		}
+
+		if (!Stream_EnsureRemainingCapacity(s, 1))
+			return FALSE;
+
+		Stream_Write_UINT8(s, (BYTE)((suiteDepth << numBits) | (startIndex + suiteDepth)));
+
+		if (!clear_write_run_length(s, runLengthFactor))
+			return FALSE;
+	}
+
+#undef CLEAR_PIXEL_AT
+
+	return TRUE;
+}
+
+static BOOL clear_compress_uncompressed(wStream* WINPR_RESTRICT s,
+                                        const UINT32* WINPR_RESTRICT pixels, UINT32 nStride,
+                                        UINT32 nWidth, UINT32 nHeight)
+{
+	if (!Stream_EnsureRemainingCapacity(s, 3ull * nWidth * nHeight))
+		return FALSE;
+
+	for (UINT32 y = 0; y < nHeight; y++)
+	{
+		const UINT32* row = &pixels[1ull * y * nStride];
+
+		for (UINT32 x = 0; x < nWidth; x++)
+		{
+			if (!clear_write_bgr(s, row[x]))
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static INLINE BOOL clear_vbar_equal(const CLEAR_VBAR_ENTRY* WINPR_RESTRICT entry,
+                                    const UINT32* WINPR_RESTRICT pixels, UINT32 count)
+{
+	if (!entry->pixels || (entry->count != count))
+		return FALSE;
+
+	return memcmp(entry->pixels, pixels, sizeof(UINT32) * count) == 0;
+}
+
+static INLINE BOOL clear_vbar_lookup(const CLEAR_VBAR_ENTRY* WINPR_RESTRICT storage,
+                                     const UINT32* WINPR_RESTRICT hashTable, size_t hashSize,
+                                     const UINT32* WINPR_RESTRICT pixels, UINT32 count,
+                                     UINT32* WINPR_RESTRICT pHash, UINT32* WINPR_RESTRICT pIndex)
+{
+	const UINT32 hash = clear_hash_pixels(pixels, count);
+	const UINT32 value = hashTable[hash % hashSize];
+
+	*pHash = hash;
+
+	if ((value == 0) || !clear_vbar_equal(&storage[value - 1], pixels, count))
+		return FALSE;
+
+	*pIndex = value - 1;
+	return TRUE;
+}
+
+static BOOL clear_vbar_store(CLEAR_CONTEXT* WINPR_RESTRICT clear,
+                             CLEAR_VBAR_ENTRY* WINPR_RESTRICT entry,
+                             const UINT32* WINPR_RESTRICT pixels, UINT32 count)
+{
+	entry->count = count;
+
+	if (!resize_vbar_entry(clear, entry))
+		return FALSE;
+
+	if (count > 0)
+		memcpy(entry->pixels, pixels, sizeof(UINT32) * count);
+
+	return TRUE;
+}
+
+static INLINE void clear_vbar_extract(const UINT32* WINPR_RESTRICT pixels, UINT32 nStride,
+                                      UINT32 x, UINT32 nHeight, UINT32 colorBkg,
+                                      UINT32* WINPR_RESTRICT vBar, UINT32* WINPR_RESTRICT pYOn,
+                                      UINT32* WINPR_RESTRICT pYOff)
+{
+	UINT32 yOn = nHeight;
+	UINT32 yOff = 0;
+
+	for (UINT32 y = 0; y < nHeight; y++)
+	{
+		vBar[y] = pixels[1ull * y * nStride + x];
+
+		if (vBar[y] != colorBkg)
+		{
+			yOn = MIN(yOn, y);
+			yOff = y + 1;
+		}
+	}
+
+	if (yOff == 0)
+		yOn = 0;
+
+	*pYOn = yOn;
+	*pYOff = yOff;
+}
+
+/**
+ * Estimate the size of a band without touching the vBar caches.
+ */
+static size_t clear_band_size(const CLEAR_CONTEXT* WINPR_RESTRICT clear,
+                              const UINT32* WINPR_RESTRICT pixels, UINT32 nStride, UINT32 nWidth,
+                              UINT32 nHeight, UINT32 colorBkg)
+{
+	size_t size = 11;
+	UINT32 vBar[CLEARCODEC_BAND_MAX_HEIGHT] = { 0 };
+
+	for (UINT32 x = 0; x < nWidth; x++)
+	{
+		UINT32 hash = 0;
+		UINT32 index = 0;
+		UINT32 yOn = 0;
+		UINT32 yOff = 0;
+
+		clear_vbar_extract(pixels, nStride, x, nHeight, colorBkg, vBar, &yOn, &yOff);
+
+		if (clear_vbar_lookup(clear->VBarStorage, clear->VBarHashTable, CLEARCODEC_VBAR_HASH_SIZE,
+		                      vBar, nHeight, &hash, &index))
+			size += 2;
+		else if (clear_vbar_lookup(clear->ShortVBarStorage, clear->ShortVBarHashTable,
+		                           CLEARCODEC_VBAR_SHORT_HASH_SIZE, &vBar[yOn], yOff - yOn, &hash,
+		                           &index))
+			size += 3;
+		else
+			size += 2ull + 3ull * (yOff - yOn);
+	}
+
+	return size;
+}
+
+static BOOL clear_compress_band(CLEAR_CONTEXT* WINPR_RESTRICT clear, wStream* WINPR_RESTRICT s,
+                                const UINT32* WINPR_RESTRICT pixels, UINT32 nStride,
+                                UINT32 nXStart, UINT32 nYStart, UINT32 nWidth, UINT32 nHeight,
+                                UINT32 colorBkg)
+{
+	UINT32 vBar[CLEARCODEC_BAND_MAX_HEIGHT] = { 0 };
+
+	WINPR_ASSERT(nHeight <= CLEARCODEC_BAND_MAX_HEIGHT);
+
+	if (!Stream_EnsureRemainingCapacity(s, 11))
+		return FALSE;
+
+	Stream_Write_UINT16(s, (UINT16)nXStart);                /* xStart */
+	Stream_Write_UINT16(s, (UINT16)(nXStart + nWidth - 1)); /* xEnd */
+	Stream_Write_UINT16(s, (UINT16)nYStart);                /* yStart */
+	Stream_Write_UINT16(s, (UINT16)(nYStart + nHeight - 1)); /* yEnd */
+
+	if (!clear_write_bgr(s, colorBkg))
+		return FALSE;
+
+	for (UINT32 x = 0; x < nWidth; x++)
+	{
+		UINT32 hash = 0;
+		UINT32 index = 0;
+		UINT32 yOn = 0;
+		UINT32 yOff = 0;
+
+		clear_vbar_extract(pixels, nStride, x, nHeight, colorBkg, vBar, &yOn, &yOff);
+
+		if (!Stream_EnsureRemainingCapacity(s, 3))
+			return FALSE;
+
+		if (clear_vbar_lookup(clear->VBarStorage, clear->VBarHashTable, CLEARCODEC_VBAR_HASH_SIZE,
+		                      vBar, nHeight, &hash, &index))
+		{
+			Stream_Write_UINT16(s, (UINT16)(0x8000 | index)); /* VBAR_CACHE_HIT */
+			continue;
+		}
+
+		const UINT32 vBarHash = hash;
+		const UINT32 count = yOff - yOn;
+
+		if (clear_vbar_lookup(clear->ShortVBarStorage, clear->ShortVBarHashTable,
+		                      CLEARCODEC_VBAR_SHORT_HASH_SIZE, &vBar[yOn], count, &hash, &index))
+		{
+			Stream_Write_UINT16(s, (UINT16)(0x4000 | index)); /* SHORT_VBAR_CACHE_HIT */
+			Stream_Write_UINT8(s, (BYTE)yOn);
+		}
+		else
+		{
+			Stream_Write_UINT16(s, (UINT16)((yOff << 8) | yOn)); /* SHORT_VBAR_CACHE_MISS */
+
+			for (UINT32 y = yOn; y < yOff; y++)
+			{
+				if (!clear_write_bgr(s, vBar[y]))
+					return FALSE;
+			}
+
+			/* Mirror the decoder, every miss is appended to the short vBar storage */
+			const UINT32 cursor = clear->ShortVBarStorageCursor;
+
+			if (!clear_vbar_store(clear, &clear->ShortVBarStorage[cursor], &vBar[yOn], count))
+				return FALSE;
+
+			clear->ShortVBarHashTable[hash % CLEARCODEC_VBAR_SHORT_HASH_SIZE] = cursor + 1;
+			clear->ShortVBarStorageCursor = (cursor + 1) % CLEARCODEC_VBAR_SHORT_SIZE;
+		}
+
+		/* ... and every short vBar reference creates a new vBar */
+		const UINT32 cursor = clear->VBarStorageCursor;
+
+		if (!clear_vbar_store(clear, &clear->VBarStorage[cursor], vBar, nHeight))
+			return FALSE;
+
+		clear->VBarHashTable[vBarHash % CLEARCODEC_VBAR_HASH_SIZE] = cursor + 1;
+		clear->VBarStorageCursor = (cursor + 1) % CLEARCODEC_VBAR_SIZE;
+	}
+
+	return TRUE;
+}
+
+static BOOL clear_write_subcodec(wStream* WINPR_RESTRICT s, UINT32 nXStart, UINT32 nYStart,
+                                 UINT32 nWidth, UINT32 nHeight, BYTE subcodecId,
+                                 wStream* WINPR_RESTRICT data)
+{
+	const size_t length = Stream_GetPosition(data);
+
+	if (length > UINT32_MAX)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, 13ull + length))
+		return FALSE;
+
+	Stream_Write_UINT16(s, (UINT16)nXStart);
+	Stream_Write_UINT16(s, (UINT16)nYStart);
+	Stream_Write_UINT16(s, (UINT16)nWidth);
+	Stream_Write_UINT16(s, (UINT16)nHeight);
+	Stream_Write_UINT32(s, (UINT32)length);
+	Stream_Write_UINT8(s, subcodecId);
+	Stream_Write(s, Stream_Buffer(data), length);
+	return TRUE;
+}
+
+/**
+ * Encode a cell of the bitmap as band or subcodec, or leave it to the residual layer,
+ * whichever is smallest.
+ */
+static BOOL clear_compress_cell(CLEAR_CONTEXT* WINPR_RESTRICT clear,
+                                const UINT32* WINPR_RESTRICT pixels, UINT32 nStride,
+                                UINT32 nXStart, UINT32 nYStart, UINT32 nWidth, UINT32 nHeight,
+                                BYTE* WINPR_RESTRICT pCellType)
+{
+	CLEAR_PALETTE palette = { 0 };
+	const UINT32* cell = &pixels[1ull * nYStart * nStride + nXStart];
+	size_t residualSize = 0;
+	size_t bandSize = SIZE_MAX;
+	size_t subcodecSize = 3ull * nWidth * nHeight;
+	BYTE subcodecId = 0; /* Uncompressed */
+	UINT32 colorBkg = 0;
+
+	/* Every color change in raster order starts a new residual run */
+	for (UINT32 y = 0; y < nHeight; y++)
+	{
+		const size_t offset = 1ull * (nYStart + y) * nStride + nXStart;
+
+		for (UINT32 x = 0; x < nWidth; x++)
+		{
+			if ((offset + x == 0) || (pixels[offset + x] != pixels[offset + x - 1]))
+				residualSize += 4;
+		}
+	}
+
+	Stream_SetPosition(clear->CellStream, 0);
+
+	if (clear_palette_build(&palette, cell, nStride, nWidth, nHeight))
+	{
+		UINT32 maxHits = 0;
+
+		for (UINT32 i = 0; i < palette.count; i++)
+		{
+			if (palette.hits[i] > maxHits)
+			{
+				maxHits = palette.hits[i];
+				colorBkg = palette.colors[i];
+			}
+		}
+
+		bandSize = clear_band_size(clear, cell, nStride, nWidth, nHeight, colorBkg);
+
+		if (!clear_compress_rlex(clear->CellStream, &palette, cell, nStride, nWidth, nHeight))
+			return FALSE;
+
+		subcodecId = 2; /* CLEARCODEC_SUBCODEC_RLEX */
+	}
+	else if (residualSize > subcodecSize / 2)
+	{
+		/* The NSCodec encoder expects bottom up bitmaps */
+		for (UINT32 y = 0; y < nHeight; y++)
+			memcpy(&clear->CellBuffer[1ull * (nHeight - 1 - y) * nWidth],
+			       &cell[1ull * y * nStride], sizeof(UINT32) * nWidth);
+
+		if (!nsc_compose_message(clear->nsc, clear->CellStream, (const BYTE*)clear->CellBuffer,
+		                         nWidth, nHeight, nWidth * sizeof(UINT32)))
+			return FALSE;
+
+		subcodecId = 1; /* NSCodec */
+	}
+
+	if (subcodecId != 0)
+	{
+		if (Stream_GetPosition(clear->CellStream) < subcodecSize)
+			subcodecSize = Stream_GetPosition(clear->CellStream);
+		else
+			subcodecId = 0;
+	}
+
+	subcodecSize += 13;
+
+	if ((residualSize <= bandSize) && (residualSize <= subcodecSize))
+	{
+		*pCellType = CLEAR_CELL_RESIDUAL;
+		return TRUE;
+	}
+
+	if (bandSize <= subcodecSize)
+	{
+		*pCellType = CLEAR_CELL_BAND;
+		return clear_compress_band(clear, clear->BandsStream, cell, nStride, nXStart, nYStart,
+		                           nWidth, nHeight, colorBkg);
+	}
+
+	*pCellType = CLEAR_CELL_SUBCODEC;
+
+	if (subcodecId == 0)
+	{
+		Stream_SetPosition(clear->CellStream, 0);
+
+		if (!clear_compress_uncompressed(clear->CellStream, cell, nStride, nWidth, nHeight))
+			return FALSE;
+	}
+
+	return clear_write_subcodec(clear->SubcodecStream, nXStart, nYStart, nWidth, nHeight,
+	                            subcodecId, clear->CellStream);
+}
+
+/**
+ * Run length encode the whole bitmap. Pixels of cells covered by bands or
+ * subcodecs are overwritten later by the decoder and just extend the current run.
+ */
+static BOOL clear_compress_residual(CLEAR_CONTEXT* WINPR_RESTRICT clear, wStream* WINPR_RESTRICT s,
+                                    const UINT32* WINPR_RESTRICT pixels, UINT32 nWidth,
+                                    UINT32 nHeight, UINT32 nCellsX)
+{
+	UINT32 color = pixels[0];
+	UINT32 runLengthFactor = 0;
+
+	for (UINT32 y = 0; y < nHeight; y++)
+	{
+		const size_t cellRow = y / CLEARCODEC_BAND_MAX_HEIGHT;
+		const BYTE* cellTypes = &clear->CellTypes[cellRow * nCellsX];
+		const UINT32* row = &pixels[1ull * y * nWidth];
+
+		for (UINT32 x = 0; x < nWidth; x++)
+		{
+			const BOOL covered = cellTypes[x / CLEARCODEC_CELL_WIDTH] != CLEAR_CELL_RESIDUAL;
+
+			if ((covered || (row[x] == color)) && (runLengthFactor < UINT32_MAX))
+			{
+				runLengthFactor++;
+				continue;
+			}
+
+			if (runLengthFactor > 0)
+			{
+				if (!clear_write_bgr(s, color) || !clear_write_run_length(s, runLengthFactor))
+					return FALSE;
+			}
+
+			color = row[x];
+			runLengthFactor = 1;
+		}
+	}
+
+	if (!clear_write_bgr(s, color))
+		return FALSE;
+
+	return clear_write_run_length(s, runLengthFactor);
+}
+
+static BOOL clear_compress_glyph(CLEAR_CONTEXT* WINPR_RESTRICT clear,
+                                 const UINT32* WINPR_RESTRICT pixels, UINT32 count,
+                                 BYTE* WINPR_RESTRICT pGlyphFlags, UINT16* WINPR_RESTRICT pIndex)
+{
+	const UINT32 hash = clear_hash_pixels(pixels, count);
+	UINT32* slot = &clear->GlyphHashTable[hash % CLEARCODEC_GLYPH_HASH_SIZE];
+
+	if (*slot != 0)
+	{
+		const CLEAR_GLYPH_ENTRY* glyphEntry = &clear->GlyphCache[*slot - 1];
+
+		if (glyphEntry->pixels && (glyphEntry->count == count) &&
+		    (memcmp(glyphEntry->pixels, pixels, sizeof(UINT32) * count) == 0))
+		{
+			*pGlyphFlags |= CLEARCODEC_FLAG_GLYPH_INDEX | CLEARCODEC_FLAG_GLYPH_HIT;
+			*pIndex = (UINT16)(*slot - 1);
+			return TRUE;
+		}
+	}
+
+	const UINT32 glyphIndex = clear->GlyphCursor;
+	CLEAR_GLYPH_ENTRY* glyphEntry = &clear->GlyphCache[glyphIndex];
+
+	if (count > glyphEntry->size)
+	{
+		UINT32* tmp = winpr_aligned_recalloc(glyphEntry->pixels, count, sizeof(UINT32), 32);
+
+		if (!tmp)
+			return FALSE;
+
+		glyphEntry->size = count;
+		glyphEntry->pixels = tmp;
+	}
+
+	glyphEntry->count = count;
+	memcpy(glyphEntry->pixels, pixels, sizeof(UINT32) * count);
+	*slot = glyphIndex + 1;
+	clear->GlyphCursor = (glyphIndex + 1) % ARRAYSIZE(clear->GlyphCache);
+
+	*pGlyphFlags |= CLEARCODEC_FLAG_GLYPH_INDEX;
+	*pIndex = (UINT16)glyphIndex;
+	return TRUE;
+}
+
+static BOOL clear_resize_cell_types(CLEAR_CONTEXT* WINPR_RESTRICT clear, size_t count)
+{
+	if (count > clear->CellTypesSize)
+	{
+		BYTE* tmp = realloc(clear->CellTypes, count);
+
+		if (!tmp)
+			return FALSE;
+
+		clear->CellTypes = tmp;
+		clear->CellTypesSize = count;
+	}
+
+	return TRUE;
+}
+
+BOOL clear_compress_to_stream(CLEAR_CONTEXT* WINPR_RESTRICT clear, wStream* WINPR_RESTRICT s,
+                              const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                              UINT32 nSrcStep, UINT32 nWidth, UINT32 nHeight)
+{
+	BYTE glyphFlags = 0;
+	UINT16 glyphIndex = 0;
+
+	if (!clear || !clear->Compressor || !s || !pSrcData)
+		return FALSE;
+
+	if ((nWidth == 0) || (nHeight == 0) || (nWidth > 0xFFFF) || (nHeight > 0xFFFF))
+		return FALSE;
+
+	if (!updateContextFormat(clear, PIXEL_FORMAT_BGRX32))
+		return FALSE;
+
+	if (!clear_resize_buffer(clear, nWidth, nHeight))
+		return FALSE;
+
+	/* Work on opaque BGRX32 pixels, these are also fed to the NSCodec encoder */
+	const UINT32 nTempStep = nWidth * FreeRDPGetBytesPerPixel(PIXEL_FORMAT_BGRX32);
+
+	if (!freerdp_image_copy_no_overlap(clear->TempBuffer, PIXEL_FORMAT_BGRX32, nTempStep, 0, 0,
+	                                   nWidth, nHeight, pSrcData, SrcFormat, nSrcStep, 0, 0, NULL,
+	                                   FREERDP_FLIP_NONE))
+		return FALSE;
+
+	for (size_t x = 3; x < 4ull * nWidth * nHeight; x += 4)
+		clear->TempBuffer[x] = 0xFF;
+
+	const UINT32* pixels = (const UINT32*)clear->TempBuffer;
+
+	if (clear->CacheResetPending)
+	{
+		glyphFlags |= CLEARCODEC_FLAG_CACHE_RESET;
+		clear_reset_vbar_storage(clear, FALSE);
+		memset(clear->VBarHashTable, 0, sizeof(UINT32) * CLEARCODEC_VBAR_HASH_SIZE);
+		memset(clear->ShortVBarHashTable, 0, sizeof(UINT32) * CLEARCODEC_VBAR_SHORT_HASH_SIZE);
+		clear->CacheResetPending = FALSE;
+	}
+
+	if (1ull * nWidth * nHeight <= CLEARCODEC_GLYPH_MAX_PIXELS)
+	{
+		if (!clear_compress_glyph(clear, pixels, nWidth * nHeight, &glyphFlags, &glyphIndex))
+			return FALSE;
+	}
+
+	if (!Stream_EnsureRemainingCapacity(s, 4))
+		return FALSE;
+
+	Stream_Write_UINT8(s, glyphFlags);
+	Stream_Write_UINT8(s, (BYTE)clear->seqNumber);
+	clear->seqNumber = (clear->seqNumber + 1) % 256;
+
+	if (glyphFlags & CLEARCODEC_FLAG_GLYPH_INDEX)
+		Stream_Write_UINT16(s, glyphIndex);
+
+	if (glyphFlags & CLEARCODEC_FLAG_GLYPH_HIT)
+		return TRUE;
+
+	const UINT32 nCellsX = (nWidth + CLEARCODEC_CELL_WIDTH - 1) / CLEARCODEC_CELL_WIDTH;
+	const UINT32 nCellsY = (nHeight + CLEARCODEC_BAND_MAX_HEIGHT - 1) / CLEARCODEC_BAND_MAX_HEIGHT;
+	BOOL residual = FALSE;
+
+	if (!clear_resize_cell_types(clear, 1ull * nCellsX * nCellsY))
+		return FALSE;
+
+	Stream_SetPosition(clear->ResidualStream, 0);
+	Stream_SetPosition(clear->BandsStream, 0);
+	Stream_SetPosition(clear->SubcodecStream, 0);
+
+	for (UINT32 cy = 0; cy < nCellsY; cy++)
+	{
+		const UINT32 y = cy * CLEARCODEC_BAND_MAX_HEIGHT;
+		const UINT32 h = MIN(CLEARCODEC_BAND_MAX_HEIGHT, nHeight - y);
+
+		for (UINT32 cx = 0; cx < nCellsX; cx++)
+		{
+			const UINT32 x = cx * CLEARCODEC_CELL_WIDTH;
+			const UINT32 w = MIN(CLEARCODEC_CELL_WIDTH, nWidth - x);
+			BYTE* cellType = &clear->CellTypes[1ull * cy * nCellsX + cx];
+
+			if (!clear_compress_cell(clear, pixels, nWidth, x, y, w, h, cellType))
+				return FALSE;
+
+			if (*cellType == CLEAR_CELL_RESIDUAL)
+				residual = TRUE;
+		}
+	}
+
+	if (residual)
+	{
+		if (!clear_compress_residual(clear, clear->ResidualStream, pixels, nWidth, nHeight,
+		                             nCellsX))
+			return FALSE;
+	}
+
+	const size_t residualByteCount = Stream_GetPosition(clear->ResidualStream);
+	const size_t bandsByteCount = Stream_GetPosition(clear->BandsStream);
+	const size_t subcodecByteCount = Stream_GetPosition(clear->SubcodecStream);
+
+	if ((residualByteCount > UINT32_MAX) || (bandsByteCount > UINT32_MAX) ||
+	    (subcodecByteCount > UINT32_MAX))
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, 12ull + residualByteCount + bandsByteCount +
+	                                           subcodecByteCount))
+		return FALSE;
+
+	Stream_Write_UINT32(s, (UINT32)residualByteCount);
+	Stream_Write_UINT32(s, (UINT32)bandsByteCount);
+	Stream_Write_UINT32(s, (UINT32)subcodecByteCount);
+	Stream_Write(s, Stream_Buffer(clear->ResidualStream), residualByteCount);
+	Stream_Write(s, Stream_Buffer(clear->BandsStream), bandsByteCount);
+	Stream_Write(s, Stream_Buffer(clear->SubcodecStream), subcodecByteCount);
+	return TRUE;
+}
+
 int clear_compress(CLEAR_CONTEXT* WINPR_RESTRICT clear, const BYTE* WINPR_RESTRICT pSrcData,
                    UINT32 SrcSize, BYTE** WINPR_RESTRICT ppDstData, UINT32* WINPR_RESTRICT pDstSize)
 {
-	WLog_ERR(TAG, "TODO: not implemented!");
-	return 1;
+	WLog_ERR(TAG, "missing bitmap geometry, use clear_compress_to_stream instead!");
+	return -1;
 }
 
 BOOL clear_context_reset(CLEAR_CONTEXT* WINPR_RESTRICT clear)
@@ -1167,10 +2158,16 @@ BOOL clear_context_reset(CLEAR_CONTEXT* WINPR_RESTRICT clear)
 	 * and its internal caches must NOT be reset on the ResetGraphics PDU.
 	 */
 	clear->seqNumber = 0;
+	clear->CacheResetPending = clear->Compressor;
 	return TRUE;
 }
 
 CLEAR_CONTEXT* clear_context_new(BOOL Compressor)
+{
+	return clear_context_new_ex(Compressor, THREADING_FLAGS_DISABLE_THREADS);
+}
+
+CLEAR_CONTEXT* clear_context_new_ex(BOOL Compressor, UINT32 ThreadingFlags)
 {
 	CLEAR_CONTEXT* clear = (CLEAR_CONTEXT*)winpr_aligned_calloc(1, sizeof(CLEAR_CONTEXT), 32);
 
@@ -1189,12 +2186,46 @@ CLEAR_CONTEXT* clear_context_new(BOOL Compressor)
 	if (!clear_resize_buffer(clear, 512, 512))
 		goto error_nsc;
 
+	if (Compressor)
+	{
+		clear->GlyphHashTable = calloc(CLEARCODEC_GLYPH_HASH_SIZE, sizeof(UINT32));
+		clear->VBarHashTable = calloc(CLEARCODEC_VBAR_HASH_SIZE, sizeof(UINT32));
+		clear->ShortVBarHashTable = calloc(CLEARCODEC_VBAR_SHORT_HASH_SIZE, sizeof(UINT32));
+		clear->ResidualStream = Stream_New(NULL, 4096);
+		clear->BandsStream = Stream_New(NULL, 4096);
+		clear->SubcodecStream = Stream_New(NULL, 4096);
+		clear->CellStream = Stream_New(NULL, 4096);
+
+		if (!clear->GlyphHashTable || !clear->VBarHashTable || !clear->ShortVBarHashTable ||
+		    !clear->ResidualStream || !clear->BandsStream || !clear->SubcodecStream ||
+		    !clear->CellStream)
+			goto error_nsc;
+	}
+
 	if (!clear->TempBuffer)
 		goto error_nsc;
 
 	if (!clear_context_reset(clear))
 		goto error_nsc;
 
+	clear->nthreads = 1;
+	if (!Compressor && !(ThreadingFlags & THREADING_FLAGS_DISABLE_THREADS))
+	{
+		SYSTEM_INFO sysInfos = { 0 };
+		GetNativeSystemInfo(&sysInfos);
+		clear->UseThreads = (sysInfos.dwNumberOfProcessors > 1);
+		if (clear->UseThreads)
+		{
+			clear->nthreads = sysInfos.dwNumberOfProcessors;
+			clear->ThreadPool = CreateThreadpool(NULL);
+			if (!clear->ThreadPool)
+				goto error_nsc;
+
+			InitializeThreadpoolEnvironment(&clear->ThreadPoolEnv);
+			SetThreadpoolCallbackPool(&clear->ThreadPoolEnv, clear->ThreadPool);
+		}
+	}
+
 	return clear;
 error_nsc:
 	WINPR_PRAGMA_DIAG_PUSH
@@ -1209,11 +2240,29 @@ void clear_context_free(CLEAR_CONTEXT* clear)
 	if (!clear)
 		return;
 
+	if (clear->UseThreads)
+	{
+		if (clear->ThreadPool)
+			CloseThreadpool(clear->ThreadPool);
+		DestroyThreadpoolEnvironment(&clear->ThreadPoolEnv);
+	}
+
 	nsc_context_free(clear->nsc);
 	winpr_aligned_free(clear->TempBuffer);
 
 	clear_reset_vbar_storage(clear, TRUE);
 	clear_reset_glyph_cache(clear);
 
+	free(clear->GlyphHashTable);
+	free(clear->VBarHashTable);
+	free(clear->ShortVBarHashTable);
+	free(clear->CellTypes);
+	Stream_Free(clear->ResidualStream, TRUE);
+	Stream_Free(clear->BandsStream, TRUE);
+	Stream_Free(clear->SubcodecStream, TRUE);
+	Stream_Free(clear->CellStream, TRUE);
+	free(clear->Bands);
+	winpr_aligned_free(clear->BandPixels);
+
 	winpr_aligned_free(clear);
 }
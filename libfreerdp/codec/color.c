@@ -943,10 +943,8 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 	if (nSrcStep == 0)
 		nSrcStep = nSrcWidth * FreeRDPGetBytesPerPixel(SrcFormat);
 
-#if defined(WITH_SWSCALE) || defined(WITH_CAIRO)
 	const BYTE* src = &pSrcData[nXSrc * FreeRDPGetBytesPerPixel(SrcFormat) + nYSrc * nSrcStep];
 	BYTE* dst = &pDstData[nXDst * FreeRDPGetBytesPerPixel(DstFormat) + nYDst * nDstStep];
-#endif
 
 	/* direct copy is much faster than scaling, so check if we can simply copy... */
 	if ((nDstWidth == nSrcWidth) && (nDstHeight == nSrcHeight))
@@ -955,7 +953,22 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 		                                     nDstHeight, pSrcData, SrcFormat, nSrcStep, nXSrc,
 		                                     nYSrc, NULL, FREERDP_FLIP_NONE);
 	}
-	else
+
+	/* the built in scaler works channel wise, so it handles any matching 32bpp format.
+	 * The alpha channel is carried over, so it must only differ if the destination ignores it. */
+	if ((FreeRDPGetBytesPerPixel(SrcFormat) == 4) && (FreeRDPGetBytesPerPixel(DstFormat) == 4) &&
+	    ((SrcFormat == DstFormat) || (FreeRDPAreColorFormatsEqualNoAlpha_int(SrcFormat, DstFormat) &&
+	                                  !FreeRDPColorHasAlpha(DstFormat))))
+	{
+		const prim_size_t srcRoi = { nSrcWidth, nSrcHeight };
+		const prim_size_t dstRoi = { nDstWidth, nDstHeight };
+		primitives_t* prims = primitives_get();
+
+		if (prims->scale_8u_AC4R(src, nSrcStep, &srcRoi, dst, nDstStep, &dstRoi) ==
+		    PRIMITIVES_SUCCESS)
+			return TRUE;
+	}
+
 #if defined(WITH_SWSCALE)
 	{
 		int res = 0;
@@ -1019,7 +1032,10 @@ BOOL freerdp_image_scale(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32
 	}
 #else
 	{
-		WLog_WARN(TAG, "SmartScaling requested but compiled without libcairo support!");
+		WLog_WARN(TAG, "SmartScaling of %s to %s requires libswscale or libcairo support!",
+		          FreeRDPGetColorFormatName(SrcFormat), FreeRDPGetColorFormatName(DstFormat));
+		WINPR_UNUSED(src);
+		WINPR_UNUSED(dst);
 	}
 #endif
 	return rc;
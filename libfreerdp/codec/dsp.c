@@ -29,6 +29,7 @@
 #include <freerdp/types.h>
 #include <freerdp/log.h>
 #include <freerdp/codec/dsp.h>
+#include <freerdp/primitives.h>
 
 #include "dsp.h"
 
@@ -61,6 +62,8 @@
 
 #if defined(WITH_SOXR)
 #include <soxr.h>
+#else
+#include <math.h>
 #endif
 
 #else
@@ -71,6 +74,36 @@
 
 #define TAG FREERDP_TAG("dsp")
 
+#if !defined(WITH_SOXR)
+/* filter bank rows, rate ratios with a larger numerator use the nearest row */
+#define DSP_RESAMPLE_MAX_PHASES 512
+/* filter length when upsampling, it grows with the decimation factor */
+#define DSP_RESAMPLE_TAPS 16
+#define DSP_RESAMPLE_MAX_TAPS 64
+#define DSP_RESAMPLE_PI 3.14159265358979323846
+
+/**
+ * Polyphase windowed sinc resampler for 16bit PCM. Each output frame is the
+ * dot product of taps input frames with the filter row of its phase, the
+ * input frames not consumed yet are carried over to the next call.
+ */
+typedef struct
+{
+	UINT32 srcRate;
+	UINT32 dstRate;
+	UINT32 channels;
+	UINT32 up;
+	UINT32 down;
+	UINT32 phases;
+	UINT32 taps;
+	UINT32 phase;
+	float* filter;
+	INT16* history;
+	size_t historyFrames;
+	size_t historyCapacity;
+} DSP_RESAMPLER;
+#endif
+
 typedef union
 {
 	struct
@@ -118,6 +151,8 @@ struct S_FREERDP_DSP_CONTEXT
 
 #if defined(WITH_SOXR)
 	soxr_t sox;
+#else
+	DSP_RESAMPLER resampler;
 #endif
 };
 
@@ -166,6 +201,13 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 		return TRUE;
 	}
 
+	if (samples > UINT32_MAX)
+		return FALSE;
+
+	/* 16bit samples go through the primitives when they are aligned */
+	const primitives_t* prims = primitives_get();
+	const BOOL aligned = (bpp == 2) && (((uintptr_t)src & 1) == 0);
+
 	Stream_SetPosition(context->common.channelmix, 0);
 
 	/* Destination has more channels than source */
@@ -177,13 +219,25 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 				if (!Stream_EnsureCapacity(context->common.channelmix, size * 2))
 					return FALSE;
 
-				for (size_t x = 0; x < samples; x++)
+				if (aligned)
 				{
-					for (size_t y = 0; y < bpp; y++)
-						Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
+					if (prims->monoToStereo_16s((const INT16*)src,
+					                            (INT16*)Stream_Buffer(context->common.channelmix),
+					                            (UINT32)samples) != PRIMITIVES_SUCCESS)
+						return FALSE;
 
-					for (size_t y = 0; y < bpp; y++)
-						Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
+					Stream_Seek(context->common.channelmix, samples * bpp * 2);
+				}
+				else
+				{
+					for (size_t x = 0; x < samples; x++)
+					{
+						for (size_t y = 0; y < bpp; y++)
+							Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
+
+						for (size_t y = 0; y < bpp; y++)
+							Stream_Write_UINT8(context->common.channelmix, src[x * bpp + y]);
+					}
 				}
 
 				Stream_SealLength(context->common.channelmix);
@@ -204,12 +258,30 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 			if (!Stream_EnsureCapacity(context->common.channelmix, size / 2))
 				return FALSE;
 
-			/* Simply drop second channel.
-			 * TODO: Calculate average */
-			for (size_t x = 0; x < samples; x++)
+			/* Average both channels */
+			if (aligned)
 			{
-				for (size_t y = 0; y < bpp; y++)
-					Stream_Write_UINT8(context->common.channelmix, src[2 * x * bpp + y]);
+				if (prims->stereoToMono_16s((const INT16*)src,
+				                            (INT16*)Stream_Buffer(context->common.channelmix),
+				                            (UINT32)samples) != PRIMITIVES_SUCCESS)
+					return FALSE;
+
+				Stream_Seek(context->common.channelmix, samples * bpp);
+			}
+			else if (bpp == 2)
+			{
+				for (size_t x = 0; x < samples; x++)
+				{
+					const INT32 sum = read_int16(&src[4 * x]) + read_int16(&src[4 * x + 2]);
+					Stream_Write_INT16(context->common.channelmix, (INT16)(sum >> 1));
+				}
+			}
+			else
+			{
+				/* 8bit PCM is unsigned */
+				for (size_t x = 0; x < samples; x++)
+					Stream_Write_UINT8(context->common.channelmix,
+					                   (BYTE)((src[2 * x] + src[2 * x + 1]) / 2));
 			}
 
 			Stream_SealLength(context->common.channelmix);
@@ -225,6 +297,197 @@ static BOOL freerdp_dsp_channel_mix(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	return FALSE;
 }
 
+#if !defined(WITH_SOXR)
+static void dsp_resampler_uninit(DSP_RESAMPLER* WINPR_RESTRICT resampler)
+{
+	WINPR_ASSERT(resampler);
+
+	free(resampler->filter);
+	free(resampler->history);
+
+	const DSP_RESAMPLER empty = { 0 };
+	*resampler = empty;
+}
+
+static UINT32 dsp_gcd(UINT32 a, UINT32 b)
+{
+	while (b != 0)
+	{
+		const UINT32 t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+static BOOL dsp_resampler_init(DSP_RESAMPLER* WINPR_RESTRICT resampler, UINT32 srcRate,
+                               UINT32 dstRate, UINT32 channels)
+{
+	WINPR_ASSERT(resampler);
+
+	if (resampler->filter && (resampler->srcRate == srcRate) &&
+	    (resampler->dstRate == dstRate) && (resampler->channels == channels))
+		return TRUE;
+
+	dsp_resampler_uninit(resampler);
+
+	if ((srcRate == 0) || (dstRate == 0) || (channels == 0))
+		return FALSE;
+
+	const UINT32 gcd = dsp_gcd(srcRate, dstRate);
+	const UINT32 up = dstRate / gcd;
+	const UINT32 down = srcRate / gcd;
+
+	/* stay below the lower nyquist frequency, a longer filter keeps the transition band narrow */
+	double cutoff = 0.9;
+	if (dstRate < srcRate)
+		cutoff *= (double)dstRate / srcRate;
+
+	UINT32 taps = (UINT32)ceil(DSP_RESAMPLE_TAPS * 0.9 / cutoff);
+	taps += taps & 1;
+	if (taps > DSP_RESAMPLE_MAX_TAPS)
+		taps = DSP_RESAMPLE_MAX_TAPS;
+
+	/* every output frame must advance by less than the filter length */
+	if (1ull * taps * up <= down)
+	{
+		WLog_ERR(TAG, "unsupported resampling ratio %" PRIu32 " -> %" PRIu32, srcRate, dstRate);
+		return FALSE;
+	}
+
+	resampler->srcRate = srcRate;
+	resampler->dstRate = dstRate;
+	resampler->channels = channels;
+	resampler->up = up;
+	resampler->down = down;
+	resampler->phases = (up > DSP_RESAMPLE_MAX_PHASES) ? DSP_RESAMPLE_MAX_PHASES : up;
+	resampler->taps = taps;
+	resampler->filter = calloc(1ull * resampler->phases * taps, sizeof(float));
+	if (!resampler->filter)
+		goto fail;
+
+	/* output frames lie between input frames center and center + 1 */
+	const double center = taps / 2.0 - 1.0;
+	const double halfWidth = taps / 2.0;
+
+	for (UINT32 p = 0; p < resampler->phases; p++)
+	{
+		float* row = &resampler->filter[1ull * p * taps];
+		const double frac = (double)p / resampler->phases;
+		double sum = 0.0;
+
+		for (UINT32 t = 0; t < taps; t++)
+		{
+			const double d = t - center - frac;
+			const double x = DSP_RESAMPLE_PI * d * cutoff;
+			const double sinc = (fabs(x) < 1e-9) ? 1.0 : sin(x) / x;
+			const double u = d / halfWidth;
+			double window = 0.0;
+
+			/* Blackman window */
+			if (fabs(u) < 1.0)
+				window = 0.42 + 0.5 * cos(DSP_RESAMPLE_PI * u) + 0.08 * cos(2.0 * DSP_RESAMPLE_PI * u);
+
+			row[t] = (float)(sinc * window);
+			sum += row[t];
+		}
+
+		/* unity gain for DC */
+		for (UINT32 t = 0; t < taps; t++)
+			row[t] = (float)(row[t] / sum);
+	}
+
+	/* prime with silence so the first output frame is aligned with the first input frame */
+	resampler->historyCapacity = taps;
+	resampler->history = calloc(1ull * resampler->historyCapacity * channels, sizeof(INT16));
+	if (!resampler->history)
+		goto fail;
+	resampler->historyFrames = (size_t)center;
+
+	return TRUE;
+fail:
+	dsp_resampler_uninit(resampler);
+	return FALSE;
+}
+
+static BOOL dsp_resampler_process(DSP_RESAMPLER* WINPR_RESTRICT resampler,
+                                  const BYTE* WINPR_RESTRICT src, size_t size,
+                                  wStream* WINPR_RESTRICT out)
+{
+	WINPR_ASSERT(resampler);
+	WINPR_ASSERT(resampler->filter);
+
+	const size_t channels = resampler->channels;
+	const size_t taps = resampler->taps;
+	const size_t frames = size / sizeof(INT16) / channels;
+	const size_t total = resampler->historyFrames + frames;
+
+	if (total > resampler->historyCapacity)
+	{
+		INT16* history = realloc(resampler->history, total * channels * sizeof(INT16));
+		if (!history)
+			return FALSE;
+		resampler->history = history;
+		resampler->historyCapacity = total;
+	}
+
+	memcpy(&resampler->history[resampler->historyFrames * channels], src,
+	       frames * channels * sizeof(INT16));
+
+	/* upper bound of the frames produced from total input frames */
+	const size_t maxFrames = total * resampler->up / resampler->down + 1;
+	Stream_SetPosition(out, 0);
+	if (!Stream_EnsureCapacity(out, maxFrames * channels * sizeof(INT16)))
+		return FALSE;
+
+	INT16* dst = Stream_BufferAs(out, INT16);
+	const INT16* history = resampler->history;
+	UINT32 phase = resampler->phase;
+	size_t index = 0;
+	size_t count = 0;
+
+	while (index + taps <= total)
+	{
+		const size_t row = (resampler->phases == resampler->up)
+		                       ? phase
+		                       : (1ull * phase * resampler->phases / resampler->up);
+		const float* coeffs = &resampler->filter[row * taps];
+
+		for (size_t c = 0; c < channels; c++)
+		{
+			const INT16* in = &history[index * channels + c];
+			float acc = 0.0f;
+
+			for (size_t t = 0; t < taps; t++)
+				acc += coeffs[t] * in[t * channels];
+
+			acc = (acc >= 0.0f) ? acc + 0.5f : acc - 0.5f;
+			if (acc > INT16_MAX)
+				acc = INT16_MAX;
+			else if (acc < INT16_MIN)
+				acc = INT16_MIN;
+			dst[count * channels + c] = (INT16)acc;
+		}
+
+		count++;
+		phase += resampler->down;
+		index += phase / resampler->up;
+		phase %= resampler->up;
+	}
+
+	/* the step is shorter than the filter, so index never passes total */
+	WINPR_ASSERT(index <= total);
+	memmove(resampler->history, &history[index * channels],
+	        (total - index) * channels * sizeof(INT16));
+	resampler->historyFrames = total - index;
+	resampler->phase = phase;
+
+	Stream_SetLength(out, count * channels * sizeof(INT16));
+	return TRUE;
+}
+#endif
+
 /**
  * Microsoft Multimedia Standards Update
  * http://download.microsoft.com/download/9/8/6/9863C72A-A3AA-4DDB-B1BA-CA8D17EFD2D4/RIFFNEW.pdf
@@ -292,8 +555,24 @@ static BOOL freerdp_dsp_resample(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	*length = Stream_Length(context->common.resample);
 	return (error == 0) ? TRUE : FALSE;
 #else
-	WLog_ERR(TAG, "Missing resample support, recompile -DWITH_SOXR=ON or -DWITH_DSP_FFMPEG=ON");
-	return FALSE;
+	if ((srcFormat->wBitsPerSample != 16) || (context->common.format.wBitsPerSample != 16))
+	{
+		WLog_ERR(TAG, "Resampling %" PRIu16 " to %" PRIu16
+		              " bit PCM requires -DWITH_SOXR=ON or -DWITH_DSP_FFMPEG=ON",
+		         srcFormat->wBitsPerSample, context->common.format.wBitsPerSample);
+		return FALSE;
+	}
+
+	if (!dsp_resampler_init(&context->resampler, srcFormat->nSamplesPerSec,
+	                        context->common.format.nSamplesPerSec, srcFormat->nChannels))
+		return FALSE;
+
+	if (!dsp_resampler_process(&context->resampler, src, size, context->common.resample))
+		return FALSE;
+
+	*data = Stream_Buffer(context->common.resample);
+	*length = Stream_Length(context->common.resample);
+	return TRUE;
 #endif
 }
 
@@ -621,7 +900,7 @@ static BOOL freerdp_dsp_decode_opus(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 
 	/* Max packet duration is 120ms (5760 at 48KHz) */
 	max_size = OPUS_MAX_FRAMES * context->common.format.nChannels * sizeof(int16_t);
-	if (!Stream_EnsureRemainingCapacity(context->common.buffer, max_size))
+	if (!Stream_EnsureRemainingCapacity(out, max_size))
 		return FALSE;
 
 	frames = opus_decode(context->opus_decoder, src, size, Stream_Pointer(out), OPUS_MAX_FRAMES, 0);
@@ -637,21 +916,51 @@ static BOOL freerdp_dsp_encode_opus(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
                                     const BYTE* WINPR_RESTRICT src, size_t size,
                                     wStream* WINPR_RESTRICT out)
 {
-	if (!context || !src || !out)
+	/* the frame durations opus accepts, in 1/10 ms, longest first */
+	const UINT32 durations[] = { 600, 400, 200, 100, 50, 25 };
+
+	if (!context || !src || !out || !context->opus_encoder)
 		return FALSE;
 
+	const size_t frame_size = sizeof(opus_int16) * context->common.format.nChannels;
+	wStream* buffer = context->common.buffer;
+
+	/* input that does not fill a valid frame is kept for the next call */
+	if (!Stream_EnsureRemainingCapacity(buffer, size))
+		return FALSE;
+	Stream_Write(buffer, src, size);
+
+	const size_t buffered = Stream_GetPosition(buffer) / frame_size;
+	size_t frames = 0;
+
+	for (size_t x = 0; x < ARRAYSIZE(durations); x++)
+	{
+		const size_t count = 1ull * context->common.format.nSamplesPerSec * durations[x] / 10000;
+		if (count <= buffered)
+		{
+			frames = count;
+			break;
+		}
+	}
+
+	if (frames == 0)
+		return TRUE;
+
 	/* Max packet duration is 120ms (5760 at 48KHz) */
-	const size_t max_size = OPUS_MAX_FRAMES * context->common.format.nChannels * sizeof(int16_t);
-	if (!Stream_EnsureRemainingCapacity(context->common.buffer, max_size))
+	const size_t max_size = OPUS_MAX_FRAMES * frame_size;
+	if (!Stream_EnsureRemainingCapacity(out, max_size))
 		return FALSE;
 
-	const int src_frames = size / sizeof(opus_int16) / context->common.format.nChannels;
-	const opus_int16* src_data = (const opus_int16*)src;
-	const int frames =
-	    opus_encode(context->opus_encoder, src_data, src_frames, Stream_Pointer(out), max_size);
-	if (frames < 0)
+	const opus_int32 rc = opus_encode(context->opus_encoder, Stream_BufferAs(buffer, opus_int16),
+	                                  (int)frames, Stream_Pointer(out), (opus_int32)max_size);
+	if (rc < 0)
 		return FALSE;
-	return Stream_SafeSeek(out, frames * context->common.format.nChannels * sizeof(int16_t));
+
+	const size_t consumed = frames * frame_size;
+	const size_t remaining = Stream_GetPosition(buffer) - consumed;
+	memmove(Stream_Buffer(buffer), Stream_Buffer(buffer) + consumed, remaining);
+	Stream_SetPosition(buffer, remaining);
+	return Stream_SafeSeek(out, (size_t)rc);
 }
 #endif
 
@@ -1231,6 +1540,8 @@ void freerdp_dsp_context_free(FREERDP_DSP_CONTEXT* context)
 #endif
 #if defined(WITH_SOXR)
 		soxr_delete(context->sox);
+#else
+		dsp_resampler_uninit(&context->resampler);
 #endif
 	    free(context);
 
@@ -1458,6 +1769,19 @@ BOOL freerdp_dsp_supports_format(const AUDIO_FORMAT* WINPR_RESTRICT format, BOOL
 #endif
 }
 
+BOOL freerdp_dsp_context_set_encoder_params(FREERDP_DSP_CONTEXT* context, UINT32 bitrate,
+                                            UINT32 complexity)
+{
+	FREERDP_DSP_COMMON_CONTEXT* ctx = (FREERDP_DSP_COMMON_CONTEXT*)context;
+
+	if (!ctx || (complexity > 10))
+		return FALSE;
+
+	ctx->bitrate = bitrate;
+	ctx->complexity = complexity;
+	return TRUE;
+}
+
 BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
                                const AUDIO_FORMAT* WINPR_RESTRICT targetFormat,
                                UINT32 FramesPerPacket)
@@ -1507,6 +1831,9 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 		{
 			int opus_error = OPUS_OK;
 
+			if (context->opus_decoder)
+				opus_decoder_destroy(context->opus_decoder);
+
 			context->opus_decoder =
 			    opus_decoder_create(context->common.format.nSamplesPerSec,
 			                        context->common.format.nChannels, &opus_error);
@@ -1516,6 +1843,10 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 		else
 		{
 			int opus_error = OPUS_OK;
+			opus_int32 bitrate = (opus_int32)(context->common.format.nAvgBytesPerSec * 8);
+
+			if (context->opus_encoder)
+				opus_encoder_destroy(context->opus_encoder);
 
 			context->opus_encoder = opus_encoder_create(context->common.format.nSamplesPerSec,
 			                                            context->common.format.nChannels,
@@ -1523,11 +1854,24 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 			if (opus_error != OPUS_OK)
 				return FALSE;
 
-			opus_error =
-			    opus_encoder_ctl(context->opus_encoder,
-			                     OPUS_SET_BITRATE(context->common.format.nAvgBytesPerSec * 8));
+			if (context->common.bitrate > 0)
+				bitrate = (opus_int32)context->common.bitrate;
+
+			opus_error = opus_encoder_ctl(context->opus_encoder, OPUS_SET_BITRATE(bitrate));
 			if (opus_error != OPUS_OK)
 				return FALSE;
+
+			if (context->common.complexity > 0)
+			{
+				opus_error = opus_encoder_ctl(
+				    context->opus_encoder,
+				    OPUS_SET_COMPLEXITY((opus_int32)context->common.complexity));
+				if (opus_error != OPUS_OK)
+					return FALSE;
+			}
+
+			/* input not yet encoded belongs to the previous format */
+			Stream_SetPosition(context->common.buffer, 0);
 		}
 	}
 
@@ -1560,6 +1904,10 @@ BOOL freerdp_dsp_context_reset(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context,
 	}
 
 #endif
+#if !defined(WITH_SOXR)
+	/* drop the frames buffered for the previous format */
+	dsp_resampler_uninit(&context->resampler);
+#endif
 #if defined(WITH_SOXR)
 	{
 		soxr_io_spec_t iospec = soxr_io_spec(SOXR_INT16, SOXR_INT16);
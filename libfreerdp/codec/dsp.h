@@ -32,6 +32,8 @@ typedef struct
 	ALIGN64 wStream* buffer;
 	ALIGN64 wStream* resample;
 	ALIGN64 wStream* channelmix;
+	ALIGN64 UINT32 bitrate;
+	ALIGN64 UINT32 complexity;
 #if defined(WITH_FDK_AAC)
 	ALIGN64 BOOL fdkSetup;
 	ALIGN64 void* fdkAacInstance;
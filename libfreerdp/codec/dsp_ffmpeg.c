@@ -276,6 +276,10 @@ static BOOL ffmpeg_open_context(FREERDP_DSP_CONTEXT* WINPR_RESTRICT context)
 	context->context->sample_rate = (int)format->nSamplesPerSec;
 	context->context->block_align = format->nBlockAlign;
 	context->context->bit_rate = format->nAvgBytesPerSec * 8LL;
+	if (context->common.bitrate > 0)
+		context->context->bit_rate = context->common.bitrate;
+	if (context->common.complexity > 0)
+		context->context->compression_level = (int)context->common.complexity;
 	context->context->sample_fmt = ffmpeg_sample_format(format);
 	context->context->time_base = av_make_q(1, context->context->sample_rate);
 
@@ -25,6 +25,7 @@
 #include <winpr/library.h>
 #include <winpr/bitstream.h>
 #include <winpr/synch.h>
+#include <winpr/pool.h>
 
 #include <freerdp/primitives.h>
 #include <freerdp/codec/h264.h>
@@ -32,11 +33,19 @@
 #include <freerdp/log.h>
 
 #include "h264.h"
+#include "../core/probes.h"
 
 #define TAG FREERDP_TAG("codec")
 
 static BOOL avc444_ensure_buffer(H264_CONTEXT* h264, DWORD nDstHeight);
 
+/* Planes are only reallocated when the frame size changes, the content is not kept */
+static BYTE* h264_plane_realloc(BYTE* plane, size_t size)
+{
+	winpr_large_free(plane);
+	return winpr_large_calloc(size, 1, 16);
+}
+
 BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width, UINT32 height)
 {
 	BOOL isNull = FALSE;
@@ -76,14 +85,10 @@ BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width, UINT3
 
 		for (size_t x = 0; x < 3; x++)
 		{
-			BYTE* tmp1 = winpr_aligned_recalloc(h264->pYUVData[x], h264->iStride[x], pheight, 16);
-			BYTE* tmp2 =
-			    winpr_aligned_recalloc(h264->pOldYUVData[x], h264->iStride[x], pheight, 16);
-			if (tmp1)
-				h264->pYUVData[x] = tmp1;
-			if (tmp2)
-				h264->pOldYUVData[x] = tmp2;
-			if (!tmp1 || !tmp2)
+			const size_t size = 1ull * h264->iStride[x] * pheight;
+			h264->pYUVData[x] = h264_plane_realloc(h264->pYUVData[x], size);
+			h264->pOldYUVData[x] = h264_plane_realloc(h264->pOldYUVData[x], size);
+			if (!h264->pYUVData[x] || !h264->pOldYUVData[x])
 				return FALSE;
 		}
 	}
@@ -91,17 +96,94 @@ BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width, UINT3
 	return TRUE;
 }
 
-INT32 avc420_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize, BYTE* pDstData,
-                        DWORD DstFormat, UINT32 nDstStep, UINT32 nDstWidth, UINT32 nDstHeight,
+INT32 avc420_decompress_yuv(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize,
+                            const BYTE* pYUVData[3], UINT32 iStride[3])
+{
+	if (!h264 || h264->Compressor || !pYUVData || !iStride)
+		return -1001;
+
+	h264->exportFrame = h264->HwFrameExport && h264->subsystem->Transfer;
+	h264->frameExported = FALSE;
+	h264->renderFrame = (h264->outputWindow != NULL);
+	h264->frameRendered = FALSE;
+	const int status = h264->subsystem->Decompress(h264, pSrcData, SrcSize);
+	h264->exportFrame = FALSE;
+	h264->renderFrame = FALSE;
+
+	if (status <= 0)
+		return status;
+
+	const BOOL noPlanes = h264->frameExported || h264->frameRendered;
+	for (size_t x = 0; x < 3; x++)
+	{
+		pYUVData[x] = noPlanes ? NULL : h264->pYUVData[x];
+		iStride[x] = noPlanes ? 0 : h264->iStride[x];
+	}
+
+	return 1;
+}
+
+BOOL h264_get_dmabuf_frame(H264_CONTEXT* h264, H264_DMABUF_FRAME* frame)
+{
+	if (!h264 || !frame || !h264->frameExported)
+		return FALSE;
+
+	*frame = h264->dmabuf;
+	return TRUE;
+}
+
+BOOL h264_context_set_output_window(H264_CONTEXT* h264, void* window)
+{
+	if (!h264 || h264->Compressor)
+		return FALSE;
+
+	h264->outputWindow = window;
+	return TRUE;
+}
+
+BOOL h264_get_frame_rendered(H264_CONTEXT* h264)
+{
+	if (!h264)
+		return FALSE;
+	return h264->frameRendered;
+}
+
+BOOL avc420_convert_yuv(H264_CONTEXT* h264, BYTE* pDstData, DWORD DstFormat, UINT32 nDstStep,
                         const RECTANGLE_16* regionRects, UINT32 numRegionRects)
 {
-	int status = 0;
 	const BYTE* pYUVData[3];
 
 	if (!h264 || h264->Compressor)
-		return -1001;
+		return FALSE;
+
+	/* The frame went straight to the output window, there is nothing to read back */
+	if (h264->frameRendered)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "the frame was rendered to the output window");
+		return FALSE;
+	}
 
-	status = h264->subsystem->Decompress(h264, pSrcData, SrcSize);
+	if (h264->frameExported)
+	{
+		if (!h264->subsystem->Transfer(h264))
+			return FALSE;
+		h264->frameExported = FALSE;
+	}
+
+	pYUVData[0] = h264->pYUVData[0];
+	pYUVData[1] = h264->pYUVData[1];
+	pYUVData[2] = h264->pYUVData[2];
+	return yuv420_context_decode(h264->yuv, pYUVData, h264->iStride, h264->height, DstFormat,
+	                             pDstData, nDstStep, regionRects, numRegionRects);
+}
+
+INT32 avc420_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize, BYTE* pDstData,
+                        DWORD DstFormat, UINT32 nDstStep, UINT32 nDstWidth, UINT32 nDstHeight,
+                        const RECTANGLE_16* regionRects, UINT32 numRegionRects)
+{
+	const BYTE* pYUVData[3] = { 0 };
+	UINT32 iStride[3] = { 0 };
+	const INT32 status = avc420_decompress_yuv(h264, pSrcData, SrcSize, pYUVData, iStride);
 
 	if (status == 0)
 		return 1;
@@ -109,11 +191,7 @@ INT32 avc420_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT32 SrcSize
 	if (status < 0)
 		return status;
 
-	pYUVData[0] = h264->pYUVData[0];
-	pYUVData[1] = h264->pYUVData[1];
-	pYUVData[2] = h264->pYUVData[2];
-	if (!yuv420_context_decode(h264->yuv, pYUVData, h264->iStride, h264->height, DstFormat,
-	                           pDstData, nDstStep, regionRects, numRegionRects))
+	if (!avc420_convert_yuv(h264, pDstData, DstFormat, nDstStep, regionRects, numRegionRects))
 		return -1002;
 
 	return 1;
@@ -232,95 +310,345 @@ static BOOL detect_changes(BOOL firstFrameDone, const UINT32 QP, const RECTANGLE
 	return TRUE;
 }
 
+/* A tile gains H264_ROI_ACTIVITY_STEP per changed frame and loses one per unchanged frame,
+ * tiles at or above H264_ROI_VIDEO_ACTIVITY have been changing continuously */
+#define H264_ROI_ACTIVITY_STEP 2
+#define H264_ROI_ACTIVITY_MAX 32
+#define H264_ROI_VIDEO_ACTIVITY 16
+#define H264_ROI_DEFAULT_QP 26
+#define H264_ROI_TEXT_QP_DELTA (-4)
+#define H264_ROI_VIDEO_QP_DELTA 6
+
+/* Sharp luma edges on every other line, text and UI elements have a lot of them */
+static BOOL roi_tile_is_text(const RECTANGLE_16* WINPR_RESTRICT rect,
+                             const BYTE* WINPR_RESTRICT pY, UINT32 stride)
+{
+	size_t edges = 0;
+	size_t samples = 0;
+
+	for (size_t y = rect->top; y < rect->bottom; y += 2)
+	{
+		const BYTE* line = &pY[y * stride];
+
+		for (size_t x = rect->left + 1; x < rect->right; x++)
+		{
+			const int d = line[x] - line[x - 1];
+			if ((d > 63) || (d < -63))
+				edges++;
+		}
+		samples += rect->right - rect->left;
+	}
+
+	return edges * 16 > samples;
+}
+
+static UINT32 roi_clamp_qp(INT64 qp)
+{
+	if (qp < 0)
+		return 0;
+	if (qp > 51)
+		return 51;
+	return (UINT32)qp;
+}
+
+static BOOL avc420_apply_roi(H264_CONTEXT* WINPR_RESTRICT h264, BYTE* pYUVData[3],
+                             RDPGFX_H264_METABLOCK* WINPR_RESTRICT meta)
+{
+	const size_t tw = (h264->width + 63) / 64;
+	const size_t th = (h264->height + 63) / 64;
+
+	if (h264->roiTiles != tw * th)
+	{
+		BYTE* tmp = realloc(h264->roiActivity, tw * th);
+		if (!tmp)
+			return FALSE;
+		memset(tmp, 0, tw * th);
+		h264->roiActivity = tmp;
+		h264->roiTiles = tw * th;
+	}
+
+	h264->roiBaseQP = (h264->QP > 0) ? h264->QP : H264_ROI_DEFAULT_QP;
+
+	/* Decay every tile, changed ones are bumped back up below */
+	for (size_t x = 0; x < h264->roiTiles; x++)
+	{
+		if (h264->roiActivity[x] > 0)
+			h264->roiActivity[x]--;
+	}
+
+	for (size_t x = 0; x < meta->numRegionRects; x++)
+	{
+		const RECTANGLE_16* rect = &meta->regionRects[x];
+		RDPGFX_H264_QUANT_QUALITY* cur = &meta->quantQualityVals[x];
+		INT64 qp = h264->roiBaseQP;
+		BYTE activity = 0;
+
+		/* The first frame is a single region covering the whole surface */
+		const size_t tx = rect->left / 64;
+		const size_t ty = rect->top / 64;
+		if ((tx < tw) && (ty < th) && (rect->right - rect->left <= 64) &&
+		    (rect->bottom - rect->top <= 64))
+		{
+			BYTE* tile = &h264->roiActivity[ty * tw + tx];
+			activity = (BYTE)MIN(H264_ROI_ACTIVITY_MAX, *tile + 1 + H264_ROI_ACTIVITY_STEP);
+			*tile = activity;
+		}
+
+		if (activity >= H264_ROI_VIDEO_ACTIVITY)
+			qp += H264_ROI_VIDEO_QP_DELTA;
+		else if ((activity <= 1 + H264_ROI_ACTIVITY_STEP) ||
+		         roi_tile_is_text(rect, pYUVData[0], h264->iStride[0]))
+			qp += H264_ROI_TEXT_QP_DELTA;
+
+		cur->qp = (UINT8)roi_clamp_qp(qp);
+		cur->qualityVal = 100 - (cur->qp & 0x3F);
+	}
+
+	return TRUE;
+}
+
+static void avc420_select_buffers(H264_CONTEXT* WINPR_RESTRICT h264, BYTE* pYUVData[3],
+                                  BYTE* pOldYUVData[3])
+{
+	WINPR_ASSERT(h264);
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		if (h264->encodingBuffer)
+		{
+			pYUVData[x] = h264->pYUVData[x];
+			pOldYUVData[x] = h264->pOldYUVData[x];
+		}
+		else
+		{
+			pYUVData[x] = h264->pOldYUVData[x];
+			pOldYUVData[x] = h264->pYUVData[x];
+		}
+	}
+}
+
+static INT32 avc420_compress_planes(H264_CONTEXT* WINPR_RESTRICT h264, BYTE* pYUVData[3],
+                                    BYTE* pOldYUVData[3], const RECTANGLE_16* regionRect,
+                                    BYTE** ppDstData, UINT32* pDstSize,
+                                    RDPGFX_H264_METABLOCK* meta)
+{
+	INT32 rc = -1;
+	const BYTE* pcYUVData[3] = { pYUVData[0], pYUVData[1], pYUVData[2] };
+
+	if (!detect_changes(h264->firstLumaFrameDone, h264->QP, regionRect, pYUVData, pOldYUVData,
+	                    h264->iStride, meta))
+		goto fail;
+
+	if (meta->numRegionRects == 0)
+	{
+		rc = 0;
+		goto fail;
+	}
+
+	if (h264->RoiEnabled)
+	{
+		if (!avc420_apply_roi(h264, pYUVData, meta))
+			goto fail;
+		h264->roiMeta = meta;
+	}
+
+	rc = h264->subsystem->Compress(h264, pcYUVData, h264->iStride, ppDstData, pDstSize);
+	h264->roiMeta = NULL;
+	if (rc >= 0)
+		h264->firstLumaFrameDone = TRUE;
+
+fail:
+	if (rc < 0)
+		free_h264_metablock(meta);
+	return rc;
+}
+
 INT32 h264_get_yuv_buffer(H264_CONTEXT* h264, UINT32 nSrcStride, UINT32 nSrcWidth,
                           UINT32 nSrcHeight, BYTE* YUVData[3], UINT32 stride[3])
 {
+	BYTE* pOldYUVData[3] = { 0 };
+
 	if (!h264 || !h264->Compressor || !h264->subsystem || !h264->subsystem->Compress)
 		return -1;
 
 	if (!avc420_ensure_buffer(h264, nSrcStride, nSrcWidth, nSrcHeight))
 		return -1;
 
+	avc420_select_buffers(h264, YUVData, pOldYUVData);
 	for (size_t x = 0; x < 3; x++)
-	{
-		YUVData[x] = h264->pYUVData[x];
 		stride[x] = h264->iStride[x];
-	}
 
 	return 0;
 }
 
 INT32 h264_compress(H264_CONTEXT* h264, BYTE** ppDstData, UINT32* pDstSize)
 {
+	BYTE* pYUVData[3] = { 0 };
+	BYTE* pOldYUVData[3] = { 0 };
+
 	if (!h264 || !h264->Compressor || !h264->subsystem || !h264->subsystem->Compress)
 		return -1;
 
-	const BYTE* pcYUVData[3] = { h264->pYUVData[0], h264->pYUVData[1], h264->pYUVData[2] };
+	avc420_select_buffers(h264, pYUVData, pOldYUVData);
+
+	const BYTE* pcYUVData[3] = { pYUVData[0], pYUVData[1], pYUVData[2] };
 
 	return h264->subsystem->Compress(h264, pcYUVData, h264->iStride, ppDstData, pDstSize);
 }
 
+static INT32 avc420_compress_int(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
+                                 UINT32 nSrcStep, UINT32 nSrcWidth, UINT32 nSrcHeight,
+                                 const RECTANGLE_16* regionRect, BYTE** ppDstData,
+                                 UINT32* pDstSize, RDPGFX_H264_METABLOCK* meta)
+{
+	BYTE* pYUVData[3] = { 0 };
+	BYTE* pOldYUVData[3] = { 0 };
+
+	if (!h264 || !regionRect || !meta || !h264->Compressor)
+		return -1;
+
+	if (!h264->subsystem->Compress)
+		return -1;
+
+	if (!avc420_ensure_buffer(h264, nSrcStep, nSrcWidth, nSrcHeight))
+		return -1;
+
+	avc420_select_buffers(h264, pYUVData, pOldYUVData);
+	h264->encodingBuffer = !h264->encodingBuffer;
+
+	if (!yuv420_context_encode(h264->yuv, pSrcData, nSrcStep, SrcFormat, h264->iStride, pYUVData,
+	                           regionRect, 1))
+	{
+		free_h264_metablock(meta);
+		return -1;
+	}
+
+	return avc420_compress_planes(h264, pYUVData, pOldYUVData, regionRect, ppDstData, pDstSize,
+	                              meta);
+}
+
 INT32 avc420_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
                       UINT32 nSrcWidth, UINT32 nSrcHeight, const RECTANGLE_16* regionRect,
                       BYTE** ppDstData, UINT32* pDstSize, RDPGFX_H264_METABLOCK* meta)
 {
-	INT32 rc = -1;
+	FREERDP_PROBE2(avc420_encode_entry, nSrcWidth, nSrcHeight);
+	const INT32 rc = avc420_compress_int(h264, pSrcData, SrcFormat, nSrcStep, nSrcWidth,
+	                                     nSrcHeight, regionRect, ppDstData, pDstSize, meta);
+	FREERDP_PROBE2(avc420_encode_exit, rc, ((rc >= 0) && pDstSize) ? *pDstSize : 0);
+	return rc;
+}
+
+INT32 avc420_compress_yuv(H264_CONTEXT* h264, const RECTANGLE_16* regionRect, BYTE** ppDstData,
+                          UINT32* pDstSize, RDPGFX_H264_METABLOCK* meta)
+{
 	BYTE* pYUVData[3] = { 0 };
-	const BYTE* pcYUVData[3] = { 0 };
 	BYTE* pOldYUVData[3] = { 0 };
 
 	if (!h264 || !regionRect || !meta || !h264->Compressor)
 		return -1;
 
-	if (!h264->subsystem->Compress)
+	if (!h264->subsystem || !h264->subsystem->Compress)
 		return -1;
 
-	if (!avc420_ensure_buffer(h264, nSrcStep, nSrcWidth, nSrcHeight))
+	if ((regionRect->right > h264->width) || (regionRect->bottom > h264->height))
 		return -1;
 
-	if (h264->encodingBuffer)
+	avc420_select_buffers(h264, pYUVData, pOldYUVData);
+	for (size_t x = 0; x < 3; x++)
 	{
-		for (size_t x = 0; x < 3; x++)
-		{
-			pYUVData[x] = h264->pYUVData[x];
-			pOldYUVData[x] = h264->pOldYUVData[x];
-		}
+		if (!pYUVData[x] || !pOldYUVData[x])
+			return -1;
 	}
-	else
+	h264->encodingBuffer = !h264->encodingBuffer;
+
+	return avc420_compress_planes(h264, pYUVData, pOldYUVData, regionRect, ppDstData, pDstSize,
+	                              meta);
+}
+
+typedef struct
+{
+	H264_CONTEXT* h264;
+	const BYTE* pYUVData[3];
+	const UINT32* pStride;
+	BYTE* coded;
+	UINT32 codedSize;
+	int rc;
+} AVC444_ENCODE_JOB;
+
+static void avc444_compress_work_callback(PVOID context, size_t index)
+{
+	AVC444_ENCODE_JOB* job = &((AVC444_ENCODE_JOB*)context)[index];
+
+	WINPR_ASSERT(job->h264);
+	job->rc = job->h264->subsystem->Compress(job->h264, job->pYUVData, job->pStride, &job->coded,
+	                                         &job->codedSize);
+}
+
+/* The auxiliary stream has its own reference frames, encode it with its own context */
+static H264_CONTEXT* avc444_get_auxiliary(H264_CONTEXT* WINPR_RESTRICT h264)
+{
+	if (!h264->auxiliary)
 	{
-		for (size_t x = 0; x < 3; x++)
+		h264->auxiliary = h264_context_new(TRUE);
+		if (!h264->auxiliary)
 		{
-			pYUVData[x] = h264->pOldYUVData[x];
-			pOldYUVData[x] = h264->pYUVData[x];
+			WLog_Print(h264->log, WLOG_WARN,
+			           "no auxiliary AVC444 encoder, encoding both views in sequence");
+			return NULL;
 		}
 	}
-	h264->encodingBuffer = !h264->encodingBuffer;
 
-	if (!yuv420_context_encode(h264->yuv, pSrcData, nSrcStep, SrcFormat, h264->iStride, pYUVData,
-	                           regionRect, 1))
-		goto fail;
+	/* Region of interest QPs are those of the main view, not applied to the auxiliary one */
+	H264_CONTEXT* aux = h264->auxiliary;
+	aux->width = h264->width;
+	aux->height = h264->height;
+	aux->RateControlMode = h264->RateControlMode;
+	aux->BitRate = h264->BitRate;
+	aux->FrameRate = h264->FrameRate;
+	aux->QP = h264->QP;
+	aux->UsageType = h264->UsageType;
+	aux->NumberOfThreads = h264->NumberOfThreads;
+	return aux;
+}
 
-	if (!detect_changes(h264->firstLumaFrameDone, h264->QP, regionRect, pYUVData, pOldYUVData,
-	                    h264->iStride, meta))
-		goto fail;
+/* Encode the views selected by op at the same time, the calling thread takes one of them */
+static BOOL avc444_compress_views(H264_CONTEXT* WINPR_RESTRICT h264,
+                                  H264_CONTEXT* WINPR_RESTRICT aux, BYTE op, BYTE* pYUV444Data[3],
+                                  BYTE* pYUVData[3], BYTE** ppDstData, UINT32* pDstSize,
+                                  BYTE** ppAuxDstData, UINT32* pAuxDstSize)
+{
+	AVC444_ENCODE_JOB jobs[2] = {
+		{ h264, { pYUV444Data[0], pYUV444Data[1], pYUV444Data[2] }, h264->iStride, NULL, 0, 0 },
+		{ aux, { pYUVData[0], pYUVData[1], pYUVData[2] }, h264->iStride, NULL, 0, 0 }
+	};
+	const size_t first = (op == 2) ? 1 : 0;
+	const size_t count = (op == 0) ? 2 : 1;
+
+	if (!winpr_SubmitThreadpoolWorkBatch(avc444_compress_work_callback, &jobs[first], count,
+	                                     NULL))
+		return FALSE;
 
-	if (meta->numRegionRects == 0)
+	for (size_t x = first; x < first + count; x++)
 	{
-		rc = 0;
-		goto fail;
+		if (jobs[x].rc < 0)
+			return FALSE;
 	}
 
-	for (size_t x = 0; x < 3; x++)
-		pcYUVData[x] = pYUVData[x];
-
-	rc = h264->subsystem->Compress(h264, pcYUVData, h264->iStride, ppDstData, pDstSize);
-	if (rc >= 0)
+	if (op != 2)
+	{
 		h264->firstLumaFrameDone = TRUE;
+		*ppDstData = jobs[0].coded;
+		*pDstSize = jobs[0].codedSize;
+	}
 
-fail:
-	if (rc < 0)
-		free_h264_metablock(meta);
-	return rc;
+	if (op != 1)
+	{
+		h264->firstChromaFrameDone = TRUE;
+		*ppAuxDstData = jobs[1].coded;
+		*pAuxDstSize = jobs[1].codedSize;
+	}
+
+	return TRUE;
 }
 
 INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat, UINT32 nSrcStep,
@@ -395,27 +723,38 @@ INT32 avc444_compress(H264_CONTEXT* h264, const BYTE* pSrcData, DWORD SrcFormat,
 		goto fail;
 	}
 
-	if ((*op == 0) || (*op == 1))
-	{
-		const BYTE* pcYUV444Data[3] = { pYUV444Data[0], pYUV444Data[1], pYUV444Data[2] };
+	H264_CONTEXT* aux = (*op != 1) ? avc444_get_auxiliary(h264) : h264->auxiliary;
 
-		if (h264->subsystem->Compress(h264, pcYUV444Data, h264->iStride, &coded, &codedSize) < 0)
+	if (aux)
+	{
+		if (!avc444_compress_views(h264, aux, *op, pYUV444Data, pYUVData, ppDstData, pDstSize,
+		                           ppAuxDstData, pAuxDstSize))
 			goto fail;
-		h264->firstLumaFrameDone = TRUE;
-		memcpy(h264->lumaData, coded, codedSize);
-		*ppDstData = h264->lumaData;
-		*pDstSize = codedSize;
 	}
-
-	if ((*op == 0) || (*op == 2))
+	else
 	{
-		const BYTE* pcYUVData[3] = { pYUVData[0], pYUVData[1], pYUVData[2] };
+		if ((*op == 0) || (*op == 1))
+		{
+			const BYTE* pcYUV444Data[3] = { pYUV444Data[0], pYUV444Data[1], pYUV444Data[2] };
 
-		if (h264->subsystem->Compress(h264, pcYUVData, h264->iStride, &coded, &codedSize) < 0)
-			goto fail;
-		h264->firstChromaFrameDone = TRUE;
-		*ppAuxDstData = coded;
-		*pAuxDstSize = codedSize;
+			if (h264->subsystem->Compress(h264, pcYUV444Data, h264->iStride, &coded, &codedSize) < 0)
+				goto fail;
+			h264->firstLumaFrameDone = TRUE;
+			memcpy(h264->lumaData, coded, codedSize);
+			*ppDstData = h264->lumaData;
+			*pDstSize = codedSize;
+		}
+
+		if ((*op == 0) || (*op == 2))
+		{
+			const BYTE* pcYUVData[3] = { pYUVData[0], pYUVData[1], pYUVData[2] };
+
+			if (h264->subsystem->Compress(h264, pcYUVData, h264->iStride, &coded, &codedSize) < 0)
+				goto fail;
+			h264->firstChromaFrameDone = TRUE;
+			*ppAuxDstData = coded;
+			*pAuxDstSize = codedSize;
+		}
 	}
 
 	rc = 1;
@@ -456,22 +795,17 @@ static BOOL avc444_ensure_buffer(H264_CONTEXT* h264, DWORD nDstHeight)
 			if (piDstSize[x] == 0)
 				return FALSE;
 
-			BYTE* tmp1 = winpr_aligned_recalloc(ppYUVDstData[x], piDstSize[x], 1, 16);
-			if (!tmp1)
+			ppYUVDstData[x] = h264_plane_realloc(ppYUVDstData[x], piDstSize[x]);
+			if (!ppYUVDstData[x])
 				return FALSE;
-			ppYUVDstData[x] = tmp1;
-			BYTE* tmp2 = winpr_aligned_recalloc(ppOldYUVDstData[x], piDstSize[x], 1, 16);
-			if (!tmp2)
+			ppOldYUVDstData[x] = h264_plane_realloc(ppOldYUVDstData[x], piDstSize[x]);
+			if (!ppOldYUVDstData[x])
 				return FALSE;
-			ppOldYUVDstData[x] = tmp2;
 		}
 
-		{
-			BYTE* tmp = winpr_aligned_recalloc(h264->lumaData, piDstSize[0], 4, 16);
-			if (!tmp)
-				goto fail;
-			h264->lumaData = tmp;
-		}
+		h264->lumaData = h264_plane_realloc(h264->lumaData, 4ull * piDstSize[0]);
+		if (!h264->lumaData)
+			goto fail;
 	}
 
 	for (UINT32 x = 0; x < 3; x++)
@@ -503,6 +837,7 @@ static BOOL avc444_process_rects(H264_CONTEXT* h264, const BYTE* pSrcData, UINT3
 	BYTE** ppYUVDstData = h264->pYUV444Data;
 	const UINT32* piStride = h264->iStride;
 
+	h264->frameExported = FALSE;
 	if (h264->subsystem->Decompress(h264, pSrcData, SrcSize) < 0)
 		return FALSE;
 
@@ -627,6 +962,13 @@ static BOOL CALLBACK h264_register_subsystems(PINIT_ONCE once, PVOID param, PVOI
 {
 	int i = 0;
 
+#ifdef WITH_VIDEO_FFMPEG
+	{
+		/* Only succeeds for compressors with a usable hardware encoder */
+		subSystems[i] = &g_Subsystem_libavcodec_hw;
+		i++;
+	}
+#endif
 #ifdef WITH_MEDIACODEC
 	{
 		subSystems[i] = &g_Subsystem_mediacodec;
@@ -737,13 +1079,15 @@ void h264_context_free(H264_CONTEXT* h264)
 		{
 			if (h264->Compressor)
 			{
-				winpr_aligned_free(h264->pYUVData[x]);
-				winpr_aligned_free(h264->pOldYUVData[x]);
+				winpr_large_free(h264->pYUVData[x]);
+				winpr_large_free(h264->pOldYUVData[x]);
 			}
-			winpr_aligned_free(h264->pYUV444Data[x]);
-			winpr_aligned_free(h264->pOldYUV444Data[x]);
+			winpr_large_free(h264->pYUV444Data[x]);
+			winpr_large_free(h264->pOldYUV444Data[x]);
 		}
-		winpr_aligned_free(h264->lumaData);
+		winpr_large_free(h264->lumaData);
+		free(h264->roiActivity);
+		h264_context_free(h264->auxiliary);
 
 		yuv_context_free(h264->yuv);
 		free(h264);
@@ -780,6 +1124,12 @@ BOOL h264_context_set_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option, UIN
 		case H264_CONTEXT_OPTION_USAGETYPE:
 			h264->UsageType = value;
 			return TRUE;
+		case H264_CONTEXT_OPTION_ROI:
+			h264->RoiEnabled = value != 0;
+			return TRUE;
+		case H264_CONTEXT_OPTION_HW_FRAME_EXPORT:
+			h264->HwFrameExport = value != 0;
+			return TRUE;
 		default:
 			WLog_Print(h264->log, WLOG_WARN, "Unknown H264_CONTEXT_OPTION[0x%08" PRIx32 "]",
 			           option);
@@ -802,6 +1152,10 @@ UINT32 h264_context_get_option(H264_CONTEXT* h264, H264_CONTEXT_OPTION option)
 			return h264->QP;
 		case H264_CONTEXT_OPTION_USAGETYPE:
 			return h264->UsageType;
+		case H264_CONTEXT_OPTION_ROI:
+			return h264->RoiEnabled ? 1 : 0;
+		case H264_CONTEXT_OPTION_HW_FRAME_EXPORT:
+			return h264->HwFrameExport ? 1 : 0;
 		default:
 			WLog_Print(h264->log, WLOG_WARN, "Unknown H264_CONTEXT_OPTION[0x%08" PRIx32 "]",
 			           option);
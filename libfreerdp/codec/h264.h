@@ -40,6 +40,7 @@ extern "C"
 	                                        const UINT32* WINPR_RESTRICT pStride,
 	                                        BYTE** WINPR_RESTRICT ppDstData,
 	                                        UINT32* WINPR_RESTRICT pDstSize);
+	typedef BOOL (*pfnH264SubsystemTransfer)(H264_CONTEXT* WINPR_RESTRICT h264);
 
 	struct S_H264_CONTEXT_SUBSYSTEM
 	{
@@ -48,6 +49,8 @@ extern "C"
 		pfnH264SubsystemUninit Uninit;
 		pfnH264SubsystemDecompress Decompress;
 		pfnH264SubsystemCompress Compress;
+		/* Optional, downloads an exported hardware frame to pYUVData */
+		pfnH264SubsystemTransfer Transfer;
 	};
 
 	struct S_H264_CONTEXT
@@ -64,6 +67,25 @@ extern "C"
 		UINT32 UsageType;
 		UINT32 NumberOfThreads;
 
+		/* Region of interest QP, per 64x64 tile activity and the regions of the frame being
+		 * encoded, so subsystems supporting QP maps can apply the per region QP */
+		BOOL RoiEnabled;
+		BYTE* roiActivity;
+		size_t roiTiles;
+		UINT32 roiBaseQP;
+		const RDPGFX_H264_METABLOCK* roiMeta;
+
+		/* Decoded frames may stay on the GPU, only for the decode call of exportFrame */
+		BOOL HwFrameExport;
+		BOOL exportFrame;
+		BOOL frameExported;
+		H264_DMABUF_FRAME dmabuf;
+
+		/* Window the decoder may present frames on, only for the decode call of renderFrame */
+		void* outputWindow;
+		BOOL renderFrame;
+		BOOL frameRendered;
+
 		UINT32 iStride[3];
 		BYTE* pOldYUVData[3];
 		BYTE* pYUVData[3];
@@ -84,6 +106,9 @@ extern "C"
 
 		void* lumaData;
 		wLog* log;
+
+		/* Second encoder for the AVC444 auxiliary stream, runs next to this one */
+		H264_CONTEXT* auxiliary;
 	};
 
 	FREERDP_LOCAL BOOL avc420_ensure_buffer(H264_CONTEXT* h264, UINT32 stride, UINT32 width,
@@ -100,6 +125,7 @@ extern "C"
 #endif
 #ifdef WITH_VIDEO_FFMPEG
 	extern const H264_CONTEXT_SUBSYSTEM g_Subsystem_libavcodec;
+	extern const H264_CONTEXT_SUBSYSTEM g_Subsystem_libavcodec_hw;
 #endif
 
 #ifdef __cplusplus
@@ -21,10 +21,12 @@
 #include <freerdp/config.h>
 
 #include <winpr/wlog.h>
+#include <winpr/synch.h>
 #include <freerdp/log.h>
 #include <freerdp/codec/h264.h>
 #include <libavcodec/avcodec.h>
 #include <libavutil/opt.h>
+#include <libavutil/imgutils.h>
 
 #include "h264.h"
 
@@ -38,6 +40,24 @@
 #endif
 #endif
 
+/* Encoding to VA-API surfaces requires AVCodecContext::hw_frames_ctx */
+#if defined(WITH_VAAPI) && (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 80, 100))
+#define VAAPI_ENCODE
+#endif
+
+/* Mapping VA-API surfaces to DRM PRIME descriptors for DMA-BUF export */
+#if defined(WITH_VAAPI) && (LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(55, 78, 100))
+#include <libavutil/hwcontext_drm.h>
+#define VAAPI_DRM_EXPORT
+#define DRM_FOURCC(a, b, c, d) \
+	((UINT32)(a) | ((UINT32)(b) << 8) | ((UINT32)(c) << 16) | ((UINT32)(d) << 24))
+#endif
+
+/* AVRegionOfInterest side data for per region QP offsets */
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 29, 100)
+#define H264_FFMPEG_ROI
+#endif
+
 /* Fallback support for older libavcodec versions */
 #if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(54, 59, 100)
 #define AV_CODEC_ID_H264 CODEC_ID_H264
@@ -81,6 +101,7 @@ typedef struct
 	AVPacket bufferpacket;
 #endif
 	AVPacket* packet;
+	const AVCodec* hwEncoder;
 #ifdef WITH_VAAPI
 	AVBufferRef* hwctx;
 	AVFrame* hwVideoFrame;
@@ -89,6 +110,12 @@ typedef struct
 	AVBufferRef* hw_frames_ctx;
 #endif
 #endif
+#ifdef VAAPI_DRM_EXPORT
+	AVFrame* drmFrame;
+#endif
+#ifdef VAAPI_ENCODE
+	AVFrame* nv12Frame;
+#endif
 } H264_CONTEXT_LIBAVCODEC;
 
 static void libavcodec_destroy_encoder(H264_CONTEXT* WINPR_RESTRICT h264)
@@ -112,6 +139,257 @@ static void libavcodec_destroy_encoder(H264_CONTEXT* WINPR_RESTRICT h264)
 
 	sys->codecEncoder = NULL;
 	sys->codecEncoderContext = NULL;
+
+#ifdef VAAPI_ENCODE
+	if (sys->nv12Frame)
+		av_frame_free(&sys->nv12Frame);
+	if (sys->hwVideoFrame)
+		av_frame_unref(sys->hwVideoFrame);
+#endif
+}
+
+static BOOL libavcodec_is_encoder(const AVCodec* codec, const char* name)
+{
+	WINPR_ASSERT(codec);
+	WINPR_ASSERT(name);
+	return strcmp(codec->name, name) == 0;
+}
+
+static void libavcodec_set_rate_control(H264_CONTEXT* WINPR_RESTRICT h264,
+                                        AVCodecContext* WINPR_RESTRICT ctx,
+                                        const AVCodec* WINPR_RESTRICT codec)
+{
+	const BOOL nvenc = libavcodec_is_encoder(codec, "h264_nvenc");
+	const BOOL vaapi = libavcodec_is_encoder(codec, "h264_vaapi");
+	const BOOL videotoolbox = libavcodec_is_encoder(codec, "h264_videotoolbox");
+
+	switch (h264->RateControlMode)
+	{
+		case H264_RATECONTROL_VBR:
+			ctx->bit_rate = h264->BitRate;
+			if (nvenc || vaapi || videotoolbox)
+				ctx->rc_max_rate = h264->BitRate;
+			if (nvenc)
+				av_opt_set(ctx, "rc", "vbr", AV_OPT_SEARCH_CHILDREN);
+			else if (vaapi)
+				av_opt_set(ctx, "rc_mode", "VBR", AV_OPT_SEARCH_CHILDREN);
+			break;
+
+		case H264_RATECONTROL_CQP:
+			if (nvenc)
+				av_opt_set(ctx, "rc", "constqp", AV_OPT_SEARCH_CHILDREN);
+			else if (vaapi)
+				av_opt_set(ctx, "rc_mode", "CQP", AV_OPT_SEARCH_CHILDREN);
+			av_opt_set_int(ctx, "qp", h264->QP, AV_OPT_SEARCH_CHILDREN);
+			break;
+
+		default:
+			break;
+	}
+}
+
+#ifdef VAAPI_ENCODE
+static BOOL libavcodec_create_hw_frames(H264_CONTEXT* WINPR_RESTRICT h264,
+                                        AVCodecContext* WINPR_RESTRICT ctx)
+{
+	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+
+	if (!sys->hwctx)
+		return FALSE;
+
+	AVBufferRef* frames = av_hwframe_ctx_alloc(sys->hwctx);
+	if (!frames)
+		return FALSE;
+
+	AVHWFramesContext* fctx = (AVHWFramesContext*)frames->data;
+	fctx->format = AV_PIX_FMT_VAAPI;
+	fctx->sw_format = AV_PIX_FMT_NV12;
+	fctx->width = ctx->width;
+	fctx->height = ctx->height;
+	fctx->initial_pool_size = 4;
+
+	const int err = av_hwframe_ctx_init(frames);
+	if (err < 0)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "Could not init hwframes context: %s",
+		           av_err2str(err));
+		av_buffer_unref(&frames);
+		return FALSE;
+	}
+
+	/* The encoder context takes over the reference */
+	ctx->hw_frames_ctx = frames;
+
+	sys->nv12Frame = av_frame_alloc();
+	if (!sys->nv12Frame)
+		return FALSE;
+
+	sys->nv12Frame->format = AV_PIX_FMT_NV12;
+	sys->nv12Frame->width = ctx->width;
+	sys->nv12Frame->height = ctx->height;
+	return av_frame_get_buffer(sys->nv12Frame, 0) >= 0;
+}
+
+/* VA-API only accepts its own surfaces, so repack the I420 planes as NV12 and upload */
+static AVFrame* libavcodec_upload_frame(H264_CONTEXT* WINPR_RESTRICT h264,
+                                        const AVFrame* WINPR_RESTRICT src)
+{
+	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+	WINPR_ASSERT(sys->nv12Frame);
+	WINPR_ASSERT(sys->hwVideoFrame);
+
+	AVFrame* nv12 = sys->nv12Frame;
+	const int cw = (src->width + 1) / 2;
+	const int ch = (src->height + 1) / 2;
+
+	av_image_copy_plane(nv12->data[0], nv12->linesize[0], src->data[0], src->linesize[0],
+	                    src->width, src->height);
+
+	for (int y = 0; y < ch; y++)
+	{
+		const uint8_t* pU = &src->data[1][1LL * y * src->linesize[1]];
+		const uint8_t* pV = &src->data[2][1LL * y * src->linesize[2]];
+		uint8_t* pUV = &nv12->data[1][1LL * y * nv12->linesize[1]];
+
+		for (int x = 0; x < cw; x++)
+		{
+			*pUV++ = pU[x];
+			*pUV++ = pV[x];
+		}
+	}
+
+	av_frame_unref(sys->hwVideoFrame);
+	int status = av_hwframe_get_buffer(sys->codecEncoderContext->hw_frames_ctx,
+	                                   sys->hwVideoFrame, 0);
+	if (status >= 0)
+		status = av_hwframe_transfer_data(sys->hwVideoFrame, nv12, 0);
+
+	if (status < 0)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "Failed to upload video frame (%s [%d])",
+		           av_err2str(status), status);
+		return NULL;
+	}
+
+	/* timestamps and region of interest side data */
+	status = av_frame_copy_props(sys->hwVideoFrame, src);
+	if (status < 0)
+		return NULL;
+	return sys->hwVideoFrame;
+}
+#endif
+
+#ifdef H264_FFMPEG_ROI
+static BOOL libavcodec_set_roi(H264_CONTEXT* WINPR_RESTRICT h264, AVFrame* WINPR_RESTRICT frame)
+{
+	const RDPGFX_H264_METABLOCK* meta = h264->roiMeta;
+	size_t count = 0;
+
+	av_frame_remove_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST);
+
+	if (!meta)
+		return TRUE;
+
+	for (size_t x = 0; x < meta->numRegionRects; x++)
+	{
+		if (meta->quantQualityVals[x].qp != h264->roiBaseQP)
+			count++;
+	}
+
+	if (count == 0)
+		return TRUE;
+
+	AVFrameSideData* sd = av_frame_new_side_data(frame, AV_FRAME_DATA_REGIONS_OF_INTEREST,
+	                                             count * sizeof(AVRegionOfInterest));
+	if (!sd)
+		return FALSE;
+
+	AVRegionOfInterest* roi = (AVRegionOfInterest*)sd->data;
+	for (size_t x = 0; x < meta->numRegionRects; x++)
+	{
+		const RECTANGLE_16* rect = &meta->regionRects[x];
+		const int delta = (int)meta->quantQualityVals[x].qp - (int)h264->roiBaseQP;
+
+		if (delta == 0)
+			continue;
+
+		roi->self_size = sizeof(AVRegionOfInterest);
+		roi->left = rect->left;
+		roi->top = rect->top;
+		roi->right = rect->right;
+		roi->bottom = rect->bottom;
+		/* encoders scale the offset by their QP range, 51 for 8 bit H.264 */
+		roi->qoffset = av_make_q(delta, 51);
+		roi++;
+	}
+
+	return TRUE;
+}
+#endif
+
+static BOOL libavcodec_open_encoder(H264_CONTEXT* WINPR_RESTRICT h264,
+                                    const AVCodec* WINPR_RESTRICT codec, BOOL hardware)
+{
+	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+
+	if (!codec)
+		return FALSE;
+
+	sys->codecEncoder = codec;
+	sys->codecEncoderContext = avcodec_alloc_context3(sys->codecEncoder);
+
+	if (!sys->codecEncoderContext)
+		return FALSE;
+
+	AVCodecContext* ctx = sys->codecEncoderContext;
+	libavcodec_set_rate_control(h264, ctx, codec);
+
+	ctx->width = (int)MIN(INT32_MAX, h264->width);
+	ctx->height = (int)MIN(INT32_MAX, h264->height);
+	ctx->delay = 0;
+	ctx->max_b_frames = 0;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(56, 13, 100)
+	ctx->framerate = (AVRational){ h264->FrameRate, 1 };
+#endif
+	ctx->time_base = (AVRational){ 1, h264->FrameRate };
+	ctx->flags |= AV_CODEC_FLAG_LOOP_FILTER;
+	ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+
+	if (!hardware)
+	{
+		av_opt_set(ctx, "preset", "medium", AV_OPT_SEARCH_CHILDREN);
+		av_opt_set(ctx, "tune", "zerolatency", AV_OPT_SEARCH_CHILDREN);
+	}
+	else if (libavcodec_is_encoder(codec, "h264_nvenc"))
+	{
+		av_opt_set(ctx, "preset", "p1", AV_OPT_SEARCH_CHILDREN);
+		av_opt_set(ctx, "tune", "ull", AV_OPT_SEARCH_CHILDREN);
+		av_opt_set_int(ctx, "zerolatency", 1, AV_OPT_SEARCH_CHILDREN);
+		av_opt_set_int(ctx, "delay", 0, AV_OPT_SEARCH_CHILDREN);
+	}
+	else if (libavcodec_is_encoder(codec, "h264_videotoolbox"))
+	{
+		/* Fail instead of silently using the Apple software encoder */
+		av_opt_set_int(ctx, "realtime", 1, AV_OPT_SEARCH_CHILDREN);
+		av_opt_set_int(ctx, "allow_sw", 0, AV_OPT_SEARCH_CHILDREN);
+		av_opt_set_int(ctx, "prio_speed", 1, AV_OPT_SEARCH_CHILDREN);
+	}
+#ifdef VAAPI_ENCODE
+	else if (libavcodec_is_encoder(codec, "h264_vaapi"))
+	{
+		/* Every frame must be returned by the call that submitted it */
+		av_opt_set_int(ctx, "async_depth", 1, AV_OPT_SEARCH_CHILDREN);
+		ctx->pix_fmt = AV_PIX_FMT_VAAPI;
+
+		if (!libavcodec_create_hw_frames(h264, ctx))
+			return FALSE;
+	}
+#endif
+
+	return avcodec_open2(ctx, codec, NULL) >= 0;
 }
 
 static BOOL libavcodec_create_encoder(H264_CONTEXT* WINPR_RESTRICT h264)
@@ -141,49 +419,129 @@ static BOOL libavcodec_create_encoder(H264_CONTEXT* WINPR_RESTRICT h264)
 		return TRUE;
 
 	libavcodec_destroy_encoder(h264);
-	sys->codecEncoder = avcodec_find_encoder(AV_CODEC_ID_H264);
 
-	if (!sys->codecEncoder)
-		goto EXCEPTION;
+	if (sys->hwEncoder)
+	{
+		if (libavcodec_open_encoder(h264, sys->hwEncoder, TRUE))
+			return TRUE;
+
+		WLog_Print(h264->log, WLOG_WARN,
+		           "Failed to open %s encoder, falling back to software encoding",
+		           sys->hwEncoder->name);
+		libavcodec_destroy_encoder(h264);
+		sys->hwEncoder = NULL;
+	}
 
-	sys->codecEncoderContext = avcodec_alloc_context3(sys->codecEncoder);
+	if (libavcodec_open_encoder(h264, avcodec_find_encoder(AV_CODEC_ID_H264), FALSE))
+		return TRUE;
 
-	if (!sys->codecEncoderContext)
-		goto EXCEPTION;
+	libavcodec_destroy_encoder(h264);
+	return FALSE;
+}
 
-	switch (h264->RateControlMode)
+static void libavcodec_set_planes(H264_CONTEXT* WINPR_RESTRICT h264,
+                                  const AVFrame* WINPR_RESTRICT frame)
+{
+	for (size_t x = 0; x < 3; x++)
 	{
-		case H264_RATECONTROL_VBR:
-			sys->codecEncoderContext->bit_rate = h264->BitRate;
-			break;
+		h264->pYUVData[x] = frame->data[x];
+		h264->iStride[x] = (UINT32)MAX(0, frame->linesize[x]);
+	}
+}
 
-		case H264_RATECONTROL_CQP:
-			/* TODO: sys->codecEncoderContext-> = h264->QP; */
-			break;
+#ifdef WITH_VAAPI
+/* Keeps the decoded VA-API surface on the GPU and describes it as DMA-BUF */
+static BOOL libavcodec_export_frame(H264_CONTEXT* WINPR_RESTRICT h264)
+{
+#ifdef VAAPI_DRM_EXPORT
+	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
 
-		default:
-			break;
+	if (!h264->exportFrame || !sys->drmFrame || !sys->hwVideoFrame->hw_frames_ctx)
+		return FALSE;
+
+	av_frame_unref(sys->drmFrame);
+	sys->drmFrame->format = AV_PIX_FMT_DRM_PRIME;
+	const int status = av_hwframe_map(sys->drmFrame, sys->hwVideoFrame, AV_HWFRAME_MAP_READ);
+
+	if (status < 0)
+	{
+		WLog_Print(h264->log, WLOG_DEBUG, "Failed to map frame to DRM PRIME (%s)",
+		           av_err2str(status));
+		return FALSE;
 	}
 
-	sys->codecEncoderContext->width = (int)MIN(INT32_MAX, h264->width);
-	sys->codecEncoderContext->height = (int)MIN(INT32_MAX, h264->height);
-	sys->codecEncoderContext->delay = 0;
-#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(56, 13, 100)
-	sys->codecEncoderContext->framerate = (AVRational){ h264->FrameRate, 1 };
+	const AVDRMFrameDescriptor* desc = (const AVDRMFrameDescriptor*)sys->drmFrame->data[0];
+	const AVHWFramesContext* frames =
+	    (const AVHWFramesContext*)sys->hwVideoFrame->hw_frames_ctx->data;
+	H264_DMABUF_FRAME* frame = &h264->dmabuf;
+	*frame = (H264_DMABUF_FRAME){ .width = (UINT32)sys->hwVideoFrame->width,
+		                          .height = (UINT32)sys->hwVideoFrame->height };
+
+	for (int l = 0; l < desc->nb_layers; l++)
+	{
+		const AVDRMLayerDescriptor* layer = &desc->layers[l];
+
+		for (int p = 0; p < layer->nb_planes; p++)
+		{
+			const AVDRMPlaneDescriptor* plane = &layer->planes[p];
+			const AVDRMObjectDescriptor* object = &desc->objects[plane->object_index];
+
+			if (frame->numPlanes >= H264_DMABUF_MAX_PLANES)
+				goto fail;
+
+			frame->fd[frame->numPlanes] = object->fd;
+			frame->offset[frame->numPlanes] = (UINT32)plane->offset;
+			frame->pitch[frame->numPlanes] = (UINT32)plane->pitch;
+			frame->modifier[frame->numPlanes] = object->format_modifier;
+			frame->numPlanes++;
+		}
+	}
+
+	/* VA-API exports the planes of NV12 as separate R8 and GR88 layers */
+	if (desc->nb_layers == 1)
+		frame->fourcc = desc->layers[0].format;
+	else if ((frames->sw_format == AV_PIX_FMT_NV12) && (frame->numPlanes == 2))
+		frame->fourcc = DRM_FOURCC('N', 'V', '1', '2');
+	else
+		goto fail;
+
+	h264->frameExported = TRUE;
+	return TRUE;
+
+fail:
+	av_frame_unref(sys->drmFrame);
+	return FALSE;
+#else
+	WINPR_UNUSED(h264);
+	return FALSE;
+#endif
+}
 #endif
-	sys->codecEncoderContext->time_base = (AVRational){ 1, h264->FrameRate };
-	av_opt_set(sys->codecEncoderContext, "preset", "medium", AV_OPT_SEARCH_CHILDREN);
-	av_opt_set(sys->codecEncoderContext, "tune", "zerolatency", AV_OPT_SEARCH_CHILDREN);
-	sys->codecEncoderContext->flags |= AV_CODEC_FLAG_LOOP_FILTER;
-	sys->codecEncoderContext->pix_fmt = AV_PIX_FMT_YUV420P;
 
-	if (avcodec_open2(sys->codecEncoderContext, sys->codecEncoder, NULL) < 0)
-		goto EXCEPTION;
+static BOOL libavcodec_transfer(H264_CONTEXT* WINPR_RESTRICT h264)
+{
+#ifdef WITH_VAAPI
+	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+
+	sys->videoFrame->width = sys->hwVideoFrame->width;
+	sys->videoFrame->height = sys->hwVideoFrame->height;
+	const int status = av_hwframe_transfer_data(sys->videoFrame, sys->hwVideoFrame, 0);
 
+	if (status < 0)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "Failed to transfer video frame (status=%d) (%s)", status,
+		           av_err2str(status));
+		return FALSE;
+	}
+
+	libavcodec_set_planes(h264, sys->videoFrame);
 	return TRUE;
-EXCEPTION:
-	libavcodec_destroy_encoder(h264);
+#else
+	WINPR_UNUSED(h264);
 	return FALSE;
+#endif
 }
 
 static int libavcodec_decompress(H264_CONTEXT* WINPR_RESTRICT h264,
@@ -203,9 +561,6 @@ static int libavcodec_decompress(H264_CONTEXT* WINPR_RESTRICT h264,
 	WINPR_ASSERT(pSrcData || (SrcSize == 0));
 
 	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
-	BYTE** pYUVData = h264->pYUVData;
-	UINT32* iStride = h264->iStride;
-
 	WINPR_ASSERT(sys);
 
 #if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 133, 100)
@@ -270,9 +625,13 @@ static int libavcodec_decompress(H264_CONTEXT* WINPR_RESTRICT h264,
 	{
 		if (sys->hwVideoFrame->format == sys->hw_pix_fmt)
 		{
-			sys->videoFrame->width = sys->hwVideoFrame->width;
-			sys->videoFrame->height = sys->hwVideoFrame->height;
-			status = av_hwframe_transfer_data(sys->videoFrame, sys->hwVideoFrame, 0);
+			/* An exported frame is only downloaded if it has to be converted on the CPU */
+			if (!libavcodec_export_frame(h264))
+			{
+				sys->videoFrame->width = sys->hwVideoFrame->width;
+				sys->videoFrame->height = sys->hwVideoFrame->height;
+				status = av_hwframe_transfer_data(sys->videoFrame, sys->hwVideoFrame, 0);
+			}
 		}
 		else
 		{
@@ -303,12 +662,8 @@ static int libavcodec_decompress(H264_CONTEXT* WINPR_RESTRICT h264,
 	{
 		WINPR_ASSERT(sys->videoFrame);
 
-		pYUVData[0] = sys->videoFrame->data[0];
-		pYUVData[1] = sys->videoFrame->data[1];
-		pYUVData[2] = sys->videoFrame->data[2];
-		iStride[0] = (UINT32)MAX(0, sys->videoFrame->linesize[0]);
-		iStride[1] = (UINT32)MAX(0, sys->videoFrame->linesize[1]);
-		iStride[2] = (UINT32)MAX(0, sys->videoFrame->linesize[2]);
+		if (!h264->frameExported)
+			libavcodec_set_planes(h264, sys->videoFrame);
 
 		rc = 1;
 	}
@@ -389,9 +744,22 @@ static int libavcodec_compress(H264_CONTEXT* WINPR_RESTRICT h264,
 	sys->videoFrame->linesize[1] = (int)pStride[1];
 	sys->videoFrame->linesize[2] = (int)pStride[2];
 	sys->videoFrame->pts++;
+#ifdef H264_FFMPEG_ROI
+	if (!libavcodec_set_roi(h264, sys->videoFrame))
+		goto fail;
+#endif
 	/* avcodec_encode_video2 is deprecated with libavcodec 57.48.101 */
 #if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 48, 101)
-	status = avcodec_send_frame(sys->codecEncoderContext, sys->videoFrame);
+	AVFrame* frame = sys->videoFrame;
+#ifdef VAAPI_ENCODE
+	if (sys->codecEncoderContext->pix_fmt == AV_PIX_FMT_VAAPI)
+	{
+		frame = libavcodec_upload_frame(h264, sys->videoFrame);
+		if (!frame)
+			goto fail;
+	}
+#endif
+	status = avcodec_send_frame(sys->codecEncoderContext, frame);
 
 	if (status < 0)
 	{
@@ -402,6 +770,18 @@ static int libavcodec_compress(H264_CONTEXT* WINPR_RESTRICT h264,
 
 	status = avcodec_receive_packet(sys->codecEncoderContext, sys->packet);
 
+	/* VideoToolbox encodes asynchronously, wait up to a frame interval for the packet */
+	if (libavcodec_is_encoder(sys->codecEncoder, "h264_videotoolbox"))
+	{
+		const UINT32 interval = 1000 / MAX(1, h264->FrameRate);
+
+		for (UINT32 x = 0; (x < interval) && (status == AVERROR(EAGAIN)); x++)
+		{
+			Sleep(1);
+			status = avcodec_receive_packet(sys->codecEncoderContext, sys->packet);
+		}
+	}
+
 	if (status < 0)
 	{
 		WLog_Print(h264->log, WLOG_ERROR, "Failed to encode video frame (%s [%d])",
@@ -495,6 +875,11 @@ static void libavcodec_uninit(H264_CONTEXT* h264)
 #endif
 	}
 
+#ifdef VAAPI_DRM_EXPORT
+	if (sys->drmFrame)
+		av_frame_free(&sys->drmFrame);
+#endif
+
 	if (sys->hwctx)
 		av_buffer_unref(&sys->hwctx);
 
@@ -670,6 +1055,9 @@ static BOOL libavcodec_init(H264_CONTEXT* h264)
 #ifdef WITH_VAAPI
 	sys->hwVideoFrame = av_frame_alloc();
 #endif
+#ifdef VAAPI_DRM_EXPORT
+	sys->drmFrame = av_frame_alloc();
+#endif
 #else
 	sys->videoFrame = avcodec_alloc_frame();
 #endif
@@ -696,6 +1084,55 @@ EXCEPTION:
 	return FALSE;
 }
 
-const H264_CONTEXT_SUBSYSTEM g_Subsystem_libavcodec = { "libavcodec", libavcodec_init,
-	                                                    libavcodec_uninit, libavcodec_decompress,
-	                                                    libavcodec_compress };
+const H264_CONTEXT_SUBSYSTEM g_Subsystem_libavcodec = {
+	"libavcodec",        libavcodec_init,     libavcodec_uninit, libavcodec_decompress,
+	libavcodec_compress, libavcodec_transfer
+};
+
+static BOOL libavcodec_hw_init(H264_CONTEXT* h264)
+{
+	WINPR_ASSERT(h264);
+
+	if (!h264->Compressor)
+		return FALSE;
+
+	if (!libavcodec_init(h264))
+		return FALSE;
+
+	H264_CONTEXT_LIBAVCODEC* sys = (H264_CONTEXT_LIBAVCODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+
+#ifdef VAAPI_ENCODE
+	{
+		const AVCodec* codec = avcodec_find_encoder_by_name("h264_vaapi");
+
+		if (codec && (av_hwdevice_ctx_create(&sys->hwctx, AV_HWDEVICE_TYPE_VAAPI, VAAPI_DEVICE,
+		                                     NULL, 0) >= 0))
+			sys->hwEncoder = codec;
+	}
+#endif
+
+	if (!sys->hwEncoder)
+		sys->hwEncoder = avcodec_find_encoder_by_name("h264_nvenc");
+
+#if defined(__APPLE__)
+	if (!sys->hwEncoder)
+		sys->hwEncoder = avcodec_find_encoder_by_name("h264_videotoolbox");
+#endif
+
+	if (!sys->hwEncoder)
+	{
+		WLog_Print(h264->log, WLOG_DEBUG, "No hardware H.264 encoder available");
+		libavcodec_uninit(h264);
+		return FALSE;
+	}
+
+	WLog_Print(h264->log, WLOG_INFO, "Using %s for accelerated H264 encoding",
+	           sys->hwEncoder->name);
+	return TRUE;
+}
+
+const H264_CONTEXT_SUBSYSTEM g_Subsystem_libavcodec_hw = {
+	"libavcodec-hw",     libavcodec_hw_init,  libavcodec_uninit, libavcodec_decompress,
+	libavcodec_compress, libavcodec_transfer
+};
@@ -26,6 +26,7 @@
 
 #include <media/NdkMediaCodec.h>
 #include <media/NdkMediaFormat.h>
+#include <android/native_window.h>
 
 #include "h264.h"
 
@@ -48,9 +49,11 @@ typedef struct
 	int32_t outputWidth;
 	int32_t outputHeight;
 	ssize_t currentOutputBufferIndex;
+	/* The decoder outputs to this window instead of byte buffers */
+	ANativeWindow* window;
 } H264_CONTEXT_MEDIACODEC;
 
-static AMediaFormat* mediacodec_format_new(wLog* log, int width, int height)
+static AMediaFormat* mediacodec_format_new(wLog* log, int width, int height, BOOL surface)
 {
 	const char* media_format;
 	AMediaFormat* format = AMediaFormat_new();
@@ -63,7 +66,9 @@ static AMediaFormat* mediacodec_format_new(wLog* log, int width, int height)
 	AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, CODEC_NAME);
 	AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_WIDTH, width);
 	AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_HEIGHT, height);
-	AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, COLOR_FormatYUV420Planar);
+	/* surface output picks its own color format */
+	if (!surface)
+		AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, COLOR_FormatYUV420Planar);
 
 	media_format = AMediaFormat_toString(format);
 	if (media_format == NULL)
@@ -211,6 +216,77 @@ static void release_current_outputbuffer(H264_CONTEXT* h264)
 	sys->currentOutputBufferIndex = -1;
 }
 
+static BOOL mediacodec_configure(H264_CONTEXT* h264)
+{
+	media_status_t status;
+	H264_CONTEXT_MEDIACODEC* sys;
+
+	WINPR_ASSERT(h264);
+	sys = (H264_CONTEXT_MEDIACODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+
+	set_mediacodec_format(
+	    h264, &sys->inputFormat,
+	    mediacodec_format_new(h264->log, sys->width, sys->height, sys->window != NULL));
+
+	status = AMediaCodec_configure(sys->decoder, sys->inputFormat, sys->window, NULL, 0);
+	if (status != AMEDIA_OK)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "AMediaCodec_configure failed: %d", status);
+		return FALSE;
+	}
+
+	if (update_mediacodec_inputformat(h264) < 0)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "MediaCodec failed updating input format");
+		return FALSE;
+	}
+
+	if (update_mediacodec_outputformat(h264) < 0)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "MediaCodec failed updating output format");
+		return FALSE;
+	}
+
+	WLog_Print(h264->log, WLOG_DEBUG, "Starting MediaCodec");
+	status = AMediaCodec_start(sys->decoder);
+	if (status != AMEDIA_OK)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "AMediaCodec_start failed %d", status);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Switches between byte buffer and window output, the codec needs to be configured again */
+static BOOL mediacodec_set_window(H264_CONTEXT* h264, ANativeWindow* window)
+{
+	media_status_t status;
+	H264_CONTEXT_MEDIACODEC* sys;
+
+	WINPR_ASSERT(h264);
+	sys = (H264_CONTEXT_MEDIACODEC*)h264->pSystemData;
+	WINPR_ASSERT(sys);
+
+	if (sys->window == window)
+		return TRUE;
+
+	WLog_Print(h264->log, WLOG_DEBUG, "MediaCodec switching to %s output",
+	           window ? "window" : "buffer");
+
+	release_current_outputbuffer(h264);
+	status = AMediaCodec_stop(sys->decoder);
+	if (status != AMEDIA_OK)
+	{
+		WLog_Print(h264->log, WLOG_ERROR, "Error AMediaCodec_stop %d", status);
+		return FALSE;
+	}
+
+	sys->window = window;
+	return mediacodec_configure(h264);
+}
+
 static int mediacodec_compress(H264_CONTEXT* h264, const BYTE** pSrcYuv, const UINT32* pStride,
                                BYTE** ppDstData, UINT32* pDstSize)
 {
@@ -248,6 +324,10 @@ static int mediacodec_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT3
 
 	release_current_outputbuffer(h264);
 
+	/* AVC444 and the other callers need the planes, only render where asked to */
+	if (!mediacodec_set_window(h264, h264->renderFrame ? h264->outputWindow : NULL))
+		return -1;
+
 	if (sys->width != h264->width || sys->height != h264->height)
 	{
 		sys->width = h264->width;
@@ -274,8 +354,9 @@ static int mediacodec_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT3
 			return -1;
 		}
 #else
-		set_mediacodec_format(h264, &sys->inputFormat,
-		                      mediacodec_format_new(h264->log, sys->width, sys->height));
+		set_mediacodec_format(
+		    h264, &sys->inputFormat,
+		    mediacodec_format_new(h264->log, sys->width, sys->height, sys->window != NULL));
 #endif
 
 		// The codec can change output width and height
@@ -332,7 +413,21 @@ static int mediacodec_decompress(H264_CONTEXT* h264, const BYTE* pSrcData, UINT3
 		{
 			AMediaCodecBufferInfo bufferInfo;
 			ssize_t outputBufferId = AMediaCodec_dequeueOutputBuffer(sys->decoder, &bufferInfo, -1);
-			if (outputBufferId >= 0)
+			if ((outputBufferId >= 0) && sys->window)
+			{
+				/* Rendering hands the frame to the compositor, no copy to memory */
+				status = AMediaCodec_releaseOutputBuffer(sys->decoder, outputBufferId, TRUE);
+				if (status != AMEDIA_OK)
+				{
+					WLog_Print(h264->log, WLOG_ERROR,
+					           "Error AMediaCodec_releaseOutputBuffer %d", status);
+					return -1;
+				}
+
+				h264->frameRendered = TRUE;
+				break;
+			}
+			else if (outputBufferId >= 0)
 			{
 				sys->currentOutputBufferIndex = outputBufferId;
 
@@ -440,7 +535,6 @@ static void mediacodec_uninit(H264_CONTEXT* h264)
 static BOOL mediacodec_init(H264_CONTEXT* h264)
 {
 	H264_CONTEXT_MEDIACODEC* sys;
-	media_status_t status;
 
 	WINPR_ASSERT(h264);
 
@@ -475,7 +569,7 @@ static BOOL mediacodec_init(H264_CONTEXT* h264)
 
 #if __ANDROID_API__ >= 28
 	char* codec_name;
-	status = AMediaCodec_getName(sys->decoder, &codec_name);
+	media_status_t status = AMediaCodec_getName(sys->decoder, &codec_name);
 	if (status != AMEDIA_OK)
 	{
 		WLog_Print(h264->log, WLOG_ERROR, "AMediaCodec_getName failed: %d", status);
@@ -486,35 +580,8 @@ static BOOL mediacodec_init(H264_CONTEXT* h264)
 	AMediaCodec_releaseName(sys->decoder, codec_name);
 #endif
 
-	set_mediacodec_format(h264, &sys->inputFormat,
-	                      mediacodec_format_new(h264->log, sys->width, sys->height));
-
-	status = AMediaCodec_configure(sys->decoder, sys->inputFormat, NULL, NULL, 0);
-	if (status != AMEDIA_OK)
-	{
-		WLog_Print(h264->log, WLOG_ERROR, "AMediaCodec_configure failed: %d", status);
+	if (!mediacodec_configure(h264))
 		goto EXCEPTION;
-	}
-
-	if (update_mediacodec_inputformat(h264) < 0)
-	{
-		WLog_Print(h264->log, WLOG_ERROR, "MediaCodec failed updating input format");
-		goto EXCEPTION;
-	}
-
-	if (update_mediacodec_outputformat(h264) < 0)
-	{
-		WLog_Print(h264->log, WLOG_ERROR, "MediaCodec failed updating output format");
-		goto EXCEPTION;
-	}
-
-	WLog_Print(h264->log, WLOG_DEBUG, "Starting MediaCodec");
-	status = AMediaCodec_start(sys->decoder);
-	if (status != AMEDIA_OK)
-	{
-		WLog_Print(h264->log, WLOG_ERROR, "AMediaCodec_start failed %d", status);
-		goto EXCEPTION;
-	}
 
 	return TRUE;
 EXCEPTION:
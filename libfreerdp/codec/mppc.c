@@ -24,9 +24,11 @@
 #include <winpr/print.h>
 #include <winpr/stream.h>
 #include <winpr/bitstream.h>
+#include <winpr/intrin.h>
 
 #include <freerdp/log.h>
 #include "mppc.h"
+#include "bulk.h"
 
 #define TAG FREERDP_TAG("codec.mppc")
 
@@ -263,143 +265,25 @@ int mppc_decompress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize,
 
 		/**
 		 * LengthOfMatch Encoding
+		 * bit 0 for a LengthOfMatch of 3, otherwise n bits 1, a bit 0 and the n + 1 lower bits of
+		 * LengthOfMatch [2^(n + 1), 2^(n + 2) - 1]. RDP4 goes up to [4096, 8191],
+		 * RDP5 up to [32768, 65535]
 		 */
 		accumulator = bs->accumulator;
 
-		if ((accumulator & 0x80000000) == 0x00000000)
+		const UINT32 ones = (accumulator == UINT32_MAX) ? 32 : __lzcnt(~accumulator);
+
+		if (ones == 0)
 		{
-			/**
-			 * LengthOfMatch [3]
-			 * bit 0 + 0 lower bits of LengthOfMatch
-			 */
 			LengthOfMatch = 3;
 			BitStream_Shift(bs, 1);
 		}
-		else if ((accumulator & 0xC0000000) == 0x80000000)
-		{
-			/**
-			 * LengthOfMatch [4, 7]
-			 * bits 10 + 2 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 28) & 0x0003) + 0x0004;
-			BitStream_Shift(bs, 4);
-		}
-		else if ((accumulator & 0xE0000000) == 0xC0000000)
-		{
-			/**
-			 * LengthOfMatch [8, 15]
-			 * bits 110 + 3 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 26) & 0x0007) + 0x0008;
-			BitStream_Shift(bs, 6);
-		}
-		else if ((accumulator & 0xF0000000) == 0xE0000000)
+		else if (ones <= (CompressionLevel ? 14u : 11u))
 		{
-			/**
-			 * LengthOfMatch [16, 31]
-			 * bits 1110 + 4 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 24) & 0x000F) + 0x0010;
-			BitStream_Shift(bs, 8);
-		}
-		else if ((accumulator & 0xF8000000) == 0xF0000000)
-		{
-			/**
-			 * LengthOfMatch [32, 63]
-			 * bits 11110 + 5 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 22) & 0x001F) + 0x0020;
-			BitStream_Shift(bs, 10);
-		}
-		else if ((accumulator & 0xFC000000) == 0xF8000000)
-		{
-			/**
-			 * LengthOfMatch [64, 127]
-			 * bits 111110 + 6 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 20) & 0x003F) + 0x0040;
-			BitStream_Shift(bs, 12);
-		}
-		else if ((accumulator & 0xFE000000) == 0xFC000000)
-		{
-			/**
-			 * LengthOfMatch [128, 255]
-			 * bits 1111110 + 7 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 18) & 0x007F) + 0x0080;
-			BitStream_Shift(bs, 14);
-		}
-		else if ((accumulator & 0xFF000000) == 0xFE000000)
-		{
-			/**
-			 * LengthOfMatch [256, 511]
-			 * bits 11111110 + 8 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 16) & 0x00FF) + 0x0100;
-			BitStream_Shift(bs, 16);
-		}
-		else if ((accumulator & 0xFF800000) == 0xFF000000)
-		{
-			/**
-			 * LengthOfMatch [512, 1023]
-			 * bits 111111110 + 9 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 14) & 0x01FF) + 0x0200;
-			BitStream_Shift(bs, 18);
-		}
-		else if ((accumulator & 0xFFC00000) == 0xFF800000)
-		{
-			/**
-			 * LengthOfMatch [1024, 2047]
-			 * bits 1111111110 + 10 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 12) & 0x03FF) + 0x0400;
-			BitStream_Shift(bs, 20);
-		}
-		else if ((accumulator & 0xFFE00000) == 0xFFC00000)
-		{
-			/**
-			 * LengthOfMatch [2048, 4095]
-			 * bits 11111111110 + 11 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 10) & 0x07FF) + 0x0800;
-			BitStream_Shift(bs, 22);
-		}
-		else if ((accumulator & 0xFFF00000) == 0xFFE00000)
-		{
-			/**
-			 * LengthOfMatch [4096, 8191]
-			 * bits 111111111110 + 12 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 8) & 0x0FFF) + 0x1000;
-			BitStream_Shift(bs, 24);
-		}
-		else if (((accumulator & 0xFFF80000) == 0xFFF00000) && CompressionLevel) /* RDP5 */
-		{
-			/**
-			 * LengthOfMatch [8192, 16383]
-			 * bits 1111111111110 + 13 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 6) & 0x1FFF) + 0x2000;
-			BitStream_Shift(bs, 26);
-		}
-		else if (((accumulator & 0xFFFC0000) == 0xFFF80000) && CompressionLevel) /* RDP5 */
-		{
-			/**
-			 * LengthOfMatch [16384, 32767]
-			 * bits 11111111111110 + 14 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 4) & 0x3FFF) + 0x4000;
-			BitStream_Shift(bs, 28);
-		}
-		else if (((accumulator & 0xFFFE0000) == 0xFFFC0000) && CompressionLevel) /* RDP5 */
-		{
-			/**
-			 * LengthOfMatch [32768, 65535]
-			 * bits 111111111111110 + 15 lower bits of LengthOfMatch
-			 */
-			LengthOfMatch = ((accumulator >> 2) & 0x7FFF) + 0x8000;
-			BitStream_Shift(bs, 30);
+			const UINT32 nbits = ones + 1;
+			const UINT32 mask = (1u << nbits) - 1u;
+			LengthOfMatch = (1u << nbits) + ((accumulator >> (32u - 2u * nbits)) & mask);
+			BitStream_Shift(bs, 2 * nbits);
 		}
 		else
 		{
@@ -420,10 +304,8 @@ int mppc_decompress(MPPC_CONTEXT* mppc, const BYTE* pSrcData, UINT32 SrcSize,
 		SrcPtr = &HistoryBuffer[(HistoryPtr - HistoryBuffer - CopyOffset) &
 		                        (CompressionLevel ? 0xFFFF : 0x1FFF)];
 
-		do
-		{
-			*HistoryPtr++ = *SrcPtr++;
-		} while (--LengthOfMatch);
+		bulk_copy_match(HistoryPtr, SrcPtr, LengthOfMatch);
+		HistoryPtr += LengthOfMatch;
 	}
 
 	*pDstSize = (UINT32)(HistoryPtr - mppc->HistoryPtr);
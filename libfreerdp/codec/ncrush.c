@@ -29,11 +29,16 @@
 
 #include <freerdp/log.h>
 #include <freerdp/types.h>
+#include <freerdp/codec/bulk.h>
 
 #include "ncrush.h"
+#include "bulk.h"
 
 #define TAG FREERDP_TAG("codec")
 
+/* The longest match the length of match tables are validated for */
+#define NCRUSH_MAX_MATCH_LENGTH 4095
+
 struct s_NCRUSH_CONTEXT
 {
 	ALIGN64 BOOL Compressor;
@@ -48,6 +53,9 @@ struct s_NCRUSH_CONTEXT
 	ALIGN64 UINT16 MatchTable[65536];
 	ALIGN64 BYTE HuffTableCopyOffset[1024];
 	ALIGN64 BYTE HuffTableLOM[4096];
+	ALIGN64 UINT32 SearchDepth;     /* 0 for the built-in match finder */
+	ALIGN64 UINT32 GoodMatchLength; /* stop walking the chain at this length */
+	ALIGN64 BOOL LazyMatching;
 };
 
 static const UINT16 HuffTableLEC[8192] = {
@@ -2258,18 +2266,8 @@ int ncrush_decompress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSi
 
 		if (CopyOffsetPtr >= HistoryBuffer)
 		{
-			while (CopyLength > 0)
-			{
-				*HistoryPtr++ = *CopyOffsetPtr++;
-				CopyLength--;
-			}
-
-			while (LengthOfMatch > CopyOffset)
-			{
-				index = ((index >= CopyOffset)) ? 0 : index;
-				*HistoryPtr++ = *(CopyOffsetPtr + index++);
-				LengthOfMatch--;
-			}
+			bulk_copy_match(HistoryPtr, CopyOffsetPtr, LengthOfMatch);
+			HistoryPtr += LengthOfMatch;
 		}
 		else
 		{
@@ -2480,6 +2478,47 @@ static int ncrush_find_best_match(NCRUSH_CONTEXT* ncrush, UINT16 HistoryOffset,
 	return MatchLength;
 }
 
+/* Walk the chain of earlier positions starting with the same two bytes, at most
+ * ncrush->SearchDepth of them, and return the longest match found. */
+static UINT32 ncrush_find_longest_match(NCRUSH_CONTEXT* ncrush, UINT32 HistoryOffset,
+                                        UINT32* pMatchOffset)
+{
+	UINT32 MatchLength = 0;
+	const BYTE* HistoryBuffer = ncrush->HistoryBuffer;
+	const BYTE* Current = &HistoryBuffer[HistoryOffset];
+	const intptr_t remaining = ncrush->HistoryPtr - Current;
+	UINT32 Offset = ncrush->MatchTable[HistoryOffset];
+
+	WINPR_ASSERT(pMatchOffset);
+
+	if (remaining < 3)
+		return 0;
+
+	for (UINT32 depth = 0; (depth < ncrush->SearchDepth) && Offset && (Offset < HistoryOffset);
+	     depth++)
+	{
+		/* a candidate can only be longer if it matches the byte after the current best */
+		if ((MatchLength < remaining) && (HistoryBuffer[Offset + MatchLength] == Current[MatchLength]))
+		{
+			const intptr_t len =
+			    ncrush_find_match_length(Current, &HistoryBuffer[Offset], ncrush->HistoryPtr);
+
+			if (len > MatchLength)
+			{
+				MatchLength = (UINT32)MIN(len, NCRUSH_MAX_MATCH_LENGTH);
+				*pMatchOffset = Offset;
+
+				if (MatchLength >= ncrush->GoodMatchLength)
+					break;
+			}
+		}
+
+		Offset = ncrush->MatchTable[Offset];
+	}
+
+	return (MatchLength >= 2) ? MatchLength : 0;
+}
+
 static int ncrush_move_encoder_windows(NCRUSH_CONTEXT* ncrush, BYTE* HistoryPtr)
 {
 	WINPR_ASSERT(ncrush);
@@ -2634,7 +2673,24 @@ int ncrush_compress(NCRUSH_CONTEXT* ncrush, const BYTE* pSrcData, UINT32 SrcSize
 		if (HistoryOffset >= 65536)
 			return -1004;
 
-		if (ncrush->MatchTable[HistoryOffset])
+		if (ncrush->MatchTable[HistoryOffset] && ncrush->SearchDepth)
+		{
+			MatchOffset = 0;
+			MatchLength = ncrush_find_longest_match(ncrush, HistoryOffset, &MatchOffset);
+
+			/* defer to a longer match starting at the next byte */
+			if (ncrush->LazyMatching && (MatchLength > 0) &&
+			    (MatchLength < ncrush->GoodMatchLength) && (SrcPtr + 1 < SrcEndPtr - 2) &&
+			    ncrush->MatchTable[HistoryOffset + 1])
+			{
+				UINT32 NextOffset = 0;
+
+				if (ncrush_find_longest_match(ncrush, HistoryOffset + 1, &NextOffset) >
+				    MatchLength + 1)
+					MatchLength = 0;
+			}
+		}
+		else if (ncrush->MatchTable[HistoryOffset])
 		{
 			int rc = 0;
 
@@ -3001,6 +3057,33 @@ void ncrush_context_reset(NCRUSH_CONTEXT* ncrush, BOOL flush)
 	ncrush->HistoryPtr = &(ncrush->HistoryBuffer[ncrush->HistoryOffset]);
 }
 
+void ncrush_set_compression_effort(NCRUSH_CONTEXT* ncrush, UINT32 effort)
+{
+	WINPR_ASSERT(ncrush);
+
+	switch (effort)
+	{
+		case BULK_COMPRESSION_EFFORT_FAST:
+			ncrush->SearchDepth = 4;
+			ncrush->GoodMatchLength = 32;
+			ncrush->LazyMatching = FALSE;
+			break;
+
+		case BULK_COMPRESSION_EFFORT_MAX:
+			ncrush->SearchDepth = 256;
+			ncrush->GoodMatchLength = NCRUSH_MAX_MATCH_LENGTH;
+			ncrush->LazyMatching = TRUE;
+			break;
+
+		case BULK_COMPRESSION_EFFORT_NORMAL:
+		default:
+			ncrush->SearchDepth = 0;
+			ncrush->GoodMatchLength = 0;
+			ncrush->LazyMatching = FALSE;
+			break;
+	}
+}
+
 NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor)
 {
 	NCRUSH_CONTEXT* ncrush = (NCRUSH_CONTEXT*)calloc(1, sizeof(NCRUSH_CONTEXT));
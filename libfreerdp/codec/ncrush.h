@@ -43,6 +43,17 @@ extern "C"
 
 	FREERDP_LOCAL void ncrush_context_reset(NCRUSH_CONTEXT* ncrush, BOOL flush);
 
+	/** Select how hard the compressor searches for matches.
+	 *
+	 *  BULK_COMPRESSION_EFFORT_NORMAL keeps the built-in match finder, FAST and MAX walk the
+	 *  hash chain of earlier positions to a small or a large depth, MAX also defers a match if
+	 *  the next byte starts a longer one.
+	 *
+	 *  @param ncrush The compressor context
+	 *  @param effort One of the BULK_COMPRESSION_EFFORT_* values
+	 */
+	FREERDP_LOCAL void ncrush_set_compression_effort(NCRUSH_CONTEXT* ncrush, UINT32 effort);
+
 	FREERDP_LOCAL NCRUSH_CONTEXT* ncrush_context_new(BOOL Compressor);
 	FREERDP_LOCAL void ncrush_context_free(NCRUSH_CONTEXT* ncrush);
 
@@ -332,6 +332,30 @@ BOOL nsc_encode(NSC_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT
 	return TRUE;
 }
 
+/* Number of consecutive positions i < max with in[i] == in[i + 1] */
+static UINT32 nsc_rle_run_length(const BYTE* WINPR_RESTRICT in, UINT32 max)
+{
+	const UINT64 pattern = 0x0101010101010101ULL * in[0];
+	UINT32 i = 0;
+
+	/* compare 8 bytes per round while the run continues */
+	while (i + 8 <= max)
+	{
+		UINT64 next = 0;
+		memcpy(&next, &in[i + 1], sizeof(next));
+
+		if (next != pattern)
+			break;
+
+		i += 8;
+	}
+
+	while ((i < max) && (in[i + 1] == in[0]))
+		i++;
+
+	return i;
+}
+
 static UINT32 nsc_rle_encode(const BYTE* WINPR_RESTRICT in, BYTE* WINPR_RESTRICT out,
                              UINT32 originalSize)
 {
@@ -348,7 +372,11 @@ static UINT32 nsc_rle_encode(const BYTE* WINPR_RESTRICT in, BYTE* WINPR_RESTRICT
 	{
 		if (left > 5 && *in == *(in + 1))
 		{
-			runlength++;
+			const UINT32 run = nsc_rle_run_length(in, left - 5);
+			runlength += run;
+			in += run;
+			left -= run;
+			continue;
 		}
 		else if (runlength == 1)
 		{
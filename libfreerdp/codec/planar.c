@@ -25,9 +25,12 @@
 #include <winpr/wtypes.h>
 #include <winpr/assert.h>
 #include <winpr/print.h>
+#include <winpr/pool.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/primitives.h>
 #include <freerdp/log.h>
+#include <freerdp/settings.h>
 #include <freerdp/codec/bitmap.h>
 #include <freerdp/codec/planar.h>
 
@@ -93,8 +96,40 @@ struct S_BITMAP_PLANAR_CONTEXT
 
 	BOOL bgr;
 	BOOL topdown;
+
+	DWORD flags;
+
+	/* batch encoding and RLE plane decoding, one scratch context per additional encoder thread */
+	BOOL UseThreads;
+	UINT32 nthreads;
+	PTP_POOL ThreadPool;
+	TP_CALLBACK_ENVIRON ThreadPoolEnv;
+	BITMAP_PLANAR_CONTEXT** workers;
 };
 
+typedef struct
+{
+	BITMAP_PLANAR_CONTEXT* planar;
+	const BYTE* data;
+	UINT32 format;
+	UINT32 scanline;
+	const RECTANGLE_16* rects;
+	BYTE** dstData;
+	UINT32* dstSizes;
+	size_t count;
+	BOOL success;
+} PLANAR_BATCH_WORK_PARAM;
+
+typedef struct
+{
+	const BYTE* src;
+	UINT32 size;
+	BYTE* dst;
+	UINT32 width;
+	UINT32 height;
+	INT32 status;
+} PLANAR_PLANE_WORK_PARAM;
+
 static INLINE UINT32 planar_invert_format(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar, BOOL alpha,
                                           UINT32 DstFormat)
 {
@@ -488,6 +523,58 @@ static INLINE INT32 planar_decompress_plane_rle(const BYTE* WINPR_RESTRICT pSrcD
 	return (INT32)(srcp - pSrcData);
 }
 
+static void planar_decompress_plane_work_callback(PVOID context, size_t index)
+{
+	PLANAR_PLANE_WORK_PARAM* params = (PLANAR_PLANE_WORK_PARAM*)context;
+	WINPR_ASSERT(params);
+
+	PLANAR_PLANE_WORK_PARAM* param = &params[index];
+	param->status =
+	    planar_decompress_plane_rle_only(param->src, param->size, param->dst, param->width,
+	                                     param->height);
+}
+
+/* Bitmaps this large have their RLE planes decoded concurrently */
+#define PLANAR_PARALLEL_MIN_PIXELS (128 * 128)
+
+static BOOL planar_use_threads(const BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar, UINT32 nWidth,
+                               UINT32 nHeight)
+{
+	if (!planar->UseThreads)
+		return FALSE;
+	return (1ull * nWidth * nHeight) >= PLANAR_PARALLEL_MIN_PIXELS;
+}
+
+/**
+ * Each scanline of a plane is delta coded against the previous one, so a plane
+ * can not be split. The planes themselves are independent, their offsets are
+ * known from the planar_skip_plane_rle pre-scan.
+ */
+static BOOL planar_decompress_planes_rle_only(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
+                                              PLANAR_PLANE_WORK_PARAM* WINPR_RESTRICT params,
+                                              size_t count, BOOL parallel)
+{
+	if (parallel && (count > 1))
+	{
+		if (!winpr_SubmitThreadpoolWorkBatch(planar_decompress_plane_work_callback, params, count,
+		                                     &planar->ThreadPoolEnv))
+			return FALSE;
+	}
+	else
+	{
+		for (size_t x = 0; x < count; x++)
+			planar_decompress_plane_work_callback(params, x);
+	}
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (params[x].status < 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static INLINE INT32 planar_set_plane(BYTE bValue, BYTE* pDstData, UINT32 nDstStep, UINT32 nXDst,
                                      UINT32 nYDst, UINT32 nWidth, UINT32 nHeight, UINT32 nChannel,
                                      BOOL vFlip)
@@ -527,10 +614,36 @@ static INLINE INT32 planar_set_plane(BYTE bValue, BYTE* pDstData, UINT32 nDstSte
 	return 0;
 }
 
-static INLINE BOOL writeLine(BYTE** WINPR_RESTRICT ppRgba, UINT32 DstFormat, UINT32 width,
+/* A missing alpha plane is written as 0xFF, matching FreeRDPGetColor for these formats */
+static INLINE BOOL writeLinePlanes(const primitives_t* WINPR_RESTRICT prims,
+                                   BYTE** WINPR_RESTRICT ppRgba, UINT32 DstFormat, UINT32 width,
+                                   const BYTE** WINPR_RESTRICT ppR,
+                                   const BYTE** WINPR_RESTRICT ppG,
+                                   const BYTE** WINPR_RESTRICT ppB,
+                                   const BYTE** WINPR_RESTRICT ppA)
+{
+	const BYTE* planes[4] = { *ppR, *ppG, *ppB, ppA ? *ppA : NULL };
+	const prim_size_t roi = { width, 1 };
+
+	if (prims->PlanesToRGB_8u_P4AC4R(planes, width, *ppRgba, width * 4, DstFormat, &roi) !=
+	    PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	*ppRgba += 4ull * width;
+	*ppR += width;
+	*ppG += width;
+	*ppB += width;
+	if (planes[3])
+		*ppA += width;
+	return TRUE;
+}
+
+static INLINE BOOL writeLine(const primitives_t* WINPR_RESTRICT prims,
+                             BYTE** WINPR_RESTRICT ppRgba, UINT32 DstFormat, UINT32 width,
                              const BYTE** WINPR_RESTRICT ppR, const BYTE** WINPR_RESTRICT ppG,
                              const BYTE** WINPR_RESTRICT ppB, const BYTE** WINPR_RESTRICT ppA)
 {
+	WINPR_ASSERT(prims);
 	WINPR_ASSERT(ppRgba);
 	WINPR_ASSERT(ppR);
 	WINPR_ASSERT(ppG);
@@ -539,26 +652,17 @@ static INLINE BOOL writeLine(BYTE** WINPR_RESTRICT ppRgba, UINT32 DstFormat, UIN
 	switch (DstFormat)
 	{
 		case PIXEL_FORMAT_BGRA32:
-			for (UINT32 x = 0; x < width; x++)
-			{
-				*(*ppRgba)++ = *(*ppB)++;
-				*(*ppRgba)++ = *(*ppG)++;
-				*(*ppRgba)++ = *(*ppR)++;
-				*(*ppRgba)++ = *(*ppA)++;
-			}
-
-			return TRUE;
+			WINPR_ASSERT(ppA);
+			return writeLinePlanes(prims, ppRgba, DstFormat, width, ppR, ppG, ppB, ppA);
 
 		case PIXEL_FORMAT_BGRX32:
-			for (UINT32 x = 0; x < width; x++)
-			{
-				*(*ppRgba)++ = *(*ppB)++;
-				*(*ppRgba)++ = *(*ppG)++;
-				*(*ppRgba)++ = *(*ppR)++;
-				*(*ppRgba)++ = 0xFF;
-			}
+			return writeLinePlanes(prims, ppRgba, DstFormat, width, ppR, ppG, ppB, NULL);
 
-			return TRUE;
+		case PIXEL_FORMAT_ARGB32:
+		case PIXEL_FORMAT_ABGR32:
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			return writeLinePlanes(prims, ppRgba, DstFormat, width, ppR, ppG, ppB, ppA);
 
 		default:
 			if (ppA)
@@ -603,6 +707,7 @@ static INLINE BOOL planar_decompress_planes_raw(const BYTE* WINPR_RESTRICT pSrcD
 	const BYTE* pB = pSrcData[2];
 	const BYTE* pA = pSrcData[3];
 	const UINT32 bpp = FreeRDPGetBytesPerPixel(DstFormat);
+	const primitives_t* prims = primitives_get();
 
 	if (vFlip)
 	{
@@ -648,7 +753,7 @@ static INLINE BOOL planar_decompress_planes_raw(const BYTE* WINPR_RESTRICT pSrcD
 
 		pRGB = &pDstData[((nYDst + y) * nDstStep) + (nXDst * bpp)];
 
-		if (!writeLine(&pRGB, DstFormat, nWidth, &pR, &pG, &pB, &pA))
+		if (!writeLine(prims, &pRGB, DstFormat, nWidth, &pR, &pG, &pB, &pA))
 			return FALSE;
 	}
 
@@ -941,6 +1046,40 @@ BOOL planar_decompress(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 			if ((SrcSize - (srcp - pSrcData)) == 1)
 				srcp++; /* pad */
 		}
+		else if (planar_use_threads(planar, nSrcWidth, nSrcHeight) && planar->rlePlanesBuffer &&
+		         (planeSize <= planar->maxPlaneSize)) /* RLE, planes decoded concurrently */
+		{
+			const BYTE* rleBuffer[4] = { 0 };
+			PLANAR_PLANE_WORK_PARAM params[4] = { 0 };
+			size_t count = 3;
+
+			for (size_t x = 0; x < 4; x++)
+			{
+				params[x].src = planes[x];
+				params[x].size = (UINT32)rleSizes[x];
+				params[x].dst = &planar->rlePlanesBuffer[x * planeSize];
+				params[x].width = nSrcWidth;
+				params[x].height = nSrcHeight;
+				rleBuffer[x] = params[x].dst;
+			}
+
+			if (useAlpha)
+				count = 4;
+			else
+				rleBuffer[3] = NULL;
+
+			if (!planar_decompress_planes_rle_only(planar, params, count, TRUE))
+				return FALSE;
+
+			/* the plane data is interleaved just like RAW data */
+			if (!planar_decompress_planes_raw(rleBuffer, pTempData, TempFormat, nTempStep, nXDst,
+			                                  nYDst, nSrcWidth, nSrcHeight, vFlip, nTotalHeight))
+				return FALSE;
+
+			srcp += rleSizes[0] + rleSizes[1] + rleSizes[2];
+			if (alpha)
+				srcp += rleSizes[3];
+		}
 		else /* RLE */
 		{
 			status =
@@ -1013,6 +1152,7 @@ BOOL planar_decompress(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 		if (rle) /* RLE encoded data. Decode and handle it like raw data. */
 		{
 			BYTE* rleBuffer[4] = { 0 };
+			PLANAR_PLANE_WORK_PARAM params[4] = { 0 };
 
 			if (!planar->rlePlanesBuffer)
 				return FALSE;
@@ -1021,38 +1161,23 @@ BOOL planar_decompress(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT planar,
 			rleBuffer[0] = rleBuffer[3] + planeSize; /* LumaOrRedPlane */
 			rleBuffer[1] = rleBuffer[0] + planeSize; /* OrangeChromaOrGreenPlane */
 			rleBuffer[2] = rleBuffer[1] + planeSize; /* GreenChromaOrBluePlane */
-			if (useAlpha)
-			{
-				status =
-				    planar_decompress_plane_rle_only(planes[3], rleSizes[3], rleBuffer[3],
-				                                     rawWidths[3], rawHeights[3]); /* AlphaPlane */
 
-				if (status < 0)
-					return FALSE;
+			/* LumaPlane, OrangeChromaPlane, GreenChromaPlane and AlphaPlane */
+			for (size_t x = 0; x < 4; x++)
+			{
+				params[x].src = planes[x];
+				params[x].size = (UINT32)rleSizes[x];
+				params[x].dst = rleBuffer[x];
+				params[x].width = rawWidths[x];
+				params[x].height = rawHeights[x];
 			}
 
-			if (alpha)
-				srcp += rleSizes[3];
-
-			status = planar_decompress_plane_rle_only(planes[0], rleSizes[0], rleBuffer[0],
-			                                          rawWidths[0], rawHeights[0]); /* LumaPlane */
-
-			if (status < 0)
-				return FALSE;
-
-			status =
-			    planar_decompress_plane_rle_only(planes[1], rleSizes[1], rleBuffer[1], rawWidths[1],
-			                                     rawHeights[1]); /* OrangeChromaPlane */
-
-			if (status < 0)
+			const BOOL parallel = planar_use_threads(planar, nSrcWidth, nSrcHeight);
+			if (!planar_decompress_planes_rle_only(planar, params, useAlpha ? 4 : 3, parallel))
 				return FALSE;
 
-			status =
-			    planar_decompress_plane_rle_only(planes[2], rleSizes[2], rleBuffer[2], rawWidths[2],
-			                                     rawHeights[2]); /* GreenChromaPlane */
-
-			if (status < 0)
-				return FALSE;
+			if (alpha)
+				srcp += rleSizes[3];
 
 			planes[0] = rleBuffer[0];
 			planes[1] = rleBuffer[1];
@@ -1125,6 +1250,39 @@ static INLINE BOOL freerdp_split_color_planes(BITMAP_PLANAR_CONTEXT* WINPR_RESTR
 	if (scanline == 0)
 		scanline = width * FreeRDPGetBytesPerPixel(format);
 
+	/* 32bpp formats are split by the primitives, the planar planes are stored A, R, G, B */
+	if (FreeRDPGetBytesPerPixel(format) == 4)
+	{
+		const primitives_t* prims = primitives_get();
+		BYTE* dst[4] = { planes[1], planes[2], planes[3], planes[0] };
+
+		if (planar->topdown)
+		{
+			const prim_size_t roi = { width, height };
+			if (prims->RGBToPlanes_8u_AC4P4R(data, scanline, format, dst, width, &roi) ==
+			    PRIMITIVES_SUCCESS)
+				return TRUE;
+		}
+		else
+		{
+			/* bottom up images are split one line at a time */
+			const prim_size_t roi = { width, 1 };
+			BOOL success = TRUE;
+
+			for (UINT32 i = 0; success && (i < height); i++)
+			{
+				const BYTE* src = &data[1ULL * scanline * (height - 1 - i)];
+				BYTE* line[4] = { &dst[0][1ULL * i * width], &dst[1][1ULL * i * width],
+					              &dst[2][1ULL * i * width], &dst[3][1ULL * i * width] };
+				success = prims->RGBToPlanes_8u_AC4P4R(src, scanline, format, line, width,
+				                                       &roi) == PRIMITIVES_SUCCESS;
+			}
+
+			if (success)
+				return TRUE;
+		}
+	}
+
 	if (planar->topdown)
 	{
 		UINT32 k = 0;
@@ -1456,7 +1614,6 @@ static INLINE BOOL freerdp_bitmap_planar_compress_planes_rle(BYTE* WINPR_RESTRIC
 BYTE* freerdp_bitmap_planar_delta_encode_plane(const BYTE* WINPR_RESTRICT inPlane, UINT32 width,
                                                UINT32 height, BYTE* WINPR_RESTRICT outPlane)
 {
-	char s2c = 0;
 	BYTE* outPtr = NULL;
 	const BYTE* srcPtr = NULL;
 	const BYTE* prevLinePtr = NULL;
@@ -1476,16 +1633,11 @@ BYTE* freerdp_bitmap_planar_delta_encode_plane(const BYTE* WINPR_RESTRICT inPlan
 	srcPtr = inPlane + width;
 	prevLinePtr = inPlane;
 
-	for (UINT32 y = 1; y < height; y++)
+	/* the planes are contiguous, so all lines are encoded in one go */
+	if (height > 1)
 	{
-		for (UINT32 x = 0; x < width; x++, outPtr++, srcPtr++, prevLinePtr++)
-		{
-			INT32 delta = *srcPtr - *prevLinePtr;
-			s2c = (delta >= 0) ? (char)delta : (char)(~((BYTE)(-delta)) + 1);
-			s2c = (s2c >= 0) ? (char)((UINT32)s2c << 1)
-			                 : (char)(((UINT32)(~((BYTE)s2c) + 1) << 1) - 1);
-			*outPtr = (BYTE)s2c;
-		}
+		const primitives_t* prims = primitives_get();
+		prims->deltaSignEncode_8u(srcPtr, prevLinePtr, outPtr, width * (height - 1));
 	}
 
 	return outPlane;
@@ -1682,6 +1834,125 @@ BYTE* freerdp_bitmap_compress_planar(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT conte
 	return dstData;
 }
 
+static void planar_compress_batch(PLANAR_BATCH_WORK_PARAM* WINPR_RESTRICT param)
+{
+	WINPR_ASSERT(param);
+
+	const size_t bpp = FreeRDPGetBytesPerPixel(param->format);
+
+	param->success = TRUE;
+	for (size_t x = 0; x < param->count; x++)
+	{
+		const RECTANGLE_16* rect = &param->rects[x];
+		const UINT32 width = rect->right - rect->left;
+		const UINT32 height = rect->bottom - rect->top;
+		const BYTE* src = &param->data[1ull * rect->top * param->scanline + bpp * rect->left];
+
+		BYTE* dst = freerdp_bitmap_compress_planar(param->planar, src, param->format, width,
+		                                           height, param->scanline, param->dstData[x],
+		                                           &param->dstSizes[x]);
+		if (!dst)
+		{
+			param->success = FALSE;
+			return;
+		}
+		param->dstData[x] = dst;
+	}
+}
+
+static void planar_compress_batch_work_callback(PVOID context, size_t index)
+{
+	PLANAR_BATCH_WORK_PARAM* params = (PLANAR_BATCH_WORK_PARAM*)context;
+	WINPR_ASSERT(params);
+
+	planar_compress_batch(&params[index]);
+}
+
+/* Worker contexts mirror the configuration of the context the batch was started on */
+static BITMAP_PLANAR_CONTEXT* planar_get_worker(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context,
+                                                UINT32 index)
+{
+	BITMAP_PLANAR_CONTEXT* worker = context->workers[index];
+
+	if (!worker)
+	{
+		worker = freerdp_bitmap_planar_context_new(context->flags, context->maxWidth,
+		                                           context->maxHeight);
+		if (!worker)
+			return NULL;
+		context->workers[index] = worker;
+	}
+	else if ((worker->maxWidth != context->maxWidth) || (worker->maxHeight != context->maxHeight))
+	{
+		if (!freerdp_bitmap_planar_context_reset(worker, context->maxWidth, context->maxHeight))
+			return NULL;
+	}
+
+	worker->bgr = context->bgr;
+	worker->topdown = context->topdown;
+	return worker;
+}
+
+BOOL freerdp_bitmap_compress_planar_batch(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context,
+                                          const BYTE* WINPR_RESTRICT data, UINT32 format,
+                                          UINT32 scanline, const RECTANGLE_16* WINPR_RESTRICT rects,
+                                          size_t count, BYTE* dstData[], UINT32 dstSizes[])
+{
+	BOOL rc = TRUE;
+
+	if (!context || !data || !rects || !dstData || !dstSizes)
+		return FALSE;
+
+	size_t nthreads = context->UseThreads ? MIN(context->nthreads, count) : 1;
+	if (nthreads < 2)
+	{
+		PLANAR_BATCH_WORK_PARAM param = { context, data,    format, scanline, rects,
+			                              dstData, dstSizes, count,  FALSE };
+		planar_compress_batch(&param);
+		return param.success;
+	}
+
+	PLANAR_BATCH_WORK_PARAM* params = calloc(nthreads, sizeof(PLANAR_BATCH_WORK_PARAM));
+	if (!params)
+		return FALSE;
+
+	/* Contiguous slices, each with its own context, slice 0 uses the context itself */
+	for (size_t x = 0; x < nthreads; x++)
+	{
+		const size_t first = x * count / nthreads;
+		const size_t last = (x + 1) * count / nthreads;
+		PLANAR_BATCH_WORK_PARAM* param = &params[x];
+
+		param->planar = (x == 0) ? context : planar_get_worker(context, (UINT32)x);
+		if (!param->planar)
+		{
+			nthreads = x;
+			rc = FALSE;
+			break;
+		}
+		param->data = data;
+		param->format = format;
+		param->scanline = scanline;
+		param->rects = &rects[first];
+		param->dstData = &dstData[first];
+		param->dstSizes = &dstSizes[first];
+		param->count = last - first;
+	}
+
+	if (!winpr_SubmitThreadpoolWorkBatch(planar_compress_batch_work_callback, params, nthreads,
+	                                     &context->ThreadPoolEnv))
+		rc = FALSE;
+
+	for (size_t x = 0; x < nthreads; x++)
+	{
+		if (!params[x].success)
+			rc = FALSE;
+	}
+
+	free(params);
+	return rc;
+}
+
 BOOL freerdp_bitmap_planar_context_reset(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT context,
                                          UINT32 width, UINT32 height)
 {
@@ -1742,6 +2013,14 @@ BOOL freerdp_bitmap_planar_context_reset(BITMAP_PLANAR_CONTEXT* WINPR_RESTRICT c
 
 BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new(DWORD flags, UINT32 maxWidth,
                                                          UINT32 maxHeight)
+{
+	return freerdp_bitmap_planar_context_new_ex(flags, maxWidth, maxHeight,
+	                                            THREADING_FLAGS_DISABLE_THREADS);
+}
+
+BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new_ex(DWORD flags, UINT32 maxWidth,
+                                                            UINT32 maxHeight,
+                                                            UINT32 ThreadingFlags)
 {
 	BITMAP_PLANAR_CONTEXT* context =
 	    (BITMAP_PLANAR_CONTEXT*)winpr_aligned_calloc(1, sizeof(BITMAP_PLANAR_CONTEXT), 32);
@@ -1749,6 +2028,8 @@ BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new(DWORD flags, UINT32 max
 	if (!context)
 		return NULL;
 
+	context->flags = flags;
+
 	if (flags & PLANAR_FORMAT_HEADER_NA)
 		context->AllowSkipAlpha = TRUE;
 
@@ -1764,15 +2045,39 @@ BITMAP_PLANAR_CONTEXT* freerdp_bitmap_planar_context_new(DWORD flags, UINT32 max
 		context->AllowDynamicColorFidelity = TRUE;
 
 	if (!freerdp_bitmap_planar_context_reset(context, maxWidth, maxHeight))
+		goto fail;
+
+	context->nthreads = 1;
+	if (!(ThreadingFlags & THREADING_FLAGS_DISABLE_THREADS))
 	{
-		WINPR_PRAGMA_DIAG_PUSH
-		WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-		freerdp_bitmap_planar_context_free(context);
-		WINPR_PRAGMA_DIAG_POP
-		return NULL;
+		SYSTEM_INFO sysInfos = { 0 };
+		GetNativeSystemInfo(&sysInfos);
+		context->UseThreads = (sysInfos.dwNumberOfProcessors > 1);
+		if (context->UseThreads)
+		{
+			context->nthreads = sysInfos.dwNumberOfProcessors;
+			context->ThreadPool = CreateThreadpool(NULL);
+			if (!context->ThreadPool)
+				goto fail;
+
+			InitializeThreadpoolEnvironment(&context->ThreadPoolEnv);
+			SetThreadpoolCallbackPool(&context->ThreadPoolEnv, context->ThreadPool);
+
+			/* The scratch contexts are allocated on first use of the batch API */
+			context->workers = calloc(context->nthreads, sizeof(BITMAP_PLANAR_CONTEXT*));
+			if (!context->workers)
+				goto fail;
+		}
 	}
 
 	return context;
+
+fail:
+	WINPR_PRAGMA_DIAG_PUSH
+	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
+	freerdp_bitmap_planar_context_free(context);
+	WINPR_PRAGMA_DIAG_POP
+	return NULL;
 }
 
 void freerdp_bitmap_planar_context_free(BITMAP_PLANAR_CONTEXT* context)
@@ -1780,6 +2085,20 @@ void freerdp_bitmap_planar_context_free(BITMAP_PLANAR_CONTEXT* context)
 	if (!context)
 		return;
 
+	if (context->UseThreads)
+	{
+		if (context->ThreadPool)
+			CloseThreadpool(context->ThreadPool);
+		DestroyThreadpoolEnvironment(&context->ThreadPoolEnv);
+
+		if (context->workers)
+		{
+			for (UINT32 x = 0; x < context->nthreads; x++)
+				freerdp_bitmap_planar_context_free(context->workers[x]);
+		}
+		free(context->workers);
+	}
+
 	winpr_aligned_free(context->pTempData);
 	winpr_aligned_free(context->planesBuffer);
 	winpr_aligned_free(context->deltaPlanesBuffer);
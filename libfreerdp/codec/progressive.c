@@ -25,6 +25,7 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 #include <winpr/bitstream.h>
+#include <winpr/intrin.h>
 
 #include <freerdp/primitives.h>
 #include <freerdp/codec/color.h>
@@ -345,15 +346,16 @@ progressive_get_surface_data(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, UI
 	return HashTable_GetItemValue(progressive->SurfaceContexts, key);
 }
 
+#define PROGRESSIVE_TILE_DATA_SIZE (64ULL * 64ULL * 4ULL)
+#define PROGRESSIVE_TILE_SIGN_SIZE ((8192ULL + 32ULL) * 3ULL)
+#define PROGRESSIVE_TILE_CURRENT_SIZE ((8192ULL + 32ULL) * 3ULL)
+#define PROGRESSIVE_TILE_BUFFER_SIZE \
+	(PROGRESSIVE_TILE_DATA_SIZE + PROGRESSIVE_TILE_SIGN_SIZE + PROGRESSIVE_TILE_CURRENT_SIZE)
+
+/* the tile buffers belong to the tileBuffers of the surface */
 static void progressive_tile_free(RFX_PROGRESSIVE_TILE* WINPR_RESTRICT tile)
 {
-	if (tile)
-	{
-		winpr_aligned_free(tile->sign);
-		winpr_aligned_free(tile->current);
-		winpr_aligned_free(tile->data);
-		winpr_aligned_free(tile);
-	}
+	winpr_aligned_free(tile);
 }
 
 static void progressive_surface_context_free(void* ptr)
@@ -372,42 +374,30 @@ static void progressive_surface_context_free(void* ptr)
 		}
 	}
 
+	for (size_t index = 0; index < surface->tileBuffersCount; index++)
+		winpr_large_free(surface->tileBuffers[index]);
+
+	free((void*)surface->tileBuffers);
 	winpr_aligned_free(surface->tiles);
 	winpr_aligned_free(surface->updatedTileIndices);
 	winpr_aligned_free(surface);
 }
 
-static INLINE RFX_PROGRESSIVE_TILE* progressive_tile_new(void)
+static INLINE RFX_PROGRESSIVE_TILE* progressive_tile_new(BYTE* WINPR_RESTRICT buffer)
 {
 	RFX_PROGRESSIVE_TILE* tile = winpr_aligned_calloc(1, sizeof(RFX_PROGRESSIVE_TILE), 32);
 	if (!tile)
-		goto fail;
+		return NULL;
 
 	tile->width = 64;
 	tile->height = 64;
 	tile->stride = 4 * tile->width;
 
-	size_t dataLen = 1ull * tile->stride * tile->height;
-	tile->data = (BYTE*)winpr_aligned_malloc(dataLen, 16);
-	if (!tile->data)
-		goto fail;
-	memset(tile->data, 0xFF, dataLen);
-
-	size_t signLen = (8192ULL + 32ULL) * 3ULL;
-	tile->sign = (BYTE*)winpr_aligned_malloc(signLen, 16);
-	if (!tile->sign)
-		goto fail;
-
-	size_t currentLen = (8192ULL + 32ULL) * 3ULL;
-	tile->current = (BYTE*)winpr_aligned_malloc(currentLen, 16);
-	if (!tile->current)
-		goto fail;
-
+	tile->data = buffer;
+	memset(tile->data, 0xFF, PROGRESSIVE_TILE_DATA_SIZE);
+	tile->sign = &tile->data[PROGRESSIVE_TILE_DATA_SIZE];
+	tile->current = &tile->sign[PROGRESSIVE_TILE_SIGN_SIZE];
 	return tile;
-
-fail:
-	progressive_tile_free(tile);
-	return NULL;
 }
 
 static INLINE BOOL
@@ -432,11 +422,24 @@ progressive_allocate_tile_cache(PROGRESSIVE_SURFACE_CONTEXT* WINPR_RESTRICT surf
 	surface->tilesSize = surface->gridSize;
 	surface->tiles = tmp;
 
-	for (size_t x = oldIndex; x < surface->tilesSize; x++)
+	/* The buffers of the new tiles share one large (huge page backed) block */
+	const size_t count = surface->gridSize - oldIndex;
+	tmp = realloc((void*)surface->tileBuffers, sizeof(BYTE*) * (surface->tileBuffersCount + 1));
+	if (!tmp)
+		return FALSE;
+	surface->tileBuffers = tmp;
+
+	BYTE* buffer = winpr_large_malloc(count * PROGRESSIVE_TILE_BUFFER_SIZE, 16);
+	if (!buffer)
+		return FALSE;
+	surface->tileBuffers[surface->tileBuffersCount++] = buffer;
+
+	for (size_t x = 0; x < count; x++)
 	{
-		surface->tiles[x] = progressive_tile_new();
-		if (!surface->tiles[x])
+		RFX_PROGRESSIVE_TILE* tile = progressive_tile_new(&buffer[x * PROGRESSIVE_TILE_BUFFER_SIZE]);
+		if (!tile)
 			return FALSE;
+		surface->tiles[oldIndex + x] = tile;
 	}
 
 	tmp =
@@ -1058,6 +1061,21 @@ fail:
 	return rc;
 }
 
+/* Number of leading '0' bits in the SRL accumulator, 32 if it is empty */
+static INLINE UINT32 progressive_rfx_srl_zeros(UINT32 accumulator)
+{
+#if defined(_WIN32) && !defined(__MINGW32__) && !defined(_M_ARM64)
+	unsigned long index = 0;
+
+	if (!_BitScanReverse(&index, accumulator))
+		return 32;
+
+	return 31 - index;
+#else
+	return accumulator ? __lzcnt(accumulator) : 32;
+#endif
+}
+
 static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINPR_RESTRICT state,
                                              UINT32 numBits)
 {
@@ -1130,15 +1148,22 @@ static INLINE INT16 progressive_rfx_srl_read(RFX_PROGRESSIVE_UPGRADE_STATE* WINP
 	UINT32 mag = 1;
 	const UINT32 max = (1 << numBits) - 1;
 
+	/* consume the run of '0' bits up to the terminating '1' bit at once */
 	while (mag < max)
 	{
-		const UINT32 bit = (bs->accumulator & 0x80000000) ? 1 : 0;
-		BitStream_Shift(bs, 1);
+		const UINT32 left = MIN(max - mag, 31);
+		const UINT32 zeros = progressive_rfx_srl_zeros(bs->accumulator);
 
-		if (bit)
-			break;
+		if (zeros >= left)
+		{
+			BitStream_Shift(bs, left);
+			mag += left;
+			continue;
+		}
 
-		mag++;
+		BitStream_Shift(bs, zeros + 1);
+		mag += zeros;
+		break;
 	}
 
 	if (mag > INT16_MAX)
@@ -1674,19 +1699,23 @@ static void CALLBACK progressive_process_tiles_tile_work_callback(PTP_CALLBACK_I
 	}
 }
 
+static void progressive_process_tiles_batch_callback(PVOID context, size_t index)
+{
+	PROGRESSIVE_TILE_PROCESS_WORK_PARAM* params = (PROGRESSIVE_TILE_PROCESS_WORK_PARAM*)context;
+	progressive_process_tiles_tile_work_callback(NULL, &params[index], NULL);
+}
+
 static INLINE SSIZE_T progressive_process_tiles(
     PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, wStream* WINPR_RESTRICT s,
     PROGRESSIVE_BLOCK_REGION* WINPR_RESTRICT region,
     PROGRESSIVE_SURFACE_CONTEXT* WINPR_RESTRICT surface,
     const PROGRESSIVE_BLOCK_CONTEXT* WINPR_RESTRICT context)
 {
-	int status = 0;
 	size_t end = 0;
 	const size_t start = Stream_GetPosition(s);
 	UINT16 blockType = 0;
 	UINT32 blockLen = 0;
 	UINT32 count = 0;
-	UINT16 close_cnt = 0;
 
 	WINPR_ASSERT(progressive);
 	WINPR_ASSERT(region);
@@ -1770,56 +1799,28 @@ static INLINE SSIZE_T progressive_process_tiles(
 
 	for (UINT32 idx = 0; idx < region->numTiles; idx++)
 	{
-		RFX_PROGRESSIVE_TILE* tile = region->tiles[idx];
 		PROGRESSIVE_TILE_PROCESS_WORK_PARAM* param = &progressive->params[idx];
 		param->progressive = progressive;
 		param->region = region;
 		param->context = context;
-		param->tile = tile;
+		param->tile = region->tiles[idx];
 
-		if (progressive->rfx_context->priv->UseThreads)
-		{
-			progressive->work_objects[idx] =
-			    CreateThreadpoolWork(progressive_process_tiles_tile_work_callback, (void*)param,
-			                         &progressive->rfx_context->priv->ThreadPoolEnv);
-			if (!progressive->work_objects[idx])
-			{
-				WLog_Print(progressive->log, WLOG_ERROR,
-				           "Failed to create ThreadpoolWork for tile %" PRIu32, idx);
-				status = -1;
-				break;
-			}
-
-			SubmitThreadpoolWork(progressive->work_objects[idx]);
-			close_cnt = idx + 1;
-		}
-		else
-		{
+		if (!progressive->rfx_context->priv->UseThreads)
 			progressive_process_tiles_tile_work_callback(0, param, 0);
-		}
-
-		if (status < 0)
-		{
-			WLog_Print(progressive->log, WLOG_ERROR, "Failed to decompress %s at %" PRIu16,
-			           rfx_get_progressive_block_type_string(tile->blockType), idx);
-			goto fail;
-		}
 	}
 
 	if (progressive->rfx_context->priv->UseThreads)
 	{
-		for (UINT32 idx = 0; idx < close_cnt; idx++)
+		if (!winpr_SubmitThreadpoolWorkBatch(progressive_process_tiles_batch_callback,
+		                                     progressive->params, region->numTiles,
+		                                     &progressive->rfx_context->priv->ThreadPoolEnv))
 		{
-			WaitForThreadpoolWorkCallbacks(progressive->work_objects[idx], FALSE);
-			CloseThreadpoolWork(progressive->work_objects[idx]);
+			WLog_Print(progressive->log, WLOG_ERROR, "Failed to decompress %" PRIu16 " tiles",
+			           region->numTiles);
+			return -1;
 		}
 	}
 
-fail:
-
-	if (status < 0)
-		return -1;
-
 	return (SSIZE_T)(end - start);
 }
 
@@ -2456,6 +2457,852 @@ fail:
 	return rc;
 }
 
+#define PROGRESSIVE_ENCODE_MAX_PASSES 4
+#define PROGRESSIVE_ENCODE_RLGR_SIZE 4096
+#define PROGRESSIVE_ENCODE_BITS_SIZE 24576
+
+static const RFX_COMPONENT_CODEC_QUANT progressive_rfx_default_quant = {
+	6, 6, 6, 6, 7, 7, 8, 8, 8, 9
+};
+
+/**
+ * Quant ladder used for the reduced quality passes, coarsest first.
+ * The last pass always uses the full quality (0xFF) quant.
+ */
+static const RFX_PROGRESSIVE_CODEC_QUANT progressive_rfx_quant_ladder[] = {
+	{ 25,
+	  { 2, 3, 3, 3, 4, 4, 4, 5, 5, 5 },
+	  { 2, 3, 3, 3, 4, 4, 4, 5, 5, 5 },
+	  { 2, 3, 3, 3, 4, 4, 4, 5, 5, 5 } },
+	{ 50,
+	  { 1, 2, 2, 2, 2, 2, 2, 3, 3, 3 },
+	  { 1, 2, 2, 2, 2, 2, 2, 3, 3, 3 },
+	  { 1, 2, 2, 2, 2, 2, 2, 3, 3, 3 } },
+	{ 75,
+	  { 0, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+	  { 0, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+	  { 0, 1, 1, 1, 1, 1, 1, 1, 1, 1 } }
+};
+
+/* Subband offsets of the reduce-extrapolate layout, see table above */
+static const size_t progressive_rfx_band_offsets[] = { 0,    1023, 2046, 3007, 3279, 3551,
+	                                                   3807, 3879, 3951, 4015, 4096 };
+
+static INLINE BYTE progressive_rfx_quant_band(const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT q,
+                                              size_t band)
+{
+	switch (band)
+	{
+		case 0:
+			return q->HL1;
+		case 1:
+			return q->LH1;
+		case 2:
+			return q->HH1;
+		case 3:
+			return q->HL2;
+		case 4:
+			return q->LH2;
+		case 5:
+			return q->HH2;
+		case 6:
+			return q->HL3;
+		case 7:
+			return q->LH3;
+		case 8:
+			return q->HH3;
+		default:
+			return q->LL3;
+	}
+}
+
+static INLINE const RFX_PROGRESSIVE_CODEC_QUANT*
+progressive_rfx_quant_prog(const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, BYTE quality)
+{
+	if (quality == 0xFF)
+		return &progressive->quantProgValFull;
+	WINPR_ASSERT(quality < ARRAYSIZE(progressive_rfx_quant_ladder));
+	return &progressive_rfx_quant_ladder[quality];
+}
+
+/* Passes use the ladder from its coarsest entry, the last pass is always full quality */
+static INLINE BYTE
+progressive_rfx_quality_next(const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, BYTE quality)
+{
+	if ((quality == 0xFF) || (quality + 2u >= progressive->numPasses))
+		return 0xFF;
+	return quality + 1;
+}
+
+/* Forward lifting of one line, the inverse of progressive_rfx_idwt_x/y */
+static INLINE void progressive_rfx_dwt(const INT16* WINPR_RESTRICT pSrc, size_t nSrcStep,
+                                       size_t nCount, INT16* WINPR_RESTRICT pLow, size_t nLowStep,
+                                       INT16* WINPR_RESTRICT pHigh, size_t nHighStep)
+{
+	const size_t nHighCount = (nCount - 1) / 2;
+
+	for (size_t k = 0; k < nHighCount; k++)
+	{
+		const INT32 x0 = pSrc[(2 * k) * nSrcStep];
+		const INT32 x1 = pSrc[(2 * k + 1) * nSrcStep];
+		const INT32 x2 = pSrc[(2 * k + 2) * nSrcStep];
+		pHigh[k * nHighStep] = (INT16)((x1 - ((x0 + x2) / 2)) / 2);
+	}
+
+	pLow[0] = (INT16)(pSrc[0] + pHigh[0]);
+
+	for (size_t k = 1; k < nHighCount; k++)
+	{
+		const INT32 h0 = pHigh[(k - 1) * nHighStep];
+		const INT32 h1 = pHigh[k * nHighStep];
+		pLow[k * nLowStep] = (INT16)(pSrc[(2 * k) * nSrcStep] + ((h0 + h1) / 2));
+	}
+
+	const INT32 xn = pSrc[(2 * nHighCount) * nSrcStep];
+	const INT32 hn = pHigh[(nHighCount - 1) * nHighStep];
+
+	if (nCount & 1)
+	{
+		pLow[nHighCount * nLowStep] = (INT16)(xn + hn);
+	}
+	else
+	{
+		/* The last sample is extrapolated from the two low band samples */
+		const INT32 xl = pSrc[(2 * nHighCount + 1) * nSrcStep];
+		pLow[nHighCount * nLowStep] = (INT16)(xn + (hn / 2));
+		pLow[(nHighCount + 1) * nLowStep] = (INT16)((2 * xl) - xn);
+	}
+}
+
+static INLINE void progressive_rfx_dwt_2d_encode_block(INT16* WINPR_RESTRICT buffer,
+                                                       INT16* WINPR_RESTRICT temp, size_t level)
+{
+	const size_t nBandL = progressive_rfx_get_band_l_count(level);
+	const size_t nBandH = progressive_rfx_get_band_h_count(level);
+	const size_t nCount = nBandL + nBandH;
+
+	INT16* HL = &buffer[0];
+	INT16* LH = &HL[nBandL * nBandH];
+	INT16* HH = &LH[nBandH * nBandL];
+	INT16* LL = &HH[nBandH * nBandH];
+	INT16* L = &temp[0];
+	INT16* H = &temp[nBandL * nCount];
+
+	/* vertical (LL -> L + H) */
+	for (size_t x = 0; x < nCount; x++)
+		progressive_rfx_dwt(&buffer[x], nCount, nCount, &L[x], nCount, &H[x], nCount);
+
+	/* horizontal (L -> LL + HL) */
+	for (size_t y = 0; y < nBandL; y++)
+		progressive_rfx_dwt(&L[y * nCount], 1, nCount, &LL[y * nBandL], 1, &HL[y * nBandH], 1);
+
+	/* horizontal (H -> LH + HH) */
+	for (size_t y = 0; y < nBandH; y++)
+		progressive_rfx_dwt(&H[y * nCount], 1, nCount, &LH[y * nBandL], 1, &HH[y * nBandH], 1);
+}
+
+static INLINE void progressive_rfx_dwt_2d_encode(INT16* WINPR_RESTRICT buffer,
+                                                 INT16* WINPR_RESTRICT temp)
+{
+	progressive_rfx_dwt_2d_encode_block(&buffer[0], temp, 1);
+	progressive_rfx_dwt_2d_encode_block(&buffer[3007], temp, 2);
+	progressive_rfx_dwt_2d_encode_block(&buffer[3807], temp, 3);
+}
+
+/**
+ * Bias the coefficients by half of the full quality step.
+ * All passes truncate the same biased magnitudes, so the bit planes stay
+ * consistent while the final pass ends up rounded instead of truncated.
+ */
+static INLINE void
+progressive_rfx_round_component(INT16* WINPR_RESTRICT buffer,
+                                const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT quant)
+{
+	for (size_t band = 0; band < 10; band++)
+	{
+		const BYTE shift = progressive_rfx_quant_band(quant, band) - 1;
+		const INT32 half = 1 << (shift - 1);
+
+		for (size_t i = progressive_rfx_band_offsets[band];
+		     i < progressive_rfx_band_offsets[band + 1]; i++)
+		{
+			INT32 v = buffer[i];
+
+			if ((band == 9) || (v > 0))
+				v += half;
+			else if (v < 0)
+				v -= half;
+
+			buffer[i] = (INT16)MAX(INT16_MIN, MIN(INT16_MAX, v));
+		}
+	}
+}
+
+static INLINE void
+progressive_rfx_quantize_component(const INT16* WINPR_RESTRICT coefficients,
+                                   INT16* WINPR_RESTRICT buffer,
+                                   const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT bitPos)
+{
+	for (size_t band = 0; band < 10; band++)
+	{
+		const BYTE shift = progressive_rfx_quant_band(bitPos, band) - 1;
+
+		for (size_t i = progressive_rfx_band_offsets[band];
+		     i < progressive_rfx_band_offsets[band + 1]; i++)
+		{
+			const INT32 v = coefficients[i];
+
+			if (band == 9)
+				buffer[i] = (INT16)(v >> shift); /* LL3 is refined with unsigned RAW bits */
+			else if (v < 0)
+				buffer[i] = (INT16)(-((-v) >> shift));
+			else
+				buffer[i] = (INT16)(v >> shift);
+		}
+	}
+
+	rfx_differential_encode(&buffer[4015], 81);
+}
+
+/* The inverse of progressive_rfx_srl_read, state->nz counts the pending zero run */
+static INLINE void progressive_rfx_srl_write(RFX_PROGRESSIVE_UPGRADE_STATE* WINPR_RESTRICT state,
+                                             INT32 value, UINT32 numBits)
+{
+	wBitStream* bs = state->srl;
+	const UINT32 k = state->kp / 8;
+
+	if (value == 0)
+	{
+		state->nz++;
+
+		if (state->nz == (1 << k))
+		{
+			/* '0' bit, a full run of (1 << k) zeros */
+			BitStream_Write_Bits(bs, 0, 1);
+			state->nz = 0;
+			state->kp = MIN(state->kp + 4, 80);
+		}
+
+		return;
+	}
+
+	/* '1' bit followed by the remaining run length and the sign */
+	BitStream_Write_Bits(bs, 1, 1);
+
+	if (k)
+		BitStream_Write_Bits(bs, (UINT32)state->nz, k);
+
+	state->nz = 0;
+	BitStream_Write_Bits(bs, (value < 0) ? 1 : 0, 1);
+
+	if (state->kp < 6)
+		state->kp = 0;
+	else
+		state->kp -= 6;
+
+	if (numBits == 1)
+		return;
+
+	/* unary magnitude, the terminating bit is implied for the maximum */
+	const UINT32 max = (1u << numBits) - 1;
+	const UINT32 mag = (UINT32)abs(value);
+
+	for (UINT32 zeros = mag - 1; zeros > 0;)
+	{
+		const UINT32 count = MIN(zeros, 16);
+		BitStream_Write_Bits(bs, 0, count);
+		zeros -= count;
+	}
+
+	if (mag < max)
+		BitStream_Write_Bits(bs, 1, 1);
+}
+
+static INLINE BOOL progressive_rfx_upgrade_encode_component(
+    const INT16* WINPR_RESTRICT coefficients,
+    const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT prevBitPos,
+    const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT bitPos, BYTE* WINPR_RESTRICT srlData,
+    UINT16* WINPR_RESTRICT srlLen, BYTE* WINPR_RESTRICT rawData, UINT16* WINPR_RESTRICT rawLen)
+{
+	wBitStream s_srl = { 0 };
+	wBitStream s_raw = { 0 };
+	RFX_PROGRESSIVE_UPGRADE_STATE state = { 0 };
+
+	state.kp = 8;
+	state.srl = &s_srl;
+	state.raw = &s_raw;
+	BitStream_Attach(state.srl, srlData, PROGRESSIVE_ENCODE_BITS_SIZE);
+	BitStream_Attach(state.raw, rawData, PROGRESSIVE_ENCODE_BITS_SIZE);
+
+	for (size_t band = 0; band < 10; band++)
+	{
+		const BYTE prev = progressive_rfx_quant_band(prevBitPos, band);
+		const BYTE cur = progressive_rfx_quant_band(bitPos, band);
+
+		if (prev < cur)
+			return FALSE;
+
+		const UINT32 numBits = prev - cur;
+		if (!numBits)
+			continue;
+
+		const UINT32 prevShift = prev - 1u;
+		const UINT32 shift = cur - 1u;
+		const UINT32 mask = (1u << numBits) - 1;
+		state.nonLL = (band != 9);
+
+		for (size_t i = progressive_rfx_band_offsets[band];
+		     i < progressive_rfx_band_offsets[band + 1]; i++)
+		{
+			const INT32 v = coefficients[i];
+
+			if (!state.nonLL)
+			{
+				BitStream_Write_Bits(state.raw, (UINT32)(v >> shift) & mask, numBits);
+				continue;
+			}
+
+			const UINT32 mag = (UINT32)abs(v);
+
+			if (mag >> prevShift)
+				BitStream_Write_Bits(state.raw, (mag >> shift) & mask, numBits);
+			else
+			{
+				const INT32 value = (INT32)(mag >> shift);
+				progressive_rfx_srl_write(&state, (v < 0) ? -value : value, numBits);
+			}
+		}
+	}
+
+	/* A trailing zero run is terminated by a single '0' bit */
+	if (state.nz)
+		BitStream_Write_Bits(state.srl, 0, 1);
+
+	BitStream_Flush(state.srl);
+	BitStream_Flush(state.raw);
+	*srlLen = (UINT16)((state.srl->position + 7) / 8);
+	*rawLen = (UINT16)((state.raw->position + 7) / 8);
+	return TRUE;
+}
+
+static BOOL progressive_encode_tile_coefficients(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                                 RFX_PROGRESSIVE_ENCODE_TILE* WINPR_RESTRICT tile,
+                                                 const BYTE* WINPR_RESTRICT pSrcData,
+                                                 UINT32 SrcFormat, UINT32 ScanLine, UINT32 nXSrc,
+                                                 UINT32 nYSrc, UINT32 nWidth, UINT32 nHeight)
+{
+	INT16* pSrcDst[3] = { 0 };
+	static const prim_size_t roi_64x64 = { 64, 64 };
+	const primitives_t* prims = primitives_get();
+	const size_t bpp = FreeRDPGetBytesPerPixel(SrcFormat);
+
+	WINPR_ASSERT(nWidth > 0);
+	WINPR_ASSERT(nHeight > 0);
+
+	if (!tile->coefficients)
+	{
+		tile->coefficients = winpr_aligned_calloc(3ULL * 4096ULL, sizeof(INT16), 32);
+		if (!tile->coefficients)
+			return FALSE;
+	}
+
+	BYTE* pBuffer = (BYTE*)BufferPool_Take(progressive->bufferPool, -1);
+	INT16* temp = (INT16*)BufferPool_Take(progressive->bufferPool, -1); /* DWT buffer */
+	if (!pBuffer || !temp)
+	{
+		BufferPool_Return(progressive->bufferPool, pBuffer);
+		BufferPool_Return(progressive->bufferPool, temp);
+		return FALSE;
+	}
+
+	pSrcDst[0] = (INT16*)((&pBuffer[((8192 + 32) * 0) + 16])); /* Y/R buffer */
+	pSrcDst[1] = (INT16*)((&pBuffer[((8192 + 32) * 1) + 16])); /* Cb/G buffer */
+	pSrcDst[2] = (INT16*)((&pBuffer[((8192 + 32) * 2) + 16])); /* Cr/B buffer */
+
+	/* Pixels outside of the surface repeat the last column and row */
+	for (UINT32 y = 0; y < 64; y++)
+	{
+		const BYTE* src = &pSrcData[1ULL * (nYSrc + MIN(y, nHeight - 1)) * ScanLine];
+
+		for (UINT32 x = 0; x < 64; x++)
+		{
+			BYTE r = 0;
+			BYTE g = 0;
+			BYTE b = 0;
+			const BYTE* pixel = &src[(nXSrc + MIN(x, nWidth - 1)) * bpp];
+			const UINT32 color = FreeRDPReadColor(pixel, SrcFormat);
+
+			FreeRDPSplitColor(color, SrcFormat, &r, &g, &b, NULL, NULL);
+			pSrcDst[0][y * 64 + x] = r;
+			pSrcDst[1][y * 64 + x] = g;
+			pSrcDst[2][y * 64 + x] = b;
+		}
+	}
+
+	const INT16** ptr = WINPR_REINTERPRET_CAST(pSrcDst, INT16**, const INT16**);
+	prims->RGBToYCbCr_16s16s_P3P3(ptr, 64 * sizeof(INT16), pSrcDst, 64 * sizeof(INT16),
+	                              &roi_64x64);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		INT16* coefficients = &tile->coefficients[c * 4096];
+
+		CopyMemory(coefficients, pSrcDst[c], 4096ULL * sizeof(INT16));
+		progressive_rfx_dwt_2d_encode(coefficients, temp);
+		progressive_rfx_round_component(coefficients, &progressive_rfx_default_quant);
+	}
+
+	BufferPool_Return(progressive->bufferPool, temp);
+	BufferPool_Return(progressive->bufferPool, pBuffer);
+	return TRUE;
+}
+
+static INLINE void progressive_encode_bit_pos(const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                              BYTE quality, RFX_COMPONENT_CODEC_QUANT bitPos[3])
+{
+	const RFX_PROGRESSIVE_CODEC_QUANT* prog = progressive_rfx_quant_prog(progressive, quality);
+
+	progressive_rfx_quant_add(&progressive_rfx_default_quant, &prog->yQuantValues, &bitPos[0]);
+	progressive_rfx_quant_add(&progressive_rfx_default_quant, &prog->cbQuantValues, &bitPos[1]);
+	progressive_rfx_quant_add(&progressive_rfx_default_quant, &prog->crQuantValues, &bitPos[2]);
+}
+
+static BOOL progressive_write_tile_first(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                         wStream* WINPR_RESTRICT s,
+                                         const RFX_PROGRESSIVE_ENCODE_TILE* WINPR_RESTRICT tile,
+                                         UINT16 xIdx, UINT16 yIdx)
+{
+	BOOL rc = FALSE;
+	int len[3] = { 0 };
+	BYTE* data[3] = { 0 };
+	RFX_COMPONENT_CODEC_QUANT bitPos[3] = { 0 };
+
+	INT16* buffer = (INT16*)BufferPool_Take(progressive->bufferPool, -1);
+	if (!buffer)
+		return FALSE;
+
+	progressive_encode_bit_pos(progressive, tile->quality, bitPos);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		data[c] = &progressive->encodeBuffer[c * PROGRESSIVE_ENCODE_RLGR_SIZE];
+
+		/* The RLGR encoder expects a zero initialized buffer */
+		ZeroMemory(data[c], PROGRESSIVE_ENCODE_RLGR_SIZE);
+		progressive_rfx_quantize_component(&tile->coefficients[c * 4096], buffer, &bitPos[c]);
+		len[c] = progressive->rfx_context->rlgr_encode(RLGR1, buffer, 4096, data[c],
+		                                               PROGRESSIVE_ENCODE_RLGR_SIZE);
+		if ((len[c] < 0) || (len[c] > PROGRESSIVE_ENCODE_RLGR_SIZE))
+			goto fail;
+	}
+
+	const UINT32 blockLen = 23 + (UINT32)len[0] + (UINT32)len[1] + (UINT32)len[2];
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		goto fail;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_FIRST); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                   /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                           /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, xIdx);                       /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, yIdx);                       /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, 0);                           /* flags (1 byte) */
+	Stream_Write_UINT8(s, tile->quality);               /* quality (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)len[0]);             /* yLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)len[1]);             /* cbLen (2 bytes) */
+	Stream_Write_UINT16(s, (UINT16)len[2]);             /* crLen (2 bytes) */
+	Stream_Write_UINT16(s, 0);                          /* tailLen (2 bytes) */
+	Stream_Write(s, data[0], (size_t)len[0]);           /* yData */
+	Stream_Write(s, data[1], (size_t)len[1]);           /* cbData */
+	Stream_Write(s, data[2], (size_t)len[2]);           /* crData */
+	rc = TRUE;
+fail:
+	BufferPool_Return(progressive->bufferPool, buffer);
+	return rc;
+}
+
+static BOOL progressive_write_tile_upgrade(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                           wStream* WINPR_RESTRICT s,
+                                           const RFX_PROGRESSIVE_ENCODE_TILE* WINPR_RESTRICT tile,
+                                           BYTE prevQuality, UINT16 xIdx, UINT16 yIdx)
+{
+	UINT16 srlLen[3] = { 0 };
+	UINT16 rawLen[3] = { 0 };
+	BYTE* srlData[3] = { 0 };
+	BYTE* rawData[3] = { 0 };
+	RFX_COMPONENT_CODEC_QUANT prevBitPos[3] = { 0 };
+	RFX_COMPONENT_CODEC_QUANT bitPos[3] = { 0 };
+	UINT32 blockLen = 26;
+
+	progressive_encode_bit_pos(progressive, prevQuality, prevBitPos);
+	progressive_encode_bit_pos(progressive, tile->quality, bitPos);
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		srlData[c] = &progressive->encodeBuffer[(2 * c) * PROGRESSIVE_ENCODE_BITS_SIZE];
+		rawData[c] = &progressive->encodeBuffer[(2 * c + 1) * PROGRESSIVE_ENCODE_BITS_SIZE];
+
+		if (!progressive_rfx_upgrade_encode_component(&tile->coefficients[c * 4096],
+		                                              &prevBitPos[c], &bitPos[c], srlData[c],
+		                                              &srlLen[c], rawData[c], &rawLen[c]))
+			return FALSE;
+
+		blockLen += srlLen[c] + rawLen[c];
+	}
+
+	if (!Stream_EnsureRemainingCapacity(s, blockLen))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_TILE_UPGRADE); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, blockLen);                     /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxY (1 byte) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxCb (1 byte) */
+	Stream_Write_UINT8(s, 0);                             /* quantIdxCr (1 byte) */
+	Stream_Write_UINT16(s, xIdx);                         /* xIdx (2 bytes) */
+	Stream_Write_UINT16(s, yIdx);                         /* yIdx (2 bytes) */
+	Stream_Write_UINT8(s, tile->quality);                 /* quality (1 byte) */
+	Stream_Write_UINT16(s, srlLen[0]);                    /* ySrlLen (2 bytes) */
+	Stream_Write_UINT16(s, rawLen[0]);                    /* yRawLen (2 bytes) */
+	Stream_Write_UINT16(s, srlLen[1]);                    /* cbSrlLen (2 bytes) */
+	Stream_Write_UINT16(s, rawLen[1]);                    /* cbRawLen (2 bytes) */
+	Stream_Write_UINT16(s, srlLen[2]);                    /* crSrlLen (2 bytes) */
+	Stream_Write_UINT16(s, rawLen[2]);                    /* crRawLen (2 bytes) */
+
+	for (size_t c = 0; c < 3; c++)
+	{
+		Stream_Write(s, srlData[c], srlLen[c]); /* SrlData */
+		Stream_Write(s, rawData[c], rawLen[c]); /* RawData */
+	}
+
+	return TRUE;
+}
+
+static INLINE void progressive_write_quant(wStream* WINPR_RESTRICT s,
+                                           const RFX_COMPONENT_CODEC_QUANT* WINPR_RESTRICT q)
+{
+	Stream_Write_UINT8(s, (UINT8)(q->LL3 | (q->HL3 << 4))); /* LL3 (4-bit), HL3 (4-bit) */
+	Stream_Write_UINT8(s, (UINT8)(q->LH3 | (q->HH3 << 4))); /* LH3 (4-bit), HH3 (4-bit) */
+	Stream_Write_UINT8(s, (UINT8)(q->HL2 | (q->LH2 << 4))); /* HL2 (4-bit), LH2 (4-bit) */
+	Stream_Write_UINT8(s, (UINT8)(q->HH2 | (q->HL1 << 4))); /* HH2 (4-bit), HL1 (4-bit) */
+	Stream_Write_UINT8(s, (UINT8)(q->LH1 | (q->HH1 << 4))); /* LH1 (4-bit), HH1 (4-bit) */
+}
+
+static BOOL progressive_write_message(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                      wStream* WINPR_RESTRICT s,
+                                      const RFX_RECT* WINPR_RESTRICT rects, UINT16 numRects,
+                                      const BYTE* WINPR_RESTRICT prevQuality)
+{
+	const UINT32 numProgQuant = ARRAYSIZE(progressive_rfx_quant_ladder);
+	const size_t headerLen = 12 + 10 + 12 + 18 + 8ULL * numRects + 5 + 16ULL * numProgQuant;
+
+	if (!Stream_EnsureRemainingCapacity(s, headerLen + 6))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_SYNC); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 12);                   /* blockLen (4 bytes) */
+	Stream_Write_UINT32(s, 0xCACCACCA);           /* magic (4 bytes) */
+	Stream_Write_UINT16(s, 0x0100);               /* version (2 bytes) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_CONTEXT); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 10);                      /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 0);                        /* ctxId (1 byte) */
+	Stream_Write_UINT16(s, 64);                      /* tileSize (2 bytes) */
+	Stream_Write_UINT8(s, RFX_SUBBAND_DIFFING);      /* flags (1 byte) */
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_BEGIN);          /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 12);                                   /* blockLen (4 bytes) */
+	Stream_Write_UINT32(s, progressive->rfx_context->frameIdx++); /* frameIndex (4 bytes) */
+	Stream_Write_UINT16(s, 1);                                    /* regionCount (2 bytes) */
+
+	const size_t start = Stream_GetPosition(s);
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_REGION);              /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 0);                                   /* blockLen (4 bytes) */
+	Stream_Write_UINT8(s, 64);                                   /* tileSize (1 byte) */
+	Stream_Write_UINT16(s, numRects);                            /* numRects (2 bytes) */
+	Stream_Write_UINT8(s, 1);                                    /* numQuant (1 byte) */
+	Stream_Write_UINT8(s, (UINT8)numProgQuant);                  /* numProgQuant (1 byte) */
+	Stream_Write_UINT8(s, RFX_DWT_REDUCE_EXTRAPOLATE);           /* flags (1 byte) */
+	Stream_Write_UINT16(s, (UINT16)progressive->numEncodeTiles); /* numTiles (2 bytes) */
+	Stream_Write_UINT32(s, 0);                                   /* tileDataSize (4 bytes) */
+
+	for (UINT16 i = 0; i < numRects; i++)
+	{
+		/* TS_RFX_RECT */
+		const RFX_RECT* r = &rects[i];
+		Stream_Write_UINT16(s, r->x);      /* x (2 bytes) */
+		Stream_Write_UINT16(s, r->y);      /* y (2 bytes) */
+		Stream_Write_UINT16(s, r->width);  /* width (2 bytes) */
+		Stream_Write_UINT16(s, r->height); /* height (2 bytes) */
+	}
+
+	progressive_write_quant(s, &progressive_rfx_default_quant);
+
+	for (UINT32 i = 0; i < numProgQuant; i++)
+	{
+		/* RFX_PROGRESSIVE_CODEC_QUANT */
+		const RFX_PROGRESSIVE_CODEC_QUANT* q = &progressive_rfx_quant_ladder[i];
+		Stream_Write_UINT8(s, q->quality); /* quality (1 byte) */
+		progressive_write_quant(s, &q->yQuantValues);
+		progressive_write_quant(s, &q->cbQuantValues);
+		progressive_write_quant(s, &q->crQuantValues);
+	}
+
+	const size_t tileStart = Stream_GetPosition(s);
+
+	for (UINT32 i = 0; i < progressive->numEncodeTiles; i++)
+	{
+		const UINT32 index = progressive->encodeTileIndices[i];
+		const RFX_PROGRESSIVE_ENCODE_TILE* tile = &progressive->encodeTiles[index];
+		const UINT16 xIdx = (UINT16)(index % progressive->encodeGridWidth);
+		const UINT16 yIdx = (UINT16)(index / progressive->encodeGridWidth);
+
+		if (prevQuality)
+		{
+			if (!progressive_write_tile_upgrade(progressive, s, tile, prevQuality[i], xIdx, yIdx))
+				return FALSE;
+		}
+		else if (!progressive_write_tile_first(progressive, s, tile, xIdx, yIdx))
+			return FALSE;
+	}
+
+	const size_t end = Stream_GetPosition(s);
+	if ((end - start) > UINT32_MAX)
+		return FALSE;
+
+	Stream_SetPosition(s, start + 2);
+	Stream_Write_UINT32(s, (UINT32)(end - start)); /* blockLen (4 bytes) */
+	Stream_Seek(s, 8);
+	Stream_Write_UINT32(s, (UINT32)(end - tileStart)); /* tileDataSize (4 bytes) */
+	Stream_SetPosition(s, end);
+
+	if (!Stream_EnsureRemainingCapacity(s, 6))
+		return FALSE;
+
+	Stream_Write_UINT16(s, PROGRESSIVE_WBT_FRAME_END); /* blockType (2 bytes) */
+	Stream_Write_UINT32(s, 6);                         /* blockLen (4 bytes) */
+	return TRUE;
+}
+
+static void progressive_encode_tiles_free(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
+{
+	if (progressive->encodeTiles)
+	{
+		for (UINT32 i = 0; i < progressive->encodeGridSize; i++)
+			winpr_aligned_free(progressive->encodeTiles[i].coefficients);
+	}
+
+	winpr_aligned_free(progressive->encodeTiles);
+	winpr_aligned_free(progressive->encodeTileIndices);
+	progressive->encodeTiles = NULL;
+	progressive->encodeTileIndices = NULL;
+	progressive->encodeGridWidth = 0;
+	progressive->encodeGridSize = 0;
+	progressive->encodeWidth = 0;
+	progressive->encodeHeight = 0;
+}
+
+static BOOL progressive_encode_tiles_update(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                            UINT32 Width, UINT32 Height)
+{
+	if (progressive->encodeTiles && (progressive->encodeWidth == Width) &&
+	    (progressive->encodeHeight == Height))
+		return TRUE;
+
+	progressive_encode_tiles_free(progressive);
+
+	const UINT32 gridWidth = (Width + 63) / 64;
+	const UINT32 gridSize = gridWidth * ((Height + 63) / 64);
+	if (gridSize > UINT16_MAX)
+	{
+		WLog_Print(progressive->log, WLOG_ERROR, "surface %" PRIu32 "x%" PRIu32 " too large",
+		           Width, Height);
+		return FALSE;
+	}
+
+	if (!progressive->encodeBuffer)
+	{
+		progressive->encodeBuffer =
+		    winpr_aligned_malloc(6ULL * PROGRESSIVE_ENCODE_BITS_SIZE + 16ULL, 32);
+		if (!progressive->encodeBuffer)
+			return FALSE;
+	}
+
+	progressive->encodeTiles =
+	    winpr_aligned_calloc(gridSize, sizeof(RFX_PROGRESSIVE_ENCODE_TILE), 32);
+	progressive->encodeTileIndices = winpr_aligned_calloc(gridSize, sizeof(UINT32), 32);
+	if (!progressive->encodeTiles || !progressive->encodeTileIndices)
+	{
+		progressive_encode_tiles_free(progressive);
+		return FALSE;
+	}
+
+	progressive->encodeWidth = Width;
+	progressive->encodeHeight = Height;
+	progressive->encodeGridWidth = gridWidth;
+	progressive->encodeGridSize = gridSize;
+	return TRUE;
+}
+
+UINT32
+progressive_context_get_pending_upgrades(const PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
+{
+	UINT32 count = 0;
+
+	if (!progressive || !progressive->encodeTiles)
+		return 0;
+
+	for (UINT32 index = 0; index < progressive->encodeGridSize; index++)
+	{
+		if (progressive->encodeTiles[index].pending)
+			count++;
+	}
+
+	return count;
+}
+
+static int progressive_compress_first(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                      const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                                      UINT32 Width, UINT32 Height, UINT32 ScanLine,
+                                      const RFX_RECT* WINPR_RESTRICT rects, UINT32 numRects,
+                                      BYTE** WINPR_RESTRICT ppDstData,
+                                      UINT32* WINPR_RESTRICT pDstSize)
+{
+	int res = -6;
+
+	if (numRects > UINT16_MAX)
+		return -5;
+
+	if (!progressive_encode_tiles_update(progressive, Width, Height))
+		return -5;
+
+	progressive->numEncodeTiles = 0;
+
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		const RFX_RECT* r = &rects[i];
+		const UINT32 right = MIN(Width, 1u * r->x + r->width);
+		const UINT32 bottom = MIN(Height, 1u * r->y + r->height);
+
+		for (UINT32 yIdx = r->y / 64; yIdx * 64 < bottom; yIdx++)
+		{
+			for (UINT32 xIdx = r->x / 64; xIdx * 64 < right; xIdx++)
+			{
+				const UINT32 index = yIdx * progressive->encodeGridWidth + xIdx;
+				RFX_PROGRESSIVE_ENCODE_TILE* tile = &progressive->encodeTiles[index];
+
+				if (tile->selected)
+					continue;
+
+				tile->selected = TRUE;
+				progressive->encodeTileIndices[progressive->numEncodeTiles++] = index;
+			}
+		}
+	}
+
+	if (progressive->numEncodeTiles == 0)
+		return 0;
+
+	for (UINT32 i = 0; i < progressive->numEncodeTiles; i++)
+	{
+		const UINT32 index = progressive->encodeTileIndices[i];
+		const UINT32 xIdx = index % progressive->encodeGridWidth;
+		const UINT32 yIdx = index / progressive->encodeGridWidth;
+		RFX_PROGRESSIVE_ENCODE_TILE* tile = &progressive->encodeTiles[index];
+
+		tile->selected = FALSE;
+		tile->quality = 0;
+		tile->pending = TRUE;
+
+		if (!progressive_encode_tile_coefficients(progressive, tile, pSrcData, SrcFormat, ScanLine,
+		                                          xIdx * 64, yIdx * 64, MIN(64, Width - xIdx * 64),
+		                                          MIN(64, Height - yIdx * 64)))
+		{
+			tile->pending = FALSE;
+			goto fail;
+		}
+	}
+
+	wStream* s = progressive->buffer;
+	Stream_SetPosition(s, 0);
+
+	if (!progressive_write_message(progressive, s, rects, (UINT16)numRects, NULL))
+	{
+		WLog_ERR(TAG, "failed to write progressive first pass");
+		goto fail;
+	}
+
+	const size_t pos = Stream_GetPosition(s);
+	WINPR_ASSERT(pos <= UINT32_MAX);
+	*pDstSize = (UINT32)pos;
+	*ppDstData = Stream_Buffer(s);
+	res = 1;
+fail:
+	for (UINT32 i = 0; i < progressive->numEncodeTiles; i++)
+		progressive->encodeTiles[progressive->encodeTileIndices[i]].selected = FALSE;
+	return res;
+}
+
+static int progressive_compress_upgrade(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                        UINT32 Width, UINT32 Height,
+                                        BYTE** WINPR_RESTRICT ppDstData,
+                                        UINT32* WINPR_RESTRICT pDstSize)
+{
+	int res = -6;
+
+	if (!progressive->encodeTiles || (progressive->encodeWidth != Width) ||
+	    (progressive->encodeHeight != Height))
+		return 0;
+
+	const UINT32 numTiles = progressive_context_get_pending_upgrades(progressive);
+	if (numTiles == 0)
+		return 0;
+
+	if (!Stream_EnsureCapacity(progressive->rects, numTiles * (sizeof(RFX_RECT) + sizeof(BYTE))))
+		return -5;
+
+	RFX_RECT* rects = Stream_BufferAs(progressive->rects, RFX_RECT);
+	BYTE* prevQuality = (BYTE*)&rects[numTiles];
+
+	progressive->numEncodeTiles = 0;
+
+	for (UINT32 index = 0; index < progressive->encodeGridSize; index++)
+	{
+		RFX_PROGRESSIVE_ENCODE_TILE* tile = &progressive->encodeTiles[index];
+
+		if (!tile->pending)
+			continue;
+
+		const UINT32 n = progressive->numEncodeTiles++;
+		RFX_RECT* r = &rects[n];
+		r->x = (UINT16)((index % progressive->encodeGridWidth) * 64);
+		r->y = (UINT16)((index / progressive->encodeGridWidth) * 64);
+		r->width = (UINT16)MIN(64, Width - r->x);
+		r->height = (UINT16)MIN(64, Height - r->y);
+
+		prevQuality[n] = tile->quality;
+		tile->quality = progressive_rfx_quality_next(progressive, tile->quality);
+		tile->pending = (tile->quality != 0xFF);
+	}
+
+	wStream* s = progressive->buffer;
+	Stream_SetPosition(s, 0);
+
+	if (!progressive_write_message(progressive, s, rects, (UINT16)numTiles, prevQuality))
+	{
+		WLog_ERR(TAG, "failed to write progressive upgrade pass");
+		goto fail;
+	}
+
+	const size_t pos = Stream_GetPosition(s);
+	WINPR_ASSERT(pos <= UINT32_MAX);
+	*pDstSize = (UINT32)pos;
+	*ppDstData = Stream_Buffer(s);
+	res = 1;
+fail:
+	return res;
+}
+
 BOOL progressive_rfx_write_message_progressive_simple(PROGRESSIVE_CONTEXT* progressive, wStream* s,
                                                       const RFX_MESSAGE* msg)
 {
@@ -2468,6 +3315,116 @@ BOOL progressive_rfx_write_message_progressive_simple(PROGRESSIVE_CONTEXT* progr
 	return rfx_write_message_progressive_simple(context, s, msg);
 }
 
+static INLINE UINT64 progressive_tile_hash(const BYTE* WINPR_RESTRICT pSrcData, UINT32 nSrcStep,
+                                           size_t nRowLen, UINT32 nHeight)
+{
+	UINT64 hash = 0xCBF29CE484222325ULL;
+
+	for (UINT32 y = 0; y < nHeight; y++)
+	{
+		const BYTE* row = &pSrcData[1ULL * y * nSrcStep];
+		size_t x = 0;
+
+		for (; x + 8 <= nRowLen; x += 8)
+		{
+			UINT64 v = 0;
+			memcpy(&v, &row[x], sizeof(v));
+			hash = (hash ^ v) * 0x9E3779B97F4A7C15ULL;
+			hash ^= hash >> 32;
+		}
+
+		for (; x < nRowLen; x++)
+			hash = (hash ^ row[x]) * 0x100000001B3ULL;
+	}
+
+	/* 0 marks a tile that must be sent */
+	return hash ? hash : 1;
+}
+
+static void progressive_tile_hashes_free(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
+{
+	winpr_aligned_free(progressive->tileHashes);
+	progressive->tileHashes = NULL;
+	progressive->tileHashWidth = 0;
+	progressive->tileHashHeight = 0;
+	progressive->tileHashFormat = 0;
+}
+
+/**
+ * Tiles sent for an explicit invalid region may only be partially updated on
+ * the client, so drop their signatures and send them again on the next full
+ * surface call.
+ */
+static void progressive_tile_hashes_invalidate(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                               UINT32 Width, UINT32 Height,
+                                               const RFX_RECT* WINPR_RESTRICT rects,
+                                               UINT32 numRects)
+{
+	if (!progressive->tileHashes || (progressive->tileHashWidth != Width) ||
+	    (progressive->tileHashHeight != Height))
+		return;
+
+	const UINT32 gridWidth = (Width + 63) / 64;
+
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		const RFX_RECT* r = &rects[i];
+		const UINT32 right = MIN(Width, 1u * r->x + r->width);
+		const UINT32 bottom = MIN(Height, 1u * r->y + r->height);
+
+		for (UINT32 yIdx = r->y / 64; yIdx * 64 < bottom; yIdx++)
+		{
+			for (UINT32 xIdx = r->x / 64; xIdx * 64 < right; xIdx++)
+				progressive->tileHashes[yIdx * gridWidth + xIdx] = 0;
+		}
+	}
+}
+
+/**
+ * Drop the tiles of a full surface update whose content did not change since
+ * they were last sent, the remaining rects are compacted in place.
+ *
+ * @return the number of rects left
+ */
+static UINT32 progressive_tile_hashes_filter(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
+                                             const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcFormat,
+                                             UINT32 Width, UINT32 Height, UINT32 ScanLine,
+                                             RFX_RECT* WINPR_RESTRICT rects, UINT32 numRects)
+{
+	const size_t bpp = FreeRDPGetBytesPerPixel(SrcFormat);
+
+	if (!progressive->tileHashes || (progressive->tileHashWidth != Width) ||
+	    (progressive->tileHashHeight != Height) || (progressive->tileHashFormat != SrcFormat))
+	{
+		progressive_tile_hashes_free(progressive);
+		progressive->tileHashes = winpr_aligned_calloc(numRects, sizeof(UINT64), 32);
+		if (!progressive->tileHashes)
+			return numRects;
+
+		progressive->tileHashWidth = Width;
+		progressive->tileHashHeight = Height;
+		progressive->tileHashFormat = SrcFormat;
+	}
+
+	UINT32 count = 0;
+
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		const RFX_RECT* r = &rects[i];
+		const BYTE* pTile = &pSrcData[1ULL * r->y * ScanLine + 1ULL * r->x * bpp];
+		const UINT64 hash = progressive_tile_hash(pTile, ScanLine, bpp * r->width, r->height);
+
+		/* the full surface rects are generated in tile order */
+		if (progressive->tileHashes[i] == hash)
+			continue;
+
+		progressive->tileHashes[i] = hash;
+		rects[count++] = *r;
+	}
+
+	return count;
+}
+
 int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
                          const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize, UINT32 SrcFormat,
                          UINT32 Width, UINT32 Height, UINT32 ScanLine,
@@ -2518,9 +3475,6 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 	else
 		numRects = region16_n_rects(invalidRegion);
 
-	if (numRects == 0)
-		return 0;
-
 	if (!Stream_EnsureCapacity(progressive->rects, numRects * sizeof(RFX_RECT)))
 		return -5;
 	rects = Stream_BufferAs(progressive->rects, RFX_RECT);
@@ -2537,6 +3491,8 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 			rect->width = r->right - r->left;
 			rect->height = r->bottom - r->top;
 		}
+
+		progressive_tile_hashes_invalidate(progressive, Width, Height, rects, numRects);
 	}
 	else
 	{
@@ -2563,7 +3519,22 @@ int progressive_compress(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive,
 			WINPR_ASSERT(r->width <= 64);
 			WINPR_ASSERT(r->height <= 64);
 		}
+
+		numRects = progressive_tile_hashes_filter(progressive, pSrcData, SrcFormat, Width, Height,
+		                                          ScanLine, rects, numRects);
 	}
+
+	if (numRects == 0)
+	{
+		if (progressive->numPasses > 1)
+			return progressive_compress_upgrade(progressive, Width, Height, ppDstData, pDstSize);
+		return 0;
+	}
+
+	if (progressive->numPasses > 1)
+		return progressive_compress_first(progressive, pSrcData, SrcFormat, Width, Height, ScanLine,
+		                                  rects, numRects, ppDstData, pDstSize);
+
 	s = progressive->buffer;
 	Stream_SetPosition(s, 0);
 
@@ -2598,6 +3569,20 @@ BOOL progressive_context_reset(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive)
 	if (!progressive)
 		return FALSE;
 
+	progressive_encode_tiles_free(progressive);
+	progressive_tile_hashes_free(progressive);
+	return TRUE;
+}
+
+BOOL progressive_context_set_passes(PROGRESSIVE_CONTEXT* WINPR_RESTRICT progressive, UINT32 passes)
+{
+	if (!progressive || (passes < 1) || (passes > PROGRESSIVE_ENCODE_MAX_PASSES))
+		return FALSE;
+
+	if (progressive->numPasses != passes)
+		progressive_encode_tiles_free(progressive);
+
+	progressive->numPasses = passes;
 	return TRUE;
 }
 
@@ -2615,6 +3600,7 @@ PROGRESSIVE_CONTEXT* progressive_context_new_ex(BOOL Compressor, UINT32 Threadin
 		return NULL;
 
 	progressive->Compressor = Compressor;
+	progressive->numPasses = 1;
 	progressive->quantProgValFull.quality = 100;
 	progressive->log = WLog_Get(TAG);
 	if (!progressive->log)
@@ -2658,6 +3644,9 @@ void progressive_context_free(PROGRESSIVE_CONTEXT* progressive)
 	Stream_Free(progressive->rects, TRUE);
 	rfx_context_free(progressive->rfx_context);
 
+	progressive_encode_tiles_free(progressive);
+	progressive_tile_hashes_free(progressive);
+	winpr_aligned_free(progressive->encodeBuffer);
 	BufferPool_Free(progressive->bufferPool);
 	HashTable_Free(progressive->SurfaceContexts);
 
@@ -140,6 +140,14 @@ typedef struct
 	RFX_COMPONENT_CODEC_QUANT crProgQuant;
 } RFX_PROGRESSIVE_TILE;
 
+typedef struct
+{
+	BOOL pending;
+	BOOL selected;
+	BYTE quality;
+	INT16* coefficients;
+} RFX_PROGRESSIVE_ENCODE_TILE;
+
 typedef struct S_PROGRESSIVE_CONTEXT PROGRESSIVE_CONTEXT;
 typedef struct S_PROGRESSIVE_BLOCK_REGION PROGRESSIVE_BLOCK_REGION;
 
@@ -199,6 +207,9 @@ typedef struct
 	UINT32 frameId;
 	UINT32 numUpdatedTiles;
 	UINT32* updatedTileIndices;
+	/* one large block per tile cache allocation, holding the buffers of its tiles */
+	BYTE** tileBuffers;
+	size_t tileBuffersCount;
 } PROGRESSIVE_SURFACE_CONTEXT;
 
 typedef enum
@@ -228,8 +239,23 @@ struct S_PROGRESSIVE_CONTEXT
 	wStream* buffer;
 	wStream* rects;
 	RFX_CONTEXT* rfx_context;
+
+	UINT32 numPasses;
+	UINT32 encodeWidth;
+	UINT32 encodeHeight;
+	UINT32 encodeGridWidth;
+	UINT32 encodeGridSize;
+	UINT32 numEncodeTiles;
+	UINT32* encodeTileIndices;
+	RFX_PROGRESSIVE_ENCODE_TILE* encodeTiles;
+	BYTE* encodeBuffer;
+
+	UINT32 tileHashWidth;
+	UINT32 tileHashHeight;
+	UINT32 tileHashFormat;
+	UINT64* tileHashes;
+
 	PROGRESSIVE_TILE_PROCESS_WORK_PARAM params[0x10000];
-	PTP_WORK work_objects[0x10000];
 };
 
 #endif /* INTERNAL_CODEC_PROGRESSIVE_H */
@@ -684,6 +684,191 @@ BOOL region16_union_rect(REGION16* dst, const REGION16* src, const RECTANGLE_16*
 	return region16_simplify_bands(dst);
 }
 
+static int region16_compare_top(const void* a, const void* b)
+{
+	const RECTANGLE_16* r1 = a;
+	const RECTANGLE_16* r2 = b;
+	return (int)r1->top - (int)r2->top;
+}
+
+static int region16_compare_left(const void* a, const void* b)
+{
+	const RECTANGLE_16* const* r1 = a;
+	const RECTANGLE_16* const* r2 = b;
+	return (int)(*r1)->left - (int)(*r2)->left;
+}
+
+static int region16_compare_y(const void* a, const void* b)
+{
+	const UINT16* y1 = a;
+	const UINT16* y2 = b;
+	return (int)*y1 - (int)*y2;
+}
+
+static BOOL region16_append_rect(REGION16_DATA** data, long* capacity, const RECTANGLE_16* rect)
+{
+	REGION16_DATA* items = *data;
+
+	if (items->nbRects == *capacity)
+	{
+		const long newCapacity = *capacity * 2;
+		items = realloc(items, sizeof(REGION16_DATA) + (newCapacity * sizeof(RECTANGLE_16)));
+
+		if (!items)
+			return FALSE;
+
+		*data = items;
+		*capacity = newCapacity;
+	}
+
+	RECTANGLE_16* rects = (RECTANGLE_16*)(&items[1]);
+	rects[items->nbRects++] = *rect;
+	return TRUE;
+}
+
+BOOL region16_union_rects(REGION16* dst, const REGION16* src, const RECTANGLE_16* rects,
+                          UINT32 count)
+{
+	BOOL rc = FALSE;
+	UINT32 srcNbRects = 0;
+	RECTANGLE_16* input = NULL;
+	const RECTANGLE_16** active = NULL;
+	UINT16* ys = NULL;
+	REGION16_DATA* newItems = NULL;
+	long capacity = 0;
+	size_t nbInput = 0;
+	size_t nbYs = 0;
+	size_t nbActive = 0;
+
+	WINPR_ASSERT(dst);
+	WINPR_ASSERT(src);
+	WINPR_ASSERT(rects || (count == 0));
+
+	const RECTANGLE_16* srcRects = region16_rects(src, &srcNbRects);
+	const size_t total = 1ULL * srcNbRects + count;
+
+	if (total == 0)
+		return region16_copy(dst, src);
+
+	/* Sweep over all distinct band boundaries: every rectangle active in a band
+	 * contributes its x interval, overlapping or touching intervals are joined */
+	input = calloc(total, sizeof(RECTANGLE_16));
+	active = calloc(total, sizeof(RECTANGLE_16*));
+	ys = calloc(2 * total, sizeof(UINT16));
+
+	if (!input || !active || !ys)
+		goto fail;
+
+	for (size_t x = 0; x < total; x++)
+	{
+		const RECTANGLE_16* rect = (x < srcNbRects) ? &srcRects[x] : &rects[x - srcNbRects];
+
+		if (rectangle_is_empty(rect))
+			continue;
+
+		input[nbInput++] = *rect;
+		ys[nbYs++] = rect->top;
+		ys[nbYs++] = rect->bottom;
+	}
+
+	if (nbInput == 0)
+	{
+		rc = region16_copy(dst, src);
+		goto fail;
+	}
+
+	qsort(input, nbInput, sizeof(RECTANGLE_16), region16_compare_top);
+	qsort(ys, nbYs, sizeof(UINT16), region16_compare_y);
+
+	capacity = (long)nbInput;
+	newItems = allocateRegion(capacity);
+
+	if (!newItems)
+		goto fail;
+
+	newItems->nbRects = 0;
+
+	size_t next = 0;
+
+	for (size_t y = 0; y + 1 < nbYs; y++)
+	{
+		const UINT16 top = ys[y];
+		const UINT16 bottom = ys[y + 1];
+
+		if (top == bottom)
+			continue;
+
+		/* drop rectangles that ended, pick up the ones starting in this band */
+		size_t kept = 0;
+
+		for (size_t x = 0; x < nbActive; x++)
+		{
+			if (active[x]->bottom > top)
+				active[kept++] = active[x];
+		}
+
+		nbActive = kept;
+
+		while ((next < nbInput) && (input[next].top <= top))
+			active[nbActive++] = &input[next++];
+
+		if (nbActive == 0)
+			continue;
+
+		qsort(active, nbActive, sizeof(RECTANGLE_16*), region16_compare_left);
+
+		RECTANGLE_16 current = { active[0]->left, top, active[0]->right, bottom };
+
+		for (size_t x = 1; x < nbActive; x++)
+		{
+			if (active[x]->left <= current.right)
+			{
+				current.right = MAX(current.right, active[x]->right);
+				continue;
+			}
+
+			if (!region16_append_rect(&newItems, &capacity, &current))
+				goto fail;
+
+			current.left = active[x]->left;
+			current.right = active[x]->right;
+		}
+
+		if (!region16_append_rect(&newItems, &capacity, &current))
+			goto fail;
+	}
+
+	newItems->size = sizeof(REGION16_DATA) + (newItems->nbRects * sizeof(RECTANGLE_16));
+
+	{
+		const RECTANGLE_16* newRects = (const RECTANGLE_16*)(&newItems[1]);
+		RECTANGLE_16 extents = { newRects[0].left, newRects[0].top, newRects[0].right,
+			                     newRects[newItems->nbRects - 1].bottom };
+
+		for (long x = 1; x < newItems->nbRects; x++)
+		{
+			extents.left = MIN(extents.left, newRects[x].left);
+			extents.right = MAX(extents.right, newRects[x].right);
+		}
+
+		if ((dst->data->size > 0) && (dst->data != &empty_region))
+			free(dst->data);
+
+		dst->data = newItems;
+		dst->extents = extents;
+		newItems = NULL;
+	}
+
+	rc = region16_simplify_bands(dst);
+
+fail:
+	free(newItems);
+	free(ys);
+	free(active);
+	free(input);
+	return rc;
+}
+
 BOOL region16_intersects_rect(const REGION16* src, const RECTANGLE_16* arg2)
 {
 	const RECTANGLE_16* rect = NULL;
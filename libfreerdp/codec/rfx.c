@@ -48,8 +48,11 @@
 #include "rfx_rlgr.h"
 
 #include "sse/rfx_sse2.h"
+#include "sse/rfx_avx2.h"
 #include "neon/rfx_neon.h"
 
+#include "../core/probes.h"
+
 #define TAG FREERDP_TAG("codec")
 
 #define RFX_KEY "Software\\" FREERDP_VENDOR_STRING "\\" FREERDP_PRODUCT_STRING "\\RemoteFX"
@@ -68,6 +71,16 @@
  */
 static const UINT32 rfx_default_quantization_values[] = { 6, 6, 6, 6, 7, 7, 8, 8, 8, 9 };
 
+/**
+ * The tables of the adaptive quantization, in RFX_QUANT_* order: the default, a fine one
+ * keeping the high bands of text and edges and a coarse one for photographic and flat tiles.
+ */
+static const UINT32 rfx_adaptive_quantization_values[] = {
+	6, 6, 6, 6, 7, 7, 8, 8, 8, 9,  /* RFX_QUANT_DEFAULT */
+	6, 6, 6, 6, 6, 6, 7, 7, 7, 8,  /* RFX_QUANT_FINE */
+	6, 6, 6, 6, 7, 7, 8, 9, 9, 10, /* RFX_QUANT_COARSE */
+};
+
 static INLINE BOOL rfx_write_progressive_tile_simple(RFX_CONTEXT* WINPR_RESTRICT rfx,
                                                      wStream* WINPR_RESTRICT s,
                                                      const RFX_TILE* WINPR_RESTRICT tile);
@@ -332,6 +345,7 @@ RFX_CONTEXT* rfx_context_new_ex(BOOL encoder, UINT32 ThreadingFlags)
 	context->rlgr_decode = rfx_rlgr_decode;
 	context->rlgr_encode = rfx_rlgr_encode;
 	rfx_init_sse2(context);
+	rfx_init_avx2(context);
 	rfx_init_neon(context);
 	context->state = RFX_STATE_SEND_HEADERS;
 	context->expectedDataBlockType = WBT_FRAME_BEGIN;
@@ -372,7 +386,6 @@ void rfx_context_free(RFX_CONTEXT* context)
 			if (priv->ThreadPool)
 				CloseThreadpool(priv->ThreadPool);
 			DestroyThreadpoolEnvironment(&priv->ThreadPoolEnv);
-			winpr_aligned_free(priv->workObjects);
 			winpr_aligned_free(priv->tileWorkParams);
 #ifdef WITH_PROFILER
 			WLog_VRB(
@@ -794,18 +807,85 @@ static INLINE BOOL rfx_process_message_region(RFX_CONTEXT* WINPR_RESTRICT contex
 	return TRUE;
 }
 
+/* Surface of rfx_process_message, tiles are converted straight into it when set */
+typedef struct
+{
+	BYTE* data;
+	UINT32 stride;
+	UINT32 left;
+	UINT32 top;
+	UINT32 width;
+	UINT32 height;
+} RFX_TILE_TARGET;
+
 typedef struct
 {
 	RFX_TILE* tile;
 	RFX_CONTEXT* context;
+	const RFX_TILE_TARGET* target;
+	REGION16 region;
 } RFX_TILE_PROCESS_WORK_PARAM;
 
-static INLINE void CALLBACK rfx_process_message_tile_work_callback(PTP_CALLBACK_INSTANCE instance,
-                                                                   void* context, PTP_WORK work)
+/* Union of the message rects in surface coordinates, clipped to the surface */
+static void rfx_message_clipping_region(const RFX_MESSAGE* WINPR_RESTRICT message, UINT32 left,
+                                        UINT32 top, UINT32 dstWidth, UINT32 dstHeight,
+                                        REGION16* WINPR_RESTRICT clippingRects)
+{
+	WINPR_ASSERT(dstWidth <= UINT16_MAX);
+	WINPR_ASSERT(dstHeight <= UINT16_MAX);
+	for (UINT32 i = 0; i < message->numRects; i++)
+	{
+		RECTANGLE_16 clippingRect = { 0 };
+		const RFX_RECT* rect = &(message->rects[i]);
+
+		WINPR_ASSERT(left + rect->x <= UINT16_MAX);
+		WINPR_ASSERT(top + rect->y <= UINT16_MAX);
+		WINPR_ASSERT(clippingRect.left + rect->width <= UINT16_MAX);
+		WINPR_ASSERT(clippingRect.top + rect->height <= UINT16_MAX);
+
+		clippingRect.left = (UINT16)MIN(left + rect->x, dstWidth);
+		clippingRect.top = (UINT16)MIN(top + rect->y, dstHeight);
+		clippingRect.right = (UINT16)MIN(clippingRect.left + rect->width, dstWidth);
+		clippingRect.bottom = (UINT16)MIN(clippingRect.top + rect->height, dstHeight);
+		region16_union_rect(clippingRects, clippingRects, &clippingRect);
+	}
+}
+
+static RECTANGLE_16 rfx_tile_rect(const RFX_TILE* WINPR_RESTRICT tile, UINT32 left, UINT32 top)
+{
+	RECTANGLE_16 updateRect = { 0 };
+
+	WINPR_ASSERT(left + tile->x <= UINT16_MAX);
+	WINPR_ASSERT(top + tile->y <= UINT16_MAX);
+
+	updateRect.left = (UINT16)left + tile->x;
+	updateRect.top = (UINT16)top + tile->y;
+	updateRect.right = updateRect.left + 64;
+	updateRect.bottom = updateRect.top + 64;
+	return updateRect;
+}
+
+static BOOL rfx_process_message_tile(RFX_CONTEXT* WINPR_RESTRICT context,
+                                     const RFX_TILE* WINPR_RESTRICT tile,
+                                     const RFX_TILE_TARGET* WINPR_RESTRICT target,
+                                     const REGION16* WINPR_RESTRICT region)
 {
-	RFX_TILE_PROCESS_WORK_PARAM* param = (RFX_TILE_PROCESS_WORK_PARAM*)context;
-	WINPR_ASSERT(param);
-	rfx_decode_rgb(param->context, param->tile, param->tile->data, 64 * 4);
+	if (!target)
+		return rfx_decode_rgb(context, tile, tile->data, 64 * 4);
+
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(region, &numRects);
+	return rfx_decode_rgb_rects(context, tile, target->data, target->stride,
+	                            target->left + tile->x, target->top + tile->y, rects, numRects);
+}
+
+static void rfx_process_message_tile_batch_callback(PVOID context, size_t index)
+{
+	RFX_TILE_PROCESS_WORK_PARAM* params = (RFX_TILE_PROCESS_WORK_PARAM*)context;
+	WINPR_ASSERT(params);
+
+	RFX_TILE_PROCESS_WORK_PARAM* param = &params[index];
+	(void)rfx_process_message_tile(param->context, param->tile, param->target, &param->region);
 }
 
 static INLINE BOOL rfx_allocate_tiles(RFX_MESSAGE* WINPR_RESTRICT message, size_t count,
@@ -832,10 +912,11 @@ static INLINE BOOL rfx_allocate_tiles(RFX_MESSAGE* WINPR_RESTRICT message, size_
 static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT context,
                                                RFX_MESSAGE* WINPR_RESTRICT message,
                                                wStream* WINPR_RESTRICT s,
-                                               UINT16* WINPR_RESTRICT pExpectedBlockType)
+                                               UINT16* WINPR_RESTRICT pExpectedBlockType,
+                                               const RFX_TILE_TARGET* WINPR_RESTRICT target)
 {
 	BOOL rc = 0;
-	size_t close_cnt = 0;
+	size_t ready = 0;
 	BYTE quant = 0;
 	RFX_TILE* tile = NULL;
 	UINT32* quants = NULL;
@@ -844,8 +925,9 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 	UINT32 blockLen = 0;
 	UINT32 blockType = 0;
 	UINT32 tilesDataSize = 0;
-	PTP_WORK* work_objects = NULL;
 	RFX_TILE_PROCESS_WORK_PARAM* params = NULL;
+	REGION16 clippingRects = { 0 };
+	REGION16 tileRegion = { 0 };
 	void* pmem = NULL;
 
 	WINPR_ASSERT(context);
@@ -940,25 +1022,23 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 
 	if (context->priv->UseThreads)
 	{
-		work_objects = (PTP_WORK*)winpr_aligned_calloc(message->numTiles, sizeof(PTP_WORK), 32);
 		params = (RFX_TILE_PROCESS_WORK_PARAM*)winpr_aligned_recalloc(
 		    NULL, message->numTiles, sizeof(RFX_TILE_PROCESS_WORK_PARAM), 32);
 
-		if (!work_objects)
-		{
-			winpr_aligned_free(params);
-			return FALSE;
-		}
-
 		if (!params)
-		{
-			winpr_aligned_free(work_objects);
 			return FALSE;
-		}
+	}
+
+	if (target)
+	{
+		region16_init(&clippingRects);
+		region16_init(&tileRegion);
+		rfx_message_clipping_region(message, target->left, target->top, target->width,
+		                            target->height, &clippingRects);
 	}
 
 	/* tiles */
-	close_cnt = 0;
+	ready = 0;
 	rc = FALSE;
 
 	if (Stream_GetRemainingLength(s) >= tilesDataSize)
@@ -1083,37 +1163,43 @@ static INLINE BOOL rfx_process_message_tileset(RFX_CONTEXT* WINPR_RESTRICT conte
 
 				params[i].context = context;
 				params[i].tile = message->tiles[i];
+				params[i].target = target;
+				region16_init(&params[i].region);
+				ready = i + 1;
+			}
 
-				if (!(work_objects[i] =
-				          CreateThreadpoolWork(rfx_process_message_tile_work_callback,
-				                               (void*)&params[i], &context->priv->ThreadPoolEnv)))
+			REGION16* region = params ? &params[i].region : &tileRegion;
+			if (target)
+			{
+				const RECTANGLE_16 tileRect = rfx_tile_rect(tile, target->left, target->top);
+				if (!region16_intersect_rect(region, &clippingRects, &tileRect))
 				{
-					WLog_Print(context->priv->log, WLOG_ERROR, "CreateThreadpoolWork failed.");
 					rc = FALSE;
 					break;
 				}
-
-				SubmitThreadpoolWork(work_objects[i]);
-				close_cnt = i + 1;
-			}
-			else
-			{
-				rfx_decode_rgb(context, tile, tile->data, 64 * 4);
 			}
+
+			if (!context->priv->UseThreads)
+				(void)rfx_process_message_tile(context, tile, target, region);
 		}
 	}
 
-	if (context->priv->UseThreads)
+	/* decode all parsed tiles in one batch */
+	if (rc && (ready > 0))
 	{
-		for (size_t i = 0; i < close_cnt; i++)
+		if (!winpr_SubmitThreadpoolWorkBatch(rfx_process_message_tile_batch_callback, params, ready,
+		                                     &context->priv->ThreadPoolEnv))
 		{
-			WaitForThreadpoolWorkCallbacks(work_objects[i], FALSE);
-			CloseThreadpoolWork(work_objects[i]);
+			WLog_Print(context->priv->log, WLOG_ERROR, "winpr_SubmitThreadpoolWorkBatch failed.");
+			rc = FALSE;
 		}
 	}
 
-	winpr_aligned_free(work_objects);
+	for (size_t i = 0; params && (i < message->numTiles); i++)
+		region16_uninit(&params[i].region);
 	winpr_aligned_free(params);
+	region16_uninit(&tileRegion);
+	region16_uninit(&clippingRects);
 
 	for (size_t i = 0; i < message->numTiles; i++)
 	{
@@ -1139,6 +1225,14 @@ BOOL rfx_process_message(RFX_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_
 	if (!context || !data || !length)
 		return FALSE;
 
+	const UINT32 dstBpp = FreeRDPGetBytesPerPixel(dstFormat);
+	if (dstBpp == 0)
+		return FALSE;
+
+	/* with matching formats the tiles are converted straight into dst, saving the tile copy */
+	const RFX_TILE_TARGET target = { dst, dstStride, left, top, dstStride / dstBpp, dstHeight };
+	const BOOL direct = dst && FreeRDPAreColorFormatsEqualNoAlpha(dstFormat, context->pixel_format);
+
 	WINPR_ASSERT(context->priv);
 	RFX_MESSAGE* message = &context->currentMessage;
 
@@ -1270,7 +1364,8 @@ BOOL rfx_process_message(RFX_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_
 
 			case WBT_EXTENSION:
 				ok = rfx_process_message_tileset(context, message, subStream,
-				                                 &context->expectedDataBlockType);
+				                                 &context->expectedDataBlockType,
+				                                 direct ? &target : NULL);
 				break;
 
 			case WBT_FRAME_END:
@@ -1291,40 +1386,14 @@ BOOL rfx_process_message(RFX_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_
 		REGION16 clippingRects = { 0 };
 		const RECTANGLE_16* updateRects = NULL;
 		const DWORD formatSize = FreeRDPGetBytesPerPixel(context->pixel_format);
-		const UINT32 dstWidth = dstStride / FreeRDPGetBytesPerPixel(dstFormat);
 		region16_init(&clippingRects);
-
-		WINPR_ASSERT(dstWidth <= UINT16_MAX);
-		WINPR_ASSERT(dstHeight <= UINT16_MAX);
-		for (UINT32 i = 0; i < message->numRects; i++)
-		{
-			RECTANGLE_16 clippingRect = { 0 };
-			const RFX_RECT* rect = &(message->rects[i]);
-
-			WINPR_ASSERT(left + rect->x <= UINT16_MAX);
-			WINPR_ASSERT(top + rect->y <= UINT16_MAX);
-			WINPR_ASSERT(clippingRect.left + rect->width <= UINT16_MAX);
-			WINPR_ASSERT(clippingRect.top + rect->height <= UINT16_MAX);
-
-			clippingRect.left = (UINT16)MIN(left + rect->x, dstWidth);
-			clippingRect.top = (UINT16)MIN(top + rect->y, dstHeight);
-			clippingRect.right = (UINT16)MIN(clippingRect.left + rect->width, dstWidth);
-			clippingRect.bottom = (UINT16)MIN(clippingRect.top + rect->height, dstHeight);
-			region16_union_rect(&clippingRects, &clippingRects, &clippingRect);
-		}
+		rfx_message_clipping_region(message, left, top, target.width, dstHeight, &clippingRects);
 
 		for (UINT32 i = 0; i < message->numTiles; i++)
 		{
-			RECTANGLE_16 updateRect = { 0 };
 			const RFX_TILE* tile = rfx_message_get_tile(message, i);
+			const RECTANGLE_16 updateRect = rfx_tile_rect(tile, left, top);
 
-			WINPR_ASSERT(left + tile->x <= UINT16_MAX);
-			WINPR_ASSERT(top + tile->y <= UINT16_MAX);
-
-			updateRect.left = (UINT16)left + tile->x;
-			updateRect.top = (UINT16)top + tile->y;
-			updateRect.right = updateRect.left + 64;
-			updateRect.bottom = updateRect.top + 64;
 			region16_init(&updateRegion);
 			region16_intersect_rect(&updateRegion, &clippingRects, &updateRect);
 			updateRects = region16_rects(&updateRegion, &nbUpdateRects);
@@ -1339,7 +1408,8 @@ BOOL rfx_process_message(RFX_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_
 				const UINT32 nWidth = updateRects[j].right - updateRects[j].left;
 				const UINT32 nHeight = updateRects[j].bottom - updateRects[j].top;
 
-				if (!freerdp_image_copy_no_overlap(dst, dstFormat, dstStride, nXDst, nYDst, nWidth,
+				if (!direct &&
+				    !freerdp_image_copy_no_overlap(dst, dstFormat, dstStride, nXDst, nYDst, nWidth,
 				                                   nHeight, tile->data, context->pixel_format,
 				                                   stride, nXSrc, nYSrc, NULL, FREERDP_FLIP_NONE))
 				{
@@ -1573,11 +1643,12 @@ struct S_RFX_TILE_COMPOSE_WORK_PARAM
 	RFX_CONTEXT* context;
 };
 
-static INLINE void CALLBACK rfx_compose_message_tile_work_callback(PTP_CALLBACK_INSTANCE instance,
-                                                                   void* context, PTP_WORK work)
+static void rfx_compose_message_tile_batch_callback(PVOID context, size_t index)
 {
-	RFX_TILE_COMPOSE_WORK_PARAM* param = (RFX_TILE_COMPOSE_WORK_PARAM*)context;
-	WINPR_ASSERT(param);
+	RFX_TILE_COMPOSE_WORK_PARAM* params = (RFX_TILE_COMPOSE_WORK_PARAM*)context;
+	WINPR_ASSERT(params);
+
+	RFX_TILE_COMPOSE_WORK_PARAM* param = &params[index];
 	rfx_encode_rgb(param->context, param->tile);
 }
 
@@ -1617,11 +1688,6 @@ static INLINE BOOL setupWorkers(RFX_CONTEXT* WINPR_RESTRICT context, size_t nbTi
 	if (!context->priv->UseThreads)
 		return TRUE;
 
-	if (!(pmem = winpr_aligned_recalloc(priv->workObjects, nbTiles, sizeof(PTP_WORK), 32)))
-		return FALSE;
-
-	priv->workObjects = (PTP_WORK*)pmem;
-
 	if (!(pmem = winpr_aligned_recalloc(priv->tileWorkParams, nbTiles,
 	                                    sizeof(RFX_TILE_COMPOSE_WORK_PARAM), 32)))
 		return FALSE;
@@ -1641,15 +1707,15 @@ static INLINE BOOL rfx_ensure_tiles(RFX_MESSAGE* WINPR_RESTRICT message, size_t
 	return rfx_allocate_tiles(message, alloc, TRUE);
 }
 
-RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
-                                const RFX_RECT* WINPR_RESTRICT rects, size_t numRects,
-                                const BYTE* WINPR_RESTRICT data, UINT32 w, UINT32 h, size_t s)
+static RFX_MESSAGE* rfx_encode_message_int(RFX_CONTEXT* WINPR_RESTRICT context,
+                                          const RFX_RECT* WINPR_RESTRICT rects, size_t numRects,
+                                          const BYTE* WINPR_RESTRICT data, UINT32 w, UINT32 h,
+                                          size_t s)
 {
 	const UINT32 width = w;
 	const UINT32 height = h;
 	const UINT32 scanline = (UINT32)s;
 	RFX_MESSAGE* message = NULL;
-	PTP_WORK* workObject = NULL;
 	RFX_TILE_COMPOSE_WORK_PARAM* workParam = NULL;
 	BOOL success = FALSE;
 	REGION16 rectsRegion = { 0 };
@@ -1677,14 +1743,21 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 
 	if (!context->numQuant)
 	{
+		const UINT32* quants = rfx_default_quantization_values;
+		size_t quantsSize = sizeof(rfx_default_quantization_values);
+
+		if (context->priv->AdaptiveQuant)
+		{
+			quants = rfx_adaptive_quantization_values;
+			quantsSize = sizeof(rfx_adaptive_quantization_values);
+		}
+
 		WINPR_ASSERT(context->quants == NULL);
-		if (!(context->quants =
-		          (UINT32*)winpr_aligned_malloc(sizeof(rfx_default_quantization_values), 32)))
+		if (!(context->quants = (UINT32*)winpr_aligned_malloc(quantsSize, 32)))
 			goto skip_encoding_loop;
 
-		CopyMemory(context->quants, &rfx_default_quantization_values,
-		           sizeof(rfx_default_quantization_values));
-		context->numQuant = 1;
+		CopyMemory(context->quants, quants, quantsSize);
+		context->numQuant = (BYTE)(quantsSize / (10 * sizeof(UINT32)));
 		context->quantIdxY = 0;
 		context->quantIdxCb = 0;
 		context->quantIdxCr = 0;
@@ -1711,10 +1784,7 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 		goto skip_encoding_loop;
 
 	if (context->priv->UseThreads)
-	{
-		workObject = context->priv->workObjects;
 		workParam = context->priv->tileWorkParams;
-	}
 
 	UINT32 regionNbRects = 0;
 	regionRect = region16_rects(&rectsRegion, &regionNbRects);
@@ -1810,16 +1880,6 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 				{
 					workParam->context = context;
 					workParam->tile = tile;
-
-					if (!(*workObject = CreateThreadpoolWork(rfx_compose_message_tile_work_callback,
-					                                         (void*)workParam,
-					                                         &context->priv->ThreadPoolEnv)))
-					{
-						goto skip_encoding_loop;
-					}
-
-					SubmitThreadpoolWork(*workObject);
-					workObject++;
 					workParam++;
 				}
 				else
@@ -1833,28 +1893,24 @@ RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
 		}     /* yIdx */
 	}         /* rects */
 
+	/* when using threads encode all tiles in one batch */
+	if (context->priv->UseThreads)
+	{
+		if (!winpr_SubmitThreadpoolWorkBatch(rfx_compose_message_tile_batch_callback,
+		                                     context->priv->tileWorkParams, message->numTiles,
+		                                     &context->priv->ThreadPoolEnv))
+			goto skip_encoding_loop;
+	}
+
 	success = TRUE;
 skip_encoding_loop:
 
-	/* when using threads ensure all computations are done */
 	if (success)
 	{
 		message->tilesDataSize = 0;
-		workObject = context->priv->workObjects;
 
 		for (UINT32 i = 0; i < message->numTiles; i++)
 		{
-			if (context->priv->UseThreads)
-			{
-				if (*workObject)
-				{
-					WaitForThreadpoolWorkCallbacks(*workObject, FALSE);
-					CloseThreadpoolWork(*workObject);
-				}
-
-				workObject++;
-			}
-
 			const RFX_TILE* tile = message->tiles[i];
 			message->tilesDataSize += rfx_tile_length(tile);
 		}
@@ -1871,6 +1927,16 @@ skip_encoding_loop:
 	return NULL;
 }
 
+RFX_MESSAGE* rfx_encode_message(RFX_CONTEXT* WINPR_RESTRICT context,
+                                const RFX_RECT* WINPR_RESTRICT rects, size_t numRects,
+                                const BYTE* WINPR_RESTRICT data, UINT32 w, UINT32 h, size_t s)
+{
+	FREERDP_PROBE3(rfx_encode_entry, numRects, w, h);
+	RFX_MESSAGE* message = rfx_encode_message_int(context, rects, numRects, data, w, h, s);
+	FREERDP_PROBE2(rfx_encode_exit, numRects, message ? message->tilesDataSize : 0);
+	return message;
+}
+
 static INLINE BOOL rfx_clone_rects(RFX_MESSAGE* WINPR_RESTRICT dst,
                                    const RFX_MESSAGE* WINPR_RESTRICT src)
 {
@@ -2199,6 +2265,25 @@ BOOL rfx_context_set_mode(RFX_CONTEXT* WINPR_RESTRICT context, RLGR_MODE mode)
 	return TRUE;
 }
 
+BOOL rfx_context_set_adaptive_quantization(RFX_CONTEXT* WINPR_RESTRICT context, BOOL enable)
+{
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(context->priv);
+
+	if (!context->encoder)
+		return FALSE;
+
+	if (context->priv->AdaptiveQuant == enable)
+		return TRUE;
+
+	/* the tables are set up again with the next message */
+	context->priv->AdaptiveQuant = enable;
+	winpr_aligned_free(context->quants);
+	context->quants = NULL;
+	context->numQuant = 0;
+	return TRUE;
+}
+
 RLGR_MODE rfx_context_get_mode(RFX_CONTEXT* WINPR_RESTRICT context)
 {
 	WINPR_ASSERT(context);
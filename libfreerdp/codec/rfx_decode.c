@@ -62,6 +62,27 @@ static INLINE void rfx_decode_component(RFX_CONTEXT* WINPR_RESTRICT context,
 /* rfx_decode_ycbcr_to_rgb code now resides in the primitives library. */
 
 /* stride is bytes between rows in the output buffer. */
+/* Decodes the three components of the tile into the planes of a BufferPool buffer */
+static INLINE BYTE* rfx_decode_ycbcr(RFX_CONTEXT* WINPR_RESTRICT context,
+                                     const RFX_TILE* WINPR_RESTRICT tile, INT16* pSrcDst[3])
+{
+	const UINT32* y_quants = context->quants + (10ULL * tile->quantIdxY);
+	const UINT32* cb_quants = context->quants + (10ULL * tile->quantIdxCb);
+	const UINT32* cr_quants = context->quants + (10ULL * tile->quantIdxCr);
+	BYTE* pBuffer = (BYTE*)BufferPool_Take(context->priv->BufferPool, -1);
+
+	if (!pBuffer)
+		return NULL;
+
+	pSrcDst[0] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 0ULL) + 16ULL]));        /* y_r_buffer */
+	pSrcDst[1] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 1ULL) + 16ULL]));        /* cb_g_buffer */
+	pSrcDst[2] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 2ULL) + 16ULL]));        /* cr_b_buffer */
+	rfx_decode_component(context, y_quants, tile->YData, tile->YLen, pSrcDst[0]); /* YData */
+	rfx_decode_component(context, cb_quants, tile->CbData, tile->CbLen, pSrcDst[1]); /* CbData */
+	rfx_decode_component(context, cr_quants, tile->CrData, tile->CrLen, pSrcDst[2]); /* CrData */
+	return pBuffer;
+}
+
 BOOL rfx_decode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, const RFX_TILE* WINPR_RESTRICT tile,
                     BYTE* WINPR_RESTRICT rgb_buffer, UINT32 stride)
 {
@@ -71,33 +92,69 @@ BOOL rfx_decode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, const RFX_TILE* WINPR_R
 		INT16** pv;
 	} cnv;
 	BOOL rc = TRUE;
-	BYTE* pBuffer = NULL;
-	INT16* pSrcDst[3];
-	UINT32* y_quants = NULL;
-	UINT32* cb_quants = NULL;
-	UINT32* cr_quants = NULL;
+	INT16* pSrcDst[3] = { 0 };
 	static const prim_size_t roi_64x64 = { 64, 64 };
 	const primitives_t* prims = primitives_get();
 	PROFILER_ENTER(context->priv->prof_rfx_decode_rgb)
-	y_quants = context->quants + (10ULL * tile->quantIdxY);
-	cb_quants = context->quants + (10ULL * tile->quantIdxCb);
-	cr_quants = context->quants + (10ULL * tile->quantIdxCr);
-	pBuffer = (BYTE*)BufferPool_Take(context->priv->BufferPool, -1);
-	pSrcDst[0] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 0ULL) + 16ULL]));        /* y_r_buffer */
-	pSrcDst[1] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 1ULL) + 16ULL]));        /* cb_g_buffer */
-	pSrcDst[2] = (INT16*)((&pBuffer[((8192ULL + 32ULL) * 2ULL) + 16ULL]));        /* cr_b_buffer */
-	rfx_decode_component(context, y_quants, tile->YData, tile->YLen, pSrcDst[0]); /* YData */
-	rfx_decode_component(context, cb_quants, tile->CbData, tile->CbLen, pSrcDst[1]); /* CbData */
-	rfx_decode_component(context, cr_quants, tile->CrData, tile->CrLen, pSrcDst[2]); /* CrData */
-	PROFILER_ENTER(context->priv->prof_rfx_ycbcr_to_rgb)
+	BYTE* pBuffer = rfx_decode_ycbcr(context, tile, pSrcDst);
+	if (!pBuffer)
+		rc = FALSE;
+	else
+	{
+		PROFILER_ENTER(context->priv->prof_rfx_ycbcr_to_rgb)
+
+		cnv.pv = pSrcDst;
+		if (prims->yCbCrToRGB_16s8u_P3AC4R(cnv.cpv, 64 * sizeof(INT16), rgb_buffer, stride,
+		                                   context->pixel_format, &roi_64x64) != PRIMITIVES_SUCCESS)
+			rc = FALSE;
 
-	cnv.pv = pSrcDst;
-	if (prims->yCbCrToRGB_16s8u_P3AC4R(cnv.cpv, 64 * sizeof(INT16), rgb_buffer, stride,
-	                                   context->pixel_format, &roi_64x64) != PRIMITIVES_SUCCESS)
+		PROFILER_EXIT(context->priv->prof_rfx_ycbcr_to_rgb)
+		BufferPool_Return(context->priv->BufferPool, pBuffer);
+	}
+	PROFILER_EXIT(context->priv->prof_rfx_decode_rgb)
+	return rc;
+}
+
+BOOL rfx_decode_rgb_rects(RFX_CONTEXT* WINPR_RESTRICT context, const RFX_TILE* WINPR_RESTRICT tile,
+                          BYTE* WINPR_RESTRICT dst, UINT32 stride, UINT32 tileLeft, UINT32 tileTop,
+                          const RECTANGLE_16* WINPR_RESTRICT rects, UINT32 numRects)
+{
+	BOOL rc = TRUE;
+	INT16* pSrcDst[3] = { 0 };
+	const primitives_t* prims = primitives_get();
+	const size_t bpp = FreeRDPGetBytesPerPixel(context->pixel_format);
+
+	if (numRects == 0)
+		return TRUE;
+
+	PROFILER_ENTER(context->priv->prof_rfx_decode_rgb)
+	BYTE* pBuffer = rfx_decode_ycbcr(context, tile, pSrcDst);
+	if (!pBuffer)
 		rc = FALSE;
+	else
+	{
+		PROFILER_ENTER(context->priv->prof_rfx_ycbcr_to_rgb)
+
+		for (UINT32 x = 0; rc && (x < numRects); x++)
+		{
+			const RECTANGLE_16* rect = &rects[x];
+			const size_t offset = 64ull * (rect->top - tileTop) + (rect->left - tileLeft);
+			const INT16* pSrc[3] = { &pSrcDst[0][offset], &pSrcDst[1][offset],
+				                     &pSrcDst[2][offset] };
+			const prim_size_t roi = { rect->right - rect->left, rect->bottom - rect->top };
+			BYTE* pDst = &dst[1ull * rect->top * stride + bpp * rect->left];
+
+			WINPR_ASSERT((rect->left >= tileLeft) && (rect->right <= tileLeft + 64));
+			WINPR_ASSERT((rect->top >= tileTop) && (rect->bottom <= tileTop + 64));
+
+			if (prims->yCbCrToRGB_16s8u_P3AC4R(pSrc, 64 * sizeof(INT16), pDst, stride,
+			                                   context->pixel_format, &roi) != PRIMITIVES_SUCCESS)
+				rc = FALSE;
+		}
 
-	PROFILER_EXIT(context->priv->prof_rfx_ycbcr_to_rgb)
+		PROFILER_EXIT(context->priv->prof_rfx_ycbcr_to_rgb)
+		BufferPool_Return(context->priv->BufferPool, pBuffer);
+	}
 	PROFILER_EXIT(context->priv->prof_rfx_decode_rgb)
-	BufferPool_Return(context->priv->BufferPool, pBuffer);
 	return rc;
 }
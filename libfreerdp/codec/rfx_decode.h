@@ -23,6 +23,7 @@
 #include <winpr/wtypes.h>
 
 #include <freerdp/codec/rfx.h>
+#include <freerdp/codec/region.h>
 #include <freerdp/api.h>
 
 /* stride is bytes between rows in the output buffer. */
@@ -30,4 +31,11 @@ FREERDP_LOCAL BOOL rfx_decode_rgb(RFX_CONTEXT* WINPR_RESTRICT context,
                                   const RFX_TILE* WINPR_RESTRICT tile,
                                   BYTE* WINPR_RESTRICT rgb_buffer, UINT32 stride);
 
+/* Converts the tile straight into dst, clipped to rects given in dst coordinates. */
+FREERDP_LOCAL BOOL rfx_decode_rgb_rects(RFX_CONTEXT* WINPR_RESTRICT context,
+                                        const RFX_TILE* WINPR_RESTRICT tile,
+                                        BYTE* WINPR_RESTRICT dst, UINT32 stride, UINT32 tileLeft,
+                                        UINT32 tileTop, const RECTANGLE_16* WINPR_RESTRICT rects,
+                                        UINT32 numRects);
+
 #endif /* FREERDP_LIB_CODEC_RFX_DECODE_H */
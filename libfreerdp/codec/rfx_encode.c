@@ -256,6 +256,79 @@ static void rfx_encode_component(RFX_CONTEXT* WINPR_RESTRICT context,
 	BufferPool_Return(context->priv->BufferPool, dwt_buffer);
 }
 
+/* Neighbours differing by this much in a channel are a hard edge */
+#define RFX_EDGE_THRESHOLD 64
+
+static INLINE UINT32 rfx_pixel_distance(const BYTE* WINPR_RESTRICT a, const BYTE* WINPR_RESTRICT b,
+                                        size_t bpp)
+{
+	UINT32 distance = 0;
+
+	for (size_t i = 0; i < bpp; i++)
+	{
+		const UINT32 d = (a[i] > b[i]) ? (a[i] - b[i]) : (b[i] - a[i]);
+		distance = MAX(distance, d);
+	}
+
+	return distance;
+}
+
+/**
+ * Picks the quantization tables of a tile from the differences of neighbouring pixels on
+ * every other row. Rendered text and UI have mostly equal neighbours and hard edges, they
+ * get the fine table for luma. Photographic content and flat tiles without any edge hide
+ * the loss of the high bands and get the coarse table.
+ */
+static void rfx_encode_classify_tile(const RFX_CONTEXT* WINPR_RESTRICT context,
+                                     RFX_TILE* WINPR_RESTRICT tile)
+{
+	const size_t bpp = context->bits_per_pixel / 8;
+	size_t equal = 0;
+	size_t edges = 0;
+	size_t total = 0;
+
+	if ((bpp < 3) || (context->numQuant < RFX_QUANT_ADAPTIVE_COUNT))
+		return;
+
+	for (UINT32 y = 1; y < tile->height; y += 2)
+	{
+		const BYTE* row = &tile->data[1ULL * y * tile->scanline];
+		const BYTE* above = row - tile->scanline;
+
+		for (UINT32 x = 1; x < tile->width; x++)
+		{
+			const BYTE* pixel = &row[x * bpp];
+			const UINT32 dx = rfx_pixel_distance(pixel, pixel - bpp, bpp);
+			const UINT32 dy = rfx_pixel_distance(pixel, &above[x * bpp], bpp);
+			equal += (dx == 0) + (dy == 0);
+			edges += (dx >= RFX_EDGE_THRESHOLD) + (dy >= RFX_EDGE_THRESHOLD);
+			total += 2;
+		}
+	}
+
+	if (total == 0)
+		return;
+
+	const size_t changes = total - equal;
+
+	if ((edges == 0) && (changes * 32 <= total))
+	{
+		/* flat */
+		tile->quantIdxY = tile->quantIdxCb = tile->quantIdxCr = RFX_QUANT_COARSE;
+	}
+	else if (equal * 2 >= total)
+	{
+		/* text and edges */
+		tile->quantIdxY = RFX_QUANT_FINE;
+		tile->quantIdxCb = tile->quantIdxCr = RFX_QUANT_DEFAULT;
+	}
+	else
+	{
+		/* photographic */
+		tile->quantIdxY = tile->quantIdxCb = tile->quantIdxCr = RFX_QUANT_COARSE;
+	}
+}
+
 void rfx_encode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, RFX_TILE* WINPR_RESTRICT tile)
 {
 	union
@@ -278,6 +351,10 @@ void rfx_encode_rgb(RFX_CONTEXT* WINPR_RESTRICT context, RFX_TILE* WINPR_RESTRIC
 		return;
 
 	YLen = CbLen = CrLen = 0;
+
+	if (context->priv->AdaptiveQuant)
+		rfx_encode_classify_tile(context, tile);
+
 	YQuant = context->quants + (10ULL * tile->quantIdxY);
 	CbQuant = context->quants + (10ULL * tile->quantIdxCb);
 	CrQuant = context->quants + (10ULL * tile->quantIdxCr);
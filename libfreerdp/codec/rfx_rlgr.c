@@ -31,7 +31,7 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 #include <winpr/sysinfo.h>
-#include <winpr/bitstream.h>
+#include <winpr/endian.h>
 #include <winpr/intrin.h>
 
 #include "rfx_bitstream.h"
@@ -135,14 +135,108 @@ static INLINE UINT32 lzcnt_s(UINT32 x)
 	return __lzcnt(x);
 }
 
+/* MSB first bit reader over a 64 bit reservoir, refilled a word at a time */
+typedef struct
+{
+	const BYTE* src;
+	const BYTE* end;
+	UINT64 bits;
+	UINT32 count;
+} RFX_RLGR_READER;
+
+static INLINE UINT32 lzcnt64_s(UINT64 x)
+{
+	const UINT32 hi = (UINT32)(x >> 32);
+
+	if (hi)
+		return lzcnt_s(hi);
+
+	return 32 + lzcnt_s((UINT32)x);
+}
+
+static INLINE size_t rlgr_reader_remaining(const RFX_RLGR_READER* WINPR_RESTRICT r)
+{
+	return r->count + 8ull * (size_t)(r->end - r->src);
+}
+
+/* Tops the reservoir up to at least 56 valid bits or the end of the stream */
+static INLINE void rlgr_reader_refill(RFX_RLGR_READER* WINPR_RESTRICT r)
+{
+	if (r->count > 56)
+		return;
+
+	if (r->end - r->src >= 8)
+	{
+		/* bits past count are loaded again, identically, by the next refill */
+		UINT64 word = 0;
+		Data_Read_UINT64_BE(r->src, word);
+		r->bits |= word >> r->count;
+
+		const UINT32 bytes = (63 - r->count) >> 3;
+		r->src += bytes;
+		r->count += 8 * bytes;
+	}
+	else
+	{
+		while ((r->count <= 56) && (r->src < r->end))
+		{
+			r->bits |= ((UINT64)*r->src++) << (56 - r->count);
+			r->count += 8;
+		}
+	}
+}
+
+static INLINE void rlgr_reader_skip(RFX_RLGR_READER* WINPR_RESTRICT r, UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= r->count);
+
+	r->bits = (nbits < 64) ? (r->bits << nbits) : 0;
+	r->count -= nbits;
+}
+
+/* Consumes the next nbits (at most 32), the caller checked they are available */
+static INLINE UINT32 rlgr_reader_read(RFX_RLGR_READER* WINPR_RESTRICT r, UINT32 nbits)
+{
+	if (!nbits)
+		return 0;
+
+	rlgr_reader_refill(r);
+
+	const UINT32 val = (UINT32)(r->bits >> (64 - nbits));
+	rlgr_reader_skip(r, nbits);
+	return val;
+}
+
+/* Consumes the run of leading 0s (or 1s), the terminating bit is left in the stream */
+static INLINE UINT32 rlgr_reader_run(RFX_RLGR_READER* WINPR_RESTRICT r, BOOL ones)
+{
+	UINT32 run = 0;
+
+	while (TRUE)
+	{
+		rlgr_reader_refill(r);
+
+		const UINT32 count = r->count;
+		if (!count)
+			break;
+
+		const UINT32 cnt = MIN(lzcnt64_s(ones ? ~r->bits : r->bits), count);
+		rlgr_reader_skip(r, cnt);
+		run += cnt;
+
+		if (cnt < count)
+			break;
+	}
+
+	return run;
+}
+
 int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
                     INT16* WINPR_RESTRICT pDstData, UINT32 rDstSize)
 {
-	int vk = 0;
+	UINT32 vk = 0;
 	size_t run = 0;
-	int cnt = 0;
 	size_t size = 0;
-	int nbits = 0;
 	size_t offset = 0;
 	INT16 mag = 0;
 	UINT32 k = 0;
@@ -155,8 +249,8 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 	UINT32 val1 = 0;
 	UINT32 val2 = 0;
 	INT16* pOutput = NULL;
-	wBitStream* bs = NULL;
-	wBitStream s_bs = { 0 };
+	RFX_RLGR_READER reader = { 0 };
+	RFX_RLGR_READER* bs = &reader;
 	const SSIZE_T DstSize = rDstSize;
 
 	InitOnceExecuteOnce(&rfx_rlgr_init_once, rfx_rlgr_init, NULL, NULL);
@@ -178,12 +272,10 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 
 	pOutput = pDstData;
 
-	bs = &s_bs;
+	bs->src = pSrcData;
+	bs->end = &pSrcData[SrcSize];
 
-	BitStream_Attach(bs, pSrcData, SrcSize);
-	BitStream_Fetch(bs);
-
-	while ((BitStream_GetRemainingLength(bs) > 0) && ((pOutput - pDstData) < DstSize))
+	while ((rlgr_reader_remaining(bs) > 0) && ((pOutput - pDstData) < DstSize))
 	{
 		if (k)
 		{
@@ -193,35 +285,12 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 
 			/* count number of leading 0s */
 
-			cnt = lzcnt_s(bs->accumulator);
-
-			nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = cnt;
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(bs->accumulator);
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				vk += cnt;
-			}
-
-			BitStream_Shift(bs, (vk % 32));
+			vk = rlgr_reader_run(bs, FALSE);
 
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (rlgr_reader_remaining(bs) < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			rlgr_reader_skip(bs, 1);
 
 			while (vk--)
 			{
@@ -240,64 +309,33 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 
 			/* next k bits contain run length remainder */
 
-			if (BitStream_GetRemainingLength(bs) < k)
+			if (rlgr_reader_remaining(bs) < k)
 				break;
 
-			bs->mask = ((1 << k) - 1);
-			run += ((bs->accumulator >> (32 - k)) & bs->mask);
-			BitStream_Shift(bs, k);
+			run += rlgr_reader_read(bs, k);
 
 			/* read sign bit */
 
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (rlgr_reader_remaining(bs) < 1)
 				break;
 
-			sign = (bs->accumulator & 0x80000000) ? 1 : 0;
-			BitStream_Shift(bs, 1);
+			sign = rlgr_reader_read(bs, 1);
 
 			/* count number of leading 1s */
 
-			cnt = lzcnt_s(~(bs->accumulator));
-
-			nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = cnt;
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(~(bs->accumulator));
-
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
+			vk = rlgr_reader_run(bs, TRUE);
 
-				vk += cnt;
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (rlgr_reader_remaining(bs) < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			rlgr_reader_skip(bs, 1);
 
 			/* next kr bits contain code remainder */
 
-			if (BitStream_GetRemainingLength(bs) < kr)
+			if (rlgr_reader_remaining(bs) < kr)
 				break;
 
-			bs->mask = ((1 << kr) - 1);
-			if (kr > 0)
-				code = (UINT16)((bs->accumulator >> (32 - kr)) & bs->mask);
-			else
-				code = 0;
-			BitStream_Shift(bs, kr);
+			code = (UINT16)rlgr_reader_read(bs, kr);
 
 			/* add (vk << kr) to code */
 
@@ -368,47 +406,19 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 
 			/* count number of leading 1s */
 
-			cnt = lzcnt_s(~(bs->accumulator));
-
-			nbits = BitStream_GetRemainingLength(bs);
-
-			if (cnt > nbits)
-				cnt = nbits;
-
-			vk = cnt;
-
-			while ((cnt == 32) && (BitStream_GetRemainingLength(bs) > 0))
-			{
-				BitStream_Shift32(bs);
-
-				cnt = lzcnt_s(~(bs->accumulator));
+			vk = rlgr_reader_run(bs, TRUE);
 
-				nbits = BitStream_GetRemainingLength(bs);
-
-				if (cnt > nbits)
-					cnt = nbits;
-
-				vk += cnt;
-			}
-
-			BitStream_Shift(bs, (vk % 32));
-
-			if (BitStream_GetRemainingLength(bs) < 1)
+			if (rlgr_reader_remaining(bs) < 1)
 				break;
 
-			BitStream_Shift(bs, 1);
+			rlgr_reader_skip(bs, 1);
 
 			/* next kr bits contain code remainder */
 
-			if (BitStream_GetRemainingLength(bs) < kr)
+			if (rlgr_reader_remaining(bs) < kr)
 				break;
 
-			bs->mask = ((1 << kr) - 1);
-			if (kr > 0)
-				code = (UINT16)((bs->accumulator >> (32 - kr)) & bs->mask);
-			else
-				code = 0;
-			BitStream_Shift(bs, kr);
+			code = (UINT16)rlgr_reader_read(bs, kr);
 
 			/* add (vk << kr) to code */
 
@@ -485,20 +495,12 @@ int rfx_rlgr_decode(RLGR_MODE mode, const BYTE* WINPR_RESTRICT pSrcData, UINT32
 				nIdx = 0;
 
 				if (code)
-				{
-					mag = (UINT32)code;
-					nIdx = 32 - lzcnt_s(mag);
-				}
+					nIdx = 32 - lzcnt_s(code);
 
-				if (BitStream_GetRemainingLength(bs) < nIdx)
+				if (rlgr_reader_remaining(bs) < nIdx)
 					break;
 
-				bs->mask = ((1 << nIdx) - 1);
-				if (nIdx > 0)
-					val1 = ((bs->accumulator >> (32 - nIdx)) & bs->mask);
-				else
-					val1 = 0;
-				BitStream_Shift(bs, nIdx);
+				val1 = rlgr_reader_read(bs, nIdx);
 
 				val2 = code - val1;
 
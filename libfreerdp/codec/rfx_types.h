@@ -47,6 +47,12 @@
 #define RFX_DECODED_CHANNELS 0x00000008
 #define RFX_DECODED_HEADERS 0x0000000F
 
+/* Quantization tables of the adaptive quantization, see rfx_context_set_adaptive_quantization */
+#define RFX_QUANT_DEFAULT 0
+#define RFX_QUANT_FINE 1
+#define RFX_QUANT_COARSE 2
+#define RFX_QUANT_ADAPTIVE_COUNT 3
+
 typedef enum
 {
 	RFX_STATE_INITIAL,
@@ -66,7 +72,6 @@ struct S_RFX_CONTEXT_PRIV
 	wObjectPool* TilePool;
 
 	BOOL UseThreads;
-	PTP_WORK* workObjects;
 	RFX_TILE_COMPOSE_WORK_PARAM* tileWorkParams;
 
 	DWORD MinThreadCount;
@@ -77,6 +82,8 @@ struct S_RFX_CONTEXT_PRIV
 
 	wBufferPool* BufferPool;
 
+	BOOL AdaptiveQuant;
+
 	/* profilers */
 	PROFILER_DEFINE(prof_rfx_decode_rgb)
 	PROFILER_DEFINE(prof_rfx_decode_component)
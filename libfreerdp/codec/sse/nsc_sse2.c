@@ -79,52 +79,6 @@ static BOOL nsc_encode_argb_to_aycocg_sse2(NSC_CONTEXT* context, const BYTE* dat
 		{
 			switch (context->format)
 			{
-				case PIXEL_FORMAT_BGRX32:
-					b_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16),
-					                      *(src + 12), *(src + 8), *(src + 4), *src);
-					g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17),
-					                      *(src + 13), *(src + 9), *(src + 5), *(src + 1));
-					r_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18),
-					                      *(src + 14), *(src + 10), *(src + 6), *(src + 2));
-					a_val = _mm_set1_epi16(0xFF);
-					src += 32;
-					break;
-
-				case PIXEL_FORMAT_BGRA32:
-					b_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16),
-					                      *(src + 12), *(src + 8), *(src + 4), *src);
-					g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17),
-					                      *(src + 13), *(src + 9), *(src + 5), *(src + 1));
-					r_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18),
-					                      *(src + 14), *(src + 10), *(src + 6), *(src + 2));
-					a_val = _mm_set_epi16(*(src + 31), *(src + 27), *(src + 23), *(src + 19),
-					                      *(src + 15), *(src + 11), *(src + 7), *(src + 3));
-					src += 32;
-					break;
-
-				case PIXEL_FORMAT_RGBX32:
-					r_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16),
-					                      *(src + 12), *(src + 8), *(src + 4), *src);
-					g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17),
-					                      *(src + 13), *(src + 9), *(src + 5), *(src + 1));
-					b_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18),
-					                      *(src + 14), *(src + 10), *(src + 6), *(src + 2));
-					a_val = _mm_set1_epi16(0xFF);
-					src += 32;
-					break;
-
-				case PIXEL_FORMAT_RGBA32:
-					r_val = _mm_set_epi16(*(src + 28), *(src + 24), *(src + 20), *(src + 16),
-					                      *(src + 12), *(src + 8), *(src + 4), *src);
-					g_val = _mm_set_epi16(*(src + 29), *(src + 25), *(src + 21), *(src + 17),
-					                      *(src + 13), *(src + 9), *(src + 5), *(src + 1));
-					b_val = _mm_set_epi16(*(src + 30), *(src + 26), *(src + 22), *(src + 18),
-					                      *(src + 14), *(src + 10), *(src + 6), *(src + 2));
-					a_val = _mm_set_epi16(*(src + 31), *(src + 27), *(src + 23), *(src + 19),
-					                      *(src + 15), *(src + 11), *(src + 7), *(src + 3));
-					src += 32;
-					break;
-
 				case PIXEL_FORMAT_BGR24:
 					b_val = _mm_set_epi16(*(src + 21), *(src + 18), *(src + 15), *(src + 12),
 					                      *(src + 9), *(src + 6), *(src + 3), *src);
@@ -325,58 +279,176 @@ static BOOL nsc_encode_argb_to_aycocg_sse2(NSC_CONTEXT* context, const BYTE* dat
 	return TRUE;
 }
 
+/* Extract the byte at offset off of 8 pixels as 16 bit values */
+static INLINE __m128i nsc_extract_channel_sse2(__m128i p0, __m128i p1, size_t off)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const __m128i shift = _mm_cvtsi32_si128((int)(8 * off));
+	const __m128i c0 = _mm_and_si128(_mm_srl_epi32(p0, shift), mask);
+	const __m128i c1 = _mm_and_si128(_mm_srl_epi32(p1, shift), mask);
+	return _mm_packs_epi32(c0, c1);
+}
+
+/* Pack 16 bit values to bytes, truncating like the generic (BYTE) cast */
+static INLINE __m128i nsc_pack_bytes_sse2(__m128i val)
+{
+	const __m128i mask = _mm_set1_epi16(0xFF);
+	val = _mm_and_si128(val, mask);
+	return _mm_packus_epi16(val, val);
+}
+
+static BOOL nsc_encode_argb_to_aycocg_32bpp_sse2(NSC_CONTEXT* context, const BYTE* data,
+                                                 UINT32 scanline, size_t roff, size_t goff,
+                                                 size_t boff, BOOL alpha)
+{
+	const UINT32 tempWidth = ROUND_UP_TO(context->width, 8);
+	const UINT32 rw = (context->ChromaSubsamplingLevel > 0 ? tempWidth : context->width);
+	const UINT32 width = context->width & ~7u;
+	const BYTE ccl = (BYTE)context->ColorLossLevel;
+	const __m128i cshift = _mm_cvtsi32_si128(ccl);
+	const __m128i opaque = _mm_set1_epi16(0xFF);
+	size_t y = 0;
+
+	for (; y < context->height; y++)
+	{
+		const BYTE* src = data + (context->height - 1 - y) * scanline;
+		BYTE* yplane = context->priv->PlaneBuffers[0] + y * rw;
+		BYTE* coplane = context->priv->PlaneBuffers[1] + y * rw;
+		BYTE* cgplane = context->priv->PlaneBuffers[2] + y * rw;
+		BYTE* aplane = context->priv->PlaneBuffers[3] + y * context->width;
+		UINT32 x = 0;
+
+		/* 8 pixels per round */
+		for (; x < width; x += 8)
+		{
+			const __m128i p0 = _mm_loadu_si128((const __m128i*)&src[4ULL * x]);
+			const __m128i p1 = _mm_loadu_si128((const __m128i*)&src[4ULL * x + 16]);
+			const __m128i r_val = nsc_extract_channel_sse2(p0, p1, roff);
+			const __m128i g_val = nsc_extract_channel_sse2(p0, p1, goff);
+			const __m128i b_val = nsc_extract_channel_sse2(p0, p1, boff);
+			const __m128i a_val = alpha ? nsc_extract_channel_sse2(p0, p1, 3) : opaque;
+			__m128i y_val = _mm_srai_epi16(r_val, 2);
+			y_val = _mm_add_epi16(y_val, _mm_srai_epi16(g_val, 1));
+			y_val = _mm_add_epi16(y_val, _mm_srai_epi16(b_val, 2));
+			const __m128i co_val = _mm_sra_epi16(_mm_sub_epi16(r_val, b_val), cshift);
+			__m128i cg_val = _mm_sub_epi16(g_val, _mm_srai_epi16(r_val, 1));
+			cg_val = _mm_sub_epi16(cg_val, _mm_srai_epi16(b_val, 1));
+			cg_val = _mm_sra_epi16(cg_val, cshift);
+			_mm_storel_epi64((__m128i*)&yplane[x], nsc_pack_bytes_sse2(y_val));
+			_mm_storel_epi64((__m128i*)&coplane[x], nsc_pack_bytes_sse2(co_val));
+			_mm_storel_epi64((__m128i*)&cgplane[x], nsc_pack_bytes_sse2(cg_val));
+			_mm_storel_epi64((__m128i*)&aplane[x], nsc_pack_bytes_sse2(a_val));
+		}
+
+		for (; x < context->width; x++)
+		{
+			const BYTE* px = &src[4ULL * x];
+			const INT16 r_val = px[roff];
+			const INT16 g_val = px[goff];
+			const INT16 b_val = px[boff];
+			yplane[x] = (BYTE)((r_val >> 2) + (g_val >> 1) + (b_val >> 2));
+			coplane[x] = (BYTE)((r_val - b_val) >> ccl);
+			cgplane[x] = (BYTE)((-(r_val >> 1) + g_val - (b_val >> 1)) >> ccl);
+			aplane[x] = alpha ? px[3] : 0xFF;
+		}
+
+		if (context->ChromaSubsamplingLevel > 0 && (context->width % 2) == 1)
+		{
+			yplane[context->width] = yplane[context->width - 1];
+			coplane[context->width] = coplane[context->width - 1];
+			cgplane[context->width] = cgplane[context->width - 1];
+		}
+	}
+
+	if (context->ChromaSubsamplingLevel > 0 && (y % 2) == 1)
+	{
+		BYTE* yplane = context->priv->PlaneBuffers[0] + y * rw;
+		BYTE* coplane = context->priv->PlaneBuffers[1] + y * rw;
+		BYTE* cgplane = context->priv->PlaneBuffers[2] + y * rw;
+		CopyMemory(yplane, yplane - rw, rw);
+		CopyMemory(coplane, coplane - rw, rw);
+		CopyMemory(cgplane, cgplane - rw, rw);
+	}
+
+	return TRUE;
+}
+
+/* Average 2x2 blocks of signed chroma values, 8 results per call */
+static INLINE __m128i nsc_subsample_sse2(const INT8* src0, const INT8* src1)
+{
+	const __m128i t0 = _mm_loadu_si128((const __m128i*)src0);
+	const __m128i t1 = _mm_loadu_si128((const __m128i*)src1);
+	/* sign extend the even and odd bytes to 16 bit */
+	const __m128i even = _mm_add_epi16(_mm_srai_epi16(_mm_slli_epi16(t0, 8), 8),
+	                                   _mm_srai_epi16(_mm_slli_epi16(t1, 8), 8));
+	const __m128i odd = _mm_add_epi16(_mm_srai_epi16(t0, 8), _mm_srai_epi16(t1, 8));
+	const __m128i val = _mm_srai_epi16(_mm_add_epi16(even, odd), 2);
+	return _mm_packs_epi16(val, val);
+}
+
 static void nsc_encode_subsampling_sse2(NSC_CONTEXT* context)
 {
-	BYTE* co_dst = NULL;
-	BYTE* cg_dst = NULL;
-	INT8* co_src0 = NULL;
-	INT8* co_src1 = NULL;
-	INT8* cg_src0 = NULL;
-	INT8* cg_src1 = NULL;
-	UINT32 tempWidth = 0;
-	UINT32 tempHeight = 0;
-	__m128i t;
-	__m128i val;
-	__m128i mask = _mm_set1_epi16(0xFF);
-	tempWidth = ROUND_UP_TO(context->width, 8);
-	tempHeight = ROUND_UP_TO(context->height, 2);
+	const UINT32 tempWidth = ROUND_UP_TO(context->width, 8);
+	const UINT32 tempHeight = ROUND_UP_TO(context->height, 2);
+	const UINT32 halfWidth = tempWidth >> 1;
 
 	for (size_t y = 0; y < tempHeight >> 1; y++)
 	{
-		co_dst = context->priv->PlaneBuffers[1] + y * (tempWidth >> 1);
-		cg_dst = context->priv->PlaneBuffers[2] + y * (tempWidth >> 1);
-		co_src0 = (INT8*)context->priv->PlaneBuffers[1] + (y << 1) * tempWidth;
-		co_src1 = co_src0 + tempWidth;
-		cg_src0 = (INT8*)context->priv->PlaneBuffers[2] + (y << 1) * tempWidth;
-		cg_src1 = cg_src0 + tempWidth;
-
-		for (UINT32 x = 0; x < tempWidth >> 1; x += 8)
+		BYTE* co_dst = context->priv->PlaneBuffers[1] + y * halfWidth;
+		BYTE* cg_dst = context->priv->PlaneBuffers[2] + y * halfWidth;
+		const INT8* co_src0 = (INT8*)context->priv->PlaneBuffers[1] + (y << 1) * tempWidth;
+		const INT8* co_src1 = co_src0 + tempWidth;
+		const INT8* cg_src0 = (INT8*)context->priv->PlaneBuffers[2] + (y << 1) * tempWidth;
+		const INT8* cg_src1 = cg_src0 + tempWidth;
+		UINT32 x = 0;
+
+		for (; x + 8 <= halfWidth; x += 8)
+		{
+			_mm_storel_epi64((__m128i*)&co_dst[x],
+			                 nsc_subsample_sse2(&co_src0[2 * x], &co_src1[2 * x]));
+			_mm_storel_epi64((__m128i*)&cg_dst[x],
+			                 nsc_subsample_sse2(&cg_src0[2 * x], &cg_src1[2 * x]));
+		}
+
+		for (; x < halfWidth; x++)
 		{
-			t = _mm_loadu_si128((__m128i*)co_src0);
-			t = _mm_avg_epu8(t, _mm_loadu_si128((__m128i*)co_src1));
-			val = _mm_and_si128(_mm_srli_si128(t, 1), mask);
-			val = _mm_avg_epu16(val, _mm_and_si128(t, mask));
-			val = _mm_packus_epi16(val, val);
-			_mm_storeu_si128((__m128i*)co_dst, val);
-			co_dst += 8;
-			co_src0 += 16;
-			co_src1 += 16;
-			t = _mm_loadu_si128((__m128i*)cg_src0);
-			t = _mm_avg_epu8(t, _mm_loadu_si128((__m128i*)cg_src1));
-			val = _mm_and_si128(_mm_srli_si128(t, 1), mask);
-			val = _mm_avg_epu16(val, _mm_and_si128(t, mask));
-			val = _mm_packus_epi16(val, val);
-			_mm_storeu_si128((__m128i*)cg_dst, val);
-			cg_dst += 8;
-			cg_src0 += 16;
-			cg_src1 += 16;
+			co_dst[x] = (BYTE)((co_src0[2 * x] + co_src0[2 * x + 1] + co_src1[2 * x] +
+			                    co_src1[2 * x + 1]) >>
+			                   2);
+			cg_dst[x] = (BYTE)((cg_src0[2 * x] + cg_src0[2 * x + 1] + cg_src1[2 * x] +
+			                    cg_src1[2 * x + 1]) >>
+			                   2);
 		}
 	}
 }
 
 static BOOL nsc_encode_sse2(NSC_CONTEXT* context, const BYTE* data, UINT32 scanline)
 {
-	if (!nsc_encode_argb_to_aycocg_sse2(context, data, scanline))
+	BOOL rc = 0;
+
+	if (!context || !data || (scanline == 0))
+		return FALSE;
+
+	switch (context->format)
+	{
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			rc = nsc_encode_argb_to_aycocg_32bpp_sse2(
+			    context, data, scanline, 2, 1, 0, context->format == PIXEL_FORMAT_BGRA32);
+			break;
+
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			rc = nsc_encode_argb_to_aycocg_32bpp_sse2(
+			    context, data, scanline, 0, 1, 2, context->format == PIXEL_FORMAT_RGBA32);
+			break;
+
+		default:
+			rc = nsc_encode_argb_to_aycocg_sse2(context, data, scanline);
+			break;
+	}
+
+	if (!rc)
 		return FALSE;
 
 	if (context->ChromaSubsamplingLevel > 0)
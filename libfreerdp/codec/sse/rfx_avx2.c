@@ -0,0 +1,393 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * RemoteFX Codec Library - AVX2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/platform.h>
+#include <freerdp/config.h>
+
+#include "../rfx_types.h"
+#include "rfx_avx2.h"
+
+#if defined(WITH_SSE2) && defined(WITH_AVX2)
+#if defined(_M_IX86) || defined(_M_AMD64) || defined(_M_IA64) || defined(_M_IX86_AMD64)
+#define AVX2_ENABLED
+#endif
+#endif
+
+#if defined(AVX2_ENABLED)
+#include <winpr/sysinfo.h>
+
+#include <immintrin.h>
+
+/* The 4096 coefficients of a tile are processed 16 at a time. A subband row of 8 coefficients
+ * only fills one 128 bit lane, so for the 8x8 subbands every register holds two rows and the
+ * row boundaries are handled per lane. */
+
+#define mm256_load(_ptr) _mm256_loadu_si256((const __m256i*)(_ptr))
+#define mm256_store(_ptr, _val) _mm256_storeu_si256((__m256i*)(_ptr), (_val))
+
+/* [first, a0, ..., a14] */
+static INLINE __m256i mm256_shift_prev_epi16(__m256i a, INT16 first)
+{
+	const __m256i prev = _mm256_permute2x128_si256(a, a, 0x08);
+	return _mm256_insert_epi16(_mm256_alignr_epi8(a, prev, 14), first, 0);
+}
+
+/* [a1, ..., a15, last] */
+static INLINE __m256i mm256_shift_next_epi16(__m256i a, INT16 last)
+{
+	const __m256i next = _mm256_permute2x128_si256(a, a, 0x81);
+	return _mm256_insert_epi16(_mm256_alignr_epi8(next, a, 2), last, 15);
+}
+
+/* Per 128 bit lane [a0, a0, a1, ..., a6] */
+static INLINE __m256i mm256_lane_shift_prev_epi16(__m256i a)
+{
+	const __m256i mask = _mm256_setr_epi8(0, 1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 0,
+	                                      1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13);
+	return _mm256_shuffle_epi8(a, mask);
+}
+
+/* Per 128 bit lane [a1, ..., a7, a7] */
+static INLINE __m256i mm256_lane_shift_next_epi16(__m256i a)
+{
+	const __m256i mask = _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 14, 15,
+	                                      2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 14, 15);
+	return _mm256_shuffle_epi8(a, mask);
+}
+
+static INLINE void rfx_quantization_decode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                      size_t buffer_size, UINT32 factor)
+{
+	if (factor == 0)
+		return;
+
+	const __m128i shift = _mm_cvtsi32_si128((int)factor);
+
+	for (size_t i = 0; i < buffer_size; i += 16)
+	{
+		const __m256i a = mm256_load(&buffer[i]);
+		mm256_store(&buffer[i], _mm256_sll_epi16(a, shift));
+	}
+}
+
+static void rfx_quantization_decode_avx2(INT16* WINPR_RESTRICT buffer,
+                                         const UINT32* WINPR_RESTRICT quantVals)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(quantVals);
+
+	rfx_quantization_decode_block_avx2(&buffer[0], 1024, quantVals[8] - 1);    /* HL1 */
+	rfx_quantization_decode_block_avx2(&buffer[1024], 1024, quantVals[7] - 1); /* LH1 */
+	rfx_quantization_decode_block_avx2(&buffer[2048], 1024, quantVals[9] - 1); /* HH1 */
+	rfx_quantization_decode_block_avx2(&buffer[3072], 256, quantVals[5] - 1);  /* HL2 */
+	rfx_quantization_decode_block_avx2(&buffer[3328], 256, quantVals[4] - 1);  /* LH2 */
+	rfx_quantization_decode_block_avx2(&buffer[3584], 256, quantVals[6] - 1);  /* HH2 */
+	rfx_quantization_decode_block_avx2(&buffer[3840], 64, quantVals[2] - 1);   /* HL3 */
+	rfx_quantization_decode_block_avx2(&buffer[3904], 64, quantVals[1] - 1);   /* LH3 */
+	rfx_quantization_decode_block_avx2(&buffer[3968], 64, quantVals[3] - 1);   /* HH3 */
+	rfx_quantization_decode_block_avx2(&buffer[4032], 64, quantVals[0] - 1);   /* LL3 */
+}
+
+static INLINE void rfx_quantization_encode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                      size_t buffer_size, UINT32 factor)
+{
+	if (factor == 0)
+		return;
+
+	const __m128i shift = _mm_cvtsi32_si128((int)factor);
+	const __m256i half = _mm256_set1_epi16((INT16)(1 << (factor - 1)));
+
+	for (size_t i = 0; i < buffer_size; i += 16)
+	{
+		const __m256i a = _mm256_add_epi16(mm256_load(&buffer[i]), half);
+		mm256_store(&buffer[i], _mm256_sra_epi16(a, shift));
+	}
+}
+
+static void rfx_quantization_encode_avx2(INT16* WINPR_RESTRICT buffer,
+                                         const UINT32* WINPR_RESTRICT quantization_values)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(quantization_values);
+
+	rfx_quantization_encode_block_avx2(buffer, 1024, quantization_values[8] - 6);        /* HL1 */
+	rfx_quantization_encode_block_avx2(buffer + 1024, 1024, quantization_values[7] - 6); /* LH1 */
+	rfx_quantization_encode_block_avx2(buffer + 2048, 1024, quantization_values[9] - 6); /* HH1 */
+	rfx_quantization_encode_block_avx2(buffer + 3072, 256, quantization_values[5] - 6);  /* HL2 */
+	rfx_quantization_encode_block_avx2(buffer + 3328, 256, quantization_values[4] - 6);  /* LH2 */
+	rfx_quantization_encode_block_avx2(buffer + 3584, 256, quantization_values[6] - 6);  /* HH2 */
+	rfx_quantization_encode_block_avx2(buffer + 3840, 64, quantization_values[2] - 6);   /* HL3 */
+	rfx_quantization_encode_block_avx2(buffer + 3904, 64, quantization_values[1] - 6);   /* LH3 */
+	rfx_quantization_encode_block_avx2(buffer + 3968, 64, quantization_values[3] - 6);   /* HH3 */
+	rfx_quantization_encode_block_avx2(buffer + 4032, 64, quantization_values[0] - 6);   /* LL3 */
+	rfx_quantization_encode_block_avx2(buffer, 4096, 5);
+}
+
+static INLINE void rfx_dwt_2d_decode_block_horiz_avx2(INT16* WINPR_RESTRICT l,
+                                                      const INT16* WINPR_RESTRICT h,
+                                                      INT16* WINPR_RESTRICT dst,
+                                                      size_t subband_width)
+{
+	const size_t count = subband_width * subband_width;
+	const __m256i one = _mm256_set1_epi16(1);
+
+	/* Even coefficients, stored back to l */
+	for (size_t i = 0; i < count; i += 16)
+	{
+		/* dst[2n] = l[n] - ((h[n-1] + h[n] + 1) >> 1); */
+		const size_t n = i % subband_width;
+		const __m256i l_n = mm256_load(&l[i]);
+		const __m256i h_n = mm256_load(&h[i]);
+		__m256i h_n_m;
+
+		if (subband_width < 16)
+			h_n_m = mm256_lane_shift_prev_epi16(h_n);
+		else
+			h_n_m = mm256_shift_prev_epi16(h_n, (n == 0) ? h[i] : h[i - 1]);
+
+		__m256i tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_n, h_n_m), one);
+		tmp_n = _mm256_srai_epi16(tmp_n, 1);
+		mm256_store(&l[i], _mm256_sub_epi16(l_n, tmp_n));
+	}
+
+	/* Odd coefficients, interleaved with the even ones into dst */
+	for (size_t i = 0; i < count; i += 16)
+	{
+		/* dst[2n + 1] = (h[n] << 1) + ((dst[2n] + dst[2n + 2]) >> 1); */
+		const size_t n = i % subband_width;
+		const __m256i h_n = _mm256_slli_epi16(mm256_load(&h[i]), 1);
+		const __m256i dst_n = mm256_load(&l[i]);
+		__m256i dst_n_p;
+
+		if (subband_width < 16)
+			dst_n_p = mm256_lane_shift_next_epi16(dst_n);
+		else
+			dst_n_p = mm256_shift_next_epi16(dst_n, (n + 16 == subband_width) ? l[i + 15]
+			                                                                   : l[i + 16]);
+
+		__m256i tmp_n = _mm256_add_epi16(dst_n_p, dst_n);
+		tmp_n = _mm256_srai_epi16(tmp_n, 1);
+		tmp_n = _mm256_add_epi16(tmp_n, h_n);
+		const __m256i lo = _mm256_unpacklo_epi16(dst_n, tmp_n);
+		const __m256i hi = _mm256_unpackhi_epi16(dst_n, tmp_n);
+		mm256_store(&dst[2 * i], _mm256_permute2x128_si256(lo, hi, 0x20));
+		mm256_store(&dst[2 * i + 16], _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+}
+
+static INLINE void rfx_dwt_2d_decode_block_vert_avx2(const INT16* WINPR_RESTRICT l,
+                                                     const INT16* WINPR_RESTRICT h,
+                                                     INT16* WINPR_RESTRICT dst,
+                                                     size_t subband_width)
+{
+	const size_t total_width = subband_width + subband_width;
+	const __m256i one = _mm256_set1_epi16(1);
+
+	/* Even coefficients */
+	for (size_t n = 0; n < subband_width; n++)
+	{
+		for (size_t x = 0; x < total_width; x += 16)
+		{
+			/* dst[2n] = l[n] - ((h[n-1] + h[n] + 1) >> 1); */
+			const __m256i l_n = mm256_load(&l[n * total_width + x]);
+			const __m256i h_n = mm256_load(&h[n * total_width + x]);
+			const __m256i h_n_m = (n == 0) ? h_n : mm256_load(&h[(n - 1) * total_width + x]);
+			__m256i tmp_n = _mm256_add_epi16(_mm256_add_epi16(h_n, h_n_m), one);
+			tmp_n = _mm256_srai_epi16(tmp_n, 1);
+			mm256_store(&dst[2 * n * total_width + x], _mm256_sub_epi16(l_n, tmp_n));
+		}
+	}
+
+	/* Odd coefficients */
+	for (size_t n = 0; n < subband_width; n++)
+	{
+		for (size_t x = 0; x < total_width; x += 16)
+		{
+			/* dst[2n + 1] = (h[n] << 1) + ((dst[2n] + dst[2n + 2]) >> 1); */
+			const __m256i h_n = _mm256_slli_epi16(mm256_load(&h[n * total_width + x]), 1);
+			const __m256i dst_n_m = mm256_load(&dst[2 * n * total_width + x]);
+			const __m256i dst_n_p = (n == subband_width - 1)
+			                            ? dst_n_m
+			                            : mm256_load(&dst[(2 * n + 2) * total_width + x]);
+			__m256i tmp_n = _mm256_add_epi16(dst_n_m, dst_n_p);
+			tmp_n = _mm256_srai_epi16(tmp_n, 1);
+			mm256_store(&dst[(2 * n + 1) * total_width + x], _mm256_add_epi16(tmp_n, h_n));
+		}
+	}
+}
+
+static INLINE void rfx_dwt_2d_decode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                INT16* WINPR_RESTRICT idwt, size_t subband_width)
+{
+	/* Inverse DWT in horizontal direction, results in 2 sub-bands in L, H order in tmp buffer idwt.
+	 */
+	/* The 4 sub-bands are stored in HL(0), LH(1), HH(2), LL(3) order. */
+	/* The lower part L uses LL(3) and HL(0). */
+	/* The higher part H uses LH(1) and HH(2). */
+	INT16* ll = buffer + 3ULL * subband_width * subband_width;
+	INT16* hl = buffer;
+	INT16* l_dst = idwt;
+	rfx_dwt_2d_decode_block_horiz_avx2(ll, hl, l_dst, subband_width);
+	INT16* lh = buffer + 1ULL * subband_width * subband_width;
+	INT16* hh = buffer + 2ULL * subband_width * subband_width;
+	INT16* h_dst = idwt + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_decode_block_horiz_avx2(lh, hh, h_dst, subband_width);
+	/* Inverse DWT in vertical direction, results are stored in original buffer. */
+	rfx_dwt_2d_decode_block_vert_avx2(l_dst, h_dst, buffer, subband_width);
+}
+
+static void rfx_dwt_2d_decode_avx2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_buffer)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(dwt_buffer);
+
+	rfx_dwt_2d_decode_block_avx2(&buffer[3840], dwt_buffer, 8);
+	rfx_dwt_2d_decode_block_avx2(&buffer[3072], dwt_buffer, 16);
+	rfx_dwt_2d_decode_block_avx2(&buffer[0], dwt_buffer, 32);
+}
+
+static INLINE void rfx_dwt_2d_encode_block_vert_avx2(const INT16* WINPR_RESTRICT src,
+                                                     INT16* WINPR_RESTRICT l,
+                                                     INT16* WINPR_RESTRICT h,
+                                                     size_t subband_width)
+{
+	const size_t total_width = subband_width << 1;
+
+	for (size_t n = 0; n < subband_width; n++)
+	{
+		for (size_t x = 0; x < total_width; x += 16)
+		{
+			const __m256i src_2n = mm256_load(&src[2 * n * total_width + x]);
+			const __m256i src_2n_1 = mm256_load(&src[(2 * n + 1) * total_width + x]);
+			const __m256i src_2n_2 = (n < subband_width - 1)
+			                             ? mm256_load(&src[(2 * n + 2) * total_width + x])
+			                             : src_2n;
+
+			/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+			__m256i h_n = _mm256_add_epi16(src_2n, src_2n_2);
+			h_n = _mm256_srai_epi16(h_n, 1);
+			h_n = _mm256_sub_epi16(src_2n_1, h_n);
+			h_n = _mm256_srai_epi16(h_n, 1);
+			mm256_store(&h[n * total_width + x], h_n);
+
+			/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1) */
+			const __m256i h_n_m = (n == 0) ? h_n : mm256_load(&h[(n - 1) * total_width + x]);
+			__m256i l_n = _mm256_add_epi16(h_n_m, h_n);
+			l_n = _mm256_srai_epi16(l_n, 1);
+			mm256_store(&l[n * total_width + x], _mm256_add_epi16(l_n, src_2n));
+		}
+	}
+}
+
+static INLINE void rfx_dwt_2d_encode_block_horiz_avx2(const INT16* WINPR_RESTRICT src,
+                                                      INT16* WINPR_RESTRICT l,
+                                                      INT16* WINPR_RESTRICT h,
+                                                      size_t subband_width)
+{
+	const size_t count = subband_width * subband_width;
+	const __m256i deinterleave = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14,
+	                                              15, 0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11,
+	                                              14, 15);
+
+	for (size_t i = 0; i < count; i += 16)
+	{
+		const size_t n = i % subband_width;
+
+		/* Split 32 source values into 16 even and 16 odd ones. */
+		__m256i a = _mm256_shuffle_epi8(mm256_load(&src[2 * i]), deinterleave);
+		__m256i b = _mm256_shuffle_epi8(mm256_load(&src[2 * i + 16]), deinterleave);
+		a = _mm256_permute4x64_epi64(a, 0xD8);
+		b = _mm256_permute4x64_epi64(b, 0xD8);
+		const __m256i src_2n = _mm256_permute2x128_si256(a, b, 0x20);
+		const __m256i src_2n_1 = _mm256_permute2x128_si256(a, b, 0x31);
+		__m256i src_2n_2;
+
+		if (subband_width < 16)
+			src_2n_2 = mm256_lane_shift_next_epi16(src_2n);
+		else
+			src_2n_2 = mm256_shift_next_epi16(src_2n, (n + 16 == subband_width) ? src[2 * i + 30]
+			                                                                     : src[2 * i + 32]);
+
+		/* h[n] = (src[2n + 1] - ((src[2n] + src[2n + 2]) >> 1)) >> 1 */
+		__m256i h_n = _mm256_add_epi16(src_2n, src_2n_2);
+		h_n = _mm256_srai_epi16(h_n, 1);
+		h_n = _mm256_sub_epi16(src_2n_1, h_n);
+		h_n = _mm256_srai_epi16(h_n, 1);
+		mm256_store(&h[i], h_n);
+
+		__m256i h_n_m;
+
+		if (subband_width < 16)
+			h_n_m = mm256_lane_shift_prev_epi16(h_n);
+		else
+			h_n_m = mm256_shift_prev_epi16(h_n, (n == 0) ? h[i] : h[i - 1]);
+
+		/* l[n] = src[2n] + ((h[n - 1] + h[n]) >> 1) */
+		__m256i l_n = _mm256_add_epi16(h_n_m, h_n);
+		l_n = _mm256_srai_epi16(l_n, 1);
+		mm256_store(&l[i], _mm256_add_epi16(l_n, src_2n));
+	}
+}
+
+static INLINE void rfx_dwt_2d_encode_block_avx2(INT16* WINPR_RESTRICT buffer,
+                                                INT16* WINPR_RESTRICT dwt, size_t subband_width)
+{
+	/* DWT in vertical direction, results in 2 sub-bands in L, H order in tmp buffer dwt. */
+	INT16* l_src = dwt;
+	INT16* h_src = dwt + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_encode_block_vert_avx2(buffer, l_src, h_src, subband_width);
+	/* DWT in horizontal direction, results in 4 sub-bands in HL(0), LH(1), HH(2), LL(3) order,
+	 * stored in original buffer. */
+	/* The lower part L generates LL(3) and HL(0). */
+	/* The higher part H generates LH(1) and HH(2). */
+	INT16* ll = buffer + 3ULL * subband_width * subband_width;
+	INT16* hl = buffer;
+	INT16* lh = buffer + 1ULL * subband_width * subband_width;
+	INT16* hh = buffer + 2ULL * subband_width * subband_width;
+	rfx_dwt_2d_encode_block_horiz_avx2(l_src, ll, hl, subband_width);
+	rfx_dwt_2d_encode_block_horiz_avx2(h_src, lh, hh, subband_width);
+}
+
+static void rfx_dwt_2d_encode_avx2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT dwt_buffer)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(dwt_buffer);
+
+	rfx_dwt_2d_encode_block_avx2(buffer, dwt_buffer, 32);
+	rfx_dwt_2d_encode_block_avx2(buffer + 3072, dwt_buffer, 16);
+	rfx_dwt_2d_encode_block_avx2(buffer + 3840, dwt_buffer, 8);
+}
+#endif
+
+void rfx_init_avx2(RFX_CONTEXT* context)
+{
+#if defined(AVX2_ENABLED)
+	if (!IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+		return;
+
+	PROFILER_RENAME(context->priv->prof_rfx_quantization_decode, "rfx_quantization_decode_avx2")
+	PROFILER_RENAME(context->priv->prof_rfx_quantization_encode, "rfx_quantization_encode_avx2")
+	PROFILER_RENAME(context->priv->prof_rfx_dwt_2d_decode, "rfx_dwt_2d_decode_avx2")
+	PROFILER_RENAME(context->priv->prof_rfx_dwt_2d_encode, "rfx_dwt_2d_encode_avx2")
+	context->quantization_decode = rfx_quantization_decode_avx2;
+	context->quantization_encode = rfx_quantization_encode_avx2;
+	context->dwt_2d_decode = rfx_dwt_2d_decode_avx2;
+	context->dwt_2d_encode = rfx_dwt_2d_encode_avx2;
+#else
+	WINPR_UNUSED(context);
+#endif
+}
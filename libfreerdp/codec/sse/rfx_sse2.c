@@ -484,6 +484,228 @@ static void rfx_dwt_2d_encode_sse2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RE
 	rfx_dwt_2d_encode_block_sse2(buffer + 3072, dwt_buffer, 16);
 	rfx_dwt_2d_encode_block_sse2(buffer + 3840, dwt_buffer, 8);
 }
+
+/* Division by two rounding towards zero, matching the C '/' of the scalar decoder */
+static __inline __m128i __attribute__((ATTRIBUTES)) mm_div2_epi16(__m128i val)
+{
+	return _mm_srai_epi16(_mm_add_epi16(val, _mm_srli_epi16(val, 15)), 1);
+}
+
+/* (a + b) / 2 as computed in int by the scalar decoder, without 16 bit overflow */
+static __inline __m128i __attribute__((ATTRIBUTES)) mm_half_sum_epi16(__m128i a, __m128i b)
+{
+	const __m128i odd = _mm_and_si128(_mm_and_si128(a, b), _mm_set1_epi16(1));
+	const __m128i base =
+	    _mm_add_epi16(_mm_add_epi16(_mm_srai_epi16(a, 1), _mm_srai_epi16(b, 1)), odd);
+	return _mm_add_epi16(base, _mm_and_si128(_mm_xor_si128(a, b), _mm_srli_epi16(base, 15)));
+}
+
+/**
+ * Horizontal inverse lifting of the reduce-extrapolate layout. The even samples
+ * of a line only depend on the bands, so they are computed first and the odd
+ * samples are then interleaved from them.
+ */
+static __inline void __attribute__((ATTRIBUTES))
+rfx_idwt_extrapolate_horiz_sse2(const INT16* WINPR_RESTRICT pLowBand, size_t nLowStep,
+                                const INT16* WINPR_RESTRICT pHighBand, size_t nHighStep,
+                                INT16* WINPR_RESTRICT pDstBand, size_t nDstStep, size_t nLowCount,
+                                size_t nHighCount, size_t nDstCount)
+{
+	INT16 even[40] = { 0 };
+	const BOOL extra = nLowCount > nHighCount + 1;
+
+	WINPR_ASSERT((nLowCount > nHighCount) && (nHighCount < ARRAYSIZE(even)));
+
+	for (size_t y = 0; y < nDstCount; y++)
+	{
+		const INT16* pL = &pLowBand[y * nLowStep];
+		const INT16* pH = &pHighBand[y * nHighStep];
+		INT16* pX = &pDstBand[y * nDstStep];
+		size_t k = 1;
+
+		even[0] = pL[0] - pH[0];
+
+		for (; k + 8 <= nHighCount; k += 8)
+		{
+			const __m128i l = _mm_loadu_si128((const __m128i*)&pL[k]);
+			const __m128i h0 = _mm_loadu_si128((const __m128i*)&pH[k - 1]);
+			const __m128i h1 = _mm_loadu_si128((const __m128i*)&pH[k]);
+			_mm_storeu_si128((__m128i*)&even[k],
+			                 _mm_sub_epi16(l, mm_half_sum_epi16(h0, h1)));
+		}
+
+		for (; k < nHighCount; k++)
+			even[k] = pL[k] - ((pH[k - 1] + pH[k]) / 2);
+
+		if (extra)
+			even[nHighCount] = pL[nHighCount] - (pH[nHighCount - 1] / 2);
+		else
+			even[nHighCount] = pL[nHighCount] - pH[nHighCount - 1];
+
+		for (k = 0; k + 8 <= nHighCount; k += 8)
+		{
+			const __m128i e0 = _mm_loadu_si128((const __m128i*)&even[k]);
+			const __m128i e1 = _mm_loadu_si128((const __m128i*)&even[k + 1]);
+			const __m128i h = _mm_loadu_si128((const __m128i*)&pH[k]);
+			const __m128i odd =
+			    _mm_add_epi16(mm_half_sum_epi16(e0, e1), _mm_slli_epi16(h, 1));
+			_mm_storeu_si128((__m128i*)&pX[2 * k], _mm_unpacklo_epi16(e0, odd));
+			_mm_storeu_si128((__m128i*)&pX[2 * k + 8], _mm_unpackhi_epi16(e0, odd));
+		}
+
+		for (; k < nHighCount; k++)
+		{
+			pX[2 * k] = even[k];
+			pX[2 * k + 1] = ((even[k] + even[k + 1]) / 2) + (2 * pH[k]);
+		}
+
+		pX[2 * nHighCount] = even[nHighCount];
+
+		if (extra)
+			pX[2 * nHighCount + 1] = (even[nHighCount] + pL[nHighCount + 1]) / 2;
+	}
+}
+
+/**
+ * Vertical inverse lifting of the reduce-extrapolate layout, eight columns at a
+ * time. The even rows are written first, the odd rows are lifted from them.
+ */
+static __inline void __attribute__((ATTRIBUTES))
+rfx_idwt_extrapolate_vert_sse2(const INT16* WINPR_RESTRICT pLowBand, size_t nLowStep,
+                               const INT16* WINPR_RESTRICT pHighBand, size_t nHighStep,
+                               INT16* WINPR_RESTRICT pDstBand, size_t nDstStep, size_t nLowCount,
+                               size_t nHighCount, size_t nDstCount)
+{
+	const BOOL extra = nLowCount > nHighCount + 1;
+	const size_t nBatch = nDstCount & ~(size_t)7;
+
+	WINPR_ASSERT(nLowCount > nHighCount);
+
+	/* even rows */
+	for (size_t n = 0; n <= nHighCount; n++)
+	{
+		const INT16* pL = &pLowBand[n * nLowStep];
+		const INT16* pH0 = &pHighBand[((n > 0) ? (n - 1) : 0) * nHighStep];
+		const INT16* pH1 = &pHighBand[((n < nHighCount) ? n : (nHighCount - 1)) * nHighStep];
+		INT16* pX = &pDstBand[2 * n * nDstStep];
+		const BOOL pair = (n > 0) && (n < nHighCount);
+		const BOOL half = (n == nHighCount) && extra;
+		size_t x = 0;
+
+		for (; x < nBatch; x += 8)
+		{
+			const __m128i l = _mm_loadu_si128((const __m128i*)&pL[x]);
+			__m128i h = _mm_loadu_si128((const __m128i*)&pH1[x]);
+
+			if (pair)
+				h = mm_half_sum_epi16(_mm_loadu_si128((const __m128i*)&pH0[x]), h);
+			else if (half)
+				h = mm_div2_epi16(h);
+
+			_mm_storeu_si128((__m128i*)&pX[x], _mm_sub_epi16(l, h));
+		}
+
+		for (; x < nDstCount; x++)
+		{
+			if (pair)
+				pX[x] = pL[x] - ((pH0[x] + pH1[x]) / 2);
+			else if (half)
+				pX[x] = pL[x] - (pH1[x] / 2);
+			else
+				pX[x] = pL[x] - pH1[x];
+		}
+	}
+
+	/* odd rows */
+	for (size_t n = 0; n < nHighCount; n++)
+	{
+		const INT16* pH = &pHighBand[n * nHighStep];
+		const INT16* pE0 = &pDstBand[2 * n * nDstStep];
+		const INT16* pE1 = &pDstBand[(2 * n + 2) * nDstStep];
+		INT16* pX = &pDstBand[(2 * n + 1) * nDstStep];
+		size_t x = 0;
+
+		for (; x < nBatch; x += 8)
+		{
+			const __m128i e0 = _mm_loadu_si128((const __m128i*)&pE0[x]);
+			const __m128i e1 = _mm_loadu_si128((const __m128i*)&pE1[x]);
+			const __m128i h = _mm_loadu_si128((const __m128i*)&pH[x]);
+			_mm_storeu_si128(
+			    (__m128i*)&pX[x],
+			    _mm_add_epi16(mm_half_sum_epi16(e0, e1), _mm_slli_epi16(h, 1)));
+		}
+
+		for (; x < nDstCount; x++)
+			pX[x] = ((pE0[x] + pE1[x]) / 2) + (2 * pH[x]);
+	}
+
+	if (extra)
+	{
+		const INT16* pL = &pLowBand[(nHighCount + 1) * nLowStep];
+		const INT16* pE = &pDstBand[2 * nHighCount * nDstStep];
+		INT16* pX = &pDstBand[(2 * nHighCount + 1) * nDstStep];
+		size_t x = 0;
+
+		for (; x < nBatch; x += 8)
+		{
+			const __m128i e = _mm_loadu_si128((const __m128i*)&pE[x]);
+			const __m128i l = _mm_loadu_si128((const __m128i*)&pL[x]);
+			_mm_storeu_si128((__m128i*)&pX[x], mm_half_sum_epi16(e, l));
+		}
+
+		for (; x < nDstCount; x++)
+			pX[x] = (pE[x] + pL[x]) / 2;
+	}
+}
+
+static __inline size_t __attribute__((ATTRIBUTES)) rfx_extrapolate_band_l_count(size_t level)
+{
+	return (64 >> level) + 1;
+}
+
+static __inline size_t __attribute__((ATTRIBUTES)) rfx_extrapolate_band_h_count(size_t level)
+{
+	if (level == 1)
+		return (64 >> 1) - 1;
+	else
+		return (64 + (1 << (level - 1))) >> level;
+}
+
+static __inline void __attribute__((ATTRIBUTES))
+rfx_dwt_2d_extrapolate_decode_block_sse2(INT16* WINPR_RESTRICT buffer, INT16* WINPR_RESTRICT temp,
+                                         size_t level)
+{
+	const size_t nBandL = rfx_extrapolate_band_l_count(level);
+	const size_t nBandH = rfx_extrapolate_band_h_count(level);
+	const size_t nDstStep = nBandL + nBandH;
+	const INT16* HL = &buffer[0];
+	const INT16* LH = &HL[nBandH * nBandL];
+	const INT16* HH = &LH[nBandL * nBandH];
+	const INT16* LL = &HH[nBandH * nBandH];
+	INT16* L = &temp[0];
+	INT16* H = &temp[nBandL * nDstStep];
+
+	/* horizontal (LL + HL -> L) */
+	rfx_idwt_extrapolate_horiz_sse2(LL, nBandL, HL, nBandH, L, nDstStep, nBandL, nBandH, nBandL);
+
+	/* horizontal (LH + HH -> H) */
+	rfx_idwt_extrapolate_horiz_sse2(LH, nBandL, HH, nBandH, H, nDstStep, nBandL, nBandH, nBandH);
+
+	/* vertical (L + H -> LL) */
+	rfx_idwt_extrapolate_vert_sse2(L, nDstStep, H, nDstStep, buffer, nDstStep, nBandL, nBandH,
+	                               nDstStep);
+}
+
+static void rfx_dwt_2d_extrapolate_decode_sse2(INT16* WINPR_RESTRICT buffer,
+                                               INT16* WINPR_RESTRICT temp)
+{
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(temp);
+
+	rfx_dwt_2d_extrapolate_decode_block_sse2(&buffer[3807], temp, 3);
+	rfx_dwt_2d_extrapolate_decode_block_sse2(&buffer[3007], temp, 2);
+	rfx_dwt_2d_extrapolate_decode_block_sse2(&buffer[0], temp, 1);
+}
 #endif
 
 void rfx_init_sse2(RFX_CONTEXT* context)
@@ -500,6 +722,7 @@ void rfx_init_sse2(RFX_CONTEXT* context)
 	context->quantization_encode = rfx_quantization_encode_sse2;
 	context->dwt_2d_decode = rfx_dwt_2d_decode_sse2;
 	context->dwt_2d_encode = rfx_dwt_2d_encode_sse2;
+	context->dwt_2d_extrapolate_decode = rfx_dwt_2d_extrapolate_decode_sse2;
 #else
 	WINPR_UNUSED(context);
 #endif
@@ -2,6 +2,8 @@
 #include <winpr/print.h>
 #include <winpr/platform.h>
 
+#include <winpr/stream.h>
+
 #include <freerdp/codec/clear.h>
 
 WINPR_PRAGMA_DIAG_PUSH
@@ -68,6 +70,140 @@ fail:
 	return rc;
 }
 
+static BOOL test_ClearRoundtrip(CLEAR_CONTEXT* encoder, CLEAR_CONTEXT* decoder,
+                                const BYTE* pSrcData, UINT32 width, UINT32 height, BOOL lossless,
+                                size_t* pSize)
+{
+	BOOL rc = FALSE;
+	const UINT32 step = 4 * width;
+	BYTE* pDstData = calloc(step, height);
+	wStream* s = Stream_New(NULL, 1024);
+
+	if (!pDstData || !s)
+		goto fail;
+
+	if (!clear_compress_to_stream(encoder, s, pSrcData, PIXEL_FORMAT_BGRX32, step, width, height))
+		goto fail;
+
+	if (clear_decompress(decoder, Stream_Buffer(s), (UINT32)Stream_GetPosition(s), width, height,
+	                     pDstData, PIXEL_FORMAT_BGRX32, step, 0, 0, width, height, NULL) != 0)
+		goto fail;
+
+	for (size_t x = 0; x < 1ull * step * height; x++)
+	{
+		const int diff = abs((int)pDstData[x] - (int)pSrcData[x]);
+
+		/* The alpha channel is not transmitted, NSCodec is lossy */
+		if ((x % 4 != 3) && (diff > (lossless ? 0 : 32)))
+		{
+			(void)printf("clear roundtrip %" PRIu32 "x%" PRIu32 " mismatch at %" PRIuz "\n", width,
+			             height, x);
+			goto fail;
+		}
+	}
+
+	*pSize = Stream_GetPosition(s);
+	rc = TRUE;
+fail:
+	Stream_Free(s, TRUE);
+	free(pDstData);
+	return rc;
+}
+
+static void test_fill_text(BYTE* data, UINT32 width, UINT32 height, UINT32 seed)
+{
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			BYTE* pixel = &data[4ull * (1ull * y * width + x)];
+			/* White background with dark glyph like strokes repeating every 8 pixels */
+			const UINT32 column = (x + seed) % 8;
+			const UINT32 line = y % 16;
+			const BOOL ink = ((column == 2) || ((line == 5) && (column < 5))) && (line > 2) &&
+			                 (line < 13);
+			const BYTE v = ink ? (BYTE)(0x20 + (column % 3) * 0x20) : 0xFF;
+			pixel[0] = v;
+			pixel[1] = v;
+			pixel[2] = ink ? v : 0xF0;
+			pixel[3] = 0xFF;
+		}
+	}
+}
+
+static void test_fill_photo(BYTE* data, UINT32 width, UINT32 height)
+{
+	for (UINT32 y = 0; y < height; y++)
+	{
+		for (UINT32 x = 0; x < width; x++)
+		{
+			BYTE* pixel = &data[4ull * (1ull * y * width + x)];
+			/* Smooth gradients, far too many colors for RLEX */
+			pixel[0] = (BYTE)((x * 255) / width);
+			pixel[1] = (BYTE)((y * 255) / height);
+			pixel[2] = (BYTE)(((x + y) * 255) / (width + height));
+			pixel[3] = 0xFF;
+		}
+	}
+}
+
+static BOOL test_ClearCompress(void)
+{
+	BOOL rc = FALSE;
+	size_t size = 0;
+	size_t first = 0;
+	const UINT32 width = 300;
+	const UINT32 height = 130;
+	BYTE* data = calloc(4ull * width, height);
+	CLEAR_CONTEXT* encoder = clear_context_new(TRUE);
+	CLEAR_CONTEXT* decoder = clear_context_new(FALSE);
+
+	if (!data || !encoder || !decoder)
+		goto fail;
+
+	/* Text like content, first encoding fills the vBar caches, second one hits them */
+	test_fill_text(data, width, height, 0);
+	if (!test_ClearRoundtrip(encoder, decoder, data, width, height, TRUE, &first))
+		goto fail;
+
+	test_fill_text(data, width, height, 3);
+	if (!test_ClearRoundtrip(encoder, decoder, data, width, height, TRUE, &size))
+		goto fail;
+
+	(void)printf("clear text: %" PRIuz " bytes, shifted %" PRIuz " bytes, raw %" PRIu32 "\n",
+	             first, size, 3 * width * height);
+	if ((first >= 3ull * width * height) || (size >= first))
+		goto fail;
+
+	/* Flat content */
+	memset(data, 0x80, 4ull * width * height);
+	if (!test_ClearRoundtrip(encoder, decoder, data, width, height, TRUE, &size))
+		goto fail;
+
+	/* Photo like content goes through NSCodec */
+	test_fill_photo(data, width, height);
+	if (!test_ClearRoundtrip(encoder, decoder, data, width, height, FALSE, &size))
+		goto fail;
+
+	/* Glyphs: the second encoding of the same small bitmap is a glyph cache hit */
+	test_fill_text(data, 16, 20, 1);
+	if (!test_ClearRoundtrip(encoder, decoder, data, 16, 20, TRUE, &first))
+		goto fail;
+
+	if (!test_ClearRoundtrip(encoder, decoder, data, 16, 20, TRUE, &size))
+		goto fail;
+
+	if (size != 4)
+		goto fail;
+
+	rc = TRUE;
+fail:
+	clear_context_free(encoder);
+	clear_context_free(decoder);
+	free(data);
+	return rc;
+}
+
 int TestFreeRDPCodecClear(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -87,5 +223,8 @@ int TestFreeRDPCodecClear(int argc, char* argv[])
 	if (!test_ClearDecompressExample(4, 7, 15, TEST_CLEAR_EXAMPLE_4, sizeof(TEST_CLEAR_EXAMPLE_4)))
 		return -1;
 
+	if (!test_ClearCompress())
+		return -1;
+
 	return 0;
 }
@@ -1,6 +1,8 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 
+#include <freerdp/codec/bulk.h>
+
 #include "../ncrush.h"
 
 static const BYTE TEST_BELLS_DATA[] = "for.whom.the.bell.tolls,.the.bell.tolls.for.thee!";
@@ -107,6 +109,85 @@ fail:
 	return rc;
 }
 
+/* Simple LCG, the packets must be the same on every run */
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 16;
+}
+
+static BOOL test_NCrushRoundTrip(UINT32 effort)
+{
+	BOOL rc = FALSE;
+	UINT32 state = 23;
+	UINT64 totalIn = 0;
+	UINT64 totalOut = 0;
+	BYTE records[16 * 96] = { 0 };
+	BYTE packet[4096] = { 0 };
+	BYTE OutputBuffer[65536] = { 0 };
+	NCRUSH_CONTEXT* send = ncrush_context_new(TRUE);
+	NCRUSH_CONTEXT* recv = ncrush_context_new(FALSE);
+
+	if (!send || !recv)
+		goto fail;
+
+	ncrush_set_compression_effort(send, effort);
+
+	for (size_t x = 0; x < sizeof(records); x++)
+		records[x] = (BYTE)test_rand(&state);
+
+	/* enough packets to move the history window several times */
+	for (size_t x = 0; x < 64; x++)
+	{
+		UINT32 Flags = 0;
+		const BYTE* pDstData = NULL;
+		const BYTE* pPlainData = NULL;
+		UINT32 PlainSize = 0;
+		UINT32 DstSize = sizeof(OutputBuffer);
+		const UINT32 SrcSize = 64 + test_rand(&state) % (sizeof(packet) - 64);
+
+		for (size_t offset = 0; offset < SrcSize; offset += 96)
+		{
+			const BYTE* record = &records[(test_rand(&state) % 16) * 96];
+			memcpy(&packet[offset], record, MIN(96, SrcSize - offset));
+			packet[offset + test_rand(&state) % MIN(96, SrcSize - offset)] ^= 0x5A;
+		}
+
+		if (ncrush_compress(send, packet, SrcSize, OutputBuffer, &pDstData, &DstSize, &Flags) < 0)
+			goto fail;
+
+		totalIn += SrcSize;
+		totalOut += DstSize;
+
+		if (Flags & PACKET_COMPRESSED)
+		{
+			if (ncrush_decompress(recv, pDstData, DstSize, &pPlainData, &PlainSize, Flags) < 0)
+				goto fail;
+		}
+		else
+		{
+			/* the compressor flushed, so does the receiver */
+			ncrush_context_reset(recv, FALSE);
+			pPlainData = pDstData;
+			PlainSize = DstSize;
+		}
+
+		if ((PlainSize != SrcSize) || (memcmp(pPlainData, packet, SrcSize) != 0))
+		{
+			printf("NCrushRoundTrip[%" PRIu32 "]: packet %" PRIuz " mismatch\n", effort, x);
+			goto fail;
+		}
+	}
+
+	printf("NCrushRoundTrip[%" PRIu32 "]: %" PRIu64 " -> %" PRIu64 " bytes\n", effort, totalIn,
+	       totalOut);
+	rc = TRUE;
+fail:
+	ncrush_context_free(send);
+	ncrush_context_free(recv);
+	return rc;
+}
+
 int TestFreeRDPCodecNCrush(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -118,5 +199,10 @@ int TestFreeRDPCodecNCrush(int argc, char* argv[])
 	if (!test_NCrushDecompressBells())
 		return -1;
 
+	if (!test_NCrushRoundTrip(BULK_COMPRESSION_EFFORT_NORMAL) ||
+	    !test_NCrushRoundTrip(BULK_COMPRESSION_EFFORT_FAST) ||
+	    !test_NCrushRoundTrip(BULK_COMPRESSION_EFFORT_MAX))
+		return -1;
+
 	return 0;
 }
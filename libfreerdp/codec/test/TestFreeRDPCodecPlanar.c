@@ -5768,6 +5768,75 @@ fail:
 	return rc;
 }
 
+/* A batch spread over the thread pool must produce the same bitstreams as serial encoding */
+static BOOL TestPlanarBatch(void)
+{
+	BOOL rc = FALSE;
+	const UINT32 width = 64 * 5 + 12;
+	const UINT32 height = 64 * 3 + 20;
+	const UINT32 format = PIXEL_FORMAT_BGRX32;
+	const UINT32 scanline = width * FreeRDPGetBytesPerPixel(format);
+	RECTANGLE_16 rects[6 * 4] = { 0 };
+	BYTE* batchData[ARRAYSIZE(rects)] = { 0 };
+	UINT32 batchSizes[ARRAYSIZE(rects)] = { 0 };
+	size_t count = 0;
+	const DWORD flags = PLANAR_FORMAT_HEADER_RLE | PLANAR_FORMAT_HEADER_NA;
+	BITMAP_PLANAR_CONTEXT* serial = freerdp_bitmap_planar_context_new_ex(
+	    flags, 64, 64, THREADING_FLAGS_DISABLE_THREADS);
+	BITMAP_PLANAR_CONTEXT* threaded = freerdp_bitmap_planar_context_new_ex(flags, 64, 64, 0);
+	BYTE* image = calloc(scanline, height);
+
+	if (!serial || !threaded || !image)
+		goto fail;
+
+	/* random noise with some flat areas so RLE runs occur */
+	winpr_RAND(image, 1ull * scanline * height);
+	memset(image, 0x42, 1ull * scanline * 40);
+
+	for (UINT32 y = 0; y < height; y += 64)
+	{
+		for (UINT32 x = 0; x < width; x += 64)
+		{
+			RECTANGLE_16* rect = &rects[count++];
+			rect->left = (UINT16)x;
+			rect->top = (UINT16)y;
+			rect->right = (UINT16)MIN(width, x + 64);
+			rect->bottom = (UINT16)MIN(height, y + 64);
+		}
+	}
+
+	if (!freerdp_bitmap_compress_planar_batch(threaded, image, format, scanline, rects, count,
+	                                          batchData, batchSizes))
+		goto fail;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const RECTANGLE_16* rect = &rects[x];
+		UINT32 size = 0;
+		BYTE* data = freerdp_bitmap_compress_planar(
+		    serial, &image[1ull * rect->top * scanline + 4ull * rect->left], format,
+		    rect->right - rect->left, rect->bottom - rect->top, scanline, NULL, &size);
+		const BOOL equal =
+		    data && (size == batchSizes[x]) && (memcmp(data, batchData[x], size) == 0);
+		free(data);
+
+		if (!equal)
+		{
+			fprintf(stderr, "planar batch entry %" PRIuz " differs from serial encoding\n", x);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	for (size_t x = 0; x < ARRAYSIZE(batchData); x++)
+		free(batchData[x]);
+	free(image);
+	freerdp_bitmap_planar_context_free(serial);
+	freerdp_bitmap_planar_context_free(threaded);
+	return rc;
+}
+
 int TestFreeRDPCodecPlanar(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -5776,6 +5845,9 @@ int TestFreeRDPCodecPlanar(int argc, char* argv[])
 	if (!FuzzPlanar())
 		return -2;
 
+	if (!TestPlanarBatch())
+		return -3;
+
 	for (UINT32 x = 0; x < colorFormatCount; x++)
 	{
 		if (!TestPlanar(colorFormatList[x]))
@@ -1116,6 +1116,207 @@ fail:
 	return res;
 }
 
+static BOOL test_encode_decode_passes(const char* path, UINT32 passes)
+{
+	BOOL res = FALSE;
+	int rc = 0;
+	BYTE* resultData = NULL;
+	BYTE* dstData = NULL;
+	UINT32 dstSize = 0;
+	UINT32 firstSize = 0;
+	UINT32 frameId = 0;
+	UINT32 ColorFormat = PIXEL_FORMAT_BGRX32;
+	REGION16 invalidRegion = { 0 };
+	REGION16 emptyRegion = { 0 };
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, "progressive.bmp");
+	PROGRESSIVE_CONTEXT* progressiveEnc = progressive_context_new(TRUE);
+	PROGRESSIVE_CONTEXT* progressiveDec = progressive_context_new(FALSE);
+
+	region16_init(&invalidRegion);
+	region16_init(&emptyRegion);
+	if (!image || !name || !progressiveEnc || !progressiveDec)
+		goto fail;
+
+	if (!progressive_context_set_passes(progressiveEnc, passes))
+		goto fail;
+
+	rc = winpr_image_read(image, name);
+	if (rc <= 0)
+		goto fail;
+
+	resultData = calloc(image->scanline, image->height);
+	if (!resultData)
+		goto fail;
+
+	rc = progressive_create_surface_context(progressiveDec, 0, image->width, image->height);
+	if (rc <= 0)
+		goto fail;
+
+	// First pass at reduced quality
+	rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+	                          ColorFormat, image->width, image->height, image->scanline, NULL,
+	                          &dstData, &dstSize);
+	if (rc <= 0)
+		goto fail;
+	firstSize = dstSize;
+
+	rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+	                            image->scanline, 0, 0, &invalidRegion, 0, frameId++);
+	if (rc < 0)
+		goto fail;
+
+	// Upgrade passes, one per idle frame
+	for (UINT32 pass = 1; pass < passes; pass++)
+	{
+		if (progressive_context_get_pending_upgrades(progressiveEnc) == 0)
+			goto fail;
+
+		rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+		                          ColorFormat, image->width, image->height, image->scanline,
+		                          &emptyRegion, &dstData, &dstSize);
+		if (rc <= 0)
+			goto fail;
+
+		rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+		                            image->scanline, 0, 0, &invalidRegion, 0, frameId++);
+		if (rc < 0)
+			goto fail;
+	}
+
+	if (progressive_context_get_pending_upgrades(progressiveEnc) != 0)
+		goto fail;
+
+	rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+	                          ColorFormat, image->width, image->height, image->scanline,
+	                          &emptyRegion, &dstData, &dstSize);
+	if (rc != 0)
+		goto fail;
+
+	printf("%" PRIu32 " passes: first pass %" PRIu32 " bytes\n", passes, firstSize);
+
+	// Compare result
+	for (size_t y = 0; y < image->height; y++)
+	{
+		const BYTE* orig = &image->data[y * image->scanline];
+		const BYTE* dec = &resultData[y * image->scanline];
+		for (size_t x = 0; x < image->width; x++)
+		{
+			const BYTE* po = &orig[x * 4];
+			const BYTE* pd = &dec[x * 4];
+
+			const DWORD a = FreeRDPReadColor(po, ColorFormat);
+			const DWORD b = FreeRDPReadColor(pd, ColorFormat);
+			if (!colordiff(ColorFormat, a, b))
+			{
+				printf("xxxxxxx [%u:%u] [%s] %08X != %08X\n", x, y,
+				       FreeRDPGetColorFormatName(ColorFormat), a, b);
+				goto fail;
+			}
+		}
+	}
+	res = TRUE;
+fail:
+	region16_uninit(&invalidRegion);
+	region16_uninit(&emptyRegion);
+	progressive_context_free(progressiveEnc);
+	progressive_context_free(progressiveDec);
+	winpr_image_free(image, TRUE);
+	free(resultData);
+	free(name);
+	return res;
+}
+
+static BOOL test_encode_unchanged_tiles(const char* path)
+{
+	BOOL res = FALSE;
+	int rc = 0;
+	BYTE* resultData = NULL;
+	BYTE* dstData = NULL;
+	UINT32 dstSize = 0;
+	UINT32 fullSize = 0;
+	UINT32 ColorFormat = PIXEL_FORMAT_BGRX32;
+	REGION16 invalidRegion = { 0 };
+	wImage* image = winpr_image_new();
+	char* name = GetCombinedPath(path, "progressive.bmp");
+	PROGRESSIVE_CONTEXT* progressiveEnc = progressive_context_new(TRUE);
+	PROGRESSIVE_CONTEXT* progressiveDec = progressive_context_new(FALSE);
+
+	region16_init(&invalidRegion);
+	if (!image || !name || !progressiveEnc || !progressiveDec)
+		goto fail;
+
+	rc = winpr_image_read(image, name);
+	if ((rc <= 0) || (image->width < 128) || (image->height < 128))
+		goto fail;
+
+	resultData = calloc(image->scanline, image->height);
+	if (!resultData)
+		goto fail;
+
+	rc = progressive_create_surface_context(progressiveDec, 0, image->width, image->height);
+	if (rc <= 0)
+		goto fail;
+
+	for (UINT32 frame = 0; frame < 3; frame++)
+	{
+		if (frame == 2)
+		{
+			// Change a few pixels of a single tile
+			for (size_t y = 70; y < 80; y++)
+				memset(&image->data[y * image->scanline + 70 * 4], 0x40, 10 * 4);
+		}
+
+		rc = progressive_compress(progressiveEnc, image->data, image->scanline * image->height,
+		                          ColorFormat, image->width, image->height, image->scanline, NULL,
+		                          &dstData, &dstSize);
+		if (rc < 0)
+			goto fail;
+
+		// Nothing changed, so nothing must be sent
+		if ((frame == 1) != (rc == 0))
+			goto fail;
+		if (rc == 0)
+			continue;
+
+		if (frame == 0)
+			fullSize = dstSize;
+		else if (dstSize * 100 > fullSize)
+			goto fail;
+
+		rc = progressive_decompress(progressiveDec, dstData, dstSize, resultData, ColorFormat,
+		                            image->scanline, 0, 0, &invalidRegion, 0, frame);
+		if (rc < 0)
+			goto fail;
+	}
+
+	for (size_t y = 0; y < image->height; y++)
+	{
+		const BYTE* orig = &image->data[y * image->scanline];
+		const BYTE* dec = &resultData[y * image->scanline];
+		for (size_t x = 0; x < image->width; x++)
+		{
+			const DWORD a = FreeRDPReadColor(&orig[x * 4], ColorFormat);
+			const DWORD b = FreeRDPReadColor(&dec[x * 4], ColorFormat);
+			if (!colordiff(ColorFormat, a, b))
+			{
+				printf("xxxxxxx [%u:%u] [%s] %08X != %08X\n", x, y,
+				       FreeRDPGetColorFormatName(ColorFormat), a, b);
+				goto fail;
+			}
+		}
+	}
+	res = TRUE;
+fail:
+	region16_uninit(&invalidRegion);
+	progressive_context_free(progressiveEnc);
+	progressive_context_free(progressiveDec);
+	winpr_image_free(image, TRUE);
+	free(resultData);
+	free(name);
+	return res;
+}
+
 static BOOL read_cmd(FILE* fp, RDPGFX_SURFACE_COMMAND* cmd, UINT32* frameId)
 {
 	WINPR_ASSERT(fp);
@@ -1498,6 +1699,13 @@ int TestFreeRDPCodecProgressive(int argc, char* argv[])
 		    */
 		if (!test_encode_decode(ms_sample_path))
 			goto fail;
+		if (!test_encode_unchanged_tiles(ms_sample_path))
+			goto fail;
+		for (UINT32 passes = 2; passes <= 4; passes++)
+		{
+			if (!test_encode_decode_passes(ms_sample_path, passes))
+				goto fail;
+		}
 		rc = 0;
 	}
 
@@ -0,0 +1,110 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+
+#include <freerdp/codec/rfx.h>
+
+#include "../rfx_types.h"
+#include "../rfx_dwt.h"
+#include "../rfx_quantization.h"
+#include "../sse/rfx_avx2.h"
+
+#define TEST_RUNS 32
+#define TEST_TILE_SIZE 4096
+
+static BOOL test_compare(const char* what, size_t run, const INT16* generic, const INT16* optimized)
+{
+	for (size_t x = 0; x < TEST_TILE_SIZE; x++)
+	{
+		if (generic[x] != optimized[x])
+		{
+			printf("%s run %" PRIuz ": coefficient %" PRIuz " is %" PRId16 ", expected %" PRId16
+			       "\n",
+			       what, run, x, optimized[x], generic[x]);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static void test_fill(INT16* tile, UINT32* quants)
+{
+	UINT16 raw[TEST_TILE_SIZE] = { 0 };
+	BYTE factors[10] = { 0 };
+
+	/* The encoder input is 11.5 fixed point YCbCr, the quantization factors are 6 to 15 */
+	winpr_RAND_pseudo(raw, sizeof(raw));
+	for (size_t x = 0; x < TEST_TILE_SIZE; x++)
+		tile[x] = (INT16)((raw[x] & 0x1FFF) - 4096);
+
+	winpr_RAND_pseudo(factors, sizeof(factors));
+	for (size_t x = 0; x < ARRAYSIZE(factors); x++)
+		quants[x] = 6 + factors[x] % 10;
+}
+
+/* Runs a tile through encode and decode with the generic and the AVX2 kernels and checks every
+ * intermediate step for bit-exactness. */
+int TestFreeRDPCodecRemoteFXAvx2(int argc, char* argv[])
+{
+	int rc = -1;
+	UINT32 quants[10] = { 0 };
+	INT16* generic = winpr_aligned_calloc(TEST_TILE_SIZE, sizeof(INT16), 32);
+	INT16* optimized = winpr_aligned_calloc(TEST_TILE_SIZE, sizeof(INT16), 32);
+	INT16* dwt = winpr_aligned_calloc(TEST_TILE_SIZE, sizeof(INT16), 32);
+	RFX_CONTEXT* context = rfx_context_new(FALSE);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!generic || !optimized || !dwt || !context)
+		goto fail;
+
+	context->quantization_decode = rfx_quantization_decode;
+	context->quantization_encode = rfx_quantization_encode;
+	context->dwt_2d_decode = rfx_dwt_2d_decode;
+	context->dwt_2d_encode = rfx_dwt_2d_encode;
+	rfx_init_avx2(context);
+
+	if (context->dwt_2d_decode == rfx_dwt_2d_decode)
+	{
+		printf("AVX2 RemoteFX kernels not available, skipping\n");
+		rc = 0;
+		goto fail;
+	}
+
+	for (size_t run = 0; run < TEST_RUNS; run++)
+	{
+		test_fill(generic, quants);
+		memcpy(optimized, generic, TEST_TILE_SIZE * sizeof(INT16));
+
+		rfx_dwt_2d_encode(generic, dwt);
+		context->dwt_2d_encode(optimized, dwt);
+		if (!test_compare("dwt_2d_encode", run, generic, optimized))
+			goto fail;
+
+		rfx_quantization_encode(generic, quants);
+		context->quantization_encode(optimized, quants);
+		if (!test_compare("quantization_encode", run, generic, optimized))
+			goto fail;
+
+		rfx_quantization_decode(generic, quants);
+		context->quantization_decode(optimized, quants);
+		if (!test_compare("quantization_decode", run, generic, optimized))
+			goto fail;
+
+		rfx_dwt_2d_decode(generic, dwt);
+		context->dwt_2d_decode(optimized, dwt);
+		if (!test_compare("dwt_2d_decode", run, generic, optimized))
+			goto fail;
+	}
+
+	rc = 0;
+fail:
+	rfx_context_free(context);
+	winpr_aligned_free(generic);
+	winpr_aligned_free(optimized);
+	winpr_aligned_free(dwt);
+	return rc;
+}
@@ -1,5 +1,8 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/codec/bulk.h>
 
 #include "../xcrush.h"
 
@@ -93,6 +96,97 @@ static BOOL test_run(const char* fkt, const void* src, UINT32 src_size, const vo
 	return rc;
 }
 
+/* Simple LCG, the benchmark input must be the same on every run */
+static UINT32 test_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 16;
+}
+
+/* Packets assembled from a small set of records with a few altered bytes each, resembling
+ * repeated drawing orders. */
+static void test_fill_packet(BYTE* packet, size_t size, const BYTE* records, size_t count,
+                             size_t recordSize, UINT32* state)
+{
+	for (size_t offset = 0; offset < size; offset += recordSize)
+	{
+		const size_t len = MIN(recordSize, size - offset);
+		const BYTE* record = &records[(test_rand(state) % count) * recordSize];
+		memcpy(&packet[offset], record, len);
+		packet[offset + test_rand(state) % len] = (BYTE)test_rand(state);
+	}
+}
+
+static BOOL test_throughput(void)
+{
+	BOOL rc = FALSE;
+	UINT32 state = 42;
+	BYTE records[32 * 200] = { 0 };
+	BYTE packet[8192] = { 0 };
+	BYTE OutputBuffer[16384] = { 0 };
+	UINT64 totalIn = 0;
+	UINT64 totalOut = 0;
+	UINT64 duration = 0;
+	XCRUSH_CONTEXT* send = xcrush_context_new(TRUE);
+	XCRUSH_CONTEXT* recv = xcrush_context_new(FALSE);
+
+	if (!send || !recv)
+		goto fail;
+
+	for (size_t x = 0; x < sizeof(records); x++)
+		records[x] = (BYTE)test_rand(&state);
+
+	for (size_t x = 0; x < 512; x++)
+	{
+		UINT32 Flags = 0;
+		const BYTE* pDstData = NULL;
+		UINT32 DstSize = sizeof(OutputBuffer);
+
+		test_fill_packet(packet, sizeof(packet), records, 32, 200, &state);
+
+		const UINT64 start = winpr_GetTickCount64NS();
+		const int status = xcrush_compress(send, packet, sizeof(packet), OutputBuffer, &pDstData,
+		                                   &DstSize, &Flags);
+		duration += winpr_GetTickCount64NS() - start;
+
+		if (status < 0)
+		{
+			printf("[XCrushThroughput] compress failed with %d\n", status);
+			goto fail;
+		}
+
+		totalIn += sizeof(packet);
+		totalOut += DstSize;
+
+		/* every packet must decompress to the original data */
+		if (Flags & (PACKET_COMPRESSED | PACKET_FLUSHED))
+		{
+			const BYTE* pPlainData = NULL;
+			UINT32 PlainSize = 0;
+
+			if (xcrush_decompress(recv, pDstData, DstSize, &pPlainData, &PlainSize, Flags) < 0)
+			{
+				printf("[XCrushThroughput] decompress failed for packet %" PRIuz "\n", x);
+				goto fail;
+			}
+
+			if (!test_compare("XCrushThroughput", pPlainData, PlainSize, packet, sizeof(packet)))
+				goto fail;
+		}
+	}
+
+	printf("[XCrushThroughput] %" PRIu64 " -> %" PRIu64 " bytes (%.1f%%) in %" PRIu64
+	       " ms, %.1f MiB/s\n",
+	       totalIn, totalOut, 100.0 * (double)totalOut / (double)totalIn, duration / 1000000ull,
+	       (duration > 0) ? (double)totalIn * 1000000000.0 / (double)duration / 1048576.0 : 0.0);
+
+	rc = totalOut < totalIn;
+fail:
+	xcrush_context_free(send);
+	xcrush_context_free(recv);
+	return rc;
+}
+
 struct test_argument
 {
 	const char* name;
@@ -126,5 +220,8 @@ int TestFreeRDPCodecXCrush(int argc, char* argv[])
 			rc = -1;
 	}
 
+	if (!test_throughput())
+		rc = -1;
+
 	return rc;
 }
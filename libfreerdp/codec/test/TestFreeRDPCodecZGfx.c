@@ -253,6 +253,115 @@ fail:
 	return rc;
 }
 
+static BOOL test_ZGfxRoundtrip(ZGFX_CONTEXT* compressor, ZGFX_CONTEXT* decompressor,
+                               const BYTE* pSrcData, UINT32 SrcSize, UINT32* pCompressedSize)
+{
+	BOOL rc = FALSE;
+	UINT32 Flags = 0;
+	BYTE* pCompressed = NULL;
+	UINT32 CompressedSize = 0;
+	BYTE* pDstData = NULL;
+	UINT32 DstSize = 0;
+
+	if (zgfx_compress(compressor, pSrcData, SrcSize, &pCompressed, &CompressedSize, &Flags) < 0)
+		goto fail;
+
+	if (zgfx_decompress(decompressor, pCompressed, CompressedSize, &pDstData, &DstSize, Flags) < 0)
+		goto fail;
+
+	if ((DstSize != SrcSize) || (memcmp(pDstData, pSrcData, SrcSize) != 0))
+	{
+		printf("test_ZGfxRoundtrip: output mismatch, size %" PRIu32 ", expected %" PRIu32 "\n",
+		       DstSize, SrcSize);
+		goto fail;
+	}
+
+	*pCompressedSize = CompressedSize;
+	rc = TRUE;
+fail:
+	free(pCompressed);
+	free(pDstData);
+	return rc;
+}
+
+static int test_ZGfxCompressLevels(void)
+{
+	int rc = -1;
+	const UINT32 SrcSize = 200000;
+	BYTE* pSrcData = calloc(SrcSize, sizeof(BYTE));
+
+	if (!pSrcData)
+		return -1;
+
+	/* Mix of repeated text, pixel like runs and noise */
+	for (UINT32 x = 0; x < SrcSize; x++)
+	{
+		if ((x / 4096) % 3 == 0)
+			pSrcData[x] = TEST_FOX_DATA[x % (sizeof(TEST_FOX_DATA) - 1)];
+		else if ((x / 4096) % 3 == 1)
+			pSrcData[x] = (BYTE)((x % 4 == 3) ? 0xFF : (x / 64));
+		else
+			pSrcData[x] = (BYTE)((x * 2654435761u) >> 24);
+	}
+
+	for (DWORD level = 0; level <= 9; level++)
+	{
+		UINT32 total = 0;
+		ZGFX_CONTEXT* compressor = zgfx_context_new(TRUE);
+		ZGFX_CONTEXT* decompressor = zgfx_context_new(FALSE);
+
+		if (!compressor || !decompressor)
+		{
+			zgfx_context_free(compressor);
+			zgfx_context_free(decompressor);
+			goto fail;
+		}
+
+		zgfx_context_set_compression_level(compressor, level);
+
+		/* Several PDUs, later ones may reference the history of earlier ones */
+		for (UINT32 pass = 0; pass < 3; pass++)
+		{
+			UINT32 CompressedSize = 0;
+			const UINT32 offset = pass * 1000;
+
+			/* Start the last PDU from an empty history on both sides */
+			if (pass == 2)
+			{
+				zgfx_context_reset(compressor, FALSE);
+				zgfx_context_reset(decompressor, FALSE);
+			}
+
+			if (!test_ZGfxRoundtrip(compressor, decompressor, &pSrcData[offset],
+			                        SrcSize - offset, &CompressedSize))
+			{
+				printf("test_ZGfxCompressLevels: level %" PRIu32 " pass %" PRIu32 " failed\n",
+				       level, pass);
+				zgfx_context_free(compressor);
+				zgfx_context_free(decompressor);
+				goto fail;
+			}
+
+			total += CompressedSize;
+		}
+
+		zgfx_context_free(compressor);
+		zgfx_context_free(decompressor);
+		printf("Compress level %" PRIu32 ": %" PRIu32 " bytes\n", level, total);
+
+		if ((level > 0) && (total >= SrcSize))
+		{
+			printf("test_ZGfxCompressLevels: level %" PRIu32 " did not compress\n", level);
+			goto fail;
+		}
+	}
+
+	rc = 0;
+fail:
+	free(pSrcData);
+	return rc;
+}
+
 int TestFreeRDPCodecZGfx(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -270,5 +379,8 @@ int TestFreeRDPCodecZGfx(int argc, char* argv[])
 	if (test_ZGfxCompressConsistent() < 0)
 		return -1;
 
+	if (test_ZGfxCompressLevels() < 0)
+		return -1;
+
 	return 0;
 }
@@ -815,6 +815,44 @@ out:
 	return retCode;
 }
 
+static int test_union_rects(void)
+{
+	REGION16 region;
+	int retCode = -1;
+	const RECTANGLE_16* rects = NULL;
+	UINT32 nbRects = 0;
+	/* a 2x2 block of tiles, a duplicate, an empty and a detached tile */
+	const RECTANGLE_16 tiles[] = { { 16, 16, 32, 32 }, { 0, 0, 16, 16 },   { 16, 0, 32, 16 },
+		                           { 0, 16, 16, 32 },  { 0, 0, 16, 16 },   { 40, 40, 40, 48 },
+		                           { 64, 0, 80, 16 } };
+	const RECTANGLE_16 extra = { 8, 32, 24, 40 };
+	const RECTANGLE_16 expected[] = {
+		{ 0, 0, 32, 16 }, { 64, 0, 80, 16 }, { 0, 16, 32, 32 }, { 8, 32, 24, 40 }
+	};
+	const RECTANGLE_16 expected_extents = { 0, 0, 80, 40 };
+	region16_init(&region);
+
+	if (!region16_union_rect(&region, &region, &extra))
+		goto out;
+
+	if (!region16_union_rects(&region, &region, tiles, ARRAYSIZE(tiles)))
+		goto out;
+
+	rects = region16_rects(&region, &nbRects);
+
+	if (!rects || (nbRects != ARRAYSIZE(expected)) ||
+	    !compareRectangles(rects, expected, ARRAYSIZE(expected)))
+		goto out;
+
+	if (!compareRectangles(region16_extents(&region), &expected_extents, 1))
+		goto out;
+
+	retCode = 0;
+out:
+	region16_uninit(&region);
+	return retCode;
+}
+
 typedef int (*TestFunction)(void);
 struct UnitaryTest
 {
@@ -836,6 +874,7 @@ static struct UnitaryTest tests[] = { { "Basic trivial tests", test_basic },
 	                                  { "norbert's case", test_norbert_case },
 	                                  { "norbert's case 2", test_norbert2_case },
 	                                  { "empty rectangle case", test_empty_rectangle },
+	                                  { "bulk union of tiles", test_union_rects },
 
 	                                  { NULL, NULL } };
 
@@ -0,0 +1,1373 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Codec throughput benchmark
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Replays a sequence of frames through every encoder and its decoder and reports
+ * throughput, latency, compression ratio and PSNR.
+ *
+ * The frames are either images given with --input (a desktop recording exported
+ * frame by frame, in order) or a synthetic desktop with moving windows, text and a
+ * photo area. Build with BUILD_TESTING, the bulk compressors are library internals. */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <winpr/crt.h>
+#include <winpr/image.h>
+#include <winpr/stream.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/codec/clear.h>
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/h264.h>
+#include <freerdp/codec/interleaved.h>
+#include <freerdp/codec/nsc.h>
+#include <freerdp/codec/planar.h>
+#include <freerdp/codec/progressive.h>
+#include <freerdp/codec/region.h>
+#include <freerdp/codec/rfx.h>
+#include <freerdp/codec/zgfx.h>
+
+#include "../bulk.h"
+#include "../mppc.h"
+#include "../ncrush.h"
+#include "../xcrush.h"
+
+#define BENCH_FORMAT PIXEL_FORMAT_BGRX32
+#define BENCH_TILE 64
+/* the bulk compressors only see fast-path PDUs below this size */
+#define BENCH_BULK_CHUNK 16000
+#define BENCH_BULK_BUFFER 65536
+#define BENCH_MAX_INPUTS 1024
+/* PSNR reported for lossless results */
+#define BENCH_PSNR_LOSSLESS 100.0
+
+typedef enum
+{
+	BENCH_OUTPUT_TEXT,
+	BENCH_OUTPUT_CSV,
+	BENCH_OUTPUT_JSON
+} BenchOutput;
+
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 stride;
+	size_t count;
+	BYTE** data;
+} BenchFrames;
+
+typedef struct
+{
+	const char* codecs;
+	const char* inputs[BENCH_MAX_INPUTS];
+	size_t numInputs;
+	UINT32 width;
+	UINT32 height;
+	UINT32 frames;
+	UINT32 iterations;
+	BOOL serial;
+	BOOL pool;
+	BenchOutput output;
+} BenchConfig;
+
+typedef struct
+{
+	UINT64 encodeNs;
+	UINT64 decodeNs;
+	UINT64 rawBytes;
+	UINT64 encodedBytes;
+	UINT64 frames;
+	double sse;
+	UINT64 samples;
+} BenchResult;
+
+typedef BOOL (*bench_fkt)(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                          BenchResult* result);
+
+typedef struct
+{
+	const char* name;
+	BOOL threaded;
+	bench_fkt fkt;
+} BenchCodec;
+
+static UINT32 bench_rand(UINT32* state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return *state >> 8;
+}
+
+/* ------------------------------------------------------------------------- */
+static void bench_account(BenchResult* result, const BenchFrames* frames, const BYTE* frame,
+                          const BYTE* decoded, UINT32 x, UINT32 y, UINT32 width, UINT32 height)
+{
+	for (UINT32 j = y; j < y + height; j++)
+	{
+		const BYTE* src = &frame[1ULL * j * frames->stride + 4ULL * x];
+		const BYTE* dst = &decoded[1ULL * j * frames->stride + 4ULL * x];
+
+		for (UINT32 i = 0; i < width; i++)
+		{
+			for (size_t c = 0; c < 3; c++)
+			{
+				const double d = (double)src[4 * i + c] - (double)dst[4 * i + c];
+				result->sse += d * d;
+			}
+		}
+	}
+
+	result->samples += 3ULL * width * height;
+	result->rawBytes += 4ULL * width * height;
+}
+
+static double bench_psnr(const BenchResult* result)
+{
+	if ((result->samples == 0) || (result->sse <= 0.0))
+		return BENCH_PSNR_LOSSLESS;
+
+	const double mse = result->sse / (double)result->samples;
+	return MIN(BENCH_PSNR_LOSSLESS, 10.0 * log10(255.0 * 255.0 / mse));
+}
+
+static BYTE* bench_alloc_frame(const BenchFrames* frames)
+{
+	return winpr_aligned_calloc(frames->height, frames->stride, 32);
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_rfx(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                      BenchResult* result)
+{
+	BOOL rc = FALSE;
+	REGION16 region = { 0 };
+	RFX_CONTEXT* enc = rfx_context_new_ex(TRUE, threadingFlags);
+	RFX_CONTEXT* dec = rfx_context_new(FALSE);
+	wStream* s = Stream_New(NULL, 1024);
+	BYTE* out = bench_alloc_frame(frames);
+
+	region16_init(&region);
+
+	if (!enc || !dec || !s || !out)
+		goto fail;
+
+	rfx_context_set_mode(enc, RLGR3);
+	rfx_context_set_pixel_format(enc, BENCH_FORMAT);
+	rfx_context_set_pixel_format(dec, BENCH_FORMAT);
+
+	if (!rfx_context_reset(enc, frames->width, frames->height))
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			const RFX_RECT rect = { 0, 0, (UINT16)frames->width, (UINT16)frames->height };
+
+			Stream_SetPosition(s, 0);
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			if (!rfx_compose_message(enc, s, &rect, 1, frames->data[x], frames->width,
+			                         frames->height, frames->stride))
+				goto fail;
+			const UINT64 t1 = winpr_GetTickCount64NS();
+			region16_clear(&region);
+			if (!rfx_process_message(dec, Stream_Buffer(s), (UINT32)Stream_GetPosition(s), 0, 0,
+			                         out, BENCH_FORMAT, frames->stride, frames->height, &region))
+				goto fail;
+			const UINT64 t2 = winpr_GetTickCount64NS();
+
+			result->encodeNs += t1 - t0;
+			result->decodeNs += t2 - t1;
+			result->encodedBytes += Stream_GetPosition(s);
+			result->frames++;
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	Stream_Free(s, TRUE);
+	region16_uninit(&region);
+	rfx_context_free(dec);
+	rfx_context_free(enc);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_progressive(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                              BenchResult* result)
+{
+	BOOL rc = FALSE;
+	UINT32 frameId = 0;
+	REGION16 region = { 0 };
+	PROGRESSIVE_CONTEXT* enc = progressive_context_new_ex(TRUE, threadingFlags);
+	PROGRESSIVE_CONTEXT* dec = progressive_context_new(FALSE);
+	BYTE* out = bench_alloc_frame(frames);
+
+	region16_init(&region);
+
+	if (!enc || !dec || !out)
+		goto fail;
+
+	if (progressive_create_surface_context(dec, 0, frames->width, frames->height) <= 0)
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			BYTE* data = NULL;
+			UINT32 size = 0;
+
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			const int status = progressive_compress(
+			    enc, frames->data[x], frames->stride * frames->height, BENCH_FORMAT,
+			    frames->width, frames->height, frames->stride, NULL, &data, &size);
+			const UINT64 t1 = winpr_GetTickCount64NS();
+
+			if (status < 0)
+				goto fail;
+
+			result->encodeNs += t1 - t0;
+			result->frames++;
+
+			/* nothing changed, the client keeps showing the previous frame */
+			if (status > 0)
+			{
+				region16_clear(&region);
+				if (progressive_decompress(dec, data, size, out, BENCH_FORMAT, frames->stride, 0,
+				                           0, &region, 0, frameId++) < 0)
+					goto fail;
+				result->decodeNs += winpr_GetTickCount64NS() - t1;
+				result->encodedBytes += size;
+			}
+
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	region16_uninit(&region);
+	progressive_context_free(dec);
+	progressive_context_free(enc);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static size_t bench_tiles(const BenchFrames* frames, RECTANGLE_16** prects)
+{
+	const size_t cols = (frames->width + BENCH_TILE - 1) / BENCH_TILE;
+	const size_t rows = (frames->height + BENCH_TILE - 1) / BENCH_TILE;
+	RECTANGLE_16* rects = calloc(cols * rows, sizeof(RECTANGLE_16));
+	size_t count = 0;
+
+	*prects = rects;
+	if (!rects)
+		return 0;
+
+	for (size_t y = 0; y < rows; y++)
+	{
+		for (size_t x = 0; x < cols; x++)
+		{
+			RECTANGLE_16* rect = &rects[count++];
+			rect->left = (UINT16)(x * BENCH_TILE);
+			rect->top = (UINT16)(y * BENCH_TILE);
+			rect->right = (UINT16)MIN((x + 1) * BENCH_TILE, frames->width);
+			rect->bottom = (UINT16)MIN((y + 1) * BENCH_TILE, frames->height);
+		}
+	}
+
+	return count;
+}
+
+static BOOL bench_planar(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                         BenchResult* result)
+{
+	BOOL rc = FALSE;
+	RECTANGLE_16* rects = NULL;
+	const size_t count = bench_tiles(frames, &rects);
+	BITMAP_PLANAR_CONTEXT* enc = freerdp_bitmap_planar_context_new_ex(
+	    PLANAR_FORMAT_HEADER_RLE | PLANAR_FORMAT_HEADER_NA, BENCH_TILE, BENCH_TILE, threadingFlags);
+	BITMAP_PLANAR_CONTEXT* dec = freerdp_bitmap_planar_context_new(0, BENCH_TILE, BENCH_TILE);
+	BYTE** dst = calloc(count, sizeof(BYTE*));
+	UINT32* sizes = calloc(count, sizeof(UINT32));
+	BYTE* out = bench_alloc_frame(frames);
+
+	if (!rects || !enc || !dec || !dst || !sizes || !out)
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			if (!freerdp_bitmap_compress_planar_batch(enc, frames->data[x], BENCH_FORMAT,
+			                                          frames->stride, rects, count, dst, sizes))
+				goto fail;
+			const UINT64 t1 = winpr_GetTickCount64NS();
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const RECTANGLE_16* r = &rects[i];
+				if (!planar_decompress(dec, dst[i], sizes[i], r->right - r->left,
+				                       r->bottom - r->top, out, BENCH_FORMAT, frames->stride,
+				                       r->left, r->top, r->right - r->left, r->bottom - r->top,
+				                       FALSE))
+					goto fail;
+			}
+			const UINT64 t2 = winpr_GetTickCount64NS();
+
+			result->encodeNs += t1 - t0;
+			result->decodeNs += t2 - t1;
+			result->frames++;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				result->encodedBytes += sizes[i];
+				free(dst[i]);
+				dst[i] = NULL;
+			}
+
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	for (size_t i = 0; dst && (i < count); i++)
+		free(dst[i]);
+	winpr_aligned_free(out);
+	free(sizes);
+	free((void*)dst);
+	freerdp_bitmap_planar_context_free(dec);
+	freerdp_bitmap_planar_context_free(enc);
+	free(rects);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_interleaved(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                              BenchResult* result)
+{
+	BOOL rc = FALSE;
+	RECTANGLE_16* rects = NULL;
+	const size_t count = bench_tiles(frames, &rects);
+	BITMAP_INTERLEAVED_CONTEXT* enc = bitmap_interleaved_context_new(TRUE);
+	BITMAP_INTERLEAVED_CONTEXT* dec = bitmap_interleaved_context_new(FALSE);
+	BYTE* buffer = calloc(BENCH_TILE * BENCH_TILE, 4);
+	BYTE* out = bench_alloc_frame(frames);
+
+	WINPR_UNUSED(threadingFlags);
+
+	if (!rects || !enc || !dec || !buffer || !out)
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const RECTANGLE_16* r = &rects[i];
+				/* the encoder requires a width that is a multiple of 4 */
+				const UINT32 width = (r->right - r->left) & ~3u;
+				const UINT32 height = r->bottom - r->top;
+				UINT32 size = BENCH_TILE * BENCH_TILE * 4;
+
+				if (width == 0)
+					continue;
+
+				const UINT64 t0 = winpr_GetTickCount64NS();
+				if (!interleaved_compress(enc, buffer, &size, width, height, frames->data[x],
+				                          BENCH_FORMAT, frames->stride, r->left, r->top, NULL,
+				                          24))
+					goto fail;
+				const UINT64 t1 = winpr_GetTickCount64NS();
+				if (!interleaved_decompress(dec, buffer, size, width, height, 24, out,
+				                            BENCH_FORMAT, frames->stride, r->left, r->top, width,
+				                            height, NULL))
+					goto fail;
+				const UINT64 t2 = winpr_GetTickCount64NS();
+
+				result->encodeNs += t1 - t0;
+				result->decodeNs += t2 - t1;
+				result->encodedBytes += size;
+				bench_account(result, frames, frames->data[x], out, r->left, r->top, width,
+				              height);
+			}
+
+			result->frames++;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	free(buffer);
+	bitmap_interleaved_context_free(dec);
+	bitmap_interleaved_context_free(enc);
+	free(rects);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_nsc(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                      BenchResult* result)
+{
+	BOOL rc = FALSE;
+	NSC_CONTEXT* enc = nsc_context_new();
+	NSC_CONTEXT* dec = nsc_context_new();
+	wStream* s = Stream_New(NULL, 1024);
+	BYTE* out = bench_alloc_frame(frames);
+
+	WINPR_UNUSED(threadingFlags);
+
+	if (!enc || !dec || !s || !out)
+		goto fail;
+
+	if (!nsc_context_set_parameters(enc, NSC_COLOR_FORMAT, BENCH_FORMAT) ||
+	    !nsc_context_set_parameters(enc, NSC_COLOR_LOSS_LEVEL, 3) ||
+	    !nsc_context_set_parameters(enc, NSC_ALLOW_SUBSAMPLING, TRUE))
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			Stream_SetPosition(s, 0);
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			if (!nsc_compose_message(enc, s, frames->data[x], frames->width, frames->height,
+			                         frames->stride))
+				goto fail;
+			const UINT64 t1 = winpr_GetTickCount64NS();
+			if (!nsc_process_message(dec, 32, frames->width, frames->height, Stream_Buffer(s),
+			                         (UINT32)Stream_GetPosition(s), out, BENCH_FORMAT,
+			                         frames->stride, 0, 0, frames->width, frames->height,
+			                         FREERDP_FLIP_NONE))
+				goto fail;
+			const UINT64 t2 = winpr_GetTickCount64NS();
+
+			result->encodeNs += t1 - t0;
+			result->decodeNs += t2 - t1;
+			result->encodedBytes += Stream_GetPosition(s);
+			result->frames++;
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	Stream_Free(s, TRUE);
+	nsc_context_free(dec);
+	nsc_context_free(enc);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_clear(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                        BenchResult* result)
+{
+	BOOL rc = FALSE;
+	RECTANGLE_16* rects = NULL;
+	const size_t count = bench_tiles(frames, &rects);
+	CLEAR_CONTEXT* enc = clear_context_new(TRUE);
+	CLEAR_CONTEXT* dec = clear_context_new(FALSE);
+	wStream* s = Stream_New(NULL, 1024);
+	BYTE* out = bench_alloc_frame(frames);
+
+	WINPR_UNUSED(threadingFlags);
+
+	if (!rects || !enc || !dec || !s || !out)
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const RECTANGLE_16* r = &rects[i];
+				const UINT32 width = r->right - r->left;
+				const UINT32 height = r->bottom - r->top;
+				const BYTE* src =
+				    &frames->data[x][1ULL * r->top * frames->stride + 4ULL * r->left];
+
+				Stream_SetPosition(s, 0);
+				const UINT64 t0 = winpr_GetTickCount64NS();
+				if (!clear_compress_to_stream(enc, s, src, BENCH_FORMAT, frames->stride, width,
+				                              height))
+					goto fail;
+				const UINT64 t1 = winpr_GetTickCount64NS();
+				if (clear_decompress(dec, Stream_Buffer(s), (UINT32)Stream_GetPosition(s), width,
+				                     height, out, BENCH_FORMAT, frames->stride, r->left, r->top,
+				                     frames->width, frames->height, NULL) < 0)
+					goto fail;
+				const UINT64 t2 = winpr_GetTickCount64NS();
+
+				result->encodeNs += t1 - t0;
+				result->decodeNs += t2 - t1;
+				result->encodedBytes += Stream_GetPosition(s);
+			}
+
+			result->frames++;
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	Stream_Free(s, TRUE);
+	clear_context_free(dec);
+	clear_context_free(enc);
+	free(rects);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static H264_CONTEXT* bench_h264_new(BOOL compressor, const BenchFrames* frames)
+{
+	H264_CONTEXT* h264 = h264_context_new(compressor);
+
+	if (!h264)
+		return NULL;
+
+	if (!h264_context_reset(h264, frames->width, frames->height))
+		goto fail;
+
+	if (compressor)
+	{
+		/* the shadow server defaults */
+		if (!h264_context_set_option(h264, H264_CONTEXT_OPTION_RATECONTROL,
+		                             H264_RATECONTROL_VBR) ||
+		    !h264_context_set_option(h264, H264_CONTEXT_OPTION_BITRATE, 10000000) ||
+		    !h264_context_set_option(h264, H264_CONTEXT_OPTION_FRAMERATE, 30) ||
+		    !h264_context_set_option(h264, H264_CONTEXT_OPTION_QP, 0))
+			goto fail;
+	}
+
+	return h264;
+fail:
+	h264_context_free(h264);
+	return NULL;
+}
+
+static BOOL bench_avc420(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                         BenchResult* result)
+{
+	BOOL rc = FALSE;
+	H264_CONTEXT* enc = bench_h264_new(TRUE, frames);
+	H264_CONTEXT* dec = bench_h264_new(FALSE, frames);
+	BYTE* out = bench_alloc_frame(frames);
+	const RECTANGLE_16 rect = { 0, 0, (UINT16)frames->width, (UINT16)frames->height };
+
+	WINPR_UNUSED(threadingFlags);
+
+	if (!enc || !dec || !out)
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			RDPGFX_H264_METABLOCK meta = { 0 };
+			BYTE* data = NULL;
+			UINT32 size = 0;
+
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			const INT32 status = avc420_compress(enc, frames->data[x], BENCH_FORMAT,
+			                                     frames->stride, frames->width, frames->height,
+			                                     &rect, &data, &size, &meta);
+			free_h264_metablock(&meta);
+			const UINT64 t1 = winpr_GetTickCount64NS();
+
+			if (status < 0)
+				goto fail;
+
+			result->encodeNs += t1 - t0;
+			result->frames++;
+
+			if (status > 0)
+			{
+				if (avc420_decompress(dec, data, size, out, BENCH_FORMAT, frames->stride,
+				                      frames->width, frames->height, &rect, 1) < 0)
+					goto fail;
+				result->decodeNs += winpr_GetTickCount64NS() - t1;
+				result->encodedBytes += size;
+			}
+
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	h264_context_free(dec);
+	h264_context_free(enc);
+	return rc;
+}
+
+static BOOL bench_avc444(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                         BenchResult* result)
+{
+	BOOL rc = FALSE;
+	H264_CONTEXT* enc = bench_h264_new(TRUE, frames);
+	H264_CONTEXT* dec = bench_h264_new(FALSE, frames);
+	BYTE* out = bench_alloc_frame(frames);
+	const RECTANGLE_16 rect = { 0, 0, (UINT16)frames->width, (UINT16)frames->height };
+
+	WINPR_UNUSED(threadingFlags);
+
+	if (!enc || !dec || !out)
+		goto fail;
+
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			RDPGFX_H264_METABLOCK meta = { 0 };
+			RDPGFX_H264_METABLOCK auxMeta = { 0 };
+			BYTE op = 0;
+			BYTE* data = NULL;
+			UINT32 size = 0;
+			BYTE* auxData = NULL;
+			UINT32 auxSize = 0;
+
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			const INT32 status = avc444_compress(
+			    enc, frames->data[x], BENCH_FORMAT, frames->stride, frames->width, frames->height,
+			    1, &rect, &op, &data, &size, &auxData, &auxSize, &meta, &auxMeta);
+			free_h264_metablock(&meta);
+			free_h264_metablock(&auxMeta);
+			const UINT64 t1 = winpr_GetTickCount64NS();
+
+			if (status < 0)
+				goto fail;
+
+			result->encodeNs += t1 - t0;
+			result->frames++;
+
+			if (status > 0)
+			{
+				/* a chroma only frame is sent as the first stream */
+				const BYTE* first = (op == 2) ? auxData : data;
+				const UINT32 firstSize = (op == 2) ? auxSize : size;
+				const UINT32 secondSize = (op == 0) ? auxSize : 0;
+
+				if (avc444_decompress(dec, op, &rect, 1, first, firstSize, &rect, 1, auxData,
+				                      secondSize, out, BENCH_FORMAT, frames->stride,
+				                      frames->width, frames->height,
+				                      RDPGFX_CODECID_AVC444) < 0)
+					goto fail;
+				result->decodeNs += winpr_GetTickCount64NS() - t1;
+				result->encodedBytes += 1ULL * firstSize + secondSize;
+			}
+
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	h264_context_free(dec);
+	h264_context_free(enc);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_zgfx(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                       BenchResult* result)
+{
+	BOOL rc = FALSE;
+	ZGFX_CONTEXT* enc = zgfx_context_new(TRUE);
+	ZGFX_CONTEXT* dec = zgfx_context_new(FALSE);
+	const UINT32 size = frames->stride * frames->height;
+
+	WINPR_UNUSED(threadingFlags);
+
+	if (!enc || !dec)
+		goto fail;
+
+	/* the uncompressed surface command payload, as sent for the uncompressed codec */
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			BYTE* data = NULL;
+			UINT32 dataSize = 0;
+			BYTE* decoded = NULL;
+			UINT32 decodedSize = 0;
+			UINT32 flags = 0;
+
+			const UINT64 t0 = winpr_GetTickCount64NS();
+			if (zgfx_compress(enc, frames->data[x], size, &data, &dataSize, &flags) < 0)
+				goto fail;
+			const UINT64 t1 = winpr_GetTickCount64NS();
+			const int status = zgfx_decompress(dec, data, dataSize, &decoded, &decodedSize, 0);
+			const UINT64 t2 = winpr_GetTickCount64NS();
+			const BOOL valid = (status >= 0) && (decodedSize == size);
+
+			if (valid)
+				bench_account(result, frames, frames->data[x], decoded, 0, 0, frames->width,
+				              frames->height);
+			free(decoded);
+			free(data);
+
+			if (!valid)
+				goto fail;
+
+			result->encodeNs += t1 - t0;
+			result->decodeNs += t2 - t1;
+			result->encodedBytes += dataSize;
+			result->frames++;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	zgfx_context_free(dec);
+	zgfx_context_free(enc);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+typedef enum
+{
+	BENCH_BULK_NONE,
+	BENCH_BULK_MPPC,
+	BENCH_BULK_NCRUSH,
+	BENCH_BULK_XCRUSH
+} BenchBulk;
+
+static BOOL bench_bulk(BenchBulk type, const BenchFrames* frames, UINT32 iterations,
+                       BenchResult* result)
+{
+	BOOL rc = FALSE;
+	MPPC_CONTEXT* mppcEnc = NULL;
+	MPPC_CONTEXT* mppcDec = NULL;
+	NCRUSH_CONTEXT* ncrushEnc = NULL;
+	NCRUSH_CONTEXT* ncrushDec = NULL;
+	XCRUSH_CONTEXT* xcrushEnc = NULL;
+	XCRUSH_CONTEXT* xcrushDec = NULL;
+	BYTE* buffer = calloc(1, BENCH_BULK_BUFFER);
+	BYTE* out = bench_alloc_frame(frames);
+	const UINT32 size = frames->stride * frames->height;
+
+	if (!buffer || !out)
+		goto fail;
+
+	switch (type)
+	{
+		case BENCH_BULK_MPPC:
+			mppcEnc = mppc_context_new(1, TRUE);
+			mppcDec = mppc_context_new(1, FALSE);
+			if (!mppcEnc || !mppcDec)
+				goto fail;
+			break;
+		case BENCH_BULK_NCRUSH:
+			ncrushEnc = ncrush_context_new(TRUE);
+			ncrushDec = ncrush_context_new(FALSE);
+			if (!ncrushEnc || !ncrushDec)
+				goto fail;
+			break;
+		case BENCH_BULK_XCRUSH:
+		default:
+			xcrushEnc = xcrush_context_new(TRUE);
+			xcrushDec = xcrush_context_new(FALSE);
+			if (!xcrushEnc || !xcrushDec)
+				goto fail;
+			break;
+	}
+
+	/* the frames are cut into PDU sized chunks, like uncompressed bitmap updates */
+	for (UINT32 it = 0; it < iterations; it++)
+	{
+		for (size_t x = 0; x < frames->count; x++)
+		{
+			for (UINT32 offset = 0; offset < size; offset += BENCH_BULK_CHUNK)
+			{
+				const BYTE* src = &frames->data[x][offset];
+				const UINT32 srcSize = MIN(BENCH_BULK_CHUNK, size - offset);
+				const BYTE* data = NULL;
+				UINT32 dataSize = BENCH_BULK_BUFFER;
+				const BYTE* decoded = NULL;
+				UINT32 decodedSize = 0;
+				UINT32 flags = 0;
+				int status = 0;
+
+				const UINT64 t0 = winpr_GetTickCount64NS();
+				switch (type)
+				{
+					case BENCH_BULK_MPPC:
+						status = mppc_compress(mppcEnc, src, srcSize, buffer, &data, &dataSize,
+						                       &flags);
+						break;
+					case BENCH_BULK_NCRUSH:
+						status = ncrush_compress(ncrushEnc, src, srcSize, buffer, &data,
+						                         &dataSize, &flags);
+						break;
+					case BENCH_BULK_XCRUSH:
+					default:
+						status = xcrush_compress(xcrushEnc, src, srcSize, buffer, &data,
+						                         &dataSize, &flags);
+						break;
+				}
+				const UINT64 t1 = winpr_GetTickCount64NS();
+
+				if (status < 0)
+					goto fail;
+
+				/* like bulk_decompress, plain packets bypass the decompressor */
+				switch ((flags & BULK_COMPRESSION_FLAGS_MASK) ? type : BENCH_BULK_NONE)
+				{
+					case BENCH_BULK_MPPC:
+						status = mppc_decompress(mppcDec, data, dataSize, &decoded, &decodedSize,
+						                         flags);
+						break;
+					case BENCH_BULK_NCRUSH:
+						status = ncrush_decompress(ncrushDec, data, dataSize, &decoded,
+						                           &decodedSize, flags);
+						break;
+					case BENCH_BULK_XCRUSH:
+						status = xcrush_decompress(xcrushDec, data, dataSize, &decoded,
+						                           &decodedSize, flags);
+						break;
+					case BENCH_BULK_NONE:
+					default:
+						decoded = data;
+						decodedSize = dataSize;
+						break;
+				}
+				const UINT64 t2 = winpr_GetTickCount64NS();
+
+				if ((status < 0) || (decodedSize != srcSize))
+					goto fail;
+
+				memcpy(&out[offset], decoded, decodedSize);
+				result->encodeNs += t1 - t0;
+				result->decodeNs += t2 - t1;
+				result->encodedBytes += dataSize;
+			}
+
+			result->frames++;
+			bench_account(result, frames, frames->data[x], out, 0, 0, frames->width,
+			              frames->height);
+		}
+	}
+
+	rc = TRUE;
+fail:
+	winpr_aligned_free(out);
+	free(buffer);
+	xcrush_context_free(xcrushDec);
+	xcrush_context_free(xcrushEnc);
+	ncrush_context_free(ncrushDec);
+	ncrush_context_free(ncrushEnc);
+	mppc_context_free(mppcDec);
+	mppc_context_free(mppcEnc);
+	return rc;
+}
+
+static BOOL bench_mppc(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                       BenchResult* result)
+{
+	WINPR_UNUSED(threadingFlags);
+	return bench_bulk(BENCH_BULK_MPPC, frames, iterations, result);
+}
+
+static BOOL bench_ncrush(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                         BenchResult* result)
+{
+	WINPR_UNUSED(threadingFlags);
+	return bench_bulk(BENCH_BULK_NCRUSH, frames, iterations, result);
+}
+
+static BOOL bench_xcrush(const BenchFrames* frames, UINT32 threadingFlags, UINT32 iterations,
+                         BenchResult* result)
+{
+	WINPR_UNUSED(threadingFlags);
+	return bench_bulk(BENCH_BULK_XCRUSH, frames, iterations, result);
+}
+
+static const BenchCodec bench_codecs[] = {
+	{ "rfx", TRUE, bench_rfx },
+	{ "progressive", TRUE, bench_progressive },
+	{ "planar", TRUE, bench_planar },
+	{ "interleaved", FALSE, bench_interleaved },
+	{ "nsc", FALSE, bench_nsc },
+	{ "clear", FALSE, bench_clear },
+	{ "avc420", FALSE, bench_avc420 },
+	{ "avc444", FALSE, bench_avc444 },
+	{ "zgfx", FALSE, bench_zgfx },
+	{ "mppc", FALSE, bench_mppc },
+	{ "ncrush", FALSE, bench_ncrush },
+	{ "xcrush", FALSE, bench_xcrush },
+};
+
+/* ------------------------------------------------------------------------- */
+static void bench_frames_free(BenchFrames* frames)
+{
+	for (size_t x = 0; frames->data && (x < frames->count); x++)
+		winpr_aligned_free(frames->data[x]);
+
+	free((void*)frames->data);
+	frames->data = NULL;
+	frames->count = 0;
+}
+
+static BOOL bench_frames_alloc(BenchFrames* frames, UINT32 width, UINT32 height, size_t count)
+{
+	frames->width = width;
+	frames->height = height;
+	frames->stride = width * FreeRDPGetBytesPerPixel(BENCH_FORMAT);
+	frames->data = (BYTE**)calloc(count, sizeof(BYTE*));
+
+	if (!frames->data)
+		return FALSE;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		frames->data[x] = bench_alloc_frame(frames);
+		if (!frames->data[x])
+			return FALSE;
+		frames->count++;
+	}
+
+	return TRUE;
+}
+
+static void bench_fill_rect(BYTE* data, UINT32 stride, INT32 left, INT32 top, INT32 width,
+                            INT32 height, UINT32 frameWidth, UINT32 frameHeight, UINT32 color)
+{
+	const INT32 x0 = MAX(0, left);
+	const INT32 y0 = MAX(0, top);
+	const INT32 x1 = MIN((INT32)frameWidth, left + width);
+	const INT32 y1 = MIN((INT32)frameHeight, top + height);
+
+	for (INT32 y = y0; y < y1; y++)
+	{
+		for (INT32 x = x0; x < x1; x++)
+			FreeRDPWriteColor(&data[1ULL * y * stride + 4ULL * x], BENCH_FORMAT, color);
+	}
+}
+
+/* A desktop like scene: a gradient wallpaper, a photo, and windows with text that
+ * scroll and move a bit from frame to frame */
+static BOOL bench_frames_synthetic(BenchFrames* frames, UINT32 width, UINT32 height, size_t count)
+{
+	if (!bench_frames_alloc(frames, width, height, count))
+		return FALSE;
+
+	for (size_t f = 0; f < count; f++)
+	{
+		BYTE* data = frames->data[f];
+		UINT32 seed = 42;
+
+		for (UINT32 y = 0; y < height; y++)
+		{
+			for (UINT32 x = 0; x < width; x++)
+			{
+				const BYTE r = (BYTE)(32 + (64 * y) / height);
+				const BYTE g = (BYTE)(64 + (96 * x) / width);
+				const UINT32 color = FreeRDPGetColor(BENCH_FORMAT, r, g, 160, 0xFF);
+				FreeRDPWriteColor(&data[1ULL * y * frames->stride + 4ULL * x], BENCH_FORMAT,
+				                  color);
+			}
+		}
+
+		/* photo area with smooth content and some sensor noise */
+		const UINT32 px = width / 2;
+		const UINT32 py = height / 8;
+		for (UINT32 y = py; y < MIN(height, py + height / 3); y++)
+		{
+			for (UINT32 x = px; x < MIN(width, px + width / 3); x++)
+			{
+				const double v = sin(x / 23.0) * cos(y / 17.0) + sin((x + y + f) / 41.0);
+				const BYTE n = (BYTE)(bench_rand(&seed) & 0x07);
+				const BYTE r = (BYTE)(128 + 50 * v + n);
+				const BYTE g = (BYTE)(110 + 40 * sin((x - y) / 29.0) + n);
+				const BYTE b = (BYTE)(90 + 60 * cos(x / 31.0) + n);
+				const UINT32 color = FreeRDPGetColor(BENCH_FORMAT, r, g, b, 0xFF);
+				FreeRDPWriteColor(&data[1ULL * y * frames->stride + 4ULL * x], BENCH_FORMAT,
+				                  color);
+			}
+		}
+
+		/* windows with a title bar and lines of text, the second one moves */
+		for (size_t w = 0; w < 2; w++)
+		{
+			const INT32 wx = (INT32)(width / 16 + w * (width / 4) + (w ? 4 * f : 0));
+			const INT32 wy = (INT32)(height / 6 + w * (height / 3));
+			const INT32 ww = (INT32)(width / 2);
+			const INT32 wh = (INT32)(height / 2);
+			const UINT32 frame = FreeRDPGetColor(BENCH_FORMAT, 0x30, 0x50, 0x90, 0xFF);
+			const UINT32 paper = FreeRDPGetColor(BENCH_FORMAT, 0xF8, 0xF8, 0xF8, 0xFF);
+			const UINT32 ink = FreeRDPGetColor(BENCH_FORMAT, 0x20, 0x20, 0x20, 0xFF);
+			UINT32 text = 7 + (UINT32)w;
+
+			bench_fill_rect(data, frames->stride, wx, wy, ww, 24, width, height, frame);
+			bench_fill_rect(data, frames->stride, wx, wy + 24, ww, wh - 24, width, height, paper);
+
+			/* the text scrolls by one line per frame */
+			for (INT32 line = 0; line * 16 + 40 < wh; line++)
+			{
+				UINT32 lseed = text * 977 + (UINT32)(line + (INT32)f) * 131;
+				INT32 x = wx + 8;
+
+				while (x < wx + ww - 16)
+				{
+					const INT32 glyph = 4 + (INT32)(bench_rand(&lseed) % 6);
+					if ((bench_rand(&lseed) % 7) != 0)
+					{
+						for (INT32 stroke = 0; stroke < glyph; stroke += 2)
+							bench_fill_rect(data, frames->stride, x + stroke,
+							                wy + 32 + line * 16 + (INT32)(bench_rand(&lseed) % 3),
+							                1, 8 + (INT32)(bench_rand(&lseed) % 3), width, height,
+							                ink);
+					}
+					x += glyph + 2;
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL bench_frames_load(BenchFrames* frames, const BenchConfig* config)
+{
+	for (size_t x = 0; x < config->numInputs; x++)
+	{
+		BOOL rc = FALSE;
+		wImage* image = winpr_image_new();
+
+		if (!image)
+			return FALSE;
+
+		if (winpr_image_read(image, config->inputs[x]) <= 0)
+		{
+			(void)fprintf(stderr, "failed to read %s\n", config->inputs[x]);
+			goto fail;
+		}
+
+		if (x == 0)
+		{
+			if (!bench_frames_alloc(frames, image->width, image->height, config->numInputs))
+				goto fail;
+		}
+		else if ((image->width != frames->width) || (image->height != frames->height))
+		{
+			(void)fprintf(stderr, "%s: all frames must be %" PRIu32 "x%" PRIu32 "\n",
+			              config->inputs[x], frames->width, frames->height);
+			goto fail;
+		}
+
+		const UINT32 format =
+		    (image->bytesPerPixel == 4) ? PIXEL_FORMAT_BGRX32 : PIXEL_FORMAT_BGR24;
+		rc = freerdp_image_copy_no_overlap(frames->data[x], BENCH_FORMAT, frames->stride, 0, 0,
+		                                   frames->width, frames->height, image->data, format,
+		                                   image->scanline, 0, 0, NULL, FREERDP_FLIP_NONE);
+	fail:
+		winpr_image_free(image, TRUE);
+		if (!rc)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL bench_codec_selected(const BenchConfig* config, const char* name)
+{
+	if (!config->codecs)
+		return TRUE;
+
+	const size_t len = strlen(name);
+	const char* cur = config->codecs;
+
+	while (cur && *cur)
+	{
+		const char* end = strchr(cur, ',');
+		const size_t clen = end ? (size_t)(end - cur) : strlen(cur);
+
+		if ((clen == len) && (strncmp(cur, name, len) == 0))
+			return TRUE;
+
+		cur = end ? end + 1 : NULL;
+	}
+
+	return FALSE;
+}
+
+static void bench_print_header(const BenchConfig* config, const BenchFrames* frames)
+{
+	switch (config->output)
+	{
+		case BENCH_OUTPUT_CSV:
+			printf("codec,threads,width,height,frames,status,encode_mbps,decode_mbps,encode_ms_"
+			       "per_frame,decode_ms_per_frame,ratio,psnr_db\n");
+			break;
+		case BENCH_OUTPUT_JSON:
+			printf("[\n");
+			break;
+		case BENCH_OUTPUT_TEXT:
+		default:
+			printf("%" PRIuz " frames of %" PRIu32 "x%" PRIu32 ", %" PRIu32 " iterations\n",
+			       frames->count, frames->width, frames->height, config->iterations);
+			printf("%-12s %-7s %-6s %10s %10s %10s %10s %8s %8s\n", "codec", "threads", "status",
+			       "enc MB/s", "dec MB/s", "enc ms/f", "dec ms/f", "ratio", "PSNR dB");
+			break;
+	}
+}
+
+static void bench_print_result(const BenchConfig* config, const BenchFrames* frames,
+                               const char* name, const char* threads, BOOL ok,
+                               const BenchResult* result, BOOL* first)
+{
+	const double mb = (double)result->rawBytes / (1024.0 * 1024.0);
+	const double enc = (double)result->encodeNs / 1e9;
+	const double dec = (double)result->decodeNs / 1e9;
+	const double encMBps = (enc > 0.0) ? mb / enc : 0.0;
+	const double decMBps = (dec > 0.0) ? mb / dec : 0.0;
+	const double nframes = (result->frames > 0) ? (double)result->frames : 1.0;
+	const double encMs = enc * 1000.0 / nframes;
+	const double decMs = dec * 1000.0 / nframes;
+	const double ratio = (result->encodedBytes > 0)
+	                         ? (double)result->rawBytes / (double)result->encodedBytes
+	                         : 0.0;
+	const double psnr = bench_psnr(result);
+	const char* status = ok ? "ok" : "failed";
+
+	switch (config->output)
+	{
+		case BENCH_OUTPUT_CSV:
+			printf("%s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%s,%.2f,%.2f,%.3f,%.3f,%.3f,%.2f\n",
+			       name, threads, frames->width, frames->height, result->frames, status, encMBps,
+			       decMBps, encMs, decMs, ratio, psnr);
+			break;
+		case BENCH_OUTPUT_JSON:
+			printf("%s  { \"codec\": \"%s\", \"threads\": \"%s\", \"width\": %" PRIu32
+			       ", \"height\": %" PRIu32 ", \"frames\": %" PRIu64
+			       ", \"status\": \"%s\", \"encode_mbps\": %.2f, \"decode_mbps\": %.2f, "
+			       "\"encode_ms_per_frame\": %.3f, \"decode_ms_per_frame\": %.3f, \"ratio\": "
+			       "%.3f, \"psnr_db\": %.2f }",
+			       *first ? "" : ",\n", name, threads, frames->width, frames->height,
+			       result->frames, status, encMBps, decMBps, encMs, decMs, ratio, psnr);
+			break;
+		case BENCH_OUTPUT_TEXT:
+		default:
+			if (ok)
+				printf("%-12s %-7s %-6s %10.2f %10.2f %10.3f %10.3f %8.2f %8.2f\n", name, threads,
+				       status, encMBps, decMBps, encMs, decMs, ratio, psnr);
+			else
+				printf("%-12s %-7s %-6s\n", name, threads, status);
+			break;
+	}
+
+	*first = FALSE;
+}
+
+static void bench_usage(const char* name)
+{
+	printf("Usage: %s [options]\n", name);
+	printf("  -i, --input <file>       add a frame (BMP/PNG), all frames must have the same size\n");
+	printf("  -n, --frames <count>     synthetic frames without --input (default 8)\n");
+	printf("  -s, --size <w>x<h>       synthetic frame size (default 1920x1080)\n");
+	printf("  -r, --iterations <count> passes over all frames (default 3)\n");
+	printf("  -c, --codec <list>       comma separated codecs (default all):\n                 "
+	       "          ");
+	for (size_t x = 0; x < ARRAYSIZE(bench_codecs); x++)
+		printf("%s%s", x ? "," : "", bench_codecs[x].name);
+	printf("\n");
+	printf("  -t, --threads <mode>     serial, pool or all (default all), only for codecs\n"
+	       "                           that can encode on the thread pool\n");
+	printf("  -f, --format <format>    text, csv or json (default text)\n");
+}
+
+static BOOL bench_parse_uint(const char* value, UINT32 min, UINT32 max, UINT32* result)
+{
+	char* end = NULL;
+
+	if (!value)
+		return FALSE;
+
+	errno = 0;
+	const unsigned long val = strtoul(value, &end, 0);
+
+	if ((errno != 0) || !end || (*end != '\0') || (val < min) || (val > max))
+		return FALSE;
+
+	*result = (UINT32)val;
+	return TRUE;
+}
+
+static int bench_parse(BenchConfig* config, int argc, char* argv[])
+{
+	for (int x = 1; x < argc; x++)
+	{
+		const char* arg = argv[x];
+		const char* value = (x + 1 < argc) ? argv[x + 1] : NULL;
+
+		if ((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0))
+			return 0;
+
+		if (!value)
+			return -1;
+
+		x++;
+
+		if ((strcmp(arg, "-i") == 0) || (strcmp(arg, "--input") == 0))
+		{
+			if (config->numInputs >= ARRAYSIZE(config->inputs))
+				return -1;
+			config->inputs[config->numInputs++] = value;
+		}
+		else if ((strcmp(arg, "-n") == 0) || (strcmp(arg, "--frames") == 0))
+		{
+			if (!bench_parse_uint(value, 1, 100000, &config->frames))
+				return -1;
+		}
+		else if ((strcmp(arg, "-s") == 0) || (strcmp(arg, "--size") == 0))
+		{
+			unsigned w = 0;
+			unsigned h = 0;
+
+			if ((sscanf(value, "%ux%u", &w, &h) != 2) || (w < 16) || (h < 16) || (w > 8192) ||
+			    (h > 8192))
+				return -1;
+			config->width = w;
+			config->height = h;
+		}
+		else if ((strcmp(arg, "-r") == 0) || (strcmp(arg, "--iterations") == 0))
+		{
+			if (!bench_parse_uint(value, 1, 100000, &config->iterations))
+				return -1;
+		}
+		else if ((strcmp(arg, "-c") == 0) || (strcmp(arg, "--codec") == 0))
+			config->codecs = value;
+		else if ((strcmp(arg, "-t") == 0) || (strcmp(arg, "--threads") == 0))
+		{
+			config->serial = (strcmp(value, "serial") == 0) || (strcmp(value, "all") == 0);
+			config->pool = (strcmp(value, "pool") == 0) || (strcmp(value, "all") == 0);
+			if (!config->serial && !config->pool)
+				return -1;
+		}
+		else if ((strcmp(arg, "-f") == 0) || (strcmp(arg, "--format") == 0))
+		{
+			if (strcmp(value, "text") == 0)
+				config->output = BENCH_OUTPUT_TEXT;
+			else if (strcmp(value, "csv") == 0)
+				config->output = BENCH_OUTPUT_CSV;
+			else if (strcmp(value, "json") == 0)
+				config->output = BENCH_OUTPUT_JSON;
+			else
+				return -1;
+		}
+		else
+			return -1;
+	}
+
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	int rc = -1;
+	BOOL first = TRUE;
+	BenchFrames frames = { 0 };
+	BenchConfig config = { 0 };
+
+	config.width = 1920;
+	config.height = 1080;
+	config.frames = 8;
+	config.iterations = 3;
+	config.serial = TRUE;
+	config.pool = TRUE;
+	config.output = BENCH_OUTPUT_TEXT;
+
+	const int status = bench_parse(&config, argc, argv);
+	if (status <= 0)
+	{
+		bench_usage(argv[0]);
+		return (status == 0) ? 0 : -1;
+	}
+
+	if (config.numInputs > 0)
+	{
+		if (!bench_frames_load(&frames, &config))
+			goto fail;
+	}
+	else if (!bench_frames_synthetic(&frames, config.width, config.height, config.frames))
+		goto fail;
+
+	bench_print_header(&config, &frames);
+	rc = 0;
+
+	for (size_t x = 0; x < ARRAYSIZE(bench_codecs); x++)
+	{
+		const BenchCodec* codec = &bench_codecs[x];
+
+		if (!bench_codec_selected(&config, codec->name))
+			continue;
+
+		for (size_t mode = 0; mode < 2; mode++)
+		{
+			const BOOL pool = (mode == 1);
+
+			if (pool && (!codec->threaded || !config.pool))
+				continue;
+
+			/* codecs without thread pool support always run serially */
+			if (!pool && !config.serial && codec->threaded)
+				continue;
+
+			BenchResult result = { 0 };
+			const UINT32 flags = pool ? 0 : THREADING_FLAGS_DISABLE_THREADS;
+			const BOOL ok = codec->fkt(&frames, flags, config.iterations, &result);
+
+			/* the H.264 codecs are optional, a missing backend is not an error */
+			if (!ok && (strncmp(codec->name, "avc", 3) != 0))
+				rc = -1;
+
+			bench_print_result(&config, &frames, codec->name, pool ? "pool" : "serial", ok,
+			                   &result, &first);
+		}
+	}
+
+	if (config.output == BENCH_OUTPUT_JSON)
+		printf("\n]\n");
+
+fail:
+	bench_frames_free(&frames);
+	return rc;
+}
@@ -28,6 +28,7 @@
 
 #include <freerdp/log.h>
 #include "xcrush.h"
+#include "bulk.h"
 
 #pragma pack(push, 1)
 
@@ -410,20 +411,65 @@ static int xcrush_insert_chunk(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 	return 1;
 }
 
+/* Number of equal leading bytes of a and b, at most max */
+static INLINE UINT32 xcrush_forward_match_length(const BYTE* WINPR_RESTRICT a,
+                                                 const BYTE* WINPR_RESTRICT b, UINT32 max)
+{
+	UINT32 length = 0;
+
+	/* compare 8 bytes per round, the mismatching word is resolved bytewise */
+	while (length + 8 <= max)
+	{
+		UINT64 va = 0;
+		UINT64 vb = 0;
+		memcpy(&va, &a[length], sizeof(va));
+		memcpy(&vb, &b[length], sizeof(vb));
+
+		if (va != vb)
+			break;
+
+		length += 8;
+	}
+
+	while ((length < max) && (a[length] == b[length]))
+		length++;
+
+	return length;
+}
+
+/* Number of equal bytes preceding a and b, at most max */
+static INLINE UINT32 xcrush_reverse_match_length(const BYTE* WINPR_RESTRICT a,
+                                                 const BYTE* WINPR_RESTRICT b, UINT32 max)
+{
+	UINT32 length = 0;
+
+	while (length + 8 <= max)
+	{
+		UINT64 va = 0;
+		UINT64 vb = 0;
+		memcpy(&va, a - length - 8, sizeof(va));
+		memcpy(&vb, b - length - 8, sizeof(vb));
+
+		if (va != vb)
+			break;
+
+		length += 8;
+	}
+
+	while ((length < max) && (*(a - length - 1) == *(b - length - 1)))
+		length++;
+
+	return length;
+}
+
 static int xcrush_find_match_length(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT32 MatchOffset,
                                     UINT32 ChunkOffset, UINT32 HistoryOffset, UINT32 SrcSize,
                                     UINT32 MaxMatchLength,
                                     XCRUSH_MATCH_INFO* WINPR_RESTRICT MatchInfo)
 {
-	UINT32 MatchSymbol = 0;
-	UINT32 ChunkSymbol = 0;
 	BYTE* ChunkBuffer = NULL;
 	BYTE* MatchBuffer = NULL;
 	BYTE* MatchStartPtr = NULL;
-	BYTE* ForwardChunkPtr = NULL;
-	BYTE* ReverseChunkPtr = NULL;
-	BYTE* ForwardMatchPtr = NULL;
-	BYTE* ReverseMatchPtr = NULL;
 	BYTE* HistoryBufferEnd = NULL;
 	UINT32 ReverseMatchLength = 0;
 	UINT32 ForwardMatchLength = 0;
@@ -457,39 +503,20 @@ static int xcrush_find_match_length(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush, UINT3
 	if (ChunkBuffer < HistoryBuffer)
 		return -2005; /* error */
 
-	ForwardMatchPtr = &HistoryBuffer[MatchOffset];
-	ForwardChunkPtr = &HistoryBuffer[ChunkOffset];
-
 	if ((&MatchBuffer[MaxMatchLength + 1] < HistoryBufferEnd) &&
 	    (MatchBuffer[MaxMatchLength + 1] != ChunkBuffer[MaxMatchLength + 1]))
 	{
 		return 0;
 	}
 
-	while (1)
-	{
-		MatchSymbol = *ForwardMatchPtr++;
-		ChunkSymbol = *ForwardChunkPtr++;
-
-		if (MatchSymbol != ChunkSymbol)
-			break;
-
-		if (ForwardMatchPtr > HistoryBufferEnd)
-			break;
+	if (MatchBuffer < HistoryBufferEnd)
+		ForwardMatchLength = xcrush_forward_match_length(
+		    MatchBuffer, ChunkBuffer, (UINT32)(HistoryBufferEnd - MatchBuffer));
 
-		ForwardMatchLength++;
-	}
-
-	ReverseMatchPtr = MatchBuffer - 1;
-	ReverseChunkPtr = ChunkBuffer - 1;
-
-	while ((ReverseMatchPtr > &HistoryBuffer[HistoryOffset]) && (ReverseChunkPtr > HistoryBuffer) &&
-	       (*ReverseMatchPtr == *ReverseChunkPtr))
-	{
-		ReverseMatchLength++;
-		ReverseMatchPtr--;
-		ReverseChunkPtr--;
-	}
+	/* the reverse match may neither reach the current data start nor the history start */
+	if ((MatchOffset > HistoryOffset + 1) && (ChunkOffset > 1))
+		ReverseMatchLength = xcrush_reverse_match_length(
+		    MatchBuffer, ChunkBuffer, MIN(MatchOffset - HistoryOffset - 1, ChunkOffset - 1));
 
 	MatchStartPtr = MatchBuffer - ReverseMatchLength;
 	TotalMatchLength = ReverseMatchLength + ForwardMatchLength;
@@ -758,37 +785,6 @@ static int xcrush_generate_output(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 	return 1;
 }
 
-static INLINE size_t xcrush_copy_bytes_no_overlap(BYTE* WINPR_RESTRICT dst,
-                                                  const BYTE* WINPR_RESTRICT src, size_t num)
-{
-	// src and dst overlaps
-	// we should copy the area that doesn't overlap repeatly
-	const size_t diff = (dst > src) ? dst - src : src - dst;
-	const size_t rest = num % diff;
-	const size_t end = num - rest;
-
-	for (size_t a = 0; a < end; a += diff)
-		memcpy(&dst[a], &src[a], diff);
-
-	if (rest != 0)
-		memcpy(&dst[end], &src[end], rest);
-
-	return num;
-}
-
-static INLINE size_t xcrush_copy_bytes(BYTE* dst, const BYTE* src, size_t num)
-{
-	WINPR_ASSERT(dst);
-	WINPR_ASSERT(src);
-
-	if (src + num < dst || src > dst + num)
-		memcpy(dst, src, num);
-	else if (src != dst)
-		return xcrush_copy_bytes_no_overlap(dst, src, num);
-
-	return num;
-}
-
 static int xcrush_decompress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
                                 const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
                                 const BYTE** WINPR_RESTRICT ppDstData,
@@ -874,7 +870,7 @@ static int xcrush_decompress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 				    (&Literals[OutputLength] > pSrcEnd))
 					return -1009;
 
-				xcrush_copy_bytes(HistoryPtr, Literals, OutputLength);
+				MoveMemory(HistoryPtr, Literals, OutputLength);
 				HistoryPtr += OutputLength;
 				Literals += OutputLength;
 				OutputOffset += OutputLength;
@@ -889,7 +885,7 @@ static int xcrush_decompress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 			    (&OutputPtr[MatchLength] >= HistoryBufferEnd))
 				return -1011;
 
-			xcrush_copy_bytes(HistoryPtr, OutputPtr, MatchLength);
+			bulk_copy_match(HistoryPtr, OutputPtr, MatchLength);
 			OutputOffset += MatchLength;
 			HistoryPtr += MatchLength;
 		}
@@ -902,7 +898,7 @@ static int xcrush_decompress_l1(XCRUSH_CONTEXT* WINPR_RESTRICT xcrush,
 		if ((&HistoryPtr[OutputLength] >= HistoryBufferEnd) || (&Literals[OutputLength] > pSrcEnd))
 			return -1012;
 
-		xcrush_copy_bytes(HistoryPtr, Literals, OutputLength);
+		MoveMemory(HistoryPtr, Literals, OutputLength);
 		HistoryPtr += OutputLength;
 	}
 
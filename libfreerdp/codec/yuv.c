@@ -61,7 +61,6 @@ struct S_YUV_CONTEXT
 	TP_CALLBACK_ENVIRON ThreadPoolEnv;
 
 	UINT32 work_object_count;
-	PTP_WORK* work_objects;
 	YUV_ENCODE_WORK_PARAM* work_enc_params;
 	YUV_PROCESS_WORK_PARAM* work_dec_params;
 	YUV_COMBINE_WORK_PARAM* work_combined_params;
@@ -207,12 +206,6 @@ BOOL yuv_context_reset(YUV_CONTEXT* WINPR_RESTRICT context, UINT32 width, UINT32
 			context->work_combined_params = ctmp;
 		}
 
-		void* wtmp = winpr_aligned_recalloc(context->work_objects, count, sizeof(PTP_WORK), 32);
-		if (!wtmp)
-			goto fail;
-		memset(wtmp, 0, count * sizeof(PTP_WORK));
-
-		context->work_objects = wtmp;
 		context->work_object_count = count;
 	}
 	rc = TRUE;
@@ -269,7 +262,6 @@ void yuv_context_free(YUV_CONTEXT* context)
 		if (context->threadPool)
 			CloseThreadpool(context->threadPool);
 		DestroyThreadpoolEnvironment(&context->ThreadPoolEnv);
-		winpr_aligned_free(context->work_objects);
 		winpr_aligned_free(context->work_combined_params);
 		winpr_aligned_free(context->work_enc_params);
 		winpr_aligned_free(context->work_dec_params);
@@ -305,48 +297,30 @@ static INLINE YUV_PROCESS_WORK_PARAM pool_decode_param(const RECTANGLE_16* WINPR
 	return current;
 }
 
-static BOOL submit_object(PTP_WORK* WINPR_RESTRICT work_object, PTP_WORK_CALLBACK cb,
-                          const void* WINPR_RESTRICT param, YUV_CONTEXT* WINPR_RESTRICT context)
+typedef struct
 {
-	union
-	{
-		const void* cpv;
-		void* pv;
-	} cnv;
-
-	cnv.cpv = param;
+	PTP_WORK_CALLBACK cb;
+	BYTE* params;
+	size_t size;
+} YUV_WORK_BATCH;
 
-	if (!work_object)
-		return FALSE;
-
-	*work_object = NULL;
-
-	if (!param || !context)
-		return FALSE;
-
-	*work_object = CreateThreadpoolWork(cb, cnv.pv, &context->ThreadPoolEnv);
-	if (!*work_object)
-		return FALSE;
+static void yuv_batch_work_callback(PVOID context, size_t index)
+{
+	YUV_WORK_BATCH* batch = (YUV_WORK_BATCH*)context;
+	WINPR_ASSERT(batch);
 
-	SubmitThreadpoolWork(*work_object);
-	return TRUE;
+	batch->cb(NULL, &batch->params[index * batch->size], NULL);
 }
 
-static void free_objects(PTP_WORK* work_objects, UINT32 waitCount)
+/* Runs cb for the first count entries of params, the pool wakes once per batch */
+static BOOL run_batch(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK cb, void* params,
+                      size_t size, UINT32 count)
 {
-	WINPR_ASSERT(work_objects || (waitCount == 0));
-
-	for (UINT32 i = 0; i < waitCount; i++)
-	{
-		PTP_WORK cur = work_objects[i];
-		work_objects[i] = NULL;
-
-		if (!cur)
-			continue;
+	YUV_WORK_BATCH batch = { cb, (BYTE*)params, size };
 
-		WaitForThreadpoolWorkCallbacks(cur, FALSE);
-		CloseThreadpoolWork(cur);
-	}
+	WINPR_ASSERT(context);
+	return winpr_SubmitThreadpoolWorkBatch(yuv_batch_work_callback, &batch, count,
+	                                       &context->ThreadPoolEnv);
 }
 
 static BOOL intersects(UINT32 pos, const RECTANGLE_16* WINPR_RESTRICT regionRects,
@@ -390,7 +364,6 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
                         UINT32 nDstStep, const RECTANGLE_16* WINPR_RESTRICT regionRects,
                         UINT32 numRegionRects)
 {
-	BOOL rc = FALSE;
 	UINT32 waitCount = 0;
 	primitives_t* prims = primitives_get();
 
@@ -442,7 +415,7 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 					         "YUV decoder: invalid number of tiles, only support less than %" PRIu32
 					         ", got %" PRIu32,
 					         context->work_object_count, waitCount);
-					goto fail;
+					return FALSE;
 				}
 
 				YUV_PROCESS_WORK_PARAM* cur = &context->work_dec_params[waitCount];
@@ -450,8 +423,6 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 				if (rectangle_is_empty(&z))
 					continue;
 				*cur = pool_decode_param(&z, context, pYUVData, iStride, DstFormat, dest, nDstStep);
-				if (!submit_object(&context->work_objects[waitCount], cb, cur, context))
-					goto fail;
 				waitCount++;
 				y.top += TILE_SIZE;
 			}
@@ -459,10 +430,9 @@ static BOOL pool_decode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 			r.left += TILE_SIZE;
 		}
 	}
-	rc = TRUE;
-fail:
-	free_objects(context->work_objects, context->work_object_count);
-	return rc;
+
+	return run_batch(context, cb, context->work_dec_params, sizeof(YUV_PROCESS_WORK_PARAM),
+	                 waitCount);
 }
 
 static INLINE BOOL check_rect(const YUV_CONTEXT* WINPR_RESTRICT yuv,
@@ -555,7 +525,6 @@ static BOOL pool_decode_rect(YUV_CONTEXT* WINPR_RESTRICT context, BYTE type,
                              BYTE* WINPR_RESTRICT pYUVDstData[3], const UINT32 iDstStride[3],
                              const RECTANGLE_16* WINPR_RESTRICT regionRects, UINT32 numRegionRects)
 {
-	BOOL rc = FALSE;
 	UINT32 waitCount = 0;
 	PTP_WORK_CALLBACK cb = yuv444_combine_work_callback;
 	primitives_t* prims = primitives_get();
@@ -589,20 +558,53 @@ static BOOL pool_decode_rect(YUV_CONTEXT* WINPR_RESTRICT context, BYTE type,
 			         "YUV rect decoder: invalid number of tiles, only support less than %" PRIu32
 			         ", got %" PRIu32,
 			         context->work_object_count, waitCount);
-			goto fail;
+			return FALSE;
 		}
 		current = &context->work_combined_params[waitCount];
 		*current = pool_decode_rect_param(&regionRects[waitCount], context, type, pYUVData, iStride,
 		                                  pYUVDstData, iDstStride);
+	}
+
+	return run_batch(context, cb, context->work_combined_params, sizeof(YUV_COMBINE_WORK_PARAM),
+	                 waitCount);
+}
+
+static BOOL yuv444_combine_decode(YUV_CONTEXT* WINPR_RESTRICT context, BYTE type,
+                                  const BYTE* WINPR_RESTRICT pYUVData[3], const UINT32 iStride[3],
+                                  UINT32 srcYuvHeight, BYTE* WINPR_RESTRICT pYUVDstData[3],
+                                  const UINT32 iDstStride[3], DWORD DstFormat,
+                                  BYTE* WINPR_RESTRICT dest, UINT32 nDstStep,
+                                  const RECTANGLE_16* WINPR_RESTRICT regionRects,
+                                  UINT32 numRegionRects)
+{
+	primitives_t* prims = primitives_get();
+
+	WINPR_ASSERT(context);
+
+	const UINT32 alignedWidth =
+	    context->width + ((context->width % 16 != 0) ? 16 - context->width % 16 : 0);
+	const UINT32 alignedHeight =
+	    context->height + ((context->height % 16 != 0) ? 16 - context->height % 16 : 0);
 
-		if (!submit_object(&context->work_objects[waitCount], cb, current, context))
-			goto fail;
+	/* Combine and convert each rectangle in one pass, with a GPU backend the frame does not
+	 * leave the device in between. */
+	for (UINT32 x = 0; x < numRegionRects; x++)
+	{
+		if (!check_rect(context, &regionRects[x], context->width, context->height))
+			continue;
+
+		const RECTANGLE_16 rect = clamp(context, &regionRects[x], srcYuvHeight);
+		if (rectangle_is_empty(&rect))
+			continue;
+
+		if (prims->YUV420CombineToRGB_8u_P3AC4R((avc444_frame_type)type, pYUVData, iStride,
+		                                        alignedWidth, alignedHeight, pYUVDstData,
+		                                        iDstStride, dest, nDstStep, DstFormat,
+		                                        &rect) != PRIMITIVES_SUCCESS)
+			WLog_WARN(TAG, "YUV420CombineToRGB_8u_P3AC4R failed");
 	}
 
-	rc = TRUE;
-fail:
-	free_objects(context->work_objects, context->work_object_count);
-	return rc;
+	return TRUE;
 }
 
 BOOL yuv444_context_decode(YUV_CONTEXT* WINPR_RESTRICT context, BYTE type,
@@ -627,6 +629,11 @@ BOOL yuv444_context_decode(YUV_CONTEXT* WINPR_RESTRICT context, BYTE type,
 		WLog_ERR(TAG, "YUV context set up for encoding, can not decode with it, aborting");
 		return FALSE;
 	}
+	if (!context->useThreads || (primitives_flags(primitives_get()) & PRIM_FLAGS_HAVE_EXTGPU))
+		return yuv444_combine_decode(context, type, pYUVData, iStride, srcYuvHeight, pYUVDstData,
+		                             iDstStride, DstFormat, dest, nDstStep, regionRects,
+		                             numRegionRects);
+
 	if (!pool_decode_rect(context, type, pYUVData, iStride, pYUVDstData, iDstStride, regionRects,
 	                      numRegionRects))
 		return FALSE;
@@ -795,7 +802,6 @@ static BOOL pool_encode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
                         BYTE* WINPR_RESTRICT pYUVChromaData[],
                         const RECTANGLE_16* WINPR_RESTRICT regionRects, UINT32 numRegionRects)
 {
-	BOOL rc = FALSE;
 	primitives_t* prims = primitives_get();
 	UINT32 waitCount = 0;
 
@@ -825,15 +831,6 @@ static BOOL pool_encode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 	}
 
 	/* case where we use threads */
-	for (UINT32 x = 0; x < numRegionRects; x++)
-	{
-		const RECTANGLE_16* rect = &regionRects[x];
-		const UINT32 height = rect->bottom - rect->top;
-		const UINT32 steps = (height + context->heightStep / 2) / context->heightStep;
-
-		waitCount += steps;
-	}
-
 	for (UINT32 x = 0; x < numRegionRects; x++)
 	{
 		const RECTANGLE_16* rect = &regionRects[x];
@@ -851,23 +848,19 @@ static BOOL pool_encode(YUV_CONTEXT* WINPR_RESTRICT context, PTP_WORK_CALLBACK c
 				         "YUV encoder: invalid number of tiles, only support less than %" PRIu32
 				         ", got %" PRIu32,
 				         context->work_object_count, waitCount);
-				goto fail;
+				return FALSE;
 			}
 
 			current = &context->work_enc_params[waitCount];
 			r.top += y * context->heightStep;
 			*current = pool_encode_fill(&r, context, pSrcData, nSrcStep, SrcFormat, iStride,
 			                            pYUVLumaData, pYUVChromaData);
-			if (!submit_object(&context->work_objects[waitCount], cb, current, context))
-				goto fail;
 			waitCount++;
 		}
 	}
 
-	rc = TRUE;
-fail:
-	free_objects(context->work_objects, context->work_object_count);
-	return rc;
+	return run_batch(context, cb, context->work_enc_params, sizeof(YUV_ENCODE_WORK_PARAM),
+	                 waitCount);
 }
 
 BOOL yuv420_context_encode(YUV_CONTEXT* WINPR_RESTRICT context, const BYTE* WINPR_RESTRICT pSrcData,
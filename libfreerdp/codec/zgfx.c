@@ -28,6 +28,8 @@
 #include <freerdp/log.h>
 #include <freerdp/codec/zgfx.h>
 
+#include "bulk.h"
+
 #define TAG FREERDP_TAG("codec")
 
 /**
@@ -40,6 +42,62 @@
  * Minimum match length: 3 bytes
  */
 
+#define ZGFX_HASH_BITS 15
+#define ZGFX_HASH_SIZE (1u << ZGFX_HASH_BITS)
+#define ZGFX_CHAIN_SIZE 65536u
+#define ZGFX_CHAIN_MASK (ZGFX_CHAIN_SIZE - 1u)
+#define ZGFX_HASH_EMPTY UINT32_MAX
+
+#define ZGFX_MIN_MATCH 3
+#define ZGFX_MAX_UNENCODED 32767
+#define ZGFX_DEFAULT_COMPRESSION_LEVEL 3
+#define ZGFX_MAX_COMPRESSION_LEVEL 9
+
+/* History size mandated by [MS-RDPEGFX] 2.2.5.1 */
+#define ZGFX_HISTORY_SIZE 2500000u
+/* Largest output of a single encoded segment */
+#define ZGFX_OUTPUT_SIZE 65536u
+/* Largest output of a single decoded segment */
+#define ZGFX_WINDOW_SEGMENT_SIZE 65536u
+/* Decompressor window size in history sizes, the history is moved once per 3 history sizes */
+#define ZGFX_WINDOW_HISTORY_FACTOR 4u
+
+/**
+ * Match finder tuning per compression level:
+ *
+ * maxChain: number of hash chain candidates inspected per position
+ * niceLength: stop searching once a match of this length was found
+ * lazy: try a match at the next position before committing
+ */
+typedef struct
+{
+	UINT32 maxChain;
+	UINT32 niceLength;
+	BOOL lazy;
+} ZGFX_LEVEL;
+
+static const ZGFX_LEVEL ZGFX_LEVEL_TABLE[ZGFX_MAX_COMPRESSION_LEVEL + 1] = {
+	{ 0, 0, FALSE },     /* 0: store only */
+	{ 1, 16, FALSE },    /* 1 */
+	{ 4, 32, FALSE },    /* 2 */
+	{ 8, 64, FALSE },    /* 3 */
+	{ 16, 128, FALSE },  /* 4 */
+	{ 16, 128, TRUE },   /* 5 */
+	{ 32, 256, TRUE },   /* 6 */
+	{ 64, 512, TRUE },   /* 7 */
+	{ 256, 1024, TRUE }, /* 8 */
+	{ 1024, 4096, TRUE } /* 9 */
+};
+
+typedef struct
+{
+	BYTE* buffer;
+	size_t length;
+	size_t position;
+	UINT64 accumulator;
+	UINT32 count;
+} ZGFX_BIT_WRITER;
+
 typedef struct
 {
 	UINT32 prefixLength;
@@ -61,12 +119,25 @@ struct S_ZGFX_CONTEXT
 	UINT32 BitsCurrent;
 	UINT32 cBitsCurrent;
 
-	BYTE OutputBuffer[65536];
 	UINT32 OutputCount;
+	UINT32 HistoryBufferSize;
+
+	/* Decompressor state, segments are decoded in place right behind the history */
+	BYTE* Window;
+	size_t WindowSize;
+	size_t WindowIndex;
+	const BYTE* OutputData;
 
-	BYTE HistoryBuffer[2500000];
+	/* Compressor state */
+	BYTE* OutputBuffer;
+	BYTE* HistoryBuffer;
 	UINT32 HistoryIndex;
-	UINT32 HistoryBufferSize;
+	UINT32 CompressionLevel;
+	UINT32 HistoryAvailable;
+	UINT32* HashHead;
+	UINT32* HashChain;
+	UINT16 LiteralCode[256];
+	BYTE LiteralBits[256];
 };
 
 static const ZGFX_TOKEN ZGFX_TOKEN_TABLE[] = {
@@ -168,52 +239,35 @@ static INLINE void zgfx_history_buffer_ring_write(ZGFX_CONTEXT* WINPR_RESTRICT z
 	}
 }
 
-static INLINE void zgfx_history_buffer_ring_read(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, int offset,
-                                                 BYTE* WINPR_RESTRICT dst, UINT32 count)
+/**
+ * Make room for the next decoded segment in the decompressor window.
+ * The window is a linear buffer holding the history followed by the output, so the output
+ * needs no extra copy into a history ring and matches are plain backward copies. Once the
+ * window is full the last HistoryBufferSize bytes are moved back to its start.
+ */
+static INLINE BOOL zgfx_window_prepare(ZGFX_CONTEXT* WINPR_RESTRICT zgfx)
 {
-	UINT32 front = 0;
-	UINT32 index = 0;
-	INT32 bytes = 0;
-	UINT32 valid = 0;
-	INT32 bytesLeft = 0;
-	BYTE* dptr = dst;
-	BYTE* origDst = dst;
-
-	if ((count <= 0) || (count > INT32_MAX))
-		return;
-
-	bytesLeft = (INT32)count;
-	index = (zgfx->HistoryIndex + zgfx->HistoryBufferSize - offset) % zgfx->HistoryBufferSize;
-	bytes = MIN(bytesLeft, offset);
+	const size_t historySize = zgfx->HistoryBufferSize;
 
-	if ((index + bytes) <= zgfx->HistoryBufferSize)
+	if (!zgfx->Window)
 	{
-		CopyMemory(dptr, &(zgfx->HistoryBuffer[index]), bytes);
-	}
-	else
-	{
-		front = zgfx->HistoryBufferSize - index;
-		CopyMemory(dptr, &(zgfx->HistoryBuffer[index]), front);
-		CopyMemory(&dptr[front], zgfx->HistoryBuffer, bytes - front);
-	}
+		zgfx->WindowSize = ZGFX_WINDOW_HISTORY_FACTOR * historySize + ZGFX_WINDOW_SEGMENT_SIZE;
+		zgfx->Window = winpr_large_calloc(zgfx->WindowSize, sizeof(BYTE), 64);
 
-	if ((bytesLeft -= bytes) == 0)
-		return;
+		if (!zgfx->Window)
+			return FALSE;
 
-	dptr += bytes;
-	valid = bytes;
+		/* the zeroed start of the window stands in for the initially empty history */
+		zgfx->WindowIndex = historySize;
+	}
 
-	do
+	if (zgfx->WindowIndex + ZGFX_WINDOW_SEGMENT_SIZE > zgfx->WindowSize)
 	{
-		bytes = valid;
-
-		if (bytes > bytesLeft)
-			bytes = bytesLeft;
+		MoveMemory(zgfx->Window, &zgfx->Window[zgfx->WindowIndex - historySize], historySize);
+		zgfx->WindowIndex = historySize;
+	}
 
-		CopyMemory(dptr, origDst, bytes);
-		dptr += bytes;
-		valid <<= 1;
-	} while ((bytesLeft -= bytes) > 0);
+	return TRUE;
 }
 
 static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
@@ -247,15 +301,20 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 	if (!Stream_SafeSeek(stream, cbSegment))
 		return FALSE;
 
+	if (!zgfx_window_prepare(zgfx))
+		return FALSE;
+
+	BYTE* output = &zgfx->Window[zgfx->WindowIndex];
+	zgfx->OutputData = output;
+
 	if (!(flags & PACKET_COMPRESSED))
 	{
-		zgfx_history_buffer_ring_write(zgfx, pbSegment, cbSegment);
-
-		if (cbSegment > sizeof(zgfx->OutputBuffer))
+		if (cbSegment > ZGFX_WINDOW_SEGMENT_SIZE)
 			return FALSE;
 
-		CopyMemory(zgfx->OutputBuffer, pbSegment, cbSegment);
-		zgfx->OutputCount = cbSegment;
+		CopyMemory(output, pbSegment, cbSegment);
+		zgfx->OutputCount = (UINT32)cbSegment;
+		zgfx->WindowIndex += cbSegment;
 		return TRUE;
 	}
 
@@ -291,15 +350,11 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 					/* Literal */
 					zgfx_GetBits(zgfx, ZGFX_TOKEN_TABLE[opIndex].valueBits);
 					c = (BYTE)(ZGFX_TOKEN_TABLE[opIndex].valueBase + zgfx->bits);
-					zgfx->HistoryBuffer[zgfx->HistoryIndex] = c;
-
-					if (++zgfx->HistoryIndex == zgfx->HistoryBufferSize)
-						zgfx->HistoryIndex = 0;
 
-					if (zgfx->OutputCount >= sizeof(zgfx->OutputBuffer))
+					if (zgfx->OutputCount >= ZGFX_WINDOW_SEGMENT_SIZE)
 						return FALSE;
 
-					zgfx->OutputBuffer[zgfx->OutputCount++] = c;
+					output[zgfx->OutputCount++] = c;
 				}
 				else
 				{
@@ -332,13 +387,15 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 							count += zgfx->bits;
 						}
 
-						if (count > sizeof(zgfx->OutputBuffer) - zgfx->OutputCount)
+						if (count > ZGFX_WINDOW_SEGMENT_SIZE - zgfx->OutputCount)
 							return FALSE;
 
-						zgfx_history_buffer_ring_read(
-						    zgfx, distance, &(zgfx->OutputBuffer[zgfx->OutputCount]), count);
-						zgfx_history_buffer_ring_write(
-						    zgfx, &(zgfx->OutputBuffer[zgfx->OutputCount]), count);
+						/* the window always holds HistoryBufferSize bytes before the output */
+						if (distance > zgfx->HistoryBufferSize)
+							return FALSE;
+
+						BYTE* dst = &output[zgfx->OutputCount];
+						bulk_copy_match(dst, dst - distance, count);
 						zgfx->OutputCount += count;
 					}
 					else
@@ -350,16 +407,14 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 						zgfx->cBitsCurrent = 0;
 						zgfx->BitsCurrent = 0;
 
-						if (count > sizeof(zgfx->OutputBuffer) - zgfx->OutputCount)
+						if (count > ZGFX_WINDOW_SEGMENT_SIZE - zgfx->OutputCount)
 							return FALSE;
 						else if (count > zgfx->cBitsRemaining / 8)
 							return FALSE;
 						else if (zgfx->pbInputCurrent + count > zgfx->pbInputEnd)
 							return FALSE;
 
-						CopyMemory(&(zgfx->OutputBuffer[zgfx->OutputCount]), zgfx->pbInputCurrent,
-						           count);
-						zgfx_history_buffer_ring_write(zgfx, zgfx->pbInputCurrent, count);
+						CopyMemory(&output[zgfx->OutputCount], zgfx->pbInputCurrent, count);
 						zgfx->pbInputCurrent += count;
 						zgfx->cBitsRemaining -= (8 * count);
 						zgfx->OutputCount += count;
@@ -371,6 +426,7 @@ static INLINE BOOL zgfx_decompress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 		}
 	}
 
+	zgfx->WindowIndex += zgfx->OutputCount;
 	return TRUE;
 }
 
@@ -404,7 +460,7 @@ static INLINE BOOL zgfx_append(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
 	if (!tmp)
 		return FALSE;
 	*ppConcatenated = tmp;
-	CopyMemory(&tmp[used], zgfx->OutputBuffer, zgfx->OutputCount);
+	CopyMemory(&tmp[used], zgfx->OutputData, zgfx->OutputCount);
 	*pUsed = used + zgfx->OutputCount;
 	return TRUE;
 }
@@ -493,20 +549,419 @@ fail:
 	return status;
 }
 
+static INLINE BOOL zgfx_write_bits(ZGFX_BIT_WRITER* WINPR_RESTRICT bs, UINT32 value,
+                                   UINT32 nbits)
+{
+	WINPR_ASSERT(nbits <= 32);
+
+	bs->accumulator = (bs->accumulator << nbits) | value;
+	bs->count += nbits;
+
+	while (bs->count >= 8)
+	{
+		if (bs->position >= bs->length)
+			return FALSE;
+
+		bs->count -= 8;
+		bs->buffer[bs->position++] = (BYTE)(bs->accumulator >> bs->count);
+	}
+
+	bs->accumulator &= (1ull << bs->count) - 1ull;
+	return TRUE;
+}
+
+static INLINE UINT32 zgfx_pad_bits(const ZGFX_BIT_WRITER* WINPR_RESTRICT bs)
+{
+	return (8u - (bs->count % 8u)) % 8u;
+}
+
+static INLINE const ZGFX_TOKEN* zgfx_distance_token(UINT32 distance)
+{
+	for (size_t x = 0; ZGFX_TOKEN_TABLE[x].prefixLength != 0; x++)
+	{
+		const ZGFX_TOKEN* token = &ZGFX_TOKEN_TABLE[x];
+
+		if (token->tokenType != 1)
+			continue;
+
+		if ((distance >= token->valueBase) &&
+		    (distance - token->valueBase < (1u << token->valueBits)))
+			return token;
+	}
+
+	return NULL;
+}
+
+static INLINE UINT32 zgfx_count_bits(UINT32 count)
+{
+	WINPR_ASSERT(count >= ZGFX_MIN_MATCH);
+
+	if (count == 3)
+		return 1;
+
+	/* '1' + (k ones) + '0' + (k + 2) bits, count in [2^(k+2), 2^(k+3)) */
+	UINT32 k = 0;
+	while ((count >> (k + 3)) != 0)
+		k++;
+	return 2 * k + 4;
+}
+
+static INLINE UINT32 zgfx_match_bits(UINT32 distance, UINT32 count)
+{
+	const ZGFX_TOKEN* token = zgfx_distance_token(distance);
+
+	if (!token)
+		return UINT32_MAX;
+
+	return token->prefixLength + token->valueBits + zgfx_count_bits(count);
+}
+
+static INLINE BOOL zgfx_write_literal(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                      ZGFX_BIT_WRITER* WINPR_RESTRICT bs, BYTE c)
+{
+	return zgfx_write_bits(bs, zgfx->LiteralCode[c], zgfx->LiteralBits[c]);
+}
+
+static INLINE BOOL zgfx_write_match(ZGFX_BIT_WRITER* WINPR_RESTRICT bs, UINT32 distance,
+                                    UINT32 count)
+{
+	const ZGFX_TOKEN* token = zgfx_distance_token(distance);
+
+	if (!token)
+		return FALSE;
+
+	if (!zgfx_write_bits(bs, token->prefixCode, token->prefixLength))
+		return FALSE;
+
+	if (!zgfx_write_bits(bs, distance - token->valueBase, token->valueBits))
+		return FALSE;
+
+	if (count == 3)
+		return zgfx_write_bits(bs, 0, 1);
+
+	UINT32 k = 0;
+	while ((count >> (k + 3)) != 0)
+		k++;
+
+	/* leading '1', k continuation ones and the terminating '0' */
+	if (!zgfx_write_bits(bs, ((1u << (k + 1)) - 1u) << 1, k + 2))
+		return FALSE;
+
+	return zgfx_write_bits(bs, count - (1u << (k + 2)), k + 2);
+}
+
+static INLINE BOOL zgfx_write_unencoded(ZGFX_BIT_WRITER* WINPR_RESTRICT bs,
+                                        const BYTE* WINPR_RESTRICT pSrcData, UINT32 count)
+{
+	const ZGFX_TOKEN* token = zgfx_distance_token(0);
+
+	WINPR_ASSERT(token);
+	WINPR_ASSERT(count <= ZGFX_MAX_UNENCODED);
+
+	if (!zgfx_write_bits(bs, token->prefixCode, token->prefixLength))
+		return FALSE;
+
+	if (!zgfx_write_bits(bs, 0, token->valueBits))
+		return FALSE;
+
+	if (!zgfx_write_bits(bs, count, 15))
+		return FALSE;
+
+	/* The decoder discards the remaining bits of the current byte */
+	if (!zgfx_write_bits(bs, 0, zgfx_pad_bits(bs)))
+		return FALSE;
+
+	if (bs->length - bs->position < count)
+		return FALSE;
+
+	CopyMemory(&bs->buffer[bs->position], pSrcData, count);
+	bs->position += count;
+	return TRUE;
+}
+
+static INLINE BOOL zgfx_write_literals(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                       ZGFX_BIT_WRITER* WINPR_RESTRICT bs,
+                                       const BYTE* WINPR_RESTRICT pSrcData, UINT32 count)
+{
+	while (count > 0)
+	{
+		const UINT32 run = MIN(count, ZGFX_MAX_UNENCODED);
+		size_t literalBits = 0;
+
+		for (UINT32 x = 0; x < run; x++)
+			literalBits += zgfx->LiteralBits[pSrcData[x]];
+
+		/* token + distance + count + worst case alignment */
+		const size_t unencodedBits = 5ull + 5ull + 15ull + 7ull + 8ull * run;
+
+		if (unencodedBits < literalBits)
+		{
+			if (!zgfx_write_unencoded(bs, pSrcData, run))
+				return FALSE;
+		}
+		else
+		{
+			for (UINT32 x = 0; x < run; x++)
+			{
+				if (!zgfx_write_literal(zgfx, bs, pSrcData[x]))
+					return FALSE;
+			}
+		}
+
+		pSrcData += run;
+		count -= run;
+	}
+
+	return TRUE;
+}
+
+static INLINE UINT32 zgfx_hash(const BYTE* WINPR_RESTRICT data)
+{
+	const UINT32 value = ((UINT32)data[0] << 16) | ((UINT32)data[1] << 8) | data[2];
+	return (value * 2654435761u) >> (32 - ZGFX_HASH_BITS);
+}
+
+static INLINE void zgfx_hash_insert(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                    const BYTE* WINPR_RESTRICT data, UINT32 index)
+{
+	const UINT32 hash = zgfx_hash(data);
+	zgfx->HashChain[index & ZGFX_CHAIN_MASK] = zgfx->HashHead[hash];
+	zgfx->HashHead[hash] = index;
+}
+
+static INLINE UINT32 zgfx_match_length(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx, UINT32 index,
+                                       const BYTE* WINPR_RESTRICT data, UINT32 maxLength)
+{
+	UINT32 length = 0;
+
+	while (length < maxLength)
+	{
+		const UINT32 run = MIN(maxLength - length, zgfx->HistoryBufferSize - index);
+		const BYTE* history = &zgfx->HistoryBuffer[index];
+		const BYTE* current = &data[length];
+		UINT32 x = 0;
+
+		while ((x + 8 <= run) && (memcmp(&history[x], &current[x], 8) == 0))
+			x += 8;
+
+		while ((x < run) && (history[x] == current[x]))
+			x++;
+
+		length += x;
+
+		if (x < run)
+			break;
+
+		index = 0;
+	}
+
+	return length;
+}
+
+/**
+ * Find the longest match for the data at history ring position index.
+ *
+ * Candidates are verified against the history buffer, so stale hash chain
+ * entries only cost time and never produce an invalid match.
+ */
+static INLINE UINT32 zgfx_find_match(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                     const ZGFX_LEVEL* WINPR_RESTRICT level,
+                                     const BYTE* WINPR_RESTRICT data, UINT32 index,
+                                     UINT32 maxLength, UINT32 maxDistance,
+                                     UINT32* WINPR_RESTRICT pDistance)
+{
+	UINT32 bestLength = 0;
+	UINT32 lastDistance = 0;
+	UINT32 candidate = zgfx->HashHead[zgfx_hash(data)];
+
+	for (UINT32 chain = 0; (chain < level->maxChain) && (candidate != ZGFX_HASH_EMPTY); chain++)
+	{
+		const UINT32 distance =
+		    (index + zgfx->HistoryBufferSize - candidate) % zgfx->HistoryBufferSize;
+
+		if ((distance <= lastDistance) || (distance > maxDistance))
+			break;
+
+		const UINT32 probe = (candidate + bestLength) % zgfx->HistoryBufferSize;
+
+		if ((bestLength == 0) || (zgfx->HistoryBuffer[probe] == data[bestLength]))
+		{
+			const UINT32 length = zgfx_match_length(zgfx, candidate, data, maxLength);
+
+			/* Farther matches need more distance bits, prefer the cheaper encoding */
+			if ((length > bestLength) &&
+			    ((bestLength < ZGFX_MIN_MATCH) ||
+			     (9ll * length - zgfx_match_bits(distance, length) >
+			      9ll * bestLength - zgfx_match_bits(*pDistance, bestLength))))
+			{
+				bestLength = length;
+				*pDistance = distance;
+
+				if ((length >= level->niceLength) || (length == maxLength))
+					break;
+			}
+		}
+
+		lastDistance = distance;
+		candidate = zgfx->HashChain[candidate & ZGFX_CHAIN_MASK];
+	}
+
+	return (bestLength >= ZGFX_MIN_MATCH) ? bestLength : 0;
+}
+
+/**
+ * Estimate the number of bits saved by encoding length bytes as a match
+ * instead of literals. Only the head of long matches is inspected.
+ */
+static INLINE INT64 zgfx_match_gain(const ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                    const BYTE* WINPR_RESTRICT data, UINT32 length,
+                                    UINT32 distance)
+{
+	if (length < ZGFX_MIN_MATCH)
+		return 0;
+
+	const UINT32 head = MIN(length, 32);
+	INT64 literalBits = 9ll * (length - head);
+
+	for (UINT32 x = 0; x < head; x++)
+		literalBits += zgfx->LiteralBits[data[x]];
+
+	return literalBits - zgfx_match_bits(distance, length);
+}
+
+/**
+ * Encode a segment into zgfx->OutputBuffer.
+ *
+ * The segment data must already be part of the history ring, starting at
+ * ring position start.
+ *
+ * @return the number of bytes written, 0 if the result would not be smaller
+ *         than the source.
+ */
+static size_t zgfx_compress_segment_data(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                         const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
+                                         UINT32 start, UINT32 available)
+{
+	const ZGFX_LEVEL* level = &ZGFX_LEVEL_TABLE[zgfx->CompressionLevel];
+	/* Matches must not reach into history overwritten by this segment */
+	const UINT32 windowSize = zgfx->HistoryBufferSize - ZGFX_SEGMENTED_MAXSIZE;
+	ZGFX_BIT_WRITER bs = { 0 };
+	UINT32 literalStart = 0;
+	UINT32 x = 0;
+
+	bs.buffer = zgfx->OutputBuffer;
+	bs.length = MIN(ZGFX_OUTPUT_SIZE, SrcSize);
+
+	while (x < SrcSize)
+	{
+		UINT32 length = 0;
+		UINT32 distance = 0;
+		const UINT32 index = (start + x) % zgfx->HistoryBufferSize;
+
+		if (SrcSize - x < ZGFX_MIN_MATCH)
+			break;
+
+		length = zgfx_find_match(zgfx, level, &pSrcData[x], index, SrcSize - x,
+		                         MIN(windowSize, available + x), &distance);
+		zgfx_hash_insert(zgfx, &pSrcData[x], index);
+
+		if (level->lazy && (length > 0) && (length < level->niceLength) &&
+		    (SrcSize - x - 1 >= ZGFX_MIN_MATCH))
+		{
+			UINT32 nextDistance = 0;
+			const UINT32 nextIndex = (index + 1) % zgfx->HistoryBufferSize;
+			const UINT32 nextLength =
+			    zgfx_find_match(zgfx, level, &pSrcData[x + 1], nextIndex, SrcSize - x - 1,
+			                    MIN(windowSize, available + x + 1), &nextDistance);
+
+			if ((nextLength > length) &&
+			    (zgfx_match_gain(zgfx, &pSrcData[x + 1], nextLength, nextDistance) >
+			     zgfx_match_gain(zgfx, &pSrcData[x], length, distance) +
+			         zgfx->LiteralBits[pSrcData[x]]))
+			{
+				x++;
+				zgfx_hash_insert(zgfx, &pSrcData[x], nextIndex);
+				length = nextLength;
+				distance = nextDistance;
+			}
+		}
+
+		if (zgfx_match_gain(zgfx, &pSrcData[x], length, distance) <= 0)
+		{
+			x++;
+			continue;
+		}
+
+		if (!zgfx_write_literals(zgfx, &bs, &pSrcData[literalStart], x - literalStart))
+			return 0;
+
+		if (!zgfx_write_match(&bs, distance, length))
+			return 0;
+
+		for (UINT32 y = 1; (y < length) && (x + y + ZGFX_MIN_MATCH <= SrcSize); y++)
+			zgfx_hash_insert(zgfx, &pSrcData[x + y], (index + y) % zgfx->HistoryBufferSize);
+
+		x += length;
+		literalStart = x;
+	}
+
+	if (!zgfx_write_literals(zgfx, &bs, &pSrcData[literalStart], SrcSize - literalStart))
+		return 0;
+
+	/* The last byte holds the number of unused bits in the byte before it */
+	const UINT32 padding = zgfx_pad_bits(&bs);
+
+	if (!zgfx_write_bits(&bs, 0, padding))
+		return 0;
+
+	if (!zgfx_write_bits(&bs, padding, 8))
+		return 0;
+
+	if (bs.position >= SrcSize)
+		return 0;
+
+	return bs.position;
+}
+
 static BOOL zgfx_compress_segment(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, wStream* WINPR_RESTRICT s,
                                   const BYTE* WINPR_RESTRICT pSrcData, UINT32 SrcSize,
                                   UINT32* WINPR_RESTRICT pFlags)
 {
-	/* FIXME: Currently compression not implemented. Just copy the raw source */
-	if (!Stream_EnsureRemainingCapacity(s, SrcSize + 1))
+	size_t DstSize = 0;
+	BYTE header = ZGFX_PACKET_COMPR_TYPE_RDP8; /* RDP 8.0 compression format */
+	const UINT32 start = zgfx->HistoryIndex;
+	const UINT32 available = zgfx->HistoryAvailable;
+
+	WINPR_ASSERT(SrcSize <= ZGFX_SEGMENTED_MAXSIZE);
+
+	/* The decoder adds every segment to the history, compressed or not */
+	if (zgfx->HistoryBuffer)
+	{
+		zgfx_history_buffer_ring_write(zgfx, pSrcData, SrcSize);
+		zgfx->HistoryAvailable = MIN(zgfx->HistoryBufferSize, available + SrcSize);
+	}
+
+	/* Decompressor contexts own no history ring and send segments uncompressed */
+	if ((zgfx->CompressionLevel > 0) && zgfx->HistoryBuffer && zgfx->HashHead && zgfx->HashChain)
+		DstSize = zgfx_compress_segment_data(zgfx, pSrcData, SrcSize, start, available);
+
+	if (!Stream_EnsureRemainingCapacity(s, ((DstSize > 0) ? DstSize : SrcSize) + 1))
 	{
 		WLog_ERR(TAG, "Stream_EnsureRemainingCapacity failed!");
 		return FALSE;
 	}
 
-	(*pFlags) |= ZGFX_PACKET_COMPR_TYPE_RDP8; /* RDP 8.0 compression format */
-	Stream_Write_UINT8(s, (*pFlags));         /* header (1 byte) */
-	Stream_Write(s, pSrcData, SrcSize);
+	if (DstSize > 0)
+		header |= PACKET_COMPRESSED;
+
+	(*pFlags) |= header;
+	Stream_Write_UINT8(s, header); /* header (1 byte) */
+
+	if (DstSize > 0)
+		Stream_Write(s, zgfx->OutputBuffer, DstSize);
+	else
+		Stream_Write(s, pSrcData, SrcSize);
+
 	return TRUE;
 }
 
@@ -609,6 +1064,63 @@ int zgfx_compress(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, const BYTE* WINPR_RESTRICT
 void zgfx_context_reset(ZGFX_CONTEXT* WINPR_RESTRICT zgfx, BOOL flush)
 {
 	zgfx->HistoryIndex = 0;
+	zgfx->HistoryAvailable = 0;
+	zgfx->OutputCount = 0;
+	zgfx->OutputData = NULL;
+
+	if (zgfx->Window)
+	{
+		/* back to the zeroed history a freshly allocated window starts with */
+		ZeroMemory(zgfx->Window, zgfx->HistoryBufferSize);
+		zgfx->WindowIndex = zgfx->HistoryBufferSize;
+	}
+
+	if (zgfx->HashHead)
+	{
+		for (size_t x = 0; x < ZGFX_HASH_SIZE; x++)
+			zgfx->HashHead[x] = ZGFX_HASH_EMPTY;
+	}
+}
+
+void zgfx_context_set_compression_level(ZGFX_CONTEXT* WINPR_RESTRICT zgfx,
+                                        DWORD CompressionLevel)
+{
+	WINPR_ASSERT(zgfx);
+	zgfx->CompressionLevel = MIN(CompressionLevel, ZGFX_MAX_COMPRESSION_LEVEL);
+}
+
+static void zgfx_init_literal_table(ZGFX_CONTEXT* WINPR_RESTRICT zgfx)
+{
+	for (size_t x = 0; ZGFX_TOKEN_TABLE[x].prefixLength != 0; x++)
+	{
+		const ZGFX_TOKEN* token = &ZGFX_TOKEN_TABLE[x];
+
+		if (token->tokenType != 0)
+			continue;
+
+		if (token->valueBits == 8)
+		{
+			/* Generic literal: prefix followed by the 8 bit value */
+			for (size_t c = 0; c < ARRAYSIZE(zgfx->LiteralCode); c++)
+			{
+				if (zgfx->LiteralBits[c] != 0)
+					continue;
+
+				zgfx->LiteralCode[c] = (UINT16)((token->prefixCode << 8) | c);
+				zgfx->LiteralBits[c] = (BYTE)(token->prefixLength + 8);
+			}
+		}
+		else
+		{
+			const size_t c = token->valueBase;
+
+			if ((zgfx->LiteralBits[c] == 0) || (zgfx->LiteralBits[c] > token->prefixLength))
+			{
+				zgfx->LiteralCode[c] = (UINT16)token->prefixCode;
+				zgfx->LiteralBits[c] = (BYTE)token->prefixLength;
+			}
+		}
+	}
 }
 
 ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
@@ -619,7 +1131,26 @@ ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
 	if (zgfx)
 	{
 		zgfx->Compressor = Compressor;
-		zgfx->HistoryBufferSize = sizeof(zgfx->HistoryBuffer);
+		zgfx->HistoryBufferSize = ZGFX_HISTORY_SIZE;
+
+		if (Compressor)
+		{
+			zgfx->OutputBuffer = (BYTE*)calloc(ZGFX_OUTPUT_SIZE, sizeof(BYTE));
+			zgfx->HistoryBuffer = (BYTE*)calloc(ZGFX_HISTORY_SIZE, sizeof(BYTE));
+			zgfx->HashHead = (UINT32*)calloc(ZGFX_HASH_SIZE, sizeof(UINT32));
+			zgfx->HashChain = (UINT32*)calloc(ZGFX_CHAIN_SIZE, sizeof(UINT32));
+
+			if (!zgfx->OutputBuffer || !zgfx->HistoryBuffer || !zgfx->HashHead ||
+			    !zgfx->HashChain)
+			{
+				zgfx_context_free(zgfx);
+				return NULL;
+			}
+
+			zgfx->CompressionLevel = ZGFX_DEFAULT_COMPRESSION_LEVEL;
+			zgfx_init_literal_table(zgfx);
+		}
+
 		zgfx_context_reset(zgfx, FALSE);
 	}
 
@@ -628,5 +1159,13 @@ ZGFX_CONTEXT* zgfx_context_new(BOOL Compressor)
 
 void zgfx_context_free(ZGFX_CONTEXT* zgfx)
 {
+	if (!zgfx)
+		return;
+
+	free(zgfx->OutputBuffer);
+	free(zgfx->HistoryBuffer);
+	free(zgfx->HashHead);
+	free(zgfx->HashChain);
+	winpr_large_free(zgfx->Window);
 	free(zgfx);
 }
@@ -195,6 +195,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_DumpRemoteFx:
 			return settings->DumpRemoteFx;
 
+		case FreeRDP_DynamicChannelCompression:
+			return settings->DynamicChannelCompression;
+
 		case FreeRDP_DynamicDaylightTimeDisabled:
 			return settings->DynamicDaylightTimeDisabled;
 
@@ -222,6 +225,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_FastPathInput:
 			return settings->FastPathInput;
 
+		case FreeRDP_FastPathInputBatching:
+			return settings->FastPathInputBatching;
+
 		case FreeRDP_FastPathOutput:
 			return settings->FastPathOutput;
 
@@ -276,6 +282,12 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_GfxH264:
 			return settings->GfxH264;
 
+		case FreeRDP_GfxH264DmaBuf:
+			return settings->GfxH264DmaBuf;
+
+		case FreeRDP_GfxParallelDecode:
+			return settings->GfxParallelDecode;
+
 		case FreeRDP_GfxPlanar:
 			return settings->GfxPlanar;
 
@@ -297,6 +309,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_GfxThinClient:
 			return settings->GfxThinClient;
 
+		case FreeRDP_GfxZeroCopyOutput:
+			return settings->GfxZeroCopyOutput;
+
 		case FreeRDP_GrabKeyboard:
 			return settings->GrabKeyboard;
 
@@ -378,6 +393,9 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_MultiTouchInput:
 			return settings->MultiTouchInput;
 
+		case FreeRDP_MultitransportUdp:
+			return settings->MultitransportUdp;
+
 		case FreeRDP_NSCodec:
 			return settings->NSCodec;
 
@@ -588,9 +606,15 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_SynchronousStaticChannels:
 			return settings->SynchronousStaticChannels;
 
+		case FreeRDP_TcpAdaptiveBuffers:
+			return settings->TcpAdaptiveBuffers;
+
 		case FreeRDP_TcpKeepAlive:
 			return settings->TcpKeepAlive;
 
+		case FreeRDP_TlsKernelOffload:
+			return settings->TlsKernelOffload;
+
 		case FreeRDP_TlsSecurity:
 			return settings->TlsSecurity;
 
@@ -606,6 +630,12 @@ BOOL freerdp_settings_get_bool(const rdpSettings* settings, FreeRDP_Settings_Key
 		case FreeRDP_TransportDumpReplayNodelay:
 			return settings->TransportDumpReplayNodelay;
 
+		case FreeRDP_TransportIoUring:
+			return settings->TransportIoUring;
+
+		case FreeRDP_TransportSendQueue:
+			return settings->TransportSendQueue;
+
 		case FreeRDP_UnicodeInput:
 			return settings->UnicodeInput;
 
@@ -844,6 +874,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->DumpRemoteFx = cnv.c;
 			break;
 
+		case FreeRDP_DynamicChannelCompression:
+			settings->DynamicChannelCompression = cnv.c;
+			break;
+
 		case FreeRDP_DynamicDaylightTimeDisabled:
 			settings->DynamicDaylightTimeDisabled = cnv.c;
 			break;
@@ -880,6 +914,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->FastPathInput = cnv.c;
 			break;
 
+		case FreeRDP_FastPathInputBatching:
+			settings->FastPathInputBatching = cnv.c;
+			break;
+
 		case FreeRDP_FastPathOutput:
 			settings->FastPathOutput = cnv.c;
 			break;
@@ -952,6 +990,14 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->GfxH264 = cnv.c;
 			break;
 
+		case FreeRDP_GfxH264DmaBuf:
+			settings->GfxH264DmaBuf = cnv.c;
+			break;
+
+		case FreeRDP_GfxParallelDecode:
+			settings->GfxParallelDecode = cnv.c;
+			break;
+
 		case FreeRDP_GfxPlanar:
 			settings->GfxPlanar = cnv.c;
 			break;
@@ -980,6 +1026,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->GfxThinClient = cnv.c;
 			break;
 
+		case FreeRDP_GfxZeroCopyOutput:
+			settings->GfxZeroCopyOutput = cnv.c;
+			break;
+
 		case FreeRDP_GrabKeyboard:
 			settings->GrabKeyboard = cnv.c;
 			break;
@@ -1088,6 +1138,10 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->MultiTouchInput = cnv.c;
 			break;
 
+		case FreeRDP_MultitransportUdp:
+			settings->MultitransportUdp = cnv.c;
+			break;
+
 		case FreeRDP_NSCodec:
 			settings->NSCodec = cnv.c;
 			break;
@@ -1368,10 +1422,18 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->SynchronousStaticChannels = cnv.c;
 			break;
 
+		case FreeRDP_TcpAdaptiveBuffers:
+			settings->TcpAdaptiveBuffers = cnv.c;
+			break;
+
 		case FreeRDP_TcpKeepAlive:
 			settings->TcpKeepAlive = cnv.c;
 			break;
 
+		case FreeRDP_TlsKernelOffload:
+			settings->TlsKernelOffload = cnv.c;
+			break;
+
 		case FreeRDP_TlsSecurity:
 			settings->TlsSecurity = cnv.c;
 			break;
@@ -1392,6 +1454,14 @@ BOOL freerdp_settings_set_bool(rdpSettings* settings, FreeRDP_Settings_Keys_Bool
 			settings->TransportDumpReplayNodelay = cnv.c;
 			break;
 
+		case FreeRDP_TransportIoUring:
+			settings->TransportIoUring = cnv.c;
+			break;
+
+		case FreeRDP_TransportSendQueue:
+			settings->TransportSendQueue = cnv.c;
+			break;
+
 		case FreeRDP_UnicodeInput:
 			settings->UnicodeInput = cnv.c;
 			break;
@@ -1619,6 +1689,12 @@ UINT32 freerdp_settings_get_uint32(const rdpSettings* settings, FreeRDP_Settings
 		case FreeRDP_AcceptedCertLength:
 			return settings->AcceptedCertLength;
 
+		case FreeRDP_AudioEncoderBitrate:
+			return settings->AudioEncoderBitrate;
+
+		case FreeRDP_AudioEncoderComplexity:
+			return settings->AudioEncoderComplexity;
+
 		case FreeRDP_AuthenticationLevel:
 			return settings->AuthenticationLevel;
 
@@ -1667,6 +1743,9 @@ UINT32 freerdp_settings_get_uint32(const rdpSettings* settings, FreeRDP_Settings
 		case FreeRDP_CompDeskSupportLevel:
 			return settings->CompDeskSupportLevel;
 
+		case FreeRDP_CompressionEffort:
+			return settings->CompressionEffort;
+
 		case FreeRDP_CompressionLevel:
 			return settings->CompressionLevel;
 
@@ -1970,6 +2049,9 @@ UINT32 freerdp_settings_get_uint32(const rdpSettings* settings, FreeRDP_Settings
 		case FreeRDP_TcpAckTimeout:
 			return settings->TcpAckTimeout;
 
+		case FreeRDP_TcpBusyPoll:
+			return settings->TcpBusyPoll;
+
 		case FreeRDP_TcpConnectTimeout:
 			return settings->TcpConnectTimeout;
 
@@ -1982,6 +2064,18 @@ UINT32 freerdp_settings_get_uint32(const rdpSettings* settings, FreeRDP_Settings
 		case FreeRDP_TcpKeepAliveRetries:
 			return settings->TcpKeepAliveRetries;
 
+		case FreeRDP_TcpNotSentLowat:
+			return settings->TcpNotSentLowat;
+
+		case FreeRDP_TcpReceiveBufferSize:
+			return settings->TcpReceiveBufferSize;
+
+		case FreeRDP_TcpSendBufferSize:
+			return settings->TcpSendBufferSize;
+
+		case FreeRDP_TcpSendQueueLimit:
+			return settings->TcpSendQueueLimit;
+
 		case FreeRDP_ThreadingFlags:
 			return settings->ThreadingFlags;
 
@@ -2022,6 +2116,14 @@ BOOL freerdp_settings_set_uint32(rdpSettings* settings, FreeRDP_Settings_Keys_UI
 			settings->AcceptedCertLength = cnv.c;
 			break;
 
+		case FreeRDP_AudioEncoderBitrate:
+			settings->AudioEncoderBitrate = cnv.c;
+			break;
+
+		case FreeRDP_AudioEncoderComplexity:
+			settings->AudioEncoderComplexity = cnv.c;
+			break;
+
 		case FreeRDP_AuthenticationLevel:
 			settings->AuthenticationLevel = cnv.c;
 			break;
@@ -2086,6 +2188,10 @@ BOOL freerdp_settings_set_uint32(rdpSettings* settings, FreeRDP_Settings_Keys_UI
 			settings->CompDeskSupportLevel = cnv.c;
 			break;
 
+		case FreeRDP_CompressionEffort:
+			settings->CompressionEffort = cnv.c;
+			break;
+
 		case FreeRDP_CompressionLevel:
 			settings->CompressionLevel = cnv.c;
 			break;
@@ -2490,6 +2596,10 @@ BOOL freerdp_settings_set_uint32(rdpSettings* settings, FreeRDP_Settings_Keys_UI
 			settings->TcpAckTimeout = cnv.c;
 			break;
 
+		case FreeRDP_TcpBusyPoll:
+			settings->TcpBusyPoll = cnv.c;
+			break;
+
 		case FreeRDP_TcpConnectTimeout:
 			settings->TcpConnectTimeout = cnv.c;
 			break;
@@ -2506,6 +2616,22 @@ BOOL freerdp_settings_set_uint32(rdpSettings* settings, FreeRDP_Settings_Keys_UI
 			settings->TcpKeepAliveRetries = cnv.c;
 			break;
 
+		case FreeRDP_TcpNotSentLowat:
+			settings->TcpNotSentLowat = cnv.c;
+			break;
+
+		case FreeRDP_TcpReceiveBufferSize:
+			settings->TcpReceiveBufferSize = cnv.c;
+			break;
+
+		case FreeRDP_TcpSendBufferSize:
+			settings->TcpSendBufferSize = cnv.c;
+			break;
+
+		case FreeRDP_TcpSendQueueLimit:
+			settings->TcpSendQueueLimit = cnv.c;
+			break;
+
 		case FreeRDP_ThreadingFlags:
 			settings->ThreadingFlags = cnv.c;
 			break;
@@ -2736,6 +2862,9 @@ const char* freerdp_settings_get_string(const rdpSettings* settings,
 		case FreeRDP_ConnectionFile:
 			return settings->ConnectionFile;
 
+		case FreeRDP_ConnectionTraceFile:
+			return settings->ConnectionTraceFile;
+
 		case FreeRDP_ContainerName:
 			return settings->ContainerName;
 
@@ -2949,6 +3078,9 @@ const char* freerdp_settings_get_string(const rdpSettings* settings,
 		case FreeRDP_TerminalDescriptor:
 			return settings->TerminalDescriptor;
 
+		case FreeRDP_ThreadAffinity:
+			return settings->ThreadAffinity;
+
 		case FreeRDP_TlsSecretsFile:
 			return settings->TlsSecretsFile;
 
@@ -3045,6 +3177,9 @@ char* freerdp_settings_get_string_writable(rdpSettings* settings, FreeRDP_Settin
 		case FreeRDP_ConnectionFile:
 			return settings->ConnectionFile;
 
+		case FreeRDP_ConnectionTraceFile:
+			return settings->ConnectionTraceFile;
+
 		case FreeRDP_ContainerName:
 			return settings->ContainerName;
 
@@ -3258,6 +3393,9 @@ char* freerdp_settings_get_string_writable(rdpSettings* settings, FreeRDP_Settin
 		case FreeRDP_TerminalDescriptor:
 			return settings->TerminalDescriptor;
 
+		case FreeRDP_ThreadAffinity:
+			return settings->ThreadAffinity;
+
 		case FreeRDP_TlsSecretsFile:
 			return settings->TlsSecretsFile;
 
@@ -3364,6 +3502,9 @@ BOOL freerdp_settings_set_string_(rdpSettings* settings, FreeRDP_Settings_Keys_S
 		case FreeRDP_ConnectionFile:
 			return update_string_(&settings->ConnectionFile, cnv.c, len);
 
+		case FreeRDP_ConnectionTraceFile:
+			return update_string_(&settings->ConnectionTraceFile, cnv.c, len);
+
 		case FreeRDP_ContainerName:
 			return update_string_(&settings->ContainerName, cnv.c, len);
 
@@ -3577,6 +3718,9 @@ BOOL freerdp_settings_set_string_(rdpSettings* settings, FreeRDP_Settings_Keys_S
 		case FreeRDP_TerminalDescriptor:
 			return update_string_(&settings->TerminalDescriptor, cnv.c, len);
 
+		case FreeRDP_ThreadAffinity:
+			return update_string_(&settings->ThreadAffinity, cnv.c, len);
+
 		case FreeRDP_TlsSecretsFile:
 			return update_string_(&settings->TlsSecretsFile, cnv.c, len);
 
@@ -3699,6 +3843,9 @@ BOOL freerdp_settings_set_string_copy_(rdpSettings* settings, FreeRDP_Settings_K
 		case FreeRDP_ConnectionFile:
 			return update_string_copy_(&settings->ConnectionFile, cnv.cc, len, cleanup);
 
+		case FreeRDP_ConnectionTraceFile:
+			return update_string_copy_(&settings->ConnectionTraceFile, cnv.cc, len, cleanup);
+
 		case FreeRDP_ContainerName:
 			return update_string_copy_(&settings->ContainerName, cnv.cc, len, cleanup);
 
@@ -3916,6 +4063,9 @@ BOOL freerdp_settings_set_string_copy_(rdpSettings* settings, FreeRDP_Settings_K
 		case FreeRDP_TerminalDescriptor:
 			return update_string_copy_(&settings->TerminalDescriptor, cnv.cc, len, cleanup);
 
+		case FreeRDP_ThreadAffinity:
+			return update_string_copy_(&settings->ThreadAffinity, cnv.cc, len, cleanup);
+
 		case FreeRDP_TlsSecretsFile:
 			return update_string_copy_(&settings->TlsSecretsFile, cnv.cc, len, cleanup);
 
@@ -90,6 +90,8 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_DrawGdiPlusEnabled, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_DrawGdiPlusEnabled" },
 	{ FreeRDP_DrawNineGridEnabled, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_DrawNineGridEnabled" },
 	{ FreeRDP_DumpRemoteFx, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_DumpRemoteFx" },
+	{ FreeRDP_DynamicChannelCompression, FREERDP_SETTINGS_TYPE_BOOL,
+	  "FreeRDP_DynamicChannelCompression" },
 	{ FreeRDP_DynamicDaylightTimeDisabled, FREERDP_SETTINGS_TYPE_BOOL,
 	  "FreeRDP_DynamicDaylightTimeDisabled" },
 	{ FreeRDP_DynamicResolutionUpdate, FREERDP_SETTINGS_TYPE_BOOL,
@@ -102,6 +104,7 @@ static const struct settings_str_entry settings_map[] = {
 	  "FreeRDP_ExternalCertificateManagement" },
 	{ FreeRDP_FIPSMode, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_FIPSMode" },
 	{ FreeRDP_FastPathInput, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_FastPathInput" },
+	{ FreeRDP_FastPathInputBatching, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_FastPathInputBatching" },
 	{ FreeRDP_FastPathOutput, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_FastPathOutput" },
 	{ FreeRDP_ForceEncryptedCsPdu, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_ForceEncryptedCsPdu" },
 	{ FreeRDP_ForceMultimon, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_ForceMultimon" },
@@ -125,6 +128,8 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_GfxAVC444, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxAVC444" },
 	{ FreeRDP_GfxAVC444v2, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxAVC444v2" },
 	{ FreeRDP_GfxH264, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxH264" },
+	{ FreeRDP_GfxH264DmaBuf, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxH264DmaBuf" },
+	{ FreeRDP_GfxParallelDecode, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxParallelDecode" },
 	{ FreeRDP_GfxPlanar, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxPlanar" },
 	{ FreeRDP_GfxProgressive, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxProgressive" },
 	{ FreeRDP_GfxProgressiveV2, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxProgressiveV2" },
@@ -132,6 +137,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_GfxSmallCache, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxSmallCache" },
 	{ FreeRDP_GfxSuspendFrameAck, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxSuspendFrameAck" },
 	{ FreeRDP_GfxThinClient, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxThinClient" },
+	{ FreeRDP_GfxZeroCopyOutput, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GfxZeroCopyOutput" },
 	{ FreeRDP_GrabKeyboard, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GrabKeyboard" },
 	{ FreeRDP_GrabMouse, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_GrabMouse" },
 	{ FreeRDP_HasExtendedMouseEvent, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_HasExtendedMouseEvent" },
@@ -160,6 +166,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_MstscCookieMode, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_MstscCookieMode" },
 	{ FreeRDP_MultiTouchGestures, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_MultiTouchGestures" },
 	{ FreeRDP_MultiTouchInput, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_MultiTouchInput" },
+	{ FreeRDP_MultitransportUdp, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_MultitransportUdp" },
 	{ FreeRDP_NSCodec, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_NSCodec" },
 	{ FreeRDP_NSCodecAllowDynamicColorFidelity, FREERDP_SETTINGS_TYPE_BOOL,
 	  "FreeRDP_NSCodecAllowDynamicColorFidelity" },
@@ -250,13 +257,17 @@ static const struct settings_str_entry settings_map[] = {
 	  "FreeRDP_SynchronousDynamicChannels" },
 	{ FreeRDP_SynchronousStaticChannels, FREERDP_SETTINGS_TYPE_BOOL,
 	  "FreeRDP_SynchronousStaticChannels" },
+	{ FreeRDP_TcpAdaptiveBuffers, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TcpAdaptiveBuffers" },
 	{ FreeRDP_TcpKeepAlive, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TcpKeepAlive" },
+	{ FreeRDP_TlsKernelOffload, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TlsKernelOffload" },
 	{ FreeRDP_TlsSecurity, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TlsSecurity" },
 	{ FreeRDP_ToggleFullscreen, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_ToggleFullscreen" },
 	{ FreeRDP_TransportDump, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportDump" },
 	{ FreeRDP_TransportDumpReplay, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportDumpReplay" },
 	{ FreeRDP_TransportDumpReplayNodelay, FREERDP_SETTINGS_TYPE_BOOL,
 	  "FreeRDP_TransportDumpReplayNodelay" },
+	{ FreeRDP_TransportIoUring, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportIoUring" },
+	{ FreeRDP_TransportSendQueue, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_TransportSendQueue" },
 	{ FreeRDP_UnicodeInput, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_UnicodeInput" },
 	{ FreeRDP_UnmapButtons, FREERDP_SETTINGS_TYPE_BOOL, "FreeRDP_UnmapButtons" },
 	{ FreeRDP_UseCommonStdioCallbacks, FREERDP_SETTINGS_TYPE_BOOL,
@@ -287,6 +298,9 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_TLSMinVersion, FREERDP_SETTINGS_TYPE_UINT16, "FreeRDP_TLSMinVersion" },
 	{ FreeRDP_TextANSICodePage, FREERDP_SETTINGS_TYPE_UINT16, "FreeRDP_TextANSICodePage" },
 	{ FreeRDP_AcceptedCertLength, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_AcceptedCertLength" },
+	{ FreeRDP_AudioEncoderBitrate, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_AudioEncoderBitrate" },
+	{ FreeRDP_AudioEncoderComplexity, FREERDP_SETTINGS_TYPE_UINT32,
+	  "FreeRDP_AudioEncoderComplexity" },
 	{ FreeRDP_AuthenticationLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_AuthenticationLevel" },
 	{ FreeRDP_AutoReconnectMaxRetries, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_AutoReconnectMaxRetries" },
@@ -306,6 +320,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_ColorPointerCacheSize, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_ColorPointerCacheSize" },
 	{ FreeRDP_CompDeskSupportLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CompDeskSupportLevel" },
+	{ FreeRDP_CompressionEffort, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CompressionEffort" },
 	{ FreeRDP_CompressionLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CompressionLevel" },
 	{ FreeRDP_ConnectionType, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_ConnectionType" },
 	{ FreeRDP_CookieMaxLength, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_CookieMaxLength" },
@@ -439,10 +454,15 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_TargetNetAddressCount, FREERDP_SETTINGS_TYPE_UINT32,
 	  "FreeRDP_TargetNetAddressCount" },
 	{ FreeRDP_TcpAckTimeout, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpAckTimeout" },
+	{ FreeRDP_TcpBusyPoll, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpBusyPoll" },
 	{ FreeRDP_TcpConnectTimeout, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpConnectTimeout" },
 	{ FreeRDP_TcpKeepAliveDelay, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpKeepAliveDelay" },
 	{ FreeRDP_TcpKeepAliveInterval, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpKeepAliveInterval" },
 	{ FreeRDP_TcpKeepAliveRetries, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpKeepAliveRetries" },
+	{ FreeRDP_TcpNotSentLowat, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpNotSentLowat" },
+	{ FreeRDP_TcpReceiveBufferSize, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpReceiveBufferSize" },
+	{ FreeRDP_TcpSendBufferSize, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpSendBufferSize" },
+	{ FreeRDP_TcpSendQueueLimit, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TcpSendQueueLimit" },
 	{ FreeRDP_ThreadingFlags, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_ThreadingFlags" },
 	{ FreeRDP_TlsSecLevel, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_TlsSecLevel" },
 	{ FreeRDP_VCChunkSize, FREERDP_SETTINGS_TYPE_UINT32, "FreeRDP_VCChunkSize" },
@@ -475,6 +495,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_ComputerName, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_ComputerName" },
 	{ FreeRDP_ConfigPath, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_ConfigPath" },
 	{ FreeRDP_ConnectionFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_ConnectionFile" },
+	{ FreeRDP_ConnectionTraceFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_ConnectionTraceFile" },
 	{ FreeRDP_ContainerName, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_ContainerName" },
 	{ FreeRDP_CspName, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_CspName" },
 	{ FreeRDP_CurrentPath, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_CurrentPath" },
@@ -572,6 +593,7 @@ static const struct settings_str_entry settings_map[] = {
 	{ FreeRDP_SspiModule, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_SspiModule" },
 	{ FreeRDP_TargetNetAddress, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TargetNetAddress" },
 	{ FreeRDP_TerminalDescriptor, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TerminalDescriptor" },
+	{ FreeRDP_ThreadAffinity, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_ThreadAffinity" },
 	{ FreeRDP_TlsSecretsFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TlsSecretsFile" },
 	{ FreeRDP_TransportDumpFile, FREERDP_SETTINGS_TYPE_STRING, "FreeRDP_TransportDumpFile" },
 	{ FreeRDP_UserSpecifiedServerName, FREERDP_SETTINGS_TYPE_STRING,
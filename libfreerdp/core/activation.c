@@ -312,7 +312,7 @@ static UINT32 rdp_load_persistent_key_list(rdpRdp* rdp, UINT64** pKeyList)
 	{
 		PERSISTENT_CACHE_ENTRY cacheEntry = { 0 };
 
-		if (persistent_cache_read_entry(persistent, &cacheEntry) < 1)
+		if (persistent_cache_read_key(persistent, &cacheEntry) < 1)
 			continue;
 
 		keyList[index] = cacheEntry.key64;
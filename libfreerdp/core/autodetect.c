@@ -502,6 +502,9 @@ static BOOL autodetect_recv_rtt_measure_response(rdpAutoDetect* autodetect,
 	    autodetect->netCharBaseRTT > autodetect->netCharAverageRTT)
 		autodetect->netCharBaseRTT = autodetect->netCharAverageRTT;
 
+	netestimate_add_rtt(autodetect->context->rdp->estimator,
+	                    (UINT32)MIN(1000ULL * autodetect->netCharAverageRTT, UINT32_MAX), 0);
+
 	IFCALLRET(autodetect->RTTMeasureResponse, success, autodetect, transport,
 	          autodetectRspPdu->sequenceNumber);
 	if (!success)
@@ -636,6 +639,31 @@ static BOOL autodetect_recv_bandwidth_measure_stop(rdpAutoDetect* autodetect,
 	                                                 autodetectReqPdu->sequenceNumber);
 }
 
+/* The socket buffers follow the bandwidth-delay product if FreeRDP_TcpAdaptiveBuffers is set */
+static void autodetect_tune_transport(rdpAutoDetect* autodetect, UINT32 bandwidth, UINT32 rtt)
+{
+	WINPR_ASSERT(autodetect);
+
+	rdpContext* context = autodetect->context;
+	if (!context || !context->rdp || !context->rdp->transport)
+		return;
+	if ((bandwidth == 0) || (rtt == 0))
+		return;
+
+	(void)transport_set_bandwidth_delay(context->rdp->transport, bandwidth, rtt);
+}
+
+/* The peer reported values, 0 for the fields it did not measure */
+static void autodetect_update_estimate(rdpAutoDetect* autodetect, UINT32 bandwidth, UINT32 rtt)
+{
+	WINPR_ASSERT(autodetect);
+	WINPR_ASSERT(autodetect->context);
+
+	rdpNetworkEstimator* estimator = autodetect->context->rdp->estimator;
+	netestimate_add_bandwidth(estimator, bandwidth);
+	netestimate_add_rtt(estimator, (UINT32)MIN(1000ULL * rtt, UINT32_MAX), 0);
+}
+
 static BOOL autodetect_recv_bandwidth_measure_results(rdpAutoDetect* autodetect,
                                                       RDP_TRANSPORT_TYPE transport, wStream* s,
                                                       const AUTODETECT_RSP_PDU* autodetectRspPdu)
@@ -662,6 +690,14 @@ static BOOL autodetect_recv_bandwidth_measure_results(rdpAutoDetect* autodetect,
 	Stream_Read_UINT32(s, timeDelta); /* timeDelta (4 bytes) */
 	Stream_Read_UINT32(s, byteCount); /* byteCount (4 bytes) */
 
+	/* Too short measurements are dominated by timer resolution, bytes per ms * 8 = kbit/s */
+	if (timeDelta >= 10)
+	{
+		const UINT32 bandwidth = (UINT32)MIN(8ULL * byteCount / timeDelta, UINT32_MAX);
+		netestimate_add_bandwidth(autodetect->context->rdp->estimator, bandwidth);
+		autodetect_tune_transport(autodetect, bandwidth, autodetect->netCharAverageRTT);
+	}
+
 	IFCALLRET(autodetect->BandwidthMeasureResults, success, autodetect, transport,
 	          autodetectRspPdu->sequenceNumber, autodetectRspPdu->responseType, timeDelta,
 	          byteCount);
@@ -700,6 +736,9 @@ static BOOL autodetect_recv_netchar_sync(rdpAutoDetect* autodetect, RDP_TRANSPOR
 	           "",
 	           bandwidth, rtt);
 
+	autodetect_update_estimate(autodetect, bandwidth, rtt);
+	autodetect_tune_transport(autodetect, bandwidth, rtt);
+
 	IFCALLRET(autodetect->NetworkCharacteristicsSync, success, autodetect, transport,
 	          autodetectRspPdu->sequenceNumber, bandwidth, rtt);
 	if (!success)
@@ -784,6 +823,9 @@ static BOOL autodetect_recv_netchar_request(rdpAutoDetect* autodetect, RDP_TRANS
 	           ", bandwidth=%" PRIu32 ", averageRTT=%" PRIu32 "",
 	           result.baseRTT, result.bandwidth, result.averageRTT);
 
+	autodetect_update_estimate(autodetect, result.bandwidth, result.averageRTT);
+	autodetect_tune_transport(autodetect, result.bandwidth, result.averageRTT);
+
 	IFCALLRET(autodetect->NetworkCharacteristicsResult, success, autodetect, transport,
 	          autodetectReqPdu->sequenceNumber, &result);
 	if (!success)
@@ -107,6 +107,7 @@ BOOL freerdp_channel_send(rdpRdp* rdp, UINT16 channelId, const BYTE* data, size_
 		flags = 0;
 	}
 
+	metrics_channel_bytes(rdp->context->metrics, channelId, channel->Name, 0, size);
 	return TRUE;
 }
 
@@ -144,6 +145,22 @@ BOOL freerdp_channel_process(freerdp* instance, wStream* s, UINT16 channelId, si
 		return FALSE;
 	}
 
+	rdpContext* context = instance->context;
+	if (context && context->metrics)
+	{
+		const char* name = NULL;
+		const rdpMcs* mcs = context->rdp->mcs;
+		for (UINT32 x = 0; x < mcs->channelCount; x++)
+		{
+			if (mcs->channels[x].ChannelId == channelId)
+			{
+				name = mcs->channels[x].Name;
+				break;
+			}
+		}
+		metrics_channel_bytes(context->metrics, channelId, name, chunkLength, 0);
+	}
+
 	IFCALLRET(instance->ReceiveChannelData, rc, instance, channelId, Stream_Pointer(s), chunkLength,
 	          flags, length);
 	if (!rc)
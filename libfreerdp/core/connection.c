@@ -310,6 +310,9 @@ BOOL rdp_client_connect(rdpRdp* rdp)
 	settings = rdp->settings;
 	WINPR_ASSERT(settings);
 
+	/* Redirects and reconnects start a new trace */
+	conntrace_reset(rdp->conntrace);
+
 	if (!rdp_client_reset_codecs(rdp->context))
 		return FALSE;
 
@@ -333,11 +336,13 @@ BOOL rdp_client_connect(rdpRdp* rdp)
 	UINT32 TcpConnectTimeout = freerdp_settings_get_uint32(settings, FreeRDP_TcpConnectTimeout);
 	if (settings->GatewayArmTransport)
 	{
+		conntrace_begin(rdp->conntrace, "ARM endpoint resolve");
 		if (!arm_resolve_endpoint(rdp->context, TcpConnectTimeout))
 		{
 			WLog_ERR(TAG, "error retrieving ARM configuration");
 			return FALSE;
 		}
+		conntrace_end(rdp->conntrace, "ARM endpoint resolve");
 	}
 
 	const char* hostname = settings->ServerHostname;
@@ -1979,6 +1984,9 @@ BOOL rdp_server_transition_to_state(rdpRdp* rdp, CONNECTION_STATE state)
 	if (!rdp_set_state(rdp, state))
 		goto fail;
 
+	if (state == CONNECTION_STATE_ACTIVE)
+		conntrace_report(rdp->conntrace);
+
 	status = TRUE;
 fail:
 	return status;
@@ -2080,6 +2088,7 @@ BOOL rdp_set_state(rdpRdp* rdp, CONNECTION_STATE state)
 {
 	WINPR_ASSERT(rdp);
 	rdp->state = state;
+	conntrace_state(rdp->conntrace, state);
 	return TRUE;
 }
 
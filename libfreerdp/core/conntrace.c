@@ -0,0 +1,378 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Connection Sequence Tracing
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <stdio.h>
+
+#include <winpr/assert.h>
+#include <winpr/interlocked.h>
+#include <winpr/file.h>
+#include <winpr/string.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/log.h>
+
+#include "conntrace.h"
+
+#define TAG FREERDP_TAG("core.conntrace")
+
+/* A connection sequence has about 30 states, redirects and NLA round trips add a few more */
+#define CONNTRACE_MAX_EVENTS 256
+
+struct rdp_connection_trace
+{
+	rdpRdp* rdp;
+	wLog* log;
+	CRITICAL_SECTION lock;
+
+	UINT64 start;
+	size_t state;
+	size_t count;
+	size_t dropped;
+	BOOL reported;
+	volatile LONG graphics;
+	rdpConnectionTraceEvent events[CONNTRACE_MAX_EVENTS];
+};
+
+static const char* conntrace_type_string(FREERDP_CONNECTION_TRACE_TYPE type)
+{
+	switch (type)
+	{
+		case FREERDP_CONNECTION_TRACE_STATE:
+			return "state";
+		case FREERDP_CONNECTION_TRACE_PHASE:
+			return "phase";
+		case FREERDP_CONNECTION_TRACE_MARK:
+			return "mark";
+		default:
+			return "unknown";
+	}
+}
+
+static UINT64 conntrace_duration(const rdpConnectionTraceEvent* event, UINT64 now)
+{
+	WINPR_ASSERT(event);
+
+	if (event->complete)
+		return event->duration;
+	return (now > event->start) ? now - event->start : 0;
+}
+
+static void conntrace_finish(rdpConnectionTraceEvent* event, UINT64 now)
+{
+	WINPR_ASSERT(event);
+
+	event->duration = conntrace_duration(event, now);
+	event->complete = TRUE;
+}
+
+static rdpConnectionTraceEvent* conntrace_add(rdpConnectionTrace* trace,
+                                              FREERDP_CONNECTION_TRACE_TYPE type, const char* name,
+                                              UINT64 now)
+{
+	WINPR_ASSERT(trace);
+	WINPR_ASSERT(name);
+
+	if (trace->count >= ARRAYSIZE(trace->events))
+	{
+		trace->dropped++;
+		return NULL;
+	}
+
+	if (trace->count == 0)
+		trace->start = now;
+
+	rdpConnectionTraceEvent* event = &trace->events[trace->count++];
+	event->type = type;
+	(void)_snprintf(event->name, sizeof(event->name), "%s", name);
+	event->start = now - trace->start;
+	event->duration = 0;
+	event->complete = (type == FREERDP_CONNECTION_TRACE_MARK);
+	return event;
+}
+
+void conntrace_state(rdpConnectionTrace* trace, CONNECTION_STATE state)
+{
+	WINPR_ASSERT(trace);
+
+	const UINT64 now = winpr_GetTickCount64NS();
+
+	EnterCriticalSection(&trace->lock);
+	if (trace->state < trace->count)
+		conntrace_finish(&trace->events[trace->state], now - trace->start);
+
+	if (conntrace_add(trace, FREERDP_CONNECTION_TRACE_STATE, rdp_state_string(state), now))
+		trace->state = trace->count - 1;
+	else
+		trace->state = SIZE_MAX;
+	LeaveCriticalSection(&trace->lock);
+}
+
+void conntrace_begin(rdpConnectionTrace* trace, const char* name)
+{
+	WINPR_ASSERT(trace);
+
+	EnterCriticalSection(&trace->lock);
+	(void)conntrace_add(trace, FREERDP_CONNECTION_TRACE_PHASE, name, winpr_GetTickCount64NS());
+	LeaveCriticalSection(&trace->lock);
+}
+
+void conntrace_end(rdpConnectionTrace* trace, const char* name)
+{
+	WINPR_ASSERT(trace);
+	WINPR_ASSERT(name);
+
+	const UINT64 now = winpr_GetTickCount64NS();
+
+	EnterCriticalSection(&trace->lock);
+	for (size_t x = trace->count; x > 0; x--)
+	{
+		rdpConnectionTraceEvent* event = &trace->events[x - 1];
+		if ((event->type != FREERDP_CONNECTION_TRACE_PHASE) || event->complete)
+			continue;
+		if (strncmp(event->name, name, sizeof(event->name) - 1) != 0)
+			continue;
+
+		conntrace_finish(event, now - trace->start);
+		break;
+	}
+	LeaveCriticalSection(&trace->lock);
+}
+
+void conntrace_mark(rdpConnectionTrace* trace, const char* name)
+{
+	WINPR_ASSERT(trace);
+
+	EnterCriticalSection(&trace->lock);
+	(void)conntrace_add(trace, FREERDP_CONNECTION_TRACE_MARK, name, winpr_GetTickCount64NS());
+	LeaveCriticalSection(&trace->lock);
+}
+
+static void conntrace_write_string(FILE* fp, const char* str)
+{
+	(void)fputc('"', fp);
+	for (const char* cur = str; *cur != '\0'; cur++)
+	{
+		if ((*cur == '"') || (*cur == '\\'))
+			(void)fputc('\\', fp);
+		if ((unsigned char)*cur >= 0x20)
+			(void)fputc(*cur, fp);
+	}
+	(void)fputc('"', fp);
+}
+
+/* Chrome trace event format, loads in about:tracing and https://ui.perfetto.dev */
+static BOOL conntrace_write_json(const rdpConnectionTrace* trace, const char* file, UINT64 now)
+{
+	WINPR_ASSERT(trace);
+	WINPR_ASSERT(file);
+
+	FILE* fp = winpr_fopen(file, "w");
+	if (!fp)
+		return FALSE;
+
+	(void)fprintf(fp, "{\"traceEvents\":[");
+	for (size_t x = 0; x < trace->count; x++)
+	{
+		const rdpConnectionTraceEvent* event = &trace->events[x];
+		const BOOL mark = (event->type == FREERDP_CONNECTION_TRACE_MARK);
+
+		(void)fprintf(fp, "%s\n{\"name\":", (x == 0) ? "" : ",");
+		conntrace_write_string(fp, event->name);
+		(void)fprintf(fp,
+		              ",\"cat\":\"%s\",\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%" PRIu64
+		              ".%03" PRIu64,
+		              conntrace_type_string(event->type), mark ? "i" : "X",
+		              (event->type == FREERDP_CONNECTION_TRACE_STATE) ? 1 : 2,
+		              event->start / 1000, event->start % 1000);
+		if (mark)
+			(void)fprintf(fp, ",\"s\":\"g\"");
+		else
+		{
+			const UINT64 duration = conntrace_duration(event, now);
+			(void)fprintf(fp, ",\"dur\":%" PRIu64 ".%03" PRIu64 ",\"args\":{\"complete\":%s}",
+			              duration / 1000, duration % 1000, event->complete ? "true" : "false");
+		}
+		(void)fprintf(fp, "}");
+	}
+	(void)fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	const BOOL rc = (ferror(fp) == 0);
+	(void)fclose(fp);
+	return rc;
+}
+
+static void conntrace_report_locked(rdpConnectionTrace* trace)
+{
+	WINPR_ASSERT(trace);
+	WINPR_ASSERT(trace->rdp);
+
+	if (trace->reported || (trace->count == 0))
+		return;
+	trace->reported = TRUE;
+
+	const UINT64 now = winpr_GetTickCount64NS() - trace->start;
+	const rdpSettings* settings = trace->rdp->settings;
+	const BOOL server = freerdp_settings_get_bool(settings, FreeRDP_ServerMode);
+
+	WLog_Print(trace->log, WLOG_DEBUG, "%s connection sequence, %" PRIu64 " ms",
+	           server ? "server" : "client", now / 1000000);
+	for (size_t x = 0; x < trace->count; x++)
+	{
+		const rdpConnectionTraceEvent* event = &trace->events[x];
+		const UINT64 duration = conntrace_duration(event, now);
+
+		/* Phases are shown below the state they ran in, the current state is always open */
+		if (event->type == FREERDP_CONNECTION_TRACE_MARK)
+			WLog_Print(trace->log, WLOG_DEBUG, "%8" PRIu64 ".%03" PRIu64 " ms   %s",
+			           event->start / 1000000, (event->start / 1000) % 1000, event->name);
+		else
+			WLog_Print(
+			    trace->log, WLOG_DEBUG,
+			    "%8" PRIu64 ".%03" PRIu64 " ms %s%-56s %6" PRIu64 ".%03" PRIu64 " ms%s",
+			    event->start / 1000000, (event->start / 1000) % 1000,
+			    (event->type == FREERDP_CONNECTION_TRACE_STATE) ? "" : "  ", event->name,
+			    duration / 1000000, (duration / 1000) % 1000,
+			    (event->complete || (x == trace->state)) ? "" : " (unfinished)");
+	}
+	if (trace->dropped > 0)
+		WLog_Print(trace->log, WLOG_DEBUG, "%" PRIuz " steps not recorded", trace->dropped);
+
+	const char* file = freerdp_settings_get_string(settings, FreeRDP_ConnectionTraceFile);
+	if (file && !conntrace_write_json(trace, file, now))
+		WLog_Print(trace->log, WLOG_WARN, "failed to write the connection trace to %s", file);
+}
+
+void conntrace_report(rdpConnectionTrace* trace)
+{
+	WINPR_ASSERT(trace);
+
+	EnterCriticalSection(&trace->lock);
+	conntrace_report_locked(trace);
+	LeaveCriticalSection(&trace->lock);
+}
+
+void conntrace_reset(rdpConnectionTrace* trace)
+{
+	WINPR_ASSERT(trace);
+
+	EnterCriticalSection(&trace->lock);
+	conntrace_report_locked(trace);
+	trace->start = 0;
+	trace->state = SIZE_MAX;
+	trace->count = 0;
+	trace->dropped = 0;
+	trace->reported = FALSE;
+	(void)InterlockedExchange(&trace->graphics, 0);
+	LeaveCriticalSection(&trace->lock);
+}
+
+rdpConnectionTrace* conntrace_new(rdpRdp* rdp)
+{
+	WINPR_ASSERT(rdp);
+
+	rdpConnectionTrace* trace = calloc(1, sizeof(rdpConnectionTrace));
+	if (!trace)
+		return NULL;
+
+	trace->rdp = rdp;
+	trace->state = SIZE_MAX;
+	trace->log = WLog_Get(TAG);
+	if (!InitializeCriticalSectionAndSpinCount(&trace->lock, 4000))
+	{
+		free(trace);
+		return NULL;
+	}
+	return trace;
+}
+
+void conntrace_free(rdpConnectionTrace* trace)
+{
+	if (!trace)
+		return;
+
+	/* Connections that never got to a graphics update are the interesting ones */
+	conntrace_report(trace);
+	DeleteCriticalSection(&trace->lock);
+	free(trace);
+}
+
+static rdpConnectionTrace* conntrace_get_context(rdpContext* context)
+{
+	if (!context || !context->rdp)
+		return NULL;
+	return context->rdp->conntrace;
+}
+
+size_t freerdp_connection_trace_count(rdpContext* context)
+{
+	rdpConnectionTrace* trace = conntrace_get_context(context);
+	if (!trace)
+		return 0;
+
+	EnterCriticalSection(&trace->lock);
+	const size_t count = trace->count;
+	LeaveCriticalSection(&trace->lock);
+	return count;
+}
+
+BOOL freerdp_connection_trace_get(rdpContext* context, size_t index,
+                                  rdpConnectionTraceEvent* event)
+{
+	rdpConnectionTrace* trace = conntrace_get_context(context);
+	if (!trace || !event)
+		return FALSE;
+
+	EnterCriticalSection(&trace->lock);
+	const BOOL rc = (index < trace->count);
+	if (rc)
+		*event = trace->events[index];
+	LeaveCriticalSection(&trace->lock);
+	return rc;
+}
+
+BOOL freerdp_connection_trace_mark(rdpContext* context, const char* name)
+{
+	rdpConnectionTrace* trace = conntrace_get_context(context);
+	if (!trace || !name)
+		return FALSE;
+
+	conntrace_mark(trace, name);
+	return TRUE;
+}
+
+void freerdp_connection_trace_graphics_update(rdpContext* context)
+{
+	rdpConnectionTrace* trace = conntrace_get_context(context);
+	if (!trace)
+		return;
+
+	/* Called for every update, only the first one takes the lock */
+	if (InterlockedCompareExchange(&trace->graphics, 1, 0) != 0)
+		return;
+
+	EnterCriticalSection(&trace->lock);
+	if (!trace->reported && (trace->count > 0))
+	{
+		(void)conntrace_add(trace, FREERDP_CONNECTION_TRACE_MARK, "first graphics update",
+		                    winpr_GetTickCount64NS());
+		conntrace_report_locked(trace);
+	}
+	LeaveCriticalSection(&trace->lock);
+}
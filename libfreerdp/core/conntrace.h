@@ -0,0 +1,48 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Connection Sequence Tracing
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_CONNTRACE_H
+#define FREERDP_LIB_CORE_CONNTRACE_H
+
+typedef struct rdp_connection_trace rdpConnectionTrace;
+
+#include "rdp.h"
+
+#include <freerdp/freerdp.h>
+#include <freerdp/api.h>
+
+FREERDP_LOCAL void conntrace_free(rdpConnectionTrace* trace);
+
+WINPR_ATTR_MALLOC(conntrace_free, 1)
+FREERDP_LOCAL rdpConnectionTrace* conntrace_new(rdpRdp* rdp);
+
+/* Reports a trace that was not reported yet and starts a new one */
+FREERDP_LOCAL void conntrace_reset(rdpConnectionTrace* trace);
+
+/* Ends the step of the previous connection state and starts the one of the new state */
+FREERDP_LOCAL void conntrace_state(rdpConnectionTrace* trace, CONNECTION_STATE state);
+
+/* Phases are spans inside of the states, ending a phase ends its latest unfinished instance */
+FREERDP_LOCAL void conntrace_begin(rdpConnectionTrace* trace, const char* name);
+FREERDP_LOCAL void conntrace_end(rdpConnectionTrace* trace, const char* name);
+
+FREERDP_LOCAL void conntrace_mark(rdpConnectionTrace* trace, const char* name);
+
+/* Logs the trace and writes FreeRDP_ConnectionTraceFile, only once per connection */
+FREERDP_LOCAL void conntrace_report(rdpConnectionTrace* trace);
+
+#endif /* FREERDP_LIB_CORE_CONNTRACE_H */
@@ -41,6 +41,7 @@
 #include "surface.h"
 #include "fastpath.h"
 #include "rdp.h"
+#include "probes.h"
 
 #include "../cache/pointer.h"
 #include "../cache/palette.h"
@@ -95,7 +96,7 @@ static const char* const FASTPATH_UPDATETYPE_STRINGS[] = {
 	"New Pointer",            /* 0xB */
 };
 
-static const char* fastpath_update_to_string(UINT8 update)
+const char* fastpath_update_to_string(UINT8 update)
 {
 	if (update >= ARRAYSIZE(FASTPATH_UPDATETYPE_STRINGS))
 		return "UNKNOWN";
@@ -294,7 +295,7 @@ static BOOL fastpath_recv_update_common(rdpFastPath* fastpath, wStream* s)
 
 	context = update->context;
 
-	defaultReturn = freerdp_settings_get_bool(context->settings, FreeRDP_DeactivateClientDecoding);
+	defaultReturn = context->settings->DeactivateClientDecoding;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
 		return FALSE;
@@ -310,7 +311,7 @@ static BOOL fastpath_recv_update_common(rdpFastPath* fastpath, wStream* s)
 				return FALSE;
 
 			rc = IFCALLRESULT(defaultReturn, update->BitmapUpdate, context, bitmap_update);
-			free_bitmap_update(context, bitmap_update);
+			update_arena_reset(update);
 		}
 		break;
 
@@ -322,7 +323,7 @@ static BOOL fastpath_recv_update_common(rdpFastPath* fastpath, wStream* s)
 				return FALSE;
 
 			rc = IFCALLRESULT(defaultReturn, update->Palette, context, palette_update);
-			free_palette_update(context, palette_update);
+			update_arena_reset(update);
 		}
 		break;
 
@@ -353,9 +354,6 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 	if (!fastpath || !fastpath->rdp || !s)
 		return -1;
 
-	Stream_SealLength(s);
-	Stream_SetPosition(s, 0);
-
 	rdpUpdate* update = fastpath->rdp->update;
 
 	if (!update || !update->pointer || !update->context)
@@ -367,13 +365,19 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 	rdpPointerUpdate* pointer = update->pointer;
 	WINPR_ASSERT(pointer);
 
+	FREERDP_PROBE2(fastpath_update_entry, updateCode, Stream_GetRemainingLength(s));
+	metrics_fastpath_update(context->metrics, updateCode, Stream_GetRemainingLength(s));
+
 #ifdef WITH_DEBUG_RDP
 	DEBUG_RDP(fastpath->rdp, "recv Fast-Path %s Update (0x%02" PRIX8 "), length:%" PRIuz "",
 	          fastpath_update_to_string(updateCode), updateCode, Stream_GetRemainingLength(s));
 #endif
 
-	const BOOL defaultReturn =
-	    freerdp_settings_get_bool(context->settings, FreeRDP_DeactivateClientDecoding);
+	if ((updateCode == FASTPATH_UPDATETYPE_ORDERS) || (updateCode == FASTPATH_UPDATETYPE_BITMAP) ||
+	    (updateCode == FASTPATH_UPDATETYPE_SURFCMDS))
+		freerdp_connection_trace_graphics_update(context);
+
+	const BOOL defaultReturn = context->settings->DeactivateClientDecoding;
 	switch (updateCode)
 	{
 		case FASTPATH_UPDATETYPE_ORDERS:
@@ -478,7 +482,8 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 			break;
 	}
 
-	Stream_SetPosition(s, 0);
+	FREERDP_PROBE2(fastpath_update_exit, updateCode, rc);
+
 	if (!rc)
 	{
 		WLog_ERR(TAG, "Fastpath update %s [%" PRIx8 "] failed, status %d",
@@ -489,6 +494,19 @@ static int fastpath_recv_update(rdpFastPath* fastpath, BYTE updateCode, wStream*
 	return status;
 }
 
+static int fastpath_recv_update_fragments(rdpFastPath* fastpath, BYTE updateCode)
+{
+	WINPR_ASSERT(fastpath);
+
+	wStream* s = fastpath->updateData;
+	Stream_SealLength(s);
+	Stream_SetPosition(s, 0);
+
+	const int status = fastpath_recv_update(fastpath, updateCode, s);
+	Stream_SetPosition(s, 0);
+	return status;
+}
+
 static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 {
 	int status = 0;
@@ -538,17 +556,12 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 	    bulk_decompress(rdp->bulk, Stream_Pointer(s), size, &pDstData, &DstSize, compressionFlags);
 	Stream_Seek(s, size);
 
-	if (bulkStatus < 0)
+	if ((bulkStatus < 0) || !pDstData)
 	{
 		WLog_ERR(TAG, "bulk_decompress() failed");
 		return -1;
 	}
 
-	if (!Stream_EnsureRemainingCapacity(fastpath->updateData, DstSize))
-		return -1;
-
-	Stream_Write(fastpath->updateData, pDstData, DstSize);
-
 	if (fragmentation == FASTPATH_FRAGMENT_SINGLE)
 	{
 		if (fastpath->fragmentation != -1)
@@ -557,7 +570,11 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 			goto out_fail;
 		}
 
-		status = fastpath_recv_update(fastpath, updateCode, fastpath->updateData);
+		/* Complete updates are parsed straight out of the receive or decompression buffer,
+		 * only fragments are collected in updateData */
+		wStream sbuffer = { 0 };
+		wStream* us = Stream_StaticConstInit(&sbuffer, pDstData, DstSize);
+		status = fastpath_recv_update(fastpath, updateCode, us);
 
 		if (status < 0)
 		{
@@ -568,6 +585,11 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 	else
 	{
 		rdpContext* context = NULL;
+
+		if (!Stream_EnsureRemainingCapacity(fastpath->updateData, DstSize))
+			return -1;
+
+		Stream_Write(fastpath->updateData, pDstData, DstSize);
 		const size_t totalSize = Stream_GetPosition(fastpath->updateData);
 
 		context = transport_get_context(transport);
@@ -612,7 +634,7 @@ static int fastpath_recv_update_data(rdpFastPath* fastpath, wStream* s)
 			}
 
 			fastpath->fragmentation = -1;
-			status = fastpath_recv_update(fastpath, updateCode, fastpath->updateData);
+			status = fastpath_recv_update_fragments(fastpath, updateCode);
 
 			if (status < 0)
 			{
@@ -1134,7 +1156,7 @@ BOOL fastpath_send_multiple_input_pdu(rdpFastPath* fastpath, wStream* s, size_t
 	Stream_SetPosition(s, length);
 	Stream_SealLength(s);
 
-	if (transport_write(rdp->transport, s) < 0)
+	if (rdp_transport_write(rdp, s, TRANSPORT_PRIORITY_HIGH) < 0)
 		goto fail;
 
 	rc = TRUE;
@@ -1160,8 +1182,23 @@ wStream* fastpath_update_pdu_init_new(rdpFastPath* fastpath)
 	return s;
 }
 
-BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s,
-                              BOOL skipCompression)
+/* Surface commands and bitmap updates mostly carry codec output (RemoteFX, H.264,
+ * planar, ...) which the bulk compressors cannot shrink. Probe those before compressing,
+ * everything else is small or structured and always worth a try. */
+static BOOL fastpath_update_probe_compressible(BYTE updateCode)
+{
+	switch (updateCode)
+	{
+		case FASTPATH_UPDATETYPE_SURFCMDS:
+		case FASTPATH_UPDATETYPE_BITMAP:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL fastpath_send_update_pdu_fragments(rdpFastPath* fastpath, BYTE updateCode, wStream* s,
+                                               BOOL skipCompression)
 {
 	BOOL status = TRUE;
 	wStream* fs = NULL;
@@ -1193,6 +1230,7 @@ BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s
 		maxLength -= 20;
 	}
 
+	const BOOL probe = fastpath_update_probe_compressible(updateCode);
 	size_t totalLength = Stream_GetPosition(s);
 	Stream_SetPosition(s, 0);
 
@@ -1243,7 +1281,10 @@ BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s
 		if (rdp->sec_flags & SEC_SECURE_CHECKSUM)
 			fpUpdatePduHeader.secFlags |= FASTPATH_OUTPUT_SECURE_CHECKSUM;
 
-		if (settings->CompressionEnabled && !skipCompression)
+		/* An incompressible fragment is sent uncompressed without touching the
+		 * compressor, so the shared history stays in sync with the peer. */
+		if (settings->CompressionEnabled && !skipCompression &&
+		    (!probe || bulk_is_compressible(pSrcData, SrcSize)))
 		{
 			if (bulk_compress(rdp->bulk, pSrcData, SrcSize, &pDstData, &DstSize,
 			                  &compressionFlags) >= 0)
@@ -1361,6 +1402,23 @@ BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s
 	return status;
 }
 
+BOOL fastpath_send_update_pdu(rdpFastPath* fastpath, BYTE updateCode, wStream* s,
+                              BOOL skipCompression)
+{
+	if (!fastpath || !fastpath->rdp || !s)
+		return FALSE;
+
+	/* Fragments of large updates are sent together */
+	rdpTransport* transport = fastpath->rdp->transport;
+	const BOOL corked =
+	    (Stream_GetPosition(s) > FASTPATH_MAX_PACKET_SIZE) && transport_cork(transport);
+
+	BOOL rc = fastpath_send_update_pdu_fragments(fastpath, updateCode, s, skipCompression);
+	if (corked && !transport_uncork(transport))
+		rc = FALSE;
+	return rc;
+}
+
 rdpFastPath* fastpath_new(rdpRdp* rdp)
 {
 	rdpFastPath* fastpath = NULL;
@@ -126,6 +126,8 @@ typedef struct
 	BYTE compression;
 } FASTPATH_UPDATE_HEADER;
 
+FREERDP_LOCAL const char* fastpath_update_to_string(UINT8 update);
+
 FREERDP_LOCAL BOOL fastpath_read_header_rdp(rdpFastPath* fastpath, wStream* s, UINT16* length);
 FREERDP_LOCAL state_run_t fastpath_recv_updates(rdpFastPath* fastpath, wStream* s);
 FREERDP_LOCAL state_run_t fastpath_recv_inputs(rdpFastPath* fastpath, wStream* s);
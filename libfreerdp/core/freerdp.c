@@ -121,6 +121,8 @@ static int freerdp_connect_begin(freerdp* instance)
 	freerdp_settings_print_warnings(settings);
 	if (status)
 		status = freerdp_settings_check_client_after_preconnect(settings);
+	if (status)
+		status = utils_apply_thread_affinity(WLog_Get(TAG), settings);
 
 	if (status)
 		status = rdp_set_backup_settings(rdp);
@@ -393,6 +395,14 @@ DWORD freerdp_get_event_handles(rdpContext* context, HANDLE* events, DWORD count
 	else
 		return 0;
 
+	HANDLE multitransport = multitransport_get_event_handle(context->rdp->multitransport);
+	if (multitransport)
+	{
+		if (nCount >= count)
+			return 0;
+		events[nCount++] = multitransport;
+	}
+
 	const SSIZE_T rc = freerdp_client_channel_get_registered_event_handles(
 	    context->channels, &events[nCount], count - nCount);
 	if (rc < 0)
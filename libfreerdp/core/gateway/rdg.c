@@ -50,7 +50,7 @@
 
 /* HTTP channel response fields present flags. */
 #define HTTP_CHANNEL_RESPONSE_FIELD_CHANNELID 0x1
-#define HTTP_CHANNEL_RESPONSE_OPTIONAL 0x2
+#define HTTP_CHANNEL_RESPONSE_OPTIONAL 0x2 /* HTTP_CHANNEL_RESPONSE_FIELD_AUTHNCOOKIE */
 #define HTTP_CHANNEL_RESPONSE_FIELD_UDPPORT 0x4
 
 /* HTTP extended auth. */
@@ -137,6 +137,13 @@ struct rdp_rdg
 
 	SmartcardCertInfo* smartcard;
 	wLog* log;
+
+	/* the UDP side channel the gateway offered in the channel response */
+	UINT16 udpPort;
+	BYTE* udpCookie;
+	size_t udpCookieLength;
+
+	wStream* sendBuffer; /* reused for every outgoing data packet, guarded by writeSection */
 };
 
 enum
@@ -493,9 +500,12 @@ static BOOL rdg_send_tunnel_request(rdpRdg* rdg)
 	UINT16 fieldsPresent = 0;
 	WCHAR* PAACookie = NULL;
 	size_t PAACookieLen = 0;
-	const UINT32 capabilities = HTTP_CAPABILITY_TYPE_QUAR_SOH |
-	                            HTTP_CAPABILITY_MESSAGING_CONSENT_SIGN |
-	                            HTTP_CAPABILITY_MESSAGING_SERVICE_MSG;
+	UINT32 capabilities = HTTP_CAPABILITY_TYPE_QUAR_SOH | HTTP_CAPABILITY_MESSAGING_CONSENT_SIGN |
+	                      HTTP_CAPABILITY_MESSAGING_SERVICE_MSG;
+
+	/* the gateway only offers its UDP side channel to clients that asked for it */
+	if (freerdp_settings_get_bool(rdg->context->settings, FreeRDP_MultitransportUdp))
+		capabilities |= HTTP_CAPABILITY_UDP_TRANSPORT;
 
 	if (rdg->extAuth == HTTP_EXTENDED_AUTH_PAA)
 	{
@@ -1033,6 +1043,57 @@ static BOOL rdg_process_extauth_sspi(rdpRdg* rdg, wStream* s)
 	return FALSE;
 }
 
+static BOOL rdg_process_channel_response_optional(rdpRdg* rdg, wStream* s, UINT16 fieldsPresent)
+{
+	if (fieldsPresent & HTTP_CHANNEL_RESPONSE_FIELD_CHANNELID)
+	{
+		/* Seek over channelId (4 bytes) */
+		if (!Stream_SafeSeek(s, 4))
+		{
+			WLog_Print(rdg->log, WLOG_ERROR, "Short channelId, got %" PRIuz ", expected 4",
+			           Stream_GetRemainingLength(s));
+			return FALSE;
+		}
+	}
+
+	if (fieldsPresent & HTTP_CHANNEL_RESPONSE_FIELD_UDPPORT)
+	{
+		if (!Stream_CheckAndLogRequiredLengthWLog(rdg->log, s, 2))
+			return FALSE;
+
+		Stream_Read_UINT16(s, rdg->udpPort);
+	}
+
+	if (fieldsPresent & HTTP_CHANNEL_RESPONSE_OPTIONAL)
+	{
+		UINT16 cbLen = 0;
+		if (!Stream_CheckAndLogRequiredLengthWLog(rdg->log, s, 2))
+			return FALSE;
+
+		Stream_Read_UINT16(s, cbLen);
+		if (!Stream_CheckAndLogRequiredLengthWLog(rdg->log, s, cbLen))
+			return FALSE;
+
+		free(rdg->udpCookie);
+		rdg->udpCookie = NULL;
+		rdg->udpCookieLength = 0;
+		if (cbLen > 0)
+		{
+			rdg->udpCookie = malloc(cbLen);
+			if (!rdg->udpCookie)
+				return FALSE;
+			Stream_Read(s, rdg->udpCookie, cbLen);
+			rdg->udpCookieLength = cbLen;
+		}
+	}
+
+	if (rdg->udpPort != 0)
+		WLog_Print(rdg->log, WLOG_DEBUG,
+		           "gateway offers a UDP side channel on port %" PRIu16 ", cookie %" PRIuz " bytes",
+		           rdg->udpPort, rdg->udpCookieLength);
+	return TRUE;
+}
+
 static BOOL rdg_process_channel_response(rdpRdg* rdg, wStream* s)
 {
 	UINT16 fieldsPresent = 0;
@@ -1063,6 +1124,9 @@ static BOOL rdg_process_channel_response(rdpRdg* rdg, wStream* s)
 		return FALSE;
 	}
 
+	if (!rdg_process_channel_response_optional(rdg, s, fieldsPresent))
+		return FALSE;
+
 	rdg->state = RDG_CLIENT_STATE_OPENED;
 	return TRUE;
 }
@@ -1606,96 +1670,31 @@ BOOL rdg_connect(rdpRdg* rdg, DWORD timeout, BOOL* rpcFallback)
 
 static int rdg_write_websocket_data_packet(rdpRdg* rdg, const BYTE* buf, int isize)
 {
-	size_t payloadSize = 0;
-	size_t fullLen = 0;
-	int status = 0;
-	wStream* sWS = NULL;
-
-	uint32_t maskingKey = 0;
-	BYTE* maskingKeyByte1 = (BYTE*)&maskingKey;
-	BYTE* maskingKeyByte2 = maskingKeyByte1 + 1;
-	BYTE* maskingKeyByte3 = maskingKeyByte1 + 2;
-	BYTE* maskingKeyByte4 = maskingKeyByte1 + 3;
-
-	int streamPos = 0;
+	BYTE header[10] = { 0 };
+	wStream sbuffer = { 0 };
 
-	winpr_RAND(&maskingKey, 4);
-
-	payloadSize = isize + 10;
 	if ((isize < 0) || (isize > UINT16_MAX))
 		return -1;
 
-	if (payloadSize < 1)
+	if (isize < 1)
 		return 0;
 
-	if (payloadSize < 126)
-		fullLen = payloadSize + 6; /* 2 byte "mini header" + 4 byte masking key */
-	else if (payloadSize < 0x10000)
-		fullLen = payloadSize + 8; /* 2 byte "mini header" + 2 byte length + 4 byte masking key */
-	else
-		fullLen = payloadSize + 14; /* 2 byte "mini header" + 8 byte length + 4 byte masking key */
-
-	sWS = Stream_New(NULL, fullLen);
-	if (!sWS)
-		return FALSE;
-
-	Stream_Write_UINT8(sWS, WEBSOCKET_FIN_BIT | WebsocketBinaryOpcode);
-	if (payloadSize < 126)
-		Stream_Write_UINT8(sWS, payloadSize | WEBSOCKET_MASK_BIT);
-	else if (payloadSize < 0x10000)
-	{
-		Stream_Write_UINT8(sWS, 126 | WEBSOCKET_MASK_BIT);
-		Stream_Write_UINT16_BE(sWS, payloadSize);
-	}
-	else
-	{
-		Stream_Write_UINT8(sWS, 127 | WEBSOCKET_MASK_BIT);
-		/* biggest packet possible is 0xffff + 0xa, so 32bit is always enough */
-		Stream_Write_UINT32_BE(sWS, 0);
-		Stream_Write_UINT32_BE(sWS, payloadSize);
-	}
-	Stream_Write_UINT32(sWS, maskingKey);
-
-	Stream_Write_UINT16(sWS, PKT_TYPE_DATA ^ (*maskingKeyByte1 | *maskingKeyByte2 << 8)); /* Type */
-	Stream_Write_UINT16(sWS, 0 ^ (*maskingKeyByte3 | *maskingKeyByte4 << 8)); /* Reserved */
-	Stream_Write_UINT32(sWS, (UINT32)payloadSize ^ maskingKey);               /* Packet length */
-	Stream_Write_UINT16(sWS,
-	                    (UINT16)isize ^ (*maskingKeyByte1 | *maskingKeyByte2 << 8)); /* Data size */
-
-	/* masking key is now off by 2 bytes. fix that */
-	maskingKey = (maskingKey & 0xffff) << 16 | (maskingKey >> 16);
-
-	/* mask as much as possible with 32bit access */
-	for (streamPos = 0; streamPos + 4 <= isize; streamPos += 4)
-	{
-		uint32_t masked = *((const uint32_t*)(buf + streamPos)) ^ maskingKey;
-		Stream_Write_UINT32(sWS, masked);
-	}
-
-	/* mask the rest byte by byte */
-	for (; streamPos < isize; streamPos++)
-	{
-		BYTE* partialMask = (BYTE*)(&maskingKey) + streamPos % 4;
-		BYTE masked = *((buf + streamPos)) ^ *partialMask;
-		Stream_Write_UINT8(sWS, masked);
-	}
-
-	Stream_SealLength(sWS);
+	/* the data packet header is masked together with the data, no copy of it is made */
+	wStream* s = Stream_StaticInit(&sbuffer, header, sizeof(header));
+	Stream_Write_UINT16(s, PKT_TYPE_DATA);                  /* Type */
+	Stream_Write_UINT16(s, 0);                              /* Reserved */
+	Stream_Write_UINT32(s, (UINT32)isize + sizeof(header)); /* Packet length */
+	Stream_Write_UINT16(s, (UINT16)isize);                  /* Data size */
 
-	status = freerdp_tls_write_all(rdg->tlsOut, Stream_Buffer(sWS), Stream_Length(sWS));
-	Stream_Free(sWS, TRUE);
-
-	if (status < 0)
-		return status;
-
-	return isize;
+	return websocket_write_frame(rdg->tlsOut->bio, rdg->sendBuffer, header, sizeof(header), buf,
+	                             (size_t)isize, WebsocketBinaryOpcode);
 }
 
 static int rdg_write_chunked_data_packet(rdpRdg* rdg, const BYTE* buf, int isize)
 {
 	int status = 0;
 	size_t len = 0;
-	wStream* sChunk = NULL;
+	wStream* sChunk = rdg->sendBuffer;
 	size_t size = (size_t)isize;
 	size_t packetSize = size + 10;
 	char chunkSize[11];
@@ -1707,9 +1706,8 @@ static int rdg_write_chunked_data_packet(rdpRdg* rdg, const BYTE* buf, int isize
 		return 0;
 
 	(void)sprintf_s(chunkSize, sizeof(chunkSize), "%" PRIxz "\r\n", packetSize);
-	sChunk = Stream_New(NULL, strnlen(chunkSize, sizeof(chunkSize)) + packetSize + 2);
-
-	if (!sChunk)
+	Stream_SetPosition(sChunk, 0);
+	if (!Stream_EnsureCapacity(sChunk, strnlen(chunkSize, sizeof(chunkSize)) + packetSize + 2))
 		return -1;
 
 	Stream_Write(sChunk, chunkSize, strnlen(chunkSize, sizeof(chunkSize)));
@@ -1723,13 +1721,9 @@ static int rdg_write_chunked_data_packet(rdpRdg* rdg, const BYTE* buf, int isize
 	len = Stream_Length(sChunk);
 
 	if (len > INT_MAX)
-	{
-		Stream_Free(sChunk, TRUE);
 		return -1;
-	}
 
 	status = freerdp_tls_write_all(rdg->tlsIn, Stream_Buffer(sChunk), (int)len);
-	Stream_Free(sChunk, TRUE);
 
 	if (status < 0)
 		return -1;
@@ -2235,6 +2229,11 @@ rdpRdg* rdg_new(rdpContext* context)
 		if (!rdg->http)
 			goto rdg_alloc_error;
 
+		rdg->sendBuffer = Stream_New(NULL, 4096);
+
+		if (!rdg->sendBuffer)
+			goto rdg_alloc_error;
+
 		if (!http_context_set_uri(rdg->http, "/remoteDesktopGateway/") ||
 		    !http_context_set_accept(rdg->http, "*/*") ||
 		    !http_context_set_cache_control(rdg->http, "no-cache") ||
@@ -2316,10 +2315,26 @@ void rdg_free(rdpRdg* rdg)
 	}
 
 	smartcardCertInfo_Free(rdg->smartcard);
+	free(rdg->udpCookie);
+	Stream_Free(rdg->sendBuffer, TRUE);
 
 	free(rdg);
 }
 
+BOOL rdg_get_udp_side_channel(rdpRdg* rdg, UINT16* port, const BYTE** cookie, size_t* length)
+{
+	if (!rdg || (rdg->state != RDG_CLIENT_STATE_OPENED) || (rdg->udpPort == 0))
+		return FALSE;
+
+	if (port)
+		*port = rdg->udpPort;
+	if (cookie)
+		*cookie = rdg->udpCookie;
+	if (length)
+		*length = rdg->udpCookieLength;
+	return TRUE;
+}
+
 BIO* rdg_get_front_bio_and_take_ownership(rdpRdg* rdg)
 {
 	if (!rdg)
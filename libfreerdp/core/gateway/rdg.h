@@ -39,4 +39,8 @@ FREERDP_LOCAL BIO* rdg_get_front_bio_and_take_ownership(rdpRdg* rdg);
 FREERDP_LOCAL BOOL rdg_connect(rdpRdg* rdg, DWORD timeout, BOOL* rpcFallback);
 FREERDP_LOCAL DWORD rdg_get_event_handles(rdpRdg* rdg, HANDLE* events, DWORD count);
 
+/* The UDP port and authentication cookie the gateway offered for its DTLS side channel */
+FREERDP_LOCAL BOOL rdg_get_udp_side_channel(rdpRdg* rdg, UINT16* port, const BYTE** cookie,
+                                            size_t* length);
+
 #endif /* FREERDP_LIB_CORE_GATEWAY_RDG_H */
@@ -708,7 +708,8 @@ fail:
 	return NULL;
 }
 
-static BOOL rpc_channel_tls_connect(RpcChannel* channel, UINT32 timeout)
+/* Opens the socket and the proxy tunnel of a channel, does not touch the other channel */
+static BOOL rpc_channel_tcp_connect(RpcChannel* channel, UINT32 timeout)
 {
 	if (!channel || !channel->client || !channel->client->context ||
 	    !channel->client->context->settings)
@@ -764,6 +765,21 @@ static BOOL rpc_channel_tls_connect(RpcChannel* channel, UINT32 timeout)
 	}
 
 	channel->bio = bufferedBio;
+	return TRUE;
+}
+
+static BOOL rpc_channel_tls_handshake(RpcChannel* channel)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->client);
+	WINPR_ASSERT(channel->rpc);
+
+	rdpContext* context = channel->client->context;
+	WINPR_ASSERT(context);
+
+	rdpSettings* settings = context->settings;
+	WINPR_ASSERT(settings);
+
 	rdpTls* tls = channel->tls = freerdp_tls_new(context);
 
 	if (!tls)
@@ -772,7 +788,9 @@ static BOOL rpc_channel_tls_connect(RpcChannel* channel, UINT32 timeout)
 	tls->hostname = settings->GatewayHostname;
 	tls->port = settings->GatewayPort;
 	tls->isGatewayTransport = TRUE;
-	int tlsStatus = freerdp_tls_connect(tls, bufferedBio);
+	/* The second channel resumes the session of the first one */
+	tls->sessionCache = channel->rpc->tlsSessions;
+	int tlsStatus = freerdp_tls_connect(tls, channel->bio);
 
 	if (tlsStatus < 1)
 	{
@@ -791,6 +809,13 @@ static BOOL rpc_channel_tls_connect(RpcChannel* channel, UINT32 timeout)
 	return TRUE;
 }
 
+static BOOL rpc_channel_tls_connect(RpcChannel* channel, UINT32 timeout)
+{
+	if (!rpc_channel_tcp_connect(channel, timeout))
+		return FALSE;
+	return rpc_channel_tls_handshake(channel);
+}
+
 static int rpc_in_channel_connect(RpcInChannel* inChannel, UINT32 timeout)
 {
 	rdpContext* context = NULL;
@@ -825,7 +850,8 @@ static int rpc_in_channel_connect(RpcInChannel* inChannel, UINT32 timeout)
 	return 1;
 }
 
-static int rpc_out_channel_connect(RpcOutChannel* outChannel, int timeout)
+/* Runs the TLS handshake and sends the OUT channel request on a connected socket */
+static int rpc_out_channel_connect(RpcOutChannel* outChannel)
 {
 	rdpContext* context = NULL;
 
@@ -836,7 +862,7 @@ static int rpc_out_channel_connect(RpcOutChannel* outChannel, int timeout)
 
 	/* Connect OUT Channel */
 
-	if (!rpc_channel_tls_connect(&outChannel->common, timeout))
+	if (!rpc_channel_tls_handshake(&outChannel->common))
 		return -1;
 
 	rpc_out_channel_transition_to_state(outChannel, CLIENT_OUT_CHANNEL_STATE_CONNECTED);
@@ -889,6 +915,22 @@ int rpc_out_channel_replacement_connect(RpcOutChannel* outChannel, int timeout)
 	return 1;
 }
 
+typedef struct
+{
+	RpcChannel* channel;
+	UINT32 timeout;
+	BOOL result;
+} RpcChannelConnect;
+
+static DWORD WINAPI rpc_channel_tcp_connect_thread(LPVOID arg)
+{
+	RpcChannelConnect* connect = arg;
+	WINPR_ASSERT(connect);
+
+	connect->result = rpc_channel_tcp_connect(connect->channel, connect->timeout);
+	return 0;
+}
+
 BOOL rpc_connect(rdpRpc* rpc, UINT32 timeout)
 {
 	RpcInChannel* inChannel = NULL;
@@ -904,10 +946,37 @@ BOOL rpc_connect(rdpRpc* rpc, UINT32 timeout)
 	outChannel = connection->DefaultOutChannel;
 	rpc_virtual_connection_transition_to_state(rpc, connection, VIRTUAL_CONNECTION_STATE_INITIAL);
 
-	if (rpc_in_channel_connect(inChannel, timeout) < 0)
+	/**
+	 * The OUT channel socket and proxy tunnel are opened while the IN channel connects.
+	 * The TLS handshakes stay one after the other: certificate prompts are not shown twice at
+	 * the same time and the OUT channel resumes the TLS session of the IN channel.
+	 * The HTTP authentication of both channels then runs interleaved in tsg_check_event_handles.
+	 */
+	RpcChannelConnect outConnect = { &outChannel->common, timeout, FALSE };
+	HANDLE thread = CreateThread(NULL, 0, rpc_channel_tcp_connect_thread, &outConnect, 0, NULL);
+	if (!thread)
+		WLog_Print(rpc->log, WLOG_WARN, "connecting the OUT channel after the IN channel");
+
+	const int inStatus = rpc_in_channel_connect(inChannel, timeout);
+
+	if (thread)
+	{
+		(void)WaitForSingleObject(thread, INFINITE);
+		(void)CloseHandle(thread);
+	}
+	else if (inStatus >= 0)
+		outConnect.result = rpc_channel_tcp_connect(&outChannel->common, timeout);
+
+	if ((inStatus < 0) || !outConnect.result)
+	{
+		/* Without a TLS layer nothing else owns the socket */
+		if (!outChannel->common.tls && outChannel->common.bio)
+			BIO_free_all(outChannel->common.bio);
+		outChannel->common.bio = NULL;
 		return FALSE;
+	}
 
-	if (rpc_out_channel_connect(outChannel, timeout) < 0)
+	if (rpc_out_channel_connect(outChannel) < 0)
 		return FALSE;
 
 	return TRUE;
@@ -957,6 +1026,11 @@ rdpRpc* rpc_new(rdpTransport* transport)
 	if (!rpc->client)
 		goto out_free;
 
+	rpc->tlsSessions = freerdp_tls_session_cache_new();
+
+	if (!rpc->tlsSessions)
+		goto out_free;
+
 	return rpc;
 out_free:
 	WINPR_PRAGMA_DIAG_PUSH
@@ -973,6 +1047,7 @@ void rpc_free(rdpRpc* rpc)
 		rpc_client_free(rpc->client);
 		credssp_auth_free(rpc->auth);
 		rpc_virtual_connection_free(rpc->VirtualConnection);
+		freerdp_tls_session_cache_free(rpc->tlsSessions);
 		free(rpc);
 	}
 }
@@ -754,6 +754,7 @@ struct rdp_rpc
 	UINT32 CurrentKeepAliveInterval;
 
 	RpcVirtualConnection* VirtualConnection;
+	rdpTlsSessionCache* tlsSessions;
 	wLog* log;
 };
 
@@ -19,6 +19,7 @@
 
 #include "websocket.h"
 #include <freerdp/log.h>
+#include <freerdp/primitives.h>
 #include "../tcp.h"
 
 #define TAG FREERDP_TAG("core.gateway.websocket")
@@ -133,78 +134,91 @@ static int websocket_write_all(BIO* bio, const BYTE* data, size_t length)
 	return length;
 }
 
-int websocket_write(BIO* bio, const BYTE* buf, int isize, WEBSOCKET_OPCODE opcode)
+/* XORs data into dst with the masking key, offset is the position in the frame payload */
+static void websocket_mask(BYTE* dst, const BYTE* data, size_t length, uint32_t maskingKey,
+                           size_t offset)
 {
-	size_t payloadSize = 0;
-	size_t fullLen = 0;
-	int status = 0;
-	wStream* sWS = NULL;
+	const BYTE* key = (const BYTE*)&maskingKey;
+	size_t pos = 0;
 
-	uint32_t maskingKey = 0;
+	/* align to the key, then mask whole words with the vector primitive */
+	for (; (pos < length) && ((offset + pos) % 4) != 0; pos++)
+		dst[pos] = data[pos] ^ key[(offset + pos) % 4];
 
-	int streamPos = 0;
+	const size_t words = MIN((length - pos) / 4, INT32_MAX);
+	if (words > 0)
+	{
+		const primitives_t* prims = primitives_get();
+		WINPR_ASSERT(prims);
+		WINPR_ASSERT(prims->xorC_32u);
 
-	WINPR_ASSERT(bio);
-	WINPR_ASSERT(buf);
+		prims->xorC_32u((const UINT32*)&data[pos], maskingKey, (UINT32*)&dst[pos], (INT32)words);
+		pos += words * 4;
+	}
 
-	winpr_RAND(&maskingKey, sizeof(maskingKey));
+	for (; pos < length; pos++)
+		dst[pos] = data[pos] ^ key[(offset + pos) % 4];
+}
 
-	payloadSize = isize;
-	if ((isize < 0) || (isize > UINT32_MAX))
+int websocket_write_frame(BIO* bio, wStream* frame, const BYTE* prefix, size_t prefixLength,
+                          const BYTE* buf, size_t length, WEBSOCKET_OPCODE opcode)
+{
+	uint32_t maskingKey = 0;
+
+	WINPR_ASSERT(bio);
+	WINPR_ASSERT(frame);
+	WINPR_ASSERT(prefix || (prefixLength == 0));
+	WINPR_ASSERT(buf || (length == 0));
+
+	const size_t payloadSize = prefixLength + length;
+	if ((payloadSize < length) || (payloadSize > INT32_MAX - 30))
 		return -1;
 
-	if (payloadSize < 126)
-		fullLen = payloadSize + 6; /* 2 byte "mini header" + 4 byte masking key */
-	else if (payloadSize < 0x10000)
-		fullLen = payloadSize + 8; /* 2 byte "mini header" + 2 byte length + 4 byte masking key */
-	else
-		fullLen = payloadSize + 14; /* 2 byte "mini header" + 8 byte length + 4 byte masking key */
+	/* 2 byte "mini header", 0, 2 or 8 byte length, 4 byte masking key */
+	size_t headerSize = 6;
+	if (payloadSize >= 0x10000)
+		headerSize += 8;
+	else if (payloadSize >= 126)
+		headerSize += 2;
+
+	/* start the frame so that the data lands on a 16 byte boundary for the vector masking */
+	const size_t start = (16 - ((headerSize + prefixLength) % 16)) % 16;
+	Stream_SetPosition(frame, 0);
+	if (!Stream_EnsureCapacity(frame, start + headerSize + payloadSize))
+		return -1;
+	Stream_SetPosition(frame, start);
 
-	sWS = Stream_New(NULL, fullLen);
-	if (!sWS)
-		return FALSE;
+	winpr_RAND(&maskingKey, sizeof(maskingKey));
 
-	Stream_Write_UINT8(sWS, WEBSOCKET_FIN_BIT | opcode);
+	Stream_Write_UINT8(frame, WEBSOCKET_FIN_BIT | opcode);
 	if (payloadSize < 126)
-		Stream_Write_UINT8(sWS, payloadSize | WEBSOCKET_MASK_BIT);
+		Stream_Write_UINT8(frame, payloadSize | WEBSOCKET_MASK_BIT);
 	else if (payloadSize < 0x10000)
 	{
-		Stream_Write_UINT8(sWS, 126 | WEBSOCKET_MASK_BIT);
-		Stream_Write_UINT16_BE(sWS, payloadSize);
+		Stream_Write_UINT8(frame, 126 | WEBSOCKET_MASK_BIT);
+		Stream_Write_UINT16_BE(frame, payloadSize);
 	}
 	else
 	{
-		Stream_Write_UINT8(sWS, 127 | WEBSOCKET_MASK_BIT);
-		/* biggest packet possible is 0xffff + 0xa, so 32bit is always enough */
-		Stream_Write_UINT32_BE(sWS, 0);
-		Stream_Write_UINT32_BE(sWS, payloadSize);
-	}
-	Stream_Write_UINT32(sWS, maskingKey);
-
-	/* mask as much as possible with 32bit access */
-	for (streamPos = 0; streamPos + 4 <= isize; streamPos += 4)
-	{
-		uint32_t masked = *((const uint32_t*)(buf + streamPos)) ^ maskingKey;
-		Stream_Write_UINT32(sWS, masked);
+		Stream_Write_UINT8(frame, 127 | WEBSOCKET_MASK_BIT);
+		Stream_Write_UINT32_BE(frame, 0); /* payload is limited to INT_MAX */
+		Stream_Write_UINT32_BE(frame, payloadSize);
 	}
+	Stream_Write_UINT32(frame, maskingKey);
 
-	/* mask the rest byte by byte */
-	for (; streamPos < isize; streamPos++)
-	{
-		BYTE* partialMask = (BYTE*)(&maskingKey) + streamPos % 4;
-		BYTE masked = *((buf + streamPos)) ^ *partialMask;
-		Stream_Write_UINT8(sWS, masked);
-	}
-
-	Stream_SealLength(sWS);
-
-	status = websocket_write_all(bio, Stream_Buffer(sWS), Stream_Length(sWS));
-	Stream_Free(sWS, TRUE);
+	/* the prefix and the data are masked straight into the frame as one payload */
+	websocket_mask(Stream_Pointer(frame), prefix, prefixLength, maskingKey, 0);
+	Stream_Seek(frame, prefixLength);
+	websocket_mask(Stream_Pointer(frame), buf, length, maskingKey, prefixLength);
+	Stream_Seek(frame, length);
+	Stream_SealLength(frame);
 
+	const int status =
+	    websocket_write_all(bio, Stream_Buffer(frame) + start, Stream_Length(frame) - start);
 	if (status < 0)
 		return status;
 
-	return isize;
+	return (int)length;
 }
 
 static int websocket_read_data(BIO* bio, BYTE* pBuffer, size_t size,
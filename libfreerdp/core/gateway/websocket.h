@@ -64,7 +64,16 @@ typedef struct
 } websocket_context;
 
 FREERDP_LOCAL BOOL websocket_write_wstream(BIO* bio, wStream* sPacket, WEBSOCKET_OPCODE opcode);
-FREERDP_LOCAL int websocket_write(BIO* bio, const BYTE* buf, int isize, WEBSOCKET_OPCODE opcode);
+
+/**
+ * @brief websocket_write_frame Sends prefix and buf as the masked payload of one frame.
+ *
+ * @param frame A stream reused by the caller for every frame, grown as needed
+ * @return The number of bytes of buf written, a negative value on error
+ */
+FREERDP_LOCAL int websocket_write_frame(BIO* bio, wStream* frame, const BYTE* prefix,
+                                        size_t prefixLength, const BYTE* buf, size_t length,
+                                        WEBSOCKET_OPCODE opcode);
 FREERDP_LOCAL int websocket_read(BIO* bio, BYTE* pBuffer, size_t size,
                                  websocket_context* encodingContext);
 
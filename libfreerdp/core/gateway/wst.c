@@ -64,6 +64,7 @@ struct rdp_wst
 	uint16_t gwport;
 	char* gwpath;
 	websocket_context wscontext;
+	wStream* sendBuffer; /* reused for every outgoing frame, guarded by writeSection */
 };
 
 static const char arm_query_param[] = "%s%cClmTk=Bearer%%20%s&X-MS-User-Agent=FreeRDP%%2F3.0";
@@ -541,7 +542,8 @@ static int wst_bio_write(BIO* bio, const char* buf, int num)
 	WINPR_ASSERT(wst);
 	BIO_clear_flags(bio, BIO_FLAGS_WRITE);
 	EnterCriticalSection(&wst->writeSection);
-	status = websocket_write(wst->tls->bio, (const BYTE*)buf, num, WebsocketBinaryOpcode);
+	status = websocket_write_frame(wst->tls->bio, wst->sendBuffer, NULL, 0, (const BYTE*)buf,
+	                               (size_t)num, WebsocketBinaryOpcode);
 	LeaveCriticalSection(&wst->writeSection);
 
 	if (status < 0)
@@ -834,6 +836,10 @@ rdpWst* wst_new(rdpContext* context)
 		wst->auth = credssp_auth_new(context);
 		if (!wst->auth)
 			goto wst_alloc_error;
+
+		wst->sendBuffer = Stream_New(NULL, 4096);
+		if (!wst->sendBuffer)
+			goto wst_alloc_error;
 	}
 
 	return wst;
@@ -863,6 +869,7 @@ void wst_free(rdpWst* wst)
 
 	if (wst->wscontext.responseStreamBuffer != NULL)
 		Stream_Free(wst->wscontext.responseStreamBuffer, TRUE);
+	Stream_Free(wst->sendBuffer, TRUE);
 
 	free(wst);
 }
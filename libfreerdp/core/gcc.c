@@ -1749,6 +1749,14 @@ BOOL gcc_read_server_security_data(wStream* s, rdpMcs* mcs)
 	data = settings->ServerCertificate;
 	length = settings->ServerCertificateLength;
 
+	/* the certificate might be shared with a settings copy, do not modify that one */
+	if (!settings->RdpServerCertificate ||
+	    freerdp_certificate_is_shared(settings->RdpServerCertificate))
+	{
+		if (!freerdp_settings_set_pointer_len(settings, FreeRDP_RdpServerCertificate, NULL, 1))
+			goto fail;
+	}
+
 	if (!freerdp_certificate_read_server_cert(settings->RdpServerCertificate, data, length))
 		goto fail;
 
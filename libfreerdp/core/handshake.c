@@ -0,0 +1,263 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Server Handshake Pool
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <openssl/evp.h>
+
+#include <winpr/assert.h>
+#include <winpr/crypto.h>
+#include <winpr/interlocked.h>
+#include <winpr/synch.h>
+
+#include <freerdp/log.h>
+#include <freerdp/crypto/certificate.h>
+#include <freerdp/crypto/privatekey.h>
+
+#include "handshake.h"
+#include "../crypto/certificate.h"
+#include "../crypto/privatekey.h"
+
+#define TAG FREERDP_TAG("core.handshake")
+
+/* Bounds both the wait for a slot and the handshake holding it, so stalled clients can not
+ * keep the slots busy */
+#define HANDSHAKE_POOL_TIMEOUT_MS 10000
+
+/* Large enough for the 80 byte ticket keys of OpenSSL 1.1 and later */
+#define HANDSHAKE_POOL_TICKET_KEYS_MAX 128
+
+struct rdp_handshake_pool
+{
+	LONG refcount;
+
+	UINT32 concurrent;
+	UINT32 queued;
+	HANDLE slots;
+	LONG pending;
+	LONG rejected;
+
+	BOOL tickets;
+	BYTE ticketKeys[HANDSHAKE_POOL_TICKET_KEYS_MAX];
+
+	rdpCertificate* ecdsaCert;
+	rdpPrivateKey* ecdsaKey;
+};
+
+rdpHandshakePool* handshake_pool_new(void)
+{
+	rdpHandshakePool* pool = calloc(1, sizeof(rdpHandshakePool));
+	if (!pool)
+		return NULL;
+
+	pool->refcount = 1;
+	return pool;
+}
+
+rdpHandshakePool* handshake_pool_ref(rdpHandshakePool* pool)
+{
+	if (pool)
+		(void)InterlockedIncrement(&pool->refcount);
+	return pool;
+}
+
+void handshake_pool_unref(rdpHandshakePool* pool)
+{
+	if (!pool)
+		return;
+
+	if (InterlockedDecrement(&pool->refcount) > 0)
+		return;
+
+	if (pool->slots)
+		(void)CloseHandle(pool->slots);
+	freerdp_certificate_free(pool->ecdsaCert);
+	freerdp_key_free(pool->ecdsaKey);
+	free(pool);
+}
+
+BOOL handshake_pool_set_limits(rdpHandshakePool* pool, UINT32 concurrent, UINT32 queued)
+{
+	WINPR_ASSERT(pool);
+
+	if (concurrent > INT32_MAX)
+		return FALSE;
+
+	HANDLE slots = NULL;
+	if (concurrent > 0)
+	{
+		slots = CreateSemaphore(NULL, (LONG)concurrent, (LONG)concurrent, NULL);
+		if (!slots)
+			return FALSE;
+	}
+
+	if (pool->slots)
+		(void)CloseHandle(pool->slots);
+	pool->slots = slots;
+	pool->concurrent = concurrent;
+	pool->queued = queued;
+	return TRUE;
+}
+
+BOOL handshake_pool_set_session_tickets(rdpHandshakePool* pool, BOOL enable)
+{
+	WINPR_ASSERT(pool);
+
+	/* The keys live as long as the pool, every TLS context of its peers shares them */
+	if (enable && !pool->tickets)
+	{
+		if (winpr_RAND(pool->ticketKeys, sizeof(pool->ticketKeys)) < 0)
+			return FALSE;
+	}
+	pool->tickets = enable;
+	return TRUE;
+}
+
+BOOL handshake_pool_set_ecdsa_certificate(rdpHandshakePool* pool, const char* certfile,
+                                          const char* keyfile)
+{
+	WINPR_ASSERT(pool);
+
+	rdpCertificate* cert = NULL;
+	rdpPrivateKey* key = NULL;
+
+	if (certfile || keyfile)
+	{
+		if (!certfile || !keyfile)
+			return FALSE;
+
+		cert = freerdp_certificate_new_from_file(certfile);
+		key = freerdp_key_new_from_file(keyfile);
+		if (!cert || !key)
+		{
+			WLog_ERR(TAG, "failed to load the ECDSA certificate %s and key %s", certfile,
+			         keyfile);
+			goto fail;
+		}
+
+		EVP_PKEY* evp = freerdp_key_get_evp_pkey(key);
+		const BOOL ec = evp && (EVP_PKEY_id(evp) == EVP_PKEY_EC);
+		EVP_PKEY_free(evp);
+		if (!ec)
+		{
+			WLog_ERR(TAG, "%s is not an ECDSA private key", keyfile);
+			goto fail;
+		}
+	}
+
+	freerdp_certificate_free(pool->ecdsaCert);
+	freerdp_key_free(pool->ecdsaKey);
+	pool->ecdsaCert = cert;
+	pool->ecdsaKey = key;
+	return TRUE;
+
+fail:
+	freerdp_certificate_free(cert);
+	freerdp_key_free(key);
+	return FALSE;
+}
+
+static void handshake_pool_reject(rdpHandshakePool* pool, const char* reason)
+{
+	WINPR_ASSERT(pool);
+
+	const LONG rejected = InterlockedIncrement(&pool->rejected);
+
+	/* Rejects come in storms, only log every power of two */
+	if ((rejected & (rejected - 1)) == 0)
+		WLog_WARN(TAG, "rejecting handshake, %s [%" PRId32 " rejected so far]", reason, rejected);
+}
+
+BOOL handshake_pool_enter(rdpHandshakePool* pool)
+{
+	if (!pool || !pool->slots)
+		return TRUE;
+
+	const LONG pending = InterlockedIncrement(&pool->pending);
+	if ((UINT64)pending > (UINT64)pool->concurrent + pool->queued)
+	{
+		(void)InterlockedDecrement(&pool->pending);
+		handshake_pool_reject(pool, "queue full");
+		return FALSE;
+	}
+
+	if (WaitForSingleObject(pool->slots, HANDSHAKE_POOL_TIMEOUT_MS) != WAIT_OBJECT_0)
+	{
+		(void)InterlockedDecrement(&pool->pending);
+		handshake_pool_reject(pool, "timed out waiting for a slot");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+UINT32 handshake_pool_timeout(const rdpHandshakePool* pool)
+{
+	if (!pool || !pool->slots)
+		return 0;
+	return HANDSHAKE_POOL_TIMEOUT_MS;
+}
+
+void handshake_pool_leave(rdpHandshakePool* pool)
+{
+	if (!pool || !pool->slots)
+		return;
+
+	(void)ReleaseSemaphore(pool->slots, 1, NULL);
+	(void)InterlockedDecrement(&pool->pending);
+}
+
+BOOL handshake_pool_prepare_tls(rdpHandshakePool* pool, SSL_CTX* ctx, SSL* ssl)
+{
+	WINPR_ASSERT(ctx);
+	WINPR_ASSERT(ssl);
+
+	if (!pool)
+		return TRUE;
+
+	if (pool->tickets)
+	{
+		/* Every connection has its own SSL_CTX, tickets only resume with shared keys */
+		const long length = SSL_CTX_get_tlsext_ticket_keys(ctx, NULL, 0);
+		if ((length <= 0) || ((size_t)length > sizeof(pool->ticketKeys)) ||
+		    (SSL_CTX_set_tlsext_ticket_keys(ctx, pool->ticketKeys, length) <= 0))
+		{
+			WLog_ERR(TAG, "failed to set the TLS session ticket keys");
+			return FALSE;
+		}
+	}
+
+	if (pool->ecdsaCert && pool->ecdsaKey)
+	{
+		EVP_PKEY* evp = freerdp_key_get_evp_pkey(pool->ecdsaKey);
+		if (!evp)
+			return FALSE;
+
+		const int rc = SSL_use_PrivateKey(ssl, evp);
+		EVP_PKEY_free(evp);
+		if ((rc <= 0) || (SSL_use_certificate(ssl, freerdp_certificate_get_x509(
+		                                               pool->ecdsaCert)) <= 0))
+		{
+			WLog_ERR(TAG, "failed to use the ECDSA certificate");
+			return FALSE;
+		}
+
+		/* OpenSSL then picks the ECDSA certificate whenever the client supports it */
+		SSL_set_options(ssl, SSL_OP_CIPHER_SERVER_PREFERENCE);
+	}
+
+	return TRUE;
+}
@@ -0,0 +1,60 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Server Handshake Pool
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_HANDSHAKE_H
+#define FREERDP_LIB_CORE_HANDSHAKE_H
+
+#include <openssl/ssl.h>
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+/* Shared by all peers accepted by a listener, reference counted as peers outlive it */
+typedef struct rdp_handshake_pool rdpHandshakePool;
+
+FREERDP_LOCAL void handshake_pool_unref(rdpHandshakePool* pool);
+
+WINPR_ATTR_MALLOC(handshake_pool_unref, 1)
+FREERDP_LOCAL rdpHandshakePool* handshake_pool_new(void);
+
+FREERDP_LOCAL rdpHandshakePool* handshake_pool_ref(rdpHandshakePool* pool);
+
+FREERDP_LOCAL BOOL handshake_pool_set_limits(rdpHandshakePool* pool, UINT32 concurrent,
+                                             UINT32 queued);
+FREERDP_LOCAL BOOL handshake_pool_set_session_tickets(rdpHandshakePool* pool, BOOL enable);
+FREERDP_LOCAL BOOL handshake_pool_set_ecdsa_certificate(rdpHandshakePool* pool,
+                                                        const char* certfile,
+                                                        const char* keyfile);
+
+/**
+ * @brief handshake_pool_enter Takes one of the handshake slots, waits in the queue if all
+ * are in use.
+ *
+ * @param pool The pool of the peer, NULL for no limits
+ * @return TRUE if the handshake may proceed, FALSE if the queue is full or the wait timed out
+ */
+FREERDP_LOCAL BOOL handshake_pool_enter(rdpHandshakePool* pool);
+FREERDP_LOCAL void handshake_pool_leave(rdpHandshakePool* pool);
+
+/* The time in ms a handshake may hold its slot, 0 for no limit */
+FREERDP_LOCAL UINT32 handshake_pool_timeout(const rdpHandshakePool* pool);
+
+/* Applies the session ticket keys and the ECDSA certificate, NULL pool is a no-op */
+FREERDP_LOCAL BOOL handshake_pool_prepare_tls(rdpHandshakePool* pool, SSL_CTX* ctx, SSL* ssl);
+
+#endif /* FREERDP_LIB_CORE_HANDSHAKE_H */
@@ -52,6 +52,8 @@ state_run_t rdp_recv_heartbeat_packet(rdpRdp* rdp, wStream* s)
 		return STATE_RUN_FAILED;
 	}
 
+	/* Heartbeats keep coming while the session is idle, sample the socket with them */
+	netestimate_check(rdp->estimator, TRUE);
 	return STATE_RUN_SUCCESS;
 }
 
@@ -333,70 +333,342 @@ static BOOL input_send_keyboard_pause_event(rdpInput* input)
 	                                 RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
 }
 
-static BOOL input_send_fastpath_synchronize_event(rdpInput* input, UINT32 flags)
+static BOOL input_send_fastpath_pdu(rdpRdp* rdp, const BYTE* data, size_t length, size_t count)
 {
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	WINPR_ASSERT(rdp);
+	WINPR_ASSERT(data);
 
-	WINPR_ASSERT(input);
-	WINPR_ASSERT(input->context);
+	wStream* s = fastpath_input_pdu_init_header(rdp->fastpath);
 
-	rdp = input->context->rdp;
+	if (!s)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, length))
+	{
+		Stream_Release(s);
+		return FALSE;
+	}
+
+	Stream_Write(s, data, length);
+	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, count);
+}
+
+static BOOL input_batch_coalesce(InputBatch* batch, const BYTE* data, INPUT_COALESCE coalesce)
+{
+	WINPR_ASSERT(batch);
+	WINPR_ASSERT(data);
+
+	if ((coalesce == INPUT_COALESCE_NONE) || (batch->coalesce != coalesce))
+		return FALSE;
+
+	/* eventHeader (1 byte), pointerFlags (2 bytes), x and y (2 bytes each) */
+	BYTE* last = &batch->data[batch->coalesceOffset];
+	if (coalesce == INPUT_COALESCE_MOVE)
+	{
+		memcpy(&last[3], &data[3], 4);
+		return TRUE;
+	}
+
+	UINT16 lastX = 0;
+	UINT16 lastY = 0;
+	UINT16 x = 0;
+	UINT16 y = 0;
+	Data_Read_UINT16(&last[3], lastX);
+	Data_Read_UINT16(&last[5], lastY);
+	Data_Read_UINT16(&data[3], x);
+	Data_Read_UINT16(&data[5], y);
+
+	const INT32 xDelta = (INT16)lastX + (INT16)x;
+	const INT32 yDelta = (INT16)lastY + (INT16)y;
+	if ((xDelta < INT16_MIN) || (xDelta > INT16_MAX) || (yDelta < INT16_MIN) ||
+	    (yDelta > INT16_MAX))
+		return FALSE;
+
+	Data_Write_UINT16(&last[3], (UINT16)(INT16)xDelta);
+	Data_Write_UINT16(&last[5], (UINT16)(INT16)yDelta);
+	return TRUE;
+}
+
+static BOOL input_batch_append(InputBatch* batch, const BYTE* data, size_t length, size_t count,
+                               INPUT_COALESCE coalesce)
+{
+	WINPR_ASSERT(batch);
+
+	if (input_batch_coalesce(batch, data, coalesce))
+		return TRUE;
+
+	if ((batch->events + count > INPUT_BATCH_MAX_EVENTS) ||
+	    (batch->length + length > sizeof(batch->data)))
+		return FALSE;
+
+	memcpy(&batch->data[batch->length], data, length);
+	batch->coalesceOffset = batch->length;
+	batch->coalesce = (count == 1) ? coalesce : INPUT_COALESCE_NONE;
+	batch->length += length;
+	batch->events += count;
+	return TRUE;
+}
+
+static void input_batch_reset(InputBatch* batch)
+{
+	WINPR_ASSERT(batch);
+
+	batch->length = 0;
+	batch->events = 0;
+	batch->coalesce = INPUT_COALESCE_NONE;
+}
+
+/**
+ * Sends the batched events. Only one thread sends at a time, the events other threads add
+ * meanwhile are sent by it as well. With \b wait FALSE the call returns right away if another
+ * thread sends.
+ */
+static BOOL input_batch_flush(rdpInput* input, BOOL wait)
+{
+	BOOL rc = TRUE;
+	rdp_input_internal* in = input_cast(input);
+
+	WINPR_ASSERT(input->context);
+	rdpRdp* rdp = input->context->rdp;
 	WINPR_ASSERT(rdp);
 
-	if (!input_ensure_client_running(input))
+	for (;;)
+	{
+		if (wait)
+			EnterCriticalSection(&in->sendLock);
+		else if (!TryEnterCriticalSection(&in->sendLock))
+			return TRUE;
+		wait = FALSE;
+
+		while (rc)
+		{
+			BYTE data[sizeof(in->batch.data)];
+
+			EnterCriticalSection(&in->batchLock);
+			const size_t length = in->batch.length;
+			const size_t count = in->batch.events;
+			memcpy(data, in->batch.data, length);
+			input_batch_reset(&in->batch);
+			LeaveCriticalSection(&in->batchLock);
+
+			if (count == 0)
+				break;
+			rc = input_send_fastpath_pdu(rdp, data, length, count);
+		}
+		LeaveCriticalSection(&in->sendLock);
+
+		/* Events added after the last check but before the lock was left */
+		EnterCriticalSection(&in->batchLock);
+		const BOOL pending = in->batch.events > 0;
+		LeaveCriticalSection(&in->batchLock);
+
+		if (!pending || !rc)
+			return rc;
+	}
+}
+
+static BOOL input_ring_push(rdp_input_internal* in, const BYTE* data, size_t length, size_t count,
+                            INPUT_COALESCE coalesce)
+{
+	WINPR_ASSERT(in);
+	WINPR_ASSERT(data);
+	WINPR_ASSERT(length <= INPUT_FASTPATH_EVENTS_SIZE);
+	WINPR_ASSERT(count <= INPUT_BATCH_MAX_EVENTS);
+
+	/* A slot is free for the write position pos if its sequence is pos, filled if it is pos + 1 */
+	for (;;)
+	{
+		const LONG pos = InterlockedCompareExchange(&in->ringWrite, 0, 0);
+		InputRingSlot* slot = &in->ring[(ULONG)pos & (INPUT_RING_SIZE - 1)];
+		const LONG sequence = InterlockedCompareExchange(&slot->sequence, 0, 0);
+
+		if (sequence == pos)
+		{
+			if (InterlockedCompareExchange(&in->ringWrite, (LONG)((ULONG)pos + 1), pos) != pos)
+				continue;
+
+			memcpy(slot->data, data, length);
+			slot->length = (BYTE)length;
+			slot->count = (BYTE)count;
+			slot->coalesce = (BYTE)coalesce;
+			(void)InterlockedExchange(&slot->sequence, (LONG)((ULONG)pos + 1));
+			return TRUE;
+		}
+
+		/* Still holds the event of the previous round */
+		if ((LONG)((ULONG)sequence - (ULONG)pos) < 0)
+			return FALSE;
+	}
+}
+
+/* Only called by the sender thread */
+static BOOL input_ring_pop(rdp_input_internal* in, InputRingSlot* event)
+{
+	WINPR_ASSERT(in);
+	WINPR_ASSERT(event);
+
+	const LONG pos = in->ringRead;
+	InputRingSlot* slot = &in->ring[(ULONG)pos & (INPUT_RING_SIZE - 1)];
+
+	if (InterlockedCompareExchange(&slot->sequence, 0, 0) != (LONG)((ULONG)pos + 1))
 		return FALSE;
 
-	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
-	s = fastpath_input_pdu_init(rdp->fastpath, (BYTE)flags, FASTPATH_INPUT_EVENT_SYNC);
+	memcpy(event->data, slot->data, slot->length);
+	event->length = slot->length;
+	event->count = slot->count;
+	event->coalesce = slot->coalesce;
+	(void)InterlockedExchange(&slot->sequence, (LONG)((ULONG)pos + INPUT_RING_SIZE));
+	in->ringRead = (LONG)((ULONG)pos + 1);
+	return TRUE;
+}
 
-	if (!s)
+/**
+ * Runs on the sender thread of the transport send queue, it batches what the ring holds and
+ * writes it ahead of the queued PDUs.
+ */
+static BOOL input_ring_drain(rdpTransport* transport, void* arg)
+{
+	rdpInput* input = arg;
+	rdp_input_internal* in = input_cast(input);
+	InputBatch batch = { 0 };
+	InputRingSlot event = { 0 };
+	BOOL rc = TRUE;
+
+	WINPR_UNUSED(transport);
+	WINPR_ASSERT(input->context);
+	rdpRdp* rdp = input->context->rdp;
+	WINPR_ASSERT(rdp);
+
+	while (rc && input_ring_pop(in, &event))
+	{
+		const INPUT_COALESCE coalesce = (INPUT_COALESCE)event.coalesce;
+		if (input_batch_append(&batch, event.data, event.length, event.count, coalesce))
+			continue;
+
+		rc = input_send_fastpath_pdu(rdp, batch.data, batch.length, batch.events);
+		input_batch_reset(&batch);
+		if (!input_batch_append(&batch, event.data, event.length, event.count, coalesce))
+			rc = FALSE;
+	}
+
+	if (rc && (batch.events > 0))
+		rc = input_send_fastpath_pdu(rdp, batch.data, batch.length, batch.events);
+	return rc;
+}
+
+static BOOL input_ring_send(rdpInput* input, const BYTE* data, size_t length, size_t count,
+                            INPUT_COALESCE coalesce)
+{
+	rdp_input_internal* in = input_cast(input);
+
+	WINPR_ASSERT(input->context);
+	rdpRdp* rdp = input->context->rdp;
+	WINPR_ASSERT(rdp);
+
+	while (!input_ring_push(in, data, length, count, coalesce))
+	{
+		/* The sender thread fell behind, it empties the ring before it writes anything else */
+		if (!transport_send_source_signal(rdp->transport, input_ring_drain, input))
+			return FALSE;
+		Sleep(1);
+	}
+
+	return transport_send_source_signal(rdp->transport, input_ring_drain, input);
+}
+
+static BOOL input_send_fastpath_events(rdpInput* input, wStream* s, size_t count,
+                                       INPUT_COALESCE coalesce)
+{
+	rdp_input_internal* in = input_cast(input);
+
+	WINPR_ASSERT(s);
+	WINPR_ASSERT(input->context);
+	rdpRdp* rdp = input->context->rdp;
+	WINPR_ASSERT(rdp);
+
+	const BYTE* data = Stream_Buffer(s);
+	const size_t length = Stream_GetPosition(s);
+	if (!freerdp_settings_get_bool(input->context->settings, FreeRDP_FastPathInputBatching))
+		return input_send_fastpath_pdu(rdp, data, length, count);
+
+	/* Standard RDP security encrypts in write order, its PDUs are all sent in one class */
+	if (!rdp->do_crypt && transport_have_send_queue(rdp->transport))
+		return input_ring_send(input, data, length, count, coalesce);
+
+	/* Key and button events are never merged, a full batch is sent before adding more */
+	for (;;)
+	{
+		EnterCriticalSection(&in->batchLock);
+		const BOOL queued = input_batch_append(&in->batch, data, length, count, coalesce);
+		LeaveCriticalSection(&in->batchLock);
+
+		if (queued)
+			break;
+		if (!input_batch_flush(input, TRUE))
+			return FALSE;
+	}
+
+	return input_batch_flush(input, FALSE);
+}
+
+static wStream* input_fastpath_event_init(wStream* buffer, BYTE* data, size_t size,
+                                          BYTE eventFlags, BYTE eventCode)
+{
+	wStream* s = Stream_StaticInit(buffer, data, size);
+	Stream_Write_UINT8(s, eventFlags | (eventCode << 5)); /* eventHeader (1 byte) */
+	return s;
+}
+
+static BOOL input_send_fastpath_synchronize_event(rdpInput* input, UINT32 flags)
+{
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
+
+	WINPR_ASSERT(input);
+	WINPR_ASSERT(input->context);
+
+	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
+	wStream* s = input_fastpath_event_init(&buffer, data, sizeof(data), (BYTE)flags,
+	                                       FASTPATH_INPUT_EVENT_SYNC);
+	return input_send_fastpath_events(input, s, 1, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_keyboard_event(rdpInput* input, UINT16 flags, UINT8 code)
 {
-	wStream* s = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED) ? FASTPATH_INPUT_KBDFLAGS_EXTENDED : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED1) ? FASTPATH_INPUT_KBDFLAGS_PREFIX_E1 : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE);
-
-	if (!s)
-		return FALSE;
+	wStream* s = input_fastpath_event_init(&buffer, data, sizeof(data), eventFlags,
+	                                       FASTPATH_INPUT_EVENT_SCANCODE);
 
 	WINPR_ASSERT(code <= UINT8_MAX);
 	Stream_Write_UINT8(s, code); /* keyCode (1 byte) */
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	return input_send_fastpath_events(input, s, 1, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_unicode_keyboard_event(rdpInput* input, UINT16 flags, UINT16 code)
 {
-	wStream* s = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -407,27 +679,22 @@ static BOOL input_send_fastpath_unicode_keyboard_event(rdpInput* input, UINT16 f
 	}
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_UNICODE);
-
-	if (!s)
-		return FALSE;
+	wStream* s = input_fastpath_event_init(&buffer, data, sizeof(data), eventFlags,
+	                                       FASTPATH_INPUT_EVENT_UNICODE);
 
 	Stream_Write_UINT16(s, code); /* unicodeCode (2 bytes) */
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	return input_send_fastpath_events(input, s, 1, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_mouse_event(rdpInput* input, UINT16 flags, UINT16 x, UINT16 y)
 {
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -443,27 +710,24 @@ static BOOL input_send_fastpath_mouse_event(rdpInput* input, UINT16 flags, UINT1
 		}
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSE);
-
-	if (!s)
-		return FALSE;
+	wStream* s =
+	    input_fastpath_event_init(&buffer, data, sizeof(data), 0, FASTPATH_INPUT_EVENT_MOUSE);
 
 	input_write_mouse_event(s, flags, x, y);
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	return input_send_fastpath_events(input, s, 1,
+	                                  (flags == PTR_FLAGS_MOVE) ? INPUT_COALESCE_MOVE
+	                                                            : INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_extended_mouse_event(rdpInput* input, UINT16 flags, UINT16 x,
                                                      UINT16 y)
 {
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -476,28 +740,23 @@ static BOOL input_send_fastpath_extended_mouse_event(rdpInput* input, UINT16 fla
 		return TRUE;
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSEX);
-
-	if (!s)
-		return FALSE;
+	wStream* s =
+	    input_fastpath_event_init(&buffer, data, sizeof(data), 0, FASTPATH_INPUT_EVENT_MOUSEX);
 
 	input_write_extended_mouse_event(s, flags, x, y);
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	return input_send_fastpath_events(input, s, 1, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_relmouse_event(rdpInput* input, UINT16 flags, INT16 xDelta,
                                                INT16 yDelta)
 {
-	wStream* s = NULL;
-	rdpRdp* rdp = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -507,26 +766,26 @@ static BOOL input_send_fastpath_relmouse_event(rdpInput* input, UINT16 flags, IN
 		return FALSE;
 	}
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, TS_FP_RELPOINTER_EVENT);
-
-	if (!s)
-		return FALSE;
+	wStream* s =
+	    input_fastpath_event_init(&buffer, data, sizeof(data), 0, TS_FP_RELPOINTER_EVENT);
 
 	Stream_Write_UINT16(s, flags); /* pointerFlags (2 bytes) */
 	Stream_Write_INT16(s, xDelta); /* xDelta (2 bytes) */
 	Stream_Write_INT16(s, yDelta); /* yDelta (2 bytes) */
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	return input_send_fastpath_events(input, s, 1,
+	                                  (flags == PTR_FLAGS_MOVE) ? INPUT_COALESCE_RELMOVE
+	                                                            : INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_qoe_event(rdpInput* input, UINT32 timestampMS)
 {
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
+
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 	WINPR_ASSERT(input->context->settings);
 
-	rdpRdp* rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
@@ -536,40 +795,26 @@ static BOOL input_send_fastpath_qoe_event(rdpInput* input, UINT32 timestampMS)
 		return FALSE;
 	}
 
-	wStream* s = fastpath_input_pdu_init(rdp->fastpath, 0, TS_FP_QOETIMESTAMP_EVENT);
-
-	if (!s)
-		return FALSE;
-
-	if (!Stream_EnsureRemainingCapacity(s, 4))
-	{
-		Stream_Free(s, TRUE);
-		return FALSE;
-	}
+	wStream* s =
+	    input_fastpath_event_init(&buffer, data, sizeof(data), 0, TS_FP_QOETIMESTAMP_EVENT);
 
 	Stream_Write_UINT32(s, timestampMS);
-	return fastpath_send_input_pdu(rdp->fastpath, s);
+	return input_send_fastpath_events(input, s, 1, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_focus_in_event(rdpInput* input, UINT16 toggleStates)
 {
-	wStream* s = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 	BYTE eventFlags = 0;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	s = fastpath_input_pdu_init_header(rdp->fastpath);
-
-	if (!s)
-		return FALSE;
+	wStream* s = Stream_StaticInit(&buffer, data, sizeof(data));
 
 	/* send a tab up like mstsc.exe */
 	eventFlags = FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_EVENT_SCANCODE << 5;
@@ -582,7 +827,7 @@ static BOOL input_send_fastpath_focus_in_event(rdpInput* input, UINT16 toggleSta
 	eventFlags = FASTPATH_INPUT_KBDFLAGS_RELEASE | FASTPATH_INPUT_EVENT_SCANCODE << 5;
 	Stream_Write_UINT8(s, eventFlags); /* Key Release event (1 byte) */
 	Stream_Write_UINT8(s, 0x0f);       /* keyCode (1 byte) */
-	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, 3);
+	return input_send_fastpath_events(input, s, 3, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
@@ -591,24 +836,18 @@ static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
 	 * and pause-up sent nothing.  However, reverse engineering mstsc shows
 	 * it sending the following sequence:
 	 */
-	wStream* s = NULL;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE] = { 0 };
+	wStream buffer = { 0 };
 	const BYTE keyDownEvent = FASTPATH_INPUT_EVENT_SCANCODE << 5;
 	const BYTE keyUpEvent = (FASTPATH_INPUT_EVENT_SCANCODE << 5) | FASTPATH_INPUT_KBDFLAGS_RELEASE;
-	rdpRdp* rdp = NULL;
 
 	WINPR_ASSERT(input);
 	WINPR_ASSERT(input->context);
 
-	rdp = input->context->rdp;
-	WINPR_ASSERT(rdp);
-
 	if (!input_ensure_client_running(input))
 		return FALSE;
 
-	s = fastpath_input_pdu_init_header(rdp->fastpath);
-
-	if (!s)
-		return FALSE;
+	wStream* s = Stream_StaticInit(&buffer, data, sizeof(data));
 
 	/* Control down (0x1D) */
 	Stream_Write_UINT8(s, keyDownEvent | FASTPATH_INPUT_KBDFLAGS_PREFIX_E1);
@@ -622,7 +861,7 @@ static BOOL input_send_fastpath_keyboard_pause_event(rdpInput* input)
 	/* Numlock down (0x45) */
 	Stream_Write_UINT8(s, keyUpEvent);
 	Stream_Write_UINT8(s, RDP_SCANCODE_CODE(RDP_SCANCODE_NUMLOCK));
-	return fastpath_send_multiple_input_pdu(rdp->fastpath, s, 4);
+	return input_send_fastpath_events(input, s, 4, INPUT_COALESCE_NONE);
 }
 
 static BOOL input_recv_sync_event(rdpInput* input, wStream* s)
@@ -1063,6 +1302,24 @@ rdpInput* input_new(rdpRdp* rdp)
 		return NULL;
 	}
 
+	if (!InitializeCriticalSectionAndSpinCount(&input->batchLock, 4000))
+	{
+		MessageQueue_Free(input->queue);
+		free(input);
+		return NULL;
+	}
+
+	if (!InitializeCriticalSectionAndSpinCount(&input->sendLock, 4000))
+	{
+		DeleteCriticalSection(&input->batchLock);
+		MessageQueue_Free(input->queue);
+		free(input);
+		return NULL;
+	}
+
+	for (LONG x = 0; x < INPUT_RING_SIZE; x++)
+		input->ring[x].sequence = x;
+
 	return &input->common;
 }
 
@@ -1073,6 +1330,8 @@ void input_free(rdpInput* input)
 		rdp_input_internal* in = input_cast(input);
 
 		MessageQueue_Free(in->queue);
+		DeleteCriticalSection(&in->sendLock);
+		DeleteCriticalSection(&in->batchLock);
 		free(in);
 	}
 }
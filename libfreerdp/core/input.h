@@ -29,6 +29,39 @@
 #include <freerdp/api.h>
 
 #include <winpr/stream.h>
+#include <winpr/synch.h>
+
+/* A fastpath input PDU carries up to 15 events, the largest event is 7 bytes long */
+#define INPUT_BATCH_MAX_EVENTS 15
+#define INPUT_FASTPATH_EVENTS_SIZE 16
+
+typedef enum
+{
+	INPUT_COALESCE_NONE,
+	INPUT_COALESCE_MOVE,
+	INPUT_COALESCE_RELMOVE
+} INPUT_COALESCE;
+
+typedef struct
+{
+	BYTE data[INPUT_BATCH_MAX_EVENTS * 7];
+	size_t length;
+	size_t events;
+	size_t coalesceOffset;
+	INPUT_COALESCE coalesce;
+} InputBatch;
+
+/* Slots of the input ring, a power of 2 */
+#define INPUT_RING_SIZE 256
+
+typedef struct
+{
+	volatile LONG sequence;
+	BYTE length;
+	BYTE count;
+	BYTE coalesce;
+	BYTE data[INPUT_FASTPATH_EVENTS_SIZE];
+} InputRingSlot;
 
 typedef struct
 {
@@ -41,6 +74,17 @@ typedef struct
 	UINT64 lastInputTimestamp;
 	UINT16 lastX;
 	UINT16 lastY;
+
+	/* FreeRDP_FastPathInputBatching */
+	CRITICAL_SECTION batchLock;
+	CRITICAL_SECTION sendLock;
+	InputBatch batch;
+
+	/* With the transport send queue the events go lock free to its sender thread, which is
+	 * the only reader */
+	volatile LONG ringWrite;
+	LONG ringRead;
+	InputRingSlot ring[INPUT_RING_SIZE];
 } rdp_input_internal;
 
 static INLINE rdp_input_internal* input_cast(rdpInput* input)
@@ -658,6 +658,25 @@ error_path:
 	return NULL;
 }
 
+static BOOL license_cache_cal(rdpRdp* rdp, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(rdp);
+	WINPR_ASSERT(data || (length == 0));
+
+	if ((length == 0) || (length > UINT16_MAX))
+		return FALSE;
+
+	BYTE* copy = malloc(length);
+	if (!copy)
+		return FALSE;
+	memcpy(copy, data, length);
+
+	free(rdp->cachedLicense);
+	rdp->cachedLicense = copy;
+	rdp->cachedLicenseLength = length;
+	return TRUE;
+}
+
 /**
  * Read a licensing preamble.
  * msdn{cc240480}
@@ -2210,9 +2229,21 @@ BOOL license_read_new_or_upgrade_license_packet(rdpLicense* license, wStream* s)
 	license->type = LICENSE_TYPE_ISSUED;
 	ret = license_set_state(license, LICENSE_STATE_COMPLETED);
 
-	if (!license->rdp->settings->OldLicenseBehaviour)
-		ret = saveCal(license->rdp->settings, Stream_Pointer(licenseStream), cbLicenseInfo,
-		              license->rdp->settings->ClientHostname);
+	if (ret && !license->rdp->settings->OldLicenseBehaviour)
+	{
+		const BYTE* data = Stream_Pointer(licenseStream);
+
+		/* Reconnects reuse the license even if the store is not writable */
+		if (license_cache_cal(license->rdp, data, cbLicenseInfo))
+		{
+			if (!saveCal(license->rdp->settings, data, cbLicenseInfo,
+			             license->rdp->settings->ClientHostname))
+				WLog_WARN(TAG, "license store not available, keeping the license in memory");
+		}
+		else
+			ret = saveCal(license->rdp->settings, data, cbLicenseInfo,
+			              license->rdp->settings->ClientHostname);
+	}
 
 fail:
 	license_free_binary_blob(calBlob);
@@ -2389,9 +2420,22 @@ BOOL license_answer_license_request(rdpLicense* license)
 	WINPR_ASSERT(license->rdp->settings);
 
 	if (!license->rdp->settings->OldLicenseBehaviour)
+	{
 		license_data = loadCalFile(license->rdp->settings, license->rdp->settings->ClientHostname,
 		                           &license_size);
 
+		rdpRdp* rdp = license->rdp;
+		if (!license_data && rdp->cachedLicense)
+		{
+			license_data = malloc(rdp->cachedLicenseLength);
+			if (license_data)
+			{
+				memcpy(license_data, rdp->cachedLicense, rdp->cachedLicenseLength);
+				license_size = rdp->cachedLicenseLength;
+			}
+		}
+	}
+
 	if (license_data)
 	{
 		LICENSE_BLOB* calBlob = NULL;
@@ -52,6 +52,8 @@
 
 #define TAG FREERDP_TAG("core.listener")
 
+static BOOL freerdp_listener_start_thread(rdpListener* listener, int index);
+
 static BOOL freerdp_listener_open_from_vsock(freerdp_listener* instance, const char* bind_address,
                                              UINT16 port)
 {
@@ -115,6 +117,12 @@ static BOOL freerdp_listener_open_from_vsock(freerdp_listener* instance, const c
 	}
 
 	WSAEventSelect(sockfd, listener->events[listener->num_sockfds], FD_READ | FD_ACCEPT | FD_CLOSE);
+	if (!freerdp_listener_start_thread(listener, listener->num_sockfds))
+	{
+		closesocket((SOCKET)sockfd);
+		(void)CloseHandle(listener->events[listener->num_sockfds]);
+		return FALSE;
+	}
 	listener->num_sockfds++;
 
 	WLog_INFO(TAG, "Listening on %s:%d", bind_address, port);
@@ -125,109 +133,153 @@ static BOOL freerdp_listener_open_from_vsock(freerdp_listener* instance, const c
 #endif
 }
 
-static BOOL freerdp_listener_open(freerdp_listener* instance, const char* bind_address, UINT16 port)
+/* Returns FALSE if the listener can not take more sockets, unusable addresses are skipped */
+static BOOL freerdp_listener_open_addr(rdpListener* listener, const struct addrinfo* ai,
+                                       UINT16 port, BOOL reuseport)
 {
-	int ai_flags = 0;
 	int status = 0;
 	int sockfd = 0;
 	char addr[64];
 	void* sin_addr = NULL;
 	int option_value = 0;
-	struct addrinfo* res = NULL;
-	rdpListener* listener = (rdpListener*)instance->listener;
 #ifdef _WIN32
 	u_long arg;
 #endif
 
-	if (!bind_address)
-		ai_flags = AI_PASSIVE;
+	if (listener->num_sockfds == MAX_LISTENER_HANDLES)
+	{
+		WLog_ERR(TAG, "too many listening sockets");
+		return FALSE;
+	}
 
-	if (utils_is_vsock(bind_address))
+	sockfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+
+	if (sockfd == -1)
 	{
-		bind_address = utils_is_vsock(bind_address);
-		return freerdp_listener_open_from_vsock(instance, bind_address, port);
+		WLog_ERR(TAG, "socket");
+		return TRUE;
 	}
 
-	res = freerdp_tcp_resolve_host(bind_address, port, ai_flags);
+	option_value = 1;
 
-	if (!res)
-		return FALSE;
+	if (ai->ai_family == AF_INET)
+		sin_addr = &(((struct sockaddr_in*)ai->ai_addr)->sin_addr);
+	else
+	{
+		sin_addr = &(((struct sockaddr_in6*)ai->ai_addr)->sin6_addr);
+		if (setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, (void*)&option_value,
+		               sizeof(option_value)) == -1)
+			WLog_ERR(TAG, "setsockopt");
+	}
+
+	inet_ntop(ai->ai_family, sin_addr, addr, sizeof(addr));
+
+	if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (void*)&option_value,
+	               sizeof(option_value)) == -1)
+		WLog_ERR(TAG, "setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR)");
 
-	for (struct addrinfo* ai = res; ai && (listener->num_sockfds < 5); ai = ai->ai_next)
+#if defined(SO_REUSEPORT)
+	if (reuseport && (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, (void*)&option_value,
+	                             sizeof(option_value)) == -1))
 	{
-		if ((ai->ai_family != AF_INET) && (ai->ai_family != AF_INET6))
-			continue;
+		WLog_ERR(TAG, "setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT)");
+		closesocket((SOCKET)sockfd);
+		return TRUE;
+	}
+#else
+	WINPR_UNUSED(reuseport);
+#endif
 
-		if (listener->num_sockfds == MAX_LISTENER_HANDLES)
-		{
-			WLog_ERR(TAG, "too many listening sockets");
-			continue;
-		}
+#ifndef _WIN32
+	if (fcntl(sockfd, F_SETFL, O_NONBLOCK) != 0)
+		WLog_ERR(TAG, "fcntl(sockfd, F_SETFL, O_NONBLOCK)");
+#else
+	arg = 1;
+	ioctlsocket(sockfd, FIONBIO, &arg);
+#endif
+	status = _bind((SOCKET)sockfd, ai->ai_addr, ai->ai_addrlen);
 
-		sockfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+	if (status != 0)
+	{
+		closesocket((SOCKET)sockfd);
+		return TRUE;
+	}
 
-		if (sockfd == -1)
-		{
-			WLog_ERR(TAG, "socket");
-			continue;
-		}
+	status = _listen((SOCKET)sockfd, 10);
+
+	if (status != 0)
+	{
+		WLog_ERR(TAG, "listen");
+		closesocket((SOCKET)sockfd);
+		return TRUE;
+	}
 
-		option_value = 1;
+	/* FIXME: these file descriptors do not work on Windows */
+	listener->sockfds[listener->num_sockfds] = sockfd;
+	listener->events[listener->num_sockfds] = WSACreateEvent();
 
-		if (ai->ai_family == AF_INET)
-			sin_addr = &(((struct sockaddr_in*)ai->ai_addr)->sin_addr);
-		else
-		{
-			sin_addr = &(((struct sockaddr_in6*)ai->ai_addr)->sin6_addr);
-			if (setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, (void*)&option_value,
-			               sizeof(option_value)) == -1)
-				WLog_ERR(TAG, "setsockopt");
-		}
+	if (!listener->events[listener->num_sockfds])
+	{
+		closesocket((SOCKET)sockfd);
+		return FALSE;
+	}
 
-		inet_ntop(ai->ai_family, sin_addr, addr, sizeof(addr));
+	WSAEventSelect(sockfd, listener->events[listener->num_sockfds],
+	               FD_READ | FD_ACCEPT | FD_CLOSE);
+	if (!freerdp_listener_start_thread(listener, listener->num_sockfds))
+	{
+		closesocket((SOCKET)sockfd);
+		(void)CloseHandle(listener->events[listener->num_sockfds]);
+		return FALSE;
+	}
+	listener->num_sockfds++;
+	WLog_INFO(TAG, "Listening on [%s]:%" PRIu16, addr, port);
+	return TRUE;
+}
 
-		if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (void*)&option_value,
-		               sizeof(option_value)) == -1)
-			WLog_ERR(TAG, "setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR)");
+static BOOL freerdp_listener_open(freerdp_listener* instance, const char* bind_address, UINT16 port)
+{
+	int ai_flags = 0;
+	struct addrinfo* res = NULL;
+	rdpListener* listener = (rdpListener*)instance->listener;
+	UINT32 copies = 1;
 
-#ifndef _WIN32
-		if (fcntl(sockfd, F_SETFL, O_NONBLOCK) != 0)
-			WLog_ERR(TAG, "fcntl(sockfd, F_SETFL, O_NONBLOCK)");
-#else
-		arg = 1;
-		ioctlsocket(sockfd, FIONBIO, &arg);
-#endif
-		status = _bind((SOCKET)sockfd, ai->ai_addr, ai->ai_addrlen);
+	if (!bind_address)
+		ai_flags = AI_PASSIVE;
 
-		if (status != 0)
-		{
-			closesocket((SOCKET)sockfd);
-			continue;
-		}
+	if (utils_is_vsock(bind_address))
+	{
+		bind_address = utils_is_vsock(bind_address);
+		return freerdp_listener_open_from_vsock(instance, bind_address, port);
+	}
 
-		status = _listen((SOCKET)sockfd, 10);
+	res = freerdp_tcp_resolve_host(bind_address, port, ai_flags);
 
-		if (status != 0)
-		{
-			WLog_ERR(TAG, "listen");
-			closesocket((SOCKET)sockfd);
-			continue;
-		}
+	if (!res)
+		return FALSE;
 
-		/* FIXME: these file descriptors do not work on Windows */
-		listener->sockfds[listener->num_sockfds] = sockfd;
-		listener->events[listener->num_sockfds] = WSACreateEvent();
+#if defined(SO_REUSEPORT)
+	/* one socket per accept thread, the kernel balances the connections between them */
+	if (listener->accept_threads > 1)
+		copies = listener->accept_threads;
+#endif
 
-		if (!listener->events[listener->num_sockfds])
+	for (struct addrinfo* ai = res; ai; ai = ai->ai_next)
+	{
+		if ((ai->ai_family != AF_INET) && (ai->ai_family != AF_INET6))
+			continue;
+
+		BOOL full = FALSE;
+		for (UINT32 x = 0; x < copies; x++)
 		{
-			listener->num_sockfds = 0;
-			break;
+			if (!freerdp_listener_open_addr(listener, ai, port, copies > 1))
+			{
+				full = TRUE;
+				break;
+			}
 		}
-
-		WSAEventSelect(sockfd, listener->events[listener->num_sockfds],
-		               FD_READ | FD_ACCEPT | FD_CLOSE);
-		listener->num_sockfds++;
-		WLog_INFO(TAG, "Listening on [%s]:%" PRIu16, addr, port);
+		if (full)
+			break;
 	}
 
 	freeaddrinfo(res);
@@ -297,6 +349,12 @@ static BOOL freerdp_listener_open_local(freerdp_listener* instance, const char*
 
 	listener->sockfds[listener->num_sockfds] = sockfd;
 	listener->events[listener->num_sockfds] = hevent;
+	if (!freerdp_listener_start_thread(listener, listener->num_sockfds))
+	{
+		closesocket((SOCKET)sockfd);
+		(void)CloseHandle(hevent);
+		return FALSE;
+	}
 	listener->num_sockfds++;
 	WLog_INFO(TAG, "Listening on socket %s.", addr.sun_path);
 	return TRUE;
@@ -326,6 +384,11 @@ static BOOL freerdp_listener_open_from_socket(freerdp_listener* instance, int fd
 		return FALSE;
 
 	WSAEventSelect(fd, listener->events[listener->num_sockfds], FD_READ | FD_ACCEPT | FD_CLOSE);
+	if (!freerdp_listener_start_thread(listener, listener->num_sockfds))
+	{
+		(void)CloseHandle(listener->events[listener->num_sockfds]);
+		return FALSE;
+	}
 
 	listener->num_sockfds++;
 	WLog_INFO(TAG, "Listening on socket %d.", fd);
@@ -339,6 +402,20 @@ static void freerdp_listener_close(freerdp_listener* instance)
 {
 	rdpListener* listener = (rdpListener*)instance->listener;
 
+	if (listener->accept_threads > 0)
+	{
+		(void)SetEvent(listener->stopEvent);
+		for (int i = 0; i < listener->num_sockfds; i++)
+		{
+			rdpListenerThread* thread = &listener->threads[i];
+			(void)WaitForSingleObject(thread->thread, INFINITE);
+			(void)CloseHandle(thread->thread);
+			thread->thread = NULL;
+		}
+		(void)ResetEvent(listener->stopEvent);
+		(void)ResetEvent(listener->errorEvent);
+	}
+
 	for (int i = 0; i < listener->num_sockfds; i++)
 	{
 		closesocket((SOCKET)listener->sockfds[i]);
@@ -374,6 +451,15 @@ static DWORD freerdp_listener_get_event_handles(freerdp_listener* instance, HAND
 	if (listener->num_sockfds < 1)
 		return 0;
 
+	/* the sockets are served by the accept threads, only report their failure */
+	if (listener->accept_threads > 0)
+	{
+		if (nCount < 1)
+			return 0;
+		events[0] = listener->errorEvent;
+		return 1;
+	}
+
 	if (listener->num_sockfds > (INT64)nCount)
 		return 0;
 
@@ -449,6 +535,10 @@ static BOOL freerdp_check_and_create_client(freerdp_listener* instance, int peer
 		return FALSE;
 	}
 
+	rdpListener* listener = (rdpListener*)instance->listener;
+	WINPR_ASSERT(listener);
+	client->HandshakePool = handshake_pool_ref(listener->handshake);
+
 	if (!freerdp_peer_set_local_and_hostname(client, peer_addr))
 	{
 		freerdp_peer_free(client);
@@ -465,21 +555,19 @@ static BOOL freerdp_check_and_create_client(freerdp_listener* instance, int peer
 	return TRUE;
 }
 
-static BOOL freerdp_listener_check_fds(freerdp_listener* instance)
+/* Accepts one or all pending connections of a listening socket */
+static BOOL freerdp_listener_accept(rdpListener* listener, int index, BOOL all)
 {
-	rdpListener* listener = (rdpListener*)instance->listener;
+	WINPR_ASSERT(listener);
 
-	if (listener->num_sockfds < 1)
-		return FALSE;
-
-	for (int i = 0; i < listener->num_sockfds; i++)
+	(void)WSAResetEvent(listener->events[index]);
+	do
 	{
 		struct sockaddr_storage peer_addr = { 0 };
 
-		(void)WSAResetEvent(listener->events[i]);
 		int peer_addr_size = sizeof(peer_addr);
 		int peer_sockfd =
-		    _accept(listener->sockfds[i], (struct sockaddr*)&peer_addr, &peer_addr_size);
+		    _accept(listener->sockfds[index], (struct sockaddr*)&peer_addr, &peer_addr_size);
 
 		if (peer_sockfd == -1)
 		{
@@ -489,25 +577,160 @@ static BOOL freerdp_listener_check_fds(freerdp_listener* instance)
 
 			/* No data available */
 			if (wsa_error == WSAEWOULDBLOCK)
-				continue;
+				return TRUE;
 
 #else
 
 			if (errno == EAGAIN || errno == EWOULDBLOCK)
-				continue;
+				return TRUE;
 
 #endif
 			WLog_WARN(TAG, "accept failed with %s", winpr_strerror(errno, buffer, sizeof(buffer)));
 			return FALSE;
 		}
 
-		if (!freerdp_check_and_create_client(instance, peer_sockfd, &peer_addr))
+		if (!freerdp_check_and_create_client(listener->instance, peer_sockfd, &peer_addr))
 			return FALSE;
+	} while (all);
+
+	return TRUE;
+}
+
+static DWORD WINAPI freerdp_listener_thread(LPVOID arg)
+{
+	rdpListenerThread* thread = arg;
+	WINPR_ASSERT(thread);
+
+	rdpListener* listener = thread->listener;
+	WINPR_ASSERT(listener);
+
+	HANDLE events[] = { listener->stopEvent, listener->events[thread->index] };
+	while (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE) ==
+	       WAIT_OBJECT_0 + 1)
+	{
+		/* drain the backlog, connection storms arrive faster than single wakeups */
+		if (!freerdp_listener_accept(listener, thread->index, TRUE))
+		{
+			(void)SetEvent(listener->errorEvent);
+			break;
+		}
 	}
 
+	ExitThread(0);
+	return 0;
+}
+
+static BOOL freerdp_listener_start_thread(rdpListener* listener, int index)
+{
+	WINPR_ASSERT(listener);
+	WINPR_ASSERT(index < MAX_LISTENER_HANDLES);
+
+	if (listener->accept_threads == 0)
+		return TRUE;
+
+	rdpListenerThread* thread = &listener->threads[index];
+	thread->listener = listener;
+	thread->index = index;
+	thread->thread = CreateThread(NULL, 0, freerdp_listener_thread, thread, 0, NULL);
+	if (!thread->thread)
+	{
+		WLog_ERR(TAG, "failed to start accept thread");
+		return FALSE;
+	}
 	return TRUE;
 }
 
+static BOOL freerdp_listener_check_fds(freerdp_listener* instance)
+{
+	rdpListener* listener = (rdpListener*)instance->listener;
+
+	if (listener->num_sockfds < 1)
+		return FALSE;
+
+	if (listener->accept_threads > 0)
+		return WaitForSingleObject(listener->errorEvent, 0) != WAIT_OBJECT_0;
+
+	for (int i = 0; i < listener->num_sockfds; i++)
+	{
+		if (!freerdp_listener_accept(listener, i, FALSE))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL freerdp_listener_set_accept_threads(freerdp_listener* instance, UINT32 count)
+{
+	WINPR_ASSERT(instance);
+
+	rdpListener* listener = (rdpListener*)instance->listener;
+	WINPR_ASSERT(listener);
+
+	if (listener->num_sockfds > 0)
+	{
+		WLog_ERR(TAG, "accept threads must be configured before opening the listener");
+		return FALSE;
+	}
+
+	if (count > MAX_LISTENER_HANDLES)
+	{
+		WLog_ERR(TAG, "at most %d accept threads are supported", MAX_LISTENER_HANDLES);
+		return FALSE;
+	}
+
+#if !defined(SO_REUSEPORT)
+	if (count > 1)
+		WLog_WARN(TAG, "SO_REUSEPORT not supported, using one accept thread per address");
+#endif
+
+	listener->accept_threads = (count > 1) ? count : 0;
+	return TRUE;
+}
+
+static rdpHandshakePool* freerdp_listener_get_handshake_pool(freerdp_listener* instance)
+{
+	WINPR_ASSERT(instance);
+
+	rdpListener* listener = (rdpListener*)instance->listener;
+	WINPR_ASSERT(listener);
+
+	if (listener->num_sockfds > 0)
+	{
+		WLog_ERR(TAG, "handshake options must be configured before opening the listener");
+		return NULL;
+	}
+
+	if (!listener->handshake)
+		listener->handshake = handshake_pool_new();
+	return listener->handshake;
+}
+
+BOOL freerdp_listener_set_handshake_limits(freerdp_listener* instance, UINT32 concurrent,
+                                           UINT32 queued)
+{
+	rdpHandshakePool* pool = freerdp_listener_get_handshake_pool(instance);
+	if (!pool)
+		return FALSE;
+	return handshake_pool_set_limits(pool, concurrent, queued);
+}
+
+BOOL freerdp_listener_set_tls_session_tickets(freerdp_listener* instance, BOOL enable)
+{
+	rdpHandshakePool* pool = freerdp_listener_get_handshake_pool(instance);
+	if (!pool)
+		return FALSE;
+	return handshake_pool_set_session_tickets(pool, enable);
+}
+
+BOOL freerdp_listener_set_tls_ecdsa_certificate(freerdp_listener* instance, const char* certfile,
+                                                const char* keyfile)
+{
+	rdpHandshakePool* pool = freerdp_listener_get_handshake_pool(instance);
+	if (!pool)
+		return FALSE;
+	return handshake_pool_set_ecdsa_certificate(pool, certfile, keyfile);
+}
+
 freerdp_listener* freerdp_listener_new(void)
 {
 	freerdp_listener* instance = NULL;
@@ -536,6 +759,14 @@ freerdp_listener* freerdp_listener_new(void)
 
 	listener->instance = instance;
 	instance->listener = (void*)listener;
+
+	listener->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	listener->errorEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!listener->stopEvent || !listener->errorEvent)
+	{
+		freerdp_listener_free(instance);
+		return NULL;
+	}
 	return instance;
 }
 
@@ -543,6 +774,18 @@ void freerdp_listener_free(freerdp_listener* instance)
 {
 	if (instance)
 	{
+		rdpListener* listener = (rdpListener*)instance->listener;
+		if (listener)
+		{
+			/* the accept threads use the listener */
+			if (listener->accept_threads > 0)
+				freerdp_listener_close(instance);
+			if (listener->stopEvent)
+				(void)CloseHandle(listener->stopEvent);
+			if (listener->errorEvent)
+				(void)CloseHandle(listener->errorEvent);
+			handshake_pool_unref(listener->handshake);
+		}
 		free(instance->listener);
 		free(instance);
 	}
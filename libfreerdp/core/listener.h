@@ -29,7 +29,16 @@ typedef struct rdp_listener rdpListener;
 
 #include <freerdp/listener.h>
 
-#define MAX_LISTENER_HANDLES 5
+#include "handshake.h"
+
+#define MAX_LISTENER_HANDLES 32
+
+typedef struct
+{
+	rdpListener* listener;
+	int index;
+	HANDLE thread;
+} rdpListenerThread;
 
 struct rdp_listener
 {
@@ -38,6 +47,15 @@ struct rdp_listener
 	int num_sockfds;
 	int sockfds[MAX_LISTENER_HANDLES];
 	HANDLE events[MAX_LISTENER_HANDLES];
+
+	/* with accept threads every socket is served by its own thread */
+	UINT32 accept_threads;
+	rdpListenerThread threads[MAX_LISTENER_HANDLES];
+	HANDLE stopEvent;
+	HANDLE errorEvent;
+
+	/* created with the first handshake option, every accepted peer holds a reference */
+	rdpHandshakePool* handshake;
 };
 
 #endif /* FREERDP_LIB_CORE_LISTENER_H */
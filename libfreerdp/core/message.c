@@ -2700,158 +2700,96 @@ static BOOL update_message_register_interface(rdpUpdateProxy* message, rdpUpdate
 	if (!primary || !secondary || !altsec || !window || !pointer)
 		return FALSE;
 
+	/* only callbacks the frontend implements are marshalled, orders without a handler are
+	 * dropped right away instead of being copied for the proxy thread */
+#define PROXY_CALLBACK(table, name)                   \
+	do                                                \
+	{                                                 \
+		message->name = (table)->name;                \
+		if (message->name)                            \
+			(table)->name = update_message_##name;    \
+	} while (0)
+
 	/* Update */
-	message->BeginPaint = update->BeginPaint;
-	message->EndPaint = update->EndPaint;
-	message->SetBounds = update->SetBounds;
-	message->Synchronize = update->Synchronize;
-	message->DesktopResize = update->DesktopResize;
-	message->BitmapUpdate = update->BitmapUpdate;
-	message->Palette = update->Palette;
-	message->PlaySound = update->PlaySound;
-	message->SetKeyboardIndicators = update->SetKeyboardIndicators;
-	message->SetKeyboardImeStatus = update->SetKeyboardImeStatus;
-	message->RefreshRect = update->RefreshRect;
-	message->SuppressOutput = update->SuppressOutput;
-	message->SurfaceCommand = update->SurfaceCommand;
-	message->SurfaceBits = update->SurfaceBits;
-	message->SurfaceFrameMarker = update->SurfaceFrameMarker;
-	message->SurfaceFrameAcknowledge = update->SurfaceFrameAcknowledge;
-	update->BeginPaint = update_message_BeginPaint;
-	update->EndPaint = update_message_EndPaint;
-	update->SetBounds = update_message_SetBounds;
-	update->Synchronize = update_message_Synchronize;
-	update->DesktopResize = update_message_DesktopResize;
-	update->BitmapUpdate = update_message_BitmapUpdate;
-	update->Palette = update_message_Palette;
-	update->PlaySound = update_message_PlaySound;
-	update->SetKeyboardIndicators = update_message_SetKeyboardIndicators;
-	update->SetKeyboardImeStatus = update_message_SetKeyboardImeStatus;
-	update->RefreshRect = update_message_RefreshRect;
-	update->SuppressOutput = update_message_SuppressOutput;
-	update->SurfaceCommand = update_message_SurfaceCommand;
-	update->SurfaceBits = update_message_SurfaceBits;
-	update->SurfaceFrameMarker = update_message_SurfaceFrameMarker;
-	update->SurfaceFrameAcknowledge = update_message_SurfaceFrameAcknowledge;
+	PROXY_CALLBACK(update, BeginPaint);
+	PROXY_CALLBACK(update, EndPaint);
+	PROXY_CALLBACK(update, SetBounds);
+	PROXY_CALLBACK(update, Synchronize);
+	PROXY_CALLBACK(update, DesktopResize);
+	PROXY_CALLBACK(update, BitmapUpdate);
+	PROXY_CALLBACK(update, Palette);
+	PROXY_CALLBACK(update, PlaySound);
+	PROXY_CALLBACK(update, SetKeyboardIndicators);
+	PROXY_CALLBACK(update, SetKeyboardImeStatus);
+	PROXY_CALLBACK(update, RefreshRect);
+	PROXY_CALLBACK(update, SuppressOutput);
+	PROXY_CALLBACK(update, SurfaceCommand);
+	PROXY_CALLBACK(update, SurfaceBits);
+	PROXY_CALLBACK(update, SurfaceFrameMarker);
+	PROXY_CALLBACK(update, SurfaceFrameAcknowledge);
 	/* Primary Update */
-	message->DstBlt = primary->DstBlt;
-	message->PatBlt = primary->PatBlt;
-	message->ScrBlt = primary->ScrBlt;
-	message->OpaqueRect = primary->OpaqueRect;
-	message->DrawNineGrid = primary->DrawNineGrid;
-	message->MultiDstBlt = primary->MultiDstBlt;
-	message->MultiPatBlt = primary->MultiPatBlt;
-	message->MultiScrBlt = primary->MultiScrBlt;
-	message->MultiOpaqueRect = primary->MultiOpaqueRect;
-	message->MultiDrawNineGrid = primary->MultiDrawNineGrid;
-	message->LineTo = primary->LineTo;
-	message->Polyline = primary->Polyline;
-	message->MemBlt = primary->MemBlt;
-	message->Mem3Blt = primary->Mem3Blt;
-	message->SaveBitmap = primary->SaveBitmap;
-	message->GlyphIndex = primary->GlyphIndex;
-	message->FastIndex = primary->FastIndex;
-	message->FastGlyph = primary->FastGlyph;
-	message->PolygonSC = primary->PolygonSC;
-	message->PolygonCB = primary->PolygonCB;
-	message->EllipseSC = primary->EllipseSC;
-	message->EllipseCB = primary->EllipseCB;
-	primary->DstBlt = update_message_DstBlt;
-	primary->PatBlt = update_message_PatBlt;
-	primary->ScrBlt = update_message_ScrBlt;
-	primary->OpaqueRect = update_message_OpaqueRect;
-	primary->DrawNineGrid = update_message_DrawNineGrid;
-	primary->MultiDstBlt = update_message_MultiDstBlt;
-	primary->MultiPatBlt = update_message_MultiPatBlt;
-	primary->MultiScrBlt = update_message_MultiScrBlt;
-	primary->MultiOpaqueRect = update_message_MultiOpaqueRect;
-	primary->MultiDrawNineGrid = update_message_MultiDrawNineGrid;
-	primary->LineTo = update_message_LineTo;
-	primary->Polyline = update_message_Polyline;
-	primary->MemBlt = update_message_MemBlt;
-	primary->Mem3Blt = update_message_Mem3Blt;
-	primary->SaveBitmap = update_message_SaveBitmap;
-	primary->GlyphIndex = update_message_GlyphIndex;
-	primary->FastIndex = update_message_FastIndex;
-	primary->FastGlyph = update_message_FastGlyph;
-	primary->PolygonSC = update_message_PolygonSC;
-	primary->PolygonCB = update_message_PolygonCB;
-	primary->EllipseSC = update_message_EllipseSC;
-	primary->EllipseCB = update_message_EllipseCB;
+	PROXY_CALLBACK(primary, DstBlt);
+	PROXY_CALLBACK(primary, PatBlt);
+	PROXY_CALLBACK(primary, ScrBlt);
+	PROXY_CALLBACK(primary, OpaqueRect);
+	PROXY_CALLBACK(primary, DrawNineGrid);
+	PROXY_CALLBACK(primary, MultiDstBlt);
+	PROXY_CALLBACK(primary, MultiPatBlt);
+	PROXY_CALLBACK(primary, MultiScrBlt);
+	PROXY_CALLBACK(primary, MultiOpaqueRect);
+	PROXY_CALLBACK(primary, MultiDrawNineGrid);
+	PROXY_CALLBACK(primary, LineTo);
+	PROXY_CALLBACK(primary, Polyline);
+	PROXY_CALLBACK(primary, MemBlt);
+	PROXY_CALLBACK(primary, Mem3Blt);
+	PROXY_CALLBACK(primary, SaveBitmap);
+	PROXY_CALLBACK(primary, GlyphIndex);
+	PROXY_CALLBACK(primary, FastIndex);
+	PROXY_CALLBACK(primary, FastGlyph);
+	PROXY_CALLBACK(primary, PolygonSC);
+	PROXY_CALLBACK(primary, PolygonCB);
+	PROXY_CALLBACK(primary, EllipseSC);
+	PROXY_CALLBACK(primary, EllipseCB);
 	/* Secondary Update */
-	message->CacheBitmap = secondary->CacheBitmap;
-	message->CacheBitmapV2 = secondary->CacheBitmapV2;
-	message->CacheBitmapV3 = secondary->CacheBitmapV3;
-	message->CacheColorTable = secondary->CacheColorTable;
-	message->CacheGlyph = secondary->CacheGlyph;
-	message->CacheGlyphV2 = secondary->CacheGlyphV2;
-	message->CacheBrush = secondary->CacheBrush;
-	secondary->CacheBitmap = update_message_CacheBitmap;
-	secondary->CacheBitmapV2 = update_message_CacheBitmapV2;
-	secondary->CacheBitmapV3 = update_message_CacheBitmapV3;
-	secondary->CacheColorTable = update_message_CacheColorTable;
-	secondary->CacheGlyph = update_message_CacheGlyph;
-	secondary->CacheGlyphV2 = update_message_CacheGlyphV2;
-	secondary->CacheBrush = update_message_CacheBrush;
+	PROXY_CALLBACK(secondary, CacheBitmap);
+	PROXY_CALLBACK(secondary, CacheBitmapV2);
+	PROXY_CALLBACK(secondary, CacheBitmapV3);
+	PROXY_CALLBACK(secondary, CacheColorTable);
+	PROXY_CALLBACK(secondary, CacheGlyph);
+	PROXY_CALLBACK(secondary, CacheGlyphV2);
+	PROXY_CALLBACK(secondary, CacheBrush);
 	/* Alternate Secondary Update */
-	message->CreateOffscreenBitmap = altsec->CreateOffscreenBitmap;
-	message->SwitchSurface = altsec->SwitchSurface;
-	message->CreateNineGridBitmap = altsec->CreateNineGridBitmap;
-	message->FrameMarker = altsec->FrameMarker;
-	message->StreamBitmapFirst = altsec->StreamBitmapFirst;
-	message->StreamBitmapNext = altsec->StreamBitmapNext;
-	message->DrawGdiPlusFirst = altsec->DrawGdiPlusFirst;
-	message->DrawGdiPlusNext = altsec->DrawGdiPlusNext;
-	message->DrawGdiPlusEnd = altsec->DrawGdiPlusEnd;
-	message->DrawGdiPlusCacheFirst = altsec->DrawGdiPlusCacheFirst;
-	message->DrawGdiPlusCacheNext = altsec->DrawGdiPlusCacheNext;
-	message->DrawGdiPlusCacheEnd = altsec->DrawGdiPlusCacheEnd;
-	altsec->CreateOffscreenBitmap = update_message_CreateOffscreenBitmap;
-	altsec->SwitchSurface = update_message_SwitchSurface;
-	altsec->CreateNineGridBitmap = update_message_CreateNineGridBitmap;
-	altsec->FrameMarker = update_message_FrameMarker;
-	altsec->StreamBitmapFirst = update_message_StreamBitmapFirst;
-	altsec->StreamBitmapNext = update_message_StreamBitmapNext;
-	altsec->DrawGdiPlusFirst = update_message_DrawGdiPlusFirst;
-	altsec->DrawGdiPlusNext = update_message_DrawGdiPlusNext;
-	altsec->DrawGdiPlusEnd = update_message_DrawGdiPlusEnd;
-	altsec->DrawGdiPlusCacheFirst = update_message_DrawGdiPlusCacheFirst;
-	altsec->DrawGdiPlusCacheNext = update_message_DrawGdiPlusCacheNext;
-	altsec->DrawGdiPlusCacheEnd = update_message_DrawGdiPlusCacheEnd;
+	PROXY_CALLBACK(altsec, CreateOffscreenBitmap);
+	PROXY_CALLBACK(altsec, SwitchSurface);
+	PROXY_CALLBACK(altsec, CreateNineGridBitmap);
+	PROXY_CALLBACK(altsec, FrameMarker);
+	PROXY_CALLBACK(altsec, StreamBitmapFirst);
+	PROXY_CALLBACK(altsec, StreamBitmapNext);
+	PROXY_CALLBACK(altsec, DrawGdiPlusFirst);
+	PROXY_CALLBACK(altsec, DrawGdiPlusNext);
+	PROXY_CALLBACK(altsec, DrawGdiPlusEnd);
+	PROXY_CALLBACK(altsec, DrawGdiPlusCacheFirst);
+	PROXY_CALLBACK(altsec, DrawGdiPlusCacheNext);
+	PROXY_CALLBACK(altsec, DrawGdiPlusCacheEnd);
 	/* Window Update */
-	message->WindowCreate = window->WindowCreate;
-	message->WindowUpdate = window->WindowUpdate;
-	message->WindowIcon = window->WindowIcon;
-	message->WindowCachedIcon = window->WindowCachedIcon;
-	message->WindowDelete = window->WindowDelete;
-	message->NotifyIconCreate = window->NotifyIconCreate;
-	message->NotifyIconUpdate = window->NotifyIconUpdate;
-	message->NotifyIconDelete = window->NotifyIconDelete;
-	message->MonitoredDesktop = window->MonitoredDesktop;
-	message->NonMonitoredDesktop = window->NonMonitoredDesktop;
-	window->WindowCreate = update_message_WindowCreate;
-	window->WindowUpdate = update_message_WindowUpdate;
-	window->WindowIcon = update_message_WindowIcon;
-	window->WindowCachedIcon = update_message_WindowCachedIcon;
-	window->WindowDelete = update_message_WindowDelete;
-	window->NotifyIconCreate = update_message_NotifyIconCreate;
-	window->NotifyIconUpdate = update_message_NotifyIconUpdate;
-	window->NotifyIconDelete = update_message_NotifyIconDelete;
-	window->MonitoredDesktop = update_message_MonitoredDesktop;
-	window->NonMonitoredDesktop = update_message_NonMonitoredDesktop;
+	PROXY_CALLBACK(window, WindowCreate);
+	PROXY_CALLBACK(window, WindowUpdate);
+	PROXY_CALLBACK(window, WindowIcon);
+	PROXY_CALLBACK(window, WindowCachedIcon);
+	PROXY_CALLBACK(window, WindowDelete);
+	PROXY_CALLBACK(window, NotifyIconCreate);
+	PROXY_CALLBACK(window, NotifyIconUpdate);
+	PROXY_CALLBACK(window, NotifyIconDelete);
+	PROXY_CALLBACK(window, MonitoredDesktop);
+	PROXY_CALLBACK(window, NonMonitoredDesktop);
 	/* Pointer Update */
-	message->PointerPosition = pointer->PointerPosition;
-	message->PointerSystem = pointer->PointerSystem;
-	message->PointerColor = pointer->PointerColor;
-	message->PointerLarge = pointer->PointerLarge;
-	message->PointerNew = pointer->PointerNew;
-	message->PointerCached = pointer->PointerCached;
-	pointer->PointerPosition = update_message_PointerPosition;
-	pointer->PointerSystem = update_message_PointerSystem;
-	pointer->PointerColor = update_message_PointerColor;
-	pointer->PointerLarge = update_message_PointerLarge;
-	pointer->PointerNew = update_message_PointerNew;
-	pointer->PointerCached = update_message_PointerCached;
+	PROXY_CALLBACK(pointer, PointerPosition);
+	PROXY_CALLBACK(pointer, PointerSystem);
+	PROXY_CALLBACK(pointer, PointerColor);
+	PROXY_CALLBACK(pointer, PointerLarge);
+	PROXY_CALLBACK(pointer, PointerNew);
+	PROXY_CALLBACK(pointer, PointerCached);
+#undef PROXY_CALLBACK
 	return TRUE;
 }
 
@@ -19,8 +19,39 @@
 
 #include <freerdp/config.h>
 
+#include <winpr/synch.h>
+
 #include "rdp.h"
 
+typedef struct
+{
+	rdpMetrics common;
+
+	CRITICAL_SECTION lock;
+	rdpMetricsStats stats;
+} rdpMetricsPrivate;
+
+static rdpMetricsPrivate* metrics_private(rdpMetrics* metrics)
+{
+	/* metrics_new always allocates the private layout */
+	return (rdpMetricsPrivate*)metrics;
+}
+
+static void metrics_histogram_add(rdpMetricsHistogram* histogram, UINT64 durationNs)
+{
+	const UINT64 us = durationNs / 1000ull;
+	size_t bucket = 0;
+
+	while ((bucket < FREERDP_METRICS_HISTOGRAM_BUCKETS - 1) && (us >= (16ull << bucket)))
+		bucket++;
+
+	histogram->Count++;
+	histogram->TotalUs += us;
+	if (us > histogram->MaxUs)
+		histogram->MaxUs = us;
+	histogram->Buckets[bucket]++;
+}
+
 double metrics_write_bytes(rdpMetrics* metrics, UINT32 UncompressedBytes, UINT32 CompressedBytes)
 {
 	double CompressionRatio = 0.0;
@@ -37,21 +68,165 @@ double metrics_write_bytes(rdpMetrics* metrics, UINT32 UncompressedBytes, UINT32
 	return CompressionRatio;
 }
 
+void metrics_write_bulk_bytes(rdpMetrics* metrics, UINT32 type, BOOL compress,
+                              UINT32 UncompressedBytes, UINT32 CompressedBytes)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv || (type >= FREERDP_METRICS_BULK_TYPES))
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	rdpMetricsBulk* bulk =
+	    compress ? &priv->stats.BulkCompress[type] : &priv->stats.BulkDecompress[type];
+	bulk->CompressedBytes += CompressedBytes;
+	bulk->UncompressedBytes += UncompressedBytes;
+	LeaveCriticalSection(&priv->lock);
+}
+
+void metrics_channel_bytes(rdpMetrics* metrics, UINT16 channelId, const char* name,
+                           size_t inBytes, size_t outBytes)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv)
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	rdpMetricsStats* stats = &priv->stats;
+	rdpMetricsChannel* channel = NULL;
+	for (UINT32 x = 0; x < stats->ChannelCount; x++)
+	{
+		if (stats->Channels[x].ChannelId == channelId)
+		{
+			channel = &stats->Channels[x];
+			break;
+		}
+	}
+
+	if (!channel && (stats->ChannelCount < FREERDP_METRICS_MAX_CHANNELS))
+	{
+		channel = &stats->Channels[stats->ChannelCount++];
+		channel->ChannelId = channelId;
+	}
+
+	if (channel)
+	{
+		if (name && (channel->Name[0] == '\0'))
+			(void)strncpy(channel->Name, name, sizeof(channel->Name) - 1);
+		if (inBytes > 0)
+		{
+			channel->In.Count++;
+			channel->In.Bytes += inBytes;
+		}
+		if (outBytes > 0)
+		{
+			channel->Out.Count++;
+			channel->Out.Bytes += outBytes;
+		}
+	}
+	LeaveCriticalSection(&priv->lock);
+}
+
+void metrics_fastpath_update(rdpMetrics* metrics, BYTE updateCode, size_t bytes)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv || (updateCode >= FREERDP_METRICS_PDU_TYPES))
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	priv->stats.FastpathUpdates[updateCode].Count++;
+	priv->stats.FastpathUpdates[updateCode].Bytes += bytes;
+	LeaveCriticalSection(&priv->lock);
+}
+
+void metrics_codec_decode(rdpMetrics* metrics, UINT16 codecId, UINT64 durationNs)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv || (codecId >= FREERDP_METRICS_CODECS))
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	metrics_histogram_add(&priv->stats.Decode[codecId], durationNs);
+	LeaveCriticalSection(&priv->lock);
+}
+
+void metrics_codec_encode(rdpMetrics* metrics, UINT16 codecId, UINT64 durationNs)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv || (codecId >= FREERDP_METRICS_CODECS))
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	metrics_histogram_add(&priv->stats.Encode[codecId], durationNs);
+	LeaveCriticalSection(&priv->lock);
+}
+
+void metrics_frame_ack(rdpMetrics* metrics, UINT64 rttNs)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv)
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	metrics_histogram_add(&priv->stats.FrameAck, rttNs);
+	LeaveCriticalSection(&priv->lock);
+}
+
+BOOL metrics_get_stats(rdpMetrics* metrics, rdpMetricsStats* stats)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv || !stats)
+		return FALSE;
+
+	EnterCriticalSection(&priv->lock);
+	*stats = priv->stats;
+	LeaveCriticalSection(&priv->lock);
+	return TRUE;
+}
+
+void metrics_reset_stats(rdpMetrics* metrics)
+{
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv)
+		return;
+
+	EnterCriticalSection(&priv->lock);
+	const rdpMetricsStats empty = { 0 };
+	priv->stats = empty;
+	LeaveCriticalSection(&priv->lock);
+}
+
 rdpMetrics* metrics_new(rdpContext* context)
 {
-	rdpMetrics* metrics = NULL;
+	rdpMetricsPrivate* priv = (rdpMetricsPrivate*)calloc(1, sizeof(rdpMetricsPrivate));
 
-	metrics = (rdpMetrics*)calloc(1, sizeof(rdpMetrics));
+	if (!priv)
+		return NULL;
 
-	if (metrics)
+	if (!InitializeCriticalSectionAndSpinCount(&priv->lock, 4000))
 	{
-		metrics->context = context;
+		free(priv);
+		return NULL;
 	}
 
-	return metrics;
+	priv->common.context = context;
+	return &priv->common;
 }
 
 void metrics_free(rdpMetrics* metrics)
 {
-	free(metrics);
+	rdpMetricsPrivate* priv = metrics_private(metrics);
+
+	if (!priv)
+		return;
+
+	DeleteCriticalSection(&priv->lock);
+	free(priv);
 }
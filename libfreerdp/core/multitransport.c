@@ -19,11 +19,64 @@
 
 #include <winpr/assert.h>
 #include <freerdp/config.h>
+
+#include <winpr/crypto.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/winsock.h>
+
 #include <freerdp/log.h>
+#include <freerdp/channels/channels.h>
+#include <freerdp/channels/drdynvc.h>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+#include <openssl/ssl.h>
 
 #include "settings.h"
 #include "rdp.h"
+#include "rdpudp.h"
 #include "multitransport.h"
+#include "../crypto/tls.h"
+
+#define TAG FREERDP_TAG("core.multitransport")
+
+/* the connection sequence waits for the tunnel, keep a filtered UDP port from stalling it */
+#define MULTITRANSPORT_CONNECT_TIMEOUT_MS 3000
+#define MULTITRANSPORT_TUNNEL_HEADER_LEN 4
+#define MULTITRANSPORT_TUNNEL_MAX_PAYLOAD 0xFFFF
+
+enum
+{
+	RDPTUNNEL_ACTION_CREATEREQUEST = 0x00,
+	RDPTUNNEL_ACTION_CREATERESPONSE = 0x01,
+	RDPTUNNEL_ACTION_DATA = 0x02
+};
+
+enum
+{
+	MULTITRANSPORT_TUNNEL_RELIABLE,
+	MULTITRANSPORT_TUNNEL_LOSSY,
+	MULTITRANSPORT_TUNNEL_COUNT
+};
+
+typedef struct
+{
+	rdpMultitransport* multi;
+	UINT32 tunnelType;
+	RDPUDP_MODE mode;
+	rdpUdp* udp;
+	rdpTls* tls;
+	HANDLE thread;
+	HANDLE stopEvent;
+	wQueue* sendQueue;
+	wStream* pending;
+	wStream* received;
+	volatile LONG failed;
+} rdpMultitransportTunnel;
 
 struct rdp_multitransport
 {
@@ -37,17 +90,13 @@ struct rdp_multitransport
 
 	BYTE reliableCookie[RDPUDP_COOKIE_LEN];
 	BYTE reliableCookieHash[RDPUDP_COOKIE_HASHLEN];
-};
 
-enum
-{
-	RDPTUNNEL_ACTION_CREATEREQUEST = 0x00,
-	RDPTUNNEL_ACTION_CREATERESPONSE = 0x01,
-	RDPTUNNEL_ACTION_DATA = 0x02
+	/* client-side data, the tunnels and the dynamic channel data they received */
+	rdpMultitransportTunnel* tunnels[MULTITRANSPORT_TUNNEL_COUNT];
+	wQueue* receiveQueue;
+	volatile LONG tunnelUsed;
 };
 
-#define TAG FREERDP_TAG("core.multitransport")
-
 state_run_t multitransport_recv_request(rdpMultitransport* multi, wStream* s)
 {
 	WINPR_ASSERT(multi);
@@ -188,6 +237,640 @@ static state_run_t multitransport_no_udp(rdpMultitransport* multi, UINT32 reqId,
 	                                                                  : STATE_RUN_FAILED;
 }
 
+static void multitransport_stream_free(void* obj)
+{
+	Stream_Free((wStream*)obj, TRUE);
+}
+
+static size_t multitransport_tunnel_index(UINT32 tunnelType)
+{
+	return (tunnelType == TUNNELTYPE_UDPFECL) ? MULTITRANSPORT_TUNNEL_LOSSY
+	                                          : MULTITRANSPORT_TUNNEL_RELIABLE;
+}
+
+static BOOL multitransport_tunnel_pump(rdpMultitransportTunnel* tunnel, DWORD timeout)
+{
+	WINPR_ASSERT(tunnel);
+
+	DWORD wait = MIN(timeout, rdpudp_get_timeout(tunnel->udp));
+	if (tunnel->tls && tunnel->tls->ssl && (tunnel->mode == RDPUDP_MODE_LOSSY))
+	{
+		struct timeval tv = { 0 };
+		if (DTLSv1_get_timeout(tunnel->tls->ssl, &tv))
+			wait = MIN(wait, (DWORD)(tv.tv_sec * 1000 + tv.tv_usec / 1000));
+	}
+
+	if (WaitForSingleObject(rdpudp_get_event(tunnel->udp), wait) == WAIT_FAILED)
+		return FALSE;
+	if (!rdpudp_check(tunnel->udp))
+		return FALSE;
+
+	/* DTLS repeats its lost handshake flights by itself, but only when asked to */
+	if (tunnel->tls && tunnel->tls->ssl && (tunnel->mode == RDPUDP_MODE_LOSSY))
+		(void)DTLSv1_handle_timeout(tunnel->tls->ssl);
+	return TRUE;
+}
+
+static BOOL multitransport_tunnel_write_pdu(rdpMultitransportTunnel* tunnel, wStream* s)
+{
+	WINPR_ASSERT(tunnel);
+
+	const BYTE* data = Stream_Buffer(s);
+	const size_t length = Stream_GetPosition(s);
+	const UINT64 start = GetTickCount64();
+	size_t offset = 0;
+
+	while (offset < length)
+	{
+		ERR_clear_error();
+		const int rc = BIO_write(tunnel->tls->bio, &data[offset], (int)(length - offset));
+		if (rc > 0)
+		{
+			offset += (size_t)rc;
+			continue;
+		}
+
+		if (!BIO_should_retry(tunnel->tls->bio))
+			return FALSE;
+		if (GetTickCount64() - start > MULTITRANSPORT_CONNECT_TIMEOUT_MS)
+			return FALSE;
+		if (!multitransport_tunnel_pump(tunnel, 50))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Reads what the tunnel received, returns 1 and the payload for a complete tunnel PDU */
+static int multitransport_tunnel_read_pdu(rdpMultitransportTunnel* tunnel, BYTE* action,
+                                          wStream* payload)
+{
+	WINPR_ASSERT(tunnel);
+	WINPR_ASSERT(action);
+	WINPR_ASSERT(payload);
+
+	wStream* s = tunnel->received;
+	for (;;)
+	{
+		const size_t have = Stream_GetPosition(s);
+		if (have >= MULTITRANSPORT_TUNNEL_HEADER_LEN)
+		{
+			const BYTE* header = Stream_Buffer(s);
+			const size_t payloadLength = (size_t)header[1] | ((size_t)header[2] << 8);
+			const size_t headerLength = header[3];
+			if (headerLength < MULTITRANSPORT_TUNNEL_HEADER_LEN)
+			{
+				WLog_ERR(TAG, "invalid tunnel header length %" PRIuz, headerLength);
+				return -1;
+			}
+
+			/* the sub headers carry nothing we use */
+			const size_t total = headerLength + payloadLength;
+			if (have >= total)
+			{
+				*action = header[0] & 0x0F;
+				Stream_StaticConstInit(payload, &header[headerLength], payloadLength);
+				return 1;
+			}
+		}
+
+		if (!Stream_EnsureRemainingCapacity(s, 4096))
+			return -1;
+
+		ERR_clear_error();
+		const int rc = BIO_read(tunnel->tls->bio, Stream_Pointer(s),
+		                        (int)MIN(Stream_GetRemainingCapacity(s), INT32_MAX));
+		if (rc > 0)
+		{
+			Stream_Seek(s, (size_t)rc);
+			continue;
+		}
+
+		if (!BIO_should_retry(tunnel->tls->bio))
+			return -1;
+		return 0;
+	}
+}
+
+/* Drops the tunnel PDU multitransport_tunnel_read_pdu returned */
+static void multitransport_tunnel_consume_pdu(rdpMultitransportTunnel* tunnel, wStream* payload)
+{
+	WINPR_ASSERT(tunnel);
+
+	wStream* s = tunnel->received;
+	const BYTE* end = Stream_Buffer(payload) + Stream_Length(payload);
+	const size_t used = (size_t)(end - Stream_Buffer(s));
+	const size_t left = Stream_GetPosition(s) - used;
+
+	memmove(Stream_Buffer(s), end, left);
+	Stream_SetPosition(s, left);
+}
+
+static wStream* multitransport_tunnel_pdu_new(BYTE action, size_t length)
+{
+	if (length > MULTITRANSPORT_TUNNEL_MAX_PAYLOAD)
+		return NULL;
+
+	wStream* s = Stream_New(NULL, MULTITRANSPORT_TUNNEL_HEADER_LEN + length);
+	if (!s)
+		return NULL;
+
+	Stream_Write_UINT8(s, action);                           /* Action (4 bits), Flags (4 bits) */
+	Stream_Write_UINT16(s, (UINT16)length);                  /* PayloadLength (2 bytes) */
+	Stream_Write_UINT8(s, MULTITRANSPORT_TUNNEL_HEADER_LEN); /* HeaderLength (1 byte) */
+	return s;
+}
+
+static BOOL multitransport_tunnel_create(rdpMultitransportTunnel* tunnel, UINT32 reqId,
+                                         const BYTE* cookie)
+{
+	WINPR_ASSERT(tunnel);
+
+	wStream* s = multitransport_tunnel_pdu_new(RDPTUNNEL_ACTION_CREATEREQUEST, 24);
+	if (!s)
+		return FALSE;
+
+	Stream_Write_UINT32(s, reqId);              /* RequestID (4 bytes) */
+	Stream_Zero(s, 4);                          /* Reserved (4 bytes) */
+	Stream_Write(s, cookie, RDPUDP_COOKIE_LEN); /* SecurityCookie (16 bytes) */
+	const BOOL rc = multitransport_tunnel_write_pdu(tunnel, s);
+	Stream_Free(s, TRUE);
+	if (!rc)
+		return FALSE;
+
+	const UINT64 start = GetTickCount64();
+	while (GetTickCount64() - start < MULTITRANSPORT_CONNECT_TIMEOUT_MS)
+	{
+		BYTE action = 0;
+		wStream sbuffer = { 0 };
+		const int status = multitransport_tunnel_read_pdu(tunnel, &action, &sbuffer);
+		if (status < 0)
+			return FALSE;
+		if (status == 0)
+		{
+			if (!multitransport_tunnel_pump(tunnel, 50))
+				return FALSE;
+			continue;
+		}
+
+		if (action != RDPTUNNEL_ACTION_CREATERESPONSE)
+		{
+			multitransport_tunnel_consume_pdu(tunnel, &sbuffer);
+			continue;
+		}
+
+		if (!Stream_CheckAndLogRequiredLength(TAG, &sbuffer, 4))
+			return FALSE;
+
+		const UINT32 hr = Stream_Get_UINT32(&sbuffer); /* HrResponse (4 bytes) */
+		multitransport_tunnel_consume_pdu(tunnel, &sbuffer);
+		if (hr != S_OK)
+		{
+			WLog_ERR(TAG, "server refused the tunnel with 0x%08" PRIx32, hr);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	WLog_ERR(TAG, "no tunnel create response within %" PRIu32 " ms",
+	         MULTITRANSPORT_CONNECT_TIMEOUT_MS);
+	return FALSE;
+}
+
+static BOOL multitransport_tunnel_handshake(rdpMultitransportTunnel* tunnel)
+{
+	WINPR_ASSERT(tunnel);
+
+	rdpRdp* rdp = tunnel->multi->rdp;
+	rdpSettings* settings = rdp->settings;
+
+	tunnel->tls = freerdp_tls_new(rdp->context);
+	if (!tunnel->tls)
+		return FALSE;
+
+	BIO* bio = BIO_new(BIO_s_rdpudp());
+	if (!bio)
+		return FALSE;
+	BIO_set_data(bio, tunnel->udp);
+
+	const UINT32 port = freerdp_settings_get_uint32(settings, FreeRDP_ServerPort);
+	tunnel->tls->hostname = freerdp_settings_get_string(settings, FreeRDP_ServerHostname);
+	tunnel->tls->port = (int)MIN(port, INT32_MAX);
+
+	/* the reliable tunnel secures the stream with TLS, the lossy one every datagram with DTLS */
+	const SSL_METHOD* method =
+	    freerdp_tls_get_ssl_method(tunnel->mode == RDPUDP_MODE_LOSSY, TRUE);
+	TlsHandshakeResult result = freerdp_tls_connect_ex(tunnel->tls, bio, method);
+	if (!tunnel->tls->bio || (BIO_next(tunnel->tls->bio) != bio))
+		BIO_free_all(bio);
+
+	const UINT64 start = GetTickCount64();
+	while (result == TLS_HANDSHAKE_CONTINUE)
+	{
+		if (GetTickCount64() - start > MULTITRANSPORT_CONNECT_TIMEOUT_MS)
+		{
+			WLog_ERR(TAG, "tunnel handshake not completed within %" PRIu32 " ms",
+			         MULTITRANSPORT_CONNECT_TIMEOUT_MS);
+			return FALSE;
+		}
+
+		if (!multitransport_tunnel_pump(tunnel, 50))
+			return FALSE;
+		result = freerdp_tls_handshake(tunnel->tls);
+	}
+
+	if (result != TLS_HANDSHAKE_SUCCESS)
+		return FALSE;
+
+	/* the tunnel must end at the server the main connection was verified against */
+	const rdpTls* main = transport_get_tls(rdp->transport);
+	if (!main || !main->PublicKey || (main->PublicKeyLength != tunnel->tls->PublicKeyLength) ||
+	    (memcmp(main->PublicKey, tunnel->tls->PublicKey, main->PublicKeyLength) != 0))
+	{
+		WLog_ERR(TAG, "the tunnel certificate does not match the one of the main connection");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static int multitransport_tunnel_socket(const rdpSettings* settings)
+{
+	char port[16] = { 0 };
+	struct addrinfo hints = { 0 };
+	struct addrinfo* result = NULL;
+
+	/* the server listens for UDP on the port of the TCP connection */
+	const char* hostname = freerdp_settings_get_string(settings, FreeRDP_ServerHostname);
+	(void)_snprintf(port, sizeof(port), "%" PRIu32,
+	                freerdp_settings_get_uint32(settings, FreeRDP_ServerPort));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_protocol = IPPROTO_UDP;
+
+	const int status = getaddrinfo(hostname, port, &hints, &result);
+	if (status != 0)
+	{
+		WLog_ERR(TAG, "unable to resolve %s: %s", hostname, gai_strerror(status));
+		return -1;
+	}
+
+	int sockfd = -1;
+	for (const struct addrinfo* addr = result; addr && (sockfd < 0); addr = addr->ai_next)
+	{
+		sockfd = (int)socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+		if (sockfd < 0)
+			continue;
+
+		if (connect(sockfd, addr->ai_addr, (int)addr->ai_addrlen) != 0)
+		{
+			closesocket((SOCKET)sockfd);
+			sockfd = -1;
+		}
+	}
+
+	freeaddrinfo(result);
+	return sockfd;
+}
+
+static void multitransport_tunnel_free(rdpMultitransportTunnel* tunnel)
+{
+	if (!tunnel)
+		return;
+
+	if (tunnel->thread)
+	{
+		(void)SetEvent(tunnel->stopEvent);
+		(void)WaitForSingleObject(tunnel->thread, INFINITE);
+		(void)CloseHandle(tunnel->thread);
+	}
+
+	/* the TLS BIO chain only refers to the connection */
+	freerdp_tls_free(tunnel->tls);
+	rdpudp_free(tunnel->udp);
+	if (tunnel->stopEvent)
+		(void)CloseHandle(tunnel->stopEvent);
+	Queue_Free(tunnel->sendQueue);
+	Stream_Free(tunnel->pending, TRUE);
+	Stream_Free(tunnel->received, TRUE);
+	free(tunnel);
+}
+
+static rdpMultitransportTunnel* multitransport_tunnel_connect(rdpMultitransport* multi,
+                                                              UINT32 reqId, UINT16 reqProto,
+                                                              const BYTE* cookie)
+{
+	WINPR_ASSERT(multi);
+
+	int sockfd = -1;
+	BYTE cookieHash[RDPUDP_COOKIE_HASHLEN] = { 0 };
+	const rdpSettings* settings = multi->rdp->settings;
+	rdpMultitransportTunnel* tunnel = calloc(1, sizeof(rdpMultitransportTunnel));
+	if (!tunnel)
+		return NULL;
+
+	tunnel->multi = multi;
+	if (reqProto == INITIATE_REQUEST_PROTOCOL_UDPFECL)
+	{
+		tunnel->tunnelType = TUNNELTYPE_UDPFECL;
+		tunnel->mode = RDPUDP_MODE_LOSSY;
+	}
+	else
+	{
+		tunnel->tunnelType = TUNNELTYPE_UDPFECR;
+		tunnel->mode = RDPUDP_MODE_RELIABLE;
+	}
+
+	tunnel->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	tunnel->sendQueue = Queue_New(TRUE, -1, -1);
+	tunnel->received = Stream_New(NULL, 4096);
+	if (!tunnel->stopEvent || !tunnel->sendQueue || !tunnel->received)
+		goto fail;
+	Queue_Object(tunnel->sendQueue)->fnObjectFree = multitransport_stream_free;
+
+	/* protocol version 3 proves the cookie with its hash in the SYN */
+	if (!winpr_Digest(WINPR_MD_SHA256, cookie, RDPUDP_COOKIE_LEN, cookieHash, sizeof(cookieHash)))
+		goto fail;
+
+	sockfd = multitransport_tunnel_socket(settings);
+	if (sockfd < 0)
+		goto fail;
+
+	tunnel->udp = rdpudp_new(sockfd, FALSE, tunnel->mode, NULL, cookieHash);
+	if (!tunnel->udp)
+	{
+		closesocket((SOCKET)sockfd);
+		goto fail;
+	}
+
+	if (!rdpudp_connect(tunnel->udp, MULTITRANSPORT_CONNECT_TIMEOUT_MS))
+		goto fail;
+	if (!multitransport_tunnel_handshake(tunnel))
+		goto fail;
+	if (!multitransport_tunnel_create(tunnel, reqId, cookie))
+		goto fail;
+
+	WLog_INFO(TAG, "%s UDP tunnel to %s:%" PRIu32 " established, rtt %" PRIu32 " ms",
+	          (tunnel->mode == RDPUDP_MODE_LOSSY) ? "lossy" : "reliable",
+	          freerdp_settings_get_string(settings, FreeRDP_ServerHostname),
+	          freerdp_settings_get_uint32(settings, FreeRDP_ServerPort),
+	          rdpudp_get_rtt(tunnel->udp));
+	return tunnel;
+fail:
+	multitransport_tunnel_free(tunnel);
+	return NULL;
+}
+
+static BOOL multitransport_tunnel_receive(rdpMultitransportTunnel* tunnel)
+{
+	WINPR_ASSERT(tunnel);
+
+	for (;;)
+	{
+		BYTE action = 0;
+		wStream sbuffer = { 0 };
+		const int status = multitransport_tunnel_read_pdu(tunnel, &action, &sbuffer);
+		if (status <= 0)
+			return status == 0;
+
+		/* the main thread hands the dynamic channel PDUs to drdynvc */
+		if ((action == RDPTUNNEL_ACTION_DATA) && (Stream_Length(&sbuffer) > 0))
+		{
+			wStream* s = Stream_New(NULL, Stream_Length(&sbuffer));
+			if (!s)
+				return FALSE;
+			Stream_Write(s, Stream_Buffer(&sbuffer), Stream_Length(&sbuffer));
+			Stream_SealLength(s);
+			if (!Queue_Enqueue(tunnel->multi->receiveQueue, s))
+			{
+				Stream_Free(s, TRUE);
+				return FALSE;
+			}
+		}
+
+		multitransport_tunnel_consume_pdu(tunnel, &sbuffer);
+	}
+}
+
+static BOOL multitransport_tunnel_send(rdpMultitransportTunnel* tunnel)
+{
+	WINPR_ASSERT(tunnel);
+
+	for (;;)
+	{
+		if (!tunnel->pending)
+		{
+			tunnel->pending = Queue_Dequeue(tunnel->sendQueue);
+			if (!tunnel->pending)
+				return TRUE;
+		}
+
+		wStream* s = tunnel->pending;
+		ERR_clear_error();
+		const int rc = BIO_write(tunnel->tls->bio, Stream_Pointer(s),
+		                         (int)Stream_GetRemainingLength(s));
+		if (rc <= 0)
+			return BIO_should_retry(tunnel->tls->bio);
+
+		Stream_Seek(s, (size_t)rc);
+		if (Stream_GetRemainingLength(s) == 0)
+		{
+			Stream_Free(s, TRUE);
+			tunnel->pending = NULL;
+		}
+	}
+}
+
+static DWORD WINAPI multitransport_tunnel_thread(LPVOID arg)
+{
+	rdpMultitransportTunnel* tunnel = arg;
+	WINPR_ASSERT(tunnel);
+
+	for (;;)
+	{
+		HANDLE events[3] = { tunnel->stopEvent, rdpudp_get_event(tunnel->udp),
+			                 Queue_Event(tunnel->sendQueue) };
+
+		/* a full send window waits for acknowledgements, not for more data to send */
+		const DWORD count = tunnel->pending ? 2 : 3;
+		const DWORD status =
+		    WaitForMultipleObjects(count, events, FALSE, rdpudp_get_timeout(tunnel->udp));
+		if (status == WAIT_FAILED)
+			break;
+		if (WaitForSingleObject(tunnel->stopEvent, 0) == WAIT_OBJECT_0)
+			return 0;
+
+		if (!rdpudp_check(tunnel->udp) || !multitransport_tunnel_receive(tunnel) ||
+		    !multitransport_tunnel_send(tunnel))
+			break;
+	}
+
+	WLog_ERR(TAG, "%s UDP tunnel lost", (tunnel->mode == RDPUDP_MODE_LOSSY) ? "lossy" : "reliable");
+	(void)InterlockedExchange(&tunnel->failed, 1);
+	return 1;
+}
+
+/* The tunnels need a UDP path to the server, a gateway only relays the TCP connection */
+static BOOL multitransport_direct_udp(rdpMultitransport* multi)
+{
+	WINPR_ASSERT(multi);
+
+	rdpRdp* rdp = multi->rdp;
+	if (!freerdp_settings_get_bool(rdp->settings, FreeRDP_GatewayEnabled))
+		return TRUE;
+
+	UINT16 port = 0;
+	rdpRdg* rdg = transport_get_rdg(rdp->transport);
+	if (rdg_get_udp_side_channel(rdg, &port, NULL, NULL))
+		WLog_INFO(TAG,
+		          "gateway UDP side channel on port %" PRIu16 " not supported, staying on TCP",
+		          port);
+	return FALSE;
+}
+
+static state_run_t multitransport_client_request(rdpMultitransport* multi, UINT32 reqId,
+                                                 UINT16 reqProto, const BYTE* cookie)
+{
+	WINPR_ASSERT(multi);
+
+	rdpSettings* settings = multi->rdp->settings;
+	WINPR_ASSERT(settings);
+
+	if (!freerdp_settings_get_bool(settings, FreeRDP_MultitransportUdp))
+		return multitransport_no_udp(multi, reqId, reqProto, cookie);
+
+	if (!multi->receiveQueue)
+	{
+		multi->receiveQueue = Queue_New(TRUE, -1, -1);
+		if (!multi->receiveQueue)
+			return STATE_RUN_FAILED;
+		Queue_Object(multi->receiveQueue)->fnObjectFree = multitransport_stream_free;
+	}
+
+	const size_t index = multitransport_tunnel_index(
+	    (reqProto == INITIATE_REQUEST_PROTOCOL_UDPFECL) ? TUNNELTYPE_UDPFECL : TUNNELTYPE_UDPFECR);
+	rdpMultitransportTunnel* tunnel = NULL;
+
+	if (((reqProto == INITIATE_REQUEST_PROTOCOL_UDPFECR) ||
+	     (reqProto == INITIATE_REQUEST_PROTOCOL_UDPFECL)) &&
+	    !multi->tunnels[index] && multitransport_direct_udp(multi))
+		tunnel = multitransport_tunnel_connect(multi, reqId, reqProto, cookie);
+
+	if (!tunnel)
+	{
+		WLog_WARN(TAG, "UDP tunnel for protocol 0x%04" PRIx16 " not available, staying on TCP",
+		          reqProto);
+		return multitransport_client_send_response(multi, reqId, E_ABORT) ? STATE_RUN_SUCCESS
+		                                                                  : STATE_RUN_FAILED;
+	}
+
+	/* without soft-sync the server takes the created tunnel as the answer */
+	const UINT32 flags = freerdp_settings_get_uint32(settings, FreeRDP_MultitransportFlags);
+	if ((flags & SOFTSYNC_TCP_TO_UDP) && !multitransport_client_send_response(multi, reqId, S_OK))
+	{
+		multitransport_tunnel_free(tunnel);
+		return STATE_RUN_FAILED;
+	}
+
+	tunnel->thread = CreateThread(NULL, 0, multitransport_tunnel_thread, tunnel, 0, NULL);
+	if (!tunnel->thread)
+	{
+		multitransport_tunnel_free(tunnel);
+		return STATE_RUN_FAILED;
+	}
+
+	multi->tunnels[index] = tunnel;
+	return STATE_RUN_SUCCESS;
+}
+
+HANDLE multitransport_get_event_handle(rdpMultitransport* multi)
+{
+	if (!multi || !multi->receiveQueue)
+		return NULL;
+	return Queue_Event(multi->receiveQueue);
+}
+
+BOOL multitransport_check(rdpMultitransport* multi)
+{
+	if (!multi || !multi->receiveQueue)
+		return TRUE;
+
+	rdpContext* context = multi->rdp->context;
+	WINPR_ASSERT(context);
+
+	freerdp* instance = context->instance;
+	WINPR_ASSERT(instance);
+
+	for (size_t x = 0; x < ARRAYSIZE(multi->tunnels); x++)
+	{
+		rdpMultitransportTunnel* tunnel = multi->tunnels[x];
+		if (!tunnel || !InterlockedCompareExchange(&tunnel->failed, 0, 0))
+			continue;
+
+		/* dynamic channels moved to the tunnel cannot go back to TCP */
+		if (InterlockedCompareExchange(&multi->tunnelUsed, 0, 0))
+			return FALSE;
+
+		multi->tunnels[x] = NULL;
+		multitransport_tunnel_free(tunnel);
+	}
+
+	const UINT16 channelId = freerdp_channels_get_id_by_name(instance, DRDYNVC_SVC_CHANNEL_NAME);
+	wStream* s = NULL;
+	while ((s = Queue_Dequeue(multi->receiveQueue)))
+	{
+		const size_t length = Stream_Length(s);
+		BOOL rc = (channelId != 0) && instance->ReceiveChannelData;
+
+		(void)InterlockedExchange(&multi->tunnelUsed, 1);
+		if (rc)
+			rc = instance->ReceiveChannelData(instance, channelId, Stream_Buffer(s), length,
+			                                  CHANNEL_FLAG_FIRST | CHANNEL_FLAG_LAST, length) >= 0;
+		Stream_Free(s, TRUE);
+		if (!rc)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL freerdp_multitransport_has_tunnel(rdpContext* context, UINT32 tunnelType)
+{
+	if (!context || !context->rdp || !context->rdp->multitransport)
+		return FALSE;
+
+	rdpMultitransport* multi = context->rdp->multitransport;
+	rdpMultitransportTunnel* tunnel = multi->tunnels[multitransport_tunnel_index(tunnelType)];
+	return tunnel && (tunnel->tunnelType == tunnelType) &&
+	       !InterlockedCompareExchange(&tunnel->failed, 0, 0);
+}
+
+BOOL freerdp_multitransport_send_dvc(rdpContext* context, UINT32 tunnelType, const BYTE* data,
+                                     size_t length)
+{
+	if (!freerdp_multitransport_has_tunnel(context, tunnelType) || !data)
+		return FALSE;
+
+	rdpMultitransport* multi = context->rdp->multitransport;
+	rdpMultitransportTunnel* tunnel = multi->tunnels[multitransport_tunnel_index(tunnelType)];
+
+	wStream* s = multitransport_tunnel_pdu_new(RDPTUNNEL_ACTION_DATA, length);
+	if (!s)
+		return FALSE;
+
+	Stream_Write(s, data, length); /* HigherLayerData */
+	Stream_SealLength(s);
+	Stream_SetPosition(s, 0);
+	(void)InterlockedExchange(&multi->tunnelUsed, 1);
+	if (!Queue_Enqueue(tunnel->sendQueue, s))
+	{
+		Stream_Free(s, TRUE);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static state_run_t multitransport_server_handle_response(rdpMultitransport* multi, UINT32 reqId,
                                                          UINT32 hrResponse)
 {
@@ -216,7 +899,8 @@ rdpMultitransport* multitransport_new(rdpRdp* rdp, UINT16 protocol)
 	}
 	else
 	{
-		multi->MtRequest = multitransport_no_udp;
+		/* the settings are only complete once the connection starts */
+		multi->MtRequest = multitransport_client_request;
 	}
 
 	multi->rdp = rdp;
@@ -225,5 +909,11 @@ rdpMultitransport* multitransport_new(rdpRdp* rdp, UINT16 protocol)
 
 void multitransport_free(rdpMultitransport* multitransport)
 {
+	if (!multitransport)
+		return;
+
+	for (size_t x = 0; x < ARRAYSIZE(multitransport->tunnels); x++)
+		multitransport_tunnel_free(multitransport->tunnels[x]);
+	Queue_Free(multitransport->receiveQueue);
 	free(multitransport);
 }
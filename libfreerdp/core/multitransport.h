@@ -51,6 +51,12 @@ FREERDP_LOCAL state_run_t multitransport_recv_response(rdpMultitransport* multi,
 FREERDP_LOCAL BOOL multitransport_client_send_response(rdpMultitransport* multi, UINT32 reqId,
                                                        HRESULT hr);
 
+/* The event of the dynamic channel data received through the UDP tunnels, NULL without */
+FREERDP_LOCAL HANDLE multitransport_get_event_handle(rdpMultitransport* multi);
+
+/* Hands the received tunnel data to drdynvc, FALSE if a tunnel in use was lost */
+FREERDP_LOCAL BOOL multitransport_check(rdpMultitransport* multi);
+
 FREERDP_LOCAL void multitransport_free(rdpMultitransport* multi);
 
 WINPR_ATTR_MALLOC(multitransport_free, 1)
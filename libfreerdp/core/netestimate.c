@@ -0,0 +1,272 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Network Estimation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+
+#include "netestimate.h"
+#include "transport.h"
+
+#define NETESTIMATE_INTERVAL 1000
+/* Fewer segments make single retransmissions look like heavy loss */
+#define NETESTIMATE_LOSS_SEGMENTS 256
+
+struct rdp_network_estimator
+{
+	rdpRdp* rdp;
+	CRITICAL_SECTION lock;
+
+	UINT32 flags;
+	/* RFC 6298 estimators in us */
+	UINT64 srtt;
+	UINT64 rttVar;
+	UINT64 minRtt;
+	UINT32 bandwidth;
+	UINT32 goodput;
+	UINT32 loss;
+	UINT32 frameLatency;
+	UINT64 updated;
+
+	UINT64 lastCheck;
+	UINT64 lastBytes;
+	UINT64 lastOutBytes;
+	UINT32 lastRetransmits;
+	BOOL tcpInfo;
+};
+
+static UINT32 netestimate_average(UINT32 average, UINT64 value, UINT32 weight)
+{
+	const UINT64 v = MIN(value, UINT32_MAX);
+	return (UINT32)((average * (weight - 1ULL) + v) / weight);
+}
+
+static void netestimate_add_rtt_locked(rdpNetworkEstimator* estimator, UINT32 rtt, UINT32 rttVar)
+{
+	if (rtt == 0)
+		return;
+
+	if (!(estimator->flags & FREERDP_NETWORK_ESTIMATE_RTT))
+	{
+		estimator->srtt = rtt;
+		estimator->rttVar = (rttVar != 0) ? rttVar : rtt / 2;
+		estimator->minRtt = rtt;
+		estimator->flags |= FREERDP_NETWORK_ESTIMATE_RTT;
+	}
+	else
+	{
+		const UINT64 deviation =
+		    (rttVar != 0) ? rttVar
+		                  : ((estimator->srtt > rtt) ? estimator->srtt - rtt : rtt - estimator->srtt);
+		estimator->rttVar = (3 * estimator->rttVar + deviation) / 4;
+		estimator->srtt = (7 * estimator->srtt + rtt) / 8;
+		estimator->minRtt = MIN(estimator->minRtt, rtt);
+	}
+	estimator->updated = GetTickCount64();
+}
+
+void netestimate_add_rtt(rdpNetworkEstimator* estimator, UINT32 rtt, UINT32 rttVar)
+{
+	WINPR_ASSERT(estimator);
+
+	EnterCriticalSection(&estimator->lock);
+	netestimate_add_rtt_locked(estimator, rtt, rttVar);
+	LeaveCriticalSection(&estimator->lock);
+}
+
+void netestimate_add_bandwidth(rdpNetworkEstimator* estimator, UINT32 bandwidth)
+{
+	WINPR_ASSERT(estimator);
+
+	if (bandwidth == 0)
+		return;
+
+	/* Every measurement is an explicit probe of the link, the latest one wins */
+	EnterCriticalSection(&estimator->lock);
+	estimator->bandwidth = bandwidth;
+	estimator->flags |= FREERDP_NETWORK_ESTIMATE_BANDWIDTH;
+	estimator->updated = GetTickCount64();
+	LeaveCriticalSection(&estimator->lock);
+}
+
+void netestimate_add_frame_latency(rdpNetworkEstimator* estimator, UINT32 latency)
+{
+	WINPR_ASSERT(estimator);
+
+	EnterCriticalSection(&estimator->lock);
+	if (!(estimator->flags & FREERDP_NETWORK_ESTIMATE_FRAME_LATENCY))
+		estimator->frameLatency = latency;
+	else
+		estimator->frameLatency = netestimate_average(estimator->frameLatency, latency, 8);
+	estimator->flags |= FREERDP_NETWORK_ESTIMATE_FRAME_LATENCY;
+	estimator->updated = GetTickCount64();
+	LeaveCriticalSection(&estimator->lock);
+}
+
+static void netestimate_check_tcp(rdpNetworkEstimator* estimator, UINT64 outBytes)
+{
+	UINT32 rtt = 0;
+	UINT32 rttVar = 0;
+	UINT32 mss = 0;
+	UINT32 retransmits = 0;
+
+	rdpTransport* transport = estimator->rdp->transport;
+	if (!transport || !transport_get_tcp_info(transport, &rtt, &rttVar, &mss, &retransmits))
+		return;
+
+	netestimate_add_rtt_locked(estimator, rtt, rttVar);
+
+	/* The segments sent are estimated from the bytes, the kernel does not report them here */
+	if (estimator->tcpInfo && (mss > 0) && (outBytes >= estimator->lastOutBytes) &&
+	    (retransmits >= estimator->lastRetransmits))
+	{
+		const UINT64 segments = (outBytes - estimator->lastOutBytes) / mss;
+		const UINT64 lost = retransmits - estimator->lastRetransmits;
+
+		/* Keep accumulating until the interval is meaningful */
+		if (segments < NETESTIMATE_LOSS_SEGMENTS)
+			return;
+
+		const UINT64 loss = 10000 * lost / (segments + lost);
+		if (!(estimator->flags & FREERDP_NETWORK_ESTIMATE_LOSS))
+			estimator->loss = (UINT32)loss;
+		else
+			estimator->loss = netestimate_average(estimator->loss, loss, 4);
+		estimator->flags |= FREERDP_NETWORK_ESTIMATE_LOSS;
+	}
+
+	estimator->tcpInfo = TRUE;
+	estimator->lastOutBytes = outBytes;
+	estimator->lastRetransmits = retransmits;
+}
+
+void netestimate_check(rdpNetworkEstimator* estimator, BOOL force)
+{
+	WINPR_ASSERT(estimator);
+	WINPR_ASSERT(estimator->rdp);
+
+	const UINT64 now = GetTickCount64();
+	if (!force && (now - estimator->lastCheck < NETESTIMATE_INTERVAL))
+		return;
+
+	rdpRdp* rdp = estimator->rdp;
+	const BOOL server = freerdp_settings_get_bool(rdp->settings, FreeRDP_ServerMode);
+	const UINT64 bytes = server ? rdp->outBytes : rdp->inBytes;
+
+	EnterCriticalSection(&estimator->lock);
+	if ((estimator->lastCheck != 0) && (now > estimator->lastCheck) &&
+	    (bytes >= estimator->lastBytes))
+	{
+		/* bytes per ms * 8 = kbit/s */
+		const UINT64 goodput = 8 * (bytes - estimator->lastBytes) / (now - estimator->lastCheck);
+
+		if (!(estimator->flags & FREERDP_NETWORK_ESTIMATE_GOODPUT))
+			estimator->goodput = (UINT32)MIN(goodput, UINT32_MAX);
+		else
+			estimator->goodput = netestimate_average(estimator->goodput, goodput, 4);
+		estimator->flags |= FREERDP_NETWORK_ESTIMATE_GOODPUT;
+		estimator->updated = now;
+	}
+	estimator->lastCheck = now;
+	estimator->lastBytes = bytes;
+
+	netestimate_check_tcp(estimator, rdp->outBytes);
+	LeaveCriticalSection(&estimator->lock);
+}
+
+void netestimate_get(rdpNetworkEstimator* estimator, rdpNetworkEstimate* estimate)
+{
+	WINPR_ASSERT(estimator);
+	WINPR_ASSERT(estimate);
+
+	EnterCriticalSection(&estimator->lock);
+	estimate->flags = estimator->flags;
+	estimate->smoothedRTT = (UINT32)MIN((estimator->srtt + 500) / 1000, UINT32_MAX);
+	estimate->minRTT = (UINT32)MIN((estimator->minRtt + 500) / 1000, UINT32_MAX);
+	estimate->jitter = (UINT32)MIN((estimator->rttVar + 500) / 1000, UINT32_MAX);
+	estimate->bandwidth = estimator->bandwidth;
+	estimate->goodput = estimator->goodput;
+	estimate->loss = estimator->loss;
+	estimate->frameLatency = estimator->frameLatency;
+	estimate->updated = estimator->updated;
+	LeaveCriticalSection(&estimator->lock);
+}
+
+rdpNetworkEstimator* netestimate_new(rdpRdp* rdp)
+{
+	WINPR_ASSERT(rdp);
+
+	rdpNetworkEstimator* estimator = calloc(1, sizeof(rdpNetworkEstimator));
+	if (!estimator)
+		return NULL;
+
+	estimator->rdp = rdp;
+	if (!InitializeCriticalSectionAndSpinCount(&estimator->lock, 4000))
+	{
+		free(estimator);
+		return NULL;
+	}
+	return estimator;
+}
+
+void netestimate_free(rdpNetworkEstimator* estimator)
+{
+	if (!estimator)
+		return;
+
+	DeleteCriticalSection(&estimator->lock);
+	free(estimator);
+}
+
+static rdpNetworkEstimator* netestimate_get_context(rdpContext* context)
+{
+	if (!context || !context->rdp)
+		return NULL;
+	return context->rdp->estimator;
+}
+
+BOOL freerdp_network_estimate_get(rdpContext* context, rdpNetworkEstimate* estimate)
+{
+	rdpNetworkEstimator* estimator = netestimate_get_context(context);
+	if (!estimator || !estimate)
+		return FALSE;
+
+	netestimate_get(estimator, estimate);
+	return TRUE;
+}
+
+BOOL freerdp_network_estimate_add_rtt(rdpContext* context, UINT32 rtt)
+{
+	rdpNetworkEstimator* estimator = netestimate_get_context(context);
+	if (!estimator || (rtt == 0) || (rtt > UINT32_MAX / 1000))
+		return FALSE;
+
+	netestimate_add_rtt(estimator, rtt * 1000, 0);
+	return TRUE;
+}
+
+BOOL freerdp_network_estimate_add_frame_latency(rdpContext* context, UINT32 latency)
+{
+	rdpNetworkEstimator* estimator = netestimate_get_context(context);
+	if (!estimator)
+		return FALSE;
+
+	netestimate_add_frame_latency(estimator, latency);
+	return TRUE;
+}
@@ -0,0 +1,46 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Network Estimation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_NETESTIMATE_H
+#define FREERDP_LIB_CORE_NETESTIMATE_H
+
+typedef struct rdp_network_estimator rdpNetworkEstimator;
+
+#include "rdp.h"
+
+#include <freerdp/autodetect.h>
+#include <freerdp/api.h>
+
+FREERDP_LOCAL void netestimate_free(rdpNetworkEstimator* estimator);
+
+WINPR_ATTR_MALLOC(netestimate_free, 1)
+FREERDP_LOCAL rdpNetworkEstimator* netestimate_new(rdpRdp* rdp);
+
+/* Adds a round-trip time sample in us, rttVar is the deviation reported with it or 0 */
+FREERDP_LOCAL void netestimate_add_rtt(rdpNetworkEstimator* estimator, UINT32 rtt, UINT32 rttVar);
+
+/* Adds a bandwidth measured by auto-detect in kbit/s */
+FREERDP_LOCAL void netestimate_add_bandwidth(rdpNetworkEstimator* estimator, UINT32 bandwidth);
+
+FREERDP_LOCAL void netestimate_add_frame_latency(rdpNetworkEstimator* estimator, UINT32 latency);
+
+/* Samples the goodput and the TCP_INFO of the socket, at most once a second unless forced */
+FREERDP_LOCAL void netestimate_check(rdpNetworkEstimator* estimator, BOOL force);
+
+FREERDP_LOCAL void netestimate_get(rdpNetworkEstimator* estimator, rdpNetworkEstimate* estimate);
+
+#endif /* FREERDP_LIB_CORE_NETESTIMATE_H */
@@ -107,6 +107,8 @@ typedef enum
  *
  */
 
+#define NLA_ROUND_TRIP "NLA round trip"
+
 struct rdp_nla
 {
 	BOOL server;
@@ -1758,6 +1760,10 @@ BOOL nla_send(rdpNla* nla)
 	WinPrAsn1Encoder* enc = NULL;
 
 	WINPR_ASSERT(nla);
+	WINPR_ASSERT(nla->rdpcontext);
+
+	/* Only the client credentials are not answered, unless early user auth is used */
+	const BOOL reply = nla->server || (nla->authInfo.cbBuffer == 0) || nla->earlyUserAuth;
 
 	enc = WinPrAsn1Encoder_New(WINPR_ASN1_DER);
 	if (!enc)
@@ -1837,6 +1843,8 @@ BOOL nla_send(rdpNla* nla)
 	WLog_DBG(TAG, "[%" PRIuz " bytes]", length);
 	if (transport_write(nla->transport, s) < 0)
 		goto fail;
+	if (reply)
+		conntrace_begin(nla->rdpcontext->rdp->conntrace, NLA_ROUND_TRIP);
 	rc = TRUE;
 
 fail:
@@ -1957,6 +1965,9 @@ int nla_recv_pdu(rdpNla* nla, wStream* s)
 {
 	WINPR_ASSERT(nla);
 	WINPR_ASSERT(s);
+	WINPR_ASSERT(nla->rdpcontext);
+
+	conntrace_end(nla->rdpcontext->rdp->conntrace, NLA_ROUND_TRIP);
 
 	if (nla_get_state(nla) == NLA_STATE_EARLY_USER_AUTH)
 	{
@@ -2044,9 +2055,12 @@ int nla_server_recv(rdpNla* nla)
 
 	WINPR_ASSERT(nla);
 
+	WINPR_ASSERT(nla->rdpcontext);
+
 	wStream* s = nla_server_recv_stream(nla);
 	if (!s)
 		goto fail;
+	conntrace_end(nla->rdpcontext->rdp->conntrace, NLA_ROUND_TRIP);
 	status = nla_decode_ts_request(nla, s);
 
 fail:
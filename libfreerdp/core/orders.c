@@ -2179,7 +2179,6 @@ static BOOL update_read_ellipse_cb_order(const char* orderName, wStream* s,
 }
 
 /* Secondary Drawing Orders */
-WINPR_ATTR_MALLOC(free_cache_bitmap_order, 2)
 static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wStream* s,
                                                           BOOL compressed, UINT16 flags)
 {
@@ -2189,7 +2188,7 @@ static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wSt
 	if (!update || !s)
 		return NULL;
 
-	cache_bitmap = calloc(1, sizeof(CACHE_BITMAP_ORDER));
+	cache_bitmap = update_arena_calloc(update, 1, sizeof(CACHE_BITMAP_ORDER));
 
 	if (!cache_bitmap)
 		goto fail;
@@ -2232,7 +2231,7 @@ static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wSt
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, cache_bitmap->bitmapLength))
 		goto fail;
 
-	cache_bitmap->bitmapDataStream = malloc(cache_bitmap->bitmapLength);
+	cache_bitmap->bitmapDataStream = update_arena_alloc(update, cache_bitmap->bitmapLength);
 
 	if (!cache_bitmap->bitmapDataStream)
 		goto fail;
@@ -2241,10 +2240,6 @@ static CACHE_BITMAP_ORDER* update_read_cache_bitmap_order(rdpUpdate* update, wSt
 	cache_bitmap->compressed = compressed;
 	return cache_bitmap;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_bitmap_order(update->context, cache_bitmap);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2298,7 +2293,6 @@ BOOL update_write_cache_bitmap_order(wStream* s, const CACHE_BITMAP_ORDER* cache
 	return TRUE;
 }
 
-WINPR_ATTR_MALLOC(free_cache_bitmap_v2_order, 2)
 static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* update, wStream* s,
                                                                 BOOL compressed, UINT16 flags)
 {
@@ -2309,7 +2303,7 @@ static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* updat
 	if (!update || !s)
 		return NULL;
 
-	cache_bitmap_v2 = calloc(1, sizeof(CACHE_BITMAP_V2_ORDER));
+	cache_bitmap_v2 = update_arena_calloc(update, 1, sizeof(CACHE_BITMAP_V2_ORDER));
 
 	if (!cache_bitmap_v2)
 		goto fail;
@@ -2378,7 +2372,7 @@ static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* updat
 	if (cache_bitmap_v2->bitmapLength == 0)
 		goto fail;
 
-	cache_bitmap_v2->bitmapDataStream = malloc(cache_bitmap_v2->bitmapLength);
+	cache_bitmap_v2->bitmapDataStream = update_arena_alloc(update, cache_bitmap_v2->bitmapLength);
 
 	if (!cache_bitmap_v2->bitmapDataStream)
 		goto fail;
@@ -2387,10 +2381,6 @@ static CACHE_BITMAP_V2_ORDER* update_read_cache_bitmap_v2_order(rdpUpdate* updat
 	cache_bitmap_v2->compressed = compressed;
 	return cache_bitmap_v2;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_bitmap_v2_order(update->context, cache_bitmap_v2);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2476,7 +2466,6 @@ BOOL update_write_cache_bitmap_v2_order(wStream* s, CACHE_BITMAP_V2_ORDER* cache
 	return TRUE;
 }
 
-WINPR_ATTR_MALLOC(free_cache_bitmap_v3_order, 2)
 static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* update, wStream* s,
                                                                 UINT16 flags)
 {
@@ -2491,7 +2480,7 @@ static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* updat
 	if (!update || !s)
 		return NULL;
 
-	cache_bitmap_v3 = calloc(1, sizeof(CACHE_BITMAP_V3_ORDER));
+	cache_bitmap_v3 = update_arena_calloc(update, 1, sizeof(CACHE_BITMAP_V3_ORDER));
 
 	if (!cache_bitmap_v3)
 		goto fail;
@@ -2528,7 +2517,7 @@ static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* updat
 	if ((new_len == 0) || (!Stream_CheckAndLogRequiredLength(TAG, s, new_len)))
 		goto fail;
 
-	new_data = (BYTE*)realloc(bitmapData->data, new_len);
+	new_data = (BYTE*)update_arena_alloc(update, new_len);
 
 	if (!new_data)
 		goto fail;
@@ -2538,10 +2527,6 @@ static CACHE_BITMAP_V3_ORDER* update_read_cache_bitmap_v3_order(rdpUpdate* updat
 	Stream_Read(s, bitmapData->data, bitmapData->length);
 	return cache_bitmap_v3;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_bitmap_v3_order(update->context, cache_bitmap_v3);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2583,12 +2568,12 @@ BOOL update_write_cache_bitmap_v3_order(wStream* s, CACHE_BITMAP_V3_ORDER* cache
 	return TRUE;
 }
 
-WINPR_ATTR_MALLOC(free_cache_color_table_order, 2)
 static CACHE_COLOR_TABLE_ORDER* update_read_cache_color_table_order(rdpUpdate* update, wStream* s,
                                                                     UINT16 flags)
 {
 	UINT32* colorTable = NULL;
-	CACHE_COLOR_TABLE_ORDER* cache_color_table = calloc(1, sizeof(CACHE_COLOR_TABLE_ORDER));
+	CACHE_COLOR_TABLE_ORDER* cache_color_table =
+	    update_arena_calloc(update, 1, sizeof(CACHE_COLOR_TABLE_ORDER));
 
 	if (!cache_color_table)
 		goto fail;
@@ -2610,15 +2595,13 @@ static CACHE_COLOR_TABLE_ORDER* update_read_cache_color_table_order(rdpUpdate* u
 
 	colorTable = (UINT32*)&cache_color_table->colorTable;
 
+	/* TS_COLOR_QUAD is blue, green, red, pad, a little endian UINT32 without the pad byte */
+	Stream_ReadArray_UINT32(s, colorTable, cache_color_table->numberColors);
 	for (UINT32 i = 0; i < cache_color_table->numberColors; i++)
-		update_read_color_quad(s, &colorTable[i]);
+		colorTable[i] &= 0x00FFFFFF;
 
 	return cache_color_table;
 fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_cache_color_table_order(update->context, cache_color_table);
-	WINPR_PRAGMA_DIAG_POP
 	return NULL;
 }
 
@@ -2659,7 +2642,8 @@ BOOL update_write_cache_color_table_order(wStream* s,
 }
 static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStream* s, UINT16 flags)
 {
-	CACHE_GLYPH_ORDER* cache_glyph_order = calloc(1, sizeof(CACHE_GLYPH_ORDER));
+	CACHE_GLYPH_ORDER* cache_glyph_order =
+	    update_arena_calloc(update, 1, sizeof(CACHE_GLYPH_ORDER));
 
 	WINPR_ASSERT(update);
 	WINPR_ASSERT(s);
@@ -2680,18 +2664,23 @@ static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStre
 		if (!Stream_CheckAndLogRequiredLength(TAG, s, 10))
 			goto fail;
 
-		Stream_Read_UINT16(s, glyph->cacheIndex);
-		Stream_Read_INT16(s, glyph->x);
-		Stream_Read_INT16(s, glyph->y);
-		Stream_Read_UINT16(s, glyph->cx);
-		Stream_Read_UINT16(s, glyph->cy);
+		UINT16 x = 0;
+		UINT16 y = 0;
+		const BYTE* data = Stream_ReadSpan(s, 10);
+		Data_Read_UINT16(&data[0], glyph->cacheIndex);
+		Data_Read_UINT16(&data[2], x);
+		Data_Read_UINT16(&data[4], y);
+		glyph->x = (INT16)x;
+		glyph->y = (INT16)y;
+		Data_Read_UINT16(&data[6], glyph->cx);
+		Data_Read_UINT16(&data[8], glyph->cy);
 		glyph->cb = ((glyph->cx + 7) / 8) * glyph->cy;
 		glyph->cb += ((glyph->cb % 4) > 0) ? 4 - (glyph->cb % 4) : 0;
 
 		if (!Stream_CheckAndLogRequiredLength(TAG, s, glyph->cb))
 			goto fail;
 
-		glyph->aj = (BYTE*)malloc(glyph->cb);
+		glyph->aj = (BYTE*)update_arena_alloc(update, glyph->cb);
 
 		if (!glyph->aj)
 			goto fail;
@@ -2701,7 +2690,8 @@ static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStre
 
 	if ((flags & CG_GLYPH_UNICODE_PRESENT) && (cache_glyph_order->cGlyphs > 0))
 	{
-		cache_glyph_order->unicodeCharacters = calloc(cache_glyph_order->cGlyphs, sizeof(WCHAR));
+		cache_glyph_order->unicodeCharacters =
+		    update_arena_calloc(update, cache_glyph_order->cGlyphs, sizeof(WCHAR));
 
 		if (!cache_glyph_order->unicodeCharacters)
 			goto fail;
@@ -2716,7 +2706,6 @@ static CACHE_GLYPH_ORDER* update_read_cache_glyph_order(rdpUpdate* update, wStre
 
 	return cache_glyph_order;
 fail:
-	free_cache_glyph_order(update->context, cache_glyph_order);
 	return NULL;
 }
 
@@ -2767,7 +2756,8 @@ BOOL update_write_cache_glyph_order(wStream* s, const CACHE_GLYPH_ORDER* cache_g
 static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update, wStream* s,
                                                               UINT16 flags)
 {
-	CACHE_GLYPH_V2_ORDER* cache_glyph_v2 = calloc(1, sizeof(CACHE_GLYPH_V2_ORDER));
+	CACHE_GLYPH_V2_ORDER* cache_glyph_v2 =
+	    update_arena_calloc(update, 1, sizeof(CACHE_GLYPH_V2_ORDER));
 
 	if (!cache_glyph_v2)
 		goto fail;
@@ -2798,7 +2788,7 @@ static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update,
 		if (!Stream_CheckAndLogRequiredLength(TAG, s, glyph->cb))
 			goto fail;
 
-		glyph->aj = (BYTE*)malloc(glyph->cb);
+		glyph->aj = (BYTE*)update_arena_alloc(update, glyph->cb);
 
 		if (!glyph->aj)
 			goto fail;
@@ -2808,7 +2798,8 @@ static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update,
 
 	if ((flags & CG_GLYPH_UNICODE_PRESENT) && (cache_glyph_v2->cGlyphs > 0))
 	{
-		cache_glyph_v2->unicodeCharacters = calloc(cache_glyph_v2->cGlyphs, sizeof(WCHAR));
+		cache_glyph_v2->unicodeCharacters =
+		    update_arena_calloc(update, cache_glyph_v2->cGlyphs, sizeof(WCHAR));
 
 		if (!cache_glyph_v2->unicodeCharacters)
 			goto fail;
@@ -2821,7 +2812,6 @@ static CACHE_GLYPH_V2_ORDER* update_read_cache_glyph_v2_order(rdpUpdate* update,
 
 	return cache_glyph_v2;
 fail:
-	free_cache_glyph_v2_order(update->context, cache_glyph_v2);
 	return NULL;
 }
 
@@ -2911,7 +2901,7 @@ static CACHE_BRUSH_ORDER* update_read_cache_brush_order(rdpUpdate* update, wStre
 	BYTE iBitmapFormat = 0;
 	BOOL compressed = FALSE;
 	rdp_update_internal* up = update_cast(update);
-	CACHE_BRUSH_ORDER* cache_brush = calloc(1, sizeof(CACHE_BRUSH_ORDER));
+	CACHE_BRUSH_ORDER* cache_brush = update_arena_calloc(update, 1, sizeof(CACHE_BRUSH_ORDER));
 
 	if (!cache_brush)
 		goto fail;
@@ -2987,7 +2977,6 @@ static CACHE_BRUSH_ORDER* update_read_cache_brush_order(rdpUpdate* update, wStre
 
 	return cache_brush;
 fail:
-	free_cache_brush_order(update->context, cache_brush);
 	return NULL;
 }
 
@@ -3657,7 +3646,7 @@ static BOOL update_recv_primary_order(rdpUpdate* update, wStream* s, BYTE flags)
 	settings = context->settings;
 	WINPR_ASSERT(settings);
 
-	defaultReturn = freerdp_settings_get_bool(settings, FreeRDP_DeactivateClientDecoding);
+	defaultReturn = settings->DeactivateClientDecoding;
 
 	if (flags & ORDER_TYPE_CHANGE)
 	{
@@ -3933,7 +3922,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 	const char* name = NULL;
 	BOOL defaultReturn = 0;
 
-	defaultReturn = freerdp_settings_get_bool(settings, FreeRDP_DeactivateClientDecoding);
+	defaultReturn = settings->DeactivateClientDecoding;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 5))
 		return FALSE;
@@ -3983,7 +3972,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 			if (order)
 			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheBitmap, context, order);
-				free_cache_bitmap_order(context, order);
+				update_arena_reset(update);
 			}
 		}
 		break;
@@ -3998,7 +3987,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 			if (order)
 			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheBitmapV2, context, order);
-				free_cache_bitmap_v2_order(context, order);
+				update_arena_reset(update);
 			}
 		}
 		break;
@@ -4010,7 +3999,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 			if (order)
 			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheBitmapV3, context, order);
-				free_cache_bitmap_v3_order(context, order);
+				update_arena_reset(update);
 			}
 		}
 		break;
@@ -4023,7 +4012,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 			if (order)
 			{
 				rc = IFCALLRESULT(defaultReturn, secondary->CacheColorTable, context, order);
-				free_cache_color_table_order(context, order);
+				update_arena_reset(update);
 			}
 		}
 		break;
@@ -4040,7 +4029,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 					if (order)
 					{
 						rc = IFCALLRESULT(defaultReturn, secondary->CacheGlyph, context, order);
-						free_cache_glyph_order(context, order);
+						update_arena_reset(update);
 					}
 				}
 				break;
@@ -4053,7 +4042,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 					if (order)
 					{
 						rc = IFCALLRESULT(defaultReturn, secondary->CacheGlyphV2, context, order);
-						free_cache_glyph_v2_order(context, order);
+						update_arena_reset(update);
 					}
 				}
 				break;
@@ -4073,7 +4062,7 @@ static BOOL update_recv_secondary_order(rdpUpdate* update, wStream* s, BYTE flag
 				if (order)
 				{
 					rc = IFCALLRESULT(defaultReturn, secondary->CacheBrush, context, order);
-					free_cache_brush_order(context, order);
+					update_arena_reset(update);
 				}
 			}
 			break;
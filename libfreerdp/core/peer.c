@@ -39,6 +39,8 @@
 #include "rdp.h"
 #include "peer.h"
 #include "multitransport.h"
+#include "handshake.h"
+#include "utils.h"
 
 #define TAG FREERDP_TAG("core.peer")
 
@@ -266,6 +268,9 @@ static BOOL freerdp_peer_initialize(freerdp_peer* client)
 		}
 	}
 
+	if (!utils_apply_thread_affinity(WLog_Get(TAG), settings))
+		return FALSE;
+
 	nego_set_RCG_supported(rdp->nego, settings->RemoteCredentialGuard);
 	if (!rdp_server_transition_to_state(rdp, CONNECTION_STATE_INITIAL))
 		return FALSE;
@@ -1292,6 +1297,58 @@ static BOOL freerdp_peer_has_more_to_read(freerdp_peer* peer)
 	return transport_have_more_bytes_to_read(peer->context->rdp->transport);
 }
 
+static int freerdp_peer_get_socket(freerdp_peer* peer)
+{
+	WINPR_ASSERT(peer);
+	WINPR_ASSERT(peer->context);
+	WINPR_ASSERT(peer->context->rdp);
+	return transport_get_socket(peer->context->rdp->transport);
+}
+
+static int freerdp_peer_process_input(freerdp_peer* peer, size_t maxPdus)
+{
+	size_t count = 0;
+
+	WINPR_ASSERT(peer);
+	WINPR_ASSERT(peer->context);
+	WINPR_ASSERT(peer->context->rdp);
+
+	rdpRdp* rdp = peer->context->rdp;
+
+	/* Every round handles at most one PDU, the TLS layer might hold more than the socket */
+	do
+	{
+		if (rdp_check_fds(rdp) < 0)
+			return -1;
+
+		if (!transport_have_more_bytes_to_read(rdp->transport))
+			return 0;
+	} while ((maxPdus == 0) || (++count < maxPdus));
+
+	return 1;
+}
+
+static int freerdp_peer_process_output(freerdp_peer* peer)
+{
+	WINPR_ASSERT(peer);
+	WINPR_ASSERT(peer->context);
+	WINPR_ASSERT(peer->context->rdp);
+
+	rdpTransport* transport = peer->context->rdp->transport;
+	const int status = transport_drain_output_buffer(transport);
+
+	if (status < 0)
+		return -1;
+
+	if ((status > 0) || transport_is_write_blocked(transport))
+		return 1;
+
+	if (!IFCALLRESULT(TRUE, peer->WriteReady, peer))
+		return -1;
+
+	return 0;
+}
+
 static LicenseCallbackResult freerdp_peer_nolicense(freerdp_peer* peer, wStream* s)
 {
 	rdpRdp* rdp = NULL;
@@ -1470,6 +1527,9 @@ freerdp_peer* freerdp_peer_new(int sockfd)
 		client->IsWriteBlocked = freerdp_peer_is_write_blocked;
 		client->DrainOutputBuffer = freerdp_peer_drain_output_buffer;
 		client->HasMoreToRead = freerdp_peer_has_more_to_read;
+		client->GetSocket = freerdp_peer_get_socket;
+		client->ProcessInput = freerdp_peer_process_input;
+		client->ProcessOutput = freerdp_peer_process_output;
 		client->VirtualChannelOpen = freerdp_peer_virtual_channel_open;
 		client->VirtualChannelClose = freerdp_peer_virtual_channel_close;
 		client->VirtualChannelWrite = freerdp_peer_virtual_channel_write;
@@ -1488,6 +1548,7 @@ void freerdp_peer_free(freerdp_peer* client)
 		return;
 
 	sspi_FreeAuthIdentity(&client->identity);
+	handshake_pool_unref(client->HandshakePool);
 	if (client->sockfd >= 0)
 		closesocket((SOCKET)client->sockfd);
 	free(client);
@@ -0,0 +1,62 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Static tracing probes
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_PROBES_H
+#define FREERDP_LIB_CORE_PROBES_H
+
+#include <freerdp/config.h>
+
+/**
+ * USDT probes in the provider 'freerdp'. Each one compiles to a single nop until a tracer
+ * (bpftrace, SystemTap, perf) attaches, e.g.
+ *
+ *   bpftrace -e 'usdt:libfreerdp3.so:freerdp:gfx_decode_exit { @[arg0] = count(); }'
+ *
+ * Arguments must be integers or pointers.
+ */
+#if defined(FREERDP_HAVE_SYS_SDT_H)
+#include <sys/sdt.h>
+
+#define FREERDP_PROBE0(name) DTRACE_PROBE(freerdp, name)
+#define FREERDP_PROBE1(name, a) DTRACE_PROBE1(freerdp, name, a)
+#define FREERDP_PROBE2(name, a, b) DTRACE_PROBE2(freerdp, name, a, b)
+#define FREERDP_PROBE3(name, a, b, c) DTRACE_PROBE3(freerdp, name, a, b, c)
+#define FREERDP_PROBE4(name, a, b, c, d) DTRACE_PROBE4(freerdp, name, a, b, c, d)
+#else
+#define FREERDP_PROBE0(name) \
+	do                       \
+	{                        \
+	} while (0)
+#define FREERDP_PROBE1(name, a) \
+	do                          \
+	{                           \
+	} while (0)
+#define FREERDP_PROBE2(name, a, b) \
+	do                             \
+	{                              \
+	} while (0)
+#define FREERDP_PROBE3(name, a, b, c) \
+	do                                \
+	{                                 \
+	} while (0)
+#define FREERDP_PROBE4(name, a, b, c, d) \
+	do                                   \
+	{                                    \
+	} while (0)
+#endif
+
+#endif /* FREERDP_LIB_CORE_PROBES_H */
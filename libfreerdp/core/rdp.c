@@ -36,6 +36,9 @@
 #include "redirection.h"
 
 #include <freerdp/codec/bulk.h>
+#include <freerdp/channels/cliprdr.h>
+#include <freerdp/channels/rdpdr.h>
+#include <freerdp/channels/rdpsnd.h>
 #include <freerdp/crypto/per.h>
 #include <freerdp/log.h>
 #include <freerdp/buildflags.h>
@@ -811,6 +814,51 @@ static UINT32 rdp_get_sec_bytes(rdpRdp* rdp, UINT16 sec_flags)
 	return sec_bytes;
 }
 
+int rdp_transport_write(rdpRdp* rdp, wStream* s, TRANSPORT_PRIORITY priority)
+{
+	WINPR_ASSERT(rdp);
+
+	/* Standard RDP security encrypts with a running cipher state, its PDUs must stay in order */
+	if (rdp->do_crypt)
+		priority = TRANSPORT_PRIORITY_NORMAL;
+	return transport_write_ex(rdp->transport, s, priority);
+}
+
+static TRANSPORT_PRIORITY rdp_channel_priority(const rdpRdp* rdp, UINT16 channel_id)
+{
+	WINPR_ASSERT(rdp);
+
+	const rdpMcs* mcs = rdp->mcs;
+	if (!mcs || (channel_id == MCS_GLOBAL_CHANNEL_ID))
+		return TRANSPORT_PRIORITY_NORMAL;
+
+	for (UINT32 x = 0; x < mcs->channelCount; x++)
+	{
+		const rdpMcsChannel* channel = &mcs->channels[x];
+		if (channel->ChannelId != channel_id)
+			continue;
+
+		/* The server ignores the priority options, they are still the channel's own word */
+		if (channel->options & CHANNEL_OPTION_PRI_HIGH)
+			return TRANSPORT_PRIORITY_HIGH;
+		if (channel->options & CHANNEL_OPTION_PRI_LOW)
+			return TRANSPORT_PRIORITY_BULK;
+		if (channel->options & CHANNEL_OPTION_PRI_MED)
+			return TRANSPORT_PRIORITY_NORMAL;
+
+		/* Peers that do not set them: audio plays ahead of the display, file transfers must
+		 * not hold back anything */
+		if (strcmp(channel->Name, RDPSND_CHANNEL_NAME) == 0)
+			return TRANSPORT_PRIORITY_HIGH;
+		if ((strcmp(channel->Name, CLIPRDR_SVC_CHANNEL_NAME) == 0) ||
+		    (strcmp(channel->Name, RDPDR_SVC_CHANNEL_NAME) == 0))
+			return TRANSPORT_PRIORITY_BULK;
+		break;
+	}
+
+	return TRANSPORT_PRIORITY_NORMAL;
+}
+
 /**
  * Send an RDP packet.
  * @param rdp RDP module
@@ -841,7 +889,7 @@ BOOL rdp_send(rdpRdp* rdp, wStream* s, UINT16 channel_id)
 	Stream_SetPosition(s, length);
 	Stream_SealLength(s);
 
-	if (transport_write(rdp->transport, s) < 0)
+	if (rdp_transport_write(rdp, s, rdp_channel_priority(rdp, channel_id)) < 0)
 		goto fail;
 
 	rc = TRUE;
@@ -920,7 +968,9 @@ BOOL rdp_send_data_pdu(rdpRdp* rdp, wStream* s, BYTE type, UINT16 channel_id)
 	           Stream_Length(s), channel_id);
 
 	rdp->outPackets++;
-	if (transport_write(rdp->transport, s) < 0)
+	const TRANSPORT_PRIORITY priority =
+	    (type == DATA_PDU_TYPE_INPUT) ? TRANSPORT_PRIORITY_HIGH : TRANSPORT_PRIORITY_NORMAL;
+	if (rdp_transport_write(rdp, s, priority) < 0)
 		goto fail;
 
 	rc = TRUE;
@@ -1080,6 +1130,7 @@ static BOOL rdp_recv_monitor_layout_pdu(rdpRdp* rdp, wStream* s)
 state_run_t rdp_recv_data_pdu(rdpRdp* rdp, wStream* s)
 {
 	BYTE type = 0;
+	wStream sbuffer = { 0 };
 	wStream* cs = NULL;
 	UINT16 length = 0;
 	UINT32 shareId = 0;
@@ -1118,27 +1169,16 @@ state_run_t rdp_recv_data_pdu(rdpRdp* rdp, wStream* s)
 			return STATE_RUN_FAILED;
 		}
 
-		if (bulk_decompress(rdp->bulk, Stream_ConstPointer(s), SrcSize, &pDstData, &DstSize,
-		                    compressedType))
-		{
-			cs = transport_take_from_pool(rdp->transport, DstSize);
-			if (!cs)
-			{
-				WLog_Print(rdp->log, WLOG_ERROR, "Couldn't take stream from pool");
-				return STATE_RUN_FAILED;
-			}
-
-			Stream_SetPosition(cs, 0);
-			Stream_Write(cs, pDstData, DstSize);
-			Stream_SealLength(cs);
-			Stream_SetPosition(cs, 0);
-		}
-		else
+		if ((bulk_decompress(rdp->bulk, Stream_ConstPointer(s), SrcSize, &pDstData, &DstSize,
+		                     compressedType) < 0) ||
+		    !pDstData)
 		{
 			WLog_Print(rdp->log, WLOG_ERROR, "bulk_decompress() failed");
 			return STATE_RUN_FAILED;
 		}
 
+		/* The decompressed data stays valid until the next PDU, parse it in place */
+		cs = Stream_StaticConstInit(&sbuffer, pDstData, DstSize);
 		Stream_Seek(s, SrcSize);
 	}
 
@@ -1298,15 +1338,8 @@ state_run_t rdp_recv_data_pdu(rdpRdp* rdp, wStream* s)
 			break;
 	}
 
-	if (cs != s)
-		Stream_Release(cs);
-
 	return STATE_RUN_SUCCESS;
 out_fail:
-
-	if (cs != s)
-		Stream_Release(cs);
-
 	return STATE_RUN_FAILED;
 }
 
@@ -2219,6 +2252,13 @@ int rdp_check_fds(rdpRdp* rdp)
 
 	if (status < 0)
 		WLog_Print(rdp->log, WLOG_DEBUG, "transport_check_fds() - %i", status);
+	else if (!multitransport_check(rdp->multitransport))
+	{
+		WLog_Print(rdp->log, WLOG_ERROR, "rdp_check_fds: multitransport_check()");
+		return -1;
+	}
+	else
+		netestimate_check(rdp->estimator, FALSE);
 
 	return status;
 }
@@ -2366,6 +2406,21 @@ rdpRdp* rdp_new(rdpContext* context)
 	if (!rdp->multitransport)
 		goto fail;
 
+	rdp->estimator = netestimate_new(rdp);
+
+	if (!rdp->estimator)
+		goto fail;
+
+	rdp->tlsSessions = freerdp_tls_session_cache_new();
+
+	if (!rdp->tlsSessions)
+		goto fail;
+
+	rdp->conntrace = conntrace_new(rdp);
+
+	if (!rdp->conntrace)
+		goto fail;
+
 	rdp->bulk = bulk_new(context);
 
 	if (!rdp->bulk)
@@ -2497,6 +2552,8 @@ void rdp_free(rdpRdp* rdp)
 		DeleteCriticalSection(&rdp->critical);
 		rdp_reset_free(rdp);
 
+		/* An unreported trace is reported on free, that needs the settings */
+		conntrace_free(rdp->conntrace);
 		freerdp_settings_free(rdp->settings);
 		freerdp_settings_free(rdp->originalSettings);
 		freerdp_settings_free(rdp->remoteSettings);
@@ -2508,6 +2565,9 @@ void rdp_free(rdpRdp* rdp)
 		autodetect_free(rdp->autodetect);
 		heartbeat_free(rdp->heartbeat);
 		multitransport_free(rdp->multitransport);
+		netestimate_free(rdp->estimator);
+		freerdp_tls_session_cache_free(rdp->tlsSessions);
+		free(rdp->cachedLicense);
 		bulk_free(rdp->bulk);
 		free(rdp->io);
 		PubSub_Free(rdp->pubSub);
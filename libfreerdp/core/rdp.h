@@ -38,6 +38,8 @@
 #include "autodetect.h"
 #include "heartbeat.h"
 #include "multitransport.h"
+#include "netestimate.h"
+#include "conntrace.h"
 #include "security.h"
 #include "transport.h"
 #include "connection.h"
@@ -163,6 +165,12 @@ struct rdp_rdp
 	rdpAutoDetect* autodetect;
 	rdpHeartbeat* heartbeat;
 	rdpMultitransport* multitransport;
+	rdpNetworkEstimator* estimator;
+	rdpConnectionTrace* conntrace;
+	rdpTlsSessionCache* tlsSessions;
+	/* The last client license, for reconnects if the license store could not be used */
+	BYTE* cachedLicense;
+	size_t cachedLicenseLength;
 	WINPR_RC4_CTX* rc4_decrypt_key;
 	UINT32 decrypt_use_count;
 	UINT32 decrypt_checksum_use_count;
@@ -233,6 +241,9 @@ FREERDP_LOCAL state_run_t rdp_recv_data_pdu(rdpRdp* rdp, wStream* s);
 
 FREERDP_LOCAL BOOL rdp_send(rdpRdp* rdp, wStream* s, UINT16 channelId);
 
+/* Writes s with the given priority, standard RDP security keeps everything in order */
+FREERDP_LOCAL int rdp_transport_write(rdpRdp* rdp, wStream* s, TRANSPORT_PRIORITY priority);
+
 FREERDP_LOCAL BOOL rdp_send_channel_data(rdpRdp* rdp, UINT16 channelId, const BYTE* data,
                                          size_t size);
 FREERDP_LOCAL BOOL rdp_channel_send_packet(rdpRdp* rdp, UINT16 channelId, size_t totalSize,
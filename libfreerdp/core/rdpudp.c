@@ -0,0 +1,1236 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * UDP Transport Extension (MS-RDPEUDP)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <string.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/stream.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/log.h>
+#include <freerdp/types.h>
+#include <freerdp/utils/ringbuffer.h>
+
+#include "rdpudp.h"
+
+#define TAG FREERDP_TAG("core.rdpudp")
+
+#define RDPUDP_FLAG_SYN 0x0001
+#define RDPUDP_FLAG_FIN 0x0002
+#define RDPUDP_FLAG_ACK 0x0004
+#define RDPUDP_FLAG_DATA 0x0008
+#define RDPUDP_FLAG_FEC 0x0010
+#define RDPUDP_FLAG_CN 0x0020
+#define RDPUDP_FLAG_CWR 0x0040
+#define RDPUDP_FLAG_AOA 0x0100
+#define RDPUDP_FLAG_SYNLOSSY 0x0200
+#define RDPUDP_FLAG_ACKDELAYED 0x0400
+#define RDPUDP_FLAG_CORRELATION_ID 0x0800
+#define RDPUDP_FLAG_SYNEX 0x1000
+
+#define RDPUDP_VERSION_INFO_VALID 0x0001
+#define RDPUDP_PROTOCOL_VERSION_1 0x0001
+#define RDPUDP_PROTOCOL_VERSION_2 0x0002
+#define RDPUDP_PROTOCOL_VERSION_3 0x0101
+
+#define RDPUDP_ACK_VECTOR_RECEIVED 0
+#define RDPUDP_ACK_VECTOR_PENDING 3
+#define RDPUDP_ACK_VECTOR_RUN_MAX 0x3F
+
+#define RDPUDP_MTU 1232
+#define RDPUDP_MIN_MTU 1132
+#define RDPUDP_FEC_HEADER_LEN 8
+#define RDPUDP_SOURCE_HEADER_LEN 8
+#define RDPUDP_AOA_LEN 4
+#define RDPUDP_ACK_VECTOR_MAX 64
+/* uAckVectorSize, the elements and the padding to a multiple of 4 bytes */
+#define RDPUDP_ACK_VECTOR_LEN_MAX 68
+#define RDPUDP_OVERHEAD                                                             \
+	(RDPUDP_FEC_HEADER_LEN + RDPUDP_ACK_VECTOR_LEN_MAX + RDPUDP_AOA_LEN + \
+	 RDPUDP_SOURCE_HEADER_LEN)
+
+#define RDPUDP_WINDOW 256        /* datagrams in flight and buffered out of order */
+#define RDPUDP_ACK_STATES 4096   /* coded sequence numbers remembered for the ack vector */
+#define RDPUDP_INITIAL_CWND 8
+#define RDPUDP_DUPLICATE_ACKS 3
+#define RDPUDP_MAX_TRANSMISSIONS 10
+#define RDPUDP_SYN_INTERVAL_MS 500
+#define RDPUDP_ACK_DELAY_MS 20
+#define RDPUDP_ACK_EVERY 2
+#define RDPUDP_KEEPALIVE_MS 2000
+#define RDPUDP_TIMEOUT_MS 65000
+#define RDPUDP_RTO_INITIAL_MS 1000
+#define RDPUDP_RTO_MIN_MS 100
+#define RDPUDP_RTO_MAX_MS 10000
+
+#define rdpudp_seq_lt(_a, _b) ((INT32)((UINT32)(_a) - (UINT32)(_b)) < 0)
+#define rdpudp_seq_leq(_a, _b) ((INT32)((UINT32)(_a) - (UINT32)(_b)) <= 0)
+
+typedef struct
+{
+	BOOL used;
+	BOOL acked;
+	UINT32 seq;
+	UINT32 transmissions;
+	UINT32 missing;
+	UINT64 sent;
+	size_t length;
+	BYTE data[RDPUDP_MTU];
+} rdpUdpSendSlot;
+
+typedef struct
+{
+	BOOL used;
+	size_t length;
+	BYTE data[RDPUDP_MTU];
+} rdpUdpRecvSlot;
+
+typedef enum
+{
+	RDPUDP_STATE_INITIAL,
+	RDPUDP_STATE_SYN_SENT,
+	RDPUDP_STATE_SYN_RECEIVED,
+	RDPUDP_STATE_CONNECTED,
+	RDPUDP_STATE_FAILED
+} RDPUDP_STATE;
+
+struct rdp_udp
+{
+	SOCKET sockfd;
+	HANDLE event;
+	BOOL server;
+	RDPUDP_MODE mode;
+	RDPUDP_STATE state;
+	UINT16 version;
+	UINT16 mtu;
+	BOOL hasCorrelationId;
+	BYTE correlationId[RDPUDP_CORRELATION_ID_LEN];
+	BOOL hasCookieHash;
+	BYTE cookieHash[RDPUDP_COOKIE_HASH_LEN];
+	UINT64 lastSend;
+	UINT64 lastReceive;
+
+	/* sending, the coded and the source sequence numbers are the same for our datagrams */
+	UINT32 localIsn;
+	UINT32 sndUna;
+	UINT32 sndNxt;
+	UINT32 cwnd;
+	UINT32 cwndCount;
+	UINT32 ssthresh;
+	UINT32 recover;
+	UINT32 peerWindow;
+	UINT32 srtt;
+	UINT32 rttvar;
+	UINT32 rto;
+	BOOL rttValid;
+	BOOL sendCwr;
+	rdpUdpSendSlot* sendSlots;
+
+	/* receiving */
+	UINT32 remoteIsn;
+	UINT32 rcvNxt;
+	UINT32 ackBase;
+	UINT32 ackHighest;
+	BYTE* ackStates;
+	UINT32 ackUnsent;
+	UINT64 ackSince;
+	BOOL congested;
+	rdpUdpRecvSlot* recvSlots;
+	size_t lossyHead;
+	size_t lossyCount;
+	RingBuffer received;
+};
+
+static BOOL rdpudp_send_datagram(rdpUdp* udp, const rdpUdpSendSlot* slot);
+
+static UINT32 rdpudp_window_free(const rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	size_t buffered = 0;
+	if (udp->mode == RDPUDP_MODE_LOSSY)
+		buffered = udp->lossyCount;
+	else
+		buffered = ringbuffer_used(&udp->received) / (RDPUDP_MTU - RDPUDP_OVERHEAD);
+
+	if (buffered >= RDPUDP_WINDOW)
+		return 0;
+	return (UINT32)(RDPUDP_WINDOW - buffered);
+}
+
+static BOOL rdpudp_send_raw(rdpUdp* udp, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(udp);
+
+	WINPR_ASSERT(length <= RDPUDP_MTU);
+	const int status = _send(udp->sockfd, (const char*)data, (int)length, 0);
+	if (status < 0)
+	{
+		/* a full socket buffer loses the datagram like the network would */
+		const int error = WSAGetLastError();
+		if ((error == WSAEWOULDBLOCK) || (error == WSAEINTR) || (error == WSAECONNREFUSED))
+			return TRUE;
+		WLog_ERR(TAG, "send failed with error %d", error);
+		return FALSE;
+	}
+
+	udp->lastSend = GetTickCount64();
+	return TRUE;
+}
+
+static void rdpudp_write_fec_header(rdpUdp* udp, wStream* s, UINT32 snSourceAck, UINT16 flags)
+{
+	Stream_Write_UINT32_BE(s, snSourceAck);
+	Stream_Write_UINT16_BE(s, (UINT16)rdpudp_window_free(udp));
+	Stream_Write_UINT16_BE(s, flags);
+}
+
+static BOOL rdpudp_send_syn(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	BYTE buffer[RDPUDP_MTU] = { 0 };
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticInit(&sbuffer, buffer, sizeof(buffer));
+
+	UINT16 flags = RDPUDP_FLAG_SYN | RDPUDP_FLAG_SYNEX;
+	if (udp->mode == RDPUDP_MODE_LOSSY)
+		flags |= RDPUDP_FLAG_SYNLOSSY;
+	if (udp->server)
+		flags |= RDPUDP_FLAG_ACK;
+	else if (udp->hasCorrelationId)
+		flags |= RDPUDP_FLAG_CORRELATION_ID;
+
+	rdpudp_write_fec_header(udp, s, udp->server ? udp->remoteIsn : UINT32_MAX, flags);
+	Stream_Write_UINT32_BE(s, udp->localIsn);
+	Stream_Write_UINT16_BE(s, udp->mtu);
+	Stream_Write_UINT16_BE(s, udp->mtu);
+
+	if (flags & RDPUDP_FLAG_CORRELATION_ID)
+	{
+		Stream_Write(s, udp->correlationId, sizeof(udp->correlationId));
+		Stream_Zero(s, 16);
+	}
+
+	Stream_Write_UINT16_BE(s, RDPUDP_VERSION_INFO_VALID);
+	Stream_Write_UINT16_BE(s, udp->version);
+	if (!udp->server && (udp->version == RDPUDP_PROTOCOL_VERSION_3))
+		Stream_Write(s, udp->cookieHash, sizeof(udp->cookieHash));
+
+	/* SYN datagrams are padded to the MTU so the path is known to carry it */
+	return rdpudp_send_raw(udp, buffer, udp->mtu);
+}
+
+static void rdpudp_write_ack_vector(rdpUdp* udp, wStream* s)
+{
+	WINPR_ASSERT(udp);
+
+	BYTE elements[RDPUDP_ACK_VECTOR_MAX] = { 0 };
+	size_t count = 0;
+	UINT32 seq = udp->ackHighest;
+	UINT32 span = udp->ackHighest - udp->ackBase + 1;
+	if (span > RDPUDP_ACK_STATES)
+		span = RDPUDP_ACK_STATES;
+
+	/* built from the newest state backwards, the oldest states are dropped if it is too long */
+	while ((span > 0) && (count < ARRAYSIZE(elements)))
+	{
+		const BOOL received = udp->ackStates[seq & (RDPUDP_ACK_STATES - 1)] != 0;
+		BYTE run = 0;
+
+		while ((span > 0) && (run < RDPUDP_ACK_VECTOR_RUN_MAX) &&
+		       ((udp->ackStates[seq & (RDPUDP_ACK_STATES - 1)] != 0) == received))
+		{
+			run++;
+			seq--;
+			span--;
+		}
+
+		const BYTE state = received ? RDPUDP_ACK_VECTOR_RECEIVED : RDPUDP_ACK_VECTOR_PENDING;
+		elements[count++] = (BYTE)((state << 6) | run);
+	}
+
+	Stream_Write_UINT16_BE(s, (UINT16)count);
+	for (size_t x = 0; x < count; x++)
+		Stream_Write_UINT8(s, elements[count - x - 1]);
+	Stream_Zero(s, (4 - ((2 + count) % 4)) % 4);
+}
+
+static BOOL rdpudp_send_datagram(rdpUdp* udp, const rdpUdpSendSlot* slot)
+{
+	WINPR_ASSERT(udp);
+
+	BYTE buffer[RDPUDP_MTU] = { 0 };
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticInit(&sbuffer, buffer, sizeof(buffer));
+
+	UINT16 flags = RDPUDP_FLAG_ACK | RDPUDP_FLAG_AOA;
+	if (slot)
+		flags |= RDPUDP_FLAG_DATA;
+	if (udp->congested)
+		flags |= RDPUDP_FLAG_CN;
+	if (udp->sendCwr)
+		flags |= RDPUDP_FLAG_CWR;
+	if (udp->ackSince && (GetTickCount64() - udp->ackSince >= RDPUDP_ACK_DELAY_MS))
+		flags |= RDPUDP_FLAG_ACKDELAYED;
+
+	rdpudp_write_fec_header(udp, s, udp->ackHighest, flags);
+	rdpudp_write_ack_vector(udp, s);
+	Stream_Write_UINT32_BE(s, udp->sndUna);
+
+	if (slot)
+	{
+		WINPR_ASSERT(slot->length <= Stream_GetRemainingCapacity(s) - RDPUDP_SOURCE_HEADER_LEN);
+		Stream_Write_UINT32_BE(s, slot->seq);
+		Stream_Write_UINT32_BE(s, slot->seq);
+		Stream_Write(s, slot->data, slot->length);
+	}
+
+	udp->sendCwr = FALSE;
+	udp->ackUnsent = 0;
+	udp->ackSince = 0;
+	return rdpudp_send_raw(udp, buffer, Stream_GetPosition(s));
+}
+
+static void rdpudp_update_rtt(rdpUdp* udp, UINT32 sample)
+{
+	WINPR_ASSERT(udp);
+
+	if (!udp->rttValid)
+	{
+		udp->srtt = sample;
+		udp->rttvar = sample / 2;
+		udp->rttValid = TRUE;
+	}
+	else
+	{
+		const UINT32 delta = (sample > udp->srtt) ? sample - udp->srtt : udp->srtt - sample;
+		udp->rttvar = (3 * udp->rttvar + delta) / 4;
+		udp->srtt = (7 * udp->srtt + sample) / 8;
+	}
+
+	udp->rto = udp->srtt + 4 * udp->rttvar;
+	if (udp->rto < RDPUDP_RTO_MIN_MS)
+		udp->rto = RDPUDP_RTO_MIN_MS;
+	if (udp->rto > RDPUDP_RTO_MAX_MS)
+		udp->rto = RDPUDP_RTO_MAX_MS;
+}
+
+static void rdpudp_congestion_event(rdpUdp* udp, UINT32 seq)
+{
+	WINPR_ASSERT(udp);
+
+	/* once per window, the losses of the same round trip are one event */
+	if (rdpudp_seq_lt(seq, udp->recover))
+		return;
+
+	udp->ssthresh = MAX(udp->cwnd / 2, 2);
+	udp->cwnd = udp->ssthresh;
+	udp->cwndCount = 0;
+	udp->recover = udp->sndNxt;
+}
+
+static BOOL rdpudp_lost(rdpUdp* udp, rdpUdpSendSlot* slot)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(slot);
+
+	slot->missing = 0;
+	if (udp->mode == RDPUDP_MODE_LOSSY)
+	{
+		/* the lossy mode does not repeat, the datagram is done with */
+		slot->acked = TRUE;
+		return TRUE;
+	}
+
+	if (++slot->transmissions > RDPUDP_MAX_TRANSMISSIONS)
+	{
+		WLog_ERR(TAG, "datagram %" PRIu32 " not acknowledged after %" PRIu32 " transmissions",
+		         slot->seq, RDPUDP_MAX_TRANSMISSIONS);
+		return FALSE;
+	}
+
+	slot->sent = GetTickCount64();
+	return rdpudp_send_datagram(udp, slot);
+}
+
+static void rdpudp_advance(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	while (udp->sndUna != udp->sndNxt)
+	{
+		rdpUdpSendSlot* slot = &udp->sendSlots[udp->sndUna % RDPUDP_WINDOW];
+		if (!slot->acked)
+			break;
+		slot->used = FALSE;
+		udp->sndUna++;
+	}
+}
+
+static BOOL rdpudp_acked(rdpUdp* udp, UINT32 seq, UINT64 now, UINT32* highest, UINT32* newly)
+{
+	WINPR_ASSERT(udp);
+
+	if (rdpudp_seq_lt(seq, udp->sndUna) || !rdpudp_seq_lt(seq, udp->sndNxt))
+		return TRUE;
+
+	rdpUdpSendSlot* slot = &udp->sendSlots[seq % RDPUDP_WINDOW];
+	if (!slot->used || slot->acked || (slot->seq != seq))
+		return TRUE;
+
+	slot->acked = TRUE;
+	/* Karn: only datagrams sent once give a sample */
+	if (slot->transmissions == 1)
+		rdpudp_update_rtt(udp, (UINT32)MIN(now - slot->sent, UINT32_MAX));
+
+	if (udp->cwnd < udp->ssthresh)
+		udp->cwnd++;
+	else if (++udp->cwndCount >= udp->cwnd)
+	{
+		udp->cwnd++;
+		udp->cwndCount = 0;
+	}
+	if (udp->cwnd > RDPUDP_WINDOW)
+		udp->cwnd = RDPUDP_WINDOW;
+
+	if ((*newly == 0) || rdpudp_seq_lt(*highest, seq))
+		*highest = seq;
+	(*newly)++;
+	return TRUE;
+}
+
+static BOOL rdpudp_read_ack_vector(rdpUdp* udp, wStream* s, UINT32 snSourceAck)
+{
+	WINPR_ASSERT(udp);
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
+		return FALSE;
+
+	const size_t count = Stream_Get_UINT16_BE(s);
+	const size_t padding = (4 - ((2 + count) % 4)) % 4;
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, count + padding))
+		return FALSE;
+
+	const BYTE* elements = Stream_Pointer(s);
+	Stream_Seek(s, count + padding);
+
+	UINT32 total = 0;
+	for (size_t x = 0; x < count; x++)
+		total += elements[x] & RDPUDP_ACK_VECTOR_RUN_MAX;
+
+	const UINT64 now = GetTickCount64();
+	UINT32 seq = snSourceAck - total + 1;
+	UINT32 highest = 0;
+	UINT32 newly = 0;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const BYTE state = elements[x] >> 6;
+		const BYTE run = elements[x] & RDPUDP_ACK_VECTOR_RUN_MAX;
+
+		for (BYTE y = 0; y < run; y++, seq++)
+		{
+			if (state != RDPUDP_ACK_VECTOR_RECEIVED)
+				continue;
+			if (!rdpudp_acked(udp, seq, now, &highest, &newly))
+				return FALSE;
+		}
+	}
+
+	if (newly > 0)
+	{
+		/* datagrams overtaken by later acknowledged ones are presumed lost once enough of them
+		 * got through or once they are a quarter round trip older than the acknowledged ones */
+		const UINT64 reorder = udp->srtt + udp->srtt / 4;
+		for (UINT32 x = udp->sndUna; rdpudp_seq_lt(x, highest); x++)
+		{
+			rdpUdpSendSlot* slot = &udp->sendSlots[x % RDPUDP_WINDOW];
+			if (!slot->used || slot->acked)
+				continue;
+			slot->missing += newly;
+			if ((slot->missing < RDPUDP_DUPLICATE_ACKS) &&
+			    (!udp->rttValid || (now - slot->sent <= reorder)))
+				continue;
+
+			rdpudp_congestion_event(udp, slot->seq);
+			if (!rdpudp_lost(udp, slot))
+				return FALSE;
+		}
+	}
+
+	rdpudp_advance(udp);
+	return TRUE;
+}
+
+static void rdpudp_mark_received(rdpUdp* udp, UINT32 coded)
+{
+	WINPR_ASSERT(udp);
+
+	if (rdpudp_seq_lt(coded, udp->ackBase))
+		return;
+
+	if (rdpudp_seq_lt(udp->ackHighest, coded))
+	{
+		/* a gap in the coded sequence is reported as congestion until the CWR */
+		if (coded != udp->ackHighest + 1)
+			udp->congested = TRUE;
+
+		for (UINT32 x = udp->ackHighest + 1; rdpudp_seq_lt(x, coded); x++)
+			udp->ackStates[x & (RDPUDP_ACK_STATES - 1)] = 0;
+		udp->ackHighest = coded;
+
+		if (udp->ackHighest - udp->ackBase >= RDPUDP_ACK_STATES)
+			udp->ackBase = udp->ackHighest - RDPUDP_ACK_STATES + 1;
+	}
+
+	udp->ackStates[coded & (RDPUDP_ACK_STATES - 1)] = 1;
+	udp->ackUnsent++;
+	if (!udp->ackSince)
+		udp->ackSince = GetTickCount64();
+}
+
+static BOOL rdpudp_receive_data(rdpUdp* udp, UINT32 coded, UINT32 source, const BYTE* data,
+                                size_t length)
+{
+	WINPR_ASSERT(udp);
+
+	if (length > RDPUDP_MTU)
+		return TRUE;
+
+	if (udp->mode == RDPUDP_MODE_LOSSY)
+	{
+		if (udp->lossyCount >= RDPUDP_WINDOW)
+			return TRUE;
+
+		rdpUdpRecvSlot* slot =
+		    &udp->recvSlots[(udp->lossyHead + udp->lossyCount) % RDPUDP_WINDOW];
+		memcpy(slot->data, data, length);
+		slot->length = length;
+		slot->used = TRUE;
+		udp->lossyCount++;
+		rdpudp_mark_received(udp, coded);
+		return TRUE;
+	}
+
+	if (rdpudp_seq_lt(source, udp->rcvNxt))
+	{
+		/* a repeat of delivered data, the acknowledgement was lost */
+		rdpudp_mark_received(udp, coded);
+		return TRUE;
+	}
+
+	if (source - udp->rcvNxt >= RDPUDP_WINDOW)
+		return TRUE;
+
+	rdpUdpRecvSlot* slot = &udp->recvSlots[source % RDPUDP_WINDOW];
+	if (!slot->used)
+	{
+		memcpy(slot->data, data, length);
+		slot->length = length;
+		slot->used = TRUE;
+	}
+	rdpudp_mark_received(udp, coded);
+
+	for (;;)
+	{
+		rdpUdpRecvSlot* next = &udp->recvSlots[udp->rcvNxt % RDPUDP_WINDOW];
+		if (!next->used)
+			break;
+		if (!ringbuffer_write(&udp->received, next->data, next->length))
+			return FALSE;
+		next->used = FALSE;
+		udp->rcvNxt++;
+	}
+
+	return TRUE;
+}
+
+static BOOL rdpudp_read_syn(rdpUdp* udp, wStream* s, UINT16 flags)
+{
+	WINPR_ASSERT(udp);
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, 8))
+		return FALSE;
+
+	const UINT32 isn = Stream_Get_UINT32_BE(s);
+	const UINT16 upMtu = Stream_Get_UINT16_BE(s);
+	const UINT16 downMtu = Stream_Get_UINT16_BE(s);
+	if ((upMtu < RDPUDP_MIN_MTU) || (downMtu < RDPUDP_MIN_MTU))
+	{
+		WLog_ERR(TAG, "invalid MTU %" PRIu16 "/%" PRIu16, upMtu, downMtu);
+		return FALSE;
+	}
+
+	if (flags & RDPUDP_FLAG_CORRELATION_ID)
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 32))
+			return FALSE;
+		Stream_Read(s, udp->correlationId, sizeof(udp->correlationId));
+		Stream_Seek(s, 16);
+		udp->hasCorrelationId = TRUE;
+	}
+
+	UINT16 version = RDPUDP_PROTOCOL_VERSION_1;
+	if (flags & RDPUDP_FLAG_SYNEX)
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 4))
+			return FALSE;
+		const UINT16 synExFlags = Stream_Get_UINT16_BE(s);
+		const UINT16 udpVer = Stream_Get_UINT16_BE(s);
+		if (synExFlags & RDPUDP_VERSION_INFO_VALID)
+			version = udpVer;
+
+		if (udp->server && (version == RDPUDP_PROTOCOL_VERSION_3))
+		{
+			if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_COOKIE_HASH_LEN))
+				return FALSE;
+			Stream_Read(s, udp->cookieHash, sizeof(udp->cookieHash));
+			udp->hasCookieHash = TRUE;
+		}
+	}
+
+	if (udp->server)
+	{
+		if ((version != RDPUDP_PROTOCOL_VERSION_1) && (version != RDPUDP_PROTOCOL_VERSION_2) &&
+		    (version != RDPUDP_PROTOCOL_VERSION_3))
+			version = RDPUDP_PROTOCOL_VERSION_2;
+		udp->mode = (flags & RDPUDP_FLAG_SYNLOSSY) ? RDPUDP_MODE_LOSSY : RDPUDP_MODE_RELIABLE;
+	}
+	else if ((version != udp->version) &&
+	         ((version == RDPUDP_PROTOCOL_VERSION_3) || (udp->version != RDPUDP_PROTOCOL_VERSION_3)))
+	{
+		WLog_ERR(TAG, "server answered with protocol version 0x%04" PRIx16, version);
+		return FALSE;
+	}
+
+	udp->version = version;
+	udp->mtu = MIN(udp->mtu, MIN(upMtu, downMtu));
+	udp->remoteIsn = isn;
+	udp->rcvNxt = isn + 1;
+	udp->ackBase = isn;
+	udp->ackHighest = isn;
+	udp->ackStates[isn & (RDPUDP_ACK_STATES - 1)] = 1;
+	return TRUE;
+}
+
+static BOOL rdpudp_process(rdpUdp* udp, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(udp);
+
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticConstInit(&sbuffer, data, length);
+
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_FEC_HEADER_LEN))
+		return TRUE;
+
+	const UINT32 snSourceAck = Stream_Get_UINT32_BE(s);
+	const UINT16 window = Stream_Get_UINT16_BE(s);
+	const UINT16 flags = Stream_Get_UINT16_BE(s);
+
+	if (flags & RDPUDP_FLAG_SYN)
+	{
+		if (udp->server && !(flags & RDPUDP_FLAG_ACK))
+		{
+			if (udp->state == RDPUDP_STATE_INITIAL)
+			{
+				if (!rdpudp_read_syn(udp, s, flags))
+					return TRUE;
+				udp->state = RDPUDP_STATE_SYN_RECEIVED;
+			}
+
+			/* a repeated SYN means our SYN+ACK got lost */
+			if (udp->state == RDPUDP_STATE_SYN_RECEIVED)
+				return rdpudp_send_syn(udp);
+			return TRUE;
+		}
+
+		if (!udp->server && (flags & RDPUDP_FLAG_ACK) && (udp->state == RDPUDP_STATE_SYN_SENT))
+		{
+			if (snSourceAck != udp->localIsn)
+				return TRUE;
+			if (!rdpudp_read_syn(udp, s, flags))
+			{
+				udp->state = RDPUDP_STATE_FAILED;
+				return FALSE;
+			}
+
+			udp->peerWindow = window;
+			udp->state = RDPUDP_STATE_CONNECTED;
+			udp->lastReceive = GetTickCount64();
+			return rdpudp_send_datagram(udp, NULL);
+		}
+
+		return TRUE;
+	}
+
+	if (udp->state == RDPUDP_STATE_SYN_RECEIVED)
+	{
+		if (!(flags & RDPUDP_FLAG_ACK) || rdpudp_seq_lt(snSourceAck, udp->localIsn))
+			return TRUE;
+		udp->state = RDPUDP_STATE_CONNECTED;
+	}
+
+	if (udp->state != RDPUDP_STATE_CONNECTED)
+		return TRUE;
+
+	udp->lastReceive = GetTickCount64();
+	udp->peerWindow = window;
+
+	if (flags & RDPUDP_FLAG_FIN)
+	{
+		WLog_DBG(TAG, "peer closed the connection");
+		udp->state = RDPUDP_STATE_FAILED;
+		return FALSE;
+	}
+
+	if (flags & RDPUDP_FLAG_CN)
+	{
+		rdpudp_congestion_event(udp, udp->sndUna);
+		udp->sendCwr = TRUE;
+	}
+
+	if (flags & RDPUDP_FLAG_CWR)
+		udp->congested = FALSE;
+
+	if (flags & RDPUDP_FLAG_ACK)
+	{
+		if (!rdpudp_read_ack_vector(udp, s, snSourceAck))
+			return FALSE;
+	}
+
+	if (flags & RDPUDP_FLAG_AOA)
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_AOA_LEN))
+			return TRUE;
+
+		/* the peer is done with everything before, those states need not be reported */
+		const UINT32 aoa = Stream_Get_UINT32_BE(s);
+		if (rdpudp_seq_lt(udp->ackBase, aoa) && rdpudp_seq_leq(aoa, udp->ackHighest + 1))
+			udp->ackBase = aoa;
+	}
+
+	if (flags & (RDPUDP_FLAG_DATA | RDPUDP_FLAG_FEC))
+	{
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, RDPUDP_SOURCE_HEADER_LEN))
+			return TRUE;
+
+		const UINT32 coded = Stream_Get_UINT32_BE(s);
+		const UINT32 source = Stream_Get_UINT32_BE(s);
+
+		/* the ack states cannot describe a larger gap, the datagram is spoofed or corrupt */
+		if (!rdpudp_seq_lt(coded, udp->ackHighest + RDPUDP_ACK_STATES))
+			return TRUE;
+
+		/* FEC datagrams repair losses, we rely on retransmissions and only acknowledge them */
+		if (flags & RDPUDP_FLAG_FEC)
+			rdpudp_mark_received(udp, coded);
+		else if (!rdpudp_receive_data(udp, coded, source, Stream_Pointer(s),
+		                              Stream_GetRemainingLength(s)))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL rdpudp_receive(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	WSAResetEvent(udp->event);
+	for (;;)
+	{
+		BYTE buffer[RDPUDP_MTU * 2];
+		const int status = _recv(udp->sockfd, (char*)buffer, sizeof(buffer), 0);
+		if (status < 0)
+		{
+			const int error = WSAGetLastError();
+			if (error == WSAEWOULDBLOCK)
+				return TRUE;
+			/* a client SYN refused by ICMP means the server has no UDP listener */
+			if ((error == WSAECONNREFUSED) && (udp->state == RDPUDP_STATE_SYN_SENT))
+			{
+				WLog_WARN(TAG, "the server refused the UDP connection");
+				return FALSE;
+			}
+			/* an ICMP error of an earlier datagram, the peer might not be up yet */
+			if ((error == WSAEINTR) || (error == WSAECONNREFUSED))
+				continue;
+			WLog_ERR(TAG, "recv failed with error %d", error);
+			return FALSE;
+		}
+
+		if (!rdpudp_process(udp, buffer, (size_t)status))
+			return FALSE;
+	}
+}
+
+static BOOL rdpudp_check_timers(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	const UINT64 now = GetTickCount64();
+	if (now - udp->lastReceive > RDPUDP_TIMEOUT_MS)
+	{
+		WLog_ERR(TAG, "no datagram received for %" PRIu32 " ms", RDPUDP_TIMEOUT_MS);
+		return FALSE;
+	}
+
+	BOOL timedOut = FALSE;
+	const UINT32 rto = udp->rto;
+	for (UINT32 x = udp->sndUna; x != udp->sndNxt; x++)
+	{
+		rdpUdpSendSlot* slot = &udp->sendSlots[x % RDPUDP_WINDOW];
+		if (!slot->used || slot->acked || (now - slot->sent < rto))
+			continue;
+
+		if (!timedOut)
+		{
+			udp->ssthresh = MAX(udp->cwnd / 2, 2);
+			udp->cwnd = 2;
+			udp->cwndCount = 0;
+			udp->recover = udp->sndNxt;
+			udp->rto = MIN(udp->rto * 2, RDPUDP_RTO_MAX_MS);
+			timedOut = TRUE;
+		}
+
+		if (!rdpudp_lost(udp, slot))
+			return FALSE;
+	}
+	rdpudp_advance(udp);
+
+	if ((udp->ackUnsent >= RDPUDP_ACK_EVERY) ||
+	    (udp->ackSince && (now - udp->ackSince >= RDPUDP_ACK_DELAY_MS)) ||
+	    (now - udp->lastSend >= RDPUDP_KEEPALIVE_MS))
+		return rdpudp_send_datagram(udp, NULL);
+
+	return TRUE;
+}
+
+rdpUdp* rdpudp_new(int sockfd, BOOL server, RDPUDP_MODE mode, const BYTE* correlationId,
+                   const BYTE* cookieHash)
+{
+	rdpUdp* udp = (rdpUdp*)calloc(1, sizeof(rdpUdp));
+	if (!udp)
+		return NULL;
+
+	udp->sockfd = (SOCKET)sockfd;
+	udp->server = server;
+	udp->mode = mode;
+	udp->mtu = RDPUDP_MTU;
+	udp->version = cookieHash ? RDPUDP_PROTOCOL_VERSION_3 : RDPUDP_PROTOCOL_VERSION_2;
+	udp->cwnd = RDPUDP_INITIAL_CWND;
+	udp->ssthresh = RDPUDP_WINDOW;
+	udp->peerWindow = RDPUDP_WINDOW;
+	udp->rto = RDPUDP_RTO_INITIAL_MS;
+
+	if (correlationId)
+	{
+		memcpy(udp->correlationId, correlationId, sizeof(udp->correlationId));
+		udp->hasCorrelationId = TRUE;
+	}
+
+	if (cookieHash)
+	{
+		memcpy(udp->cookieHash, cookieHash, sizeof(udp->cookieHash));
+		udp->hasCookieHash = TRUE;
+	}
+
+	if (winpr_RAND(&udp->localIsn, sizeof(udp->localIsn)) < 0)
+		goto fail;
+	udp->sndUna = udp->sndNxt = udp->recover = udp->localIsn + 1;
+
+	udp->sendSlots = (rdpUdpSendSlot*)calloc(RDPUDP_WINDOW, sizeof(rdpUdpSendSlot));
+	udp->recvSlots = (rdpUdpRecvSlot*)calloc(RDPUDP_WINDOW, sizeof(rdpUdpRecvSlot));
+	udp->ackStates = (BYTE*)calloc(RDPUDP_ACK_STATES, sizeof(BYTE));
+	if (!udp->sendSlots || !udp->recvSlots || !udp->ackStates)
+		goto fail;
+
+	if (!ringbuffer_init(&udp->received, 64 * 1024))
+		goto fail;
+
+	udp->event = WSACreateEvent();
+	if (!udp->event)
+		goto fail;
+
+	/* WSAEventSelect automatically sets the socket in non-blocking mode */
+	if (WSAEventSelect(udp->sockfd, udp->event, FD_READ) != 0)
+		goto fail;
+
+	return udp;
+fail:
+	WLog_ERR(TAG, "failed to create the RDP-UDP connection");
+	udp->sockfd = INVALID_SOCKET;
+	rdpudp_free(udp);
+	return NULL;
+}
+
+void rdpudp_free(rdpUdp* udp)
+{
+	if (!udp)
+		return;
+
+	if (udp->state == RDPUDP_STATE_CONNECTED)
+	{
+		BYTE buffer[RDPUDP_FEC_HEADER_LEN] = { 0 };
+		wStream sbuffer = { 0 };
+		wStream* s = Stream_StaticInit(&sbuffer, buffer, sizeof(buffer));
+		rdpudp_write_fec_header(udp, s, udp->ackHighest, RDPUDP_FLAG_FIN);
+		(void)rdpudp_send_raw(udp, buffer, sizeof(buffer));
+	}
+
+	if (udp->event)
+		(void)WSACloseEvent(udp->event);
+	if (udp->sockfd != INVALID_SOCKET)
+		closesocket(udp->sockfd);
+
+	ringbuffer_destroy(&udp->received);
+	free(udp->sendSlots);
+	free(udp->recvSlots);
+	free(udp->ackStates);
+	free(udp);
+}
+
+BOOL rdpudp_connect(rdpUdp* udp, DWORD timeout)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->state != RDPUDP_STATE_INITIAL)
+		return FALSE;
+
+	const UINT64 start = GetTickCount64();
+	UINT64 nextSyn = start;
+
+	while (udp->state != RDPUDP_STATE_CONNECTED)
+	{
+		const UINT64 now = GetTickCount64();
+		if (now - start >= timeout)
+		{
+			WLog_ERR(TAG, "RDP-UDP handshake timed out after %" PRIu32 " ms", timeout);
+			return FALSE;
+		}
+
+		/* the server waits for the SYN and repeats its SYN+ACK until the ACK arrives */
+		if ((!udp->server || (udp->state == RDPUDP_STATE_SYN_RECEIVED)) && (now >= nextSyn))
+		{
+			if (!rdpudp_send_syn(udp))
+				return FALSE;
+			if (!udp->server)
+				udp->state = RDPUDP_STATE_SYN_SENT;
+			nextSyn = now + RDPUDP_SYN_INTERVAL_MS;
+		}
+
+		UINT64 wait = MIN(start + timeout, nextSyn);
+		if (udp->server && (udp->state == RDPUDP_STATE_INITIAL))
+			wait = start + timeout;
+		const DWORD status = WaitForSingleObject(udp->event, (DWORD)(wait > now ? wait - now : 0));
+		if (status == WAIT_FAILED)
+			return FALSE;
+
+		if (!rdpudp_receive(udp))
+			return FALSE;
+		if (udp->state == RDPUDP_STATE_FAILED)
+			return FALSE;
+	}
+
+	udp->lastReceive = GetTickCount64();
+	WLog_DBG(TAG, "RDP-UDP %s connection established, version 0x%04" PRIx16 ", MTU %" PRIu16,
+	         (udp->mode == RDPUDP_MODE_LOSSY) ? "lossy" : "reliable", udp->version, udp->mtu);
+	return TRUE;
+}
+
+HANDLE rdpudp_get_event(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return udp->event;
+}
+
+DWORD rdpudp_get_timeout(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	const UINT64 now = GetTickCount64();
+	UINT64 due = udp->lastSend + RDPUDP_KEEPALIVE_MS;
+
+	if (udp->ackUnsent >= RDPUDP_ACK_EVERY)
+		due = now;
+	else if (udp->ackSince)
+		due = MIN(due, udp->ackSince + RDPUDP_ACK_DELAY_MS);
+
+	for (UINT32 x = udp->sndUna; x != udp->sndNxt; x++)
+	{
+		const rdpUdpSendSlot* slot = &udp->sendSlots[x % RDPUDP_WINDOW];
+		if (slot->used && !slot->acked)
+			due = MIN(due, slot->sent + udp->rto);
+	}
+
+	return (due > now) ? (DWORD)(due - now) : 0;
+}
+
+BOOL rdpudp_check(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->state != RDPUDP_STATE_CONNECTED)
+		return FALSE;
+
+	if (!rdpudp_receive(udp) || (udp->state != RDPUDP_STATE_CONNECTED) ||
+	    !rdpudp_check_timers(udp))
+	{
+		udp->state = RDPUDP_STATE_FAILED;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL rdpudp_can_send(const rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	const UINT32 inflight = udp->sndNxt - udp->sndUna;
+	const UINT32 window = MIN(MIN(udp->cwnd, MAX(udp->peerWindow, 1)), RDPUDP_WINDOW);
+	return inflight < window;
+}
+
+int rdpudp_write(rdpUdp* udp, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(data || (length == 0));
+
+	if (udp->state != RDPUDP_STATE_CONNECTED)
+		return -1;
+
+	const size_t max = rdpudp_get_max_payload(udp);
+	if ((udp->mode == RDPUDP_MODE_LOSSY) && (length > max))
+	{
+		WLog_ERR(TAG, "datagram of %" PRIuz " bytes exceeds the maximum of %" PRIuz, length,
+		         max);
+		return -1;
+	}
+
+	length = MIN(length, INT32_MAX);
+	size_t taken = 0;
+	while ((taken < length) && rdpudp_can_send(udp))
+	{
+		rdpUdpSendSlot* slot = &udp->sendSlots[udp->sndNxt % RDPUDP_WINDOW];
+		WINPR_ASSERT(!slot->used);
+
+		slot->length = MIN(max, length - taken);
+		memcpy(slot->data, &data[taken], slot->length);
+		slot->seq = udp->sndNxt++;
+		slot->used = TRUE;
+		slot->acked = FALSE;
+		slot->missing = 0;
+		slot->transmissions = 1;
+		slot->sent = GetTickCount64();
+		taken += slot->length;
+
+		if (!rdpudp_send_datagram(udp, slot))
+		{
+			udp->state = RDPUDP_STATE_FAILED;
+			return -1;
+		}
+	}
+
+	return (int)taken;
+}
+
+int rdpudp_read(rdpUdp* udp, BYTE* data, size_t length)
+{
+	WINPR_ASSERT(udp);
+	WINPR_ASSERT(data || (length == 0));
+
+	if (udp->mode == RDPUDP_MODE_LOSSY)
+	{
+		if (udp->lossyCount == 0)
+			return (udp->state == RDPUDP_STATE_CONNECTED) ? 0 : -1;
+
+		rdpUdpRecvSlot* slot = &udp->recvSlots[udp->lossyHead];
+		if (slot->length > length)
+			return -1;
+
+		const size_t size = slot->length;
+		memcpy(data, slot->data, size);
+		slot->used = FALSE;
+		udp->lossyHead = (udp->lossyHead + 1) % RDPUDP_WINDOW;
+		udp->lossyCount--;
+		return (int)size;
+	}
+
+	const size_t used = ringbuffer_used(&udp->received);
+	if (used == 0)
+		return (udp->state == RDPUDP_STATE_CONNECTED) ? 0 : -1;
+
+	DataChunk chunks[2] = { 0 };
+	const size_t size = MIN(MIN(used, length), INT32_MAX);
+	const int count = ringbuffer_peek(&udp->received, chunks, size);
+
+	size_t offset = 0;
+	for (int x = 0; x < count; x++)
+	{
+		memcpy(&data[offset], chunks[x].data, chunks[x].size);
+		offset += chunks[x].size;
+	}
+	ringbuffer_commit_read_bytes(&udp->received, offset);
+	return (int)offset;
+}
+
+size_t rdpudp_get_max_payload(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return udp->mtu - RDPUDP_OVERHEAD;
+}
+
+UINT32 rdpudp_get_rtt(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return udp->rttValid ? udp->srtt : 0;
+}
+
+const BYTE* rdpudp_get_cookie_hash(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+	return udp->hasCookieHash ? udp->cookieHash : NULL;
+}
+
+static size_t rdpudp_get_pending(rdpUdp* udp)
+{
+	WINPR_ASSERT(udp);
+
+	if (udp->mode == RDPUDP_MODE_LOSSY)
+		return (udp->lossyCount > 0) ? udp->recvSlots[udp->lossyHead].length : 0;
+	return ringbuffer_used(&udp->received);
+}
+
+static int bio_rdpudp_write(BIO* bio, const char* buf, int size)
+{
+	rdpUdp* udp = (rdpUdp*)BIO_get_data(bio);
+
+	BIO_clear_flags(bio, BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY);
+	if (!udp || !buf || (size < 0))
+		return -1;
+
+	const int status = rdpudp_write(udp, (const BYTE*)buf, (size_t)size);
+	if ((status == 0) && (size > 0))
+	{
+		BIO_set_flags(bio, BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY);
+		return -1;
+	}
+
+	return status;
+}
+
+static int bio_rdpudp_read(BIO* bio, char* buf, int size)
+{
+	rdpUdp* udp = (rdpUdp*)BIO_get_data(bio);
+
+	BIO_clear_flags(bio, BIO_FLAGS_READ | BIO_FLAGS_SHOULD_RETRY);
+	if (!udp || !buf || (size < 0))
+		return -1;
+
+	const int status = rdpudp_read(udp, (BYTE*)buf, (size_t)size);
+	if (status == 0)
+	{
+		BIO_set_flags(bio, BIO_FLAGS_READ | BIO_FLAGS_SHOULD_RETRY);
+		return -1;
+	}
+
+	return status;
+}
+
+static int bio_rdpudp_puts(BIO* bio, const char* str)
+{
+	if (!str)
+		return 0;
+	return bio_rdpudp_write(bio, str, (int)MIN(strnlen(str, INT32_MAX), INT32_MAX));
+}
+
+static long bio_rdpudp_ctrl(BIO* bio, int cmd, long arg1, void* arg2)
+{
+	rdpUdp* udp = (rdpUdp*)BIO_get_data(bio);
+
+	WINPR_UNUSED(arg2);
+	if (!udp)
+		return 0;
+
+	switch (cmd)
+	{
+		case BIO_CTRL_FLUSH:
+		case BIO_CTRL_DGRAM_SET_CONNECTED:
+			return 1;
+
+		case BIO_CTRL_PENDING:
+			return (long)MIN(rdpudp_get_pending(udp), LONG_MAX);
+
+		case BIO_CTRL_WPENDING:
+			return 0;
+
+		case BIO_CTRL_DGRAM_QUERY_MTU:
+		case BIO_CTRL_DGRAM_GET_FALLBACK_MTU:
+		case BIO_CTRL_DGRAM_GET_MTU:
+			return (long)rdpudp_get_max_payload(udp);
+
+		case BIO_CTRL_DGRAM_SET_MTU:
+			return arg1;
+
+		default:
+			return 0;
+	}
+}
+
+static int bio_rdpudp_new(BIO* bio)
+{
+	BIO_set_init(bio, 1);
+	BIO_set_flags(bio, BIO_FLAGS_SHOULD_RETRY);
+	return 1;
+}
+
+static int bio_rdpudp_free(BIO* bio)
+{
+	if (!bio)
+		return 0;
+
+	BIO_set_data(bio, NULL);
+	return 1;
+}
+
+BIO_METHOD* BIO_s_rdpudp(void)
+{
+	static BIO_METHOD* bio_methods = NULL;
+
+	if (bio_methods == NULL)
+	{
+		if (!(bio_methods = BIO_meth_new(BIO_TYPE_RDPUDP, "RdpUdp")))
+			return NULL;
+
+		BIO_meth_set_write(bio_methods, bio_rdpudp_write);
+		BIO_meth_set_read(bio_methods, bio_rdpudp_read);
+		BIO_meth_set_puts(bio_methods, bio_rdpudp_puts);
+		BIO_meth_set_ctrl(bio_methods, bio_rdpudp_ctrl);
+		BIO_meth_set_create(bio_methods, bio_rdpudp_new);
+		BIO_meth_set_destroy(bio_methods, bio_rdpudp_free);
+	}
+
+	return bio_methods;
+}
@@ -0,0 +1,94 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * UDP Transport Extension (MS-RDPEUDP)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_RDPUDP_H
+#define FREERDP_LIB_CORE_RDPUDP_H
+
+#include <openssl/bio.h>
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+
+typedef struct rdp_udp rdpUdp;
+
+typedef enum
+{
+	RDPUDP_MODE_RELIABLE,
+	RDPUDP_MODE_LOSSY
+} RDPUDP_MODE;
+
+#define RDPUDP_CORRELATION_ID_LEN 16
+#define RDPUDP_COOKIE_HASH_LEN 32
+
+#define BIO_TYPE_RDPUDP 80
+
+FREERDP_LOCAL void rdpudp_free(rdpUdp* udp);
+
+/**
+ * @brief rdpudp_new Creates an RDP-UDP connection on a connected datagram socket.
+ *
+ * @param sockfd The socket, owned by the connection if it was created
+ * @param server TRUE to accept the SYN of a client, FALSE to send it
+ * @param mode Reliable (RDPEUDP-R) or lossy (RDPEUDP-L) delivery
+ * @param correlationId The 16 byte correlation id of the client SYN, may be NULL
+ * @param cookieHash The SHA-256 of the multitransport cookie for protocol version 3, may be NULL
+ * @return The new connection or NULL
+ */
+WINPR_ATTR_MALLOC(rdpudp_free, 1)
+FREERDP_LOCAL rdpUdp* rdpudp_new(int sockfd, BOOL server, RDPUDP_MODE mode,
+                                 const BYTE* correlationId, const BYTE* cookieHash);
+
+/* Runs the SYN, SYN+ACK, ACK handshake, waits at most timeout ms */
+FREERDP_LOCAL BOOL rdpudp_connect(rdpUdp* udp, DWORD timeout);
+
+FREERDP_LOCAL HANDLE rdpudp_get_event(rdpUdp* udp);
+
+/* The time in ms until rdpudp_check must run again for retransmissions and acks */
+FREERDP_LOCAL DWORD rdpudp_get_timeout(rdpUdp* udp);
+
+/* Processes the received datagrams and the timers, FALSE if the connection is lost */
+FREERDP_LOCAL BOOL rdpudp_check(rdpUdp* udp);
+
+/**
+ * @brief rdpudp_write Sends data, the reliable mode splits it into datagrams, the lossy mode
+ * sends it as one.
+ *
+ * @return The number of bytes taken, 0 if the send window is full, -1 on error
+ */
+FREERDP_LOCAL int rdpudp_write(rdpUdp* udp, const BYTE* data, size_t length);
+
+/**
+ * @brief rdpudp_read Reads received data, in order for the reliable mode, one datagram at a
+ * time in the order of arrival for the lossy mode.
+ *
+ * @return The number of bytes read, 0 if nothing is pending, -1 on error
+ */
+FREERDP_LOCAL int rdpudp_read(rdpUdp* udp, BYTE* data, size_t length);
+
+/* The largest payload of a single datagram */
+FREERDP_LOCAL size_t rdpudp_get_max_payload(rdpUdp* udp);
+
+FREERDP_LOCAL UINT32 rdpudp_get_rtt(rdpUdp* udp);
+
+/* Only valid on the server side after the handshake, NULL if the client sent no hash */
+FREERDP_LOCAL const BYTE* rdpudp_get_cookie_hash(rdpUdp* udp);
+
+/* A BIO on top of the connection for TLS (reliable) and DTLS (lossy), does not own it */
+FREERDP_LOCAL BIO_METHOD* BIO_s_rdpudp(void);
+
+#endif /* FREERDP_LIB_CORE_RDPUDP_H */
@@ -27,6 +27,7 @@
 
 #include <winpr/crt.h>
 #include <winpr/synch.h>
+#include <winpr/interlocked.h>
 #include <winpr/stream.h>
 
 #include <freerdp/log.h>
@@ -50,6 +51,8 @@
 #endif
 
 #define DVC_MAX_DATA_PDU_SIZE 1600
+/* cmd, channelId and length, each up to 4 bytes */
+#define DVC_MAX_HEADER_SIZE 9
 
 typedef struct
 {
@@ -59,6 +62,23 @@ typedef struct
 	UINT32 offset;
 } wtsChannelMessage;
 
+/* Payload of a channel write, shared by all PDUs it is split into */
+typedef struct
+{
+	LONG refCount;
+	wStream* s;
+} wtsSendBuffer;
+
+/* A single PDU in the send queue, a slice of the payload with an optional DVC header */
+typedef struct
+{
+	wtsSendBuffer* buffer;
+	const BYTE* data;
+	UINT32 length;
+	BYTE header[DVC_MAX_HEADER_SIZE];
+	UINT32 headerLength;
+} wtsSendItem;
+
 static DWORD g_SessionId = 1;
 static wHashTable* g_ServerHandles = NULL;
 
@@ -87,18 +107,107 @@ static BOOL wts_queue_receive_data(rdpPeerChannel* channel, const BYTE* Buffer,
 	return MessageQueue_Post(channel->queue, messageCtx, 0, NULL, NULL);
 }
 
-static BOOL wts_queue_send_item(rdpPeerChannel* channel, BYTE* Buffer, UINT32 Length)
+/* Streams handed to the send queue may be taken from a StreamPool */
+static void wts_send_stream_free(wStream* s)
+{
+	if (!s)
+		return;
+
+	if (s->pool)
+		Stream_Release(s);
+	else
+		Stream_Free(s, TRUE);
+}
+
+/* Takes ownership of the stream */
+static wtsSendBuffer* wts_send_buffer_new(wStream* s)
+{
+	WINPR_ASSERT(s);
+
+	wtsSendBuffer* buffer = (wtsSendBuffer*)calloc(1, sizeof(wtsSendBuffer));
+
+	if (!buffer)
+		return NULL;
+
+	buffer->refCount = 1;
+	buffer->s = s;
+	return buffer;
+}
+
+static void wts_send_buffer_unref(wtsSendBuffer* buffer)
+{
+	if (!buffer)
+		return;
+
+	if (InterlockedDecrement(&buffer->refCount) > 0)
+		return;
+
+	wts_send_stream_free(buffer->s);
+	free(buffer);
+}
+
+static void wts_send_item_free(wtsSendItem* item)
+{
+	if (!item)
+		return;
+
+	wts_send_buffer_unref(item->buffer);
+	free(item);
+}
+
+static BOOL wts_queue_send_slice(rdpPeerChannel* channel, wtsSendBuffer* buffer,
+                                 const BYTE* header, UINT32 headerLength, const BYTE* data,
+                                 UINT32 length)
 {
-	BYTE* buffer = NULL;
-	UINT32 length = 0;
-	UINT16 channelId = 0;
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(channel->vcm);
-	buffer = Buffer;
-	length = Length;
-	channelId = channel->channelId;
-	return MessageQueue_Post(channel->vcm->queue, (void*)(UINT_PTR)channelId, 0, (void*)buffer,
-	                         (void*)(UINT_PTR)length);
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(headerLength <= DVC_MAX_HEADER_SIZE);
+
+	wtsSendItem* item = (wtsSendItem*)calloc(1, sizeof(wtsSendItem));
+
+	if (!item)
+		return FALSE;
+
+	(void)InterlockedIncrement(&buffer->refCount);
+	item->buffer = buffer;
+	item->data = data;
+	item->length = length;
+	if (headerLength > 0)
+		CopyMemory(item->header, header, headerLength);
+	item->headerLength = headerLength;
+
+	const UINT16 channelId = channel->channelId;
+	if (!MessageQueue_Post(channel->vcm->queue, (void*)(UINT_PTR)channelId, 0, item, NULL))
+	{
+		wts_send_item_free(item);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Takes ownership of a malloc'ed PDU */
+static BOOL wts_queue_send_item(rdpPeerChannel* channel, BYTE* Buffer, UINT32 Length)
+{
+	wStream* s = Stream_New(Buffer, Length);
+
+	if (!s)
+	{
+		free(Buffer);
+		return FALSE;
+	}
+
+	wtsSendBuffer* buffer = wts_send_buffer_new(s);
+
+	if (!buffer)
+	{
+		Stream_Free(s, TRUE);
+		return FALSE;
+	}
+
+	const BOOL rc = wts_queue_send_slice(channel, buffer, NULL, 0, Buffer, Length);
+	wts_send_buffer_unref(buffer);
+	return rc;
 }
 
 static int wts_read_variable_uint(wStream* s, int cbLen, UINT32* val)
@@ -134,17 +243,19 @@ static int wts_read_variable_uint(wStream* s, int cbLen, UINT32* val)
 	}
 }
 
-static BOOL wts_read_drdynvc_capabilities_response(rdpPeerChannel* channel, UINT32 length)
+static BOOL wts_read_drdynvc_capabilities_response(rdpPeerChannel* channel, wStream* s,
+                                                   UINT32 length)
 {
 	UINT16 Version = 0;
 
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(channel->vcm);
+	WINPR_ASSERT(s);
 	if (length < 3)
 		return FALSE;
 
-	Stream_Seek_UINT8(channel->receiveData); /* Pad (1 byte) */
-	Stream_Read_UINT16(channel->receiveData, Version);
+	Stream_Seek_UINT8(s); /* Pad (1 byte) */
+	Stream_Read_UINT16(s, Version);
 	DEBUG_DVC("Version: %" PRIu16 "", Version);
 
 	if (Version < 1)
@@ -156,8 +267,8 @@ static BOOL wts_read_drdynvc_capabilities_response(rdpPeerChannel* channel, UINT
 	WTSVirtualChannelManager* vcm = channel->vcm;
 	vcm->drdynvc_state = DRDYNVC_STATE_READY;
 
-	/* we only support version 1 for now (no compression yet) */
-	vcm->dvc_spoken_version = MAX(Version, 1);
+	/* dvc_spoken_version holds the version we offered, never speak a newer one */
+	vcm->dvc_spoken_version = MIN(Version, vcm->dvc_spoken_version);
 
 	return SetEvent(MessageQueue_Event(vcm->queue));
 }
@@ -262,7 +373,7 @@ static void wts_read_drdynvc_close_response(rdpPeerChannel* channel)
 	MessageQueue_PostQuit(channel->queue, 0);
 }
 
-static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
+static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel, wStream* s)
 {
 	UINT32 length = 0;
 	UINT8 value = 0;
@@ -274,21 +385,21 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 
 	WINPR_ASSERT(channel);
 	WINPR_ASSERT(channel->vcm);
+	WINPR_ASSERT(s);
 
-	length = Stream_GetPosition(channel->receiveData);
+	length = (UINT32)Stream_GetRemainingLength(s);
 
 	if (length < 1)
 		return FALSE;
 
-	Stream_SetPosition(channel->receiveData, 0);
-	Stream_Read_UINT8(channel->receiveData, value);
+	Stream_Read_UINT8(s, value);
 	length--;
 	Cmd = (value & 0xf0) >> 4;
 	Sp = (value & 0x0c) >> 2;
 	cbChId = (value & 0x03) >> 0;
 
 	if (Cmd == CAPABILITY_REQUEST_PDU)
-		return wts_read_drdynvc_capabilities_response(channel, length);
+		return wts_read_drdynvc_capabilities_response(channel, s, length);
 
 	if (channel->vcm->drdynvc_state == DRDYNVC_STATE_READY)
 	{
@@ -306,7 +417,7 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 
 		if (haveChannelId)
 		{
-			value = wts_read_variable_uint(channel->receiveData, cbChId, &ChannelId);
+			value = wts_read_variable_uint(s, cbChId, &ChannelId);
 			if (value == 0)
 				return FALSE;
 
@@ -325,7 +436,7 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 		switch (Cmd)
 		{
 			case CREATE_REQUEST_PDU:
-				return wts_read_drdynvc_create_response(dvc, channel->receiveData, length);
+				return wts_read_drdynvc_create_response(dvc, s, length);
 
 			case DATA_FIRST_PDU:
 				if (dvc->dvc_open_state != DVC_OPEN_STATE_SUCCEEDED)
@@ -337,7 +448,7 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 					return TRUE;
 				}
 
-				return wts_read_drdynvc_data_first(dvc, channel->receiveData, Sp, length);
+				return wts_read_drdynvc_data_first(dvc, s, Sp, length);
 
 			case DATA_PDU:
 				if (dvc->dvc_open_state != DVC_OPEN_STATE_SUCCEEDED)
@@ -349,7 +460,7 @@ static BOOL wts_read_drdynvc_pdu(rdpPeerChannel* channel)
 					return TRUE;
 				}
 
-				return wts_read_drdynvc_data(dvc, channel->receiveData, length);
+				return wts_read_drdynvc_data(dvc, s, length);
 
 			case CLOSE_REQUEST_PDU:
 				wts_read_drdynvc_close_response(dvc);
@@ -436,6 +547,24 @@ static BOOL wts_write_drdynvc_create_request(wStream* s, UINT32 ChannelId, const
 	return TRUE;
 }
 
+static BOOL wts_process_channel_pdu(rdpPeerChannel* channel, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->vcm);
+
+	if (length > UINT32_MAX)
+		return FALSE;
+
+	if (channel == channel->vcm->drdynvc_channel)
+	{
+		wStream sbuffer = { 0 };
+		wStream* s = Stream_StaticConstInit(&sbuffer, data, length);
+		return wts_read_drdynvc_pdu(channel, s);
+	}
+
+	return wts_queue_receive_data(channel, data, (UINT32)length);
+}
+
 static BOOL WTSProcessChannelData(rdpPeerChannel* channel, UINT16 channelId, const BYTE* data,
                                   size_t s, UINT32 flags, size_t t)
 {
@@ -447,6 +576,18 @@ static BOOL WTSProcessChannelData(rdpPeerChannel* channel, UINT16 channelId, con
 	WINPR_ASSERT(channel->vcm);
 	WINPR_UNUSED(channelId);
 
+	/* A complete PDU in a single chunk is processed in place, without collecting it first */
+	if ((flags & CHANNEL_FLAG_FIRST) && (flags & CHANNEL_FLAG_LAST))
+	{
+		if (size != totalSize)
+		{
+			WLog_ERR(TAG, "read error");
+		}
+
+		Stream_SetPosition(channel->receiveData, 0);
+		return wts_process_channel_pdu(channel, data, size);
+	}
+
 	if (flags & CHANNEL_FLAG_FIRST)
 	{
 		Stream_SetPosition(channel->receiveData, 0);
@@ -464,16 +605,8 @@ static BOOL WTSProcessChannelData(rdpPeerChannel* channel, UINT16 channelId, con
 			WLog_ERR(TAG, "read error");
 		}
 
-		if (channel == channel->vcm->drdynvc_channel)
-		{
-			ret = wts_read_drdynvc_pdu(channel);
-		}
-		else
-		{
-			ret = wts_queue_receive_data(channel, Stream_Buffer(channel->receiveData),
-			                             Stream_GetPosition(channel->receiveData));
-		}
-
+		ret = wts_process_channel_pdu(channel, Stream_Buffer(channel->receiveData),
+		                              Stream_GetPosition(channel->receiveData));
 		Stream_SetPosition(channel->receiveData, 0);
 	}
 
@@ -565,13 +698,24 @@ BOOL WTSVirtualChannelManagerOpen(HANDLE hServer)
 			wStream staticS;
 			wStream* s = Stream_StaticInit(&staticS, capaBuffer, sizeof(capaBuffer));
 
+			/* version 3 allows sending compressed data PDUs. Older FreeRDP clients answer
+			 * with version 3 without understanding them, so this is opt in. */
+			const BOOL compress =
+			    freerdp_settings_get_bool(vcm->rdp->settings, FreeRDP_DynamicChannelCompression);
+
 			vcm->drdynvc_channel = channel;
-			vcm->dvc_spoken_version = 1;
-			Stream_Write_UINT8(s, 0x50);    /* Cmd=5 sp=0 cbId=0 */
-			Stream_Write_UINT8(s, 0x00);    /* Pad */
-			Stream_Write_UINT16(s, 0x0001); /* Version */
+			vcm->dvc_spoken_version = compress ? 3 : 1;
+			Stream_Write_UINT8(s, 0x50);                     /* Cmd=5 sp=0 cbId=0 */
+			Stream_Write_UINT8(s, 0x00);                     /* Pad */
+			Stream_Write_UINT16(s, vcm->dvc_spoken_version); /* Version */
 
-			/* TODO: shall implement version 2 and 3 */
+			if (vcm->dvc_spoken_version >= 2)
+			{
+				Stream_Write_UINT16(s, 936);   /* PriorityCharge0 */
+				Stream_Write_UINT16(s, 3276);  /* PriorityCharge1 */
+				Stream_Write_UINT16(s, 9362);  /* PriorityCharge2 */
+				Stream_Write_UINT16(s, 18724); /* PriorityCharge3 */
+			}
 
 			ULONG written = 0;
 			if (!WTSVirtualChannelWrite(channel, (PCHAR)capaBuffer, Stream_GetPosition(s),
@@ -600,14 +744,27 @@ BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen
 			return FALSE;
 	}
 
+	/* A dynamic channel frame is queued as many small PDUs, send it in few TLS records */
+	WINPR_ASSERT(vcm->rdp);
+	const BOOL corked = transport_cork(vcm->rdp->transport);
+
 	while (MessageQueue_Peek(vcm->queue, &message, TRUE))
 	{
-		BYTE* buffer = NULL;
-		UINT32 length = 0;
-		UINT16 channelId = 0;
-		channelId = (UINT16)(UINT_PTR)message.context;
-		buffer = (BYTE*)message.wParam;
-		length = (UINT32)(UINT_PTR)message.lParam;
+		const UINT16 channelId = (UINT16)(UINT_PTR)message.context;
+		wtsSendItem* item = (wtsSendItem*)message.wParam;
+		const BYTE* buffer = item->data;
+		UINT32 length = item->length;
+		BYTE pdu[DVC_MAX_DATA_PDU_SIZE];
+
+		/* DVC PDUs are small, join header and payload slice right before sending */
+		if (item->headerLength > 0)
+		{
+			WINPR_ASSERT(item->headerLength + length <= sizeof(pdu));
+			CopyMemory(pdu, item->header, item->headerLength);
+			CopyMemory(&pdu[item->headerLength], item->data, length);
+			buffer = pdu;
+			length += item->headerLength;
+		}
 
 		WINPR_ASSERT(vcm->client);
 		WINPR_ASSERT(vcm->client->SendChannelData);
@@ -616,12 +773,14 @@ BOOL WTSVirtualChannelManagerCheckFileDescriptorEx(HANDLE hServer, BOOL autoOpen
 			status = FALSE;
 		}
 
-		free(buffer);
+		wts_send_item_free(item);
 
 		if (!status)
 			break;
 	}
 
+	if (corked && !transport_uncork(vcm->rdp->transport))
+		status = FALSE;
 	return status;
 }
 
@@ -930,12 +1089,7 @@ static void wts_virtual_channel_manager_free_message(void* obj)
 	wMessage* msg = (wMessage*)obj;
 
 	if (msg)
-	{
-		BYTE* buffer = (BYTE*)msg->wParam;
-
-		if (buffer)
-			free(buffer);
-	}
+		wts_send_item_free((wtsSendItem*)msg->wParam);
 }
 
 static void channel_free(rdpPeerChannel* channel)
@@ -1526,101 +1680,239 @@ BOOL WINAPI FreeRDP_WTSVirtualChannelRead(HANDLE hChannelHandle, ULONG TimeOut,
 	return TRUE;
 }
 
-BOOL WINAPI FreeRDP_WTSVirtualChannelWrite(HANDLE hChannelHandle, PCHAR Buffer, ULONG Length,
-                                           PULONG pBytesWritten)
+static BOOL wts_channel_use_compression(rdpPeerChannel* channel)
 {
-	wStream* s = NULL;
-	int cbLen = 0;
-	int cbChId = 0;
-	int first = 0;
-	BYTE* buffer = NULL;
-	UINT32 length = 0;
-	UINT32 written = 0;
-	UINT32 totalWritten = 0;
-	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
-	BOOL ret = FALSE;
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->vcm);
 
-	if (!channel)
+	if (channel->vcm->dvc_spoken_version < 3)
 		return FALSE;
 
-	EnterCriticalSection(&channel->writeLock);
-	WINPR_ASSERT(channel->vcm);
-	if (channel->channelType == RDP_PEER_CHANNEL_TYPE_SVC)
+	if (!channel->zgfx)
 	{
-		length = Length;
-		buffer = (BYTE*)malloc(length);
+		channel->zgfx = zgfx_context_new(TRUE);
+		if (!channel->zgfx)
+		{
+			WLog_WARN(TAG, "zgfx_context_new failed, sending %s uncompressed",
+			          channel->channelName);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
 
-		if (!buffer)
+/**
+ * Sends a DVC message as DYNVC_DATA_FIRST_COMPRESSED / DYNVC_DATA_COMPRESSED PDUs.
+ * Every PDU carries a single RDP8 bulk compressed segment, sized so the PDU still fits
+ * DVC_MAX_DATA_PDU_SIZE if the segment has to be sent uncompressed.
+ */
+static BOOL wts_write_compressed_dvc(rdpPeerChannel* channel, const BYTE* Buffer, UINT32 Length)
+{
+	BOOL first = TRUE;
+
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->zgfx);
+
+	while (Length > 0)
+	{
+		int cbLen = 0;
+		UINT32 flags = 0;
+		wStream* s = Stream_New(NULL, DVC_MAX_DATA_PDU_SIZE);
+
+		if (!s)
 		{
+			WLog_ERR(TAG, "Stream_New failed!");
 			SetLastError(E_OUTOFMEMORY);
-			goto fail;
+			return FALSE;
 		}
 
-		CopyMemory(buffer, Buffer, length);
-		totalWritten = Length;
-		if (!wts_queue_send_item(channel, buffer, length))
-			goto fail;
-	}
-	else if (!channel->vcm->drdynvc_channel || (channel->vcm->drdynvc_state != DRDYNVC_STATE_READY))
-	{
-		DEBUG_DVC("drdynvc not ready");
-		goto fail;
+		Stream_Seek_UINT8(s);
+		const int cbChId = wts_write_variable_uint(s, channel->channelId);
+		BYTE cmd = DATA_COMPRESSED_PDU;
+
+		/* descriptor and segment header */
+		const size_t overhead = 2;
+		if (first && (Length > Stream_GetRemainingLength(s) - overhead))
+		{
+			cbLen = wts_write_variable_uint(s, Length);
+			cmd = DATA_FIRST_COMPRESSED_PDU;
+		}
+
+		UINT32 written = (UINT32)(Stream_GetRemainingLength(s) - overhead);
+		if (written > Length)
+			written = Length;
+
+		if (zgfx_compress_to_stream(channel->zgfx, s, Buffer, written, &flags) < 0)
+		{
+			Stream_Free(s, TRUE);
+			return FALSE;
+		}
+
+		BYTE* buffer = Stream_Buffer(s);
+		buffer[0] = (BYTE)((cmd << 4) | (cbLen << 2) | cbChId);
+
+		const size_t length = Stream_GetPosition(s);
+		Stream_Free(s, FALSE);
+		first = FALSE;
+		Length -= written;
+		Buffer += written;
+		if (!wts_queue_send_item(channel->vcm->drdynvc_channel, buffer, (UINT32)length))
+			return FALSE;
 	}
-	else
+
+	return TRUE;
+}
+
+/**
+ * Queues DYNVC_DATA_FIRST / DYNVC_DATA PDUs for a DVC message. The PDUs only reference slices
+ * of the shared payload, the header is kept with the queue item.
+ */
+static BOOL wts_write_dvc_slices(rdpPeerChannel* channel, wtsSendBuffer* buffer, const BYTE* Buffer,
+                                 UINT32 Length)
+{
+	BOOL first = TRUE;
+
+	WINPR_ASSERT(channel);
+
+	while (Length > 0)
 	{
-		rdpContext* context = NULL;
+		int cbLen = 0;
+		BYTE header[DVC_MAX_HEADER_SIZE] = { 0 };
+		wStream sbuffer = { 0 };
+		wStream* s = Stream_StaticInit(&sbuffer, header, sizeof(header));
+
+		Stream_Seek_UINT8(s);
+		const int cbChId = wts_write_variable_uint(s, channel->channelId);
 
-		first = TRUE;
-		WINPR_ASSERT(channel->client);
-		context = channel->client->context;
-		WINPR_ASSERT(context);
-		while (Length > 0)
+		if (first && (Length > DVC_MAX_DATA_PDU_SIZE - Stream_GetPosition(s)))
+		{
+			cbLen = wts_write_variable_uint(s, Length);
+			header[0] = (BYTE)((DATA_FIRST_PDU << 4) | (cbLen << 2) | cbChId);
+		}
+		else
 		{
-			s = Stream_New(NULL, DVC_MAX_DATA_PDU_SIZE);
+			header[0] = (BYTE)((DATA_PDU << 4) | cbChId);
+		}
 
-			if (!s)
-			{
-				WLog_ERR(TAG, "Stream_New failed!");
-				SetLastError(E_OUTOFMEMORY);
-				goto fail;
-			}
+		const UINT32 headerLength = (UINT32)Stream_GetPosition(s);
+		UINT32 written = DVC_MAX_DATA_PDU_SIZE - headerLength;
+		if (written > Length)
+			written = Length;
 
-			buffer = Stream_Buffer(s);
-			Stream_Seek_UINT8(s);
-			cbChId = wts_write_variable_uint(s, channel->channelId);
+		first = FALSE;
+		if (!wts_queue_send_slice(channel->vcm->drdynvc_channel, buffer, header, headerLength,
+		                          Buffer, written))
+			return FALSE;
 
-			if (first && (Length > Stream_GetRemainingLength(s)))
-			{
-				cbLen = wts_write_variable_uint(s, Length);
-				buffer[0] = (DATA_FIRST_PDU << 4) | (cbLen << 2) | cbChId;
-			}
-			else
-			{
-				buffer[0] = (DATA_PDU << 4) | cbChId;
-			}
+		Length -= written;
+		Buffer += written;
+	}
 
-			first = FALSE;
-			written = Stream_GetRemainingLength(s);
+	return TRUE;
+}
+
+/**
+ * Writes a channel message. If s is set it holds the data and is consumed in any case,
+ * otherwise the data is copied once and shared by all PDUs it is split into.
+ */
+static BOOL wts_virtual_channel_write(rdpPeerChannel* channel, wStream* s, const BYTE* Buffer,
+                                      size_t Length)
+{
+	BOOL rc = FALSE;
+	wtsSendBuffer* buffer = NULL;
+
+	WINPR_ASSERT(channel);
+	WINPR_ASSERT(channel->vcm);
+
+	if (Length > UINT32_MAX)
+		goto out;
+
+	const BOOL isSvc = (channel->channelType == RDP_PEER_CHANNEL_TYPE_SVC);
+	if (!isSvc)
+	{
+		if (!channel->vcm->drdynvc_channel ||
+		    (channel->vcm->drdynvc_state != DRDYNVC_STATE_READY))
+		{
+			DEBUG_DVC("drdynvc not ready");
+			goto out;
+		}
+
+		/* compression produces new PDUs anyway */
+		if (wts_channel_use_compression(channel))
+		{
+			rc = wts_write_compressed_dvc(channel, Buffer, (UINT32)Length);
+			goto out;
+		}
+	}
 
-			if (written > Length)
-				written = Length;
+	if (!s)
+	{
+		/* + 1 as empty streams can not be allocated */
+		s = Stream_New(NULL, Length + 1);
 
-			Stream_Write(s, Buffer, written);
-			length = Stream_GetPosition(s);
-			Stream_Free(s, FALSE);
-			Length -= written;
-			Buffer += written;
-			totalWritten += written;
-			if (!wts_queue_send_item(channel->vcm->drdynvc_channel, buffer, length))
-				goto fail;
+		if (!s)
+		{
+			SetLastError(E_OUTOFMEMORY);
+			goto out;
 		}
+
+		Stream_Write(s, Buffer, Length);
+		Buffer = Stream_Buffer(s);
 	}
 
-	if (pBytesWritten)
-		*pBytesWritten = totalWritten;
+	buffer = wts_send_buffer_new(s);
 
-	ret = TRUE;
-fail:
+	if (!buffer)
+	{
+		SetLastError(E_OUTOFMEMORY);
+		goto out;
+	}
+	s = NULL;
+
+	if (isSvc)
+		rc = wts_queue_send_slice(channel, buffer, NULL, 0, Buffer, (UINT32)Length);
+	else
+		rc = wts_write_dvc_slices(channel, buffer, Buffer, (UINT32)Length);
+
+out:
+	wts_send_buffer_unref(buffer);
+	wts_send_stream_free(s);
+	return rc;
+}
+
+BOOL WINAPI FreeRDP_WTSVirtualChannelWrite(HANDLE hChannelHandle, PCHAR Buffer, ULONG Length,
+                                           PULONG pBytesWritten)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+
+	if (!channel)
+		return FALSE;
+
+	EnterCriticalSection(&channel->writeLock);
+	const BOOL ret = wts_virtual_channel_write(channel, NULL, (const BYTE*)Buffer, Length);
+	LeaveCriticalSection(&channel->writeLock);
+
+	if (ret && pBytesWritten)
+		*pBytesWritten = Length;
+	return ret;
+}
+
+BOOL WTSVirtualChannelWriteStream(HANDLE hChannelHandle, wStream* s)
+{
+	rdpPeerChannel* channel = (rdpPeerChannel*)hChannelHandle;
+
+	if (!s)
+		return FALSE;
+
+	if (!channel)
+	{
+		wts_send_stream_free(s);
+		return FALSE;
+	}
+
+	EnterCriticalSection(&channel->writeLock);
+	const BOOL ret = wts_virtual_channel_write(channel, s, Stream_Buffer(s), Stream_GetPosition(s));
 	LeaveCriticalSection(&channel->writeLock);
 	return ret;
 }
@@ -1919,6 +2211,7 @@ void server_channel_common_free(rdpPeerChannel* channel)
 		return;
 	MessageQueue_Free(channel->queue);
 	Stream_Free(channel->receiveData, TRUE);
+	zgfx_context_free(channel->zgfx);
 	DeleteCriticalSection(&channel->writeLock);
 	free(channel);
 }
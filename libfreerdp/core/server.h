@@ -29,6 +29,8 @@
 #include <winpr/stream.h>
 #include <winpr/collections.h>
 
+#include <freerdp/codec/zgfx.h>
+
 typedef struct rdp_peer_channel rdpPeerChannel;
 typedef struct WTSVirtualChannelManager WTSVirtualChannelManager;
 
@@ -70,6 +72,9 @@ struct rdp_peer_channel
 
 	char channelName[128];
 	CRITICAL_SECTION writeLock;
+
+	/* DVC bulk compressor, created on first write once version 3 was negotiated */
+	ZGFX_CONTEXT* zgfx;
 };
 
 struct WTSVirtualChannelManager
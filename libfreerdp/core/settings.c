@@ -1120,7 +1120,8 @@ rdpSettings* freerdp_settings_new(DWORD flags)
 	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpKeepAliveDelay, 5) ||
 	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpKeepAliveInterval, 2) ||
 	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpAckTimeout, 9000) ||
-	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpConnectTimeout, 15000))
+	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpConnectTimeout, 15000) ||
+	    !freerdp_settings_set_uint32(settings, FreeRDP_TcpSendQueueLimit, 16 * 1024 * 1024))
 		goto out_fail;
 
 	if (!freerdp_settings_get_bool(settings, FreeRDP_ServerMode))
@@ -1257,9 +1258,10 @@ static BOOL freerdp_settings_int_buffer_copy(rdpSettings* _settings, const rdpSe
 		if (!freerdp_settings_set_pointer_len(_settings, FreeRDP_ServerCertificate, data, len))
 			return FALSE;
 	}
+	/* certificate and key are immutable once loaded, every session copy shares them */
 	if (settings->RdpServerCertificate)
 	{
-		rdpCertificate* cert = freerdp_certificate_clone(settings->RdpServerCertificate);
+		rdpCertificate* cert = freerdp_certificate_ref(settings->RdpServerCertificate);
 		if (!cert)
 			goto out_fail;
 		if (!freerdp_settings_set_pointer_len(_settings, FreeRDP_RdpServerCertificate, cert, 1))
@@ -1273,7 +1275,7 @@ static BOOL freerdp_settings_int_buffer_copy(rdpSettings* _settings, const rdpSe
 
 	if (settings->RdpServerRsaKey)
 	{
-		rdpPrivateKey* key = freerdp_key_clone(settings->RdpServerRsaKey);
+		rdpPrivateKey* key = freerdp_key_ref(settings->RdpServerRsaKey);
 		if (!key)
 			goto out_fail;
 		if (!freerdp_settings_set_pointer_len(_settings, FreeRDP_RdpServerRsaKey, key, 1))
@@ -30,9 +30,23 @@
 #include <freerdp/transport_io.h>
 
 #include "streamdump.h"
+#include "fastpath.h"
 
 #define TAG FREERDP_TAG("streamdump")
 
+/* one slot per fastpath update code, the last one collects slow path and encrypted PDUs */
+#define STREAM_DUMP_REPLAY_OTHER 16
+#define STREAM_DUMP_REPLAY_KINDS (STREAM_DUMP_REPLAY_OTHER + 1)
+
+typedef struct
+{
+	size_t count;
+	size_t capacity;
+	UINT64 bytes;
+	UINT64 totalNs;
+	UINT64* samples;
+} stream_dump_replay_stats;
+
 struct stream_dump_context
 {
 	rdpTransportIo io;
@@ -44,6 +58,15 @@ struct stream_dump_context
 	BOOL isServer;
 	BOOL nodelay;
 	wLog* log;
+
+	FILE* replayFile;
+	UINT64 replayStartNs;
+	UINT64 replayReturnNs;
+	UINT64 replayWaitNs;
+	size_t replayKind;
+	size_t replaySize;
+	BOOL replayReported;
+	stream_dump_replay_stats stats[STREAM_DUMP_REPLAY_KINDS];
 };
 
 static UINT32 crc32b(const BYTE* data, size_t length)
@@ -330,6 +353,123 @@ static int stream_dump_replay_transport_write(rdpTransport* transport, wStream*
 	return 1;
 }
 
+static size_t stream_dump_replay_kind(wStream* s)
+{
+	const BYTE* data = Stream_Buffer(s);
+	const size_t length = Stream_Length(s);
+
+	if ((length < 1) || ((data[0] & 0x03) != FASTPATH_OUTPUT_ACTION_FASTPATH))
+		return STREAM_DUMP_REPLAY_OTHER;
+
+	/* skip fpOutputHeader and the 1 or 2 byte length, encrypted updates (secFlags 0x2 in the
+	 * top bits of fpOutputHeader) are not inspected */
+	const size_t header = ((length > 1) && (data[1] & 0x80)) ? 3 : 2;
+	if ((length <= header) || (data[0] & 0x80))
+		return STREAM_DUMP_REPLAY_OTHER;
+	return data[header] & 0x0F;
+}
+
+static void stream_dump_replay_record(rdpStreamDumpContext* dump, UINT64 now)
+{
+	WINPR_ASSERT(dump);
+
+	if (dump->replayReturnNs == 0)
+		return;
+
+	stream_dump_replay_stats* stats = &dump->stats[dump->replayKind];
+	if (stats->count == stats->capacity)
+	{
+		const size_t capacity = (stats->capacity > 0) ? stats->capacity * 2 : 1024;
+		UINT64* samples = realloc(stats->samples, capacity * sizeof(UINT64));
+		if (!samples)
+			return;
+		stats->samples = samples;
+		stats->capacity = capacity;
+	}
+
+	const UINT64 duration = now - dump->replayReturnNs;
+	stats->samples[stats->count++] = duration;
+	stats->totalNs += duration;
+	stats->bytes += dump->replaySize;
+}
+
+static int stream_dump_replay_compare(const void* pva, const void* pvb)
+{
+	const UINT64* a = pva;
+	const UINT64* b = pvb;
+
+	if (*a < *b)
+		return -1;
+	return (*a > *b) ? 1 : 0;
+}
+
+/* the samples are sorted in place, the report is only done once at the end of the replay */
+static UINT64 stream_dump_replay_percentile(UINT64* samples, size_t count, size_t percentile)
+{
+	if (count == 0)
+		return 0;
+
+	qsort(samples, count, sizeof(UINT64), stream_dump_replay_compare);
+	const size_t index = (count * percentile + 99) / 100;
+	return samples[(index > 0) ? index - 1 : 0];
+}
+
+static void stream_dump_replay_report(rdpStreamDumpContext* dump)
+{
+	WINPR_ASSERT(dump);
+
+	if (dump->replayReported || (dump->replayStartNs == 0))
+		return;
+	dump->replayReported = TRUE;
+
+	stream_dump_replay_record(dump, winpr_GetTickCount64NS());
+	dump->replayReturnNs = 0;
+
+	const UINT64 elapsed = winpr_GetTickCount64NS() - dump->replayStartNs;
+	const UINT64 busy = (elapsed > dump->replayWaitNs) ? elapsed - dump->replayWaitNs : 0;
+	size_t total = 0;
+	size_t frames = 0;
+	UINT64* all = NULL;
+
+	for (size_t x = 0; x < STREAM_DUMP_REPLAY_KINDS; x++)
+		total += dump->stats[x].count;
+
+	if (total > 0)
+		all = calloc(total, sizeof(UINT64));
+
+	WLog_Print(dump->log, WLOG_INFO,
+	           "replay finished: %" PRIuz " PDUs in %" PRIu64 "ms (%" PRIu64 "ms processing)",
+	           total, elapsed / 1000000ull, busy / 1000000ull);
+
+	for (size_t x = 0; x < STREAM_DUMP_REPLAY_KINDS; x++)
+	{
+		stream_dump_replay_stats* stats = &dump->stats[x];
+		if (stats->count == 0)
+			continue;
+
+		if (all)
+			memcpy(&all[frames], stats->samples, stats->count * sizeof(UINT64));
+		frames += stats->count;
+
+		const char* name =
+		    (x == STREAM_DUMP_REPLAY_OTHER) ? "OTHER" : fastpath_update_to_string((UINT8)x);
+		WLog_Print(dump->log, WLOG_INFO,
+		           "  %-32s %8" PRIuz " PDUs %12" PRIu64 " bytes avg %8" PRIu64
+		           "us p99 %8" PRIu64 "us",
+		           name, stats->count, stats->bytes, stats->totalNs / stats->count / 1000ull,
+		           stream_dump_replay_percentile(stats->samples, stats->count, 99) / 1000ull);
+	}
+
+	if (all && (busy > 0))
+	{
+		WLog_Print(dump->log, WLOG_INFO,
+		           "  %" PRIu64 " PDUs/s while processing, p99 latency %" PRIu64 "us",
+		           (UINT64)total * 1000000000ull / busy,
+		           stream_dump_replay_percentile(all, total, 99) / 1000ull);
+	}
+	free(all);
+}
+
 static int stream_dump_replay_transport_read(rdpTransport* transport, wStream* s)
 {
 	rdpContext* ctx = transport_get_context(transport);
@@ -343,24 +483,41 @@ static int stream_dump_replay_transport_read(rdpTransport* transport, wStream* s
 	WINPR_ASSERT(ctx->dump);
 	WINPR_ASSERT(s);
 
+	rdpStreamDumpContext* dump = ctx->dump;
+	const UINT64 now = winpr_GetTickCount64NS();
+
+	/* everything since the previous PDU was handed out was spent processing it */
+	stream_dump_replay_record(dump, now);
+	if (dump->replayStartNs == 0)
+		dump->replayStartNs = now;
+
+	/* keep the capture open for the whole replay instead of reopening it per PDU */
+	if (!dump->replayFile)
+		dump->replayFile = stream_dump_get_file(ctx->settings, "rb");
+	if (!dump->replayFile)
+		return -1;
+
 	const size_t start = Stream_GetPosition(s);
 	do
 	{
 		Stream_SetPosition(s, start);
-		if (stream_dump_get(ctx, &flags, s, &ctx->dump->replayOffset, &ts) < 0)
+		if (!stream_dump_read_line(dump->replayFile, s, &ts, &dump->replayOffset, &flags))
+		{
+			stream_dump_replay_report(dump);
 			return -1;
+		}
 	} while (flags & STREAM_MSG_SRV_RX);
 
-	if (!ctx->dump->nodelay)
+	if (!dump->nodelay)
 	{
-		if ((ctx->dump->replayTime > 0) && (ts > ctx->dump->replayTime))
-			slp = ts - ctx->dump->replayTime;
+		if ((dump->replayTime > 0) && (ts > dump->replayTime))
+			slp = ts - dump->replayTime;
 	}
-	ctx->dump->replayTime = ts;
+	dump->replayTime = ts;
 
 	size = Stream_Length(s);
 	Stream_SetPosition(s, 0);
-	WLog_Print(ctx->dump->log, WLOG_TRACE, "replay read %" PRIuz, size);
+	WLog_Print(dump->log, WLOG_TRACE, "replay read %" PRIuz, size);
 
 	if (slp > 0)
 	{
@@ -373,6 +530,10 @@ static int stream_dump_replay_transport_read(rdpTransport* transport, wStream* s
 		} while (duration > 0);
 	}
 
+	dump->replayKind = stream_dump_replay_kind(s);
+	dump->replaySize = size;
+	dump->replayReturnNs = winpr_GetTickCount64NS();
+	dump->replayWaitNs += dump->replayReturnNs - now;
 	return 1;
 }
 
@@ -454,6 +615,14 @@ BOOL stream_dump_register_handlers(rdpContext* context, CONNECTION_STATE state,
 
 void stream_dump_free(rdpStreamDumpContext* dump)
 {
+	if (!dump)
+		return;
+
+	stream_dump_replay_report(dump);
+	if (dump->replayFile)
+		(void)fclose(dump->replayFile);
+	for (size_t x = 0; x < STREAM_DUMP_REPLAY_KINDS; x++)
+		free(dump->stats[x].samples);
 	free(dump);
 }
 
@@ -39,10 +39,11 @@ static BOOL update_recv_surfcmd_bitmap_header_ex(wStream* s, TS_COMPRESSED_BITMA
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 24))
 		return FALSE;
 
-	Stream_Read_UINT32(s, header->highUniqueId);
-	Stream_Read_UINT32(s, header->lowUniqueId);
-	Stream_Read_UINT64(s, header->tmMilliseconds);
-	Stream_Read_UINT64(s, header->tmSeconds);
+	const BYTE* data = Stream_ReadSpan(s, 24);
+	Data_Read_UINT32(&data[0], header->highUniqueId);
+	Data_Read_UINT32(&data[4], header->lowUniqueId);
+	Data_Read_UINT64(&data[8], header->tmMilliseconds);
+	Data_Read_UINT64(&data[16], header->tmSeconds);
 	return TRUE;
 }
 
@@ -54,13 +55,14 @@ static BOOL update_recv_surfcmd_bitmap_ex(wStream* s, TS_BITMAP_DATA_EX* bmp)
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 12))
 		return FALSE;
 
-	Stream_Read_UINT8(s, bmp->bpp);
-	Stream_Read_UINT8(s, bmp->flags);
-	Stream_Seek(s, 1); /* reserved */
-	Stream_Read_UINT8(s, bmp->codecID);
-	Stream_Read_UINT16(s, bmp->width);
-	Stream_Read_UINT16(s, bmp->height);
-	Stream_Read_UINT32(s, bmp->bitmapDataLength);
+	const BYTE* data = Stream_ReadSpan(s, 12);
+	Data_Read_UINT8(&data[0], bmp->bpp);
+	Data_Read_UINT8(&data[1], bmp->flags);
+	/* data[2] is reserved */
+	Data_Read_UINT8(&data[3], bmp->codecID);
+	Data_Read_UINT16(&data[4], bmp->width);
+	Data_Read_UINT16(&data[6], bmp->height);
+	Data_Read_UINT32(&data[8], bmp->bitmapDataLength);
 
 	if ((bmp->width == 0) || (bmp->height == 0))
 	{
@@ -133,10 +135,11 @@ static BOOL update_recv_surfcmd_surface_bits(rdpUpdate* update, wStream* s, UINT
 		goto fail;
 
 	cmd.cmdType = cmdType;
-	Stream_Read_UINT16(s, cmd.destLeft);
-	Stream_Read_UINT16(s, cmd.destTop);
-	Stream_Read_UINT16(s, cmd.destRight);
-	Stream_Read_UINT16(s, cmd.destBottom);
+	const BYTE* data = Stream_ReadSpan(s, 8);
+	Data_Read_UINT16(&data[0], cmd.destLeft);
+	Data_Read_UINT16(&data[2], cmd.destTop);
+	Data_Read_UINT16(&data[4], cmd.destRight);
+	Data_Read_UINT16(&data[6], cmd.destBottom);
 
 	if (!update_recv_surfcmd_is_rect_valid(update->context, &cmd))
 		goto fail;
@@ -39,12 +39,17 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <net/if.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
 
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 #ifdef WINPR_HAVE_POLL_H
 #include <poll.h>
 #else
@@ -90,14 +95,39 @@
 #include <linux/vm_sockets.h>
 #endif
 
+#if defined(HAVE_LINUX_TLS_H) && !defined(OPENSSL_NO_KTLS)
+#include <linux/tls.h>
+
+/* Sending only, kTLS reception needs the record type of every single read */
+#define TRANSPORT_KTLS_SEND
+
+/* The BIO controls OpenSSL uses internally to hand the keys over, see openssl/bio.h */
+#define TRANSPORT_BIO_CTRL_SET_KTLS 72
+#define TRANSPORT_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG 74
+#define TRANSPORT_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG 75
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#endif
+
 #define TAG FREERDP_TAG("core")
 
+/* Bounds of the socket buffers sized from the bandwidth-delay product */
+#define TCP_ADAPTIVE_BUFFER_MIN (64 * 1024)
+#define TCP_ADAPTIVE_BUFFER_MAX (16 * 1024 * 1024)
+
 /* Simple Socket BIO */
 
 typedef struct
 {
 	SOCKET socket;
 	HANDLE hEvent;
+	BOOL ktlsSend;
+	BYTE ktlsRecordType; /* of the next write if not application data, 0 otherwise */
 } WINPR_BIO_SIMPLE_SOCKET;
 
 static int transport_bio_simple_init(BIO* bio, SOCKET socket, int shutdown);
@@ -109,6 +139,88 @@ static long transport_bio_simple_callback(BIO* bio, int mode, const char* argp,
 	return 1;
 }
 
+#if defined(TRANSPORT_KTLS_SEND)
+static BOOL transport_bio_simple_start_ktls(WINPR_BIO_SIMPLE_SOCKET* ptr, const void* info)
+{
+	const struct tls_crypto_info* crypto = info;
+	size_t length = 0;
+
+	WINPR_ASSERT(ptr);
+	if (!crypto)
+		return FALSE;
+
+	/* OpenSSL passes a union of all ciphers, the kernel wants the exact size */
+	switch (crypto->cipher_type)
+	{
+		case TLS_CIPHER_AES_GCM_128:
+			length = sizeof(struct tls12_crypto_info_aes_gcm_128);
+			break;
+#if defined(TLS_CIPHER_AES_GCM_256)
+		case TLS_CIPHER_AES_GCM_256:
+			length = sizeof(struct tls12_crypto_info_aes_gcm_256);
+			break;
+#endif
+#if defined(TLS_CIPHER_CHACHA20_POLY1305)
+		case TLS_CIPHER_CHACHA20_POLY1305:
+			length = sizeof(struct tls12_crypto_info_chacha20_poly1305);
+			break;
+#endif
+		default:
+			WLog_DBG(TAG, "kernel TLS does not support cipher type %" PRIu16, crypto->cipher_type);
+			return FALSE;
+	}
+
+	if (setsockopt((int)ptr->socket, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) != 0)
+	{
+		char ebuffer[256] = { 0 };
+		WLog_DBG(TAG, "kernel TLS not available: %s",
+		         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+		return FALSE;
+	}
+
+	if (setsockopt((int)ptr->socket, SOL_TLS, TLS_TX, crypto, (socklen_t)length) != 0)
+	{
+		char ebuffer[256] = { 0 };
+		WLog_DBG(TAG, "kernel TLS rejected the keys: %s",
+		         winpr_strerror(errno, ebuffer, sizeof(ebuffer)));
+		return FALSE;
+	}
+
+	ptr->ktlsSend = TRUE;
+	return TRUE;
+}
+
+/* Handshake messages and alerts go out with their record type in a control message */
+static int transport_bio_simple_send_record(WINPR_BIO_SIMPLE_SOCKET* ptr, const char* buf,
+                                            int size)
+{
+	char control[CMSG_SPACE(sizeof(BYTE))] = { 0 };
+	struct iovec iov = { .iov_base = (void*)buf, .iov_len = (size_t)size };
+	struct msghdr msg = { 0 };
+
+	WINPR_ASSERT(ptr);
+
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_TLS;
+	cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(BYTE));
+	*CMSG_DATA(cmsg) = ptr->ktlsRecordType;
+
+	/* The kernel takes records as a whole, like the OpenSSL socket BIO */
+	const ssize_t status = sendmsg((int)ptr->socket, &msg, 0);
+	if (status < 0)
+		return -1;
+
+	ptr->ktlsRecordType = 0;
+	return size;
+}
+#endif
+
 static int transport_bio_simple_write(BIO* bio, const char* buf, int size)
 {
 	int error = 0;
@@ -119,7 +231,12 @@ static int transport_bio_simple_write(BIO* bio, const char* buf, int size)
 		return 0;
 
 	BIO_clear_flags(bio, BIO_FLAGS_WRITE);
-	status = _send(ptr->socket, buf, size, 0);
+#if defined(TRANSPORT_KTLS_SEND)
+	if (ptr->ktlsRecordType != 0)
+		status = transport_bio_simple_send_record(ptr, buf, size);
+	else
+#endif
+		status = _send(ptr->socket, buf, size, 0);
 
 	if (status <= 0)
 	{
@@ -139,6 +256,54 @@ static int transport_bio_simple_write(BIO* bio, const char* buf, int size)
 	return status;
 }
 
+#if !defined(_WIN32)
+static long transport_bio_simple_write_vector(BIO* bio, TransportBioVector* vector)
+{
+	struct iovec iov[TRANSPORT_BIO_VECTOR_MAX] = { 0 };
+	struct msghdr msg = { 0 };
+	WINPR_BIO_SIMPLE_SOCKET* ptr = (WINPR_BIO_SIMPLE_SOCKET*)BIO_get_data(bio);
+
+	WINPR_ASSERT(ptr);
+	if (!vector || (vector->count > ARRAYSIZE(iov)))
+		return 0;
+
+	/* Records with a type of their own go out one by one */
+	if (ptr->ktlsRecordType != 0)
+		return 0;
+
+	for (size_t x = 0; x < vector->count; x++)
+	{
+		iov[x].iov_base = (void*)vector->chunks[x].data;
+		iov[x].iov_len = vector->chunks[x].size;
+	}
+	msg.msg_iov = iov;
+	msg.msg_iovlen = vector->count;
+
+	BIO_clear_flags(bio, BIO_FLAGS_WRITE);
+	ssize_t status = 0;
+	do
+	{
+		status = sendmsg((int)ptr->socket, &msg, MSG_NOSIGNAL);
+	} while ((status < 0) && (errno == EINTR));
+
+	if (status < 0)
+	{
+		vector->sent = 0;
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+		{
+			BIO_set_flags(bio, (BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY));
+			return 1;
+		}
+
+		BIO_clear_flags(bio, BIO_FLAGS_SHOULD_RETRY);
+		return -1;
+	}
+
+	vector->sent = (size_t)status;
+	return 1;
+}
+#endif
+
 static int transport_bio_simple_read(BIO* bio, char* buf, int size)
 {
 	int error = 0;
@@ -343,6 +508,37 @@ static long transport_bio_simple_ctrl(BIO* bio, int cmd, long arg1, void* arg2)
 			status = 1;
 			break;
 
+		case BIO_C_WRITE_VECTOR:
+#if !defined(_WIN32)
+			if (!BIO_get_init(bio))
+				return 0;
+			return transport_bio_simple_write_vector(bio, arg2);
+#else
+			status = 0;
+			break;
+#endif
+
+#if defined(TRANSPORT_KTLS_SEND)
+		case TRANSPORT_BIO_CTRL_SET_KTLS:
+			/* arg1 is set for the sending direction, OpenSSL keeps decrypting otherwise */
+			if (!BIO_get_init(bio) || !arg1 || ptr->ktlsSend)
+				return 0;
+			return transport_bio_simple_start_ktls(ptr, arg2) ? 1 : 0;
+
+		case BIO_CTRL_GET_KTLS_SEND:
+			return BIO_get_init(bio) && ptr->ktlsSend;
+
+		case TRANSPORT_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+			ptr->ktlsRecordType = (BYTE)arg1;
+			status = 0;
+			break;
+
+		case TRANSPORT_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+			ptr->ktlsRecordType = 0;
+			status = 0;
+			break;
+#endif
+
 		default:
 			status = 0;
 			break;
@@ -355,6 +551,8 @@ static int transport_bio_simple_init(BIO* bio, SOCKET socket, int shutdown)
 {
 	WINPR_BIO_SIMPLE_SOCKET* ptr = (WINPR_BIO_SIMPLE_SOCKET*)BIO_get_data(bio);
 	ptr->socket = socket;
+	ptr->ktlsSend = FALSE;
+	ptr->ktlsRecordType = 0;
 	BIO_set_shutdown(bio, shutdown);
 	BIO_set_flags(bio, BIO_FLAGS_SHOULD_RETRY);
 	BIO_set_init(bio, 1);
@@ -453,12 +651,30 @@ BIO_METHOD* BIO_s_simple_socket(void)
 
 /* Buffered Socket BIO */
 
+/* Queued data lives in a chain of fixed size chunks, a few of them are kept for reuse */
+#define BUFFERED_CHUNK_SIZE 16384
+#define BUFFERED_CHUNK_POOL 8
+
+typedef struct s_buffered_socket_chunk
+{
+	struct s_buffered_socket_chunk* next;
+	size_t offset; /* of the first byte not sent yet */
+	size_t length;
+	BYTE data[BUFFERED_CHUNK_SIZE];
+} BufferedSocketChunk;
+
 typedef struct
 {
 	BIO* bufferedBio;
 	BOOL readBlocked;
 	BOOL writeBlocked;
-	RingBuffer xmitBuffer;
+	BufferedSocketChunk* head;
+	BufferedSocketChunk* tail;
+	BufferedSocketChunk* pool;
+	size_t poolCount;
+	size_t queued;
+	size_t queueLimit; /* 0 for no limit */
+	BYTE ktlsRecordType;
 } WINPR_BIO_BUFFERED_SOCKET;
 
 static long transport_bio_buffered_callback(BIO* bio, int mode, const char* argp, int argi,
@@ -467,14 +683,252 @@ static long transport_bio_buffered_callback(BIO* bio, int mode, const char* argp
 	return 1;
 }
 
+/* Writes as much as possible of buf to the next BIO, returns the number of bytes written or -1 */
+static int transport_bio_buffered_send(BIO* bio, const BYTE* buf, size_t size)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+	BIO* next_bio = BIO_next(bio);
+	size_t offset = 0;
+
+	WINPR_ASSERT(ptr);
+
+	while (offset < size)
+	{
+		ERR_clear_error();
+		const size_t chunk = MIN(size - offset, INT32_MAX);
+		const int status = BIO_write(next_bio, &buf[offset], (int)chunk);
+
+		if (status <= 0)
+		{
+			if (!BIO_should_retry(next_bio))
+			{
+				BIO_clear_flags(bio, BIO_FLAGS_SHOULD_RETRY);
+				return -1; /* fatal error */
+			}
+
+			if (BIO_should_write(next_bio))
+			{
+				BIO_set_flags(bio, BIO_FLAGS_WRITE);
+				ptr->writeBlocked = TRUE;
+				break; /* EWOULDBLOCK */
+			}
+		}
+		else
+			offset += (size_t)status;
+	}
+
+	WINPR_ASSERT(offset <= INT32_MAX);
+	return (int)offset;
+}
+
+static BufferedSocketChunk* transport_bio_buffered_chunk_new(WINPR_BIO_BUFFERED_SOCKET* ptr)
+{
+	WINPR_ASSERT(ptr);
+
+	BufferedSocketChunk* chunk = ptr->pool;
+	if (chunk)
+	{
+		ptr->pool = chunk->next;
+		ptr->poolCount--;
+	}
+	else
+	{
+		chunk = malloc(sizeof(BufferedSocketChunk));
+		if (!chunk)
+			return NULL;
+	}
+
+	chunk->next = NULL;
+	chunk->offset = 0;
+	chunk->length = 0;
+	return chunk;
+}
+
+static void transport_bio_buffered_chunk_free(WINPR_BIO_BUFFERED_SOCKET* ptr,
+                                              BufferedSocketChunk* chunk)
+{
+	WINPR_ASSERT(ptr);
+
+	if (!chunk)
+		return;
+
+	if (ptr->poolCount < BUFFERED_CHUNK_POOL)
+	{
+		chunk->next = ptr->pool;
+		ptr->pool = chunk;
+		ptr->poolCount++;
+	}
+	else
+		free(chunk);
+}
+
+static BOOL transport_bio_buffered_queue(WINPR_BIO_BUFFERED_SOCKET* ptr, const BYTE* buf,
+                                         size_t size)
+{
+	WINPR_ASSERT(ptr);
+	WINPR_ASSERT(buf || (size == 0));
+
+	while (size > 0)
+	{
+		BufferedSocketChunk* chunk = ptr->tail;
+		if (!chunk || (chunk->length == BUFFERED_CHUNK_SIZE))
+		{
+			chunk = transport_bio_buffered_chunk_new(ptr);
+			if (!chunk)
+				return FALSE;
+
+			if (ptr->tail)
+				ptr->tail->next = chunk;
+			else
+				ptr->head = chunk;
+			ptr->tail = chunk;
+		}
+
+		const size_t length = MIN(size, BUFFERED_CHUNK_SIZE - chunk->length);
+		memcpy(&chunk->data[chunk->length], buf, length);
+		chunk->length += length;
+		ptr->queued += length;
+		buf += length;
+		size -= length;
+	}
+
+	return TRUE;
+}
+
+/* Hands all queued chunks to the next BIO at once if it can send vectors */
+static int transport_bio_buffered_send_vector(BIO* bio, const DataChunk* chunks, size_t count)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+	TransportBioVector vector = { .chunks = chunks, .count = count, .sent = 0 };
+	size_t total = 0;
+
+	WINPR_ASSERT(ptr);
+
+	for (size_t x = 0; x < count; x++)
+		total += chunks[x].size;
+
+	ERR_clear_error();
+	const long rc = BIO_ctrl(BIO_next(bio), BIO_C_WRITE_VECTOR, 0, &vector);
+	if (rc < 0)
+	{
+		BIO_clear_flags(bio, BIO_FLAGS_SHOULD_RETRY);
+		return -1; /* fatal error */
+	}
+
+	if (rc == 0)
+	{
+		size_t sent = 0;
+		for (size_t x = 0; x < count; x++)
+		{
+			const int status = transport_bio_buffered_send(bio, chunks[x].data, chunks[x].size);
+			if (status < 0)
+				return -1;
+
+			sent += (size_t)status;
+			if ((size_t)status < chunks[x].size)
+				break;
+		}
+		vector.sent = sent;
+	}
+	else if (vector.sent < total)
+	{
+		BIO_set_flags(bio, BIO_FLAGS_WRITE);
+		ptr->writeBlocked = TRUE;
+	}
+
+	WINPR_ASSERT(vector.sent <= INT32_MAX);
+	return (int)vector.sent;
+}
+
+/* Sends queued data until the next BIO blocks, returns -1 on error and 0 otherwise */
+static int transport_bio_buffered_drain(BIO* bio)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+
+	WINPR_ASSERT(ptr);
+
+	while (ptr->head)
+	{
+		DataChunk chunks[TRANSPORT_BIO_VECTOR_MAX] = { 0 };
+		size_t count = 0;
+
+		for (const BufferedSocketChunk* cur = ptr->head; cur && (count < ARRAYSIZE(chunks));
+		     cur = cur->next)
+		{
+			chunks[count].data = &cur->data[cur->offset];
+			chunks[count].size = cur->length - cur->offset;
+			count++;
+		}
+
+		const int status = transport_bio_buffered_send_vector(bio, chunks, count);
+		if (status < 0)
+			return -1;
+
+		size_t sent = (size_t)status;
+		ptr->queued -= sent;
+		while (ptr->head && (sent >= ptr->head->length - ptr->head->offset))
+		{
+			BufferedSocketChunk* chunk = ptr->head;
+			sent -= chunk->length - chunk->offset;
+			ptr->head = chunk->next;
+			if (!ptr->head)
+				ptr->tail = NULL;
+			transport_bio_buffered_chunk_free(ptr, chunk);
+		}
+
+		if (ptr->head)
+			ptr->head->offset += sent;
+
+		if (ptr->writeBlocked)
+			break;
+	}
+
+	return 0;
+}
+
+static int transport_bio_buffered_write(BIO* bio, const char* buf, int num);
+
+#if defined(TRANSPORT_KTLS_SEND)
+/* A kTLS control record must go out in one piece and nothing queued may take its type */
+static int transport_bio_buffered_write_record(BIO* bio, const char* buf, int num)
+{
+	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
+	BIO* next_bio = BIO_next(bio);
+
+	WINPR_ASSERT(ptr);
+
+	if (ptr->queued > 0)
+	{
+		if (transport_bio_buffered_write(bio, NULL, 0) < 0)
+			return -1;
+	}
+
+	int status = 0;
+	if (ptr->queued == 0)
+	{
+		BIO_ctrl(next_bio, TRANSPORT_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG, ptr->ktlsRecordType,
+		         NULL);
+		status = transport_bio_buffered_send(bio, (const BYTE*)buf, (size_t)num);
+		BIO_ctrl(next_bio, TRANSPORT_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG, 0, NULL);
+		if (status < 0)
+			return -1;
+	}
+
+	if (status < num)
+	{
+		/* OpenSSL retries the whole record */
+		BIO_set_flags(bio, BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY);
+		return -1;
+	}
+
+	ptr->ktlsRecordType = 0;
+	return num;
+}
+#endif
+
 static int transport_bio_buffered_write(BIO* bio, const char* buf, int num)
 {
-	int ret = num;
-	int nchunks = 0;
-	size_t committedBytes = 0;
-	DataChunk chunks[2] = { 0 };
 	WINPR_BIO_BUFFERED_SOCKET* ptr = (WINPR_BIO_BUFFERED_SOCKET*)BIO_get_data(bio);
-	BIO* next_bio = NULL;
 
 	WINPR_ASSERT(bio);
 	WINPR_ASSERT(ptr);
@@ -482,53 +936,52 @@ static int transport_bio_buffered_write(BIO* bio, const char* buf, int num)
 	ptr->writeBlocked = FALSE;
 	BIO_clear_flags(bio, BIO_FLAGS_WRITE);
 
-	/* we directly append extra bytes in the xmit buffer, this could be prevented
-	 * but for now it makes the code more simple.
-	 */
-	if (buf && num && !ringbuffer_write(&ptr->xmitBuffer, (const BYTE*)buf, num))
+#if defined(TRANSPORT_KTLS_SEND)
+	if (buf && (ptr->ktlsRecordType != 0))
+		return transport_bio_buffered_write_record(bio, buf, num);
+#endif
+
+	/* Keep the order of data that is already queued */
+	if (ptr->queued > 0)
 	{
-		WLog_ERR(TAG, "an error occurred when writing (num: %d)", num);
-		return -1;
+		if (transport_bio_buffered_drain(bio) < 0)
+			return -1;
 	}
 
-	nchunks = ringbuffer_peek(&ptr->xmitBuffer, chunks, ringbuffer_used(&ptr->xmitBuffer));
-	next_bio = BIO_next(bio);
+	if (!buf || (num <= 0))
+		return num;
 
-	for (int i = 0; i < nchunks; i++)
+	/* Nothing pending, send straight from the caller buffer and only keep what the socket
+	 * did not take. This saves copying every PDU through the queue. */
+	if (ptr->queued == 0)
 	{
-		while (chunks[i].size)
-		{
-			ERR_clear_error();
-			const int status = BIO_write(next_bio, chunks[i].data, chunks[i].size);
-
-			if (status <= 0)
-			{
-				if (!BIO_should_retry(next_bio))
-				{
-					BIO_clear_flags(bio, BIO_FLAGS_SHOULD_RETRY);
-					ret = -1; /* fatal error */
-					goto out;
-				}
+		const int status = transport_bio_buffered_send(bio, (const BYTE*)buf, (size_t)num);
+		if (status < 0)
+			return -1;
 
-				if (BIO_should_write(next_bio))
-				{
-					BIO_set_flags(bio, BIO_FLAGS_WRITE);
-					ptr->writeBlocked = TRUE;
-					goto out; /* EWOULDBLOCK */
-				}
-			}
-			else
-			{
-				committedBytes += (size_t)status;
-				chunks[i].size -= (size_t)status;
-				chunks[i].data += status;
-			}
+		if (!transport_bio_buffered_queue(ptr, (const BYTE*)&buf[status],
+		                                  (size_t)(num - status)))
+		{
+			WLog_ERR(TAG, "an error occurred when writing (num: %d)", num);
+			return -1;
 		}
+		return num;
 	}
 
-out:
-	ringbuffer_commit_read_bytes(&ptr->xmitBuffer, committedBytes);
-	return ret;
+	/* Above the limit the sender has to wait until the peer took some of the queue */
+	if ((ptr->queueLimit > 0) && (ptr->queued >= ptr->queueLimit))
+	{
+		BIO_set_flags(bio, BIO_FLAGS_WRITE | BIO_FLAGS_SHOULD_RETRY);
+		ptr->writeBlocked = TRUE;
+		return -1;
+	}
+
+	if (!transport_bio_buffered_queue(ptr, (const BYTE*)buf, (size_t)num))
+	{
+		WLog_ERR(TAG, "an error occurred when writing (num: %d)", num);
+		return -1;
+	}
+	return num;
 }
 
 static int transport_bio_buffered_read(BIO* bio, char* buf, int size)
@@ -581,7 +1034,7 @@ static long transport_bio_buffered_ctrl(BIO* bio, int cmd, long arg1, void* arg2
 	switch (cmd)
 	{
 		case BIO_CTRL_FLUSH:
-			if (!ringbuffer_used(&ptr->xmitBuffer))
+			if (!ptr->queued)
 				status = 1;
 			else
 				status = (transport_bio_buffered_write(bio, NULL, 0) >= 0) ? 1 : -1;
@@ -589,7 +1042,12 @@ static long transport_bio_buffered_ctrl(BIO* bio, int cmd, long arg1, void* arg2
 			break;
 
 		case BIO_CTRL_WPENDING:
-			status = ringbuffer_used(&ptr->xmitBuffer);
+			status = (long)MIN(ptr->queued, LONG_MAX);
+			break;
+
+		case BIO_C_SET_SEND_QUEUE_LIMIT:
+			ptr->queueLimit = (size_t)arg1;
+			status = 1;
 			break;
 
 		case BIO_CTRL_PENDING:
@@ -604,6 +1062,26 @@ static long transport_bio_buffered_ctrl(BIO* bio, int cmd, long arg1, void* arg2
 			status = (int)ptr->writeBlocked;
 			break;
 
+#if defined(TRANSPORT_KTLS_SEND)
+		case TRANSPORT_BIO_CTRL_SET_KTLS:
+			/* Queued data would be encrypted with the new keys */
+			if (ptr->queued > 0)
+				status = 0;
+			else
+				status = BIO_ctrl(BIO_next(bio), cmd, arg1, arg2);
+			break;
+
+		case TRANSPORT_BIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+			ptr->ktlsRecordType = (BYTE)arg1;
+			status = 0;
+			break;
+
+		case TRANSPORT_BIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+			ptr->ktlsRecordType = 0;
+			status = 0;
+			break;
+#endif
+
 		default:
 			status = BIO_ctrl(BIO_next(bio), cmd, arg1, arg2);
 			break;
@@ -623,10 +1101,6 @@ static int transport_bio_buffered_new(BIO* bio)
 		return -1;
 
 	BIO_set_data(bio, (void*)ptr);
-
-	if (!ringbuffer_init(&ptr->xmitBuffer, 0x10000))
-		return -1;
-
 	return 1;
 }
 
@@ -640,7 +1114,20 @@ static int transport_bio_buffered_free(BIO* bio)
 	if (!ptr)
 		return 0;
 
-	ringbuffer_destroy(&ptr->xmitBuffer);
+	while (ptr->head)
+	{
+		BufferedSocketChunk* chunk = ptr->head;
+		ptr->head = chunk->next;
+		free(chunk);
+	}
+
+	while (ptr->pool)
+	{
+		BufferedSocketChunk* chunk = ptr->pool;
+		ptr->pool = chunk->next;
+		free(chunk);
+	}
+
 	free(ptr);
 	return 1;
 }
@@ -791,91 +1278,406 @@ struct addrinfo* freerdp_tcp_resolve_host(const char* hostname, int port, int ai
 	return result;
 }
 
-static BOOL freerdp_tcp_is_hostname_resolvable(rdpContext* context, const char* hostname)
+/* RFC 8305 "Happy Eyeballs" */
+#define TCP_RESOLUTION_DELAY_MS 50
+#define TCP_CONNECTION_ATTEMPT_DELAY_MS 250
+#define TCP_MAX_CONNECTION_ATTEMPTS 16
+
+typedef struct
 {
-	struct addrinfo* result = freerdp_tcp_resolve_host(hostname, -1, 0);
+	LONG refcount;
+	HANDLE done;
+	char* hostname;
+	int port;
+	int family;
+	struct addrinfo* result;
+} rdpTcpResolver;
 
-	if (!result)
-	{
-		freerdp_set_last_error_if_not(context, FREERDP_ERROR_DNS_NAME_NOT_FOUND);
+static void freerdp_tcp_resolver_unref(rdpTcpResolver* resolver)
+{
+	if (!resolver)
+		return;
+
+	if (InterlockedDecrement(&resolver->refcount) > 0)
+		return;
+
+	if (resolver->result)
+		freeaddrinfo(resolver->result);
+	if (resolver->done)
+		(void)CloseHandle(resolver->done);
+	free(resolver->hostname);
+	free(resolver);
+}
 
-		return FALSE;
-	}
+/* getaddrinfo can not be cancelled, an abandoned lookup cleans up after itself */
+static DWORD WINAPI freerdp_tcp_resolver_thread(LPVOID arg)
+{
+	rdpTcpResolver* resolver = arg;
+	char service[16] = { 0 };
+	struct addrinfo hints = { 0 };
 
-	freerdp_set_last_error_log(context, 0);
-	freeaddrinfo(result);
-	return TRUE;
+	WINPR_ASSERT(resolver);
+
+	hints.ai_family = resolver->family;
+	hints.ai_socktype = SOCK_STREAM;
+	(void)sprintf_s(service, sizeof(service) - 1, "%d", resolver->port);
+
+	if (getaddrinfo(resolver->hostname, service, &hints, &resolver->result) != 0)
+		resolver->result = NULL;
+
+	(void)SetEvent(resolver->done);
+	freerdp_tcp_resolver_unref(resolver);
+	ExitThread(0);
+	return 0;
 }
 
-static BOOL freerdp_tcp_connect_timeout(rdpContext* context, int sockfd, struct sockaddr* addr,
-                                        socklen_t addrlen, UINT32 timeout)
+static rdpTcpResolver* freerdp_tcp_resolver_start(const char* hostname, int port, int family)
 {
-	BOOL rc = FALSE;
-	HANDLE handles[2];
-	int status = 0;
-	int count = 0;
-	u_long arg = 0;
-	DWORD tout = (timeout > 0) ? timeout : INFINITE;
+	rdpTcpResolver* resolver = calloc(1, sizeof(rdpTcpResolver));
+	if (!resolver)
+		return NULL;
 
-	handles[count] = CreateEvent(NULL, TRUE, FALSE, NULL);
+	/* one reference for the caller, one for the thread */
+	resolver->refcount = 2;
+	resolver->port = port;
+	resolver->family = family;
+	resolver->hostname = _strdup(hostname);
+	resolver->done = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!resolver->hostname || !resolver->done)
+		goto fail;
 
-	if (!handles[count])
-		return FALSE;
+	HANDLE thread = CreateThread(NULL, 0, freerdp_tcp_resolver_thread, resolver, 0, NULL);
+	if (!thread)
+		goto fail;
 
-	status = WSAEventSelect(sockfd, handles[count++], FD_READ | FD_WRITE | FD_CONNECT | FD_CLOSE);
+	(void)CloseHandle(thread);
+	return resolver;
 
-	if (status < 0)
+fail:
+	resolver->refcount = 1;
+	freerdp_tcp_resolver_unref(resolver);
+	return NULL;
+}
+
+static struct addrinfo* freerdp_tcp_resolver_take(rdpTcpResolver* resolver)
+{
+	WINPR_ASSERT(resolver);
+
+	struct addrinfo* result = resolver->result;
+	resolver->result = NULL;
+	return result;
+}
+
+static struct addrinfo* freerdp_tcp_addrinfo_append(struct addrinfo* list, struct addrinfo* next)
+{
+	if (!list)
+		return next;
+
+	struct addrinfo* last = list;
+	while (last->ai_next)
+		last = last->ai_next;
+	last->ai_next = next;
+	return list;
+}
+
+/**
+ * Looks up the IPv6 and IPv4 addresses of a host in parallel, abortable and bounded by timeout.
+ *
+ * Once one family is resolved the other one gets TCP_RESOLUTION_DELAY_MS more, so a stalled
+ * AAAA or A query does not delay the connection. The result lists the addresses of the family
+ * that answered first, followed by the other one.
+ */
+static struct addrinfo* freerdp_tcp_resolve_host_async(rdpContext* context, const char* hostname,
+                                                       int port, DWORD timeout)
+{
+	rdpTcpResolver* resolvers[2] = { 0 };
+	struct addrinfo* result = NULL;
+	size_t count = 0;
+
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(hostname);
+
+	const UINT32 IPvX = freerdp_settings_get_uint32(context->settings, FreeRDP_ForceIPvX);
+	if (IPvX != 4)
+		resolvers[count++] = freerdp_tcp_resolver_start(hostname, port, AF_INET6);
+	if (IPvX != 6)
+		resolvers[count++] = freerdp_tcp_resolver_start(hostname, port, AF_INET);
+
+	for (size_t x = 0; x < count; x++)
 	{
-		WLog_ERR(TAG, "WSAEventSelect failed with %d", WSAGetLastError());
-		goto fail;
+		if (!resolvers[x])
+			goto out;
 	}
 
-	handles[count++] = utils_get_abort_event(context->rdp);
-	status = _connect(sockfd, addr, addrlen);
-
-	if (status < 0)
+	const UINT64 start = GetTickCount64();
+	UINT64 deadline = (timeout > 0) ? start + timeout : UINT64_MAX;
+	size_t pending = count;
+	while (pending > 0)
 	{
-		status = WSAGetLastError();
+		HANDLE events[3] = { utils_get_abort_event(context->rdp) };
+		DWORD nevents = 1;
+		for (size_t x = 0; x < count; x++)
+		{
+			if (resolvers[x])
+				events[nevents++] = resolvers[x]->done;
+		}
+
+		const UINT64 now = GetTickCount64();
+		if (now >= deadline)
+			break;
+		const UINT64 left = deadline - now;
+		const DWORD wait = (left > INFINITE - 1) ? INFINITE : (DWORD)left;
 
-		switch (status)
+		const DWORD status = WaitForMultipleObjects(nevents, events, FALSE, wait);
+		if (status == WAIT_OBJECT_0)
 		{
-			case WSAEINPROGRESS:
-			case WSAEWOULDBLOCK:
-				break;
+			freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_CANCELLED);
+			break;
+		}
+		if (status >= WAIT_OBJECT_0 + nevents)
+			break;
+
+		for (size_t x = 0; x < count; x++)
+		{
+			if (resolvers[x] && (WaitForSingleObject(resolvers[x]->done, 0) == WAIT_OBJECT_0))
+			{
+				result = freerdp_tcp_addrinfo_append(result,
+				                                     freerdp_tcp_resolver_take(resolvers[x]));
+				freerdp_tcp_resolver_unref(resolvers[x]);
+				resolvers[x] = NULL;
+				pending--;
+			}
+		}
 
-			default:
-				goto fail;
+		if (result && (pending > 0))
+		{
+			const UINT64 delay = GetTickCount64() + TCP_RESOLUTION_DELAY_MS;
+			deadline = MIN(deadline, delay);
 		}
 	}
 
-	status = WaitForMultipleObjects(count, handles, FALSE, tout);
+out:
+	for (size_t x = 0; x < count; x++)
+		freerdp_tcp_resolver_unref(resolvers[x]);
+	return result;
+}
 
-	if (WAIT_OBJECT_0 != status)
-		goto fail;
+typedef struct
+{
+	SOCKET sockfd;
+	HANDLE event;
+	const struct addrinfo* addr;
+} rdpTcpAttempt;
 
-	status = recv(sockfd, NULL, 0, 0);
+static void freerdp_tcp_attempt_close(rdpTcpAttempt* attempt, BOOL closeSocket)
+{
+	WINPR_ASSERT(attempt);
 
-	if (status == SOCKET_ERROR)
+	if (attempt->sockfd != INVALID_SOCKET)
 	{
-		if (WSAGetLastError() == WSAECONNRESET)
-			goto fail;
+		(void)WSAEventSelect(attempt->sockfd, attempt->event, 0);
+		if (closeSocket)
+			closesocket(attempt->sockfd);
 	}
+	if (attempt->event)
+		(void)CloseHandle(attempt->event);
+	attempt->sockfd = INVALID_SOCKET;
+	attempt->event = NULL;
+}
 
-	status = WSAEventSelect(sockfd, handles[0], 0);
+static BOOL freerdp_tcp_attempt_start(rdpTcpAttempt* attempt, const struct addrinfo* addr,
+                                      BOOL* connected)
+{
+	WINPR_ASSERT(attempt);
+	WINPR_ASSERT(addr);
+	WINPR_ASSERT(connected);
+
+	*connected = FALSE;
+	attempt->addr = addr;
+	attempt->sockfd = _socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+	if (attempt->sockfd == INVALID_SOCKET)
+		return FALSE;
 
-	if (status < 0)
+	char* peerAddress =
+	    freerdp_tcp_address_to_string((const struct sockaddr_storage*)addr->ai_addr, NULL);
+	if (peerAddress)
 	{
-		WLog_ERR(TAG, "WSAEventSelect failed with %d", WSAGetLastError());
-		goto fail;
+		WLog_DBG(TAG, "connecting to peer %s", peerAddress);
+		free(peerAddress);
 	}
 
-	if (_ioctlsocket(sockfd, FIONBIO, &arg) != 0)
+	attempt->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!attempt->event ||
+	    (WSAEventSelect(attempt->sockfd, attempt->event, FD_WRITE | FD_CONNECT) < 0))
 		goto fail;
 
-	rc = TRUE;
+	if (_connect(attempt->sockfd, addr->ai_addr, (int)addr->ai_addrlen) == 0)
+	{
+		*connected = TRUE;
+		return TRUE;
+	}
+
+	const int error = WSAGetLastError();
+	if ((error == WSAEINPROGRESS) || (error == WSAEWOULDBLOCK))
+		return TRUE;
+
 fail:
-	(void)CloseHandle(handles[0]);
-	return rc;
+	freerdp_tcp_attempt_close(attempt, TRUE);
+	return FALSE;
+}
+
+static BOOL freerdp_tcp_attempt_connected(const rdpTcpAttempt* attempt)
+{
+	int error = 0;
+	socklen_t optlen = sizeof(error);
+
+	WINPR_ASSERT(attempt);
+	if (getsockopt(attempt->sockfd, SOL_SOCKET, SO_ERROR, (void*)&error, &optlen) != 0)
+		return FALSE;
+	return error == 0;
+}
+
+/* Alternates the address families, starting with the preferred one, per RFC 8305 section 4 */
+static size_t freerdp_tcp_sort_addresses(rdpContext* context, struct addrinfo* result,
+                                         const struct addrinfo** sorted, size_t size)
+{
+	size_t count = 0;
+	const struct addrinfo* first = result;
+
+	WINPR_ASSERT(context);
+	WINPR_ASSERT(sorted);
+
+	if (freerdp_settings_get_bool(context->settings, FreeRDP_PreferIPv6OverIPv4))
+	{
+		while (first && (first->ai_family != AF_INET6))
+			first = first->ai_next;
+		if (!first)
+			first = result;
+	}
+	if (!first)
+		return 0;
+
+	const struct addrinfo* cur[2] = { result, result };
+	const int families[2] = { first->ai_family,
+		                      (first->ai_family == AF_INET6) ? AF_INET : AF_INET6 };
+	BOOL more = TRUE;
+	while (more && (count < size))
+	{
+		more = FALSE;
+		for (size_t x = 0; (x < ARRAYSIZE(families)) && (count < size); x++)
+		{
+			while (cur[x] && (cur[x]->ai_family != families[x]))
+				cur[x] = cur[x]->ai_next;
+			if (!cur[x])
+				continue;
+
+			sorted[count++] = cur[x];
+			cur[x] = cur[x]->ai_next;
+			more = TRUE;
+		}
+	}
+	return count;
+}
+
+/**
+ * Connects to the first address that answers. A new attempt starts every
+ * TCP_CONNECTION_ATTEMPT_DELAY_MS or as soon as the previous one failed, so a broken IPv6 route
+ * or a dead first address does not hold up the connection.
+ */
+static SOCKET freerdp_tcp_connect_happy_eyeballs(rdpContext* context, struct addrinfo* result,
+                                                 DWORD timeout)
+{
+	const struct addrinfo* addresses[TCP_MAX_CONNECTION_ATTEMPTS] = { 0 };
+	rdpTcpAttempt attempts[TCP_MAX_CONNECTION_ATTEMPTS] = { 0 };
+	SOCKET sockfd = INVALID_SOCKET;
+	size_t active = 0;
+	size_t next = 0;
+
+	WINPR_ASSERT(context);
+
+	const size_t count =
+	    freerdp_tcp_sort_addresses(context, result, addresses, ARRAYSIZE(addresses));
+	if (count == 0)
+	{
+		freerdp_set_last_error_if_not(context, FREERDP_ERROR_DNS_NAME_NOT_FOUND);
+		return INVALID_SOCKET;
+	}
+
+	const UINT64 start = GetTickCount64();
+	UINT64 nextStart = start;
+	while ((sockfd == INVALID_SOCKET) && ((active > 0) || (next < count)))
+	{
+		const UINT64 now = GetTickCount64();
+		if ((timeout > 0) && (now - start >= timeout))
+			break;
+
+		if ((next < count) && (now >= nextStart))
+		{
+			BOOL connected = FALSE;
+			rdpTcpAttempt* attempt = &attempts[active];
+			if (!freerdp_tcp_attempt_start(attempt, addresses[next++], &connected))
+				continue;
+
+			active++;
+			nextStart = now + TCP_CONNECTION_ATTEMPT_DELAY_MS;
+			if (connected)
+			{
+				sockfd = attempt->sockfd;
+				freerdp_tcp_attempt_close(attempt, FALSE);
+				break;
+			}
+			continue;
+		}
+
+		HANDLE events[TCP_MAX_CONNECTION_ATTEMPTS + 1] = { utils_get_abort_event(context->rdp) };
+		for (size_t x = 0; x < active; x++)
+			events[x + 1] = attempts[x].event;
+
+		UINT64 wait = UINT64_MAX;
+		if (next < count)
+			wait = nextStart - now;
+		if (timeout > 0)
+			wait = MIN(wait, start + timeout - now);
+
+		const DWORD status = WaitForMultipleObjects((DWORD)active + 1, events, FALSE,
+		                                            (wait >= INFINITE) ? INFINITE : (DWORD)wait);
+		if (status == WAIT_TIMEOUT)
+			continue;
+		if (status == WAIT_OBJECT_0)
+		{
+			freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_CANCELLED);
+			break;
+		}
+		if ((status < WAIT_OBJECT_0 + 1) || (status > WAIT_OBJECT_0 + active))
+			break;
+
+		const size_t index = status - WAIT_OBJECT_0 - 1;
+		if (freerdp_tcp_attempt_connected(&attempts[index]))
+		{
+			sockfd = attempts[index].sockfd;
+			freerdp_tcp_attempt_close(&attempts[index], FALSE);
+			break;
+		}
+
+		/* failed, do not wait for the delay to try the next address */
+		freerdp_tcp_attempt_close(&attempts[index], TRUE);
+		attempts[index] = attempts[--active];
+		nextStart = GetTickCount64();
+	}
+
+	for (size_t x = 0; x < active; x++)
+		freerdp_tcp_attempt_close(&attempts[x], TRUE);
+
+	if (sockfd != INVALID_SOCKET)
+	{
+		u_long arg = 0;
+		if (_ioctlsocket(sockfd, FIONBIO, &arg) != 0)
+		{
+			closesocket(sockfd);
+			return INVALID_SOCKET;
+		}
+	}
+	return sockfd;
 }
 
 typedef struct
@@ -1060,63 +1862,117 @@ BOOL freerdp_tcp_set_keep_alive_mode(const rdpSettings* settings, int sockfd)
 	return TRUE;
 }
 
-int freerdp_tcp_connect(rdpContext* context, const char* hostname, int port, DWORD timeout)
+static void freerdp_tcp_set_buffer_size(int sockfd, int optname, const char* name, UINT32 size)
 {
-	rdpTransport* transport = NULL;
-	if (!context || !context->rdp)
-		return -1;
-	transport = context->rdp->transport;
-	if (!transport)
-		return -1;
-	return transport_tcp_connect(context->rdp->transport, hostname, port, timeout);
+	const int optval = (int)MIN(size, INT32_MAX);
+
+	if (setsockopt(sockfd, SOL_SOCKET, optname, (const void*)&optval, sizeof(optval)) < 0)
+		WLog_WARN(TAG, "setsockopt() SOL_SOCKET, %s", name);
 }
 
-static int get_next_addrinfo(rdpContext* context, struct addrinfo* input, struct addrinfo** result,
-                             UINT32 errorCode)
+BOOL freerdp_tcp_set_socket_profile(const rdpSettings* settings, int sockfd)
 {
-	WINPR_ASSERT(context);
-	WINPR_ASSERT(result);
-
-	struct addrinfo* addr = input;
-	if (!addr)
-		goto fail;
+	WINPR_ASSERT(settings);
 
-	if (freerdp_settings_get_bool(context->settings, FreeRDP_PreferIPv6OverIPv4))
+#ifdef TCP_NOTSENT_LOWAT
+	/* Keeps the kernel queue short, so frames wait in our queue where they can be skipped */
+	const UINT32 lowat = freerdp_settings_get_uint32(settings, FreeRDP_TcpNotSentLowat);
+	if (lowat > 0)
 	{
-		while (addr && (addr->ai_family != AF_INET6))
-			addr = addr->ai_next;
-		if (!addr)
-			addr = input;
+		const int optval = (int)MIN(lowat, INT32_MAX);
+		if (setsockopt(sockfd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (const void*)&optval,
+		               sizeof(optval)) < 0)
+			WLog_WARN(TAG, "setsockopt() IPPROTO_TCP, TCP_NOTSENT_LOWAT");
 	}
+#endif
 
-	/* We want to force IPvX, abort if not detected */
-	const UINT32 IPvX = freerdp_settings_get_uint32(context->settings, FreeRDP_ForceIPvX);
-	switch (IPvX)
+#ifdef SO_BUSY_POLL
+	const UINT32 busyPoll = freerdp_settings_get_uint32(settings, FreeRDP_TcpBusyPoll);
+	if (busyPoll > 0)
 	{
-		case 4:
-		case 6:
-		{
-			const int family = (IPvX == 4) ? AF_INET : AF_INET6;
-			while (addr && (addr->ai_family != family))
-				addr = addr->ai_next;
-			if (!addr)
-				goto fail;
-		}
-		break;
-		default:
-			break;
+		const int optval = (int)MIN(busyPoll, INT32_MAX);
+		if (setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, (const void*)&optval, sizeof(optval)) <
+		    0)
+			WLog_WARN(TAG, "setsockopt() SOL_SOCKET, SO_BUSY_POLL");
 	}
+#endif
 
-	if (!addr)
-		goto fail;
+	/* Fixed sizes turn the autotuning of the kernel off, 0 leaves it on */
+	const UINT32 sndbuf = freerdp_settings_get_uint32(settings, FreeRDP_TcpSendBufferSize);
+	if (sndbuf > 0)
+		freerdp_tcp_set_buffer_size(sockfd, SO_SNDBUF, "SO_SNDBUF", sndbuf);
 
-	*result = addr;
-	return 0;
+	const UINT32 rcvbuf = freerdp_settings_get_uint32(settings, FreeRDP_TcpReceiveBufferSize);
+	if (rcvbuf > 0)
+		freerdp_tcp_set_buffer_size(sockfd, SO_RCVBUF, "SO_RCVBUF", rcvbuf);
 
-fail:
-	freerdp_set_last_error_if_not(context, errorCode);
-	freeaddrinfo(input);
-	return -1;
+	return TRUE;
+}
+
+BOOL freerdp_tcp_set_bandwidth_delay(const rdpSettings* settings, int sockfd, UINT32 bandwidth,
+                                     UINT32 rtt)
+{
+	WINPR_ASSERT(settings);
+
+	if (!freerdp_settings_get_bool(settings, FreeRDP_TcpAdaptiveBuffers))
+		return TRUE;
+	if ((bandwidth == 0) || (rtt == 0))
+		return FALSE;
+
+	/* kbit/s * ms / 8 = bytes in flight, twice that leaves room for the kernel overhead */
+	const UINT64 bdp = 1ULL * bandwidth * rtt / 8;
+	const UINT32 size =
+	    (UINT32)MIN(MAX(2 * bdp, TCP_ADAPTIVE_BUFFER_MIN), TCP_ADAPTIVE_BUFFER_MAX);
+
+	WLog_DBG(TAG, "bandwidth %" PRIu32 " kbit/s, rtt %" PRIu32 " ms, socket buffers %" PRIu32,
+	         bandwidth, rtt, size);
+
+	if (freerdp_settings_get_uint32(settings, FreeRDP_TcpSendBufferSize) == 0)
+		freerdp_tcp_set_buffer_size(sockfd, SO_SNDBUF, "SO_SNDBUF", size);
+	if (freerdp_settings_get_uint32(settings, FreeRDP_TcpReceiveBufferSize) == 0)
+		freerdp_tcp_set_buffer_size(sockfd, SO_RCVBUF, "SO_RCVBUF", size);
+	return TRUE;
+}
+
+BOOL freerdp_tcp_get_info(int sockfd, UINT32* rtt, UINT32* rttVar, UINT32* mss,
+                          UINT32* retransmits)
+{
+	WINPR_ASSERT(rtt);
+	WINPR_ASSERT(rttVar);
+	WINPR_ASSERT(mss);
+	WINPR_ASSERT(retransmits);
+
+#if defined(__linux__) && defined(TCP_INFO)
+	struct tcp_info info = { 0 };
+	socklen_t length = sizeof(info);
+
+	if (getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &info, &length) != 0)
+		return FALSE;
+
+	/* tcpi_rtt is 0 until the first segment was acknowledged */
+	if ((length < sizeof(info)) || (info.tcpi_rtt == 0))
+		return FALSE;
+
+	*rtt = info.tcpi_rtt;
+	*rttVar = info.tcpi_rttvar;
+	*mss = info.tcpi_snd_mss;
+	*retransmits = info.tcpi_total_retrans;
+	return TRUE;
+#else
+	WINPR_UNUSED(sockfd);
+	return FALSE;
+#endif
+}
+
+int freerdp_tcp_connect(rdpContext* context, const char* hostname, int port, DWORD timeout)
+{
+	rdpTransport* transport = NULL;
+	if (!context || !context->rdp)
+		return -1;
+	transport = context->rdp->transport;
+	if (!transport)
+		return -1;
+	return transport_tcp_connect(context->rdp->transport, hostname, port, timeout);
 }
 
 int freerdp_tcp_default_connect(rdpContext* context, rdpSettings* settings, const char* hostname,
@@ -1194,10 +2050,23 @@ int freerdp_tcp_default_connect(rdpContext* context, rdpSettings* settings, cons
 	{
 		sockfd = -1;
 
+		struct addrinfo* result = freerdp_tcp_resolve_host_async(context, hostname, port, timeout);
+		if (WaitForSingleObject(utils_get_abort_event(context->rdp), 0) == WAIT_OBJECT_0)
+		{
+			if (result)
+				freeaddrinfo(result);
+			freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_CANCELLED);
+			return -1;
+		}
+
+		if (!result)
+			freerdp_set_last_error_if_not(context, FREERDP_ERROR_DNS_NAME_NOT_FOUND);
+		else
+			freerdp_set_last_error_log(context, 0);
+
 		if (!settings->GatewayEnabled)
 		{
-			if (!freerdp_tcp_is_hostname_resolvable(context, hostname) ||
-			    settings->RemoteAssistanceMode)
+			if (!result || settings->RemoteAssistanceMode)
 			{
 				if (settings->TargetNetAddressCount > 0)
 				{
@@ -1210,71 +2079,41 @@ int freerdp_tcp_default_connect(rdpContext* context, rdpSettings* settings, cons
 
 		if (sockfd <= 0)
 		{
-			char* peerAddress = NULL;
-			struct addrinfo* addr = NULL;
-			struct addrinfo* result = NULL;
-
-			result = freerdp_tcp_resolve_host(hostname, port, 0);
-
 			if (!result)
-			{
-				freerdp_set_last_error_if_not(context, FREERDP_ERROR_DNS_NAME_NOT_FOUND);
-
 				return -1;
-			}
-			freerdp_set_last_error_log(context, 0);
 
-			/* By default we take the first returned entry.
+			/* By default the family that resolved first is tried first.
 			 *
-			 * If PreferIPv6OverIPv4 = TRUE we force to IPv6 if there
-			 * is such an address available, but fall back to first if not found
+			 * If PreferIPv6OverIPv4 = TRUE we start with IPv6 if there
+			 * is such an address available
 			 */
-			const int rc =
-			    get_next_addrinfo(context, result, &addr, FREERDP_ERROR_DNS_NAME_NOT_FOUND);
-			if (rc < 0)
-				return rc;
-
-			do
-			{
-				sockfd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
-				if (sockfd < 0)
-				{
-					const int lrc = get_next_addrinfo(context, addr->ai_next, &addr,
-					                                  FREERDP_ERROR_CONNECT_FAILED);
-					if (lrc < 0)
-						return lrc;
-				}
-			} while (sockfd < 0);
-
-			if ((peerAddress = freerdp_tcp_address_to_string(
-			         (const struct sockaddr_storage*)addr->ai_addr, NULL)) != NULL)
-			{
-				WLog_DBG(TAG, "connecting to peer %s", peerAddress);
-				free(peerAddress);
-			}
+			sockfd = (int)freerdp_tcp_connect_happy_eyeballs(context, result, timeout);
+			freeaddrinfo(result);
 
-			if (!freerdp_tcp_connect_timeout(context, sockfd, addr->ai_addr, addr->ai_addrlen,
-			                                 timeout))
+			if (sockfd < 0)
 			{
-				freeaddrinfo(result);
-				close(sockfd);
-
 				freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_FAILED);
 
 				WLog_ERR(TAG, "failed to connect to %s", hostname);
 				return -1;
 			}
-
-			freeaddrinfo(result);
 		}
+		else if (result)
+			freeaddrinfo(result);
 	}
 
 	if (!vsock)
 	{
-		free(settings->ClientAddress);
-		settings->ClientAddress = freerdp_tcp_get_ip_address(sockfd, &settings->IPv6Enabled);
-
-		if (!settings->ClientAddress)
+		/* Gateway channels connect from several threads at once, swap the address atomically */
+		char* address = freerdp_tcp_get_ip_address(sockfd, &settings->IPv6Enabled);
+		PVOID old = settings->ClientAddress;
+		PVOID cur = NULL;
+		while ((cur = InterlockedCompareExchangePointer((PVOID*)&settings->ClientAddress,
+		                                                address, old)) != old)
+			old = cur;
+		free(old);
+
+		if (!address)
 		{
 			if (!useExternalDefinedSocket)
 				close(sockfd);
@@ -1317,7 +2156,8 @@ int freerdp_tcp_default_connect(rdpContext* context, rdpSettings* settings, cons
 
 	if (!ipcSocket && !useExternalDefinedSocket)
 	{
-		if (!freerdp_tcp_set_keep_alive_mode(settings, sockfd))
+		if (!freerdp_tcp_set_keep_alive_mode(settings, sockfd) ||
+		    !freerdp_tcp_set_socket_profile(settings, sockfd))
 		{
 			close(sockfd);
 
@@ -53,6 +53,20 @@
 #define BIO_C_WAIT_READ 1107
 #define BIO_C_WAIT_WRITE 1108
 #define BIO_C_SET_HANDLE 1109
+#define BIO_C_WRITE_VECTOR 1110
+#define BIO_C_SET_SEND_QUEUE_LIMIT 1111
+
+/* At most this many chunks are passed with BIO_C_WRITE_VECTOR */
+#define TRANSPORT_BIO_VECTOR_MAX 16
+
+/* BIO_C_WRITE_VECTOR returns 1 with sent set if the BIO sent the chunks as one, 0 if it can not
+ * and -1 on errors */
+typedef struct
+{
+	const DataChunk* chunks;
+	size_t count;
+	size_t sent;
+} TransportBioVector;
 
 static INLINE long BIO_set_socket(BIO* b, SOCKET* s, long c)
 {
@@ -78,6 +92,10 @@ static INLINE long BIO_read_blocked(BIO* b)
 {
 	return BIO_ctrl(b, BIO_C_READ_BLOCKED, 0, NULL);
 }
+static INLINE long BIO_set_send_queue_limit(BIO* b, long c)
+{
+	return BIO_ctrl(b, BIO_C_SET_SEND_QUEUE_LIMIT, c, NULL);
+}
 static INLINE long BIO_write_blocked(BIO* b)
 {
 	return BIO_ctrl(b, BIO_C_WRITE_BLOCKED, 0, NULL);
@@ -97,6 +115,19 @@ FREERDP_LOCAL BIO_METHOD* BIO_s_buffered_socket(void);
 
 FREERDP_LOCAL BOOL freerdp_tcp_set_keep_alive_mode(const rdpSettings* settings, int sockfd);
 
+/* Applies the TCP_NOTSENT_LOWAT, SO_BUSY_POLL and buffer size settings */
+FREERDP_LOCAL BOOL freerdp_tcp_set_socket_profile(const rdpSettings* settings, int sockfd);
+
+/* Sizes the socket buffers from the measured bandwidth in kbit/s and round trip time in ms if
+ * FreeRDP_TcpAdaptiveBuffers is set */
+FREERDP_LOCAL BOOL freerdp_tcp_set_bandwidth_delay(const rdpSettings* settings, int sockfd,
+                                                   UINT32 bandwidth, UINT32 rtt);
+
+/* Reads the kernel round trip time and variation in us, the segment size and the total number
+ * of retransmitted segments, FALSE where TCP_INFO is not available */
+FREERDP_LOCAL BOOL freerdp_tcp_get_info(int sockfd, UINT32* rtt, UINT32* rttVar, UINT32* mss,
+                                        UINT32* retransmits);
+
 FREERDP_LOCAL int freerdp_tcp_connect(rdpContext* context, const char* hostname, int port,
                                       DWORD timeout);
 
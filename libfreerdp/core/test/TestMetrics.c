@@ -0,0 +1,83 @@
+#include <stdio.h>
+
+#include <freerdp/freerdp.h>
+#include <freerdp/metrics.h>
+
+static BOOL test_metrics_channels(rdpMetrics* metrics)
+{
+	rdpMetricsStats stats = { 0 };
+
+	metrics_channel_bytes(metrics, 1004, "drdynvc", 100, 0);
+	metrics_channel_bytes(metrics, 1004, NULL, 0, 20);
+	metrics_channel_bytes(metrics, 1005, NULL, 7, 0);
+
+	if (!metrics_get_stats(metrics, &stats))
+		return FALSE;
+
+	if (stats.ChannelCount != 2)
+	{
+		printf("expected 2 channels, got %" PRIu32 "\n", stats.ChannelCount);
+		return FALSE;
+	}
+
+	const rdpMetricsChannel* channel = &stats.Channels[0];
+	if ((channel->ChannelId != 1004) || (strcmp(channel->Name, "drdynvc") != 0) ||
+	    (channel->In.Bytes != 100) || (channel->Out.Bytes != 20) || (channel->In.Count != 1) ||
+	    (channel->Out.Count != 1))
+	{
+		printf("channel 1004 statistics mismatch\n");
+		return FALSE;
+	}
+
+	return stats.Channels[1].In.Bytes == 7;
+}
+
+static BOOL test_metrics_histogram(rdpMetrics* metrics)
+{
+	rdpMetricsStats stats = { 0 };
+
+	metrics_codec_decode(metrics, 3, 10 * 1000ull);      /* 10us, first bucket */
+	metrics_codec_decode(metrics, 3, 100 * 1000ull);     /* 100us, below 128us */
+	metrics_codec_decode(metrics, 3, 10000000 * 1000ull); /* 10s, overflow bucket */
+	metrics_codec_decode(metrics, 200, 1000ull);          /* out of range, ignored */
+
+	if (!metrics_get_stats(metrics, &stats))
+		return FALSE;
+
+	const rdpMetricsHistogram* histogram = &stats.Decode[3];
+	if ((histogram->Count != 3) || (histogram->Buckets[0] != 1) || (histogram->Buckets[3] != 1) ||
+	    (histogram->Buckets[FREERDP_METRICS_HISTOGRAM_BUCKETS - 1] != 1) ||
+	    (histogram->MaxUs != 10000000))
+	{
+		printf("decode histogram mismatch\n");
+		return FALSE;
+	}
+
+	metrics_reset_stats(metrics);
+	if (!metrics_get_stats(metrics, &stats))
+		return FALSE;
+
+	return (stats.Decode[3].Count == 0) && (stats.ChannelCount == 0);
+}
+
+int TestMetrics(int argc, char* argv[])
+{
+	int rc = -1;
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	rdpMetrics* metrics = metrics_new(NULL);
+	if (!metrics)
+		return -1;
+
+	if (!test_metrics_channels(metrics))
+		goto fail;
+
+	if (!test_metrics_histogram(metrics))
+		goto fail;
+
+	rc = 0;
+fail:
+	metrics_free(metrics);
+	return rc;
+}
@@ -0,0 +1,350 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/thread.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/freerdp.h>
+
+#include "../rdpudp.h"
+
+#include <poll.h>
+
+#define TEST_RELIABLE_SIZE (512 * 1024)
+#define TEST_LOSSY_COUNT 200
+#define TEST_LOSSY_SIZE 1000
+#define TEST_DROP_EVERY 16
+#define TEST_TIMEOUT_MS 30000
+
+typedef struct
+{
+	int relay[2];
+	int server;
+	RDPUDP_MODE mode;
+	BOOL spoof;
+	BOOL spoofed;
+	volatile LONG stop;
+	volatile LONG done;
+	BOOL result;
+	size_t received;
+} TestRdpUdpContext;
+
+static BOOL test_socket_pair(int* a, int* b)
+{
+	struct sockaddr_in addr[2] = { 0 };
+
+	*a = socket(AF_INET, SOCK_DGRAM, 0);
+	*b = socket(AF_INET, SOCK_DGRAM, 0);
+	if ((*a < 0) || (*b < 0))
+		return FALSE;
+
+	for (size_t x = 0; x < 2; x++)
+	{
+		const int fd = (x == 0) ? *a : *b;
+		socklen_t len = sizeof(addr[x]);
+		addr[x].sin_family = AF_INET;
+		addr[x].sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		if (bind(fd, (struct sockaddr*)&addr[x], sizeof(addr[x])) != 0)
+			return FALSE;
+		if (getsockname(fd, (struct sockaddr*)&addr[x], &len) != 0)
+			return FALSE;
+	}
+
+	if (connect(*a, (struct sockaddr*)&addr[1], sizeof(addr[1])) != 0)
+		return FALSE;
+	return connect(*b, (struct sockaddr*)&addr[0], sizeof(addr[0])) == 0;
+}
+
+static UINT32 test_get_uint32_be(const BYTE* data)
+{
+	return ((UINT32)data[0] << 24) | ((UINT32)data[1] << 16) | ((UINT32)data[2] << 8) | data[3];
+}
+
+/* Send a FEC datagram with a coded sequence number far ahead of the data datagram in buffer */
+static BOOL test_spoof_datagram(int fd, const BYTE* buffer, size_t len)
+{
+	BYTE spoof[16] = { 0 };
+	size_t offset = 8;
+
+	if (len < offset)
+		return FALSE;
+
+	const UINT16 flags = (UINT16)((buffer[6] << 8) | buffer[7]);
+	if (!(flags & 0x0008)) /* RDPUDP_FLAG_DATA */
+		return FALSE;
+
+	if (flags & 0x0004) /* RDPUDP_FLAG_ACK, skip the ack vector */
+	{
+		if (len < offset + 2)
+			return FALSE;
+		const size_t count = ((size_t)buffer[offset] << 8) | buffer[offset + 1];
+		offset += 2 + count + (4 - ((2 + count) % 4)) % 4;
+	}
+	if (flags & 0x0100) /* RDPUDP_FLAG_AOA */
+		offset += 4;
+	if (len < offset + 8)
+		return FALSE;
+
+	const UINT32 coded = test_get_uint32_be(&buffer[offset]) + 0x7FFFFFF0;
+
+	memcpy(spoof, buffer, 6);
+	spoof[7] = 0x10; /* RDPUDP_FLAG_FEC */
+	spoof[8] = (BYTE)(coded >> 24);
+	spoof[9] = (BYTE)(coded >> 16);
+	spoof[10] = (BYTE)(coded >> 8);
+	spoof[11] = (BYTE)coded;
+	memcpy(&spoof[12], &buffer[offset + 4], 4);
+	return send(fd, spoof, sizeof(spoof), 0) == sizeof(spoof);
+}
+
+static DWORD WINAPI test_relay_thread(LPVOID arg)
+{
+	TestRdpUdpContext* ctx = arg;
+	size_t count = 0;
+
+	while (!InterlockedCompareExchange(&ctx->stop, 0, 0))
+	{
+		struct pollfd fds[2] = { { ctx->relay[0], POLLIN, 0 }, { ctx->relay[1], POLLIN, 0 } };
+		if (poll(fds, 2, 50) <= 0)
+			continue;
+
+		for (size_t x = 0; x < 2; x++)
+		{
+			BYTE buffer[2048];
+			if (!(fds[x].revents & POLLIN))
+				continue;
+
+			const ssize_t len = recv(ctx->relay[x], buffer, sizeof(buffer), 0);
+			if (len <= 0)
+				continue;
+			if ((++count % TEST_DROP_EVERY) == 0)
+				continue;
+			if (ctx->spoof && !ctx->spoofed && (x == 0) && (count > TEST_DROP_EVERY))
+				ctx->spoofed = test_spoof_datagram(ctx->relay[1], buffer, (size_t)len);
+			(void)send(ctx->relay[1 - x], buffer, (size_t)len, 0);
+		}
+	}
+
+	return 0;
+}
+
+static BYTE test_pattern(size_t offset)
+{
+	return (BYTE)((offset * 31) ^ (offset >> 8));
+}
+
+static BOOL test_server_receive(TestRdpUdpContext* ctx, rdpUdp* udp)
+{
+	BYTE buffer[4096];
+
+	for (;;)
+	{
+		const int len = rdpudp_read(udp, buffer, sizeof(buffer));
+		if (len <= 0)
+			return len == 0;
+
+		if (ctx->mode == RDPUDP_MODE_LOSSY)
+		{
+			if (len != TEST_LOSSY_SIZE)
+				return FALSE;
+			for (size_t x = 1; x < TEST_LOSSY_SIZE; x++)
+			{
+				if (buffer[x] != test_pattern(buffer[0] + x))
+					return FALSE;
+			}
+			ctx->received++;
+		}
+		else
+		{
+			for (int x = 0; x < len; x++)
+			{
+				if (buffer[x] != test_pattern(ctx->received + (size_t)x))
+					return FALSE;
+			}
+			ctx->received += (size_t)len;
+		}
+	}
+}
+
+static DWORD WINAPI test_server_thread(LPVOID arg)
+{
+	TestRdpUdpContext* ctx = arg;
+	UINT64 last = 0;
+	size_t count = 0;
+
+	rdpUdp* udp = rdpudp_new(ctx->server, TRUE, RDPUDP_MODE_RELIABLE, NULL, NULL);
+	if (!udp || !rdpudp_connect(udp, TEST_TIMEOUT_MS))
+		goto fail;
+
+	while (!InterlockedCompareExchange(&ctx->stop, 0, 0))
+	{
+		(void)WaitForSingleObject(rdpudp_get_event(udp), MIN(rdpudp_get_timeout(udp), 50));
+		if (!rdpudp_check(udp) || !test_server_receive(ctx, udp))
+			goto fail;
+
+		if (InterlockedCompareExchange(&ctx->done, 0, 0))
+			continue;
+
+		if (ctx->mode == RDPUDP_MODE_RELIABLE)
+		{
+			if (ctx->received == TEST_RELIABLE_SIZE)
+				ctx->result = TRUE;
+		}
+		else if (ctx->received > 0)
+		{
+			/* the lossy mode never repeats, done once nothing arrived for a while */
+			if (ctx->received != count)
+			{
+				count = ctx->received;
+				last = GetTickCount64();
+			}
+			else if (GetTickCount64() - last > 1000)
+			{
+				ctx->result = (ctx->received < TEST_LOSSY_COUNT);
+				(void)InterlockedExchange(&ctx->done, 1);
+			}
+		}
+
+		if (ctx->result)
+			(void)InterlockedExchange(&ctx->done, 1);
+	}
+
+	rdpudp_free(udp);
+	return 0;
+fail:
+	(void)fprintf(stderr, "[%s] server failed after %" PRIuz " received\n", __func__,
+	              ctx->received);
+	if (udp)
+		rdpudp_free(udp);
+	else
+		closesocket((SOCKET)ctx->server);
+	(void)InterlockedExchange(&ctx->done, 1);
+	return 1;
+}
+
+static BOOL test_client_write(rdpUdp* udp, RDPUDP_MODE mode, size_t* sent)
+{
+	BYTE buffer[4096];
+
+	if (mode == RDPUDP_MODE_LOSSY)
+	{
+		while (*sent < TEST_LOSSY_COUNT)
+		{
+			for (size_t x = 0; x < TEST_LOSSY_SIZE; x++)
+				buffer[x] = test_pattern((BYTE)*sent + x);
+			buffer[0] = (BYTE)*sent;
+
+			const int status = rdpudp_write(udp, buffer, TEST_LOSSY_SIZE);
+			if (status < 0)
+				return FALSE;
+			if (status == 0)
+				return TRUE;
+			(*sent)++;
+		}
+		return TRUE;
+	}
+
+	while (*sent < TEST_RELIABLE_SIZE)
+	{
+		const size_t len = MIN(sizeof(buffer), TEST_RELIABLE_SIZE - *sent);
+		for (size_t x = 0; x < len; x++)
+			buffer[x] = test_pattern(*sent + x);
+
+		const int status = rdpudp_write(udp, buffer, len);
+		if (status < 0)
+			return FALSE;
+		if (status == 0)
+			return TRUE;
+		*sent += (size_t)status;
+	}
+	return TRUE;
+}
+
+static BOOL test_transfer(RDPUDP_MODE mode, BOOL spoof)
+{
+	BOOL rc = FALSE;
+	int client = -1;
+	size_t sent = 0;
+	HANDLE relay = NULL;
+	HANDLE server = NULL;
+	rdpUdp* udp = NULL;
+	TestRdpUdpContext ctx = { 0 };
+
+	ctx.mode = mode;
+	ctx.spoof = spoof;
+	ctx.relay[0] = ctx.relay[1] = ctx.server = -1;
+	if (!test_socket_pair(&client, &ctx.relay[0]) || !test_socket_pair(&ctx.server, &ctx.relay[1]))
+		goto fail;
+
+	relay = CreateThread(NULL, 0, test_relay_thread, &ctx, 0, NULL);
+	server = CreateThread(NULL, 0, test_server_thread, &ctx, 0, NULL);
+	if (!relay || !server)
+		goto fail;
+
+	udp = rdpudp_new(client, FALSE, mode, NULL, NULL);
+	if (!udp)
+		goto fail;
+	client = -1;
+	if (!rdpudp_connect(udp, TEST_TIMEOUT_MS))
+		goto fail;
+
+	if (rdpudp_get_max_payload(udp) < TEST_LOSSY_SIZE)
+		goto fail;
+
+	const UINT64 start = GetTickCount64();
+	while (!InterlockedCompareExchange(&ctx.done, 0, 0))
+	{
+		if (GetTickCount64() - start > TEST_TIMEOUT_MS)
+			goto fail;
+		if (!test_client_write(udp, mode, &sent))
+			goto fail;
+		(void)WaitForSingleObject(rdpudp_get_event(udp), MIN(rdpudp_get_timeout(udp), 50));
+		if (!rdpudp_check(udp))
+			goto fail;
+	}
+
+	rc = ctx.result && (ctx.spoofed == spoof);
+	(void)fprintf(stderr, "[%s] %s mode, %" PRIuz " sent, %" PRIuz " received, rtt %" PRIu32 "\n",
+	              __func__, (mode == RDPUDP_MODE_LOSSY) ? "lossy" : "reliable", sent,
+	              ctx.received, rdpudp_get_rtt(udp));
+fail:
+	(void)InterlockedExchange(&ctx.stop, 1);
+	if (server)
+	{
+		(void)WaitForSingleObject(server, INFINITE);
+		(void)CloseHandle(server);
+	}
+	else if (ctx.server >= 0)
+		closesocket((SOCKET)ctx.server);
+	if (relay)
+	{
+		(void)WaitForSingleObject(relay, INFINITE);
+		(void)CloseHandle(relay);
+	}
+	rdpudp_free(udp);
+	if (client >= 0)
+		closesocket((SOCKET)client);
+	for (size_t x = 0; x < 2; x++)
+	{
+		if (ctx.relay[x] >= 0)
+			closesocket((SOCKET)ctx.relay[x]);
+	}
+	return rc;
+}
+
+int TestRdpUdp(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_transfer(RDPUDP_MODE_RELIABLE, FALSE))
+		return -1;
+	if (!test_transfer(RDPUDP_MODE_LOSSY, FALSE))
+		return -1;
+	/* a datagram with a sequence number far ahead must neither stall nor hang the receiver */
+	if (!test_transfer(RDPUDP_MODE_RELIABLE, TRUE))
+		return -1;
+	return 0;
+}
@@ -49,6 +49,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_DrawGdiPlusEnabled,
 	FreeRDP_DrawNineGridEnabled,
 	FreeRDP_DumpRemoteFx,
+	FreeRDP_DynamicChannelCompression,
 	FreeRDP_DynamicDaylightTimeDisabled,
 	FreeRDP_DynamicResolutionUpdate,
 	FreeRDP_EmbeddedWindow,
@@ -58,6 +59,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_ExternalCertificateManagement,
 	FreeRDP_FIPSMode,
 	FreeRDP_FastPathInput,
+	FreeRDP_FastPathInputBatching,
 	FreeRDP_FastPathOutput,
 	FreeRDP_ForceEncryptedCsPdu,
 	FreeRDP_ForceMultimon,
@@ -76,6 +78,8 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_GfxAVC444,
 	FreeRDP_GfxAVC444v2,
 	FreeRDP_GfxH264,
+	FreeRDP_GfxH264DmaBuf,
+	FreeRDP_GfxParallelDecode,
 	FreeRDP_GfxPlanar,
 	FreeRDP_GfxProgressive,
 	FreeRDP_GfxProgressiveV2,
@@ -83,6 +87,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_GfxSmallCache,
 	FreeRDP_GfxSuspendFrameAck,
 	FreeRDP_GfxThinClient,
+	FreeRDP_GfxZeroCopyOutput,
 	FreeRDP_GrabKeyboard,
 	FreeRDP_GrabMouse,
 	FreeRDP_HasExtendedMouseEvent,
@@ -110,6 +115,7 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_MstscCookieMode,
 	FreeRDP_MultiTouchGestures,
 	FreeRDP_MultiTouchInput,
+	FreeRDP_MultitransportUdp,
 	FreeRDP_NSCodec,
 	FreeRDP_NSCodecAllowDynamicColorFidelity,
 	FreeRDP_NSCodecAllowSubsampling,
@@ -180,12 +186,16 @@ static const size_t bool_list_indices[] = {
 	FreeRDP_SuspendInput,
 	FreeRDP_SynchronousDynamicChannels,
 	FreeRDP_SynchronousStaticChannels,
+	FreeRDP_TcpAdaptiveBuffers,
 	FreeRDP_TcpKeepAlive,
+	FreeRDP_TlsKernelOffload,
 	FreeRDP_TlsSecurity,
 	FreeRDP_ToggleFullscreen,
 	FreeRDP_TransportDump,
 	FreeRDP_TransportDumpReplay,
 	FreeRDP_TransportDumpReplayNodelay,
+	FreeRDP_TransportIoUring,
+	FreeRDP_TransportSendQueue,
 	FreeRDP_UnicodeInput,
 	FreeRDP_UnmapButtons,
 	FreeRDP_UseCommonStdioCallbacks,
@@ -218,6 +228,8 @@ static const size_t uint16_list_indices[] = {
 #define have_uint32_list_indices
 static const size_t uint32_list_indices[] = {
 	FreeRDP_AcceptedCertLength,
+	FreeRDP_AudioEncoderBitrate,
+	FreeRDP_AudioEncoderComplexity,
 	FreeRDP_AuthenticationLevel,
 	FreeRDP_AutoReconnectMaxRetries,
 	FreeRDP_BitmapCacheV2NumCells,
@@ -234,6 +246,7 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_ColorDepth,
 	FreeRDP_ColorPointerCacheSize,
 	FreeRDP_CompDeskSupportLevel,
+	FreeRDP_CompressionEffort,
 	FreeRDP_CompressionLevel,
 	FreeRDP_ConnectionType,
 	FreeRDP_CookieMaxLength,
@@ -335,10 +348,15 @@ static const size_t uint32_list_indices[] = {
 	FreeRDP_SurfaceCommandsSupported,
 	FreeRDP_TargetNetAddressCount,
 	FreeRDP_TcpAckTimeout,
+	FreeRDP_TcpBusyPoll,
 	FreeRDP_TcpConnectTimeout,
 	FreeRDP_TcpKeepAliveDelay,
 	FreeRDP_TcpKeepAliveInterval,
 	FreeRDP_TcpKeepAliveRetries,
+	FreeRDP_TcpNotSentLowat,
+	FreeRDP_TcpReceiveBufferSize,
+	FreeRDP_TcpSendBufferSize,
+	FreeRDP_TcpSendQueueLimit,
 	FreeRDP_ThreadingFlags,
 	FreeRDP_TlsSecLevel,
 	FreeRDP_VCChunkSize,
@@ -378,6 +396,7 @@ static const size_t string_list_indices[] = {
 	FreeRDP_ComputerName,
 	FreeRDP_ConfigPath,
 	FreeRDP_ConnectionFile,
+	FreeRDP_ConnectionTraceFile,
 	FreeRDP_ContainerName,
 	FreeRDP_CspName,
 	FreeRDP_CurrentPath,
@@ -449,6 +468,7 @@ static const size_t string_list_indices[] = {
 	FreeRDP_SspiModule,
 	FreeRDP_TargetNetAddress,
 	FreeRDP_TerminalDescriptor,
+	FreeRDP_ThreadAffinity,
 	FreeRDP_TlsSecretsFile,
 	FreeRDP_TransportDumpFile,
 	FreeRDP_UserSpecifiedServerName,
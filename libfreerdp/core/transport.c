@@ -52,10 +52,13 @@
 #include "fastpath.h"
 #include "transport.h"
 #include "rdp.h"
+#include "probes.h"
 #include "proxy.h"
 #include "utils.h"
 #include "state.h"
 #include "childsession.h"
+#include "handshake.h"
+#include "uring.h"
 
 #include "gateway/rdg.h"
 #include "gateway/wst.h"
@@ -65,6 +68,46 @@
 
 #define BUFFER_SIZE 16384
 
+/* Four full TLS records */
+#define TRANSPORT_CORK_MAX (4 * 16384)
+
+typedef struct s_transport_send_entry TransportSendEntry;
+
+struct s_transport_send_entry
+{
+	TransportSendEntry* next;
+	size_t length;
+};
+
+/* Credit in bytes a backlogged class gets per round, the high class always goes first */
+#define TRANSPORT_SEND_QUANTUM 16384
+
+/* Producers push lock free onto one stack per priority, the sender thread takes whole
+ * stacks and restores their order */
+typedef struct
+{
+	rdpTransport* transport;
+	LONG refs; /* held by the transport and by every producer using the queue */
+	HANDLE thread;
+	HANDLE event;
+	HANDLE space;
+	LONG pending;
+	LONG stop;
+	LONG failed;
+	LONG queued;
+	LONG limit;
+	TransportSendEntry* volatile heads[TRANSPORT_PRIORITY_COUNT];
+
+	/* A producer whose PDUs the sender thread builds itself, ahead of the queued ones */
+	TransportSendSource source;
+	void* sourceArg;
+	LONG sourcePending;
+
+	/* Deficit round robin below the high class, only touched by the sender thread */
+	size_t turn;
+	size_t deficit[TRANSPORT_PRIORITY_COUNT];
+} TransportSendQueue;
+
 struct rdp_transport
 {
 	TRANSPORT_LAYER layer;
@@ -95,6 +138,9 @@ struct rdp_transport
 	HANDLE ioEvent;
 	BOOL useIoEvent;
 	BOOL earlyUserAuth;
+	UINT32 corked;
+	wStream* corkBuffer;
+	TransportSendQueue* sendQueue;
 };
 
 static void transport_ssl_cb(const SSL* ssl, int where, int ret)
@@ -190,9 +236,25 @@ static BOOL transport_default_attach(rdpTransport* transport, int sockfd)
 
 	if (sockfd >= 0)
 	{
-		if (!freerdp_tcp_set_keep_alive_mode(settings, sockfd))
+		if (!freerdp_tcp_set_keep_alive_mode(settings, sockfd) ||
+		    !freerdp_tcp_set_socket_profile(settings, sockfd))
 			goto fail;
 
+		/* Without io_uring support in the kernel the socket BIO is used */
+		if (freerdp_settings_get_bool(settings, FreeRDP_TransportIoUring))
+		{
+			rdpTransportLayer* layer = freerdp_uring_layer_new(transport, sockfd);
+			if (layer)
+			{
+				if (!transport_attach_layer(transport, layer))
+				{
+					transport_layer_free(layer);
+					return FALSE;
+				}
+				return TRUE;
+			}
+		}
+
 		socketBio = BIO_new(BIO_s_simple_socket());
 
 		if (!socketBio)
@@ -216,6 +278,8 @@ static BOOL transport_default_attach(rdpTransport* transport, int sockfd)
 		 */
 		BIO_set_fd(socketBio, sockfd, BIO_CLOSE);
 	}
+	const UINT32 queueLimit = freerdp_settings_get_uint32(settings, FreeRDP_TcpSendQueueLimit);
+	BIO_set_send_queue_limit(bufferedBio, (long)queueLimit);
 	transport->frontBio = bufferedBio;
 	return TRUE;
 fail:
@@ -309,7 +373,10 @@ static BOOL transport_default_connect_tls(rdpTransport* transport)
 		tls->port = 3389;
 
 	tls->isGatewayTransport = FALSE;
+	tls->sessionCache = context->rdp->tlsSessions;
+	conntrace_begin(context->rdp->conntrace, "TLS handshake");
 	tlsStatus = freerdp_tls_connect(tls, transport->frontBio);
+	conntrace_end(context->rdp->conntrace, "TLS handshake");
 
 	if (tlsStatus < 1)
 	{
@@ -390,7 +457,11 @@ BOOL transport_connect_nla(rdpTransport* transport, BOOL earlyUserAuth)
 			return FALSE;
 	}
 
-	if (nla_client_begin(rdp->nla) < 0)
+	/* Includes the Kerberos ticket requests of the first token */
+	conntrace_begin(rdp->conntrace, "NLA first token");
+	const int nlaStatus = nla_client_begin(rdp->nla);
+	conntrace_end(rdp->conntrace, "NLA first token");
+	if (nlaStatus < 0)
 	{
 		WLog_Print(transport->log, WLOG_ERROR, "NLA begin failed");
 
@@ -465,7 +536,10 @@ BOOL transport_connect_aad(rdpTransport* transport)
 
 	transport_set_aad_mode(transport, TRUE);
 
-	if (aad_client_begin(rdp->aad) < 0)
+	conntrace_begin(rdp->conntrace, "AAD token request");
+	const int aadStatus = aad_client_begin(rdp->aad);
+	conntrace_end(rdp->conntrace, "AAD token request");
+	if (aadStatus < 0)
 	{
 		WLog_Print(transport->log, WLOG_ERROR, "AAD begin failed");
 
@@ -493,6 +567,10 @@ BOOL transport_connect(rdpTransport* transport, const char* hostname, UINT16 por
 
 	rpcFallback = !settings->GatewayHttpTransport;
 
+	/* Gateways include their own TLS, HTTP authentication and tunnel setup */
+	const char* phase = transport->GatewayEnabled ? "gateway connect" : "TCP connect";
+	conntrace_begin(context->rdp->conntrace, phase);
+
 	if (transport->GatewayEnabled)
 	{
 		if (settings->GatewayUrl)
@@ -603,6 +681,8 @@ BOOL transport_connect(rdpTransport* transport, const char* hostname, UINT16 por
 		status = TRUE;
 	}
 
+	if (status)
+		conntrace_end(context->rdp->conntrace, phase);
 	return status;
 }
 
@@ -643,15 +723,37 @@ static BOOL transport_default_accept_tls(rdpTransport* transport)
 	settings = context->settings;
 	WINPR_ASSERT(settings);
 
+	/* The private key operation is the expensive part of accepting a client, cap how many
+	 * run at the same time so a connection storm does not starve established sessions.
+	 * Rejected before creating the TLS layer, which would take over the socket BIO. */
+	rdpHandshakePool* pool = context->peer ? context->peer->HandshakePool : NULL;
+	if (!handshake_pool_enter(pool))
+		return FALSE;
+
 	if (!transport->tls)
 		transport->tls = freerdp_tls_new(context);
 
 	transport->layer = TRANSPORT_LAYER_TLS;
 
-	if (!freerdp_tls_accept(transport->tls, transport->frontBio, settings))
+	/* The server negotiation reads blocking, which would wait for a stalled client forever
+	 * while it holds the slot. Poll the handshake against the pool deadline instead. */
+	const BOOL deadline = handshake_pool_timeout(pool) > 0;
+	if (deadline && !transport_set_blocking_mode(transport, FALSE))
+	{
+		handshake_pool_leave(pool);
+		return FALSE;
+	}
+
+	conntrace_begin(context->rdp->conntrace, "TLS handshake");
+	const BOOL rc = freerdp_tls_accept(transport->tls, transport->frontBio, settings);
+	conntrace_end(context->rdp->conntrace, "TLS handshake");
+	handshake_pool_leave(pool);
+	if (!rc)
 		return FALSE;
 
 	transport->frontBio = transport->tls->bio;
+	if (deadline)
+		return transport_set_blocking_mode(transport, TRUE);
 	return TRUE;
 }
 
@@ -893,7 +995,9 @@ int transport_read_pdu(rdpTransport* transport, wStream* s)
 {
 	if (!transport)
 		return -1;
-	return IFCALLRESULT(-1, transport->io.ReadPdu, transport, s);
+	const int rc = IFCALLRESULT(-1, transport->io.ReadPdu, transport, s);
+	FREERDP_PROBE2(transport_read, rc, Stream_GetPosition(s));
+	return rc;
 }
 
 static SSIZE_T parse_nla_mode_pdu(rdpTransport* transport, wStream* stream)
@@ -1128,50 +1232,26 @@ static int transport_default_read_pdu(rdpTransport* transport, wStream* s)
 
 int transport_write(rdpTransport* transport, wStream* s)
 {
-	if (!transport)
-		return -1;
-
-	return IFCALLRESULT(-1, transport->io.WritePdu, transport, s);
+	return transport_write_ex(transport, s, TRANSPORT_PRIORITY_NORMAL);
 }
 
-static int transport_default_write(rdpTransport* transport, wStream* s)
+/* Called with the WriteLock held */
+static int transport_write_bio(rdpTransport* transport, const BYTE* data, size_t length)
 {
-	size_t length = 0;
 	int status = -1;
-	int writtenlength = 0;
-	rdpRdp* rdp = NULL;
 	rdpContext* context = transport_get_context(transport);
 
 	WINPR_ASSERT(transport);
 	WINPR_ASSERT(context);
+	WINPR_ASSERT(data || (length == 0));
 
-	if (!s)
-		return -1;
-
-	Stream_AddRef(s);
-
-	rdp = context->rdp;
-	if (!rdp)
-		goto fail;
-
-	EnterCriticalSection(&(transport->WriteLock));
 	if (!transport->frontBio)
-		goto out_cleanup;
-
-	length = Stream_GetPosition(s);
-	writtenlength = length;
-	Stream_SetPosition(s, 0);
-
-	if (length > 0)
-	{
-		rdp->outBytes += length;
-		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
-	}
+		return -1;
 
 	while (length > 0)
 	{
 		ERR_clear_error();
-		status = BIO_write(transport->frontBio, Stream_ConstPointer(s), length);
+		status = BIO_write(transport->frontBio, data, (int)MIN(length, INT32_MAX));
 
 		if (status <= 0)
 		{
@@ -1182,21 +1262,20 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 			if (!BIO_should_retry(transport->frontBio))
 			{
 				WLog_ERR_BIO(transport, "BIO_should_retry", transport->frontBio);
-				goto out_cleanup;
+				return -1;
 			}
 
-			/* non-blocking can live with blocked IOs */
-			if (!transport->blocking)
+			/* non-blocking can live with blocked IOs, but not with a full send queue */
+			if (!transport->blocking && !BIO_write_blocked(transport->frontBio))
 			{
 				WLog_ERR_BIO(transport, "BIO_write", transport->frontBio);
-				goto out_cleanup;
+				return -1;
 			}
 
 			if (BIO_wait_write(transport->frontBio, 100) < 0)
 			{
 				WLog_ERR_BIO(transport, "BIO_wait_write", transport->frontBio);
-				status = -1;
-				goto out_cleanup;
+				return -1;
 			}
 
 			continue;
@@ -1210,24 +1289,99 @@ static int transport_default_write(rdpTransport* transport, wStream* s)
 				if (BIO_wait_write(transport->frontBio, 100) < 0)
 				{
 					WLog_Print(transport->log, WLOG_ERROR, "error when selecting for write");
-					status = -1;
-					goto out_cleanup;
+					return -1;
 				}
 
 				if (BIO_flush(transport->frontBio) < 1)
 				{
 					WLog_Print(transport->log, WLOG_ERROR, "error when flushing outputBuffer");
-					status = -1;
-					goto out_cleanup;
+					return -1;
 				}
 			}
 		}
 
-		length -= status;
-		Stream_Seek(s, status);
+		length -= (size_t)status;
+		data += status;
+	}
+
+	return status;
+}
+
+/* Called with the WriteLock held */
+static int transport_write_cork_buffer(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	if (!transport->corkBuffer || (Stream_GetPosition(transport->corkBuffer) == 0))
+		return 0;
+
+	const size_t length = Stream_GetPosition(transport->corkBuffer);
+	Stream_SetPosition(transport->corkBuffer, 0);
+	return transport_write_bio(transport, Stream_Buffer(transport->corkBuffer), length);
+}
+
+static int transport_default_write(rdpTransport* transport, wStream* s)
+{
+	size_t length = 0;
+	int status = -1;
+	int writtenlength = 0;
+	rdpRdp* rdp = NULL;
+	rdpContext* context = transport_get_context(transport);
+
+	WINPR_ASSERT(transport);
+	WINPR_ASSERT(context);
+
+	if (!s)
+		return -1;
+
+	Stream_AddRef(s);
+
+	rdp = context->rdp;
+	if (!rdp)
+		goto fail;
+
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->frontBio)
+		goto out_cleanup;
+
+	length = Stream_GetPosition(s);
+	writtenlength = length;
+	Stream_SetPosition(s, 0);
+
+	if (length > 0)
+	{
+		rdp->outBytes += length;
+		WLog_Packet(transport->log, WLOG_TRACE, Stream_Buffer(s), length, WLOG_PACKET_OUTBOUND);
+	}
+
+	if ((transport->corked > 0) && (length > 0))
+	{
+		wStream* cork = transport->corkBuffer;
+
+		/* Keep the corked data below a few full TLS records, larger PDUs go out directly */
+		if (Stream_GetPosition(cork) + length > TRANSPORT_CORK_MAX)
+		{
+			if (transport_write_cork_buffer(transport) < 0)
+				goto out_cleanup;
+		}
+
+		if (length <= TRANSPORT_CORK_MAX)
+		{
+			Stream_Write(cork, Stream_Buffer(s), length);
+			Stream_Seek(s, length);
+			transport->written += writtenlength;
+			status = writtenlength;
+			goto out_cleanup;
+		}
+	}
+
+	status = transport_write_bio(transport, Stream_ConstPointer(s), length);
+	if (status >= 0)
+	{
+		Stream_Seek(s, length);
+		transport->written += writtenlength;
 	}
 
-	transport->written += writtenlength;
 out_cleanup:
 
 	if (status < 0)
@@ -1243,6 +1397,483 @@ fail:
 	return status;
 }
 
+/* Called with the WriteLock held */
+static BOOL transport_cork_locked(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	if (!transport->corkBuffer)
+		transport->corkBuffer = Stream_New(NULL, TRANSPORT_CORK_MAX);
+
+	const BOOL rc = transport->corkBuffer != NULL;
+	if (rc)
+		transport->corked++;
+	return rc;
+}
+
+/* Called with the WriteLock held */
+static BOOL transport_uncork_locked(rdpTransport* transport)
+{
+	int status = 0;
+
+	WINPR_ASSERT(transport);
+
+	/* The send queue drops the cork of writers that were corked when it started */
+	if (transport->corked == 0)
+		return TRUE;
+
+	if (--transport->corked == 0)
+	{
+		status = transport_write_cork_buffer(transport);
+		if (status < 0)
+		{
+			transport->layer = TRANSPORT_LAYER_CLOSED;
+			freerdp_set_last_error_if_not(transport->context,
+			                              FREERDP_ERROR_CONNECT_TRANSPORT_FAILED);
+		}
+	}
+	return status >= 0;
+}
+
+static BOOL transport_cork_int(rdpTransport* transport)
+{
+	EnterCriticalSection(&(transport->WriteLock));
+	const BOOL rc = transport_cork_locked(transport);
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+static BOOL transport_uncork_int(rdpTransport* transport)
+{
+	EnterCriticalSection(&(transport->WriteLock));
+	const BOOL rc = transport_uncork_locked(transport);
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+BOOL transport_cork(rdpTransport* transport)
+{
+	BOOL rc = TRUE;
+
+	WINPR_ASSERT(transport);
+
+	/* With a send queue its thread batches whatever piled up, it owns the cork */
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->sendQueue)
+		rc = transport_cork_locked(transport);
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+BOOL transport_uncork(rdpTransport* transport)
+{
+	BOOL rc = TRUE;
+
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->sendQueue)
+		rc = transport_uncork_locked(transport);
+	LeaveCriticalSection(&(transport->WriteLock));
+	return rc;
+}
+
+static void transport_send_queue_collect(TransportSendQueue* queue, TransportSendEntry** first,
+                                         TransportSendEntry** last)
+{
+	WINPR_ASSERT(queue);
+
+	for (size_t x = 0; x < TRANSPORT_PRIORITY_COUNT; x++)
+	{
+		if (!queue->heads[x])
+			continue;
+
+		TransportSendEntry* entry = NULL;
+		do
+		{
+			entry = queue->heads[x];
+		} while (InterlockedCompareExchangePointer((PVOID volatile*)&queue->heads[x], NULL,
+		                                           entry) != entry);
+
+		TransportSendEntry* reversed = NULL;
+		TransportSendEntry* tail = entry;
+
+		while (entry)
+		{
+			TransportSendEntry* next = entry->next;
+			entry->next = reversed;
+			reversed = entry;
+			entry = next;
+		}
+
+		if (!reversed)
+			continue;
+
+		if (first[x])
+			last[x]->next = reversed;
+		else
+			first[x] = reversed;
+		last[x] = tail;
+	}
+}
+
+static size_t transport_send_queue_pick(TransportSendQueue* queue,
+                                         TransportSendEntry* const* first)
+{
+	/* Graphics get three quarters of the link while a bulk transfer competes for it */
+	static const size_t weights[TRANSPORT_PRIORITY_COUNT] = { 0, 3, 1 };
+
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(first);
+
+	if (first[TRANSPORT_PRIORITY_HIGH])
+		return TRANSPORT_PRIORITY_HIGH;
+
+	size_t active = 0;
+	for (size_t x = TRANSPORT_PRIORITY_NORMAL; x < TRANSPORT_PRIORITY_COUNT; x++)
+	{
+		if (first[x])
+			active++;
+		else
+			queue->deficit[x] = 0; /* Idle classes do not save up credit */
+	}
+	if (active == 0)
+		return TRANSPORT_PRIORITY_COUNT;
+
+	for (;;)
+	{
+		const size_t x = queue->turn;
+		const TransportSendEntry* entry = first[x];
+		if (entry && (queue->deficit[x] >= entry->length))
+		{
+			queue->deficit[x] -= entry->length;
+			return x;
+		}
+
+		if (++queue->turn >= TRANSPORT_PRIORITY_COUNT)
+			queue->turn = TRANSPORT_PRIORITY_NORMAL;
+		if (first[queue->turn])
+			queue->deficit[queue->turn] += TRANSPORT_SEND_QUANTUM * weights[queue->turn];
+	}
+}
+
+static BOOL transport_send_queue_drain(TransportSendQueue* queue)
+{
+	TransportSendEntry* first[TRANSPORT_PRIORITY_COUNT] = { 0 };
+	TransportSendEntry* last[TRANSPORT_PRIORITY_COUNT] = { 0 };
+	BOOL corked = FALSE;
+	BOOL rc = InterlockedCompareExchange(&queue->failed, 0, 0) == 0;
+
+	WINPR_ASSERT(queue);
+	rdpTransport* transport = queue->transport;
+	WINPR_ASSERT(transport);
+
+	for (;;)
+	{
+		/* The source writes high class PDUs, they are collected right after */
+		if ((InterlockedExchange(&queue->sourcePending, 0) != 0) && rc &&
+		    (InterlockedCompareExchange(&queue->stop, 0, 0) == 0))
+			rc = queue->source(transport, queue->sourceArg);
+
+		/* Look for new entries after every write, input must not wait for a bulk backlog */
+		transport_send_queue_collect(queue, first, last);
+
+		const size_t x = transport_send_queue_pick(queue, first);
+		if (x == TRANSPORT_PRIORITY_COUNT)
+			break;
+
+		TransportSendEntry* entry = first[x];
+		first[x] = entry->next;
+
+		if (rc && !corked)
+			corked = transport_cork_int(transport);
+
+		if (rc)
+		{
+			wStream sbuffer = { 0 };
+			wStream* s = Stream_StaticInit(&sbuffer, (BYTE*)&entry[1], entry->length);
+			Stream_SetPosition(s, entry->length);
+			rc = IFCALLRESULT(-1, transport->io.WritePdu, transport, s) >= 0;
+		}
+
+		const LONG queued = InterlockedExchangeAdd(&queue->queued, -(LONG)entry->length);
+		if (!rc || ((queue->limit > 0) && (queued - (LONG)entry->length <= queue->limit)))
+			(void)SetEvent(queue->space);
+		free(entry);
+	}
+
+	if (corked && !transport_uncork_int(transport))
+		rc = FALSE;
+
+	if (!rc)
+	{
+		(void)InterlockedExchange(&queue->failed, 1);
+		(void)SetEvent(queue->space);
+	}
+	return rc;
+}
+
+static DWORD WINAPI transport_send_queue_thread(LPVOID arg)
+{
+	TransportSendQueue* queue = arg;
+	WINPR_ASSERT(queue);
+
+	for (;;)
+	{
+		const BOOL stop = InterlockedCompareExchange(&queue->stop, 0, 0) != 0;
+
+		/* Producers only signal when they set pending, so reset both before draining */
+		(void)ResetEvent(queue->event);
+		(void)InterlockedExchange(&queue->pending, 0);
+		(void)transport_send_queue_drain(queue);
+		if (stop)
+			break;
+
+		if (WaitForSingleObject(queue->event, INFINITE) != WAIT_OBJECT_0)
+			break;
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+/* Flush what is queued and end the sender thread, later pushes fail */
+static void transport_send_queue_halt(TransportSendQueue* queue)
+{
+	WINPR_ASSERT(queue);
+
+	(void)InterlockedExchange(&queue->stop, 1);
+	if (queue->thread)
+	{
+		(void)SetEvent(queue->event);
+		(void)WaitForSingleObject(queue->thread, INFINITE);
+		(void)CloseHandle(queue->thread);
+		queue->thread = NULL;
+	}
+}
+
+static void transport_send_queue_free(TransportSendQueue* queue)
+{
+	if (!queue)
+		return;
+
+	transport_send_queue_halt(queue);
+
+	for (size_t x = 0; x < TRANSPORT_PRIORITY_COUNT; x++)
+	{
+		TransportSendEntry* entry = queue->heads[x];
+		while (entry)
+		{
+			TransportSendEntry* next = entry->next;
+			free(entry);
+			entry = next;
+		}
+	}
+
+	(void)CloseHandle(queue->event);
+	(void)CloseHandle(queue->space);
+	free(queue);
+}
+
+static TransportSendQueue* transport_send_queue_new(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	TransportSendQueue* queue = calloc(1, sizeof(TransportSendQueue));
+	if (!queue)
+		return NULL;
+
+	const UINT32 limit =
+	    freerdp_settings_get_uint32(transport->context->settings, FreeRDP_TcpSendQueueLimit);
+	queue->transport = transport;
+	queue->refs = 1;
+	queue->turn = TRANSPORT_PRIORITY_NORMAL;
+	queue->limit = (LONG)MIN(limit, INT32_MAX / 2);
+	queue->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	queue->space = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!queue->event || !queue->space)
+		goto fail;
+
+	queue->thread = CreateThread(NULL, 0, transport_send_queue_thread, queue, 0, NULL);
+	if (!queue->thread)
+		goto fail;
+	return queue;
+
+fail:
+	transport_send_queue_free(queue);
+	return NULL;
+}
+
+static void transport_send_queue_release(TransportSendQueue* queue)
+{
+	if (queue && (InterlockedDecrement(&queue->refs) == 0))
+		transport_send_queue_free(queue);
+}
+
+/* Take a reference to the queue, transport_send_queue_stop may detach it at any time.
+ * The queue takes over once the session is active, the connection sequence stays synchronous
+ * as it switches security layers in between its PDUs */
+static TransportSendQueue* transport_send_queue_acquire(rdpTransport* transport, BOOL start)
+{
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	TransportSendQueue* queue = transport->sendQueue;
+	if (queue)
+		(void)InterlockedIncrement(&queue->refs);
+	LeaveCriticalSection(&(transport->WriteLock));
+	if (queue || !start)
+		return queue;
+
+	rdpContext* context = transport->context;
+	if (!context || !context->rdp ||
+	    !freerdp_settings_get_bool(context->settings, FreeRDP_TransportSendQueue) ||
+	    (rdp_get_state(context->rdp) != CONNECTION_STATE_ACTIVE))
+		return NULL;
+
+	EnterCriticalSection(&(transport->WriteLock));
+	if (!transport->sendQueue && transport->frontBio &&
+	    (transport->layer != TRANSPORT_LAYER_CLOSED))
+	{
+		/* The queue owns the cork from now on, send what the writers corked so far */
+		if ((transport->corked > 0) && (transport_write_cork_buffer(transport) >= 0))
+			transport->corked = 0;
+
+		if (transport->corked == 0)
+			transport->sendQueue = transport_send_queue_new(transport);
+		if (transport->sendQueue)
+			WLog_Print(transport->log, WLOG_DEBUG, "writing through the send queue");
+	}
+	queue = transport->sendQueue;
+	if (queue)
+		(void)InterlockedIncrement(&queue->refs);
+	LeaveCriticalSection(&(transport->WriteLock));
+	return queue;
+}
+
+static void transport_send_queue_stop(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	EnterCriticalSection(&(transport->WriteLock));
+	TransportSendQueue* queue = transport->sendQueue;
+	transport->sendQueue = NULL;
+	LeaveCriticalSection(&(transport->WriteLock));
+
+	/* Flushes what is queued, the thread takes the WriteLock for every write. Producers
+	 * still holding a reference free the queue with their release. */
+	if (queue)
+	{
+		transport_send_queue_halt(queue);
+		transport_send_queue_release(queue);
+	}
+}
+
+static int transport_send_queue_push(TransportSendQueue* queue, wStream* s,
+                                     TRANSPORT_PRIORITY priority)
+{
+	WINPR_ASSERT(queue);
+	WINPR_ASSERT(s);
+	WINPR_ASSERT(priority < TRANSPORT_PRIORITY_COUNT);
+
+	const size_t length = Stream_GetPosition(s);
+	if (length > INT32_MAX / 2)
+		return -1;
+
+	/* Input and audio are small, only the other classes wait for the sender to catch up */
+	while ((priority != TRANSPORT_PRIORITY_HIGH) && (queue->limit > 0))
+	{
+		if ((InterlockedCompareExchange(&queue->failed, 0, 0) != 0) ||
+		    (InterlockedCompareExchange(&queue->stop, 0, 0) != 0))
+			return -1;
+		if (InterlockedCompareExchange(&queue->queued, 0, 0) <= queue->limit)
+			break;
+
+		(void)ResetEvent(queue->space);
+		if (InterlockedCompareExchange(&queue->queued, 0, 0) <= queue->limit)
+			break;
+		(void)WaitForSingleObject(queue->space, 100);
+	}
+
+	/* A stopped queue has no sender thread left to write the entry */
+	if ((InterlockedCompareExchange(&queue->failed, 0, 0) != 0) ||
+	    (InterlockedCompareExchange(&queue->stop, 0, 0) != 0))
+		return -1;
+
+	TransportSendEntry* entry = malloc(sizeof(TransportSendEntry) + length);
+	if (!entry)
+		return -1;
+
+	/* Callers reuse or free the stream as soon as this returns */
+	entry->length = length;
+	memcpy(&entry[1], Stream_Buffer(s), length);
+	(void)InterlockedExchangeAdd(&queue->queued, (LONG)length);
+
+	TransportSendEntry* head = NULL;
+	do
+	{
+		head = queue->heads[priority];
+		entry->next = head;
+	} while (InterlockedCompareExchangePointer((PVOID volatile*)&queue->heads[priority], entry,
+	                                           head) != head);
+
+	if (InterlockedExchange(&queue->pending, 1) == 0)
+		(void)SetEvent(queue->event);
+	return (int)length;
+}
+
+int transport_write_ex(rdpTransport* transport, wStream* s, TRANSPORT_PRIORITY priority)
+{
+	if (!transport || !s)
+		return -1;
+
+	FREERDP_PROBE2(transport_write, Stream_GetPosition(s), priority);
+
+	TransportSendQueue* queue = transport_send_queue_acquire(transport, TRUE);
+	if (queue)
+	{
+		const int rc = transport_send_queue_push(queue, s, priority);
+		transport_send_queue_release(queue);
+		return rc;
+	}
+
+	return IFCALLRESULT(-1, transport->io.WritePdu, transport, s);
+}
+
+BOOL transport_have_send_queue(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	TransportSendQueue* queue = transport_send_queue_acquire(transport, TRUE);
+	const BOOL rc = queue && (InterlockedCompareExchange(&queue->failed, 0, 0) == 0);
+	transport_send_queue_release(queue);
+	return rc;
+}
+
+BOOL transport_send_source_signal(rdpTransport* transport, TransportSendSource source, void* arg)
+{
+	WINPR_ASSERT(transport);
+	WINPR_ASSERT(source);
+
+	TransportSendQueue* queue = transport_send_queue_acquire(transport, FALSE);
+	if (!queue)
+		return FALSE;
+
+	const BOOL rc = (InterlockedCompareExchange(&queue->failed, 0, 0) == 0) &&
+	                (InterlockedCompareExchange(&queue->stop, 0, 0) == 0);
+	if (rc)
+	{
+		/* Every signal of a session names the same source, the exchange below publishes it */
+		queue->source = source;
+		queue->sourceArg = arg;
+		(void)InterlockedExchange(&queue->sourcePending, 1);
+		if (InterlockedExchange(&queue->pending, 1) == 0)
+			(void)SetEvent(queue->event);
+	}
+	transport_send_queue_release(queue);
+	return rc;
+}
+
 BOOL transport_get_public_key(rdpTransport* transport, const BYTE** data, DWORD* length)
 {
 	return IFCALLRESULT(FALSE, transport->io.GetPublicKey, transport, data, length);
@@ -1370,10 +2001,57 @@ void transport_get_fds(rdpTransport* transport, void** rfds, int* rcount)
 }
 #endif
 
+int transport_get_socket(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+
+	if (!transport->frontBio)
+		return -1;
+
+	/* Gateways and custom transport layers have no socket of their own */
+	int sockfd = -1;
+	BIO* socketBio = BIO_find_type(transport->frontBio, BIO_TYPE_SIMPLE);
+	if (!socketBio || (BIO_get_fd(socketBio, &sockfd) <= 0))
+		return -1;
+	return sockfd;
+}
+
+BOOL transport_set_bandwidth_delay(rdpTransport* transport, UINT32 bandwidth, UINT32 rtt)
+{
+	WINPR_ASSERT(transport);
+
+	rdpContext* context = transport_get_context(transport);
+	WINPR_ASSERT(context);
+
+	const int sockfd = transport_get_socket(transport);
+	if (sockfd < 0)
+		return FALSE;
+
+	return freerdp_tcp_set_bandwidth_delay(context->settings, sockfd, bandwidth, rtt);
+}
+
+BOOL transport_get_tcp_info(rdpTransport* transport, UINT32* rtt, UINT32* rttVar, UINT32* mss,
+                            UINT32* retransmits)
+{
+	const int sockfd = transport_get_socket(transport);
+	if (sockfd < 0)
+		return FALSE;
+
+	return freerdp_tcp_get_info(sockfd, rtt, rttVar, mss, retransmits);
+}
+
 BOOL transport_is_write_blocked(rdpTransport* transport)
 {
 	WINPR_ASSERT(transport);
 	WINPR_ASSERT(transport->frontBio);
+
+	/* A backlog in the send queue is the socket falling behind just the same */
+	TransportSendQueue* queue = transport_send_queue_acquire(transport, FALSE);
+	const BOOL backlog =
+	    queue && (InterlockedCompareExchange(&queue->queued, 0, 0) > TRANSPORT_CORK_MAX);
+	transport_send_queue_release(queue);
+	if (backlog)
+		return TRUE;
 	return BIO_write_blocked(transport->frontBio);
 }
 
@@ -1410,6 +2088,17 @@ int transport_check_fds(rdpTransport* transport)
 		return -1;
 	}
 
+	/* Do not hold back corked data longer than one event loop iteration */
+	EnterCriticalSection(&(transport->WriteLock));
+	status = transport_write_cork_buffer(transport);
+	LeaveCriticalSection(&(transport->WriteLock));
+	if (status < 0)
+	{
+		transport->layer = TRANSPORT_LAYER_CLOSED;
+		freerdp_set_last_error_if_not(context, FREERDP_ERROR_CONNECT_TRANSPORT_FAILED);
+		return -1;
+	}
+
 	/**
 	 * Note: transport_read_pdu tries to read one PDU from
 	 * the transport layer.
@@ -1532,6 +2221,10 @@ static BOOL transport_default_attach_layer(rdpTransport* transport, rdpTransport
 	/* BIO takes over the layer reference at this point. */
 	BIO_set_data(layerBio, layer);
 
+	const rdpContext* context = transport_get_context(transport);
+	WINPR_ASSERT(context);
+	BIO_set_send_queue_limit(bufferedBio, (long)freerdp_settings_get_uint32(
+	                                          context->settings, FreeRDP_TcpSendQueueLimit));
 	transport->frontBio = bufferedBio;
 
 	return TRUE;
@@ -1571,6 +2264,8 @@ BOOL transport_disconnect(rdpTransport* transport)
 {
 	if (!transport)
 		return FALSE;
+
+	transport_send_queue_stop(transport);
 	return IFCALLRESULT(FALSE, transport->io.TransportDisconnect, transport);
 }
 
@@ -1701,6 +2396,7 @@ void transport_free(rdpTransport* transport)
 		Stream_Release(transport->ReceiveBuffer);
 
 	nla_free(transport->nla);
+	Stream_Free(transport->corkBuffer, TRUE);
 	StreamPool_Free(transport->ReceivePool);
 	(void)CloseHandle(transport->connectedEvent);
 	(void)CloseHandle(transport->rereadEvent);
@@ -1781,6 +2477,12 @@ rdpTsg* transport_get_tsg(rdpTransport* transport)
 	return transport->tsg;
 }
 
+rdpRdg* transport_get_rdg(rdpTransport* transport)
+{
+	WINPR_ASSERT(transport);
+	return transport->rdg;
+}
+
 wStream* transport_take_from_pool(rdpTransport* transport, size_t size)
 {
 	WINPR_ASSERT(transport);
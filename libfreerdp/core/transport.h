@@ -35,6 +35,7 @@ typedef enum
 #include "rdstls.h"
 
 #include "gateway/tsg.h"
+#include "gateway/rdg.h"
 
 #include <winpr/sspi.h>
 #include <winpr/wlog.h>
@@ -52,6 +53,15 @@ typedef enum
 
 #include "state.h"
 
+/* Send classes of the transport send queue, see FreeRDP_TransportSendQueue */
+typedef enum
+{
+	TRANSPORT_PRIORITY_HIGH,
+	TRANSPORT_PRIORITY_NORMAL,
+	TRANSPORT_PRIORITY_BULK,
+	TRANSPORT_PRIORITY_COUNT
+} TRANSPORT_PRIORITY;
+
 typedef state_run_t (*TransportRecv)(rdpTransport* transport, wStream* stream, void* extra);
 
 FREERDP_LOCAL wStream* transport_send_stream_init(rdpTransport* transport, size_t size);
@@ -105,6 +115,48 @@ FREERDP_LOCAL BOOL transport_accept_rdstls(rdpTransport* transport);
 FREERDP_LOCAL int transport_read_pdu(rdpTransport* transport, wStream* s);
 FREERDP_LOCAL int transport_write(rdpTransport* transport, wStream* s);
 
+/**! \brief Write a PDU with a send priority
+ *
+ * With FreeRDP_TransportSendQueue an active session hands its PDUs to a sender thread that
+ * sends higher classes first, the order within a class is kept. Otherwise the PDU is written
+ * right away like transport_write does.
+ *
+ * \param transport The transport to write to
+ * \param s The PDU, its position is the length to send
+ * \param priority The send class of the PDU
+ *
+ * \return The number of bytes written or queued, a negative value in case of an error
+ */
+FREERDP_LOCAL int transport_write_ex(rdpTransport* transport, wStream* s,
+                                     TRANSPORT_PRIORITY priority);
+
+/**! \brief Check for the send queue
+ *
+ * Starts the send queue of FreeRDP_TransportSendQueue if the session is active.
+ *
+ * \param transport The transport to check
+ *
+ * \return \b TRUE if PDUs are written by the sender thread, \b FALSE otherwise
+ */
+FREERDP_LOCAL BOOL transport_have_send_queue(rdpTransport* transport);
+
+/** Called on the sender thread, writes the PDUs of a source with transport_write_ex */
+typedef BOOL (*TransportSendSource)(rdpTransport* transport, void* arg);
+
+/**! \brief Wake the sender thread for a source
+ *
+ * The sender thread calls \b source before it writes the next queued PDU, so a producer can
+ * hand over its data without a lock and have it batched at send time.
+ *
+ * \param transport The transport with the send queue
+ * \param source The callback building the PDUs
+ * \param arg The argument for \b source
+ *
+ * \return \b TRUE if the sender thread will call \b source, \b FALSE if no send queue runs
+ */
+FREERDP_LOCAL BOOL transport_send_source_signal(rdpTransport* transport,
+                                                TransportSendSource source, void* arg);
+
 FREERDP_LOCAL BOOL transport_get_public_key(rdpTransport* transport, const BYTE** data,
                                             DWORD* length);
 
@@ -123,6 +175,25 @@ FREERDP_LOCAL void transport_set_nla_mode(rdpTransport* transport, BOOL NlaMode)
 FREERDP_LOCAL void transport_set_rdstls_mode(rdpTransport* transport, BOOL RdstlsMode);
 FREERDP_LOCAL void transport_set_aad_mode(rdpTransport* transport, BOOL AadMode);
 FREERDP_LOCAL BOOL transport_is_write_blocked(rdpTransport* transport);
+
+/* The socket at the end of the BIO chain or -1 for gateways and custom transport layers */
+FREERDP_LOCAL int transport_get_socket(rdpTransport* transport);
+
+/* Passes the measured bandwidth in kbit/s and round trip time in ms on to the socket */
+FREERDP_LOCAL BOOL transport_set_bandwidth_delay(rdpTransport* transport, UINT32 bandwidth,
+                                                 UINT32 rtt);
+
+/* The TCP_INFO of the socket, see freerdp_tcp_get_info */
+FREERDP_LOCAL BOOL transport_get_tcp_info(rdpTransport* transport, UINT32* rtt, UINT32* rttVar,
+                                          UINT32* mss, UINT32* retransmits);
+
+/**
+ * @brief transport_cork Collects the following PDUs and sends them together on the matching
+ * transport_uncork, so a burst of small PDUs fills a few TLS records and send calls.
+ * Calls nest, only the outermost transport_uncork sends.
+ */
+FREERDP_LOCAL BOOL transport_cork(rdpTransport* transport);
+FREERDP_LOCAL BOOL transport_uncork(rdpTransport* transport);
 FREERDP_LOCAL int transport_drain_output_buffer(rdpTransport* transport);
 
 FREERDP_LOCAL BOOL transport_io_callback_set_event(rdpTransport* transport, BOOL set);
@@ -140,6 +211,8 @@ FREERDP_LOCAL rdpTls* transport_get_tls(rdpTransport* transport);
 FREERDP_LOCAL BOOL transport_set_tsg(rdpTransport* transport, rdpTsg* tsg);
 FREERDP_LOCAL rdpTsg* transport_get_tsg(rdpTransport* transport);
 
+FREERDP_LOCAL rdpRdg* transport_get_rdg(rdpTransport* transport);
+
 FREERDP_LOCAL wStream* transport_take_from_pool(rdpTransport* transport, size_t size);
 
 FREERDP_LOCAL ULONG transport_get_bytes_sent(rdpTransport* transport, BOOL resetCount);
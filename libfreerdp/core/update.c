@@ -135,7 +135,7 @@ static BOOL update_read_bitmap_data(rdpUpdate* update, wStream* s, BITMAP_DATA*
 
 	if (bitmapData->bitmapLength > 0)
 	{
-		bitmapData->bitmapDataStream = malloc(bitmapData->bitmapLength);
+		bitmapData->bitmapDataStream = update_arena_alloc(update, bitmapData->bitmapLength);
 
 		if (!bitmapData->bitmapDataStream)
 			return FALSE;
@@ -206,37 +206,32 @@ static BOOL update_write_bitmap_data(rdpUpdate* update_pub, wStream* s, BITMAP_D
 
 BITMAP_UPDATE* update_read_bitmap_update(rdpUpdate* update, wStream* s)
 {
-	BITMAP_UPDATE* bitmapUpdate = calloc(1, sizeof(BITMAP_UPDATE));
+	BITMAP_UPDATE* bitmapUpdate = update_arena_calloc(update, 1, sizeof(BITMAP_UPDATE));
 	rdp_update_internal* up = update_cast(update);
 
 	if (!bitmapUpdate)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
-		goto fail;
+		return NULL;
 
 	Stream_Read_UINT16(s, bitmapUpdate->number); /* numberRectangles (2 bytes) */
 	WLog_Print(up->log, WLOG_TRACE, "BitmapUpdate: %" PRIu32 "", bitmapUpdate->number);
 
-	bitmapUpdate->rectangles = (BITMAP_DATA*)calloc(bitmapUpdate->number, sizeof(BITMAP_DATA));
+	bitmapUpdate->rectangles =
+	    (BITMAP_DATA*)update_arena_calloc(update, bitmapUpdate->number, sizeof(BITMAP_DATA));
 
 	if (!bitmapUpdate->rectangles)
-		goto fail;
+		return NULL;
 
 	/* rectangles */
 	for (UINT32 i = 0; i < bitmapUpdate->number; i++)
 	{
 		if (!update_read_bitmap_data(update, s, &bitmapUpdate->rectangles[i]))
-			goto fail;
+			return NULL;
 	}
 
 	return bitmapUpdate;
-fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_bitmap_update(update->context, bitmapUpdate);
-	WINPR_PRAGMA_DIAG_POP
-	return NULL;
 }
 
 static BOOL update_write_bitmap_update(rdpUpdate* update, wStream* s,
@@ -263,13 +258,13 @@ static BOOL update_write_bitmap_update(rdpUpdate* update, wStream* s,
 
 PALETTE_UPDATE* update_read_palette(rdpUpdate* update, wStream* s)
 {
-	PALETTE_UPDATE* palette_update = calloc(1, sizeof(PALETTE_UPDATE));
+	PALETTE_UPDATE* palette_update = update_arena_calloc(update, 1, sizeof(PALETTE_UPDATE));
 
 	if (!palette_update)
-		goto fail;
+		return NULL;
 
 	if (!Stream_CheckAndLogRequiredLength(TAG, s, 6))
-		goto fail;
+		return NULL;
 
 	Stream_Seek_UINT16(s);                         /* pad2Octets (2 bytes) */
 	Stream_Read_UINT32(s, palette_update->number); /* numberColors (4 bytes), must be set to 256 */
@@ -278,7 +273,7 @@ PALETTE_UPDATE* update_read_palette(rdpUpdate* update, wStream* s)
 		palette_update->number = 256;
 
 	if (!Stream_CheckAndLogRequiredLengthOfSize(TAG, s, palette_update->number, 3ull))
-		goto fail;
+		return NULL;
 
 	/* paletteEntries */
 	for (UINT32 i = 0; i < palette_update->number; i++)
@@ -290,12 +285,6 @@ PALETTE_UPDATE* update_read_palette(rdpUpdate* update, wStream* s)
 	}
 
 	return palette_update;
-fail:
-	WINPR_PRAGMA_DIAG_PUSH
-	WINPR_PRAGMA_DIAG_IGNORED_MISMATCHED_DEALLOC
-	free_palette_update(update->context, palette_update);
-	WINPR_PRAGMA_DIAG_POP
-	return NULL;
 }
 
 static BOOL update_read_synchronize(rdpUpdate* update, wStream* s)
@@ -824,6 +813,9 @@ BOOL update_recv(rdpUpdate* update, wStream* s)
 	Stream_Read_UINT16(s, updateType); /* updateType (2 bytes) */
 	WLog_Print(up->log, WLOG_TRACE, "%s Update Data PDU", update_type_to_string(updateType));
 
+	if ((updateType == UPDATE_TYPE_ORDERS) || (updateType == UPDATE_TYPE_BITMAP))
+		freerdp_connection_trace_graphics_update(context);
+
 	if (!update_begin_paint(update))
 		goto fail;
 
@@ -844,7 +836,7 @@ BOOL update_recv(rdpUpdate* update, wStream* s)
 			}
 
 			rc = IFCALLRESULT(FALSE, update->BitmapUpdate, context, bitmap_update);
-			free_bitmap_update(context, bitmap_update);
+			update_arena_reset(update);
 		}
 		break;
 
@@ -859,7 +851,7 @@ BOOL update_recv(rdpUpdate* update, wStream* s)
 			}
 
 			rc = IFCALLRESULT(FALSE, update->Palette, context, palette_update);
-			free_palette_update(context, palette_update);
+			update_arena_reset(update);
 		}
 		break;
 
@@ -1364,6 +1356,7 @@ static BOOL update_send_surface_frame_marker(rdpContext* context,
 	wStream* s = NULL;
 	WINPR_ASSERT(context);
 	rdpRdp* rdp = context->rdp;
+	rdp_update_internal* update = update_cast(context->update);
 	BOOL ret = FALSE;
 	update_force_flush(context);
 
@@ -1373,6 +1366,11 @@ static BOOL update_send_surface_frame_marker(rdpContext* context,
 	if (!s)
 		return FALSE;
 
+	/* The peer check flushes a frame that is never ended, see transport_check_fds */
+	if ((surfaceFrameMarker->frameAction == SURFACECMD_FRAMEACTION_BEGIN) &&
+	    !update->frameCorked)
+		update->frameCorked = transport_cork(rdp->transport);
+
 	if (!update_write_surfcmd_frame_marker(s, surfaceFrameMarker->frameAction,
 	                                       surfaceFrameMarker->frameId) ||
 	    !fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_SURFCMDS, s, FALSE))
@@ -1381,6 +1379,12 @@ static BOOL update_send_surface_frame_marker(rdpContext* context,
 	update_force_flush(context);
 	ret = TRUE;
 out_fail:
+	if ((surfaceFrameMarker->frameAction == SURFACECMD_FRAMEACTION_END) && update->frameCorked)
+	{
+		update->frameCorked = FALSE;
+		if (!transport_uncork(rdp->transport))
+			ret = FALSE;
+	}
 	Stream_Release(s);
 	return ret;
 }
@@ -3190,6 +3194,90 @@ void update_free_window_state(WINDOW_STATE_ORDER* window_state)
 	memset(window_state, 0, sizeof(WINDOW_STATE_ORDER));
 }
 
+/* initial arena chunk size, chunks double from there */
+#define UPDATE_ARENA_CHUNK_SIZE (64ull * 1024ull)
+/* arenas grown beyond this by a single large PDU are released on reset */
+#define UPDATE_ARENA_RETAIN_SIZE (4ull * 1024ull * 1024ull)
+
+struct s_update_arena_chunk
+{
+	update_arena_chunk* next;
+	size_t size;
+	size_t used;
+	UINT64 data[1];
+};
+
+void* update_arena_alloc(rdpUpdate* update, size_t size)
+{
+	rdp_update_internal* up = update_cast(update);
+	update_arena_chunk* chunk = up->arena;
+
+	/* keep every allocation 8 byte aligned */
+	if (size > SIZE_MAX - sizeof(UINT64))
+		return NULL;
+	size = (size + sizeof(UINT64) - 1) & ~(sizeof(UINT64) - 1);
+
+	if (!chunk || (chunk->size - chunk->used < size))
+	{
+		size_t csize = UPDATE_ARENA_CHUNK_SIZE;
+		if (chunk && (chunk->size <= SIZE_MAX / 2) && (csize < chunk->size * 2))
+			csize = chunk->size * 2;
+		if (csize < size)
+			csize = size;
+		if (csize > SIZE_MAX - sizeof(update_arena_chunk))
+			return NULL;
+
+		update_arena_chunk* next =
+		    (update_arena_chunk*)malloc(sizeof(update_arena_chunk) + csize);
+		if (!next)
+			return NULL;
+
+		next->next = chunk;
+		next->size = csize;
+		next->used = 0;
+		up->arena = chunk = next;
+	}
+
+	BYTE* ptr = (BYTE*)chunk->data + chunk->used;
+	chunk->used += size;
+	return ptr;
+}
+
+void* update_arena_calloc(rdpUpdate* update, size_t count, size_t size)
+{
+	if ((size > 0) && (count > SIZE_MAX / size))
+		return NULL;
+
+	void* ptr = update_arena_alloc(update, count * size);
+	if (ptr)
+		memset(ptr, 0, count * size);
+	return ptr;
+}
+
+void update_arena_reset(rdpUpdate* update)
+{
+	rdp_update_internal* up = update_cast(update);
+	update_arena_chunk* chunk = up->arena;
+
+	if (!chunk)
+		return;
+
+	/* the newest chunk is the largest, keep only that one around */
+	while (chunk->next)
+	{
+		update_arena_chunk* old = chunk->next;
+		chunk->next = old->next;
+		free(old);
+	}
+
+	chunk->used = 0;
+	if (chunk->size > UPDATE_ARENA_RETAIN_SIZE)
+	{
+		free(chunk);
+		up->arena = NULL;
+	}
+}
+
 rdpUpdate* update_new(rdpRdp* rdp)
 {
 	const wObject cb = { NULL, NULL, NULL, update_free_queued_message, NULL };
@@ -3296,6 +3384,9 @@ void update_free(rdpUpdate* update)
 
 		if (up->us)
 			Stream_Free(up->us, TRUE);
+
+		update_arena_reset(update);
+		free(up->arena);
 		free(update);
 	}
 }
@@ -42,6 +42,8 @@
 #define BITMAP_COMPRESSION 0x0001
 #define NO_BITMAP_COMPRESSION_HDR 0x0400
 
+typedef struct s_update_arena_chunk update_arena_chunk;
+
 typedef struct
 {
 	rdpUpdate common;
@@ -65,6 +67,8 @@ typedef struct
 	rdpBounds previousBounds;
 	CRITICAL_SECTION mux;
 	BOOL withinBeginEndPaint;
+	BOOL frameCorked; /* PDUs between surface frame markers are sent together */
+	update_arena_chunk* arena; /* parse state of the PDU being dispatched */
 } rdp_update_internal;
 
 typedef struct
@@ -185,10 +189,13 @@ FREERDP_LOCAL BOOL update_recv_play_sound(rdpUpdate* update, wStream* s);
 FREERDP_LOCAL BOOL update_recv_pointer(rdpUpdate* update, wStream* s);
 FREERDP_LOCAL BOOL update_recv(rdpUpdate* update, wStream* s);
 
-WINPR_ATTR_MALLOC(free_bitmap_update, 2)
-FREERDP_LOCAL BITMAP_UPDATE* update_read_bitmap_update(rdpUpdate* update, wStream* s);
+/** Allocates from the per PDU arena, valid until update_arena_reset */
+FREERDP_LOCAL void* update_arena_alloc(rdpUpdate* update, size_t size);
+FREERDP_LOCAL void* update_arena_calloc(rdpUpdate* update, size_t count, size_t size);
+FREERDP_LOCAL void update_arena_reset(rdpUpdate* update);
 
-WINPR_ATTR_MALLOC(free_palette_update, 2)
+/* the returned update lives in the arena, release it with update_arena_reset */
+FREERDP_LOCAL BITMAP_UPDATE* update_read_bitmap_update(rdpUpdate* update, wStream* s);
 FREERDP_LOCAL PALETTE_UPDATE* update_read_palette(rdpUpdate* update, wStream* s);
 
 WINPR_ATTR_MALLOC(free_pointer_system_update, 2)
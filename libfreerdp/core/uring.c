@@ -0,0 +1,694 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * io_uring Transport Layer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+
+#include <freerdp/log.h>
+
+#include "uring.h"
+
+#define TAG FREERDP_TAG("core.uring")
+
+#if defined(HAVE_LINUX_IO_URING)
+
+#include <errno.h>
+#include <string.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/winsock.h>
+
+#define URING_ENTRIES 16
+#define URING_BUFFER_GROUP 0
+#define URING_RECV_BUFFERS 16 /* must be a power of two */
+#define URING_RECV_BUFFER_SIZE 16384
+#define URING_SEND_BUFFER_SIZE (256 * 1024)
+#define URING_CLOSE_TIMEOUT_MS 1000
+
+#define URING_OP_RECV 1
+#define URING_OP_SEND 2
+#define URING_OP_CANCEL 3
+
+typedef struct
+{
+	UINT16 bid;
+	UINT32 offset;
+	UINT32 length;
+} rdpUringChunk;
+
+typedef struct
+{
+	int sockfd;
+	int ringfd;
+	HANDLE event;
+	BOOL signaled;
+	UINT32 eventTail;
+
+	void* ring;
+	size_t ringSize;
+	struct io_uring_sqe* sqes;
+	size_t sqesSize;
+	UINT32* sqHead;
+	UINT32* sqTail;
+	UINT32* sqArray;
+	UINT32 sqMask;
+	UINT32 sqEntries;
+	UINT32* cqHead;
+	UINT32* cqTail;
+	UINT32 cqMask;
+	struct io_uring_cqe* cqes;
+	UINT32 toSubmit;
+
+	/* Buffers handed to the kernel for the multishot receive, returned once read */
+	struct io_uring_buf_ring* bufRing;
+	size_t bufRingSize;
+	BYTE* recvBuffers;
+	rdpUringChunk chunks[URING_RECV_BUFFERS];
+	size_t chunkHead;
+	size_t chunkCount;
+	BOOL recvArmed;
+	BOOL multishot;
+	BOOL received;
+	BOOL eof;
+
+	/* Writes are queued here while a send is in flight and go out together with the next */
+	BYTE* sendBuffer;
+	size_t sendHead;
+	size_t sendUsed;
+	size_t sendInFlight;
+	BOOL failed;
+} rdpUringLayer;
+
+static UINT32 uring_load(const UINT32* ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static void uring_store(UINT32* ptr, UINT32 value)
+{
+	__atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+static int uring_enter(rdpUringLayer* uring, UINT32 minComplete, DWORD timeout)
+{
+	WINPR_ASSERT(uring);
+
+	UINT32 flags = 0;
+	const void* arg = NULL;
+	size_t argsz = 0;
+	struct __kernel_timespec ts = { 0 };
+	struct io_uring_getevents_arg getevents = { 0 };
+
+	if (minComplete > 0)
+	{
+		flags |= IORING_ENTER_GETEVENTS;
+		if (timeout != INFINITE)
+		{
+			ts.tv_sec = timeout / 1000;
+			ts.tv_nsec = (timeout % 1000) * 1000000LL;
+			getevents.ts = (UINT64)(uintptr_t)&ts;
+			flags |= IORING_ENTER_EXT_ARG;
+			arg = &getevents;
+			argsz = sizeof(getevents);
+		}
+	}
+	else if (uring->toSubmit == 0)
+		return 0;
+
+	long rc = 0;
+	do
+	{
+		rc = syscall(__NR_io_uring_enter, uring->ringfd, uring->toSubmit, minComplete, flags, arg,
+		             argsz);
+	} while ((rc < 0) && (errno == EINTR));
+
+	if (rc < 0)
+	{
+		/* Busy with a full completion queue, it is drained before the next submission */
+		if ((errno == ETIME) || (errno == EBUSY) || (errno == EAGAIN))
+			return 0;
+		WLog_ERR(TAG, "io_uring_enter failed with %s [%d]", strerror(errno), errno);
+		return -1;
+	}
+
+	WINPR_ASSERT((UINT32)rc <= uring->toSubmit);
+	uring->toSubmit -= (UINT32)rc;
+	return (int)rc;
+}
+
+static struct io_uring_sqe* uring_get_sqe(rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+
+	UINT32 tail = *uring->sqTail;
+	if (tail - uring_load(uring->sqHead) >= uring->sqEntries)
+	{
+		if (uring_enter(uring, 0, 0) < 0)
+			return NULL;
+		if (tail - uring_load(uring->sqHead) >= uring->sqEntries)
+			return NULL;
+	}
+
+	const UINT32 index = tail & uring->sqMask;
+	struct io_uring_sqe* sqe = &uring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	uring->sqArray[index] = index;
+	uring_store(uring->sqTail, tail + 1);
+	uring->toSubmit++;
+	return sqe;
+}
+
+static void uring_recycle_buffer(rdpUringLayer* uring, UINT16 bid)
+{
+	WINPR_ASSERT(uring);
+	WINPR_ASSERT(bid < URING_RECV_BUFFERS);
+
+	/* The buffer ring is shared memory, returning a buffer needs no syscall */
+	const UINT16 tail = uring->bufRing->tail;
+	struct io_uring_buf* buf = &uring->bufRing->bufs[tail & (URING_RECV_BUFFERS - 1)];
+	buf->addr = (UINT64)(uintptr_t)&uring->recvBuffers[(size_t)bid * URING_RECV_BUFFER_SIZE];
+	buf->len = URING_RECV_BUFFER_SIZE;
+	buf->bid = bid;
+	__atomic_store_n(&uring->bufRing->tail, (UINT16)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static void uring_arm_recv(rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+
+	/* With all buffers queued for reading the receive is armed again when one is returned */
+	if (uring->recvArmed || uring->eof || (uring->chunkCount >= URING_RECV_BUFFERS))
+		return;
+
+	struct io_uring_sqe* sqe = uring_get_sqe(uring);
+	if (!sqe)
+		return;
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = uring->sockfd;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUFFER_GROUP;
+	sqe->ioprio = uring->multishot ? IORING_RECV_MULTISHOT : 0;
+	sqe->user_data = URING_OP_RECV;
+	uring->recvArmed = TRUE;
+}
+
+static void uring_start_send(rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+
+	if ((uring->sendInFlight > 0) || (uring->sendUsed == 0) || uring->failed)
+		return;
+
+	struct io_uring_sqe* sqe = uring_get_sqe(uring);
+	if (!sqe)
+		return;
+
+	/* A single send in flight keeps the stream in order, the wrapped rest goes next */
+	const size_t length = MIN(uring->sendUsed, URING_SEND_BUFFER_SIZE - uring->sendHead);
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = uring->sockfd;
+	sqe->addr = (UINT64)(uintptr_t)&uring->sendBuffer[uring->sendHead];
+	sqe->len = (UINT32)length;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = URING_OP_SEND;
+	uring->sendInFlight = length;
+}
+
+static void uring_complete_recv(rdpUringLayer* uring, const struct io_uring_cqe* cqe)
+{
+	WINPR_ASSERT(uring);
+	WINPR_ASSERT(cqe);
+
+	if (!(cqe->flags & IORING_CQE_F_MORE))
+		uring->recvArmed = FALSE;
+
+	if ((cqe->res > 0) && (cqe->flags & IORING_CQE_F_BUFFER))
+	{
+		const UINT16 bid = (UINT16)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+		WINPR_ASSERT(uring->chunkCount < URING_RECV_BUFFERS);
+
+		rdpUringChunk* chunk =
+		    &uring->chunks[(uring->chunkHead + uring->chunkCount) % URING_RECV_BUFFERS];
+		chunk->bid = bid;
+		chunk->offset = 0;
+		chunk->length = (UINT32)cqe->res;
+		uring->chunkCount++;
+		uring->received = TRUE;
+		return;
+	}
+
+	if (cqe->flags & IORING_CQE_F_BUFFER)
+		uring_recycle_buffer(uring, (UINT16)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+
+	switch (cqe->res)
+	{
+		case -ENOBUFS:
+			break;
+
+		case -EINVAL:
+			if (uring->multishot && !uring->received)
+			{
+				WLog_DBG(TAG, "multishot receive not supported, falling back to single shots");
+				uring->multishot = FALSE;
+				break;
+			}
+			uring->eof = TRUE;
+			break;
+
+		case 0:
+			uring->eof = TRUE;
+			break;
+
+		default:
+			if (cqe->res < 0)
+			{
+				WLog_DBG(TAG, "receive failed with %s [%d]", strerror(-cqe->res), -cqe->res);
+				uring->eof = TRUE;
+			}
+			break;
+	}
+}
+
+static void uring_complete_send(rdpUringLayer* uring, const struct io_uring_cqe* cqe)
+{
+	WINPR_ASSERT(uring);
+	WINPR_ASSERT(cqe);
+
+	uring->sendInFlight = 0;
+	if (cqe->res < 0)
+	{
+		WLog_DBG(TAG, "send failed with %s [%d]", strerror(-cqe->res), -cqe->res);
+		uring->failed = TRUE;
+		return;
+	}
+
+	/* Short sends leave the rest queued for the next one */
+	WINPR_ASSERT((size_t)cqe->res <= uring->sendUsed);
+	uring->sendHead = (uring->sendHead + (size_t)cqe->res) % URING_SEND_BUFFER_SIZE;
+	uring->sendUsed -= (size_t)cqe->res;
+	if (uring->sendUsed == 0)
+		uring->sendHead = 0;
+}
+
+static void uring_reap(rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+
+	UINT32 head = *uring->cqHead;
+	const UINT32 tail = uring_load(uring->cqTail);
+
+	for (; head != tail; head++)
+	{
+		const struct io_uring_cqe* cqe = &uring->cqes[head & uring->cqMask];
+
+		switch (cqe->user_data)
+		{
+			case URING_OP_RECV:
+				uring_complete_recv(uring, cqe);
+				break;
+			case URING_OP_SEND:
+				uring_complete_send(uring, cqe);
+				break;
+			default:
+				break;
+		}
+	}
+
+	uring_store(uring->cqHead, head);
+	uring_start_send(uring);
+}
+
+static BOOL uring_readable(const rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+	return (uring->chunkCount > 0) || uring->eof || uring->failed;
+}
+
+static BOOL uring_writable(const rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+	return (uring->sendUsed < URING_SEND_BUFFER_SIZE) || uring->failed;
+}
+
+/* Submits what was queued and keeps the event set while data is buffered or completions wait */
+static BOOL uring_update(rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+
+	uring_arm_recv(uring);
+	if (uring_enter(uring, 0, 0) < 0)
+		return FALSE;
+
+	if (uring_readable(uring))
+	{
+		if (!uring->signaled)
+			uring->signaled = SetEvent(uring->event);
+		return TRUE;
+	}
+
+	/* The kernel signals the event for each completion, unchanged tail means nothing arrived */
+	const UINT32 tail = uring_load(uring->cqTail);
+	if (uring->signaled || (tail != uring->eventTail))
+	{
+		(void)ResetEvent(uring->event);
+		uring->signaled = FALSE;
+		uring->eventTail = tail;
+
+		if (*uring->cqHead != uring_load(uring->cqTail))
+			uring->signaled = SetEvent(uring->event);
+	}
+	return TRUE;
+}
+
+static int uring_layer_read(void* userContext, void* data, int bytes)
+{
+	if (!userContext)
+		return -1;
+	if (!data || !bytes)
+		return 0;
+
+	rdpUringLayer* uring = (rdpUringLayer*)userContext;
+	BYTE* dst = data;
+	size_t copied = 0;
+
+	uring_reap(uring);
+	while ((copied < (size_t)bytes) && (uring->chunkCount > 0))
+	{
+		rdpUringChunk* chunk = &uring->chunks[uring->chunkHead];
+		const size_t length = MIN((size_t)bytes - copied, chunk->length);
+		const BYTE* src = &uring->recvBuffers[(size_t)chunk->bid * URING_RECV_BUFFER_SIZE];
+
+		memcpy(&dst[copied], &src[chunk->offset], length);
+		chunk->offset += (UINT32)length;
+		chunk->length -= (UINT32)length;
+		copied += length;
+
+		if (chunk->length == 0)
+		{
+			uring_recycle_buffer(uring, chunk->bid);
+			uring->chunkHead = (uring->chunkHead + 1) % URING_RECV_BUFFERS;
+			uring->chunkCount--;
+		}
+	}
+
+	if (!uring_update(uring))
+		return -1;
+
+	if (copied > 0)
+		return (int)copied;
+	if (uring->eof)
+		return -1; /* socket closed */
+	return 0;
+}
+
+static int uring_layer_write(void* userContext, const void* data, int bytes)
+{
+	if (!userContext)
+		return -1;
+	if (!data || !bytes)
+		return 0;
+
+	rdpUringLayer* uring = (rdpUringLayer*)userContext;
+	const BYTE* src = data;
+
+	uring_reap(uring);
+	if (uring->failed)
+		return -1;
+
+	const size_t length = MIN((size_t)bytes, URING_SEND_BUFFER_SIZE - uring->sendUsed);
+	if (length > 0)
+	{
+		const size_t tail = (uring->sendHead + uring->sendUsed) % URING_SEND_BUFFER_SIZE;
+		const size_t first = MIN(length, URING_SEND_BUFFER_SIZE - tail);
+
+		memcpy(&uring->sendBuffer[tail], src, first);
+		memcpy(uring->sendBuffer, &src[first], length - first);
+		uring->sendUsed += length;
+		uring_start_send(uring);
+	}
+
+	if (!uring_update(uring))
+		return -1;
+	return (int)length;
+}
+
+static BOOL uring_layer_wait(void* userContext, BOOL waitWrite, DWORD timeout)
+{
+	if (!userContext)
+		return FALSE;
+
+	rdpUringLayer* uring = (rdpUringLayer*)userContext;
+	const UINT64 start = GetTickCount64();
+
+	for (;;)
+	{
+		uring_reap(uring);
+		if (waitWrite ? uring_writable(uring) : uring_readable(uring))
+			return uring_update(uring);
+
+		DWORD remaining = INFINITE;
+		if (timeout != INFINITE)
+		{
+			const UINT64 elapsed = GetTickCount64() - start;
+			if (elapsed >= timeout)
+			{
+				(void)uring_update(uring);
+				return FALSE;
+			}
+			remaining = (DWORD)(timeout - elapsed);
+		}
+
+		uring_arm_recv(uring);
+		if (uring_enter(uring, 1, remaining) < 0)
+			return FALSE;
+	}
+}
+
+static HANDLE uring_layer_get_event(void* userContext)
+{
+	if (!userContext)
+		return NULL;
+
+	rdpUringLayer* uring = (rdpUringLayer*)userContext;
+	return uring->event;
+}
+
+static BOOL uring_busy(const rdpUringLayer* uring)
+{
+	WINPR_ASSERT(uring);
+	return uring->recvArmed || (uring->sendInFlight > 0);
+}
+
+static BOOL uring_layer_close(void* userContext)
+{
+	if (!userContext)
+		return FALSE;
+
+	rdpUringLayer* uring = (rdpUringLayer*)userContext;
+	BOOL idle = TRUE;
+
+	if (uring->ringfd >= 0)
+	{
+		/* Flush what was written, then shut the socket down to end the pending receive */
+		const UINT64 start = GetTickCount64();
+		while ((uring->sendUsed > 0) && !uring->failed &&
+		       (GetTickCount64() - start < URING_CLOSE_TIMEOUT_MS))
+		{
+			if (uring_enter(uring, 1, URING_CLOSE_TIMEOUT_MS) < 0)
+				break;
+			uring_reap(uring);
+		}
+
+		if (uring->sockfd >= 0)
+			(void)shutdown(uring->sockfd, SHUT_RDWR);
+
+		uring_reap(uring);
+		while (uring_busy(uring) && (GetTickCount64() - start < 2 * URING_CLOSE_TIMEOUT_MS))
+		{
+			if (uring_enter(uring, 1, URING_CLOSE_TIMEOUT_MS) < 0)
+				break;
+			uring_reap(uring);
+		}
+		idle = !uring_busy(uring);
+		(void)close(uring->ringfd);
+	}
+
+	if (uring->sockfd >= 0)
+		closesocket((SOCKET)uring->sockfd);
+	if (uring->event)
+		(void)CloseHandle(uring->event);
+	if (uring->ring)
+		(void)munmap(uring->ring, uring->ringSize);
+	if (uring->sqes)
+		(void)munmap(uring->sqes, uring->sqesSize);
+
+	/* The kernel might still write to buffers of operations that did not complete */
+	if (!idle)
+	{
+		WLog_WARN(TAG, "io_uring operations did not complete, not releasing their buffers");
+		return TRUE;
+	}
+
+	if (uring->bufRing)
+		(void)munmap(uring->bufRing, uring->bufRingSize);
+	free(uring->recvBuffers);
+	free(uring->sendBuffer);
+	return TRUE;
+}
+
+static BOOL uring_setup(rdpUringLayer* uring, int sockfd)
+{
+	WINPR_ASSERT(uring);
+
+	struct io_uring_params params = { 0 };
+	uring->ringfd = (int)syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+	if (uring->ringfd < 0)
+	{
+		WLog_WARN(TAG, "io_uring_setup failed with %s [%d]", strerror(errno), errno);
+		return FALSE;
+	}
+
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG))
+	{
+		WLog_WARN(TAG, "io_uring of this kernel lacks the required features");
+		return FALSE;
+	}
+
+	const size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(UINT32);
+	const size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	uring->ringSize = MAX(sqSize, cqSize);
+	void* ring = mmap(NULL, uring->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                  uring->ringfd, IORING_OFF_SQ_RING);
+	if (ring == MAP_FAILED)
+		return FALSE;
+	uring->ring = ring;
+
+	uring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = mmap(NULL, uring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                  uring->ringfd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED)
+		return FALSE;
+	uring->sqes = sqes;
+
+	BYTE* base = ring;
+	uring->sqHead = (UINT32*)&base[params.sq_off.head];
+	uring->sqTail = (UINT32*)&base[params.sq_off.tail];
+	uring->sqArray = (UINT32*)&base[params.sq_off.array];
+	uring->sqMask = *(UINT32*)&base[params.sq_off.ring_mask];
+	uring->sqEntries = params.sq_entries;
+	uring->cqHead = (UINT32*)&base[params.cq_off.head];
+	uring->cqTail = (UINT32*)&base[params.cq_off.tail];
+	uring->cqMask = *(UINT32*)&base[params.cq_off.ring_mask];
+	uring->cqes = (struct io_uring_cqe*)&base[params.cq_off.cqes];
+
+	/* The kernel signals completions on the eventfd behind the event */
+	uring->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!uring->event)
+		return FALSE;
+	const int eventfd = GetEventFileDescriptor(uring->event);
+	if ((eventfd < 0) ||
+	    (syscall(__NR_io_uring_register, uring->ringfd, IORING_REGISTER_EVENTFD, &eventfd, 1) < 0))
+	{
+		WLog_WARN(TAG, "failed to register the completion event");
+		return FALSE;
+	}
+
+	uring->bufRingSize = URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+	void* bufRing = mmap(NULL, uring->bufRingSize, PROT_READ | PROT_WRITE,
+	                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (bufRing == MAP_FAILED)
+		return FALSE;
+	uring->bufRing = bufRing;
+
+	struct io_uring_buf_reg reg = { 0 };
+	reg.ring_addr = (UINT64)(uintptr_t)bufRing;
+	reg.ring_entries = URING_RECV_BUFFERS;
+	reg.bgid = URING_BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, uring->ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+	{
+		WLog_WARN(TAG, "failed to register the receive buffers with %s [%d]", strerror(errno),
+		          errno);
+		return FALSE;
+	}
+
+	uring->recvBuffers = calloc(URING_RECV_BUFFERS, URING_RECV_BUFFER_SIZE);
+	uring->sendBuffer = calloc(1, URING_SEND_BUFFER_SIZE);
+	if (!uring->recvBuffers || !uring->sendBuffer)
+		return FALSE;
+
+	for (UINT16 bid = 0; bid < URING_RECV_BUFFERS; bid++)
+		uring_recycle_buffer(uring, bid);
+
+	uring->sockfd = sockfd;
+	uring->multishot = TRUE;
+	uring_arm_recv(uring);
+	return uring_enter(uring, 0, 0) >= 0;
+}
+
+rdpTransportLayer* freerdp_uring_layer_new(rdpTransport* transport, int sockfd)
+{
+	WINPR_ASSERT(transport);
+
+	rdpTransportLayer* layer = transport_layer_new(transport, sizeof(rdpUringLayer));
+	if (!layer)
+		return NULL;
+
+	rdpUringLayer* uring = (rdpUringLayer*)layer->userContext;
+	WINPR_ASSERT(uring);
+
+	uring->sockfd = -1;
+	uring->ringfd = -1;
+	layer->Close = uring_layer_close;
+
+	if (!uring_setup(uring, sockfd))
+	{
+		/* The socket stays with the caller, the receive was not submitted if setup failed */
+		uring->sockfd = -1;
+		uring->recvArmed = FALSE;
+		transport_layer_free(layer);
+		return NULL;
+	}
+
+	layer->Read = uring_layer_read;
+	layer->Write = uring_layer_write;
+	layer->Wait = uring_layer_wait;
+	layer->GetEvent = uring_layer_get_event;
+
+	WLog_DBG(TAG, "using io_uring for socket %d", sockfd);
+	return layer;
+}
+
+#else
+
+rdpTransportLayer* freerdp_uring_layer_new(rdpTransport* transport, int sockfd)
+{
+	WINPR_UNUSED(transport);
+	WINPR_UNUSED(sockfd);
+
+	WLog_WARN(TAG, "io_uring support was not compiled in");
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * io_uring Transport Layer
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_CORE_URING_H
+#define FREERDP_LIB_CORE_URING_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/api.h>
+#include <freerdp/transport_io.h>
+
+/**
+ * @brief freerdp_uring_layer_new Creates an io_uring backed transport layer for a connected
+ * socket.
+ *
+ * Data is received with a multishot receive into a ring of buffers provided to the kernel,
+ * writes are collected while a send is in flight and go out with the next one.
+ *
+ * @param transport The transport the layer is created for
+ * @param sockfd The connected socket, owned by the layer if it was created
+ * @return The new layer or NULL if the kernel lacks the required io_uring features
+ */
+FREERDP_LOCAL rdpTransportLayer* freerdp_uring_layer_new(rdpTransport* transport, int sockfd);
+
+#endif /* FREERDP_LIB_CORE_URING_H */
@@ -23,6 +23,9 @@
 #include "settings.h"
 
 #include <winpr/assert.h>
+#include <winpr/thread.h>
+
+#include <errno.h>
 
 #include <freerdp/freerdp.h>
 #include <freerdp/channels/cliprdr.h>
@@ -480,3 +483,50 @@ BOOL utils_reload_channels(rdpContext* context)
 		return freerdp_channels_pre_connect(context->channels, context->instance) == CHANNEL_RC_OK;
 	return rc;
 }
+
+BOOL utils_apply_thread_affinity(wLog* log, const rdpSettings* settings)
+{
+	UINT32 cpus[1024] = { 0 };
+	size_t count = ARRAYSIZE(cpus);
+
+	WINPR_ASSERT(log);
+	WINPR_ASSERT(settings);
+
+	const char* affinity = freerdp_settings_get_string(settings, FreeRDP_ThreadAffinity);
+	if (utils_str_is_empty(affinity))
+		return TRUE;
+
+	const char numa[] = "numa:";
+	if (strncmp(affinity, numa, sizeof(numa) - 1) == 0)
+	{
+		char* end = NULL;
+		const char* str = &affinity[sizeof(numa) - 1];
+
+		errno = 0;
+		const unsigned long node = strtoul(str, &end, 10);
+		if ((errno != 0) || (end == str) || (*end != '\0') || (node > UINT32_MAX))
+		{
+			WLog_Print(log, WLOG_ERROR, "invalid FreeRDP_ThreadAffinity '%s'", affinity);
+			return FALSE;
+		}
+
+		if (!winpr_GetNumaNodeProcessors((UINT32)node, cpus, &count))
+		{
+			WLog_Print(log, WLOG_WARN, "NUMA node %lu not available, not pinning threads", node);
+			return TRUE;
+		}
+	}
+	else if (!winpr_ParseProcessorList(affinity, cpus, &count))
+	{
+		WLog_Print(log, WLOG_ERROR, "invalid FreeRDP_ThreadAffinity '%s'", affinity);
+		return FALSE;
+	}
+
+	/* affinity is an optimization, a platform without support keeps the session running */
+	if (!winpr_SetCurrentThreadAffinity(cpus, count))
+		WLog_Print(log, WLOG_WARN, "failed to pin the session thread to '%s'", affinity);
+	else
+		WLog_Print(log, WLOG_DEBUG, "session thread pinned to '%s'", affinity);
+
+	return TRUE;
+}
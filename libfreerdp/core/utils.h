@@ -61,4 +61,7 @@ char* utils_redir_flags_to_string(UINT32 flags, char* buffer, size_t size);
 
 BOOL utils_reload_channels(rdpContext* context);
 
+/* Pins the calling thread to FreeRDP_ThreadAffinity, thread pools it creates inherit this */
+BOOL utils_apply_thread_affinity(wLog* log, const rdpSettings* settings);
+
 #endif /* FREERDP_LIB_CORE_UTILS_H */
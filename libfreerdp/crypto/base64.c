@@ -20,6 +20,7 @@
 #include <freerdp/config.h>
 
 #include <winpr/crt.h>
+#include <winpr/synch.h>
 
 #include <freerdp/crypto/crypto.h>
 
@@ -302,6 +303,64 @@ static const signed char dec_base64[] = {
 	-1, /* 127        177	7F	01111111	DEL	&#127;	 	Delete */
 };
 
+/*
+ * Lookup tables derived from the alphabets above on first use:
+ * the encoder maps 12 input bits to two output characters at once, the
+ * decoder gets one table per character position holding the value already
+ * shifted into place, so a block is decoded with four lookups OR-ed together
+ * and a single validity check.
+ */
+#define BASE64_INVALID 0x01000000
+
+typedef struct
+{
+	char pairs[4096][2];
+	UINT32 dec[4][256];
+} base64_tables;
+
+static base64_tables tables_base64;
+static base64_tables tables_base64url;
+static INIT_ONCE base64_tables_once = INIT_ONCE_STATIC_INIT;
+
+static void base64_tables_fill(base64_tables* tables, const BYTE* enc, const signed char* dec)
+{
+	for (size_t x = 0; x < 4096; x++)
+	{
+		tables->pairs[x][0] = (char)enc[x >> 6];
+		tables->pairs[x][1] = (char)enc[x & 0x3F];
+	}
+
+	for (size_t x = 0; x < 256; x++)
+	{
+		const int val = (x < 128) ? dec[x] : -1;
+		for (size_t y = 0; y < 4; y++)
+			tables->dec[y][x] = (val < 0) ? BASE64_INVALID : ((UINT32)val << (18 - 6 * y));
+	}
+}
+
+static BOOL CALLBACK base64_tables_init(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	base64_tables_fill(&tables_base64, enc_base64, dec_base64);
+	base64_tables_fill(&tables_base64url, enc_base64url, dec_base64url);
+	return TRUE;
+}
+
+static const base64_tables* base64_get_tables(const BYTE* alphabet)
+{
+	if (!InitOnceExecuteOnce(&base64_tables_once, base64_tables_init, NULL, NULL))
+		return NULL;
+	return (alphabet == enc_base64) ? &tables_base64 : &tables_base64url;
+}
+
+static const base64_tables* base64_get_decode_tables(const signed char* alphabet)
+{
+	return base64_get_tables((alphabet == dec_base64) ? enc_base64 : enc_base64url);
+}
+
 static INLINE char* base64_encode_ex(const BYTE* WINPR_RESTRICT alphabet,
                                      const BYTE* WINPR_RESTRICT data, size_t length, BOOL pad,
                                      BOOL crLf, size_t lineSize)
@@ -320,6 +379,10 @@ static INLINE char* base64_encode_ex(const BYTE* WINPR_RESTRICT alphabet,
 	}
 	size_t outCounter = 0;
 
+	const base64_tables* tables = base64_get_tables(alphabet);
+	if (!tables)
+		return NULL;
+
 	q = data;
 	p = ret = (char*)malloc(outLen + extra + 1ull);
 	if (!p)
@@ -343,10 +406,9 @@ static INLINE char* base64_encode_ex(const BYTE* WINPR_RESTRICT alphabet,
 	{
 		c = (q[0] << 16) + (q[1] << 8) + q[2];
 
-		*p++ = alphabet[(c & 0x00FC0000) >> 18];
-		*p++ = alphabet[(c & 0x0003F000) >> 12];
-		*p++ = alphabet[(c & 0x00000FC0) >> 6];
-		*p++ = alphabet[c & 0x0000003F];
+		memcpy(p, tables->pairs[c >> 12], 2);
+		memcpy(&p[2], tables->pairs[c & 0xFFF], 2);
+		p += 4;
 
 		outCounter += 4;
 		if (crLf && (outCounter % lineSize == 0))
@@ -422,6 +484,10 @@ static INLINE void* base64_decode(const signed char* WINPR_RESTRICT alphabet,
 	if (!pad && remainder)
 		length += 4 - remainder;
 
+	const base64_tables* tables = base64_get_decode_tables(alphabet);
+	if (!tables)
+		return NULL;
+
 	q = data = (BYTE*)malloc(length / 4 * 3 + 1);
 	if (!q)
 		return NULL;
@@ -436,21 +502,21 @@ static INLINE void* base64_decode(const signed char* WINPR_RESTRICT alphabet,
 		return NULL;
 	}
 
-	for (size_t i = 0; i < nBlocks - 1; i++, q += 3)
+	const BYTE* in = (const BYTE*)s;
+	for (size_t i = 0; i < nBlocks - 1; i++, q += 3, in += 4)
 	{
-		n[0] = base64_decode_char(alphabet, *s++);
-		n[1] = base64_decode_char(alphabet, *s++);
-		n[2] = base64_decode_char(alphabet, *s++);
-		n[3] = base64_decode_char(alphabet, *s++);
+		const UINT32 val = tables->dec[0][in[0]] | tables->dec[1][in[1]] |
+		                   tables->dec[2][in[2]] | tables->dec[3][in[3]];
 
-		if ((n[0] == -1) || (n[1] == -1) || (n[2] == -1) || (n[3] == -1))
+		if (val & BASE64_INVALID)
 			goto out_free;
 
-		q[0] = (n[0] << 2) + (n[1] >> 4);
-		q[1] = ((n[1] & 15) << 4) + (n[2] >> 2);
-		q[2] = ((n[2] & 3) << 6) + n[3];
-		outputLen += 3;
+		q[0] = (BYTE)(val >> 16);
+		q[1] = (BYTE)(val >> 8);
+		q[2] = (BYTE)val;
 	}
+	outputLen = (nBlocks - 1) * 3;
+	s = (const char*)in;
 
 	/* treat last block */
 	n[0] = base64_decode_char(alphabet, *s++);
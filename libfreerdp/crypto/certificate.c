@@ -32,8 +32,12 @@
 #include <winpr/wtypes.h>
 #include <winpr/crt.h>
 #include <winpr/file.h>
+#include <winpr/interlocked.h>
 #include <winpr/print.h>
 #include <winpr/crypto.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
 
 #include <freerdp/crypto/certificate.h>
 
@@ -59,6 +63,12 @@
 
 #define TAG FREERDP_TAG("core")
 
+/* how long a successful chain verification is trusted without redoing it, in ms */
+#define CERTIFICATE_VERIFY_CACHE_TTL (5ull * 60ull * 1000ull)
+
+/* upper bound of the process wide verification cache, it is flushed when full */
+#define CERTIFICATE_VERIFY_CACHE_MAX_ENTRIES 256
+
 #ifdef WITH_DEBUG_CERTIFICATE
 #define CERTIFICATE_TAG FREERDP_TAG("core.certificate")
 #define DEBUG_CERTIFICATE(...) WLog_DBG(TAG, __VA_ARGS__)
@@ -92,6 +102,8 @@ struct rdp_certificate
 
 	rdpCertInfo cert_info;
 	rdpX509CertChain x509_cert_chain;
+
+	LONG refCount;
 };
 
 /**
@@ -1171,7 +1183,27 @@ out_fail:
 
 rdpCertificate* freerdp_certificate_new(void)
 {
-	return (rdpCertificate*)calloc(1, sizeof(rdpCertificate));
+	rdpCertificate* cert = (rdpCertificate*)calloc(1, sizeof(rdpCertificate));
+
+	if (cert)
+		cert->refCount = 1;
+	return cert;
+}
+
+rdpCertificate* freerdp_certificate_ref(rdpCertificate* cert)
+{
+	if (!cert)
+		return NULL;
+
+	(void)InterlockedIncrement(&cert->refCount);
+	return cert;
+}
+
+BOOL freerdp_certificate_is_shared(const rdpCertificate* cert)
+{
+	WINPR_ASSERT(cert);
+	return InterlockedCompareExchange(WINPR_CAST_CONST_PTR_AWAY(&cert->refCount, LONG*), 0, 0) >
+	       1;
 }
 
 void certificate_free_int(rdpCertificate* cert)
@@ -1189,6 +1221,7 @@ void certificate_free_int(rdpCertificate* cert)
 
 /**
  * Free certificate module.
+ * The certificate is only released once the last reference was dropped.
  * @param cert certificate module to be freed
  */
 
@@ -1197,6 +1230,9 @@ void freerdp_certificate_free(rdpCertificate* cert)
 	if (!cert)
 		return;
 
+	if (InterlockedDecrement(&cert->refCount) > 0)
+		return;
+
 	certificate_free_int(cert);
 	free(cert);
 }
@@ -1576,10 +1612,103 @@ exit:
 	return status;
 }
 
+static INIT_ONCE certificate_verify_cache_once = INIT_ONCE_STATIC_INIT;
+static wHashTable* certificate_verify_cache = NULL;
+
+static BOOL CALLBACK certificate_verify_cache_init_cb(PINIT_ONCE once, PVOID param,
+                                                      PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	wHashTable* table = HashTable_New(TRUE);
+	if (!table || !HashTable_SetupForStringData(table, FALSE))
+	{
+		HashTable_Free(table);
+		return FALSE;
+	}
+
+	wObject* obj = HashTable_ValueObject(table);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = free;
+
+	certificate_verify_cache = table;
+	return TRUE;
+}
+
+/* the leaf fingerprint and the store path identify a verification result */
+static char* certificate_verify_cache_key(const rdpCertificate* cert,
+                                          const char* certificate_store_path)
+{
+	char* key = NULL;
+	size_t length = 0;
+	char* fp = freerdp_certificate_get_fingerprint_by_hash_ex(cert, "sha256", FALSE);
+
+	if (!fp)
+		return NULL;
+
+	(void)winpr_asprintf(&key, &length, "%s|%s", fp,
+	                     certificate_store_path ? certificate_store_path : "");
+	free(fp);
+	return key;
+}
+
+static BOOL certificate_verify_cache_lookup(const char* key)
+{
+	BOOL valid = FALSE;
+
+	HashTable_Lock(certificate_verify_cache);
+	const UINT64* expires = HashTable_GetItemValue(certificate_verify_cache, key);
+	if (expires)
+	{
+		valid = GetTickCount64() < *expires;
+		if (!valid)
+			HashTable_Remove(certificate_verify_cache, key);
+	}
+	HashTable_Unlock(certificate_verify_cache);
+	return valid;
+}
+
+static void certificate_verify_cache_insert(const char* key)
+{
+	UINT64* expires = malloc(sizeof(UINT64));
+	if (!expires)
+		return;
+
+	*expires = GetTickCount64() + CERTIFICATE_VERIFY_CACHE_TTL;
+
+	HashTable_Lock(certificate_verify_cache);
+	if (HashTable_Count(certificate_verify_cache) >= CERTIFICATE_VERIFY_CACHE_MAX_ENTRIES)
+		HashTable_Clear(certificate_verify_cache);
+	if (!HashTable_Insert(certificate_verify_cache, key, expires))
+		free(expires);
+	HashTable_Unlock(certificate_verify_cache);
+}
+
 BOOL freerdp_certificate_verify(const rdpCertificate* cert, const char* certificate_store_path)
 {
 	WINPR_ASSERT(cert);
-	return x509_utils_verify(cert->x509, cert->chain, certificate_store_path);
+
+	/* parsing the system trust store dominates, skip it for certificates verified recently */
+	char* key = NULL;
+	if (InitOnceExecuteOnce(&certificate_verify_cache_once, certificate_verify_cache_init_cb,
+	                        NULL, NULL))
+		key = certificate_verify_cache_key(cert, certificate_store_path);
+
+	if (key && certificate_verify_cache_lookup(key))
+	{
+		free(key);
+		return TRUE;
+	}
+
+	const BOOL rc = x509_utils_verify(cert->x509, cert->chain, certificate_store_path);
+
+	/* failures are not cached, the user might add the missing CA any time */
+	if (rc && key)
+		certificate_verify_cache_insert(key);
+	free(key);
+	return rc;
 }
 
 char** freerdp_certificate_get_dns_names(const rdpCertificate* cert, size_t* pcount,
@@ -52,6 +52,13 @@ FREERDP_LOCAL SSIZE_T freerdp_certificate_write_server_cert(const rdpCertificate
 WINPR_ATTR_MALLOC(freerdp_certificate_free, 1)
 FREERDP_LOCAL rdpCertificate* freerdp_certificate_clone(const rdpCertificate* certificate);
 
+/** \brief adds a reference to an immutable certificate.
+ *  Each reference is released with freerdp_certificate_free. A shared certificate must not be
+ *  modified, replace it with a new instance instead.
+ */
+FREERDP_LOCAL rdpCertificate* freerdp_certificate_ref(rdpCertificate* certificate);
+FREERDP_LOCAL BOOL freerdp_certificate_is_shared(const rdpCertificate* certificate);
+
 FREERDP_LOCAL const rdpCertInfo* freerdp_certificate_get_info(const rdpCertificate* certificate);
 
 /** \brief returns a pointer to a X509 structure.
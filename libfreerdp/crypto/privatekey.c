@@ -32,6 +32,7 @@
 #include <winpr/wtypes.h>
 #include <winpr/crt.h>
 #include <winpr/file.h>
+#include <winpr/interlocked.h>
 #include <winpr/crypto.h>
 
 #include <openssl/pem.h>
@@ -62,6 +63,8 @@ struct rdp_private_key
 	rdpCertInfo cert;
 	BYTE* PrivateExponent;
 	DWORD PrivateExponentLength;
+
+	LONG refCount;
 };
 
 /*
@@ -261,7 +264,20 @@ fail:
 
 rdpPrivateKey* freerdp_key_new(void)
 {
-	return calloc(1, sizeof(rdpPrivateKey));
+	rdpPrivateKey* key = calloc(1, sizeof(rdpPrivateKey));
+
+	if (key)
+		key->refCount = 1;
+	return key;
+}
+
+rdpPrivateKey* freerdp_key_ref(rdpPrivateKey* key)
+{
+	if (!key)
+		return NULL;
+
+	(void)InterlockedIncrement(&key->refCount);
+	return key;
 }
 
 rdpPrivateKey* freerdp_key_clone(const rdpPrivateKey* key)
@@ -269,7 +285,7 @@ rdpPrivateKey* freerdp_key_clone(const rdpPrivateKey* key)
 	if (!key)
 		return NULL;
 
-	rdpPrivateKey* _key = (rdpPrivateKey*)calloc(1, sizeof(rdpPrivateKey));
+	rdpPrivateKey* _key = freerdp_key_new();
 
 	if (!_key)
 		return NULL;
@@ -310,6 +326,9 @@ void freerdp_key_free(rdpPrivateKey* key)
 	if (!key)
 		return;
 
+	if (InterlockedDecrement(&key->refCount) > 0)
+		return;
+
 	EVP_PKEY_free(key->evp);
 	if (key->PrivateExponent)
 		memset(key->PrivateExponent, 0, key->PrivateExponentLength);
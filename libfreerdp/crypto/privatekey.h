@@ -42,6 +42,9 @@ extern "C"
 
 	FREERDP_LOCAL rdpPrivateKey* freerdp_key_clone(const rdpPrivateKey* key);
 
+	/** \brief adds a reference to an immutable key, release it with freerdp_key_free */
+	FREERDP_LOCAL rdpPrivateKey* freerdp_key_ref(rdpPrivateKey* key);
+
 	FREERDP_LOCAL const rdpCertInfo* freerdp_key_get_info(const rdpPrivateKey* key);
 	FREERDP_LOCAL const BYTE* freerdp_key_get_exponent(const rdpPrivateKey* key, size_t* plength);
 
@@ -31,6 +31,7 @@
 #include <winpr/string.h>
 #include <winpr/sspi.h>
 #include <winpr/ssl.h>
+#include <winpr/sysinfo.h>
 #include <winpr/json.h>
 
 #include <winpr/stream.h>
@@ -39,10 +40,12 @@
 #include <freerdp/crypto/certificate.h>
 #include <freerdp/crypto/certificate_data.h>
 #include <freerdp/utils/helpers.h>
+#include <freerdp/peer.h>
 
 #include <freerdp/log.h>
 #include "../crypto/tls.h"
 #include "../core/tcp.h"
+#include "../core/handshake.h"
 
 #include "opensslcompat.h"
 #include "certificate.h"
@@ -726,6 +729,126 @@ static void SSLCTX_keylog_cb(const SSL* ssl, const char* line)
 	}
 }
 
+struct rdp_tls_session_cache
+{
+	CRITICAL_SECTION lock;
+	char* key;
+	SSL_SESSION* session;
+};
+
+/* Replaces the cached session, takes ownership of session */
+static void tls_session_cache_set(rdpTlsSessionCache* cache, const char* key,
+                                  SSL_SESSION* session)
+{
+	WINPR_ASSERT(cache);
+
+	char* copy = key ? _strdup(key) : NULL;
+
+	EnterCriticalSection(&cache->lock);
+	if (cache->session)
+		SSL_SESSION_free(cache->session);
+	free(cache->key);
+	cache->session = copy ? session : NULL;
+	cache->key = copy;
+	LeaveCriticalSection(&cache->lock);
+
+	if (!copy && session)
+		SSL_SESSION_free(session);
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+static INIT_ONCE tls_idx_once = INIT_ONCE_STATIC_INIT;
+static int tls_idx = -1;
+
+static BOOL CALLBACK tls_idx_init_cb(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	tls_idx = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+
+	return (tls_idx != -1);
+}
+
+static char* tls_session_cache_key(rdpTls* tls)
+{
+	size_t length = 0;
+	char* key = NULL;
+	const char* name = tls_get_server_name(tls);
+
+	if (!name)
+		return NULL;
+	(void)winpr_asprintf(&key, &length, "%s:%d", name, tls->port);
+	return key;
+}
+
+/* Returns a reference to the cached session for key, NULL if there is none */
+static SSL_SESSION* tls_session_cache_get(rdpTlsSessionCache* cache, const char* key)
+{
+	SSL_SESSION* session = NULL;
+
+	WINPR_ASSERT(cache);
+
+	if (!key)
+		return NULL;
+
+	EnterCriticalSection(&cache->lock);
+	if (cache->session && cache->key && (strcmp(cache->key, key) == 0) &&
+	    SSL_SESSION_is_resumable(cache->session))
+	{
+		session = cache->session;
+		SSL_SESSION_up_ref(session);
+	}
+	LeaveCriticalSection(&cache->lock);
+	return session;
+}
+
+/* TLS 1.3 sends the session tickets after the handshake, they are stored as they arrive */
+static int tls_new_session_cb(SSL* ssl, SSL_SESSION* session)
+{
+	if (tls_idx == -1)
+		return 0;
+
+	rdpTls* tls = SSL_get_ex_data(ssl, tls_idx);
+	if (!tls || !tls->sessionCache)
+		return 0;
+
+	char* key = tls_session_cache_key(tls);
+	tls_session_cache_set(tls->sessionCache, key, session);
+	free(key);
+	return 1;
+}
+#endif
+
+static void tls_session_cache_prepare(rdpTls* tls)
+{
+	WINPR_ASSERT(tls);
+
+	if (!tls->sessionCache)
+		return;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+	InitOnceExecuteOnce(&tls_idx_once, tls_idx_init_cb, NULL, NULL);
+	if (tls_idx == -1)
+		return;
+
+	SSL_set_ex_data(tls->ssl, tls_idx, tls);
+	SSL_CTX_set_session_cache_mode(tls->ctx,
+	                               SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(tls->ctx, tls_new_session_cb);
+
+	char* key = tls_session_cache_key(tls);
+	SSL_SESSION* session = tls_session_cache_get(tls->sessionCache, key);
+	free(key);
+
+	if (session)
+	{
+		WLog_DBG(TAG, "resuming the TLS session of the previous connection");
+		SSL_set_session(tls->ssl, session);
+		SSL_SESSION_free(session);
+	}
+#else
+	WLog_DBG(TAG, "TLS session resumption requires OpenSSL 1.1.1 or higher");
+#endif
+}
+
 static void tls_reset(rdpTls* tls)
 {
 	WINPR_ASSERT(tls);
@@ -777,17 +900,21 @@ static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int op
 	SSL_CTX_set_options(tls->ctx, options);
 	SSL_CTX_set_read_ahead(tls->ctx, 1);
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L || defined(LIBRESSL_VERSION_NUMBER)
-	UINT16 version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMinVersion);
-	if (!SSL_CTX_set_min_proto_version(tls->ctx, version))
-	{
-		WLog_ERR(TAG, "SSL_CTX_set_min_proto_version %s failed", version);
-		return FALSE;
-	}
-	version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMaxVersion);
-	if (!SSL_CTX_set_max_proto_version(tls->ctx, version))
+	/* the TLS version bounds do not apply to DTLS (multitransport lossy tunnels) */
+	if ((method != DTLS_client_method()) && (method != DTLS_server_method()))
 	{
-		WLog_ERR(TAG, "SSL_CTX_set_max_proto_version %s failed", version);
-		return FALSE;
+		UINT16 version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMinVersion);
+		if (!SSL_CTX_set_min_proto_version(tls->ctx, version))
+		{
+			WLog_ERR(TAG, "SSL_CTX_set_min_proto_version %s failed", version);
+			return FALSE;
+		}
+		version = freerdp_settings_get_uint16(settings, FreeRDP_TLSMaxVersion);
+		if (!SSL_CTX_set_max_proto_version(tls->ctx, version))
+		{
+			WLog_ERR(TAG, "SSL_CTX_set_max_proto_version %s failed", version);
+			return FALSE;
+		}
 	}
 #endif
 #if OPENSSL_VERSION_NUMBER >= 0x10100000L && !defined(LIBRESSL_VERSION_NUMBER)
@@ -811,6 +938,22 @@ static BOOL tls_prepare(rdpTls* tls, BIO* underlying, SSL_METHOD* method, int op
 		return FALSE;
 	}
 
+	if (freerdp_settings_get_bool(settings, FreeRDP_TlsKernelOffload))
+	{
+#if defined(SSL_OP_ENABLE_KTLS)
+		/* Only the socket BIO passes the keys to the kernel, transport layers and gateway
+		 * tunnels stay in userspace */
+		BIO* next = BIO_next(underlying);
+		if ((BIO_method_type(underlying) == BIO_TYPE_BUFFERED) && next &&
+		    (BIO_method_type(next) == BIO_TYPE_SIMPLE))
+			SSL_set_options(tls->ssl, SSL_OP_ENABLE_KTLS);
+		else
+			WLog_DBG(TAG, "kernel TLS offload requires a plain socket connection");
+#else
+		WLog_WARN(TAG, "kernel TLS offload not available - requires OpenSSL 3.0 or higher");
+#endif
+	}
+
 	if (settings->TlsSecretsFile)
 	{
 #if OPENSSL_VERSION_NUMBER >= 0x10101000L
@@ -905,6 +1048,7 @@ TlsHandshakeResult freerdp_tls_connect_ex(rdpTls* tls, BIO* underlying, const SS
 	SSL_set_tlsext_host_name(tls->ssl, WINPR_CAST_CONST_PTR_AWAY(str, void*));
 #endif
 
+	tls_session_cache_prepare(tls);
 	return freerdp_tls_handshake(tls);
 }
 
@@ -964,6 +1108,16 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 		/* server-side NLA needs public keys (keys from us, the server) but no certificate verify */
 		ret = TLS_HANDSHAKE_SUCCESS;
 
+#if defined(SSL_OP_ENABLE_KTLS)
+		if (SSL_get_options(tls->ssl) & SSL_OP_ENABLE_KTLS)
+		{
+			if (BIO_get_ktls_send(SSL_get_wbio(tls->ssl)))
+				WLog_INFO(TAG, "kernel TLS offload active for sending");
+			else
+				WLog_INFO(TAG, "kernel TLS offload not available, encrypting in userspace");
+		}
+#endif
+
 		if (tls->isClientMode)
 		{
 			verify_status = tls_verify_certificate(tls, cert, tls_get_server_name(tls), tls->port);
@@ -971,9 +1125,13 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 			if (verify_status < 1)
 			{
 				WLog_ERR(TAG, "certificate not trusted, aborting.");
+				if (tls->sessionCache)
+					tls_session_cache_set(tls->sessionCache, NULL, NULL);
 				freerdp_tls_send_alert(tls);
 				ret = TLS_HANDSHAKE_VERIFY_ERROR;
 			}
+			else if (SSL_session_reused(tls->ssl))
+				WLog_INFO(TAG, "TLS session resumed");
 		}
 	} while (0);
 
@@ -981,12 +1139,19 @@ TlsHandshakeResult freerdp_tls_handshake(rdpTls* tls)
 	return ret;
 }
 
-static int pollAndHandshake(rdpTls* tls)
+static int pollAndHandshake(rdpTls* tls, UINT32 timeout)
 {
 	WINPR_ASSERT(tls);
 
+	const UINT64 start = GetTickCount64();
 	do
 	{
+		if ((timeout > 0) && (GetTickCount64() - start > timeout))
+		{
+			WLog_WARN(TAG, "TLS handshake not completed within %" PRIu32 "ms", timeout);
+			return -1;
+		}
+
 		HANDLE event = NULL;
 		DWORD status = 0;
 		if (BIO_get_event(tls->bio, &event) < 0)
@@ -1046,7 +1211,7 @@ int freerdp_tls_connect(rdpTls* tls, BIO* underlying)
 			return -1;
 	}
 
-	return pollAndHandshake(tls);
+	return pollAndHandshake(tls, 0);
 }
 
 #if defined(MICROSOFT_IOS_SNI_BUG) && !defined(OPENSSL_NO_TLSEXT) && \
@@ -1079,7 +1244,9 @@ BOOL freerdp_tls_accept(rdpTls* tls, BIO* underlying, rdpSettings* settings)
 			return FALSE;
 	}
 
-	return pollAndHandshake(tls) > 0;
+	const rdpHandshakePool* pool =
+	    tls->context->peer ? tls->context->peer->HandshakePool : NULL;
+	return pollAndHandshake(tls, handshake_pool_timeout(pool)) > 0;
 }
 
 TlsHandshakeResult freerdp_tls_accept_ex(rdpTls* tls, BIO* underlying, rdpSettings* settings,
@@ -1181,6 +1348,10 @@ TlsHandshakeResult freerdp_tls_accept_ex(rdpTls* tls, BIO* underlying, rdpSettin
 		return TLS_HANDSHAKE_ERROR;
 	}
 
+	rdpHandshakePool* pool = tls->context->peer ? tls->context->peer->HandshakePool : NULL;
+	if (!handshake_pool_prepare_tls(pool, tls->ctx, tls->ssl))
+		return TLS_HANDSHAKE_ERROR;
+
 #if defined(MICROSOFT_IOS_SNI_BUG) && !defined(OPENSSL_NO_TLSEXT) && \
     !defined(LIBRESSL_VERSION_NUMBER)
 	SSL_set_tlsext_debug_callback(tls->ssl, tls_openssl_tlsext_debug_callback);
@@ -2092,3 +2263,29 @@ void freerdp_tls_free(rdpTls* tls)
 
 	free(tls);
 }
+
+rdpTlsSessionCache* freerdp_tls_session_cache_new(void)
+{
+	rdpTlsSessionCache* cache = calloc(1, sizeof(rdpTlsSessionCache));
+	if (!cache)
+		return NULL;
+
+	if (!InitializeCriticalSectionAndSpinCount(&cache->lock, 4000))
+	{
+		free(cache);
+		return NULL;
+	}
+	return cache;
+}
+
+void freerdp_tls_session_cache_free(rdpTlsSessionCache* cache)
+{
+	if (!cache)
+		return;
+
+	if (cache->session)
+		SSL_SESSION_free(cache->session);
+	free(cache->key);
+	DeleteCriticalSection(&cache->lock);
+	free(cache);
+}
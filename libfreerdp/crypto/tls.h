@@ -62,6 +62,7 @@
 #define TLS_ALERT_DESCRIPTION_UNSUPPORTED_EXTENSION 110
 
 typedef struct rdp_tls rdpTls;
+typedef struct rdp_tls_session_cache rdpTlsSessionCache;
 
 struct rdp_tls
 {
@@ -82,6 +83,7 @@ struct rdp_tls
 	int alertDescription;
 	BOOL isGatewayTransport;
 	BOOL isClientMode;
+	rdpTlsSessionCache* sessionCache;
 };
 
 /** @brief result of a handshake operation */
@@ -121,6 +123,12 @@ extern "C"
 
 	FREERDP_LOCAL void freerdp_tls_free(rdpTls* tls);
 
+	FREERDP_LOCAL void freerdp_tls_session_cache_free(rdpTlsSessionCache* cache);
+
+	/* Keeps the last client session so that reconnects to the same host:port resume it */
+	WINPR_ATTR_MALLOC(freerdp_tls_session_cache_free, 1)
+	FREERDP_LOCAL rdpTlsSessionCache* freerdp_tls_session_cache_new(void);
+
 	WINPR_ATTR_MALLOC(freerdp_tls_free, 1)
 	FREERDP_LOCAL rdpTls* freerdp_tls_new(rdpContext* context);
 
@@ -162,8 +162,8 @@ HGDI_BITMAP gdi_CreateCompatibleBitmap(HGDI_DC hdc, UINT32 nWidth, UINT32 nHeigh
 	hBitmap->height = (INT32)nHeight;
 
 	size_t size = 1ull * nWidth * nHeight * FreeRDPGetBytesPerPixel(hBitmap->format);
-	hBitmap->data = winpr_aligned_malloc(size, 16);
-	hBitmap->free = winpr_aligned_free;
+	hBitmap->data = winpr_large_malloc(size, 16);
+	hBitmap->free = winpr_large_free;
 
 	if (!hBitmap->data)
 	{
@@ -461,10 +461,234 @@ static BOOL adjust_src_dst_coordinates(HGDI_DC hdcDest, INT32* pnXSrc, INT32* pn
 	return TRUE;
 }
 
+/**
+ * Evaluate a ROP3 code bitwise on whole words. Every set bit of the code selects one
+ * combination (minterm) of pattern, source and destination bits.
+ */
+static INLINE UINT32 rop3_eval(BYTE code, UINT32 src, UINT32 dst, UINT32 pat)
+{
+	UINT32 result = 0;
+
+	for (UINT32 i = 0; i < 8; i++)
+	{
+		if (code & (1u << i))
+			result |= ((i & 4) ? pat : ~pat) & ((i & 2) ? src : ~src) & ((i & 1) ? dst : ~dst);
+	}
+
+	return result;
+}
+
+/**
+ * Apply a ROP3 code to one scanline of 32bpp pixels. The operands are raw pixel words, as
+ * all codes are bitwise the channel order does not matter. The frequently used codes get
+ * loops of their own the compiler can vectorize.
+ */
+static void rop3_row(BYTE code, UINT32* WINPR_RESTRICT dst, const UINT32* WINPR_RESTRICT src,
+                     const UINT32* WINPR_RESTRICT pat, size_t width)
+{
+	switch (code)
+	{
+		case 0xCC: /* SRCCOPY */
+			memcpy(dst, src, width * sizeof(UINT32));
+			break;
+
+		case 0xF0: /* PATCOPY */
+			memcpy(dst, pat, width * sizeof(UINT32));
+			break;
+
+		case 0x55: /* DSTINVERT */
+			for (size_t x = 0; x < width; x++)
+				dst[x] = ~dst[x];
+			break;
+
+		case 0x5A: /* PATINVERT */
+			for (size_t x = 0; x < width; x++)
+				dst[x] ^= pat[x];
+			break;
+
+		case 0x66: /* SRCINVERT */
+			for (size_t x = 0; x < width; x++)
+				dst[x] ^= src[x];
+			break;
+
+		case 0x88: /* SRCAND */
+			for (size_t x = 0; x < width; x++)
+				dst[x] &= src[x];
+			break;
+
+		case 0xEE: /* SRCPAINT */
+			for (size_t x = 0; x < width; x++)
+				dst[x] |= src[x];
+			break;
+
+		case 0xC0: /* MERGECOPY */
+			for (size_t x = 0; x < width; x++)
+				dst[x] = pat[x] & src[x];
+			break;
+
+		case 0xB8: /* PSDPxax: source selects destination or pattern */
+			for (size_t x = 0; x < width; x++)
+				dst[x] = (src[x] & dst[x]) | (~src[x] & pat[x]);
+			break;
+
+		case 0xE2: /* DSPDxax: source selects pattern or destination */
+			for (size_t x = 0; x < width; x++)
+				dst[x] = (src[x] & pat[x]) | (~src[x] & dst[x]);
+			break;
+
+		default:
+			for (size_t x = 0; x < width; x++)
+				dst[x] = rop3_eval(code, src[x], dst[x], pat[x]);
+			break;
+	}
+}
+
+static UINT32 rop3_raw_color(UINT32 format, UINT32 color)
+{
+	BYTE raw[4] = { 0 };
+	UINT32 word = 0;
+
+	FreeRDPWriteColor(raw, format, color);
+	memcpy(&word, raw, sizeof(word));
+	return word;
+}
+
+/* replicate the brush bitmap row for destination line y across the scanline */
+static void rop3_pattern_row(HGDI_DC hdcDest, INT32 nXDest, INT32 y, UINT32* line, size_t width)
+{
+	const HGDI_BRUSH brush = hdcDest->brush;
+	const HGDI_BITMAP hBmpBrush = brush->pattern;
+	const UINT32 bw = (UINT32)hBmpBrush->width;
+	const UINT32 bh = (UINT32)hBmpBrush->height;
+	const UINT32 by = ((UINT32)y + bh - ((UINT32)brush->nYOrg % bh)) % bh;
+	UINT32 bx = ((UINT32)nXDest + bw - ((UINT32)brush->nXOrg % bw)) % bw;
+	const BYTE* row = hBmpBrush->data + 1ull * by * hBmpBrush->scanline;
+
+	for (size_t x = 0; x < width; x++)
+	{
+		memcpy(&line[x], &row[4ull * bx], sizeof(UINT32));
+		if (++bx >= bw)
+			bx = 0;
+	}
+}
+
+static BOOL BitBlt_rop3_supported(HGDI_DC hdcDest, HGDI_DC hdcSrc, BOOL useSrc, BOOL usePat,
+                                  UINT32 style)
+{
+	if (FreeRDPGetBytesPerPixel(hdcDest->format) != 4)
+		return FALSE;
+
+	/* color conversion is done by the generic path, except for glyph masks */
+	if (useSrc && (hdcSrc->format != hdcDest->format) && (hdcSrc->format != PIXEL_FORMAT_MONO))
+		return FALSE;
+
+	if (usePat && (style != GDI_BS_SOLID))
+	{
+		const HGDI_BITMAP hBmpBrush = hdcDest->brush->pattern;
+		if (!hBmpBrush || (hBmpBrush->width <= 0) || (hBmpBrush->height <= 0) ||
+		    (FreeRDPGetBytesPerPixel(hBmpBrush->format) != 4))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* scanline based BitBlt for 32bpp targets, coordinates are already adjusted */
+static BOOL BitBlt_rop3(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32 nHeight,
+                        HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, BYTE code, BOOL useSrc,
+                        BOOL usePat, UINT32 style, const gdiPalette* palette)
+{
+	const size_t width = (size_t)nWidth;
+	const BOOL monoSrc = useSrc && (hdcSrc->format == PIXEL_FORMAT_MONO);
+	UINT32 solid = 0;
+	UINT32 monoOff = 0;
+	UINT32 monoOn = 0;
+
+	if ((nWidth <= 0) || (nHeight <= 0))
+		return TRUE;
+
+	/* the lines are scratch space, zeroed so unused operands are defined */
+	UINT32* srcLine = calloc(3ull * width, sizeof(UINT32));
+	if (!srcLine)
+		return FALSE;
+	UINT32* patLine = &srcLine[width];
+	UINT32* dstLine = &srcLine[2ull * width];
+
+	/* BLACKNESS and WHITENESS keep an opaque alpha, fill them as a pattern */
+	if ((code == 0x00) || (code == 0xFF))
+	{
+		const BYTE v = (code == 0x00) ? 0x00 : 0xFF;
+		solid = rop3_raw_color(hdcDest->format, FreeRDPGetColor(hdcDest->format, v, v, v, 0xFF));
+		code = 0xF0;
+		usePat = TRUE;
+		style = GDI_BS_SOLID;
+	}
+	else if (usePat && (style == GDI_BS_SOLID))
+		solid = rop3_raw_color(hdcDest->format, hdcDest->brush->color);
+
+	if (usePat && (style == GDI_BS_SOLID))
+	{
+		for (size_t x = 0; x < width; x++)
+			patLine[x] = solid;
+	}
+
+	/* glyph masks hold one byte per pixel, expand them to the two colors they convert to */
+	if (monoSrc)
+	{
+		monoOff = rop3_raw_color(hdcDest->format, FreeRDPConvertColor(0x00, PIXEL_FORMAT_MONO,
+		                                                              hdcDest->format, palette));
+		monoOn = rop3_raw_color(hdcDest->format, FreeRDPConvertColor(0xFF, PIXEL_FORMAT_MONO,
+		                                                             hdcDest->format, palette));
+	}
+
+	for (INT32 i = 0; i < nHeight; i++)
+	{
+		/* bottom up if source and destination may overlap downwards */
+		const INT32 y = (nYDest > nYSrc) ? nHeight - 1 - i : i;
+		BYTE* dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
+		if (!dstp)
+			goto fail;
+
+		if (useSrc)
+		{
+			const BYTE* srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
+			if (!srcp)
+				goto fail;
+
+			if (monoSrc)
+			{
+				for (size_t x = 0; x < width; x++)
+					srcLine[x] = srcp[x] ? monoOn : monoOff;
+			}
+			else
+				memcpy(srcLine, srcp, width * sizeof(UINT32));
+		}
+
+		if (usePat && (style != GDI_BS_SOLID))
+			rop3_pattern_row(hdcDest, nXDest, nYDest + y, patLine, width);
+
+		if (((uintptr_t)dstp % sizeof(UINT32)) == 0)
+			rop3_row(code, (UINT32*)dstp, srcLine, patLine, width);
+		else
+		{
+			memcpy(dstLine, dstp, width * sizeof(UINT32));
+			rop3_row(code, dstLine, srcLine, patLine, width);
+			memcpy(dstp, dstLine, width * sizeof(UINT32));
+		}
+	}
+
+	free(srcLine);
+	return TRUE;
+fail:
+	free(srcLine);
+	return FALSE;
+}
+
 static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32 nHeight,
-                           HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, const char* rop,
+                           HGDI_DC hdcSrc, INT32 nXSrc, INT32 nYSrc, DWORD rop3,
                            const gdiPalette* palette)
 {
+	const char* rop = gdi_rop_to_string(rop3);
 	UINT32 style = 0;
 	BOOL useSrc = FALSE;
 	BOOL usePat = FALSE;
@@ -519,6 +743,14 @@ static BOOL BitBlt_process(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nW
 		}
 	}
 
+	/* known codes only, the glyph pseudo code is DSPDxax */
+	if ((*rop != '\0') && BitBlt_rop3_supported(hdcDest, hdcSrc, useSrc, usePat, style))
+	{
+		const BYTE code = (rop3 == GDI_GLYPH_ORDER) ? 0xE2 : (BYTE)((rop3 >> 16) & 0xFF);
+		return BitBlt_rop3(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, code,
+		                   useSrc, usePat, style, palette);
+	}
+
 	if ((nXDest > nXSrc) && (nYDest > nYSrc))
 	{
 		for (INT32 y = nHeight - 1; y >= 0; y--)
@@ -652,8 +884,8 @@ BOOL gdi_BitBlt(HGDI_DC hdcDest, INT32 nXDest, INT32 nYDest, INT32 nWidth, INT32
 			break;
 
 		default:
-			if (!BitBlt_process(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc,
-			                    gdi_rop_to_string(rop), palette))
+			if (!BitBlt_process(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, rop,
+			                    palette))
 				return FALSE;
 
 			break;
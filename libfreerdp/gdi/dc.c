@@ -247,6 +247,9 @@ BOOL gdi_DeleteDC(HGDI_DC hdc)
 		{
 			free(hdc->hwnd->cinvalid);
 			free(hdc->hwnd->invalid);
+			if (hdc->hwnd->region)
+				region16_uninit(hdc->hwnd->region);
+			free(hdc->hwnd->region);
 			free(hdc->hwnd);
 		}
 
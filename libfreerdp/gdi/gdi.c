@@ -21,6 +21,8 @@
 
 #include <freerdp/config.h>
 
+#include "../core/settings.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -330,8 +332,7 @@ BOOL gdi_decode_color(rdpGdi* gdi, const UINT32 srcColor, UINT32* color, UINT32*
 	if (!gdi || !color || !gdi->context || !gdi->context->settings)
 		return FALSE;
 
-	const UINT32 ColorDepth =
-	    freerdp_settings_get_uint32(gdi->context->settings, FreeRDP_ColorDepth);
+	const UINT32 ColorDepth = gdi->context->settings->ColorDepth;
 
 	switch (ColorDepth)
 	{
@@ -632,7 +633,7 @@ static BOOL gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 				UINT32 bpp = brush->bpp;
 
 				if ((bpp == 16) &&
-				    (freerdp_settings_get_uint32(context->settings, FreeRDP_ColorDepth) == 15))
+				    (context->settings->ColorDepth == 15))
 					bpp = 15;
 
 				brushFormat = gdi_get_pixel_format(bpp);
@@ -892,8 +893,7 @@ static BOOL gdi_mem3blt(rdpContext* context, MEM3BLT_ORDER* mem3blt)
 			{
 				UINT32 bpp = brush->bpp;
 
-				const UINT32 ColorDepth =
-				    freerdp_settings_get_uint32(gdi->context->settings, FreeRDP_ColorDepth);
+				const UINT32 ColorDepth = gdi->context->settings->ColorDepth;
 				if ((bpp == 16) && (ColorDepth == 15))
 					bpp = 15;
 
@@ -1303,6 +1303,7 @@ BOOL gdi_resize_ex(rdpGdi* gdi, UINT32 width, UINT32 height, UINT32 stride, UINT
 	if (gdi->drawing == gdi->primary)
 		gdi->drawing = NULL;
 
+	gdi_gfx_release_primary(gdi);
 	gdi->width = (INT32)width;
 	gdi->height = (INT32)height;
 	gdi_bitmap_free_ex(gdi->primary);
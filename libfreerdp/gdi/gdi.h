@@ -30,6 +30,9 @@ FREERDP_LOCAL BOOL gdi_bitmap_update(rdpContext* context, const BITMAP_UPDATE* b
 FREERDP_LOCAL gdiBitmap* gdi_bitmap_new_ex(rdpGdi* gdi, int width, int height, int bpp, BYTE* data);
 FREERDP_LOCAL void gdi_bitmap_free_ex(gdiBitmap* gdi_bmp);
 
+/* Gives the primary buffer back if a gfx surface decodes into it, before it is freed */
+FREERDP_LOCAL void gdi_gfx_release_primary(rdpGdi* gdi);
+
 static INLINE BYTE* gdi_get_bitmap_pointer(HGDI_DC hdcBmp, INT32 x, INT32 y)
 {
 	BYTE* p = NULL;
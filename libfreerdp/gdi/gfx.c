@@ -21,15 +21,22 @@
 
 #include <freerdp/config.h>
 
+#include "../core/settings.h"
+#include "../core/probes.h"
+
 #include "../core/update.h"
 
 #include <freerdp/api.h>
 #include <freerdp/log.h>
 #include <freerdp/gdi/gfx.h>
 #include <freerdp/gdi/region.h>
+#include <freerdp/primitives.h>
 #include <freerdp/utils/gfx.h>
+#include <winpr/sysinfo.h>
 #include <math.h>
 
+#include "gdi.h"
+
 #define TAG FREERDP_TAG("gdi")
 
 static BOOL is_rect_valid(const RECTANGLE_16* rect, size_t width, size_t height)
@@ -76,6 +83,112 @@ static DWORD gfx_align_scanline(DWORD widthInBytes, DWORD alignment)
 	return scanline;
 }
 
+static void gdi_GfxCacheEntryUnref(gdiGfxCacheEntry* entry)
+{
+	gdiGfxSurface* surface = entry->source;
+
+	if (!surface)
+		return;
+
+	if (entry->prevRef)
+		entry->prevRef->nextRef = entry->nextRef;
+	else
+		surface->cacheRefs = entry->nextRef;
+
+	if (entry->nextRef)
+		entry->nextRef->prevRef = entry->prevRef;
+
+	entry->source = NULL;
+	entry->prevRef = NULL;
+	entry->nextRef = NULL;
+}
+
+static void gdi_GfxCacheEntryFree(gdiGfxCacheEntry* entry)
+{
+	if (!entry)
+		return;
+	gdi_GfxCacheEntryUnref(entry);
+	free(entry->data);
+	free(entry);
+}
+
+static gdiGfxCacheEntry* gdi_GfxCacheEntryAlloc(UINT64 cacheKey, UINT32 width, UINT32 height,
+                                                UINT32 format)
+{
+	gdiGfxCacheEntry* cacheEntry = (gdiGfxCacheEntry*)calloc(1, sizeof(gdiGfxCacheEntry));
+	if (!cacheEntry)
+		return NULL;
+
+	cacheEntry->cacheKey = cacheKey;
+	cacheEntry->width = width;
+	cacheEntry->height = height;
+	cacheEntry->format = format;
+	cacheEntry->scanline = gfx_align_scanline(cacheEntry->width * 4, 16);
+	return cacheEntry;
+}
+
+static gdiGfxCacheEntry* gdi_GfxCacheEntryNew(UINT64 cacheKey, UINT32 width, UINT32 height,
+                                              UINT32 format)
+{
+	gdiGfxCacheEntry* cacheEntry = gdi_GfxCacheEntryAlloc(cacheKey, width, height, format);
+	if (!cacheEntry)
+		goto fail;
+
+	if ((cacheEntry->width > 0) && (cacheEntry->height > 0))
+	{
+		cacheEntry->data = (BYTE*)calloc(cacheEntry->height, cacheEntry->scanline);
+
+		if (!cacheEntry->data)
+			goto fail;
+	}
+	return cacheEntry;
+fail:
+	gdi_GfxCacheEntryFree(cacheEntry);
+	return NULL;
+}
+
+/* Copy the referenced surface area to the entry, it no longer depends on the surface then */
+static BOOL gdi_GfxCacheEntryMaterialize(gdiGfxCacheEntry* entry)
+{
+	gdiGfxSurface* surface = entry->source;
+
+	if (!surface)
+		return TRUE;
+
+	gdi_GfxCacheEntryUnref(entry);
+	entry->data = (BYTE*)calloc(entry->height, entry->scanline);
+
+	if (!entry->data)
+		return FALSE;
+
+	return freerdp_image_copy_no_overlap(entry->data, entry->format, entry->scanline, 0, 0,
+	                                     entry->width, entry->height, surface->data,
+	                                     surface->format, surface->scanline, entry->sourceRect.left,
+	                                     entry->sourceRect.top, NULL, FREERDP_FLIP_NONE);
+}
+
+/* Must be called before rect of the surface is modified, all of it for a NULL rect */
+static BOOL gdi_GfxCacheEntriesMaterialize(gdiGfxSurface* surface, const RECTANGLE_16* rect)
+{
+	BOOL rc = TRUE;
+	gdiGfxCacheEntry* entry = surface->cacheRefs;
+
+	while (entry)
+	{
+		gdiGfxCacheEntry* next = entry->nextRef;
+
+		if (!rect || rectangles_intersects(&entry->sourceRect, rect))
+		{
+			if (!gdi_GfxCacheEntryMaterialize(entry))
+				rc = FALSE;
+		}
+
+		entry = next;
+	}
+
+	return rc;
+}
+
 /**
  * Function description
  *
@@ -131,6 +244,12 @@ static UINT gdi_ResetGraphics(RdpgfxClientContext* context,
 		if (!surface)
 			continue;
 
+		if (!gdi_GfxCacheEntriesMaterialize(surface, NULL))
+		{
+			free(pSurfaceIds);
+			goto fail;
+		}
+
 		memset(surface->data, 0xFF, (size_t)surface->scanline * surface->height);
 		region16_clear(&surface->invalidRegion);
 	}
@@ -160,6 +279,114 @@ fail:
 	return rc;
 }
 
+/* The surface decodes directly into the primary buffer if it is the only one presented and
+ * the buffers are laid out identically, the output update then only invalidates the rects */
+static BOOL gdi_surface_fits_primary(rdpGdi* gdi, const gdiGfxSurface* surface)
+{
+	if (!surface->outputMapped || (surface->outputOriginX != 0) || (surface->outputOriginY != 0))
+		return FALSE;
+
+	if ((surface->outputTargetWidth != surface->mappedWidth) ||
+	    (surface->outputTargetHeight != surface->mappedHeight))
+		return FALSE;
+
+	/* The codecs write up to the aligned surface size */
+	if ((surface->scanline != gdi->stride) || (surface->height > (UINT32)MAX(0, gdi->height)))
+		return FALSE;
+
+	if (surface->format == gdi->dstFormat)
+		return TRUE;
+	return FreeRDPAreColorFormatsEqualNoAlpha(surface->format, gdi->dstFormat) &&
+	       !FreeRDPColorHasAlpha(gdi->dstFormat);
+}
+
+static void gdi_surface_attach_primary(rdpGdi* gdi, gdiGfxSurface* surface)
+{
+	const RECTANGLE_16 rect = { 0, 0, (UINT16)MIN(UINT16_MAX, surface->mappedWidth),
+		                        (UINT16)MIN(UINT16_MAX, surface->mappedHeight) };
+
+	memcpy(gdi->primary_buffer, surface->data, 1ull * surface->scanline * surface->height);
+	surface->ownData = surface->data;
+	surface->data = gdi->primary_buffer;
+
+	/* The primary buffer content is presented on the next output update */
+	region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rect);
+}
+
+static void gdi_surface_detach_primary(gdiGfxSurface* surface)
+{
+	if (!surface->ownData)
+		return;
+
+	memcpy(surface->ownData, surface->data, 1ull * surface->scanline * surface->height);
+	surface->data = surface->ownData;
+	surface->ownData = NULL;
+}
+
+static void gdi_update_primary_surface(rdpGdi* gdi, RdpgfxClientContext* context,
+                                       const UINT16* pSurfaceIds, UINT16 count)
+{
+	gdiGfxSurface* candidate = NULL;
+	size_t mapped = 0;
+
+	const BOOL enabled =
+	    !gdi->suppressOutput && (gdi->primary_buffer != NULL) &&
+	    freerdp_settings_get_bool(gdi->context->settings, FreeRDP_GfxZeroCopyOutput);
+
+	for (UINT32 index = 0; index < count; index++)
+	{
+		gdiGfxSurface* surface =
+		    (gdiGfxSurface*)context->GetSurfaceData(context, pSurfaceIds[index]);
+
+		if (!surface || !surface->outputMapped)
+			continue;
+		mapped++;
+		candidate = surface;
+	}
+
+	if (!enabled || (mapped != 1) || !gdi_surface_fits_primary(gdi, candidate))
+		candidate = NULL;
+
+	for (UINT32 index = 0; index < count; index++)
+	{
+		gdiGfxSurface* surface =
+		    (gdiGfxSurface*)context->GetSurfaceData(context, pSurfaceIds[index]);
+
+		if (surface && surface->ownData && (surface != candidate))
+			gdi_surface_detach_primary(surface);
+	}
+
+	if (candidate && !candidate->ownData)
+		gdi_surface_attach_primary(gdi, candidate);
+}
+
+void gdi_gfx_release_primary(rdpGdi* gdi)
+{
+	UINT16 count = 0;
+	UINT16* pSurfaceIds = NULL;
+
+	WINPR_ASSERT(gdi);
+
+	RdpgfxClientContext* context = gdi->gfx;
+	if (!context || !context->GetSurfaceIds || !context->GetSurfaceData)
+		return;
+
+	EnterCriticalSection(&context->mux);
+	context->GetSurfaceIds(context, &pSurfaceIds, &count);
+
+	for (UINT32 index = 0; index < count; index++)
+	{
+		gdiGfxSurface* surface =
+		    (gdiGfxSurface*)context->GetSurfaceData(context, pSurfaceIds[index]);
+
+		if (surface)
+			gdi_surface_detach_primary(surface);
+	}
+
+	free(pSurfaceIds);
+	LeaveCriticalSection(&context->mux);
+}
+
 static UINT gdi_OutputUpdate(rdpGdi* gdi, gdiGfxSurface* surface)
 {
 	UINT rc = ERROR_INTERNAL_ERROR;
@@ -207,7 +434,9 @@ static UINT gdi_OutputUpdate(rdpGdi* gdi, gdiGfxSurface* surface)
 		const UINT32 dwidth = MIN((UINT32)(swidth * sx), (UINT32)gdi->width - nXDst);
 		const UINT32 dheight = MIN((UINT32)(sheight * sy), (UINT32)gdi->height - nYDst);
 
-		if (!freerdp_image_scale(gdi->primary_buffer, gdi->dstFormat, gdi->stride, nXDst, nYDst,
+		/* A surface decoding into the primary buffer only needs the invalidation */
+		if (!surface->ownData &&
+		    !freerdp_image_scale(gdi->primary_buffer, gdi->dstFormat, gdi->stride, nXDst, nYDst,
 		                         dwidth, dheight, surface->data, surface->format, surface->scanline,
 		                         nXSrc, nYSrc, swidth, sheight))
 		{
@@ -254,6 +483,9 @@ static UINT gdi_UpdateSurfaces(RdpgfxClientContext* context)
 	context->GetSurfaceIds(context, &pSurfaceIds, &count);
 	status = CHANNEL_RC_OK;
 
+	WINPR_ASSERT(context->GetSurfaceData);
+	gdi_update_primary_surface(gdi, context, pSurfaceIds, count);
+
 	for (UINT32 index = 0; index < count; index++)
 	{
 		WINPR_ASSERT(context->GetSurfaceData);
@@ -300,6 +532,7 @@ static UINT gdi_StartFrame(RdpgfxClientContext* context, const RDPGFX_START_FRAM
 	WINPR_ASSERT(gdi);
 	gdi->inGfxFrame = TRUE;
 	gdi->frameId = startFrame->frameId;
+	FREERDP_PROBE1(gfx_start_frame, startFrame->frameId);
 	return CHANNEL_RC_OK;
 }
 
@@ -323,6 +556,7 @@ static UINT gdi_EndFrame(RdpgfxClientContext* context, const RDPGFX_END_FRAME_PD
 	WINPR_ASSERT(gdi);
 	const UINT status = gdi_call_update_surfaces(context);
 	gdi->inGfxFrame = FALSE;
+	FREERDP_PROBE2(gfx_end_frame, endFrame->frameId, status);
 	return status;
 }
 
@@ -441,8 +675,7 @@ static UINT gdi_SurfaceCommand_RemoteFX(rdpGdi* gdi, RdpgfxClientContext* contex
 	if (status != CHANNEL_RC_OK)
 		goto fail;
 
-	for (UINT32 x = 0; x < nrRects; x++)
-		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, &rects[x]);
+	region16_union_rects(&surface->invalidRegion, &surface->invalidRegion, rects, nrRects);
 
 	status = gdi_interFrameUpdate(gdi, context);
 
@@ -558,6 +791,30 @@ fail:
 	return status;
 }
 
+#ifdef WITH_GFX_H264
+/* With parallel decoding the channel keeps the surface alive and its commands in order, so the
+ * H.264 decoders of different surfaces may run concurrently. A surface decoding into the primary
+ * buffer keeps the lock, gdi_resize might release that buffer. */
+static BOOL gdi_decode_unlocked(rdpGdi* gdi, RdpgfxClientContext* context,
+                                const gdiGfxSurface* surface)
+{
+	WINPR_ASSERT(gdi);
+	WINPR_ASSERT(surface);
+
+	if (!gdi->context->settings->GfxParallelDecode || surface->ownData)
+		return FALSE;
+
+	LeaveCriticalSection(&context->mux);
+	return TRUE;
+}
+
+static void gdi_decode_relock(RdpgfxClientContext* context, BOOL unlocked)
+{
+	if (unlocked)
+		EnterCriticalSection(&context->mux);
+}
+#endif
+
 /**
  * Function description
  *
@@ -598,6 +855,20 @@ static UINT gdi_SurfaceCommand_AVC420(rdpGdi* gdi, RdpgfxClientContext* context,
 
 		if (!h264_context_reset(surface->h264, surface->width, surface->height))
 			return ERROR_INTERNAL_ERROR;
+
+		/* Only a frontend presenting the YUV frames can use a frame left on the GPU */
+		if (context->UpdateSurfaceYUV &&
+		    freerdp_settings_get_bool(gdi->context->settings, FreeRDP_GfxH264DmaBuf))
+			(void)h264_context_set_option(surface->h264, H264_CONTEXT_OPTION_HW_FRAME_EXPORT,
+			                              TRUE);
+
+		/* or let the decoder present the frames on a window of the frontend */
+		if (context->UpdateSurfaceYUV && context->GetOutputWindow)
+		{
+			void* window = context->GetOutputWindow(context, surface->surfaceId);
+			if (window)
+				(void)h264_context_set_output_window(surface->h264, window);
+		}
 	}
 
 	if (!surface->h264)
@@ -609,14 +880,58 @@ static UINT gdi_SurfaceCommand_AVC420(rdpGdi* gdi, RdpgfxClientContext* context,
 		return ERROR_INTERNAL_ERROR;
 
 	meta = &(bs->meta);
-	rc = avc420_decompress(surface->h264, bs->data, bs->length, surface->data, surface->format,
-	                       surface->scanline, surface->width, surface->height, meta->regionRects,
-	                       meta->numRegionRects);
 
-	if (rc < 0)
+	if (context->UpdateSurfaceYUV)
 	{
-		WLog_WARN(TAG, "avc420_decompress failure: %" PRId32 ", ignoring update.", rc);
-		return CHANNEL_RC_OK;
+		RDPGFX_YUV_FRAME frame = { .surfaceId = surface->surfaceId,
+			                       .width = surface->width,
+			                       .height = surface->height,
+			                       .numRegionRects = meta->numRegionRects,
+			                       .regionRects = meta->regionRects };
+
+		const BOOL unlocked = gdi_decode_unlocked(gdi, context, surface);
+		rc = avc420_decompress_yuv(surface->h264, bs->data, bs->length, frame.pYUVData,
+		                           frame.iStride);
+		gdi_decode_relock(context, unlocked);
+
+		if (rc < 0)
+		{
+			WLog_WARN(TAG, "avc420_decompress_yuv failure: %" PRId32 ", ignoring update.", rc);
+			return CHANNEL_RC_OK;
+		}
+
+		if (rc == 0)
+			return CHANNEL_RC_OK;
+
+		H264_DMABUF_FRAME dmabuf = { 0 };
+		if (h264_get_dmabuf_frame(surface->h264, &dmabuf))
+			frame.dmabuf = &dmabuf;
+		frame.rendered = h264_get_frame_rendered(surface->h264);
+
+		/* The frontend presented the frame, no conversion and no output update required */
+		if (context->UpdateSurfaceYUV(context, &frame) == CHANNEL_RC_OK)
+			return gdi_interFrameUpdate(gdi, context);
+
+		if (!avc420_convert_yuv(surface->h264, surface->data, surface->format, surface->scanline,
+		                        meta->regionRects, meta->numRegionRects))
+		{
+			WLog_WARN(TAG, "avc420_convert_yuv failure, ignoring update.");
+			return CHANNEL_RC_OK;
+		}
+	}
+	else
+	{
+		const BOOL unlocked = gdi_decode_unlocked(gdi, context, surface);
+		rc = avc420_decompress(surface->h264, bs->data, bs->length, surface->data,
+		                       surface->format, surface->scanline, surface->width,
+		                       surface->height, meta->regionRects, meta->numRegionRects);
+		gdi_decode_relock(context, unlocked);
+
+		if (rc < 0)
+		{
+			WLog_WARN(TAG, "avc420_decompress failure: %" PRId32 ", ignoring update.", rc);
+			return CHANNEL_RC_OK;
+		}
 	}
 
 	for (UINT32 i = 0; i < meta->numRegionRects; i++)
@@ -697,10 +1012,12 @@ static UINT gdi_SurfaceCommand_AVC444(rdpGdi* gdi, RdpgfxClientContext* context,
 	avc2 = &bs->bitstream[1];
 	meta1 = &avc1->meta;
 	meta2 = &avc2->meta;
+	const BOOL unlocked = gdi_decode_unlocked(gdi, context, surface);
 	rc = avc444_decompress(surface->h264, bs->LC, meta1->regionRects, meta1->numRegionRects,
 	                       avc1->data, avc1->length, meta2->regionRects, meta2->numRegionRects,
 	                       avc2->data, avc2->length, surface->data, surface->format,
 	                       surface->scanline, surface->width, surface->height, cmd->codecId);
+	gdi_decode_relock(context, unlocked);
 
 	if (rc < 0)
 	{
@@ -741,36 +1058,37 @@ fail:
 #endif
 }
 
-static BOOL gdi_apply_alpha(BYTE* data, UINT32 format, UINT32 stride, RECTANGLE_16* rect,
-                            UINT32 startOffsetX, UINT32 count, BYTE a)
+/* Apply a width * height alpha plane to the command rectangle of the surface */
+static BOOL gdi_apply_alpha(gdiGfxSurface* surface, const RDPGFX_SURFACE_COMMAND* cmd,
+                            const BYTE* plane)
 {
-	UINT32 written = 0;
-	BOOL first = TRUE;
-	const UINT32 bpp = FreeRDPGetBytesPerPixel(format);
-	WINPR_ASSERT(rect);
+	const primitives_t* prims = primitives_get();
+	const prim_size_t roi = { cmd->width, cmd->height };
+	const UINT32 bpp = FreeRDPGetBytesPerPixel(surface->format);
+	BYTE* data = &surface->data[1ULL * cmd->top * surface->scanline + 1ULL * cmd->left * bpp];
+
+	WINPR_ASSERT(prims);
 
-	for (size_t y = rect->top; y < rect->bottom; y++)
+	if (prims->applyAlpha_8u_P1AC4R(plane, cmd->width, data, surface->scanline, surface->format,
+	                                &roi) == PRIMITIVES_SUCCESS)
+		return TRUE;
+
+	/* formats without a plain alpha byte */
+	for (size_t y = 0; y < cmd->height; y++)
 	{
-		BYTE* line = &data[y * stride];
+		BYTE* line = &data[y * surface->scanline];
 
-		for (size_t x = first ? rect->left + startOffsetX : rect->left; x < rect->right; x++)
+		for (size_t x = 0; x < cmd->width; x++)
 		{
 			BYTE r = 0;
 			BYTE g = 0;
 			BYTE b = 0;
-
-			if (written == count)
-				return TRUE;
-
 			BYTE* src = &line[x * bpp];
-			UINT32 color = FreeRDPReadColor(src, format);
-			FreeRDPSplitColor(color, format, &r, &g, &b, NULL, NULL);
-			color = FreeRDPGetColor(format, r, g, b, a);
-			FreeRDPWriteColor(src, format, color);
-			written++;
+			UINT32 color = FreeRDPReadColor(src, surface->format);
+			FreeRDPSplitColor(color, surface->format, &r, &g, &b, NULL, NULL);
+			color = FreeRDPGetColor(surface->format, r, g, b, plane[y * cmd->width + x]);
+			FreeRDPWriteColor(src, surface->format, color);
 		}
-
-		first = FALSE;
 	}
 
 	return TRUE;
@@ -780,6 +1098,45 @@ static BOOL gdi_apply_alpha(BYTE* data, UINT32 format, UINT32 stride, RECTANGLE_
  *
  * @return 0 on success, otherwise a Win32 error code
  */
+static BOOL gdi_decode_alpha_rle(wStream* s, BYTE* plane, size_t total)
+{
+	size_t pos = 0;
+
+	while (pos < total)
+	{
+		UINT32 count = 0;
+		BYTE a = 0;
+
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
+			return FALSE;
+
+		Stream_Read_UINT8(s, a);
+		Stream_Read_UINT8(s, count);
+
+		if (count >= 0xFF)
+		{
+			if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
+				return FALSE;
+
+			Stream_Read_UINT16(s, count);
+
+			if (count >= 0xFFFF)
+			{
+				if (!Stream_CheckAndLogRequiredLength(TAG, s, 4))
+					return FALSE;
+
+				Stream_Read_UINT32(s, count);
+			}
+		}
+
+		const size_t run = MIN(count, total - pos);
+		memset(&plane[pos], a, run);
+		pos += run;
+	}
+
+	return TRUE;
+}
+
 static UINT gdi_SurfaceCommand_Alpha(rdpGdi* gdi, RdpgfxClientContext* context,
                                      const RDPGFX_SURFACE_COMMAND* cmd)
 {
@@ -823,74 +1180,26 @@ static UINT gdi_SurfaceCommand_Alpha(rdpGdi* gdi, RdpgfxClientContext* context,
 		if (!Stream_CheckAndLogRequiredLengthOfSize(TAG, s, cmd->height, cmd->width))
 			return ERROR_INVALID_DATA;
 
-		for (size_t y = cmd->top; y < cmd->top + cmd->height; y++)
-		{
-			BYTE* line = &surface->data[y * surface->scanline];
-
-			for (size_t x = cmd->left; x < cmd->left + cmd->width; x++)
-			{
-				UINT32 color = 0;
-				BYTE r = 0;
-				BYTE g = 0;
-				BYTE b = 0;
-				BYTE a = 0;
-				BYTE* src = &line[x * FreeRDPGetBytesPerPixel(surface->format)];
-				Stream_Read_UINT8(s, a);
-				color = FreeRDPReadColor(src, surface->format);
-				FreeRDPSplitColor(color, surface->format, &r, &g, &b, NULL, NULL);
-				color = FreeRDPGetColor(surface->format, r, g, b, a);
-				FreeRDPWriteColor(src, surface->format, color);
-			}
-		}
+		if (!gdi_apply_alpha(surface, cmd, Stream_ConstPointer(s)))
+			return ERROR_INTERNAL_ERROR;
 	}
 	else
 	{
-		UINT32 startOffsetX = 0;
-		RECTANGLE_16 rect = { 0 };
-		rect.left = (UINT16)MIN(UINT16_MAX, cmd->left);
-		rect.top = (UINT16)MIN(UINT16_MAX, cmd->top);
-		rect.right = (UINT16)MIN(UINT16_MAX, cmd->left + cmd->width);
-		rect.bottom = (UINT16)MIN(UINT16_MAX, cmd->top + cmd->height);
-
-		while (rect.top < rect.bottom)
-		{
-			UINT32 count = 0;
-			BYTE a = 0;
-
-			if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
-				return ERROR_INVALID_DATA;
-
-			Stream_Read_UINT8(s, a);
-			Stream_Read_UINT8(s, count);
-
-			if (count >= 0xFF)
-			{
-				if (!Stream_CheckAndLogRequiredLength(TAG, s, 2))
-					return ERROR_INVALID_DATA;
-
-				Stream_Read_UINT16(s, count);
-
-				if (count >= 0xFFFF)
-				{
-					if (!Stream_CheckAndLogRequiredLength(TAG, s, 4))
-						return ERROR_INVALID_DATA;
-
-					Stream_Read_UINT32(s, count);
-				}
-			}
+		/* expand the runs to a plane first, that is applied in one go */
+		const size_t total = 1ull * cmd->width * cmd->height;
+		BYTE* plane = malloc(total);
 
-			if (!gdi_apply_alpha(surface->data, surface->format, surface->scanline, &rect,
-			                     startOffsetX, count, a))
-				return ERROR_INTERNAL_ERROR;
+		if (!plane && (total > 0))
+			return CHANNEL_RC_NO_MEMORY;
 
-			startOffsetX += count;
+		if (!gdi_decode_alpha_rle(s, plane, total))
+			status = ERROR_INVALID_DATA;
+		else if (!gdi_apply_alpha(surface, cmd, plane))
+			status = ERROR_INTERNAL_ERROR;
 
-			while (startOffsetX >= cmd->width)
-			{
-				startOffsetX -= cmd->width;
-				rect.top++;
-			}
-		}
+		free(plane);
+		if (status != CHANNEL_RC_OK)
+			return status;
 	}
 
 	invalidRect.left = (UINT16)MIN(UINT16_MAX, cmd->left);
@@ -1019,6 +1328,28 @@ fail:
 	return status;
 }
 
+/* Copy the cache entries referencing the area the command is about to overwrite */
+static BOOL gdi_SurfaceCommand_ReleaseCache(RdpgfxClientContext* context,
+                                            const RDPGFX_SURFACE_COMMAND* cmd)
+{
+	WINPR_ASSERT(context->GetSurfaceData);
+	gdiGfxSurface* surface =
+	    (gdiGfxSurface*)context->GetSurfaceData(context, (UINT16)MIN(UINT16_MAX, cmd->surfaceId));
+
+	if (!surface || !surface->cacheRefs)
+		return TRUE;
+
+	/* Wire-To-Surface-2 PDUs have no rect, the update region is only known after decoding */
+	if (cmd->codecId == RDPGFX_CODECID_CAPROGRESSIVE)
+		return gdi_GfxCacheEntriesMaterialize(surface, NULL);
+
+	const RECTANGLE_16 rect = { (UINT16)MIN(UINT16_MAX, cmd->left),
+		                        (UINT16)MIN(UINT16_MAX, cmd->top),
+		                        (UINT16)MIN(UINT16_MAX, cmd->right),
+		                        (UINT16)MIN(UINT16_MAX, cmd->bottom) };
+	return gdi_GfxCacheEntriesMaterialize(surface, &rect);
+}
+
 /**
  * Function description
  *
@@ -1048,6 +1379,15 @@ static UINT gdi_SurfaceCommand(RdpgfxClientContext* context, const RDPGFX_SURFAC
 	dump_cmd(cmd, gdi->frameId);
 #endif
 
+	if (!gdi_SurfaceCommand_ReleaseCache(context, cmd))
+	{
+		LeaveCriticalSection(&context->mux);
+		return CHANNEL_RC_NO_MEMORY;
+	}
+
+	FREERDP_PROBE4(gfx_decode_entry, cmd->codecId, cmd->surfaceId, cmd->length, gdi->frameId);
+	const UINT64 start = winpr_GetTickCount64NS();
+
 	switch (cmd->codecId)
 	{
 		case RDPGFX_CODECID_UNCOMPRESSED:
@@ -1094,6 +1434,9 @@ static UINT gdi_SurfaceCommand(RdpgfxClientContext* context, const RDPGFX_SURFAC
 			break;
 	}
 
+	metrics_codec_decode(gdi->context->metrics, cmd->codecId, winpr_GetTickCount64NS() - start);
+	FREERDP_PROBE3(gfx_decode_exit, cmd->codecId, cmd->surfaceId, status);
+
 	LeaveCriticalSection(&context->mux);
 	return status;
 }
@@ -1172,7 +1515,7 @@ static UINT gdi_CreateSurface(RdpgfxClientContext* context,
 	}
 
 	surface->scanline = gfx_align_scanline(surface->width * 4UL, 16);
-	surface->data = (BYTE*)winpr_aligned_malloc(1ull * surface->scanline * surface->height, 16);
+	surface->data = (BYTE*)winpr_large_malloc(1ull * surface->scanline * surface->height, 16);
 
 	if (!surface->data)
 	{
@@ -1213,12 +1556,18 @@ static UINT gdi_DeleteSurface(RdpgfxClientContext* context,
 			rc = IFCALLRESULT(CHANNEL_RC_OK, context->UnmapWindowForSurface, context,
 			                  surface->windowId);
 
+		/* entries failing the copy stay empty, using them fails later on */
+		(void)gdi_GfxCacheEntriesMaterialize(surface, NULL);
+
 #ifdef WITH_GFX_H264
 		h264_context_free(surface->h264);
 #endif
 		region16_uninit(&surface->invalidRegion);
 		codecs = surface->codecs;
-		winpr_aligned_free(surface->data);
+		if (surface->ownData)
+			winpr_large_free(surface->ownData);
+		else
+			winpr_large_free(surface->data);
 		free(surface);
 	}
 
@@ -1299,6 +1648,9 @@ static UINT gdi_SolidFill(RdpgfxClientContext* context, const RDPGFX_SOLID_FILL_
 		if (!intersect_rect(rect, surface, &invalidRect))
 			goto fail;
 
+		if (!gdi_GfxCacheEntriesMaterialize(surface, &invalidRect))
+			goto fail;
+
 		const UINT32 nWidth = invalidRect.right - invalidRect.left;
 		const UINT32 nHeight = invalidRect.bottom - invalidRect.top;
 
@@ -1372,6 +1724,9 @@ static UINT gdi_SurfaceToSurface(RdpgfxClientContext* context,
 		if (!is_rect_valid(&rect, surfaceDst->width, surfaceDst->height))
 			goto fail;
 
+		if (!gdi_GfxCacheEntriesMaterialize(surfaceDst, &rect))
+			goto fail;
+
 		if (surfaceDst == surfaceSrc)
 		{
 			if (!freerdp_image_copy_overlap(
@@ -1406,40 +1761,6 @@ fail:
 	return status;
 }
 
-static void gdi_GfxCacheEntryFree(gdiGfxCacheEntry* entry)
-{
-	if (!entry)
-		return;
-	free(entry->data);
-	free(entry);
-}
-
-static gdiGfxCacheEntry* gdi_GfxCacheEntryNew(UINT64 cacheKey, UINT32 width, UINT32 height,
-                                              UINT32 format)
-{
-	gdiGfxCacheEntry* cacheEntry = (gdiGfxCacheEntry*)calloc(1, sizeof(gdiGfxCacheEntry));
-	if (!cacheEntry)
-		goto fail;
-
-	cacheEntry->cacheKey = cacheKey;
-	cacheEntry->width = width;
-	cacheEntry->height = height;
-	cacheEntry->format = format;
-	cacheEntry->scanline = gfx_align_scanline(cacheEntry->width * 4, 16);
-
-	if ((cacheEntry->width > 0) && (cacheEntry->height > 0))
-	{
-		cacheEntry->data = (BYTE*)calloc(cacheEntry->height, cacheEntry->scanline);
-
-		if (!cacheEntry->data)
-			goto fail;
-	}
-	return cacheEntry;
-fail:
-	gdi_GfxCacheEntryFree(cacheEntry);
-	return NULL;
-}
-
 /**
  * Function description
  *
@@ -1464,19 +1785,15 @@ static UINT gdi_SurfaceToCache(RdpgfxClientContext* context,
 	if (!is_rect_valid(rect, surface->width, surface->height))
 		goto fail;
 
-	cacheEntry = gdi_GfxCacheEntryNew(surfaceToCache->cacheKey, (UINT32)(rect->right - rect->left),
-	                                  (UINT32)(rect->bottom - rect->top), surface->format);
+	/* No copy yet, the entry references the surface area until that is modified */
+	cacheEntry =
+	    gdi_GfxCacheEntryAlloc(surfaceToCache->cacheKey, (UINT32)(rect->right - rect->left),
+	                           (UINT32)(rect->bottom - rect->top), surface->format);
 
 	if (!cacheEntry)
 		goto fail;
 
-	if (!cacheEntry->data)
-		goto fail;
-
-	if (!freerdp_image_copy_no_overlap(cacheEntry->data, cacheEntry->format, cacheEntry->scanline,
-	                                   0, 0, cacheEntry->width, cacheEntry->height, surface->data,
-	                                   surface->format, surface->scanline, rect->left, rect->top,
-	                                   NULL, FREERDP_FLIP_NONE))
+	if ((cacheEntry->width == 0) || (cacheEntry->height == 0))
 		goto fail;
 
 	RDPGFX_EVICT_CACHE_ENTRY_PDU evict = { surfaceToCache->cacheSlot };
@@ -1485,6 +1802,16 @@ static UINT gdi_SurfaceToCache(RdpgfxClientContext* context,
 
 	WINPR_ASSERT(context->SetCacheSlotData);
 	rc = context->SetCacheSlotData(context, surfaceToCache->cacheSlot, (void*)cacheEntry);
+
+	if (rc == CHANNEL_RC_OK)
+	{
+		cacheEntry->source = surface;
+		cacheEntry->sourceRect = *rect;
+		cacheEntry->nextRef = surface->cacheRefs;
+		if (surface->cacheRefs)
+			surface->cacheRefs->prevRef = cacheEntry;
+		surface->cacheRefs = cacheEntry;
+	}
 fail:
 	if (rc != CHANNEL_RC_OK)
 		gdi_GfxCacheEntryFree(cacheEntry);
@@ -1530,10 +1857,27 @@ static UINT gdi_CacheToSurface(RdpgfxClientContext* context,
 		if (!is_rect_valid(&rect, surface->width, surface->height))
 			goto fail;
 
-		if (!freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline,
-		                                   destPt->x, destPt->y, cacheEntry->width,
-		                                   cacheEntry->height, cacheEntry->data, cacheEntry->format,
-		                                   cacheEntry->scanline, 0, 0, NULL, FREERDP_FLIP_NONE))
+		/* An entry still referencing this area is copied here, so a remaining reference
+		 * never overlaps the destination */
+		if (!gdi_GfxCacheEntriesMaterialize(surface, &rect))
+			goto fail;
+
+		if (cacheEntry->source)
+		{
+			const gdiGfxSurface* source = cacheEntry->source;
+
+			if (!freerdp_image_copy_no_overlap(
+			        surface->data, surface->format, surface->scanline, destPt->x, destPt->y,
+			        cacheEntry->width, cacheEntry->height, source->data, source->format,
+			        source->scanline, cacheEntry->sourceRect.left, cacheEntry->sourceRect.top,
+			        NULL, FREERDP_FLIP_NONE))
+				goto fail;
+		}
+		else if (!cacheEntry->data ||
+		         !freerdp_image_copy_no_overlap(
+		             surface->data, surface->format, surface->scanline, destPt->x, destPt->y,
+		             cacheEntry->width, cacheEntry->height, cacheEntry->data, cacheEntry->format,
+		             cacheEntry->scanline, 0, 0, NULL, FREERDP_FLIP_NONE))
 			goto fail;
 
 		invalidRect = rect;
@@ -1653,6 +1997,9 @@ static UINT gdi_ExportCacheEntry(RdpgfxClientContext* context, UINT16 cacheSlot,
 
 	if (cacheEntry)
 	{
+		if (!gdi_GfxCacheEntryMaterialize(cacheEntry))
+			return CHANNEL_RC_NO_MEMORY;
+
 		exportCacheEntry->key64 = cacheEntry->cacheKey;
 		exportCacheEntry->width = (UINT16)MIN(UINT16_MAX, cacheEntry->width);
 		exportCacheEntry->height = (UINT16)MIN(UINT16_MAX, cacheEntry->height);
@@ -83,6 +83,13 @@ static BOOL gdi_Bitmap_New(rdpContext* context, rdpBitmap* bitmap)
 
 	if (!bitmap->data)
 		gdi_bitmap->bitmap = gdi_CreateCompatibleBitmap(gdi->hdc, bitmap->width, bitmap->height);
+	else if (bitmap->format == gdi->dstFormat)
+	{
+		/* already decoded to the surface format, share the buffer instead of holding every
+		 * cached bitmap twice. bitmap->data stays owned by the rdpBitmap. */
+		gdi_bitmap->bitmap = gdi_CreateBitmapEx(bitmap->width, bitmap->height, bitmap->format, 0,
+		                                        bitmap->data, NULL);
+	}
 	else
 	{
 		UINT32 format = bitmap->format;
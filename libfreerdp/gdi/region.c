@@ -35,6 +35,9 @@
 
 #define TAG FREERDP_TAG("gdi.region")
 
+/* beyond this many rectangles the invalid area is tracked as its bounding box */
+#define GDI_MAX_INVALID_RECTS 64
+
 static char* gdi_rect_str(char* buffer, size_t size, const HGDI_RECT rect)
 {
 	if (!buffer || (size < 1) || !rect)
@@ -591,6 +594,13 @@ INLINE BOOL gdi_PtInRect(const HGDI_RECT rc, INT32 x, INT32 y)
 	return FALSE;
 }
 
+static BOOL gdi_CRgnContains(INT32 ox, INT32 oy, INT32 ow, INT32 oh, INT32 x, INT32 y, INT32 w,
+                             INT32 h)
+{
+	return (x >= ox) && (y >= oy) && (1ll * x + w <= 1ll * ox + ow) &&
+	       (1ll * y + h <= 1ll * oy + oh);
+}
+
 /**
  * Invalidate a given region, such that it is redrawn on the next region update.
  * msdn{dd145003}
@@ -602,12 +612,55 @@ INLINE BOOL gdi_PtInRect(const HGDI_RECT rc, INT32 x, INT32 y)
  * @return nonzero on success, 0 otherwise
  */
 
+/* Rebuild the repaint list from the accumulated region, a minimal set of non overlapping
+ * rectangles */
+static BOOL gdi_InvalidRegionToList(HGDI_WND hwnd)
+{
+	UINT32 nrects = 0;
+	const RECTANGLE_16* rects = region16_rects(hwnd->region, &nrects);
+
+	/* too many rectangles to repaint one by one, repaint the bounding box instead */
+	if (nrects > GDI_MAX_INVALID_RECTS)
+	{
+		const RECTANGLE_16 extents = *region16_extents(hwnd->region);
+
+		region16_clear(hwnd->region);
+		if (!region16_union_rect(hwnd->region, hwnd->region, &extents))
+			return FALSE;
+		rects = region16_rects(hwnd->region, &nrects);
+	}
+
+	if (nrects > hwnd->count)
+	{
+		size_t new_cnt = 2ULL * hwnd->count;
+		if (new_cnt < nrects)
+			new_cnt = nrects;
+
+		HGDI_RGN new_rgn = (HGDI_RGN)realloc(hwnd->cinvalid, sizeof(GDI_RGN) * new_cnt);
+
+		if (!new_rgn)
+			return FALSE;
+
+		hwnd->count = (UINT32)new_cnt;
+		hwnd->cinvalid = new_rgn;
+	}
+
+	for (UINT32 i = 0; i < nrects; i++)
+	{
+		const RECTANGLE_16* rect = &rects[i];
+		gdi_SetRgn(&hwnd->cinvalid[i], rect->left, rect->top, rect->right - rect->left,
+		           rect->bottom - rect->top);
+	}
+
+	hwnd->ninvalid = (INT32)nrects;
+	return TRUE;
+}
+
 INLINE BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h)
 {
 	GDI_RECT inv;
 	GDI_RECT rgn;
 	HGDI_RGN invalid = NULL;
-	HGDI_RGN cinvalid = NULL;
 
 	if (!hdc->hwnd)
 		return TRUE;
@@ -618,27 +671,11 @@ INLINE BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h
 	if (w == 0 || h == 0)
 		return TRUE;
 
-	cinvalid = hdc->hwnd->cinvalid;
-
-	if ((hdc->hwnd->ninvalid + 1) > (INT64)hdc->hwnd->count)
-	{
-		HGDI_RGN new_rgn = NULL;
-		size_t new_cnt = 2ULL * hdc->hwnd->count;
-		if (new_cnt > UINT32_MAX)
-			return FALSE;
+	HGDI_WND hwnd = hdc->hwnd;
+	invalid = hwnd->invalid;
 
-		new_rgn = (HGDI_RGN)realloc(cinvalid, sizeof(GDI_RGN) * new_cnt);
-
-		if (!new_rgn)
-			return FALSE;
-
-		hdc->hwnd->count = new_cnt;
-		cinvalid = new_rgn;
-	}
-
-	gdi_SetRgn(&cinvalid[hdc->hwnd->ninvalid++], x, y, w, h);
-	hdc->hwnd->cinvalid = cinvalid;
-	invalid = hdc->hwnd->invalid;
+	/* frontends reset the invalid state once they repainted */
+	const BOOL reset = invalid->null || (hwnd->ninvalid == 0);
 
 	if (invalid->null)
 	{
@@ -647,24 +684,54 @@ INLINE BOOL gdi_InvalidateRegion(HGDI_DC hdc, INT32 x, INT32 y, INT32 w, INT32 h
 		invalid->w = w;
 		invalid->h = h;
 		invalid->null = FALSE;
-		return TRUE;
 	}
+	else
+	{
+		gdi_CRgnToRect(x, y, w, h, &rgn);
+		gdi_RgnToRect(invalid, &inv);
 
-	gdi_CRgnToRect(x, y, w, h, &rgn);
-	gdi_RgnToRect(invalid, &inv);
+		if (rgn.left < inv.left)
+			inv.left = rgn.left;
 
-	if (rgn.left < inv.left)
-		inv.left = rgn.left;
+		if (rgn.top < inv.top)
+			inv.top = rgn.top;
 
-	if (rgn.top < inv.top)
-		inv.top = rgn.top;
+		if (rgn.right > inv.right)
+			inv.right = rgn.right;
 
-	if (rgn.right > inv.right)
-		inv.right = rgn.right;
+		if (rgn.bottom > inv.bottom)
+			inv.bottom = rgn.bottom;
 
-	if (rgn.bottom > inv.bottom)
-		inv.bottom = rgn.bottom;
+		gdi_RectToRgn(&inv, invalid);
+	}
 
-	gdi_RectToRgn(&inv, invalid);
-	return TRUE;
+	if (!hwnd->region)
+	{
+		hwnd->region = (REGION16*)calloc(1, sizeof(REGION16));
+		if (!hwnd->region)
+			return FALSE;
+		region16_init(hwnd->region);
+	}
+
+	if (reset)
+		region16_clear(hwnd->region);
+	else
+	{
+		const HGDI_RGN last = &hwnd->cinvalid[hwnd->ninvalid - 1];
+
+		/* order storms mostly draw over the same area again */
+		if (gdi_CRgnContains(last->x, last->y, last->w, last->h, x, y, w, h))
+			return TRUE;
+	}
+
+	/* the region is limited to the UINT16 range, clip what is outside anyway */
+	const RECTANGLE_16 rect = { (UINT16)MIN(UINT16_MAX, MAX(0, x)),
+		                        (UINT16)MIN(UINT16_MAX, MAX(0, y)),
+		                        (UINT16)MIN(UINT16_MAX, MAX(0, 1ll * x + w)),
+		                        (UINT16)MIN(UINT16_MAX, MAX(0, 1ll * y + h)) };
+
+	if (!region16_union_rect(hwnd->region, hwnd->region, &rect))
+		return FALSE;
+
+	return gdi_InvalidRegionToList(hwnd);
 }
@@ -192,7 +192,7 @@ VideoSurface* VideoClient_CreateCommonContext(size_t size, UINT32 x, UINT32 y, U
 	ret->alignedHeight = ret->h + 32 - ret->h % 16;
 
 	ret->scanline = ret->alignedWidth * FreeRDPGetBytesPerPixel(ret->format);
-	ret->data = winpr_aligned_malloc(1ull * ret->scanline * ret->alignedHeight, 64);
+	ret->data = winpr_large_malloc(1ull * ret->scanline * ret->alignedHeight, 64);
 	if (!ret->data)
 		goto fail;
 	return ret;
@@ -205,6 +205,6 @@ void VideoClient_DestroyCommonContext(VideoSurface* surface)
 {
 	if (!surface)
 		return;
-	winpr_aligned_free(surface->data);
+	winpr_large_free(surface->data);
 	free(surface);
 }
@@ -0,0 +1,133 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized alpha blending routines.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_alphaComp.h"
+
+#if defined(NEON_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* Blend one channel of 8 pixels. The product wraps like the SSE2 version, only the low
+ * 8 bits of the sum are kept so the result is the same. */
+static INLINE uint8x8_t neon_alphaComp_blend(uint8x8_t s1, uint8x8_t s2, int16x8_t alpha)
+{
+	const int16x8_t diff = vreinterpretq_s16_u16(vsubl_u8(s1, s2));
+	const int16x8_t d = vshrq_n_s16(vmulq_s16(diff, alpha), 8);
+	return vmovn_u16(vreinterpretq_u16_s16(vaddq_s16(d, vreinterpretq_s16_u16(vmovl_u8(s2)))));
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_alphaComp_argb(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+                                     const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+                                     BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 width,
+                                     UINT32 height)
+{
+	if (width < 8) /* pointless if too small */
+		return generic->alphaComp_argb(pSrc1, src1Step, pSrc2, src2Step, pDst, dstStep, width,
+		                               height);
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* sptr1 = &pSrc1[y * src1Step];
+		const BYTE* sptr2 = &pSrc2[y * src2Step];
+		BYTE* dptr = &pDst[y * dstStep];
+		UINT32 x = 0;
+
+		/* 8 pixels per round, deinterleaved so the alpha is a channel of its own */
+		for (; x + 8 <= width; x += 8)
+		{
+			const uint8x8x4_t s1 = vld4_u8(&sptr1[4ULL * x]);
+			const uint8x8x4_t s2 = vld4_u8(&sptr2[4ULL * x]);
+			const int16x8_t alpha = vreinterpretq_s16_u16(vaddw_u8(vdupq_n_u16(1), s1.val[3]));
+			uint8x8x4_t d;
+			d.val[0] = neon_alphaComp_blend(s1.val[0], s2.val[0], alpha);
+			d.val[1] = neon_alphaComp_blend(s1.val[1], s2.val[1], alpha);
+			d.val[2] = neon_alphaComp_blend(s1.val[2], s2.val[2], alpha);
+			d.val[3] = neon_alphaComp_blend(s1.val[3], s2.val[3], alpha);
+			vst4_u8(&dptr[4ULL * x], d);
+		}
+
+		if (x < width)
+		{
+			const pstatus_t status =
+			    generic->alphaComp_argb(&sptr1[4ULL * x], src1Step, &sptr2[4ULL * x], src2Step,
+			                            &dptr[4ULL * x], dstStep, width - x, 1);
+			if (status != PRIMITIVES_SUCCESS)
+				return status;
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_applyAlpha_8u_P1AC4R(const BYTE* WINPR_RESTRICT pAlpha, UINT32 alphaStep,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                           UINT32 DstFormat, const prim_size_t* WINPR_RESTRICT roi)
+{
+	const int offset = alphaComp_alpha_offset(DstFormat);
+
+	if (offset < 0)
+		return -1;
+
+	for (size_t y = 0; y < roi->height; y++)
+	{
+		const BYTE* alpha = &pAlpha[y * alphaStep];
+		BYTE* dst = &pDst[y * dstStep];
+		UINT32 x = 0;
+
+		for (; x + 16 <= roi->width; x += 16)
+		{
+			uint8x16x4_t d = vld4q_u8(&dst[4ULL * x]);
+			d.val[offset] = vld1q_u8(&alpha[x]);
+			vst4q_u8(&dst[4ULL * x], d);
+		}
+
+		for (; x < roi->width; x++)
+			dst[4ULL * x + (size_t)offset] = alpha[x];
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_alphaComp_neon(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_ENABLED)
+	generic = primitives_get_generic();
+	primitives_init_alphaComp(prims);
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "NEON optimizations");
+		prims->alphaComp_argb = neon_alphaComp_argb;
+		prims->applyAlpha_8u_P1AC4R = neon_applyAlpha_8u_P1AC4R;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_NEON");
+	WINPR_UNUSED(prims);
+#endif
+}
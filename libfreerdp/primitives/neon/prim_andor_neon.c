@@ -0,0 +1,74 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized Logical operations.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_andor.h"
+
+#if defined(NEON_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_xorC_32u(const UINT32* WINPR_RESTRICT pSrc, UINT32 val,
+                               UINT32* WINPR_RESTRICT pDst, INT32 len)
+{
+	const uint32x4_t mask = vdupq_n_u32(val);
+
+	/* 4 128-bit registers, 16 values per round */
+	while (len >= 16)
+	{
+		const uint32x4_t q0 = veorq_u32(vld1q_u32(&pSrc[0]), mask);
+		const uint32x4_t q1 = veorq_u32(vld1q_u32(&pSrc[4]), mask);
+		const uint32x4_t q2 = veorq_u32(vld1q_u32(&pSrc[8]), mask);
+		const uint32x4_t q3 = veorq_u32(vld1q_u32(&pSrc[12]), mask);
+		vst1q_u32(&pDst[0], q0);
+		vst1q_u32(&pDst[4], q1);
+		vst1q_u32(&pDst[8], q2);
+		vst1q_u32(&pDst[12], q3);
+		pSrc += 16;
+		pDst += 16;
+		len -= 16;
+	}
+
+	return generic->xorC_32u(pSrc, val, pDst, len);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_andor_neon(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_ENABLED)
+	generic = primitives_get_generic();
+	primitives_init_andor(prims);
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "NEON optimizations");
+		prims->xorC_32u = neon_xorC_32u;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_NEON");
+	WINPR_UNUSED(prims);
+#endif
+}
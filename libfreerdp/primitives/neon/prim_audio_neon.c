@@ -0,0 +1,78 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized audio channel mixing.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_audio.h"
+
+#if defined(NEON_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_monoToStereo_16s(const INT16* WINPR_RESTRICT pSrc,
+                                       INT16* WINPR_RESTRICT pDst, UINT32 frames)
+{
+	UINT32 x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const int16x8_t mono = vld1q_s16(&pSrc[x]);
+		const int16x8x2_t stereo = { { mono, mono } };
+		vst2q_s16(&pDst[2 * x], stereo);
+	}
+
+	return generic->monoToStereo_16s(&pSrc[x], &pDst[2 * x], frames - x);
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_stereoToMono_16s(const INT16* WINPR_RESTRICT pSrc,
+                                       INT16* WINPR_RESTRICT pDst, UINT32 frames)
+{
+	UINT32 x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const int16x8x2_t stereo = vld2q_s16(&pSrc[2 * x]);
+		/* halving add, (left + right) >> 1 without overflow */
+		vst1q_s16(&pDst[x], vhaddq_s16(stereo.val[0], stereo.val[1]));
+	}
+
+	return generic->stereoToMono_16s(&pSrc[2 * x], &pDst[x], frames - x);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_audio_neon(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "NEON optimizations");
+		prims->monoToStereo_16s = neon_monoToStereo_16s;
+		prims->stereoToMono_16s = neon_stereoToMono_16s;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_NEON");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,137 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized copy operations.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_copy.h"
+
+#if defined(NEON_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+static INLINE uint8x16_t neon_shuffle_u8(uint8x16_t src, uint8x16_t index)
+{
+#if defined(_M_ARM64)
+	return vqtbl1q_u8(src, index);
+#else
+	const uint8x8x2_t table = { { vget_low_u8(src), vget_high_u8(src) } };
+	return vcombine_u8(vtbl2_u8(table, vget_low_u8(index)), vtbl2_u8(table, vget_high_u8(index)));
+#endif
+}
+
+static pstatus_t neon_image_copy_no_overlap_convert(
+    BYTE* WINPR_RESTRICT pDstData, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst, UINT32 nWidth,
+    UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, UINT32 nSrcStep, UINT32 nXSrc,
+    UINT32 nYSrc, const PRIM_COPY_SHUFFLE* WINPR_RESTRICT shuffle, SSIZE_T srcVMultiplier,
+    SSIZE_T srcVOffset)
+{
+	const size_t srcByte = shuffle->srcByte;
+	const size_t dstByte = shuffle->dstByte;
+	const uint8x16_t index = vld1q_u8(shuffle->index);
+	const uint8x16_t fill = vld1q_u8(shuffle->fill);
+
+	for (SSIZE_T y = 0; y < nHeight; y++)
+	{
+		const BYTE* WINPR_RESTRICT srcLine =
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset + nXSrc * srcByte];
+		BYTE* WINPR_RESTRICT dstLine = &pDstData[(y + nYDst) * nDstStep + nXDst * dstByte];
+
+		/* 4 pixels per round, the 16 byte loads and stores must stay inside the row. Bytes
+		 * stored past the 4th 24bpp pixel are overwritten by the next round. */
+		size_t x = 0;
+		for (; ((x * srcByte + 16) <= nWidth * srcByte) && ((x * dstByte + 16) <= nWidth * dstByte);
+		     x += 4)
+		{
+			const uint8x16_t s0 = vld1q_u8(&srcLine[x * srcByte]);
+			vst1q_u8(&dstLine[x * dstByte], vorrq_u8(neon_shuffle_u8(s0, index), fill));
+		}
+
+		shuffle->tail(&dstLine[x * dstByte], &srcLine[x * srcByte], (UINT32)(nWidth - x));
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t neon_image_copy_no_overlap(BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat,
+                                            UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
+                                            UINT32 nWidth, UINT32 nHeight,
+                                            const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
+                                            UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc,
+                                            const gdiPalette* WINPR_RESTRICT palette, UINT32 flags)
+{
+	PRIM_COPY_SHUFFLE shuffle = { 0 };
+	SSIZE_T srcVOffset = 0;
+	SSIZE_T srcVMultiplier = 1;
+
+	/* Only conversions that are a plain byte permutation are done here */
+	if ((((flags & FREERDP_KEEP_DST_ALPHA) != 0) && FreeRDPColorHasAlpha(DstFormat)) ||
+	    FreeRDPAreColorFormatsEqualNoAlpha(SrcFormat, DstFormat) ||
+	    !generic_image_copy_shuffle(SrcFormat, DstFormat, &shuffle))
+		return generic->copy_no_overlap(pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth,
+		                                nHeight, pSrcData, SrcFormat, nSrcStep, nXSrc, nYSrc,
+		                                palette, flags);
+
+	if ((nWidth == 0) || (nHeight == 0))
+		return PRIMITIVES_SUCCESS;
+
+	if ((nHeight > INT32_MAX) || (nWidth > INT32_MAX))
+		return -1;
+
+	if (!pDstData || !pSrcData)
+		return -1;
+
+	if (nDstStep == 0)
+		nDstStep = nWidth * shuffle.dstByte;
+
+	if (nSrcStep == 0)
+		nSrcStep = nWidth * shuffle.srcByte;
+
+	if (flags & FREERDP_FLIP_VERTICAL)
+	{
+		srcVOffset = (nHeight - 1ll) * nSrcStep;
+		srcVMultiplier = -1;
+	}
+
+	return neon_image_copy_no_overlap_convert(pDstData, nDstStep, nXDst, nYDst, nWidth, nHeight,
+	                                          pSrcData, nSrcStep, nXSrc, nYSrc, &shuffle,
+	                                          srcVMultiplier, srcVOffset);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_copy_neon(primitives_t* prims)
+{
+#if defined(NEON_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "NEON optimizations");
+		prims->copy_no_overlap = neon_image_copy_no_overlap;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_NEON");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,152 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized planar codec plane split, merge and delta encoding.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_planar.h"
+
+#if defined(NEON_ENABLED)
+#include <arm_neon.h>
+
+static primitives_t* generic = NULL;
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_RGBToPlanes_8u_AC4P4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                            UINT32 SrcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                            UINT32 dstStep, const prim_size_t* WINPR_RESTRICT roi)
+{
+	size_t off[4] = { 0 };
+
+	if (!prim_planar_offsets(SrcFormat, off))
+		return generic->RGBToPlanes_8u_AC4P4R(pSrc, srcStep, SrcFormat, pDst, dstStep, roi);
+
+	const BOOL alpha = FreeRDPColorHasAlpha(SrcFormat);
+	const UINT32 width = roi->width & ~15u;
+	const prim_size_t tail = { roi->width - width, roi->height };
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		const BYTE* src = &pSrc[1ULL * y * srcStep];
+		BYTE* dst[4] = { &pDst[0][1ULL * y * dstStep], &pDst[1][1ULL * y * dstStep],
+			             &pDst[2][1ULL * y * dstStep], &pDst[3][1ULL * y * dstStep] };
+
+		/* 16 pixels per round */
+		for (UINT32 x = 0; x < width; x += 16)
+		{
+			const uint8x16x4_t px = vld4q_u8(&src[4ULL * x]);
+
+			vst1q_u8(&dst[0][x], px.val[off[0]]);
+			vst1q_u8(&dst[1][x], px.val[off[1]]);
+			vst1q_u8(&dst[2][x], px.val[off[2]]);
+			vst1q_u8(&dst[3][x], alpha ? px.val[off[3]] : vdupq_n_u8(0xFF));
+		}
+	}
+
+	if (tail.width > 0)
+	{
+		BYTE* dst[4] = { &pDst[0][width], &pDst[1][width], &pDst[2][width], &pDst[3][width] };
+		return generic->RGBToPlanes_8u_AC4P4R(&pSrc[4ULL * width], srcStep, SrcFormat, dst,
+		                                      dstStep, &tail);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_PlanesToRGB_8u_P4AC4R(const BYTE* WINPR_RESTRICT pSrc[4], UINT32 srcStep,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                            UINT32 DstFormat, const prim_size_t* WINPR_RESTRICT roi)
+{
+	size_t off[4] = { 0 };
+
+	if (!prim_planar_offsets(DstFormat, off))
+		return generic->PlanesToRGB_8u_P4AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+
+	const UINT32 width = roi->width & ~15u;
+	const prim_size_t tail = { roi->width - width, roi->height };
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		/* 16 pixels per round */
+		for (UINT32 x = 0; x < width; x += 16)
+		{
+			const size_t pos = 1ULL * y * srcStep + x;
+			uint8x16x4_t px;
+
+			px.val[off[0]] = vld1q_u8(&pSrc[0][pos]);
+			px.val[off[1]] = vld1q_u8(&pSrc[1][pos]);
+			px.val[off[2]] = vld1q_u8(&pSrc[2][pos]);
+			px.val[off[3]] = pSrc[3] ? vld1q_u8(&pSrc[3][pos]) : vdupq_n_u8(0xFF);
+			vst4q_u8(&dst[4ULL * x], px);
+		}
+	}
+
+	if (tail.width > 0)
+	{
+		const BYTE* src[4] = { &pSrc[0][width], &pSrc[1][width], &pSrc[2][width],
+			                   pSrc[3] ? &pSrc[3][width] : NULL };
+		return generic->PlanesToRGB_8u_P4AC4R(src, srcStep, &pDst[4ULL * width], dstStep,
+		                                      DstFormat, &tail);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t neon_deltaSignEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                         const BYTE* WINPR_RESTRICT pPrev,
+                                         BYTE* WINPR_RESTRICT pDst, UINT32 len)
+{
+	UINT32 x = 0;
+
+	/* 16 values per round */
+	for (; x + 16 <= len; x += 16)
+	{
+		const uint8x16_t diff = vsubq_u8(vld1q_u8(&pSrc[x]), vld1q_u8(&pPrev[x]));
+		const int8x16_t delta = vreinterpretq_s8_u8(diff);
+		const uint8x16_t neg = vcltq_s8(delta, vdupq_n_s8(0));
+		/* |delta| wraps to 0x80 for -128, which still yields the expected 0xFF */
+		const uint8x16_t mag = vreinterpretq_u8_s8(vabsq_s8(delta));
+		vst1q_u8(&pDst[x], vaddq_u8(vshlq_n_u8(mag, 1), neg));
+	}
+
+	return generic->deltaSignEncode_8u(&pSrc[x], &pPrev[x], &pDst[x], len - x);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar_neon(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "NEON optimizations");
+		prims->RGBToPlanes_8u_AC4P4R = neon_RGBToPlanes_8u_AC4P4R;
+		prims->PlanesToRGB_8u_P4AC4R = neon_PlanesToRGB_8u_P4AC4R;
+		prims->deltaSignEncode_8u = neon_deltaSignEncode_8u;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_NEON");
+	WINPR_UNUSED(prims);
+#endif
+}
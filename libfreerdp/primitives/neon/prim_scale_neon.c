@@ -0,0 +1,108 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized image scaling.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+#if defined(NEON_ENABLED)
+#include <arm_neon.h>
+
+/* ------------------------------------------------------------------------- */
+static void neon_scale_vrow(const BYTE* WINPR_RESTRICT s0, const BYTE* WINPR_RESTRICT s1,
+                            UINT16 wy, UINT16* WINPR_RESTRICT row, size_t len)
+{
+	const UINT16 w0 = PRIM_SCALE_WEIGHT_ONE - wy;
+	const uint8x8_t v0 = vdup_n_u8((uint8_t)w0);
+	const uint8x8_t v1 = vdup_n_u8((uint8_t)wy);
+	size_t i = 0;
+
+	/* 16 channels per round */
+	for (; i + 16 <= len; i += 16)
+	{
+		const uint8x16_t a = vld1q_u8(&s0[i]);
+		const uint8x16_t b = vld1q_u8(&s1[i]);
+		const uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(a), v0), vget_low_u8(b), v1);
+		const uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(a), v0), vget_high_u8(b), v1);
+		vst1q_u16(&row[i], lo);
+		vst1q_u16(&row[i + 8], hi);
+	}
+
+	for (; i < len; i++)
+		row[i] = (UINT16)(s0[i] * w0 + s1[i] * wy);
+}
+
+static INLINE uint16x4_t neon_scale_pixel(const UINT16* WINPR_RESTRICT row, UINT32 x0, UINT16 w1)
+{
+	const UINT16* p = &row[4ULL * x0];
+	const uint32x4_t sum =
+	    vmlal_n_u16(vmull_n_u16(vld1_u16(p), PRIM_SCALE_WEIGHT_ONE - w1), vld1_u16(&p[4]), w1);
+	return vrshrn_n_u32(sum, 14);
+}
+
+static void neon_scale_hrow(const UINT16* WINPR_RESTRICT row, const UINT32* WINPR_RESTRICT xofs,
+                            const UINT16* WINPR_RESTRICT xw, BYTE* WINPR_RESTRICT dst,
+                            UINT32 width)
+{
+	UINT32 x = 0;
+
+	/* 2 pixels per round */
+	for (; x + 2 <= width; x += 2)
+	{
+		const uint16x4_t p0 = neon_scale_pixel(row, xofs[x + 0], xw[x + 0]);
+		const uint16x4_t p1 = neon_scale_pixel(row, xofs[x + 1], xw[x + 1]);
+		vst1_u8(dst, vmovn_u16(vcombine_u16(p0, p1)));
+		dst += 8;
+	}
+
+	for (; x < width; x++)
+	{
+		const UINT16* p = &row[4ULL * xofs[x]];
+		const UINT32 w1 = xw[x];
+		const UINT32 w0 = PRIM_SCALE_WEIGHT_ONE - w1;
+
+		for (size_t c = 0; c < 4; c++)
+			*dst++ = (BYTE)((p[c] * w0 + p[c + 4] * w1 + 8192) >> 14);
+	}
+}
+
+static pstatus_t neon_scale_8u_AC4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                    const prim_size_t* WINPR_RESTRICT srcRoi,
+                                    BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                    const prim_size_t* WINPR_RESTRICT dstRoi)
+{
+	return prim_scale_8u_AC4R(pSrc, srcStep, srcRoi, pDst, dstStep, dstRoi, neon_scale_vrow,
+	                          neon_scale_hrow);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_neon(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(NEON_ENABLED)
+	if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "NEON optimizations");
+		prims->scale_8u_AC4R = neon_scale_8u_AC4R;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_NEON");
+	WINPR_UNUSED(prims);
+#endif
+}
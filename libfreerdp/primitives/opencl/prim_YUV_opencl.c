@@ -50,6 +50,7 @@ typedef struct
 	primitives_opencl_context* cl;
 	cl_kernel kernel;
 	cl_mem srcObjs[3];
+	cl_mem yuvObjs[3];
 	cl_mem dstObj;
 	prim_size_t roi;
 	size_t dstStep;
@@ -73,6 +74,14 @@ static void cl_kernel_free(primitives_cl_kernel* kernel)
 			clReleaseMemObject(obj);
 	}
 
+	for (size_t i = 0; i < ARRAYSIZE(kernel->yuvObjs); i++)
+	{
+		cl_mem obj = kernel->yuvObjs[i];
+		kernel->yuvObjs[i] = NULL;
+		if (obj)
+			clReleaseMemObject(obj);
+	}
+
 	if (kernel->kernel)
 		clReleaseKernel(kernel->kernel);
 
@@ -147,7 +156,8 @@ static BOOL cl_kernel_set_sources(primitives_cl_kernel* ctx, const BYTE* WINPR_R
 	return TRUE;
 }
 
-static BOOL cl_kernel_set_destination(primitives_cl_kernel* ctx, UINT32 dstStep)
+static BOOL cl_kernel_set_destination(primitives_cl_kernel* ctx, cl_uint argIndex,
+                                      UINT32 dstStep)
 {
 
 	WINPR_ASSERT(ctx);
@@ -162,14 +172,14 @@ static BOOL cl_kernel_set_destination(primitives_cl_kernel* ctx, UINT32 dstStep)
 		return FALSE;
 	}
 
-	ret = clSetKernelArg(ctx->kernel, 6, sizeof(cl_mem), &ctx->dstObj);
+	ret = clSetKernelArg(ctx->kernel, argIndex, sizeof(cl_mem), &ctx->dstObj);
 	if (ret != CL_SUCCESS)
 	{
 		WLog_ERR(TAG, "unable to set arg destObj");
 		return FALSE;
 	}
 
-	ret = clSetKernelArg(ctx->kernel, 7, sizeof(cl_uint), &dstStep);
+	ret = clSetKernelArg(ctx->kernel, argIndex + 1, sizeof(cl_uint), &dstStep);
 	if (ret != CL_SUCCESS)
 	{
 		WLog_ERR(TAG, "unable to set arg dstStep");
@@ -221,7 +231,7 @@ static pstatus_t opencl_YUVToRGB(const char* kernelName, const BYTE* WINPR_RESTR
 	if (!cl_kernel_set_sources(ctx, pSrc, srcStep))
 		goto fail;
 
-	if (!cl_kernel_set_destination(ctx, dstStep))
+	if (!cl_kernel_set_destination(ctx, 6, dstStep))
 		goto fail;
 
 	if (!cl_kernel_process(ctx, pDst))
@@ -234,6 +244,223 @@ fail:
 	return res;
 }
 
+static BOOL cl_kernel_set_arg(primitives_cl_kernel* ctx, cl_uint index, size_t size,
+                              const void* value, const char* name)
+{
+	WINPR_ASSERT(ctx);
+
+	const cl_int ret = clSetKernelArg(ctx->kernel, index, size, value);
+	if (ret != CL_SUCCESS)
+	{
+		WLog_ERR(TAG, "unable to set arg %s", name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* byte offsets of R, G, B and A in a destination pixel */
+static BOOL cl_format_offsets(UINT32 DstFormat, cl_uchar4* fmt)
+{
+	WINPR_ASSERT(fmt);
+
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			*fmt = (cl_uchar4){ { 2, 1, 0, 3 } };
+			return TRUE;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			*fmt = (cl_uchar4){ { 0, 1, 2, 3 } };
+			return TRUE;
+		case PIXEL_FORMAT_ARGB32:
+		case PIXEL_FORMAT_XRGB32:
+			*fmt = (cl_uchar4){ { 1, 2, 3, 0 } };
+			return TRUE;
+		case PIXEL_FORMAT_ABGR32:
+		case PIXEL_FORMAT_XBGR32:
+			*fmt = (cl_uchar4){ { 3, 2, 1, 0 } };
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+static BOOL cl_kernel_set_combine_args(primitives_cl_kernel* ctx, avc444_frame_type type,
+                                       const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
+                                       UINT32 nWidth, UINT32 nHeight,
+                                       BYTE* WINPR_RESTRICT pYUVDst[3],
+                                       const UINT32 yuvDstStep[3], cl_uchar4 fmt,
+                                       const RECTANGLE_16* WINPR_RESTRICT roi)
+{
+	const char* sourceNames[] = { "Y", "U", "V" };
+
+	WINPR_ASSERT(ctx);
+	WINPR_ASSERT(pSrc);
+	WINPR_ASSERT(srcStep);
+	WINPR_ASSERT(pYUVDst);
+	WINPR_ASSERT(yuvDstStep);
+	WINPR_ASSERT(roi);
+
+	for (cl_uint i = 0; i < ARRAYSIZE(ctx->srcObjs); i++)
+	{
+		cl_int ret = CL_INVALID_VALUE;
+		const BYTE* csrc = pSrc[i];
+		void* WINPR_RESTRICT src = WINPR_CAST_CONST_PTR_AWAY(csrc, void* WINPR_RESTRICT);
+		const size_t rows = (i == 0) ? nHeight : nHeight / 2;
+
+		ctx->srcObjs[i] = clCreateBuffer(ctx->cl->context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+		                                 1ull * srcStep[i] * rows, src, &ret);
+		if (ret != CL_SUCCESS)
+		{
+			WLog_ERR(TAG, "unable to create %sobj", sourceNames[i]);
+			return FALSE;
+		}
+
+		/* The combined planes stay host backed, they carry over to the next luma or chroma
+		 * frame and may be handed out by the decoder. */
+		ctx->yuvObjs[i] =
+		    clCreateBuffer(ctx->cl->context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR,
+		                   1ull * yuvDstStep[i] * roi->bottom, pYUVDst[i], &ret);
+		if (ret != CL_SUCCESS)
+		{
+			WLog_ERR(TAG, "unable to create YUV444 %sobj", sourceNames[i]);
+			return FALSE;
+		}
+
+		if (!cl_kernel_set_arg(ctx, i * 2, sizeof(cl_mem), &ctx->srcObjs[i], sourceNames[i]) ||
+		    !cl_kernel_set_arg(ctx, i * 2 + 1, sizeof(cl_uint), &srcStep[i], "srcStep") ||
+		    !cl_kernel_set_arg(ctx, 6 + i * 2, sizeof(cl_mem), &ctx->yuvObjs[i], sourceNames[i]) ||
+		    !cl_kernel_set_arg(ctx, 7 + i * 2, sizeof(cl_uint), &yuvDstStep[i], "yuvDstStep"))
+			return FALSE;
+	}
+
+	/* The destination only covers the region, it is copied to its place on read back */
+	const cl_uint dstStep = 4 * ctx->roi.width;
+	if (!cl_kernel_set_destination(ctx, 12, dstStep))
+		return FALSE;
+
+	const cl_uint args[] = { type,           roi->left,       roi->top,
+		                     ctx->roi.width, ctx->roi.height, nWidth };
+	for (cl_uint i = 0; i < ARRAYSIZE(args); i++)
+	{
+		if (!cl_kernel_set_arg(ctx, 14 + i, sizeof(cl_uint), &args[i], "region"))
+			return FALSE;
+	}
+
+	return cl_kernel_set_arg(ctx, 14 + ARRAYSIZE(args), sizeof(cl_uchar4), &fmt, "fmt");
+}
+
+static BOOL cl_kernel_process_combine(primitives_cl_kernel* ctx, BYTE* WINPR_RESTRICT pYUVDst[3],
+                                      const UINT32 yuvDstStep[3], BYTE* pDst, UINT32 dstStep,
+                                      const RECTANGLE_16* WINPR_RESTRICT roi)
+{
+	WINPR_ASSERT(ctx);
+	WINPR_ASSERT(pYUVDst);
+	WINPR_ASSERT(yuvDstStep);
+	WINPR_ASSERT(pDst);
+	WINPR_ASSERT(roi);
+
+	/* one work item per 2x2 block */
+	size_t indexes[2] = { 0 };
+	indexes[0] = (ctx->roi.width + 1) / 2;
+	indexes[1] = (ctx->roi.height + 1) / 2;
+
+	cl_int ret = clEnqueueNDRangeKernel(ctx->cl->commandQueue, ctx->kernel, 2, NULL, indexes, NULL,
+	                                    0, NULL, NULL);
+	if (ret != CL_SUCCESS)
+	{
+		WLog_ERR(TAG, "unable to enqueue call kernel");
+		return FALSE;
+	}
+
+	/* Make the combined region visible in the host backed YUV444 planes */
+	for (size_t i = 0; i < ARRAYSIZE(ctx->yuvObjs); i++)
+	{
+		const size_t offset = 1ull * yuvDstStep[i] * roi->top;
+		const size_t size = 1ull * yuvDstStep[i] * ctx->roi.height;
+		void* mapped = clEnqueueMapBuffer(ctx->cl->commandQueue, ctx->yuvObjs[i], CL_TRUE,
+		                                  CL_MAP_READ, offset, size, 0, NULL, NULL, &ret);
+		if (ret != CL_SUCCESS)
+		{
+			WLog_ERR(TAG, "unable to map YUV444 buffer");
+			return FALSE;
+		}
+
+		ret = clEnqueueUnmapMemObject(ctx->cl->commandQueue, ctx->yuvObjs[i], mapped, 0, NULL,
+		                              NULL);
+		if (ret != CL_SUCCESS)
+		{
+			WLog_ERR(TAG, "unable to unmap YUV444 buffer");
+			return FALSE;
+		}
+	}
+
+	/* Transfer result to host */
+	const size_t bufferOrigin[3] = { 0 };
+	const size_t hostOrigin[3] = { 4ull * roi->left, roi->top, 0 };
+	const size_t region[3] = { ctx->dstStep, ctx->roi.height, 1 };
+	ret = clEnqueueReadBufferRect(ctx->cl->commandQueue, ctx->dstObj, CL_TRUE, bufferOrigin,
+	                              hostOrigin, region, ctx->dstStep, 0, dstStep, 0, pDst, 0, NULL,
+	                              NULL);
+	if (ret != CL_SUCCESS)
+	{
+		WLog_ERR(TAG, "unable to read back buffer");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static pstatus_t opencl_YUV420CombineToRGB_8u_P3AC4R(
+    avc444_frame_type type, const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
+    UINT32 nWidth, UINT32 nHeight, BYTE* WINPR_RESTRICT pYUVDst[3], const UINT32 yuvDstStep[3],
+    BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+    const RECTANGLE_16* WINPR_RESTRICT roi)
+{
+	pstatus_t res = -1;
+
+	if (!pSrc || !pSrc[0] || !pSrc[1] || !pSrc[2])
+		return -1;
+
+	if (!pYUVDst || !pYUVDst[0] || !pYUVDst[1] || !pYUVDst[2])
+		return -1;
+
+	if (!roi || !pDst)
+		return -1;
+
+	if ((roi->right <= roi->left) || (roi->bottom <= roi->top))
+		return PRIMITIVES_SUCCESS;
+
+	cl_uchar4 fmt = { 0 };
+	if (!cl_format_offsets(DstFormat, &fmt))
+	{
+		primitives_t* p = primitives_get_by_type(PRIMITIVES_ONLY_CPU);
+		if (!p)
+			return -1;
+		return p->YUV420CombineToRGB_8u_P3AC4R(type, pSrc, srcStep, nWidth, nHeight, pYUVDst,
+		                                       yuvDstStep, pDst, dstStep, DstFormat, roi);
+	}
+
+	const prim_size_t size = { .width = roi->right - roi->left, .height = roi->bottom - roi->top };
+	primitives_cl_kernel* ctx = cl_kernel_new("avc444_combine_to_rgb", &size);
+	if (!ctx)
+		goto fail;
+
+	if (!cl_kernel_set_combine_args(ctx, type, pSrc, srcStep, nWidth, nHeight, pYUVDst,
+	                                yuvDstStep, fmt, roi))
+		goto fail;
+
+	if (!cl_kernel_process_combine(ctx, pYUVDst, yuvDstStep, pDst, dstStep, roi))
+		goto fail;
+
+	res = PRIMITIVES_SUCCESS;
+
+fail:
+	cl_kernel_free(ctx);
+	return res;
+}
+
 static primitives_opencl_context openclContext = { 0 };
 
 static primitives_opencl_context* primitives_get_opencl_context(void)
@@ -494,6 +721,7 @@ BOOL primitives_init_opencl(primitives_t* prims)
 
 	prims->YUV420ToRGB_8u_P3AC4R = opencl_YUV420ToRGB_8u_P3AC4R;
 	prims->YUV444ToRGB_8u_P3AC4R = opencl_YUV444ToRGB_8u_P3AC4R;
+	prims->YUV420CombineToRGB_8u_P3AC4R = opencl_YUV420CombineToRGB_8u_P3AC4R;
 	prims->flags |= PRIM_FLAGS_HAVE_EXTGPU;
 	prims->uninit = primitives_uninit_opencl;
 	return TRUE;
@@ -457,3 +457,127 @@ __kernel void yuv444_to_xrgb_1b(
     destPtr[1] = clamp_uc((y256 + (403 * V)) >> 8, 0, 255); 	/* R */
     destPtr[0] = 0xff; /* A */
 }
+
+/**
+ * AVC444 combine and YUV444 to RGB conversion in one pass, one work item per 2x2 block.
+ *
+ * bufY, bufU and bufV are the planes of the decoded luma or chroma frame, yuvY, yuvU and yuvV
+ * the full resolution planes holding the combined frame between a luma and a chroma frame.
+ * Both are indexed with the region offset, dest only covers the region.
+ * fmt holds the byte offsets of R, G, B and A in a destination pixel.
+ */
+uchar avc444_filter(uchar in, int u2020)
+{
+    uchar out = clamp_uc(u2020, 0, 255);
+    int diff = (out > in) ? out - in : in - out;
+    return (diff < 30) ? in : out;
+}
+
+__kernel void avc444_combine_to_rgb(
+    __global const uchar *bufY, unsigned strideY,
+    __global const uchar *bufU, unsigned strideU,
+    __global const uchar *bufV, unsigned strideV,
+    __global uchar *yuvY, unsigned strideYuvY,
+    __global uchar *yuvU, unsigned strideYuvU,
+    __global uchar *yuvV, unsigned strideYuvV,
+    __global uchar *dest, unsigned strideDest,
+    unsigned type, unsigned left, unsigned top, unsigned width, unsigned height,
+    unsigned totalWidth, uchar4 fmt)
+{
+    unsigned int i = get_global_id(0);
+    unsigned int j = get_global_id(1);
+    unsigned int x0 = 2 * i;
+    unsigned int y0 = 2 * j;
+    uchar Y[4];
+    uchar U[4];
+    uchar V[4];
+
+    /* Samples of the block are numbered x + 2 * y */
+    if (type == 0)
+    {
+        /* Luma frame: main view Y, the subsampled U and V fill the whole block */
+        uchar u = bufU[(top / 2 + j) * strideU + left / 2 + i];
+        uchar v = bufV[(top / 2 + j) * strideV + left / 2 + i];
+
+        for (unsigned int n = 0; n < 4; n++)
+        {
+            unsigned int x = min(x0 + (n & 1), width - 1);
+            unsigned int y = min(y0 + (n >> 1), height - 1);
+            Y[n] = bufY[(top + y) * strideY + left + x];
+            U[n] = u;
+            V[n] = v;
+        }
+    }
+    else
+    {
+        /* Chroma frame: Y and the even sample come from the last luma frame */
+        for (unsigned int n = 0; n < 4; n++)
+        {
+            unsigned int x = min(x0 + (n & 1), width - 1);
+            unsigned int y = min(y0 + (n >> 1), height - 1);
+            Y[n] = yuvY[(top + y) * strideYuvY + left + x];
+            U[n] = yuvU[(top + y) * strideYuvU + left + x];
+            V[n] = yuvV[(top + y) * strideYuvV + left + x];
+        }
+
+        if (type == 1)
+        {
+            /* Chroma v1: odd lines come in groups of 8 from the auxiliary Y plane */
+            unsigned int ya = (j / 8) * 16 + (j % 8);
+            __global const uchar *pU = bufY + (top + ya) * strideY + left;
+            __global const uchar *pV = pU + 8 * strideY;
+
+            U[2] = pU[x0];
+            U[3] = pU[x0 + 1];
+            V[2] = pV[x0];
+            V[3] = pV[x0 + 1];
+            U[1] = bufU[(top / 2 + j) * strideU + left / 2 + i];
+            V[1] = bufV[(top / 2 + j) * strideV + left / 2 + i];
+        }
+        else
+        {
+            /* Chroma v2: odd columns from the auxiliary Y plane, U and V side by side */
+            __global const uchar *pY0 = bufY + (top + y0) * strideY + left / 2 + i;
+            __global const uchar *pY1 = pY0 + strideY;
+            __global const uchar *pUV = (i & 1) ? bufV + (top / 2 + j) * strideV
+                                                : bufU + (top / 2 + j) * strideU;
+
+            pUV += left / 4 + i / 2;
+            U[1] = pY0[0];
+            V[1] = pY0[totalWidth / 2];
+            U[3] = pY1[0];
+            V[3] = pY1[totalWidth / 2];
+            U[2] = pUV[0];
+            V[2] = pUV[totalWidth / 4];
+        }
+
+        /* Filter the even sample once the other three are known */
+        if ((x0 + 1 < width) && (y0 + 1 < height))
+        {
+            U[0] = avc444_filter(U[0], 4 * U[0] - U[1] - U[2] - U[3]);
+            V[0] = avc444_filter(V[0], 4 * V[0] - V[1] - V[2] - V[3]);
+        }
+    }
+
+    for (unsigned int n = 0; n < 4; n++)
+    {
+        unsigned int x = x0 + (n & 1);
+        unsigned int y = y0 + (n >> 1);
+
+        if ((x >= width) || (y >= height))
+            continue;
+
+        yuvY[(top + y) * strideYuvY + left + x] = Y[n];
+        yuvU[(top + y) * strideYuvU + left + x] = U[n];
+        yuvV[(top + y) * strideYuvV + left + x] = V[n];
+
+        __global uchar *destPtr = dest + (strideDest * y) + (x * 4);
+        short Ud = U[n] - 128;
+        short Vd = V[n] - 128;
+        int y256 = 256 * Y[n];
+        destPtr[fmt.s0] = clamp_uc((y256 + (403 * Vd)) >> 8, 0, 255); /* R */
+        destPtr[fmt.s1] = clamp_uc((y256 - (48 * Ud) - (120 * Vd)) >> 8, 0, 255); /* G */
+        destPtr[fmt.s2] = clamp_uc((y256 + (475 * Ud)) >> 8, 0, 255); /* B */
+        destPtr[fmt.s3] = 0xff; /* A */
+    }
+}
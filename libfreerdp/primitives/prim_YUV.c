@@ -297,6 +297,33 @@ static pstatus_t general_YUV420CombineToYUV444(avc444_frame_type type,
 	}
 }
 
+static pstatus_t general_YUV420CombineToRGB_8u_P3AC4R(
+    avc444_frame_type type, const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
+    UINT32 nWidth, UINT32 nHeight, BYTE* WINPR_RESTRICT pYUVDst[3], const UINT32 yuvDstStep[3],
+    BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+    const RECTANGLE_16* WINPR_RESTRICT roi)
+{
+	primitives_t* prims = primitives_get();
+
+	if (!roi || !pDst)
+		return -1;
+
+	const pstatus_t rc = prims->YUV420CombineToYUV444(type, pSrc, srcStep, nWidth, nHeight, pYUVDst,
+	                                                  yuvDstStep, roi);
+	if (rc != PRIMITIVES_SUCCESS)
+		return rc;
+
+	const prim_size_t size = { .width = roi->right - roi->left, .height = roi->bottom - roi->top };
+	const BYTE* pYUVPoint[3] = { pYUVDst[0] + 1ULL * roi->top * yuvDstStep[0] + roi->left,
+		                         pYUVDst[1] + 1ULL * roi->top * yuvDstStep[1] + roi->left,
+		                         pYUVDst[2] + 1ULL * roi->top * yuvDstStep[2] + roi->left };
+	BYTE* pDstPoint =
+	    pDst + 1ULL * roi->top * dstStep + 1ULL * roi->left * FreeRDPGetBytesPerPixel(DstFormat);
+
+	return prims->YUV444ToRGB_8u_P3AC4R(pYUVPoint, yuvDstStep, pDstPoint, dstStep, DstFormat,
+	                                    &size);
+}
+
 static pstatus_t
 general_YUV444SplitToYUV420(const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
                             BYTE* WINPR_RESTRICT pMainDst[3], const UINT32 dstMainStep[3],
@@ -1874,6 +1901,7 @@ void primitives_init_YUV(primitives_t* WINPR_RESTRICT prims)
 	prims->RGBToYUV420_8u_P3AC4R = general_RGBToYUV420_8u_P3AC4R;
 	prims->RGBToYUV444_8u_P3AC4R = general_RGBToYUV444_8u_P3AC4R;
 	prims->YUV420CombineToYUV444 = general_YUV420CombineToYUV444;
+	prims->YUV420CombineToRGB_8u_P3AC4R = general_YUV420CombineToRGB_8u_P3AC4R;
 	prims->YUV444SplitToYUV420 = general_YUV444SplitToYUV420;
 	prims->RGBToAVC444YUV = general_RGBToAVC444YUV;
 	prims->RGBToAVC444YUVv2 = general_RGBToAVC444YUVv2;
@@ -1882,5 +1910,8 @@ void primitives_init_YUV(primitives_t* WINPR_RESTRICT prims)
 void primitives_init_YUV_opt(primitives_t* WINPR_RESTRICT prims)
 {
 	primitives_init_YUV_ssse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_YUV_avx2(prims);
+#endif
 	primitives_init_YUV_neon(prims);
 }
@@ -28,4 +28,8 @@
 void primitives_init_YUV_ssse3(primitives_t* WINPR_RESTRICT prims);
 void primitives_init_YUV_neon(primitives_t* WINPR_RESTRICT prims);
 
+#if defined(WITH_AVX2)
+void primitives_init_YUV_avx2(primitives_t* WINPR_RESTRICT prims);
+#endif
+
 #endif
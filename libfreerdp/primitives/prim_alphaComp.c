@@ -23,6 +23,7 @@
 
 #include <freerdp/types.h>
 #include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
 
 #include "prim_internal.h"
 #include "prim_alphaComp.h"
@@ -84,13 +85,58 @@ static pstatus_t general_alphaComp_argb(const BYTE* pSrc1, UINT32 src1Step, cons
 	return PRIMITIVES_SUCCESS;
 }
 
+/* ------------------------------------------------------------------------- */
+int alphaComp_alpha_offset(UINT32 DstFormat)
+{
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_ARGB32:
+		case PIXEL_FORMAT_ABGR32:
+			return 0;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			return 3;
+		default:
+			return -1;
+	}
+}
+
+static pstatus_t general_applyAlpha_8u_P1AC4R(const BYTE* WINPR_RESTRICT pAlpha, UINT32 alphaStep,
+                                              BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                              UINT32 DstFormat,
+                                              const prim_size_t* WINPR_RESTRICT roi)
+{
+	const int offset = alphaComp_alpha_offset(DstFormat);
+
+	if (offset < 0)
+		return -1;
+
+	for (size_t y = 0; y < roi->height; y++)
+	{
+		const BYTE* alpha = &pAlpha[y * alphaStep];
+		BYTE* dst = &pDst[y * dstStep + (size_t)offset];
+
+		for (size_t x = 0; x < roi->width; x++)
+			dst[x * 4] = alpha[x];
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
 /* ------------------------------------------------------------------------- */
 void primitives_init_alphaComp(primitives_t* WINPR_RESTRICT prims)
 {
 	prims->alphaComp_argb = general_alphaComp_argb;
+	prims->applyAlpha_8u_P1AC4R = general_applyAlpha_8u_P1AC4R;
 }
 
 void primitives_init_alphaComp_opt(primitives_t* WINPR_RESTRICT prims)
 {
 	primitives_init_alphaComp_sse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_alphaComp_avx2(prims);
+#endif
+	primitives_init_alphaComp_neon(prims);
 }
@@ -25,6 +25,13 @@
 #include <freerdp/config.h>
 #include <freerdp/primitives.h>
 
+/* Byte offset of the alpha channel in a pixel of DstFormat, -1 if there is none to write */
+int alphaComp_alpha_offset(UINT32 DstFormat);
+
 void primitives_init_alphaComp_sse3(primitives_t* WINPR_RESTRICT prims);
+#if defined(WITH_AVX2)
+void primitives_init_alphaComp_avx2(primitives_t* WINPR_RESTRICT prims);
+#endif
+void primitives_init_alphaComp_neon(primitives_t* WINPR_RESTRICT prims);
 
 #endif
@@ -49,15 +49,31 @@ static pstatus_t general_orC_32u(const UINT32* pSrc, UINT32 val, UINT32* pDst, I
 	return PRIMITIVES_SUCCESS;
 }
 
+/* ----------------------------------------------------------------------------
+ * 32-bit XOR with a constant.
+ */
+static pstatus_t general_xorC_32u(const UINT32* pSrc, UINT32 val, UINT32* pDst, INT32 len)
+{
+	while (len-- > 0)
+		*pDst++ = *pSrc++ ^ val;
+
+	return PRIMITIVES_SUCCESS;
+}
+
 /* ------------------------------------------------------------------------- */
 void primitives_init_andor(primitives_t* WINPR_RESTRICT prims)
 {
 	/* Start with the default. */
 	prims->andC_32u = general_andC_32u;
 	prims->orC_32u = general_orC_32u;
+	prims->xorC_32u = general_xorC_32u;
 }
 
 void primitives_init_andor_opt(primitives_t* WINPR_RESTRICT prims)
 {
 	primitives_init_andor_sse3(prims);
+#if defined(WITH_AVX2)
+	primitives_init_andor_avx2(prims);
+#endif
+	primitives_init_andor_neon(prims);
 }
@@ -26,5 +26,9 @@
 #include <freerdp/primitives.h>
 
 void primitives_init_andor_sse3(primitives_t* WINPR_RESTRICT prims);
+#if defined(WITH_AVX2)
+void primitives_init_andor_avx2(primitives_t* WINPR_RESTRICT prims);
+#endif
+void primitives_init_andor_neon(primitives_t* WINPR_RESTRICT prims);
 
 #endif
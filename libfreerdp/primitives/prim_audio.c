@@ -0,0 +1,61 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Audio channel mixing.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_audio.h"
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_monoToStereo_16s(const INT16* WINPR_RESTRICT pSrc,
+                                          INT16* WINPR_RESTRICT pDst, UINT32 frames)
+{
+	for (UINT32 x = 0; x < frames; x++)
+	{
+		pDst[2 * x] = pSrc[x];
+		pDst[2 * x + 1] = pSrc[x];
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_stereoToMono_16s(const INT16* WINPR_RESTRICT pSrc,
+                                          INT16* WINPR_RESTRICT pDst, UINT32 frames)
+{
+	for (UINT32 x = 0; x < frames; x++)
+	{
+		/* the sum of two samples can not overflow 32bit, halve it afterwards */
+		const INT32 sum = (INT32)pSrc[2 * x] + pSrc[2 * x + 1];
+		pDst[x] = (INT16)(sum >> 1);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_audio(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->monoToStereo_16s = general_monoToStereo_16s;
+	prims->stereoToMono_16s = general_stereoToMono_16s;
+}
+
+void primitives_init_audio_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_audio_sse2(prims);
+	primitives_init_audio_neon(prims);
+}
@@ -192,6 +192,420 @@ static INLINE pstatus_t generic_image_copy_bgrx32_bgrx32(
 	return PRIMITIVES_SUCCESS;
 }
 
+/* Pixel accessors for the format specialized row converters. They reproduce
+ * FreeRDPSplitColor and FreeRDPGetColor for the respective format. */
+#define PRIM_COPY_EXPAND5(c) (BYTE)((((c)&0x1F) << 3) + (((c)&0x1F) >> 2))
+#define PRIM_COPY_EXPAND6(c) (BYTE)MIN(255, (((c)&0x3F) << 2) + (((c)&0x3F) >> 3))
+
+#define PRIM_COPY_BYTES_ARGB32 4
+#define PRIM_COPY_READ_ARGB32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(a) = (s)[0];                        \
+		(r) = (s)[1];                        \
+		(g) = (s)[2];                        \
+		(b) = (s)[3];                        \
+	} while (0)
+#define PRIM_COPY_WRITE_ARGB32(d, r, g, b, a) \
+	do                                        \
+	{                                         \
+		(d)[0] = (a);                         \
+		(d)[1] = (r);                         \
+		(d)[2] = (g);                         \
+		(d)[3] = (b);                         \
+	} while (0)
+
+#define PRIM_COPY_BYTES_XRGB32 4
+#define PRIM_COPY_READ_XRGB32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(a) = 0xFF;                          \
+		(r) = (s)[1];                        \
+		(g) = (s)[2];                        \
+		(b) = (s)[3];                        \
+	} while (0)
+#define PRIM_COPY_WRITE_XRGB32(d, r, g, b, a) \
+	do                                        \
+	{                                         \
+		(d)[0] = 0;                           \
+		(d)[1] = (r);                         \
+		(d)[2] = (g);                         \
+		(d)[3] = (b);                         \
+		WINPR_UNUSED(a);                      \
+	} while (0)
+
+#define PRIM_COPY_BYTES_ABGR32 4
+#define PRIM_COPY_READ_ABGR32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(a) = (s)[0];                        \
+		(b) = (s)[1];                        \
+		(g) = (s)[2];                        \
+		(r) = (s)[3];                        \
+	} while (0)
+#define PRIM_COPY_WRITE_ABGR32(d, r, g, b, a) \
+	do                                        \
+	{                                         \
+		(d)[0] = (a);                         \
+		(d)[1] = (b);                         \
+		(d)[2] = (g);                         \
+		(d)[3] = (r);                         \
+	} while (0)
+
+#define PRIM_COPY_BYTES_XBGR32 4
+#define PRIM_COPY_READ_XBGR32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(a) = 0xFF;                          \
+		(b) = (s)[1];                        \
+		(g) = (s)[2];                        \
+		(r) = (s)[3];                        \
+	} while (0)
+#define PRIM_COPY_WRITE_XBGR32(d, r, g, b, a) \
+	do                                        \
+	{                                         \
+		(d)[0] = 0;                           \
+		(d)[1] = (b);                         \
+		(d)[2] = (g);                         \
+		(d)[3] = (r);                         \
+		WINPR_UNUSED(a);                      \
+	} while (0)
+
+#define PRIM_COPY_BYTES_RGBA32 4
+#define PRIM_COPY_READ_RGBA32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(r) = (s)[0];                        \
+		(g) = (s)[1];                        \
+		(b) = (s)[2];                        \
+		(a) = (s)[3];                        \
+	} while (0)
+#define PRIM_COPY_WRITE_RGBA32(d, r, g, b, a) \
+	do                                        \
+	{                                         \
+		(d)[0] = (r);                         \
+		(d)[1] = (g);                         \
+		(d)[2] = (b);                         \
+		(d)[3] = (a);                         \
+	} while (0)
+
+#define PRIM_COPY_BYTES_RGBX32 4
+#define PRIM_COPY_READ_RGBX32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(r) = (s)[0];                        \
+		(g) = (s)[1];                        \
+		(b) = (s)[2];                        \
+		(a) = 0xFF;                          \
+	} while (0)
+#define PRIM_COPY_WRITE_RGBX32 PRIM_COPY_WRITE_RGBA32
+
+#define PRIM_COPY_BYTES_BGRA32 4
+#define PRIM_COPY_READ_BGRA32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(b) = (s)[0];                        \
+		(g) = (s)[1];                        \
+		(r) = (s)[2];                        \
+		(a) = (s)[3];                        \
+	} while (0)
+#define PRIM_COPY_WRITE_BGRA32(d, r, g, b, a) \
+	do                                        \
+	{                                         \
+		(d)[0] = (b);                         \
+		(d)[1] = (g);                         \
+		(d)[2] = (r);                         \
+		(d)[3] = (a);                         \
+	} while (0)
+
+#define PRIM_COPY_BYTES_BGRX32 4
+#define PRIM_COPY_READ_BGRX32(s, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(b) = (s)[0];                        \
+		(g) = (s)[1];                        \
+		(r) = (s)[2];                        \
+		(a) = 0xFF;                          \
+	} while (0)
+#define PRIM_COPY_WRITE_BGRX32 PRIM_COPY_WRITE_BGRA32
+
+#define PRIM_COPY_BYTES_RGB24 3
+#define PRIM_COPY_READ_RGB24(s, r, g, b, a) \
+	do                                      \
+	{                                       \
+		(r) = (s)[0];                       \
+		(g) = (s)[1];                       \
+		(b) = (s)[2];                       \
+		(a) = 0xFF;                         \
+	} while (0)
+#define PRIM_COPY_WRITE_RGB24(d, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(d)[0] = (r);                        \
+		(d)[1] = (g);                        \
+		(d)[2] = (b);                        \
+		WINPR_UNUSED(a);                     \
+	} while (0)
+
+#define PRIM_COPY_BYTES_BGR24 3
+#define PRIM_COPY_READ_BGR24(s, r, g, b, a) \
+	do                                      \
+	{                                       \
+		(b) = (s)[0];                       \
+		(g) = (s)[1];                       \
+		(r) = (s)[2];                       \
+		(a) = 0xFF;                         \
+	} while (0)
+#define PRIM_COPY_WRITE_BGR24(d, r, g, b, a) \
+	do                                       \
+	{                                        \
+		(d)[0] = (b);                        \
+		(d)[1] = (g);                        \
+		(d)[2] = (r);                        \
+		WINPR_UNUSED(a);                     \
+	} while (0)
+
+#define PRIM_COPY_BYTES_RGB16 2
+#define PRIM_COPY_READ_RGB16(s, r, g, b, a)               \
+	do                                                    \
+	{                                                     \
+		const UINT32 c_ = ((UINT32)(s)[1] << 8) | (s)[0]; \
+		(r) = PRIM_COPY_EXPAND5(c_ >> 11);                \
+		(g) = PRIM_COPY_EXPAND6(c_ >> 5);                 \
+		(b) = PRIM_COPY_EXPAND5(c_);                      \
+		(a) = 0xFF;                                       \
+	} while (0)
+#define PRIM_COPY_WRITE_RGB16(d, r, g, b, a)                                   \
+	do                                                                         \
+	{                                                                          \
+		const UINT32 c_ = (((r) >> 3) << 11) | (((g) >> 2) << 5) | ((b) >> 3); \
+		(d)[0] = (BYTE)c_;                                                     \
+		(d)[1] = (BYTE)(c_ >> 8);                                              \
+		WINPR_UNUSED(a);                                                       \
+	} while (0)
+
+#define PRIM_COPY_BYTES_BGR16 2
+#define PRIM_COPY_READ_BGR16(s, r, g, b, a) PRIM_COPY_READ_RGB16(s, b, g, r, a)
+#define PRIM_COPY_WRITE_BGR16(d, r, g, b, a) PRIM_COPY_WRITE_RGB16(d, b, g, r, a)
+
+#define PRIM_COPY_BYTES_RGB15 2
+#define PRIM_COPY_READ_RGB15(s, r, g, b, a)               \
+	do                                                    \
+	{                                                     \
+		const UINT32 c_ = ((UINT32)(s)[1] << 8) | (s)[0]; \
+		(r) = PRIM_COPY_EXPAND5(c_ >> 10);                \
+		(g) = PRIM_COPY_EXPAND5(c_ >> 5);                 \
+		(b) = PRIM_COPY_EXPAND5(c_);                      \
+		(a) = 0xFF;                                       \
+	} while (0)
+#define PRIM_COPY_WRITE_RGB15(d, r, g, b, a)                                   \
+	do                                                                         \
+	{                                                                          \
+		const UINT32 c_ = (((r) >> 3) << 10) | (((g) >> 3) << 5) | ((b) >> 3); \
+		(d)[0] = (BYTE)c_;                                                     \
+		(d)[1] = (BYTE)(c_ >> 8);                                              \
+		WINPR_UNUSED(a);                                                       \
+	} while (0)
+
+#define PRIM_COPY_BYTES_BGR15 2
+#define PRIM_COPY_READ_BGR15(s, r, g, b, a) PRIM_COPY_READ_RGB15(s, b, g, r, a)
+#define PRIM_COPY_WRITE_BGR15(d, r, g, b, a) PRIM_COPY_WRITE_RGB15(d, b, g, r, a)
+
+/* All formats with a specialized converter, X(format) for the source and
+ * Y(format, src) for the destination. */
+#define PRIM_COPY_SRC_FORMATS(X) \
+	X(ARGB32)                    \
+	X(XRGB32)                    \
+	X(ABGR32)                    \
+	X(XBGR32)                    \
+	X(RGBA32)                    \
+	X(RGBX32)                    \
+	X(BGRA32)                    \
+	X(BGRX32)                    \
+	X(RGB24)                     \
+	X(BGR24)                     \
+	X(RGB16)                     \
+	X(BGR16)                     \
+	X(RGB15)                     \
+	X(BGR15)
+
+#define PRIM_COPY_DST_FORMATS(Y, src) \
+	Y(ARGB32, src)                    \
+	Y(XRGB32, src)                    \
+	Y(ABGR32, src)                    \
+	Y(XBGR32, src)                    \
+	Y(RGBA32, src)                    \
+	Y(RGBX32, src)                    \
+	Y(BGRA32, src)                    \
+	Y(BGRX32, src)                    \
+	Y(RGB24, src)                     \
+	Y(BGR24, src)                     \
+	Y(RGB16, src)                     \
+	Y(BGR16, src)                     \
+	Y(RGB15, src)                     \
+	Y(BGR15, src)
+
+#define PRIM_COPY_ROW(dst, src)                                                   \
+	static void generic_image_copy_row_##src##_##dst(                             \
+	    BYTE* WINPR_RESTRICT pDst, const BYTE* WINPR_RESTRICT pSrc, UINT32 width) \
+	{                                                                             \
+		for (UINT32 x = 0; x < width; x++)                                        \
+		{                                                                         \
+			BYTE r = 0;                                                           \
+			BYTE g = 0;                                                           \
+			BYTE b = 0;                                                           \
+			BYTE a = 0;                                                           \
+			PRIM_COPY_READ_##src(pSrc, r, g, b, a);                               \
+			PRIM_COPY_WRITE_##dst(pDst, r, g, b, a);                              \
+			pSrc += PRIM_COPY_BYTES_##src;                                        \
+			pDst += PRIM_COPY_BYTES_##dst;                                        \
+		}                                                                         \
+	}
+#define PRIM_COPY_ROWS(src) PRIM_COPY_DST_FORMATS(PRIM_COPY_ROW, src)
+
+PRIM_COPY_SRC_FORMATS(PRIM_COPY_ROWS)
+
+#define PRIM_COPY_DST_CASE(dst, src) \
+	case PIXEL_FORMAT_##dst:         \
+		return generic_image_copy_row_##src##_##dst;
+#define PRIM_COPY_SRC_CASE(src)                            \
+	case PIXEL_FORMAT_##src:                               \
+		switch (DstFormat)                                 \
+		{                                                  \
+			PRIM_COPY_DST_FORMATS(PRIM_COPY_DST_CASE, src) \
+			default:                                       \
+				return NULL;                               \
+		}
+
+generic_image_copy_row_t generic_image_copy_row_converter(DWORD SrcFormat, DWORD DstFormat)
+{
+	switch (SrcFormat)
+	{
+		PRIM_COPY_SRC_FORMATS(PRIM_COPY_SRC_CASE)
+		default:
+			return NULL;
+	}
+}
+
+/* Byte offsets of the channels of 24 and 32bpp formats, -1 if missing */
+typedef struct
+{
+	int r;
+	int g;
+	int b;
+	int a;     /* alpha channel that carries information */
+	int x;     /* padding byte written as 0xFF or alpha */
+	int zero;  /* padding byte written as 0 */
+} PRIM_COPY_LAYOUT;
+
+static BOOL generic_image_copy_layout(DWORD format, PRIM_COPY_LAYOUT* layout)
+{
+	const PRIM_COPY_LAYOUT none = { -1, -1, -1, -1, -1, -1 };
+
+	*layout = none;
+	switch (format)
+	{
+		case PIXEL_FORMAT_ARGB32:
+			layout->a = 0;
+			layout->r = 1;
+			layout->g = 2;
+			layout->b = 3;
+			return TRUE;
+		case PIXEL_FORMAT_XRGB32:
+			layout->zero = 0;
+			layout->r = 1;
+			layout->g = 2;
+			layout->b = 3;
+			return TRUE;
+		case PIXEL_FORMAT_ABGR32:
+			layout->a = 0;
+			layout->b = 1;
+			layout->g = 2;
+			layout->r = 3;
+			return TRUE;
+		case PIXEL_FORMAT_XBGR32:
+			layout->zero = 0;
+			layout->b = 1;
+			layout->g = 2;
+			layout->r = 3;
+			return TRUE;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			layout->r = 0;
+			layout->g = 1;
+			layout->b = 2;
+			if (format == PIXEL_FORMAT_RGBA32)
+				layout->a = 3;
+			else
+				layout->x = 3;
+			return TRUE;
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			layout->b = 0;
+			layout->g = 1;
+			layout->r = 2;
+			if (format == PIXEL_FORMAT_BGRA32)
+				layout->a = 3;
+			else
+				layout->x = 3;
+			return TRUE;
+		case PIXEL_FORMAT_RGB24:
+			layout->r = 0;
+			layout->g = 1;
+			layout->b = 2;
+			return TRUE;
+		case PIXEL_FORMAT_BGR24:
+			layout->b = 0;
+			layout->g = 1;
+			layout->r = 2;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+BOOL generic_image_copy_shuffle(DWORD SrcFormat, DWORD DstFormat,
+                                PRIM_COPY_SHUFFLE* WINPR_RESTRICT shuffle)
+{
+	PRIM_COPY_LAYOUT src = { 0 };
+	PRIM_COPY_LAYOUT dst = { 0 };
+
+	WINPR_ASSERT(shuffle);
+
+	if (!generic_image_copy_layout(SrcFormat, &src) || !generic_image_copy_layout(DstFormat, &dst))
+		return FALSE;
+
+	shuffle->srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	shuffle->dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	shuffle->tail = generic_image_copy_row_converter(SrcFormat, DstFormat);
+	if (!shuffle->tail)
+		return FALSE;
+
+	/* one entry per destination byte of 4 pixels, 0x80 selects 0 like pshufb */
+	memset(shuffle->index, 0x80, sizeof(shuffle->index));
+	memset(shuffle->fill, 0, sizeof(shuffle->fill));
+	for (UINT32 p = 0; p < 4; p++)
+	{
+		const UINT32 s = p * shuffle->srcByte;
+		const UINT32 d = p * shuffle->dstByte;
+
+		shuffle->index[d + (UINT32)dst.r] = (BYTE)(s + (UINT32)src.r);
+		shuffle->index[d + (UINT32)dst.g] = (BYTE)(s + (UINT32)src.g);
+		shuffle->index[d + (UINT32)dst.b] = (BYTE)(s + (UINT32)src.b);
+
+		const int alpha = (dst.a >= 0) ? dst.a : dst.x;
+		if (alpha < 0)
+			continue;
+
+		if (src.a >= 0)
+			shuffle->index[d + (UINT32)alpha] = (BYTE)(s + (UINT32)src.a);
+		else
+			shuffle->fill[d + (UINT32)alpha] = 0xFF;
+	}
+
+	return TRUE;
+}
+
 pstatus_t generic_image_copy_no_overlap_convert(
     BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
@@ -200,7 +614,22 @@ pstatus_t generic_image_copy_no_overlap_convert(
 {
 	const SSIZE_T srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
 	const SSIZE_T dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	const generic_image_copy_row_t row = generic_image_copy_row_converter(SrcFormat, DstFormat);
+
+	if (row)
+	{
+		for (SSIZE_T y = 0; y < nHeight; y++)
+		{
+			const BYTE* WINPR_RESTRICT srcLine =
+			    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+			BYTE* WINPR_RESTRICT dstLine =
+			    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+			row(&dstLine[nXDst * dstByte], &srcLine[nXSrc * srcByte], nWidth);
+		}
+		return PRIMITIVES_SUCCESS;
+	}
 
+	/* palette and exotic formats */
 	const UINT32 width = nWidth - nWidth % 8;
 	for (SSIZE_T y = 0; y < nHeight; y++)
 	{
@@ -385,4 +814,5 @@ void primitives_init_copy_opt(primitives_t* prims)
 #if defined(WITH_AVX2)
 	primitives_init_copy_avx2(prims);
 #endif
+	primitives_init_copy_neon(prims);
 }
@@ -25,6 +25,28 @@
 #include <freerdp/config.h>
 #include <freerdp/primitives.h>
 
+/* Convert width pixels of one row, specialized for a source and destination format */
+typedef void (*generic_image_copy_row_t)(BYTE* WINPR_RESTRICT pDst, const BYTE* WINPR_RESTRICT pSrc,
+                                         UINT32 width);
+
+/* Byte shuffle converting 4 pixels between two 24 or 32bpp formats. Every destination byte
+ * is src[index] (0 for index 0x80) ORed with fill, tail converts the remaining pixels. */
+typedef struct
+{
+	BYTE index[16];
+	BYTE fill[16];
+	UINT32 srcByte;
+	UINT32 dstByte;
+	generic_image_copy_row_t tail;
+} PRIM_COPY_SHUFFLE;
+
+/* Return the row converter for the format pair or NULL if there is none */
+generic_image_copy_row_t generic_image_copy_row_converter(DWORD SrcFormat, DWORD DstFormat);
+
+/* Set up the byte shuffle for the format pair, FALSE if it is not a pure byte permutation */
+BOOL generic_image_copy_shuffle(DWORD SrcFormat, DWORD DstFormat,
+                                PRIM_COPY_SHUFFLE* WINPR_RESTRICT shuffle);
+
 pstatus_t generic_image_copy_no_overlap_convert(
     BYTE* WINPR_RESTRICT pDstData, DWORD DstFormat, UINT32 nDstStep, UINT32 nXDst, UINT32 nYDst,
     UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pSrcData, DWORD SrcFormat,
@@ -39,6 +61,7 @@ pstatus_t generic_image_copy_no_overlap_memcpy(
     UINT32 flags);
 
 void primitives_init_copy_sse41(primitives_t* prims);
+void primitives_init_copy_neon(primitives_t* prims);
 
 #if defined(WITH_AVX2)
 void primitives_init_copy_avx2(primitives_t* prims);
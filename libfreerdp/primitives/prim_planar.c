@@ -0,0 +1,122 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Planar codec plane split, merge and delta encoding.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_planar.h"
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_RGBToPlanes_8u_AC4P4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                               UINT32 SrcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                               UINT32 dstStep,
+                                               const prim_size_t* WINPR_RESTRICT roi)
+{
+	size_t off[4] = { 0 };
+
+	if (!prim_planar_offsets(SrcFormat, off))
+		return -1;
+
+	const BOOL alpha = FreeRDPColorHasAlpha(SrcFormat);
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		const BYTE* src = &pSrc[1ULL * y * srcStep];
+		BYTE* r = &pDst[0][1ULL * y * dstStep];
+		BYTE* g = &pDst[1][1ULL * y * dstStep];
+		BYTE* b = &pDst[2][1ULL * y * dstStep];
+		BYTE* a = &pDst[3][1ULL * y * dstStep];
+
+		for (UINT32 x = 0; x < roi->width; x++)
+		{
+			*r++ = src[off[0]];
+			*g++ = src[off[1]];
+			*b++ = src[off[2]];
+			*a++ = alpha ? src[off[3]] : 0xFF;
+			src += 4;
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t general_PlanesToRGB_8u_P4AC4R(const BYTE* WINPR_RESTRICT pSrc[4], UINT32 srcStep,
+                                               BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                               UINT32 DstFormat,
+                                               const prim_size_t* WINPR_RESTRICT roi)
+{
+	size_t off[4] = { 0 };
+
+	if (!prim_planar_offsets(DstFormat, off))
+		return -1;
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		const BYTE* r = &pSrc[0][1ULL * y * srcStep];
+		const BYTE* g = &pSrc[1][1ULL * y * srcStep];
+		const BYTE* b = &pSrc[2][1ULL * y * srcStep];
+		const BYTE* a = pSrc[3] ? &pSrc[3][1ULL * y * srcStep] : NULL;
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		for (UINT32 x = 0; x < roi->width; x++)
+		{
+			dst[off[0]] = *r++;
+			dst[off[1]] = *g++;
+			dst[off[2]] = *b++;
+			dst[off[3]] = a ? *a++ : 0xFF;
+			dst += 4;
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ----------------------------------------------------------------------------
+ * The difference to the previous line as a signed byte d, stored as 2 * d if
+ * positive and 2 * |d| - 1 if negative.
+ */
+static pstatus_t general_deltaSignEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                            const BYTE* WINPR_RESTRICT pPrev,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 len)
+{
+	for (UINT32 x = 0; x < len; x++)
+	{
+		const INT8 delta = (INT8)(BYTE)(pSrc[x] - pPrev[x]);
+
+		if (delta >= 0)
+			pDst[x] = (BYTE)(delta << 1);
+		else
+			pDst[x] = (BYTE)(((UINT32)(BYTE)(-delta) << 1) - 1);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->RGBToPlanes_8u_AC4P4R = general_RGBToPlanes_8u_AC4P4R;
+	prims->PlanesToRGB_8u_P4AC4R = general_PlanesToRGB_8u_P4AC4R;
+	prims->deltaSignEncode_8u = general_deltaSignEncode_8u;
+}
+
+void primitives_init_planar_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_planar_sse2(prims);
+	primitives_init_planar_neon(prims);
+}
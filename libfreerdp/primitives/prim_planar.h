@@ -0,0 +1,68 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives planar
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_PLANAR_H
+#define FREERDP_LIB_PRIM_PLANAR_H
+
+#include <winpr/wtypes.h>
+#include <freerdp/config.h>
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+
+/* Byte offsets of R, G, B and A within a pixel of a 32bpp format.
+ * The alpha offset also denotes the padding byte of formats without alpha. */
+static INLINE BOOL prim_planar_offsets(UINT32 format, size_t offsets[4])
+{
+	switch (format)
+	{
+		case PIXEL_FORMAT_ARGB32:
+		case PIXEL_FORMAT_XRGB32:
+			offsets[0] = 1;
+			offsets[1] = 2;
+			offsets[2] = 3;
+			offsets[3] = 0;
+			return TRUE;
+		case PIXEL_FORMAT_ABGR32:
+		case PIXEL_FORMAT_XBGR32:
+			offsets[0] = 3;
+			offsets[1] = 2;
+			offsets[2] = 1;
+			offsets[3] = 0;
+			return TRUE;
+		case PIXEL_FORMAT_RGBA32:
+		case PIXEL_FORMAT_RGBX32:
+			offsets[0] = 0;
+			offsets[1] = 1;
+			offsets[2] = 2;
+			offsets[3] = 3;
+			return TRUE;
+		case PIXEL_FORMAT_BGRA32:
+		case PIXEL_FORMAT_BGRX32:
+			offsets[0] = 2;
+			offsets[1] = 1;
+			offsets[2] = 0;
+			offsets[3] = 3;
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+void primitives_init_planar_sse2(primitives_t* WINPR_RESTRICT prims);
+void primitives_init_planar_neon(primitives_t* WINPR_RESTRICT prims);
+
+#endif
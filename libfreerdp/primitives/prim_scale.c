@@ -0,0 +1,197 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Image scaling.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <stdlib.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_scale.h"
+
+/* Map destination pixel centers to the source grid in 16.16 fixed point and
+ * split the result into the left sample and a 7 bit weight of its right neighbour. */
+static void scale_map(UINT32 srcLen, UINT32 dstLen, UINT32 idx, UINT32* pos, UINT16* weight)
+{
+	const INT64 step = (INT64)(((UINT64)srcLen << 16) / dstLen);
+	INT64 p = idx * step + step / 2 - 0x8000;
+
+	if (p < 0)
+		p = 0;
+
+	*pos = (UINT32)(p >> 16);
+	*weight = (UINT16)((p >> (16 - PRIM_SCALE_WEIGHT_BITS)) & (PRIM_SCALE_WEIGHT_ONE - 1));
+
+	if (*pos >= srcLen - 1)
+	{
+		*pos = srcLen - 1;
+		*weight = 0;
+	}
+}
+
+static void general_scale_vrow(const BYTE* WINPR_RESTRICT s0, const BYTE* WINPR_RESTRICT s1,
+                               UINT16 wy, UINT16* WINPR_RESTRICT row, size_t len)
+{
+	const UINT16 w0 = PRIM_SCALE_WEIGHT_ONE - wy;
+
+	for (size_t i = 0; i < len; i++)
+		row[i] = (UINT16)(s0[i] * w0 + s1[i] * wy);
+}
+
+static void general_scale_hrow(const UINT16* WINPR_RESTRICT row, const UINT32* WINPR_RESTRICT xofs,
+                               const UINT16* WINPR_RESTRICT xw, BYTE* WINPR_RESTRICT dst,
+                               UINT32 width)
+{
+	for (UINT32 x = 0; x < width; x++)
+	{
+		const UINT16* p = &row[4ULL * xofs[x]];
+		const UINT32 w1 = xw[x];
+		const UINT32 w0 = PRIM_SCALE_WEIGHT_ONE - w1;
+
+		for (size_t c = 0; c < 4; c++)
+			*dst++ = (BYTE)((p[c] * w0 + p[c + 4] * w1 + 8192) >> 14);
+	}
+}
+
+/* Box filter, every destination pixel is the average of the source pixels it covers. */
+static pstatus_t scale_area(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                            const prim_size_t* WINPR_RESTRICT srcRoi, BYTE* WINPR_RESTRICT pDst,
+                            UINT32 dstStep, const prim_size_t* WINPR_RESTRICT dstRoi)
+{
+	for (UINT32 y = 0; y < dstRoi->height; y++)
+	{
+		const UINT32 ys = (UINT32)(1ULL * y * srcRoi->height / dstRoi->height);
+		UINT32 ye = (UINT32)(1ULL * (y + 1) * srcRoi->height / dstRoi->height);
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		if (ye <= ys)
+			ye = ys + 1;
+
+		for (UINT32 x = 0; x < dstRoi->width; x++)
+		{
+			const UINT32 xs = (UINT32)(1ULL * x * srcRoi->width / dstRoi->width);
+			UINT32 xe = (UINT32)(1ULL * (x + 1) * srcRoi->width / dstRoi->width);
+			UINT64 sum[4] = { 0 };
+
+			if (xe <= xs)
+				xe = xs + 1;
+
+			for (UINT32 sy = ys; sy < ye; sy++)
+			{
+				const BYTE* src = &pSrc[1ULL * sy * srcStep + 4ULL * xs];
+
+				for (UINT32 sx = xs; sx < xe; sx++)
+				{
+					sum[0] += *src++;
+					sum[1] += *src++;
+					sum[2] += *src++;
+					sum[3] += *src++;
+				}
+			}
+
+			const UINT64 count = 1ULL * (xe - xs) * (ye - ys);
+
+			for (size_t c = 0; c < 4; c++)
+				*dst++ = (BYTE)((sum[c] + count / 2) / count);
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+pstatus_t prim_scale_8u_AC4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                             const prim_size_t* WINPR_RESTRICT srcRoi, BYTE* WINPR_RESTRICT pDst,
+                             UINT32 dstStep, const prim_size_t* WINPR_RESTRICT dstRoi,
+                             prim_scale_vrow_t vrow, prim_scale_hrow_t hrow)
+{
+	pstatus_t status = -1;
+	UINT32 lastY = UINT32_MAX;
+	UINT16 lastW = 0;
+
+	if (!pSrc || !pDst || !srcRoi || !dstRoi)
+		return -1;
+
+	if ((srcRoi->width == 0) || (srcRoi->height == 0) || (dstRoi->width == 0) ||
+	    (dstRoi->height == 0))
+		return -1;
+
+	/* Shrinking by a factor of two or more, bilinear sampling would skip source pixels. */
+	if ((dstRoi->width <= srcRoi->width) && (dstRoi->height <= srcRoi->height) &&
+	    ((dstRoi->width * 2ULL <= srcRoi->width) || (dstRoi->height * 2ULL <= srcRoi->height)))
+		return scale_area(pSrc, srcStep, srcRoi, pDst, dstStep, dstRoi);
+
+	/* One spare pixel at the end so the right neighbour of the last sample is valid */
+	const size_t rowLen = 4ULL * srcRoi->width;
+	UINT16* row = calloc(rowLen + 4, sizeof(UINT16));
+	UINT32* xofs = calloc(dstRoi->width, sizeof(UINT32));
+	UINT16* xw = calloc(dstRoi->width, sizeof(UINT16));
+
+	if (!row || !xofs || !xw)
+		goto fail;
+
+	for (UINT32 x = 0; x < dstRoi->width; x++)
+		scale_map(srcRoi->width, dstRoi->width, x, &xofs[x], &xw[x]);
+
+	for (UINT32 y = 0; y < dstRoi->height; y++)
+	{
+		UINT32 y0 = 0;
+		UINT16 wy = 0;
+		scale_map(srcRoi->height, dstRoi->height, y, &y0, &wy);
+
+		/* Upscaling maps several destination lines to the same blend, reuse it. */
+		if ((y0 != lastY) || (wy != lastW))
+		{
+			const UINT32 y1 = (y0 + 1 < srcRoi->height) ? y0 + 1 : y0;
+			vrow(&pSrc[1ULL * y0 * srcStep], &pSrc[1ULL * y1 * srcStep], wy, row, rowLen);
+
+			for (size_t c = 0; c < 4; c++)
+				row[rowLen + c] = row[rowLen - 4 + c];
+
+			lastY = y0;
+			lastW = wy;
+		}
+
+		hrow(row, xofs, xw, &pDst[1ULL * y * dstStep], dstRoi->width);
+	}
+
+	status = PRIMITIVES_SUCCESS;
+fail:
+	free(row);
+	free(xofs);
+	free(xw);
+	return status;
+}
+
+static pstatus_t general_scale_8u_AC4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                       const prim_size_t* WINPR_RESTRICT srcRoi,
+                                       BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                       const prim_size_t* WINPR_RESTRICT dstRoi)
+{
+	return prim_scale_8u_AC4R(pSrc, srcStep, srcRoi, pDst, dstStep, dstRoi, general_scale_vrow,
+	                          general_scale_hrow);
+}
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale(primitives_t* WINPR_RESTRICT prims)
+{
+	prims->scale_8u_AC4R = general_scale_8u_AC4R;
+}
+
+void primitives_init_scale_opt(primitives_t* WINPR_RESTRICT prims)
+{
+	primitives_init_scale_sse2(prims);
+	primitives_init_scale_neon(prims);
+}
@@ -0,0 +1,50 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Primitives scale
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_LIB_PRIM_SCALE_H
+#define FREERDP_LIB_PRIM_SCALE_H
+
+#include <winpr/wtypes.h>
+#include <freerdp/config.h>
+#include <freerdp/api.h>
+#include <freerdp/primitives.h>
+
+/* Bilinear weights are 7 bit fixed point, the intermediate row holds
+ * src0 * (128 - wy) + src1 * wy per channel. */
+#define PRIM_SCALE_WEIGHT_BITS 7
+#define PRIM_SCALE_WEIGHT_ONE (1 << PRIM_SCALE_WEIGHT_BITS)
+
+/* Blend two source lines into the intermediate row, len is in bytes. */
+typedef void (*prim_scale_vrow_t)(const BYTE* WINPR_RESTRICT s0, const BYTE* WINPR_RESTRICT s1,
+                                  UINT16 wy, UINT16* WINPR_RESTRICT row, size_t len);
+
+/* Blend neighbouring pixels of the intermediate row into a destination line. */
+typedef void (*prim_scale_hrow_t)(const UINT16* WINPR_RESTRICT row,
+                                  const UINT32* WINPR_RESTRICT xofs,
+                                  const UINT16* WINPR_RESTRICT xw, BYTE* WINPR_RESTRICT dst,
+                                  UINT32 width);
+
+FREERDP_LOCAL pstatus_t prim_scale_8u_AC4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                           const prim_size_t* WINPR_RESTRICT srcRoi,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                           const prim_size_t* WINPR_RESTRICT dstRoi,
+                                           prim_scale_vrow_t vrow, prim_scale_hrow_t hrow);
+
+void primitives_init_scale_sse2(primitives_t* WINPR_RESTRICT prims);
+void primitives_init_scale_neon(primitives_t* WINPR_RESTRICT prims);
+
+#endif
@@ -0,0 +1,424 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * Optimized YUV/RGB conversion operations using AVX2
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/wtypes.h>
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+#include <winpr/crt.h>
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+
+#include "prim_internal.h"
+#include "prim_YUV.h"
+
+#if defined(SSE2_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/****************************************************************************/
+/* AVX2 YUV -> RGB conversion                                               */
+/****************************************************************************/
+
+/* Two signed 16 bit factors for madd on interleaved (U - 128, V - 128) pairs */
+#define UV_FACTORS(_u, _v) _mm256_set1_epi32((INT32)(((UINT32)(UINT16)(_v) << 16) | (UINT16)(_u)))
+
+/**
+ * Convert 8 pixels given by the low 8 bytes of Yraw, Uraw and Vraw to BGRX.
+ * The alpha channel of the destination is not touched.
+ * The arithmetic is exact, the result matches YUV2R, YUV2G and YUV2B.
+ */
+static INLINE void avx2_YUV444Pixel(BYTE* WINPR_RESTRICT dst, __m128i Yraw, __m128i Uraw,
+                                    __m128i Vraw)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i max = _mm256_set1_epi32(0xFF);
+	const __m256i alpha = _mm256_set1_epi32((INT32)0xFF000000);
+	const __m256i c128 = _mm256_set1_epi16(128);
+	const __m256i C = _mm256_slli_epi32(_mm256_cvtepu8_epi32(Yraw), 8);
+	const __m256i DE = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(Uraw, Vraw)), c128);
+
+	__m256i R = _mm256_add_epi32(C, _mm256_madd_epi16(DE, UV_FACTORS(0, 403)));
+	__m256i G = _mm256_add_epi32(C, _mm256_madd_epi16(DE, UV_FACTORS(-48, -120)));
+	__m256i B = _mm256_add_epi32(C, _mm256_madd_epi16(DE, UV_FACTORS(475, 0)));
+	R = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(R, 8), zero), max);
+	G = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(G, 8), zero), max);
+	B = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(B, 8), zero), max);
+
+	__m256i BGRX = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)dst), alpha);
+	BGRX = _mm256_or_si256(BGRX, B);
+	BGRX = _mm256_or_si256(BGRX, _mm256_slli_epi32(G, 8));
+	BGRX = _mm256_or_si256(BGRX, _mm256_slli_epi32(R, 16));
+	_mm256_storeu_si256((__m256i*)dst, BGRX);
+}
+
+static pstatus_t avx2_YUV420ToRGB_BGRX(const BYTE* WINPR_RESTRICT pSrc[],
+                                       const UINT32* WINPR_RESTRICT srcStep,
+                                       BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                       const prim_size_t* WINPR_RESTRICT roi)
+{
+	const UINT32 nWidth = roi->width;
+	const UINT32 nHeight = roi->height;
+	const UINT32 pad = roi->width % 16;
+
+	for (size_t y = 0; y < nHeight; y++)
+	{
+		BYTE* dst = pDst + dstStep * y;
+		const BYTE* YData = pSrc[0] + y * srcStep[0];
+		const BYTE* UData = pSrc[1] + (y / 2) * srcStep[1];
+		const BYTE* VData = pSrc[2] + (y / 2) * srcStep[2];
+
+		for (UINT32 x = 0; x < nWidth - pad; x += 16)
+		{
+			const __m128i Y = _mm_loadu_si128((const __m128i*)YData);
+			const __m128i uRaw = _mm_loadl_epi64((const __m128i*)UData);
+			const __m128i vRaw = _mm_loadl_epi64((const __m128i*)VData);
+			const __m128i U = _mm_unpacklo_epi8(uRaw, uRaw);
+			const __m128i V = _mm_unpacklo_epi8(vRaw, vRaw);
+			YData += 16;
+			UData += 8;
+			VData += 8;
+			avx2_YUV444Pixel(dst, Y, U, V);
+			avx2_YUV444Pixel(dst + 32, _mm_srli_si128(Y, 8), _mm_srli_si128(U, 8),
+			                 _mm_srli_si128(V, 8));
+			dst += 64;
+		}
+
+		for (UINT32 x = 0; x < pad; x++)
+		{
+			const BYTE Y = *YData++;
+			const BYTE U = *UData;
+			const BYTE V = *VData;
+			const BYTE r = YUV2R(Y, U, V);
+			const BYTE g = YUV2G(Y, U, V);
+			const BYTE b = YUV2B(Y, U, V);
+			dst = writePixelBGRX(dst, 4, PIXEL_FORMAT_BGRX32, r, g, b, 0);
+
+			if (x % 2)
+			{
+				UData++;
+				VData++;
+			}
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_YUV420ToRGB(const BYTE* WINPR_RESTRICT pSrc[3], const UINT32 srcStep[3],
+                                  BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 DstFormat,
+                                  const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_YUV420ToRGB_BGRX(pSrc, srcStep, pDst, dstStep, roi);
+
+		default:
+			return generic->YUV420ToRGB_8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+	}
+}
+
+static pstatus_t avx2_YUV444ToRGB_8u_P3AC4R_BGRX(const BYTE* WINPR_RESTRICT pSrc[],
+                                                 const UINT32 srcStep[], BYTE* WINPR_RESTRICT pDst,
+                                                 UINT32 dstStep,
+                                                 const prim_size_t* WINPR_RESTRICT roi)
+{
+	const UINT32 nWidth = roi->width;
+	const UINT32 nHeight = roi->height;
+	const UINT32 pad = roi->width % 16;
+
+	for (size_t y = 0; y < nHeight; y++)
+	{
+		BYTE* dst = pDst + dstStep * y;
+		const BYTE* YData = pSrc[0] + y * srcStep[0];
+		const BYTE* UData = pSrc[1] + y * srcStep[1];
+		const BYTE* VData = pSrc[2] + y * srcStep[2];
+
+		for (size_t x = 0; x < nWidth - pad; x += 16)
+		{
+			const __m128i Y = _mm_loadu_si128((const __m128i*)YData);
+			const __m128i U = _mm_loadu_si128((const __m128i*)UData);
+			const __m128i V = _mm_loadu_si128((const __m128i*)VData);
+			YData += 16;
+			UData += 16;
+			VData += 16;
+			avx2_YUV444Pixel(dst, Y, U, V);
+			avx2_YUV444Pixel(dst + 32, _mm_srli_si128(Y, 8), _mm_srli_si128(U, 8),
+			                 _mm_srli_si128(V, 8));
+			dst += 64;
+		}
+
+		for (size_t x = 0; x < pad; x++)
+		{
+			const BYTE Y = *YData++;
+			const BYTE U = *UData++;
+			const BYTE V = *VData++;
+			const BYTE r = YUV2R(Y, U, V);
+			const BYTE g = YUV2G(Y, U, V);
+			const BYTE b = YUV2B(Y, U, V);
+			dst = writePixelBGRX(dst, 4, PIXEL_FORMAT_BGRX32, r, g, b, 0);
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_YUV444ToRGB_8u_P3AC4R(const BYTE* WINPR_RESTRICT pSrc[],
+                                            const UINT32 srcStep[], BYTE* WINPR_RESTRICT pDst,
+                                            UINT32 dstStep, UINT32 DstFormat,
+                                            const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (DstFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_YUV444ToRGB_8u_P3AC4R_BGRX(pSrc, srcStep, pDst, dstStep, roi);
+
+		default:
+			return generic->YUV444ToRGB_8u_P3AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+	}
+}
+
+/****************************************************************************/
+/* AVX2 RGB -> YUV420 conversion                                           **/
+/****************************************************************************/
+
+/**
+ * Same factors and rounding as the SSSE3 implementation, see the note on
+ * [Rec. ITU-R BT.709-6] in prim_YUV_ssse3.c. The scalar helpers below are used
+ * for the pixels not covered by a full vector and give identical results.
+ */
+
+#define BGRX_Y_FACTORS _mm256_set1_epi32(0x001B5C09)             /* 0, 27, 92, 9 */
+#define BGRX_U_FACTORS _mm256_set1_epi32((INT32)0x00E39D7F)      /* 0, -29, -99, 127 */
+#define BGRX_V_FACTORS _mm256_set1_epi32((INT32)0x007F8CF4)      /* 0, 127, -116, -12 */
+#define CONST128_FACTORS _mm256_set1_epi8(-128)
+
+#define Y_SHIFT 7
+#define U_SHIFT 8
+#define V_SHIFT 8
+
+static INLINE BYTE avx2_RGB2Y(INT32 R, INT32 G, INT32 B)
+{
+	return (BYTE)((27 * R + 92 * G + 9 * B) >> Y_SHIFT);
+}
+
+static INLINE BYTE avx2_RGB2U(INT32 R, INT32 G, INT32 B)
+{
+	return (BYTE)(((-29 * R - 99 * G + 127 * B) >> U_SHIFT) + 128);
+}
+
+static INLINE BYTE avx2_RGB2V(INT32 R, INT32 G, INT32 B)
+{
+	return (BYTE)(((127 * R - 116 * G - 12 * B) >> V_SHIFT) + 128);
+}
+
+/* compute the luma (Y) component from a single rgb source line */
+
+static INLINE void avx2_RGBToYUV420_BGRX_Y(const BYTE* WINPR_RESTRICT src, BYTE* dst, UINT32 width)
+{
+	const __m256i y_factors = BGRX_Y_FACTORS;
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+	const UINT32 pad = width % 32;
+	UINT32 x = 0;
+
+	for (; x < width - pad; x += 32)
+	{
+		/* store 32 rgba pixels in 4 256 bit registers */
+		__m256i x0 = _mm256_loadu_si256((const __m256i*)&src[4ULL * x]);
+		__m256i x1 = _mm256_loadu_si256((const __m256i*)&src[4ULL * x + 32]);
+		__m256i x2 = _mm256_loadu_si256((const __m256i*)&src[4ULL * x + 64]);
+		__m256i x3 = _mm256_loadu_si256((const __m256i*)&src[4ULL * x + 96]);
+		/* multiplications and subtotals */
+		x0 = _mm256_maddubs_epi16(x0, y_factors);
+		x1 = _mm256_maddubs_epi16(x1, y_factors);
+		x2 = _mm256_maddubs_epi16(x2, y_factors);
+		x3 = _mm256_maddubs_epi16(x3, y_factors);
+		/* the total sums */
+		x0 = _mm256_hadd_epi16(x0, x1);
+		x2 = _mm256_hadd_epi16(x2, x3);
+		/* shift the results */
+		x0 = _mm256_srli_epi16(x0, Y_SHIFT);
+		x2 = _mm256_srli_epi16(x2, Y_SHIFT);
+		/* pack the 32 words into bytes, the lanes hold groups of 4 pixels out of order */
+		x0 = _mm256_packus_epi16(x0, x2);
+		x0 = _mm256_permutevar8x32_epi32(x0, order);
+		/* save to y plane */
+		_mm256_storeu_si256((__m256i*)&dst[x], x0);
+	}
+
+	for (; x < width; x++)
+	{
+		const BYTE* rgb = &src[4ULL * x];
+		dst[x] = avx2_RGB2Y(rgb[2], rgb[1], rgb[0]);
+	}
+}
+
+/* compute the chrominance (UV) components from two rgb source lines */
+
+static INLINE void avx2_RGBToYUV420_BGRX_UV(const BYTE* WINPR_RESTRICT src1,
+                                            const BYTE* WINPR_RESTRICT src2,
+                                            BYTE* WINPR_RESTRICT dst1, BYTE* WINPR_RESTRICT dst2,
+                                            UINT32 width)
+{
+	const __m256i u_factors = BGRX_U_FACTORS;
+	const __m256i v_factors = BGRX_V_FACTORS;
+	const __m256i vector128 = CONST128_FACTORS;
+	const __m256i interleave = _mm256_setr_epi8(0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14,
+	                                            15, 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7,
+	                                            14, 15);
+	const UINT32 pad = width % 32;
+	UINT32 x = 0;
+
+	for (; x < width - pad; x += 32)
+	{
+		const __m256i* rgb1 = (const __m256i*)&src1[4ULL * x];
+		const __m256i* rgb2 = (const __m256i*)&src2[4ULL * x];
+
+		/* subsample 32x2 pixels into 32x1 pixels */
+		__m256i x0 = _mm256_avg_epu8(_mm256_loadu_si256(rgb1), _mm256_loadu_si256(rgb2));
+		__m256i x1 = _mm256_avg_epu8(_mm256_loadu_si256(rgb1 + 1), _mm256_loadu_si256(rgb2 + 1));
+		__m256i x2 = _mm256_avg_epu8(_mm256_loadu_si256(rgb1 + 2), _mm256_loadu_si256(rgb2 + 2));
+		__m256i x3 = _mm256_avg_epu8(_mm256_loadu_si256(rgb1 + 3), _mm256_loadu_si256(rgb2 + 3));
+		/* subsample these 32x1 pixels into 16x1 pixels */
+		__m256i x4 = _mm256_castps_si256(
+		    _mm256_shuffle_ps(_mm256_castsi256_ps(x0), _mm256_castsi256_ps(x1), 0x88));
+		x0 = _mm256_castps_si256(
+		    _mm256_shuffle_ps(_mm256_castsi256_ps(x0), _mm256_castsi256_ps(x1), 0xdd));
+		x0 = _mm256_avg_epu8(x0, x4);
+		x4 = _mm256_castps_si256(
+		    _mm256_shuffle_ps(_mm256_castsi256_ps(x2), _mm256_castsi256_ps(x3), 0x88));
+		x1 = _mm256_castps_si256(
+		    _mm256_shuffle_ps(_mm256_castsi256_ps(x2), _mm256_castsi256_ps(x3), 0xdd));
+		x1 = _mm256_avg_epu8(x1, x4);
+		/* multiplications and subtotals */
+		x2 = _mm256_maddubs_epi16(x0, u_factors);
+		x3 = _mm256_maddubs_epi16(x1, u_factors);
+		x4 = _mm256_maddubs_epi16(x0, v_factors);
+		__m256i x5 = _mm256_maddubs_epi16(x1, v_factors);
+		/* the total sums */
+		x0 = _mm256_hadd_epi16(x2, x3);
+		x1 = _mm256_hadd_epi16(x4, x5);
+		/* shift the results */
+		x0 = _mm256_srai_epi16(x0, U_SHIFT);
+		x1 = _mm256_srai_epi16(x1, V_SHIFT);
+		/* pack the words into bytes, restore the pixel order: U to the low, V to the high lane */
+		x0 = _mm256_packs_epi16(x0, x1);
+		x0 = _mm256_permute4x64_epi64(x0, 0xD8);
+		x0 = _mm256_shuffle_epi8(x0, interleave);
+		/* add 128 */
+		x0 = _mm256_sub_epi8(x0, vector128);
+		_mm_storeu_si128((__m128i*)&dst1[x / 2], _mm256_castsi256_si128(x0));
+		_mm_storeu_si128((__m128i*)&dst2[x / 2], _mm256_extracti128_si256(x0, 1));
+	}
+
+	for (; x < width; x += 2)
+	{
+		const BYTE* a = &src1[4ULL * x];
+		const BYTE* b = &src2[4ULL * x];
+		INT32 avg[3] = { 0 };
+
+		for (size_t c = 0; c < 3; c++)
+		{
+			const INT32 p0 = (a[c] + b[c] + 1) >> 1;
+			const INT32 p1 = (a[c + 4] + b[c + 4] + 1) >> 1;
+			avg[c] = (p0 + p1 + 1) >> 1;
+		}
+
+		dst1[x / 2] = avx2_RGB2U(avg[2], avg[1], avg[0]);
+		dst2[x / 2] = avx2_RGB2V(avg[2], avg[1], avg[0]);
+	}
+}
+
+static pstatus_t avx2_RGBToYUV420_BGRX(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                       UINT32 srcStep, BYTE* WINPR_RESTRICT pDst[],
+                                       const UINT32 dstStep[], const prim_size_t* WINPR_RESTRICT roi)
+{
+	const BYTE* argb = pSrc;
+	BYTE* ydst = pDst[0];
+	BYTE* udst = pDst[1];
+	BYTE* vdst = pDst[2];
+
+	if (roi->height < 1 || roi->width < 1)
+	{
+		return !PRIMITIVES_SUCCESS;
+	}
+
+	if (roi->width % 2)
+	{
+		return generic->RGBToYUV420_8u_P3AC4R(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+	}
+
+	for (UINT32 y = 0; y < roi->height - 1; y += 2)
+	{
+		const BYTE* line1 = argb;
+		const BYTE* line2 = argb + srcStep;
+		avx2_RGBToYUV420_BGRX_UV(line1, line2, udst, vdst, roi->width);
+		avx2_RGBToYUV420_BGRX_Y(line1, ydst, roi->width);
+		avx2_RGBToYUV420_BGRX_Y(line2, ydst + dstStep[0], roi->width);
+		argb += 2ULL * srcStep;
+		ydst += 2ULL * dstStep[0];
+		udst += 1ULL * dstStep[1];
+		vdst += 1ULL * dstStep[2];
+	}
+
+	if (roi->height & 1)
+	{
+		/* pass the same last line of an odd height twice for UV */
+		avx2_RGBToYUV420_BGRX_UV(argb, argb, udst, vdst, roi->width);
+		avx2_RGBToYUV420_BGRX_Y(argb, ydst, roi->width);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+static pstatus_t avx2_RGBToYUV420(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcFormat,
+                                  UINT32 srcStep, BYTE* WINPR_RESTRICT pDst[],
+                                  const UINT32 dstStep[], const prim_size_t* WINPR_RESTRICT roi)
+{
+	switch (srcFormat)
+	{
+		case PIXEL_FORMAT_BGRX32:
+		case PIXEL_FORMAT_BGRA32:
+			return avx2_RGBToYUV420_BGRX(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+
+		default:
+			return generic->RGBToYUV420_8u_P3AC4R(pSrc, srcFormat, srcStep, pDst, dstStep, roi);
+	}
+}
+#endif
+
+void primitives_init_YUV_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE2_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+		prims->RGBToYUV420_8u_P3AC4R = avx2_RGBToYUV420;
+		prims->YUV420ToRGB_8u_P3AC4R = avx2_YUV420ToRGB;
+		prims->YUV444ToRGB_8u_P3AC4R = avx2_YUV444ToRGB_8u_P3AC4R;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SSE2");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,140 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized alpha blending routines.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_alphaComp.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE2_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Blend the 16bit channels of 4 pixels, same arithmetic as the SSE2 version */
+static INLINE __m256i avx2_alphaComp_blend(__m256i s1, __m256i s2)
+{
+	const __m256i one = _mm256_set1_epi16(1);
+	__m256i alpha = _mm256_shufflelo_epi16(s1, 0xff);
+	alpha = _mm256_shufflehi_epi16(alpha, 0xff);
+	alpha = _mm256_adds_epi16(alpha, one);
+	__m256i d = _mm256_mullo_epi16(_mm256_subs_epi16(s1, s2), alpha);
+	d = _mm256_srai_epi16(d, 8);
+	d = _mm256_adds_epi16(d, s2);
+	return _mm256_and_si256(d, _mm256_set1_epi16(0x00ff));
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_alphaComp_argb(const BYTE* WINPR_RESTRICT pSrc1, UINT32 src1Step,
+                                     const BYTE* WINPR_RESTRICT pSrc2, UINT32 src2Step,
+                                     BYTE* WINPR_RESTRICT pDst, UINT32 dstStep, UINT32 width,
+                                     UINT32 height)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	if (width < 8) /* pointless if too small */
+		return generic->alphaComp_argb(pSrc1, src1Step, pSrc2, src2Step, pDst, dstStep, width,
+		                               height);
+
+	for (size_t y = 0; y < height; y++)
+	{
+		const BYTE* sptr1 = &pSrc1[y * src1Step];
+		const BYTE* sptr2 = &pSrc2[y * src2Step];
+		BYTE* dptr = &pDst[y * dstStep];
+		UINT32 x = 0;
+
+		/* 8 pixels per round, unpack and pack both work per 128bit lane */
+		for (; x + 8 <= width; x += 8)
+		{
+			const __m256i s1 = _mm256_loadu_si256((const __m256i*)&sptr1[4ULL * x]);
+			const __m256i s2 = _mm256_loadu_si256((const __m256i*)&sptr2[4ULL * x]);
+			const __m256i lo = avx2_alphaComp_blend(_mm256_unpacklo_epi8(s1, zero),
+			                                        _mm256_unpacklo_epi8(s2, zero));
+			const __m256i hi = avx2_alphaComp_blend(_mm256_unpackhi_epi8(s1, zero),
+			                                        _mm256_unpackhi_epi8(s2, zero));
+			_mm256_storeu_si256((__m256i*)&dptr[4ULL * x], _mm256_packus_epi16(lo, hi));
+		}
+
+		if (x < width)
+		{
+			const pstatus_t status =
+			    generic->alphaComp_argb(&sptr1[4ULL * x], src1Step, &sptr2[4ULL * x], src2Step,
+			                            &dptr[4ULL * x], dstStep, width - x, 1);
+			if (status != PRIMITIVES_SUCCESS)
+				return status;
+		}
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_applyAlpha_8u_P1AC4R(const BYTE* WINPR_RESTRICT pAlpha, UINT32 alphaStep,
+                                           BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                           UINT32 DstFormat, const prim_size_t* WINPR_RESTRICT roi)
+{
+	const int offset = alphaComp_alpha_offset(DstFormat);
+
+	if (offset < 0)
+		return -1;
+
+	const int shift = offset * 8;
+	const __m128i count = _mm_cvtsi32_si128(shift);
+	const __m256i mask = _mm256_set1_epi32((int)~(0xFFU << shift));
+
+	for (size_t y = 0; y < roi->height; y++)
+	{
+		const BYTE* alpha = &pAlpha[y * alphaStep];
+		BYTE* dst = &pDst[y * dstStep];
+		UINT32 x = 0;
+
+		for (; x + 8 <= roi->width; x += 8)
+		{
+			__m256i* dptr = (__m256i*)&dst[4ULL * x];
+			const __m256i a =
+			    _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&alpha[x]));
+			const __m256i d = _mm256_and_si256(_mm256_loadu_si256(dptr), mask);
+			_mm256_storeu_si256(dptr, _mm256_or_si256(d, _mm256_sll_epi32(a, count)));
+		}
+
+		for (; x < roi->width; x++)
+			dst[4ULL * x + (size_t)offset] = alpha[x];
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_alphaComp_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE2_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+		prims->alphaComp_argb = avx2_alphaComp_argb;
+		prims->applyAlpha_8u_P1AC4R = avx2_applyAlpha_8u_P1AC4R;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SSE2");
+	WINPR_UNUSED(prims);
+#endif
+}
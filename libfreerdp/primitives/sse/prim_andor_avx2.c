@@ -0,0 +1,73 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized Logical operations.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_andor.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE2_ENABLED)
+#include <immintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t avx2_xorC_32u(const UINT32* WINPR_RESTRICT pSrc, UINT32 val,
+                               UINT32* WINPR_RESTRICT pDst, INT32 len)
+{
+	const __m256i mask = _mm256_set1_epi32((int)val);
+
+	/* 4 256-bit registers, 32 values per round */
+	while (len >= 32)
+	{
+		const __m256i* sptr = (const __m256i*)pSrc;
+		__m256i* dptr = (__m256i*)pDst;
+		const __m256i ymm0 = _mm256_xor_si256(_mm256_loadu_si256(&sptr[0]), mask);
+		const __m256i ymm1 = _mm256_xor_si256(_mm256_loadu_si256(&sptr[1]), mask);
+		const __m256i ymm2 = _mm256_xor_si256(_mm256_loadu_si256(&sptr[2]), mask);
+		const __m256i ymm3 = _mm256_xor_si256(_mm256_loadu_si256(&sptr[3]), mask);
+		_mm256_storeu_si256(&dptr[0], ymm0);
+		_mm256_storeu_si256(&dptr[1], ymm1);
+		_mm256_storeu_si256(&dptr[2], ymm2);
+		_mm256_storeu_si256(&dptr[3], ymm3);
+		pSrc += 32;
+		pDst += 32;
+		len -= 32;
+	}
+
+	return generic->xorC_32u(pSrc, val, pDst, len);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_andor_avx2(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE2_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "AVX2 optimizations");
+		prims->xorC_32u = avx2_xorC_32u;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SSE2");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -34,6 +34,8 @@ static primitives_t* generic = NULL;
 SSE3_SCD_PRE_ROUTINE(sse3_andC_32u, UINT32, generic->andC_32u, _mm_and_si128,
                      *dptr++ = *sptr++ & val)
 SSE3_SCD_PRE_ROUTINE(sse3_orC_32u, UINT32, generic->orC_32u, _mm_or_si128, *dptr++ = *sptr++ | val)
+SSE3_SCD_PRE_ROUTINE(sse3_xorC_32u, UINT32, generic->xorC_32u, _mm_xor_si128,
+                     *dptr++ = *sptr++ ^ val)
 
 #endif
 
@@ -50,6 +52,7 @@ void primitives_init_andor_sse3(primitives_t* WINPR_RESTRICT prims)
 		WLog_VRB(PRIM_TAG, "SSE2/SSE3 optimizations");
 		prims->andC_32u = sse3_andC_32u;
 		prims->orC_32u = sse3_orC_32u;
+		prims->xorC_32u = sse3_xorC_32u;
 	}
 
 #else
@@ -0,0 +1,83 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized audio channel mixing.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_audio.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE2_ENABLED)
+#include <emmintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse2_monoToStereo_16s(const INT16* WINPR_RESTRICT pSrc,
+                                       INT16* WINPR_RESTRICT pDst, UINT32 frames)
+{
+	UINT32 x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const __m128i mono = _mm_loadu_si128((const __m128i*)&pSrc[x]);
+		_mm_storeu_si128((__m128i*)&pDst[2 * x], _mm_unpacklo_epi16(mono, mono));
+		_mm_storeu_si128((__m128i*)&pDst[2 * x + 8], _mm_unpackhi_epi16(mono, mono));
+	}
+
+	return generic->monoToStereo_16s(&pSrc[x], &pDst[2 * x], frames - x);
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse2_stereoToMono_16s(const INT16* WINPR_RESTRICT pSrc,
+                                       INT16* WINPR_RESTRICT pDst, UINT32 frames)
+{
+	const __m128i one = _mm_set1_epi16(1);
+	UINT32 x = 0;
+
+	for (; x + 8 <= frames; x += 8)
+	{
+		const __m128i lo = _mm_loadu_si128((const __m128i*)&pSrc[2 * x]);
+		const __m128i hi = _mm_loadu_si128((const __m128i*)&pSrc[2 * x + 8]);
+		/* left + right of each frame as 32bit sums */
+		const __m128i sumLo = _mm_srai_epi32(_mm_madd_epi16(lo, one), 1);
+		const __m128i sumHi = _mm_srai_epi32(_mm_madd_epi16(hi, one), 1);
+		_mm_storeu_si128((__m128i*)&pDst[x], _mm_packs_epi32(sumLo, sumHi));
+	}
+
+	return generic->stereoToMono_16s(&pSrc[2 * x], &pDst[x], frames - x);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_audio_sse2(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE2_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "SSE2 optimizations");
+		prims->monoToStereo_16s = sse2_monoToStereo_16s;
+		prims->stereoToMono_16s = sse2_stereoToMono_16s;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SSE2");
+	WINPR_UNUSED(prims);
+#endif
+}
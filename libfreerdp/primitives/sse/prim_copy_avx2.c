@@ -187,31 +187,45 @@ pstatus_t avx2_image_copy_no_overlap_convert(
     UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
     SSIZE_T srcVMultiplier, SSIZE_T srcVOffset, SSIZE_T dstVMultiplier, SSIZE_T dstVOffset)
 {
-	const SSIZE_T srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
-	const SSIZE_T dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	PRIM_COPY_SHUFFLE shuffle = { 0 };
+
+	if (!generic_image_copy_shuffle(SrcFormat, DstFormat, &shuffle))
+		return generic_image_copy_no_overlap_convert(
+		    pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData, SrcFormat,
+		    nSrcStep, nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset, dstVMultiplier,
+		    dstVOffset);
+
+	const size_t srcByte = shuffle.srcByte;
+	const size_t dstByte = shuffle.dstByte;
+	const __m256i index =
+	    _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)shuffle.index));
+	const __m256i fill = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)shuffle.fill));
 
-	const UINT32 width = nWidth - nWidth % 8;
 	for (SSIZE_T y = 0; y < nHeight; y++)
 	{
 		const BYTE* WINPR_RESTRICT srcLine =
-		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset + nXSrc * srcByte];
 		BYTE* WINPR_RESTRICT dstLine =
-		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
-
-		SSIZE_T x = 0;
-		WINPR_PRAGMA_UNROLL_LOOP
-		for (; x < width; x++)
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset + nXDst * dstByte];
+
+		/* 8 pixels per round, 4 in each 128 bit lane as pshufb does not cross lanes. The
+		 * loads and stores of the second lane must stay inside the row. */
+		size_t x = 0;
+		for (; ((x * srcByte + 4 * srcByte + 16) <= nWidth * srcByte) &&
+		       ((x * dstByte + 4 * dstByte + 16) <= nWidth * dstByte);
+		     x += 8)
 		{
-			const UINT32 color = FreeRDPReadColor_int(&srcLine[(x + nXSrc) * srcByte], SrcFormat);
-			const UINT32 dstColor = FreeRDPConvertColor(color, SrcFormat, DstFormat, palette);
-			FreeRDPWriteColor_int(&dstLine[(x + nXDst) * dstByte], DstFormat, dstColor);
-		}
-		for (; x < nWidth; x++)
-		{
-			const UINT32 color = FreeRDPReadColor_int(&srcLine[(x + nXSrc) * srcByte], SrcFormat);
-			const UINT32 dstColor = FreeRDPConvertColor(color, SrcFormat, DstFormat, palette);
-			FreeRDPWriteColor_int(&dstLine[(x + nXDst) * dstByte], DstFormat, dstColor);
+			const BYTE* src = &srcLine[x * srcByte];
+			BYTE* dst = &dstLine[x * dstByte];
+			const __m128i lo = _mm_loadu_si128((const __m128i*)src);
+			const __m128i hi = _mm_loadu_si128((const __m128i*)&src[4 * srcByte]);
+			const __m256i s0 = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+			const __m256i d0 = _mm256_or_si256(_mm256_shuffle_epi8(s0, index), fill);
+			_mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(d0));
+			_mm_storeu_si128((__m128i*)&dst[4 * dstByte], _mm256_extracti128_si256(d0, 1));
 		}
+
+		shuffle.tail(&dstLine[x * dstByte], &srcLine[x * srcByte], (UINT32)(nWidth - x));
 	}
 	return PRIMITIVES_SUCCESS;
 }
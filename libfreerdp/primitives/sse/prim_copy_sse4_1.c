@@ -186,31 +186,38 @@ pstatus_t sse_image_copy_no_overlap_convert(
     UINT32 nSrcStep, UINT32 nXSrc, UINT32 nYSrc, const gdiPalette* WINPR_RESTRICT palette,
     SSIZE_T srcVMultiplier, SSIZE_T srcVOffset, SSIZE_T dstVMultiplier, SSIZE_T dstVOffset)
 {
-	const SSIZE_T srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
-	const SSIZE_T dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+	PRIM_COPY_SHUFFLE shuffle = { 0 };
+
+	if (!generic_image_copy_shuffle(SrcFormat, DstFormat, &shuffle))
+		return generic_image_copy_no_overlap_convert(
+		    pDstData, DstFormat, nDstStep, nXDst, nYDst, nWidth, nHeight, pSrcData, SrcFormat,
+		    nSrcStep, nXSrc, nYSrc, palette, srcVMultiplier, srcVOffset, dstVMultiplier,
+		    dstVOffset);
+
+	const size_t srcByte = shuffle.srcByte;
+	const size_t dstByte = shuffle.dstByte;
+	const __m128i index = _mm_loadu_si128((const __m128i*)shuffle.index);
+	const __m128i fill = _mm_loadu_si128((const __m128i*)shuffle.fill);
 
-	const UINT32 width = nWidth - nWidth % 8;
 	for (SSIZE_T y = 0; y < nHeight; y++)
 	{
 		const BYTE* WINPR_RESTRICT srcLine =
-		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset];
+		    &pSrcData[srcVMultiplier * (y + nYSrc) * nSrcStep + srcVOffset + nXSrc * srcByte];
 		BYTE* WINPR_RESTRICT dstLine =
-		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset];
+		    &pDstData[dstVMultiplier * (y + nYDst) * nDstStep + dstVOffset + nXDst * dstByte];
 
-		SSIZE_T x = 0;
-		WINPR_PRAGMA_UNROLL_LOOP
-		for (; x < width; x++)
+		/* 4 pixels per round, the 16 byte loads and stores must stay inside the row. Bytes
+		 * stored past the 4th 24bpp pixel are overwritten by the next round. */
+		size_t x = 0;
+		for (; ((x * srcByte + 16) <= nWidth * srcByte) && ((x * dstByte + 16) <= nWidth * dstByte);
+		     x += 4)
 		{
-			const UINT32 color = FreeRDPReadColor(&srcLine[(x + nXSrc) * srcByte], SrcFormat);
-			const UINT32 dstColor = FreeRDPConvertColor(color, SrcFormat, DstFormat, palette);
-			FreeRDPWriteColor_int(&dstLine[(x + nXDst) * dstByte], DstFormat, dstColor);
-		}
-		for (; x < nWidth; x++)
-		{
-			const UINT32 color = FreeRDPReadColor(&srcLine[(x + nXSrc) * srcByte], SrcFormat);
-			const UINT32 dstColor = FreeRDPConvertColor(color, SrcFormat, DstFormat, palette);
-			FreeRDPWriteColor_int(&dstLine[(x + nXDst) * dstByte], DstFormat, dstColor);
+			const __m128i s0 = _mm_loadu_si128((const __m128i*)&srcLine[x * srcByte]);
+			const __m128i d0 = _mm_or_si128(_mm_shuffle_epi8(s0, index), fill);
+			_mm_storeu_si128((__m128i*)&dstLine[x * dstByte], d0);
 		}
+
+		shuffle.tail(&dstLine[x * dstByte], &srcLine[x * srcByte], (UINT32)(nWidth - x));
 	}
 	return PRIMITIVES_SUCCESS;
 }
@@ -0,0 +1,183 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized planar codec plane split, merge and delta encoding.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_planar.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE2_ENABLED)
+#include <emmintrin.h>
+
+static primitives_t* generic = NULL;
+
+/* Extract the byte at offset off of 16 pixels into one register */
+static INLINE __m128i sse2_extract_plane(const __m128i px[4], size_t off)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const int shift = (int)(8 * off);
+	const __m128i c0 = _mm_and_si128(_mm_srl_epi32(px[0], _mm_cvtsi32_si128(shift)), mask);
+	const __m128i c1 = _mm_and_si128(_mm_srl_epi32(px[1], _mm_cvtsi32_si128(shift)), mask);
+	const __m128i c2 = _mm_and_si128(_mm_srl_epi32(px[2], _mm_cvtsi32_si128(shift)), mask);
+	const __m128i c3 = _mm_and_si128(_mm_srl_epi32(px[3], _mm_cvtsi32_si128(shift)), mask);
+	return _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse2_RGBToPlanes_8u_AC4P4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                            UINT32 SrcFormat, BYTE* WINPR_RESTRICT pDst[4],
+                                            UINT32 dstStep, const prim_size_t* WINPR_RESTRICT roi)
+{
+	size_t off[4] = { 0 };
+
+	if (!prim_planar_offsets(SrcFormat, off))
+		return generic->RGBToPlanes_8u_AC4P4R(pSrc, srcStep, SrcFormat, pDst, dstStep, roi);
+
+	const BOOL alpha = FreeRDPColorHasAlpha(SrcFormat);
+	const UINT32 width = roi->width & ~15u;
+	const prim_size_t tail = { roi->width - width, roi->height };
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		const BYTE* src = &pSrc[1ULL * y * srcStep];
+		BYTE* dst[4] = { &pDst[0][1ULL * y * dstStep], &pDst[1][1ULL * y * dstStep],
+			             &pDst[2][1ULL * y * dstStep], &pDst[3][1ULL * y * dstStep] };
+
+		/* 16 pixels per round */
+		for (UINT32 x = 0; x < width; x += 16)
+		{
+			const __m128i* sptr = (const __m128i*)&src[4ULL * x];
+			const __m128i px[4] = { _mm_loadu_si128(&sptr[0]), _mm_loadu_si128(&sptr[1]),
+				                    _mm_loadu_si128(&sptr[2]), _mm_loadu_si128(&sptr[3]) };
+
+			for (size_t c = 0; c < 3; c++)
+				_mm_storeu_si128((__m128i*)&dst[c][x], sse2_extract_plane(px, off[c]));
+
+			if (alpha)
+				_mm_storeu_si128((__m128i*)&dst[3][x], sse2_extract_plane(px, off[3]));
+			else
+				_mm_storeu_si128((__m128i*)&dst[3][x], _mm_set1_epi8((char)0xFF));
+		}
+	}
+
+	if (tail.width > 0)
+	{
+		BYTE* dst[4] = { &pDst[0][width], &pDst[1][width], &pDst[2][width], &pDst[3][width] };
+		return generic->RGBToPlanes_8u_AC4P4R(&pSrc[4ULL * width], srcStep, SrcFormat, dst,
+		                                      dstStep, &tail);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse2_PlanesToRGB_8u_P4AC4R(const BYTE* WINPR_RESTRICT pSrc[4], UINT32 srcStep,
+                                            BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                            UINT32 DstFormat, const prim_size_t* WINPR_RESTRICT roi)
+{
+	size_t off[4] = { 0 };
+
+	if (!prim_planar_offsets(DstFormat, off))
+		return generic->PlanesToRGB_8u_P4AC4R(pSrc, srcStep, pDst, dstStep, DstFormat, roi);
+
+	const UINT32 width = roi->width & ~15u;
+	const prim_size_t tail = { roi->width - width, roi->height };
+
+	for (UINT32 y = 0; y < roi->height; y++)
+	{
+		BYTE* dst = &pDst[1ULL * y * dstStep];
+
+		/* 16 pixels per round */
+		for (UINT32 x = 0; x < width; x += 16)
+		{
+			const size_t pos = 1ULL * y * srcStep + x;
+			__m128i q[4] = { 0 };
+
+			/* sort the planes by their byte offset in the pixel */
+			q[off[0]] = _mm_loadu_si128((const __m128i*)&pSrc[0][pos]);
+			q[off[1]] = _mm_loadu_si128((const __m128i*)&pSrc[1][pos]);
+			q[off[2]] = _mm_loadu_si128((const __m128i*)&pSrc[2][pos]);
+			q[off[3]] = pSrc[3] ? _mm_loadu_si128((const __m128i*)&pSrc[3][pos])
+			                    : _mm_set1_epi8((char)0xFF);
+
+			const __m128i t0 = _mm_unpacklo_epi8(q[0], q[1]);
+			const __m128i t1 = _mm_unpackhi_epi8(q[0], q[1]);
+			const __m128i t2 = _mm_unpacklo_epi8(q[2], q[3]);
+			const __m128i t3 = _mm_unpackhi_epi8(q[2], q[3]);
+			__m128i* dptr = (__m128i*)&dst[4ULL * x];
+			_mm_storeu_si128(&dptr[0], _mm_unpacklo_epi16(t0, t2));
+			_mm_storeu_si128(&dptr[1], _mm_unpackhi_epi16(t0, t2));
+			_mm_storeu_si128(&dptr[2], _mm_unpacklo_epi16(t1, t3));
+			_mm_storeu_si128(&dptr[3], _mm_unpackhi_epi16(t1, t3));
+		}
+	}
+
+	if (tail.width > 0)
+	{
+		const BYTE* src[4] = { &pSrc[0][width], &pSrc[1][width], &pSrc[2][width],
+			                   pSrc[3] ? &pSrc[3][width] : NULL };
+		return generic->PlanesToRGB_8u_P4AC4R(src, srcStep, &pDst[4ULL * width], dstStep,
+		                                      DstFormat, &tail);
+	}
+
+	return PRIMITIVES_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t sse2_deltaSignEncode_8u(const BYTE* WINPR_RESTRICT pSrc,
+                                         const BYTE* WINPR_RESTRICT pPrev,
+                                         BYTE* WINPR_RESTRICT pDst, UINT32 len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	UINT32 x = 0;
+
+	/* 16 values per round */
+	for (; x + 16 <= len; x += 16)
+	{
+		const __m128i cur = _mm_loadu_si128((const __m128i*)&pSrc[x]);
+		const __m128i prev = _mm_loadu_si128((const __m128i*)&pPrev[x]);
+		const __m128i delta = _mm_sub_epi8(cur, prev);
+		const __m128i neg = _mm_cmpgt_epi8(zero, delta);
+		/* |delta| wraps to 0x80 for -128, which still yields the expected 0xFF */
+		const __m128i mag = _mm_sub_epi8(_mm_xor_si128(delta, neg), neg);
+		_mm_storeu_si128((__m128i*)&pDst[x], _mm_add_epi8(_mm_add_epi8(mag, mag), neg));
+	}
+
+	return generic->deltaSignEncode_8u(&pSrc[x], &pPrev[x], &pDst[x], len - x);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_planar_sse2(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE2_ENABLED)
+	generic = primitives_get_generic();
+
+	if (IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "SSE2 optimizations");
+		prims->RGBToPlanes_8u_AC4P4R = sse2_RGBToPlanes_8u_AC4P4R;
+		prims->PlanesToRGB_8u_P4AC4R = sse2_PlanesToRGB_8u_P4AC4R;
+		prims->deltaSignEncode_8u = sse2_deltaSignEncode_8u;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SSE2");
+	WINPR_UNUSED(prims);
+#endif
+}
@@ -0,0 +1,118 @@
+/* FreeRDP: A Remote Desktop Protocol Client
+ * Optimized image scaling.
+ * vi:ts=4 sw=4:
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <freerdp/types.h>
+#include <freerdp/primitives.h>
+#include <winpr/sysinfo.h>
+
+#include "prim_scale.h"
+
+#include "prim_internal.h"
+
+#if defined(SSE2_ENABLED)
+#include <emmintrin.h>
+
+/* ------------------------------------------------------------------------- */
+static void sse2_scale_vrow(const BYTE* WINPR_RESTRICT s0, const BYTE* WINPR_RESTRICT s1,
+                            UINT16 wy, UINT16* WINPR_RESTRICT row, size_t len)
+{
+	const UINT16 w0 = PRIM_SCALE_WEIGHT_ONE - wy;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i v0 = _mm_set1_epi16((INT16)w0);
+	const __m128i v1 = _mm_set1_epi16((INT16)wy);
+	size_t i = 0;
+
+	/* 16 channels per round, the products fit into 16 bit */
+	for (; i + 16 <= len; i += 16)
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i*)&s0[i]);
+		const __m128i b = _mm_loadu_si128((const __m128i*)&s1[i]);
+		const __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), v0),
+		                                 _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), v1));
+		const __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), v0),
+		                                 _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), v1));
+		_mm_storeu_si128((__m128i*)&row[i], lo);
+		_mm_storeu_si128((__m128i*)&row[i + 8], hi);
+	}
+
+	for (; i < len; i++)
+		row[i] = (UINT16)(s0[i] * w0 + s1[i] * wy);
+}
+
+/* Interleave a pixel with its right neighbour and blend both with one madd. */
+static INLINE __m128i sse2_scale_pixel(const UINT16* WINPR_RESTRICT row, UINT32 x0, UINT16 w1)
+{
+	const __m128i p = _mm_loadu_si128((const __m128i*)&row[4ULL * x0]);
+	const __m128i pair = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+	const UINT32 w = ((UINT32)w1 << 16) | (UINT32)(PRIM_SCALE_WEIGHT_ONE - w1);
+	const __m128i sum = _mm_madd_epi16(pair, _mm_set1_epi32((int)w));
+	return _mm_srai_epi32(_mm_add_epi32(sum, _mm_set1_epi32(8192)), 14);
+}
+
+static void sse2_scale_hrow(const UINT16* WINPR_RESTRICT row, const UINT32* WINPR_RESTRICT xofs,
+                            const UINT16* WINPR_RESTRICT xw, BYTE* WINPR_RESTRICT dst,
+                            UINT32 width)
+{
+	UINT32 x = 0;
+
+	/* 4 pixels per round */
+	for (; x + 4 <= width; x += 4)
+	{
+		const __m128i p0 = sse2_scale_pixel(row, xofs[x + 0], xw[x + 0]);
+		const __m128i p1 = sse2_scale_pixel(row, xofs[x + 1], xw[x + 1]);
+		const __m128i p2 = sse2_scale_pixel(row, xofs[x + 2], xw[x + 2]);
+		const __m128i p3 = sse2_scale_pixel(row, xofs[x + 3], xw[x + 3]);
+		const __m128i lo = _mm_packs_epi32(p0, p1);
+		const __m128i hi = _mm_packs_epi32(p2, p3);
+		_mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(lo, hi));
+		dst += 16;
+	}
+
+	for (; x < width; x++)
+	{
+		const UINT16* p = &row[4ULL * xofs[x]];
+		const UINT32 w1 = xw[x];
+		const UINT32 w0 = PRIM_SCALE_WEIGHT_ONE - w1;
+
+		for (size_t c = 0; c < 4; c++)
+			*dst++ = (BYTE)((p[c] * w0 + p[c + 4] * w1 + 8192) >> 14);
+	}
+}
+
+static pstatus_t sse2_scale_8u_AC4R(const BYTE* WINPR_RESTRICT pSrc, UINT32 srcStep,
+                                    const prim_size_t* WINPR_RESTRICT srcRoi,
+                                    BYTE* WINPR_RESTRICT pDst, UINT32 dstStep,
+                                    const prim_size_t* WINPR_RESTRICT dstRoi)
+{
+	return prim_scale_8u_AC4R(pSrc, srcStep, srcRoi, pDst, dstStep, dstRoi, sse2_scale_vrow,
+	                          sse2_scale_hrow);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+void primitives_init_scale_sse2(primitives_t* WINPR_RESTRICT prims)
+{
+#if defined(SSE2_ENABLED)
+	if (IsProcessorFeaturePresent(PF_SSE2_INSTRUCTIONS_AVAILABLE))
+	{
+		WLog_VRB(PRIM_TAG, "SSE2 optimizations");
+		prims->scale_8u_AC4R = sse2_scale_8u_AC4R;
+	}
+#else
+	WLog_VRB(PRIM_TAG, "undefined WITH_SSE2");
+	WINPR_UNUSED(prims);
+#endif
+}
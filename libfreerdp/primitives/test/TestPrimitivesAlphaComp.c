@@ -156,6 +156,88 @@ static BOOL test_alphaComp_func(void)
 	return TRUE;
 }
 
+/* wide enough for the vector paths and their remainder */
+static BOOL test_alphaComp_wide_func(void)
+{
+	const UINT32 width = 37;
+	const UINT32 height = 3;
+	const UINT32 step = 4 * (width + 3);
+	BYTE ALIGN(src1[4 * (37 + 3) * 3]) = { 0 };
+	BYTE ALIGN(src2[4 * (37 + 3) * 3]) = { 0 };
+	BYTE ALIGN(dst1[4 * (37 + 3) * 3]) = { 0 };
+	UINT32* ptr = (UINT32*)src2;
+
+	winpr_RAND(src1, sizeof(src1));
+	winpr_RAND(src2, sizeof(src2));
+
+	for (UINT32 i = 0; i < sizeof(src2) / 4; ++i)
+		*ptr++ |= 0xFF000000U;
+
+	/* unaligned destination rows on purpose */
+	if (optimized->alphaComp_argb(src1, step, src2, step, &dst1[4], step, width, height) !=
+	    PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	return check(src1, step, src2, step, &dst1[4], step, width, height);
+}
+
+static BOOL test_applyAlpha_func(const primitives_t* prims, UINT32 format, int offset)
+{
+	const prim_size_t roi = { 37, 3 };
+	const UINT32 alphaStep = 40;
+	const UINT32 dstStep = 4 * 40;
+	BYTE alpha[40 * 3] = { 0 };
+	BYTE ALIGN(dst[4 * 40 * 3]) = { 0 };
+	BYTE ALIGN(ref[4 * 40 * 3]) = { 0 };
+
+	winpr_RAND(alpha, sizeof(alpha));
+	winpr_RAND(dst, sizeof(dst));
+	memcpy(ref, dst, sizeof(ref));
+
+	if (prims->applyAlpha_8u_P1AC4R(alpha, alphaStep, dst, dstStep, format, &roi) !=
+	    PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	for (UINT32 y = 0; y < roi.height; y++)
+	{
+		for (UINT32 x = 0; x < roi.width; x++)
+			ref[y * dstStep + 4 * x + (UINT32)offset] = alpha[y * alphaStep + x];
+	}
+
+	if (memcmp(dst, ref, sizeof(ref)) != 0)
+	{
+		printf("applyAlpha: %s mismatch for %s\n", (prims == generic) ? "generic" : "optimized",
+		       FreeRDPGetColorFormatName(format));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static BOOL test_applyAlpha(void)
+{
+	const primitives_t* prims[] = { generic, optimized };
+	const prim_size_t roi = { 4, 4 };
+	BYTE alpha[16] = { 0 };
+	BYTE dst[64] = { 0 };
+
+	for (size_t x = 0; x < ARRAYSIZE(prims); x++)
+	{
+		if (!test_applyAlpha_func(prims[x], PIXEL_FORMAT_ARGB32, 0) ||
+		    !test_applyAlpha_func(prims[x], PIXEL_FORMAT_ABGR32, 0) ||
+		    !test_applyAlpha_func(prims[x], PIXEL_FORMAT_BGRA32, 3) ||
+		    !test_applyAlpha_func(prims[x], PIXEL_FORMAT_RGBX32, 3))
+			return FALSE;
+
+		/* no alpha byte to write */
+		if (prims[x]->applyAlpha_8u_P1AC4R(alpha, 4, dst, 16, PIXEL_FORMAT_RGB24, &roi) ==
+		    PRIMITIVES_SUCCESS)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 static int test_alphaComp_speed(void)
 {
 	BYTE ALIGN(src1[SRC1_WIDTH * SRC1_HEIGHT]) = { 0 };
@@ -192,6 +274,12 @@ int TestPrimitivesAlphaComp(int argc, char* argv[])
 	if (!test_alphaComp_func())
 		return -1;
 
+	if (!test_alphaComp_wide_func())
+		return -1;
+
+	if (!test_applyAlpha())
+		return -1;
+
 	if (g_TestPrimitivesPerformance)
 	{
 		if (!test_alphaComp_speed())
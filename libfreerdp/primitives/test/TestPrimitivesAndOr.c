@@ -144,6 +144,74 @@ static BOOL test_or_32u_speed(void)
 	return TRUE;
 }
 
+/* ========================================================================= */
+static BOOL test_xor_32u_impl(const char* name, __xorC_32u_t fkt, const UINT32* src,
+                              const UINT32 val, UINT32* dst, size_t size)
+{
+	pstatus_t status = fkt(src, val, dst, size);
+	if (status != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (dst[i] != (src[i] ^ val))
+		{
+			printf("XOR %s FAIL[%" PRIuz "] 0x%08" PRIx32 "^0x%08" PRIx32 "=0x%08" PRIx32
+			       ", got 0x%08" PRIx32 "\n",
+			       name, i, src[i], val, (src[i] ^ val), dst[i]);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_xor_32u_func(void)
+{
+	UINT32 ALIGN(src[FUNC_TEST_SIZE + 3]) = { 0 };
+	UINT32 ALIGN(dst[FUNC_TEST_SIZE + 3]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	if (!test_xor_32u_impl("generic->xorC_32u aligned", generic->xorC_32u, src + 1, VALUE, dst + 1,
+	                       FUNC_TEST_SIZE))
+		return FALSE;
+	if (!test_xor_32u_impl("generic->xorC_32u unaligned", generic->xorC_32u, src + 1, VALUE,
+	                       dst + 2, FUNC_TEST_SIZE))
+		return FALSE;
+	if (!test_xor_32u_impl("optimized->xorC_32u aligned", optimized->xorC_32u, src + 1, VALUE,
+	                       dst + 1, FUNC_TEST_SIZE))
+		return FALSE;
+	if (!test_xor_32u_impl("optimized->xorC_32u unaligned", optimized->xorC_32u, src + 1, VALUE,
+	                       dst + 2, FUNC_TEST_SIZE))
+		return FALSE;
+	/* a length that leaves a remainder for every vector width */
+	if (!test_xor_32u_impl("optimized->xorC_32u odd length", optimized->xorC_32u, src, VALUE,
+	                       dst + 1, FUNC_TEST_SIZE - 13))
+		return FALSE;
+	/* a zero key must still copy */
+	if (!test_xor_32u_impl("optimized->xorC_32u zero", optimized->xorC_32u, src + 1, 0, dst + 1,
+	                       FUNC_TEST_SIZE))
+		return FALSE;
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_xor_32u_speed(void)
+{
+	UINT32 ALIGN(src[FUNC_TEST_SIZE + 3]) = { 0 };
+	UINT32 ALIGN(dst[FUNC_TEST_SIZE + 3]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	if (!speed_test("xorC_32u", "aligned", g_Iterations, (speed_test_fkt)generic->xorC_32u,
+	                (speed_test_fkt)optimized->xorC_32u, src + 1, VALUE, dst + 1, FUNC_TEST_SIZE))
+		return FALSE;
+
+	return TRUE;
+}
+
 int TestPrimitivesAndOr(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -157,12 +225,17 @@ int TestPrimitivesAndOr(int argc, char* argv[])
 	if (!test_or_32u_func())
 		return -1;
 
+	if (!test_xor_32u_func())
+		return -1;
+
 	if (g_TestPrimitivesPerformance)
 	{
 		if (!test_and_32u_speed())
 			return -1;
 		if (!test_or_32u_speed())
 			return -1;
+		if (!test_xor_32u_speed())
+			return -1;
 	}
 
 	return 0;
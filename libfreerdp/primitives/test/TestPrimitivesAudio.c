@@ -0,0 +1,123 @@
+/* test_audio.c
+ * vi:ts=4 sw=4
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+#include "prim_test.h"
+
+/* a frame count that leaves a remainder for every vector width */
+#define FUNC_TEST_FRAMES 1027
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_mono_to_stereo_func(void)
+{
+	INT16 ALIGN(src[FUNC_TEST_FRAMES]) = { 0 };
+	INT16 ALIGN(gdst[2 * FUNC_TEST_FRAMES]) = { 0 };
+	INT16 ALIGN(odst[2 * FUNC_TEST_FRAMES]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	if (generic->monoToStereo_16s(src, gdst, FUNC_TEST_FRAMES) != PRIMITIVES_SUCCESS)
+		return FALSE;
+	if (optimized->monoToStereo_16s(src, odst, FUNC_TEST_FRAMES) != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	for (size_t x = 0; x < FUNC_TEST_FRAMES; x++)
+	{
+		if ((gdst[2 * x] != src[x]) || (gdst[2 * x + 1] != src[x]))
+		{
+			printf("monoToStereo_16s generic wrong at frame %" PRIuz "\n", x);
+			return FALSE;
+		}
+	}
+
+	if (memcmp(gdst, odst, sizeof(gdst)) != 0)
+	{
+		printf("monoToStereo_16s generic and optimized differ\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_stereo_to_mono_func(void)
+{
+	INT16 ALIGN(src[2 * FUNC_TEST_FRAMES]) = { 0 };
+	INT16 ALIGN(gdst[FUNC_TEST_FRAMES]) = { 0 };
+	INT16 ALIGN(odst[FUNC_TEST_FRAMES]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	/* the extremes must neither overflow nor saturate */
+	src[0] = src[1] = INT16_MAX;
+	src[2] = src[3] = INT16_MIN;
+
+	if (generic->stereoToMono_16s(src, gdst, FUNC_TEST_FRAMES) != PRIMITIVES_SUCCESS)
+		return FALSE;
+	if (optimized->stereoToMono_16s(src, odst, FUNC_TEST_FRAMES) != PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	if ((gdst[0] != INT16_MAX) || (gdst[1] != INT16_MIN))
+	{
+		printf("stereoToMono_16s generic wrong for full scale input\n");
+		return FALSE;
+	}
+
+	if (memcmp(gdst, odst, sizeof(gdst)) != 0)
+	{
+		printf("stereoToMono_16s generic and optimized differ\n");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_stereo_to_mono_speed(void)
+{
+	INT16 ALIGN(src[2 * MAX_TEST_SIZE]) = { 0 };
+	INT16 ALIGN(dst[MAX_TEST_SIZE]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	if (!speed_test("stereoToMono_16s", "aligned", g_Iterations,
+	                (speed_test_fkt)generic->stereoToMono_16s,
+	                (speed_test_fkt)optimized->stereoToMono_16s, src, dst, MAX_TEST_SIZE))
+		return FALSE;
+
+	return TRUE;
+}
+
+int TestPrimitivesAudio(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_mono_to_stereo_func())
+		return -1;
+
+	if (!test_stereo_to_mono_func())
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_stereo_to_mono_speed())
+			return -1;
+	}
+
+	return 0;
+}
@@ -15,10 +15,16 @@
 #include <freerdp/config.h>
 
 #include <winpr/sysinfo.h>
+#include <freerdp/codec/color.h>
 #include "prim_test.h"
 
 #define COPY_TESTSIZE (256 * 2 + 16 * 2 + 15 + 15)
 
+/* rows are wide enough for the SIMD converters and an odd tail */
+#define COPY_IMAGE_WIDTH 37
+#define COPY_IMAGE_HEIGHT 3
+#define COPY_IMAGE_STEP ((COPY_IMAGE_WIDTH + 2) * 4)
+
 /* ------------------------------------------------------------------------- */
 static BOOL test_copy8u_func(void)
 {
@@ -54,6 +60,77 @@ static BOOL test_copy8u_func(void)
 	return TRUE;
 }
 
+/* ------------------------------------------------------------------------- */
+static BOOL test_copy_no_overlap_format(primitives_t* prims, const char* name, UINT32 SrcFormat,
+                                        UINT32 DstFormat, const BYTE* src)
+{
+	BYTE expected[COPY_IMAGE_STEP * COPY_IMAGE_HEIGHT] = { 0 };
+	BYTE actual[COPY_IMAGE_STEP * COPY_IMAGE_HEIGHT] = { 0 };
+	const UINT32 srcByte = FreeRDPGetBytesPerPixel(SrcFormat);
+	const UINT32 dstByte = FreeRDPGetBytesPerPixel(DstFormat);
+
+	for (UINT32 width = 1; width <= COPY_IMAGE_WIDTH; width++)
+	{
+		memset(expected, 0x5A, sizeof(expected));
+		memset(actual, 0x5A, sizeof(actual));
+
+		for (UINT32 y = 0; y < COPY_IMAGE_HEIGHT; y++)
+		{
+			for (UINT32 x = 0; x < width; x++)
+			{
+				const UINT32 color =
+				    FreeRDPReadColor(&src[y * COPY_IMAGE_STEP + (x + 1) * srcByte], SrcFormat);
+				FreeRDPWriteColor(&expected[y * COPY_IMAGE_STEP + (x + 2) * dstByte], DstFormat,
+				                  FreeRDPConvertColor(color, SrcFormat, DstFormat, NULL));
+			}
+		}
+
+		if (prims->copy_no_overlap(actual, DstFormat, COPY_IMAGE_STEP, 2, 0, width,
+		                           COPY_IMAGE_HEIGHT, src, SrcFormat, COPY_IMAGE_STEP, 1, 0, NULL,
+		                           0) != PRIMITIVES_SUCCESS)
+			return FALSE;
+
+		if (memcmp(expected, actual, sizeof(expected)) != 0)
+		{
+			printf("%s copy_no_overlap %s -> %s width %" PRIu32 " mismatch\n", name,
+			       FreeRDPGetColorFormatName(SrcFormat), FreeRDPGetColorFormatName(DstFormat),
+			       width);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static BOOL test_copy_no_overlap_func(void)
+{
+	const UINT32 formats[] = { PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32, PIXEL_FORMAT_ABGR32,
+		                       PIXEL_FORMAT_XBGR32, PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
+		                       PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32, PIXEL_FORMAT_RGB24,
+		                       PIXEL_FORMAT_BGR24,  PIXEL_FORMAT_RGB16,  PIXEL_FORMAT_BGR16,
+		                       PIXEL_FORMAT_RGB15,  PIXEL_FORMAT_BGR15 };
+	BYTE src[COPY_IMAGE_STEP * COPY_IMAGE_HEIGHT] = { 0 };
+	winpr_RAND(src, sizeof(src));
+
+	for (size_t s = 0; s < ARRAYSIZE(formats); s++)
+	{
+		for (size_t d = 0; d < ARRAYSIZE(formats); d++)
+		{
+			/* same layout is a plain copy that keeps the padding byte */
+			if (FreeRDPAreColorFormatsEqualNoAlpha(formats[s], formats[d]))
+				continue;
+
+			if (!test_copy_no_overlap_format(generic, "generic", formats[s], formats[d], src))
+				return FALSE;
+			if (!test_copy_no_overlap_format(optimized, "optimized", formats[s], formats[d],
+			                                 src))
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
 /* ------------------------------------------------------------------------- */
 static BOOL test_copy8u_speed(void)
 {
@@ -80,6 +157,9 @@ int TestPrimitivesCopy(int argc, char* argv[])
 	if (!test_copy8u_func())
 		return 1;
 
+	if (!test_copy_no_overlap_func())
+		return 1;
+
 	if (g_TestPrimitivesPerformance)
 	{
 		if (!test_copy8u_speed())
@@ -0,0 +1,212 @@
+/* test_planar.c
+ * vi:ts=4 sw=4
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+#include <freerdp/codec/color.h>
+#include "prim_test.h"
+
+/* a width that leaves a remainder for every vector width */
+#define TEST_WIDTH 61
+#define TEST_HEIGHT 7
+#define FUNC_TEST_SIZE 4096
+
+static const UINT32 test_formats[] = { PIXEL_FORMAT_ARGB32, PIXEL_FORMAT_XRGB32,
+	                                   PIXEL_FORMAT_ABGR32, PIXEL_FORMAT_XBGR32,
+	                                   PIXEL_FORMAT_RGBA32, PIXEL_FORMAT_RGBX32,
+	                                   PIXEL_FORMAT_BGRA32, PIXEL_FORMAT_BGRX32 };
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_planes_func(void)
+{
+	const prim_size_t roi = { TEST_WIDTH, TEST_HEIGHT };
+	const UINT32 srcStep = TEST_WIDTH * 4 + 8;
+	BYTE ALIGN(src[(TEST_WIDTH * 4 + 8) * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(gplanes[4][TEST_WIDTH * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(oplanes[4][TEST_WIDTH * TEST_HEIGHT]) = { 0 };
+	BYTE ALIGN(dst[(TEST_WIDTH * 4 + 8) * TEST_HEIGHT]) = { 0 };
+
+	winpr_RAND(src, sizeof(src));
+
+	for (size_t x = 0; x < ARRAYSIZE(test_formats); x++)
+	{
+		const UINT32 format = test_formats[x];
+		const char* name = FreeRDPGetColorFormatName(format);
+		BYTE* g[4] = { gplanes[0], gplanes[1], gplanes[2], gplanes[3] };
+		BYTE* o[4] = { oplanes[0], oplanes[1], oplanes[2], oplanes[3] };
+
+		if (generic->RGBToPlanes_8u_AC4P4R(src, srcStep, format, g, TEST_WIDTH, &roi) !=
+		    PRIMITIVES_SUCCESS)
+			return FALSE;
+		if (optimized->RGBToPlanes_8u_AC4P4R(src, srcStep, format, o, TEST_WIDTH, &roi) !=
+		    PRIMITIVES_SUCCESS)
+			return FALSE;
+
+		if (memcmp(gplanes, oplanes, sizeof(gplanes)) != 0)
+		{
+			printf("RGBToPlanes_8u_AC4P4R %s generic and optimized differ\n", name);
+			return FALSE;
+		}
+
+		for (size_t y = 0; y < TEST_HEIGHT; y++)
+		{
+			for (size_t i = 0; i < TEST_WIDTH; i++)
+			{
+				BYTE r = 0;
+				BYTE gr = 0;
+				BYTE b = 0;
+				BYTE a = 0;
+				const size_t k = y * TEST_WIDTH + i;
+				const UINT32 color = FreeRDPReadColor(&src[y * srcStep + 4 * i], format);
+				FreeRDPSplitColor(color, format, &r, &gr, &b, &a, NULL);
+
+				if ((gplanes[0][k] != r) || (gplanes[1][k] != gr) || (gplanes[2][k] != b) ||
+				    (gplanes[3][k] != a))
+				{
+					printf("RGBToPlanes_8u_AC4P4R %s FAIL[%" PRIuz "]\n", name, k);
+					return FALSE;
+				}
+			}
+		}
+
+		/* merging the planes back must restore the pixels, padding bytes become 0xFF */
+		for (size_t alpha = 0; alpha < 2; alpha++)
+		{
+			const BYTE* planes[4] = { gplanes[0], gplanes[1], gplanes[2],
+				                      alpha ? gplanes[3] : NULL };
+			BYTE ALIGN(odst[sizeof(dst)]) = { 0 };
+
+			memset(dst, 0, sizeof(dst));
+			if (generic->PlanesToRGB_8u_P4AC4R(planes, TEST_WIDTH, dst, srcStep, format, &roi) !=
+			    PRIMITIVES_SUCCESS)
+				return FALSE;
+			if (optimized->PlanesToRGB_8u_P4AC4R(planes, TEST_WIDTH, odst, srcStep, format,
+			                                     &roi) != PRIMITIVES_SUCCESS)
+				return FALSE;
+
+			if (memcmp(dst, odst, sizeof(dst)) != 0)
+			{
+				printf("PlanesToRGB_8u_P4AC4R %s generic and optimized differ\n", name);
+				return FALSE;
+			}
+
+			for (size_t y = 0; y < TEST_HEIGHT; y++)
+			{
+				for (size_t i = 0; i < TEST_WIDTH; i++)
+				{
+					BYTE sc[4] = { 0 };
+					BYTE dc[4] = { 0 };
+					const UINT32 s = FreeRDPReadColor(&src[y * srcStep + 4 * i], format);
+					const UINT32 d = FreeRDPReadColor(&dst[y * srcStep + 4 * i], format);
+					FreeRDPSplitColor(s, format, &sc[0], &sc[1], &sc[2], &sc[3], NULL);
+					FreeRDPSplitColor(d, format, &dc[0], &dc[1], &dc[2], &dc[3], NULL);
+
+					/* without an alpha plane the alpha channel is opaque */
+					if (!alpha)
+						sc[3] = 0xFF;
+
+					if (memcmp(sc, dc, sizeof(sc)) != 0)
+					{
+						printf("PlanesToRGB_8u_P4AC4R %s FAIL[%" PRIuz "x%" PRIuz "]\n", name,
+						       i, y);
+						return FALSE;
+					}
+				}
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_delta_func(void)
+{
+	BYTE ALIGN(cur[FUNC_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(prev[FUNC_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(gdst[FUNC_TEST_SIZE + 3]) = { 0 };
+	BYTE ALIGN(odst[FUNC_TEST_SIZE + 3]) = { 0 };
+
+	winpr_RAND(cur, sizeof(cur));
+	winpr_RAND(prev, sizeof(prev));
+	/* the extremes of the sign-magnitude mapping */
+	cur[1] = 0x00;
+	prev[1] = 0x80;
+	cur[2] = 0x80;
+	prev[2] = 0x00;
+	cur[3] = prev[3];
+
+	if (generic->deltaSignEncode_8u(cur + 1, prev + 1, gdst + 1, FUNC_TEST_SIZE - 5) !=
+	    PRIMITIVES_SUCCESS)
+		return FALSE;
+	if (optimized->deltaSignEncode_8u(cur + 1, prev + 1, odst + 1, FUNC_TEST_SIZE - 5) !=
+	    PRIMITIVES_SUCCESS)
+		return FALSE;
+
+	for (size_t x = 1; x < FUNC_TEST_SIZE - 4; x++)
+	{
+		const INT32 delta = (INT8)(BYTE)(cur[x] - prev[x]);
+		const BYTE expect = (delta >= 0) ? (BYTE)(delta * 2) : (BYTE)(-delta * 2 - 1);
+
+		if ((gdst[x] != expect) || (odst[x] != expect))
+		{
+			printf("deltaSignEncode_8u FAIL[%" PRIuz "] %" PRId32 " -> 0x%02" PRIx8
+			       ", got 0x%02" PRIx8 " / 0x%02" PRIx8 "\n",
+			       x, delta, expect, gdst[x], odst[x]);
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_delta_speed(void)
+{
+	BYTE ALIGN(cur[MAX_TEST_SIZE]) = { 0 };
+	BYTE ALIGN(prev[MAX_TEST_SIZE]) = { 0 };
+	BYTE ALIGN(dst[MAX_TEST_SIZE]) = { 0 };
+
+	winpr_RAND(cur, sizeof(cur));
+	winpr_RAND(prev, sizeof(prev));
+
+	if (!speed_test("deltaSignEncode_8u", "aligned", g_Iterations,
+	                (speed_test_fkt)generic->deltaSignEncode_8u,
+	                (speed_test_fkt)optimized->deltaSignEncode_8u, cur, prev, dst, MAX_TEST_SIZE))
+		return FALSE;
+
+	return TRUE;
+}
+
+int TestPrimitivesPlanar(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_planes_func())
+		return -1;
+
+	if (!test_delta_func())
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_delta_speed())
+			return -1;
+	}
+
+	return 0;
+}
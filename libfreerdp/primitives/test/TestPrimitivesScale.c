@@ -0,0 +1,183 @@
+/* test_scale.c
+ * vi:ts=4 sw=4
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/sysinfo.h>
+#include "prim_test.h"
+
+#define SRC_WIDTH 67
+#define SRC_HEIGHT 31
+
+static const prim_size_t test_dst_sizes[] = {
+	{ SRC_WIDTH, SRC_HEIGHT },         { 1, 1 },   { 13, 7 },  { 33, 15 },  { 50, 25 },
+	{ 2 * SRC_WIDTH, 2 * SRC_HEIGHT }, { 97, 40 }, { 203, 5 }, { 20, 100 }, { 3, 64 },
+};
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_scale_constant(const char* name, __scale_8u_AC4R_t fkt)
+{
+	BYTE* src = NULL;
+	BYTE* dst = NULL;
+	BOOL rc = FALSE;
+	const prim_size_t srcRoi = { SRC_WIDTH, SRC_HEIGHT };
+	const UINT32 srcStep = 4 * SRC_WIDTH;
+
+	src = calloc(srcStep, SRC_HEIGHT);
+	if (!src)
+		goto fail;
+
+	for (size_t i = 0; i < 1ULL * srcStep * SRC_HEIGHT; i += 4)
+	{
+		src[i + 0] = 0x12;
+		src[i + 1] = 0x80;
+		src[i + 2] = 0xFE;
+		src[i + 3] = 0xFF;
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(test_dst_sizes); x++)
+	{
+		const prim_size_t* dstRoi = &test_dst_sizes[x];
+		const UINT32 dstStep = 4 * dstRoi->width;
+
+		free(dst);
+		dst = calloc(dstStep, dstRoi->height);
+		if (!dst)
+			goto fail;
+
+		if (fkt(src, srcStep, &srcRoi, dst, dstStep, dstRoi) != PRIMITIVES_SUCCESS)
+			goto fail;
+
+		for (size_t i = 0; i < 1ULL * dstStep * dstRoi->height; i++)
+		{
+			if (dst[i] != src[i % 4])
+			{
+				printf("scale_8u_AC4R %s constant FAIL %" PRIu32 "x%" PRIu32 "[%" PRIuz
+				       "] 0x%02" PRIx8 " != 0x%02" PRIx8 "\n",
+				       name, dstRoi->width, dstRoi->height, i, dst[i], src[i % 4]);
+				goto fail;
+			}
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
+static BOOL test_scale_compare(void)
+{
+	BYTE* src = NULL;
+	BYTE* gdst = NULL;
+	BYTE* odst = NULL;
+	BOOL rc = FALSE;
+	const prim_size_t srcRoi = { SRC_WIDTH, SRC_HEIGHT };
+	/* padded stride, the scaler must not depend on tightly packed lines */
+	const UINT32 srcStep = 4 * SRC_WIDTH + 12;
+
+	src = calloc(srcStep, SRC_HEIGHT);
+	if (!src)
+		goto fail;
+
+	winpr_RAND(src, 1ULL * srcStep * SRC_HEIGHT);
+
+	for (size_t x = 0; x < ARRAYSIZE(test_dst_sizes); x++)
+	{
+		const prim_size_t* dstRoi = &test_dst_sizes[x];
+		const UINT32 dstStep = 4 * dstRoi->width + 4;
+
+		free(gdst);
+		free(odst);
+		gdst = calloc(dstStep, dstRoi->height);
+		odst = calloc(dstStep, dstRoi->height);
+		if (!gdst || !odst)
+			goto fail;
+
+		if (generic->scale_8u_AC4R(src, srcStep, &srcRoi, gdst, dstStep, dstRoi) !=
+		    PRIMITIVES_SUCCESS)
+			goto fail;
+		if (optimized->scale_8u_AC4R(src, srcStep, &srcRoi, odst, dstStep, dstRoi) !=
+		    PRIMITIVES_SUCCESS)
+			goto fail;
+
+		if (memcmp(gdst, odst, 1ULL * dstStep * dstRoi->height) != 0)
+		{
+			printf("scale_8u_AC4R %" PRIu32 "x%" PRIu32 " generic and optimized differ\n",
+			       dstRoi->width, dstRoi->height);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(gdst);
+	free(odst);
+	return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+static BOOL test_scale_speed(void)
+{
+	BYTE* src = NULL;
+	BYTE* dst = NULL;
+	BOOL rc = FALSE;
+	const prim_size_t srcRoi = { 1024, 768 };
+	const prim_size_t dstRoi = { 1600, 1200 };
+
+	src = calloc(4ULL * srcRoi.width, srcRoi.height);
+	dst = calloc(4ULL * dstRoi.width, dstRoi.height);
+	if (!src || !dst)
+		goto fail;
+
+	winpr_RAND(src, 4ULL * srcRoi.width * srcRoi.height);
+
+	if (!speed_test("scale_8u_AC4R", "upscale", g_Iterations,
+	                (speed_test_fkt)generic->scale_8u_AC4R,
+	                (speed_test_fkt)optimized->scale_8u_AC4R, src, 4 * srcRoi.width, &srcRoi, dst,
+	                4 * dstRoi.width, &dstRoi))
+		goto fail;
+
+	rc = TRUE;
+fail:
+	free(src);
+	free(dst);
+	return rc;
+}
+
+int TestPrimitivesScale(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	prim_test_setup(FALSE);
+
+	if (!test_scale_constant("generic", generic->scale_8u_AC4R))
+		return -1;
+
+	if (!test_scale_constant("optimized", optimized->scale_8u_AC4R))
+		return -1;
+
+	if (!test_scale_compare())
+		return -1;
+
+	if (g_TestPrimitivesPerformance)
+	{
+		if (!test_scale_speed())
+			return -1;
+	}
+
+	return 0;
+}
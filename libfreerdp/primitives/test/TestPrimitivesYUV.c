@@ -386,6 +386,129 @@ fail:
 	return rc;
 }
 
+/* Combine a luma and a chroma frame, once in two steps with the active primitives and once
+ * with the fused primitive, and check both give the same YUV444 and RGB output. */
+static BOOL TestPrimitiveYUVCombineToRGB(primitives_t* prims, prim_size_t roi)
+{
+	union
+	{
+		const BYTE** cpv;
+		BYTE** pv;
+	} cnv;
+	BOOL rc = FALSE;
+	primitives_t* ref = primitives_get();
+	BYTE* src[3] = { 0 };
+	BYTE* yuvA[3] = { 0 };
+	BYTE* yuvB[3] = { 0 };
+	BYTE* rgbA = NULL;
+	BYTE* rgbB = NULL;
+	UINT32 srcStride[3] = { 0 };
+	UINT32 yuvStride[3] = { 0 };
+	const UINT32 format = PIXEL_FORMAT_BGRX32;
+	const size_t padding = 10000;
+	const size_t awidth = roi.width + 16 - roi.width % 16;
+	const size_t aheight = roi.height + 16 - roi.height % 16;
+	const size_t rgbStride = 4ULL * awidth;
+	const size_t rgbSize = rgbStride * aheight;
+	const avc444_frame_type types[] = { AVC444_LUMA, AVC444_CHROMAv1 };
+	const RECTANGLE_16 rect = { 0, 0, (UINT16)roi.width, (UINT16)roi.height };
+	PROFILER_DEFINE(yuvCombineToRGB)
+	PROFILER_CREATE(yuvCombineToRGB, "YUV420CombineToRGB_8u_P3AC4R")
+
+	if (!prims || !prims->YUV420CombineToRGB_8u_P3AC4R)
+		goto fail;
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		const size_t size = aheight * awidth;
+		const size_t halfSize = ((x > 0) ? awidth / 2 * aheight / 2 : size);
+		srcStride[x] = (x > 0) ? awidth / 2 : awidth;
+		yuvStride[x] = awidth;
+
+		if (!(src[x] = set_padding(halfSize, padding)))
+			goto fail;
+
+		if (!(yuvA[x] = set_padding(size, padding)))
+			goto fail;
+
+		if (!(yuvB[x] = set_padding(size, padding)))
+			goto fail;
+
+		winpr_RAND(src[x], halfSize);
+	}
+
+	if (!(rgbA = set_padding(rgbSize, padding)))
+		goto fail;
+
+	if (!(rgbB = set_padding(rgbSize, padding)))
+		goto fail;
+
+	for (size_t x = 0; x < ARRAYSIZE(types); x++)
+	{
+		cnv.pv = src;
+		if (ref->YUV420CombineToYUV444(types[x], cnv.cpv, srcStride, awidth, aheight, yuvA,
+		                               yuvStride, &rect) != PRIMITIVES_SUCCESS)
+			goto fail;
+
+		cnv.pv = yuvA;
+		if (ref->YUV444ToRGB_8u_P3AC4R(cnv.cpv, yuvStride, rgbA, rgbStride, format, &roi) !=
+		    PRIMITIVES_SUCCESS)
+			goto fail;
+
+		PROFILER_ENTER(yuvCombineToRGB)
+		cnv.pv = src;
+		if (prims->YUV420CombineToRGB_8u_P3AC4R(types[x], cnv.cpv, srcStride, awidth, aheight,
+		                                        yuvB, yuvStride, rgbB, rgbStride, format,
+		                                        &rect) != PRIMITIVES_SUCCESS)
+		{
+			PROFILER_EXIT(yuvCombineToRGB)
+			goto fail;
+		}
+		PROFILER_EXIT(yuvCombineToRGB)
+
+		for (size_t y = 0; y < roi.height; y++)
+		{
+			for (size_t i = 0; i < 3; i++)
+			{
+				if (!similar(yuvA[i] + y * yuvStride[i], yuvB[i] + y * yuvStride[i], roi.width))
+					goto fail;
+			}
+
+			if (!similarRGB(rgbA + y * rgbStride, rgbB + y * rgbStride, roi.width, format, TRUE))
+				goto fail;
+		}
+	}
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		if (!check_padding(yuvA[x], aheight * awidth, padding, "yuvA"))
+			goto fail;
+
+		if (!check_padding(yuvB[x], aheight * awidth, padding, "yuvB"))
+			goto fail;
+	}
+
+	if (!check_padding(rgbB, rgbSize, padding, "rgb"))
+		goto fail;
+
+	PROFILER_PRINT_HEADER
+	PROFILER_PRINT(yuvCombineToRGB)
+	PROFILER_PRINT_FOOTER
+	rc = TRUE;
+fail:
+	PROFILER_FREE(yuvCombineToRGB)
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		free_padding(src[x], padding);
+		free_padding(yuvA[x], padding);
+		free_padding(yuvB[x], padding);
+	}
+	free_padding(rgbA, padding);
+	free_padding(rgbB, padding);
+	return rc;
+}
+
 static BOOL TestPrimitiveYUV(primitives_t* prims, prim_size_t roi, BOOL use444)
 {
 	union
@@ -965,6 +1088,24 @@ int TestPrimitivesYUV(int argc, char* argv[])
 			goto end;
 		}
 
+		printf("---------------------- END --------------------------\n");
+		printf("-------------------- GENERIC ------------------------\n");
+
+		if (!TestPrimitiveYUVCombineToRGB(generic, roi))
+		{
+			printf("TestPrimitiveYUVCombineToRGB failed.\n");
+			goto end;
+		}
+
+		printf("---------------------- END --------------------------\n");
+		printf("------------------- OPTIMIZED -----------------------\n");
+
+		if (!TestPrimitiveYUVCombineToRGB(prims, roi))
+		{
+			printf("TestPrimitiveYUVCombineToRGB failed.\n");
+			goto end;
+		}
+
 		printf("---------------------- END --------------------------\n");
 		printf("------------------- OPTIMIZED -----------------------\n");
 
@@ -0,0 +1,838 @@
+/* prim_bench.c
+ * Per backend benchmark of all primitives.
+ * vi:ts=4 sw=4
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0.
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express
+ * or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/* Times every primitives_t function of every backend that is available on this
+ * machine on frame (and RemoteFX tile) sized input and prints a table. The SSE,
+ * AVX2 and NEON tables are built the way primitives_init_optimized does, but stop
+ * at the respective instruction set, so they can be told apart.
+ *
+ * With --autotune the fastest implementation of each function is picked and the
+ * resulting table is compared against the one primitives_get() selected. */
+
+#include <freerdp/config.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <winpr/crt.h>
+#include <winpr/crypto.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/primitives.h>
+#include <freerdp/codec/color.h>
+
+#include "../prim_internal.h"
+#include "../prim_YCoCg.h"
+#include "../prim_YUV.h"
+#include "../prim_add.h"
+#include "../prim_alphaComp.h"
+#include "../prim_andor.h"
+#include "../prim_audio.h"
+#include "../prim_colors.h"
+#include "../prim_copy.h"
+#include "../prim_planar.h"
+#include "../prim_scale.h"
+#include "../prim_set.h"
+#include "../prim_shift.h"
+#include "../prim_sign.h"
+
+/* RemoteFX works on 64x64 tiles */
+#define BENCH_TILE_SIZE (64 * 64)
+
+typedef enum
+{
+	BENCH_GENERIC,
+	BENCH_SSE,
+	BENCH_AVX2,
+	BENCH_NEON,
+	BENCH_OPENCL,
+	BENCH_BACKEND_COUNT
+} BenchBackendType;
+
+typedef struct
+{
+	const char* name;
+	BOOL available;
+	primitives_t prims;
+} BenchBackend;
+
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 stride;
+	BYTE* frame[3];
+	BYTE* plane[3][4];
+	INT16* tile[2][3];
+} BenchData;
+
+typedef void (*bench_fn)(void);
+typedef pstatus_t (*bench_call)(const primitives_t* prims, BenchData* data);
+
+typedef struct
+{
+	const char* name;
+	size_t offset;
+	bench_call call;
+	BOOL tile;
+} BenchPrimitive;
+
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	UINT32 timeMs;
+	const char* filter;
+	BOOL csv;
+	BOOL autotune;
+} BenchConfig;
+
+/* ------------------------------------------------------------------------- */
+static pstatus_t bench_copy(const primitives_t* prims, BenchData* data)
+{
+	return prims->copy(data->frame[0], data->frame[2], (INT32)(data->stride * data->height));
+}
+
+static pstatus_t bench_copy_8u(const primitives_t* prims, BenchData* data)
+{
+	return prims->copy_8u(data->frame[0], data->frame[2], (INT32)(data->stride * data->height));
+}
+
+static pstatus_t bench_copy_8u_AC4r(const primitives_t* prims, BenchData* data)
+{
+	return prims->copy_8u_AC4r(data->frame[0], (INT32)data->stride, data->frame[2],
+	                           (INT32)data->stride, (INT32)data->width, (INT32)data->height);
+}
+
+static pstatus_t bench_copy_no_overlap(const primitives_t* prims, BenchData* data)
+{
+	return prims->copy_no_overlap(data->frame[2], PIXEL_FORMAT_RGBX32, data->stride, 0, 0,
+	                              data->width, data->height, data->frame[0],
+	                              PIXEL_FORMAT_BGRX32, data->stride, 0, 0, NULL,
+	                              FREERDP_FLIP_NONE);
+}
+
+static pstatus_t bench_set_8u(const primitives_t* prims, BenchData* data)
+{
+	return prims->set_8u(0xA5, data->frame[2], data->stride * data->height);
+}
+
+static pstatus_t bench_set_32s(const primitives_t* prims, BenchData* data)
+{
+	return prims->set_32s(-42, (INT32*)data->frame[2], data->width * data->height);
+}
+
+static pstatus_t bench_set_32u(const primitives_t* prims, BenchData* data)
+{
+	return prims->set_32u(0xFF00FF00, (UINT32*)data->frame[2], data->width * data->height);
+}
+
+static pstatus_t bench_zero(const primitives_t* prims, BenchData* data)
+{
+	return prims->zero(data->frame[2], 1ULL * data->stride * data->height);
+}
+
+static pstatus_t bench_add_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->add_16s(data->tile[0][0], data->tile[0][1], data->tile[1][0], BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_add_16s_inplace(const primitives_t* prims, BenchData* data)
+{
+	return prims->add_16s_inplace(data->tile[1][0], data->tile[1][1], BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_andC_32u(const primitives_t* prims, BenchData* data)
+{
+	return prims->andC_32u((const UINT32*)data->frame[0], 0x00FFFFFF, (UINT32*)data->frame[2],
+	                       (INT32)(data->width * data->height));
+}
+
+static pstatus_t bench_orC_32u(const primitives_t* prims, BenchData* data)
+{
+	return prims->orC_32u((const UINT32*)data->frame[0], 0xFF000000, (UINT32*)data->frame[2],
+	                      (INT32)(data->width * data->height));
+}
+
+static pstatus_t bench_xorC_32u(const primitives_t* prims, BenchData* data)
+{
+	return prims->xorC_32u((const UINT32*)data->frame[0], 0x00FFFFFF, (UINT32*)data->frame[2],
+	                       (INT32)(data->width * data->height));
+}
+
+static pstatus_t bench_lShiftC_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->lShiftC_16s(data->tile[0][0], 5, data->tile[1][0], BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_lShiftC_16s_inplace(const primitives_t* prims, BenchData* data)
+{
+	return prims->lShiftC_16s_inplace(data->tile[1][0], 5, BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_lShiftC_16u(const primitives_t* prims, BenchData* data)
+{
+	return prims->lShiftC_16u((const UINT16*)data->tile[0][0], 5, (UINT16*)data->tile[1][0],
+	                          BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_rShiftC_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->rShiftC_16s(data->tile[0][0], 5, data->tile[1][0], BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_rShiftC_16u(const primitives_t* prims, BenchData* data)
+{
+	return prims->rShiftC_16u((const UINT16*)data->tile[0][0], 5, (UINT16*)data->tile[1][0],
+	                          BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_shiftC_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->shiftC_16s(data->tile[0][0], -5, data->tile[1][0], BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_shiftC_16u(const primitives_t* prims, BenchData* data)
+{
+	return prims->shiftC_16u((const UINT16*)data->tile[0][0], -5, (UINT16*)data->tile[1][0],
+	                         BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_alphaComp_argb(const primitives_t* prims, BenchData* data)
+{
+	return prims->alphaComp_argb(data->frame[0], data->stride, data->frame[1], data->stride,
+	                             data->frame[2], data->stride, data->width, data->height);
+}
+
+static pstatus_t bench_sign_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->sign_16s(data->tile[0][0], data->tile[1][0], BENCH_TILE_SIZE);
+}
+
+static pstatus_t bench_yCbCrToRGB_16s8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	const INT16* src[3] = { data->tile[0][0], data->tile[0][1], data->tile[0][2] };
+	const prim_size_t roi = { 64, 64 };
+	return prims->yCbCrToRGB_16s8u_P3AC4R(src, 64 * sizeof(INT16), data->frame[2], data->stride,
+	                                      PIXEL_FORMAT_BGRX32, &roi);
+}
+
+static pstatus_t bench_yCbCrToRGB_16s16s_P3P3(const primitives_t* prims, BenchData* data)
+{
+	const INT16* src[3] = { data->tile[0][0], data->tile[0][1], data->tile[0][2] };
+	INT16* dst[3] = { data->tile[1][0], data->tile[1][1], data->tile[1][2] };
+	const prim_size_t roi = { 64, 64 };
+	return prims->yCbCrToRGB_16s16s_P3P3(src, 64 * sizeof(INT16), dst, 64 * sizeof(INT16), &roi);
+}
+
+static pstatus_t bench_RGBToYCbCr_16s16s_P3P3(const primitives_t* prims, BenchData* data)
+{
+	const INT16* src[3] = { data->tile[0][0], data->tile[0][1], data->tile[0][2] };
+	INT16* dst[3] = { data->tile[1][0], data->tile[1][1], data->tile[1][2] };
+	const prim_size_t roi = { 64, 64 };
+	return prims->RGBToYCbCr_16s16s_P3P3(src, 64 * sizeof(INT16), dst, 64 * sizeof(INT16), &roi);
+}
+
+static pstatus_t bench_RGBToRGB_16s8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	const INT16* src[3] = { data->tile[0][0], data->tile[0][1], data->tile[0][2] };
+	const prim_size_t roi = { 64, 64 };
+	return prims->RGBToRGB_16s8u_P3AC4R(src, 64 * sizeof(INT16), data->frame[2], data->stride,
+	                                    PIXEL_FORMAT_BGRX32, &roi);
+}
+
+static pstatus_t bench_YCoCgToRGB_8u_AC4R(const primitives_t* prims, BenchData* data)
+{
+	return prims->YCoCgToRGB_8u_AC4R(data->frame[0], (INT32)data->stride, data->frame[2],
+	                                 PIXEL_FORMAT_BGRX32, (INT32)data->stride, data->width,
+	                                 data->height, 1, FALSE);
+}
+
+static pstatus_t bench_YUV420ToRGB_8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	const BYTE* src[3] = { data->plane[0][0], data->plane[0][1], data->plane[0][2] };
+	const UINT32 step[3] = { data->width, data->width / 2, data->width / 2 };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->YUV420ToRGB_8u_P3AC4R(src, step, data->frame[2], data->stride,
+	                                    PIXEL_FORMAT_BGRX32, &roi);
+}
+
+static pstatus_t bench_YUV444ToRGB_8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	const BYTE* src[3] = { data->plane[0][0], data->plane[0][1], data->plane[0][2] };
+	const UINT32 step[3] = { data->width, data->width, data->width };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->YUV444ToRGB_8u_P3AC4R(src, step, data->frame[2], data->stride,
+	                                    PIXEL_FORMAT_BGRX32, &roi);
+}
+
+static pstatus_t bench_RGBToYUV420_8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	BYTE* dst[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	const UINT32 step[3] = { data->width, data->width / 2, data->width / 2 };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->RGBToYUV420_8u_P3AC4R(data->frame[0], PIXEL_FORMAT_BGRX32, data->stride, dst,
+	                                    step, &roi);
+}
+
+static pstatus_t bench_RGBToYUV444_8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	BYTE* dst[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	UINT32 step[3] = { data->width, data->width, data->width };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->RGBToYUV444_8u_P3AC4R(data->frame[0], PIXEL_FORMAT_BGRX32, data->stride, dst,
+	                                    step, &roi);
+}
+
+static pstatus_t bench_YUV420CombineToYUV444(const primitives_t* prims, BenchData* data)
+{
+	const BYTE* src[3] = { data->plane[0][0], data->plane[0][1], data->plane[0][2] };
+	BYTE* dst[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	const UINT32 srcStep[3] = { data->width, data->width / 2, data->width / 2 };
+	const UINT32 dstStep[3] = { data->width, data->width, data->width };
+	const RECTANGLE_16 roi = { 0, 0, (UINT16)data->width, (UINT16)data->height };
+	return prims->YUV420CombineToYUV444(AVC444_CHROMAv1, src, srcStep, data->width, data->height,
+	                                    dst, dstStep, &roi);
+}
+
+static pstatus_t bench_YUV420CombineToRGB_8u_P3AC4R(const primitives_t* prims, BenchData* data)
+{
+	const BYTE* src[3] = { data->plane[0][0], data->plane[0][1], data->plane[0][2] };
+	BYTE* yuv[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	const UINT32 srcStep[3] = { data->width, data->width / 2, data->width / 2 };
+	const UINT32 yuvStep[3] = { data->width, data->width, data->width };
+	const RECTANGLE_16 roi = { 0, 0, (UINT16)data->width, (UINT16)data->height };
+	return prims->YUV420CombineToRGB_8u_P3AC4R(AVC444_CHROMAv1, src, srcStep, data->width,
+	                                           data->height, yuv, yuvStep, data->frame[2],
+	                                           data->stride, PIXEL_FORMAT_BGRX32, &roi);
+}
+
+static pstatus_t bench_YUV444SplitToYUV420(const primitives_t* prims, BenchData* data)
+{
+	const BYTE* src[3] = { data->plane[0][0], data->plane[0][1], data->plane[0][2] };
+	BYTE* main[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	BYTE* aux[3] = { data->plane[2][0], data->plane[2][1], data->plane[2][2] };
+	const UINT32 srcStep[3] = { data->width, data->width, data->width };
+	const UINT32 dstStep[3] = { data->width, data->width / 2, data->width / 2 };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->YUV444SplitToYUV420(src, srcStep, main, dstStep, aux, dstStep, &roi);
+}
+
+static pstatus_t bench_RGBToAVC444YUV(const primitives_t* prims, BenchData* data)
+{
+	BYTE* main[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	BYTE* aux[3] = { data->plane[2][0], data->plane[2][1], data->plane[2][2] };
+	const UINT32 step[3] = { data->width, data->width / 2, data->width / 2 };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->RGBToAVC444YUV(data->frame[0], PIXEL_FORMAT_BGRX32, data->stride, main, step,
+	                             aux, step, &roi);
+}
+
+static pstatus_t bench_RGBToAVC444YUVv2(const primitives_t* prims, BenchData* data)
+{
+	BYTE* main[3] = { data->plane[1][0], data->plane[1][1], data->plane[1][2] };
+	BYTE* aux[3] = { data->plane[2][0], data->plane[2][1], data->plane[2][2] };
+	const UINT32 step[3] = { data->width, data->width / 2, data->width / 2 };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->RGBToAVC444YUVv2(data->frame[0], PIXEL_FORMAT_BGRX32, data->stride, main, step,
+	                               aux, step, &roi);
+}
+
+static pstatus_t bench_scale_8u_AC4R(const primitives_t* prims, BenchData* data)
+{
+	/* smart sizing a session to three quarters of its size */
+	const prim_size_t srcRoi = { data->width, data->height };
+	const prim_size_t dstRoi = { data->width * 3 / 4, data->height * 3 / 4 };
+	return prims->scale_8u_AC4R(data->frame[0], data->stride, &srcRoi, data->frame[2],
+	                            data->stride, &dstRoi);
+}
+
+static pstatus_t bench_RGBToPlanes_8u_AC4P4R(const primitives_t* prims, BenchData* data)
+{
+	BYTE* dst[4] = { data->plane[1][0], data->plane[1][1], data->plane[1][2], data->plane[1][3] };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->RGBToPlanes_8u_AC4P4R(data->frame[0], data->stride, PIXEL_FORMAT_BGRA32, dst,
+	                                    data->width, &roi);
+}
+
+static pstatus_t bench_PlanesToRGB_8u_P4AC4R(const primitives_t* prims, BenchData* data)
+{
+	const BYTE* src[4] = { data->plane[0][0], data->plane[0][1], data->plane[0][2],
+		                   data->plane[0][3] };
+	const prim_size_t roi = { data->width, data->height };
+	return prims->PlanesToRGB_8u_P4AC4R(src, data->width, data->frame[2], data->stride,
+	                                    PIXEL_FORMAT_BGRA32, &roi);
+}
+
+static pstatus_t bench_deltaSignEncode_8u(const primitives_t* prims, BenchData* data)
+{
+	return prims->deltaSignEncode_8u(&data->plane[0][0][data->width], data->plane[0][0],
+	                                 data->plane[1][0], data->width * (data->height - 1));
+}
+
+/* a 32bpp frame holds one stereo 16bit sample per pixel */
+static pstatus_t bench_monoToStereo_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->monoToStereo_16s((const INT16*)data->frame[0], (INT16*)data->frame[2],
+	                               data->width * data->height);
+}
+
+static pstatus_t bench_stereoToMono_16s(const primitives_t* prims, BenchData* data)
+{
+	return prims->stereoToMono_16s((const INT16*)data->frame[0], (INT16*)data->frame[2],
+	                               data->width * data->height);
+}
+
+#define BENCH_ENTRY(name, tile) { #name, offsetof(primitives_t, name), bench_##name, tile }
+
+static const BenchPrimitive bench_primitives[] = {
+	BENCH_ENTRY(copy, FALSE),
+	BENCH_ENTRY(copy_8u, FALSE),
+	BENCH_ENTRY(copy_8u_AC4r, FALSE),
+	BENCH_ENTRY(copy_no_overlap, FALSE),
+	BENCH_ENTRY(set_8u, FALSE),
+	BENCH_ENTRY(set_32s, FALSE),
+	BENCH_ENTRY(set_32u, FALSE),
+	BENCH_ENTRY(zero, FALSE),
+	BENCH_ENTRY(add_16s, TRUE),
+	BENCH_ENTRY(add_16s_inplace, TRUE),
+	BENCH_ENTRY(andC_32u, FALSE),
+	BENCH_ENTRY(orC_32u, FALSE),
+	BENCH_ENTRY(xorC_32u, FALSE),
+	BENCH_ENTRY(lShiftC_16s, TRUE),
+	BENCH_ENTRY(lShiftC_16s_inplace, TRUE),
+	BENCH_ENTRY(lShiftC_16u, TRUE),
+	BENCH_ENTRY(rShiftC_16s, TRUE),
+	BENCH_ENTRY(rShiftC_16u, TRUE),
+	BENCH_ENTRY(shiftC_16s, TRUE),
+	BENCH_ENTRY(shiftC_16u, TRUE),
+	BENCH_ENTRY(alphaComp_argb, FALSE),
+	BENCH_ENTRY(sign_16s, TRUE),
+	BENCH_ENTRY(yCbCrToRGB_16s8u_P3AC4R, TRUE),
+	BENCH_ENTRY(yCbCrToRGB_16s16s_P3P3, TRUE),
+	BENCH_ENTRY(RGBToYCbCr_16s16s_P3P3, TRUE),
+	BENCH_ENTRY(RGBToRGB_16s8u_P3AC4R, TRUE),
+	BENCH_ENTRY(YCoCgToRGB_8u_AC4R, FALSE),
+	BENCH_ENTRY(YUV420ToRGB_8u_P3AC4R, FALSE),
+	BENCH_ENTRY(YUV444ToRGB_8u_P3AC4R, FALSE),
+	BENCH_ENTRY(RGBToYUV420_8u_P3AC4R, FALSE),
+	BENCH_ENTRY(RGBToYUV444_8u_P3AC4R, FALSE),
+	BENCH_ENTRY(YUV420CombineToYUV444, FALSE),
+	BENCH_ENTRY(YUV420CombineToRGB_8u_P3AC4R, FALSE),
+	BENCH_ENTRY(YUV444SplitToYUV420, FALSE),
+	BENCH_ENTRY(RGBToAVC444YUV, FALSE),
+	BENCH_ENTRY(RGBToAVC444YUVv2, FALSE),
+	BENCH_ENTRY(scale_8u_AC4R, FALSE),
+	BENCH_ENTRY(RGBToPlanes_8u_AC4P4R, FALSE),
+	BENCH_ENTRY(PlanesToRGB_8u_P4AC4R, FALSE),
+	BENCH_ENTRY(deltaSignEncode_8u, FALSE),
+	BENCH_ENTRY(monoToStereo_16s, FALSE),
+	BENCH_ENTRY(stereoToMono_16s, FALSE),
+};
+
+/* ------------------------------------------------------------------------- */
+static bench_fn bench_get_fn(const primitives_t* prims, size_t offset)
+{
+	bench_fn fn = NULL;
+	memcpy((void*)&fn, ((const BYTE*)prims) + offset, sizeof(fn));
+	return fn;
+}
+
+static void bench_set_fn(primitives_t* prims, size_t offset, bench_fn fn)
+{
+	memcpy(((BYTE*)prims) + offset, (const void*)&fn, sizeof(fn));
+}
+
+static void bench_init_sse(primitives_t* prims)
+{
+	primitives_init_add_sse3(prims);
+	primitives_init_andor_sse3(prims);
+	primitives_init_alphaComp_sse3(prims);
+	primitives_init_copy_sse41(prims);
+	primitives_init_set_sse2(prims);
+	primitives_init_shift_sse3(prims);
+	primitives_init_sign_ssse3(prims);
+	primitives_init_colors_sse2(prims);
+	primitives_init_YCoCg_ssse3(prims);
+	primitives_init_YUV_ssse3(prims);
+	primitives_init_scale_sse2(prims);
+	primitives_init_planar_sse2(prims);
+	primitives_init_audio_sse2(prims);
+}
+
+static void bench_init_avx2(primitives_t* prims)
+{
+#if defined(WITH_AVX2)
+	primitives_init_andor_avx2(prims);
+	primitives_init_copy_avx2(prims);
+	primitives_init_YUV_avx2(prims);
+#else
+	WINPR_UNUSED(prims);
+#endif
+}
+
+static void bench_init_neon(primitives_t* prims)
+{
+	primitives_init_andor_neon(prims);
+	primitives_init_colors_neon(prims);
+	primitives_init_YCoCg_neon(prims);
+	primitives_init_YUV_neon(prims);
+	primitives_init_scale_neon(prims);
+	primitives_init_planar_neon(prims);
+	primitives_init_audio_neon(prims);
+}
+
+static void bench_backends_init(BenchBackend backends[BENCH_BACKEND_COUNT])
+{
+	const primitives_t* generic = primitives_get_generic();
+	BenchBackend* sse = &backends[BENCH_SSE];
+	BenchBackend* avx2 = &backends[BENCH_AVX2];
+	BenchBackend* neon = &backends[BENCH_NEON];
+	BenchBackend* opencl = &backends[BENCH_OPENCL];
+
+	backends[BENCH_GENERIC].name = "generic";
+	backends[BENCH_GENERIC].prims = *generic;
+	backends[BENCH_GENERIC].available = TRUE;
+
+	/* the instruction set init functions are no-ops if not compiled in or not supported */
+	sse->name = "sse";
+	sse->prims = *generic;
+	bench_init_sse(&sse->prims);
+	sse->available = memcmp(&sse->prims, generic, sizeof(primitives_t)) != 0;
+
+	avx2->name = "avx2";
+	avx2->prims = sse->prims;
+	bench_init_avx2(&avx2->prims);
+	avx2->available = memcmp(&avx2->prims, &sse->prims, sizeof(primitives_t)) != 0;
+
+	neon->name = "neon";
+	neon->prims = *generic;
+	bench_init_neon(&neon->prims);
+	neon->available = memcmp(&neon->prims, generic, sizeof(primitives_t)) != 0;
+
+	/* without OpenCL support this falls back to the CPU or generic table */
+	const primitives_t* gpu = primitives_get_by_type(PRIMITIVES_ONLY_GPU);
+	opencl->name = "opencl";
+	opencl->available = gpu && ((primitives_flags((primitives_t*)gpu) & PRIM_FLAGS_HAVE_EXTGPU) != 0);
+	if (opencl->available)
+		opencl->prims = *gpu;
+}
+
+/* ------------------------------------------------------------------------- */
+static void bench_data_free(BenchData* data)
+{
+	for (size_t x = 0; x < ARRAYSIZE(data->frame); x++)
+		winpr_aligned_free(data->frame[x]);
+
+	for (size_t x = 0; x < ARRAYSIZE(data->plane); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(data->plane[x]); y++)
+			winpr_aligned_free(data->plane[x][y]);
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(data->tile); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(data->tile[x]); y++)
+			winpr_aligned_free(data->tile[x][y]);
+	}
+}
+
+static BOOL bench_data_init(BenchData* data, UINT32 width, UINT32 height)
+{
+	data->width = width;
+	data->height = height;
+	data->stride = width * 4;
+
+	for (size_t x = 0; x < ARRAYSIZE(data->frame); x++)
+	{
+		data->frame[x] = winpr_aligned_malloc(1ULL * data->stride * height, 32);
+		if (!data->frame[x])
+			return FALSE;
+		winpr_RAND(data->frame[x], 1ULL * data->stride * height);
+	}
+
+	/* the AVC444 auxiliary frame is read up to the next multiple of 16 lines */
+	for (size_t x = 0; x < ARRAYSIZE(data->plane); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(data->plane[x]); y++)
+		{
+			data->plane[x][y] = winpr_aligned_malloc(1ULL * width * (height + 16), 32);
+			if (!data->plane[x][y])
+				return FALSE;
+			winpr_RAND(data->plane[x][y], 1ULL * width * (height + 16));
+		}
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(data->tile); x++)
+	{
+		for (size_t y = 0; y < ARRAYSIZE(data->tile[x]); y++)
+		{
+			INT16* tile = winpr_aligned_malloc(BENCH_TILE_SIZE * sizeof(INT16), 32);
+			data->tile[x][y] = tile;
+			if (!tile)
+				return FALSE;
+
+			/* the range of dequantized RemoteFX coefficients */
+			for (size_t i = 0; i < BENCH_TILE_SIZE; i++)
+			{
+				UINT16 r = 0;
+				winpr_RAND(&r, sizeof(r));
+				tile[i] = (INT16)((r % 8192) - 4096);
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/* Returns the nanoseconds per call, or 0 on failure */
+static UINT64 bench_run(const BenchPrimitive* primitive, const primitives_t* prims,
+                        BenchData* data, UINT32 timeMs)
+{
+	UINT64 calls = 0;
+
+	/* warm up caches and lazily initialized state */
+	if (primitive->call(prims, data) != PRIMITIVES_SUCCESS)
+		return 0;
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const UINT64 due = start + 1000000ULL * timeMs;
+	UINT64 now = start;
+
+	do
+	{
+		for (size_t x = 0; x < 8; x++)
+		{
+			if (primitive->call(prims, data) != PRIMITIVES_SUCCESS)
+				return 0;
+		}
+		calls += 8;
+		now = winpr_GetTickCount64NS();
+	} while (now < due);
+
+	return MAX(1, (now - start) / calls);
+}
+
+static const char* bench_workload(const BenchPrimitive* primitive, const BenchData* data,
+                                  char* buffer, size_t size)
+{
+	if (primitive->tile)
+		(void)_snprintf(buffer, size, "64x64 tile");
+	else
+		(void)_snprintf(buffer, size, "%" PRIu32 "x%" PRIu32, data->width, data->height);
+	return buffer;
+}
+
+static void bench_usage(const char* name)
+{
+	printf("Usage: %s [options]\n", name);
+	printf("  -s, --size <w>x<h>     frame size, rounded down to even values (default "
+	       "1920x1080)\n");
+	printf("  -t, --time <ms>        time per function and backend (default 100)\n");
+	printf("  -p, --primitive <name> only functions containing name\n");
+	printf("  -a, --autotune         pick the fastest backend per function\n");
+	printf("  -c, --csv              print comma separated values\n");
+}
+
+static int bench_parse(BenchConfig* config, int argc, char* argv[])
+{
+	for (int x = 1; x < argc; x++)
+	{
+		const char* arg = argv[x];
+		const char* value = (x + 1 < argc) ? argv[x + 1] : NULL;
+
+		if ((strcmp(arg, "-h") == 0) || (strcmp(arg, "--help") == 0))
+			return 0;
+		else if ((strcmp(arg, "-a") == 0) || (strcmp(arg, "--autotune") == 0))
+			config->autotune = TRUE;
+		else if ((strcmp(arg, "-c") == 0) || (strcmp(arg, "--csv") == 0))
+			config->csv = TRUE;
+		else if ((strcmp(arg, "-s") == 0) || (strcmp(arg, "--size") == 0))
+		{
+			unsigned w = 0;
+			unsigned h = 0;
+
+			if (!value || (sscanf(value, "%ux%u", &w, &h) != 2) || (w < 64) || (h < 64) ||
+			    (w > 8192) || (h > 8192))
+				return -1;
+			config->width = w & ~1u;
+			config->height = h & ~1u;
+			x++;
+		}
+		else if ((strcmp(arg, "-t") == 0) || (strcmp(arg, "--time") == 0))
+		{
+			unsigned ms = 0;
+
+			if (!value || (sscanf(value, "%u", &ms) != 1) || (ms < 1) || (ms > 60000))
+				return -1;
+			config->timeMs = ms;
+			x++;
+		}
+		else if ((strcmp(arg, "-p") == 0) || (strcmp(arg, "--primitive") == 0))
+		{
+			if (!value)
+				return -1;
+			config->filter = value;
+			x++;
+		}
+		else
+			return -1;
+	}
+
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	int rc = -1;
+	BenchData data = { 0 };
+	BenchConfig config = { 1920, 1080, 100, NULL, FALSE, FALSE };
+	BenchBackend backends[BENCH_BACKEND_COUNT] = { 0 };
+
+	const int status = bench_parse(&config, argc, argv);
+	if (status <= 0)
+	{
+		bench_usage(argv[0]);
+		return (status == 0) ? 0 : -1;
+	}
+
+	bench_backends_init(backends);
+	if (!bench_data_init(&data, config.width, config.height))
+		goto fail;
+
+	primitives_t tuned = *primitives_get();
+	const primitives_t* selected = primitives_get();
+	UINT64 tunedNs = 0;
+	UINT64 selectedNs = 0;
+
+	if (config.csv)
+		printf("function,workload,backend,ns_per_call\n");
+	else
+	{
+		printf("%-30s %-12s", "function", "workload");
+		for (size_t b = 0; b < BENCH_BACKEND_COUNT; b++)
+		{
+			if (backends[b].available)
+				printf(" %10s", backends[b].name);
+		}
+		printf("  %s\n", "fastest");
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(bench_primitives); x++)
+	{
+		const BenchPrimitive* primitive = &bench_primitives[x];
+		UINT64 ns[BENCH_BACKEND_COUNT] = { 0 };
+		size_t best = BENCH_GENERIC;
+		char workload[32] = { 0 };
+
+		if (config.filter && !strstr(primitive->name, config.filter))
+			continue;
+
+		bench_workload(primitive, &data, workload, sizeof(workload));
+
+		for (size_t b = 0; b < BENCH_BACKEND_COUNT; b++)
+		{
+			const BenchBackend* backend = &backends[b];
+			const bench_fn fn = bench_get_fn(&backend->prims, primitive->offset);
+			BOOL duplicate = FALSE;
+
+			if (!backend->available)
+				continue;
+
+			/* a backend without its own implementation keeps the one of an earlier table */
+			for (size_t o = 0; o < b; o++)
+			{
+				if (backends[o].available &&
+				    (bench_get_fn(&backends[o].prims, primitive->offset) == fn))
+					duplicate = TRUE;
+			}
+
+			if (duplicate)
+				continue;
+
+			ns[b] = bench_run(primitive, &backend->prims, &data, config.timeMs);
+			if ((ns[b] > 0) && ((ns[best] == 0) || (ns[b] < ns[best])))
+				best = b;
+
+			if (config.csv)
+				printf("%s,%s,%s,%" PRIu64 "\n", primitive->name, workload, backend->name,
+				       ns[b]);
+		}
+
+		if (!config.csv)
+		{
+			printf("%-30s %-12s", primitive->name, workload);
+			for (size_t b = 0; b < BENCH_BACKEND_COUNT; b++)
+			{
+				if (!backends[b].available)
+					continue;
+				if (ns[b] == 0)
+					printf(" %10s", "-");
+				else
+					printf(" %8.1fus", (double)ns[b] / 1000.0);
+			}
+			printf("  %s\n", backends[best].name);
+		}
+
+		if (config.autotune)
+		{
+			const bench_fn fn = bench_get_fn(selected, primitive->offset);
+
+			bench_set_fn(&tuned, primitive->offset, bench_get_fn(&backends[best].prims,
+			                                                     primitive->offset));
+			tunedNs += ns[best];
+
+			/* the time of the implementation primitives_get() selected */
+			for (size_t b = 0; b < BENCH_BACKEND_COUNT; b++)
+			{
+				if (backends[b].available && (ns[b] > 0) &&
+				    (bench_get_fn(&backends[b].prims, primitive->offset) == fn))
+				{
+					selectedNs += ns[b];
+					break;
+				}
+			}
+		}
+	}
+
+	if (config.autotune && !config.csv)
+	{
+		size_t changed = 0;
+
+		printf("\nautotuned table differs from primitives_get() in:\n");
+		for (size_t x = 0; x < ARRAYSIZE(bench_primitives); x++)
+		{
+			const BenchPrimitive* primitive = &bench_primitives[x];
+			if (bench_get_fn(&tuned, primitive->offset) !=
+			    bench_get_fn(selected, primitive->offset))
+			{
+				printf("  %s\n", primitive->name);
+				changed++;
+			}
+		}
+
+		if (changed == 0)
+			printf("  nothing, the selected implementations are the fastest\n");
+		else if (tunedNs > 0)
+			printf("sum of call times: %.1fus selected, %.1fus autotuned\n",
+			       (double)selectedNs / 1000.0, (double)tunedNs / 1000.0);
+	}
+
+	rc = 0;
+fail:
+	bench_data_free(&data);
+	primitives_uninit();
+	return rc;
+}
@@ -22,11 +22,49 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/file.h>
+#include <winpr/environment.h>
+
 #include <freerdp/utils/profiler.h>
 #include <freerdp/log.h>
 
 #define TAG FREERDP_TAG("utils")
 
+/* if set, every profiler_exit is also written as a Chrome trace event to this file */
+#define PROFILER_TRACE_ENV "FREERDP_PROFILER_TRACE"
+
+static INIT_ONCE profiler_trace_once = INIT_ONCE_STATIC_INIT;
+static FILE* profiler_trace = NULL;
+
+static BOOL CALLBACK profiler_trace_init_cb(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+	WINPR_UNUSED(once);
+	WINPR_UNUSED(param);
+	WINPR_UNUSED(context);
+
+	const DWORD size = GetEnvironmentVariableA(PROFILER_TRACE_ENV, NULL, 0);
+	if (size == 0)
+		return TRUE;
+
+	char* file = calloc(size, sizeof(char));
+	if (!file)
+		return TRUE;
+
+	if (GetEnvironmentVariableA(PROFILER_TRACE_ENV, file, size) == size - 1)
+	{
+		/* JSON array format, the viewers accept the array left open at exit */
+		profiler_trace = winpr_fopen(file, "w");
+		if (profiler_trace)
+			(void)fprintf(profiler_trace, "[\n");
+		else
+			WLog_WARN(TAG, "failed to open profiler trace file %s", file);
+	}
+	free(file);
+	return TRUE;
+}
+
 struct S_PROFILER
 {
 	char* name;
@@ -40,6 +78,8 @@ PROFILER* profiler_create(const char* name)
 	if (!profiler)
 		return NULL;
 
+	InitOnceExecuteOnce(&profiler_trace_once, profiler_trace_init_cb, NULL, NULL);
+
 	profiler->name = _strdup(name);
 	profiler->stopwatch = stopwatch_create();
 
@@ -71,6 +111,16 @@ void profiler_enter(PROFILER* profiler)
 void profiler_exit(PROFILER* profiler)
 {
 	stopwatch_stop(profiler->stopwatch);
+
+	if (profiler_trace)
+	{
+		const STOPWATCH* sw = profiler->stopwatch;
+		(void)fprintf(profiler_trace,
+		              "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64
+		              ",\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 "},\n",
+		              profiler->name, sw->start, sw->end - sw->start, GetCurrentProcessId(),
+		              GetCurrentThreadId());
+	}
 }
 
 void profiler_print_header(void)
@@ -95,4 +145,7 @@ void profiler_print_footer(void)
 {
 	WLog_INFO(TAG,
 	          "-------------------------------+------------+-------------+-----------+-------");
+
+	if (profiler_trace)
+		(void)fflush(profiler_trace);
 }
@@ -31,6 +31,7 @@
 #include <winpr/print.h>
 #include <winpr/stream.h>
 #include <winpr/library.h>
+#include <winpr/sysinfo.h>
 #include <winpr/smartcard.h>
 
 #include <freerdp/freerdp.h>
@@ -71,6 +72,7 @@ struct s_scard_call_context
 	SCardApiFunctionTable WinSCardApi;
 	const SCardApiFunctionTable* pWinSCardApi;
 	HANDLE stopEvent;
+	wHashTable* readerStates;
 	void* userdata;
 
 	void* (*fn_new)(void*, SCARDCONTEXT);
@@ -83,6 +85,17 @@ struct s_scard_context_element
 	void (*fn_free)(void*);
 };
 
+/* zero timeout status polls are answered from the last known reader state this long, in ms */
+#define SMARTCARD_READER_STATE_CACHE_MS 100
+
+typedef struct
+{
+	UINT64 timestamp;
+	DWORD dwEventState;
+	DWORD cbAtr;
+	BYTE rgbAtr[36];
+} scard_reader_state;
+
 static void context_free(void* arg);
 
 static LONG smartcard_EstablishContext_Call(scard_call_context* smartcard, wStream* out,
@@ -888,6 +901,142 @@ static LONG smartcard_GetDeviceTypeId_Call(scard_call_context* smartcard, wStrea
 	return ret.ReturnCode;
 }
 
+static BOOL smartcard_reader_state_cacheable(const char* reader, DWORD dwCurrentState)
+{
+	if (!reader)
+		return FALSE;
+	/* the PnP pseudo reader reports the reader count, not a card state */
+	if (strncmp(reader, "\\\\?PnP?\\", 8) == 0)
+		return FALSE;
+	if (dwCurrentState == SCARD_STATE_UNAWARE)
+		return FALSE;
+	return (dwCurrentState & SCARD_STATE_IGNORE) == 0;
+}
+
+/**
+ * Answer a zero timeout poll for one reader from the cache. This only succeeds if the
+ * state the caller already knows equals the recently seen one, in which case PC/SC would
+ * report no change as well.
+ */
+static BOOL smartcard_reader_state_lookup(scard_call_context* smartcard, const char* reader,
+                                          DWORD dwCurrentState, LPDWORD pdwEventState,
+                                          LPDWORD pcbAtr, BYTE* rgbAtr)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(smartcard);
+
+	if (!smartcard_reader_state_cacheable(reader, dwCurrentState))
+		return FALSE;
+
+	HashTable_Lock(smartcard->readerStates);
+	const scard_reader_state* state = HashTable_GetItemValue(smartcard->readerStates, reader);
+	if (state && (GetTickCount64() - state->timestamp < SMARTCARD_READER_STATE_CACHE_MS) &&
+	    ((dwCurrentState & ~SCARD_STATE_CHANGED) == state->dwEventState))
+	{
+		*pdwEventState = state->dwEventState;
+		*pcbAtr = state->cbAtr;
+		CopyMemory(rgbAtr, state->rgbAtr, sizeof(state->rgbAtr));
+		rc = TRUE;
+	}
+	HashTable_Unlock(smartcard->readerStates);
+	return rc;
+}
+
+static void smartcard_reader_state_update(scard_call_context* smartcard, const char* reader,
+                                          DWORD dwCurrentState, DWORD dwEventState, DWORD cbAtr,
+                                          const BYTE* rgbAtr)
+{
+	WINPR_ASSERT(smartcard);
+
+	if (!smartcard_reader_state_cacheable(reader, dwCurrentState))
+		return;
+
+	HashTable_Lock(smartcard->readerStates);
+	scard_reader_state* state = HashTable_GetItemValue(smartcard->readerStates, reader);
+	if (!state)
+	{
+		state = calloc(1, sizeof(scard_reader_state));
+		if (state && !HashTable_Insert(smartcard->readerStates, reader, state))
+		{
+			free(state);
+			state = NULL;
+		}
+	}
+
+	if (state)
+	{
+		state->timestamp = GetTickCount64();
+		state->dwEventState = dwEventState & ~SCARD_STATE_CHANGED;
+		state->cbAtr = MIN(cbAtr, sizeof(state->rgbAtr));
+		CopyMemory(state->rgbAtr, rgbAtr, sizeof(state->rgbAtr));
+	}
+	HashTable_Unlock(smartcard->readerStates);
+}
+
+static BOOL smartcard_GetStatusChangeA_Cached(scard_call_context* smartcard,
+                                              const GetStatusChangeA_Call* call,
+                                              LPSCARD_READERSTATEA rgReaderStates)
+{
+	if ((call->dwTimeOut != 0) || (call->cReaders == 0))
+		return FALSE;
+
+	for (UINT32 x = 0; x < call->cReaders; x++)
+	{
+		LPSCARD_READERSTATEA cur = &rgReaderStates[x];
+		if (!smartcard_reader_state_lookup(smartcard, cur->szReader, cur->dwCurrentState,
+		                                   &cur->dwEventState, &cur->cbAtr, cur->rgbAtr))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOL smartcard_GetStatusChangeW_Cached(scard_call_context* smartcard,
+                                              const GetStatusChangeW_Call* call,
+                                              LPSCARD_READERSTATEW rgReaderStates)
+{
+	if ((call->dwTimeOut != 0) || (call->cReaders == 0))
+		return FALSE;
+
+	for (UINT32 x = 0; x < call->cReaders; x++)
+	{
+		LPSCARD_READERSTATEW cur = &rgReaderStates[x];
+		char* reader = ConvertWCharToUtf8Alloc(cur->szReader, NULL);
+		const BOOL hit = smartcard_reader_state_lookup(smartcard, reader, cur->dwCurrentState,
+		                                               &cur->dwEventState, &cur->cbAtr, cur->rgbAtr);
+		free(reader);
+		if (!hit)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void smartcard_GetStatusChangeA_Update(scard_call_context* smartcard,
+                                              const SCARD_READERSTATEA* rgReaderStates,
+                                              UINT32 cReaders)
+{
+	for (UINT32 x = 0; x < cReaders; x++)
+	{
+		const SCARD_READERSTATEA* cur = &rgReaderStates[x];
+		smartcard_reader_state_update(smartcard, cur->szReader, cur->dwCurrentState,
+		                              cur->dwEventState, cur->cbAtr, cur->rgbAtr);
+	}
+}
+
+static void smartcard_GetStatusChangeW_Update(scard_call_context* smartcard,
+                                              const SCARD_READERSTATEW* rgReaderStates,
+                                              UINT32 cReaders)
+{
+	for (UINT32 x = 0; x < cReaders; x++)
+	{
+		const SCARD_READERSTATEW* cur = &rgReaderStates[x];
+		char* reader = ConvertWCharToUtf8Alloc(cur->szReader, NULL);
+		smartcard_reader_state_update(smartcard, reader, cur->dwCurrentState, cur->dwEventState,
+		                              cur->cbAtr, cur->rgbAtr);
+		free(reader);
+	}
+}
+
 static LONG smartcard_GetStatusChangeA_Call(scard_call_context* smartcard, wStream* out,
                                             SMARTCARD_OPERATION* operation)
 {
@@ -912,21 +1061,30 @@ static LONG smartcard_GetStatusChangeA_Call(scard_call_context* smartcard, wStre
 		ret.rgReaderStates = (ReaderState_Return*)calloc(ret.cReaders, sizeof(ReaderState_Return));
 		if (!rgReaderStates || !ret.rgReaderStates)
 			goto fail;
+		memcpy(rgReaderStates, call->rgReaderStates, call->cReaders * sizeof(SCARD_READERSTATEA));
 	}
 
-	for (UINT32 x = 0; x < MAX(1, dwTimeOut);)
+	if (smartcard_GetStatusChangeA_Cached(smartcard, call, rgReaderStates))
+		ret.ReturnCode = SCARD_E_TIMEOUT;
+	else
 	{
-		if (call->cReaders > 0)
-			memcpy(rgReaderStates, call->rgReaderStates,
-			       call->cReaders * sizeof(SCARD_READERSTATEA));
-		ret.ReturnCode = wrap(smartcard, SCardGetStatusChangeA, operation->hContext,
-		                      MIN(dwTimeOut, dwTimeStep), rgReaderStates, call->cReaders);
-		if (ret.ReturnCode != SCARD_E_TIMEOUT)
-			break;
-		if (WaitForSingleObject(smartcard->stopEvent, 0) == WAIT_OBJECT_0)
-			break;
-		if (dwTimeOut != INFINITE)
-			x += dwTimeStep;
+		for (UINT32 x = 0; x < MAX(1, dwTimeOut);)
+		{
+			if (call->cReaders > 0)
+				memcpy(rgReaderStates, call->rgReaderStates,
+				       call->cReaders * sizeof(SCARD_READERSTATEA));
+			ret.ReturnCode = wrap(smartcard, SCardGetStatusChangeA, operation->hContext,
+			                      MIN(dwTimeOut, dwTimeStep), rgReaderStates, call->cReaders);
+			if (ret.ReturnCode != SCARD_E_TIMEOUT)
+				break;
+			if (WaitForSingleObject(smartcard->stopEvent, 0) == WAIT_OBJECT_0)
+				break;
+			if (dwTimeOut != INFINITE)
+				x += dwTimeStep;
+		}
+
+		if ((ret.ReturnCode == SCARD_S_SUCCESS) || (ret.ReturnCode == SCARD_E_TIMEOUT))
+			smartcard_GetStatusChangeA_Update(smartcard, rgReaderStates, call->cReaders);
 	}
 	scard_log_status_error(TAG, "SCardGetStatusChangeA", ret.ReturnCode);
 
@@ -974,23 +1132,30 @@ static LONG smartcard_GetStatusChangeW_Call(scard_call_context* smartcard, wStre
 		ret.rgReaderStates = (ReaderState_Return*)calloc(ret.cReaders, sizeof(ReaderState_Return));
 		if (!rgReaderStates || !ret.rgReaderStates)
 			goto fail;
+		memcpy(rgReaderStates, call->rgReaderStates, call->cReaders * sizeof(SCARD_READERSTATEW));
 	}
 
-	for (UINT32 x = 0; x < MAX(1, dwTimeOut);)
+	if (smartcard_GetStatusChangeW_Cached(smartcard, call, rgReaderStates))
+		ret.ReturnCode = SCARD_E_TIMEOUT;
+	else
 	{
-		if (call->cReaders > 0)
-			memcpy(rgReaderStates, call->rgReaderStates,
-			       call->cReaders * sizeof(SCARD_READERSTATEW));
+		for (UINT32 x = 0; x < MAX(1, dwTimeOut);)
 		{
+			if (call->cReaders > 0)
+				memcpy(rgReaderStates, call->rgReaderStates,
+				       call->cReaders * sizeof(SCARD_READERSTATEW));
 			ret.ReturnCode = wrap(smartcard, SCardGetStatusChangeW, operation->hContext,
 			                      MIN(dwTimeOut, dwTimeStep), rgReaderStates, call->cReaders);
+			if (ret.ReturnCode != SCARD_E_TIMEOUT)
+				break;
+			if (WaitForSingleObject(smartcard->stopEvent, 0) == WAIT_OBJECT_0)
+				break;
+			if (dwTimeOut != INFINITE)
+				x += dwTimeStep;
 		}
-		if (ret.ReturnCode != SCARD_E_TIMEOUT)
-			break;
-		if (WaitForSingleObject(smartcard->stopEvent, 0) == WAIT_OBJECT_0)
-			break;
-		if (dwTimeOut != INFINITE)
-			x += dwTimeStep;
+
+		if ((ret.ReturnCode == SCARD_S_SUCCESS) || (ret.ReturnCode == SCARD_E_TIMEOUT))
+			smartcard_GetStatusChangeW_Update(smartcard, rgReaderStates, call->cReaders);
 	}
 	scard_log_status_error(TAG, "SCardGetStatusChangeW", ret.ReturnCode);
 
@@ -1902,6 +2067,14 @@ scard_call_context* smartcard_call_context_new(const rdpSettings* settings)
 		}
 	}
 
+	ctx->readerStates = HashTable_New(TRUE);
+	if (!ctx->readerStates || !HashTable_SetupForStringData(ctx->readerStates, FALSE))
+		goto fail;
+
+	obj = HashTable_ValueObject(ctx->readerStates);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = free;
+
 	ctx->rgSCardContextList = HashTable_New(FALSE);
 	if (!ctx->rgSCardContextList)
 		goto fail;
@@ -1954,6 +2127,7 @@ void smartcard_call_context_free(scard_call_context* ctx)
 	ctx->pWinSCardApi = NULL;
 
 	HashTable_Free(ctx->rgSCardContextList);
+	HashTable_Free(ctx->readerStates);
 	(void)CloseHandle(ctx->stopEvent);
 	free(ctx);
 }
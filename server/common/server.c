@@ -45,6 +45,8 @@ size_t server_audin_get_formats(AUDIO_FORMAT** dst_formats)
 	BYTE adpcm_dvi_data_1[] = { 0xf9, 0x01 };
 	BYTE gsm610_data[] = { 0x40, 0x01 };
 	const AUDIO_FORMAT default_supported_audio_formats[] = {
+		/* Voice at 32 kbit/s, a fraction of PCM, only offered where opus is built in */
+		{ WAVE_FORMAT_OPUS, 1, 48000, 4000, 2, 16, 0, NULL },
 		/* Formats sent by windows 10 server */
 		{ WAVE_FORMAT_AAC_MS, 2, 44100, 24000, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_AAC_MS, 2, 44100, 20000, 4, 16, 0, NULL },
@@ -128,6 +130,7 @@ size_t server_rdpsnd_get_formats(AUDIO_FORMAT** dst_formats)
 	/* Default supported audio formats */
 	static const AUDIO_FORMAT default_supported_audio_formats[] = {
 		{ WAVE_FORMAT_AAC_MS, 2, 44100, 176400, 4, 16, 0, NULL },
+		{ WAVE_FORMAT_OPUS, 2, 48000, 192000, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_MPEGLAYER3, 2, 44100, 176400, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_MSG723, 2, 44100, 176400, 4, 16, 0, NULL },
 		{ WAVE_FORMAT_GSM610, 2, 44100, 176400, 4, 16, 0, NULL },
@@ -52,6 +52,7 @@ struct DynChannelTrackerState
 	UINT32 CurrentDataReceived;
 	UINT32 CurrentDataFragments;
 	wStream* currentPacket;
+	size_t accounted;
 	dynamic_channel_on_data_fn dataCallback;
 };
 
@@ -69,6 +70,7 @@ struct p_server_dynamic_channel_context
 
 	void* channelData;
 	channel_data_dtor_fn channelDataDtor;
+	proxyData* pdata;
 };
 
 /** @brief context for the dynamic channel */
@@ -155,6 +157,7 @@ static pServerDynamicChannelContext* DynamicChannelContext_new(wLog* log, pServe
 
 	ret->frontTracker.dataCallback = data_cb;
 	ret->backTracker.dataCallback = data_cb;
+	ret->pdata = ps->pdata;
 
 	proxyChannelToInterceptData dyn = { .name = name, .channelId = id, .intercept = FALSE };
 	if (pf_modules_run_filter(ps->pdata->module, FILTER_TYPE_DYN_INTERCEPT_LIST, ps->pdata, &dyn) &&
@@ -176,9 +179,11 @@ static void DynamicChannelContext_free(void* ptr)
 
 	if (c->backTracker.currentPacket)
 		Stream_Free(c->backTracker.currentPacket, TRUE);
+	(void)proxy_data_account_memory(c->pdata, &c->backTracker.accounted, 0);
 
 	if (c->frontTracker.currentPacket)
 		Stream_Free(c->frontTracker.currentPacket, TRUE);
+	(void)proxy_data_account_memory(c->pdata, &c->frontTracker.accounted, 0);
 
 	if (c->channelDataDtor)
 		c->channelDataDtor(&c->channelData);
@@ -530,6 +535,15 @@ static PfChannelResult DynvcTrackerPeekFn(ChannelStateTracker* tracker, BOOL fir
 				return PF_CHANNEL_RESULT_ERROR;
 			}
 
+			if (!proxy_data_account_memory(dynChannel->pdata, &trackerState->accounted,
+			                               Stream_Capacity(trackerState->currentPacket)))
+			{
+				WLog_Print(dynChannelContext->log, WLOG_WARN,
+				           "DynvcTracker(%s): reassembled packet exceeds the session budget",
+				           dynChannel->channelName);
+				return PF_CHANNEL_RESULT_ERROR;
+			}
+
 			Stream_Write(trackerState->currentPacket, Stream_ConstPointer(s), extraSize);
 		}
 		WLog_Print(dynChannelContext->log, WLOG_DEBUG,
@@ -34,6 +34,11 @@
 #include <memory>
 #include <mutex>
 #include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdlib>
 #if __has_include(<filesystem>)
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -44,6 +49,8 @@ namespace fs = std::experimental::filesystem;
 #error Could not find system header "<filesystem>" or "<experimental/filesystem>"
 #endif
 
+#include <winpr/sysinfo.h>
+
 #include <freerdp/server/proxy/proxy_modules_api.h>
 #include <freerdp/server/proxy/proxy_context.h>
 
@@ -67,6 +74,250 @@ static const std::vector<std::string>& plugin_static_intercept()
 
 static constexpr char key_path[] = "path";
 static constexpr char key_channels[] = "channels";
+static constexpr char key_rotate_size[] = "rotate-size";
+static constexpr char key_rotate_interval[] = "rotate-interval";
+
+static constexpr uint64_t default_rotate_size = 64; /* MiB */
+
+/* The writer wakes up with this much data queued or after the flush interval */
+static constexpr size_t writer_threshold = 1024ull * 1024ull;
+static constexpr size_t writer_buffer_size = 1024ull * 1024ull;
+static constexpr size_t writer_max_queued = 64ull * 1024ull * 1024ull;
+static constexpr auto writer_flush_interval = std::chrono::seconds(1);
+
+static UINT32 crc32b(const BYTE* data, size_t length)
+{
+	UINT32 crc = 0xFFFFFFFF;
+
+	for (size_t x = 0; x < length; x++)
+	{
+		const UINT32 d = data[x] & 0xFF;
+		crc = crc ^ d;
+		for (int j = 7; j >= 0; j--)
+		{
+			UINT32 mask = ~(crc & 1);
+			crc = (crc >> 1) ^ (0xEDB88320 & mask);
+		}
+	}
+	return ~crc;
+}
+
+[[nodiscard]] static std::string idstr(const std::string& name, bool back)
+{
+	std::stringstream ss;
+	ss << name << ".";
+	if (back)
+		ss << "back";
+	else
+		ss << "front";
+	return ss.str();
+}
+
+/* Writes channel data from a background thread to one file per channel and direction.
+ *
+ * The files use the stream dump record format (see libfreerdp/core/streamdump.c), one record
+ * per PDU with the front data marked as received. Each .dump file has a .idx file next to it
+ * with a UINT64 timestamp and UINT64 file offset per record to seek without a full scan.
+ */
+class Recorder
+{
+  public:
+	Recorder(fs::path base, uint64_t rotateSize, uint64_t rotateIntervalMs)
+	    : _base(std::move(base)), _rotate_size(rotateSize), _rotate_interval(rotateIntervalMs)
+	{
+		_thread = std::thread([this]() { run(); });
+	}
+
+	Recorder(const Recorder& other) = delete;
+	Recorder(Recorder&& other) = delete;
+	Recorder& operator=(const Recorder& other) = delete;
+	Recorder& operator=(Recorder&& other) = delete;
+
+	~Recorder()
+	{
+		{
+			std::lock_guard<std::mutex> guard(_mux);
+			_stop = true;
+		}
+		_cv.notify_one();
+		_thread.join();
+
+		if (_dropped > 0)
+			WLog_WARN(TAG, "dropped %" PRIu64 " PDUs, the writer could not keep up", _dropped);
+	}
+
+	/* Called from the session threads, only copies the data */
+	void add(const std::string& name, bool back, const BYTE* data, size_t len)
+	{
+		Record record{ idstr(name, back), back, GetTickCount64(),
+			           std::vector<BYTE>(data, data + len) };
+
+		std::lock_guard<std::mutex> guard(_mux);
+		if (_queued + len > writer_max_queued)
+		{
+			if (_dropped++ == 0)
+				WLog_WARN(TAG, "writer queue full, dropping PDUs");
+			return;
+		}
+
+		_queued += len;
+		_queue.push_back(std::move(record));
+		if (_queued >= writer_threshold)
+			_cv.notify_one();
+	}
+
+  private:
+	struct Record
+	{
+		std::string id;
+		bool back;
+		UINT64 ts;
+		std::vector<BYTE> data;
+	};
+
+	struct Segment
+	{
+		std::ofstream dump;
+		std::ofstream index;
+		std::vector<char> dumpBuffer;
+		std::vector<char> indexBuffer;
+		uint64_t seq = 0;
+		uint64_t size = 0;
+		uint64_t opened = 0;
+	};
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(_mux);
+		while (true)
+		{
+			_cv.wait_for(lock, writer_flush_interval,
+			             [this]() { return _stop || (_queued >= writer_threshold); });
+
+			std::vector<Record> records;
+			records.swap(_queue);
+			_queued = 0;
+			const bool stop = _stop;
+			lock.unlock();
+
+			for (const auto& record : records)
+				write(record);
+			for (auto& it : _segments)
+			{
+				it.second.dump.flush();
+				it.second.index.flush();
+			}
+
+			lock.lock();
+			if (stop && _queue.empty())
+				break;
+		}
+	}
+
+	[[nodiscard]] fs::path filepath(const std::string& id, uint64_t seq) const
+	{
+		char cstr[32] = {};
+		(void)_snprintf(cstr, sizeof(cstr), "%016" PRIx64 "-", seq);
+		auto path = _base / cstr;
+		path += id;
+		return path;
+	}
+
+	bool open(Segment& segment, const std::string& id, UINT64 now)
+	{
+		auto path = filepath(id, segment.seq++);
+		auto dumppath = path;
+		dumppath += ".dump";
+		auto indexpath = path;
+		indexpath += ".idx";
+
+		/* the buffers must be set before opening to take effect */
+		segment.dumpBuffer.resize(writer_buffer_size);
+		segment.indexBuffer.resize(writer_buffer_size / 16);
+		segment.dump.rdbuf()->pubsetbuf(segment.dumpBuffer.data(),
+		                                static_cast<std::streamsize>(segment.dumpBuffer.size()));
+		segment.index.rdbuf()->pubsetbuf(segment.indexBuffer.data(),
+		                                 static_cast<std::streamsize>(segment.indexBuffer.size()));
+
+		WLog_DBG(TAG, "[%s] writing file '%s'", id.c_str(), dumppath.c_str());
+		segment.dump.open(dumppath, std::ios::binary | std::ios::trunc);
+		segment.index.open(indexpath, std::ios::binary | std::ios::trunc);
+		if (!segment.dump.is_open() || !segment.index.is_open())
+		{
+			WLog_ERR(TAG, "Could not open '%s'", dumppath.c_str());
+			close(segment);
+			return false;
+		}
+		segment.size = 0;
+		segment.opened = now;
+		return true;
+	}
+
+	static void close(Segment& segment)
+	{
+		segment.dump.close();
+		segment.index.close();
+		segment.dump.clear();
+		segment.index.clear();
+	}
+
+	bool rotate_due(const Segment& segment, UINT64 now) const
+	{
+		if ((_rotate_size > 0) && (segment.size >= _rotate_size))
+			return true;
+		return (_rotate_interval > 0) && (now - segment.opened >= _rotate_interval);
+	}
+
+	template <typename T> static void put(std::ofstream& stream, const T& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	void write(const Record& record)
+	{
+		auto& segment = _segments[record.id];
+		if (segment.dump.is_open() && rotate_due(segment, record.ts))
+			close(segment);
+		if (!segment.dump.is_open() && !open(segment, record.id, record.ts))
+			return;
+
+		const UINT64 size = record.data.size();
+		const UINT32 crc32 = crc32b(record.data.data(), record.data.size());
+		const BYTE received = record.back ? 0 : 1;
+
+		put(segment.index, record.ts);
+		put(segment.index, segment.size);
+
+		put(segment.dump, record.ts);
+		put(segment.dump, received);
+		put(segment.dump, crc32);
+		put(segment.dump, size);
+		segment.dump.write(reinterpret_cast<const char*>(record.data.data()),
+		                   static_cast<std::streamsize>(size));
+		if (segment.dump.fail() || segment.index.fail())
+		{
+			WLog_ERR(TAG, "[%s] Could not write to stream", record.id.c_str());
+			close(segment);
+			return;
+		}
+		segment.size += sizeof(record.ts) + sizeof(received) + sizeof(crc32) + sizeof(size) + size;
+	}
+
+	fs::path _base;
+	uint64_t _rotate_size;
+	uint64_t _rotate_interval;
+
+	std::mutex _mux;
+	std::condition_variable _cv;
+	std::vector<Record> _queue;
+	size_t _queued{ 0 };
+	uint64_t _dropped{ 0 };
+	bool _stop{ false };
+	std::thread _thread;
+
+	/* only used by the writer thread */
+	std::map<std::string, Segment> _segments;
+};
 
 class PluginData
 {
@@ -93,8 +344,10 @@ class PluginData
 class ChannelData
 {
   public:
-	ChannelData(const std::string& base, std::vector<std::string> list, uint64_t sessionid)
-	    : _base(base), _channels_to_dump(std::move(list)), _session_id(sessionid)
+	ChannelData(const std::string& base, std::vector<std::string> list, uint64_t sessionid,
+	            uint64_t rotateSize, uint64_t rotateIntervalMs)
+	    : _base(base), _channels_to_dump(std::move(list)), _session_id(sessionid),
+	      _rotate_size(rotateSize), _rotate_interval(rotateIntervalMs)
 	{
 		char str[64] = {};
 		(void)_snprintf(str, sizeof(str), "session-%016" PRIx64, _session_id);
@@ -112,14 +365,12 @@ class ChannelData
 		return true;
 	}
 
-	std::ofstream stream(const std::string& name, bool back)
+	bool record(const std::string& name, bool back, const BYTE* data, size_t len)
 	{
-		std::lock_guard<std::mutex> guard(_mux);
-		auto& atom = _map[name];
-		auto count = atom++;
-		auto path = filepath(name, back, count);
-		WLog_DBG(TAG, "[%s] writing file '%s'", name.c_str(), path.c_str());
-		return std::ofstream(path);
+		if (!_recorder)
+			return false;
+		_recorder->add(name, back, data, len);
+		return true;
 	}
 
 	[[nodiscard]] bool dump_enabled(const std::string& name) const
@@ -165,6 +416,8 @@ class ChannelData
 			         key_channels);
 			return false;
 		}
+
+		_recorder = std::make_unique<Recorder>(_base, _rotate_size, _rotate_interval);
 		return true;
 	}
 
@@ -174,34 +427,15 @@ class ChannelData
 	}
 
   private:
-	[[nodiscard]] fs::path filepath(const std::string& channel, bool back, uint64_t count) const
-	{
-		auto name = idstr(channel, back);
-		char cstr[32] = {};
-		(void)_snprintf(cstr, sizeof(cstr), "%016" PRIx64 "-", count);
-		auto path = _base / cstr;
-		path += name;
-		path += ".dump";
-		return path;
-	}
-
-	[[nodiscard]] static std::string idstr(const std::string& name, bool back)
-	{
-		std::stringstream ss;
-		ss << name << ".";
-		if (back)
-			ss << "back";
-		else
-			ss << "front";
-		return ss.str();
-	}
-
 	fs::path _base;
 	std::vector<std::string> _channels_to_dump;
 
 	std::mutex _mux;
 	std::map<std::string, uint64_t> _map;
 	uint64_t _session_id;
+	uint64_t _rotate_size;
+	uint64_t _rotate_interval;
+	std::unique_ptr<Recorder> _recorder;
 };
 
 static PluginData* dump_get_plugin_data(proxyPlugin* plugin)
@@ -323,29 +557,17 @@ static BOOL dump_dyn_channel_intercept(proxyPlugin* plugin, proxyData* pdata, vo
 			return FALSE;
 		}
 
-		if (!cdata->ensure_path_exists())
-			return FALSE;
-
-		auto stream = cdata->stream(data->name, data->isBackData);
-		auto buffer = reinterpret_cast<const char*>(Stream_ConstBuffer(data->data));
-		if (!stream.is_open() || !stream.good())
-		{
-			WLog_ERR(TAG, "Could not write to stream");
-			return FALSE;
-		}
 		const auto s = Stream_Length(data->data);
 		if (s > std::numeric_limits<std::streamsize>::max())
 		{
 			WLog_ERR(TAG, "Stream length %" PRIuz " exceeds std::streamsize::max", s);
 			return FALSE;
 		}
-		stream.write(buffer, static_cast<std::streamsize>(s));
-		if (stream.fail())
+		if (!cdata->record(data->name, data->isBackData, Stream_ConstBuffer(data->data), s))
 		{
 			WLog_ERR(TAG, "Could not write to stream");
 			return FALSE;
 		}
-		stream.flush();
 	}
 
 	return TRUE;
@@ -360,6 +582,24 @@ static std::vector<std::string> split(const std::string& input, const std::strin
 	return { first, last };
 }
 
+static bool dump_config_uint(const proxyConfig* config, const char* key, uint64_t& value)
+{
+	auto cvalue = pf_config_get(config, plugin_name, key);
+	if (!cvalue)
+		return true;
+
+	errno = 0;
+	char* end = nullptr;
+	const auto val = strtoull(cvalue, &end, 10);
+	if ((errno != 0) || (end == cvalue) || (*end != '\0'))
+	{
+		WLog_ERR(TAG, "Invalid configuration entry [%s/%s]: '%s'", plugin_name, key, cvalue);
+		return false;
+	}
+	value = val;
+	return true;
+}
+
 static BOOL dump_session_started(proxyPlugin* plugin, proxyData* pdata, void* /*unused*/)
 {
 	WINPR_ASSERT(plugin);
@@ -386,10 +626,28 @@ static BOOL dump_session_started(proxyPlugin* plugin, proxyData* pdata, void* /*
 		return FALSE;
 	}
 
+	uint64_t rotateSize = default_rotate_size;
+	uint64_t rotateInterval = 0;
+	if (!dump_config_uint(config, key_rotate_size, rotateSize) ||
+	    !dump_config_uint(config, key_rotate_interval, rotateInterval))
+		return FALSE;
+	if (rotateSize > UINT64_MAX / 1024 / 1024)
+	{
+		WLog_ERR(TAG, "Configuration entry [%s/%s] out of range", plugin_name, key_rotate_size);
+		return FALSE;
+	}
+	if (rotateInterval > UINT64_MAX / 1000)
+	{
+		WLog_ERR(TAG, "Configuration entry [%s/%s] out of range", plugin_name,
+		         key_rotate_interval);
+		return FALSE;
+	}
+
 	std::string path(cpath);
 	std::string channels(cchannels);
 	std::vector<std::string> list = split(channels, "[;,]");
-	auto cfg = new ChannelData(path, std::move(list), custom->session());
+	auto cfg = new ChannelData(path, std::move(list), custom->session(),
+	                           rotateSize * 1024ull * 1024ull, rotateInterval * 1000ull);
 	if (!cfg || !cfg->create())
 	{
 		delete cfg;
@@ -38,17 +38,35 @@ struct _ChannelStateTracker
 	ChannelTrackerPeekFn peekFn;
 	void* trackerData;
 	proxyData* pdata;
+	size_t accounted;
 };
 
+static BOOL channelTracker_account(ChannelStateTracker* tracker)
+{
+	WINPR_ASSERT(tracker);
+
+	const size_t size = tracker->currentPacket ? Stream_Capacity(tracker->currentPacket) : 0;
+	if (proxy_data_account_memory(tracker->pdata, &tracker->accounted, size))
+		return TRUE;
+
+	WLog_WARN(TAG, "channel %s: reassembly buffer of %" PRIuz " bytes exceeds the session budget",
+	          tracker->channel->channel_name, size);
+	return FALSE;
+}
+
 static BOOL channelTracker_resetCurrentPacket(ChannelStateTracker* tracker)
 {
 	WINPR_ASSERT(tracker);
 
+	/* sessions over their memory budget only keep the initial buffer size */
+	const size_t keep = proxy_data_memory_exceeded(tracker->pdata) ? 10ULL * 1024ULL + 1ULL
+	                                                                : 1ULL * 1000ULL * 1000ULL;
+
 	BOOL create = TRUE;
 	if (tracker->currentPacket)
 	{
 		const size_t cap = Stream_Capacity(tracker->currentPacket);
-		if (cap < 1ULL * 1000ULL * 1000ULL)
+		if (cap < keep)
 			create = FALSE;
 		else
 			Stream_Free(tracker->currentPacket, TRUE);
@@ -59,6 +77,8 @@ static BOOL channelTracker_resetCurrentPacket(ChannelStateTracker* tracker)
 	if (!tracker->currentPacket)
 		return FALSE;
 	Stream_SetPosition(tracker->currentPacket, 0);
+	(void)proxy_data_account_memory(tracker->pdata, &tracker->accounted,
+	                                Stream_Capacity(tracker->currentPacket));
 	return TRUE;
 }
 
@@ -127,6 +147,8 @@ PfChannelResult channelTracker_update(ChannelStateTracker* tracker, const BYTE*
 			wStream* currentPacket = channelTracker_getCurrentPacket(tracker);
 			if (!Stream_EnsureRemainingCapacity(currentPacket, xsize))
 				return PF_CHANNEL_RESULT_ERROR;
+			if (!channelTracker_account(tracker))
+				return PF_CHANNEL_RESULT_ERROR;
 
 			Stream_Write(currentPacket, xdata, xsize);
 
@@ -161,6 +183,8 @@ void channelTracker_free(ChannelStateTracker* t)
 		return;
 
 	Stream_Free(t->currentPacket, TRUE);
+	t->currentPacket = NULL;
+	(void)channelTracker_account(t);
 	free(t);
 }
 
@@ -314,7 +338,7 @@ BOOL channelTracker_setPData(ChannelStateTracker* tracker, proxyData* pdata)
 {
 	WINPR_ASSERT(tracker);
 	tracker->pdata = pdata;
-	return TRUE;
+	return channelTracker_account(tracker);
 }
 
 proxyData* channelTracker_getPData(ChannelStateTracker* tracker)
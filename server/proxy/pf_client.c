@@ -23,6 +23,8 @@
 
 #include <freerdp/config.h>
 
+#include <winpr/sysinfo.h>
+
 #include <freerdp/freerdp.h>
 #include <freerdp/gdi/gdi.h>
 #include <freerdp/client/cmdline.h>
@@ -42,6 +44,7 @@
 #include "pf_input.h"
 #include <freerdp/server/proxy/proxy_config.h>
 #include "proxy_modules.h"
+#include "pf_metrics.h"
 #include "pf_utils.h"
 #include "channels/pf_channel_rdpdr.h"
 #include "channels/pf_channel_smartcard.h"
@@ -476,6 +479,8 @@ static BOOL pf_client_receive_channel_data_hook(freerdp* instance, UINT16 channe
 	if (!channel)
 		return TRUE;
 
+	pf_metrics_channel_data(channel->metrics, PF_METRICS_BACK_TO_FRONT, xsize, flags);
+
 	WINPR_ASSERT(channel->onBackData);
 	switch (channel->onBackData(pdata, channel, xdata, xsize, flags, totalSize))
 	{
@@ -511,12 +516,38 @@ static BOOL pf_client_on_server_heartbeat(freerdp* instance, BYTE period, BYTE c
 	return freerdp_heartbeat_send_heartbeat_pdu(ps->context.peer, period, count1, count2);
 }
 
+static BOOL pf_client_send_channel_packet(pClientContext* pc, const proxyChannelDataEventInfo* ev)
+{
+	freerdp* instance = pc->context.instance;
+	WINPR_ASSERT(instance);
+
+	const UINT16 channelId = freerdp_channels_get_id_by_name(instance, ev->channel_name);
+	/* Ignore unmappable channels */
+	if ((channelId == 0) || (channelId == UINT16_MAX))
+		return TRUE;
+
+	WINPR_ASSERT(instance->SendChannelPacket);
+	return instance->SendChannelPacket(instance, channelId, ev->total_size, ev->flags, ev->data,
+	                                   ev->data_len);
+}
+
 static BOOL pf_client_send_channel_data(pClientContext* pc, const proxyChannelDataEventInfo* ev)
 {
+	BOOL rc = FALSE;
+
 	WINPR_ASSERT(pc);
 	WINPR_ASSERT(ev);
 
-	return Queue_Enqueue(pc->cached_server_channel_data, ev);
+	/* Once connected and nothing is cached the chunk is forwarded as is, without copying it.
+	 * The queue lock keeps the order with sendQueuedChannelData. */
+	Queue_Lock(pc->cached_server_channel_data);
+	if (pc->connected && (Queue_Count(pc->cached_server_channel_data) == 0))
+		rc = pf_client_send_channel_packet(pc, ev);
+	else
+		rc = Queue_Enqueue(pc->cached_server_channel_data, ev);
+	Queue_Unlock(pc->cached_server_channel_data);
+
+	return rc;
 }
 
 static BOOL sendQueuedChannelData(pClientContext* pc)
@@ -532,20 +563,7 @@ static BOOL sendQueuedChannelData(pClientContext* pc)
 		Queue_Lock(pc->cached_server_channel_data);
 		while (rc && (ev = Queue_Dequeue(pc->cached_server_channel_data)))
 		{
-			UINT16 channelId = 0;
-			WINPR_ASSERT(pc->context.instance);
-
-			channelId = freerdp_channels_get_id_by_name(pc->context.instance, ev->channel_name);
-			/* Ignore unmappable channels */
-			if ((channelId == 0) || (channelId == UINT16_MAX))
-				rc = TRUE;
-			else
-			{
-				WINPR_ASSERT(pc->context.instance->SendChannelPacket);
-				rc = pc->context.instance->SendChannelPacket(pc->context.instance, channelId,
-				                                             ev->total_size, ev->flags, ev->data,
-				                                             ev->data_len);
-			}
+			rc = pf_client_send_channel_packet(pc, ev);
 			channel_data_free(ev);
 		}
 
@@ -591,10 +609,33 @@ static BOOL pf_client_post_connect(freerdp* instance)
 	if (!pf_modules_run_hook(pc->pdata->module, HOOK_TYPE_CLIENT_POST_CONNECT, pc->pdata, pc))
 		return FALSE;
 
-	if (!gdi_init(instance, PIXEL_FORMAT_BGRA32))
-		return FALSE;
+	/* Without a plugin inspecting the painted frames there is no need to decode the graphics
+	 * updates of the target, surface commands are forwarded as they are. */
+	BOOL useGdi = pf_modules_has_hook(pc->pdata->module, HOOK_TYPE_CLIENT_END_PAINT);
+	if (useGdi)
+	{
+		/* the frame buffer is by far the biggest allocation of a session */
+		const size_t size = 4ull * freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth) *
+		                    freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight);
+		if (!proxy_data_account_memory(pc->pdata, &pc->gdi_memory, size))
+		{
+			WLog_WARN(TAG, "session memory budget exceeded, graphics hooks are not called");
+			(void)proxy_data_account_memory(pc->pdata, &pc->gdi_memory, 0);
+			useGdi = FALSE;
+		}
+	}
+	else
+		WLog_INFO(TAG, "no graphics hooks registered, forwarding graphics updates without GDI");
 
-	WINPR_ASSERT(freerdp_settings_get_bool(settings, FreeRDP_SoftwareGdi));
+	if (useGdi)
+	{
+		if (!gdi_init(instance, PIXEL_FORMAT_BGRA32))
+			return FALSE;
+
+		WINPR_ASSERT(freerdp_settings_get_bool(settings, FreeRDP_SoftwareGdi));
+	}
+	else
+		pf_client_register_passthrough_callbacks(update);
 
 	pf_client_register_update_callbacks(update);
 
@@ -647,6 +688,7 @@ static void pf_client_post_disconnect(freerdp* instance)
 
 	PubSub_UnsubscribeErrorInfo(instance->context->pubSub, pf_client_on_error_info);
 	gdi_free(instance);
+	(void)proxy_data_account_memory(pdata, &pc->gdi_memory, 0);
 
 	/* Only close the connection if NLA fallback process is done */
 	if (!pc->allow_next_conn_failure)
@@ -812,6 +854,75 @@ out:
 	return rc;
 }
 
+/* Run the connect hooks and connect to the target, aborts the session on failure */
+static BOOL pf_client_connect_target(pClientContext* pc)
+{
+	proxyData* pdata = pc->pdata;
+	WINPR_ASSERT(pdata);
+
+	if (!pf_modules_run_hook(pdata->module, HOOK_TYPE_CLIENT_INIT_CONNECT, pdata, pc))
+	{
+		proxy_data_abort_connect(pdata);
+		return FALSE;
+	}
+
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL connected = pf_client_connect(pc->context.instance);
+	pf_metrics_session_backend_connect(pdata->metrics, connected,
+	                                   winpr_GetTickCount64NS() - start);
+	if (!connected)
+	{
+		proxy_data_abort_connect(pdata);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+DWORD pf_client_get_event_handles(pClientContext* pc, HANDLE* events, DWORD count)
+{
+	WINPR_ASSERT(pc);
+	WINPR_ASSERT(events);
+
+	if (count < 2)
+		return 0;
+
+	events[0] = Queue_Event(pc->cached_server_channel_data);
+
+	const DWORD tmp = freerdp_get_event_handles(&pc->context, &events[1], count - 1);
+	if (tmp == 0)
+	{
+		PROXY_LOG_ERR(TAG, pc, "freerdp_get_event_handles failed!");
+		return 0;
+	}
+
+	return tmp + 1;
+}
+
+BOOL pf_client_check_event_handles(pClientContext* pc)
+{
+	WINPR_ASSERT(pc);
+
+	rdpContext* context = &pc->context;
+
+	if (freerdp_shall_disconnect_context(context))
+		return FALSE;
+
+	if (proxy_data_shall_disconnect(pc->pdata))
+		return FALSE;
+
+	if (!freerdp_check_event_handles(context))
+	{
+		if (freerdp_get_last_error(context) == FREERDP_ERROR_SUCCESS)
+			WLog_ERR(TAG, "Failed to check FreeRDP event handles");
+
+		return FALSE;
+	}
+
+	sendQueuedChannelData(pc);
+	return TRUE;
+}
+
 /**
  * RDP main loop.
  * Connects RDP, loops while running and handles event and dispatch, cleans up
@@ -841,29 +952,16 @@ static DWORD WINAPI pf_client_thread_proc(pClientContext* pc)
 	 */
 	handles[nCount++] = pdata->abort_event;
 
-	if (!pf_modules_run_hook(pdata->module, HOOK_TYPE_CLIENT_INIT_CONNECT, pdata, pc))
-	{
-		proxy_data_abort_connect(pdata);
+	if (!pf_client_connect_target(pc))
 		goto end;
-	}
-
-	if (!pf_client_connect(instance))
-	{
-		proxy_data_abort_connect(pdata);
-		goto end;
-	}
-	handles[nCount++] = Queue_Event(pc->cached_server_channel_data);
 
 	while (!freerdp_shall_disconnect_context(instance->context))
 	{
-		UINT32 tmp = freerdp_get_event_handles(instance->context, &handles[nCount],
-		                                       ARRAYSIZE(handles) - nCount);
+		const DWORD tmp = pf_client_get_event_handles(pc, &handles[nCount],
+		                                              ARRAYSIZE(handles) - nCount);
 
 		if (tmp == 0)
-		{
-			PROXY_LOG_ERR(TAG, pc, "freerdp_get_event_handles failed!");
 			break;
-		}
 
 		status = WaitForMultipleObjects(nCount + tmp, handles, FALSE, INFINITE);
 
@@ -877,20 +975,8 @@ static DWORD WINAPI pf_client_thread_proc(pClientContext* pc)
 		if (status == WAIT_OBJECT_0)
 			break;
 
-		if (freerdp_shall_disconnect_context(instance->context))
-			break;
-
-		if (proxy_data_shall_disconnect(pdata))
-			break;
-
-		if (!freerdp_check_event_handles(instance->context))
-		{
-			if (freerdp_get_last_error(instance->context) == FREERDP_ERROR_SUCCESS)
-				WLog_ERR(TAG, "Failed to check FreeRDP event handles");
-
+		if (!pf_client_check_event_handles(pc))
 			break;
-		}
-		sendQueuedChannelData(pc);
 	}
 
 	freerdp_disconnect(instance);
@@ -1092,6 +1178,33 @@ int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints)
 	return 0;
 }
 
+/**
+ * Connects to the target server and returns, the session thread then polls the
+ * connection with pf_client_get_event_handles and pf_client_check_event_handles.
+ * The thread exit code is 0 if the connection was established.
+ */
+DWORD WINAPI pf_client_connect_start(LPVOID arg)
+{
+	pClientContext* pc = (pClientContext*)arg;
+
+	WINPR_ASSERT(pc);
+	if ((freerdp_client_start(&pc->context) == 0) && pf_client_connect_target(pc))
+		return 0;
+
+	pf_modules_run_hook(pc->pdata->module, HOOK_TYPE_CLIENT_UNINIT_CONNECT, pc->pdata, pc);
+	freerdp_client_stop(&pc->context);
+	return 1;
+}
+
+void pf_client_disconnect_target(pClientContext* pc)
+{
+	WINPR_ASSERT(pc);
+
+	freerdp_disconnect(pc->context.instance);
+	pf_modules_run_hook(pc->pdata->module, HOOK_TYPE_CLIENT_UNINIT_CONNECT, pc->pdata, pc);
+	freerdp_client_stop(&pc->context);
+}
+
 /**
  * Starts running a client connection towards target server.
  */
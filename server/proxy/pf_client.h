@@ -23,9 +23,16 @@
 #define FREERDP_SERVER_PROXY_PFCLIENT_H
 
 #include <freerdp/freerdp.h>
+#include <freerdp/server/proxy/proxy_context.h>
 #include <winpr/wtypes.h>
 
 int RdpClientEntry(RDP_CLIENT_ENTRY_POINTS* pEntryPoints);
 DWORD WINAPI pf_client_start(LPVOID arg);
 
+/* Shared session thread mode, the session thread polls the target connection itself */
+DWORD WINAPI pf_client_connect_start(LPVOID arg);
+void pf_client_disconnect_target(pClientContext* pc);
+DWORD pf_client_get_event_handles(pClientContext* pc, HANDLE* events, DWORD count);
+BOOL pf_client_check_event_handles(pClientContext* pc);
+
 #endif /* FREERDP_SERVER_PROXY_PFCLIENT_H */
@@ -67,6 +67,15 @@ static const char* boolstr(BOOL rc)
 static const char* section_server = "Server";
 static const char* key_host = "Host";
 static const char* key_port = "Port";
+static const char* key_server_shared_thread = "SharedSessionThread";
+static const char* key_server_accept_threads = "AcceptThreads";
+static const char* key_server_io_uring = "IoUring";
+static const char* key_server_routing_passthrough = "RoutingPassthrough";
+
+static const char* section_metrics = "Metrics";
+
+static const char* section_memory = "Memory";
+static const char* key_memory_session_budget = "SessionBudget";
 
 static const char* section_target = "Target";
 static const char* key_target_fixed = "FixedTarget";
@@ -74,6 +83,7 @@ static const char* key_target_user = "User";
 static const char* key_target_pwd = "Password";
 static const char* key_target_domain = "Domain";
 static const char* key_target_tls_seclevel = "TlsSecLevel";
+static const char* key_target_pool = "ConnectionPool";
 
 static const char* section_plugins = "Plugins";
 static const char* key_plugins_modules = "Modules";
@@ -106,12 +116,18 @@ static const char* key_security_client_nla = "ClientNlaSecurity";
 static const char* key_security_client_tls = "ClientTlsSecurity";
 static const char* key_security_client_rdp = "ClientRdpSecurity";
 static const char* key_security_client_fallback = "ClientAllowFallbackToTls";
+static const char* key_security_handshake_concurrency = "ServerHandshakeConcurrency";
+static const char* key_security_handshake_queue = "ServerHandshakeQueue";
+static const char* key_security_session_tickets = "ServerTlsSessionTickets";
+static const char* key_security_kernel_offload = "ServerTlsKernelOffload";
 
 static const char* section_certificates = "Certificates";
 static const char* key_private_key_file = "PrivateKeyFile";
 static const char* key_private_key_content = "PrivateKeyContent";
 static const char* key_cert_file = "CertificateFile";
 static const char* key_cert_content = "CertificateContent";
+static const char* key_ecdsa_cert_file = "EcdsaCertificateFile";
+static const char* key_ecdsa_private_key_file = "EcdsaPrivateKeyFile";
 
 static char** pf_config_parse_comma_separated_list(const char* list, size_t* count)
 {
@@ -224,6 +240,15 @@ static BOOL pf_config_load_server(wIniFile* ini, proxyConfig* config)
 	const char* host = NULL;
 
 	WINPR_ASSERT(config);
+	config->SharedSessionThread =
+	    pf_config_get_bool(ini, section_server, key_server_shared_thread, FALSE);
+	if (!pf_config_get_uint32(ini, section_server, key_server_accept_threads,
+	                          &config->AcceptThreads, FALSE))
+		return FALSE;
+	config->IoUring = pf_config_get_bool(ini, section_server, key_server_io_uring, FALSE);
+	config->RoutingPassthrough =
+	    pf_config_get_bool(ini, section_server, key_server_routing_passthrough, FALSE);
+
 	host = pf_config_get_str(ini, section_server, key_host, FALSE);
 
 	if (!host)
@@ -240,6 +265,34 @@ static BOOL pf_config_load_server(wIniFile* ini, proxyConfig* config)
 	return TRUE;
 }
 
+static BOOL pf_config_load_metrics(wIniFile* ini, proxyConfig* config)
+{
+	const char* host = NULL;
+
+	WINPR_ASSERT(config);
+	host = pf_config_get_str(ini, section_metrics, key_host, FALSE);
+
+	if (!host)
+		return TRUE;
+
+	config->MetricsHost = _strdup(host);
+
+	if (!config->MetricsHost)
+		return FALSE;
+
+	if (!pf_config_get_uint16(ini, section_metrics, key_port, &config->MetricsPort, TRUE))
+		return FALSE;
+
+	return TRUE;
+}
+
+static BOOL pf_config_load_memory(wIniFile* ini, proxyConfig* config)
+{
+	WINPR_ASSERT(config);
+	return pf_config_get_uint32(ini, section_memory, key_memory_session_budget,
+	                            &config->SessionMemoryBudget, FALSE);
+}
+
 static BOOL pf_config_load_target(wIniFile* ini, proxyConfig* config)
 {
 	const char* target_value = NULL;
@@ -255,6 +308,10 @@ static BOOL pf_config_load_target(wIniFile* ini, proxyConfig* config)
 	                          &config->TargetTlsSecLevel, FALSE))
 		return FALSE;
 
+	if (!pf_config_get_uint32(ini, section_target, key_target_pool, &config->TargetConnectionPool,
+	                          FALSE))
+		return FALSE;
+
 	if (config->FixedTarget)
 	{
 		target_value = pf_config_get_str(ini, section_target, key_host, TRUE);
@@ -345,7 +402,16 @@ static BOOL pf_config_load_security(wIniFile* ini, proxyConfig* config)
 	    pf_config_get_bool(ini, section_security, key_security_client_rdp, TRUE);
 	config->ClientAllowFallbackToTls =
 	    pf_config_get_bool(ini, section_security, key_security_client_fallback, TRUE);
-	return TRUE;
+
+	config->ServerTlsSessionTickets =
+	    pf_config_get_bool(ini, section_security, key_security_session_tickets, FALSE);
+	config->ServerTlsKernelOffload =
+	    pf_config_get_bool(ini, section_security, key_security_kernel_offload, FALSE);
+	if (!pf_config_get_uint32(ini, section_security, key_security_handshake_concurrency,
+	                          &config->ServerHandshakeConcurrency, FALSE))
+		return FALSE;
+	return pf_config_get_uint32(ini, section_security, key_security_handshake_queue,
+	                            &config->ServerHandshakeQueue, FALSE);
 }
 
 static BOOL pf_config_load_modules(wIniFile* ini, proxyConfig* config)
@@ -540,6 +606,30 @@ static BOOL pf_config_load_certificates(wIniFile* ini, proxyConfig* config)
 		return FALSE;
 	}
 
+	/* optional, preferred over the RSA certificate by clients supporting it */
+	tmp1 = pf_config_get_str(ini, section_certificates, key_ecdsa_cert_file, FALSE);
+	tmp2 = pf_config_get_str(ini, section_certificates, key_ecdsa_private_key_file, FALSE);
+	if (!tmp1 != !tmp2)
+	{
+		WLog_ERR(TAG, "%s/%s and %s/%s must be set together", section_certificates,
+		         key_ecdsa_cert_file, section_certificates, key_ecdsa_private_key_file);
+		return FALSE;
+	}
+	else if (tmp1)
+	{
+		if (!winpr_PathFileExists(tmp1) || !winpr_PathFileExists(tmp2))
+		{
+			WLog_ERR(TAG, "%s/%s file %s or %s/%s file %s does not exist",
+			         section_certificates, key_ecdsa_cert_file, tmp1, section_certificates,
+			         key_ecdsa_private_key_file, tmp2);
+			return FALSE;
+		}
+		config->EcdsaCertificateFile = _strdup(tmp1);
+		config->EcdsaPrivateKeyFile = _strdup(tmp2);
+		if (!config->EcdsaCertificateFile || !config->EcdsaPrivateKeyFile)
+			return FALSE;
+	}
+
 	return TRUE;
 }
 
@@ -559,6 +649,12 @@ proxyConfig* server_config_load_ini(wIniFile* ini)
 		if (!pf_config_load_server(ini, config))
 			goto out;
 
+		if (!pf_config_load_metrics(ini, config))
+			goto out;
+
+		if (!pf_config_load_memory(ini, config))
+			goto out;
+
 		if (!pf_config_load_target(ini, config))
 			goto out;
 
@@ -602,6 +698,26 @@ BOOL pf_server_config_dump(const char* file)
 		goto fail;
 	if (IniFile_SetKeyValueInt(ini, section_server, key_port, 3389) < 0)
 		goto fail;
+	if (IniFile_SetKeyValueString(ini, section_server, key_server_shared_thread, bool_str_false) <
+	    0)
+		goto fail;
+	if (IniFile_SetKeyValueInt(ini, section_server, key_server_accept_threads, 0) < 0)
+		goto fail;
+	if (IniFile_SetKeyValueString(ini, section_server, key_server_io_uring, bool_str_false) < 0)
+		goto fail;
+	if (IniFile_SetKeyValueString(ini, section_server, key_server_routing_passthrough,
+	                              bool_str_false) < 0)
+		goto fail;
+
+	/* Metrics endpoint configuration */
+	if (IniFile_SetKeyValueString(ini, section_metrics, key_host, "127.0.0.1") < 0)
+		goto fail;
+	if (IniFile_SetKeyValueInt(ini, section_metrics, key_port, 9389) < 0)
+		goto fail;
+
+	/* Per session memory budget in MiB, 0 for no limit */
+	if (IniFile_SetKeyValueInt(ini, section_memory, key_memory_session_budget, 0) < 0)
+		goto fail;
 
 	/* Target configuration */
 	if (IniFile_SetKeyValueString(ini, section_target, key_host, "somehost.example.com") < 0)
@@ -612,6 +728,8 @@ BOOL pf_server_config_dump(const char* file)
 		goto fail;
 	if (IniFile_SetKeyValueInt(ini, section_target, key_target_tls_seclevel, 1) < 0)
 		goto fail;
+	if (IniFile_SetKeyValueInt(ini, section_target, key_target_pool, 0) < 0)
+		goto fail;
 
 	/* Channel configuration */
 	if (IniFile_SetKeyValueString(ini, section_channels, key_channels_gfx, bool_str_true) < 0)
@@ -671,6 +789,16 @@ BOOL pf_server_config_dump(const char* file)
 	if (IniFile_SetKeyValueString(ini, section_security, key_security_client_fallback,
 	                              bool_str_true) < 0)
 		goto fail;
+	if (IniFile_SetKeyValueInt(ini, section_security, key_security_handshake_concurrency, 0) < 0)
+		goto fail;
+	if (IniFile_SetKeyValueInt(ini, section_security, key_security_handshake_queue, 0) < 0)
+		goto fail;
+	if (IniFile_SetKeyValueString(ini, section_security, key_security_session_tickets,
+	                              bool_str_false) < 0)
+		goto fail;
+	if (IniFile_SetKeyValueString(ini, section_security, key_security_kernel_offload,
+	                              bool_str_false) < 0)
+		goto fail;
 
 	/* Module configuration */
 	if (IniFile_SetKeyValueString(ini, section_plugins, key_plugins_modules,
@@ -769,6 +897,20 @@ void pf_server_config_print(const proxyConfig* config)
 	CONFIG_PRINT_SECTION(section_server);
 	CONFIG_PRINT_STR(config, Host);
 	CONFIG_PRINT_UINT16(config, Port);
+	CONFIG_PRINT_BOOL(config, SharedSessionThread);
+	CONFIG_PRINT_UINT32(config, AcceptThreads);
+	CONFIG_PRINT_BOOL(config, IoUring);
+	CONFIG_PRINT_BOOL(config, RoutingPassthrough);
+
+	if (config->MetricsHost)
+	{
+		CONFIG_PRINT_SECTION(section_metrics);
+		CONFIG_PRINT_STR(config, MetricsHost);
+		CONFIG_PRINT_UINT16(config, MetricsPort);
+	}
+
+	CONFIG_PRINT_SECTION(section_memory);
+	CONFIG_PRINT_UINT32(config, SessionMemoryBudget);
 
 	if (config->FixedTarget)
 	{
@@ -776,6 +918,7 @@ void pf_server_config_print(const proxyConfig* config)
 		CONFIG_PRINT_STR(config, TargetHost);
 		CONFIG_PRINT_UINT16(config, TargetPort);
 		CONFIG_PRINT_UINT32(config, TargetTlsSecLevel);
+		CONFIG_PRINT_UINT32(config, TargetConnectionPool);
 
 		if (config->TargetUser)
 			CONFIG_PRINT_STR(config, TargetUser);
@@ -796,6 +939,10 @@ void pf_server_config_print(const proxyConfig* config)
 	CONFIG_PRINT_BOOL(config, ClientTlsSecurity);
 	CONFIG_PRINT_BOOL(config, ClientRdpSecurity);
 	CONFIG_PRINT_BOOL(config, ClientAllowFallbackToTls);
+	CONFIG_PRINT_UINT32(config, ServerHandshakeConcurrency);
+	CONFIG_PRINT_UINT32(config, ServerHandshakeQueue);
+	CONFIG_PRINT_BOOL(config, ServerTlsSessionTickets);
+	CONFIG_PRINT_BOOL(config, ServerTlsKernelOffload);
 
 	CONFIG_PRINT_SECTION(section_channels);
 	CONFIG_PRINT_BOOL(config, GFX);
@@ -836,6 +983,11 @@ void pf_server_config_print(const proxyConfig* config)
 	CONFIG_PRINT_STR_CONTENT(config, CertificateContent);
 	CONFIG_PRINT_STR(config, PrivateKeyFile);
 	CONFIG_PRINT_STR_CONTENT(config, PrivateKeyContent);
+	if (config->EcdsaCertificateFile)
+	{
+		CONFIG_PRINT_STR(config, EcdsaCertificateFile);
+		CONFIG_PRINT_STR(config, EcdsaPrivateKeyFile);
+	}
 }
 
 void pf_server_config_free(proxyConfig* config)
@@ -849,6 +1001,9 @@ void pf_server_config_free(proxyConfig* config)
 	free(config->Modules);
 	free(config->TargetHost);
 	free(config->Host);
+	free(config->MetricsHost);
+	free(config->EcdsaCertificateFile);
+	free(config->EcdsaPrivateKeyFile);
 	free(config->CertificateFile);
 	free(config->CertificateContent);
 	if (config->CertificatePEM)
@@ -957,6 +1112,12 @@ BOOL pf_config_clone(proxyConfig** dst, const proxyConfig* config)
 		goto fail;
 	if (!pf_config_copy_string(&tmp->TargetHost, config->TargetHost))
 		goto fail;
+	if (!pf_config_copy_string(&tmp->MetricsHost, config->MetricsHost))
+		goto fail;
+	if (!pf_config_copy_string(&tmp->EcdsaCertificateFile, config->EcdsaCertificateFile))
+		goto fail;
+	if (!pf_config_copy_string(&tmp->EcdsaPrivateKeyFile, config->EcdsaPrivateKeyFile))
+		goto fail;
 
 	if (!pf_config_copy_string_list(&tmp->Passthrough, &tmp->PassthroughCount, config->Passthrough,
 	                                config->PassthroughCount))
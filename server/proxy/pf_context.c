@@ -23,6 +23,7 @@
 
 #include <winpr/crypto.h>
 #include <winpr/print.h>
+#include <winpr/interlocked.h>
 
 #include <freerdp/server/proxy/proxy_log.h>
 #include <freerdp/server/proxy/proxy_server.h>
@@ -31,6 +32,7 @@
 #include "pf_client.h"
 #include "pf_utils.h"
 #include "proxy_modules.h"
+#include "pf_metrics.h"
 
 #include <freerdp/server/proxy/proxy_context.h>
 
@@ -89,6 +91,7 @@ pServerStaticChannelContext* StaticChannelContext_new(pServerContext* ps, const
 	}
 
 	ret->front_channel_id = id;
+	ret->metrics = pf_metrics_channel(ps->pdata->metrics, name);
 	ret->channel_name = _strdup(name);
 	if (!ret->channel_name)
 	{
@@ -212,6 +215,11 @@ void client_to_proxy_context_free(freerdp_peer* client, rdpContext* ctx)
 }
 
 BOOL pf_context_init_server_context(freerdp_peer* client)
+{
+	return pf_context_init_server_context_ex(client, NULL);
+}
+
+BOOL pf_context_init_server_context_ex(freerdp_peer* client, const rdpSettings* settings)
 {
 	WINPR_ASSERT(client);
 
@@ -219,7 +227,7 @@ BOOL pf_context_init_server_context(freerdp_peer* client)
 	client->ContextNew = client_to_proxy_context_new;
 	client->ContextFree = client_to_proxy_context_free;
 
-	return freerdp_peer_context_new(client);
+	return freerdp_peer_context_new_ex(client, settings);
 }
 
 static BOOL pf_context_revert_str_settings(rdpSettings* dst, const rdpSettings* before, size_t nr,
@@ -387,6 +395,13 @@ void proxy_data_free(proxyData* pdata)
 	if (!pdata)
 		return;
 
+	pf_modules_flush_async(pdata->module);
+
+	if (pdata->config && (pdata->config->SessionMemoryBudget > 0))
+		WLog_DBG(TAG, "session %s used at most %" PRId64 " KiB of %" PRIu32 " MiB",
+		         pdata->session_id, pdata->memory_peak / 1024,
+		         pdata->config->SessionMemoryBudget);
+
 	if (pdata->abort_event)
 		(void)CloseHandle(pdata->abort_event);
 
@@ -399,6 +414,8 @@ void proxy_data_free(proxyData* pdata)
 	if (pdata->modules_info)
 		HashTable_Free(pdata->modules_info);
 
+	pf_metrics_session_free(pdata->metrics);
+
 	if (pdata->pc)
 		freerdp_client_context_free(&pdata->pc->context);
 
@@ -420,3 +437,46 @@ BOOL proxy_data_shall_disconnect(proxyData* pdata)
 	WINPR_ASSERT(pdata->abort_event);
 	return WaitForSingleObject(pdata->abort_event, 0) == WAIT_OBJECT_0;
 }
+
+static LONGLONG proxy_data_memory_budget(const proxyData* pdata)
+{
+	WINPR_ASSERT(pdata);
+	if (!pdata->config)
+		return 0;
+	return 1024LL * 1024LL * pdata->config->SessionMemoryBudget;
+}
+
+BOOL proxy_data_account_memory(proxyData* pdata, size_t* accounted, size_t size)
+{
+	WINPR_ASSERT(accounted);
+
+	if (!pdata || (*accounted == size))
+		return TRUE;
+
+	/* channel data arrives on the server and the client thread */
+	const LONGLONG delta = (LONGLONG)size - (LONGLONG)*accounted;
+	LONGLONG cur = pdata->memory_used;
+	LONGLONG prev = 0;
+	while ((prev = InterlockedCompareExchange64(&pdata->memory_used, cur + delta, cur)) != cur)
+		cur = prev;
+	*accounted = size;
+
+	const LONGLONG used = cur + delta;
+	while (used > (cur = pdata->memory_peak))
+	{
+		if (InterlockedCompareExchange64(&pdata->memory_peak, used, cur) == cur)
+			break;
+	}
+
+	const LONGLONG budget = proxy_data_memory_budget(pdata);
+	return (delta <= 0) || (budget == 0) || (used <= budget);
+}
+
+BOOL proxy_data_memory_exceeded(const proxyData* pdata)
+{
+	if (!pdata)
+		return FALSE;
+
+	const LONGLONG budget = proxy_data_memory_budget(pdata);
+	return (budget > 0) && (pdata->memory_used > budget);
+}
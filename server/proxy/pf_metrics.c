@@ -0,0 +1,631 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * FreeRDP Proxy Server
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+
+#include <winpr/assert.h>
+#include <winpr/collections.h>
+#include <winpr/interlocked.h>
+#include <winpr/stream.h>
+#include <winpr/string.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/thread.h>
+#include <winpr/winsock.h>
+#include <winpr/wtsapi.h>
+
+#include <freerdp/server/proxy/proxy_log.h>
+
+#include "pf_metrics.h"
+
+#define TAG PROXY_TAG("metrics")
+
+#define PF_METRICS_REQUEST_MAX 4096
+
+struct proxy_channel_metrics
+{
+	char name[CHANNEL_NAME_LEN + 1];
+	LONGLONG volatile bytes[2];
+	LONGLONG volatile pdus[2];
+};
+
+struct proxy_session_metrics
+{
+	proxyMetrics* metrics;
+	char sessionId[PROXY_SESSION_ID_LENGTH + 1];
+	UINT64 start;
+	BOOL logon;
+	ULONG lastFrontSent;
+	ULONG lastBackSent;
+
+	LONGLONG volatile frontSent;
+	LONGLONG volatile backSent;
+	LONGLONG volatile queued;
+};
+
+struct proxy_metrics
+{
+	wArrayList* sessions;
+	wArrayList* channels;
+
+	LONGLONG volatile sessionsTotal;
+	LONGLONG volatile logons;
+	LONGLONG volatile logonTime;
+	LONGLONG volatile backendConnects;
+	LONGLONG volatile backendConnectTime;
+	LONGLONG volatile backendFailures;
+
+	SOCKET socket;
+	HANDLE socketEvent;
+	HANDLE stopEvent;
+	HANDLE thread;
+};
+
+static void pf_metrics_add(LONGLONG volatile* value, LONGLONG add)
+{
+	LONGLONG cur = 0;
+
+	WINPR_ASSERT(value);
+	do
+	{
+		cur = *value;
+	} while (InterlockedCompareExchange64(value, cur + add, cur) != cur);
+}
+
+static void pf_metrics_set(LONGLONG volatile* value, LONGLONG set)
+{
+	LONGLONG cur = 0;
+
+	WINPR_ASSERT(value);
+	do
+	{
+		cur = *value;
+	} while (InterlockedCompareExchange64(value, set, cur) != cur);
+}
+
+static LONGLONG pf_metrics_get(LONGLONG volatile* value)
+{
+	WINPR_ASSERT(value);
+	return InterlockedCompareExchange64(value, 0, 0);
+}
+
+static LONGLONG pf_metrics_delta(ULONG cur, ULONG last)
+{
+	if (cur < last)
+		return cur;
+	return cur - last;
+}
+
+static double pf_metrics_seconds(LONGLONG ns)
+{
+	return (double)ns / 1000000000.0;
+}
+
+WINPR_ATTR_FORMAT_ARG(2, 3)
+static BOOL pf_metrics_printf(wStream* s, WINPR_FORMAT_ARG const char* fmt, ...)
+{
+	va_list ap = { 0 };
+
+	WINPR_ASSERT(s);
+	va_start(ap, fmt);
+	const int rc = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (rc < 0)
+		return FALSE;
+
+	if (!Stream_EnsureRemainingCapacity(s, (size_t)rc + 1))
+		return FALSE;
+
+	va_start(ap, fmt);
+	(void)vsnprintf(Stream_PointerAs(s, char), (size_t)rc + 1, fmt, ap);
+	va_end(ap);
+	Stream_Seek(s, (size_t)rc);
+	return TRUE;
+}
+
+static BOOL pf_metrics_write_channels(proxyMetrics* metrics, wStream* s)
+{
+	static const char* dirs[] = { "front_to_back", "back_to_front" };
+	BOOL rc = TRUE;
+
+	WINPR_ASSERT(metrics);
+
+	rc &= pf_metrics_printf(s, "# TYPE freerdp_proxy_channel_bytes counter\n"
+	                           "# UNIT freerdp_proxy_channel_bytes bytes\n");
+	ArrayList_Lock(metrics->channels);
+	for (size_t x = 0; x < ArrayList_Count(metrics->channels); x++)
+	{
+		proxyChannelMetrics* channel = ArrayList_GetItem(metrics->channels, x);
+		for (size_t d = 0; d < ARRAYSIZE(dirs); d++)
+			rc &= pf_metrics_printf(s,
+			                        "freerdp_proxy_channel_bytes_total{channel=\"%s\","
+			                        "direction=\"%s\"} %" PRId64 "\n",
+			                        channel->name, dirs[d], pf_metrics_get(&channel->bytes[d]));
+	}
+
+	rc &= pf_metrics_printf(s, "# TYPE freerdp_proxy_channel_pdus counter\n");
+	for (size_t x = 0; x < ArrayList_Count(metrics->channels); x++)
+	{
+		proxyChannelMetrics* channel = ArrayList_GetItem(metrics->channels, x);
+		for (size_t d = 0; d < ARRAYSIZE(dirs); d++)
+			rc &= pf_metrics_printf(s,
+			                        "freerdp_proxy_channel_pdus_total{channel=\"%s\","
+			                        "direction=\"%s\"} %" PRId64 "\n",
+			                        channel->name, dirs[d], pf_metrics_get(&channel->pdus[d]));
+	}
+	ArrayList_Unlock(metrics->channels);
+	return rc;
+}
+
+static BOOL pf_metrics_write_sessions(proxyMetrics* metrics, wStream* s)
+{
+	BOOL rc = TRUE;
+
+	WINPR_ASSERT(metrics);
+
+	ArrayList_Lock(metrics->sessions);
+	const size_t count = ArrayList_Count(metrics->sessions);
+	rc &= pf_metrics_printf(s,
+	                        "# TYPE freerdp_proxy_sessions_active gauge\n"
+	                        "freerdp_proxy_sessions_active %" PRIuz "\n",
+	                        count);
+
+	rc &= pf_metrics_printf(s, "# TYPE freerdp_proxy_session_sent_bytes counter\n"
+	                           "# UNIT freerdp_proxy_session_sent_bytes bytes\n");
+	for (size_t x = 0; x < count; x++)
+	{
+		proxySessionMetrics* session = ArrayList_GetItem(metrics->sessions, x);
+		rc &= pf_metrics_printf(
+		    s,
+		    "freerdp_proxy_session_sent_bytes_total{session=\"%s\",side=\"front\"} %" PRId64 "\n"
+		    "freerdp_proxy_session_sent_bytes_total{session=\"%s\",side=\"back\"} %" PRId64 "\n",
+		    session->sessionId, pf_metrics_get(&session->frontSent), session->sessionId,
+		    pf_metrics_get(&session->backSent));
+	}
+
+	rc &= pf_metrics_printf(s, "# TYPE freerdp_proxy_session_queued_pdus gauge\n");
+	for (size_t x = 0; x < count; x++)
+	{
+		proxySessionMetrics* session = ArrayList_GetItem(metrics->sessions, x);
+		rc &= pf_metrics_printf(s,
+		                        "freerdp_proxy_session_queued_pdus{session=\"%s\"} %" PRId64 "\n",
+		                        session->sessionId, pf_metrics_get(&session->queued));
+	}
+	ArrayList_Unlock(metrics->sessions);
+	return rc;
+}
+
+static wStream* pf_metrics_write(proxyMetrics* metrics)
+{
+	BOOL rc = TRUE;
+	wStream* s = Stream_New(NULL, 4096);
+	if (!s)
+		return NULL;
+
+	rc &= pf_metrics_printf(s,
+	                        "# TYPE freerdp_proxy_sessions counter\n"
+	                        "freerdp_proxy_sessions_total %" PRId64 "\n",
+	                        pf_metrics_get(&metrics->sessionsTotal));
+	rc &= pf_metrics_write_sessions(metrics, s);
+	rc &= pf_metrics_printf(s,
+	                        "# TYPE freerdp_proxy_front_logon_seconds summary\n"
+	                        "# UNIT freerdp_proxy_front_logon_seconds seconds\n"
+	                        "freerdp_proxy_front_logon_seconds_sum %f\n"
+	                        "freerdp_proxy_front_logon_seconds_count %" PRId64 "\n",
+	                        pf_metrics_seconds(pf_metrics_get(&metrics->logonTime)),
+	                        pf_metrics_get(&metrics->logons));
+	rc &= pf_metrics_printf(s,
+	                        "# TYPE freerdp_proxy_backend_connect_seconds summary\n"
+	                        "# UNIT freerdp_proxy_backend_connect_seconds seconds\n"
+	                        "freerdp_proxy_backend_connect_seconds_sum %f\n"
+	                        "freerdp_proxy_backend_connect_seconds_count %" PRId64 "\n"
+	                        "# TYPE freerdp_proxy_backend_connect_failures counter\n"
+	                        "freerdp_proxy_backend_connect_failures_total %" PRId64 "\n",
+	                        pf_metrics_seconds(pf_metrics_get(&metrics->backendConnectTime)),
+	                        pf_metrics_get(&metrics->backendConnects),
+	                        pf_metrics_get(&metrics->backendFailures));
+	rc &= pf_metrics_write_channels(metrics, s);
+	rc &= pf_metrics_printf(s, "# EOF\n");
+
+	if (!rc)
+	{
+		Stream_Free(s, TRUE);
+		return NULL;
+	}
+	return s;
+}
+
+static BOOL pf_metrics_send_all(SOCKET sockfd, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const int chunk = (size > INT32_MAX) ? INT32_MAX : (int)size;
+		const int rc = _send(sockfd, data, chunk, 0);
+		if (rc <= 0)
+			return FALSE;
+		data += rc;
+		size -= (size_t)rc;
+	}
+	return TRUE;
+}
+
+static void pf_metrics_handle_request(proxyMetrics* metrics, SOCKET sockfd)
+{
+	char request[PF_METRICS_REQUEST_MAX + 1] = { 0 };
+	size_t length = 0;
+	u_long arg = 0;
+
+	/* The accepted socket is served synchronously, stop waiting for slow scrapers */
+	(void)_ioctlsocket(sockfd, FIONBIO, &arg);
+#if defined(_WIN32)
+	DWORD timeout = 1000;
+#else
+	struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+#endif
+	(void)_setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+
+	while (length < PF_METRICS_REQUEST_MAX)
+	{
+		const int rc = _recv(sockfd, &request[length], (int)(PF_METRICS_REQUEST_MAX - length), 0);
+		if (rc <= 0)
+			return;
+		length += (size_t)rc;
+		if (strstr(request, "\r\n\r\n"))
+			break;
+	}
+
+	if ((strncmp(request, "GET /metrics ", 13) != 0) &&
+	    (strncmp(request, "GET /metrics?", 13) != 0))
+	{
+		static const char notfound[] = "HTTP/1.1 404 Not Found\r\n"
+		                               "Content-Length: 0\r\n"
+		                               "Connection: close\r\n\r\n";
+		(void)pf_metrics_send_all(sockfd, notfound, sizeof(notfound) - 1);
+		return;
+	}
+
+	wStream* s = pf_metrics_write(metrics);
+	if (!s)
+	{
+		static const char failed[] = "HTTP/1.1 500 Internal Server Error\r\n"
+		                             "Content-Length: 0\r\n"
+		                             "Connection: close\r\n\r\n";
+		(void)pf_metrics_send_all(sockfd, failed, sizeof(failed) - 1);
+		return;
+	}
+
+	char header[256] = { 0 };
+	const int hlen = _snprintf(header, sizeof(header),
+	                           "HTTP/1.1 200 OK\r\n"
+	                           "Content-Type: application/openmetrics-text; version=1.0.0; "
+	                           "charset=utf-8\r\n"
+	                           "Content-Length: %" PRIuz "\r\n"
+	                           "Connection: close\r\n\r\n",
+	                           Stream_GetPosition(s));
+	if ((hlen > 0) && ((size_t)hlen < sizeof(header)) &&
+	    pf_metrics_send_all(sockfd, header, (size_t)hlen))
+		(void)pf_metrics_send_all(sockfd, Stream_BufferAs(s, char), Stream_GetPosition(s));
+	Stream_Free(s, TRUE);
+}
+
+static DWORD WINAPI pf_metrics_thread(LPVOID arg)
+{
+	proxyMetrics* metrics = arg;
+	WINPR_ASSERT(metrics);
+
+	HANDLE events[] = { metrics->stopEvent, metrics->socketEvent };
+	while (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE) ==
+	       WAIT_OBJECT_0 + 1)
+	{
+		struct sockaddr_storage addr = { 0 };
+		int addrlen = sizeof(addr);
+		const SOCKET sockfd = _accept(metrics->socket, (struct sockaddr*)&addr, &addrlen);
+		if (sockfd == INVALID_SOCKET)
+		{
+			/* Another wakeup without a pending connection, avoid spinning */
+			if (WaitForSingleObject(metrics->stopEvent, 10) == WAIT_OBJECT_0)
+				break;
+			continue;
+		}
+
+		pf_metrics_handle_request(metrics, sockfd);
+		closesocket(sockfd);
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+static SOCKET pf_metrics_listen(const char* host, UINT16 port)
+{
+	char service[8] = { 0 };
+	struct addrinfo hints = { 0 };
+	struct addrinfo* res = NULL;
+	SOCKET sockfd = INVALID_SOCKET;
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	(void)_snprintf(service, sizeof(service), "%" PRIu16, port);
+
+	if (getaddrinfo(host, service, &hints, &res) != 0)
+	{
+		WLog_ERR(TAG, "failed to resolve metrics address %s:%" PRIu16, host, port);
+		return INVALID_SOCKET;
+	}
+
+	for (struct addrinfo* ai = res; ai; ai = ai->ai_next)
+	{
+		int option_value = 1;
+
+		sockfd = _socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (sockfd == INVALID_SOCKET)
+			continue;
+
+		(void)_setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (const char*)&option_value,
+		                  sizeof(option_value));
+
+		if ((_bind(sockfd, ai->ai_addr, (int)ai->ai_addrlen) == 0) && (_listen(sockfd, 10) == 0))
+			break;
+
+		closesocket(sockfd);
+		sockfd = INVALID_SOCKET;
+	}
+
+	freeaddrinfo(res);
+	if (sockfd == INVALID_SOCKET)
+		WLog_ERR(TAG, "failed to listen for metrics on %s:%" PRIu16, host, port);
+	return sockfd;
+}
+
+BOOL pf_metrics_start(proxyMetrics* metrics, const char* host, UINT16 port)
+{
+	WINPR_ASSERT(metrics);
+	WINPR_ASSERT(!metrics->thread);
+
+	metrics->socket = pf_metrics_listen(host, port);
+	if (metrics->socket == INVALID_SOCKET)
+		return FALSE;
+
+	metrics->socketEvent = WSACreateEvent();
+	if (!metrics->socketEvent)
+		goto fail;
+
+	if (WSAEventSelect(metrics->socket, metrics->socketEvent, FD_READ | FD_ACCEPT | FD_CLOSE) !=
+	    0)
+		goto fail;
+
+	(void)ResetEvent(metrics->stopEvent);
+	metrics->thread = CreateThread(NULL, 0, pf_metrics_thread, metrics, 0, NULL);
+	if (!metrics->thread)
+		goto fail;
+
+	WLog_INFO(TAG, "Serving metrics on http://%s:%" PRIu16 "/metrics", host, port);
+	return TRUE;
+
+fail:
+	pf_metrics_stop(metrics);
+	return FALSE;
+}
+
+void pf_metrics_stop(proxyMetrics* metrics)
+{
+	if (!metrics)
+		return;
+
+	if (metrics->thread)
+	{
+		(void)SetEvent(metrics->stopEvent);
+		(void)WaitForSingleObject(metrics->thread, INFINITE);
+		(void)CloseHandle(metrics->thread);
+		metrics->thread = NULL;
+	}
+
+	if (metrics->socketEvent)
+		(void)CloseHandle(metrics->socketEvent);
+	metrics->socketEvent = NULL;
+
+	if (metrics->socket != INVALID_SOCKET)
+		closesocket(metrics->socket);
+	metrics->socket = INVALID_SOCKET;
+}
+
+static void pf_metrics_channel_free(void* obj)
+{
+	free(obj);
+}
+
+proxyMetrics* pf_metrics_new(void)
+{
+	proxyMetrics* metrics = calloc(1, sizeof(proxyMetrics));
+	if (!metrics)
+		return NULL;
+
+	metrics->socket = INVALID_SOCKET;
+	metrics->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!metrics->stopEvent)
+		goto fail;
+
+	metrics->sessions = ArrayList_New(TRUE);
+	if (!metrics->sessions)
+		goto fail;
+
+	metrics->channels = ArrayList_New(TRUE);
+	if (!metrics->channels)
+		goto fail;
+
+	wObject* obj = ArrayList_Object(metrics->channels);
+	WINPR_ASSERT(obj);
+	obj->fnObjectFree = pf_metrics_channel_free;
+
+	return metrics;
+
+fail:
+	pf_metrics_free(metrics);
+	return NULL;
+}
+
+void pf_metrics_free(proxyMetrics* metrics)
+{
+	if (!metrics)
+		return;
+
+	pf_metrics_stop(metrics);
+	ArrayList_Free(metrics->channels);
+	ArrayList_Free(metrics->sessions);
+	if (metrics->stopEvent)
+		(void)CloseHandle(metrics->stopEvent);
+	free(metrics);
+}
+
+proxySessionMetrics* pf_metrics_session_new(proxyMetrics* metrics, const char* sessionId)
+{
+	if (!metrics)
+		return NULL;
+
+	WINPR_ASSERT(sessionId);
+	proxySessionMetrics* session = calloc(1, sizeof(proxySessionMetrics));
+	if (!session)
+		return NULL;
+
+	session->metrics = metrics;
+	(void)strncpy(session->sessionId, sessionId, ARRAYSIZE(session->sessionId) - 1);
+	session->start = winpr_GetTickCount64NS();
+
+	if (!ArrayList_Append(metrics->sessions, session))
+	{
+		free(session);
+		return NULL;
+	}
+
+	pf_metrics_add(&metrics->sessionsTotal, 1);
+	return session;
+}
+
+void pf_metrics_session_free(proxySessionMetrics* session)
+{
+	if (!session)
+		return;
+
+	WINPR_ASSERT(session->metrics);
+	ArrayList_Remove(session->metrics->sessions, session);
+	free(session);
+}
+
+void pf_metrics_session_logon(proxySessionMetrics* session)
+{
+	if (!session || session->logon)
+		return;
+
+	WINPR_ASSERT(session->metrics);
+	session->logon = TRUE;
+	pf_metrics_add(&session->metrics->logonTime,
+	               (LONGLONG)(winpr_GetTickCount64NS() - session->start));
+	pf_metrics_add(&session->metrics->logons, 1);
+}
+
+void pf_metrics_session_backend_connect(proxySessionMetrics* session, BOOL success,
+                                        UINT64 duration_ns)
+{
+	if (!session)
+		return;
+
+	WINPR_ASSERT(session->metrics);
+	if (!success)
+	{
+		pf_metrics_add(&session->metrics->backendFailures, 1);
+		return;
+	}
+
+	pf_metrics_add(&session->metrics->backendConnectTime, (LONGLONG)duration_ns);
+	pf_metrics_add(&session->metrics->backendConnects, 1);
+}
+
+void pf_metrics_session_update(proxySessionMetrics* session, ULONG frontSent, ULONG backSent,
+                               size_t queued)
+{
+	if (!session)
+		return;
+
+	/* The transport counters restart on reconnects and wrap, accumulate them here */
+	pf_metrics_add(&session->frontSent, pf_metrics_delta(frontSent, session->lastFrontSent));
+	pf_metrics_add(&session->backSent, pf_metrics_delta(backSent, session->lastBackSent));
+	session->lastFrontSent = frontSent;
+	session->lastBackSent = backSent;
+	pf_metrics_set(&session->queued, (LONGLONG)queued);
+}
+
+proxyChannelMetrics* pf_metrics_channel(proxySessionMetrics* session, const char* name)
+{
+	proxyChannelMetrics* channel = NULL;
+
+	if (!session)
+		return NULL;
+
+	WINPR_ASSERT(session->metrics);
+	WINPR_ASSERT(name);
+
+	/* Channel names are client controlled, keep them safe to use as a label value */
+	char label[CHANNEL_NAME_LEN + 1] = { 0 };
+	for (size_t x = 0; (x < CHANNEL_NAME_LEN) && (name[x] != '\0'); x++)
+	{
+		const char c = name[x];
+		const BOOL valid = ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+		                   ((c >= '0') && (c <= '9')) || (c == '_') || (c == '-');
+		label[x] = valid ? c : '_';
+	}
+
+	wArrayList* channels = session->metrics->channels;
+	ArrayList_Lock(channels);
+	for (size_t x = 0; x < ArrayList_Count(channels); x++)
+	{
+		proxyChannelMetrics* cur = ArrayList_GetItem(channels, x);
+		if (strcmp(cur->name, label) == 0)
+		{
+			channel = cur;
+			break;
+		}
+	}
+
+	if (!channel)
+	{
+		channel = calloc(1, sizeof(proxyChannelMetrics));
+		if (channel)
+		{
+			memcpy(channel->name, label, sizeof(channel->name));
+			if (!ArrayList_Append(channels, channel))
+			{
+				free(channel);
+				channel = NULL;
+			}
+		}
+	}
+	ArrayList_Unlock(channels);
+	return channel;
+}
+
+void pf_metrics_channel_data(proxyChannelMetrics* channel, pf_metrics_direction direction,
+                             size_t size, UINT32 flags)
+{
+	if (!channel)
+		return;
+
+	WINPR_ASSERT((size_t)direction < ARRAYSIZE(channel->bytes));
+	pf_metrics_add(&channel->bytes[direction], (LONGLONG)size);
+	if (flags & CHANNEL_FLAG_LAST)
+		pf_metrics_add(&channel->pdus[direction], 1);
+}
@@ -0,0 +1,66 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * FreeRDP Proxy Server
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_PROXY_PFMETRICS_H
+#define FREERDP_SERVER_PROXY_PFMETRICS_H
+
+#include <winpr/wtypes.h>
+
+#include <freerdp/server/proxy/proxy_context.h>
+
+typedef struct proxy_metrics proxyMetrics;
+
+/** @brief direction of channel data relative to the proxy */
+typedef enum
+{
+	PF_METRICS_FRONT_TO_BACK = 0,
+	PF_METRICS_BACK_TO_FRONT = 1
+} pf_metrics_direction;
+
+void pf_metrics_free(proxyMetrics* metrics);
+
+WINPR_ATTR_MALLOC(pf_metrics_free, 1)
+proxyMetrics* pf_metrics_new(void);
+
+/**
+ * @brief pf_metrics_start Serves the metrics in OpenMetrics text format over HTTP
+ *
+ * @param metrics The metrics to serve. Must NOT be NULL.
+ * @param host The address to bind to
+ * @param port The TCP port to listen on
+ * @return TRUE for success, FALSE otherwise
+ */
+BOOL pf_metrics_start(proxyMetrics* metrics, const char* host, UINT16 port);
+void pf_metrics_stop(proxyMetrics* metrics);
+
+/* All functions below accept NULL for disabled metrics */
+proxySessionMetrics* pf_metrics_session_new(proxyMetrics* metrics, const char* sessionId);
+void pf_metrics_session_free(proxySessionMetrics* session);
+
+void pf_metrics_session_logon(proxySessionMetrics* session);
+void pf_metrics_session_backend_connect(proxySessionMetrics* session, BOOL success,
+                                        UINT64 duration_ns);
+/* Takes the transport byte counters of both connections, called from the session thread */
+void pf_metrics_session_update(proxySessionMetrics* session, ULONG frontSent, ULONG backSent,
+                               size_t queued);
+
+proxyChannelMetrics* pf_metrics_channel(proxySessionMetrics* session, const char* name);
+/* PDUs are counted on the chunk carrying CHANNEL_FLAG_LAST */
+void pf_metrics_channel_data(proxyChannelMetrics* channel, pf_metrics_direction direction,
+                             size_t size, UINT32 flags);
+
+#endif /* FREERDP_SERVER_PROXY_PFMETRICS_H */
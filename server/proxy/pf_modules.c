@@ -26,6 +26,9 @@
 #include <winpr/wlog.h>
 #include <winpr/path.h>
 #include <winpr/library.h>
+#include <winpr/sysinfo.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
 #include <freerdp/api.h>
 #include <freerdp/build-config.h>
 
@@ -39,11 +42,43 @@
 
 #define MODULE_ENTRY_POINT "proxy_module_entry_point"
 
+/* Plugin calls slower than this are reported, they delay the session thread running them */
+#define PF_MODULES_HOOK_BUDGET_NS (10ull * 1000ull * 1000ull)
+
+/* Pending asynchronous calls per plugin before channel data is dropped for it */
+#define PF_MODULES_ASYNC_QUEUE_MAX 4096
+
+/* Message id of a flush request, data messages use the PF_FILTER_TYPE */
+#define PF_MODULES_ASYNC_FLUSH FILTER_LAST
+
+typedef struct
+{
+	LONGLONG calls;
+	LONGLONG total_ns;
+	LONGLONG max_ns;
+} proxyModuleTiming;
+
+typedef struct
+{
+	proxyPlugin plugin; /* must be first, the list callbacks use the entries as proxyPlugin */
+
+	proxyModuleTiming hooks[HOOK_LAST];
+	proxyModuleTiming filters[FILTER_LAST];
+	proxyModuleTiming async;
+	LONGLONG asyncDropped;
+
+	wMessageQueue* queue;
+	HANDLE thread;
+} proxyPluginEntry;
+
 struct proxy_module
 {
 	proxyPluginsManager mgr;
 	wArrayList* plugins;
 	wArrayList* handles;
+
+	wStreamPool* asyncPool;
+	size_t asyncPlugins;
 };
 
 static const char* pf_modules_get_filter_type_string(PF_FILTER_TYPE result)
@@ -122,10 +157,63 @@ static const char* pf_modules_get_hook_type_string(PF_HOOK_TYPE result)
 	}
 }
 
+static LONGLONG pf_modules_add64(LONGLONG volatile* value, LONGLONG add)
+{
+	LONGLONG cur = *value;
+	LONGLONG prev = 0;
+	while ((prev = InterlockedCompareExchange64(value, cur + add, cur)) != cur)
+		cur = prev;
+	return cur + add;
+}
+
+static BOOL pf_modules_max64(LONGLONG volatile* value, LONGLONG val)
+{
+	LONGLONG cur = *value;
+	while (val > cur)
+	{
+		const LONGLONG prev = InterlockedCompareExchange64(value, val, cur);
+		if (prev == cur)
+			return TRUE;
+		cur = prev;
+	}
+	return FALSE;
+}
+
+static void pf_modules_timing_add(proxyModuleTiming* timing, const proxyPlugin* plugin,
+                                  const char* what, UINT64 start)
+{
+	WINPR_ASSERT(timing);
+	WINPR_ASSERT(plugin);
+
+	const LONGLONG ns = (LONGLONG)(winpr_GetTickCount64NS() - start);
+	pf_modules_add64(&timing->calls, 1);
+	pf_modules_add64(&timing->total_ns, ns);
+
+	/* only new maxima are reported to keep a constantly slow plugin from flooding the log */
+	if (pf_modules_max64(&timing->max_ns, ns) && (ns > (LONGLONG)PF_MODULES_HOOK_BUDGET_NS))
+		WLog_WARN(TAG, "plugin %s, %s took %" PRId64 "us, budget is %" PRIu64 "us", plugin->name,
+		          what, ns / 1000, PF_MODULES_HOOK_BUDGET_NS / 1000);
+}
+
+static void pf_modules_timing_print(const proxyModuleTiming* timing, const proxyPlugin* plugin,
+                                    const char* what)
+{
+	WINPR_ASSERT(timing);
+	WINPR_ASSERT(plugin);
+
+	if (timing->calls == 0)
+		return;
+	WLog_INFO(TAG, "plugin %s, %s: %" PRId64 " calls, avg %" PRId64 "us, max %" PRId64 "us",
+	          plugin->name, what, timing->calls, timing->total_ns / timing->calls / 1000,
+	          timing->max_ns / 1000);
+}
+
 static BOOL pf_modules_proxy_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
 {
-	proxyPlugin* plugin = (proxyPlugin*)data;
-	BOOL ok = FALSE;
+	proxyPluginEntry* entry = (proxyPluginEntry*)data;
+	proxyPlugin* plugin = &entry->plugin;
+	proxyHookFn fn = NULL;
+	BOOL ok = TRUE;
 
 	WINPR_UNUSED(index);
 
@@ -138,74 +226,83 @@ static BOOL pf_modules_proxy_ArrayList_ForEachFkt(void* data, size_t index, va_l
 	switch (type)
 	{
 		case HOOK_TYPE_CLIENT_INIT_CONNECT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientInitConnect, plugin, pdata, custom);
+			fn = plugin->ClientInitConnect;
 			break;
 		case HOOK_TYPE_CLIENT_UNINIT_CONNECT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientUninitConnect, plugin, pdata, custom);
+			fn = plugin->ClientUninitConnect;
 			break;
 		case HOOK_TYPE_CLIENT_PRE_CONNECT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientPreConnect, plugin, pdata, custom);
+			fn = plugin->ClientPreConnect;
 			break;
 
 		case HOOK_TYPE_CLIENT_POST_CONNECT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientPostConnect, plugin, pdata, custom);
+			fn = plugin->ClientPostConnect;
 			break;
 
 		case HOOK_TYPE_CLIENT_REDIRECT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientRedirect, plugin, pdata, custom);
+			fn = plugin->ClientRedirect;
 			break;
 
 		case HOOK_TYPE_CLIENT_POST_DISCONNECT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientPostDisconnect, plugin, pdata, custom);
+			fn = plugin->ClientPostDisconnect;
 			break;
 
 		case HOOK_TYPE_CLIENT_VERIFY_X509:
-			ok = IFCALLRESULT(TRUE, plugin->ClientX509Certificate, plugin, pdata, custom);
+			fn = plugin->ClientX509Certificate;
 			break;
 
 		case HOOK_TYPE_CLIENT_LOGIN_FAILURE:
-			ok = IFCALLRESULT(TRUE, plugin->ClientLoginFailure, plugin, pdata, custom);
+			fn = plugin->ClientLoginFailure;
 			break;
 
 		case HOOK_TYPE_CLIENT_END_PAINT:
-			ok = IFCALLRESULT(TRUE, plugin->ClientEndPaint, plugin, pdata, custom);
+			fn = plugin->ClientEndPaint;
 			break;
 
 		case HOOK_TYPE_CLIENT_LOAD_CHANNELS:
-			ok = IFCALLRESULT(TRUE, plugin->ClientLoadChannels, plugin, pdata, custom);
+			fn = plugin->ClientLoadChannels;
 			break;
 
 		case HOOK_TYPE_SERVER_POST_CONNECT:
-			ok = IFCALLRESULT(TRUE, plugin->ServerPostConnect, plugin, pdata, custom);
+			fn = plugin->ServerPostConnect;
 			break;
 
 		case HOOK_TYPE_SERVER_ACTIVATE:
-			ok = IFCALLRESULT(TRUE, plugin->ServerPeerActivate, plugin, pdata, custom);
+			fn = plugin->ServerPeerActivate;
 			break;
 
 		case HOOK_TYPE_SERVER_CHANNELS_INIT:
-			ok = IFCALLRESULT(TRUE, plugin->ServerChannelsInit, plugin, pdata, custom);
+			fn = plugin->ServerChannelsInit;
 			break;
 
 		case HOOK_TYPE_SERVER_CHANNELS_FREE:
-			ok = IFCALLRESULT(TRUE, plugin->ServerChannelsFree, plugin, pdata, custom);
+			fn = plugin->ServerChannelsFree;
 			break;
 
 		case HOOK_TYPE_SERVER_SESSION_END:
-			ok = IFCALLRESULT(TRUE, plugin->ServerSessionEnd, plugin, pdata, custom);
+			fn = plugin->ServerSessionEnd;
 			break;
 
 		case HOOK_TYPE_SERVER_SESSION_INITIALIZE:
-			ok = IFCALLRESULT(TRUE, plugin->ServerSessionInitialize, plugin, pdata, custom);
+			fn = plugin->ServerSessionInitialize;
 			break;
 
 		case HOOK_TYPE_SERVER_SESSION_STARTED:
-			ok = IFCALLRESULT(TRUE, plugin->ServerSessionStarted, plugin, pdata, custom);
+			fn = plugin->ServerSessionStarted;
 			break;
 
 		case HOOK_LAST:
 		default:
 			WLog_ERR(TAG, "invalid hook called");
+			return FALSE;
+	}
+
+	if (fn)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		ok = fn(plugin, pdata, custom);
+		pf_modules_timing_add(&entry->hooks[type], plugin, pf_modules_get_hook_type_string(type),
+		                      start);
 	}
 
 	if (!ok)
@@ -217,6 +314,177 @@ static BOOL pf_modules_proxy_ArrayList_ForEachFkt(void* data, size_t index, va_l
 	return TRUE;
 }
 
+static proxyHookFn pf_modules_get_async_hook(const proxyPlugin* plugin, UINT32 type)
+{
+	WINPR_ASSERT(plugin);
+
+	switch (type)
+	{
+		case FILTER_TYPE_CLIENT_PASSTHROUGH_CHANNEL_DATA:
+			return plugin->ClientChannelDataAsync;
+		case FILTER_TYPE_SERVER_PASSTHROUGH_CHANNEL_DATA:
+			return plugin->ServerChannelDataAsync;
+		default:
+			return NULL;
+	}
+}
+
+static BOOL pf_modules_has_async_hooks(const proxyPlugin* plugin)
+{
+	return pf_modules_get_async_hook(plugin, FILTER_TYPE_CLIENT_PASSTHROUGH_CHANNEL_DATA) ||
+	       pf_modules_get_async_hook(plugin, FILTER_TYPE_SERVER_PASSTHROUGH_CHANNEL_DATA);
+}
+
+static void pf_modules_async_message_free(void* obj)
+{
+	wMessage* msg = obj;
+	WINPR_ASSERT(msg);
+
+	switch (msg->id)
+	{
+		case WMQ_QUIT:
+			break;
+		case PF_MODULES_ASYNC_FLUSH:
+			(void)SetEvent(msg->wParam);
+			break;
+		default:
+			Stream_Release(msg->wParam);
+			break;
+	}
+}
+
+static DWORD WINAPI pf_modules_async_thread(LPVOID arg)
+{
+	proxyPluginEntry* entry = arg;
+	proxyPlugin* plugin = NULL;
+	wMessage msg = { 0 };
+
+	WINPR_ASSERT(entry);
+	plugin = &entry->plugin;
+
+	while (MessageQueue_Get(entry->queue, &msg) > 0)
+	{
+		if (msg.id == PF_MODULES_ASYNC_FLUSH)
+		{
+			(void)SetEvent(msg.wParam);
+			continue;
+		}
+
+		wStream* s = msg.wParam;
+		const proxyHookFn fn = pf_modules_get_async_hook(plugin, msg.id);
+		if (fn)
+		{
+			const UINT64 start = winpr_GetTickCount64NS();
+			if (!fn(plugin, msg.context, Stream_Buffer(s)))
+				WLog_DBG(TAG, "plugin %s, async %s failed", plugin->name,
+				         pf_modules_get_filter_type_string(msg.id));
+			pf_modules_timing_add(&entry->async, plugin, "async channel data", start);
+		}
+		Stream_Release(s);
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+static BOOL pf_modules_async_post_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
+{
+	proxyPluginEntry* entry = (proxyPluginEntry*)data;
+
+	WINPR_UNUSED(index);
+
+	PF_FILTER_TYPE type = va_arg(ap, PF_FILTER_TYPE);
+	proxyData* pdata = va_arg(ap, proxyData*);
+	wStream* s = va_arg(ap, wStream*);
+
+	if (!entry->queue || !pf_modules_get_async_hook(&entry->plugin, type))
+		return TRUE;
+
+	/* a plugin not keeping up loses data instead of growing the queue without bounds */
+	if (MessageQueue_Size(entry->queue) >= PF_MODULES_ASYNC_QUEUE_MAX)
+	{
+		const LONGLONG dropped = pf_modules_add64(&entry->asyncDropped, 1);
+		if ((dropped & (dropped - 1)) == 0)
+			WLog_WARN(TAG, "plugin %s, dropped %" PRId64 " asynchronous calls so far",
+			          entry->plugin.name, dropped);
+		return TRUE;
+	}
+
+	Stream_AddRef(s);
+	if (!MessageQueue_Post(entry->queue, pdata, type, s, NULL))
+		Stream_Release(s);
+	return TRUE;
+}
+
+/* The copy is shared between all plugins, each pending call holds a reference */
+static void pf_modules_run_async(proxyModule* module, PF_FILTER_TYPE type, proxyData* pdata,
+                                 const proxyChannelDataEventInfo* ev)
+{
+	WINPR_ASSERT(module);
+	WINPR_ASSERT(ev);
+
+	if (module->asyncPlugins == 0)
+		return;
+
+	const size_t namelen = ev->channel_name ? strlen(ev->channel_name) + 1 : 0;
+	wStream* s = StreamPool_Take(module->asyncPool, sizeof(*ev) + ev->data_len + namelen);
+	if (!s)
+		return;
+
+	proxyChannelDataEventInfo* copy = (proxyChannelDataEventInfo*)Stream_Buffer(s);
+	BYTE* buffer = Stream_Buffer(s) + sizeof(*copy);
+
+	*copy = *ev;
+	if (ev->data_len > 0)
+		memcpy(buffer, ev->data, ev->data_len);
+	copy->data = buffer;
+
+	if (ev->channel_name)
+	{
+		char* name = (char*)&buffer[ev->data_len];
+		memcpy(name, ev->channel_name, namelen);
+		copy->channel_name = name;
+	}
+
+	ArrayList_ForEach(module->plugins, pf_modules_async_post_ArrayList_ForEachFkt, type, pdata, s);
+	Stream_Release(s);
+}
+
+static BOOL pf_modules_async_flush_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
+{
+	proxyPluginEntry* entry = (proxyPluginEntry*)data;
+
+	WINPR_UNUSED(index);
+
+	HANDLE event = va_arg(ap, HANDLE);
+
+	if (!entry->queue)
+		return TRUE;
+
+	(void)ResetEvent(event);
+	/* runs after all calls queued before, the worker handles them in order */
+	if (!MessageQueue_Post(entry->queue, NULL, PF_MODULES_ASYNC_FLUSH, event, NULL))
+		return TRUE;
+	(void)WaitForSingleObject(event, INFINITE);
+	return TRUE;
+}
+
+void pf_modules_flush_async(proxyModule* module)
+{
+	if (!module || (module->asyncPlugins == 0))
+		return;
+
+	HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!event)
+	{
+		WLog_ERR(TAG, "CreateEvent failed!");
+		return;
+	}
+
+	ArrayList_ForEach(module->plugins, pf_modules_async_flush_ArrayList_ForEachFkt, event);
+	(void)CloseHandle(event);
+}
+
 /*
  * runs all hooks of type `type`.
  *
@@ -227,14 +495,21 @@ BOOL pf_modules_run_hook(proxyModule* module, PF_HOOK_TYPE type, proxyData* pdat
 {
 	WINPR_ASSERT(module);
 	WINPR_ASSERT(module->plugins);
+
+	/* plugins free their session data when the session ends */
+	if (type == HOOK_TYPE_SERVER_SESSION_END)
+		pf_modules_flush_async(module);
+
 	return ArrayList_ForEach(module->plugins, pf_modules_proxy_ArrayList_ForEachFkt, type, pdata,
 	                         custom);
 }
 
 static BOOL pf_modules_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
 {
-	proxyPlugin* plugin = (proxyPlugin*)data;
-	BOOL result = FALSE;
+	proxyPluginEntry* entry = (proxyPluginEntry*)data;
+	proxyPlugin* plugin = &entry->plugin;
+	proxyFilterFn fn = NULL;
+	BOOL result = TRUE;
 
 	WINPR_UNUSED(index);
 
@@ -247,60 +522,69 @@ static BOOL pf_modules_ArrayList_ForEachFkt(void* data, size_t index, va_list ap
 	switch (type)
 	{
 		case FILTER_TYPE_KEYBOARD:
-			result = IFCALLRESULT(TRUE, plugin->KeyboardEvent, plugin, pdata, param);
+			fn = plugin->KeyboardEvent;
 			break;
 
 		case FILTER_TYPE_UNICODE:
-			result = IFCALLRESULT(TRUE, plugin->UnicodeEvent, plugin, pdata, param);
+			fn = plugin->UnicodeEvent;
 			break;
 
 		case FILTER_TYPE_MOUSE:
-			result = IFCALLRESULT(TRUE, plugin->MouseEvent, plugin, pdata, param);
+			fn = plugin->MouseEvent;
 			break;
 
 		case FILTER_TYPE_MOUSE_EX:
-			result = IFCALLRESULT(TRUE, plugin->MouseExEvent, plugin, pdata, param);
+			fn = plugin->MouseExEvent;
 			break;
 
 		case FILTER_TYPE_CLIENT_PASSTHROUGH_CHANNEL_DATA:
-			result = IFCALLRESULT(TRUE, plugin->ClientChannelData, plugin, pdata, param);
+			fn = plugin->ClientChannelData;
 			break;
 
 		case FILTER_TYPE_SERVER_PASSTHROUGH_CHANNEL_DATA:
-			result = IFCALLRESULT(TRUE, plugin->ServerChannelData, plugin, pdata, param);
+			fn = plugin->ServerChannelData;
 			break;
 
 		case FILTER_TYPE_CLIENT_PASSTHROUGH_CHANNEL_CREATE:
-			result = IFCALLRESULT(TRUE, plugin->ChannelCreate, plugin, pdata, param);
+			fn = plugin->ChannelCreate;
 			break;
 
 		case FILTER_TYPE_CLIENT_PASSTHROUGH_DYN_CHANNEL_CREATE:
-			result = IFCALLRESULT(TRUE, plugin->DynamicChannelCreate, plugin, pdata, param);
+			fn = plugin->DynamicChannelCreate;
 			break;
 
 		case FILTER_TYPE_SERVER_FETCH_TARGET_ADDR:
-			result = IFCALLRESULT(TRUE, plugin->ServerFetchTargetAddr, plugin, pdata, param);
+			fn = plugin->ServerFetchTargetAddr;
 			break;
 
 		case FILTER_TYPE_SERVER_PEER_LOGON:
-			result = IFCALLRESULT(TRUE, plugin->ServerPeerLogon, plugin, pdata, param);
+			fn = plugin->ServerPeerLogon;
 			break;
 
 		case FILTER_TYPE_INTERCEPT_CHANNEL:
-			result = IFCALLRESULT(TRUE, plugin->DynChannelIntercept, plugin, pdata, param);
+			fn = plugin->DynChannelIntercept;
 			break;
 
 		case FILTER_TYPE_DYN_INTERCEPT_LIST:
-			result = IFCALLRESULT(TRUE, plugin->DynChannelToIntercept, plugin, pdata, param);
+			fn = plugin->DynChannelToIntercept;
 			break;
 
 		case FILTER_TYPE_STATIC_INTERCEPT_LIST:
-			result = IFCALLRESULT(TRUE, plugin->StaticChannelToIntercept, plugin, pdata, param);
+			fn = plugin->StaticChannelToIntercept;
 			break;
 
 		case FILTER_LAST:
 		default:
 			WLog_ERR(TAG, "invalid filter called");
+			return FALSE;
+	}
+
+	if (fn)
+	{
+		const UINT64 start = winpr_GetTickCount64NS();
+		result = fn(plugin, pdata, param);
+		pf_modules_timing_add(&entry->filters[type], plugin,
+		                      pf_modules_get_filter_type_string(type), start);
 	}
 
 	if (!result)
@@ -323,7 +607,19 @@ BOOL pf_modules_run_filter(proxyModule* module, PF_FILTER_TYPE type, proxyData*
 	WINPR_ASSERT(module);
 	WINPR_ASSERT(module->plugins);
 
-	return ArrayList_ForEach(module->plugins, pf_modules_ArrayList_ForEachFkt, type, pdata, param);
+	if (!ArrayList_ForEach(module->plugins, pf_modules_ArrayList_ForEachFkt, type, pdata, param))
+		return FALSE;
+
+	switch (type)
+	{
+		case FILTER_TYPE_CLIENT_PASSTHROUGH_CHANNEL_DATA:
+		case FILTER_TYPE_SERVER_PASSTHROUGH_CHANNEL_DATA:
+			pf_modules_run_async(module, type, pdata, param);
+			break;
+		default:
+			break;
+	}
+	return TRUE;
 }
 
 /*
@@ -423,6 +719,8 @@ static BOOL pf_modules_register_plugin(proxyPluginsManager* mgr,
 		return FALSE;
 	}
 
+	if (pf_modules_has_async_hooks(&internal))
+		module->asyncPlugins++;
 	return TRUE;
 }
 
@@ -452,6 +750,40 @@ BOOL pf_modules_is_plugin_loaded(proxyModule* module, const char* plugin_name)
 	return rc;
 }
 
+static BOOL pf_modules_has_hook_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
+{
+	proxyPlugin* plugin = (proxyPlugin*)data;
+
+	WINPR_UNUSED(index);
+
+	PF_HOOK_TYPE type = va_arg(ap, PF_HOOK_TYPE);
+	BOOL* res = va_arg(ap, BOOL*);
+	WINPR_ASSERT(res);
+
+	switch (type)
+	{
+		case HOOK_TYPE_CLIENT_END_PAINT:
+			if (plugin->ClientEndPaint)
+				*res = TRUE;
+			break;
+		default:
+			*res = TRUE;
+			break;
+	}
+	return TRUE;
+}
+
+BOOL pf_modules_has_hook(proxyModule* module, PF_HOOK_TYPE type)
+{
+	BOOL rc = FALSE;
+	WINPR_ASSERT(module);
+	if (ArrayList_Count(module->plugins) < 1)
+		return FALSE;
+	if (!ArrayList_ForEach(module->plugins, pf_modules_has_hook_ArrayList_ForEachFkt, type, &rc))
+		return TRUE;
+	return rc;
+}
+
 static BOOL pf_modules_print_ArrayList_ForEachFkt(void* data, size_t index, va_list ap)
 {
 	proxyPlugin* plugin = (proxyPlugin*)data;
@@ -519,23 +851,64 @@ static void free_handle(void* obj)
 
 static void free_plugin(void* obj)
 {
-	proxyPlugin* plugin = (proxyPlugin*)obj;
-	WINPR_ASSERT(plugin);
+	proxyPluginEntry* entry = (proxyPluginEntry*)obj;
+	WINPR_ASSERT(entry);
+	proxyPlugin* plugin = &entry->plugin;
+
+	if (entry->queue)
+	{
+		if (entry->thread)
+		{
+			(void)MessageQueue_PostQuit(entry->queue, 0);
+			(void)WaitForSingleObject(entry->thread, INFINITE);
+			(void)CloseHandle(entry->thread);
+		}
+		MessageQueue_Free(entry->queue);
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(entry->hooks); x++)
+		pf_modules_timing_print(&entry->hooks[x], plugin, pf_modules_get_hook_type_string(x));
+	for (size_t x = 0; x < ARRAYSIZE(entry->filters); x++)
+		pf_modules_timing_print(&entry->filters[x], plugin, pf_modules_get_filter_type_string(x));
+	pf_modules_timing_print(&entry->async, plugin, "async channel data");
+	if (entry->asyncDropped > 0)
+		WLog_WARN(TAG, "plugin %s, dropped %" PRId64 " asynchronous calls", plugin->name,
+		          entry->asyncDropped);
 
 	if (!IFCALLRESULT(TRUE, plugin->PluginUnload, plugin))
 		WLog_WARN(TAG, "PluginUnload failed for plugin '%s'", plugin->name);
 
-	free(plugin);
+	free(entry);
 }
 
 static void* new_plugin(const void* obj)
 {
 	const proxyPlugin* src = obj;
-	proxyPlugin* proxy = calloc(1, sizeof(proxyPlugin));
-	if (!proxy)
+	proxyPluginEntry* entry = calloc(1, sizeof(proxyPluginEntry));
+	if (!entry)
 		return NULL;
-	*proxy = *src;
-	return proxy;
+	entry->plugin = *src;
+
+	if (pf_modules_has_async_hooks(src))
+	{
+		wObject queueCallbacks = { 0 };
+		queueCallbacks.fnObjectFree = pf_modules_async_message_free;
+
+		entry->queue = MessageQueue_New(&queueCallbacks);
+		if (!entry->queue)
+			goto fail;
+
+		entry->thread = CreateThread(NULL, 0, pf_modules_async_thread, entry, 0, NULL);
+		if (!entry->thread)
+			goto fail;
+	}
+	return entry;
+
+fail:
+	WLog_ERR(TAG, "failed to start the asynchronous worker of plugin %s", src->name);
+	MessageQueue_Free(entry->queue);
+	free(entry);
+	return NULL;
 }
 
 proxyModule* pf_modules_new(const char* root_dir, const char** modules, size_t count)
@@ -550,6 +923,13 @@ proxyModule* pf_modules_new(const char* root_dir, const char** modules, size_t c
 	module->mgr.SetPluginData = pf_modules_set_plugin_data;
 	module->mgr.GetPluginData = pf_modules_get_plugin_data;
 	module->mgr.AbortConnect = pf_modules_abort_connect;
+	module->asyncPool = StreamPool_New(TRUE, 4096);
+	if (!module->asyncPool)
+	{
+		WLog_ERR(TAG, "StreamPool_New failed!");
+		goto error;
+	}
+
 	module->plugins = ArrayList_New(FALSE);
 
 	if (module->plugins == NULL)
@@ -618,8 +998,10 @@ void pf_modules_free(proxyModule* module)
 	if (!module)
 		return;
 
+	/* stops the asynchronous workers, which return their streams to the pool */
 	ArrayList_Free(module->plugins);
 	ArrayList_Free(module->handles);
+	StreamPool_Free(module->asyncPool);
 	free(module);
 }
 
@@ -0,0 +1,405 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * FreeRDP Proxy Server
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,cert-dcl37-c,cert-dcl51-cpp)
+#endif
+
+#include <winpr/assert.h>
+#include <winpr/string.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/server/proxy/proxy_log.h>
+
+#include "pf_passthrough.h"
+#include "pf_server.h"
+#include "pf_pool.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#define PF_PASSTHROUGH_SPLICE
+#endif
+
+#define TAG PROXY_TAG("passthrough")
+
+/* The X.224 Connection Request must arrive within this time, in ms */
+#define PF_PASSTHROUGH_REQUEST_TIMEOUT_MS 5000
+#define PF_PASSTHROUGH_REQUEST_MAX_SIZE 4096
+#define PF_PASSTHROUGH_CHUNK_SIZE 65536
+#define PF_PASSTHROUGH_HOST_MAX 100
+
+#define ROUTING_TOKEN_PREFIX "Cookie: msts="
+
+/* One direction of the relay, data read from src waits in the pipe or buffer until sent to dst */
+typedef struct
+{
+	SOCKET src;
+	SOCKET dst;
+#if defined(PF_PASSTHROUGH_SPLICE)
+	int pipe[2];
+#else
+	BYTE buffer[PF_PASSTHROUGH_CHUNK_SIZE];
+	size_t offset;
+#endif
+	size_t pending;
+	BOOL eof;
+} proxyPassthroughPipe;
+
+static BOOL pf_passthrough_would_block(void)
+{
+	const int err = WSAGetLastError();
+	return (err == WSAEWOULDBLOCK) || (err == WSAEINTR);
+}
+
+static BOOL pf_passthrough_pipe_init(proxyPassthroughPipe* p, SOCKET src, SOCKET dst)
+{
+	WINPR_ASSERT(p);
+
+	p->src = src;
+	p->dst = dst;
+#if defined(PF_PASSTHROUGH_SPLICE)
+	if (pipe2(p->pipe, O_NONBLOCK | O_CLOEXEC) != 0)
+	{
+		p->pipe[0] = p->pipe[1] = -1;
+		return FALSE;
+	}
+#endif
+	return TRUE;
+}
+
+static void pf_passthrough_pipe_uninit(proxyPassthroughPipe* p)
+{
+	WINPR_ASSERT(p);
+
+#if defined(PF_PASSTHROUGH_SPLICE)
+	for (size_t x = 0; x < ARRAYSIZE(p->pipe); x++)
+	{
+		if (p->pipe[x] >= 0)
+			(void)close(p->pipe[x]);
+	}
+#endif
+}
+
+/* Queues data already read from src, the pipe is empty at this point */
+static BOOL pf_passthrough_pipe_queue(proxyPassthroughPipe* p, const BYTE* data, size_t length)
+{
+	WINPR_ASSERT(p);
+	WINPR_ASSERT(p->pending == 0);
+
+#if defined(PF_PASSTHROUGH_SPLICE)
+	const ssize_t rc = write(p->pipe[1], data, length);
+	if ((rc < 0) || ((size_t)rc != length))
+		return FALSE;
+#else
+	if (length > sizeof(p->buffer))
+		return FALSE;
+	memcpy(p->buffer, data, length);
+	p->offset = 0;
+#endif
+	p->pending = length;
+	return TRUE;
+}
+
+static SSIZE_T pf_passthrough_pipe_send(proxyPassthroughPipe* p)
+{
+#if defined(PF_PASSTHROUGH_SPLICE)
+	return splice(p->pipe[0], NULL, (int)p->dst, NULL, p->pending,
+	              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+#else
+	const int len = (int)MIN(p->pending, INT32_MAX);
+	const SSIZE_T rc = _send(p->dst, (const char*)&p->buffer[p->offset], len, 0);
+	if (rc > 0)
+		p->offset += (size_t)rc;
+	return rc;
+#endif
+}
+
+static SSIZE_T pf_passthrough_pipe_receive(proxyPassthroughPipe* p)
+{
+#if defined(PF_PASSTHROUGH_SPLICE)
+	return splice((int)p->src, NULL, p->pipe[1], NULL, PF_PASSTHROUGH_CHUNK_SIZE,
+	              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+#else
+	p->offset = 0;
+	return _recv(p->src, (char*)p->buffer, sizeof(p->buffer), 0);
+#endif
+}
+
+/**
+ * Moves data from src to dst until one of them would block.
+ * Returns FALSE if the connection failed or src was closed and everything was sent.
+ */
+static BOOL pf_passthrough_pipe_pump(proxyPassthroughPipe* p)
+{
+	WINPR_ASSERT(p);
+
+	while (1)
+	{
+		if (p->pending > 0)
+		{
+			const SSIZE_T rc = pf_passthrough_pipe_send(p);
+			if (rc < 0)
+				return pf_passthrough_would_block();
+			p->pending -= (size_t)rc;
+			continue;
+		}
+
+		if (p->eof)
+			return FALSE;
+
+		const SSIZE_T rc = pf_passthrough_pipe_receive(p);
+		if (rc < 0)
+			return pf_passthrough_would_block();
+		if (rc == 0)
+			p->eof = TRUE;
+		p->pending = (size_t)rc;
+	}
+}
+
+/* A direction either waits for src to become readable or for dst to become writable */
+static LONG pf_passthrough_socket_events(SOCKET s, const proxyPassthroughPipe* pipes, size_t count)
+{
+	LONG events = FD_CLOSE;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		const proxyPassthroughPipe* p = &pipes[x];
+		if ((p->pending == 0) && (p->src == s))
+			events |= FD_READ;
+		if ((p->pending > 0) && (p->dst == s))
+			events |= FD_WRITE;
+	}
+
+	return events;
+}
+
+static BOOL pf_passthrough_relay(proxyServer* server, SOCKET peer, SOCKET target,
+                                 const BYTE* request, size_t length)
+{
+	BOOL rc = FALSE;
+	HANDLE peerEvent = NULL;
+	HANDLE targetEvent = NULL;
+	proxyPassthroughPipe pipes[2] = { 0 };
+
+	WINPR_ASSERT(server);
+
+	/* both are initialized, a failed one is still safe to uninit */
+	const BOOL forward = pf_passthrough_pipe_init(&pipes[0], peer, target);
+	const BOOL backward = pf_passthrough_pipe_init(&pipes[1], target, peer);
+	if (!forward || !backward)
+		goto fail;
+
+	/* The Connection Request is forwarded unchanged */
+	if (!pf_passthrough_pipe_queue(&pipes[0], request, length))
+		goto fail;
+
+	peerEvent = WSACreateEvent();
+	targetEvent = WSACreateEvent();
+	if (!peerEvent || !targetEvent)
+		goto fail;
+
+	/* pooled target connections are blocking */
+	u_long arg = 1;
+	if ((_ioctlsocket(peer, FIONBIO, &arg) != 0) || (_ioctlsocket(target, FIONBIO, &arg) != 0))
+		goto fail;
+
+	while (WaitForSingleObject(server->stopEvent, 0) != WAIT_OBJECT_0)
+	{
+		if (!pf_passthrough_pipe_pump(&pipes[0]) || !pf_passthrough_pipe_pump(&pipes[1]))
+		{
+			rc = TRUE;
+			break;
+		}
+
+		if ((WSAEventSelect(peer, peerEvent,
+		                    pf_passthrough_socket_events(peer, pipes, ARRAYSIZE(pipes))) != 0) ||
+		    (WSAEventSelect(target, targetEvent,
+		                    pf_passthrough_socket_events(target, pipes, ARRAYSIZE(pipes))) != 0))
+			break;
+
+		HANDLE events[] = { server->stopEvent, peerEvent, targetEvent };
+		if (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE) == WAIT_FAILED)
+			break;
+	}
+
+fail:
+	if (peerEvent)
+		(void)CloseHandle(peerEvent);
+	if (targetEvent)
+		(void)CloseHandle(targetEvent);
+	pf_passthrough_pipe_uninit(&pipes[0]);
+	pf_passthrough_pipe_uninit(&pipes[1]);
+	return rc;
+}
+
+/* Reads the TPKT framed X.224 Connection Request, nothing beyond it */
+static size_t pf_passthrough_read_request(proxyServer* server, SOCKET sockfd, BYTE* buffer,
+                                          size_t size)
+{
+	size_t length = 4;
+	size_t offset = 0;
+	const UINT64 deadline = GetTickCount64() + PF_PASSTHROUGH_REQUEST_TIMEOUT_MS;
+
+	WINPR_ASSERT(server);
+	WINPR_ASSERT(buffer);
+	WINPR_ASSERT(size >= length);
+
+	HANDLE event = WSACreateEvent();
+	if (!event)
+		return 0;
+
+	if (WSAEventSelect(sockfd, event, FD_READ | FD_CLOSE) != 0)
+		goto fail;
+
+	while (offset < length)
+	{
+		const UINT64 now = GetTickCount64();
+		if (now >= deadline)
+			goto fail;
+
+		HANDLE events[] = { server->stopEvent, event };
+		if (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, (DWORD)(deadline - now)) !=
+		    WAIT_OBJECT_0 + 1)
+			goto fail;
+
+		const int rc = _recv(sockfd, (char*)&buffer[offset], (int)(length - offset), 0);
+		if (rc == 0)
+			goto fail;
+		if (rc < 0)
+		{
+			if (pf_passthrough_would_block())
+				continue;
+			goto fail;
+		}
+		offset += (size_t)rc;
+
+		if ((offset == 4) && (length == 4))
+		{
+			/* TPKT version 3, 16 bit big endian length */
+			length = ((size_t)buffer[2] << 8) | buffer[3];
+			if ((buffer[0] != 3) || (length < 11) || (length > size))
+				goto fail;
+		}
+	}
+
+	(void)CloseHandle(event);
+	return length;
+
+fail:
+	(void)CloseHandle(event);
+	return 0;
+}
+
+/* The same "Cookie: msts=host[:port]" format the full proxy accepts */
+static BOOL pf_passthrough_parse_target(const BYTE* request, size_t length, char* host,
+                                        size_t hostSize, UINT16* port)
+{
+	const size_t prefix_len = strnlen(ROUTING_TOKEN_PREFIX, sizeof(ROUTING_TOKEN_PREFIX));
+
+	WINPR_ASSERT(request);
+	WINPR_ASSERT(host);
+	WINPR_ASSERT(port);
+
+	/* X.224 Connection Request, LI covers everything after itself */
+	if ((request[4] != length - 5) || ((request[5] & 0xF0) != 0xE0))
+		return FALSE;
+
+	const char* token = (const char*)&request[11];
+	const size_t remain = length - 11;
+	if ((remain <= prefix_len) || (strncmp(token, ROUTING_TOKEN_PREFIX, prefix_len) != 0))
+		return FALSE;
+
+	size_t end = prefix_len;
+	while ((end + 1 < remain) && !((token[end] == '\r') && (token[end + 1] == '\n')))
+		end++;
+	if (end + 1 >= remain)
+		return FALSE;
+
+	size_t len = end - prefix_len;
+	const char* colon = memchr(&token[prefix_len], ':', len);
+	if (colon)
+	{
+		char str[8] = { 0 };
+		const size_t portLen = (size_t)(&token[end] - colon) - 1;
+		if ((portLen == 0) || (portLen >= sizeof(str)))
+			return FALSE;
+		memcpy(str, colon + 1, portLen);
+
+		const unsigned long p = strtoul(str, NULL, 10);
+		if ((p == 0) || (p > UINT16_MAX))
+			return FALSE;
+		*port = (UINT16)p;
+		len = (size_t)(colon - &token[prefix_len]);
+	}
+
+	if ((len == 0) || (len >= hostSize))
+		return FALSE;
+	memcpy(host, &token[prefix_len], len);
+	host[len] = '\0';
+	return TRUE;
+}
+
+BOOL pf_passthrough_run(proxyServer* server, SOCKET sockfd, const char* peer)
+{
+	BYTE request[PF_PASSTHROUGH_REQUEST_MAX_SIZE] = { 0 };
+	char host[PF_PASSTHROUGH_HOST_MAX] = { 0 };
+	UINT16 port = 3389;
+	SOCKET target = INVALID_SOCKET;
+
+	WINPR_ASSERT(server);
+	WINPR_ASSERT(server->config);
+
+	const proxyConfig* config = server->config;
+	const size_t length = pf_passthrough_read_request(server, sockfd, request, sizeof(request));
+	if (length == 0)
+	{
+		WLog_WARN(TAG, "no valid connection request from %s", peer);
+		return FALSE;
+	}
+
+	if (config->FixedTarget)
+	{
+		(void)_snprintf(host, sizeof(host), "%s", config->TargetHost);
+		if (config->TargetPort > 0)
+			port = config->TargetPort;
+	}
+	else if (!pf_passthrough_parse_target(request, length, host, sizeof(host), &port))
+	{
+		WLog_WARN(TAG, "no routing token in connection request from %s", peer);
+		return FALSE;
+	}
+
+	if (server->pool)
+		target = pf_pool_acquire(server->pool, host, port);
+	if (target == INVALID_SOCKET)
+		target = pf_pool_connect_host(host, port, server->stopEvent);
+	if (target == INVALID_SOCKET)
+	{
+		WLog_WARN(TAG, "failed to connect %s to %s:%" PRIu16, peer, host, port);
+		return FALSE;
+	}
+
+	WLog_INFO(TAG, "relaying %s to %s:%" PRIu16, peer, host, port);
+	const BOOL rc = pf_passthrough_relay(server, sockfd, target, request, length);
+	WLog_INFO(TAG, "connection of %s to %s:%" PRIu16 " closed", peer, host, port);
+
+	closesocket(target);
+	return rc;
+}
@@ -0,0 +1,41 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * FreeRDP Proxy Server
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_PROXY_PFPASSTHROUGH_H
+#define FREERDP_SERVER_PROXY_PFPASSTHROUGH_H
+
+#include <winpr/wtypes.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/server/proxy/proxy_server.h>
+
+/**
+ * @brief pf_passthrough_run Routes a connection without terminating TLS or NLA
+ *
+ * Only the X.224 Connection Request is read from the peer, the target is taken from
+ * the configured fixed target or the routing token. The request is forwarded unchanged
+ * and the sockets are relayed (with splice on linux) until either side closes or the
+ * server is stopped. No modules are run for these connections.
+ *
+ * @param server The proxy server. Must NOT be NULL.
+ * @param sockfd The connected peer socket, owned by the caller
+ * @param peer The peer address, for logging
+ * @return TRUE if a target connection was relayed, FALSE otherwise
+ */
+BOOL pf_passthrough_run(proxyServer* server, SOCKET sockfd, const char* peer);
+
+#endif /* FREERDP_SERVER_PROXY_PFPASSTHROUGH_H */
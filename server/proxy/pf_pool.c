@@ -0,0 +1,369 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * FreeRDP Proxy Server
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/assert.h>
+#include <winpr/string.h>
+#include <winpr/synch.h>
+#include <winpr/sysinfo.h>
+#include <winpr/thread.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/transport_io.h>
+#include <freerdp/server/proxy/proxy_log.h>
+
+#include "pf_pool.h"
+
+#define TAG PROXY_TAG("pool")
+
+/* Targets drop connections that do not start the X.224 negotiation, recycle them early */
+#define PF_POOL_MAX_IDLE_MS 20000
+#define PF_POOL_CONNECT_TIMEOUT_MS 5000
+#define PF_POOL_CHECK_INTERVAL_MS 1000
+
+typedef struct
+{
+	SOCKET sockfd;
+	UINT64 created;
+} proxyPoolEntry;
+
+struct proxy_backend_pool
+{
+	char* host;
+	UINT16 port;
+
+	CRITICAL_SECTION lock;
+	proxyPoolEntry* entries;
+	size_t count;
+	size_t size;
+	pTCPConnect tcpConnect; /* the transport default, used for the pooled sockets too */
+
+	HANDLE stopEvent;
+	HANDLE refillEvent;
+	HANDLE thread;
+};
+
+/* Idle pooled connections must not have been closed or written to by the target */
+static BOOL pf_pool_entry_alive(const proxyPoolEntry* entry, UINT64 now)
+{
+	char b = 0;
+
+	WINPR_ASSERT(entry);
+	if (now - entry->created > PF_POOL_MAX_IDLE_MS)
+		return FALSE;
+
+	const int rc = _recv(entry->sockfd, &b, 1, MSG_PEEK);
+	if (rc < 0)
+		return WSAGetLastError() == WSAEWOULDBLOCK;
+	return FALSE;
+}
+
+static SOCKET pf_pool_connect_addr(HANDLE stopEvent, const struct addrinfo* ai, HANDLE event)
+{
+	WINPR_ASSERT(stopEvent);
+	WINPR_ASSERT(ai);
+
+	SOCKET sockfd = _socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+	if (sockfd == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	/* non blocking from here on, so a connect can be interrupted with stopEvent */
+	if (WSAEventSelect(sockfd, event, FD_WRITE | FD_CONNECT) != 0)
+		goto fail;
+
+	if (_connect(sockfd, ai->ai_addr, (int)ai->ai_addrlen) != 0)
+	{
+		const int err = WSAGetLastError();
+		if ((err != WSAEWOULDBLOCK) && (err != WSAEINPROGRESS))
+			goto fail;
+
+		HANDLE events[] = { stopEvent, event };
+		if (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE,
+		                           PF_POOL_CONNECT_TIMEOUT_MS) != WAIT_OBJECT_0 + 1)
+			goto fail;
+
+		int error = 0;
+		int optlen = sizeof(error);
+		if ((_getsockopt(sockfd, SOL_SOCKET, SO_ERROR, (char*)&error, &optlen) != 0) ||
+		    (error != 0))
+			goto fail;
+	}
+
+	const int optval = 1;
+	(void)_setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (const char*)&optval, sizeof(optval));
+	(void)WSAEventSelect(sockfd, event, 0);
+	return sockfd;
+
+fail:
+	closesocket(sockfd);
+	return INVALID_SOCKET;
+}
+
+SOCKET pf_pool_connect_host(const char* host, UINT16 port, HANDLE stopEvent)
+{
+	char service[8] = { 0 };
+	struct addrinfo hints = { 0 };
+	struct addrinfo* res = NULL;
+	SOCKET sockfd = INVALID_SOCKET;
+
+	WINPR_ASSERT(host);
+	WINPR_ASSERT(stopEvent);
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	(void)_snprintf(service, sizeof(service), "%" PRIu16, port);
+
+	if (getaddrinfo(host, service, &hints, &res) != 0)
+	{
+		WLog_WARN(TAG, "failed to resolve %s:%" PRIu16, host, port);
+		return INVALID_SOCKET;
+	}
+
+	HANDLE event = WSACreateEvent();
+	if (event)
+	{
+		for (struct addrinfo* ai = res; ai && (sockfd == INVALID_SOCKET); ai = ai->ai_next)
+			sockfd = pf_pool_connect_addr(stopEvent, ai, event);
+		(void)CloseHandle(event);
+	}
+
+	freeaddrinfo(res);
+	return sockfd;
+}
+
+static SOCKET pf_pool_connect(proxyBackendPool* pool)
+{
+	WINPR_ASSERT(pool);
+	return pf_pool_connect_host(pool->host, pool->port, pool->stopEvent);
+}
+
+static void pf_pool_prune(proxyBackendPool* pool)
+{
+	const UINT64 now = GetTickCount64();
+	size_t kept = 0;
+
+	WINPR_ASSERT(pool);
+
+	EnterCriticalSection(&pool->lock);
+	for (size_t x = 0; x < pool->count; x++)
+	{
+		if (pf_pool_entry_alive(&pool->entries[x], now))
+			pool->entries[kept++] = pool->entries[x];
+		else
+			closesocket(pool->entries[x].sockfd);
+	}
+	pool->count = kept;
+	LeaveCriticalSection(&pool->lock);
+}
+
+static DWORD WINAPI pf_pool_thread(LPVOID arg)
+{
+	proxyBackendPool* pool = arg;
+	WINPR_ASSERT(pool);
+
+	HANDLE events[] = { pool->stopEvent, pool->refillEvent };
+	while (WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, PF_POOL_CHECK_INTERVAL_MS) !=
+	       WAIT_OBJECT_0)
+	{
+		(void)ResetEvent(pool->refillEvent);
+		pf_pool_prune(pool);
+
+		while (WaitForSingleObject(pool->stopEvent, 0) != WAIT_OBJECT_0)
+		{
+			EnterCriticalSection(&pool->lock);
+			const BOOL full = pool->count >= pool->size;
+			LeaveCriticalSection(&pool->lock);
+			if (full)
+				break;
+
+			/* retried with the next check if the target is not reachable */
+			const SOCKET sockfd = pf_pool_connect(pool);
+			if (sockfd == INVALID_SOCKET)
+				break;
+
+			EnterCriticalSection(&pool->lock);
+			WINPR_ASSERT(pool->count < pool->size);
+			pool->entries[pool->count].sockfd = sockfd;
+			pool->entries[pool->count].created = GetTickCount64();
+			pool->count++;
+			LeaveCriticalSection(&pool->lock);
+		}
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+static SOCKET pf_pool_take(proxyBackendPool* pool)
+{
+	SOCKET sockfd = INVALID_SOCKET;
+	const UINT64 now = GetTickCount64();
+
+	WINPR_ASSERT(pool);
+
+	EnterCriticalSection(&pool->lock);
+	while ((sockfd == INVALID_SOCKET) && (pool->count > 0))
+	{
+		/* the most recent connection has the longest time left before the target drops it */
+		const proxyPoolEntry* entry = &pool->entries[--pool->count];
+		if (pf_pool_entry_alive(entry, now))
+			sockfd = entry->sockfd;
+		else
+			closesocket(entry->sockfd);
+	}
+	LeaveCriticalSection(&pool->lock);
+
+	(void)SetEvent(pool->refillEvent);
+
+	if (sockfd != INVALID_SOCKET)
+	{
+		u_long arg = 0;
+		(void)_ioctlsocket(sockfd, FIONBIO, &arg);
+	}
+	return sockfd;
+}
+
+SOCKET pf_pool_acquire(proxyBackendPool* pool, const char* host, UINT16 port)
+{
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(host);
+
+	if ((port != pool->port) || (_stricmp(host, pool->host) != 0))
+		return INVALID_SOCKET;
+	return pf_pool_take(pool);
+}
+
+static int pf_pool_tcp_connect(rdpContext* context, rdpSettings* settings, const char* hostname,
+                               int port, DWORD timeout)
+{
+	proxyBackendPool* pool = freerdp_get_io_callback_context(context);
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(pool->tcpConnect);
+	WINPR_ASSERT(settings);
+
+	if (hostname && (port == pool->port) && (_stricmp(hostname, pool->host) == 0) &&
+	    !freerdp_settings_get_bool(settings, FreeRDP_GatewayEnabled))
+	{
+		const SOCKET sockfd = pf_pool_take(pool);
+		if (sockfd != INVALID_SOCKET)
+		{
+			WLog_DBG(TAG, "using pooled connection to %s:%d", hostname, port);
+
+			/* The default connect adopts an external socket passed as port */
+			const int rc = pool->tcpConnect(context, settings, "|", (int)sockfd, timeout);
+			if (rc < 0)
+				closesocket(sockfd);
+			return rc;
+		}
+	}
+
+	return pool->tcpConnect(context, settings, hostname, port, timeout);
+}
+
+BOOL pf_pool_register(proxyBackendPool* pool, rdpContext* context)
+{
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(context);
+
+	const rdpTransportIo* cb = freerdp_get_io_callbacks(context);
+	if (!cb)
+		return FALSE;
+
+	rdpTransportIo io = *cb;
+	EnterCriticalSection(&pool->lock);
+	if (!pool->tcpConnect)
+		pool->tcpConnect = io.TCPConnect;
+	LeaveCriticalSection(&pool->lock);
+
+	io.TCPConnect = pf_pool_tcp_connect;
+	if (!freerdp_set_io_callbacks(context, &io))
+		return FALSE;
+	return freerdp_set_io_callback_context(context, pool);
+}
+
+BOOL pf_pool_start(proxyBackendPool* pool)
+{
+	WINPR_ASSERT(pool);
+	WINPR_ASSERT(!pool->thread);
+
+	pool->thread = CreateThread(NULL, 0, pf_pool_thread, pool, 0, NULL);
+	if (!pool->thread)
+		return FALSE;
+
+	(void)SetEvent(pool->refillEvent);
+	WLog_INFO(TAG, "keeping %" PRIuz " connections to %s:%" PRIu16 " ready", pool->size,
+	          pool->host, pool->port);
+	return TRUE;
+}
+
+proxyBackendPool* pf_pool_new(const char* host, UINT16 port, size_t size)
+{
+	WINPR_ASSERT(host);
+
+	proxyBackendPool* pool = calloc(1, sizeof(proxyBackendPool));
+	if (!pool)
+		return NULL;
+
+	InitializeCriticalSection(&pool->lock);
+	pool->port = port;
+	pool->size = size;
+	pool->host = _strdup(host);
+	if (!pool->host)
+		goto fail;
+
+	pool->entries = calloc(size, sizeof(proxyPoolEntry));
+	if (!pool->entries)
+		goto fail;
+
+	pool->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!pool->stopEvent)
+		goto fail;
+
+	pool->refillEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if (!pool->refillEvent)
+		goto fail;
+
+	return pool;
+
+fail:
+	pf_pool_free(pool);
+	return NULL;
+}
+
+void pf_pool_free(proxyBackendPool* pool)
+{
+	if (!pool)
+		return;
+
+	if (pool->thread)
+	{
+		(void)SetEvent(pool->stopEvent);
+		(void)WaitForSingleObject(pool->thread, INFINITE);
+		(void)CloseHandle(pool->thread);
+	}
+
+	for (size_t x = 0; x < pool->count; x++)
+		closesocket(pool->entries[x].sockfd);
+
+	if (pool->refillEvent)
+		(void)CloseHandle(pool->refillEvent);
+	if (pool->stopEvent)
+		(void)CloseHandle(pool->stopEvent);
+	DeleteCriticalSection(&pool->lock);
+	free(pool->entries);
+	free(pool->host);
+	free(pool);
+}
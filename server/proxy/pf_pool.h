@@ -0,0 +1,75 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ * FreeRDP Proxy Server
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_PROXY_PFPOOL_H
+#define FREERDP_SERVER_PROXY_PFPOOL_H
+
+#include <winpr/wtypes.h>
+#include <winpr/winsock.h>
+
+#include <freerdp/freerdp.h>
+
+typedef struct proxy_backend_pool proxyBackendPool;
+
+void pf_pool_free(proxyBackendPool* pool);
+
+/**
+ * @brief pf_pool_new Creates a pool of pre-established TCP connections to a target
+ *
+ * @param host The target host name. Must NOT be NULL.
+ * @param port The target port
+ * @param size The number of idle connections to keep ready
+ * @return A new pool or NULL in case of failure
+ */
+WINPR_ATTR_MALLOC(pf_pool_free, 1)
+proxyBackendPool* pf_pool_new(const char* host, UINT16 port, size_t size);
+
+BOOL pf_pool_start(proxyBackendPool* pool);
+
+/**
+ * @brief pf_pool_register Makes a client context take its target connection from the pool
+ *
+ * Connections to other targets than the pooled one and connections while the pool is empty
+ * are established as usual.
+ *
+ * @param pool The pool to use. Must NOT be NULL.
+ * @param context The proxy client context. Must NOT be NULL.
+ * @return TRUE for success, FALSE otherwise
+ */
+BOOL pf_pool_register(proxyBackendPool* pool, rdpContext* context);
+
+/**
+ * @brief pf_pool_acquire Takes an idle connection from the pool
+ *
+ * @param pool The pool to use. Must NOT be NULL.
+ * @param host The target host name. Must NOT be NULL.
+ * @param port The target port
+ * @return A connected blocking socket or INVALID_SOCKET if the pool is empty or for another target
+ */
+SOCKET pf_pool_acquire(proxyBackendPool* pool, const char* host, UINT16 port);
+
+/**
+ * @brief pf_pool_connect_host Connects to a target the way the pool does
+ *
+ * @param host The target host name. Must NOT be NULL.
+ * @param port The target port
+ * @param stopEvent Aborts the connect when set. Must NOT be NULL.
+ * @return A connected non blocking socket or INVALID_SOCKET
+ */
+SOCKET pf_pool_connect_host(const char* host, UINT16 port, HANDLE stopEvent);
+
+#endif /* FREERDP_SERVER_PROXY_PFPOOL_H */
@@ -52,6 +52,7 @@
 #include "pf_update.h"
 #include "proxy_modules.h"
 #include "pf_utils.h"
+#include "pf_passthrough.h"
 #include "channels/pf_channel_drdynvc.h"
 #include "channels/pf_channel_rdpdr.h"
 
@@ -322,6 +323,14 @@ static BOOL pf_server_post_connect(freerdp_peer* peer)
 	/* keep both sides of the connection in pdata */
 	proxy_data_set_client_context(pdata, pc);
 
+	proxyServer* server = (proxyServer*)peer->ContextExtra;
+	WINPR_ASSERT(server);
+	if (server->pool && !pf_pool_register(server->pool, &pc->context))
+	{
+		PROXY_LOG_ERR(TAG, ps, "failed to use the target connection pool");
+		return FALSE;
+	}
+
 	if (!pf_server_get_target_info(peer->context, client_settings, pdata->config))
 	{
 		PROXY_LOG_INFO(TAG, ps, "pf_server_get_target_info failed!");
@@ -335,8 +344,11 @@ static BOOL pf_server_post_connect(freerdp_peer* peer)
 	if (!pf_modules_run_hook(pdata->module, HOOK_TYPE_SERVER_POST_CONNECT, pdata, peer))
 		return FALSE;
 
-	/* Start a proxy's client in it's own thread */
-	if (!(pdata->client_thread = CreateThread(NULL, 0, pf_client_start, pc, 0, NULL)))
+	/* Start a proxy's client in it's own thread. With SharedSessionThread the thread only
+	 * connects and the session thread handles both connections afterwards. */
+	LPTHREAD_START_ROUTINE fkt =
+	    pdata->config->SharedSessionThread ? pf_client_connect_start : pf_client_start;
+	if (!(pdata->client_thread = CreateThread(NULL, 0, fkt, pc, 0, NULL)))
 	{
 		PROXY_LOG_ERR(TAG, ps, "failed to create client thread");
 		return FALSE;
@@ -385,6 +397,8 @@ static BOOL pf_server_logon(freerdp_peer* peer, const SEC_WINNT_AUTH_IDENTITY* i
 	WINPR_ASSERT(pdata);
 	WINPR_ASSERT(identity);
 
+	pf_metrics_session_logon(pdata->metrics);
+
 	info.identity = identity;
 	info.automatic = automatic;
 	if (!pf_modules_run_filter(pdata->module, FILTER_TYPE_SERVER_PEER_LOGON, pdata, &info))
@@ -436,6 +450,8 @@ static BOOL pf_server_receive_channel_data_hook(freerdp_peer* peer, UINT16 chann
 		return TRUE;
 	}
 
+	pf_metrics_channel_data(channel->metrics, PF_METRICS_FRONT_TO_BACK, size, flags);
+
 	WINPR_ASSERT(channel->onFrontData);
 	switch (channel->onFrontData(pdata, channel, data, size, flags, totalSize))
 	{
@@ -482,6 +498,12 @@ static BOOL pf_server_initialize_peer_connection(freerdp_peer* peer)
 	proxy_data_set_server_context(pdata, ps);
 
 	pdata->module = server->module;
+	if (server->metrics)
+	{
+		pdata->metrics = pf_metrics_session_new(server->metrics, pdata->session_id);
+		if (!pdata->metrics)
+			return FALSE;
+	}
 	const proxyConfig* config = pdata->config = server->config;
 
 	rdpPrivateKey* key = freerdp_key_new_from_pem(config->PrivateKeyPEM);
@@ -538,6 +560,9 @@ static BOOL pf_server_initialize_peer_connection(freerdp_peer* peer)
 		return FALSE;
 	if (!freerdp_settings_set_bool(settings, FreeRDP_NlaSecurity, config->ServerNlaSecurity))
 		return FALSE;
+	if (!freerdp_settings_set_bool(settings, FreeRDP_TlsKernelOffload,
+	                               config->ServerTlsKernelOffload))
+		return FALSE;
 
 	if (!freerdp_settings_set_uint32(settings, FreeRDP_EncryptionLevel,
 	                                 ENCRYPTION_LEVEL_CLIENT_COMPATIBLE))
@@ -580,6 +605,8 @@ static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 	pServerContext* ps = NULL;
 	proxyData* pdata = NULL;
 	peer_thread_args* args = arg;
+	BOOL backendPolled = FALSE; /* SharedSessionThread, target connection handled here */
+	BOOL backendDone = FALSE;
 
 	WINPR_ASSERT(args);
 
@@ -591,7 +618,22 @@ static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 
 	size_t count = ArrayList_Count(server->peer_list);
 
-	if (!pf_context_init_server_context(client))
+	if (server->config->RoutingPassthrough)
+	{
+		/* no RDP context at all, the raw socket is relayed to the target */
+		(void)pf_passthrough_run(server, (SOCKET)client->sockfd, client->hostname);
+		goto out_free_peer;
+	}
+
+	/* The socket is attached while the context is created, its transport is chosen here */
+	rdpSettings* initial = freerdp_settings_new(FREERDP_SETTINGS_SERVER_MODE);
+	if (!initial)
+		goto out_free_peer;
+	const BOOL initialized =
+	    freerdp_settings_set_bool(initial, FreeRDP_TransportIoUring, server->config->IoUring) &&
+	    pf_context_init_server_context_ex(client, initial);
+	freerdp_settings_free(initial);
+	if (!initialized)
 		goto out_free_peer;
 
 	if (!pf_server_initialize_peer_connection(client))
@@ -642,6 +684,17 @@ static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 		eventHandles[eventCount++] = pdata->abort_event;
 		eventHandles[eventCount++] = server->stopEvent;
 
+		if (backendPolled)
+		{
+			const DWORD tmp = pf_client_get_event_handles(pdata->pc, &eventHandles[eventCount],
+			                                              ARRAYSIZE(eventHandles) - eventCount);
+			if (tmp == 0)
+				break;
+			eventCount += tmp;
+		}
+		else if (pdata->config->SharedSessionThread && pdata->client_thread && !backendDone)
+			eventHandles[eventCount++] = pdata->client_thread;
+
 		const DWORD status = WaitForMultipleObjects(
 		    eventCount, eventHandles, FALSE, 1000); /* Do periodic polling to avoid client hang */
 
@@ -664,6 +717,36 @@ static DWORD WINAPI pf_server_handle_peer(LPVOID arg)
 			}
 		}
 
+		if (backendPolled)
+		{
+			if (!pf_client_check_event_handles(pdata->pc))
+			{
+				pf_client_disconnect_target(pdata->pc);
+				backendPolled = FALSE;
+				backendDone = TRUE;
+				/* The target closed the connection, close the peer too */
+				proxy_data_abort_connect(pdata);
+			}
+		}
+		else if (pdata->config->SharedSessionThread && pdata->client_thread && !backendDone &&
+		         (WaitForSingleObject(pdata->client_thread, 0) == WAIT_OBJECT_0))
+		{
+			DWORD code = 1;
+			if (GetExitCodeThread(pdata->client_thread, &code) && (code == 0))
+				backendPolled = TRUE;
+			else
+				backendDone = TRUE;
+		}
+
+		if (pdata->metrics)
+		{
+			pClientContext* pc = pdata->pc;
+			pf_metrics_session_update(
+			    pdata->metrics, freerdp_get_transport_sent(client->context, FALSE),
+			    pc ? freerdp_get_transport_sent(&pc->context, FALSE) : 0,
+			    pc ? Queue_Count(pc->cached_server_channel_data) : 0);
+		}
+
 		/* only disconnect after checking client's and vcm's file descriptors  */
 		if (proxy_data_shall_disconnect(pdata))
 		{
@@ -730,6 +813,11 @@ out_free_peer:
 	{
 		proxy_data_abort_connect(pdata);
 		(void)WaitForSingleObject(pdata->client_thread, INFINITE);
+
+		DWORD code = 1;
+		if (pdata->config->SharedSessionThread && !backendDone &&
+		    GetExitCodeThread(pdata->client_thread, &code) && (code == 0))
+			pf_client_disconnect_target(pdata->pc);
 	}
 
 	{
@@ -770,7 +858,12 @@ static BOOL pf_server_start_peer(freerdp_peer* client)
 		return FALSE;
 
 	args->thread = hThread;
-	if (!ArrayList_Append(server->peer_list, hThread))
+
+	/* peers are accepted concurrently with AcceptThreads */
+	ArrayList_Lock(server->peer_list);
+	const BOOL added = ArrayList_Append(server->peer_list, hThread);
+	ArrayList_Unlock(server->peer_list);
+	if (!added)
 	{
 		(void)CloseHandle(hThread);
 		return FALSE;
@@ -789,6 +882,22 @@ static BOOL pf_server_peer_accepted(freerdp_listener* listener, freerdp_peer* cl
 	return pf_server_start_peer(client);
 }
 
+/* Starts the optional helpers configured next to the listener */
+static BOOL pf_server_start_services(proxyServer* server)
+{
+	WINPR_ASSERT(server);
+	WINPR_ASSERT(server->config);
+
+	if (server->metrics && !pf_metrics_start(server->metrics, server->config->MetricsHost,
+	                                         server->config->MetricsPort))
+		return FALSE;
+
+	if (server->pool && !pf_pool_start(server->pool))
+		return FALSE;
+
+	return TRUE;
+}
+
 BOOL pf_server_start(proxyServer* server)
 {
 	WSADATA wsaData;
@@ -822,6 +931,9 @@ BOOL pf_server_start(proxyServer* server)
 		goto error;
 	}
 
+	if (!pf_server_start_services(server))
+		goto error;
+
 	return TRUE;
 
 error:
@@ -861,6 +973,9 @@ BOOL pf_server_start_from_socket(proxyServer* server, int socket)
 		goto error;
 	}
 
+	if (!pf_server_start_services(server))
+		goto error;
+
 	return TRUE;
 
 error:
@@ -958,6 +1073,20 @@ proxyServer* pf_server_new(const proxyConfig* config)
 	if (!server->listener)
 		goto out;
 
+	if (!freerdp_listener_set_accept_threads(server->listener, server->config->AcceptThreads))
+		goto out;
+	if (!freerdp_listener_set_handshake_limits(server->listener,
+	                                           server->config->ServerHandshakeConcurrency,
+	                                           server->config->ServerHandshakeQueue))
+		goto out;
+	if (!freerdp_listener_set_tls_session_tickets(server->listener,
+	                                              server->config->ServerTlsSessionTickets))
+		goto out;
+	if (!freerdp_listener_set_tls_ecdsa_certificate(server->listener,
+	                                                server->config->EcdsaCertificateFile,
+	                                                server->config->EcdsaPrivateKeyFile))
+		goto out;
+
 	server->peer_list = ArrayList_New(FALSE);
 	if (!server->peer_list)
 		goto out;
@@ -967,6 +1096,21 @@ proxyServer* pf_server_new(const proxyConfig* config)
 
 	obj->fnObjectFree = peer_free;
 
+	if (server->config->MetricsHost)
+	{
+		server->metrics = pf_metrics_new();
+		if (!server->metrics)
+			goto out;
+	}
+
+	if (server->config->FixedTarget && (server->config->TargetConnectionPool > 0))
+	{
+		server->pool = pf_pool_new(server->config->TargetHost, server->config->TargetPort,
+		                           server->config->TargetConnectionPool);
+		if (!server->pool)
+			goto out;
+	}
+
 	server->listener->info = server;
 	server->listener->PeerAccepted = pf_server_peer_accepted;
 
@@ -1071,6 +1215,8 @@ void pf_server_free(proxyServer* server)
 	}
 	ArrayList_Free(server->peer_list);
 	freerdp_listener_free(server->listener);
+	pf_metrics_free(server->metrics);
+	pf_pool_free(server->pool);
 
 	if (server->stopEvent)
 		(void)CloseHandle(server->stopEvent);
@@ -29,6 +29,8 @@
 
 #include <freerdp/server/proxy/proxy_config.h>
 #include "proxy_modules.h"
+#include "pf_metrics.h"
+#include "pf_pool.h"
 
 struct proxy_server
 {
@@ -38,6 +40,8 @@ struct proxy_server
 	freerdp_listener* listener;
 	HANDLE stopEvent; /* an event used to signal the main thread to stop */
 	wArrayList* peer_list;
+	proxyMetrics* metrics; /* NULL if the metrics endpoint is not configured */
+	proxyBackendPool* pool; /* NULL without connection pooling to a fixed target */
 };
 
 #endif /* INT_FREERDP_SERVER_PROXY_SERVER_H */
@@ -129,6 +129,39 @@ static BOOL pf_client_bitmap_update(rdpContext* context, const BITMAP_UPDATE* bi
 	return ps->update->BitmapUpdate(ps, bitmap);
 }
 
+static BOOL pf_client_surface_bits(rdpContext* context, const SURFACE_BITS_COMMAND* cmd)
+{
+	pClientContext* pc = (pClientContext*)context;
+	proxyData* pdata = NULL;
+	rdpContext* ps = NULL;
+	WINPR_ASSERT(pc);
+	pdata = pc->pdata;
+	WINPR_ASSERT(pdata);
+	ps = (rdpContext*)pdata->ps;
+	WINPR_ASSERT(ps);
+	WINPR_ASSERT(ps->update);
+	WINPR_ASSERT(ps->update->SurfaceBits);
+	WLog_DBG(TAG, "called");
+	return ps->update->SurfaceBits(ps, cmd);
+}
+
+static BOOL pf_client_surface_frame_marker(rdpContext* context,
+                                           const SURFACE_FRAME_MARKER* surfaceFrameMarker)
+{
+	pClientContext* pc = (pClientContext*)context;
+	proxyData* pdata = NULL;
+	rdpContext* ps = NULL;
+	WINPR_ASSERT(pc);
+	pdata = pc->pdata;
+	WINPR_ASSERT(pdata);
+	ps = (rdpContext*)pdata->ps;
+	WINPR_ASSERT(ps);
+	WINPR_ASSERT(ps->update);
+	WINPR_ASSERT(ps->update->SurfaceFrameMarker);
+	WLog_DBG(TAG, "called");
+	return ps->update->SurfaceFrameMarker(ps, surfaceFrameMarker);
+}
+
 static BOOL pf_client_desktop_resize(rdpContext* context)
 {
 	pClientContext* pc = (pClientContext*)context;
@@ -627,3 +660,10 @@ void pf_client_register_update_callbacks(rdpUpdate* update)
 	update->pointer->PointerNew = pf_client_send_pointer_new;
 	update->pointer->PointerCached = pf_client_send_pointer_cached;
 }
+
+void pf_client_register_passthrough_callbacks(rdpUpdate* update)
+{
+	WINPR_ASSERT(update);
+	update->SurfaceBits = pf_client_surface_bits;
+	update->SurfaceFrameMarker = pf_client_surface_frame_marker;
+}
@@ -31,4 +31,7 @@
 void pf_server_register_update_callbacks(rdpUpdate* update);
 void pf_client_register_update_callbacks(rdpUpdate* update);
 
+/* Forward surface commands instead of decoding them in a local GDI */
+void pf_client_register_passthrough_callbacks(rdpUpdate* update);
+
 #endif /* FREERDP_SERVER_PROXY_PFUPDATE_H */
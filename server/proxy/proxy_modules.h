@@ -86,11 +86,26 @@ extern "C"
 	BOOL pf_modules_is_plugin_loaded(proxyModule* module, const char* plugin_name);
 	void pf_modules_list_loaded_plugins(proxyModule* module);
 
+	/**
+	 * @brief pf_modules_has_hook Checks if any loaded plugin implements a hook
+	 * @return TRUE if a plugin implements the hook or the hook type is not tracked
+	 */
+	BOOL pf_modules_has_hook(proxyModule* module, PF_HOOK_TYPE type);
+
 	BOOL pf_modules_run_filter(proxyModule* module, PF_FILTER_TYPE type, proxyData* pdata,
 	                           void* param);
 	BOOL pf_modules_run_hook(proxyModule* module, PF_HOOK_TYPE type, proxyData* pdata,
 	                         void* custom);
 
+	/**
+	 * @brief pf_modules_flush_async Waits for all queued asynchronous plugin calls
+	 *
+	 * Must be called before any proxyData passed to the asynchronous calls is freed.
+	 *
+	 * @param module The module to flush, may be NULL
+	 */
+	void pf_modules_flush_async(proxyModule* module);
+
 	void pf_modules_free(proxyModule* module);
 
 #ifdef __cplusplus
@@ -360,15 +360,13 @@ static void (^mac_capture_stream_handler)(
     CGDisplayStreamFrameStatus, uint64_t, IOSurfaceRef,
     CGDisplayStreamUpdateRef) = ^(CGDisplayStreamFrameStatus status, uint64_t displayTime,
                                   IOSurfaceRef frameSurface, CGDisplayStreamUpdateRef updateRef) {
-  int x, y;
   int count;
-  int width;
-  int height;
   int nSrcStep;
   BOOL empty;
   BYTE* pSrcData;
+  UINT32 numRects;
   RECTANGLE_16 surfaceRect;
-  const RECTANGLE_16* extents;
+  const RECTANGLE_16* rects;
   macShadowSubsystem* subsystem = g_Subsystem;
   rdpShadowServer* server = subsystem->common.server;
   rdpShadowSurface* surface = server->surface;
@@ -389,25 +387,32 @@ static void (^mac_capture_stream_handler)(
 
   if (!empty)
   {
-	  extents = region16_extents(&(surface->invalidRegion));
-	  x = extents->left;
-	  y = extents->top;
-	  width = extents->right - extents->left;
-	  height = extents->bottom - extents->top;
+	  EnterCriticalSection(&(surface->lock));
 	  IOSurfaceLock(frameSurface, kIOSurfaceLockReadOnly, NULL);
 	  pSrcData = (BYTE*)IOSurfaceGetBaseAddress(frameSurface);
 	  nSrcStep = (int)IOSurfaceGetBytesPerRow(frameSurface);
 
-	  if (subsystem->retina)
-	  {
-		  freerdp_image_copy_from_retina(surface->data, surface->format, surface->scanline, x, y,
-			                             width, height, pSrcData, nSrcStep, x, y);
-	  }
-	  else
+	  /* Copy the dirty rects only, not their bounding box */
+	  rects = region16_rects(&(surface->invalidRegion), &numRects);
+
+	  for (UINT32 index = 0; index < numRects; index++)
 	  {
-		  freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline, x, y,
-			                            width, height, pSrcData, PIXEL_FORMAT_BGRX32, nSrcStep, x,
-			                            y, NULL, FREERDP_FLIP_NONE);
+		  const int x = rects[index].left;
+		  const int y = rects[index].top;
+		  const int width = rects[index].right - rects[index].left;
+		  const int height = rects[index].bottom - rects[index].top;
+
+		  if (subsystem->retina)
+		  {
+			  freerdp_image_copy_from_retina(surface->data, surface->format, surface->scanline, x,
+				                             y, width, height, pSrcData, nSrcStep, x, y);
+		  }
+		  else
+		  {
+			  freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline, x,
+				                            y, width, height, pSrcData, PIXEL_FORMAT_BGRX32,
+				                            nSrcStep, x, y, NULL, FREERDP_FLIP_NONE);
+		  }
 	  }
 	  LeaveCriticalSection(&(surface->lock));
 
@@ -0,0 +1,1283 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/dma-buf.h>
+#include <linux/input-event-codes.h>
+
+#include <gio/gunixfdlist.h>
+
+#include <spa/buffer/meta.h>
+#include <spa/param/video/type-info.h>
+#include <spa/utils/result.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/input.h>
+#include <winpr/sysinfo.h>
+#include <winpr/collections.h>
+
+#include <freerdp/log.h>
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/region.h>
+
+#include "pipewire_shadow.h"
+
+#define TAG SERVER_TAG("shadow.pipewire")
+
+#define PORTAL_BUS_NAME "org.freedesktop.portal.Desktop"
+#define PORTAL_OBJECT_PATH "/org/freedesktop/portal/desktop"
+#define PORTAL_REQUEST_INTERFACE "org.freedesktop.portal.Request"
+#define PORTAL_SESSION_INTERFACE "org.freedesktop.portal.Session"
+#define PORTAL_SCREENCAST_INTERFACE "org.freedesktop.portal.ScreenCast"
+#define PORTAL_REMOTEDESKTOP_INTERFACE "org.freedesktop.portal.RemoteDesktop"
+
+/* xdg-desktop-portal enumerations */
+#define PORTAL_DEVICE_KEYBOARD 1
+#define PORTAL_DEVICE_POINTER 2
+#define PORTAL_SOURCE_MONITOR 1
+#define PORTAL_CURSOR_EMBEDDED 2
+
+/* DRM_FORMAT_MOD_LINEAR, without depending on libdrm headers */
+#define PIPEWIRE_SHADOW_MOD_LINEAR 0
+
+#define PIPEWIRE_SHADOW_MAX_DAMAGE 16
+
+typedef struct
+{
+	BOOL done;
+	UINT32 response;
+	GVariant* results;
+} PIPEWIRE_PORTAL_RESPONSE;
+
+typedef struct
+{
+	void* map;
+	size_t size;
+} PIPEWIRE_SHADOW_BUFFER;
+
+static void pipewire_shadow_portal_response(GDBusConnection* connection, const gchar* sender,
+                                            const gchar* path, const gchar* iface,
+                                            const gchar* signal, GVariant* parameters,
+                                            gpointer user_data)
+{
+	PIPEWIRE_PORTAL_RESPONSE* response = (PIPEWIRE_PORTAL_RESPONSE*)user_data;
+
+	WINPR_UNUSED(connection);
+	WINPR_UNUSED(sender);
+	WINPR_UNUSED(path);
+	WINPR_UNUSED(iface);
+	WINPR_UNUSED(signal);
+
+	g_variant_get(parameters, "(u@a{sv})", &response->response, &response->results);
+	response->done = TRUE;
+}
+
+static char* pipewire_shadow_portal_token(pipewireShadowSubsystem* subsystem)
+{
+	return g_strdup_printf("freerdp_shadow_%" PRIu32 "_%" PRIu32, (UINT32)getpid(),
+	                       subsystem->token++);
+}
+
+/**
+ * Call a portal method that returns a Request object and wait for its Response signal.
+ * The options of the call must contain token as handle_token.
+ */
+static BOOL pipewire_shadow_portal_request(pipewireShadowSubsystem* subsystem, const char* iface,
+                                           const char* method, GVariant* parameters,
+                                           const char* token, GVariant** results)
+{
+	BOOL rc = FALSE;
+	GError* error = NULL;
+	PIPEWIRE_PORTAL_RESPONSE response = { 0 };
+	char* path = g_strdup_printf("%s/request/%s/%s", PORTAL_OBJECT_PATH, subsystem->sender, token);
+
+	/* Subscribe before the call, the response may arrive before the call returns */
+	const guint id = g_dbus_connection_signal_subscribe(
+	    subsystem->connection, PORTAL_BUS_NAME, PORTAL_REQUEST_INTERFACE, "Response", path, NULL,
+	    G_DBUS_SIGNAL_FLAGS_NONE, pipewire_shadow_portal_response, &response, NULL);
+
+	GVariant* reply = g_dbus_connection_call_sync(
+	    subsystem->connection, PORTAL_BUS_NAME, PORTAL_OBJECT_PATH, iface, method, parameters,
+	    G_VARIANT_TYPE("(o)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+
+	if (!reply)
+	{
+		WLog_ERR(TAG, "%s.%s failed: %s", iface, method, error ? error->message : "unknown");
+		goto fail;
+	}
+
+	g_variant_unref(reply);
+
+	/* The portal may show a dialog, wait for the user to answer it */
+	while (!response.done)
+		g_main_context_iteration(subsystem->context, TRUE);
+
+	if (response.response != 0)
+	{
+		WLog_ERR(TAG, "%s.%s was %s", iface, method,
+		         (response.response == 1) ? "cancelled" : "rejected");
+		goto fail;
+	}
+
+	*results = response.results;
+	response.results = NULL;
+	rc = TRUE;
+fail:
+	if (response.results)
+		g_variant_unref(response.results);
+	g_dbus_connection_signal_unsubscribe(subsystem->connection, id);
+	g_clear_error(&error);
+	g_free(path);
+	return rc;
+}
+
+static BOOL pipewire_shadow_portal_create_session(pipewireShadowSubsystem* subsystem)
+{
+	GVariant* results = NULL;
+	GVariantBuilder options;
+	char* token = pipewire_shadow_portal_token(subsystem);
+	char* sessionToken = pipewire_shadow_portal_token(subsystem);
+
+	g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add(&options, "{sv}", "handle_token", g_variant_new_string(token));
+	g_variant_builder_add(&options, "{sv}", "session_handle_token",
+	                      g_variant_new_string(sessionToken));
+
+	BOOL rc = pipewire_shadow_portal_request(subsystem, PORTAL_REMOTEDESKTOP_INTERFACE,
+	                                         "CreateSession", g_variant_new("(a{sv})", &options),
+	                                         token, &results);
+	if (rc)
+	{
+		/* Older portals send a string, newer ones an object path */
+		GVariant* session = g_variant_lookup_value(results, "session_handle", NULL);
+
+		if (session && (g_variant_is_of_type(session, G_VARIANT_TYPE_STRING) ||
+		                g_variant_is_of_type(session, G_VARIANT_TYPE_OBJECT_PATH)))
+			subsystem->session = g_variant_dup_string(session, NULL);
+		else
+			rc = FALSE;
+
+		if (session)
+			g_variant_unref(session);
+
+		g_variant_unref(results);
+	}
+
+	g_free(sessionToken);
+	g_free(token);
+	return rc;
+}
+
+static BOOL pipewire_shadow_portal_select(pipewireShadowSubsystem* subsystem, const char* iface,
+                                          const char* method, const char* key, UINT32 types)
+{
+	GVariant* results = NULL;
+	GVariantBuilder options;
+	char* token = pipewire_shadow_portal_token(subsystem);
+
+	g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add(&options, "{sv}", "handle_token", g_variant_new_string(token));
+	g_variant_builder_add(&options, "{sv}", key, g_variant_new_uint32(types));
+
+	if (strcmp(method, "SelectSources") == 0)
+	{
+		/* The cursor is part of the frames like with the X11 subsystem */
+		g_variant_builder_add(&options, "{sv}", "multiple", g_variant_new_boolean(FALSE));
+		g_variant_builder_add(&options, "{sv}", "cursor_mode",
+		                      g_variant_new_uint32(PORTAL_CURSOR_EMBEDDED));
+	}
+
+	const BOOL rc = pipewire_shadow_portal_request(
+	    subsystem, iface, method, g_variant_new("(oa{sv})", subsystem->session, &options), token,
+	    &results);
+	if (rc)
+		g_variant_unref(results);
+
+	g_free(token);
+	return rc;
+}
+
+static BOOL pipewire_shadow_portal_start(pipewireShadowSubsystem* subsystem)
+{
+	BOOL rc = FALSE;
+	GVariant* results = NULL;
+	GVariantBuilder options;
+	char* token = pipewire_shadow_portal_token(subsystem);
+
+	g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add(&options, "{sv}", "handle_token", g_variant_new_string(token));
+
+	if (!pipewire_shadow_portal_request(
+	        subsystem, PORTAL_REMOTEDESKTOP_INTERFACE, "Start",
+	        g_variant_new("(osa{sv})", subsystem->session, "", &options), token, &results))
+		goto fail;
+
+	GVariant* streams = g_variant_lookup_value(results, "streams", G_VARIANT_TYPE("a(ua{sv})"));
+	if (streams)
+	{
+		GVariantIter iter;
+		GVariant* properties = NULL;
+		guint32 node = 0;
+
+		g_variant_iter_init(&iter, streams);
+		if (g_variant_iter_next(&iter, "(u@a{sv})", &node, &properties))
+		{
+			gint32 width = 0;
+			gint32 height = 0;
+
+			subsystem->node = node;
+			if (g_variant_lookup(properties, "size", "(ii)", &width, &height) && (width > 0) &&
+			    (height > 0))
+			{
+				subsystem->streamWidth = (UINT32)width;
+				subsystem->streamHeight = (UINT32)height;
+			}
+
+			g_variant_unref(properties);
+			rc = TRUE;
+		}
+
+		g_variant_unref(streams);
+	}
+
+	if (!rc)
+		WLog_ERR(TAG, "the portal did not provide a screen cast stream");
+
+	g_variant_unref(results);
+fail:
+	g_free(token);
+	return rc;
+}
+
+static int pipewire_shadow_portal_open_remote(pipewireShadowSubsystem* subsystem)
+{
+	int fd = -1;
+	gint32 handle = 0;
+	GError* error = NULL;
+	GUnixFDList* fds = NULL;
+	GVariantBuilder options;
+
+	g_variant_builder_init(&options, G_VARIANT_TYPE_VARDICT);
+
+	GVariant* reply = g_dbus_connection_call_with_unix_fd_list_sync(
+	    subsystem->connection, PORTAL_BUS_NAME, PORTAL_OBJECT_PATH, PORTAL_SCREENCAST_INTERFACE,
+	    "OpenPipeWireRemote", g_variant_new("(oa{sv})", subsystem->session, &options),
+	    G_VARIANT_TYPE("(h)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, &fds, NULL, &error);
+
+	if (!reply)
+	{
+		WLog_ERR(TAG, "OpenPipeWireRemote failed: %s", error ? error->message : "unknown");
+		goto fail;
+	}
+
+	g_variant_get(reply, "(h)", &handle);
+	fd = g_unix_fd_list_get(fds, handle, &error);
+	if (fd < 0)
+		WLog_ERR(TAG, "no PipeWire remote: %s", error ? error->message : "unknown");
+
+	g_variant_unref(reply);
+fail:
+	if (fds)
+		g_object_unref(fds);
+	g_clear_error(&error);
+	return fd;
+}
+
+static void pipewire_shadow_portal_close(pipewireShadowSubsystem* subsystem)
+{
+	if (subsystem->connection && subsystem->session)
+	{
+		GVariant* reply = g_dbus_connection_call_sync(
+		    subsystem->connection, PORTAL_BUS_NAME, subsystem->session, PORTAL_SESSION_INTERFACE,
+		    "Close", NULL, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+		if (reply)
+			g_variant_unref(reply);
+	}
+
+	g_free(subsystem->session);
+	subsystem->session = NULL;
+}
+
+/* Input goes through the portal session, the replies are not needed */
+static void pipewire_shadow_portal_notify(pipewireShadowSubsystem* subsystem, const char* method,
+                                          GVariant* parameters)
+{
+	if (!subsystem->connection || !subsystem->session)
+	{
+		g_variant_unref(g_variant_ref_sink(parameters));
+		return;
+	}
+
+	g_dbus_connection_call(subsystem->connection, PORTAL_BUS_NAME, PORTAL_OBJECT_PATH,
+	                       PORTAL_REMOTEDESKTOP_INTERFACE, method, parameters, NULL,
+	                       G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+}
+
+static GVariant* pipewire_shadow_empty_options(void)
+{
+	return g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0);
+}
+
+static BOOL pipewire_shadow_input_synchronize_event(rdpShadowSubsystem* subsystem,
+                                                    rdpShadowClient* client, UINT32 flags)
+{
+	WINPR_UNUSED(flags);
+
+	if (!subsystem || !client)
+		return FALSE;
+
+	return TRUE;
+}
+
+static BOOL pipewire_shadow_input_keyboard_event(rdpShadowSubsystem* subsystem,
+                                                 rdpShadowClient* client, UINT16 flags, UINT8 code)
+{
+	pipewireShadowSubsystem* pw = (pipewireShadowSubsystem*)subsystem;
+	DWORD scancode = code;
+
+	if (!subsystem || !client)
+		return FALSE;
+
+	if (flags & KBD_FLAGS_EXTENDED)
+		scancode |= KBDEXT;
+
+	DWORD vkcode = GetVirtualKeyCodeFromVirtualScanCode(scancode, WINPR_KBD_TYPE_IBM_ENHANCED);
+
+	if (flags & KBD_FLAGS_EXTENDED)
+		vkcode |= KBDEXT;
+
+	const DWORD keycode = GetKeycodeFromVirtualKeyCode(vkcode, WINPR_KEYCODE_TYPE_EVDEV);
+
+	if (keycode != 0)
+	{
+		const guint32 state = (flags & KBD_FLAGS_RELEASE) ? 0 : 1;
+		pipewire_shadow_portal_notify(pw, "NotifyKeyboardKeycode",
+		                              g_variant_new("(o@a{sv}iu)", pw->session,
+		                                            pipewire_shadow_empty_options(),
+		                                            (gint32)keycode, state));
+	}
+
+	return TRUE;
+}
+
+/* X keysym of a unicode code point, 0 for control characters without a key */
+static guint32 pipewire_shadow_unicode_keysym(UINT32 codepoint)
+{
+	switch (codepoint)
+	{
+		case 0x08: /* BackSpace */
+		case 0x09: /* Tab */
+		case 0x0A: /* Linefeed */
+		case 0x0D: /* Return */
+		case 0x1B: /* Escape */
+			return 0xFF00 | codepoint;
+		case 0x7F: /* Delete */
+			return 0xFFFF;
+		default:
+			break;
+	}
+
+	if ((codepoint < 0x20) || ((codepoint >= 0x80) && (codepoint < 0xA0)))
+		return 0;
+
+	/* Latin-1 keysyms are the code point, all others have the unicode keysym offset */
+	if (codepoint <= 0xFF)
+		return codepoint;
+	return 0x01000000 | codepoint;
+}
+
+static BOOL pipewire_shadow_input_unicode_keyboard_event(rdpShadowSubsystem* subsystem,
+                                                         rdpShadowClient* client, UINT16 flags,
+                                                         UINT16 code)
+{
+	pipewireShadowSubsystem* pw = (pipewireShadowSubsystem*)subsystem;
+	UINT32 codepoint = code;
+
+	if (!subsystem || !client)
+		return FALSE;
+
+	/* Characters outside the BMP arrive as a surrogate pair of events */
+	const size_t release = (flags & KBD_FLAGS_RELEASE) ? 1 : 0;
+	if ((code >= 0xD800) && (code <= 0xDBFF))
+	{
+		pw->surrogate[release] = code;
+		return TRUE;
+	}
+
+	if ((code >= 0xDC00) && (code <= 0xDFFF))
+	{
+		const UINT16 high = pw->surrogate[release];
+		pw->surrogate[release] = 0;
+		if (high == 0)
+			return TRUE;
+		codepoint = 0x10000 + (((UINT32)high - 0xD800) << 10) + (code - 0xDC00u);
+	}
+
+	const guint32 keysym = pipewire_shadow_unicode_keysym(codepoint);
+	if (keysym != 0)
+	{
+		const guint32 state = release ? 0 : 1;
+		pipewire_shadow_portal_notify(pw, "NotifyKeyboardKeysym",
+		                              g_variant_new("(o@a{sv}iu)", pw->session,
+		                                            pipewire_shadow_empty_options(),
+		                                            (gint32)keysym, state));
+	}
+
+	return TRUE;
+}
+
+static void pipewire_shadow_pointer_motion(pipewireShadowSubsystem* pw, UINT16 x, UINT16 y)
+{
+	pipewire_shadow_portal_notify(pw, "NotifyPointerMotionAbsolute",
+	                              g_variant_new("(o@a{sv}udd)", pw->session,
+	                                            pipewire_shadow_empty_options(), pw->node,
+	                                            (double)x, (double)y));
+}
+
+static void pipewire_shadow_pointer_button(pipewireShadowSubsystem* pw, gint32 button, BOOL down)
+{
+	pipewire_shadow_portal_notify(pw, "NotifyPointerButton",
+	                              g_variant_new("(o@a{sv}iu)", pw->session,
+	                                            pipewire_shadow_empty_options(), button,
+	                                            down ? 1u : 0u));
+}
+
+static BOOL pipewire_shadow_input_mouse_event(rdpShadowSubsystem* subsystem,
+                                              rdpShadowClient* client, UINT16 flags, UINT16 x,
+                                              UINT16 y)
+{
+	pipewireShadowSubsystem* pw = (pipewireShadowSubsystem*)subsystem;
+
+	if (!subsystem || !client)
+		return FALSE;
+
+	if (flags & (PTR_FLAGS_WHEEL | PTR_FLAGS_HWHEEL))
+	{
+		/* Positive discrete steps scroll down or right, RDP wheel rotation is the opposite */
+		const guint32 axis = (flags & PTR_FLAGS_HWHEEL) ? 1 : 0;
+		gint32 steps = (flags & PTR_FLAGS_WHEEL_NEGATIVE) ? 1 : -1;
+
+		if (axis == 1)
+			steps = -steps;
+
+		pipewire_shadow_portal_notify(pw, "NotifyPointerAxisDiscrete",
+		                              g_variant_new("(o@a{sv}ui)", pw->session,
+		                                            pipewire_shadow_empty_options(), axis, steps));
+		return TRUE;
+	}
+
+	if (flags & PTR_FLAGS_MOVE)
+		pipewire_shadow_pointer_motion(pw, x, y);
+
+	gint32 button = 0;
+	if (flags & PTR_FLAGS_BUTTON1)
+		button = BTN_LEFT;
+	else if (flags & PTR_FLAGS_BUTTON2)
+		button = BTN_RIGHT;
+	else if (flags & PTR_FLAGS_BUTTON3)
+		button = BTN_MIDDLE;
+
+	if (button)
+		pipewire_shadow_pointer_button(pw, button, (flags & PTR_FLAGS_DOWN) ? TRUE : FALSE);
+
+	return TRUE;
+}
+
+static BOOL pipewire_shadow_input_extended_mouse_event(rdpShadowSubsystem* subsystem,
+                                                       rdpShadowClient* client, UINT16 flags,
+                                                       UINT16 x, UINT16 y)
+{
+	pipewireShadowSubsystem* pw = (pipewireShadowSubsystem*)subsystem;
+
+	if (!subsystem || !client)
+		return FALSE;
+
+	pipewire_shadow_pointer_motion(pw, x, y);
+
+	gint32 button = 0;
+	if (flags & PTR_XFLAGS_BUTTON1)
+		button = BTN_SIDE;
+	else if (flags & PTR_XFLAGS_BUTTON2)
+		button = BTN_EXTRA;
+
+	if (button)
+		pipewire_shadow_pointer_button(pw, button, (flags & PTR_XFLAGS_DOWN) ? TRUE : FALSE);
+
+	return TRUE;
+}
+
+static UINT32 pipewire_shadow_format(enum spa_video_format format)
+{
+	switch (format)
+	{
+		case SPA_VIDEO_FORMAT_BGRx:
+			return PIXEL_FORMAT_BGRX32;
+		case SPA_VIDEO_FORMAT_BGRA:
+			return PIXEL_FORMAT_BGRA32;
+		case SPA_VIDEO_FORMAT_RGBx:
+			return PIXEL_FORMAT_RGBX32;
+		case SPA_VIDEO_FORMAT_RGBA:
+			return PIXEL_FORMAT_RGBA32;
+		default:
+			return 0;
+	}
+}
+
+static const struct spa_pod* pipewire_shadow_build_format(struct spa_pod_builder* b, BOOL dmabuf)
+{
+	struct spa_pod_frame f = { 0 };
+	const struct spa_rectangle defSize = SPA_RECTANGLE(1920, 1080);
+	const struct spa_rectangle minSize = SPA_RECTANGLE(1, 1);
+	const struct spa_rectangle maxSize = SPA_RECTANGLE(8192, 8192);
+	const struct spa_fraction defRate = SPA_FRACTION(30, 1);
+	const struct spa_fraction minRate = SPA_FRACTION(0, 1);
+	const struct spa_fraction maxRate = SPA_FRACTION(144, 1);
+
+	spa_pod_builder_push_object(b, &f, SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b, SPA_FORMAT_mediaType, SPA_POD_Id(SPA_MEDIA_TYPE_video), 0);
+	spa_pod_builder_add(b, SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw), 0);
+	spa_pod_builder_add(b, SPA_FORMAT_VIDEO_format,
+	                    SPA_POD_CHOICE_ENUM_Id(5, SPA_VIDEO_FORMAT_BGRx, SPA_VIDEO_FORMAT_BGRx,
+	                                           SPA_VIDEO_FORMAT_BGRA, SPA_VIDEO_FORMAT_RGBx,
+	                                           SPA_VIDEO_FORMAT_RGBA),
+	                    0);
+
+	if (dmabuf)
+	{
+		/* Only linear DMA-BUFs can be mapped and read without a GPU import */
+		spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_modifier, SPA_POD_PROP_FLAG_MANDATORY);
+		spa_pod_builder_long(b, PIPEWIRE_SHADOW_MOD_LINEAR);
+	}
+
+	spa_pod_builder_add(b, SPA_FORMAT_VIDEO_size,
+	                    SPA_POD_CHOICE_RANGE_Rectangle(&defSize, &minSize, &maxSize), 0);
+	spa_pod_builder_add(b, SPA_FORMAT_VIDEO_framerate,
+	                    SPA_POD_CHOICE_RANGE_Fraction(&defRate, &minRate, &maxRate), 0);
+	return (const struct spa_pod*)spa_pod_builder_pop(b, &f);
+}
+
+static void pipewire_shadow_stream_state_changed(void* data, enum pw_stream_state old,
+                                                 enum pw_stream_state state, const char* error)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)data;
+
+	WINPR_UNUSED(old);
+	WLog_DBG(TAG, "stream state %s", pw_stream_state_as_string(state));
+
+	if (state == PW_STREAM_STATE_ERROR)
+	{
+		WLog_ERR(TAG, "stream error: %s", error ? error : "unknown");
+		pw_thread_loop_signal(subsystem->loop, FALSE);
+	}
+}
+
+static void pipewire_shadow_stream_param_changed(void* data, uint32_t id,
+                                                 const struct spa_pod* param)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)data;
+	struct spa_video_info_raw info = { 0 };
+	uint32_t mediaType = 0;
+	uint32_t mediaSubtype = 0;
+
+	if (!param || (id != SPA_PARAM_Format))
+		return;
+
+	if ((spa_format_parse(param, &mediaType, &mediaSubtype) < 0) ||
+	    (mediaType != SPA_MEDIA_TYPE_video) || (mediaSubtype != SPA_MEDIA_SUBTYPE_raw))
+		return;
+
+	if (spa_format_video_raw_parse(param, &info) < 0)
+		return;
+
+	const UINT32 format = pipewire_shadow_format(info.format);
+	if (format == 0)
+	{
+		WLog_ERR(TAG, "unsupported stream format %" PRIu32, (UINT32)info.format);
+		return;
+	}
+
+	subsystem->dmabuf = spa_pod_find_prop(param, NULL, SPA_FORMAT_VIDEO_modifier) != NULL;
+	subsystem->format = format;
+	subsystem->streamWidth = info.size.width;
+	subsystem->streamHeight = info.size.height;
+
+	const int dataType = subsystem->dmabuf
+	                         ? (1 << SPA_DATA_DmaBuf)
+	                         : ((1 << SPA_DATA_MemFd) | (1 << SPA_DATA_MemPtr));
+	uint8_t buffer[1024] = { 0 };
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod* params[3] = { 0 };
+
+	params[0] = (const struct spa_pod*)spa_pod_builder_add_object(
+	    &b, SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers, SPA_PARAM_BUFFERS_buffers,
+	    SPA_POD_CHOICE_RANGE_Int(4, 2, 16), SPA_PARAM_BUFFERS_blocks, SPA_POD_Int(1),
+	    SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(dataType));
+	params[1] = (const struct spa_pod*)spa_pod_builder_add_object(
+	    &b, SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta, SPA_PARAM_META_type,
+	    SPA_POD_Id(SPA_META_Header), SPA_PARAM_META_size,
+	    SPA_POD_Int(sizeof(struct spa_meta_header)));
+	/* The compositor reports damage, there is no need to compare frames */
+	params[2] = (const struct spa_pod*)spa_pod_builder_add_object(
+	    &b, SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta, SPA_PARAM_META_type,
+	    SPA_POD_Id(SPA_META_VideoDamage), SPA_PARAM_META_size,
+	    SPA_POD_CHOICE_RANGE_Int(sizeof(struct spa_meta_region) * PIPEWIRE_SHADOW_MAX_DAMAGE,
+	                             sizeof(struct spa_meta_region),
+	                             sizeof(struct spa_meta_region) * PIPEWIRE_SHADOW_MAX_DAMAGE));
+
+	pw_stream_update_params(subsystem->stream, params, ARRAYSIZE(params));
+
+	WLog_INFO(TAG, "stream %" PRIu32 "x%" PRIu32 " %s, %s buffers", subsystem->streamWidth,
+	          subsystem->streamHeight, FreeRDPGetColorFormatName(format),
+	          subsystem->dmabuf ? "DMA-BUF" : "shared memory");
+
+	subsystem->negotiated = TRUE;
+	pw_thread_loop_signal(subsystem->loop, FALSE);
+}
+
+/* Map DMA-BUFs once when they are added instead of per frame */
+static void pipewire_shadow_stream_add_buffer(void* data, struct pw_buffer* buffer)
+{
+	WINPR_UNUSED(data);
+
+	struct spa_data* d = &buffer->buffer->datas[0];
+	if ((d->type != SPA_DATA_DmaBuf) || d->data)
+		return;
+
+	PIPEWIRE_SHADOW_BUFFER* map =
+	    (PIPEWIRE_SHADOW_BUFFER*)calloc(1, sizeof(PIPEWIRE_SHADOW_BUFFER));
+	if (!map)
+		return;
+
+	map->size = d->maxsize + d->mapoffset;
+	map->map = mmap(NULL, map->size, PROT_READ, MAP_SHARED, (int)d->fd, 0);
+	if (map->map == MAP_FAILED)
+	{
+		WLog_ERR(TAG, "failed to map DMA-BUF: %s", strerror(errno));
+		free(map);
+		return;
+	}
+
+	buffer->user_data = map;
+}
+
+static void pipewire_shadow_stream_remove_buffer(void* data, struct pw_buffer* buffer)
+{
+	WINPR_UNUSED(data);
+
+	PIPEWIRE_SHADOW_BUFFER* map = (PIPEWIRE_SHADOW_BUFFER*)buffer->user_data;
+	if (!map)
+		return;
+
+	munmap(map->map, map->size);
+	free(map);
+	buffer->user_data = NULL;
+}
+
+static BOOL pipewire_shadow_buffer_damage(const struct spa_buffer* buffer, REGION16* damage,
+                                          const RECTANGLE_16* bounds)
+{
+	const struct spa_meta* meta = spa_buffer_find_meta(buffer, SPA_META_VideoDamage);
+
+	if (!meta)
+		return region16_union_rect(damage, damage, bounds);
+
+	const struct spa_meta_region* region = NULL;
+	spa_meta_for_each(region, meta)
+	{
+		if (!spa_meta_region_is_valid(region))
+			break;
+
+		const INT64 left = MAX(region->region.position.x, 0);
+		const INT64 top = MAX(region->region.position.y, 0);
+		const INT64 right = MIN(region->region.position.x + region->region.size.width,
+		                        (INT64)bounds->right);
+		const INT64 bottom = MIN(region->region.position.y + region->region.size.height,
+		                         (INT64)bounds->bottom);
+
+		if ((left >= right) || (top >= bottom))
+			continue;
+
+		const RECTANGLE_16 rect = { (UINT16)left, (UINT16)top, (UINT16)right, (UINT16)bottom };
+		if (!region16_union_rect(damage, damage, &rect))
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void pipewire_shadow_copy_frame(pipewireShadowSubsystem* subsystem,
+                                       struct pw_buffer* buffer, REGION16* damage)
+{
+	rdpShadowServer* server = subsystem->common.server;
+	rdpShadowSurface* surface = server ? server->surface : NULL;
+	struct spa_data* d = &buffer->buffer->datas[0];
+	const PIPEWIRE_SHADOW_BUFFER* map = (const PIPEWIRE_SHADOW_BUFFER*)buffer->user_data;
+	const BYTE* src = (const BYTE*)d->data;
+
+	if (!src && map)
+		src = &((const BYTE*)map->map)[d->mapoffset];
+
+	if (!src || !d->chunk || (d->chunk->size == 0))
+		return;
+
+	const struct spa_meta_header* header = (const struct spa_meta_header*)spa_buffer_find_meta_data(
+	    buffer->buffer, SPA_META_Header, sizeof(struct spa_meta_header));
+	if ((header && (header->flags & SPA_META_HEADER_FLAG_CORRUPTED)) ||
+	    (d->chunk->flags & SPA_CHUNK_FLAG_CORRUPTED))
+		return;
+
+	const UINT32 stride =
+	    (d->chunk->stride > 0) ? (UINT32)d->chunk->stride : subsystem->streamWidth * 4;
+	src = &src[d->chunk->offset];
+
+	if (!surface)
+		return;
+
+	EnterCriticalSection(&surface->lock);
+
+	/* Resizing is up to the subsystem thread, keep the damage until it is done */
+	if ((surface->width != subsystem->streamWidth) || (surface->height != subsystem->streamHeight))
+	{
+		subsystem->fullDamage = TRUE;
+		LeaveCriticalSection(&surface->lock);
+		return;
+	}
+
+	const RECTANGLE_16 bounds = { 0, 0, (UINT16)surface->width, (UINT16)surface->height };
+	if (subsystem->fullDamage)
+	{
+		region16_union_rect(damage, damage, &bounds);
+		subsystem->fullDamage = FALSE;
+	}
+
+	struct dma_buf_sync sync = { DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ };
+	if (map)
+		(void)ioctl((int)d->fd, DMA_BUF_IOCTL_SYNC, &sync);
+
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(damage, &numRects);
+
+	/* Only copy the damaged rectangles, the encoders work on the surface */
+	for (UINT32 index = 0; index < numRects; index++)
+	{
+		const RECTANGLE_16* rect = &rects[index];
+
+		if (!freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline,
+		                                   rect->left, rect->top, rect->right - rect->left,
+		                                   rect->bottom - rect->top, src, subsystem->format, stride,
+		                                   rect->left, rect->top, NULL, FREERDP_FLIP_NONE))
+		{
+			subsystem->fullDamage = TRUE;
+			break;
+		}
+
+		region16_union_rect(&surface->invalidRegion, &surface->invalidRegion, rect);
+	}
+
+	if (map)
+	{
+		sync.flags = DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ;
+		(void)ioctl((int)d->fd, DMA_BUF_IOCTL_SYNC, &sync);
+	}
+
+	LeaveCriticalSection(&surface->lock);
+}
+
+static void pipewire_shadow_stream_process(void* data)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)data;
+	struct pw_buffer* latest = NULL;
+	struct pw_buffer* buffer = NULL;
+	REGION16 damage;
+	const RECTANGLE_16 bounds = { 0, 0, (UINT16)MIN(subsystem->streamWidth, UINT16_MAX),
+		                          (UINT16)MIN(subsystem->streamHeight, UINT16_MAX) };
+
+	region16_init(&damage);
+
+	/* Only the latest frame is copied, but the damage of skipped frames is kept */
+	while ((buffer = pw_stream_dequeue_buffer(subsystem->stream)))
+	{
+		if (!pipewire_shadow_buffer_damage(buffer->buffer, &damage, &bounds))
+			region16_union_rect(&damage, &damage, &bounds);
+
+		if (latest)
+			pw_stream_queue_buffer(subsystem->stream, latest);
+		latest = buffer;
+	}
+
+	if (latest)
+	{
+		pipewire_shadow_copy_frame(subsystem, latest, &damage);
+		pw_stream_queue_buffer(subsystem->stream, latest);
+	}
+
+	region16_uninit(&damage);
+}
+
+static const struct pw_stream_events pipewire_shadow_stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.state_changed = pipewire_shadow_stream_state_changed,
+	.param_changed = pipewire_shadow_stream_param_changed,
+	.add_buffer = pipewire_shadow_stream_add_buffer,
+	.remove_buffer = pipewire_shadow_stream_remove_buffer,
+	.process = pipewire_shadow_stream_process,
+};
+
+static BOOL pipewire_shadow_stream_connect(pipewireShadowSubsystem* subsystem, int fd)
+{
+	BOOL rc = FALSE;
+	uint8_t buffer[2048] = { 0 };
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod* params[2] = { 0 };
+
+	if (!(subsystem->loop = pw_thread_loop_new("freerdp-shadow", NULL)))
+	{
+		close(fd);
+		return FALSE;
+	}
+
+	if (!(subsystem->pwContext =
+	          pw_context_new(pw_thread_loop_get_loop(subsystem->loop), NULL, 0)) ||
+	    (pw_thread_loop_start(subsystem->loop) < 0))
+	{
+		close(fd);
+		return FALSE;
+	}
+
+	pw_thread_loop_lock(subsystem->loop);
+
+	/* The core takes ownership of the portal file descriptor */
+	if (!(subsystem->core = pw_context_connect_fd(subsystem->pwContext, fd, NULL, 0)))
+	{
+		WLog_ERR(TAG, "failed to connect to the PipeWire remote");
+		goto fail;
+	}
+
+	subsystem->stream = pw_stream_new(
+	    subsystem->core, "FreeRDP shadow",
+	    pw_properties_new(PW_KEY_MEDIA_TYPE, "Video", PW_KEY_MEDIA_CATEGORY, "Capture",
+	                      PW_KEY_MEDIA_ROLE, "Screen", NULL));
+	if (!subsystem->stream)
+		goto fail;
+
+	pw_stream_add_listener(subsystem->stream, &subsystem->streamListener,
+	                       &pipewire_shadow_stream_events, subsystem);
+
+	/* Prefer DMA-BUFs, they avoid a copy in the compositor */
+	params[0] = pipewire_shadow_build_format(&b, TRUE);
+	params[1] = pipewire_shadow_build_format(&b, FALSE);
+
+	if (pw_stream_connect(subsystem->stream, PW_DIRECTION_INPUT, subsystem->node,
+	                      PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS, params,
+	                      ARRAYSIZE(params)) < 0)
+	{
+		WLog_ERR(TAG, "failed to connect to stream node %" PRIu32, subsystem->node);
+		goto fail;
+	}
+
+	/* The surface size depends on the negotiated format */
+	while (!subsystem->negotiated &&
+	       (pw_stream_get_state(subsystem->stream, NULL) != PW_STREAM_STATE_ERROR))
+	{
+		if (pw_thread_loop_timed_wait(subsystem->loop, 5) != 0)
+		{
+			WLog_ERR(TAG, "timed out waiting for the stream format");
+			break;
+		}
+	}
+
+	rc = subsystem->negotiated;
+fail:
+	pw_thread_loop_unlock(subsystem->loop);
+	return rc;
+}
+
+static void pipewire_shadow_stream_disconnect(pipewireShadowSubsystem* subsystem)
+{
+	if (subsystem->loop)
+		pw_thread_loop_stop(subsystem->loop);
+
+	if (subsystem->stream)
+	{
+		pw_stream_destroy(subsystem->stream);
+		subsystem->stream = NULL;
+	}
+
+	if (subsystem->core)
+	{
+		pw_core_disconnect(subsystem->core);
+		subsystem->core = NULL;
+	}
+
+	if (subsystem->pwContext)
+	{
+		pw_context_destroy(subsystem->pwContext);
+		subsystem->pwContext = NULL;
+	}
+
+	if (subsystem->loop)
+	{
+		pw_thread_loop_destroy(subsystem->loop);
+		subsystem->loop = NULL;
+	}
+
+	subsystem->negotiated = FALSE;
+}
+
+static void pipewire_shadow_update_monitors(pipewireShadowSubsystem* subsystem)
+{
+	MONITOR_DEF* monitor = &subsystem->common.monitors[0];
+	MONITOR_DEF* virtualScreen = &subsystem->common.virtualScreen;
+
+	subsystem->width = subsystem->streamWidth;
+	subsystem->height = subsystem->streamHeight;
+
+	/* The portal stream is the only monitor, it was picked by the user */
+	monitor->left = 0;
+	monitor->top = 0;
+	monitor->right = (INT32)subsystem->width - 1;
+	monitor->bottom = (INT32)subsystem->height - 1;
+	monitor->flags = 1;
+	*virtualScreen = *monitor;
+	subsystem->common.numMonitors = 1;
+	subsystem->common.selectedMonitor = 0;
+}
+
+static BOOL pipewire_shadow_check_resize(pipewireShadowSubsystem* subsystem)
+{
+	pw_thread_loop_lock(subsystem->loop);
+	const BOOL resized = (subsystem->width != subsystem->streamWidth) ||
+	                     (subsystem->height != subsystem->streamHeight);
+	if (resized)
+		pipewire_shadow_update_monitors(subsystem);
+	pw_thread_loop_unlock(subsystem->loop);
+
+	if (resized)
+		shadow_screen_resize(subsystem->common.server->screen);
+
+	return resized;
+}
+
+static void pipewire_shadow_frame_update(pipewireShadowSubsystem* subsystem)
+{
+	rdpShadowServer* server = subsystem->common.server;
+	rdpShadowSurface* surface = server->surface;
+
+	if (ArrayList_Count(server->clients) < 1)
+		return;
+
+	EnterCriticalSection(&surface->lock);
+	const BOOL empty = region16_is_empty(&surface->invalidRegion);
+	LeaveCriticalSection(&surface->lock);
+
+	if (empty)
+		return;
+
+	shadow_subsystem_frame_update(&subsystem->common);
+
+	if (ArrayList_Count(server->clients) == 1)
+	{
+		rdpShadowClient* client = (rdpShadowClient*)ArrayList_GetItem(server->clients, 0);
+
+		if (client)
+			subsystem->common.captureFrameRate = shadow_encoder_preferred_fps(client->encoder);
+	}
+
+	EnterCriticalSection(&surface->lock);
+	region16_clear(&surface->invalidRegion);
+	LeaveCriticalSection(&surface->lock);
+}
+
+static int pipewire_shadow_subsystem_process_message(pipewireShadowSubsystem* subsystem,
+                                                     wMessage* message)
+{
+	switch (message->id)
+	{
+		case SHADOW_MSG_IN_REFRESH_REQUEST_ID:
+			shadow_subsystem_frame_update((rdpShadowSubsystem*)subsystem);
+			break;
+
+		default:
+			WLog_ERR(TAG, "Unknown message id: %" PRIu32 "", message->id);
+			break;
+	}
+
+	if (message->Free)
+		message->Free(message);
+
+	return 1;
+}
+
+/* Pause the stream while no client shows the screen, the compositor stops producing frames */
+static void pipewire_shadow_set_active(pipewireShadowSubsystem* subsystem, BOOL active)
+{
+	pw_thread_loop_lock(subsystem->loop);
+	if (subsystem->stream)
+	{
+		/* Frames skipped while paused carry no damage for the time in between */
+		if (active)
+			subsystem->fullDamage = TRUE;
+		(void)pw_stream_set_active(subsystem->stream, active);
+	}
+	pw_thread_loop_unlock(subsystem->loop);
+}
+
+/* Frames are copied on the PipeWire thread, this one paces the updates to the clients */
+static DWORD WINAPI pipewire_shadow_subsystem_thread(LPVOID arg)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)arg;
+	wMessage message = { 0 };
+	wMessagePipe* MsgPipe = subsystem->common.MsgPipe;
+	HANDLE events[] = { MessageQueue_Event(MsgPipe->In),
+		                shadow_subsystem_capture_event(&subsystem->common) };
+	BOOL active = TRUE;
+
+	subsystem->common.captureFrameRate = 16;
+	UINT64 frameTime = GetTickCount64() + 1000 / subsystem->common.captureFrameRate;
+
+	while (1)
+	{
+		DWORD status = 0;
+
+		if (active != shadow_subsystem_capture_wanted(&subsystem->common))
+		{
+			active = !active;
+			pipewire_shadow_set_active(subsystem, active);
+			frameTime = GetTickCount64();
+		}
+
+		if (!active)
+		{
+			/* Nobody watches, sleep until a client shows the screen again */
+			status = WaitForMultipleObjects(ARRAYSIZE(events), events, FALSE, INFINITE);
+		}
+		else
+		{
+			const UINT64 cTime = GetTickCount64();
+			const DWORD dwTimeout = (cTime > frameTime) ? 0 : (DWORD)(frameTime - cTime);
+			status = WaitForSingleObject(events[0], dwTimeout);
+		}
+
+		if (status == WAIT_OBJECT_0)
+		{
+			if (MessageQueue_Peek(MsgPipe->In, &message, TRUE))
+			{
+				if (message.id == WMQ_QUIT)
+					break;
+
+				pipewire_shadow_subsystem_process_message(subsystem, &message);
+			}
+		}
+
+		if (active && ((status == WAIT_TIMEOUT) || (GetTickCount64() > frameTime)))
+		{
+			pipewire_shadow_check_resize(subsystem);
+			pipewire_shadow_frame_update(subsystem);
+			frameTime += 1000 / subsystem->common.captureFrameRate;
+		}
+	}
+
+	ExitThread(0);
+	return 0;
+}
+
+static UINT32 pipewire_shadow_enum_monitors(MONITOR_DEF* monitors, UINT32 maxMonitors)
+{
+	WINPR_UNUSED(monitors);
+	WINPR_UNUSED(maxMonitors);
+
+	/* Monitors are chosen in the portal dialog and cannot be listed up front */
+	WLog_INFO(TAG, "the monitor to share is selected through xdg-desktop-portal");
+	return 0;
+}
+
+static int pipewire_shadow_subsystem_uninit(rdpShadowSubsystem* sub)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)sub;
+
+	if (!subsystem)
+		return -1;
+
+	pipewire_shadow_stream_disconnect(subsystem);
+	pipewire_shadow_portal_close(subsystem);
+
+	if (subsystem->connection)
+	{
+		g_object_unref(subsystem->connection);
+		subsystem->connection = NULL;
+	}
+
+	if (subsystem->context)
+	{
+		g_main_context_unref(subsystem->context);
+		subsystem->context = NULL;
+	}
+
+	g_free(subsystem->sender);
+	subsystem->sender = NULL;
+	return 1;
+}
+
+static int pipewire_shadow_subsystem_init(rdpShadowSubsystem* sub)
+{
+	int rc = -1;
+	GError* error = NULL;
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)sub;
+
+	if (!subsystem)
+		return -1;
+
+	if (!(subsystem->context = g_main_context_new()))
+		return -1;
+
+	/* Portal responses are dispatched on this thread while waiting for them */
+	g_main_context_push_thread_default(subsystem->context);
+
+	subsystem->connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
+	if (!subsystem->connection)
+	{
+		WLog_ERR(TAG, "failed to connect to the session bus: %s",
+		         error ? error->message : "unknown");
+		goto fail;
+	}
+
+	/* Request object paths use the unique bus name without ':' and with '.' as '_' */
+	subsystem->sender = g_strdup(&g_dbus_connection_get_unique_name(subsystem->connection)[1]);
+	for (char* c = subsystem->sender; *c; c++)
+	{
+		if (*c == '.')
+			*c = '_';
+	}
+
+	if (!pipewire_shadow_portal_create_session(subsystem) ||
+	    !pipewire_shadow_portal_select(subsystem, PORTAL_REMOTEDESKTOP_INTERFACE, "SelectDevices",
+	                                   "types", PORTAL_DEVICE_KEYBOARD | PORTAL_DEVICE_POINTER) ||
+	    !pipewire_shadow_portal_select(subsystem, PORTAL_SCREENCAST_INTERFACE, "SelectSources",
+	                                   "types", PORTAL_SOURCE_MONITOR) ||
+	    !pipewire_shadow_portal_start(subsystem))
+		goto fail;
+
+	const int fd = pipewire_shadow_portal_open_remote(subsystem);
+	if (fd < 0)
+		goto fail;
+
+	if (!pipewire_shadow_stream_connect(subsystem, fd))
+		goto fail;
+
+	pw_thread_loop_lock(subsystem->loop);
+	pipewire_shadow_update_monitors(subsystem);
+	subsystem->fullDamage = TRUE;
+	pw_thread_loop_unlock(subsystem->loop);
+
+	rc = 1;
+fail:
+	g_main_context_pop_thread_default(subsystem->context);
+	g_clear_error(&error);
+	if (rc < 0)
+		pipewire_shadow_subsystem_uninit(sub);
+	return rc;
+}
+
+static int pipewire_shadow_subsystem_start(rdpShadowSubsystem* sub)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)sub;
+
+	if (!subsystem)
+		return -1;
+
+	if (!(subsystem->thread =
+	          CreateThread(NULL, 0, pipewire_shadow_subsystem_thread, (void*)subsystem, 0, NULL)))
+	{
+		WLog_ERR(TAG, "Failed to create thread");
+		return -1;
+	}
+
+	return 1;
+}
+
+static int pipewire_shadow_subsystem_stop(rdpShadowSubsystem* sub)
+{
+	pipewireShadowSubsystem* subsystem = (pipewireShadowSubsystem*)sub;
+
+	if (!subsystem)
+		return -1;
+
+	if (subsystem->thread)
+	{
+		if (MessageQueue_PostQuit(subsystem->common.MsgPipe->In, 0))
+			(void)WaitForSingleObject(subsystem->thread, INFINITE);
+
+		(void)CloseHandle(subsystem->thread);
+		subsystem->thread = NULL;
+	}
+
+	return 1;
+}
+
+static rdpShadowSubsystem* pipewire_shadow_subsystem_new(void)
+{
+	pipewireShadowSubsystem* subsystem =
+	    (pipewireShadowSubsystem*)calloc(1, sizeof(pipewireShadowSubsystem));
+
+	if (!subsystem)
+		return NULL;
+
+	pw_init(NULL, NULL);
+
+	subsystem->common.SynchronizeEvent = pipewire_shadow_input_synchronize_event;
+	subsystem->common.KeyboardEvent = pipewire_shadow_input_keyboard_event;
+	subsystem->common.UnicodeKeyboardEvent = pipewire_shadow_input_unicode_keyboard_event;
+	subsystem->common.MouseEvent = pipewire_shadow_input_mouse_event;
+	subsystem->common.ExtendedMouseEvent = pipewire_shadow_input_extended_mouse_event;
+	return (rdpShadowSubsystem*)subsystem;
+}
+
+static void pipewire_shadow_subsystem_free(rdpShadowSubsystem* subsystem)
+{
+	if (!subsystem)
+		return;
+
+	pipewire_shadow_subsystem_uninit(subsystem);
+	free(subsystem);
+	pw_deinit();
+}
+
+const char* PipeWireShadowSubsystemName(void)
+{
+	return "PipeWire";
+}
+
+int PipeWireShadowSubsystemEntry(RDP_SHADOW_ENTRY_POINTS* pEntryPoints)
+{
+	if (!pEntryPoints)
+		return -1;
+
+	pEntryPoints->New = pipewire_shadow_subsystem_new;
+	pEntryPoints->Free = pipewire_shadow_subsystem_free;
+	pEntryPoints->Init = pipewire_shadow_subsystem_init;
+	pEntryPoints->Uninit = pipewire_shadow_subsystem_uninit;
+	pEntryPoints->Start = pipewire_shadow_subsystem_start;
+	pEntryPoints->Stop = pipewire_shadow_subsystem_stop;
+	pEntryPoints->EnumMonitors = pipewire_shadow_enum_monitors;
+	return 1;
+}
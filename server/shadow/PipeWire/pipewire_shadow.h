@@ -0,0 +1,78 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_PIPEWIRE_H
+#define FREERDP_SERVER_SHADOW_PIPEWIRE_H
+
+#include <freerdp/server/shadow.h>
+
+typedef struct pipewire_shadow_subsystem pipewireShadowSubsystem;
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+
+#include <gio/gio.h>
+
+#include <pipewire/pipewire.h>
+#include <spa/param/video/format-utils.h>
+
+struct pipewire_shadow_subsystem
+{
+	rdpShadowSubsystem common;
+
+	HANDLE thread;
+
+	UINT32 width;
+	UINT32 height;
+
+	/* xdg-desktop-portal RemoteDesktop session, also used for input */
+	GDBusConnection* connection;
+	GMainContext* context;
+	char* sender;
+	char* session;
+	UINT32 token;
+	UINT32 node;
+
+	/* High surrogate of the unicode key press and release in progress */
+	UINT16 surrogate[2];
+
+	/* PipeWire stream, its callbacks run on the loop thread */
+	struct pw_thread_loop* loop;
+	struct pw_context* pwContext;
+	struct pw_core* core;
+	struct pw_stream* stream;
+	struct spa_hook streamListener;
+	BOOL negotiated;
+	BOOL dmabuf;
+	UINT32 format;
+	UINT32 streamWidth;
+	UINT32 streamHeight;
+
+	/* Set when the surface lags behind the stream, protected by the surface lock */
+	BOOL fullDamage;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_SERVER_SHADOW_PIPEWIRE_H */
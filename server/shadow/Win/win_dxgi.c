@@ -497,26 +497,32 @@ int win_shadow_dxgi_uninit(winShadowSubsystem* subsystem)
 }
 
 int win_shadow_dxgi_fetch_frame_data(winShadowSubsystem* subsystem, BYTE** ppDstData,
-                                     int* pnDstStep, int x, int y, int width, int height)
+                                     int* pnDstStep, const REGION16* region)
 {
 	int status;
 	HRESULT hr;
 	D3D11_BOX Box;
 	DXGI_MAPPED_RECT mappedRect;
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(region, &numRects);
 
-	if ((width * height) < 1)
+	if (numRects < 1)
 		return 0;
 
-	Box.top = x;
-	Box.left = y;
-	Box.right = x + width;
-	Box.bottom = y + height;
-	Box.front = 0;
-	Box.back = 1;
+	/* Only the invalid rects are read back, each one to its place in the staging texture */
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		Box.left = rects[i].left;
+		Box.top = rects[i].top;
+		Box.right = rects[i].right;
+		Box.bottom = rects[i].bottom;
+		Box.front = 0;
+		Box.back = 1;
 
-	subsystem->dxgiDeviceContext->lpVtbl->CopySubresourceRegion(
-	    subsystem->dxgiDeviceContext, (ID3D11Resource*)subsystem->dxgiStage, 0, 0, 0, 0,
-	    (ID3D11Resource*)subsystem->dxgiDesktopImage, 0, &Box);
+		subsystem->dxgiDeviceContext->lpVtbl->CopySubresourceRegion(
+		    subsystem->dxgiDeviceContext, (ID3D11Resource*)subsystem->dxgiStage, 0, Box.left,
+		    Box.top, 0, (ID3D11Resource*)subsystem->dxgiDesktopImage, 0, &Box);
+	}
 
 	hr = subsystem->dxgiStage->lpVtbl->QueryInterface(subsystem->dxgiStage, &IID_IDXGISurface,
 	                                                  (void**)&(subsystem->dxgiSurface));
@@ -697,6 +703,8 @@ int win_shadow_dxgi_get_invalid_region(winShadowSubsystem* subsystem)
 	RECT* pDirtyRectsBuffer;
 	DXGI_OUTDUPL_MOVE_RECT* pMoveRect;
 	DXGI_OUTDUPL_MOVE_RECT* pMoveRectBuffer;
+	SHADOW_SURFACE_MOVE moves[8] = { 0 };
+	REGION16 dirty;
 	rdpShadowSurface* surface = subsystem->server->surface;
 
 	if (subsystem->dxgiFrameInfo.AccumulatedFrames == 0)
@@ -773,9 +781,20 @@ int win_shadow_dxgi_get_invalid_region(winShadowSubsystem* subsystem)
 		invalidRect.bottom = (UINT16)pDstRect->bottom;
 
 		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion), &invalidRect);
+
+		if (i < ARRAYSIZE(moves))
+		{
+			moves[i].src.left = (UINT16)pSrcPt->x;
+			moves[i].src.top = (UINT16)pSrcPt->y;
+			moves[i].src.right = (UINT16)(pSrcPt->x + (pDstRect->right - pDstRect->left));
+			moves[i].src.bottom = (UINT16)(pSrcPt->y + (pDstRect->bottom - pDstRect->top));
+			moves[i].x = invalidRect.left;
+			moves[i].y = invalidRect.top;
+		}
 	}
 
 	numDirtyRects = DirtyRectsBufferSize / sizeof(RECT);
+	region16_init(&dirty);
 
 	for (UINT i = 0; i < numDirtyRects; i++)
 	{
@@ -787,8 +806,20 @@ int win_shadow_dxgi_get_invalid_region(winShadowSubsystem* subsystem)
 		invalidRect.bottom = (UINT16)pDirtyRect->bottom;
 
 		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion), &invalidRect);
+		region16_union_rect(&dirty, &dirty, &invalidRect);
+	}
+
+	/* Let the gfx encoder send the moves as copies instead of encoding their destinations */
+	if ((numMoveRects > 0) && (numMoveRects <= ARRAYSIZE(moves)))
+	{
+		UINT32 numRects = 0;
+		const RECTANGLE_16* rects = region16_rects(&dirty, &numRects);
+		(void)shadow_surface_set_moves(surface, moves, numMoveRects, rects, numRects);
 	}
+	else
+		(void)shadow_surface_set_moves(surface, NULL, 0, NULL, 0);
 
+	region16_uninit(&dirty);
 	return 1;
 }
 
@@ -308,16 +308,34 @@ static int win_shadow_surface_copy(winShadowSubsystem* subsystem)
 	}
 #elif defined(WITH_DXGI_1_2)
 	DstFormat = PIXEL_FORMAT_BGRX32;
-	status = win_shadow_dxgi_fetch_frame_data(subsystem, &pDstData, &nDstStep, x, y, width, height);
+	status =
+	    win_shadow_dxgi_fetch_frame_data(subsystem, &pDstData, &nDstStep, &(surface->invalidRegion));
 #endif
 
 	if (status <= 0)
 		return status;
 
+#if defined(WITH_DXGI_1_2)
+	/* The staging texture only holds the invalid rects, copy nothing else */
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(&(surface->invalidRegion), &numRects);
+
+	for (UINT32 i = 0; i < numRects; i++)
+	{
+		const RECTANGLE_16* rect = &rects[i];
+
+		if (!freerdp_image_copy_no_overlap(
+		        surface->data, surface->format, surface->scanline, rect->left, rect->top,
+		        rect->right - rect->left, rect->bottom - rect->top, pDstData, DstFormat, nDstStep,
+		        rect->left, rect->top, NULL, FREERDP_FLIP_NONE))
+			return ERROR_INTERNAL_ERROR;
+	}
+#else
 	if (!freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline, x, y,
 	                                   width, height, pDstData, DstFormat, nDstStep, x, y, NULL,
 	                                   FREERDP_FLIP_NONE))
 		return ERROR_INTERNAL_ERROR;
+#endif
 
 	ArrayList_Lock(server->clients);
 	count = ArrayList_Count(server->clients);
@@ -385,17 +403,28 @@ static DWORD WINAPI win_shadow_subsystem_thread(LPVOID arg)
 
 	while (1)
 	{
-		dwTimeout = INFINITE;
-		cTime = GetTickCount64();
-		dwTimeout = (DWORD)((cTime > frameTime) ? 0 : frameTime - cTime);
-		status = WaitForMultipleObjects(nCount, events, FALSE, dwTimeout);
+		const BOOL capture = shadow_subsystem_capture_wanted(&subsystem->base);
+
+		if (!capture)
+		{
+			/* Nobody watches, sleep until a client shows the screen again */
+			events[nCount] = shadow_subsystem_capture_event(&subsystem->base);
+			status = WaitForMultipleObjects(nCount + 1, events, FALSE, INFINITE);
+			frameTime = GetTickCount64();
+		}
+		else
+		{
+			cTime = GetTickCount64();
+			dwTimeout = (DWORD)((cTime > frameTime) ? 0 : frameTime - cTime);
+			status = WaitForMultipleObjects(nCount, events, FALSE, dwTimeout);
+		}
 
 		if (WaitForSingleObject(StopEvent, 0) == WAIT_OBJECT_0)
 		{
 			break;
 		}
 
-		if ((status == WAIT_TIMEOUT) || (GetTickCount64() > frameTime))
+		if (capture && ((status == WAIT_TIMEOUT) || (GetTickCount64() > frameTime)))
 		{
 			int dxgi_status;
 			dxgi_status = win_shadow_dxgi_get_next_frame(subsystem);
@@ -731,6 +731,9 @@ static BOOL x11_shadow_check_resize(x11ShadowSubsystem* subsystem)
 		virtualScreen->right = subsystem->width - 1;
 		virtualScreen->bottom = subsystem->height - 1;
 		virtualScreen->flags = 1;
+#if defined(WITH_XDAMAGE)
+		subsystem->damageAll = TRUE;
+#endif
 		return TRUE;
 	}
 
@@ -753,6 +756,153 @@ static int x11_shadow_error_handler_for_capture(Display* display, XErrorEvent* e
 	return 0;
 }
 
+static void x11_shadow_publish_frame(x11ShadowSubsystem* subsystem)
+{
+	rdpShadowServer* server = subsystem->common.server;
+	rdpShadowSurface* surface = server->surface;
+
+	// x11_shadow_blend_cursor(subsystem);
+	const size_t count = ArrayList_Count(server->clients);
+	shadow_subsystem_frame_update(&subsystem->common);
+
+	if (count == 1)
+	{
+		rdpShadowClient* client = NULL;
+		client = (rdpShadowClient*)ArrayList_GetItem(server->clients, 0);
+
+		if (client)
+			subsystem->common.captureFrameRate = shadow_encoder_preferred_fps(client->encoder);
+	}
+
+	EnterCriticalSection(&surface->lock);
+	region16_clear(&(surface->invalidRegion));
+	LeaveCriticalSection(&surface->lock);
+}
+
+#if defined(WITH_XDAMAGE) && defined(WITH_XFIXES)
+/* Take the damage accumulated by the server since the last call, in surface coordinates */
+static BOOL x11_shadow_fetch_damage(x11ShadowSubsystem* subsystem, const rdpShadowSurface* surface,
+                                    REGION16* damage)
+{
+	int count = 0;
+	const RECTANGLE_16 bounds = { 0, 0, (UINT16)surface->width, (UINT16)surface->height };
+
+	XDamageSubtract(subsystem->display, subsystem->xdamage, None, subsystem->xdamage_region);
+
+	if (subsystem->damageAll)
+	{
+		subsystem->damageAll = FALSE;
+		return region16_union_rect(damage, damage, &bounds);
+	}
+
+	XRectangle* rects = XFixesFetchRegion(subsystem->display, subsystem->xdamage_region, &count);
+	BOOL rc = TRUE;
+	for (int x = 0; rc && (x < count); x++)
+	{
+		const INT64 left = MAX(0, (INT64)rects[x].x - surface->x);
+		const INT64 top = MAX(0, (INT64)rects[x].y - surface->y);
+		const INT64 right = MIN(bounds.right, (INT64)rects[x].x + rects[x].width - surface->x);
+		const INT64 bottom = MIN(bounds.bottom, (INT64)rects[x].y + rects[x].height - surface->y);
+
+		if ((left >= right) || (top >= bottom))
+			continue;
+
+		const RECTANGLE_16 rect = { (UINT16)left, (UINT16)top, (UINT16)right, (UINT16)bottom };
+		rc = region16_union_rect(damage, damage, &rect);
+	}
+
+	if (rects)
+		XFree(rects);
+	return rc;
+}
+
+/* Read a rect of the screen through the shared memory image and copy it to the surface.
+ * The server writes the rect tightly packed, rects larger than the image are read in bands. */
+static BOOL x11_shadow_xshm_read_rect(x11ShadowSubsystem* subsystem, rdpShadowSurface* surface,
+                                      const RECTANGLE_16* rect)
+{
+	XImage* image = subsystem->fb_image;
+	const int imageWidth = image->width;
+	const int imageHeight = image->height;
+	const int imageStep = image->bytes_per_line;
+	const size_t capacity = 1ull * imageStep * imageHeight;
+	const UINT32 bpp = (UINT32)image->bits_per_pixel / 8;
+	const UINT32 width = rect->right - rect->left;
+	const UINT32 step = width * bpp;
+	const UINT32 rows = (UINT32)MIN(capacity / step, UINT16_MAX);
+	BOOL rc = rows > 0;
+
+	for (UINT32 y = rect->top; rc && (y < rect->bottom); y += rows)
+	{
+		const UINT32 height = MIN(rows, rect->bottom - y);
+
+		image->width = (int)width;
+		image->height = (int)height;
+		image->bytes_per_line = (int)step;
+		rc = XShmGetImage(subsystem->display, subsystem->root_window, image,
+		                  surface->x + (int)rect->left, surface->y + (int)y, AllPlanes) != 0;
+		image->width = imageWidth;
+		image->height = imageHeight;
+		image->bytes_per_line = imageStep;
+
+		if (rc)
+			rc = freerdp_image_copy_no_overlap(surface->data, surface->format, surface->scanline,
+			                                   rect->left, y, width, height, (BYTE*)image->data,
+			                                   subsystem->format, step, 0, 0, NULL,
+			                                   FREERDP_FLIP_NONE);
+	}
+
+	return rc;
+}
+
+/* Only the rects reported by XDamage are read, they are the invalid region as is */
+static int x11_shadow_screen_grab_damage(x11ShadowSubsystem* subsystem)
+{
+	BOOL rc = TRUE;
+	BOOL empty = TRUE;
+	REGION16 damage;
+	rdpShadowSurface* surface = subsystem->common.server->surface;
+
+	region16_init(&damage);
+
+	XLockDisplay(subsystem->display);
+	/* The screen size may be changed outside, BadMatch is ignored until the next resize */
+	XSetErrorHandler(x11_shadow_error_handler_for_capture);
+
+	EnterCriticalSection(&surface->lock);
+	rc = x11_shadow_fetch_damage(subsystem, surface, &damage);
+
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(&damage, &numRects);
+	for (UINT32 index = 0; rc && (index < numRects); index++)
+	{
+		rc = x11_shadow_xshm_read_rect(subsystem, surface, &rects[index]);
+		if (rc)
+			rc = region16_union_rect(&surface->invalidRegion, &surface->invalidRegion,
+			                         &rects[index]);
+	}
+	empty = region16_is_empty(&surface->invalidRegion);
+	LeaveCriticalSection(&surface->lock);
+
+	XSetErrorHandler(NULL);
+	XSync(subsystem->display, False);
+	XUnlockDisplay(subsystem->display);
+	region16_uninit(&damage);
+
+	if (!rc)
+	{
+		/* Part of the damage may be lost, read everything with the next frame */
+		subsystem->damageAll = TRUE;
+		return 1;
+	}
+
+	if (!empty)
+		x11_shadow_publish_frame(subsystem);
+
+	return 1;
+}
+#endif
+
 static int x11_shadow_screen_grab(x11ShadowSubsystem* subsystem)
 {
 	int rc = 0;
@@ -765,9 +915,8 @@ static int x11_shadow_screen_grab(x11ShadowSubsystem* subsystem)
 	XImage* image = NULL;
 	rdpShadowServer* server = NULL;
 	rdpShadowSurface* surface = NULL;
-	RECTANGLE_16 invalidRect;
+	REGION16 invalidRegion;
 	RECTANGLE_16 surfaceRect;
-	const RECTANGLE_16* extents = NULL;
 	server = subsystem->common.server;
 	surface = server->surface;
 	count = ArrayList_Count(server->clients);
@@ -775,6 +924,13 @@ static int x11_shadow_screen_grab(x11ShadowSubsystem* subsystem)
 	if (count < 1)
 		return 1;
 
+#if defined(WITH_XDAMAGE) && defined(WITH_XFIXES)
+	if (subsystem->use_xshm && subsystem->use_xdamage)
+		return x11_shadow_screen_grab_damage(subsystem);
+#endif
+
+	region16_init(&invalidRegion);
+
 	EnterCriticalSection(&surface->lock);
 	surfaceRect.left = 0;
 	surfaceRect.top = 0;
@@ -796,10 +952,10 @@ static int x11_shadow_screen_grab(x11ShadowSubsystem* subsystem)
 		          subsystem->xshm_gc, 0, 0, subsystem->width, subsystem->height, 0, 0);
 
 		EnterCriticalSection(&surface->lock);
-		status = shadow_capture_compare_with_format(
+		status = shadow_capture_compare_region(
 		    surface->data, surface->format, surface->scanline, surface->width, surface->height,
 		    (BYTE*)&(image->data[surface->width * 4ull]), subsystem->format, image->bytes_per_line,
-		    &invalidRect);
+		    &invalidRegion);
 		LeaveCriticalSection(&surface->lock);
 	}
 	else
@@ -811,9 +967,9 @@ static int x11_shadow_screen_grab(x11ShadowSubsystem* subsystem)
 
 		if (image)
 		{
-			status = shadow_capture_compare_with_format(
+			status = shadow_capture_compare_region(
 			    surface->data, surface->format, surface->scanline, surface->width, surface->height,
-			    (BYTE*)image->data, subsystem->format, image->bytes_per_line, &invalidRect);
+			    (BYTE*)image->data, subsystem->format, image->bytes_per_line, &invalidRegion);
 		}
 		LeaveCriticalSection(&surface->lock);
 		if (!image)
@@ -831,58 +987,53 @@ static int x11_shadow_screen_grab(x11ShadowSubsystem* subsystem)
 	XSync(subsystem->display, False);
 	XUnlockDisplay(subsystem->display);
 
-	if (status)
+	if (status > 0)
 	{
 		BOOL empty = 0;
+		UINT32 numRects = 0;
+		const RECTANGLE_16* rects = region16_rects(&invalidRegion, &numRects);
+
 		EnterCriticalSection(&surface->lock);
-		region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion), &invalidRect);
+		for (UINT32 index = 0; index < numRects; index++)
+			region16_union_rect(&(surface->invalidRegion), &(surface->invalidRegion),
+			                    &rects[index]);
 		region16_intersect_rect(&(surface->invalidRegion), &(surface->invalidRegion), &surfaceRect);
 		empty = region16_is_empty(&(surface->invalidRegion));
 		LeaveCriticalSection(&surface->lock);
 
 		if (!empty)
 		{
-			BOOL success = 0;
+			BOOL success = TRUE;
 			EnterCriticalSection(&surface->lock);
-			extents = region16_extents(&(surface->invalidRegion));
-			x = extents->left;
-			y = extents->top;
-			width = extents->right - extents->left;
-			height = extents->bottom - extents->top;
-			WINPR_ASSERT(image);
-			WINPR_ASSERT(image->bytes_per_line >= 0);
-			WINPR_ASSERT(width >= 0);
-			WINPR_ASSERT(height >= 0);
-			success = freerdp_image_copy_no_overlap(
-			    surface->data, surface->format, surface->scanline, x, y, (UINT32)width,
-			    (UINT32)height, (BYTE*)image->data, subsystem->format,
-			    (UINT32)image->bytes_per_line, x, y, NULL, FREERDP_FLIP_NONE);
-			LeaveCriticalSection(&surface->lock);
-			if (!success)
-				goto fail_capture;
-
-			// x11_shadow_blend_cursor(subsystem);
-			count = ArrayList_Count(server->clients);
-			shadow_subsystem_frame_update(&subsystem->common);
+			rects = region16_rects(&(surface->invalidRegion), &numRects);
 
-			if (count == 1)
+			/* Only copy the changed tiles, not their bounding rectangle */
+			for (UINT32 index = 0; success && (index < numRects); index++)
 			{
-				rdpShadowClient* client = NULL;
-				client = (rdpShadowClient*)ArrayList_GetItem(server->clients, 0);
-
-				if (client)
-					subsystem->common.captureFrameRate =
-					    shadow_encoder_preferred_fps(client->encoder);
+				x = rects[index].left;
+				y = rects[index].top;
+				width = rects[index].right - rects[index].left;
+				height = rects[index].bottom - rects[index].top;
+				WINPR_ASSERT(image);
+				WINPR_ASSERT(image->bytes_per_line >= 0);
+				WINPR_ASSERT(width >= 0);
+				WINPR_ASSERT(height >= 0);
+				success = freerdp_image_copy_no_overlap(
+				    surface->data, surface->format, surface->scanline, x, y, (UINT32)width,
+				    (UINT32)height, (BYTE*)image->data, subsystem->format,
+				    (UINT32)image->bytes_per_line, x, y, NULL, FREERDP_FLIP_NONE);
 			}
-
-			EnterCriticalSection(&surface->lock);
-			region16_clear(&(surface->invalidRegion));
 			LeaveCriticalSection(&surface->lock);
+			if (!success)
+				goto fail_capture;
+
+			x11_shadow_publish_frame(subsystem);
 		}
 	}
 
 	rc = 1;
 fail_capture:
+	region16_uninit(&invalidRegion);
 	if (!subsystem->use_xshm && image)
 		XDestroyImage(image);
 
@@ -938,9 +1089,19 @@ static DWORD WINAPI x11_shadow_subsystem_thread(LPVOID arg)
 
 	while (1)
 	{
-		cTime = GetTickCount64();
-		dwTimeout = (cTime > frameTime) ? 0 : frameTime - cTime;
-		status = WaitForMultipleObjects(nCount, events, FALSE, dwTimeout);
+		if (!shadow_subsystem_capture_wanted(&subsystem->common))
+		{
+			/* Nobody watches, sleep until a client shows the screen again */
+			events[nCount] = shadow_subsystem_capture_event(&subsystem->common);
+			status = WaitForMultipleObjects(nCount + 1, events, FALSE, INFINITE);
+			frameTime = GetTickCount64();
+		}
+		else
+		{
+			cTime = GetTickCount64();
+			dwTimeout = (cTime > frameTime) ? 0 : frameTime - cTime;
+			status = WaitForMultipleObjects(nCount, events, FALSE, dwTimeout);
+		}
 
 		if (WaitForSingleObject(MessageQueue_Event(MsgPipe->In), 0) == WAIT_OBJECT_0)
 		{
@@ -966,7 +1127,8 @@ static DWORD WINAPI x11_shadow_subsystem_thread(LPVOID arg)
 			XUnlockDisplay(subsystem->display);
 		}
 
-		if ((status == WAIT_TIMEOUT) || (GetTickCount64() > frameTime))
+		if (shadow_subsystem_capture_wanted(&subsystem->common) &&
+		    ((status == WAIT_TIMEOUT) || (GetTickCount64() > frameTime)))
 		{
 			x11_shadow_check_resize(subsystem);
 			x11_shadow_screen_grab(subsystem);
@@ -1082,8 +1244,10 @@ static int x11_shadow_xdamage_init(x11ShadowSubsystem* subsystem)
 		return -1;
 
 	subsystem->xdamage_notify_event = damage_event + XDamageNotify;
+	/* The damage is polled with every capture, one event to wake up is enough */
 	subsystem->xdamage =
-	    XDamageCreate(subsystem->display, subsystem->root_window, XDamageReportDeltaRectangles);
+	    XDamageCreate(subsystem->display, subsystem->root_window, XDamageReportNonEmpty);
+	subsystem->damageAll = TRUE;
 
 	if (!subsystem->xdamage)
 		return -1;
@@ -1382,6 +1546,10 @@ static int x11_shadow_subsystem_init(rdpShadowSubsystem* sub)
 			subsystem->use_xdamage = FALSE;
 	}
 
+	/* XShm only reads the damaged rects, without XDamage the screen is compared */
+	if (!subsystem->use_xdamage)
+		subsystem->use_xshm = FALSE;
+
 	if (!(subsystem->common.event =
 	          CreateFileDescriptorEvent(NULL, FALSE, FALSE, subsystem->xfds, WINPR_FD_READ)))
 		return -1;
@@ -1486,9 +1654,9 @@ static rdpShadowSubsystem* x11_shadow_subsystem_new(void)
 	subsystem->common.MouseEvent = x11_shadow_input_mouse_event;
 	subsystem->common.ExtendedMouseEvent = x11_shadow_input_extended_mouse_event;
 	subsystem->composite = FALSE;
-	subsystem->use_xshm = FALSE; /* temporarily disabled */
+	subsystem->use_xshm = TRUE;
 	subsystem->use_xfixes = TRUE;
-	subsystem->use_xdamage = FALSE;
+	subsystem->use_xdamage = TRUE;
 	subsystem->use_xinerama = TRUE;
 	return (rdpShadowSubsystem*)subsystem;
 }
@@ -95,6 +95,7 @@ struct x11_shadow_subsystem
 	Damage xdamage;
 	int xdamage_notify_event;
 	XserverRegion xdamage_region;
+	BOOL damageAll; /* the next capture reads the whole screen */
 #endif
 
 #ifdef WITH_XFIXES
@@ -72,6 +72,28 @@ int main(int argc, char** argv)
 		  "nla protocol security" },
 		{ "sec-ext", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
 		  "nla extended protocol security" },
+		{ "tls-kernel-offload", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Let the kernel encrypt sent TLS records if supported" },
+		{ "io-uring", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Use io_uring for the client connections if the kernel supports it" },
+		{ "send-queue", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Write to the clients from a sender thread, input and audio go ahead of other data" },
+		{ "tcp-notsent-lowat", COMMAND_LINE_VALUE_REQUIRED, "<bytes>", "0", NULL, -1, NULL,
+		  "Limit unsent data in the kernel to <bytes> (TCP_NOTSENT_LOWAT), 0 for no limit" },
+		{ "tcp-busy-poll", COMMAND_LINE_VALUE_REQUIRED, "<microseconds>", "0", NULL, -1, NULL,
+		  "Busy poll the network device for <microseconds> (SO_BUSY_POLL), 0 to disable" },
+		{ "tcp-buffers", COMMAND_LINE_VALUE_REQUIRED, "<sndbuf>[,<rcvbuf>]", NULL, NULL, -1, NULL,
+		  "Fixed socket buffer sizes in bytes, 0 for kernel autotuning" },
+		{ "tcp-adaptive-buffers", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Size the socket buffers from the bandwidth and round trip time measured by autodetect" },
+		{ "compression-effort", COMMAND_LINE_VALUE_REQUIRED, "<fast|normal|max>", "normal", NULL,
+		  -1, NULL, "Search effort of the RDP6 bulk compressor, more effort saves bandwidth" },
+		{ "dvc-compression", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Compress dynamic virtual channel data for clients supporting DRDYNVC version 3" },
+		{ "audio-bitrate", COMMAND_LINE_VALUE_REQUIRED, "<bits per second>", NULL, NULL, -1, NULL,
+		  "Bitrate of compressed (Opus, AAC) audio, 0 derives it from the format" },
+		{ "audio-complexity", COMMAND_LINE_VALUE_REQUIRED, "<0-10>", NULL, NULL, -1, NULL,
+		  "Encoder complexity of compressed audio, 0 keeps the encoder default" },
 		{ "sam-file", COMMAND_LINE_VALUE_REQUIRED, "<file>", NULL, NULL, -1, NULL,
 		  "NTLM SAM file for NLA authentication" },
 		{ "keytab", COMMAND_LINE_VALUE_REQUIRED, "<file>", NULL, NULL, -1, NULL,
@@ -95,6 +117,23 @@ int main(int argc, char** argv)
 		  "Allow GFX AVC420 codec" },
 		{ "gfx-avc444", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
 		  "Allow GFX AVC444 codec" },
+		{ "share-encoder", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Encode GFX RFX and planar frames once for all clients" },
+		{ "gfx-cache", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueTrue, NULL, -1, NULL,
+		  "Use GFX solid fills and the client bitmap cache for repeated tiles" },
+		{ "adaptive-codec", COMMAND_LINE_VALUE_BOOL, NULL, BoolValueFalse, NULL, -1, NULL,
+		  "Select GFX codec and H264 bitrate from measured bandwidth and latency" },
+		{ "stats-interval", COMMAND_LINE_VALUE_REQUIRED, "<seconds>", "0", NULL, -1, NULL,
+		  "Log per client encoder statistics every <seconds>, 0 to disable" },
+		{ "gfx-refine", COMMAND_LINE_VALUE_REQUIRED, "<ms>", "0", NULL, -1, NULL,
+		  "Resend H264 encoded regions losslessly after <ms> without changes, 0 to disable" },
+		{ "accept-threads", COMMAND_LINE_VALUE_REQUIRED, "<number>", "0", NULL, -1, NULL,
+		  "Accept connections on <number> SO_REUSEPORT sockets in parallel, 0 for one" },
+		{ "encode-depth", COMMAND_LINE_VALUE_REQUIRED, "<frames>", "0", NULL, -1, NULL,
+		  "Encode GFX frames on a separate thread with up to <frames> unacknowledged, 0 to "
+		  "disable" },
+		{ "codec-pool", COMMAND_LINE_VALUE_REQUIRED, "<contexts>", "8", NULL, -1, NULL,
+		  "Keep up to <contexts> codec contexts of closed connections for reuse, 0 to disable" },
 		{ "version", COMMAND_LINE_VALUE_FLAG | COMMAND_LINE_PRINT_VERSION, NULL, NULL, NULL, -1,
 		  NULL, "Print version" },
 		{ "buildconfig", COMMAND_LINE_VALUE_FLAG | COMMAND_LINE_PRINT_BUILDCONFIG, NULL, NULL, NULL,
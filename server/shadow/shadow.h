@@ -26,6 +26,9 @@
 #include "shadow_screen.h"
 #include "shadow_surface.h"
 #include "shadow_encoder.h"
+#include "shadow_shared_encoder.h"
+#include "shadow_codec_pool.h"
+#include "shadow_gfx_cache.h"
 #include "shadow_capture.h"
 #include "shadow_channels.h"
 #include "shadow_subsystem.h"
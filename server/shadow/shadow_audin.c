@@ -31,6 +31,56 @@
 
 #if defined(CHANNEL_AUDIN_SERVER)
 
+/* Subsystems get PCM, compressed formats like opus are decoded first */
+static BOOL shadow_audin_decode(rdpShadowClient* client, const AUDIO_FORMAT* format, wStream* data,
+                                AUDIO_FORMAT* pcm)
+{
+	WINPR_ASSERT(client);
+	WINPR_ASSERT(format);
+	WINPR_ASSERT(data);
+	WINPR_ASSERT(pcm);
+
+	/* The format is negotiated once per channel context */
+	if (!client->audinDsp)
+	{
+		client->audinDsp = freerdp_dsp_context_new(FALSE);
+		if (!client->audinDsp)
+			return FALSE;
+
+		if (!freerdp_dsp_context_reset(client->audinDsp, format, 0))
+		{
+			freerdp_dsp_context_free(client->audinDsp);
+			client->audinDsp = NULL;
+			return FALSE;
+		}
+	}
+
+	if (!client->audinSamples)
+	{
+		client->audinSamples = Stream_New(NULL, 4096);
+		if (!client->audinSamples)
+			return FALSE;
+	}
+
+	Stream_SetPosition(client->audinSamples, 0);
+	if (!freerdp_dsp_decode(client->audinDsp, format, Stream_Buffer(data), Stream_Length(data),
+	                        client->audinSamples))
+		return FALSE;
+
+	/* Same layout as the received data, the samples span the whole length */
+	Stream_SealLength(client->audinSamples);
+	Stream_SetPosition(client->audinSamples, 0);
+
+	*pcm = *format;
+	pcm->wFormatTag = WAVE_FORMAT_PCM;
+	pcm->wBitsPerSample = 16;
+	pcm->nBlockAlign = 2 * pcm->nChannels;
+	pcm->nAvgBytesPerSec = pcm->nBlockAlign * pcm->nSamplesPerSec;
+	pcm->cbSize = 0;
+	pcm->data = NULL;
+	return TRUE;
+}
+
 static UINT AudinServerData(audin_server_context* audin, const SNDIN_DATA* data)
 {
 	rdpShadowClient* client = NULL;
@@ -48,8 +98,23 @@ static UINT AudinServerData(audin_server_context* audin, const SNDIN_DATA* data)
 	if (!client->mayInteract)
 		return CHANNEL_RC_OK;
 
-	if (!IFCALLRESULT(TRUE, subsystem->AudinServerReceiveSamples, subsystem, client,
-	                  audin_server_get_negotiated_format(client->audin), data->Data))
+	const AUDIO_FORMAT* format = audin_server_get_negotiated_format(client->audin);
+	wStream* samples = data->Data;
+	AUDIO_FORMAT pcm = { 0 };
+
+	if (!subsystem->AudinServerReceiveSamples)
+		return CHANNEL_RC_OK;
+
+	if (format && (format->wFormatTag != WAVE_FORMAT_PCM))
+	{
+		if (!shadow_audin_decode(client, format, samples, &pcm))
+			return ERROR_INTERNAL_ERROR;
+
+		format = &pcm;
+		samples = client->audinSamples;
+	}
+
+	if (!subsystem->AudinServerReceiveSamples(subsystem, client, format, samples))
 		return ERROR_INTERNAL_ERROR;
 
 	return CHANNEL_RC_OK;
@@ -102,4 +167,8 @@ void shadow_client_audin_uninit(rdpShadowClient* client)
 	audin_server_context_free(client->audin);
 	client->audin = NULL;
 #endif
+	freerdp_dsp_context_free(client->audinDsp);
+	client->audinDsp = NULL;
+	Stream_Free(client->audinSamples, TRUE);
+	client->audinSamples = NULL;
 }
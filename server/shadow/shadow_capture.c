@@ -21,6 +21,14 @@
 #include <winpr/crt.h>
 #include <winpr/print.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include <freerdp/log.h>
 
 #include "shadow_surface.h"
@@ -84,47 +92,6 @@ int shadow_capture_compare(const BYTE* WINPR_RESTRICT pData1, UINT32 nStep1, UIN
 	                                          pData2, PIXEL_FORMAT_BGRX32, nStep2, rect);
 }
 
-static BOOL color_equal(UINT32 colorA, UINT32 formatA, UINT32 colorB, UINT32 formatB)
-{
-	BYTE ar = 0;
-	BYTE ag = 0;
-	BYTE ab = 0;
-	BYTE aa = 0;
-	BYTE br = 0;
-	BYTE bg = 0;
-	BYTE bb = 0;
-	BYTE ba = 0;
-	FreeRDPSplitColor(colorA, formatA, &ar, &ag, &ab, &aa, NULL);
-	FreeRDPSplitColor(colorB, formatB, &br, &bg, &bb, &ba, NULL);
-
-	if (ar != br)
-		return FALSE;
-	if (ag != bg)
-		return FALSE;
-	if (ab != bb)
-		return FALSE;
-	if (aa != ba)
-		return FALSE;
-	return TRUE;
-}
-
-static BOOL pixel_equal(const BYTE* WINPR_RESTRICT a, UINT32 formatA, const BYTE* WINPR_RESTRICT b,
-                        UINT32 formatB, size_t count)
-{
-	const size_t bppA = FreeRDPGetBytesPerPixel(formatA);
-	const size_t bppB = FreeRDPGetBytesPerPixel(formatB);
-
-	for (size_t x = 0; x < count; x++)
-	{
-		const UINT32 colorA = FreeRDPReadColor(&a[bppA * x], formatA);
-		const UINT32 colorB = FreeRDPReadColor(&b[bppB * x], formatB);
-		if (!color_equal(colorA, formatA, colorB, formatB))
-			return FALSE;
-	}
-
-	return TRUE;
-}
-
 static BOOL color_equal_no_alpha(UINT32 colorA, UINT32 formatA, UINT32 colorB, UINT32 formatB)
 {
 	BYTE ar = 0;
@@ -171,69 +138,168 @@ static BOOL pixel_equal_same_format(const BYTE* WINPR_RESTRICT a, UINT32 formatA
 	return memcmp(a, b, count * bppA) == 0;
 }
 
+/* Compare count 32bpp pixels, only the bits set in mask are significant */
+static BOOL pixel_equal_32bpp_masked(const BYTE* WINPR_RESTRICT a, const BYTE* WINPR_RESTRICT b,
+                                     size_t count, UINT32 mask)
+{
+	size_t x = 0;
+
+#if defined(__AVX2__)
+	{
+		const __m256i m = _mm256_set1_epi32((int)mask);
+		__m256i acc = _mm256_setzero_si256();
+
+		for (; x + 8 <= count; x += 8)
+		{
+			const __m256i va = _mm256_loadu_si256((const __m256i*)&a[4 * x]);
+			const __m256i vb = _mm256_loadu_si256((const __m256i*)&b[4 * x]);
+			acc = _mm256_or_si256(acc, _mm256_xor_si256(va, vb));
+		}
+
+		if (!_mm256_testz_si256(acc, m))
+			return FALSE;
+	}
+#endif
+#if defined(__SSE2__)
+	{
+		const __m128i m = _mm_set1_epi32((int)mask);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i acc = zero;
+
+		for (; x + 4 <= count; x += 4)
+		{
+			const __m128i va = _mm_loadu_si128((const __m128i*)&a[4 * x]);
+			const __m128i vb = _mm_loadu_si128((const __m128i*)&b[4 * x]);
+			acc = _mm_or_si128(acc, _mm_xor_si128(va, vb));
+		}
+
+		acc = _mm_and_si128(acc, m);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF)
+			return FALSE;
+	}
+#elif defined(__ARM_NEON)
+	{
+		uint32x4_t acc = vdupq_n_u32(0);
+
+		for (; x + 4 <= count; x += 4)
+		{
+			const uint32x4_t va = vreinterpretq_u32_u8(vld1q_u8(&a[4 * x]));
+			const uint32x4_t vb = vreinterpretq_u32_u8(vld1q_u8(&b[4 * x]));
+			acc = vorrq_u32(acc, veorq_u32(va, vb));
+		}
+
+		acc = vandq_u32(acc, vdupq_n_u32(mask));
+		const uint32x2_t r = vorr_u32(vget_low_u32(acc), vget_high_u32(acc));
+		if ((vget_lane_u32(r, 0) | vget_lane_u32(r, 1)) != 0)
+			return FALSE;
+	}
+#endif
+
+	for (; x < count; x++)
+	{
+		UINT32 va = 0;
+		UINT32 vb = 0;
+		memcpy(&va, &a[4 * x], sizeof(va));
+		memcpy(&vb, &b[4 * x], sizeof(vb));
+		if (((va ^ vb) & mask) != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
 typedef BOOL (*pixel_equal_fn_t)(const BYTE* WINPR_RESTRICT a, UINT32 formatA,
                                  const BYTE* WINPR_RESTRICT b, UINT32 formatB, size_t count);
 
-static pixel_equal_fn_t get_comparison_fn(DWORD format1, DWORD format2)
+typedef struct
 {
+	pixel_equal_fn_t fn;
+	BOOL masked;
+	UINT32 mask;
+	UINT32 format1;
+	UINT32 format2;
+} pixel_compare_t;
+
+/* The bits of a 32bpp pixel in memory order that are not alpha */
+static UINT32 get_color_mask(DWORD format)
+{
+	BYTE alpha[4] = { 0 };
+	UINT32 mask = 0;
 
-	if (format1 == format2)
-		return pixel_equal_same_format;
+	if (!FreeRDPWriteColor(alpha, format, FreeRDPGetColor(format, 0, 0, 0, 0xFF)))
+		return UINT32_MAX;
+
+	memcpy(&mask, alpha, sizeof(mask));
+	return ~mask;
+}
 
+static pixel_compare_t get_comparison_fn(DWORD format1, DWORD format2)
+{
+	pixel_compare_t cmp = { 0 };
 	const UINT32 bpp1 = FreeRDPGetBitsPerPixel(format1);
 
-	if (!FreeRDPColorHasAlpha(format1) || !FreeRDPColorHasAlpha(format2))
+	cmp.format1 = format1;
+	cmp.format2 = format2;
+
+	if (format1 == format2)
 	{
-		/* In case we have RGBA32 and RGBX32 or similar assume the alpha data is equal.
-		 * This allows us to use the fast memcmp comparison. */
-		if ((bpp1 == 32) && FreeRDPAreColorFormatsEqualNoAlpha(format1, format2))
+		cmp.fn = pixel_equal_same_format;
+		if (bpp1 == 32)
 		{
-			switch (format1)
-			{
-				case PIXEL_FORMAT_ARGB32:
-				case PIXEL_FORMAT_XRGB32:
-				case PIXEL_FORMAT_ABGR32:
-				case PIXEL_FORMAT_XBGR32:
-					return pixel_equal;
-				case PIXEL_FORMAT_RGBA32:
-				case PIXEL_FORMAT_RGBX32:
-				case PIXEL_FORMAT_BGRA32:
-				case PIXEL_FORMAT_BGRX32:
-					return pixel_equal;
-				default:
-					break;
-			}
+			cmp.masked = TRUE;
+			cmp.mask = UINT32_MAX;
 		}
-		return pixel_equal_no_alpha;
+		return cmp;
+	}
+
+	cmp.fn = pixel_equal_no_alpha;
+
+	/* In case we have RGBA32 and RGBX32 or similar only compare the color channels.
+	 * This allows us to use the fast vectorized comparison. */
+	if ((bpp1 == 32) && FreeRDPAreColorFormatsEqualNoAlpha(format1, format2))
+	{
+		cmp.masked = TRUE;
+		cmp.mask = get_color_mask(format1) & get_color_mask(format2);
 	}
-	else
-		return pixel_equal_no_alpha;
+
+	return cmp;
 }
 
-int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32 format1,
-                                       UINT32 nStep1, UINT32 nWidth, UINT32 nHeight,
-                                       const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
-                                       UINT32 nStep2, RECTANGLE_16* WINPR_RESTRICT rect)
+static BOOL tile_equal(const pixel_compare_t* WINPR_RESTRICT cmp, const BYTE* WINPR_RESTRICT p1,
+                       UINT32 nStep1, const BYTE* WINPR_RESTRICT p2, UINT32 nStep2, size_t tw,
+                       size_t th)
 {
-	pixel_equal_fn_t pixel_equal_fn = get_comparison_fn(format1, format2);
-	BOOL allEqual = TRUE;
-	UINT32 tw = 0;
-	const UINT32 nrow = (nHeight + 15) / 16;
-	const UINT32 ncol = (nWidth + 15) / 16;
-	UINT32 l = ncol + 1;
-	UINT32 t = nrow + 1;
-	UINT32 r = 0;
-	UINT32 b = 0;
+	for (size_t k = 0; k < th; k++)
+	{
+		if (cmp->masked)
+		{
+			if (!pixel_equal_32bpp_masked(p1, p2, tw, cmp->mask))
+				return FALSE;
+		}
+		else if (!cmp->fn(p1, cmp->format1, p2, cmp->format2, tw))
+			return FALSE;
+
+		p1 += nStep1;
+		p2 += nStep2;
+	}
+
+	return TRUE;
+}
+
+/* Fill dirty with one entry per 16x16 tile, row by row, return the number of dirty tiles */
+static size_t compare_tiles(const BYTE* WINPR_RESTRICT pData1, UINT32 format1, UINT32 nStep1,
+                            UINT32 nWidth, UINT32 nHeight, const BYTE* WINPR_RESTRICT pData2,
+                            UINT32 format2, UINT32 nStep2, BYTE* WINPR_RESTRICT dirty)
+{
+	const pixel_compare_t cmp = get_comparison_fn(format1, format2);
+	const size_t nrow = (nHeight + 15) / 16;
+	const size_t ncol = (nWidth + 15) / 16;
 	const size_t bppA = FreeRDPGetBytesPerPixel(format1);
 	const size_t bppB = FreeRDPGetBytesPerPixel(format2);
-	const RECTANGLE_16 empty = { 0 };
-	WINPR_ASSERT(rect);
-
-	*rect = empty;
+	size_t count = 0;
 
 	for (size_t ty = 0; ty < nrow; ty++)
 	{
-		BOOL rowEqual = TRUE;
 		size_t th = ((ty + 1) == nrow) ? (nHeight % 16) : 16;
 
 		if (!th)
@@ -241,61 +307,77 @@ int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32
 
 		for (size_t tx = 0; tx < ncol; tx++)
 		{
-			BOOL equal = TRUE;
-			tw = ((tx + 1) == ncol) ? (nWidth % 16) : 16;
+			size_t tw = ((tx + 1) == ncol) ? (nWidth % 16) : 16;
 
 			if (!tw)
 				tw = 16;
 
 			const BYTE* p1 = &pData1[(ty * 16 * nStep1) + (tx * 16ull * bppA)];
 			const BYTE* p2 = &pData2[(ty * 16 * nStep2) + (tx * 16ull * bppB)];
+			const BOOL equal = tile_equal(&cmp, p1, nStep1, p2, nStep2, tw, th);
 
-			for (size_t k = 0; k < th; k++)
-			{
-				if (!pixel_equal_fn(p1, format1, p2, format2, tw))
-				{
-					equal = FALSE;
-					break;
-				}
-
-				p1 += nStep1;
-				p2 += nStep2;
-			}
-
+			dirty[ty * ncol + tx] = equal ? 0 : 1;
 			if (!equal)
-			{
-				rowEqual = FALSE;
-				if (l > tx)
-					l = tx;
-
-				if (r < tx)
-					r = tx;
-			}
+				count++;
 		}
+	}
 
-		if (!rowEqual)
-		{
-			allEqual = FALSE;
+	return count;
+}
 
-			if (t > ty)
-				t = ty;
+int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32 format1,
+                                       UINT32 nStep1, UINT32 nWidth, UINT32 nHeight,
+                                       const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
+                                       UINT32 nStep2, RECTANGLE_16* WINPR_RESTRICT rect)
+{
+	const size_t nrow = (nHeight + 15) / 16;
+	const size_t ncol = (nWidth + 15) / 16;
+	size_t l = ncol + 1;
+	size_t t = nrow + 1;
+	size_t r = 0;
+	size_t b = 0;
+	const RECTANGLE_16 empty = { 0 };
+	WINPR_ASSERT(rect);
 
-			if (b < ty)
-				b = ty;
-		}
-	}
+	*rect = empty;
 
-	if (allEqual)
+	if ((nrow == 0) || (ncol == 0))
 		return 0;
 
+	BYTE* dirty = calloc(nrow * ncol, sizeof(BYTE));
+	if (!dirty)
+		return -1;
+
+	if (compare_tiles(pData1, format1, nStep1, nWidth, nHeight, pData2, format2, nStep2,
+	                  dirty) == 0)
+	{
+		free(dirty);
+		return 0;
+	}
+
+	for (size_t ty = 0; ty < nrow; ty++)
+	{
+		for (size_t tx = 0; tx < ncol; tx++)
+		{
+			if (!dirty[ty * ncol + tx])
+				continue;
+
+			l = MIN(l, tx);
+			r = MAX(r, tx);
+			t = MIN(t, ty);
+			b = MAX(b, ty);
+		}
+	}
+	free(dirty);
+
 	WINPR_ASSERT(l * 16 <= UINT16_MAX);
 	WINPR_ASSERT(t * 16 <= UINT16_MAX);
 	WINPR_ASSERT((r + 1) * 16 <= UINT16_MAX);
 	WINPR_ASSERT((b + 1) * 16 <= UINT16_MAX);
-	rect->left = (UINT16)l * 16;
-	rect->top = (UINT16)t * 16;
-	rect->right = (UINT16)(r + 1) * 16;
-	rect->bottom = (UINT16)(b + 1) * 16;
+	rect->left = (UINT16)(l * 16);
+	rect->top = (UINT16)(t * 16);
+	rect->right = (UINT16)((r + 1) * 16);
+	rect->bottom = (UINT16)((b + 1) * 16);
 
 	WINPR_ASSERT(nWidth <= UINT16_MAX);
 	if (rect->right > nWidth)
@@ -308,6 +390,215 @@ int shadow_capture_compare_with_format(const BYTE* WINPR_RESTRICT pData1, UINT32
 	return 1;
 }
 
+int shadow_capture_compare_region(const BYTE* WINPR_RESTRICT pData1, UINT32 format1, UINT32 nStep1,
+                                  UINT32 nWidth, UINT32 nHeight,
+                                  const BYTE* WINPR_RESTRICT pData2, UINT32 format2,
+                                  UINT32 nStep2, REGION16* WINPR_RESTRICT region)
+{
+	int rc = -1;
+	RECTANGLE_16* rects = NULL;
+	UINT32 nbRects = 0;
+	const size_t nrow = (nHeight + 15) / 16;
+	const size_t ncol = (nWidth + 15) / 16;
+	WINPR_ASSERT(region);
+
+	region16_clear(region);
+
+	if ((nrow == 0) || (ncol == 0))
+		return 0;
+
+	if ((nWidth > UINT16_MAX) || (nHeight > UINT16_MAX))
+		return -1;
+
+	BYTE* dirty = calloc(nrow * ncol, sizeof(BYTE));
+	if (!dirty)
+		return -1;
+
+	if (compare_tiles(pData1, format1, nStep1, nWidth, nHeight, pData2, format2, nStep2,
+	                  dirty) == 0)
+	{
+		rc = 0;
+		goto fail;
+	}
+
+	/* at most every other tile of a row starts a run */
+	rects = calloc(nrow * ((ncol + 1) / 2), sizeof(RECTANGLE_16));
+	if (!rects)
+		goto fail;
+
+	for (size_t ty = 0; ty < nrow; ty++)
+	{
+		for (size_t tx = 0; tx < ncol; tx++)
+		{
+			if (!dirty[ty * ncol + tx])
+				continue;
+
+			/* Merge horizontal runs of dirty tiles into one rectangle */
+			size_t end = tx + 1;
+			while ((end < ncol) && dirty[ty * ncol + end])
+				end++;
+
+			const RECTANGLE_16 rect = { (UINT16)(tx * 16), (UINT16)(ty * 16),
+				                        (UINT16)MIN(end * 16, nWidth),
+				                        (UINT16)MIN((ty + 1) * 16, nHeight) };
+			rects[nbRects++] = rect;
+			tx = end;
+		}
+	}
+
+	/* building the region in one go avoids rebuilding the bands per tile run */
+	if (!region16_union_rects(region, region, rects, nbRects))
+		goto fail;
+
+	rc = 1;
+fail:
+	free(rects);
+	free(dirty);
+	return rc;
+}
+
+/* Anchors per band used to vote for the shift, enough for a clear majority */
+#define SHADOW_MOTION_ANCHORS 16
+
+static void motion_vote(const UINT64* WINPR_RESTRICT prev, const UINT64* WINPR_RESTRICT cur,
+                        UINT32 length, UINT32* WINPR_RESTRICT votes)
+{
+	const UINT32 step = MAX(1, length / (2 * SHADOW_MOTION_ANCHORS));
+	UINT32 anchors = 0;
+
+	for (UINT32 y = 1; (y < length) && (anchors < SHADOW_MOTION_ANCHORS); y += step)
+	{
+		/* Unchanged and repeated lines match at many shifts, skip them */
+		if ((cur[y] == prev[y]) || (cur[y] == cur[y - 1]))
+			continue;
+
+		UINT32 matches = 0;
+		for (UINT32 x = 0; (x < length) && (matches < 4); x++)
+		{
+			if (prev[x] == cur[y])
+			{
+				votes[length + y - x]++;
+				matches++;
+			}
+		}
+		anchors++;
+	}
+}
+
+static void motion_run(const UINT64* WINPR_RESTRICT prev, const UINT64* WINPR_RESTRICT cur,
+                       UINT32 length, INT32 shift, UINT32* WINPR_RESTRICT start,
+                       UINT32* WINPR_RESTRICT end)
+{
+	const UINT32 first = (shift > 0) ? (UINT32)shift : 0;
+	const UINT32 last = (shift < 0) ? length - (UINT32)-shift : length;
+	UINT32 runStart = first;
+
+	*start = 0;
+	*end = 0;
+
+	for (UINT32 y = first; y <= last; y++)
+	{
+		if ((y < last) && (cur[y] == prev[(INT64)y - shift]))
+			continue;
+
+		if (y - runStart > *end - *start)
+		{
+			*start = runStart;
+			*end = y;
+		}
+		runStart = y + 1;
+	}
+}
+
+BOOL shadow_capture_detect_motion(const UINT64* WINPR_RESTRICT prev,
+                                  const UINT64* WINPR_RESTRICT cur, UINT32 bands, UINT32 length,
+                                  UINT32 minLength, SHADOW_CAPTURE_MOTION* WINPR_RESTRICT motion)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(prev);
+	WINPR_ASSERT(cur);
+	WINPR_ASSERT(motion);
+
+	if ((bands == 0) || (length < 2) || (length > INT32_MAX))
+		return FALSE;
+
+	UINT32* votes = calloc(2ULL * length, sizeof(UINT32));
+	UINT32* starts = calloc(bands, sizeof(UINT32));
+	UINT32* ends = calloc(bands, sizeof(UINT32));
+	if (!votes || !starts || !ends)
+		goto fail;
+
+	for (UINT32 b = 0; b < bands; b++)
+		motion_vote(&prev[1ULL * b * length], &cur[1ULL * b * length], length, votes);
+
+	/* The dominant shift, there is usually only one window scrolling at a time */
+	UINT32 best = length;
+	for (UINT32 x = 1; x < 2 * length; x++)
+	{
+		if ((x != length) && (votes[x] > votes[best]))
+			best = x;
+	}
+
+	if (votes[best] < 4)
+		goto fail;
+
+	const INT32 shift = (INT32)best - (INT32)length;
+
+	for (UINT32 b = 0; b < bands; b++)
+		motion_run(&prev[1ULL * b * length], &cur[1ULL * b * length], length, shift, &starts[b],
+		           &ends[b]);
+
+	/* Largest block of adjacent bands sharing a long enough run */
+	UINT64 area = 0;
+	for (UINT32 b0 = 0; b0 < bands; b0++)
+	{
+		UINT32 start = starts[b0];
+		UINT32 end = ends[b0];
+
+		for (UINT32 b1 = b0; b1 < bands; b1++)
+		{
+			start = MAX(start, starts[b1]);
+			end = MIN(end, ends[b1]);
+			if ((end <= start) || (end - start < minLength))
+				break;
+
+			const UINT64 blockArea = 1ULL * (b1 - b0 + 1) * (end - start);
+			if (blockArea > area)
+			{
+				area = blockArea;
+				motion->firstBand = b0;
+				motion->lastBand = b1 + 1;
+				motion->start = start;
+				motion->end = end;
+				motion->shift = shift;
+			}
+		}
+	}
+
+	if (area == 0)
+		goto fail;
+
+	/* Moving content that did not change is pointless */
+	for (UINT32 b = motion->firstBand; (b < motion->lastBand) && !rc; b++)
+	{
+		for (UINT32 y = motion->start; y < motion->end; y++)
+		{
+			if (cur[1ULL * b * length + y] != prev[1ULL * b * length + y])
+			{
+				rc = TRUE;
+				break;
+			}
+		}
+	}
+
+fail:
+	free(votes);
+	free(starts);
+	free(ends);
+	return rc;
+}
+
 rdpShadowCapture* shadow_capture_new(rdpShadowServer* server)
 {
 	WINPR_ASSERT(server);
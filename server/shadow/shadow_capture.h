@@ -35,6 +35,16 @@ struct rdp_shadow_capture
 	CRITICAL_SECTION lock;
 };
 
+/** A block of content that moved along one axis between two frames */
+typedef struct
+{
+	UINT32 firstBand; /* first band, inclusive */
+	UINT32 lastBand;  /* last band, exclusive */
+	UINT32 start;     /* first position in the current frame, inclusive */
+	UINT32 end;       /* last position in the current frame, exclusive */
+	INT32 shift;      /* current position minus previous position */
+} SHADOW_CAPTURE_MOTION;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -45,6 +55,14 @@ extern "C"
 	WINPR_ATTR_MALLOC(shadow_capture_free, 1)
 	rdpShadowCapture* shadow_capture_new(rdpShadowServer* server);
 
+	/* Find the largest block shifted along the band direction between two frames.
+	 * Frames are given as line hashes, key[band * length + position], e.g. the hashes of
+	 * the rows of every 64 pixel wide column band for vertical scrolling. */
+	BOOL shadow_capture_detect_motion(const UINT64* WINPR_RESTRICT prev,
+	                                  const UINT64* WINPR_RESTRICT cur, UINT32 bands,
+	                                  UINT32 length, UINT32 minLength,
+	                                  SHADOW_CAPTURE_MOTION* WINPR_RESTRICT motion);
+
 #ifdef __cplusplus
 }
 #endif
@@ -24,24 +24,46 @@
 #include <winpr/assert.h>
 #include <winpr/file.h>
 #include <winpr/path.h>
+#include <winpr/pool.h>
 #include <winpr/synch.h>
 #include <winpr/thread.h>
 #include <winpr/sysinfo.h>
 #include <winpr/interlocked.h>
 
 #include <freerdp/log.h>
+#include <freerdp/autodetect.h>
 #include <freerdp/channels/drdynvc.h>
 
 #include "shadow.h"
+#include "shadow_pipeline.h"
 
 #define TAG CLIENT_TAG("shadow")
 
+/* Poll interval in ms while a frame waits for the output buffer to drain */
+#define SHADOW_CLIENT_DRAIN_INTERVAL 10
+
+/* Unacknowledged frames older than this (ms) no longer hold back the encode pipeline */
+#define SHADOW_CLIENT_ACK_TIMEOUT 1000
+
 typedef struct
 {
 	BOOL gfxOpened;
 	BOOL gfxSurfaceCreated;
 } SHADOW_GFX_STATUS;
 
+/**
+ * GFX frames are encoded on a per client thread while the client thread keeps
+ * sending the previous frame and serving input. The encoder queues its output on
+ * the virtual channel manager, the client thread writes it to the connection.
+ * The encoder state belongs to the encode thread while the worker is busy.
+ */
+typedef struct
+{
+	rdpShadowClient* client;
+	SHADOW_GFX_STATUS* gfxstatus;
+	SHADOW_PIPELINE worker;
+} SHADOW_CLIENT_PIPELINE;
+
 /* See https://github.com/FreeRDP/FreeRDP/issues/10413
  *
  * Microsoft ditched support for RFX and multiple rectangles in BitmapUpdate for
@@ -275,6 +297,9 @@ static BOOL shadow_client_context_new(freerdp_peer* peer, rdpContext* context)
 		return FALSE;
 	if (!freerdp_settings_set_uint32(settings, FreeRDP_CompressionLevel, PACKET_COMPR_TYPE_RDP8))
 		return FALSE;
+	if (server->adaptiveCodec &&
+	    !freerdp_settings_set_bool(settings, FreeRDP_NetworkAutoDetect, TRUE))
+		return FALSE;
 
 	if (server->ipcSocket && (strncmp(bind_address, server->ipcSocket,
 	                                  strnlen(bind_address, sizeof(bind_address))) != 0))
@@ -298,7 +323,8 @@ static BOOL shadow_client_context_new(freerdp_peer* peer, rdpContext* context)
 	if (!client->vcm || client->vcm == INVALID_HANDLE_VALUE)
 		goto fail;
 
-	if (!(client->MsgQueue = MessageQueue_New(&cb)))
+	/* drained by shadow_client_thread only, posted to from the server and subsystem */
+	if (!(client->MsgQueue = MessageQueue_NewEx(&cb, WMQ_FLAG_SINGLE_CONSUMER)))
 		goto fail;
 
 	if (!(client->encoder = shadow_encoder_new(client)))
@@ -331,10 +357,7 @@ static INLINE void shadow_client_mark_invalid(rdpShadowClient* client, UINT32 nu
 	/* Mark client invalid region. No rectangle means full screen */
 	if (numRects > 0)
 	{
-		for (UINT32 index = 0; index < numRects; index++)
-		{
-			region16_union_rect(&(client->invalidRegion), &(client->invalidRegion), &rects[index]);
-		}
+		region16_union_rects(&(client->invalidRegion), &(client->invalidRegion), rects, numRects);
 	}
 	else
 	{
@@ -594,6 +617,22 @@ static INLINE void shadow_client_convert_rects(rdpShadowClient* client, RECTANGL
 	}
 }
 
+/* Only clients showing the screen keep the capture running, the lobby has its own surface */
+static void shadow_client_update_capture(rdpShadowClient* client)
+{
+	WINPR_ASSERT(client);
+
+	const BOOL consumer = client->activated && !client->suppressOutput && !client->inLobby;
+	if (consumer == client->captureConsumer)
+		return;
+
+	client->captureConsumer = consumer;
+	if (consumer)
+		shadow_subsystem_capture_acquire(client->subsystem);
+	else
+		shadow_subsystem_capture_release(client->subsystem);
+}
+
 static BOOL shadow_client_refresh_request(rdpShadowClient* client)
 {
 	wMessage message = { 0 };
@@ -651,6 +690,7 @@ static BOOL shadow_client_suppress_output(rdpContext* context, BYTE allow, const
 	WINPR_ASSERT(client);
 
 	client->suppressOutput = allow ? FALSE : TRUE;
+	shadow_client_update_capture(client);
 
 	if (allow)
 	{
@@ -688,6 +728,7 @@ static BOOL shadow_client_activate(freerdp_peer* peer)
 	shadow_reset_desktop_resize(client);
 	client->activated = TRUE;
 	client->inLobby = client->mayView ? FALSE : TRUE;
+	shadow_client_update_capture(client);
 
 	if (shadow_encoder_reset(client->encoder) < 0)
 	{
@@ -781,7 +822,30 @@ static INLINE void shadow_client_common_frame_acknowledge(rdpShadowClient* clien
 	 */
 	WINPR_ASSERT(client);
 	WINPR_ASSERT(client->encoder);
-	client->encoder->lastAckframeId = frameId;
+	shadow_encoder_frame_acknowledged(client->encoder, frameId);
+}
+
+static BOOL shadow_client_bandwidth_measure_results(rdpAutoDetect* autodetect,
+                                                    RDP_TRANSPORT_TYPE transport,
+                                                    UINT16 sequenceNumber, UINT16 responseType,
+                                                    UINT32 timeDelta, UINT32 byteCount)
+{
+	WINPR_UNUSED(transport);
+	WINPR_UNUSED(sequenceNumber);
+	WINPR_UNUSED(responseType);
+	WINPR_ASSERT(autodetect);
+
+	rdpShadowClient* client = (rdpShadowClient*)autodetect->context;
+	WINPR_ASSERT(client);
+
+	/* Too short measurements are dominated by timer resolution */
+	if (!client->encoder || (timeDelta < 10))
+		return TRUE;
+
+	/* bytes per millisecond * 8 = kbit/s */
+	shadow_encoder_set_bandwidth(client->encoder,
+	                             (UINT32)MIN(8ULL * byteCount / timeDelta, UINT32_MAX));
+	return TRUE;
 }
 
 static BOOL shadow_client_surface_frame_acknowledge(rdpContext* context, UINT32 frameId)
@@ -1115,60 +1179,376 @@ static INLINE UINT32 rdpgfx_estimate_h264_avc420(RDPGFX_AVC420_BITMAP_STREAM* ha
 	       havc420->length;
 }
 
-/**
- * Function description
- *
- * @return TRUE on success
- */
-static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE* pSrcData,
-                                           UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nXSrc,
-                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight)
+#ifdef WITH_GFX_H264
+/* Let the subsystem write the frame straight into the encoder input, skipping the RGB surface
+ * and the color conversion in avc420_compress. */
+static INT32 shadow_client_avc420_compress_yuv(rdpShadowSubsystem* subsystem, H264_CONTEXT* h264,
+                                               UINT32 nWidth, UINT32 nHeight,
+                                               const RECTANGLE_16* regionRect,
+                                               RDPGFX_AVC420_BITMAP_STREAM* avc420)
 {
-	UINT32 id = 0;
-	UINT error = CHANNEL_RC_OK;
-	const rdpContext* context = (const rdpContext*)client;
-	const rdpSettings* settings = NULL;
-	rdpShadowEncoder* encoder = NULL;
-	RDPGFX_SURFACE_COMMAND cmd = { 0 };
-	RDPGFX_START_FRAME_PDU cmdstart = { 0 };
-	RDPGFX_END_FRAME_PDU cmdend = { 0 };
-	SYSTEMTIME sTime = { 0 };
+	BYTE* pYUVData[3] = { 0 };
+	UINT32 stride[3] = { 0 };
 
-	if (!context || !pSrcData)
-		return FALSE;
+	WINPR_ASSERT(subsystem);
+	WINPR_ASSERT(subsystem->GetYUV420Frame);
+	WINPR_ASSERT(avc420);
 
-	settings = context->settings;
-	encoder = client->encoder;
+	if (h264_get_yuv_buffer(h264, 0, nWidth, nHeight, pYUVData, stride) < 0)
+		return -1;
 
-	if (!settings || !encoder)
+	if (!subsystem->GetYUV420Frame(subsystem, regionRect, pYUVData, stride))
+	{
+		WLog_ERR(TAG, "GetYUV420Frame failed");
+		return -1;
+	}
+
+	return avc420_compress_yuv(h264, regionRect, &avc420->data, &avc420->length, &avc420->meta);
+}
+#endif
+
+typedef struct
+{
+	rdpShadowEncoder* encoder;
+	const BYTE* pSrcData;
+	UINT32 nSrcStep;
+	UINT32 SrcFormat;
+	UINT32 nWidth;
+	UINT32 nHeight;
+	RECTANGLE_16 rect;
+	const REGION16* region; /* optional, the parts of rect to encode */
+	BOOL shared;            /* the bitstream may be sent to other clients as well */
+} SHADOW_GFX_ENCODE;
+
+static BOOL shadow_client_encode_gfx_rfx(void* ctx, BYTE** ppData, UINT32* pLength)
+{
+	SHADOW_GFX_ENCODE* args = ctx;
+	WINPR_ASSERT(args);
+
+	UINT32 numRects = 1;
+	RFX_RECT rect = { args->rect.left, args->rect.top, args->rect.right - args->rect.left,
+		              args->rect.bottom - args->rect.top };
+	RFX_RECT* rects = &rect;
+
+	if (args->region)
+	{
+		const RECTANGLE_16* regionRects = region16_rects(args->region, &numRects);
+		rects = (RFX_RECT*)calloc(MAX(1, numRects), sizeof(RFX_RECT));
+		if (!rects)
+			return FALSE;
+
+		for (UINT32 x = 0; x < numRects; x++)
+		{
+			rects[x].x = regionRects[x].left;
+			rects[x].y = regionRects[x].top;
+			rects[x].width = regionRects[x].right - regionRects[x].left;
+			rects[x].height = regionRects[x].bottom - regionRects[x].top;
+		}
+	}
+
+	wStream* s = Stream_New(NULL, 1024);
+	if (!s)
+		goto fail;
+
+	const rdpShadowEncoder* encoder = args->encoder;
+	const BOOL composed =
+	    args->shared
+	        ? shadow_shared_encoder_compose_rfx(encoder->rfx, encoder->width, encoder->height, s,
+	                                            rects, numRects, args->pSrcData, args->nWidth,
+	                                            args->nHeight, args->nSrcStep)
+	        : rfx_compose_message(encoder->rfx, s, rects, numRects, args->pSrcData, args->nWidth,
+	                              args->nHeight, args->nSrcStep);
+	if (!composed)
+	{
+		WLog_ERR(TAG, "rfx_compose_message failed");
+		goto fail;
+	}
+
+	if (rects != &rect)
+		free(rects);
+
+	const size_t pos = Stream_GetPosition(s);
+	WINPR_ASSERT(pos <= UINT32_MAX);
+	*ppData = Stream_Buffer(s);
+	*pLength = (UINT32)pos;
+	Stream_Free(s, FALSE);
+	return TRUE;
+
+fail:
+	if (rects != &rect)
+		free(rects);
+	Stream_Free(s, TRUE);
+	return FALSE;
+}
+
+typedef struct
+{
+	BITMAP_PLANAR_CONTEXT* planar;
+	const BYTE* pSrcData;
+	UINT32 SrcFormat;
+	UINT32 nSrcStep;
+	RECTANGLE_16 rect;
+	BYTE* data;
+	UINT32 length;
+} SHADOW_GFX_BAND;
+
+static BOOL shadow_client_encode_gfx_band(SHADOW_GFX_BAND* band)
+{
+	WINPR_ASSERT(band);
+
+	const UINT32 w = band->rect.right - band->rect.left;
+	const UINT32 h = band->rect.bottom - band->rect.top;
+	const BYTE* src = &band->pSrcData[band->rect.top * band->nSrcStep +
+	                                  band->rect.left * FreeRDPGetBytesPerPixel(band->SrcFormat)];
+
+	if (!freerdp_bitmap_planar_context_reset(band->planar, w, h))
 		return FALSE;
+	freerdp_planar_topdown_image(band->planar, TRUE);
 
-	if (client->first_frame)
+	band->data = freerdp_bitmap_compress_planar(band->planar, src, band->SrcFormat, w, h,
+	                                            band->nSrcStep, NULL, &band->length);
+	return band->data != NULL;
+}
+
+static void CALLBACK shadow_client_encode_gfx_band_work_callback(PTP_CALLBACK_INSTANCE instance,
+                                                                 void* context, PTP_WORK work)
+{
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+
+	SHADOW_GFX_BAND* band = context;
+	if (!shadow_client_encode_gfx_band(band))
+		WLog_ERR(TAG, "planar encoding of band failed");
+}
+
+/* The planar bitstream is a sequence of bands, each a rectangle, a length and the
+ * planar data for that part of the frame. Bands are encoded on the thread pool. */
+static BOOL shadow_client_encode_gfx_planar(void* ctx, BYTE** ppData, UINT32* pLength)
+{
+	BOOL rc = FALSE;
+	SHADOW_GFX_ENCODE* args = ctx;
+	SHADOW_GFX_BAND bands[SHADOW_ENCODER_MAX_BANDS] = { 0 };
+	PTP_WORK work[SHADOW_ENCODER_MAX_BANDS] = { 0 };
+	wStream* s = NULL;
+
+	WINPR_ASSERT(args);
+	WINPR_ASSERT(args->encoder);
+
+	const rdpShadowEncoder* encoder = args->encoder;
+
+	/* Planar has no notion of a region, encode its bounding box */
+	RECTANGLE_16 rect = args->rect;
+	if (args->region)
+		rect = *region16_extents(args->region);
+
+	const UINT32 h = rect.bottom - rect.top;
+
+	/* Bands below 64 lines are not worth the thread switch */
+	UINT32 count = MAX(1, MIN(encoder->planarBandCount, h / 64));
+	const UINT32 bandHeight = MAX(1, (h + count - 1) / count);
+	count = MAX(1, (h + bandHeight - 1) / bandHeight);
+
+	for (UINT32 x = 0; x < count; x++)
 	{
-		rfx_context_reset(encoder->rfx, nWidth, nHeight);
-		client->first_frame = FALSE;
+		SHADOW_GFX_BAND* band = &bands[x];
+		band->planar = (count > 1) ? encoder->planarBands[x] : encoder->planar;
+		band->pSrcData = args->pSrcData;
+		band->SrcFormat = args->SrcFormat;
+		band->nSrcStep = args->nSrcStep;
+		band->rect = rect;
+		band->rect.top = (UINT16)(rect.top + x * bandHeight);
+		band->rect.bottom = (UINT16)MIN(rect.bottom, band->rect.top + bandHeight);
 	}
 
-	cmdstart.frameId = shadow_encoder_create_frame_id(encoder);
-	GetSystemTime(&sTime);
-	cmdstart.timestamp = (UINT32)(sTime.wHour << 22U | sTime.wMinute << 16U | sTime.wSecond << 10U |
-	                              sTime.wMilliseconds);
-	cmdend.frameId = cmdstart.frameId;
-	cmd.surfaceId = client->surfaceId;
-	cmd.format = PIXEL_FORMAT_BGRX32;
-	cmd.left = nXSrc;
-	cmd.top = nYSrc;
-	cmd.right = cmd.left + nWidth;
-	cmd.bottom = cmd.top + nHeight;
-	cmd.width = nWidth;
-	cmd.height = nHeight;
+	/* The first band is encoded on the calling thread */
+	for (UINT32 x = 1; x < count; x++)
+	{
+		work[x] = CreateThreadpoolWork(shadow_client_encode_gfx_band_work_callback,
+		                               (void*)&bands[x], NULL);
+		if (work[x])
+			SubmitThreadpoolWork(work[x]);
+	}
+
+	BOOL success = shadow_client_encode_gfx_band(&bands[0]);
+
+	for (UINT32 x = 1; x < count; x++)
+	{
+		if (work[x])
+		{
+			WaitForThreadpoolWorkCallbacks(work[x], FALSE);
+			CloseThreadpoolWork(work[x]);
+		}
+		else if (!shadow_client_encode_gfx_band(&bands[x]))
+			success = FALSE;
+
+		if (!bands[x].data)
+			success = FALSE;
+	}
+
+	if (!success)
+	{
+		WLog_ERR(TAG, "freerdp_bitmap_compress_planar failed");
+		goto fail;
+	}
+
+	size_t length = 0;
+	for (UINT32 x = 0; x < count; x++)
+		length += 12ull + bands[x].length;
+
+	s = Stream_New(NULL, length);
+	if (!s)
+		goto fail;
+
+	for (UINT32 x = 0; x < count; x++)
+	{
+		const SHADOW_GFX_BAND* band = &bands[x];
+		Stream_Write_UINT16(s, band->rect.left);
+		Stream_Write_UINT16(s, band->rect.top);
+		Stream_Write_UINT16(s, band->rect.right);
+		Stream_Write_UINT16(s, band->rect.bottom);
+		Stream_Write_UINT32(s, band->length);
+		Stream_Write(s, band->data, band->length);
+	}
+
+	WINPR_ASSERT(length <= UINT32_MAX);
+	*ppData = Stream_Buffer(s);
+	*pLength = (UINT32)length;
+	Stream_Free(s, FALSE);
+	rc = TRUE;
+
+fail:
+	for (UINT32 x = 0; x < count; x++)
+		free(bands[x].data);
+	return rc;
+}
+
+static UINT shadow_client_send_gfx_planar(rdpShadowClient* client, RDPGFX_SURFACE_COMMAND* cmd,
+                                          const RDPGFX_START_FRAME_PDU* cmdstart,
+                                          const RDPGFX_END_FRAME_PDU* cmdend, const BYTE* data,
+                                          UINT32 length)
+{
+	UINT error = CHANNEL_RC_OK;
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticConstInit(&sbuffer, data, length);
+
+	cmd->codecId = RDPGFX_CODECID_PLANAR;
+
+	/* All bands belong to the same frame */
+	while (Stream_GetRemainingLength(s) >= 12)
+	{
+		Stream_Read_UINT16(s, cmd->left);
+		Stream_Read_UINT16(s, cmd->top);
+		Stream_Read_UINT16(s, cmd->right);
+		Stream_Read_UINT16(s, cmd->bottom);
+		Stream_Read_UINT32(s, cmd->length);
+		if (!Stream_CheckAndLogRequiredLength(TAG, s, cmd->length))
+			return ERROR_INVALID_DATA;
+
+		cmd->width = cmd->right - cmd->left;
+		cmd->height = cmd->bottom - cmd->top;
+		cmd->data = Stream_Pointer(s);
+		Stream_Seek(s, cmd->length);
+
+		const BOOL last = Stream_GetRemainingLength(s) < 12;
+		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, cmd, cmdstart,
+		          last ? cmdend : NULL);
+		if (error)
+			return error;
+		cmdstart = NULL;
+	}
+
+	return error;
+}
+
+/* Run the encoder, or reuse the bitstream another client produced for this frame */
+static BOOL shadow_client_encode_gfx_shared(rdpShadowClient* client, UINT32 codecId,
+                                            UINT32 variant, pfnShadowSharedEncode fn,
+                                            SHADOW_GFX_ENCODE* args, BYTE** ppData,
+                                            UINT32* pLength)
+{
+	rdpShadowServer* server = client->server;
+
+	/* Regions depend on the per client cache state, only whole frames are shared */
+	if (server && server->sharedEncoder && !args->region)
+	{
+		args->shared = TRUE;
+		return shadow_shared_encoder_encode(server->sharedEncoder, codecId, variant,
+		                                    args->pSrcData, &args->rect, fn, args, ppData,
+		                                    pLength);
+	}
+	return fn(args, ppData, pLength);
+}
+
+static UINT32 shadow_client_gfx_codecs(const rdpSettings* settings)
+{
+	UINT32 codecs = 0;
+
+	WINPR_ASSERT(settings);
+
+#ifdef WITH_GFX_H264
+	if (freerdp_settings_get_bool(settings, FreeRDP_GfxAVC444) ||
+	    freerdp_settings_get_bool(settings, FreeRDP_GfxAVC444v2))
+		codecs |= FREERDP_CODEC_AVC444;
+	if (freerdp_settings_get_bool(settings, FreeRDP_GfxH264))
+		codecs |= FREERDP_CODEC_AVC420;
+#endif
+	if (freerdp_settings_get_bool(settings, FreeRDP_RemoteFxCodec) &&
+	    (freerdp_settings_get_uint32(settings, FreeRDP_RemoteFxCodecId) != 0))
+		codecs |= FREERDP_CODEC_REMOTEFX;
+	if (freerdp_settings_get_bool(settings, FreeRDP_GfxProgressive))
+		codecs |= FREERDP_CODEC_PROGRESSIVE;
+	if (freerdp_settings_get_bool(settings, FreeRDP_GfxPlanar))
+		codecs |= FREERDP_CODEC_PLANAR;
+
+	return codecs;
+}
+
+#ifdef WITH_GFX_H264
+static void shadow_client_gfx_mark_lossy(rdpShadowClient* client,
+                                         const RDPGFX_H264_METABLOCK* meta)
+{
+	if (!client->server->refineDelay)
+		return;
+
+	for (UINT32 x = 0; x < meta->numRegionRects; x++)
+		shadow_encoder_mark_lossy(client->encoder, &meta->regionRects[x]);
+}
+#endif
+
+static void shadow_client_gfx_mark_lossless(rdpShadowClient* client,
+                                            const RDPGFX_SURFACE_COMMAND* cmd,
+                                            const REGION16* region)
+{
+	UINT32 numRects = 1;
+	const RECTANGLE_16 rect = { (UINT16)cmd->left, (UINT16)cmd->top, (UINT16)cmd->right,
+		                        (UINT16)cmd->bottom };
+	const RECTANGLE_16* rects = region ? region16_rects(region, &numRects) : &rect;
+
+	for (UINT32 x = 0; x < numRects; x++)
+		shadow_encoder_mark_lossless(client->encoder, &rects[x]);
+}
+
+static BOOL shadow_client_send_gfx_codec_int(rdpShadowClient* client, UINT32 codec,
+                                             RDPGFX_SURFACE_COMMAND* cmd,
+                                             const RDPGFX_START_FRAME_PDU* cmdstart,
+                                             const RDPGFX_END_FRAME_PDU* cmdend,
+                                             const BYTE* pSrcData, UINT32 nSrcStep,
+                                             UINT32 SrcFormat, UINT16 nWidth, UINT16 nHeight,
+                                             const REGION16* region)
+{
+	UINT error = CHANNEL_RC_OK;
+	const rdpSettings* settings = client->context.settings;
+	rdpShadowEncoder* encoder = client->encoder;
+#ifdef WITH_GFX_H264
+	rdpShadowSubsystem* subsystem = client->server ? client->server->subsystem : NULL;
+#endif
+
+	WINPR_ASSERT(settings);
+	WINPR_ASSERT(encoder);
 
-	id = freerdp_settings_get_uint32(settings, FreeRDP_RemoteFxCodecId);
 #ifdef WITH_GFX_H264
-	const BOOL GfxH264 = freerdp_settings_get_bool(settings, FreeRDP_GfxH264);
-	const BOOL GfxAVC444 = freerdp_settings_get_bool(settings, FreeRDP_GfxAVC444);
 	const BOOL GfxAVC444v2 = freerdp_settings_get_bool(settings, FreeRDP_GfxAVC444v2);
-	if (GfxAVC444 || GfxAVC444v2)
+	if (codec == FREERDP_CODEC_AVC444)
 	{
 		INT32 rc = 0;
 		RDPGFX_AVC444_BITMAP_STREAM avc444 = { 0 };
@@ -1181,15 +1561,15 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		regionRect.left = (UINT16)cmd.left;
-		regionRect.top = (UINT16)cmd.top;
-		regionRect.right = (UINT16)cmd.right;
-		regionRect.bottom = (UINT16)cmd.bottom;
-		rc = avc444_compress(encoder->h264, pSrcData, cmd.format, nSrcStep, nWidth, nHeight,
+		WINPR_ASSERT(cmd->left <= UINT16_MAX);
+		WINPR_ASSERT(cmd->top <= UINT16_MAX);
+		WINPR_ASSERT(cmd->right <= UINT16_MAX);
+		WINPR_ASSERT(cmd->bottom <= UINT16_MAX);
+		regionRect.left = (UINT16)cmd->left;
+		regionRect.top = (UINT16)cmd->top;
+		regionRect.right = (UINT16)cmd->right;
+		regionRect.bottom = (UINT16)cmd->bottom;
+		rc = avc444_compress(encoder->h264, pSrcData, cmd->format, nSrcStep, nWidth, nHeight,
 		                     version, &regionRect, &avc444.LC, &avc444.bitstream[0].data,
 		                     &avc444.bitstream[0].length, &avc444.bitstream[1].data,
 		                     &avc444.bitstream[1].length, &avc444.bitstream[0].meta,
@@ -1204,10 +1584,12 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 		if (rc > 0)
 		{
 			avc444.cbAvc420EncodedBitstream1 = rdpgfx_estimate_h264_avc420(&avc444.bitstream[0]);
-			cmd.codecId = GfxAVC444v2 ? RDPGFX_CODECID_AVC444v2 : RDPGFX_CODECID_AVC444;
-			cmd.extra = (void*)&avc444;
-			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-			          &cmdend);
+			cmd->codecId = GfxAVC444v2 ? RDPGFX_CODECID_AVC444v2 : RDPGFX_CODECID_AVC444;
+			cmd->extra = (void*)&avc444;
+			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, cmd, cmdstart,
+			          cmdend);
+			shadow_client_gfx_mark_lossy(client, &avc444.bitstream[0].meta);
+			shadow_client_gfx_mark_lossy(client, &avc444.bitstream[1].meta);
 		}
 
 		free_h264_metablock(&avc444.bitstream[0].meta);
@@ -1218,7 +1600,7 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 	}
-	else if (GfxH264)
+	else if (codec == FREERDP_CODEC_AVC420)
 	{
 		INT32 rc = 0;
 		RDPGFX_AVC420_BITMAP_STREAM avc420 = { 0 };
@@ -1230,16 +1612,20 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		regionRect.left = (UINT16)cmd.left;
-		regionRect.top = (UINT16)cmd.top;
-		regionRect.right = (UINT16)cmd.right;
-		regionRect.bottom = (UINT16)cmd.bottom;
-		rc = avc420_compress(encoder->h264, pSrcData, cmd.format, nSrcStep, nWidth, nHeight,
-		                     &regionRect, &avc420.data, &avc420.length, &avc420.meta);
+		WINPR_ASSERT(cmd->left <= UINT16_MAX);
+		WINPR_ASSERT(cmd->top <= UINT16_MAX);
+		WINPR_ASSERT(cmd->right <= UINT16_MAX);
+		WINPR_ASSERT(cmd->bottom <= UINT16_MAX);
+		regionRect.left = (UINT16)cmd->left;
+		regionRect.top = (UINT16)cmd->top;
+		regionRect.right = (UINT16)cmd->right;
+		regionRect.bottom = (UINT16)cmd->bottom;
+		if (subsystem && subsystem->GetYUV420Frame)
+			rc = shadow_client_avc420_compress_yuv(subsystem, encoder->h264, nWidth, nHeight,
+			                                       &regionRect, &avc420);
+		else
+			rc = avc420_compress(encoder->h264, pSrcData, cmd->format, nSrcStep, nWidth, nHeight,
+			                     &regionRect, &avc420.data, &avc420.length, &avc420.meta);
 		if (rc < 0)
 		{
 			WLog_ERR(TAG, "avc420_compress failed");
@@ -1249,11 +1635,12 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 		/* rc > 0 means new data */
 		if (rc > 0)
 		{
-			cmd.codecId = RDPGFX_CODECID_AVC420;
-			cmd.extra = (void*)&avc420;
+			cmd->codecId = RDPGFX_CODECID_AVC420;
+			cmd->extra = (void*)&avc420;
 
-			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-			          &cmdend);
+			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, cmd, cmdstart,
+			          cmdend);
+			shadow_client_gfx_mark_lossy(client, &avc420.meta);
 		}
 		free_h264_metablock(&avc420.meta);
 
@@ -1265,11 +1652,10 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	}
 	else
 #endif
-	    if (freerdp_settings_get_bool(settings, FreeRDP_RemoteFxCodec) && (id != 0))
+	    if (codec == FREERDP_CODEC_REMOTEFX)
 	{
-		BOOL rc = 0;
-		wStream* s = NULL;
-		RFX_RECT rect;
+		BYTE* data = NULL;
+		UINT32 length = 0;
 
 		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_REMOTEFX) < 0)
 		{
@@ -1277,52 +1663,44 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 
-		s = Stream_New(NULL, 1024);
-		WINPR_ASSERT(s);
-
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		rect.x = (UINT16)cmd.left;
-		rect.y = (UINT16)cmd.top;
-		rect.width = (UINT16)cmd.right - cmd.left;
-		rect.height = (UINT16)cmd.bottom - cmd.top;
-
-		rc = rfx_compose_message(encoder->rfx, s, &rect, 1, pSrcData, nWidth, nHeight, nSrcStep);
-
-		if (!rc)
-		{
-			WLog_ERR(TAG, "rfx_compose_message failed");
-			Stream_Free(s, TRUE);
+		WINPR_ASSERT(cmd->left <= UINT16_MAX);
+		WINPR_ASSERT(cmd->top <= UINT16_MAX);
+		WINPR_ASSERT(cmd->right <= UINT16_MAX);
+		WINPR_ASSERT(cmd->bottom <= UINT16_MAX);
+		SHADOW_GFX_ENCODE args = { encoder,
+			                       pSrcData,
+			                       nSrcStep,
+			                       SrcFormat,
+			                       nWidth,
+			                       nHeight,
+			                       { (UINT16)cmd->left, (UINT16)cmd->top, (UINT16)cmd->right,
+			                         (UINT16)cmd->bottom },
+			                       region };
+
+		if (!shadow_client_encode_gfx_shared(
+		        client, RDPGFX_CODECID_CAVIDEO,
+		        freerdp_settings_get_uint32(settings, FreeRDP_RemoteFxRlgrMode),
+		        shadow_client_encode_gfx_rfx, &args, &data, &length))
 			return FALSE;
-		}
-
-		/* rc > 0 means new data */
-		if (rc > 0)
-		{
-			const size_t pos = Stream_GetPosition(s);
-			WINPR_ASSERT(pos <= UINT32_MAX);
 
-			cmd.codecId = RDPGFX_CODECID_CAVIDEO;
-			cmd.data = Stream_Buffer(s);
-			cmd.length = (UINT32)pos;
+		cmd->codecId = RDPGFX_CODECID_CAVIDEO;
+		cmd->data = data;
+		cmd->length = length;
 
-			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-			          &cmdend);
-		}
+		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, cmd, cmdstart,
+		          cmdend);
 
-		Stream_Free(s, TRUE);
+		free(data);
 		if (error)
 		{
 			WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
 			return FALSE;
 		}
 	}
-	else if (freerdp_settings_get_bool(settings, FreeRDP_GfxProgressive))
+	else if (codec == FREERDP_CODEC_PROGRESSIVE)
 	{
 		INT32 rc = 0;
-		REGION16 region;
+		REGION16 invalidRegion;
 		RECTANGLE_16 regionRect;
 
 		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PROGRESSIVE) < 0)
@@ -1331,19 +1709,23 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 
-		WINPR_ASSERT(cmd.left <= UINT16_MAX);
-		WINPR_ASSERT(cmd.top <= UINT16_MAX);
-		WINPR_ASSERT(cmd.right <= UINT16_MAX);
-		WINPR_ASSERT(cmd.bottom <= UINT16_MAX);
-		regionRect.left = (UINT16)cmd.left;
-		regionRect.top = (UINT16)cmd.top;
-		regionRect.right = (UINT16)cmd.right;
-		regionRect.bottom = (UINT16)cmd.bottom;
-		region16_init(&region);
-		region16_union_rect(&region, &region, &regionRect);
-		rc = progressive_compress(encoder->progressive, pSrcData, nSrcStep * nHeight, cmd.format,
-		                          nWidth, nHeight, nSrcStep, &region, &cmd.data, &cmd.length);
-		region16_uninit(&region);
+		WINPR_ASSERT(cmd->left <= UINT16_MAX);
+		WINPR_ASSERT(cmd->top <= UINT16_MAX);
+		WINPR_ASSERT(cmd->right <= UINT16_MAX);
+		WINPR_ASSERT(cmd->bottom <= UINT16_MAX);
+		regionRect.left = (UINT16)cmd->left;
+		regionRect.top = (UINT16)cmd->top;
+		regionRect.right = (UINT16)cmd->right;
+		regionRect.bottom = (UINT16)cmd->bottom;
+		region16_init(&invalidRegion);
+		if (region)
+			region16_copy(&invalidRegion, region);
+		else
+			region16_union_rect(&invalidRegion, &invalidRegion, &regionRect);
+		rc = progressive_compress(encoder->progressive, pSrcData, nSrcStep * nHeight, cmd->format,
+		                          nWidth, nHeight, nSrcStep, &invalidRegion, &cmd->data,
+		                          &cmd->length);
+		region16_uninit(&invalidRegion);
 		if (rc < 0)
 		{
 			WLog_ERR(TAG, "progressive_compress failed");
@@ -1353,10 +1735,10 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 		/* rc > 0 means new data */
 		if (rc > 0)
 		{
-			cmd.codecId = RDPGFX_CODECID_CAPROGRESSIVE;
+			cmd->codecId = RDPGFX_CODECID_CAPROGRESSIVE;
 
-			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-			          &cmdend);
+			IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, cmd, cmdstart,
+			          cmdend);
 		}
 
 		if (error)
@@ -1365,32 +1747,39 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 			return FALSE;
 		}
 	}
-	else if (freerdp_settings_get_bool(settings, FreeRDP_GfxPlanar))
+	else if (codec == FREERDP_CODEC_PLANAR)
 	{
-		BOOL rc = 0;
-		const UINT32 w = cmd.right - cmd.left;
-		const UINT32 h = cmd.bottom - cmd.top;
-		const BYTE* src =
-		    &pSrcData[cmd.top * nSrcStep + cmd.left * FreeRDPGetBytesPerPixel(SrcFormat)];
+		BYTE* data = NULL;
+		UINT32 length = 0;
+
 		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_PLANAR) < 0)
 		{
 			WLog_ERR(TAG, "Failed to prepare encoder FREERDP_CODEC_PLANAR");
 			return FALSE;
 		}
 
-		rc = freerdp_bitmap_planar_context_reset(encoder->planar, w, h);
-		WINPR_ASSERT(rc);
-		freerdp_planar_topdown_image(encoder->planar, TRUE);
-
-		cmd.data = freerdp_bitmap_compress_planar(encoder->planar, src, SrcFormat, w, h, nSrcStep,
-		                                          NULL, &cmd.length);
-		WINPR_ASSERT(cmd.data || (cmd.length == 0));
-
-		cmd.codecId = RDPGFX_CODECID_PLANAR;
+		WINPR_ASSERT(cmd->left <= UINT16_MAX);
+		WINPR_ASSERT(cmd->top <= UINT16_MAX);
+		WINPR_ASSERT(cmd->right <= UINT16_MAX);
+		WINPR_ASSERT(cmd->bottom <= UINT16_MAX);
+		SHADOW_GFX_ENCODE args = { encoder,
+			                       pSrcData,
+			                       nSrcStep,
+			                       SrcFormat,
+			                       nWidth,
+			                       nHeight,
+			                       { (UINT16)cmd->left, (UINT16)cmd->top, (UINT16)cmd->right,
+			                         (UINT16)cmd->bottom },
+			                       region };
+
+		if (!shadow_client_encode_gfx_shared(client, RDPGFX_CODECID_PLANAR, SrcFormat,
+		                                     shadow_client_encode_gfx_planar, &args, &data,
+		                                     &length))
+			return FALSE;
 
-		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-		          &cmdend);
-		free(cmd.data);
+		shadow_client_gfx_mark_lossless(client, cmd, region);
+		error = shadow_client_send_gfx_planar(client, cmd, cmdstart, cmdend, data, length);
+		free(data);
 		if (error)
 		{
 			WLog_ERR(TAG, "SurfaceFrameCommand failed with error %" PRIu32 "", error);
@@ -1400,23 +1789,24 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	else
 	{
 		BOOL rc = 0;
-		const UINT32 w = cmd.right - cmd.left;
-		const UINT32 h = cmd.bottom - cmd.top;
+		const UINT32 w = cmd->right - cmd->left;
+		const UINT32 h = cmd->bottom - cmd->top;
 		const UINT32 length = w * 4 * h;
 		BYTE* data = malloc(length);
 
 		WINPR_ASSERT(data);
 
 		rc = freerdp_image_copy_no_overlap(data, PIXEL_FORMAT_BGRA32, 0, 0, 0, w, h, pSrcData,
-		                                   SrcFormat, nSrcStep, cmd.left, cmd.top, NULL, 0);
+		                                   SrcFormat, nSrcStep, cmd->left, cmd->top, NULL, 0);
 		WINPR_ASSERT(rc);
 
-		cmd.data = data;
-		cmd.length = length;
-		cmd.codecId = RDPGFX_CODECID_UNCOMPRESSED;
+		shadow_client_gfx_mark_lossless(client, cmd, NULL);
+		cmd->data = data;
+		cmd->length = length;
+		cmd->codecId = RDPGFX_CODECID_UNCOMPRESSED;
 
-		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, &cmd, &cmdstart,
-		          &cmdend);
+		IFCALLRET(client->rdpgfx->SurfaceFrameCommand, error, client->rdpgfx, cmd, cmdstart,
+		          cmdend);
 		free(data);
 		if (error)
 		{
@@ -1427,37 +1817,100 @@ static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE*
 	return TRUE;
 }
 
-static BOOL stream_surface_bits_supported(const rdpSettings* settings)
+static BOOL shadow_client_send_gfx_codec(rdpShadowClient* client, UINT32 codec,
+                                         RDPGFX_SURFACE_COMMAND* cmd,
+                                         const RDPGFX_START_FRAME_PDU* cmdstart,
+                                         const RDPGFX_END_FRAME_PDU* cmdend, const BYTE* pSrcData,
+                                         UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nWidth,
+                                         UINT16 nHeight, const REGION16* region)
 {
-	const UINT32 supported =
-	    freerdp_settings_get_uint32(settings, FreeRDP_SurfaceCommandsSupported);
-	return ((supported & SURFCMDS_STREAM_SURFACE_BITS) != 0);
+	/* the encoders hand out their output while sending, the time includes the send */
+	const UINT64 start = winpr_GetTickCount64NS();
+	const BOOL rc = shadow_client_send_gfx_codec_int(client, codec, cmd, cmdstart, cmdend, pSrcData,
+	                                                 nSrcStep, SrcFormat, nWidth, nHeight, region);
+	if (rc)
+		metrics_codec_encode(client->context.metrics, cmd->codecId,
+		                     winpr_GetTickCount64NS() - start);
+	return rc;
 }
 
-static BOOL set_surface_bits_supported(const rdpSettings* settings)
+/* The per client tile cache, only for codecs able to encode a region of the frame */
+static rdpShadowGfxCache* shadow_client_gfx_cache(rdpShadowClient* client, UINT32 codec,
+                                                  UINT32 SrcFormat, UINT16 nWidth, UINT16 nHeight)
 {
-	const UINT32 supported =
-	    freerdp_settings_get_uint32(settings, FreeRDP_SurfaceCommandsSupported);
-	return ((supported & SURFCMDS_SET_SURFACE_BITS) != 0);
-}
+	rdpShadowEncoder* encoder = client->encoder;
+	const rdpSettings* settings = client->context.settings;
 
-static BOOL is_surface_command_supported(const rdpSettings* settings)
-{
-	if (stream_surface_bits_supported(settings))
+	if (!client->server->gfxCache || (FreeRDPGetBytesPerPixel(SrcFormat) != 4))
+		return NULL;
+
+	switch (codec)
 	{
-		const UINT32 rfxID = freerdp_settings_get_uint32(settings, FreeRDP_RemoteFxCodecId);
-		const BOOL supported = freerdp_settings_get_bool(settings, FreeRDP_RemoteFxCodec);
-		if (supported && (rfxID != 0))
-			return TRUE;
+		case FREERDP_CODEC_REMOTEFX:
+		case FREERDP_CODEC_PROGRESSIVE:
+		case FREERDP_CODEC_PLANAR:
+			break;
+		default:
+			return NULL;
 	}
-	if (set_surface_bits_supported(settings))
+
+	if (!encoder->gfxCache)
 	{
-		const UINT32 nsID = freerdp_settings_get_uint32(settings, FreeRDP_NSCodecId);
-		const BOOL supported = freerdp_settings_get_bool(settings, FreeRDP_NSCodec);
-		if (supported && (nsID != 0))
-			return TRUE;
+		/* 4096 or 25600 slots, but 64x64 tiles fill the 16MB (small cache) or
+		 * 100MB client cache first */
+		const BOOL small = freerdp_settings_get_bool(settings, FreeRDP_GfxSmallCache);
+		const UINT32 maxSlots = small ? 1024 : 6400;
+
+		encoder->gfxCache = shadow_gfx_cache_new(maxSlots);
+		if (!encoder->gfxCache)
+			return NULL;
+
+		if (!shadow_gfx_cache_reset(encoder->gfxCache, nWidth, nHeight))
+		{
+			shadow_gfx_cache_free(encoder->gfxCache);
+			encoder->gfxCache = NULL;
+			return NULL;
+		}
 	}
-	return FALSE;
+
+	return encoder->gfxCache;
+}
+
+static BOOL shadow_client_send_gfx_cache_frame(rdpShadowClient* client,
+                                               const SHADOW_GFX_CACHE_FRAME* frame)
+{
+	UINT error = CHANNEL_RC_OK;
+	RdpgfxServerContext* rdpgfx = client->rdpgfx;
+
+	for (UINT32 x = 0; (x < frame->numFills) && !error; x++)
+		IFCALLRET(rdpgfx->SolidFill, error, rdpgfx, &frame->fills[x]);
+
+	for (UINT32 x = 0; (x < frame->numCopies) && !error; x++)
+		IFCALLRET(rdpgfx->CacheToSurface, error, rdpgfx, &frame->copies[x]);
+
+	/* Stores copy from the surface and must follow the commands updating it */
+	for (UINT32 x = 0; (x < frame->numStores) && !error; x++)
+		IFCALLRET(rdpgfx->SurfaceToCache, error, rdpgfx, &frame->stores[x]);
+
+	if (error)
+	{
+		WLog_ERR(TAG, "sending cache commands failed with error %" PRIu32 "", error);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void shadow_client_gfx_frame_ids(rdpShadowEncoder* encoder, RDPGFX_START_FRAME_PDU* start,
+                                        RDPGFX_END_FRAME_PDU* end)
+{
+	SYSTEMTIME sTime = { 0 };
+
+	start->frameId = shadow_encoder_create_frame_id(encoder);
+	GetSystemTime(&sTime);
+	start->timestamp = (UINT32)(sTime.wHour << 22U | sTime.wMinute << 16U | sTime.wSecond << 10U |
+	                            sTime.wMilliseconds);
+	end->frameId = start->frameId;
 }
 
 /**
@@ -1465,9 +1918,172 @@ static BOOL is_surface_command_supported(const rdpSettings* settings)
  *
  * @return TRUE on success
  */
-static BOOL shadow_client_send_surface_bits(rdpShadowClient* client, BYTE* pSrcData,
-                                            UINT32 nSrcStep, UINT16 nXSrc, UINT16 nYSrc,
-                                            UINT16 nWidth, UINT16 nHeight)
+static BOOL shadow_client_send_surface_gfx(rdpShadowClient* client, const BYTE* pSrcData,
+                                           UINT32 nSrcStep, UINT32 SrcFormat, UINT16 nXSrc,
+                                           UINT16 nYSrc, UINT16 nWidth, UINT16 nHeight,
+                                           const SHADOW_GFX_CACHE_HINT* hint)
+{
+	UINT error = CHANNEL_RC_OK;
+	const rdpContext* context = (const rdpContext*)client;
+	const rdpSettings* settings = NULL;
+	rdpShadowEncoder* encoder = NULL;
+	RDPGFX_SURFACE_COMMAND cmd = { 0 };
+	RDPGFX_START_FRAME_PDU cmdstart = { 0 };
+	RDPGFX_END_FRAME_PDU cmdend = { 0 };
+
+	if (!context || !pSrcData)
+		return FALSE;
+
+	settings = context->settings;
+	encoder = client->encoder;
+#ifdef WITH_GFX_H264
+	rdpShadowSubsystem* subsystem = client->server ? client->server->subsystem : NULL;
+#endif
+
+	if (!settings || !encoder)
+		return FALSE;
+
+	if (client->first_frame)
+	{
+		rfx_context_reset(encoder->rfx, nWidth, nHeight);
+		if (encoder->gfxCache && !shadow_gfx_cache_reset(encoder->gfxCache, nWidth, nHeight))
+			return FALSE;
+		const RECTANGLE_16 all = { 0, 0, UINT16_MAX, UINT16_MAX };
+		shadow_encoder_mark_lossless(encoder, &all);
+		client->first_frame = FALSE;
+	}
+
+	shadow_client_gfx_frame_ids(encoder, &cmdstart, &cmdend);
+	cmd.surfaceId = client->surfaceId;
+	cmd.format = PIXEL_FORMAT_BGRX32;
+	cmd.left = nXSrc;
+	cmd.top = nYSrc;
+	cmd.right = cmd.left + nWidth;
+	cmd.bottom = cmd.top + nHeight;
+	cmd.width = nWidth;
+	cmd.height = nHeight;
+
+	const UINT32 supported = shadow_client_gfx_codecs(settings);
+	UINT32 codec = 0;
+
+	/* Static preference order, the encoder may deviate from it with adaptive-codec */
+	if (supported & FREERDP_CODEC_AVC444)
+		codec = FREERDP_CODEC_AVC444;
+	else if (supported & FREERDP_CODEC_AVC420)
+		codec = FREERDP_CODEC_AVC420;
+	else if (supported & FREERDP_CODEC_REMOTEFX)
+		codec = FREERDP_CODEC_REMOTEFX;
+	else if (supported & FREERDP_CODEC_PROGRESSIVE)
+		codec = FREERDP_CODEC_PROGRESSIVE;
+	else if (supported & FREERDP_CODEC_PLANAR)
+		codec = FREERDP_CODEC_PLANAR;
+
+	if (codec != 0)
+		codec = shadow_encoder_select_codec(encoder, supported, codec);
+
+	rdpShadowGfxCache* cache = shadow_client_gfx_cache(client, codec, SrcFormat, nWidth, nHeight);
+	if (!cache)
+		return shadow_client_send_gfx_codec(client, codec, &cmd, &cmdstart, &cmdend, pSrcData,
+		                                    nSrcStep, SrcFormat, nWidth, nHeight, NULL);
+
+	BOOL rc = FALSE;
+	BOOL batched = FALSE;
+	SHADOW_GFX_CACHE_FRAME frame = { 0 };
+	const RECTANGLE_16 rect = { (UINT16)cmd.left, (UINT16)cmd.top, (UINT16)cmd.right,
+		                        (UINT16)cmd.bottom };
+
+	region16_init(&frame.encode);
+	if (!shadow_gfx_cache_process(cache, client->surfaceId, pSrcData, nSrcStep, &rect, hint,
+	                              &frame))
+		goto out;
+
+	/* Codec output and cache commands are sent as one frame, in a single channel write */
+	if (client->rdpgfx->BeginBatch && client->rdpgfx->EndBatch)
+	{
+		error = client->rdpgfx->BeginBatch(client->rdpgfx);
+		if (error)
+			goto out;
+		batched = TRUE;
+	}
+
+	IFCALLRET(client->rdpgfx->StartFrame, error, client->rdpgfx, &cmdstart);
+	if (error)
+		goto out;
+
+	/* Moves copy the previous surface content and must come before anything updating it */
+	for (UINT32 x = 0; (x < frame.numMoves) && !error; x++)
+		IFCALLRET(client->rdpgfx->SurfaceToSurface, error, client->rdpgfx, &frame.moves[x]);
+	if (error)
+		goto out;
+
+	if (!region16_is_empty(&frame.encode) &&
+	    !shadow_client_send_gfx_codec(client, codec, &cmd, NULL, NULL, pSrcData, nSrcStep,
+	                                  SrcFormat, nWidth, nHeight, &frame.encode))
+		goto out;
+
+	if (!shadow_client_send_gfx_cache_frame(client, &frame))
+		goto out;
+
+	IFCALLRET(client->rdpgfx->EndFrame, error, client->rdpgfx, &cmdend);
+	rc = (error == CHANNEL_RC_OK);
+out:
+	if (batched)
+	{
+		const UINT status = client->rdpgfx->EndBatch(client->rdpgfx);
+		if (status != CHANNEL_RC_OK)
+		{
+			error = status;
+			rc = FALSE;
+		}
+	}
+	if (error)
+		WLog_ERR(TAG, "sending cached frame failed with error %" PRIu32 "", error);
+	region16_uninit(&frame.encode);
+	return rc;
+}
+
+static BOOL stream_surface_bits_supported(const rdpSettings* settings)
+{
+	const UINT32 supported =
+	    freerdp_settings_get_uint32(settings, FreeRDP_SurfaceCommandsSupported);
+	return ((supported & SURFCMDS_STREAM_SURFACE_BITS) != 0);
+}
+
+static BOOL set_surface_bits_supported(const rdpSettings* settings)
+{
+	const UINT32 supported =
+	    freerdp_settings_get_uint32(settings, FreeRDP_SurfaceCommandsSupported);
+	return ((supported & SURFCMDS_SET_SURFACE_BITS) != 0);
+}
+
+static BOOL is_surface_command_supported(const rdpSettings* settings)
+{
+	if (stream_surface_bits_supported(settings))
+	{
+		const UINT32 rfxID = freerdp_settings_get_uint32(settings, FreeRDP_RemoteFxCodecId);
+		const BOOL supported = freerdp_settings_get_bool(settings, FreeRDP_RemoteFxCodec);
+		if (supported && (rfxID != 0))
+			return TRUE;
+	}
+	if (set_surface_bits_supported(settings))
+	{
+		const UINT32 nsID = freerdp_settings_get_uint32(settings, FreeRDP_NSCodecId);
+		const BOOL supported = freerdp_settings_get_bool(settings, FreeRDP_NSCodec);
+		if (supported && (nsID != 0))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Function description
+ *
+ * @return TRUE on success
+ */
+static BOOL shadow_client_send_surface_bits(rdpShadowClient* client, BYTE* pSrcData,
+                                            UINT32 nSrcStep, UINT16 nXSrc, UINT16 nYSrc,
+                                            UINT16 nWidth, UINT16 nHeight,
+                                            const REGION16* invalidRegion)
 {
 	BOOL ret = TRUE;
 	BOOL first = 0;
@@ -1501,6 +2117,8 @@ static BOOL shadow_client_send_surface_bits(rdpShadowClient* client, BYTE* pSrcD
 	    freerdp_settings_get_bool(settings, FreeRDP_RemoteFxCodec) && (rfxID != 0))
 	{
 		RFX_RECT rect = { 0 };
+		RFX_RECT* rects = &rect;
+		UINT32 numRects = 1;
 
 		if (shadow_encoder_prepare(encoder, FREERDP_CODEC_REMOTEFX) < 0)
 		{
@@ -1514,13 +2132,39 @@ static BOOL shadow_client_send_surface_bits(rdpShadowClient* client, BYTE* pSrcD
 		rect.width = nWidth;
 		rect.height = nHeight;
 
+		/* Encode only the changed rectangles, RFX tiles outside of them are skipped */
+		const RECTANGLE_16* regionRects = region16_rects(invalidRegion, &numRects);
+		if (numRects > 1)
+		{
+			const RECTANGLE_16* extents = region16_extents(invalidRegion);
+			const INT32 dx = extents->left - nXSrc;
+			const INT32 dy = extents->top - nYSrc;
+
+			rects = calloc(numRects, sizeof(RFX_RECT));
+			if (!rects)
+				return FALSE;
+
+			for (UINT32 x = 0; x < numRects; x++)
+			{
+				const RECTANGLE_16* cur = &regionRects[x];
+				rects[x].x = (UINT16)(cur->left - dx);
+				rects[x].y = (UINT16)(cur->top - dy);
+				rects[x].width = cur->right - cur->left;
+				rects[x].height = cur->bottom - cur->top;
+			}
+		}
+		else
+			numRects = 1;
+
 		const UINT32 MultifragMaxRequestSize =
 		    freerdp_settings_get_uint32(settings, FreeRDP_MultifragMaxRequestSize);
 		RFX_MESSAGE_LIST* messages =
-		    rfx_encode_messages(encoder->rfx, &rect, 1, pSrcData,
+		    rfx_encode_messages(encoder->rfx, rects, (size_t)numRects, pSrcData,
 		                        freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth),
 		                        freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight),
 		                        nSrcStep, &numMessages, MultifragMaxRequestSize);
+		if (rects != &rect)
+			free(rects);
 		if (!messages)
 		{
 			WLog_ERR(TAG, "rfx_encode_messages failed");
@@ -1628,7 +2272,6 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
                                              UINT16 nWidth, UINT16 nHeight)
 {
 	BOOL ret = TRUE;
-	BYTE* data = NULL;
 	BYTE* buffer = NULL;
 	UINT32 k = 0;
 	UINT32 yIdx = 0;
@@ -1643,6 +2286,9 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
 	UINT32 updateSizeEstimate = 0;
 	BITMAP_DATA* bitmapData = NULL;
 	BITMAP_UPDATE bitmapUpdate = { 0 };
+	RECTANGLE_16* planarRects = NULL;
+	BYTE** planarData = NULL;
+	UINT32* planarSizes = NULL;
 
 	if (!context || !pSrcData)
 		return FALSE;
@@ -1698,6 +2344,18 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
 
 	bitmapUpdate.rectangles = bitmapData;
 
+	if (freerdp_settings_get_uint32(settings, FreeRDP_ColorDepth) >= 32)
+	{
+		planarRects = calloc(bitmapUpdate.number, sizeof(RECTANGLE_16));
+		planarData = calloc(bitmapUpdate.number, sizeof(BYTE*));
+		planarSizes = calloc(bitmapUpdate.number, sizeof(UINT32));
+		if (!planarRects || !planarData || !planarSizes)
+		{
+			ret = FALSE;
+			goto out;
+		}
+	}
+
 	if ((nWidth % 4) != 0)
 	{
 		nWidth += (4 - (nWidth % 4));
@@ -1748,27 +2406,47 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
 			}
 			else
 			{
-				UINT32 dstSize = 0;
-				buffer = encoder->grid[k];
-				data = &pSrcData[(bitmap->destTop * nSrcStep) + (bitmap->destLeft * 4)];
-
-				buffer =
-				    freerdp_bitmap_compress_planar(encoder->planar, data, SrcFormat, bitmap->width,
-				                                   bitmap->height, nSrcStep, buffer, &dstSize);
-				bitmap->bitmapDataStream = buffer;
-				bitmap->bitmapLength = dstSize;
+				/* compressed below, all blocks in one batch */
+				RECTANGLE_16* rect = &planarRects[k];
+				rect->left = (UINT16)bitmap->destLeft;
+				rect->top = (UINT16)bitmap->destTop;
+				rect->right = (UINT16)(bitmap->destLeft + bitmap->width);
+				rect->bottom = (UINT16)(bitmap->destTop + bitmap->height);
+				planarData[k] = encoder->grid[k];
 				bitmap->bitsPerPixel = 32;
 				bitmap->cbScanWidth = bitmap->width * 4;
 				bitmap->cbUncompressedSize = bitmap->width * bitmap->height * 4;
 			}
 
-			bitmap->cbCompFirstRowSize = 0;
-			bitmap->cbCompMainBodySize = bitmap->bitmapLength;
-			totalBitmapSize += bitmap->bitmapLength;
 			k++;
 		}
 	}
 
+	if (planarRects)
+	{
+		if (!freerdp_bitmap_compress_planar_batch(encoder->planar, pSrcData, SrcFormat, nSrcStep,
+		                                          planarRects, k, planarData, planarSizes))
+		{
+			WLog_ERR(TAG, "freerdp_bitmap_compress_planar_batch failed");
+			ret = FALSE;
+			goto out;
+		}
+
+		for (UINT32 x = 0; x < k; x++)
+		{
+			bitmapData[x].bitmapDataStream = planarData[x];
+			bitmapData[x].bitmapLength = planarSizes[x];
+		}
+	}
+
+	for (UINT32 x = 0; x < k; x++)
+	{
+		bitmap = &bitmapData[x];
+		bitmap->cbCompFirstRowSize = 0;
+		bitmap->cbCompMainBodySize = bitmap->bitmapLength;
+		totalBitmapSize += bitmap->bitmapLength;
+	}
+
 	bitmapUpdate.number = k;
 	updateSizeEstimate = totalBitmapSize + (k * bitmapUpdate.number) + 16;
 
@@ -1825,6 +2503,9 @@ static BOOL shadow_client_send_bitmap_update(rdpShadowClient* client, BYTE* pSrc
 	}
 
 out:
+	free(planarRects);
+	free(planarData);
+	free(planarSizes);
 	free(bitmapData);
 	return ret;
 }
@@ -1834,7 +2515,8 @@ out:
  *
  * @return TRUE on success (or nothing need to be updated)
  */
-static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GFX_STATUS* pStatus)
+static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GFX_STATUS* pStatus,
+                                              void* subscriber, BOOL* pConsumed)
 {
 	BOOL ret = TRUE;
 	INT64 nXSrc = 0;
@@ -1853,8 +2535,13 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	UINT32 SrcFormat = 0;
 	UINT32 numRects = 0;
 	const RECTANGLE_16* rects = NULL;
+	rdpShadowSurfaceFrame* frame = NULL;
+	BOOL locked = TRUE;
+	BOOL encoded = TRUE;
+	UINT64 encodeStart = 0;
+	ULONG sentStart = 0;
 
-	if (!context || !pStatus)
+	if (!context || !pStatus || !pConsumed)
 		return FALSE;
 
 	settings = context->settings;
@@ -1876,9 +2563,7 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 
 	EnterCriticalSection(&surface->lock);
 	rects = region16_rects(&(surface->invalidRegion), &numRects);
-
-	for (UINT32 index = 0; index < numRects; index++)
-		region16_union_rect(&invalidRegion, &invalidRegion, &rects[index]);
+	region16_union_rects(&invalidRegion, &invalidRegion, rects, numRects);
 
 	surfaceRect.left = 0;
 	surfaceRect.top = 0;
@@ -1908,6 +2593,28 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	nSrcStep = surface->scanline;
 	SrcFormat = surface->format;
 
+	/* Encode from the published frame without the lock, the capture may write the next one */
+	frame = shadow_surface_acquire_frame(surface);
+	if (frame && ((frame->width != surface->width) || (frame->height != surface->height)))
+	{
+		shadow_surface_release_frame(frame);
+		frame = NULL;
+	}
+
+	if (frame)
+	{
+		pSrcData = frame->data;
+		nSrcStep = frame->scanline;
+		SrcFormat = frame->format;
+		LeaveCriticalSection(&surface->lock);
+		locked = FALSE;
+
+		(void)shadow_multiclient_consume(subscriber);
+		*pConsumed = TRUE;
+
+		shadow_encoder_stats_capture(client->encoder, frame->generation, frame->timestamp);
+	}
+
 	/* Move to new pSrcData / nXSrc / nYSrc according to sub rect */
 	if (server->shareSubRect)
 	{
@@ -1928,6 +2635,10 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 	// PRId64 " height: %" PRId64 " right: %" PRId64 " bottom: %" PRId64, 	nXSrc, nYSrc, nWidth,
 	// nHeight, nXSrc + nWidth, nYSrc + nHeight);
 
+	encodeStart = winpr_GetTickCount64NS();
+	sentStart = freerdp_get_transport_sent(context, FALSE);
+	client->encoder->statsCodecs = 0;
+
 	if (freerdp_settings_get_bool(settings, FreeRDP_SupportGraphicsPipeline))
 	{
 		if (pStatus->gfxOpened && client->areGfxCapsReady)
@@ -1953,11 +2664,24 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 			WINPR_ASSERT(nWidth <= UINT16_MAX);
 			WINPR_ASSERT(nHeight >= 0);
 			WINPR_ASSERT(nHeight <= UINT16_MAX);
+
+			/* Moves reported by the capture are in surface coordinates */
+			SHADOW_GFX_CACHE_HINT hint = { 0 };
+			if (frame && !server->shareSubRect)
+			{
+				hint.generation = frame->generation;
+				hint.moves = frame->moves;
+				hint.numMoves = frame->numMoves;
+				hint.dirty = &frame->dirty;
+			}
+
 			ret = shadow_client_send_surface_gfx(client, pSrcData, nSrcStep, SrcFormat, 0, 0,
-			                                     (UINT16)nWidth, (UINT16)nHeight);
+			                                     (UINT16)nWidth, (UINT16)nHeight,
+			                                     (hint.generation != 0) ? &hint : NULL);
 		}
 		else
 		{
+			encoded = FALSE;
 			ret = TRUE;
 		}
 	}
@@ -1972,7 +2696,8 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 		WINPR_ASSERT(nHeight >= 0);
 		WINPR_ASSERT(nHeight <= UINT16_MAX);
 		ret = shadow_client_send_surface_bits(client, pSrcData, nSrcStep, (UINT16)nXSrc,
-		                                      (UINT16)nYSrc, (UINT16)nWidth, (UINT16)nHeight);
+		                                      (UINT16)nYSrc, (UINT16)nWidth, (UINT16)nHeight,
+		                                      &invalidRegion);
 	}
 	else
 	{
@@ -1988,12 +2713,143 @@ static BOOL shadow_client_send_surface_update(rdpShadowClient* client, SHADOW_GF
 		                                       (UINT16)nYSrc, (UINT16)nWidth, (UINT16)nHeight);
 	}
 
+	if (ret && encoded)
+		shadow_encoder_stats_encode(client->encoder, winpr_GetTickCount64NS() - encodeStart,
+		                            freerdp_get_transport_sent(context, FALSE) - sentStart);
+
 out:
-	LeaveCriticalSection(&surface->lock);
+	if (locked)
+		LeaveCriticalSection(&surface->lock);
+	shadow_surface_release_frame(frame);
 	region16_uninit(&invalidRegion);
 	return ret;
 }
 
+/* Milliseconds until the lossy GFX regions are due for refinement, INFINITE if none are */
+static DWORD shadow_client_refine_timeout(rdpShadowClient* client, const SHADOW_GFX_STATUS* pStatus)
+{
+	const rdpShadowEncoder* encoder = client->encoder;
+	const UINT32 delay = client->server->refineDelay;
+
+	if (!delay || !pStatus->gfxSurfaceCreated || (encoder->lossyCount == 0))
+		return INFINITE;
+
+	const UINT64 now = GetTickCount64();
+	const UINT64 due = encoder->lossyTime + delay;
+	return (now >= due) ? 0 : (DWORD)(due - now);
+}
+
+/**
+ * Function description
+ * Resend the parts of the GFX surface last encoded with H264 as planar, so static
+ * content becomes lossless once the screen stopped changing.
+ *
+ * @return TRUE on success
+ */
+static BOOL shadow_client_send_gfx_refinement(rdpShadowClient* client)
+{
+	BOOL rc = FALSE;
+	UINT error = CHANNEL_RC_OK;
+	rdpSettings* settings = client->context.settings;
+	rdpShadowServer* server = client->server;
+	rdpShadowEncoder* encoder = client->encoder;
+	rdpShadowSurface* surface = client->inLobby ? server->lobby : server->surface;
+	RDPGFX_SURFACE_COMMAND cmd = { 0 };
+	RDPGFX_START_FRAME_PDU cmdstart = { 0 };
+	RDPGFX_END_FRAME_PDU cmdend = { 0 };
+	UINT32 numRects = 0;
+	rdpShadowSurfaceFrame* frame = NULL;
+	BOOL locked = FALSE;
+	REGION16 refine;
+
+	if (!surface)
+		return FALSE;
+
+	const UINT32 nWidth = freerdp_settings_get_uint32(settings, FreeRDP_DesktopWidth);
+	const UINT32 nHeight = freerdp_settings_get_uint32(settings, FreeRDP_DesktopHeight);
+	const RECTANGLE_16 surfaceRect = { 0, 0, (UINT16)MIN(nWidth, UINT16_MAX),
+		                               (UINT16)MIN(nHeight, UINT16_MAX) };
+
+	region16_init(&refine);
+	if (!shadow_encoder_take_lossy_region(encoder, &refine))
+		goto out;
+	(void)region16_intersect_rect(&refine, &refine, &surfaceRect);
+
+	EnterCriticalSection(&surface->lock);
+	locked = TRUE;
+	const BYTE* pSrcData = surface->data;
+	UINT32 nSrcStep = surface->scanline;
+	UINT32 SrcFormat = surface->format;
+
+	frame = shadow_surface_acquire_frame(surface);
+	if (frame && ((frame->width != surface->width) || (frame->height != surface->height)))
+	{
+		shadow_surface_release_frame(frame);
+		frame = NULL;
+	}
+
+	if (frame)
+	{
+		pSrcData = frame->data;
+		nSrcStep = frame->scanline;
+		SrcFormat = frame->format;
+		LeaveCriticalSection(&surface->lock);
+		locked = FALSE;
+	}
+
+	if (server->shareSubRect)
+		pSrcData = &pSrcData[(server->subRect.top * nSrcStep) + (server->subRect.left * 4U)];
+
+	const RECTANGLE_16* rects = region16_rects(&refine, &numRects);
+	if (numRects == 0)
+	{
+		rc = TRUE;
+		goto out;
+	}
+
+	shadow_client_gfx_frame_ids(encoder, &cmdstart, &cmdend);
+	cmd.surfaceId = client->surfaceId;
+	cmd.format = PIXEL_FORMAT_BGRX32;
+
+	IFCALLRET(client->rdpgfx->StartFrame, error, client->rdpgfx, &cmdstart);
+	if (error)
+		goto out;
+
+	for (UINT32 x = 0; x < numRects; x++)
+	{
+		REGION16 rectRegion;
+
+		cmd.left = rects[x].left;
+		cmd.top = rects[x].top;
+		cmd.right = rects[x].right;
+		cmd.bottom = rects[x].bottom;
+		cmd.width = cmd.right - cmd.left;
+		cmd.height = cmd.bottom - cmd.top;
+
+		region16_init(&rectRegion);
+		(void)region16_union_rect(&rectRegion, &rectRegion, &rects[x]);
+		const BOOL sent =
+		    shadow_client_send_gfx_codec(client, FREERDP_CODEC_PLANAR, &cmd, NULL, NULL, pSrcData,
+		                                 nSrcStep, SrcFormat, (UINT16)nWidth, (UINT16)nHeight,
+		                                 &rectRegion);
+		region16_uninit(&rectRegion);
+		if (!sent)
+			goto out;
+	}
+
+	IFCALLRET(client->rdpgfx->EndFrame, error, client->rdpgfx, &cmdend);
+	rc = (error == CHANNEL_RC_OK);
+
+out:
+	if (error)
+		WLog_ERR(TAG, "sending refinement frame failed with error %" PRIu32 "", error);
+	if (locked)
+		LeaveCriticalSection(&surface->lock);
+	shadow_surface_release_frame(frame);
+	region16_uninit(&refine);
+	return rc;
+}
+
 /**
  * Function description
  * Notify client for resize. The new desktop width/height
@@ -2022,6 +2878,7 @@ static BOOL shadow_client_send_resize(rdpShadowClient* client, SHADOW_GFX_STATUS
 	 * shadow_client_activate would be invoked later.
 	 */
 	client->activated = FALSE;
+	shadow_client_update_capture(client);
 
 	/* Close Gfx surfaces */
 	if (pStatus->gfxSurfaceCreated)
@@ -2194,6 +3051,93 @@ static int shadow_client_subsystem_process_message(rdpShadowClient* client, wMes
 	return 1;
 }
 
+static BOOL shadow_client_pipeline_encode(void* arg)
+{
+	SHADOW_CLIENT_PIPELINE* pipeline = arg;
+	BOOL consumed = FALSE;
+
+	WINPR_ASSERT(pipeline);
+
+	/* The client thread collected the invalid region and consumed the update */
+	return shadow_client_send_surface_update(pipeline->client, pipeline->gfxstatus, NULL,
+	                                         &consumed);
+}
+
+static BOOL shadow_client_pipeline_init(SHADOW_CLIENT_PIPELINE* pipeline, rdpShadowClient* client,
+                                        SHADOW_GFX_STATUS* gfxstatus)
+{
+	WINPR_ASSERT(pipeline);
+	WINPR_ASSERT(client);
+
+	pipeline->client = client;
+	pipeline->gfxstatus = gfxstatus;
+	return shadow_pipeline_init(&pipeline->worker, shadow_client_pipeline_encode, pipeline);
+}
+
+static void shadow_client_pipeline_uninit(SHADOW_CLIENT_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	shadow_pipeline_uninit(&pipeline->worker);
+}
+
+/* Whether the next GFX frame should be encoded on the pipeline thread */
+static BOOL shadow_client_pipeline_enabled(const SHADOW_CLIENT_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	const rdpShadowClient* client = pipeline->client;
+	return pipeline->worker.thread && pipeline->gfxstatus->gfxOpened &&
+	       pipeline->gfxstatus->gfxSurfaceCreated && client && client->areGfxCapsReady &&
+	       freerdp_settings_get_bool(client->context.settings, FreeRDP_SupportGraphicsPipeline);
+}
+
+/* Hold back new frames while the client has depth frames unacknowledged */
+static BOOL shadow_client_pipeline_window_full(const SHADOW_CLIENT_PIPELINE* pipeline)
+{
+	const rdpShadowEncoder* encoder = pipeline->client->encoder;
+	const UINT32 depth = pipeline->client->server->encodeDepth;
+
+	WINPR_ASSERT(encoder);
+
+	if ((encoder->queueDepth == SUSPEND_FRAME_ACKNOWLEDGEMENT) ||
+	    (encoder->frameId - encoder->lastAckframeId < depth))
+		return FALSE;
+
+	/* Some clients stop acknowledging while inactive, do not wait for them forever */
+	const UINT32 oldest = encoder->lastAckframeId + 1;
+	if (encoder->frameId - oldest >= SHADOW_ENCODER_ACK_HISTORY)
+		return FALSE;
+
+	const UINT64 sent = encoder->frameSentTime[oldest % SHADOW_ENCODER_ACK_HISTORY];
+	return GetTickCount64() - sent < SHADOW_CLIENT_ACK_TIMEOUT;
+}
+
+/* Returns FALSE if the encode could not be started now, the frame stays pending */
+static BOOL shadow_client_pipeline_start(SHADOW_CLIENT_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	if (pipeline->worker.busy || shadow_client_pipeline_window_full(pipeline))
+		return FALSE;
+
+	return shadow_pipeline_start(&pipeline->worker);
+}
+
+/* Wait for a running encode, the encoder state may be used afterwards */
+static BOOL shadow_client_pipeline_wait(SHADOW_CLIENT_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	if (!pipeline->worker.busy)
+		return TRUE;
+
+	const BOOL rc = shadow_pipeline_wait(&pipeline->worker);
+	if (!rc)
+		WLog_ERR(TAG, "Failed to send surface update");
+	return rc;
+}
+
 static DWORD WINAPI shadow_client_thread(LPVOID arg)
 {
 	rdpShadowClient* client = (rdpShadowClient*)arg;
@@ -2214,6 +3158,8 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	wMessageQueue* MsgQueue = NULL;
 	/* This should only be visited in client thread */
 	SHADOW_GFX_STATUS gfxstatus = { 0 };
+	SHADOW_CLIENT_PIPELINE pipeline = { 0 };
+	BOOL updatePending = FALSE;
 	rdpUpdate* update = NULL;
 
 	WINPR_ASSERT(client);
@@ -2249,6 +3195,13 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	update->SuppressOutput = shadow_client_suppress_output;
 	update->SurfaceFrameAcknowledge = shadow_client_surface_frame_acknowledge;
 
+	if (client->server->adaptiveCodec)
+	{
+		rdpAutoDetect* autodetect = autodetect_get(peer->context);
+		if (autodetect)
+			autodetect->BandwidthMeasureResults = shadow_client_bandwidth_measure_results;
+	}
+
 	if ((!client->vcm) || (!subsystem->updateEvent))
 		goto out;
 
@@ -2271,22 +3224,25 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	WINPR_ASSERT(rc);
 	rc = freerdp_settings_set_bool(settings, FreeRDP_SupportMonitorLayoutPdu, TRUE);
 	WINPR_ASSERT(rc);
+
+	if ((server->encodeDepth > 0) && !shadow_client_pipeline_init(&pipeline, client, &gfxstatus))
+	{
+		WLog_ERR(TAG, "Failed to start the encode thread");
+		goto fail;
+	}
+
 	while (1)
 	{
 		HANDLE events[MAXIMUM_WAIT_OBJECTS] = { 0 };
 		DWORD nCount = 0;
 		events[nCount++] = UpdateEvent;
+		const DWORD peerCount = peer->GetEventHandles(peer, &events[nCount], 64 - nCount);
+		if (peerCount == 0)
 		{
-			DWORD tmp = peer->GetEventHandles(peer, &events[nCount], 64 - nCount);
-
-			if (tmp == 0)
-			{
-				WLog_ERR(TAG, "Failed to get FreeRDP transport event handles");
-				goto fail;
-			}
-
-			nCount += tmp;
+			WLog_ERR(TAG, "Failed to get FreeRDP transport event handles");
+			goto fail;
 		}
+		nCount += peerCount;
 		events[nCount++] = ChannelEvent;
 		events[nCount++] = MessageQueue_Event(MsgQueue);
 
@@ -2297,13 +3253,32 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 			events[nCount++] = gfxevent;
 #endif
 
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+		if (pipeline.worker.busy)
+			events[nCount++] = pipeline.worker.done;
+
+		/* The event handles only signal input, poll while output is pending */
+		DWORD timeout =
+		    pipeline.worker.busy ? INFINITE : shadow_client_refine_timeout(client, &gfxstatus);
+		if (updatePending)
+			timeout = MIN(timeout, SHADOW_CLIENT_DRAIN_INTERVAL);
+
+		status = WaitForMultipleObjects(nCount, events, FALSE, timeout);
 
 		if (status == WAIT_FAILED)
 			goto fail;
 
+		/* The lobby state may change on the encomsp channel thread */
+		shadow_client_update_capture(client);
+
+		if (pipeline.worker.busy &&
+		    (WaitForSingleObject(pipeline.worker.done, 0) == WAIT_OBJECT_0) &&
+		    !shadow_client_pipeline_wait(&pipeline))
+			break;
+
 		if (WaitForSingleObject(UpdateEvent, 0) == WAIT_OBJECT_0)
 		{
+			BOOL consumed = FALSE;
+
 			/* The UpdateEvent means to start sending current frame. It is
 			 * triggered from subsystem implementation and it should ensure
 			 * that the screen and primary surface meta data (width, height,
@@ -2319,16 +3294,43 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 				if (shadow_client_recalc_desktop_size(client))
 				{
 					/* Screen size changed, do resize */
+					if (!shadow_client_pipeline_wait(&pipeline))
+						break;
 					if (!shadow_client_send_resize(client, &gfxstatus))
 					{
 						WLog_ERR(TAG, "Failed to send resize message");
 						break;
 					}
 				}
+				else if (shadow_client_pipeline_enabled(&pipeline))
+				{
+					/* Collect the changes, the encode thread picks them up once idle and
+					 * the frame acknowledge window has room */
+					if (!shadow_client_no_surface_update(client, &gfxstatus))
+					{
+						WLog_ERR(TAG, "Failed to handle surface update");
+						break;
+					}
+					updatePending =
+					    peer->IsWriteBlocked(peer) || !shadow_client_pipeline_start(&pipeline);
+				}
+				else if (peer->IsWriteBlocked(peer))
+				{
+					/* Do not queue up frames behind a congested connection, collect the
+					 * changes and send the latest frame once the output drained */
+					if (!shadow_client_no_surface_update(client, &gfxstatus))
+					{
+						WLog_ERR(TAG, "Failed to handle surface update");
+						break;
+					}
+					updatePending = TRUE;
+				}
 				else
 				{
 					/* Send frame */
-					if (!shadow_client_send_surface_update(client, &gfxstatus))
+					updatePending = FALSE;
+					if (!shadow_client_send_surface_update(client, &gfxstatus, UpdateSubscriber,
+					                                       &consumed))
 					{
 						WLog_ERR(TAG, "Failed to send surface update");
 						break;
@@ -2348,15 +3350,63 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 			/*
 			 * The return value of shadow_multiclient_consume is whether or not
 			 * the subscriber really consumes the event. It's not cared currently.
+			 * Updates encoding a published frame consume it before encoding.
 			 */
-			(void)shadow_multiclient_consume(UpdateSubscriber);
+			if (!consumed)
+				(void)shadow_multiclient_consume(UpdateSubscriber);
 		}
 
-		WINPR_ASSERT(peer->CheckFileDescriptor);
-		if (!peer->CheckFileDescriptor(peer))
+		/* Input may change the encoder state, it waits for a running encode */
+		if (!pipeline.worker.busy ||
+		    (WaitForMultipleObjects(peerCount, &events[1], FALSE, 0) < WAIT_OBJECT_0 + peerCount))
 		{
-			WLog_ERR(TAG, "Failed to check FreeRDP file descriptor");
-			goto fail;
+			if (!shadow_client_pipeline_wait(&pipeline))
+				break;
+
+			WINPR_ASSERT(peer->CheckFileDescriptor);
+			if (!peer->CheckFileDescriptor(peer))
+			{
+				WLog_ERR(TAG, "Failed to check FreeRDP file descriptor");
+				goto fail;
+			}
+		}
+
+		if (updatePending)
+		{
+			if (peer->DrainOutputBuffer(peer) < 0)
+			{
+				WLog_ERR(TAG, "Failed to drain output buffer");
+				goto fail;
+			}
+
+			if (!peer->IsWriteBlocked(peer))
+			{
+				BOOL consumed = FALSE;
+
+				updatePending = FALSE;
+				if (client->activated && !client->suppressOutput)
+				{
+					if (shadow_client_pipeline_enabled(&pipeline))
+						updatePending = !shadow_client_pipeline_start(&pipeline);
+					else if (!shadow_client_send_surface_update(client, &gfxstatus, NULL,
+					                                            &consumed))
+					{
+						WLog_ERR(TAG, "Failed to send surface update");
+						break;
+					}
+				}
+			}
+		}
+
+		if (!updatePending && !pipeline.worker.busy && client->activated &&
+		    !client->suppressOutput && (shadow_client_refine_timeout(client, &gfxstatus) == 0) &&
+		    !peer->IsWriteBlocked(peer))
+		{
+			if (!shadow_client_send_gfx_refinement(client))
+			{
+				WLog_ERR(TAG, "Failed to send refinement");
+				break;
+			}
 		}
 
 		if (client->activated &&
@@ -2430,6 +3480,8 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 		{
 			if (WaitForSingleObject(gfxevent, 0) == WAIT_OBJECT_0)
 			{
+				if (!shadow_client_pipeline_wait(&pipeline))
+					break;
 				rdpgfx_server_handle_messages(client->rdpgfx);
 			}
 		}
@@ -2508,6 +3560,7 @@ static DWORD WINAPI shadow_client_thread(LPVOID arg)
 	}
 
 fail:
+	shadow_client_pipeline_uninit(&pipeline);
 
 	/* Free channels early because we establish channels in post connect */
 #if defined(CHANNEL_AUDIN_SERVER)
@@ -2548,6 +3601,9 @@ fail:
 	}
 
 out:
+	client->activated = FALSE;
+	shadow_client_update_capture(client);
+
 	WINPR_ASSERT(peer->Disconnect);
 	peer->Disconnect(peer);
 	freerdp_peer_context_free(peer);
@@ -2687,6 +3743,43 @@ int shadow_client_boardcast_msg(rdpShadowServer* server, void* context, UINT32 t
 	return count;
 }
 
+BOOL shadow_client_get_stats(rdpShadowClient* client, SHADOW_CLIENT_STATS* stats)
+{
+	if (!client || !stats || !client->encoder)
+		return FALSE;
+
+	shadow_encoder_get_stats(client->encoder, stats);
+
+	const freerdp_peer* peer = client->context.peer;
+	if (peer)
+		(void)strncpy(stats->hostname, peer->hostname, sizeof(stats->hostname) - 1);
+	stats->hostname[sizeof(stats->hostname) - 1] = '\0';
+	return TRUE;
+}
+
+size_t shadow_server_get_client_stats(rdpShadowServer* server, SHADOW_CLIENT_STATS* stats,
+                                      size_t count)
+{
+	size_t filled = 0;
+
+	if (!server || !server->clients || (!stats && (count > 0)))
+		return 0;
+
+	ArrayList_Lock(server->clients);
+
+	const size_t clients = ArrayList_Count(server->clients);
+	for (size_t index = 0; (index < clients) && (filled < count); index++)
+	{
+		rdpShadowClient* client = (rdpShadowClient*)ArrayList_GetItem(server->clients, index);
+
+		if (shadow_client_get_stats(client, &stats[filled]))
+			filled++;
+	}
+
+	ArrayList_Unlock(server->clients);
+	return clients;
+}
+
 int shadow_client_boardcast_quit(rdpShadowServer* server, int nExitCode)
 {
 	wMessageQueue* queue = NULL;
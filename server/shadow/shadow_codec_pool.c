@@ -0,0 +1,213 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+
+#include <freerdp/log.h>
+#include <freerdp/codecs.h>
+
+#include "shadow.h"
+
+#include "shadow_codec_pool.h"
+
+#define TAG SERVER_TAG("shadow.pool")
+
+typedef struct
+{
+	UINT32 codec;
+	UINT32 width;
+	UINT32 height;
+	UINT32 flags;
+	UINT64 released;
+	void* context;
+} SHADOW_CODEC_POOL_ENTRY;
+
+struct rdp_shadow_codec_pool
+{
+	CRITICAL_SECTION lock;
+	UINT64 sequence;
+	size_t count;
+	size_t maxContexts;
+	SHADOW_CODEC_POOL_ENTRY* entries;
+	UINT64 hits;
+	UINT64 misses;
+};
+
+static void codec_pool_context_free(UINT32 codec, void* context)
+{
+	switch (codec)
+	{
+		case FREERDP_CODEC_REMOTEFX:
+			rfx_context_free(context);
+			break;
+		case FREERDP_CODEC_NSCODEC:
+			nsc_context_free(context);
+			break;
+		case FREERDP_CODEC_PLANAR:
+			freerdp_bitmap_planar_context_free(context);
+			break;
+		case FREERDP_CODEC_INTERLEAVED:
+			bitmap_interleaved_context_free(context);
+			break;
+		case FREERDP_CODEC_AVC420:
+			h264_context_free(context);
+			break;
+		case FREERDP_CODEC_PROGRESSIVE:
+			progressive_context_free(context);
+			break;
+		default:
+			WLog_WARN(TAG, "leaking context of unknown codec 0x%08" PRIx32, codec);
+			break;
+	}
+}
+
+rdpShadowCodecPool* shadow_codec_pool_new(size_t maxContexts)
+{
+	rdpShadowCodecPool* pool = (rdpShadowCodecPool*)calloc(1, sizeof(rdpShadowCodecPool));
+
+	if (!pool)
+		return NULL;
+
+	pool->maxContexts = maxContexts;
+	pool->entries =
+	    (SHADOW_CODEC_POOL_ENTRY*)calloc(MAX(maxContexts, 1), sizeof(SHADOW_CODEC_POOL_ENTRY));
+	if (!pool->entries)
+	{
+		free(pool);
+		return NULL;
+	}
+
+	if (!InitializeCriticalSectionAndSpinCount(&pool->lock, 4000))
+	{
+		free(pool->entries);
+		free(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+void shadow_codec_pool_free(rdpShadowCodecPool* pool)
+{
+	if (!pool)
+		return;
+
+	WLog_DBG(TAG, "codec contexts: %" PRIu64 " created, %" PRIu64 " reused", pool->misses,
+	         pool->hits);
+
+	for (size_t x = 0; x < pool->count; x++)
+		codec_pool_context_free(pool->entries[x].codec, pool->entries[x].context);
+
+	DeleteCriticalSection(&pool->lock);
+	free(pool->entries);
+	free(pool);
+}
+
+void* shadow_codec_pool_take(rdpShadowCodecPool* pool, UINT32 codec, UINT32 width,
+                             UINT32 height, UINT32 flags)
+{
+	void* context = NULL;
+
+	if (!pool)
+		return NULL;
+
+	EnterCriticalSection(&pool->lock);
+
+	/* prefer the most recently released context, it is the most likely to be cache warm */
+	size_t found = pool->count;
+	for (size_t x = 0; x < pool->count; x++)
+	{
+		const SHADOW_CODEC_POOL_ENTRY* entry = &pool->entries[x];
+
+		if ((entry->codec != codec) || (entry->width != width) || (entry->height != height) ||
+		    (entry->flags != flags))
+			continue;
+
+		if ((found == pool->count) || (entry->released > pool->entries[found].released))
+			found = x;
+	}
+
+	if (found < pool->count)
+	{
+		context = pool->entries[found].context;
+		pool->entries[found] = pool->entries[--pool->count];
+		pool->hits++;
+	}
+	else
+		pool->misses++;
+
+	LeaveCriticalSection(&pool->lock);
+	return context;
+}
+
+void shadow_codec_pool_put(rdpShadowCodecPool* pool, UINT32 codec, UINT32 width,
+                           UINT32 height, UINT32 flags, void* context)
+{
+	void* evicted = NULL;
+	UINT32 evictedCodec = 0;
+
+	if (!context)
+		return;
+
+	if (!pool || (pool->maxContexts == 0))
+	{
+		codec_pool_context_free(codec, context);
+		return;
+	}
+
+	/* Forget the configured size so the backend initializes the encoder again on the next
+	 * frame. This keeps the library and YUV contexts but starts the next session with an IDR
+	 * frame instead of continuing the reference chain of the previous one. */
+	if (codec == FREERDP_CODEC_AVC420)
+	{
+		if (!h264_context_reset(context, 0, 0))
+		{
+			h264_context_free(context);
+			return;
+		}
+	}
+
+	EnterCriticalSection(&pool->lock);
+
+	if (pool->count == pool->maxContexts)
+	{
+		size_t oldest = 0;
+		for (size_t x = 1; x < pool->count; x++)
+		{
+			if (pool->entries[x].released < pool->entries[oldest].released)
+				oldest = x;
+		}
+
+		evicted = pool->entries[oldest].context;
+		evictedCodec = pool->entries[oldest].codec;
+		pool->entries[oldest] = pool->entries[--pool->count];
+	}
+
+	SHADOW_CODEC_POOL_ENTRY* entry = &pool->entries[pool->count++];
+	entry->codec = codec;
+	entry->width = width;
+	entry->height = height;
+	entry->flags = flags;
+	entry->released = ++pool->sequence;
+	entry->context = context;
+
+	LeaveCriticalSection(&pool->lock);
+
+	if (evicted)
+		codec_pool_context_free(evictedCodec, evicted);
+}
@@ -0,0 +1,49 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_CODEC_POOL_H
+#define FREERDP_SERVER_SHADOW_CODEC_POOL_H
+
+#include <freerdp/server/shadow.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	void shadow_codec_pool_free(rdpShadowCodecPool* pool);
+
+	WINPR_ATTR_MALLOC(shadow_codec_pool_free, 1)
+	rdpShadowCodecPool* shadow_codec_pool_new(size_t maxContexts);
+
+	/* Return an idle context of codec created for width x height with flags, or NULL.
+	 * The caller owns the context and must reset it before use. */
+	void* shadow_codec_pool_take(rdpShadowCodecPool* pool, UINT32 codec, UINT32 width,
+	                             UINT32 height, UINT32 flags);
+
+	/* Hand a context of codec back to the pool. The pool takes ownership and frees the context
+	 * if pool is NULL or full. */
+	void shadow_codec_pool_put(rdpShadowCodecPool* pool, UINT32 codec, UINT32 width,
+	                           UINT32 height, UINT32 flags, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_SERVER_SHADOW_CODEC_POOL_H */
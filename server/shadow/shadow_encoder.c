@@ -19,6 +19,9 @@
 #include <freerdp/config.h>
 
 #include <winpr/assert.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/autodetect.h>
 
 #include "shadow.h"
 
@@ -27,6 +30,9 @@
 #include <freerdp/log.h>
 #define TAG CLIENT_TAG("shadow")
 
+static int shadow_encoder_uninit_h264(rdpShadowEncoder* encoder);
+static int shadow_encoder_uninit_progressive(rdpShadowEncoder* encoder);
+
 UINT32 shadow_encoder_preferred_fps(rdpShadowEncoder* encoder)
 {
 	/* Return preferred fps calculated according to the last
@@ -75,9 +81,391 @@ UINT32 shadow_encoder_create_frame_id(rdpShadowEncoder* encoder)
 		encoder->fps = 1;
 
 	frameId = ++encoder->frameId;
+	encoder->frameSentTime[frameId % SHADOW_ENCODER_ACK_HISTORY] = GetTickCount64();
 	return frameId;
 }
 
+void shadow_encoder_frame_acknowledged(rdpShadowEncoder* encoder, UINT32 frameId)
+{
+	WINPR_ASSERT(encoder);
+
+	encoder->lastAckframeId = frameId;
+
+	/* Acknowledgements older than the send history can not be timed */
+	if ((frameId == 0) || (frameId > encoder->frameId) ||
+	    (encoder->frameId - frameId >= SHADOW_ENCODER_ACK_HISTORY))
+		return;
+
+	const UINT64 sent = encoder->frameSentTime[frameId % SHADOW_ENCODER_ACK_HISTORY];
+	const UINT64 now = GetTickCount64();
+
+	if ((sent == 0) || (sent > now))
+		return;
+
+	const UINT32 latency = (UINT32)MIN(now - sent, UINT32_MAX / 8);
+	(void)freerdp_network_estimate_add_frame_latency((rdpContext*)encoder->client, latency);
+
+	/* Exponential moving average, weight 1/8 like the TCP SRTT estimator */
+	if (encoder->ackLatency == 0)
+		encoder->ackLatency = latency;
+	else
+		encoder->ackLatency = (7 * encoder->ackLatency + latency) / 8;
+}
+
+static UINT32 shadow_encoder_stats_average(UINT32 average, UINT64 value)
+{
+	const UINT32 v = (UINT32)MIN(value, UINT32_MAX / 8);
+
+	/* Same weight as the acknowledge latency */
+	if (average == 0)
+		return v;
+	return (7 * average + v) / 8;
+}
+
+void shadow_encoder_stats_capture(rdpShadowEncoder* encoder, UINT64 generation, UINT64 captured)
+{
+	WINPR_ASSERT(encoder);
+
+	const UINT64 now = winpr_GetTickCount64NS();
+
+	EnterCriticalSection(&encoder->statsLock);
+	SHADOW_CLIENT_STATS* stats = &encoder->stats;
+
+	if ((encoder->statsGeneration != 0) && (generation > encoder->statsGeneration + 1))
+		stats->droppedFrames += generation - encoder->statsGeneration - 1;
+	if (generation > encoder->statsGeneration)
+		encoder->statsGeneration = generation;
+
+	if (now >= captured)
+		stats->captureToEncode =
+		    shadow_encoder_stats_average(stats->captureToEncode, (now - captured) / 1000);
+	LeaveCriticalSection(&encoder->statsLock);
+}
+
+void shadow_encoder_stats_encode(rdpShadowEncoder* encoder, UINT64 encodeTime, size_t bytes)
+{
+	WINPR_ASSERT(encoder);
+
+	EnterCriticalSection(&encoder->statsLock);
+	SHADOW_CLIENT_STATS* stats = &encoder->stats;
+
+	stats->frames++;
+	stats->bytes += bytes;
+	stats->frameBytes = shadow_encoder_stats_average(stats->frameBytes, bytes);
+
+	for (size_t x = 0; x < SHADOW_CLIENT_STATS_CODECS; x++)
+	{
+		if ((encoder->statsCodecs & (1u << x)) == 0)
+			continue;
+
+		stats->codecFrames[x]++;
+		stats->codecEncodeTime[x] =
+		    shadow_encoder_stats_average(stats->codecEncodeTime[x], encodeTime / 1000);
+	}
+	LeaveCriticalSection(&encoder->statsLock);
+}
+
+void shadow_encoder_get_stats(rdpShadowEncoder* encoder, SHADOW_CLIENT_STATS* stats)
+{
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(stats);
+
+	EnterCriticalSection(&encoder->statsLock);
+	*stats = encoder->stats;
+	LeaveCriticalSection(&encoder->statsLock);
+
+	stats->inflightFrames = shadow_encoder_inflight_frames(encoder);
+	stats->ackLatency = encoder->ackLatency;
+}
+
+void shadow_encoder_mark_lossy(rdpShadowEncoder* encoder, const RECTANGLE_16* rect)
+{
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(rect);
+
+	if (!encoder->lossyTiles || (rect->right <= rect->left) || (rect->bottom <= rect->top))
+		return;
+
+	const UINT32 x0 = rect->left / encoder->maxTileWidth;
+	const UINT32 y0 = rect->top / encoder->maxTileHeight;
+	const UINT32 x1 = MIN(encoder->gridWidth, (rect->right + encoder->maxTileWidth - 1) /
+	                                              encoder->maxTileWidth);
+	const UINT32 y1 = MIN(encoder->gridHeight, (rect->bottom + encoder->maxTileHeight - 1) /
+	                                               encoder->maxTileHeight);
+
+	for (UINT32 y = y0; y < y1; y++)
+	{
+		for (UINT32 x = x0; x < x1; x++)
+		{
+			BYTE* tile = &encoder->lossyTiles[1ull * y * encoder->gridWidth + x];
+			if (!*tile)
+				encoder->lossyCount++;
+			*tile = 1;
+		}
+	}
+
+	encoder->lossyTime = GetTickCount64();
+}
+
+void shadow_encoder_mark_lossless(rdpShadowEncoder* encoder, const RECTANGLE_16* rect)
+{
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(rect);
+
+	if (!encoder->lossyTiles || (encoder->lossyCount == 0))
+		return;
+
+	/* Edge tiles of the grid are cut at the screen border */
+	const UINT32 x0 = (rect->left + encoder->maxTileWidth - 1) / encoder->maxTileWidth;
+	const UINT32 y0 = (rect->top + encoder->maxTileHeight - 1) / encoder->maxTileHeight;
+	const UINT32 x1 = (rect->right >= encoder->width) ? encoder->gridWidth
+	                                                  : rect->right / encoder->maxTileWidth;
+	const UINT32 y1 = (rect->bottom >= encoder->height) ? encoder->gridHeight
+	                                                    : rect->bottom / encoder->maxTileHeight;
+
+	for (UINT32 y = y0; y < MIN(y1, encoder->gridHeight); y++)
+	{
+		for (UINT32 x = x0; x < MIN(x1, encoder->gridWidth); x++)
+		{
+			BYTE* tile = &encoder->lossyTiles[1ull * y * encoder->gridWidth + x];
+			if (*tile)
+				encoder->lossyCount--;
+			*tile = 0;
+		}
+	}
+}
+
+BOOL shadow_encoder_take_lossy_region(rdpShadowEncoder* encoder, REGION16* region)
+{
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(region);
+
+	for (UINT32 y = 0; (y < encoder->gridHeight) && (encoder->lossyCount > 0); y++)
+	{
+		for (UINT32 x = 0; x < encoder->gridWidth; x++)
+		{
+			BYTE* tile = &encoder->lossyTiles[1ull * y * encoder->gridWidth + x];
+			if (!*tile)
+				continue;
+
+			const RECTANGLE_16 rect = {
+				(UINT16)(x * encoder->maxTileWidth), (UINT16)(y * encoder->maxTileHeight),
+				(UINT16)MIN(encoder->width, (x + 1) * encoder->maxTileWidth),
+				(UINT16)MIN(encoder->height, (y + 1) * encoder->maxTileHeight)
+			};
+
+			*tile = 0;
+			encoder->lossyCount--;
+			if (!region16_union_rect(region, region, &rect))
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+void shadow_encoder_set_bandwidth(rdpShadowEncoder* encoder, UINT32 bandwidth)
+{
+	WINPR_ASSERT(encoder);
+
+	if (encoder->bandwidth == 0)
+		encoder->bandwidth = bandwidth;
+	else
+		encoder->bandwidth = (UINT32)((3ULL * encoder->bandwidth + bandwidth) / 4);
+}
+
+static UINT32 shadow_encoder_codec_level(UINT32 codec)
+{
+	/* Ordered by the bandwidth the codec needs for the same screen content */
+	switch (codec)
+	{
+		case FREERDP_CODEC_AVC444:
+		case FREERDP_CODEC_AVC420:
+			return 0;
+		case FREERDP_CODEC_PROGRESSIVE:
+			return 1;
+		case FREERDP_CODEC_REMOTEFX:
+			return 2;
+		case FREERDP_CODEC_PLANAR:
+		default:
+			return 3;
+	}
+}
+
+static UINT32 shadow_encoder_codec_for_level(UINT32 supported, UINT32 preferred, UINT32 level)
+{
+	static const UINT32 ladder[] = { FREERDP_CODEC_AVC444, FREERDP_CODEC_AVC420,
+		                             FREERDP_CODEC_PROGRESSIVE, FREERDP_CODEC_REMOTEFX };
+
+	/* Keep the statically preferred codec if it is on the requested level */
+	if (shadow_encoder_codec_level(preferred) == level)
+		return preferred;
+
+	/* Otherwise the cheapest supported codec at or above the requested level... */
+	for (size_t x = 0; x < ARRAYSIZE(ladder); x++)
+	{
+		const UINT32 codec = ladder[x];
+		if ((supported & codec) && (shadow_encoder_codec_level(codec) >= level))
+			return codec;
+	}
+
+	/* ...or the most bandwidth efficient one below it */
+	for (size_t x = 0; x < ARRAYSIZE(ladder); x++)
+	{
+		if (supported & ladder[x])
+			return ladder[x];
+	}
+
+	return preferred;
+}
+
+static void shadow_encoder_probe_network(rdpShadowEncoder* encoder, UINT64 now)
+{
+	rdpContext* context = (rdpContext*)encoder->client;
+	WINPR_ASSERT(context);
+
+	if (!freerdp_settings_get_bool(context->settings, FreeRDP_NetworkAutoDetect))
+		return;
+
+	rdpAutoDetect* autodetect = autodetect_get(context);
+	if (!autodetect)
+		return;
+
+	if (now - encoder->lastRttProbe >= 2000)
+	{
+		encoder->lastRttProbe = now;
+		IFCALL(autodetect->RTTMeasureRequest, autodetect, RDP_TRANSPORT_TCP,
+		       encoder->probeSequence++);
+	}
+
+	/* A continuous bandwidth measurement covers the traffic between start and stop */
+	if (encoder->lastBandwidthProbe == 0)
+	{
+		if (IFCALLRESULT(FALSE, autodetect->BandwidthMeasureStart, autodetect, RDP_TRANSPORT_TCP,
+		                 encoder->probeSequence))
+			encoder->lastBandwidthProbe = now;
+	}
+	else if (now - encoder->lastBandwidthProbe >= 1000)
+	{
+		encoder->lastBandwidthProbe = 0;
+		IFCALL(autodetect->BandwidthMeasureStop, autodetect, RDP_TRANSPORT_TCP,
+		       encoder->probeSequence++, 0);
+	}
+}
+
+static void shadow_encoder_update_bitrate(rdpShadowEncoder* encoder, BOOL congested, BOOL idle)
+{
+	const UINT32 minBitRate = 500000;
+	UINT32 maxBitRate = encoder->server->h264BitRate;
+
+	/* Leave some headroom for the other channels */
+	if (encoder->bandwidth > 0)
+		maxBitRate = (UINT32)MIN(maxBitRate, 600ULL * encoder->bandwidth);
+	maxBitRate = MAX(maxBitRate, minBitRate);
+
+	UINT32 bitRate = encoder->h264BitRate ? encoder->h264BitRate : maxBitRate;
+
+	if (congested)
+		bitRate = bitRate / 4 * 3;
+	else if (idle)
+		bitRate = bitRate / 10 * 11;
+
+	bitRate = MAX(minBitRate, MIN(maxBitRate, bitRate));
+
+	if (bitRate == encoder->h264BitRate)
+		return;
+
+	encoder->h264BitRate = bitRate;
+
+	if (encoder->h264)
+		h264_context_set_option(encoder->h264, H264_CONTEXT_OPTION_BITRATE, bitRate);
+}
+
+UINT32 shadow_encoder_select_codec(rdpShadowEncoder* encoder, UINT32 supported, UINT32 preferred)
+{
+	WINPR_ASSERT(encoder);
+	WINPR_ASSERT(encoder->server);
+
+	if (!encoder->server->adaptiveCodec)
+		return preferred;
+
+	const UINT64 now = GetTickCount64();
+	shadow_encoder_probe_network(encoder, now);
+
+	if (encoder->codec == 0)
+	{
+		encoder->codec = preferred;
+		encoder->lastSwitch = now;
+	}
+
+	/* The continuous estimate includes the TCP_INFO of the socket between two probes */
+	rdpNetworkEstimate estimate = { 0 };
+	rdpAutoDetect* autodetect = autodetect_get((rdpContext*)encoder->client);
+	UINT32 rtt = autodetect ? autodetect->netCharAverageRTT : 0;
+	if (freerdp_network_estimate_get((rdpContext*)encoder->client, &estimate) &&
+	    (estimate.flags & FREERDP_NETWORK_ESTIMATE_RTT))
+		rtt = estimate.smoothedRTT;
+
+	/* Time a frame spends queued on top of the network round trip */
+	const UINT32 queueing = (encoder->ackLatency > rtt) ? encoder->ackLatency - rtt : 0;
+	const BOOL congested = (encoder->ackLatency > 0) && (queueing > 100);
+	const BOOL idle = (encoder->ackLatency > 0) && (queueing < 20);
+
+	const UINT32 current = shadow_encoder_codec_level(encoder->codec);
+	UINT32 level = shadow_encoder_codec_level(preferred);
+
+	if (encoder->bandwidth > 0)
+	{
+		/* kbit/s thresholds for a full screen update at a usable frame rate */
+		if (encoder->bandwidth >= 100000)
+			level = 2;
+		else if (encoder->bandwidth >= 20000)
+			level = 1;
+		else
+			level = 0;
+	}
+
+	if (congested)
+		level = (current > 0) ? MIN(level, current - 1) : 0;
+	else if (!idle)
+		level = MIN(level, current);
+
+	const UINT32 candidate = shadow_encoder_codec_for_level(supported, preferred, level);
+
+	if (candidate == encoder->codec)
+		encoder->candidateCount = 0;
+	else if (candidate != encoder->candidate)
+	{
+		encoder->candidate = candidate;
+		encoder->candidateCount = 1;
+	}
+	else
+		encoder->candidateCount++;
+
+	/* Require a stable decision and a minimum dwell time to avoid oscillating */
+	if ((encoder->candidateCount >= 3) && (now - encoder->lastSwitch >= 5000))
+	{
+		WLog_DBG(TAG, "switching codec 0x%08" PRIx32 " -> 0x%08" PRIx32 " [bw=%" PRIu32
+		         "kbps rtt=%" PRIu32 "ms ack=%" PRIu32 "ms]",
+		         encoder->codec, candidate, encoder->bandwidth, rtt, encoder->ackLatency);
+
+		/* Stateful encoders restart with a key frame when used again */
+		if ((encoder->codec == FREERDP_CODEC_AVC420) || (encoder->codec == FREERDP_CODEC_AVC444))
+			shadow_encoder_uninit_h264(encoder);
+		else if (encoder->codec == FREERDP_CODEC_PROGRESSIVE)
+			shadow_encoder_uninit_progressive(encoder);
+
+		encoder->codec = candidate;
+		encoder->candidateCount = 0;
+		encoder->lastSwitch = now;
+	}
+
+	if (shadow_encoder_codec_level(encoder->codec) == 0)
+		shadow_encoder_update_bitrate(encoder, congested, idle);
+
+	return encoder->codec;
+}
+
 static int shadow_encoder_init_grid(rdpShadowEncoder* encoder)
 {
 	UINT32 tileSize = 0;
@@ -97,6 +485,12 @@ static int shadow_encoder_init_grid(rdpShadowEncoder* encoder)
 	if (!encoder->grid)
 		return -1;
 
+	encoder->lossyTiles = (BYTE*)calloc(tileCount, sizeof(BYTE));
+	encoder->lossyCount = 0;
+
+	if (!encoder->lossyTiles)
+		return -1;
+
 	for (UINT32 i = 0; i < encoder->gridHeight; i++)
 	{
 		for (UINT32 j = 0; j < encoder->gridWidth; j++)
@@ -123,6 +517,10 @@ static int shadow_encoder_uninit_grid(rdpShadowEncoder* encoder)
 		encoder->grid = NULL;
 	}
 
+	free(encoder->lossyTiles);
+	encoder->lossyTiles = NULL;
+	encoder->lossyCount = 0;
+
 	encoder->gridWidth = 0;
 	encoder->gridHeight = 0;
 	return 0;
@@ -130,6 +528,10 @@ static int shadow_encoder_uninit_grid(rdpShadowEncoder* encoder)
 
 static int shadow_encoder_init_rfx(rdpShadowEncoder* encoder)
 {
+	if (!encoder->rfx)
+		encoder->rfx = shadow_codec_pool_take(encoder->server->codecPool, FREERDP_CODEC_REMOTEFX,
+		                                      encoder->width, encoder->height, 0);
+
 	if (!encoder->rfx)
 		encoder->rfx = rfx_context_new_ex(
 		    TRUE, freerdp_settings_get_uint32(encoder->server->settings, FreeRDP_ThreadingFlags));
@@ -143,6 +545,8 @@ static int shadow_encoder_init_rfx(rdpShadowEncoder* encoder)
 	rfx_context_set_mode(encoder->rfx, freerdp_settings_get_uint32(encoder->server->settings,
 	                                                               FreeRDP_RemoteFxRlgrMode));
 	rfx_context_set_pixel_format(encoder->rfx, PIXEL_FORMAT_BGRX32);
+	if (!rfx_context_set_adaptive_quantization(encoder->rfx, TRUE))
+		goto fail;
 	encoder->codecs |= FREERDP_CODEC_REMOTEFX;
 	return 1;
 fail:
@@ -155,6 +559,10 @@ static int shadow_encoder_init_nsc(rdpShadowEncoder* encoder)
 	rdpContext* context = (rdpContext*)encoder->client;
 	rdpSettings* settings = context->settings;
 
+	if (!encoder->nsc)
+		encoder->nsc = shadow_codec_pool_take(encoder->server->codecPool, FREERDP_CODEC_NSCODEC,
+		                                      encoder->width, encoder->height, 0);
+
 	if (!encoder->nsc)
 		encoder->nsc = nsc_context_new();
 
@@ -195,11 +603,18 @@ static int shadow_encoder_init_planar(rdpShadowEncoder* encoder)
 		planarFlags |= PLANAR_FORMAT_HEADER_NA;
 
 	planarFlags |= PLANAR_FORMAT_HEADER_RLE;
+	encoder->planarFlags = planarFlags;
+
+	if (!encoder->planar)
+		encoder->planar =
+		    shadow_codec_pool_take(encoder->server->codecPool, FREERDP_CODEC_PLANAR,
+		                           encoder->maxTileWidth, encoder->maxTileHeight, planarFlags);
 
 	if (!encoder->planar)
 	{
-		encoder->planar = freerdp_bitmap_planar_context_new(planarFlags, encoder->maxTileWidth,
-		                                                    encoder->maxTileHeight);
+		encoder->planar = freerdp_bitmap_planar_context_new_ex(
+		    planarFlags, encoder->maxTileWidth, encoder->maxTileHeight,
+		    freerdp_settings_get_uint32(settings, FreeRDP_ThreadingFlags));
 	}
 
 	if (!encoder->planar)
@@ -209,15 +624,50 @@ static int shadow_encoder_init_planar(rdpShadowEncoder* encoder)
 	                                         encoder->maxTileHeight))
 		goto fail;
 
+	if (encoder->planarBandCount == 0)
+	{
+		const UINT32 flags = freerdp_settings_get_uint32(settings, FreeRDP_ThreadingFlags);
+		SYSTEM_INFO sysinfo = { 0 };
+
+		GetNativeSystemInfo(&sysinfo);
+		const UINT32 bands = (flags & THREADING_FLAGS_DISABLE_THREADS)
+		                         ? 1
+		                         : MIN(sysinfo.dwNumberOfProcessors, SHADOW_ENCODER_MAX_BANDS);
+
+		/* A single band is encoded with encoder->planar directly */
+		if (bands > 1)
+		{
+			for (UINT32 x = 0; x < bands; x++)
+			{
+				encoder->planarBands[x] = freerdp_bitmap_planar_context_new(
+				    planarFlags, encoder->maxTileWidth, encoder->maxTileHeight);
+				if (!encoder->planarBands[x])
+					goto fail;
+				encoder->planarBandCount++;
+			}
+		}
+	}
+
 	encoder->codecs |= FREERDP_CODEC_PLANAR;
 	return 1;
 fail:
 	freerdp_bitmap_planar_context_free(encoder->planar);
+	encoder->planar = NULL;
+	for (UINT32 x = 0; x < encoder->planarBandCount; x++)
+	{
+		freerdp_bitmap_planar_context_free(encoder->planarBands[x]);
+		encoder->planarBands[x] = NULL;
+	}
+	encoder->planarBandCount = 0;
 	return -1;
 }
 
 static int shadow_encoder_init_interleaved(rdpShadowEncoder* encoder)
 {
+	if (!encoder->interleaved)
+		encoder->interleaved = shadow_codec_pool_take(encoder->server->codecPool,
+		                                              FREERDP_CODEC_INTERLEAVED, 0, 0, 0);
+
 	if (!encoder->interleaved)
 		encoder->interleaved = bitmap_interleaved_context_new(TRUE);
 
@@ -236,6 +686,10 @@ fail:
 
 static int shadow_encoder_init_h264(rdpShadowEncoder* encoder)
 {
+	if (!encoder->h264)
+		encoder->h264 = shadow_codec_pool_take(encoder->server->codecPool, FREERDP_CODEC_AVC420,
+		                                       encoder->width, encoder->height, 0);
+
 	if (!encoder->h264)
 		encoder->h264 = h264_context_new(TRUE);
 
@@ -249,7 +703,8 @@ static int shadow_encoder_init_h264(rdpShadowEncoder* encoder)
 	                             encoder->server->h264RateControlMode))
 		goto fail;
 	if (!h264_context_set_option(encoder->h264, H264_CONTEXT_OPTION_BITRATE,
-	                             encoder->server->h264BitRate))
+	                             encoder->h264BitRate ? encoder->h264BitRate
+	                                                  : encoder->server->h264BitRate))
 		goto fail;
 	if (!h264_context_set_option(encoder->h264, H264_CONTEXT_OPTION_FRAMERATE,
 	                             encoder->server->h264FrameRate))
@@ -267,6 +722,10 @@ fail:
 static int shadow_encoder_init_progressive(rdpShadowEncoder* encoder)
 {
 	WINPR_ASSERT(encoder);
+	if (!encoder->progressive)
+		encoder->progressive = shadow_codec_pool_take(encoder->server->codecPool,
+		                                              FREERDP_CODEC_PROGRESSIVE, 0, 0, 0);
+
 	if (!encoder->progressive)
 		encoder->progressive = progressive_context_new(TRUE);
 
@@ -304,7 +763,8 @@ static int shadow_encoder_uninit_rfx(rdpShadowEncoder* encoder)
 {
 	if (encoder->rfx)
 	{
-		rfx_context_free(encoder->rfx);
+		shadow_codec_pool_put(encoder->server->codecPool, FREERDP_CODEC_REMOTEFX, encoder->width,
+		                      encoder->height, 0, encoder->rfx);
 		encoder->rfx = NULL;
 	}
 
@@ -316,7 +776,8 @@ static int shadow_encoder_uninit_nsc(rdpShadowEncoder* encoder)
 {
 	if (encoder->nsc)
 	{
-		nsc_context_free(encoder->nsc);
+		shadow_codec_pool_put(encoder->server->codecPool, FREERDP_CODEC_NSCODEC, encoder->width,
+		                      encoder->height, 0, encoder->nsc);
 		encoder->nsc = NULL;
 	}
 
@@ -328,10 +789,19 @@ static int shadow_encoder_uninit_planar(rdpShadowEncoder* encoder)
 {
 	if (encoder->planar)
 	{
-		freerdp_bitmap_planar_context_free(encoder->planar);
+		shadow_codec_pool_put(encoder->server->codecPool, FREERDP_CODEC_PLANAR,
+		                      encoder->maxTileWidth, encoder->maxTileHeight, encoder->planarFlags,
+		                      encoder->planar);
 		encoder->planar = NULL;
 	}
 
+	for (UINT32 x = 0; x < encoder->planarBandCount; x++)
+	{
+		freerdp_bitmap_planar_context_free(encoder->planarBands[x]);
+		encoder->planarBands[x] = NULL;
+	}
+	encoder->planarBandCount = 0;
+
 	encoder->codecs &= (UINT32)~FREERDP_CODEC_PLANAR;
 	return 1;
 }
@@ -340,7 +810,8 @@ static int shadow_encoder_uninit_interleaved(rdpShadowEncoder* encoder)
 {
 	if (encoder->interleaved)
 	{
-		bitmap_interleaved_context_free(encoder->interleaved);
+		shadow_codec_pool_put(encoder->server->codecPool, FREERDP_CODEC_INTERLEAVED, 0, 0, 0,
+		                      encoder->interleaved);
 		encoder->interleaved = NULL;
 	}
 
@@ -352,7 +823,8 @@ static int shadow_encoder_uninit_h264(rdpShadowEncoder* encoder)
 {
 	if (encoder->h264)
 	{
-		h264_context_free(encoder->h264);
+		shadow_codec_pool_put(encoder->server->codecPool, FREERDP_CODEC_AVC420, encoder->width,
+		                      encoder->height, 0, encoder->h264);
 		encoder->h264 = NULL;
 	}
 
@@ -365,7 +837,8 @@ static int shadow_encoder_uninit_progressive(rdpShadowEncoder* encoder)
 	WINPR_ASSERT(encoder);
 	if (encoder->progressive)
 	{
-		progressive_context_free(encoder->progressive);
+		shadow_codec_pool_put(encoder->server->codecPool, FREERDP_CODEC_PROGRESSIVE, 0, 0, 0,
+		                      encoder->progressive);
 		encoder->progressive = NULL;
 	}
 
@@ -377,6 +850,9 @@ static int shadow_encoder_uninit(rdpShadowEncoder* encoder)
 {
 	shadow_encoder_uninit_grid(encoder);
 
+	shadow_gfx_cache_free(encoder->gfxCache);
+	encoder->gfxCache = NULL;
+
 	if (encoder->bs)
 	{
 		Stream_Free(encoder->bs, TRUE);
@@ -430,6 +906,8 @@ int shadow_encoder_prepare(rdpShadowEncoder* encoder, UINT32 codecs)
 {
 	int status = 0;
 
+	encoder->statsCodecs |= codecs;
+
 	if ((codecs & FREERDP_CODEC_REMOTEFX) && !(encoder->codecs & FREERDP_CODEC_REMOTEFX))
 	{
 		WLog_DBG(TAG, "initializing RemoteFX encoder");
@@ -501,9 +979,11 @@ rdpShadowEncoder* shadow_encoder_new(rdpShadowClient* client)
 	encoder->server = server;
 	encoder->fps = 16;
 	encoder->maxFps = 32;
+	InitializeCriticalSection(&encoder->statsLock);
 
 	if (shadow_encoder_init(encoder) < 0)
 	{
+		DeleteCriticalSection(&encoder->statsLock);
 		free(encoder);
 		return NULL;
 	}
@@ -517,5 +997,6 @@ void shadow_encoder_free(rdpShadowEncoder* encoder)
 		return;
 
 	shadow_encoder_uninit(encoder);
+	DeleteCriticalSection(&encoder->statsLock);
 	free(encoder);
 }
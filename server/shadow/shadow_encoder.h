@@ -27,6 +27,11 @@
 
 #include <freerdp/server/shadow.h>
 
+#include "shadow_gfx_cache.h"
+
+#define SHADOW_ENCODER_ACK_HISTORY 32
+#define SHADOW_ENCODER_MAX_BANDS 8
+
 struct rdp_shadow_encoder
 {
 	rdpShadowClient* client;
@@ -52,12 +57,43 @@ struct rdp_shadow_encoder
 	H264_CONTEXT* h264;
 	PROGRESSIVE_CONTEXT* progressive;
 
+	/* Planar contexts for encoding horizontal bands of a GFX frame in parallel */
+	BITMAP_PLANAR_CONTEXT* planarBands[SHADOW_ENCODER_MAX_BANDS];
+	UINT32 planarBandCount;
+	UINT32 planarFlags;
+
+	rdpShadowGfxCache* gfxCache;
+
 	UINT32 fps;
 	UINT32 maxFps;
 	BOOL frameAck;
 	UINT32 frameId;
 	UINT32 lastAckframeId;
 	UINT32 queueDepth;
+
+	/* Network adaptation, see shadow_encoder_select_codec */
+	UINT64 frameSentTime[SHADOW_ENCODER_ACK_HISTORY];
+	UINT32 ackLatency;
+	UINT32 bandwidth;
+	UINT32 h264BitRate;
+	UINT32 codec;
+	UINT32 candidate;
+	UINT32 candidateCount;
+	UINT64 lastSwitch;
+	UINT64 lastRttProbe;
+	UINT64 lastBandwidthProbe;
+	UINT16 probeSequence;
+
+	/* Statistics, see shadow_client_get_stats */
+	CRITICAL_SECTION statsLock;
+	SHADOW_CLIENT_STATS stats;
+	UINT32 statsCodecs; /* codecs prepared while encoding the current frame */
+	UINT64 statsGeneration;
+
+	/* Grid tiles last sent with a lossy codec, refined once idle */
+	BYTE* lossyTiles;
+	UINT32 lossyCount;
+	UINT64 lossyTime;
 };
 
 #ifdef __cplusplus
@@ -68,6 +104,23 @@ extern "C"
 	int shadow_encoder_reset(rdpShadowEncoder* encoder);
 	int shadow_encoder_prepare(rdpShadowEncoder* encoder, UINT32 codecs);
 	UINT32 shadow_encoder_create_frame_id(rdpShadowEncoder* encoder);
+	void shadow_encoder_frame_acknowledged(rdpShadowEncoder* encoder, UINT32 frameId);
+	void shadow_encoder_set_bandwidth(rdpShadowEncoder* encoder, UINT32 bandwidth);
+	UINT32 shadow_encoder_select_codec(rdpShadowEncoder* encoder, UINT32 supported,
+	                                   UINT32 preferred);
+
+	/* Account a published capture of the given generation and time (ns) taken for encoding */
+	void shadow_encoder_stats_capture(rdpShadowEncoder* encoder, UINT64 generation,
+	                                  UINT64 captured);
+	/* Account an encoded and sent frame, encodeTime in ns */
+	void shadow_encoder_stats_encode(rdpShadowEncoder* encoder, UINT64 encodeTime, size_t bytes);
+	void shadow_encoder_get_stats(rdpShadowEncoder* encoder, SHADOW_CLIENT_STATS* stats);
+
+	/* Track the quality of the grid tiles, lossless only clears fully covered tiles */
+	void shadow_encoder_mark_lossy(rdpShadowEncoder* encoder, const RECTANGLE_16* rect);
+	void shadow_encoder_mark_lossless(rdpShadowEncoder* encoder, const RECTANGLE_16* rect);
+	/* Move the lossy tiles to region, all tiles are lossless afterwards */
+	BOOL shadow_encoder_take_lossy_region(rdpShadowEncoder* encoder, REGION16* region);
 
 	void shadow_encoder_free(rdpShadowEncoder* encoder);
 
@@ -0,0 +1,826 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+
+#include <freerdp/log.h>
+
+#include "shadow_capture.h"
+#include "shadow_gfx_cache.h"
+
+#define TAG SERVER_TAG("shadow.gfxcache")
+
+#define SHADOW_GFX_CACHE_TILE 64
+
+/* Limit the SurfaceToCache PDUs sent per frame, stable content is stored over time */
+#define SHADOW_GFX_CACHE_MAX_STORES 64
+
+typedef struct
+{
+	UINT64 key;
+	UINT16 slot;
+} SHADOW_GFX_CACHE_ENTRY;
+
+/* Copy of the tile stored in a client cache slot, keys are only compared as a shortcut */
+typedef struct
+{
+	UINT32 width;
+	UINT32 height;
+	BYTE* pixels; /* SHADOW_GFX_CACHE_TILE * 4 bytes per line */
+} SHADOW_GFX_CACHE_SLOT;
+
+struct rdp_shadow_gfx_cache
+{
+	/* Client cache slots, 1-based like in the protocol */
+	UINT32 maxSlots;
+	UINT64* slotKeys;
+	BYTE* slotRefs;
+	SHADOW_GFX_CACHE_SLOT* slots;
+	UINT32 hand;
+
+	/* Open addressing map from tile key to slot */
+	SHADOW_GFX_CACHE_ENTRY* table;
+	UINT32 tableMask;
+
+	/* Key of the content currently shown on the client surface per tile */
+	UINT32 width;
+	UINT32 height;
+	UINT32 gridWidth;
+	UINT32 gridHeight;
+	UINT64* tileKeys;
+	BYTE* tileSolid;
+	UINT32* tileColor;
+
+	/* The frame content the client surface shows, to confirm what the keys suggest */
+	BYTE* shown;
+
+	/* Line hashes of the current and the previous frame for motion detection,
+	 * rows per 64 pixel column band and columns per 64 pixel row band */
+	UINT64* rowKeys[2];
+	UINT64* colKeys[2];
+	UINT32 current;
+	BOOL previousValid;
+	UINT64 generation; /* of the previous frame, 0 if unknown */
+	RDPGFX_SURFACE_TO_SURFACE_PDU moves[SHADOW_SURFACE_MAX_MOVES];
+	RDPGFX_POINT16 movePts[SHADOW_SURFACE_MAX_MOVES];
+	RECTANGLE_16 moved[SHADOW_SURFACE_MAX_MOVES];
+
+	RDPGFX_SOLID_FILL_PDU* fills;
+	RECTANGLE_16* fillRects;
+	RDPGFX_CACHE_TO_SURFACE_PDU* copies;
+	RDPGFX_POINT16* copyPts;
+	RDPGFX_SURFACE_TO_CACHE_PDU* stores;
+
+	UINT64 hits;
+	UINT64 fillCount;
+	UINT64 moveCount;
+};
+
+static UINT32 table_index(const rdpShadowGfxCache* cache, UINT64 key)
+{
+	return (UINT32)(key ^ (key >> 32)) & cache->tableMask;
+}
+
+static UINT16 table_get(const rdpShadowGfxCache* cache, UINT64 key)
+{
+	for (UINT32 i = table_index(cache, key);; i = (i + 1) & cache->tableMask)
+	{
+		const SHADOW_GFX_CACHE_ENTRY* entry = &cache->table[i];
+		if (entry->key == 0)
+			return 0;
+		if (entry->key == key)
+			return entry->slot;
+	}
+}
+
+static void table_put(rdpShadowGfxCache* cache, UINT64 key, UINT16 slot)
+{
+	UINT32 i = table_index(cache, key);
+
+	while ((cache->table[i].key != 0) && (cache->table[i].key != key))
+		i = (i + 1) & cache->tableMask;
+
+	cache->table[i].key = key;
+	cache->table[i].slot = slot;
+}
+
+static void table_remove(rdpShadowGfxCache* cache, UINT64 key)
+{
+	UINT32 i = table_index(cache, key);
+
+	while (cache->table[i].key != key)
+	{
+		if (cache->table[i].key == 0)
+			return;
+		i = (i + 1) & cache->tableMask;
+	}
+
+	/* Backward shift deletion keeps the probe sequences intact without tombstones */
+	for (UINT32 j = (i + 1) & cache->tableMask; cache->table[j].key != 0;
+	     j = (j + 1) & cache->tableMask)
+	{
+		const UINT32 home = table_index(cache, cache->table[j].key);
+		const BOOL movable = (i <= j) ? ((home <= i) || (home > j)) : ((home <= i) && (home > j));
+
+		if (movable)
+		{
+			cache->table[i] = cache->table[j];
+			i = j;
+		}
+	}
+
+	cache->table[i].key = 0;
+	cache->table[i].slot = 0;
+}
+
+/* Compare two 32bpp tiles ignoring the alpha byte like the keys do */
+static BOOL tile_equal(const BYTE* WINPR_RESTRICT a, UINT32 aStep, const BYTE* WINPR_RESTRICT b,
+                       UINT32 bStep, UINT32 width, UINT32 height)
+{
+	const UINT64 mask = 0x00FFFFFF00FFFFFFULL;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* rowA = &a[1ULL * y * aStep];
+		const BYTE* rowB = &b[1ULL * y * bStep];
+		UINT64 diff = 0;
+		UINT32 x = 0;
+
+		for (; x + 2 <= width; x += 2)
+		{
+			UINT64 pa = 0;
+			UINT64 pb = 0;
+			memcpy(&pa, &rowA[4ULL * x], sizeof(pa));
+			memcpy(&pb, &rowB[4ULL * x], sizeof(pb));
+			diff |= (pa ^ pb) & mask;
+		}
+
+		for (; x < width; x++)
+		{
+			UINT32 pa = 0;
+			UINT32 pb = 0;
+			memcpy(&pa, &rowA[4ULL * x], sizeof(pa));
+			memcpy(&pb, &rowB[4ULL * x], sizeof(pb));
+			diff |= (pa ^ pb) & 0x00FFFFFF;
+		}
+
+		if (diff != 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* TRUE if the client surface shows the tile at (x, y) of its last content */
+static BOOL tile_shown(const rdpShadowGfxCache* cache, const BYTE* pSrcData, UINT32 nSrcStep,
+                       const RECTANGLE_16* tile, UINT32 x, UINT32 y)
+{
+	const UINT32 step = cache->width * 4;
+
+	return tile_equal(&pSrcData[1ULL * tile->top * nSrcStep + 4ULL * tile->left], nSrcStep,
+	                  &cache->shown[1ULL * y * step + 4ULL * x], step, tile->right - tile->left,
+	                  tile->bottom - tile->top);
+}
+
+static BOOL slot_equal(const rdpShadowGfxCache* cache, UINT16 slot, const BYTE* pSrcData,
+                       UINT32 nSrcStep, const RECTANGLE_16* tile)
+{
+	const SHADOW_GFX_CACHE_SLOT* entry = &cache->slots[slot];
+	const UINT32 width = tile->right - tile->left;
+	const UINT32 height = tile->bottom - tile->top;
+
+	if (!entry->pixels || (entry->width != width) || (entry->height != height))
+		return FALSE;
+
+	return tile_equal(&pSrcData[1ULL * tile->top * nSrcStep + 4ULL * tile->left], nSrcStep,
+	                  entry->pixels, SHADOW_GFX_CACHE_TILE * 4, width, height);
+}
+
+/* Clock (second chance) replacement of the client cache slots, 0 if out of memory */
+static UINT16 cache_insert(rdpShadowGfxCache* cache, UINT64 key, const BYTE* pSrcData,
+                           UINT32 nSrcStep, const RECTANGLE_16* tile)
+{
+	for (;;)
+	{
+		const UINT32 slot = cache->hand + 1;
+		cache->hand = (cache->hand + 1) % cache->maxSlots;
+
+		if (cache->slotRefs[slot])
+		{
+			cache->slotRefs[slot] = 0;
+			continue;
+		}
+
+		SHADOW_GFX_CACHE_SLOT* entry = &cache->slots[slot];
+		if (!entry->pixels)
+		{
+			entry->pixels = malloc(4ULL * SHADOW_GFX_CACHE_TILE * SHADOW_GFX_CACHE_TILE);
+			if (!entry->pixels)
+				return 0;
+		}
+
+		if (cache->slotKeys[slot] != 0)
+			table_remove(cache, cache->slotKeys[slot]);
+
+		entry->width = tile->right - tile->left;
+		entry->height = tile->bottom - tile->top;
+		for (UINT32 y = 0; y < entry->height; y++)
+			memcpy(&entry->pixels[4ULL * SHADOW_GFX_CACHE_TILE * y],
+			       &pSrcData[1ULL * (tile->top + y) * nSrcStep + 4ULL * tile->left],
+			       4ULL * entry->width);
+
+		cache->slotKeys[slot] = key;
+		cache->slotRefs[slot] = 1;
+		table_put(cache, key, (UINT16)slot);
+		return (UINT16)slot;
+	}
+}
+
+static INLINE UINT64 tile_mix(UINT64 h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+/* Hash the rows and columns of a 32bpp tile ignoring the alpha byte and detect single
+ * color tiles. Row hashes go to the column band of the tile, column hashes to its row band. */
+static void tile_scan(rdpShadowGfxCache* WINPR_RESTRICT cache, const BYTE* WINPR_RESTRICT pSrcData,
+                      UINT32 nSrcStep, UINT32 tx, UINT32 ty, const RECTANGLE_16* tile,
+                      BOOL* WINPR_RESTRICT solid, UINT32* WINPR_RESTRICT color)
+{
+	const UINT64 prime = 0x100000001b3ULL;
+	const UINT64 mask = 0x00FFFFFF00FFFFFFULL;
+	const UINT32 width = tile->right - tile->left;
+	const UINT32 height = tile->bottom - tile->top;
+	UINT64* rows = &cache->rowKeys[cache->current][1ULL * tx * cache->height + tile->top];
+	UINT64* cols = &cache->colKeys[cache->current][1ULL * ty * cache->width + tile->left];
+	const BYTE* src = &pSrcData[1ULL * tile->top * nSrcStep + 4ULL * tile->left];
+	UINT32 first = 0;
+	UINT64 diff = 0;
+
+	memcpy(&first, src, sizeof(first));
+	first &= 0x00FFFFFF;
+	const UINT64 first2 = ((UINT64)first << 32) | first;
+
+	for (UINT32 x = 0; x < width; x++)
+		cols[x] = 0xcbf29ce484222325ULL ^ height;
+
+	for (UINT32 y = 0; y < height; y++)
+	{
+		const BYTE* row = &src[1ULL * y * nSrcStep];
+		UINT64 h0 = 0xcbf29ce484222325ULL ^ width;
+		UINT64 h1 = 0x84222325cbf29ce4ULL;
+		UINT32 x = 0;
+
+		/* Two independent lanes to hide the multiply latency */
+		for (; x + 4 <= width; x += 4)
+		{
+			UINT64 a = 0;
+			UINT64 b = 0;
+			memcpy(&a, &row[4ULL * x], sizeof(a));
+			memcpy(&b, &row[4ULL * x + 8], sizeof(b));
+			a &= mask;
+			b &= mask;
+			diff |= (a ^ first2) | (b ^ first2);
+			h0 = (h0 ^ a) * prime;
+			h1 = (h1 ^ b) * prime;
+			cols[x] = (cols[x] ^ (a & UINT32_MAX)) * prime;
+			cols[x + 1] = (cols[x + 1] ^ (a >> 32)) * prime;
+			cols[x + 2] = (cols[x + 2] ^ (b & UINT32_MAX)) * prime;
+			cols[x + 3] = (cols[x + 3] ^ (b >> 32)) * prime;
+		}
+
+		for (; x < width; x++)
+		{
+			UINT32 p = 0;
+			memcpy(&p, &row[4ULL * x], sizeof(p));
+			p &= 0x00FFFFFF;
+			diff |= p ^ first;
+			h0 = (h0 ^ p) * prime;
+			cols[x] = (cols[x] ^ p) * prime;
+		}
+
+		rows[y] = tile_mix(h0 ^ tile_mix(h1));
+	}
+
+	for (UINT32 x = 0; x < width; x++)
+		cols[x] = tile_mix(cols[x]);
+
+	*solid = (diff == 0);
+	*color = first;
+}
+
+static UINT64 tile_key(const rdpShadowGfxCache* cache, UINT32 tx, const RECTANGLE_16* tile)
+{
+	const UINT64 prime = 0x100000001b3ULL;
+	const UINT32 width = tile->right - tile->left;
+	const UINT32 height = tile->bottom - tile->top;
+	const UINT64* rows = &cache->rowKeys[cache->current][1ULL * tx * cache->height + tile->top];
+	UINT64 h = 0xcbf29ce484222325ULL ^ (((UINT64)width << 16) | height);
+
+	for (UINT32 y = 0; y < height; y++)
+		h = (h ^ rows[y]) * prime;
+
+	h = tile_mix(h);
+	return (h != 0) ? h : 1;
+}
+
+void shadow_gfx_cache_free(rdpShadowGfxCache* cache)
+{
+	if (!cache)
+		return;
+
+	WLog_DBG(TAG, "cache hits: %" PRIu64 ", solid fills: %" PRIu64 ", moves: %" PRIu64,
+	         cache->hits, cache->fillCount, cache->moveCount);
+
+	if (cache->slots)
+	{
+		for (size_t x = 0; x <= cache->maxSlots; x++)
+			free(cache->slots[x].pixels);
+	}
+
+	free(cache->slotKeys);
+	free(cache->slotRefs);
+	free(cache->slots);
+	free(cache->table);
+	free(cache->tileKeys);
+	free(cache->tileSolid);
+	free(cache->tileColor);
+	free(cache->shown);
+	for (size_t x = 0; x < ARRAYSIZE(cache->rowKeys); x++)
+	{
+		free(cache->rowKeys[x]);
+		free(cache->colKeys[x]);
+	}
+	free(cache->fills);
+	free(cache->fillRects);
+	free(cache->copies);
+	free(cache->copyPts);
+	free(cache->stores);
+	free(cache);
+}
+
+rdpShadowGfxCache* shadow_gfx_cache_new(UINT32 maxSlots)
+{
+	if ((maxSlots == 0) || (maxSlots > UINT16_MAX))
+		return NULL;
+
+	rdpShadowGfxCache* cache = (rdpShadowGfxCache*)calloc(1, sizeof(rdpShadowGfxCache));
+	if (!cache)
+		return NULL;
+
+	UINT32 tableSize = 1;
+	while (tableSize < 2 * maxSlots)
+		tableSize <<= 1;
+
+	cache->maxSlots = maxSlots;
+	cache->tableMask = tableSize - 1;
+	cache->slotKeys = (UINT64*)calloc(maxSlots + 1ULL, sizeof(UINT64));
+	cache->slotRefs = (BYTE*)calloc(maxSlots + 1ULL, sizeof(BYTE));
+	cache->slots = (SHADOW_GFX_CACHE_SLOT*)calloc(maxSlots + 1ULL, sizeof(SHADOW_GFX_CACHE_SLOT));
+	cache->table = (SHADOW_GFX_CACHE_ENTRY*)calloc(tableSize, sizeof(SHADOW_GFX_CACHE_ENTRY));
+	cache->stores = (RDPGFX_SURFACE_TO_CACHE_PDU*)calloc(SHADOW_GFX_CACHE_MAX_STORES,
+	                                                     sizeof(RDPGFX_SURFACE_TO_CACHE_PDU));
+
+	if (!cache->slotKeys || !cache->slotRefs || !cache->slots || !cache->table || !cache->stores)
+	{
+		shadow_gfx_cache_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+static void cache_free_frame_buffers(rdpShadowGfxCache* cache)
+{
+	free(cache->tileKeys);
+	free(cache->tileSolid);
+	free(cache->tileColor);
+	free(cache->shown);
+	free(cache->fills);
+	free(cache->fillRects);
+	free(cache->copies);
+	free(cache->copyPts);
+	cache->tileKeys = NULL;
+	cache->tileSolid = NULL;
+	cache->tileColor = NULL;
+	cache->shown = NULL;
+	cache->fills = NULL;
+	cache->fillRects = NULL;
+	cache->copies = NULL;
+	cache->copyPts = NULL;
+
+	for (size_t x = 0; x < ARRAYSIZE(cache->rowKeys); x++)
+	{
+		free(cache->rowKeys[x]);
+		free(cache->colKeys[x]);
+		cache->rowKeys[x] = NULL;
+		cache->colKeys[x] = NULL;
+	}
+}
+
+BOOL shadow_gfx_cache_reset(rdpShadowGfxCache* cache, UINT32 width, UINT32 height)
+{
+	WINPR_ASSERT(cache);
+
+	if ((width > UINT16_MAX) || (height > UINT16_MAX))
+		return FALSE;
+
+	const UINT32 gridWidth = (width + SHADOW_GFX_CACHE_TILE - 1) / SHADOW_GFX_CACHE_TILE;
+	const UINT32 gridHeight = (height + SHADOW_GFX_CACHE_TILE - 1) / SHADOW_GFX_CACHE_TILE;
+	const size_t count = 1ULL * gridWidth * gridHeight;
+
+	if ((width != cache->width) || (height != cache->height))
+	{
+		cache_free_frame_buffers(cache);
+
+		cache->width = width;
+		cache->height = height;
+		cache->gridWidth = gridWidth;
+		cache->gridHeight = gridHeight;
+		cache->tileKeys = (UINT64*)calloc(count + 1, sizeof(UINT64));
+		cache->tileSolid = (BYTE*)calloc(count + 1, sizeof(BYTE));
+		cache->tileColor = (UINT32*)calloc(count + 1, sizeof(UINT32));
+		cache->shown = (BYTE*)calloc(1ULL * width * height + 1, 4);
+		cache->fills = (RDPGFX_SOLID_FILL_PDU*)calloc(count + 1, sizeof(RDPGFX_SOLID_FILL_PDU));
+		cache->fillRects = (RECTANGLE_16*)calloc(count + 1, sizeof(RECTANGLE_16));
+		cache->copies =
+		    (RDPGFX_CACHE_TO_SURFACE_PDU*)calloc(count + 1, sizeof(RDPGFX_CACHE_TO_SURFACE_PDU));
+		cache->copyPts = (RDPGFX_POINT16*)calloc(count + 1, sizeof(RDPGFX_POINT16));
+
+		BOOL allocated = cache->tileKeys && cache->tileSolid && cache->tileColor && cache->shown &&
+		                 cache->fills && cache->fillRects && cache->copies && cache->copyPts;
+		for (size_t x = 0; x < ARRAYSIZE(cache->rowKeys); x++)
+		{
+			cache->rowKeys[x] = (UINT64*)calloc(1ULL * gridWidth * height + 1, sizeof(UINT64));
+			cache->colKeys[x] = (UINT64*)calloc(1ULL * gridHeight * width + 1, sizeof(UINT64));
+			allocated = allocated && cache->rowKeys[x] && cache->colKeys[x];
+		}
+
+		if (!allocated)
+		{
+			cache_free_frame_buffers(cache);
+			cache->width = 0;
+			cache->height = 0;
+			cache->gridWidth = 0;
+			cache->gridHeight = 0;
+			return FALSE;
+		}
+	}
+	else
+		memset(cache->tileKeys, 0, count * sizeof(UINT64));
+
+	memset(cache->slotKeys, 0, (cache->maxSlots + 1ULL) * sizeof(UINT64));
+	memset(cache->slotRefs, 0, (cache->maxSlots + 1ULL) * sizeof(BYTE));
+	memset(cache->table, 0, (cache->tableMask + 1ULL) * sizeof(SHADOW_GFX_CACHE_ENTRY));
+	cache->hand = 0;
+	cache->previousValid = FALSE;
+	cache->generation = 0;
+	return TRUE;
+}
+
+static void cache_add_fill(rdpShadowGfxCache* cache, UINT16 surfaceId, SHADOW_GFX_CACHE_FRAME* frame,
+                           const RECTANGLE_16* tile, UINT32 color)
+{
+	const RDPGFX_COLOR32 pixel = { (BYTE)(color & 0xFF), (BYTE)((color >> 8) & 0xFF),
+		                           (BYTE)((color >> 16) & 0xFF), 0xFF };
+
+	/* Merge with the fill of the tile to the left */
+	if (frame->numFills > 0)
+	{
+		RDPGFX_SOLID_FILL_PDU* last = &frame->fills[frame->numFills - 1];
+		RECTANGLE_16* rect = last->fillRects;
+
+		if ((memcmp(&last->fillPixel, &pixel, sizeof(pixel)) == 0) &&
+		    (rect->right == tile->left) && (rect->top == tile->top) &&
+		    (rect->bottom == tile->bottom))
+		{
+			rect->right = tile->right;
+			return;
+		}
+	}
+
+	RDPGFX_SOLID_FILL_PDU* fill = &frame->fills[frame->numFills];
+	RECTANGLE_16* rect = &cache->fillRects[frame->numFills];
+	*rect = *tile;
+	fill->surfaceId = surfaceId;
+	fill->fillPixel = pixel;
+	fill->fillRectCount = 1;
+	fill->fillRects = rect;
+	frame->numFills++;
+	cache->fillCount++;
+}
+
+static void cache_set_move(rdpShadowGfxCache* cache, UINT32 index, UINT16 surfaceId,
+                           const RECTANGLE_16* src, const RECTANGLE_16* dst)
+{
+	cache->moved[index] = *dst;
+	cache->movePts[index].x = dst->left;
+	cache->movePts[index].y = dst->top;
+	cache->moves[index].surfaceIdSrc = surfaceId;
+	cache->moves[index].surfaceIdDest = surfaceId;
+	cache->moves[index].rectSrc = *src;
+	cache->moves[index].destPtsCount = 1;
+	cache->moves[index].destPts = &cache->movePts[index];
+	cache->moveCount++;
+}
+
+/* Use the moves the capture reported. Later moves must not read what earlier ones wrote and
+ * destinations must not overlap, a tile then has a single source. */
+static UINT32 cache_hint_moves(rdpShadowGfxCache* cache, UINT16 surfaceId,
+                               const SHADOW_GFX_CACHE_HINT* hint)
+{
+	if ((hint->numMoves == 0) || (hint->numMoves > ARRAYSIZE(cache->moves)))
+		return 0;
+
+	for (UINT32 x = 0; x < hint->numMoves; x++)
+	{
+		const SHADOW_SURFACE_MOVE* move = &hint->moves[x];
+		const UINT32 width = move->src.right - move->src.left;
+		const UINT32 height = move->src.bottom - move->src.top;
+		const RECTANGLE_16 dst = { move->x, move->y, (UINT16)MIN(UINT16_MAX, move->x + width),
+			                       (UINT16)MIN(UINT16_MAX, move->y + height) };
+
+		if ((move->src.right <= move->src.left) || (move->src.bottom <= move->src.top) ||
+		    (move->src.right > cache->width) || (move->src.bottom > cache->height) ||
+		    (1ULL * move->x + width > cache->width) || (1ULL * move->y + height > cache->height))
+			return 0;
+
+		for (UINT32 y = 0; y < x; y++)
+		{
+			if (rectangles_intersects(&cache->moved[y], &move->src) ||
+			    rectangles_intersects(&cache->moved[y], &dst))
+				return 0;
+		}
+
+		cache->moved[x] = dst;
+	}
+
+	for (UINT32 x = 0; x < hint->numMoves; x++)
+		cache_set_move(cache, x, surfaceId, &hint->moves[x].src, &cache->moved[x]);
+
+	return hint->numMoves;
+}
+
+/* Look for scrolled or moved content and let the client copy it on its surface */
+static BOOL cache_detect_move(rdpShadowGfxCache* cache, UINT16 surfaceId, RECTANGLE_16* dst)
+{
+	SHADOW_CAPTURE_MOTION motion = { 0 };
+	const UINT32 previous = cache->current ^ 1;
+	RECTANGLE_16 src = { 0 };
+
+	if (shadow_capture_detect_motion(cache->rowKeys[previous], cache->rowKeys[cache->current],
+	                                 cache->gridWidth, cache->height, SHADOW_GFX_CACHE_TILE,
+	                                 &motion))
+	{
+		dst->left = (UINT16)(motion.firstBand * SHADOW_GFX_CACHE_TILE);
+		dst->right = (UINT16)MIN(cache->width, motion.lastBand * SHADOW_GFX_CACHE_TILE);
+		dst->top = (UINT16)motion.start;
+		dst->bottom = (UINT16)motion.end;
+		src = *dst;
+		src.top = (UINT16)(dst->top - motion.shift);
+		src.bottom = (UINT16)(dst->bottom - motion.shift);
+	}
+	else if (shadow_capture_detect_motion(cache->colKeys[previous], cache->colKeys[cache->current],
+	                                      cache->gridHeight, cache->width, SHADOW_GFX_CACHE_TILE,
+	                                      &motion))
+	{
+		dst->left = (UINT16)motion.start;
+		dst->right = (UINT16)motion.end;
+		dst->top = (UINT16)(motion.firstBand * SHADOW_GFX_CACHE_TILE);
+		dst->bottom = (UINT16)MIN(cache->height, motion.lastBand * SHADOW_GFX_CACHE_TILE);
+		src = *dst;
+		src.left = (UINT16)(dst->left - motion.shift);
+		src.right = (UINT16)(dst->right - motion.shift);
+	}
+	else
+		return FALSE;
+
+	cache_set_move(cache, 0, surfaceId, &src, dst);
+	return TRUE;
+}
+
+/* Partial tiles at the right and bottom edges hash differently by size, tiles clipped by the
+ * update rect are not tracked */
+static BOOL tile_complete(const rdpShadowGfxCache* cache, UINT32 tx, UINT32 ty,
+                          const RECTANGLE_16* tile)
+{
+	const UINT32 right = MIN(cache->width, (tx + 1) * SHADOW_GFX_CACHE_TILE);
+	const UINT32 bottom = MIN(cache->height, (ty + 1) * SHADOW_GFX_CACHE_TILE);
+
+	return (tile->left == tx * SHADOW_GFX_CACHE_TILE) &&
+	       (tile->top == ty * SHADOW_GFX_CACHE_TILE) && (tile->right == right) &&
+	       (tile->bottom == bottom);
+}
+
+/* 1 if a move left the current tile content on the client, -1 if a move wrote part of the
+ * tile and 0 if the tile was not touched */
+static int cache_tile_moved(const rdpShadowGfxCache* cache, UINT32 numMoves,
+                            const REGION16* dirty, const BYTE* pSrcData, UINT32 nSrcStep,
+                            const RECTANGLE_16* tile)
+{
+	int rc = 0;
+
+	for (UINT32 x = 0; x < numMoves; x++)
+	{
+		const RECTANGLE_16* moved = &cache->moved[x];
+
+		if ((tile->left >= moved->left) && (tile->right <= moved->right) &&
+		    (tile->top >= moved->top) && (tile->bottom <= moved->bottom))
+		{
+			if (dirty && region16_intersects_rect(dirty, tile))
+				return -1;
+
+			/* Detected moves rest on line hashes, check what the move copies */
+			const RECTANGLE_16* src = &cache->moves[x].rectSrc;
+			return tile_shown(cache, pSrcData, nSrcStep, tile,
+			                  tile->left - moved->left + src->left,
+			                  tile->top - moved->top + src->top)
+			           ? 1
+			           : -1;
+		}
+
+		if (rectangles_intersects(moved, tile))
+			rc = -1;
+	}
+
+	return rc;
+}
+
+BOOL shadow_gfx_cache_process(rdpShadowGfxCache* cache, UINT16 surfaceId, const BYTE* pSrcData,
+                              UINT32 nSrcStep, const RECTANGLE_16* rect,
+                              const SHADOW_GFX_CACHE_HINT* hint, SHADOW_GFX_CACHE_FRAME* frame)
+{
+	WINPR_ASSERT(cache);
+	WINPR_ASSERT(pSrcData);
+	WINPR_ASSERT(rect);
+	WINPR_ASSERT(frame);
+
+	frame->moves = cache->moves;
+	frame->numMoves = 0;
+	frame->fills = cache->fills;
+	frame->numFills = 0;
+	frame->copies = cache->copies;
+	frame->numCopies = 0;
+	frame->stores = cache->stores;
+	frame->numStores = 0;
+
+	if (!cache->tileKeys)
+		return region16_union_rect(&frame->encode, &frame->encode, rect);
+
+	if ((rect->right > cache->width) || (rect->bottom > cache->height))
+		return FALSE;
+
+	/* Line hashes are only complete, and comparable to the next frame, for full updates */
+	const BOOL full = (rect->left == 0) && (rect->top == 0) && (rect->right == cache->width) &&
+	                  (rect->bottom == cache->height);
+	const UINT32 x0 = rect->left / SHADOW_GFX_CACHE_TILE;
+	const UINT32 y0 = rect->top / SHADOW_GFX_CACHE_TILE;
+	const UINT32 x1 = (rect->right + SHADOW_GFX_CACHE_TILE - 1u) / SHADOW_GFX_CACHE_TILE;
+	const UINT32 y1 = (rect->bottom + SHADOW_GFX_CACHE_TILE - 1u) / SHADOW_GFX_CACHE_TILE;
+
+	for (UINT32 ty = y0; ty < y1; ty++)
+	{
+		for (UINT32 tx = x0; tx < x1; tx++)
+		{
+			const size_t index = 1ULL * ty * cache->gridWidth + tx;
+			const RECTANGLE_16 tile = {
+				(UINT16)MAX(rect->left, tx * SHADOW_GFX_CACHE_TILE),
+				(UINT16)MAX(rect->top, ty * SHADOW_GFX_CACHE_TILE),
+				(UINT16)MIN(rect->right, (tx + 1) * SHADOW_GFX_CACHE_TILE),
+				(UINT16)MIN(rect->bottom, (ty + 1) * SHADOW_GFX_CACHE_TILE),
+			};
+
+			BOOL solid = FALSE;
+			tile_scan(cache, pSrcData, nSrcStep, tx, ty, &tile, &solid, &cache->tileColor[index]);
+			cache->tileSolid[index] = solid ? 1 : 0;
+		}
+	}
+
+	/* Moves the capture reported are exact and spare comparing the line hashes */
+	const BOOL consecutive =
+	    hint && (cache->generation != 0) && (hint->generation == cache->generation + 1);
+	const REGION16* dirty = NULL;
+	if (full && cache->previousValid && consecutive &&
+	    ((frame->numMoves = cache_hint_moves(cache, surfaceId, hint)) > 0))
+		dirty = hint->dirty;
+	else if (full && cache->previousValid && cache_detect_move(cache, surfaceId, &cache->moved[0]))
+		frame->numMoves = 1;
+
+	for (UINT32 ty = y0; ty < y1; ty++)
+	{
+		for (UINT32 tx = x0; tx < x1; tx++)
+		{
+			const size_t index = 1ULL * ty * cache->gridWidth + tx;
+			UINT64* tileKey = &cache->tileKeys[index];
+			const RECTANGLE_16 tile = {
+				(UINT16)MAX(rect->left, tx * SHADOW_GFX_CACHE_TILE),
+				(UINT16)MAX(rect->top, ty * SHADOW_GFX_CACHE_TILE),
+				(UINT16)MIN(rect->right, (tx + 1) * SHADOW_GFX_CACHE_TILE),
+				(UINT16)MIN(rect->bottom, (ty + 1) * SHADOW_GFX_CACHE_TILE),
+			};
+			const BOOL solid = cache->tileSolid[index] != 0;
+			const UINT64 key = tile_key(cache, tx, &tile);
+
+			if (!tile_complete(cache, tx, ty, &tile))
+			{
+				*tileKey = 0;
+				if (!region16_union_rect(&frame->encode, &frame->encode, &tile))
+					return FALSE;
+				continue;
+			}
+
+			/* The client surface already has the current content after the move */
+			const int moved =
+			    cache_tile_moved(cache, frame->numMoves, dirty, pSrcData, nSrcStep, &tile);
+			if (moved > 0)
+			{
+				*tileKey = key;
+				continue;
+			}
+
+			/* Whatever the client shows there now, it is not the content it had */
+			if (moved < 0)
+				*tileKey = 0;
+
+			if ((key == *tileKey) &&
+			    tile_shown(cache, pSrcData, nSrcStep, &tile, tile.left, tile.top))
+			{
+				/* Content the client already shows, store it once it is stable */
+				if (!solid && !table_get(cache, key) &&
+				    (frame->numStores < SHADOW_GFX_CACHE_MAX_STORES))
+				{
+					const UINT16 slot = cache_insert(cache, key, pSrcData, nSrcStep, &tile);
+					if (slot != 0)
+					{
+						RDPGFX_SURFACE_TO_CACHE_PDU* store = &frame->stores[frame->numStores++];
+						store->surfaceId = surfaceId;
+						store->cacheKey = key;
+						store->cacheSlot = slot;
+						store->rectSrc = tile;
+					}
+				}
+				continue;
+			}
+
+			*tileKey = key;
+
+			if (solid)
+			{
+				cache_add_fill(cache, surfaceId, frame, &tile, cache->tileColor[index]);
+				continue;
+			}
+
+			const UINT16 slot = table_get(cache, key);
+			if ((slot != 0) && slot_equal(cache, slot, pSrcData, nSrcStep, &tile))
+			{
+				RDPGFX_CACHE_TO_SURFACE_PDU* copy = &frame->copies[frame->numCopies];
+				RDPGFX_POINT16* pt = &cache->copyPts[frame->numCopies];
+				pt->x = tile.left;
+				pt->y = tile.top;
+				copy->cacheSlot = slot;
+				copy->surfaceId = surfaceId;
+				copy->destPtsCount = 1;
+				copy->destPts = pt;
+				frame->numCopies++;
+				cache->slotRefs[slot] = 1;
+				cache->hits++;
+				continue;
+			}
+
+			if (!region16_union_rect(&frame->encode, &frame->encode, &tile))
+				return FALSE;
+		}
+	}
+
+	/* Every tile of rect now shows the current content on the client */
+	const UINT32 shownStep = cache->width * 4;
+	for (UINT32 y = rect->top; y < rect->bottom; y++)
+		memcpy(&cache->shown[1ULL * y * shownStep + 4ULL * rect->left],
+		       &pSrcData[1ULL * y * nSrcStep + 4ULL * rect->left],
+		       4ULL * (rect->right - rect->left));
+
+	cache->previousValid = full;
+	cache->generation = hint ? hint->generation : 0;
+	cache->current ^= 1;
+	return TRUE;
+}
@@ -0,0 +1,78 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_GFX_CACHE_H
+#define FREERDP_SERVER_SHADOW_GFX_CACHE_H
+
+#include <winpr/crt.h>
+
+#include <freerdp/codec/region.h>
+#include <freerdp/channels/rdpgfx.h>
+
+#include "shadow_surface.h"
+
+typedef struct rdp_shadow_gfx_cache rdpShadowGfxCache;
+
+/** Moves the capture reported for a published frame */
+typedef struct
+{
+	UINT64 generation; /* of the frame, the moves apply to generation - 1 */
+	const SHADOW_SURFACE_MOVE* moves;
+	UINT32 numMoves;
+	const REGION16* dirty; /* changed after the moves */
+} SHADOW_GFX_CACHE_HINT;
+
+/** The commands replacing codec output for one frame, the arrays are owned by the cache */
+typedef struct
+{
+	REGION16 encode; /* part of the frame the codec still has to encode */
+	RDPGFX_SURFACE_TO_SURFACE_PDU* moves; /* send before anything else */
+	UINT32 numMoves;
+	RDPGFX_SOLID_FILL_PDU* fills;
+	UINT32 numFills;
+	RDPGFX_CACHE_TO_SURFACE_PDU* copies;
+	UINT32 numCopies;
+	RDPGFX_SURFACE_TO_CACHE_PDU* stores; /* send after the codec output */
+	UINT32 numStores;
+} SHADOW_GFX_CACHE_FRAME;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	void shadow_gfx_cache_free(rdpShadowGfxCache* cache);
+
+	WINPR_ATTR_MALLOC(shadow_gfx_cache_free, 1)
+	rdpShadowGfxCache* shadow_gfx_cache_new(UINT32 maxSlots);
+
+	/* Forget all surface and cache slot state, e.g. after a graphics reset */
+	BOOL shadow_gfx_cache_reset(rdpShadowGfxCache* cache, UINT32 width, UINT32 height);
+
+	/* Split the 32bpp frame rect into moved content, solid fills, cache hits, unchanged
+	 * tiles and the region left for the codec. frame->encode must be initialized by the
+	 * caller. The moves of hint replace motion detection if the previous frame processed
+	 * was its generation - 1, hint is NULL for frames that are not published captures. */
+	BOOL shadow_gfx_cache_process(rdpShadowGfxCache* cache, UINT16 surfaceId,
+	                              const BYTE* pSrcData, UINT32 nSrcStep, const RECTANGLE_16* rect,
+	                              const SHADOW_GFX_CACHE_HINT* hint,
+	                              SHADOW_GFX_CACHE_FRAME* frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_SERVER_SHADOW_GFX_CACHE_H */
@@ -187,6 +187,7 @@ static BOOL Consume(struct rdp_shadow_multiclient_subscriber* subscriber, BOOL w
 	{
 		/* Consume my share. Server is waiting for us */
 		event->consuming--;
+		subscriber->pleaseHandle = FALSE;
 		ret = TRUE;
 	}
 
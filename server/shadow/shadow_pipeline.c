@@ -0,0 +1,108 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
+
+#include "shadow_pipeline.h"
+
+static DWORD WINAPI shadow_pipeline_thread(LPVOID arg)
+{
+	SHADOW_PIPELINE* pipeline = arg;
+
+	WINPR_ASSERT(pipeline);
+	WINPR_ASSERT(pipeline->encode);
+
+	while (WaitForSingleObject(pipeline->event, INFINITE) == WAIT_OBJECT_0)
+	{
+		/* winpr has no auto reset events, the next start sets it again */
+		(void)ResetEvent(pipeline->event);
+
+		if (InterlockedCompareExchange(&pipeline->stop, 0, 0) != 0)
+			break;
+
+		pipeline->result = pipeline->encode(pipeline->arg);
+		(void)SetEvent(pipeline->done);
+	}
+
+	return 0;
+}
+
+BOOL shadow_pipeline_init(SHADOW_PIPELINE* pipeline, pfnShadowPipelineEncode encode, void* arg)
+{
+	WINPR_ASSERT(pipeline);
+	WINPR_ASSERT(encode);
+
+	pipeline->encode = encode;
+	pipeline->arg = arg;
+	(void)InterlockedExchange(&pipeline->stop, 0);
+	pipeline->event = CreateEventA(NULL, TRUE, FALSE, NULL);
+	pipeline->done = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!pipeline->event || !pipeline->done)
+		return FALSE;
+
+	pipeline->thread = CreateThread(NULL, 0, shadow_pipeline_thread, pipeline, 0, NULL);
+	return pipeline->thread != NULL;
+}
+
+void shadow_pipeline_uninit(SHADOW_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	if (pipeline->thread)
+	{
+		(void)InterlockedExchange(&pipeline->stop, 1);
+		(void)SetEvent(pipeline->event);
+		(void)WaitForSingleObject(pipeline->thread, INFINITE);
+		(void)CloseHandle(pipeline->thread);
+	}
+
+	if (pipeline->event)
+		(void)CloseHandle(pipeline->event);
+	if (pipeline->done)
+		(void)CloseHandle(pipeline->done);
+	pipeline->thread = pipeline->event = pipeline->done = NULL;
+	pipeline->busy = FALSE;
+}
+
+BOOL shadow_pipeline_start(SHADOW_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	if (pipeline->busy || !pipeline->thread)
+		return FALSE;
+
+	pipeline->busy = TRUE;
+	pipeline->result = FALSE;
+	(void)ResetEvent(pipeline->done);
+	(void)SetEvent(pipeline->event);
+	return TRUE;
+}
+
+BOOL shadow_pipeline_wait(SHADOW_PIPELINE* pipeline)
+{
+	WINPR_ASSERT(pipeline);
+
+	if (!pipeline->busy)
+		return TRUE;
+
+	(void)WaitForSingleObject(pipeline->done, INFINITE);
+	pipeline->busy = FALSE;
+	return pipeline->result;
+}
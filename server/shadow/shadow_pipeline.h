@@ -0,0 +1,54 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_PIPELINE_H
+#define FREERDP_SERVER_SHADOW_PIPELINE_H
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+
+#include <freerdp/api.h>
+
+/** Encodes one frame on the pipeline thread */
+typedef BOOL (*pfnShadowPipelineEncode)(void* arg);
+
+/**
+ * A worker thread encoding one frame at a time. The state the encode uses belongs to the
+ * worker while busy is set, the owner thread starts a frame and waits for it to finish.
+ */
+typedef struct
+{
+	pfnShadowPipelineEncode encode;
+	void* arg;
+	HANDLE thread;
+	HANDLE event; /* manual reset, starts an encode, reset by the worker */
+	HANDLE done;  /* manual reset, set once the encode finished */
+	BOOL busy;    /* only accessed by the owner thread */
+	LONG stop;
+	BOOL result;
+} SHADOW_PIPELINE;
+
+FREERDP_LOCAL BOOL shadow_pipeline_init(SHADOW_PIPELINE* pipeline, pfnShadowPipelineEncode encode,
+                                        void* arg);
+FREERDP_LOCAL void shadow_pipeline_uninit(SHADOW_PIPELINE* pipeline);
+
+/** Returns FALSE if the previous frame is still encoding */
+FREERDP_LOCAL BOOL shadow_pipeline_start(SHADOW_PIPELINE* pipeline);
+
+/** Waits for a running encode and returns its result, TRUE if none runs */
+FREERDP_LOCAL BOOL shadow_pipeline_wait(SHADOW_PIPELINE* pipeline);
+
+#endif /* FREERDP_SERVER_SHADOW_PIPELINE_H */
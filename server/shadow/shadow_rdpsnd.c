@@ -29,8 +29,32 @@
 
 #define TAG SERVER_TAG("shadow")
 
+static BOOL rdpsnd_select_format(RdpsndServerContext* context, UINT16 wFormatTag)
+{
+	for (UINT16 i = 0; i < context->num_client_formats; i++)
+	{
+		if (context->client_formats[i].wFormatTag != wFormatTag)
+			continue;
+
+		for (size_t j = 0; j < context->num_server_formats; j++)
+		{
+			if (audio_format_compatible(&context->server_formats[j], &context->client_formats[i]))
+			{
+				context->SelectFormat(context, i);
+				return TRUE;
+			}
+		}
+	}
+
+	return FALSE;
+}
+
 static void rdpsnd_activated(RdpsndServerContext* context)
 {
+	/* opus needs a fraction of the bandwidth of PCM or ADPCM, prefer it when both ends can */
+	if (rdpsnd_select_format(context, WAVE_FORMAT_OPUS))
+		return;
+
 	for (size_t i = 0; i < context->num_client_formats; i++)
 	{
 		for (size_t j = 0; j < context->num_server_formats; j++)
@@ -57,6 +81,7 @@ int shadow_client_rdpsnd_init(rdpShadowClient* client)
 	}
 
 	rdpsnd->data = client;
+	rdpsnd->rdpcontext = &client->context;
 
 	if (client->subsystem->rdpsndFormats)
 	{
@@ -27,9 +27,11 @@
 #include <winpr/path.h>
 #include <winpr/cmdline.h>
 #include <winpr/winsock.h>
+#include <winpr/sysinfo.h>
 
 #include <freerdp/log.h>
 #include <freerdp/version.h>
+#include <freerdp/codec/bulk.h>
 
 #include <winpr/tools/makecert.h>
 
@@ -57,6 +59,17 @@ static int fail_at_(const COMMAND_LINE_ARGUMENT_A* arg, int rc, const char* file
 	return rc;
 }
 
+static BOOL shadow_server_set_uint32_arg(rdpSettings* settings, FreeRDP_Settings_Keys_UInt32 id,
+                                         const char* value)
+{
+	errno = 0;
+	unsigned long val = strtoul(value, NULL, 0);
+
+	if ((errno != 0) || (val > UINT32_MAX))
+		return FALSE;
+	return freerdp_settings_set_uint32(settings, id, (UINT32)val);
+}
+
 static int shadow_server_print_command_line_help(int argc, char** argv,
                                                  COMMAND_LINE_ARGUMENT_A* largs)
 {
@@ -414,6 +427,87 @@ int shadow_server_parse_command_line(rdpShadowServer* server, int argc, char** a
 			                               arg->Value ? TRUE : FALSE))
 				return fail_at(arg, COMMAND_LINE_ERROR);
 		}
+		CommandLineSwitchCase(arg, "tls-kernel-offload")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_TlsKernelOffload,
+			                               arg->Value ? TRUE : FALSE))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "io-uring")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_TransportIoUring,
+			                               arg->Value ? TRUE : FALSE))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "send-queue")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_TransportSendQueue,
+			                               arg->Value ? TRUE : FALSE))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "tcp-notsent-lowat")
+		{
+			if (!shadow_server_set_uint32_arg(settings, FreeRDP_TcpNotSentLowat, arg->Value))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "tcp-busy-poll")
+		{
+			if (!shadow_server_set_uint32_arg(settings, FreeRDP_TcpBusyPoll, arg->Value))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "tcp-buffers")
+		{
+			char* rcvbuf = strchr(arg->Value, ',');
+			if (rcvbuf)
+				*rcvbuf++ = '\0';
+
+			if (!shadow_server_set_uint32_arg(settings, FreeRDP_TcpSendBufferSize, arg->Value) ||
+			    !shadow_server_set_uint32_arg(settings, FreeRDP_TcpReceiveBufferSize,
+			                                  rcvbuf ? rcvbuf : arg->Value))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "tcp-adaptive-buffers")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_TcpAdaptiveBuffers,
+			                               arg->Value ? TRUE : FALSE))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "compression-effort")
+		{
+			UINT32 effort = BULK_COMPRESSION_EFFORT_NORMAL;
+
+			if (strcmp("fast", arg->Value) == 0)
+				effort = BULK_COMPRESSION_EFFORT_FAST;
+			else if (strcmp("max", arg->Value) == 0)
+				effort = BULK_COMPRESSION_EFFORT_MAX;
+			else if (strcmp("normal", arg->Value) != 0)
+				return fail_at(arg, COMMAND_LINE_ERROR);
+
+			if (!freerdp_settings_set_uint32(settings, FreeRDP_CompressionEffort, effort))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "dvc-compression")
+		{
+			if (!freerdp_settings_set_bool(settings, FreeRDP_DynamicChannelCompression,
+			                               arg->Value ? TRUE : FALSE))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "audio-bitrate")
+		{
+			if (!shadow_server_set_uint32_arg(settings, FreeRDP_AudioEncoderBitrate, arg->Value))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
+		CommandLineSwitchCase(arg, "audio-complexity")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > 10))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+
+			if (!freerdp_settings_set_uint32(settings, FreeRDP_AudioEncoderComplexity, (UINT32)val))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+		}
 		CommandLineSwitchCase(arg, "sam-file")
 		{
 			if (!freerdp_settings_set_string(settings, FreeRDP_NtlmSamFile, arg->Value))
@@ -478,6 +572,63 @@ int shadow_server_parse_command_line(rdpShadowServer* server, int argc, char** a
 			if (!freerdp_settings_set_bool(settings, FreeRDP_GfxAVC444, arg->Value ? TRUE : FALSE))
 				return fail_at(arg, COMMAND_LINE_ERROR);
 		}
+		CommandLineSwitchCase(arg, "share-encoder")
+		{
+			server->shareEncoder = arg->Value ? TRUE : FALSE;
+		}
+		CommandLineSwitchCase(arg, "gfx-cache")
+		{
+			server->gfxCache = arg->Value ? TRUE : FALSE;
+		}
+		CommandLineSwitchCase(arg, "adaptive-codec")
+		{
+			server->adaptiveCodec = arg->Value ? TRUE : FALSE;
+		}
+		CommandLineSwitchCase(arg, "stats-interval")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX / 1000))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+			server->statsInterval = (UINT32)val;
+		}
+		CommandLineSwitchCase(arg, "gfx-refine")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+			server->refineDelay = (UINT32)val;
+		}
+		CommandLineSwitchCase(arg, "accept-threads")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+			server->acceptThreads = (UINT32)val;
+		}
+		CommandLineSwitchCase(arg, "encode-depth")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+			server->encodeDepth = (UINT32)val;
+		}
+		CommandLineSwitchCase(arg, "codec-pool")
+		{
+			errno = 0;
+			unsigned long val = strtoul(arg->Value, NULL, 0);
+
+			if ((errno != 0) || (val > UINT32_MAX))
+				return fail_at(arg, COMMAND_LINE_ERROR);
+			server->codecPoolSize = (UINT32)val;
+		}
 		CommandLineSwitchCase(arg, "keytab")
 		{
 			if (!freerdp_settings_set_string(settings, FreeRDP_KerberosKeytab, arg->Value))
@@ -546,12 +697,44 @@ int shadow_server_parse_command_line(rdpShadowServer* server, int argc, char** a
 	return status;
 }
 
+static void shadow_server_log_stats(rdpShadowServer* server)
+{
+	SHADOW_CLIENT_STATS stats[16] = { 0 };
+	const size_t count = shadow_server_get_client_stats(server, stats, ARRAYSIZE(stats));
+
+	for (size_t x = 0; x < MIN(count, ARRAYSIZE(stats)); x++)
+	{
+		const SHADOW_CLIENT_STATS* cur = &stats[x];
+		char codecs[256] = { 0 };
+
+		for (size_t y = 0; y < SHADOW_CLIENT_STATS_CODECS; y++)
+		{
+			if (cur->codecFrames[y] == 0)
+				continue;
+
+			const size_t len = strnlen(codecs, sizeof(codecs));
+			(void)_snprintf(&codecs[len], sizeof(codecs) - len,
+			                " [0x%08" PRIx32 ": %" PRIu64 " frames, %" PRIu32 "us]", 1u << y,
+			                cur->codecFrames[y], cur->codecEncodeTime[y]);
+		}
+
+		WLog_INFO(TAG,
+		          "%s: %" PRIu64 " frames, %" PRIu64 " dropped, %" PRIu64 " bytes, %" PRIu32
+		          " bytes/frame, capture to encode %" PRIu32 "us, %" PRIu32
+		          " in flight, ack latency %" PRIu32 "ms, codecs%s",
+		          cur->hostname, cur->frames, cur->droppedFrames, cur->bytes, cur->frameBytes,
+		          cur->captureToEncode, cur->inflightFrames, cur->ackLatency, codecs);
+	}
+}
+
 static DWORD WINAPI shadow_server_thread(LPVOID arg)
 {
 	rdpShadowServer* server = (rdpShadowServer*)arg;
 	BOOL running = TRUE;
 	DWORD status = 0;
 	freerdp_listener* listener = server->listener;
+	const UINT64 interval = 1000ull * server->statsInterval;
+	UINT64 nextStats = GetTickCount64() + interval;
 	shadow_subsystem_start(server->subsystem);
 
 	while (running)
@@ -567,7 +750,19 @@ static DWORD WINAPI shadow_server_thread(LPVOID arg)
 			break;
 		}
 
-		status = WaitForMultipleObjects(nCount, events, FALSE, INFINITE);
+		DWORD timeout = INFINITE;
+		if (interval > 0)
+		{
+			const UINT64 now = GetTickCount64();
+			if (now >= nextStats)
+			{
+				shadow_server_log_stats(server);
+				nextStats = now + interval;
+			}
+			timeout = (DWORD)(nextStats - now);
+		}
+
+		status = WaitForMultipleObjects(nCount, events, FALSE, timeout);
 
 		switch (status)
 		{
@@ -576,6 +771,9 @@ static DWORD WINAPI shadow_server_thread(LPVOID arg)
 				running = FALSE;
 				break;
 
+			case WAIT_TIMEOUT:
+				break;
+
 			default:
 			{
 				if (!listener->CheckFileDescriptor(listener))
@@ -683,6 +881,12 @@ int shadow_server_start(rdpShadowServer* server)
 	 * <local path>          ... bind local (IPC)
 	 * bind-socket,<address> ... bind TCP to specified interface
 	 */
+	if (!freerdp_listener_set_accept_threads(server->listener, server->acceptThreads))
+	{
+		WLog_ERR(TAG, "invalid number of accept threads %" PRIu32, server->acceptThreads);
+		return -1;
+	}
+
 	ipc = server->ipcSocket && (strncmp(bind_address, server->ipcSocket,
 	                                    strnlen(bind_address, sizeof(bind_address))) != 0);
 	if (!ipc)
@@ -939,6 +1143,20 @@ int shadow_server_init(rdpShadowServer* server)
 	if (!shadow_server_init_certificate(server))
 		goto fail;
 
+	if (server->shareEncoder)
+	{
+		server->sharedEncoder = shadow_shared_encoder_new();
+		if (!server->sharedEncoder)
+			goto fail;
+	}
+
+	if (server->codecPoolSize > 0)
+	{
+		server->codecPool = shadow_codec_pool_new(server->codecPoolSize);
+		if (!server->codecPool)
+			goto fail;
+	}
+
 	server->listener = freerdp_listener_new();
 
 	if (!server->listener)
@@ -975,6 +1193,10 @@ int shadow_server_uninit(rdpShadowServer* server)
 	server->subsystem = NULL;
 	freerdp_listener_free(server->listener);
 	server->listener = NULL;
+	shadow_shared_encoder_free(server->sharedEncoder);
+	server->sharedEncoder = NULL;
+	shadow_codec_pool_free(server->codecPool);
+	server->codecPool = NULL;
 	free(server->CertificateFile);
 	server->CertificateFile = NULL;
 	free(server->PrivateKeyFile);
@@ -1005,6 +1227,8 @@ rdpShadowServer* shadow_server_new(void)
 	server->h264FrameRate = 30;
 	server->h264QP = 0;
 	server->authentication = TRUE;
+	server->gfxCache = TRUE;
+	server->codecPoolSize = 8;
 	server->settings = freerdp_settings_new(FREERDP_SETTINGS_SERVER_MODE);
 	return server;
 }
@@ -0,0 +1,210 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <freerdp/config.h>
+
+#include <winpr/assert.h>
+
+#include <freerdp/log.h>
+
+#include "shadow.h"
+
+#include "shadow_shared_encoder.h"
+
+#define TAG SERVER_TAG("shadow.shared")
+
+/* One slot per codec configuration in use at the same time */
+#define SHADOW_SHARED_ENCODER_SLOTS 4
+
+typedef struct
+{
+	BOOL valid;
+	UINT64 generation;
+	UINT32 codecId;
+	UINT32 variant;
+	const BYTE* pSrcData;
+	RECTANGLE_16 rect;
+	BYTE* data;
+	UINT32 length;
+} SHADOW_SHARED_FRAME;
+
+struct rdp_shadow_shared_encoder
+{
+	CRITICAL_SECTION lock;
+	UINT64 generation;
+	SHADOW_SHARED_FRAME frames[SHADOW_SHARED_ENCODER_SLOTS];
+	UINT64 hits;
+	UINT64 misses;
+};
+
+rdpShadowSharedEncoder* shadow_shared_encoder_new(void)
+{
+	rdpShadowSharedEncoder* shared =
+	    (rdpShadowSharedEncoder*)calloc(1, sizeof(rdpShadowSharedEncoder));
+
+	if (!shared)
+		return NULL;
+
+	if (!InitializeCriticalSectionAndSpinCount(&shared->lock, 4000))
+	{
+		free(shared);
+		return NULL;
+	}
+
+	return shared;
+}
+
+void shadow_shared_encoder_free(rdpShadowSharedEncoder* shared)
+{
+	if (!shared)
+		return;
+
+	WLog_DBG(TAG, "shared frames: %" PRIu64 " encoded, %" PRIu64 " reused", shared->misses,
+	         shared->hits);
+
+	for (size_t x = 0; x < SHADOW_SHARED_ENCODER_SLOTS; x++)
+		free(shared->frames[x].data);
+
+	DeleteCriticalSection(&shared->lock);
+	free(shared);
+}
+
+void shadow_shared_encoder_next_frame(rdpShadowSharedEncoder* shared)
+{
+	if (!shared)
+		return;
+
+	EnterCriticalSection(&shared->lock);
+	shared->generation++;
+	LeaveCriticalSection(&shared->lock);
+}
+
+static BOOL shared_frame_matches(const SHADOW_SHARED_FRAME* frame, UINT64 generation,
+                                 UINT32 codecId, UINT32 variant, const BYTE* pSrcData,
+                                 const RECTANGLE_16* rect)
+{
+	if (!frame->valid || (frame->generation != generation))
+		return FALSE;
+	if ((frame->codecId != codecId) || (frame->variant != variant))
+		return FALSE;
+	if (frame->pSrcData != pSrcData)
+		return FALSE;
+	return rectangles_equal(&frame->rect, rect);
+}
+
+static SHADOW_SHARED_FRAME* shared_frame_slot(rdpShadowSharedEncoder* shared, UINT32 codecId,
+                                              UINT32 variant)
+{
+	SHADOW_SHARED_FRAME* oldest = &shared->frames[0];
+
+	for (size_t x = 0; x < SHADOW_SHARED_ENCODER_SLOTS; x++)
+	{
+		SHADOW_SHARED_FRAME* cur = &shared->frames[x];
+
+		if (!cur->valid || ((cur->codecId == codecId) && (cur->variant == variant)))
+			return cur;
+		if (cur->generation < oldest->generation)
+			oldest = cur;
+	}
+
+	return oldest;
+}
+
+BOOL shadow_shared_encoder_encode(rdpShadowSharedEncoder* shared, UINT32 codecId, UINT32 variant,
+                                  const BYTE* pSrcData, const RECTANGLE_16* rect,
+                                  pfnShadowSharedEncode fn, void* ctx, BYTE** ppData,
+                                  UINT32* pLength)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(shared);
+	WINPR_ASSERT(rect);
+	WINPR_ASSERT(fn);
+	WINPR_ASSERT(ppData);
+	WINPR_ASSERT(pLength);
+
+	*ppData = NULL;
+	*pLength = 0;
+
+	/* Encoding is done with the lock held, so clients arriving while a frame is being
+	 * encoded wait for it instead of encoding the same frame again. */
+	EnterCriticalSection(&shared->lock);
+
+	SHADOW_SHARED_FRAME* frame = NULL;
+	for (size_t x = 0; x < SHADOW_SHARED_ENCODER_SLOTS; x++)
+	{
+		SHADOW_SHARED_FRAME* cur = &shared->frames[x];
+		if (shared_frame_matches(cur, shared->generation, codecId, variant, pSrcData, rect))
+		{
+			frame = cur;
+			break;
+		}
+	}
+
+	if (frame)
+		shared->hits++;
+	else
+	{
+		BYTE* data = NULL;
+		UINT32 length = 0;
+
+		if (!fn(ctx, &data, &length))
+			goto fail;
+
+		frame = shared_frame_slot(shared, codecId, variant);
+		free(frame->data);
+		frame->valid = TRUE;
+		frame->generation = shared->generation;
+		frame->codecId = codecId;
+		frame->variant = variant;
+		frame->pSrcData = pSrcData;
+		frame->rect = *rect;
+		frame->data = data;
+		frame->length = length;
+		shared->misses++;
+	}
+
+	if (frame->length > 0)
+	{
+		*ppData = malloc(frame->length);
+		if (!*ppData)
+			goto fail;
+		memcpy(*ppData, frame->data, frame->length);
+	}
+	*pLength = frame->length;
+	rc = TRUE;
+
+fail:
+	LeaveCriticalSection(&shared->lock);
+	return rc;
+}
+
+BOOL shadow_shared_encoder_compose_rfx(RFX_CONTEXT* rfx, UINT32 channelWidth,
+                                       UINT32 channelHeight, wStream* s, const RFX_RECT* rects,
+                                       size_t numRects, const BYTE* data, UINT32 width,
+                                       UINT32 height, UINT32 scanline)
+{
+	WINPR_ASSERT(rfx);
+
+	/* The RFX context writes the sync, context, codec version and channel blocks only into
+	 * the first message and numbers the frames it encodes. A client may get its first
+	 * shared message from any other client's context, so every shared message starts a
+	 * new stream: all header blocks and frame index 0. */
+	if (!rfx_context_reset(rfx, channelWidth, channelHeight))
+		return FALSE;
+
+	return rfx_compose_message(rfx, s, rects, numRects, data, width, height, scanline);
+}
@@ -0,0 +1,61 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Implementation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FREERDP_SERVER_SHADOW_SHARED_ENCODER_H
+#define FREERDP_SERVER_SHADOW_SHARED_ENCODER_H
+
+#include <freerdp/server/shadow.h>
+#include <freerdp/codec/rfx.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+
+/** Encode callback, must return a malloc'ed buffer in ppData */
+typedef BOOL (*pfnShadowSharedEncode)(void* ctx, BYTE** ppData, UINT32* pLength);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	void shadow_shared_encoder_free(rdpShadowSharedEncoder* shared);
+
+	WINPR_ATTR_MALLOC(shadow_shared_encoder_free, 1)
+	rdpShadowSharedEncoder* shadow_shared_encoder_new(void);
+
+	/* Called for every surface update, invalidates all cached bitstreams */
+	void shadow_shared_encoder_next_frame(rdpShadowSharedEncoder* shared);
+
+	/* Return a copy of the bitstream encoded for the current frame with the same codec,
+	 * variant, source and rectangle, or run fn to create it. The caller frees ppData. */
+	BOOL shadow_shared_encoder_encode(rdpShadowSharedEncoder* shared, UINT32 codecId,
+	                                  UINT32 variant, const BYTE* pSrcData,
+	                                  const RECTANGLE_16* rect, pfnShadowSharedEncode fn,
+	                                  void* ctx, BYTE** ppData, UINT32* pLength);
+
+	/* Compose a RemoteFX message a client can decode without the earlier messages of the
+	 * stream, for bitstreams handed to clients other than the one owning rfx. */
+	BOOL shadow_shared_encoder_compose_rfx(RFX_CONTEXT* rfx, UINT32 channelWidth,
+	                                       UINT32 channelHeight, wStream* s,
+	                                       const RFX_RECT* rects, size_t numRects,
+	                                       const BYTE* data, UINT32 width, UINT32 height,
+	                                       UINT32 scanline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FREERDP_SERVER_SHADOW_SHARED_ENCODER_H */
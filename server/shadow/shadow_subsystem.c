@@ -85,6 +85,10 @@ int shadow_subsystem_init(rdpShadowSubsystem* subsystem, rdpShadowServer* server
 	if (!(subsystem->updateEvent = shadow_multiclient_new()))
 		goto fail;
 
+	subsystem->captureConsumers = 0;
+	if (!(subsystem->captureEvent = CreateEventA(NULL, TRUE, FALSE, NULL)))
+		goto fail;
+
 	if ((status = subsystem->ep.Init(subsystem)) >= 0)
 		return status;
 
@@ -101,6 +105,12 @@ fail:
 		subsystem->updateEvent = NULL;
 	}
 
+	if (subsystem->captureEvent)
+	{
+		(void)CloseHandle(subsystem->captureEvent);
+		subsystem->captureEvent = NULL;
+	}
+
 	return status;
 }
 
@@ -144,6 +154,12 @@ void shadow_subsystem_uninit(rdpShadowSubsystem* subsystem)
 		shadow_multiclient_free(subsystem->updateEvent);
 		subsystem->updateEvent = NULL;
 	}
+
+	if (subsystem->captureEvent)
+	{
+		(void)CloseHandle(subsystem->captureEvent);
+		subsystem->captureEvent = NULL;
+	}
 }
 
 int shadow_subsystem_start(rdpShadowSubsystem* subsystem)
@@ -288,5 +304,56 @@ int shadow_subsystem_pointer_convert_alpha_pointer_data_to_format(
 
 void shadow_subsystem_frame_update(rdpShadowSubsystem* subsystem)
 {
+	rdpShadowServer* server = subsystem->server;
+
+	/* Clients encode from a published copy and let the capture continue once they took it.
+	 * Subsystems providing YUV frames are read during the encode and keep the barrier. */
+	if (server && server->surface && !subsystem->GetYUV420Frame)
+	{
+		if (!shadow_surface_publish(server->surface))
+			return;
+	}
+
+	if (server)
+		shadow_shared_encoder_next_frame(server->sharedEncoder);
 	shadow_multiclient_publish_and_wait(subsystem->updateEvent);
 }
+
+void shadow_subsystem_capture_acquire(rdpShadowSubsystem* subsystem)
+{
+	WINPR_ASSERT(subsystem);
+	WINPR_ASSERT(subsystem->server);
+
+	/* The count and the event change together, see shadow_subsystem_capture_release */
+	EnterCriticalSection(&subsystem->server->lock);
+	if (subsystem->captureConsumers++ == 0)
+		(void)SetEvent(subsystem->captureEvent);
+	LeaveCriticalSection(&subsystem->server->lock);
+}
+
+void shadow_subsystem_capture_release(rdpShadowSubsystem* subsystem)
+{
+	WINPR_ASSERT(subsystem);
+	WINPR_ASSERT(subsystem->server);
+
+	EnterCriticalSection(&subsystem->server->lock);
+	WINPR_ASSERT(subsystem->captureConsumers > 0);
+	if (--subsystem->captureConsumers == 0)
+		(void)ResetEvent(subsystem->captureEvent);
+	LeaveCriticalSection(&subsystem->server->lock);
+}
+
+BOOL shadow_subsystem_capture_wanted(rdpShadowSubsystem* subsystem)
+{
+	if (!subsystem || !subsystem->captureEvent)
+		return TRUE;
+
+	return WaitForSingleObject(subsystem->captureEvent, 0) == WAIT_OBJECT_0;
+}
+
+HANDLE shadow_subsystem_capture_event(rdpShadowSubsystem* subsystem)
+{
+	if (!subsystem)
+		return NULL;
+	return subsystem->captureEvent;
+}
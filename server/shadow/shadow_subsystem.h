@@ -40,6 +40,11 @@ extern "C"
 	int shadow_subsystem_start(rdpShadowSubsystem* subsystem);
 	int shadow_subsystem_stop(rdpShadowSubsystem* subsystem);
 
+	/* Count a client showing the capture, the first one resumes capturing */
+	void shadow_subsystem_capture_acquire(rdpShadowSubsystem* subsystem);
+	/* Release a client counted with shadow_subsystem_capture_acquire */
+	void shadow_subsystem_capture_release(rdpShadowSubsystem* subsystem);
+
 #ifdef __cplusplus
 }
 #endif
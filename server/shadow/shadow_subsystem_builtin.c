@@ -29,9 +29,17 @@ typedef struct
 extern int ShadowSubsystemEntry(RDP_SHADOW_ENTRY_POINTS* pEntryPoints);
 extern const char* ShadowSubsystemName(void);
 
+#if defined(WITH_SHADOW_PIPEWIRE)
+extern int PipeWireShadowSubsystemEntry(RDP_SHADOW_ENTRY_POINTS* pEntryPoints);
+extern const char* PipeWireShadowSubsystemName(void);
+#endif
+
 static RDP_SHADOW_SUBSYSTEM g_Subsystems[] = {
 
-	{ ShadowSubsystemName, ShadowSubsystemEntry }
+	{ ShadowSubsystemName, ShadowSubsystemEntry },
+#if defined(WITH_SHADOW_PIPEWIRE)
+	{ PipeWireShadowSubsystemName, PipeWireShadowSubsystemEntry },
+#endif
 };
 
 static size_t g_SubsystemCount = ARRAYSIZE(g_Subsystems);
@@ -40,6 +48,13 @@ static pfnShadowSubsystemEntry shadow_subsystem_load_static_entry(const char* na
 {
 	if (!name)
 	{
+#if defined(WITH_SHADOW_PIPEWIRE)
+		/* X11 capture does not work in Wayland sessions */
+		const char* session = getenv("XDG_SESSION_TYPE");
+		if (session && (strcmp(session, "wayland") == 0))
+			return PipeWireShadowSubsystemEntry;
+#endif
+
 		if (g_SubsystemCount > 0)
 		{
 			const RDP_SHADOW_SUBSYSTEM* cur = &g_Subsystems[0];
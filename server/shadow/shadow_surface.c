@@ -18,12 +18,137 @@
 
 #include <freerdp/config.h>
 
+#include <winpr/assert.h>
+#include <winpr/interlocked.h>
+#include <winpr/sysinfo.h>
+
+#include <freerdp/codec/color.h>
+
 #include "shadow.h"
 
 #include "shadow_surface.h"
 #define ALIGN_SCREEN_SIZE(size, align) \
 	((((size) % (align)) != 0) ? ((size) + (align) - ((size) % (align))) : (size))
 
+/* One frame being encoded, one published and one for the capture to write */
+#define SHADOW_SURFACE_FRAMES 3
+
+struct rdp_shadow_surface_frames
+{
+	rdpShadowSurfaceFrame frames[SHADOW_SURFACE_FRAMES];
+	rdpShadowSurfaceFrame* volatile current;
+	REGION16 pending; /* invalid region of skipped publications */
+	UINT64 generation;
+	UINT64 skipped;
+
+	/* Moves of the next publication, usable if reported by exactly one capture */
+	SHADOW_SURFACE_MOVE moves[SHADOW_SURFACE_MAX_MOVES];
+	UINT32 numMoves;
+	REGION16 dirty;
+	UINT32 hints;
+};
+
+static BOOL region16_union(REGION16* dst, const REGION16* src)
+{
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(src, &numRects);
+	return region16_union_rects(dst, dst, rects, numRects);
+}
+
+/* Only the capture thread replaces the current frame, the swap cannot fail */
+static void shadow_surface_set_current(rdpShadowSurfaceFrames* frames, rdpShadowSurfaceFrame* frame)
+{
+	rdpShadowSurfaceFrame* current = frames->current;
+	(void)InterlockedCompareExchangePointer((PVOID volatile*)&frames->current, frame, current);
+}
+
+static void shadow_surface_frames_free(rdpShadowSurfaceFrames* frames)
+{
+	if (!frames)
+		return;
+
+	for (size_t x = 0; x < ARRAYSIZE(frames->frames); x++)
+	{
+		winpr_aligned_free(frames->frames[x].data);
+		region16_uninit(&frames->frames[x].stale);
+		region16_uninit(&frames->frames[x].dirty);
+	}
+
+	region16_uninit(&frames->pending);
+	region16_uninit(&frames->dirty);
+	free(frames);
+}
+
+static rdpShadowSurfaceFrames* shadow_surface_frames_new(void)
+{
+	rdpShadowSurfaceFrames* frames =
+	    (rdpShadowSurfaceFrames*)calloc(1, sizeof(rdpShadowSurfaceFrames));
+
+	if (!frames)
+		return NULL;
+
+	for (size_t x = 0; x < ARRAYSIZE(frames->frames); x++)
+	{
+		region16_init(&frames->frames[x].stale);
+		region16_init(&frames->frames[x].dirty);
+	}
+
+	region16_init(&frames->pending);
+	region16_init(&frames->dirty);
+	return frames;
+}
+
+/* Bring a claimed frame up to date with the surface, the surface lock is held */
+static BOOL shadow_surface_frame_update(rdpShadowSurface* surface, rdpShadowSurfaceFrame* frame)
+{
+	const RECTANGLE_16 surfaceRect = { 0, 0, (UINT16)MIN(surface->width, UINT16_MAX),
+		                               (UINT16)MIN(surface->height, UINT16_MAX) };
+
+	if ((frame->width != surface->width) || (frame->height != surface->height) ||
+	    (frame->scanline != surface->scanline) || (frame->format != surface->format))
+	{
+		winpr_aligned_free(frame->data);
+		frame->data = winpr_aligned_malloc(1ull * surface->scanline * surface->height, 32);
+		if (!frame->data)
+		{
+			frame->width = 0;
+			frame->height = 0;
+			return FALSE;
+		}
+
+		frame->width = surface->width;
+		frame->height = surface->height;
+		frame->scanline = surface->scanline;
+		frame->format = surface->format;
+		region16_clear(&frame->stale);
+		if (!region16_union_rect(&frame->stale, &frame->stale, &surfaceRect))
+			return FALSE;
+	}
+
+	if (!region16_intersect_rect(&frame->stale, &frame->stale, &surfaceRect))
+		return FALSE;
+
+	UINT32 numRects = 0;
+	const RECTANGLE_16* rects = region16_rects(&frame->stale, &numRects);
+	const size_t bpp = FreeRDPGetBytesPerPixel(surface->format);
+
+	for (UINT32 x = 0; x < numRects; x++)
+	{
+		const RECTANGLE_16* rect = &rects[x];
+		const size_t offset = 1ull * rect->left * bpp;
+		const size_t length = 1ull * (rect->right - rect->left) * bpp;
+
+		for (UINT32 y = rect->top; y < rect->bottom; y++)
+		{
+			const size_t line = 1ull * y * surface->scanline + offset;
+			memcpy(&frame->data[line], &surface->data[line], length);
+		}
+	}
+
+	region16_clear(&frame->stale);
+	return TRUE;
+}
+
 rdpShadowSurface* shadow_surface_new(rdpShadowServer* server, UINT16 x, UINT16 y, UINT32 width,
                                      UINT32 height)
 {
@@ -64,6 +189,7 @@ void shadow_surface_free(rdpShadowSurface* surface)
 	if (!surface)
 		return;
 
+	shadow_surface_frames_free(surface->frames);
 	free(surface->data);
 	DeleteCriticalSection(&(surface->lock));
 	region16_uninit(&(surface->invalidRegion));
@@ -102,3 +228,155 @@ BOOL shadow_surface_resize(rdpShadowSurface* surface, UINT16 x, UINT16 y, UINT32
 
 	return FALSE;
 }
+
+BOOL shadow_surface_publish(rdpShadowSurface* surface)
+{
+	BOOL rc = TRUE;
+	rdpShadowSurfaceFrame* frame = NULL;
+
+	WINPR_ASSERT(surface);
+
+	EnterCriticalSection(&surface->lock);
+
+	if (!surface->frames && !(surface->frames = shadow_surface_frames_new()))
+		goto out;
+
+	rdpShadowSurfaceFrames* frames = surface->frames;
+
+	/* Moves are relative to the previous capture, which must be the previous publication */
+	BOOL moves = (frames->hints == 1);
+
+	/* Hand the changes of skipped publications to the clients with this one */
+	if (!region16_is_empty(&frames->pending))
+	{
+		moves = FALSE;
+		region16_union(&surface->invalidRegion, &frames->pending);
+		region16_clear(&frames->pending);
+	}
+
+	for (size_t x = 0; x < ARRAYSIZE(frames->frames); x++)
+		region16_union(&frames->frames[x].stale, &surface->invalidRegion);
+
+	/* Frames referenced by clients are left alone, only the capture thread claims frames */
+	for (size_t x = 0; x < ARRAYSIZE(frames->frames); x++)
+	{
+		rdpShadowSurfaceFrame* cur = &frames->frames[x];
+
+		if ((cur != frames->current) && (InterlockedCompareExchange(&cur->refs, -1, 0) == 0))
+		{
+			frame = cur;
+			break;
+		}
+	}
+
+	if (!frame)
+	{
+		region16_union(&frames->pending, &surface->invalidRegion);
+		frames->skipped++;
+		rc = FALSE;
+		goto out;
+	}
+
+	frames->hints = 0;
+	frame->numMoves = 0;
+	region16_clear(&frame->dirty);
+
+	if (!shadow_surface_frame_update(surface, frame))
+	{
+		/* Clients fall back to reading the surface with the lock held. The generation is
+		 * still counted, moves of the next frame do not apply to the current one. */
+		shadow_surface_set_current(frames, NULL);
+		frames->generation++;
+		(void)InterlockedExchange(&frame->refs, 0);
+		goto out;
+	}
+
+	if (moves && (frames->numMoves > 0) && region16_copy(&frame->dirty, &frames->dirty))
+	{
+		memcpy(frame->moves, frames->moves, frames->numMoves * sizeof(SHADOW_SURFACE_MOVE));
+		frame->numMoves = frames->numMoves;
+	}
+
+	frame->generation = ++frames->generation;
+	frame->timestamp = winpr_GetTickCount64NS();
+	(void)InterlockedExchange(&frame->refs, 0);
+	shadow_surface_set_current(frames, frame);
+
+out:
+	LeaveCriticalSection(&surface->lock);
+	return rc;
+}
+
+BOOL shadow_surface_set_moves(rdpShadowSurface* surface, const SHADOW_SURFACE_MOVE* moves,
+                              UINT32 numMoves, const RECTANGLE_16* dirty, UINT32 numDirty)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(surface);
+	WINPR_ASSERT(moves || (numMoves == 0));
+	WINPR_ASSERT(dirty || (numDirty == 0));
+
+	EnterCriticalSection(&surface->lock);
+
+	if (!surface->frames && !(surface->frames = shadow_surface_frames_new()))
+		goto out;
+
+	rdpShadowSurfaceFrames* frames = surface->frames;
+	frames->hints++;
+	frames->numMoves = 0;
+	region16_clear(&frames->dirty);
+
+	if (numMoves > ARRAYSIZE(frames->moves))
+	{
+		/* Too many to be worth it, the destinations are in the invalid region anyway */
+		rc = TRUE;
+		goto out;
+	}
+
+	if (!region16_union_rects(&frames->dirty, &frames->dirty, dirty, numDirty))
+		goto out;
+
+	if (numMoves > 0)
+		memcpy(frames->moves, moves, numMoves * sizeof(SHADOW_SURFACE_MOVE));
+	frames->numMoves = numMoves;
+	rc = TRUE;
+out:
+	LeaveCriticalSection(&surface->lock);
+	return rc;
+}
+
+rdpShadowSurfaceFrame* shadow_surface_acquire_frame(rdpShadowSurface* surface)
+{
+	WINPR_ASSERT(surface);
+
+	rdpShadowSurfaceFrames* frames = surface->frames;
+	if (!frames)
+		return NULL;
+
+	for (;;)
+	{
+		rdpShadowSurfaceFrame* frame = (rdpShadowSurfaceFrame*)InterlockedCompareExchangePointer(
+		    (PVOID volatile*)&frames->current, NULL, NULL);
+		if (!frame)
+			return NULL;
+
+		const LONG refs = frame->refs;
+		if ((refs < 0) || (InterlockedCompareExchange(&frame->refs, refs + 1, refs) != refs))
+			continue;
+
+		/* The frame may have been replaced and reclaimed before the reference was taken */
+		if (frame == frames->current)
+			return frame;
+
+		(void)InterlockedDecrement(&frame->refs);
+	}
+}
+
+void shadow_surface_release_frame(rdpShadowSurfaceFrame* frame)
+{
+	if (!frame)
+		return;
+
+	WINPR_ASSERT(frame->refs > 0);
+	(void)InterlockedDecrement(&frame->refs);
+}
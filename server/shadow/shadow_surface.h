@@ -24,6 +24,29 @@
 #include <winpr/crt.h>
 #include <winpr/synch.h>
 
+#define SHADOW_SURFACE_MAX_MOVES 8
+
+/** Copy of the surface published to the clients, read without holding the surface lock */
+typedef struct
+{
+	BYTE* data;
+	UINT32 scanline;
+	UINT32 width;
+	UINT32 height;
+	DWORD format;
+	UINT64 generation;
+	UINT64 timestamp; /* winpr_GetTickCount64NS of the publication */
+
+	REGION16 stale;     /* changed in the surface since this copy was written */
+	volatile LONG refs; /* readers, -1 while the capture thread writes it */
+
+	/* Generation - 1 becomes this frame by applying the moves in order and then updating
+	 * the dirty region. numMoves is 0 if the capture did not report moves. */
+	SHADOW_SURFACE_MOVE moves[SHADOW_SURFACE_MAX_MOVES];
+	UINT32 numMoves;
+	REGION16 dirty;
+} rdpShadowSurfaceFrame;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -38,6 +61,14 @@ extern "C"
 	BOOL shadow_surface_resize(rdpShadowSurface* surface, UINT16 x, UINT16 y, UINT32 width,
 	                           UINT32 height);
 
+	/* Copy the invalid region to a free frame and make it the current one. Returns FALSE
+	 * if all frames are still read by clients, the changes are then published next time. */
+	BOOL shadow_surface_publish(rdpShadowSurface* surface);
+
+	/* Reference the current frame, NULL if there is none and the surface must be used */
+	rdpShadowSurfaceFrame* shadow_surface_acquire_frame(rdpShadowSurface* surface);
+	void shadow_surface_release_frame(rdpShadowSurfaceFrame* frame);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,89 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+
+#include "shadow_gfx_cache.h"
+
+#define TEST_SIZE 128
+#define TEST_STEP (TEST_SIZE * 4)
+#define TEST_TILE 64
+
+static void test_fill_tile(BYTE* image, UINT32 tx, UINT32 ty, UINT32 seed)
+{
+	UINT32 state = seed * 2654435761u + 1;
+
+	for (size_t y = 0; y < TEST_TILE; y++)
+	{
+		BYTE* row = &image[(ty * TEST_TILE + y) * TEST_STEP + tx * TEST_TILE * 4];
+		for (size_t x = 0; x < TEST_TILE * 4; x++)
+		{
+			state = state * 1103515245u + 12345u;
+			row[x] = (BYTE)(state >> 16);
+		}
+	}
+}
+
+static BOOL test_process(rdpShadowGfxCache* cache, const BYTE* image, UINT32 fills,
+                         UINT32 copies, UINT32 stores, BOOL encode)
+{
+	const RECTANGLE_16 rect = { 0, 0, TEST_SIZE, TEST_SIZE };
+	SHADOW_GFX_CACHE_FRAME frame = { 0 };
+
+	region16_init(&frame.encode);
+	BOOL rc = shadow_gfx_cache_process(cache, 1, image, TEST_STEP, &rect, NULL, &frame);
+	if (rc && ((frame.numFills != fills) || (frame.numCopies != copies) ||
+	           (frame.numStores != stores) || (region16_is_empty(&frame.encode) == encode)))
+	{
+		printf("got %" PRIu32 " fills, %" PRIu32 " copies, %" PRIu32 " stores, encode %d\n",
+		       frame.numFills, frame.numCopies, frame.numStores,
+		       !region16_is_empty(&frame.encode));
+		rc = FALSE;
+	}
+	region16_uninit(&frame.encode);
+	return rc;
+}
+
+int TestShadowGfxCache(int argc, char* argv[])
+{
+	int rc = -1;
+	BYTE* image = calloc(TEST_SIZE, TEST_STEP);
+	rdpShadowGfxCache* cache = shadow_gfx_cache_new(16);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!image || !cache || !shadow_gfx_cache_reset(cache, TEST_SIZE, TEST_SIZE))
+		goto fail;
+
+	for (UINT32 x = 0; x < 4; x++)
+		test_fill_tile(image, x % 2, x / 2, x);
+
+	/* New content is encoded, stable content is stored in the client cache */
+	if (!test_process(cache, image, 0, 0, 0, TRUE))
+		goto fail;
+	if (!test_process(cache, image, 0, 0, 4, FALSE))
+		goto fail;
+	if (!test_process(cache, image, 0, 0, 0, FALSE))
+		goto fail;
+
+	/* Content of a cached tile shown elsewhere is copied from the cache */
+	test_fill_tile(image, 0, 0, 3);
+	if (!test_process(cache, image, 0, 1, 0, FALSE))
+		goto fail;
+
+	/* A single changed pixel is encoded */
+	image[TEST_STEP * 70 + 4 * 100] ^= 0x01;
+	if (!test_process(cache, image, 0, 0, 0, TRUE))
+		goto fail;
+
+	/* Solid tiles are filled, the changed tile is stable now */
+	memset(image, 0x20, TEST_STEP * TEST_TILE);
+	if (!test_process(cache, image, 1, 0, 1, FALSE))
+		goto fail;
+
+	rc = 0;
+fail:
+	shadow_gfx_cache_free(cache);
+	free(image);
+	return rc;
+}
@@ -0,0 +1,90 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/synch.h>
+#include <winpr/interlocked.h>
+
+#include "shadow_pipeline.h"
+
+typedef struct
+{
+	LONG encodes;
+	LONG running;
+	LONG ownerActive;
+	LONG failed;
+} TEST_PIPELINE_STATE;
+
+static BOOL test_encode(void* arg)
+{
+	TEST_PIPELINE_STATE* state = arg;
+
+	/* The owner must not touch the encoder state while a frame encodes */
+	if ((InterlockedIncrement(&state->running) != 1) ||
+	    (InterlockedCompareExchange(&state->ownerActive, 0, 0) != 0))
+		(void)InterlockedExchange(&state->failed, 1);
+
+	Sleep(10);
+	(void)InterlockedIncrement(&state->encodes);
+	(void)InterlockedDecrement(&state->running);
+	return TRUE;
+}
+
+/* The owner encodes on its own between pipeline frames, the worker has to stay idle */
+static BOOL test_owner_work(TEST_PIPELINE_STATE* state)
+{
+	const LONG encodes = InterlockedCompareExchange(&state->encodes, 0, 0);
+
+	(void)InterlockedExchange(&state->ownerActive, 1);
+	Sleep(50);
+	(void)InterlockedExchange(&state->ownerActive, 0);
+	return InterlockedCompareExchange(&state->encodes, 0, 0) == encodes;
+}
+
+int TestShadowPipeline(int argc, char* argv[])
+{
+	int rc = -1;
+	SHADOW_PIPELINE pipeline = { 0 };
+	TEST_PIPELINE_STATE state = { 0 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!shadow_pipeline_init(&pipeline, test_encode, &state))
+		goto fail;
+
+	/* Two frames back to back */
+	for (size_t x = 0; x < 2; x++)
+	{
+		if (!shadow_pipeline_start(&pipeline))
+			goto fail;
+		if (shadow_pipeline_start(&pipeline))
+		{
+			(void)fprintf(stderr, "started a frame while the previous one encodes\n");
+			goto fail;
+		}
+		if (!shadow_pipeline_wait(&pipeline))
+			goto fail;
+	}
+
+	if (!test_owner_work(&state))
+	{
+		(void)fprintf(stderr, "the pipeline encoded without being started\n");
+		goto fail;
+	}
+
+	if ((state.encodes != 2) || (state.failed != 0))
+	{
+		(void)fprintf(stderr, "%" PRId32 " frames encoded, expected 2, failed=%" PRId32 "\n",
+		              state.encodes, state.failed);
+		goto fail;
+	}
+
+	/* A wait without a running frame returns right away */
+	if (!shadow_pipeline_wait(&pipeline))
+		goto fail;
+
+	rc = 0;
+fail:
+	shadow_pipeline_uninit(&pipeline);
+	return rc;
+}
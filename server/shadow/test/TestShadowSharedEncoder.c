@@ -0,0 +1,170 @@
+#include <stdio.h>
+
+#include <winpr/crt.h>
+#include <winpr/stream.h>
+
+#include <freerdp/codec/color.h>
+#include <freerdp/codec/region.h>
+#include <freerdp/codec/rfx.h>
+#include <freerdp/channels/rdpgfx.h>
+
+#include "shadow_shared_encoder.h"
+
+#define TEST_WIDTH 128
+#define TEST_HEIGHT 64
+#define TEST_FORMAT PIXEL_FORMAT_BGRX32
+#define TEST_STRIDE (TEST_WIDTH * 4)
+
+typedef struct
+{
+	RFX_CONTEXT* rfx;
+	const BYTE* image;
+	RFX_RECT rect;
+	size_t encodes;
+} TEST_SHARED_CLIENT;
+
+static BOOL test_encode_rfx(void* ctx, BYTE** ppData, UINT32* pLength)
+{
+	TEST_SHARED_CLIENT* client = ctx;
+	wStream* s = Stream_New(NULL, 1024);
+
+	if (!s)
+		return FALSE;
+
+	if (!shadow_shared_encoder_compose_rfx(client->rfx, TEST_WIDTH, TEST_HEIGHT, s, &client->rect,
+	                                       1, client->image, TEST_WIDTH, TEST_HEIGHT,
+	                                       TEST_STRIDE))
+	{
+		Stream_Free(s, TRUE);
+		return FALSE;
+	}
+
+	*ppData = Stream_Buffer(s);
+	*pLength = (UINT32)Stream_GetPosition(s);
+	Stream_Free(s, FALSE);
+	client->encodes++;
+	return TRUE;
+}
+
+static BOOL test_shared_frame(rdpShadowSharedEncoder* shared, TEST_SHARED_CLIENT* client,
+                              BYTE** ppData, UINT32* pLength)
+{
+	const RECTANGLE_16 rect = { 0, 0, TEST_WIDTH, TEST_HEIGHT };
+
+	return shadow_shared_encoder_encode(shared, RDPGFX_CODECID_CAVIDEO, 0, client->image, &rect,
+	                                    test_encode_rfx, client, ppData, pLength);
+}
+
+static BOOL test_decode(RFX_CONTEXT* decoder, const BYTE* data, UINT32 length, BYTE* dst)
+{
+	REGION16 region = { 0 };
+
+	region16_init(&region);
+	const BOOL rc = rfx_process_message(decoder, data, length, 0, 0, dst, TEST_FORMAT,
+	                                    TEST_STRIDE, TEST_HEIGHT, &region);
+	region16_uninit(&region);
+	return rc;
+}
+
+static void test_fill_image(BYTE* image, UINT32 seed)
+{
+	for (size_t y = 0; y < TEST_HEIGHT; y++)
+	{
+		for (size_t x = 0; x < TEST_WIDTH; x++)
+		{
+			BYTE* pixel = &image[y * TEST_STRIDE + x * 4];
+			pixel[0] = (BYTE)(x * 2 + seed);
+			pixel[1] = (BYTE)(y * 4 + seed);
+			pixel[2] = (BYTE)((x ^ y) + seed);
+			pixel[3] = 0xFF;
+		}
+	}
+}
+
+/* A client joining after the first frame decodes a stream another client's context encoded */
+int TestShadowSharedEncoder(int argc, char* argv[])
+{
+	int rc = -1;
+	BYTE* frame[2] = { 0 };
+	UINT32 length[2] = { 0 };
+	BYTE* image = calloc(TEST_HEIGHT, TEST_STRIDE);
+	BYTE* dstA = calloc(TEST_HEIGHT, TEST_STRIDE);
+	BYTE* dstB = calloc(TEST_HEIGHT, TEST_STRIDE);
+	rdpShadowSharedEncoder* shared = shadow_shared_encoder_new();
+	TEST_SHARED_CLIENT clientA = { rfx_context_new(TRUE), image, { 0, 0, TEST_WIDTH, TEST_HEIGHT },
+		                           0 };
+	TEST_SHARED_CLIENT clientB = { rfx_context_new(TRUE), image, { 0, 0, TEST_WIDTH, TEST_HEIGHT },
+		                           0 };
+	RFX_CONTEXT* decoderA = rfx_context_new(FALSE);
+	RFX_CONTEXT* decoderB = rfx_context_new(FALSE);
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!image || !dstA || !dstB || !shared || !clientA.rfx || !clientB.rfx || !decoderA ||
+	    !decoderB)
+		goto fail;
+
+	if (!rfx_context_reset(clientA.rfx, TEST_WIDTH, TEST_HEIGHT) ||
+	    !rfx_context_reset(clientB.rfx, TEST_WIDTH, TEST_HEIGHT))
+		goto fail;
+
+	/* Frame 1 only goes to client A */
+	test_fill_image(image, 0);
+	if (!test_shared_frame(shared, &clientA, &frame[0], &length[0]))
+		goto fail;
+	if (!test_decode(decoderA, frame[0], length[0], dstA))
+		goto fail;
+
+	/* Frame 2 is encoded by client A and reused for client B, which joined late */
+	shadow_shared_encoder_next_frame(shared);
+	test_fill_image(image, 77);
+	free(frame[0]);
+	frame[0] = NULL;
+	if (!test_shared_frame(shared, &clientA, &frame[0], &length[0]))
+		goto fail;
+	if (!test_shared_frame(shared, &clientB, &frame[1], &length[1]))
+		goto fail;
+
+	if ((clientA.encodes != 2) || (clientB.encodes != 0))
+	{
+		printf("frame 2 was not shared: %" PRIuz " %" PRIuz " encodes\n", clientA.encodes,
+		       clientB.encodes);
+		goto fail;
+	}
+
+	if ((length[0] != length[1]) || (memcmp(frame[0], frame[1], length[0]) != 0))
+		goto fail;
+
+	if (!test_decode(decoderA, frame[0], length[0], dstA))
+	{
+		printf("decoder A failed to decode the shared frame\n");
+		goto fail;
+	}
+
+	if (!test_decode(decoderB, frame[1], length[1], dstB))
+	{
+		printf("decoder B failed to decode the shared frame\n");
+		goto fail;
+	}
+
+	if (memcmp(dstA, dstB, 1ull * TEST_HEIGHT * TEST_STRIDE) != 0)
+	{
+		printf("the decoders disagree on the shared frame\n");
+		goto fail;
+	}
+
+	rc = 0;
+fail:
+	free(frame[0]);
+	free(frame[1]);
+	rfx_context_free(decoderA);
+	rfx_context_free(decoderB);
+	rfx_context_free(clientA.rfx);
+	rfx_context_free(clientB.rfx);
+	shadow_shared_encoder_free(shared);
+	free(image);
+	free(dstA);
+	free(dstB);
+	return rc;
+}
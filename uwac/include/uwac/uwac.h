@@ -535,8 +535,8 @@ extern "C"
 	 *	Sends a frame to the compositor with the content of the drawing buffer
 	 *
 	 * @param window the UwacWindow to refresh
-	 * @param copyContentForNextFrame if true the content to display is copied in the next drawing
-	 *buffer
+	 * @param copyContentForNextFrame if true the next drawing buffer is brought up to date with the
+	 *submitted one, only the areas it missed since it was last drawn to are copied
 	 * @return UWAC_SUCCESS if the operation was successful
 	 */
 	UWAC_API UwacReturnCode UwacWindowSubmitBuffer(UwacWindow* window,
@@ -35,7 +35,7 @@
 #include "uwac-os.h"
 #include "wayland-cursor.h"
 
-#define TARGET_COMPOSITOR_INTERFACE 3U
+#define TARGET_COMPOSITOR_INTERFACE 4U
 #define TARGET_SHM_INTERFACE 1U
 #define TARGET_SHELL_INTERFACE 1U
 #define TARGET_DDM_INTERFACE 1U
@@ -152,8 +152,9 @@ static void registry_handle_global(void* data, struct wl_registry* registry, uin
 
 	if (strcmp(interface, "wl_compositor") == 0)
 	{
-		d->compositor = wl_registry_bind(registry, id, &wl_compositor_interface,
-		                                 min(TARGET_COMPOSITOR_INTERFACE, version));
+		d->compositor_version = min(TARGET_COMPOSITOR_INTERFACE, version);
+		d->compositor =
+		    wl_registry_bind(registry, id, &wl_compositor_interface, d->compositor_version);
 	}
 	else if (strcmp(interface, "wl_shm") == 0)
 	{
@@ -93,6 +93,7 @@ struct uwac_display
 	struct wl_display* display;
 	struct wl_registry* registry;
 	struct wl_compositor* compositor;
+	uint32_t compositor_version;
 	struct wp_viewporter* viewporter;
 	struct wl_subcompositor* subcompositor;
 	struct wl_shell* shell;
@@ -225,8 +226,10 @@ struct uwac_buffer
 	bool dirty;
 #ifdef UWAC_HAVE_PIXMAN_REGION
 	pixman_region32_t damage;
+	pixman_region32_t repair;
 #else
 	REGION16 damage;
+	REGION16 repair;
 #endif
 	struct wl_buffer* wayland_buffer;
 	void* data;
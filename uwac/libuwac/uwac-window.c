@@ -63,8 +63,10 @@ static void UwacWindowDestroyBuffers(UwacWindow* w)
 		UwacBuffer* buffer = &w->buffers[i];
 #ifdef UWAC_HAVE_PIXMAN_REGION
 		pixman_region32_fini(&buffer->damage);
+		pixman_region32_fini(&buffer->repair);
 #else
 		region16_uninit(&buffer->damage);
+		region16_uninit(&buffer->repair);
 #endif
 		UwacBufferReleaseData* releaseData =
 		    (UwacBufferReleaseData*)wl_buffer_get_user_data(buffer->wayland_buffer);
@@ -377,8 +379,13 @@ int UwacWindowShmAllocBuffers(UwacWindow* w, int64_t nbuffers, int64_t allocSize
 		UwacBuffer* buffer = &w->buffers[bufferIdx];
 #ifdef UWAC_HAVE_PIXMAN_REGION
 		pixman_region32_init(&buffer->damage);
+		/* a new buffer has no content yet, it needs a full copy before it can be drawn to */
+		pixman_region32_init_rect(&buffer->repair, 0, 0, width, height);
 #else
+		const RECTANGLE_16 box = { 0, 0, width, height };
 		region16_init(&buffer->damage);
+		region16_init(&buffer->repair);
+		region16_union_rect(&buffer->repair, &buffer->repair, &box);
 #endif
 		buffer->data = &((char*)data)[allocSize * idx];
 		buffer->size = allocSize;
@@ -695,9 +702,18 @@ static void damage_surface(UwacWindow* window, UwacBuffer* buffer, int scale)
 {
 	int nrects = 0;
 	const pixman_box32_t* box = pixman_region32_rectangles(&buffer->damage, &nrects);
+	const bool damageBuffer =
+	    window->display->compositor_version >= WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION;
 
 	for (int i = 0; i < nrects; i++, box++)
 	{
+		if (damageBuffer)
+		{
+			wl_surface_damage_buffer(window->surface, box->x1, box->y1, box->x2 - box->x1,
+			                         box->y2 - box->y1);
+			continue;
+		}
+
 		const int x = ((int)floor(box->x1 / scale)) - 1;
 		const int y = ((int)floor(box->y1 / scale)) - 1;
 		const int w = ((int)ceil((box->x2 - box->x1) / scale)) + 2;
@@ -705,17 +721,59 @@ static void damage_surface(UwacWindow* window, UwacBuffer* buffer, int scale)
 		wl_surface_damage(window->surface, x, y, w, h);
 	}
 
+	/* all other buffers miss this damage now */
+	for (size_t i = 0; i < window->nbuffers; i++)
+	{
+		UwacBuffer* other = &window->buffers[i];
+		if (other != buffer)
+			pixman_region32_union(&other->repair, &other->repair, &buffer->damage);
+	}
+
 	pixman_region32_clear(&buffer->damage);
 }
+
+static void repair_buffer(UwacWindow* window, UwacBuffer* dst, const UwacBuffer* src)
+{
+	int nrects = 0;
+	const int bpp = bppFromShmFormat(window->format);
+
+	pixman_region32_intersect_rect(&dst->repair, &dst->repair, 0, 0, window->width,
+	                               window->height);
+	const pixman_box32_t* box = pixman_region32_rectangles(&dst->repair, &nrects);
+
+	for (int i = 0; i < nrects; i++, box++)
+	{
+		const size_t offset = 1ull * box->y1 * window->stride + 1ull * box->x1 * bpp;
+		const size_t width = 1ull * (box->x2 - box->x1) * bpp;
+
+		for (int y = box->y1; y < box->y2; y++)
+		{
+			const size_t pos = offset + 1ull * (y - box->y1) * window->stride;
+			memcpy(&((char*)dst->data)[pos], &((const char*)src->data)[pos], width);
+		}
+	}
+
+	pixman_region32_clear(&dst->repair);
+}
 #else
 static void damage_surface(UwacWindow* window, UwacBuffer* buffer, int scale)
 {
 	uint32_t nrects = 0;
 	const RECTANGLE_16* boxes = region16_rects(&buffer->damage, &nrects);
+	const bool damageBuffer =
+	    window->display->compositor_version >= WL_SURFACE_DAMAGE_BUFFER_SINCE_VERSION;
 
 	for (UINT32 i = 0; i < nrects; i++)
 	{
 		const RECTANGLE_16* box = &boxes[i];
+
+		if (damageBuffer)
+		{
+			wl_surface_damage_buffer(window->surface, box->left, box->top,
+			                         box->right - box->left, box->bottom - box->top);
+			continue;
+		}
+
 		const double dx = floor(1.0 * box->left / scale);
 		const double dy = floor(1.0 * box->top / scale);
 		const double dw = ceil(1.0 * (box->right - box->left) / scale);
@@ -727,8 +785,44 @@ static void damage_surface(UwacWindow* window, UwacBuffer* buffer, int scale)
 		wl_surface_damage(window->surface, x, y, w, h);
 	}
 
+	/* all other buffers miss this damage now */
+	for (size_t x = 0; x < window->nbuffers; x++)
+	{
+		UwacBuffer* other = &window->buffers[x];
+		if (other == buffer)
+			continue;
+
+		for (UINT32 i = 0; i < nrects; i++)
+			region16_union_rect(&other->repair, &other->repair, &boxes[i]);
+	}
+
 	region16_clear(&buffer->damage);
 }
+
+static void repair_buffer(UwacWindow* window, UwacBuffer* dst, const UwacBuffer* src)
+{
+	uint32_t nrects = 0;
+	const int bpp = bppFromShmFormat(window->format);
+	const RECTANGLE_16 frame = { 0, 0, window->width, window->height };
+
+	region16_intersect_rect(&dst->repair, &dst->repair, &frame);
+	const RECTANGLE_16* boxes = region16_rects(&dst->repair, &nrects);
+
+	for (UINT32 i = 0; i < nrects; i++)
+	{
+		const RECTANGLE_16* box = &boxes[i];
+		const size_t offset = 1ull * box->top * window->stride + 1ull * box->left * bpp;
+		const size_t width = 1ull * (box->right - box->left) * bpp;
+
+		for (UINT32 y = box->top; y < box->bottom; y++)
+		{
+			const size_t pos = offset + 1ull * (y - box->top) * window->stride;
+			memcpy(&((char*)dst->data)[pos], &((const char*)src->data)[pos], width);
+		}
+	}
+
+	region16_clear(&dst->repair);
+}
 #endif
 
 static void UwacSubmitBufferPtr(UwacWindow* window, UwacBuffer* buffer)
@@ -839,11 +933,12 @@ UwacReturnCode UwacWindowSubmitBuffer(UwacWindow* window, bool copyContentForNex
 	if ((!nextDrawingBuffer) || (window->drawingBufferIdx < 0))
 		return UWAC_ERROR_NOMEMORY;
 
+	UwacSubmitBufferPtr(window, pendingBuffer);
+
+	/* Only bring over what changed since the next buffer was last drawn to */
 	if (copyContentForNextFrame)
-		memcpy(nextDrawingBuffer->data, pendingBuffer->data,
-		       1ull * window->stride * window->height);
+		repair_buffer(window, nextDrawingBuffer, pendingBuffer);
 
-	UwacSubmitBufferPtr(window, pendingBuffer);
 	return UWAC_SUCCESS;
 }
 
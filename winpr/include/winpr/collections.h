@@ -771,6 +771,27 @@ extern "C"
 	WINPR_ATTR_MALLOC(MessageQueue_Free, 1)
 	WINPR_API wMessageQueue* MessageQueue_New(const wObject* callback);
 
+/** Only one thread ever reads from the queue */
+#define WMQ_FLAG_SINGLE_CONSUMER 0x00000001
+
+	/*! \brief Creates a new message queue with the behaviour selected by \b flags.
+	 *
+	 *  With \b WMQ_FLAG_SINGLE_CONSUMER the messages are kept in a linked ring of blocks.
+	 *  Posting threads only serialize among themselves, the reading thread never takes a
+	 *  lock and the event is only set when the queue goes from empty to non-empty.
+	 *  'MessageQueue_Get', 'MessageQueue_Peek' and 'MessageQueue_Clear' must then
+	 *  always be called from the same thread.
+	 *
+	 * \param callback a pointer to custom initialization / cleanup functions.
+	 * 								 Can be NULL if not used.
+	 * \param flags A combination of WMQ_FLAG_* values
+	 *
+	 * \return A pointer to a newly allocated MessageQueue or NULL.
+	 *  @since version 3.9.0
+	 */
+	WINPR_ATTR_MALLOC(MessageQueue_Free, 1)
+	WINPR_API wMessageQueue* MessageQueue_NewEx(const wObject* callback, UINT32 flags);
+
 	/* Message Pipe */
 
 	typedef struct
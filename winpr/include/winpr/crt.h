@@ -240,6 +240,40 @@ extern "C"
 #define winpr_aligned_calloc(count, size, alignment) _aligned_recalloc(NULL, count, size, alignment)
 #endif /* defined(_WIN32) && (!defined(__MINGW32__) || defined(_UCRT)) */
 
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	/** @brief Free a buffer allocated with winpr_large_malloc or winpr_large_calloc
+	 *  @since version 3.9.0
+	 */
+	WINPR_API void winpr_large_free(void* memblock);
+
+	/** @brief Allocate an aligned buffer for framebuffers, codec planes and alike
+	 *
+	 *  Buffers of 2MiB and more are backed by huge pages where the system supports them
+	 *  (reserved hugetlb pages first, transparent huge pages otherwise) to reduce TLB pressure,
+	 *  smaller ones are ordinary aligned allocations.
+	 *
+	 *  @param size The size of the buffer in bytes
+	 *  @param alignment The alignment, a power of 2 of at most 2MiB
+	 *  @return The buffer or \b NULL, free with winpr_large_free
+	 *  @since version 3.9.0
+	 */
+	WINPR_ATTR_MALLOC(winpr_large_free, 1)
+	WINPR_API void* winpr_large_malloc(size_t size, size_t alignment);
+
+	/** @brief Like winpr_large_malloc, the buffer is zeroed
+	 *  @since version 3.9.0
+	 */
+	WINPR_ATTR_MALLOC(winpr_large_free, 1)
+	WINPR_API void* winpr_large_calloc(size_t count, size_t size, size_t alignment);
+
+#ifdef __cplusplus
+}
+#endif
+
 WINPR_PRAGMA_DIAG_POP
 
 #endif /* WINPR_CRT_H */
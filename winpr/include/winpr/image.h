@@ -96,6 +96,19 @@ typedef enum
 
 /** @} */
 
+/** @defgroup WINPR_IMAGE_WRITE_FLAGS WINPR_IMAGE_WRITE_FLAGS
+ *  @since version 3.9.0
+ *  @{
+ */
+typedef enum
+{
+	WINPR_IMAGE_WRITE_NO_FLAGS = 0,
+	WINPR_IMAGE_WRITE_FAST = 1,     /**< favour encoding speed over output size */
+	WINPR_IMAGE_WRITE_BOTTOM_UP = 2 /**< the image lines are stored bottom up, like a DIB */
+} wImageWriteFlags;
+
+/** @} */
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -137,6 +150,21 @@ extern "C"
 	 * as deallocator
 	 */
 	WINPR_API void* winpr_image_write_buffer(wImage* image, UINT32 format, size_t* size);
+
+	/** @brief write a bitmap to a buffer and return it
+	 *
+	 *  @param image the image to write
+	 *  @param format the format of type @ref WINPR_IMAGE_FORMAT
+	 *  @param flags a combination of @ref WINPR_IMAGE_WRITE_FLAGS
+	 *  @param size a pointer to hold the size in bytes of the allocated bitmap
+	 *
+	 *  @since version 3.9.0
+	 *
+	 *  @return \b NULL in case of failure, a pointer to an allocated buffer otherwise. Use \b free
+	 * as deallocator
+	 */
+	WINPR_API void* winpr_image_write_buffer_ex(wImage* image, UINT32 format, UINT32 flags,
+	                                            size_t* size);
 	WINPR_API int winpr_image_read_buffer(wImage* image, const BYTE* buffer, size_t size);
 
 	WINPR_API void winpr_image_free(wImage* image, BOOL bFreeBuffer);
@@ -234,6 +234,28 @@ extern "C"
 
 #endif /* WINPR_THREAD_POOL */
 
+	/* WinPR extensions */
+
+	typedef VOID (*PTP_WORK_BATCH_CALLBACK)(PVOID Context, size_t Index);
+
+	/**
+	 * @brief Run a callback for every index of [0, count) on a thread pool and wait for all of
+	 * them (fork-join).
+	 *
+	 * Indices are handed out from a shared counter to at most one runner per processor, the
+	 * calling thread being one of them. Only one work object is submitted and waited for, no
+	 * matter how large count is.
+	 *
+	 * @param pfnwk The callback to run for each index
+	 * @param pv The context passed to each callback
+	 * @param count The number of indices
+	 * @param pcbe The callback environment selecting the pool, NULL for the default pool
+	 * @return TRUE if all callbacks have run, FALSE for invalid arguments
+	 * @since version 3.9.0
+	 */
+	WINPR_API BOOL winpr_SubmitThreadpoolWorkBatch(PTP_WORK_BATCH_CALLBACK pfnwk, PVOID pv,
+	                                               size_t count, PTP_CALLBACK_ENVIRON pcbe);
+
 #if !defined(_WIN32)
 #define WINPR_CALLBACK_ENVIRON 1
 #elif defined(_WIN32) && (_WIN32_WINNT < 0x0600)
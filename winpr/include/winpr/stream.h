@@ -698,6 +698,78 @@ extern "C"
 		Stream_Seek(_s, _n);
 	}
 
+	/**
+	 * @brief Consume a fixed size record from the stream
+	 *
+	 * The caller must have checked the remaining length beforehand, e.g. with
+	 * Stream_CheckAndLogRequiredLength. The fields can then be read from the returned
+	 * pointer with Data_Read_* at constant offsets, one bounds check for the whole record.
+	 *
+	 * @param _s The stream to read from
+	 * @param _n The size of the record in bytes
+	 * @return A pointer to the start of the record
+	 * @since version 3.9.0
+	 */
+	static INLINE const BYTE* Stream_ReadSpan(wStream* _s, size_t _n)
+	{
+		WINPR_ASSERT(_s);
+		WINPR_ASSERT(Stream_GetRemainingLength(_s) >= _n);
+
+		const BYTE* span = _s->pointer;
+		_s->pointer += _n;
+		return span;
+	}
+
+	/**
+	 * @brief Read an array of little endian 16bit integers
+	 *
+	 * The caller must have checked the remaining length for @p _nmemb elements.
+	 *
+	 * @param _s The stream to read from
+	 * @param _v The destination array
+	 * @param _nmemb The number of elements to read
+	 * @since version 3.9.0
+	 */
+	static INLINE void Stream_ReadArray_UINT16(wStream* _s, UINT16* _v, size_t _nmemb)
+	{
+		WINPR_ASSERT(_s);
+		WINPR_ASSERT(_v || (_nmemb == 0));
+		WINPR_ASSERT(Stream_GetRemainingLength(_s) / sizeof(UINT16) >= _nmemb);
+
+#if defined(__LITTLE_ENDIAN__)
+		memcpy(_v, _s->pointer, _nmemb * sizeof(UINT16));
+#else
+		for (size_t x = 0; x < _nmemb; x++)
+			Data_Read_UINT16(&_s->pointer[x * sizeof(UINT16)], _v[x]);
+#endif
+		_s->pointer += _nmemb * sizeof(UINT16);
+	}
+
+	/**
+	 * @brief Read an array of little endian 32bit integers
+	 *
+	 * The caller must have checked the remaining length for @p _nmemb elements.
+	 *
+	 * @param _s The stream to read from
+	 * @param _v The destination array
+	 * @param _nmemb The number of elements to read
+	 * @since version 3.9.0
+	 */
+	static INLINE void Stream_ReadArray_UINT32(wStream* _s, UINT32* _v, size_t _nmemb)
+	{
+		WINPR_ASSERT(_s);
+		WINPR_ASSERT(_v || (_nmemb == 0));
+		WINPR_ASSERT(Stream_GetRemainingLength(_s) / sizeof(UINT32) >= _nmemb);
+
+#if defined(__LITTLE_ENDIAN__)
+		memcpy(_v, _s->pointer, _nmemb * sizeof(UINT32));
+#else
+		for (size_t x = 0; x < _nmemb; x++)
+			Data_Read_UINT32(&_s->pointer[x * sizeof(UINT32)], _v[x]);
+#endif
+		_s->pointer += _nmemb * sizeof(UINT32);
+	}
+
 #define Stream_Peek_UINT8(_s, _v)       \
 	do                                  \
 	{                                   \
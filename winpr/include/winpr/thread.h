@@ -293,6 +293,38 @@ WINPR_PRAGMA_DIAG_POP
 	WINPR_API LPSTR* CommandLineToArgvA(LPCSTR lpCmdLine, int* pNumArgs);
 	WINPR_API VOID DumpThreadHandles(void);
 
+	/** @brief Parse a processor list like \b 0-3,8,10-11
+	 *
+	 *  @param list The list to parse
+	 *  @param cpus The array receiving the processor numbers
+	 *  @param count The capacity of cpus, receives the number of processors on success
+	 *  @return \b TRUE for success, \b FALSE for malformed lists or insufficient capacity
+	 *  @since version 3.9.0
+	 */
+	WINPR_API BOOL winpr_ParseProcessorList(const char* list, UINT32* cpus, size_t* count);
+
+	/** @brief Get the processors belonging to a NUMA node
+	 *
+	 *  @param node The NUMA node number
+	 *  @param cpus The array receiving the processor numbers
+	 *  @param count The capacity of cpus, receives the number of processors on success
+	 *  @return \b TRUE for success, \b FALSE if the node is unknown or not supported
+	 *  @since version 3.9.0
+	 */
+	WINPR_API BOOL winpr_GetNumaNodeProcessors(UINT32 node, UINT32* cpus, size_t* count);
+
+	/** @brief Restrict the calling thread to a set of processors
+	 *
+	 *  Threads created afterwards by the calling thread, like the workers of a thread pool it
+	 *  creates, inherit the restriction on POSIX systems.
+	 *
+	 *  @param cpus The processor numbers
+	 *  @param count The number of processors, \b 0 allows all processors
+	 *  @return \b TRUE for success, \b FALSE otherwise
+	 *  @since version 3.9.0
+	 */
+	WINPR_API BOOL winpr_SetCurrentThreadAffinity(const UINT32* cpus, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -46,6 +46,20 @@ extern "C"
 #define WLOG_OFF 6
 #define WLOG_LEVEL_INHERIT 0xFFFF
 
+/**
+ * Messages below this level are removed at compile time.
+ * Set with -DWITH_WLOG_MIN_LEVEL=<level> when configuring the build.
+ */
+#if !defined(WINPR_WLOG_MIN_LEVEL)
+#define WINPR_WLOG_MIN_LEVEL WLOG_TRACE
+#endif
+
+#if WINPR_WLOG_MIN_LEVEL > WLOG_TRACE
+#define WLog_IsLevelCompiled(_log_level) ((_log_level) >= WINPR_WLOG_MIN_LEVEL)
+#else
+#define WLog_IsLevelCompiled(_log_level) TRUE
+#endif
+
 /**
  * Log Message
  */
@@ -112,6 +126,15 @@ extern "C"
 
 	WINPR_API wLog* WLog_GetRoot(void);
 	WINPR_API wLog* WLog_Get(LPCSTR name);
+	/** @brief Get the effective level of a logger.
+	 *
+	 *  The level is cached per logger and only recomputed after a level or filter changed
+	 *  somewhere, so this is cheap enough to call on every message.
+	 *
+	 *  @param log The logger to query
+	 *
+	 *  @return The effective level, \b WLOG_OFF if \b log is \b NULL
+	 */
 	WINPR_API DWORD WLog_GetLogLevel(wLog* log);
 	WINPR_API BOOL WLog_IsLevelActive(wLog* _log, DWORD _log_level);
 
@@ -134,22 +157,25 @@ extern "C"
 		                  __VA_ARGS__);                                                      \
 	} while (0)
 
-#define WLog_Print(_log, _log_level, ...)                        \
-	do                                                           \
-	{                                                            \
-		if (WLog_IsLevelActive(_log, _log_level))                \
-		{                                                        \
-			WLog_Print_unchecked(_log, _log_level, __VA_ARGS__); \
-		}                                                        \
+#define WLog_Print(_log, _log_level, ...)                                             \
+	do                                                                                \
+	{                                                                                 \
+		if (WLog_IsLevelCompiled(_log_level) && WLog_IsLevelActive(_log, _log_level)) \
+		{                                                                             \
+			WLog_Print_unchecked(_log, _log_level, __VA_ARGS__);                      \
+		}                                                                             \
 	} while (0)
 
-#define WLog_Print_tag(_tag, _log_level, ...)                 \
-	do                                                        \
-	{                                                         \
-		static wLog* _log_cached_ptr = NULL;                  \
-		if (!_log_cached_ptr)                                 \
-			_log_cached_ptr = WLog_Get(_tag);                 \
-		WLog_Print(_log_cached_ptr, _log_level, __VA_ARGS__); \
+#define WLog_Print_tag(_tag, _log_level, ...)                     \
+	do                                                            \
+	{                                                             \
+		if (WLog_IsLevelCompiled(_log_level))                     \
+		{                                                         \
+			static wLog* _log_cached_ptr = NULL;                  \
+			if (!_log_cached_ptr)                                 \
+				_log_cached_ptr = WLog_Get(_tag);                 \
+			WLog_Print(_log_cached_ptr, _log_level, __VA_ARGS__); \
+		}                                                         \
 	} while (0)
 
 #define WLog_PrintVA_unchecked(_log, _log_level, _args)                                        \
@@ -159,19 +185,19 @@ extern "C"
 		                    _args);                                                            \
 	} while (0)
 
-#define WLog_PrintVA(_log, _log_level, _args)                \
-	do                                                       \
-	{                                                        \
-		if (WLog_IsLevelActive(_log, _log_level))            \
-		{                                                    \
-			WLog_PrintVA_unchecked(_log, _log_level, _args); \
-		}                                                    \
+#define WLog_PrintVA(_log, _log_level, _args)                                         \
+	do                                                                                \
+	{                                                                                 \
+		if (WLog_IsLevelCompiled(_log_level) && WLog_IsLevelActive(_log, _log_level)) \
+		{                                                                             \
+			WLog_PrintVA_unchecked(_log, _log_level, _args);                          \
+		}                                                                             \
 	} while (0)
 
 #define WLog_Data(_log, _log_level, ...)                                                         \
 	do                                                                                           \
 	{                                                                                            \
-		if (WLog_IsLevelActive(_log, _log_level))                                                \
+		if (WLog_IsLevelCompiled(_log_level) && WLog_IsLevelActive(_log, _log_level))            \
 		{                                                                                        \
 			WLog_PrintMessage(_log, WLOG_MESSAGE_DATA, _log_level, __LINE__, __FILE__, __func__, \
 			                  __VA_ARGS__);                                                      \
@@ -181,7 +207,7 @@ extern "C"
 #define WLog_Image(_log, _log_level, ...)                                                        \
 	do                                                                                           \
 	{                                                                                            \
-		if (WLog_IsLevelActive(_log, _log_level))                                                \
+		if (WLog_IsLevelCompiled(_log_level) && WLog_IsLevelActive(_log, _log_level))            \
 		{                                                                                        \
 			WLog_PrintMessage(_log, WLOG_MESSAGE_DATA, _log_level, __LINE__, __FILE__, __func__, \
 			                  __VA_ARGS__);                                                      \
@@ -191,7 +217,7 @@ extern "C"
 #define WLog_Packet(_log, _log_level, ...)                                                         \
 	do                                                                                             \
 	{                                                                                              \
-		if (WLog_IsLevelActive(_log, _log_level))                                                  \
+		if (WLog_IsLevelCompiled(_log_level) && WLog_IsLevelActive(_log, _log_level))              \
 		{                                                                                          \
 			WLog_PrintMessage(_log, WLOG_MESSAGE_PACKET, _log_level, __LINE__, __FILE__, __func__, \
 			                  __VA_ARGS__);                                                        \
@@ -211,6 +237,22 @@ extern "C"
 	WINPR_API BOOL WLog_AddStringLogFilters(LPCSTR filter);
 
 	WINPR_API BOOL WLog_SetLogAppenderType(wLog* log, DWORD logAppenderType);
+
+	/** @brief Write text messages of the appender used by \b log from a background thread.
+	 *
+	 *  The message prefix is still rendered by the logging thread, the text is then queued
+	 *  in a fixed size lock-free queue. If the queue is full the message is dropped and the
+	 *  number of dropped messages is reported once there is room again. Data, image and
+	 *  packet messages are always written synchronously.
+	 *  Can also be enabled for the root logger with the environment variable WLOG_ASYNC.
+	 *
+	 *  @param log The logger to configure. Must not be \b NULL
+	 *  @param async \b TRUE to enable the queue, \b FALSE to flush and disable it
+	 *
+	 *  @return \b TRUE for success, \b FALSE otherwise.
+	 *  @since version 3.9.0
+	 */
+	WINPR_API BOOL WLog_SetLogAppenderAsync(wLog* log, BOOL async);
 	WINPR_API wLogAppender* WLog_GetLogAppender(wLog* log);
 	WINPR_API BOOL WLog_OpenAppender(wLog* log);
 	WINPR_API BOOL WLog_CloseAppender(wLog* log);
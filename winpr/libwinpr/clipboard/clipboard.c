@@ -20,6 +20,7 @@
 #include <winpr/config.h>
 
 #include <winpr/crt.h>
+#include <winpr/assert.h>
 #include <winpr/collections.h>
 #include <winpr/wlog.h>
 
@@ -155,11 +156,63 @@ void ClipboardUnlock(wClipboard* clipboard)
 	LeaveCriticalSection(&(clipboard->lock));
 }
 
+static void ClipboardClearCache(wClipboard* clipboard)
+{
+	WINPR_ASSERT(clipboard);
+
+	for (UINT32 index = 0; index < clipboard->numCached; index++)
+		free(clipboard->cached[index].data);
+
+	free(clipboard->cached);
+	clipboard->cached = NULL;
+	clipboard->numCached = 0;
+}
+
+static const wClipboardCachedData* ClipboardFindCached(wClipboard* clipboard, UINT32 formatId)
+{
+	WINPR_ASSERT(clipboard);
+
+	for (UINT32 index = 0; index < clipboard->numCached; index++)
+	{
+		if (clipboard->cached[index].formatId == formatId)
+			return &clipboard->cached[index];
+	}
+
+	return NULL;
+}
+
+/* keeps a copy of synthesized data, conversions (e.g. image encoding) run once per change */
+static void ClipboardAddCached(wClipboard* clipboard, UINT32 formatId, const void* data,
+                               UINT32 size)
+{
+	WINPR_ASSERT(clipboard);
+
+	wClipboardCachedData* cached = (wClipboardCachedData*)realloc(
+	    clipboard->cached, (clipboard->numCached + 1ull) * sizeof(wClipboardCachedData));
+
+	if (!cached)
+		return;
+
+	clipboard->cached = cached;
+
+	void* copy = malloc(size);
+	if (!copy)
+		return;
+
+	CopyMemory(copy, data, size);
+	cached[clipboard->numCached].formatId = formatId;
+	cached[clipboard->numCached].size = size;
+	cached[clipboard->numCached].data = copy;
+	clipboard->numCached++;
+}
+
 BOOL ClipboardEmpty(wClipboard* clipboard)
 {
 	if (!clipboard)
 		return FALSE;
 
+	ClipboardClearCache(clipboard);
+
 	if (clipboard->data)
 	{
 		free(clipboard->data);
@@ -464,6 +517,20 @@ void* ClipboardGetData(wClipboard* clipboard, UINT32 formatId, UINT32* pSize)
 	}
 	else
 	{
+		const wClipboardCachedData* cached = ClipboardFindCached(clipboard, formatId);
+
+		if (cached)
+		{
+			pDstData = malloc(cached->size);
+
+			if (!pDstData)
+				return NULL;
+
+			CopyMemory(pDstData, cached->data, cached->size);
+			*pSize = cached->size;
+			return pDstData;
+		}
+
 		synthesizer = ClipboardFindSynthesizer(format, formatId);
 
 		if (!synthesizer || !synthesizer->pfnSynthesize)
@@ -472,7 +539,10 @@ void* ClipboardGetData(wClipboard* clipboard, UINT32 formatId, UINT32* pSize)
 		DstSize = SrcSize;
 		pDstData = synthesizer->pfnSynthesize(clipboard, format->formatId, pSrcData, &DstSize);
 		if (pDstData)
+		{
 			*pSize = DstSize;
+			ClipboardAddCached(clipboard, formatId, pDstData, DstSize);
+		}
 	}
 
 	return pDstData;
@@ -490,6 +560,12 @@ BOOL ClipboardSetData(wClipboard* clipboard, UINT32 formatId, const void* data,
 	if (!format)
 		return FALSE;
 
+	/* clients set the same data again for every request, keep what was synthesized from it */
+	if (clipboard->data && data && (clipboard->formatId == formatId) &&
+	    (clipboard->size == size) && (memcmp(clipboard->data, data, size) == 0))
+		return TRUE;
+
+	ClipboardClearCache(clipboard);
 	free(clipboard->data);
 	clipboard->data = malloc(size);
 
@@ -586,6 +662,7 @@ void ClipboardDestroy(wClipboard* clipboard)
 	clipboard->localFiles = NULL;
 
 	ClipboardUninitFormats(clipboard);
+	ClipboardClearCache(clipboard);
 
 	free(clipboard->data);
 	clipboard->data = NULL;
@@ -40,6 +40,13 @@ typedef struct
 	wClipboardSynthesizer* synthesizers;
 } wClipboardFormat;
 
+typedef struct
+{
+	UINT32 formatId;
+	UINT32 size;
+	void* data;
+} wClipboardCachedData;
+
 struct s_wClipboard
 {
 	UINT64 ownerId;
@@ -58,11 +65,19 @@ struct s_wClipboard
 	UINT32 formatId;
 	UINT32 sequenceNumber;
 
+	/* synthesized data, dropped whenever the clipboard data changes */
+	UINT32 numCached;
+	wClipboardCachedData* cached;
+
 	/* clipboard file handling */
 
 	wArrayList* localFiles;
 	UINT32 fileListSequenceNumber;
 
+	/* index of the local file currently read through file range requests */
+	UINT32 streamFileIndex;
+	BOOL streamFileValid;
+
 	wClipboardDelegate delegate;
 
 	CRITICAL_SECTION lock;
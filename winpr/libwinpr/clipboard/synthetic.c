@@ -27,6 +27,9 @@
 #include "../utils/image.h"
 #include "clipboard.h"
 
+#include "../log.h"
+#define TAG WINPR_TAG("clipboard.synthetic")
+
 static const char* mime_bitmap[] = { "image/bmp", "image/x-bmp", "image/x-MS-bmp",
 	                                 "image/x-win-bitmap" };
 
@@ -343,6 +346,47 @@ static void* clipboard_synthesize_image_bmp(wClipboard* clipboard, UINT32 format
 
 #if defined(WINPR_UTILS_IMAGE_PNG) || defined(WINPR_UTILS_IMAGE_WEBP) || \
     defined(WINPR_UTILS_IMAGE_JPEG)
+/* Point the image at the pixels of a plain 24 or 32 bpp CF_DIB, the encoders read it in place. */
+static BOOL clipboard_wrap_dib(wImage* img, const void* data, UINT32 SrcSize, UINT32* pFlags)
+{
+	size_t offset = 0;
+	wStream sbuffer = { 0 };
+	WINPR_BITMAP_INFO_HEADER header = { 0 };
+	wStream* s = Stream_StaticConstInit(&sbuffer, data, SrcSize);
+
+	if (!readBitmapInfoHeader(s, &header, &offset))
+		return FALSE;
+
+	if ((header.biCompression != BI_RGB) || (offset != 0) ||
+	    ((header.biBitCount != 24) && (header.biBitCount != 32)))
+		return FALSE;
+
+	if ((header.biWidth <= 0) || (header.biHeight == 0) || (header.biHeight == INT32_MIN))
+		return FALSE;
+
+	const size_t width = (size_t)header.biWidth;
+	const size_t height = (size_t)((header.biHeight < 0) ? -header.biHeight : header.biHeight);
+	const size_t stride = (((width * header.biBitCount) + 31) & ~(size_t)31) >> 3;
+	if ((stride > UINT32_MAX) || (height > SIZE_MAX / stride))
+		return FALSE;
+	if (!Stream_CheckAndLogRequiredLength(TAG, s, stride * height))
+		return FALSE;
+
+	img->type = WINPR_IMAGE_BITMAP;
+	img->width = (UINT32)width;
+	img->height = (UINT32)height;
+	img->scanline = (UINT32)stride;
+	img->bitsPerPixel = header.biBitCount;
+	img->bytesPerPixel = header.biBitCount / 8;
+	img->data = WINPR_CAST_CONST_PTR_AWAY(Stream_ConstPointer(s), BYTE*);
+
+	/* clipboard conversions are interactive, prefer speed over size */
+	*pFlags = WINPR_IMAGE_WRITE_FAST;
+	if (header.biHeight > 0)
+		*pFlags |= WINPR_IMAGE_WRITE_BOTTOM_UP;
+	return TRUE;
+}
+
 static void* clipboard_synthesize_image_bmp_to_format(wClipboard* clipboard, UINT32 formatId,
                                                       UINT32 bmpFormat, const void* data,
                                                       UINT32* pSize)
@@ -355,6 +399,23 @@ static void* clipboard_synthesize_image_bmp_to_format(wClipboard* clipboard, UIN
 	void* result = NULL;
 
 	wImage* img = winpr_image_new();
+	if (!img)
+		return NULL;
+
+	UINT32 flags = 0;
+	if ((formatId == CF_DIB) && clipboard_wrap_dib(img, data, *pSize, &flags))
+	{
+		result = winpr_image_write_buffer_ex(img, bmpFormat, flags, &dsize);
+		winpr_image_free(img, FALSE);
+		if (dsize > UINT32_MAX)
+		{
+			free(result);
+			result = NULL;
+		}
+		*pSize = result ? (UINT32)dsize : 0;
+		return result;
+	}
+
 	void* bmp = clipboard_synthesize_image_bmp(clipboard, formatId, data, pSize);
 	const UINT32 SrcSize = *pSize;
 	*pSize = 0;
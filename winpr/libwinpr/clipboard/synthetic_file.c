@@ -48,6 +48,10 @@ WINPR_PRAGMA_DIAG_POP
 #include "../log.h"
 #define TAG WINPR_TAG("clipboard.synthetic.file")
 
+/* file ranges are read from disk in blocks of this size and served from memory */
+#define SYNTHETIC_FILE_READ_AHEAD (4ull * 1024ull * 1024ull)
+#define SYNTHETIC_FILE_PAGE_SIZE 4096
+
 static const char* mime_uri_list = "text/uri-list";
 static const char* mime_FileGroupDescriptorW = "FileGroupDescriptorW";
 static const char* mime_gnome_copied_files = "x-special/gnome-copied-files";
@@ -61,6 +65,12 @@ struct synthetic_file
 	HANDLE fd;
 	INT64 offset;
 
+	/* read-ahead block, page aligned, holding cacheLength bytes from cacheOffset */
+	BYTE* cache;
+	size_t cacheSize;
+	UINT64 cacheOffset;
+	UINT32 cacheLength;
+
 	DWORD dwFileAttributes;
 	FILETIME ftCreationTime;
 	FILETIME ftLastAccessTime;
@@ -126,6 +136,7 @@ void free_synthetic_file(struct synthetic_file* file)
 		return;
 
 	synthetic_file_read_close(file, TRUE);
+	winpr_aligned_free(file->cache);
 
 	free(file->local_name);
 	free(file->remote_name);
@@ -1062,8 +1073,8 @@ UINT synthetic_file_read_close(struct synthetic_file* file, BOOL force)
 	if (!file || INVALID_HANDLE_VALUE == file->fd)
 		return NO_ERROR;
 
-	/* Always force close the file. Clipboard might open hundreds of files
-	 * so avoid caching to prevent running out of available file descriptors */
+	/* Clipboard might open hundreds of files, only the file currently streamed
+	 * stays open (see file_switch_stream) and only until it was read to the end */
 	UINT64 size = 0;
 	file_get_size(file, &size);
 	if ((file->offset < 0) || ((UINT64)file->offset >= size) || force)
@@ -1080,112 +1091,193 @@ UINT synthetic_file_read_close(struct synthetic_file* file, BOOL force)
 	return NO_ERROR;
 }
 
-static UINT file_get_range(struct synthetic_file* file, UINT64 offset, UINT32 size,
-                           BYTE** actual_data, UINT32* actual_size)
+static void synthetic_file_release_cache(struct synthetic_file* file)
+{
+	WINPR_ASSERT(file);
+
+	winpr_aligned_free(file->cache);
+	file->cache = NULL;
+	file->cacheSize = 0;
+	file->cacheLength = 0;
+}
+
+static UINT file_open(struct synthetic_file* file)
+{
+	UINT error = NO_ERROR;
+	BY_HANDLE_FILE_INFORMATION FileInfo = { 0 };
+
+	WINPR_ASSERT(file);
+
+	file->fd = CreateFileW(file->local_name, GENERIC_READ, 0, NULL, OPEN_EXISTING,
+	                       FILE_ATTRIBUTE_NORMAL, NULL);
+	if (INVALID_HANDLE_VALUE == file->fd)
+	{
+		error = GetLastError();
+		WLog_ERR(TAG, "failed to open file %s: 0x%08" PRIx32, file->local_name, error);
+		return error;
+	}
+
+	if (!GetFileInformationByHandle(file->fd, &FileInfo))
+	{
+		(void)CloseHandle(file->fd);
+		file->fd = INVALID_HANDLE_VALUE;
+		error = GetLastError();
+		WLog_ERR(TAG, "Get file [%s] information fail: 0x%08" PRIx32, file->local_name, error);
+		return error;
+	}
+
+	file->offset = 0;
+	file->nFileSizeHigh = FileInfo.nFileSizeHigh;
+	file->nFileSizeLow = FileInfo.nFileSizeLow;
+	return NO_ERROR;
+}
+
+/* fills the read-ahead block starting at offset, reads at least size bytes unless EOF */
+static UINT file_read_ahead(struct synthetic_file* file, UINT64 offset, UINT32 size)
 {
 	UINT error = NO_ERROR;
 	DWORD dwLow = 0;
 	DWORD dwHigh = 0;
 
 	WINPR_ASSERT(file);
-	WINPR_ASSERT(actual_data);
-	WINPR_ASSERT(actual_size);
 
-	if (INVALID_HANDLE_VALUE == file->fd)
+	size_t blockSize = SYNTHETIC_FILE_READ_AHEAD;
+	if (blockSize < size)
+		blockSize = size;
+
+	if (file->cacheSize < blockSize)
 	{
-		BY_HANDLE_FILE_INFORMATION FileInfo = { 0 };
+		synthetic_file_release_cache(file);
+		file->cache = winpr_aligned_malloc(blockSize, SYNTHETIC_FILE_PAGE_SIZE);
+		if (!file->cache)
+			return ERROR_NOT_ENOUGH_MEMORY;
+		file->cacheSize = blockSize;
+	}
 
-		file->fd = CreateFileW(file->local_name, GENERIC_READ, 0, NULL, OPEN_EXISTING,
-		                       FILE_ATTRIBUTE_NORMAL, NULL);
-		if (INVALID_HANDLE_VALUE == file->fd)
-		{
-			error = GetLastError();
-			WLog_ERR(TAG, "failed to open file %s: 0x%08" PRIx32, file->local_name, error);
-			return error;
-		}
+	file->cacheLength = 0;
 
-		if (!GetFileInformationByHandle(file->fd, &FileInfo))
-		{
-			(void)CloseHandle(file->fd);
-			file->fd = INVALID_HANDLE_VALUE;
-			error = GetLastError();
-			WLog_ERR(TAG, "Get file [%s] information fail: 0x%08" PRIx32, file->local_name, error);
+	if (INVALID_HANDLE_VALUE == file->fd)
+	{
+		error = file_open(file);
+		if (error)
 			return error;
-		}
+	}
 
-		file->offset = 0;
-		file->nFileSizeHigh = FileInfo.nFileSizeHigh;
-		file->nFileSizeLow = FileInfo.nFileSizeLow;
+	/*
+	 * We should avoid seeking when possible as some filesystems (e.g.,
+	 * an FTP server mapped via FUSE) may not support seeking. We keep
+	 * an accurate account of the current file offset and do not call
+	 * lseek() if the client requests file content sequentially.
+	 */
+	if (offset > INT64_MAX)
+	{
+		WLog_ERR(TAG, "offset [%" PRIu64 "] > INT64_MAX", offset);
+		return ERROR_SEEK;
+	}
 
-		/*
-		{
-		    UINT64 s = 0;
-		    file_get_size(file, &s);
-		    WLog_DBG(TAG, "open file %d -> %s", file->fd, file->local_name);
-		    WLog_DBG(TAG, "file %d size: %" PRIu64 " bytes", file->fd, s);
-		} //*/
+	if (file->offset != (INT64)offset)
+	{
+		WLog_DBG(TAG, "file %d force seeking to %" PRIu64 ", current %" PRIu64, file->fd, offset,
+		         file->offset);
+
+		dwHigh = offset >> 32;
+		dwLow = offset & 0xFFFFFFFF;
+		if (INVALID_SET_FILE_POINTER ==
+		    SetFilePointer(file->fd, dwLow, (PLONG)&dwHigh, FILE_BEGIN))
+			return GetLastError();
+		file->offset = (INT64)offset;
 	}
 
-	do
+	file->cacheOffset = offset;
+	while (file->cacheLength < blockSize)
 	{
-		/*
-		 * We should avoid seeking when possible as some filesystems (e.g.,
-		 * an FTP server mapped via FUSE) may not support seeking. We keep
-		 * an accurate account of the current file offset and do not call
-		 * lseek() if the client requests file content sequentially.
-		 */
-		if (offset > INT64_MAX)
-		{
-			WLog_ERR(TAG, "offset [%" PRIu64 "] > INT64_MAX", offset);
-			error = ERROR_SEEK;
+		DWORD read = 0;
+
+		if (!ReadFile(file->fd, &file->cache[file->cacheLength],
+		              (DWORD)(blockSize - file->cacheLength), &read, NULL))
+			return GetLastError();
+
+		if (read == 0)
 			break;
-		}
 
-		if (file->offset != (INT64)offset)
-		{
-			WLog_DBG(TAG, "file %d force seeking to %" PRIu64 ", current %" PRIu64, file->fd,
-			         offset, file->offset);
+		file->cacheLength += read;
+		file->offset += read;
+	}
 
-			dwHigh = offset >> 32;
-			dwLow = offset & 0xFFFFFFFF;
-			if (INVALID_SET_FILE_POINTER ==
-			    SetFilePointer(file->fd, dwLow, (PLONG)&dwHigh, FILE_BEGIN))
-			{
-				error = GetLastError();
-				break;
-			}
-		}
+	WLog_VRB(TAG, "file %d read ahead %" PRIu32 " bytes (offset %" PRIu64 ")", file->fd,
+	         file->cacheLength, file->offset);
+	return NO_ERROR;
+}
 
-		BYTE* buffer = malloc(size);
-		if (!buffer)
-		{
-			error = ERROR_NOT_ENOUGH_MEMORY;
-			break;
-		}
-		if (!ReadFile(file->fd, buffer, size, (LPDWORD)actual_size, NULL))
-		{
-			free(buffer);
-			error = GetLastError();
-			break;
-		}
+/**
+ * Returns a pointer into the read-ahead block of the file, valid until the
+ * next call for this file. Sequential requests are served from memory and
+ * only hit the disk once per SYNTHETIC_FILE_READ_AHEAD bytes.
+ */
+static UINT file_get_range(struct synthetic_file* file, UINT64 offset, UINT32 size,
+                           const BYTE** actual_data, UINT32* actual_size)
+{
+	UINT error = NO_ERROR;
 
-		*actual_data = buffer;
-		file->offset += *actual_size;
-		WLog_VRB(TAG, "file %d actual read %" PRIu32 " bytes (offset %" PRIu64 ")", file->fd,
-		         *actual_size, file->offset);
-	} while (0);
+	WINPR_ASSERT(file);
+	WINPR_ASSERT(actual_data);
+	WINPR_ASSERT(actual_size);
+
+	const BOOL cached = file->cache && (offset >= file->cacheOffset) &&
+	                    (offset - file->cacheOffset <= file->cacheLength) &&
+	                    (offset - file->cacheOffset + size <= file->cacheLength);
+
+	if (!cached)
+		error = file_read_ahead(file, offset, size);
+
+	if (error == NO_ERROR)
+	{
+		const size_t start = (size_t)(offset - file->cacheOffset);
+		UINT32 available = file->cacheLength - (UINT32)start;
 
-	synthetic_file_read_close(file, TRUE /* (error != NO_ERROR) && (size > 0) */);
+		if (available > size)
+			available = size;
+
+		*actual_data = &file->cache[start];
+		*actual_size = available;
+	}
+	else
+		synthetic_file_release_cache(file);
+
+	/* closes the file once it was read to the end */
+	synthetic_file_read_close(file, error != NO_ERROR);
 	return error;
 }
 
+/* only one file is streamed at a time, this bounds open descriptors and read-ahead memory */
+static void file_switch_stream(wClipboard* clipboard, UINT32 listIndex)
+{
+	WINPR_ASSERT(clipboard);
+
+	if (clipboard->streamFileValid && (clipboard->streamFileIndex != listIndex))
+	{
+		struct synthetic_file* previous =
+		    ArrayList_GetItem(clipboard->localFiles, clipboard->streamFileIndex);
+
+		if (previous)
+		{
+			synthetic_file_read_close(previous, TRUE);
+			synthetic_file_release_cache(previous);
+		}
+	}
+
+	clipboard->streamFileIndex = listIndex;
+	clipboard->streamFileValid = TRUE;
+}
+
 static UINT delegate_file_request_range(wClipboardDelegate* delegate,
                                         const wClipboardFileRangeRequest* request)
 {
 	UINT error = 0;
-	BYTE* data = NULL;
+	const BYTE* data = NULL;
 	UINT32 size = 0;
 	UINT64 offset = 0;
+	UINT64 fileSize = 0;
 	struct synthetic_file* file = NULL;
 
 	if (!delegate || !delegate->clipboard || !request)
@@ -1199,6 +1291,8 @@ static UINT delegate_file_request_range(wClipboardDelegate* delegate,
 	if (!file)
 		return ERROR_INDEX_ABSENT;
 
+	file_switch_stream(delegate->clipboard, request->listIndex);
+
 	offset = (((UINT64)request->nPositionHigh) << 32) | ((UINT64)request->nPositionLow);
 	error = file_get_range(file, offset, request->cbRequested, &data, &size);
 
@@ -1210,7 +1304,11 @@ static UINT delegate_file_request_range(wClipboardDelegate* delegate,
 	if (error)
 		WLog_WARN(TAG, "failed to report file range result: 0x%08X", error);
 
-	free(data);
+	/* the last chunk was sent, no need to keep the block around */
+	(void)file_get_size(file, &fileSize);
+	if (offset + size >= fileSize)
+		synthetic_file_release_cache(file);
+
 	return NO_ERROR;
 }
 
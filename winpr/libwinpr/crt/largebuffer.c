@@ -0,0 +1,200 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * Large Buffer Allocation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/interlocked.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define WINPR_LARGE_MMAP
+#endif
+
+#include "../log.h"
+#define TAG WINPR_TAG("crt")
+
+#define WINPR_LARGE_MEM_SIGNATURE 0x0B16B0FU
+
+/* Buffers from this size on are backed by huge pages, also the huge page size of x86 and arm64 */
+#define WINPR_LARGE_PAGE_SIZE (2ull * 1024ull * 1024ull)
+
+typedef struct
+{
+	UINT32 sig;
+	BOOL mapped;
+	void* base;
+	size_t length;
+} WINPR_LARGE_MEM;
+
+static size_t large_round_up(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/* The buffer starts at the first aligned offset after the header */
+static size_t large_header_size(size_t alignment)
+{
+	return large_round_up(sizeof(WINPR_LARGE_MEM), alignment);
+}
+
+static WINPR_LARGE_MEM* large_mem_from_ptr(void* memblock)
+{
+	return (WINPR_LARGE_MEM*)((BYTE*)memblock - sizeof(WINPR_LARGE_MEM));
+}
+
+#if defined(WINPR_LARGE_MMAP)
+/* Set once explicit huge pages failed, they are only available if reserved by the admin */
+static LONG hugetlbUnavailable = 0;
+
+static void* large_map(size_t size, size_t* plength)
+{
+	const long pageSize = sysconf(_SC_PAGESIZE);
+	const size_t length = large_round_up(size, (pageSize > 0) ? (size_t)pageSize : 4096);
+
+#if defined(MAP_HUGETLB)
+	if (InterlockedCompareExchange(&hugetlbUnavailable, 0, 0) == 0)
+	{
+		const size_t hugeLength = large_round_up(size, WINPR_LARGE_PAGE_SIZE);
+		void* base = mmap(NULL, hugeLength, PROT_READ | PROT_WRITE,
+		                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (base != MAP_FAILED)
+		{
+			*plength = hugeLength;
+			return base;
+		}
+
+		(void)InterlockedExchange(&hugetlbUnavailable, 1);
+	}
+#endif
+
+	/* transparent huge pages only back 2M aligned ranges, map more and trim */
+	if (length > SIZE_MAX - WINPR_LARGE_PAGE_SIZE)
+		return NULL;
+
+	const size_t mapLength = length + WINPR_LARGE_PAGE_SIZE;
+	BYTE* map = mmap(NULL, mapLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (map == MAP_FAILED)
+		return NULL;
+
+	BYTE* base = (BYTE*)large_round_up((size_t)map, WINPR_LARGE_PAGE_SIZE);
+	const size_t head = (size_t)(base - map);
+	const size_t tail = mapLength - head - length;
+
+	if (head > 0)
+		(void)munmap(map, head);
+	if (tail > 0)
+		(void)munmap(&base[length], tail);
+
+#if defined(MADV_HUGEPAGE)
+	(void)madvise(base, length, MADV_HUGEPAGE);
+#endif
+
+	*plength = length;
+	return base;
+}
+#endif
+
+void* winpr_large_malloc(size_t size, size_t alignment)
+{
+	BYTE* base = NULL;
+	size_t length = 0;
+	BOOL mapped = FALSE;
+
+	/* alignment must be a power of 2 */
+	if ((alignment & (alignment - 1)) != 0)
+		return NULL;
+
+	/* minimum alignment is pointer size */
+	if (alignment < sizeof(void*))
+		alignment = sizeof(void*);
+
+	if (alignment > WINPR_LARGE_PAGE_SIZE)
+		return NULL;
+
+	const size_t header = large_header_size(alignment);
+
+	if (size > SIZE_MAX - header)
+		return NULL;
+
+#if defined(WINPR_LARGE_MMAP)
+	/* mappings are 2M aligned, that covers any supported alignment */
+	if (size >= WINPR_LARGE_PAGE_SIZE)
+	{
+		base = large_map(size + header, &length);
+		mapped = (base != NULL);
+	}
+#endif
+
+	if (!base)
+	{
+		length = size + header;
+		base = winpr_aligned_malloc(length, alignment);
+		if (!base)
+			return NULL;
+	}
+
+	BYTE* memblock = &base[header];
+	WINPR_LARGE_MEM* pMem = large_mem_from_ptr(memblock);
+	pMem->sig = WINPR_LARGE_MEM_SIGNATURE;
+	pMem->mapped = mapped;
+	pMem->base = base;
+	pMem->length = length;
+	return memblock;
+}
+
+void* winpr_large_calloc(size_t count, size_t size, size_t alignment)
+{
+	if ((size > 0) && (count > SIZE_MAX / size))
+		return NULL;
+
+	BYTE* memblock = winpr_large_malloc(count * size, alignment);
+
+	if (memblock && !large_mem_from_ptr(memblock)->mapped)
+		memset(memblock, 0, count * size);
+
+	return memblock;
+}
+
+void winpr_large_free(void* memblock)
+{
+	if (!memblock)
+		return;
+
+	WINPR_LARGE_MEM* pMem = large_mem_from_ptr(memblock);
+
+	if (pMem->sig != WINPR_LARGE_MEM_SIGNATURE)
+	{
+		WLog_ERR(TAG, "winpr_large_free: memory block was not allocated by winpr_large_malloc!");
+		return;
+	}
+
+	pMem->sig = 0;
+
+#if defined(WINPR_LARGE_MMAP)
+	if (pMem->mapped)
+	{
+		(void)munmap(pMem->base, pMem->length);
+		return;
+	}
+#endif
+
+	winpr_aligned_free(pMem->base);
+}
@@ -3,6 +3,38 @@
 #include <winpr/crt.h>
 #include <winpr/windows.h>
 
+static BOOL test_large_buffer(size_t size, size_t alignment)
+{
+	BYTE* ptr = winpr_large_calloc(size, 1, alignment);
+
+	if (!ptr)
+	{
+		printf("Error allocating large buffer of %" PRIuz " bytes.\n", size);
+		return FALSE;
+	}
+
+	if (((size_t)ptr % alignment) != 0)
+	{
+		printf("This pointer, %p, is not aligned on %" PRIuz "\n", (void*)ptr, alignment);
+		winpr_large_free(ptr);
+		return FALSE;
+	}
+
+	for (size_t x = 0; x < size; x++)
+	{
+		if (ptr[x] != 0)
+		{
+			printf("Large buffer of %" PRIuz " bytes is not zeroed.\n", size);
+			winpr_large_free(ptr);
+			return FALSE;
+		}
+	}
+
+	memset(ptr, 0xAB, size);
+	winpr_large_free(ptr);
+	return TRUE;
+}
+
 int TestAlignment(int argc, char* argv[])
 {
 	void* ptr = NULL;
@@ -83,5 +115,9 @@ int TestAlignment(int argc, char* argv[])
 	 * used. */
 	winpr_aligned_free(ptr);
 
+	/* winpr_large_malloc, below and above the huge page threshold */
+	if (!test_large_buffer(100, 16) || !test_large_buffer(4ull * 1024ull * 1024ull + 3, 64))
+		return -1;
+
 	return 0;
 }
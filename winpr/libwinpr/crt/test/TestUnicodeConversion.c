@@ -29,7 +29,17 @@ static const testcase_t unit_testcases[] = {
 	{ "✊🎅ęʥ꣸𑗊a", 19,
 	  (const WCHAR*)"\x0a\x27\x3c\xd8\x85\xdf\x19\x01\xa5\x02\xf8\xa8\x05\xd8\xca\xdd\x61\x00\x00"
 	                "\x00",
-	  9 }
+	  9 },
+	/* long enough to cross the vectorized ASCII blocks */
+	{ "The quick brown fox jumps over the lazy dog, été ☃ over 16 chars!", 69,
+	  (const WCHAR*)"\x54\x00\x68\x00\x65\x00\x20\x00\x71\x00\x75\x00\x69\x00\x63\x00\x6b\x00\x20\x00"
+	                "\x62\x00\x72\x00\x6f\x00\x77\x00\x6e\x00\x20\x00\x66\x00\x6f\x00\x78\x00\x20\x00"
+	                "\x6a\x00\x75\x00\x6d\x00\x70\x00\x73\x00\x20\x00\x6f\x00\x76\x00\x65\x00\x72\x00"
+	                "\x20\x00\x74\x00\x68\x00\x65\x00\x20\x00\x6c\x00\x61\x00\x7a\x00\x79\x00\x20\x00"
+	                "\x64\x00\x6f\x00\x67\x00\x2c\x00\x20\x00\xe9\x00\x74\x00\xe9\x00\x20\x00\x03\x26"
+	                "\x20\x00\x6f\x00\x76\x00\x65\x00\x72\x00\x20\x00\x31\x00\x36\x00\x20\x00\x63\x00"
+	                "\x68\x00\x61\x00\x72\x00\x73\x00\x21\x00\x00\x00",
+	  65 }
 };
 
 static void create_prefix(char* prefix, size_t prefixlen, size_t buffersize, SSIZE_T rc,
@@ -47,6 +47,14 @@ See the header file "utf.h" for complete documentation.
 #include "../log.h"
 #define TAG WINPR_TAG("unicode")
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define WINPR_UNICODE_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define WINPR_UNICODE_NEON
+#endif
+
 /*
  * Character Types:
  *
@@ -135,6 +143,92 @@ static const uint8_t firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0x
 
 /* --------------------------------------------------------------------- */
 
+/*
+ * Most strings exchanged over RDP are plain ASCII. These helpers convert the
+ * leading ASCII run of a buffer 16 characters at a time and return the
+ * number of characters converted. With a NULL target only the run is
+ * measured.
+ */
+static size_t winpr_ConvertASCIItoUTF16(const uint8_t* source, size_t count, uint16_t* target)
+{
+	size_t x = 0;
+
+#if defined(WINPR_UNICODE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 16 <= count; x += 16)
+	{
+		const __m128i val = _mm_loadu_si128((const __m128i*)&source[x]);
+		if (_mm_movemask_epi8(val) != 0)
+			break;
+		if (target)
+		{
+			_mm_storeu_si128((__m128i*)&target[x], _mm_unpacklo_epi8(val, zero));
+			_mm_storeu_si128((__m128i*)&target[x + 8], _mm_unpackhi_epi8(val, zero));
+		}
+	}
+#elif defined(WINPR_UNICODE_NEON)
+	for (; x + 16 <= count; x += 16)
+	{
+		const uint8x16_t val = vld1q_u8(&source[x]);
+		if (vmaxvq_u8(val) >= 0x80)
+			break;
+		if (target)
+		{
+			vst1q_u16(&target[x], vmovl_u8(vget_low_u8(val)));
+			vst1q_u16(&target[x + 8], vmovl_u8(vget_high_u8(val)));
+		}
+	}
+#endif
+
+	for (; (x < count) && (source[x] < 0x80); x++)
+	{
+		if (target)
+			target[x] = source[x];
+	}
+
+	return x;
+}
+
+static size_t winpr_ConvertUTF16toASCII(const uint16_t* source, size_t count, uint8_t* target)
+{
+	size_t x = 0;
+
+#if defined(WINPR_UNICODE_SSE2)
+	const __m128i mask = _mm_set1_epi16((short)0xFF80);
+	const __m128i zero = _mm_setzero_si128();
+	for (; x + 16 <= count; x += 16)
+	{
+		const __m128i lo = _mm_loadu_si128((const __m128i*)&source[x]);
+		const __m128i hi = _mm_loadu_si128((const __m128i*)&source[x + 8]);
+		const __m128i high = _mm_and_si128(_mm_or_si128(lo, hi), mask);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) != 0xFFFF)
+			break;
+		if (target)
+			_mm_storeu_si128((__m128i*)&target[x], _mm_packus_epi16(lo, hi));
+	}
+#elif defined(WINPR_UNICODE_NEON)
+	for (; x + 16 <= count; x += 16)
+	{
+		const uint16x8_t lo = vld1q_u16(&source[x]);
+		const uint16x8_t hi = vld1q_u16(&source[x + 8]);
+		if (vmaxvq_u16(vorrq_u16(lo, hi)) >= 0x80)
+			break;
+		if (target)
+			vst1q_u8(&target[x], vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+	}
+#endif
+
+	for (; (x < count) && (source[x] < 0x80); x++)
+	{
+		if (target)
+			target[x] = (uint8_t)source[x];
+	}
+
+	return x;
+}
+
+/* --------------------------------------------------------------------- */
+
 static ConversionResult winpr_ConvertUTF16toUTF8_Internal(const uint16_t** sourceStart,
                                                           const uint16_t* sourceEnd,
                                                           uint8_t** targetStart, uint8_t* targetEnd,
@@ -149,6 +243,21 @@ static ConversionResult winpr_ConvertUTF16toUTF8_Internal(const uint16_t** sourc
 	{
 		uint32_t ch = 0;
 		unsigned short bytesToWrite = 0;
+
+		if (*source < 0x80)
+		{
+			size_t count = (size_t)(sourceEnd - source);
+			if (!computeLength && ((size_t)(targetEnd - target) < count))
+				count = (size_t)(targetEnd - target);
+
+			const size_t done =
+			    winpr_ConvertUTF16toASCII(source, count, computeLength ? NULL : target);
+			source += done;
+			target += done;
+			if (done > 0)
+				continue;
+		}
+
 		const uint32_t byteMask = 0xBF;
 		const uint32_t byteMark = 0x80;
 		const uint16_t* oldSource =
@@ -391,6 +500,20 @@ static ConversionResult winpr_ConvertUTF8toUTF16_Internal(const uint8_t** source
 
 	while (source < sourceEnd)
 	{
+		if (*source < 0x80)
+		{
+			size_t count = (size_t)(sourceEnd - source);
+			if (!computeLength && ((size_t)(targetEnd - target) < count))
+				count = (size_t)(targetEnd - target);
+
+			const size_t done =
+			    winpr_ConvertASCIItoUTF16(source, count, computeLength ? NULL : target);
+			source += done;
+			target += done;
+			if (done > 0)
+				continue;
+		}
+
 		uint32_t ch = 0;
 		unsigned short extraBytesToRead = trailingBytesForUTF8[*source];
 
@@ -0,0 +1,102 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * Thread Pool API (Work Batch)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <winpr/assert.h>
+#include <winpr/crt.h>
+#include <winpr/pool.h>
+#include <winpr/sysinfo.h>
+#include <winpr/interlocked.h>
+
+#include "../log.h"
+#define TAG WINPR_TAG("pool")
+
+typedef struct
+{
+	PTP_WORK_BATCH_CALLBACK callback;
+	PVOID context;
+	LONG count;
+	LONG volatile next;
+} WINPR_WORK_BATCH;
+
+static void work_batch_run(WINPR_WORK_BATCH* batch)
+{
+	WINPR_ASSERT(batch);
+
+	while (1)
+	{
+		const LONG index = InterlockedIncrement(&batch->next) - 1;
+		if (index >= batch->count)
+			break;
+
+		batch->callback(batch->context, (size_t)index);
+	}
+}
+
+static VOID CALLBACK work_batch_callback(PTP_CALLBACK_INSTANCE instance, PVOID context,
+                                         PTP_WORK work)
+{
+	WINPR_UNUSED(instance);
+	WINPR_UNUSED(work);
+	work_batch_run((WINPR_WORK_BATCH*)context);
+}
+
+BOOL winpr_SubmitThreadpoolWorkBatch(PTP_WORK_BATCH_CALLBACK pfnwk, PVOID pv, size_t count,
+                                     PTP_CALLBACK_ENVIRON pcbe)
+{
+	SYSTEM_INFO info = { 0 };
+
+	if (!pfnwk)
+		return FALSE;
+
+	/* leave headroom for the runners overshooting the counter */
+	if (count > (INT32_MAX / 2))
+		return FALSE;
+
+	WINPR_WORK_BATCH batch = { pfnwk, pv, (LONG)count, 0 };
+
+	GetSystemInfo(&info);
+	size_t runners = info.dwNumberOfProcessors;
+	if (runners > count)
+		runners = count;
+
+	PTP_WORK work = NULL;
+	if (runners > 1)
+	{
+		work = CreateThreadpoolWork(work_batch_callback, &batch, pcbe);
+		if (!work)
+			WLog_WARN(TAG, "CreateThreadpoolWork failed, running batch serially");
+	}
+
+	if (work)
+	{
+		/* the calling thread is a runner as well */
+		for (size_t x = 1; x < runners; x++)
+			SubmitThreadpoolWork(work);
+	}
+
+	work_batch_run(&batch);
+
+	if (work)
+	{
+		WaitForThreadpoolWorkCallbacks(work, FALSE);
+		CloseThreadpoolWork(work);
+	}
+
+	return TRUE;
+}
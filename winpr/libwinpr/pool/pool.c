@@ -52,52 +52,227 @@ static BOOL CALLBACK init_module(PINIT_ONCE once, PVOID param, PVOID* context)
 #endif
 
 static TP_POOL DEFAULT_POOL = {
-	0,    /* DWORD Minimum */
-	500,  /* DWORD Maximum */
-	NULL, /* wArrayList* Threads */
-	NULL, /* wQueue* PendingQueue */
-	NULL, /* HANDLE TerminateEvent */
-	NULL, /* wCountdownEvent* WorkComplete */
+	.Minimum = 0,
+	.Maximum = 500,
 };
 
-static DWORD WINAPI thread_pool_work_func(LPVOID arg)
+/* The pool lock guards the pending ring, the counters and the terminate flag. Idle
+ * workers park on WorkAvailable, so a submission costs a lock and at most one wakeup. */
+#if defined(_WIN32)
+static BOOL pool_sync_init(PTP_POOL pool)
 {
-	DWORD status = 0;
-	PTP_POOL pool = NULL;
-	PTP_WORK work = NULL;
-	HANDLE events[2];
-	PTP_CALLBACK_INSTANCE callbackInstance = NULL;
+	if (!InitializeCriticalSectionAndSpinCount(&pool->Lock, 4000))
+		return FALSE;
 
-	pool = (PTP_POOL)arg;
+	pool->WorkAvailable = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+	pool->WorkComplete = CreateEvent(NULL, TRUE, TRUE, NULL);
+	pool->Initialized = TRUE;
+	return pool->WorkAvailable && pool->WorkComplete;
+}
 
-	events[0] = pool->TerminateEvent;
-	events[1] = Queue_Event(pool->PendingQueue);
+static void pool_sync_free(PTP_POOL pool)
+{
+	if (pool->WorkAvailable)
+		(void)CloseHandle(pool->WorkAvailable);
+	if (pool->WorkComplete)
+		(void)CloseHandle(pool->WorkComplete);
+	DeleteCriticalSection(&pool->Lock);
+}
+
+static void pool_lock(PTP_POOL pool)
+{
+	EnterCriticalSection(&pool->Lock);
+}
+
+static void pool_unlock(PTP_POOL pool)
+{
+	LeaveCriticalSection(&pool->Lock);
+}
+
+/* called with the lock held, spurious wakeups are fine */
+static void pool_park(PTP_POOL pool)
+{
+	pool_unlock(pool);
+	(void)WaitForSingleObject(pool->WorkAvailable, INFINITE);
+	pool_lock(pool);
+}
+
+static void pool_wake(PTP_POOL pool, LONG count)
+{
+	(void)ReleaseSemaphore(pool->WorkAvailable, count, NULL);
+}
+
+static void pool_set_complete(PTP_POOL pool, BOOL complete)
+{
+	if (complete)
+		(void)SetEvent(pool->WorkComplete);
+	else
+		(void)ResetEvent(pool->WorkComplete);
+}
+
+static void pool_wait_complete(PTP_POOL pool)
+{
+	(void)WaitForSingleObject(pool->WorkComplete, INFINITE);
+}
+#else
+static BOOL pool_sync_init(PTP_POOL pool)
+{
+	if (pthread_mutex_init(&pool->Lock, NULL) != 0)
+		return FALSE;
+
+	if (pthread_cond_init(&pool->WorkAvailable, NULL) != 0)
+	{
+		pthread_mutex_destroy(&pool->Lock);
+		return FALSE;
+	}
+
+	if (pthread_cond_init(&pool->WorkComplete, NULL) != 0)
+	{
+		pthread_cond_destroy(&pool->WorkAvailable);
+		pthread_mutex_destroy(&pool->Lock);
+		return FALSE;
+	}
+
+	pool->Initialized = TRUE;
+	return TRUE;
+}
+
+static void pool_sync_free(PTP_POOL pool)
+{
+	pthread_cond_destroy(&pool->WorkComplete);
+	pthread_cond_destroy(&pool->WorkAvailable);
+	pthread_mutex_destroy(&pool->Lock);
+}
+
+static void pool_lock(PTP_POOL pool)
+{
+	pthread_mutex_lock(&pool->Lock);
+}
+
+static void pool_unlock(PTP_POOL pool)
+{
+	pthread_mutex_unlock(&pool->Lock);
+}
+
+static void pool_park(PTP_POOL pool)
+{
+	pthread_cond_wait(&pool->WorkAvailable, &pool->Lock);
+}
+
+static void pool_wake(PTP_POOL pool, LONG count)
+{
+	if (count == 1)
+		pthread_cond_signal(&pool->WorkAvailable);
+	else
+		pthread_cond_broadcast(&pool->WorkAvailable);
+}
+
+static void pool_set_complete(PTP_POOL pool, BOOL complete)
+{
+	if (complete)
+		pthread_cond_broadcast(&pool->WorkComplete);
+}
+
+static void pool_wait_complete(PTP_POOL pool)
+{
+	pool_lock(pool);
+	while (pool->Outstanding > 0)
+		pthread_cond_wait(&pool->WorkComplete, &pool->Lock);
+	pool_unlock(pool);
+}
+#endif
+
+static DWORD WINAPI thread_pool_work_func(LPVOID arg)
+{
+	PTP_POOL pool = (PTP_POOL)arg;
+
+	pool_lock(pool);
 
 	while (1)
 	{
-		status = WaitForMultipleObjects(2, events, FALSE, INFINITE);
+		while (!pool->Terminate && (pool->PendingCount == 0))
+			pool_park(pool);
 
-		if (status == WAIT_OBJECT_0)
+		if (pool->Terminate)
 			break;
 
-		if (status != (WAIT_OBJECT_0 + 1))
-			break;
+		PTP_WORK work = pool->Pending[pool->PendingHead];
+		pool->PendingHead = (pool->PendingHead + 1) % pool->PendingSize;
+		pool->PendingCount--;
+		pool_unlock(pool);
 
-		callbackInstance = (PTP_CALLBACK_INSTANCE)Queue_Dequeue(pool->PendingQueue);
+		/* the instance only lives for the duration of the callback */
+		TP_CALLBACK_INSTANCE callbackInstance = { work };
+		work->WorkCallback(&callbackInstance, work->CallbackParameter, work);
 
-		if (callbackInstance)
-		{
-			work = callbackInstance->Work;
-			work->WorkCallback(callbackInstance, work->CallbackParameter, work);
-			CountdownEvent_Signal(pool->WorkComplete, 1);
-			free(callbackInstance);
-		}
+		pool_lock(pool);
+		pool->Outstanding--;
+		if (pool->Outstanding == 0)
+			pool_set_complete(pool, TRUE);
 	}
 
+	pool_unlock(pool);
 	ExitThread(0);
 	return 0;
 }
 
+BOOL TpPostWork(PTP_POOL pool, PTP_WORK work)
+{
+	BOOL rc = FALSE;
+
+	pool_lock(pool);
+
+	if (pool->PendingCount == pool->PendingSize)
+	{
+		const size_t size = (pool->PendingSize > 0) ? pool->PendingSize * 2 : 64;
+		PTP_WORK* pending = (PTP_WORK*)calloc(size, sizeof(PTP_WORK));
+
+		if (!pending)
+			goto fail;
+
+		/* unwrap the ring into the new buffer */
+		for (size_t x = 0; x < pool->PendingCount; x++)
+			pending[x] = pool->Pending[(pool->PendingHead + x) % pool->PendingSize];
+
+		free((void*)pool->Pending);
+		pool->Pending = pending;
+		pool->PendingHead = 0;
+		pool->PendingSize = size;
+	}
+
+	pool->Pending[(pool->PendingHead + pool->PendingCount) % pool->PendingSize] = work;
+	pool->PendingCount++;
+
+	if (pool->Outstanding++ == 0)
+		pool_set_complete(pool, FALSE);
+
+	pool_wake(pool, 1);
+	rc = TRUE;
+fail:
+	pool_unlock(pool);
+	return rc;
+}
+
+VOID TpWaitForWork(PTP_POOL pool)
+{
+	pool_wait_complete(pool);
+}
+
+/* Stops and joins all workers, queued work stays pending */
+static void pool_terminate_threads(PTP_POOL pool)
+{
+	pool_lock(pool);
+	pool->Terminate = TRUE;
+	pool_wake(pool, (LONG)ArrayList_Count(pool->Threads) + 1);
+	pool_unlock(pool);
+
+	ArrayList_Clear(pool->Threads);
+
+	pool_lock(pool);
+	pool->Terminate = FALSE;
+	pool_unlock(pool);
+}
+
 static void threads_close(void* thread)
 {
 	(void)WaitForSingleObject(thread, INFINITE);
@@ -112,13 +287,7 @@ static BOOL InitializeThreadpool(PTP_POOL pool)
 	if (pool->Threads)
 		return TRUE;
 
-	if (!(pool->PendingQueue = Queue_New(TRUE, -1, -1)))
-		goto fail;
-
-	if (!(pool->WorkComplete = CountdownEvent_New(0)))
-		goto fail;
-
-	if (!(pool->TerminateEvent = CreateEvent(NULL, TRUE, FALSE, NULL)))
+	if (!pool->Initialized && !pool_sync_init(pool))
 		goto fail;
 
 	if (!(pool->Threads = ArrayList_New(TRUE)))
@@ -185,12 +354,15 @@ VOID winpr_CloseThreadpool(PTP_POOL ptpp)
 		return;
 	}
 #endif
-	(void)SetEvent(ptpp->TerminateEvent);
+	if (ptpp->Initialized)
+	{
+		if (ptpp->Threads)
+			pool_terminate_threads(ptpp);
+		pool_sync_free(ptpp);
+	}
 
 	ArrayList_Free(ptpp->Threads);
-	Queue_Free(ptpp->PendingQueue);
-	CountdownEvent_Free(ptpp->WorkComplete);
-	(void)CloseHandle(ptpp->TerminateEvent);
+	free((void*)ptpp->Pending);
 
 	{
 		TP_POOL empty = { 0 };
@@ -246,11 +418,7 @@ VOID winpr_SetThreadpoolThreadMaximum(PTP_POOL ptpp, DWORD cthrdMost)
 
 	ArrayList_Lock(ptpp->Threads);
 	if (ArrayList_Count(ptpp->Threads) > ptpp->Maximum)
-	{
-		(void)SetEvent(ptpp->TerminateEvent);
-		ArrayList_Clear(ptpp->Threads);
-		(void)ResetEvent(ptpp->TerminateEvent);
-	}
+		pool_terminate_threads(ptpp);
 	ArrayList_Unlock(ptpp->Threads);
 	winpr_SetThreadpoolThreadMinimum(ptpp, ptpp->Minimum);
 }
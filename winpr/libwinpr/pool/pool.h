@@ -26,6 +26,10 @@
 #include <winpr/thread.h>
 #include <winpr/collections.h>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
 #if defined(_WIN32)
 #if (_WIN32_WINNT < _WIN32_WINNT_WIN6) || defined(__MINGW32__)
 struct S_TP_CALLBACK_INSTANCE
@@ -38,9 +42,16 @@ struct S_TP_POOL
 	DWORD Minimum;
 	DWORD Maximum;
 	wArrayList* Threads;
-	wQueue* PendingQueue;
-	HANDLE TerminateEvent;
-	wCountdownEvent* WorkComplete;
+	PTP_WORK* Pending; /* ring buffer of submitted work */
+	size_t PendingHead;
+	size_t PendingCount;
+	size_t PendingSize;
+	size_t Outstanding; /* queued or running callbacks */
+	BOOL Terminate;
+	BOOL Initialized;
+	CRITICAL_SECTION Lock;
+	HANDLE WorkAvailable; /* semaphore, one count per submission */
+	HANDLE WorkComplete;  /* manual reset, set while nothing is outstanding */
 };
 
 struct S_TP_WORK
@@ -82,9 +93,16 @@ struct S_TP_POOL
 	DWORD Minimum;
 	DWORD Maximum;
 	wArrayList* Threads;
-	wQueue* PendingQueue;
-	HANDLE TerminateEvent;
-	wCountdownEvent* WorkComplete;
+	PTP_WORK* Pending; /* ring buffer of submitted work */
+	size_t PendingHead;
+	size_t PendingCount;
+	size_t PendingSize;
+	size_t Outstanding; /* queued or running callbacks */
+	BOOL Terminate;
+	BOOL Initialized;
+	pthread_mutex_t Lock;
+	pthread_cond_t WorkAvailable;
+	pthread_cond_t WorkComplete;
 };
 
 struct S_TP_WORK
@@ -118,5 +136,7 @@ struct S_TP_CLEANUP_GROUP
 #endif
 
 PTP_POOL GetDefaultThreadpool(void);
+BOOL TpPostWork(PTP_POOL pool, PTP_WORK work);
+VOID TpWaitForWork(PTP_POOL pool);
 
 #endif /* WINPR_POOL_PRIVATE_H */
@@ -120,6 +120,64 @@ fail:
 	return rc;
 }
 
+static void test_BatchCallback(PVOID context, size_t index)
+{
+	LONG* hits = (LONG*)context;
+	InterlockedIncrement(&hits[index]);
+}
+
+static BOOL test3(void)
+{
+	BOOL rc = FALSE;
+	LONG hits[1000] = { 0 };
+	PTP_POOL pool = NULL;
+	TP_CALLBACK_ENVIRON environment;
+	printf("Work Batch\n");
+
+	/* the default pool */
+	if (!winpr_SubmitThreadpoolWorkBatch(test_BatchCallback, hits, ARRAYSIZE(hits), NULL))
+	{
+		printf("winpr_SubmitThreadpoolWorkBatch failure\n");
+		return FALSE;
+	}
+
+	if (!(pool = CreateThreadpool(NULL)))
+	{
+		printf("CreateThreadpool failure\n");
+		return FALSE;
+	}
+
+	InitializeThreadpoolEnvironment(&environment);
+	SetThreadpoolCallbackPool(&environment, pool);
+
+	/* an empty batch and a single item must work as well */
+	if (!winpr_SubmitThreadpoolWorkBatch(test_BatchCallback, hits, 0, &environment))
+		goto fail;
+
+	if (!winpr_SubmitThreadpoolWorkBatch(test_BatchCallback, hits, 1, &environment))
+		goto fail;
+
+	if (!winpr_SubmitThreadpoolWorkBatch(test_BatchCallback, hits, ARRAYSIZE(hits), &environment))
+		goto fail;
+
+	for (size_t x = 0; x < ARRAYSIZE(hits); x++)
+	{
+		const LONG expect = (x == 0) ? 3 : 2;
+		if (hits[x] != expect)
+		{
+			printf("index %" PRIuz " ran %" PRId32 " times, expected %" PRId32 "\n", x, hits[x],
+			       expect);
+			goto fail;
+		}
+	}
+
+	rc = TRUE;
+fail:
+	DestroyThreadpoolEnvironment(&environment);
+	CloseThreadpool(pool);
+	return rc;
+}
+
 int TestPoolWork(int argc, char* argv[])
 {
 
@@ -132,5 +190,8 @@ int TestPoolWork(int argc, char* argv[])
 	if (!test2())
 		return -1;
 
+	if (!test3())
+		return -1;
+
 	return 0;
 }
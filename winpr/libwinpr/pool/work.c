@@ -128,7 +128,6 @@ VOID winpr_CloseThreadpoolWork(PTP_WORK pwk)
 VOID winpr_SubmitThreadpoolWork(PTP_WORK pwk)
 {
 	PTP_POOL pool = NULL;
-	PTP_CALLBACK_INSTANCE callbackInstance = NULL;
 #ifdef _WIN32
 	InitOnceExecuteOnce(&init_once_module, init_module, NULL, NULL);
 
@@ -143,16 +142,10 @@ VOID winpr_SubmitThreadpoolWork(PTP_WORK pwk)
 	WINPR_ASSERT(pwk);
 	WINPR_ASSERT(pwk->CallbackEnvironment);
 	pool = pwk->CallbackEnvironment->Pool;
-	callbackInstance = (PTP_CALLBACK_INSTANCE)calloc(1, sizeof(TP_CALLBACK_INSTANCE));
+	WINPR_ASSERT(pool);
 
-	if (callbackInstance)
-	{
-		callbackInstance->Work = pwk;
-		CountdownEvent_AddCount(pool->WorkComplete, 1);
-		if (!Queue_Enqueue(pool->PendingQueue, callbackInstance))
-			free(callbackInstance);
-	}
-	// NOLINTNEXTLINE(clang-analyzer-unix.Malloc): Queue_Enqueue takes ownership of callbackInstance
+	if (!TpPostWork(pool, pwk))
+		WLog_ERR(TAG, "failed to queue work");
 }
 
 BOOL winpr_TrySubmitThreadpoolCallback(PTP_SIMPLE_CALLBACK pfns, PVOID pv,
@@ -171,7 +164,6 @@ BOOL winpr_TrySubmitThreadpoolCallback(PTP_SIMPLE_CALLBACK pfns, PVOID pv,
 
 VOID winpr_WaitForThreadpoolWorkCallbacks(PTP_WORK pwk, BOOL fCancelPendingCallbacks)
 {
-	HANDLE event = NULL;
 	PTP_POOL pool = NULL;
 
 #ifdef _WIN32
@@ -190,10 +182,7 @@ VOID winpr_WaitForThreadpoolWorkCallbacks(PTP_WORK pwk, BOOL fCancelPendingCallb
 	pool = pwk->CallbackEnvironment->Pool;
 	WINPR_ASSERT(pool);
 
-	event = CountdownEvent_WaitHandle(pool->WorkComplete);
-
-	if (WaitForSingleObject(event, INFINITE) != WAIT_OBJECT_0)
-		WLog_ERR(TAG, "error waiting on work completion");
+	TpWaitForWork(pool);
 }
 
 #endif /* WINPR_THREAD_POOL defined */
@@ -257,6 +257,38 @@ fail:
 	return rv;
 }
 
+/**
+ * A MEMORY cache configured in the settings is shared by all connections of the process, the
+ * tickets of one identity are reused until they expire. Every principal gets its own cache
+ * below that name so connections with different identities do not reinitialize (and thereby
+ * wipe) each others tickets.
+ */
+static krb5_error_code kerberos_resolve_shared_ccache(krb5_context ctx, const char* name,
+                                                      krb5_principal principal,
+                                                      krb5_ccache* ccache)
+{
+	const char prefix[] = "MEMORY:";
+
+	if (_strnicmp(name, prefix, sizeof(prefix) - 1) != 0)
+		return krb5_cc_resolve(ctx, name, ccache);
+
+	char* client = NULL;
+	krb5_error_code rv = krb5_unparse_name(ctx, principal, &client);
+	if (rv)
+		return rv;
+
+	char* shared = NULL;
+	size_t length = 0;
+	if (winpr_asprintf(&shared, &length, "%s-%s", name, client) < 0)
+		rv = KRB5_CC_NOMEM;
+	else
+		rv = krb5_cc_resolve(ctx, shared, ccache);
+
+	free(shared);
+	krb5_free_unparsed_name(ctx, client);
+	return rv;
+}
+
 #endif /* WITH_KRB5 */
 
 static SECURITY_STATUS SEC_ENTRY kerberos_AcquireCredentialsHandleA(
@@ -351,7 +383,8 @@ static SECURITY_STATUS SEC_ENTRY kerberos_AcquireCredentialsHandleA(
 			}
 			else
 			{
-				if (krb_log_exec(krb5_cc_resolve, ctx, krb_settings->cache, &ccache))
+				if (krb_log_exec(kerberos_resolve_shared_ccache, ctx, krb_settings->cache,
+				                 principal, &ccache))
 					goto cleanup;
 			}
 
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 
 #include <winpr/synch.h>
+#include <winpr/assert.h>
 
 #ifndef _WIN32
 
@@ -103,8 +104,20 @@ static BOOL set_non_blocking_fd(int fd)
 }
 #endif /* !WINPR_HAVE_SYS_EVENTFD_H */
 
+static BOOL winpr_event_init_lock(WINPR_EVENT_IMPL* event, BOOL mirrored)
+{
+	event->mirrored = mirrored;
+	event->signaled = FALSE;
+	event->lockInitialized = (pthread_mutex_init(&event->lock, NULL) == 0);
+	return event->lockInitialized;
+}
+
 BOOL winpr_event_init(WINPR_EVENT_IMPL* event)
 {
+	/* the descriptor is private, the signaled state can be tracked in user space */
+	if (!winpr_event_init_lock(event, TRUE))
+		return FALSE;
+
 #ifdef WINPR_HAVE_SYS_EVENTFD_H
 	event->fds[1] = -1;
 	event->fds[0] = eventfd(0, EFD_NONBLOCK);
@@ -127,13 +140,16 @@ out_error:
 
 void winpr_event_init_from_fd(WINPR_EVENT_IMPL* event, int fd)
 {
+	/* someone else owns the descriptor, always ask the kernel */
+	(void)winpr_event_init_lock(event, FALSE);
+
 	event->fds[0] = fd;
 #ifndef WINPR_HAVE_SYS_EVENTFD_H
 	event->fds[1] = fd;
 #endif
 }
 
-BOOL winpr_event_set(WINPR_EVENT_IMPL* event)
+static BOOL winpr_event_set_fd(WINPR_EVENT_IMPL* event)
 {
 	int ret = 0;
 	do
@@ -149,7 +165,7 @@ BOOL winpr_event_set(WINPR_EVENT_IMPL* event)
 	return ret >= 0;
 }
 
-BOOL winpr_event_reset(WINPR_EVENT_IMPL* event)
+static BOOL winpr_event_reset_fd(WINPR_EVENT_IMPL* event)
 {
 	int ret = 0;
 	do
@@ -169,6 +185,75 @@ BOOL winpr_event_reset(WINPR_EVENT_IMPL* event)
 	return (errno == EAGAIN);
 }
 
+BOOL winpr_event_set(WINPR_EVENT_IMPL* event)
+{
+	BOOL rc = TRUE;
+
+	if (!event->lockInitialized)
+		return winpr_event_set_fd(event);
+
+	pthread_mutex_lock(&event->lock);
+	/* setting a set event does not need to touch the descriptor */
+	if (!event->mirrored || !event->signaled)
+	{
+		rc = winpr_event_set_fd(event);
+		if (rc)
+			event->signaled = TRUE;
+	}
+	pthread_mutex_unlock(&event->lock);
+	return rc;
+}
+
+BOOL winpr_event_reset(WINPR_EVENT_IMPL* event)
+{
+	BOOL rc = TRUE;
+
+	if (!event->lockInitialized)
+		return winpr_event_reset_fd(event);
+
+	pthread_mutex_lock(&event->lock);
+	if (!event->mirrored || event->signaled)
+	{
+		rc = winpr_event_reset_fd(event);
+		if (rc)
+			event->signaled = FALSE;
+	}
+	pthread_mutex_unlock(&event->lock);
+	return rc;
+}
+
+BOOL winpr_event_peek(WINPR_EVENT_IMPL* event, BOOL* signaled)
+{
+	BOOL rc = FALSE;
+
+	WINPR_ASSERT(event);
+	WINPR_ASSERT(signaled);
+
+	if (!event->lockInitialized)
+		return FALSE;
+
+	pthread_mutex_lock(&event->lock);
+	if (event->mirrored)
+	{
+		*signaled = event->signaled;
+		rc = TRUE;
+	}
+	pthread_mutex_unlock(&event->lock);
+	return rc;
+}
+
+void winpr_event_unmirror(WINPR_EVENT_IMPL* event)
+{
+	WINPR_ASSERT(event);
+
+	if (!event->lockInitialized)
+		return;
+
+	pthread_mutex_lock(&event->lock);
+	event->mirrored = FALSE;
+	pthread_mutex_unlock(&event->lock);
+}
+
 void winpr_event_uninit(WINPR_EVENT_IMPL* event)
 {
 	if (event->fds[0] != -1)
@@ -182,6 +267,12 @@ void winpr_event_uninit(WINPR_EVENT_IMPL* event)
 		close(event->fds[1]);
 		event->fds[1] = -1;
 	}
+
+	if (event->lockInitialized)
+	{
+		pthread_mutex_destroy(&event->lock);
+		event->lockInitialized = FALSE;
+	}
 }
 
 static BOOL EventCloseHandle(HANDLE handle);
@@ -481,6 +572,13 @@ HANDLE CreateWaitObjectEvent(LPSECURITY_ATTRIBUTES lpEventAttributes, BOOL bManu
 int GetEventFileDescriptor(HANDLE hEvent)
 {
 #ifndef _WIN32
+	ULONG Type = 0;
+	WINPR_HANDLE* Object = NULL;
+
+	/* the caller may poll, read or hand the descriptor to the kernel from now on */
+	if (winpr_Handle_GetInfo(hEvent, &Type, &Object) && (Type == HANDLE_TYPE_EVENT))
+		winpr_event_unmirror(&((WINPR_EVENT*)Object)->impl);
+
 	return winpr_Handle_getFd(hEvent);
 #else
 	return -1;
@@ -511,6 +609,7 @@ int SetEventFileDescriptor(HANDLE hEvent, int FileDescriptor, ULONG mode)
 	if (!event->bAttached && event->impl.fds[0] >= 0 && event->impl.fds[0] != FileDescriptor)
 		close(event->impl.fds[0]);
 
+	winpr_event_unmirror(&event->impl);
 	event->bAttached = TRUE;
 	event->common.Mode = mode;
 	event->impl.fds[0] = FileDescriptor;
@@ -27,9 +27,21 @@
 #include <sys/eventfd.h>
 #endif
 
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
 struct winpr_event_impl
 {
 	int fds[2];
+#ifndef _WIN32
+	/* serializes set and reset, keeps signaled in sync with the descriptor */
+	pthread_mutex_t lock;
+	BOOL lockInitialized;
+	/* signaled is only valid while nobody outside of winpr touches the descriptor */
+	BOOL mirrored;
+	BOOL signaled;
+#endif
 };
 
 typedef struct winpr_event_impl WINPR_EVENT_IMPL;
@@ -54,4 +66,12 @@ BOOL winpr_event_set(WINPR_EVENT_IMPL* event);
 BOOL winpr_event_reset(WINPR_EVENT_IMPL* event);
 void winpr_event_uninit(WINPR_EVENT_IMPL* event);
 
+/** @brief Get the state of an event without a syscall.
+ *
+ *  @return \b FALSE if the state is only known to the kernel, e.g. because the descriptor was
+ *  handed out with GetEventFileDescriptor
+ */
+BOOL winpr_event_peek(WINPR_EVENT_IMPL* event, BOOL* signaled);
+void winpr_event_unmirror(WINPR_EVENT_IMPL* event);
+
 #endif /* WINPR_LIBWINPR_SYNCH_EVENT_H_ */
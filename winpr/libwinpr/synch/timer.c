@@ -679,6 +679,9 @@ int GetTimerFileDescriptor(HANDLE hTimer)
 		return -1;
 	}
 
+#if defined(TIMER_IMPL_DISPATCH) || defined(TIMER_IMPL_POSIX)
+	winpr_event_unmirror(&((WINPR_TIMER*)hdl)->event);
+#endif
 	return winpr_Handle_getFd(hTimer);
 }
 
@@ -132,6 +132,61 @@ static void ts_add_ms(struct timespec* ts, DWORD dwMilliseconds)
 	ts->tv_nsec = ts->tv_nsec % 1000000000L;
 }
 
+/* events created by winpr track their state in user space, answer from there when possible */
+static BOOL wait_peek_event(WINPR_HANDLE* Object, ULONG Type, BOOL* signaled)
+{
+	if (Type != HANDLE_TYPE_EVENT)
+		return FALSE;
+
+	return winpr_event_peek(&((WINPR_EVENT*)Object)->impl, signaled);
+}
+
+/**
+ * Decides a wait on handles without a syscall if all of them are tracked events.
+ *
+ * @return 1 if \b ret is set, 0 if no handle is ready yet and -1 if poll is required
+ */
+static int wait_peek_events(DWORD nCount, const HANDLE* lpHandles, BOOL bWaitAll, DWORD* ret)
+{
+	DWORD count = 0;
+	DWORD first = nCount;
+
+	for (DWORD idx = 0; idx < nCount; idx++)
+	{
+		ULONG Type = 0;
+		WINPR_HANDLE* Object = NULL;
+		BOOL signaled = FALSE;
+
+		if (!winpr_Handle_GetInfo(lpHandles[idx], &Type, &Object))
+			return -1;
+
+		if (!wait_peek_event(Object, Type, &signaled))
+			return -1;
+
+		if (signaled)
+		{
+			count++;
+			if (first == nCount)
+				first = idx;
+		}
+	}
+
+	/* events have no cleanup, no need to call winpr_Handle_cleanup */
+	if (bWaitAll && (count == nCount))
+	{
+		*ret = WAIT_OBJECT_0;
+		return 1;
+	}
+
+	if (!bWaitAll && (first < nCount))
+	{
+		*ret = WAIT_OBJECT_0 + first;
+		return 1;
+	}
+
+	return 0;
+}
+
 DWORD WaitForSingleObjectEx(HANDLE hHandle, DWORD dwMilliseconds, BOOL bAlertable)
 {
 	ULONG Type = 0;
@@ -145,6 +200,19 @@ DWORD WaitForSingleObjectEx(HANDLE hHandle, DWORD dwMilliseconds, BOOL bAlertabl
 		return WAIT_FAILED;
 	}
 
+	if (!bAlertable)
+	{
+		BOOL signaled = FALSE;
+
+		if (wait_peek_event(Object, Type, &signaled))
+		{
+			if (signaled)
+				return winpr_Handle_cleanup(Object);
+			if (dwMilliseconds == 0)
+				return WAIT_TIMEOUT;
+		}
+	}
+
 	if (Type == HANDLE_TYPE_PROCESS && winpr_Handle_getFd(hHandle) == -1)
 	{
 		/* note: if we have pidfd support (under linux and we have managed to associate a
@@ -322,6 +390,15 @@ DWORD WaitForMultipleObjectsEx(DWORD nCount, const HANDLE* lpHandles, BOOL bWait
 		return WAIT_FAILED;
 	}
 
+	if (!bAlertable)
+	{
+		const int rc = wait_peek_events(nCount, lpHandles, bWaitAll, &ret);
+		if (rc > 0)
+			return ret;
+		if ((rc == 0) && (dwMilliseconds == 0))
+			return WAIT_TIMEOUT;
+	}
+
 	if (bAlertable)
 	{
 		thread = winpr_GetCurrentThread();
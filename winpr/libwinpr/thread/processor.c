@@ -17,12 +17,28 @@
  * limitations under the License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // NOLINT(bugprone-reserved-identifier,cert-dcl37-c,cert-dcl51-cpp)
+#endif
+
 #include <winpr/config.h>
 
-#include <winpr/handle.h>
+#include <errno.h>
 
+#include <winpr/handle.h>
+#include <winpr/crt.h>
+#include <winpr/file.h>
+#include <winpr/debug.h>
 #include <winpr/thread.h>
 
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "../log.h"
+#define TAG WINPR_TAG("thread")
+
 /**
  * GetCurrentProcessorNumber
  * GetCurrentProcessorNumberEx
@@ -39,3 +55,166 @@ DWORD GetCurrentProcessorNumber(VOID)
 }
 
 #endif
+
+BOOL winpr_ParseProcessorList(const char* list, UINT32* cpus, size_t* count)
+{
+	size_t used = 0;
+
+	if (!list || !count || (!cpus && (*count > 0)))
+		return FALSE;
+
+	const char* cur = list;
+	while (*cur != '\0')
+	{
+		char* end = NULL;
+
+		errno = 0;
+		const unsigned long first = strtoul(cur, &end, 10);
+		if ((errno != 0) || (end == cur) || (first > UINT32_MAX))
+			return FALSE;
+
+		unsigned long last = first;
+		cur = end;
+		if (*cur == '-')
+		{
+			cur++;
+			errno = 0;
+			last = strtoul(cur, &end, 10);
+			if ((errno != 0) || (end == cur) || (last > UINT32_MAX) || (last < first))
+				return FALSE;
+			cur = end;
+		}
+
+		for (unsigned long x = first; x <= last; x++)
+		{
+			if (used >= *count)
+				return FALSE;
+			cpus[used++] = (UINT32)x;
+		}
+
+		/* sysfs lists end with a newline */
+		while ((*cur == ' ') || (*cur == '\n'))
+			cur++;
+		if (*cur == ',')
+			cur++;
+		else if (*cur != '\0')
+			return FALSE;
+	}
+
+	*count = used;
+	return TRUE;
+}
+
+BOOL winpr_GetNumaNodeProcessors(UINT32 node, UINT32* cpus, size_t* count)
+{
+	if (!cpus || !count)
+		return FALSE;
+
+#if defined(_WIN32)
+	ULONGLONG mask = 0;
+	size_t used = 0;
+
+	if ((node > UCHAR_MAX) || !GetNumaNodeProcessorMask((UCHAR)node, &mask))
+		return FALSE;
+
+	for (UINT32 x = 0; x < 64; x++)
+	{
+		if ((mask & (1ull << x)) == 0)
+			continue;
+		if (used >= *count)
+			return FALSE;
+		cpus[used++] = x;
+	}
+
+	*count = used;
+	return TRUE;
+#elif defined(__linux__)
+	char path[64] = { 0 };
+	char buffer[4096] = { 0 };
+
+	(void)_snprintf(path, sizeof(path), "/sys/devices/system/node/node%" PRIu32 "/cpulist", node);
+	FILE* fp = winpr_fopen(path, "r");
+	if (!fp)
+		return FALSE;
+
+	const size_t rc = fread(buffer, 1, sizeof(buffer) - 1, fp);
+	(void)fclose(fp);
+	if (rc == 0)
+		return FALSE;
+
+	return winpr_ParseProcessorList(buffer, cpus, count);
+#else
+	WINPR_UNUSED(node);
+	return FALSE;
+#endif
+}
+
+BOOL winpr_SetCurrentThreadAffinity(const UINT32* cpus, size_t count)
+{
+	if (!cpus && (count > 0))
+		return FALSE;
+
+#if defined(_WIN32)
+	DWORD_PTR mask = 0;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (cpus[x] >= sizeof(DWORD_PTR) * 8)
+			return FALSE;
+		mask |= ((DWORD_PTR)1) << cpus[x];
+	}
+
+	if (count == 0)
+	{
+		DWORD_PTR system = 0;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &system))
+			return FALSE;
+	}
+
+	return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+	const long configured = sysconf(_SC_NPROCESSORS_CONF);
+	size_t max = (configured > 0) ? (size_t)configured : 1;
+
+	for (size_t x = 0; x < count; x++)
+	{
+		if (cpus[x] >= max)
+			max = cpus[x] + 1ull;
+	}
+
+	cpu_set_t* set = CPU_ALLOC(max);
+	if (!set)
+		return FALSE;
+
+	const size_t size = CPU_ALLOC_SIZE(max);
+	CPU_ZERO_S(size, set);
+
+	/* no processors means all of them */
+	if (count == 0)
+	{
+		for (size_t x = 0; x < max; x++)
+			CPU_SET_S(x, size, set);
+	}
+	else
+	{
+		for (size_t x = 0; x < count; x++)
+			CPU_SET_S(cpus[x], size, set);
+	}
+
+	const int rc = sched_setaffinity(0, size, set);
+	CPU_FREE(set);
+
+	if (rc != 0)
+	{
+		char ebuffer[256] = { 0 };
+		WLog_WARN(TAG, "sched_setaffinity failed with %s [%d]",
+		          winpr_strerror(errno, ebuffer, sizeof(ebuffer)), errno);
+		return FALSE;
+	}
+	return TRUE;
+#else
+	WINPR_UNUSED(cpus);
+	WINPR_UNUSED(count);
+	return FALSE;
+#endif
+}
@@ -0,0 +1,64 @@
+
+#include <stdio.h>
+#include <string.h>
+
+#include <winpr/thread.h>
+
+static BOOL test_list(const char* list, BOOL valid, const UINT32* expect, size_t expectCount)
+{
+	UINT32 cpus[16] = { 0 };
+	size_t count = ARRAYSIZE(cpus);
+
+	const BOOL rc = winpr_ParseProcessorList(list, cpus, &count);
+	if (rc != valid)
+	{
+		printf("winpr_ParseProcessorList(\"%s\") returned %d, expected %d\n", list, rc, valid);
+		return FALSE;
+	}
+
+	if (!valid)
+		return TRUE;
+
+	if ((count != expectCount) || (memcmp(cpus, expect, count * sizeof(UINT32)) != 0))
+	{
+		printf("winpr_ParseProcessorList(\"%s\") returned a wrong list\n", list);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int TestThreadAffinity(int argc, char* argv[])
+{
+	const UINT32 ranges[] = { 0, 1, 2, 3, 8, 10, 11 };
+	const UINT32 single[] = { 7 };
+
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_list("0-3,8,10-11", TRUE, ranges, ARRAYSIZE(ranges)))
+		return -1;
+	if (!test_list("7\n", TRUE, single, ARRAYSIZE(single)))
+		return -1;
+	if (!test_list("", TRUE, NULL, 0))
+		return -1;
+	if (!test_list("3-1", FALSE, NULL, 0))
+		return -1;
+	if (!test_list("1,,2", FALSE, NULL, 0))
+		return -1;
+	if (!test_list("node1", FALSE, NULL, 0))
+		return -1;
+	if (!test_list("0-31", FALSE, NULL, 0))
+		return -1;
+
+	/* allowing all processors again must always work where affinity is supported */
+#if defined(_WIN32) || defined(__linux__)
+	if (!winpr_SetCurrentThreadAffinity(NULL, 0))
+	{
+		printf("winpr_SetCurrentThreadAffinity failed\n");
+		return -1;
+	}
+#endif
+
+	return 0;
+}
@@ -25,35 +25,49 @@
 #include <winpr/collections.h>
 
 /**
- * This implementation is based on the public domain
- * hash table implementation made by Keith Pomakis:
+ * Open addressing hash table using Robin Hood probing.
  *
- * http://www.pomakis.com/hashtable/hashtable.c
- * http://www.pomakis.com/hashtable/hashtable.h
+ * Entries are stored inline in a dense array, the slot array only holds the
+ * (mixed) hash and the index of the entry. Lookups compare the hash stored in
+ * the slot before touching the entry, and a probe stops as soon as it reaches
+ * a slot closer to its home position than the probe itself.
+ *
+ * Entries are iterated in array order, so HashTable_Foreach callbacks can
+ * safely insert (new entries are appended) and remove (entries are marked and
+ * compacted once the outermost HashTable_Foreach returns).
  */
 
-typedef struct s_wKeyValuePair wKeyValuePair;
+#define HASHTABLE_MIN_SLOTS 16
+
+/* grow once this many slots out of 8 are used */
+#define HASHTABLE_MAX_LOAD 6
 
-struct s_wKeyValuePair
+typedef struct
 {
 	void* key;
 	void* value;
-
-	wKeyValuePair* next;
+	UINT32 hash;
 	BOOL markedForRemove;
-};
+} wHashTableEntry;
+
+typedef struct
+{
+	UINT32 hash;
+	UINT32 entry; /* index into the entry array + 1, 0 for a free slot */
+} wHashTableSlot;
 
 struct s_wHashTable
 {
 	BOOL synchronized;
 	CRITICAL_SECTION lock;
 
-	size_t numOfBuckets;
+	wHashTableSlot* slots;
+	size_t numOfSlots; /* power of two */
+
+	wHashTableEntry* entries;
+	size_t numOfEntries; /* including entries marked for removal */
+	size_t maxEntries;
 	size_t numOfElements;
-	float idealRatio;
-	float lowerRehashThreshold;
-	float upperRehashThreshold;
-	wKeyValuePair** bucketArray;
 
 	HASH_TABLE_HASH_FN hash;
 	wObject key;
@@ -104,105 +118,165 @@ void HashTable_StringFree(void* str)
 	winpr_ObjectStringFree(str);
 }
 
-static INLINE BOOL HashTable_IsProbablePrime(size_t oddNumber)
+static INLINE UINT32 HashTable_Hash(wHashTable* table, const void* key)
 {
-	for (size_t i = 3; i < 51; i += 2)
-	{
-		if (oddNumber == i)
-			return TRUE;
-		else if (oddNumber % i == 0)
-			return FALSE;
-	}
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(table->hash);
+
+	/* the slot index only uses the low bits, spread the user hash over all of them */
+	UINT32 hash = table->hash(key);
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
 
-	return TRUE; /* maybe */
+static INLINE size_t HashTable_ProbeDistance(wHashTable* table, const wHashTableSlot* slot,
+                                             size_t pos)
+{
+	return (pos - slot->hash) & (table->numOfSlots - 1);
 }
 
-static INLINE size_t HashTable_CalculateIdealNumOfBuckets(wHashTable* table)
+static INLINE void HashTable_SlotInsert(wHashTable* table, UINT32 hash, size_t index)
 {
 	WINPR_ASSERT(table);
+	WINPR_ASSERT(index < UINT32_MAX);
 
-	const float numOfElements = (float)table->numOfElements;
-	const float tmp = (numOfElements / table->idealRatio);
-	size_t idealNumOfBuckets = (size_t)tmp;
+	const size_t mask = table->numOfSlots - 1;
+	wHashTableSlot cur = { hash, (UINT32)index + 1 };
+	size_t pos = hash & mask;
+	size_t dist = 0;
 
-	if (idealNumOfBuckets < 5)
-		idealNumOfBuckets = 5;
-	else
-		idealNumOfBuckets |= 0x01;
+	while (1)
+	{
+		wHashTableSlot* slot = &table->slots[pos];
 
-	while (!HashTable_IsProbablePrime(idealNumOfBuckets))
-		idealNumOfBuckets += 2;
+		if (slot->entry == 0)
+		{
+			*slot = cur;
+			return;
+		}
+
+		/* take the slot from entries that are closer to their home position */
+		const size_t slotDist = HashTable_ProbeDistance(table, slot, pos);
+		if (slotDist < dist)
+		{
+			const wHashTableSlot tmp = *slot;
+			*slot = cur;
+			cur = tmp;
+			dist = slotDist;
+		}
 
-	return idealNumOfBuckets;
+		pos = (pos + 1) & mask;
+		dist++;
+	}
 }
 
-static INLINE void HashTable_Rehash(wHashTable* table, size_t numOfBuckets)
+static INLINE void HashTable_SlotRemove(wHashTable* table, size_t pos)
 {
-	UINT32 hashValue = 0;
-	wKeyValuePair* nextPair = NULL;
-	wKeyValuePair** newBucketArray = NULL;
-
 	WINPR_ASSERT(table);
-	if (numOfBuckets == 0)
-		numOfBuckets = HashTable_CalculateIdealNumOfBuckets(table);
-
-	if (numOfBuckets == table->numOfBuckets)
-		return; /* already the right size! */
 
-	newBucketArray = (wKeyValuePair**)calloc(numOfBuckets, sizeof(wKeyValuePair*));
+	const size_t mask = table->numOfSlots - 1;
+	size_t next = (pos + 1) & mask;
 
-	if (!newBucketArray)
+	/* backward shift, keeps the table free of tombstones */
+	while ((table->slots[next].entry != 0) &&
+	       (HashTable_ProbeDistance(table, &table->slots[next], next) != 0))
 	{
-		/*
-		 * Couldn't allocate memory for the new array.
-		 * This isn't a fatal error; we just can't perform the rehash.
-		 */
-		return;
+		table->slots[pos] = table->slots[next];
+		pos = next;
+		next = (next + 1) & mask;
 	}
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
-	{
-		wKeyValuePair* pair = table->bucketArray[index];
+	table->slots[pos].entry = 0;
+}
 
-		while (pair)
-		{
-			nextPair = pair->next;
-			hashValue = table->hash(pair->key) % numOfBuckets;
-			pair->next = newBucketArray[hashValue];
-			newBucketArray[hashValue] = pair;
-			pair = nextPair;
-		}
+static INLINE void HashTable_Reindex(wHashTable* table)
+{
+	WINPR_ASSERT(table);
+
+	memset(table->slots, 0, table->numOfSlots * sizeof(wHashTableSlot));
+	for (size_t index = 0; index < table->numOfEntries; index++)
+		HashTable_SlotInsert(table, table->entries[index].hash, index);
+}
+
+static INLINE BOOL HashTable_Resize(wHashTable* table, size_t numOfSlots)
+{
+	WINPR_ASSERT(table);
+
+	if (numOfSlots < HASHTABLE_MIN_SLOTS)
+		numOfSlots = HASHTABLE_MIN_SLOTS;
+
+	if (numOfSlots > (UINT32_MAX / 2))
+		return FALSE;
+
+	const size_t maxEntries = numOfSlots / 8 * HASHTABLE_MAX_LOAD;
+	if (maxEntries < table->numOfEntries)
+		return FALSE;
+
+	wHashTableSlot* slots = (wHashTableSlot*)calloc(numOfSlots, sizeof(wHashTableSlot));
+	if (!slots)
+		return FALSE;
+
+	wHashTableEntry* entries =
+	    (wHashTableEntry*)realloc(table->entries, maxEntries * sizeof(wHashTableEntry));
+	if (!entries)
+	{
+		free(slots);
+		return FALSE;
 	}
 
-	free(table->bucketArray);
-	table->bucketArray = newBucketArray;
-	table->numOfBuckets = numOfBuckets;
+	free(table->slots);
+	table->slots = slots;
+	table->numOfSlots = numOfSlots;
+	table->entries = entries;
+	table->maxEntries = maxEntries;
+	HashTable_Reindex(table);
+	return TRUE;
 }
 
-static INLINE BOOL HashTable_Equals(wHashTable* table, const wKeyValuePair* pair, const void* key)
+/* returns the slot position of key or numOfSlots if it is not in the table */
+static INLINE size_t HashTable_Find(wHashTable* table, const void* key, UINT32 hash)
 {
 	WINPR_ASSERT(table);
-	WINPR_ASSERT(pair);
 	WINPR_ASSERT(key);
-	return table->key.fnObjectEquals(key, pair->key);
+
+	const size_t mask = table->numOfSlots - 1;
+	size_t pos = hash & mask;
+
+	for (size_t dist = 0; dist < table->numOfSlots; dist++)
+	{
+		const wHashTableSlot* slot = &table->slots[pos];
+
+		if (slot->entry == 0)
+			break;
+
+		if (HashTable_ProbeDistance(table, slot, pos) < dist)
+			break;
+
+		if ((slot->hash == hash) &&
+		    table->key.fnObjectEquals(key, table->entries[slot->entry - 1].key))
+			return pos;
+
+		pos = (pos + 1) & mask;
+	}
+
+	return table->numOfSlots;
 }
 
-static INLINE wKeyValuePair* HashTable_Get(wHashTable* table, const void* key)
+static INLINE wHashTableEntry* HashTable_Get(wHashTable* table, const void* key)
 {
-	UINT32 hashValue = 0;
-	wKeyValuePair* pair = NULL;
-
 	WINPR_ASSERT(table);
 	if (!key)
 		return NULL;
 
-	hashValue = table->hash(key) % table->numOfBuckets;
-	pair = table->bucketArray[hashValue];
-
-	while (pair && !HashTable_Equals(table, pair, key))
-		pair = pair->next;
+	const size_t pos = HashTable_Find(table, key, HashTable_Hash(table, key));
+	if (pos >= table->numOfSlots)
+		return NULL;
 
-	return pair;
+	return &table->entries[table->slots[pos].entry - 1];
 }
 
 static INLINE void disposeKey(wHashTable* table, void* key)
@@ -219,24 +293,25 @@ static INLINE void disposeValue(wHashTable* table, void* value)
 		table->value.fnObjectFree(value);
 }
 
-static INLINE void disposePair(wHashTable* table, wKeyValuePair* pair)
+static INLINE void disposeEntry(wHashTable* table, wHashTableEntry* entry)
 {
 	WINPR_ASSERT(table);
-	if (!pair)
+	if (!entry)
 		return;
-	disposeKey(table, pair->key);
-	disposeValue(table, pair->value);
-	free(pair);
+	disposeKey(table, entry->key);
+	disposeValue(table, entry->value);
+	entry->key = NULL;
+	entry->value = NULL;
 }
 
-static INLINE void setKey(wHashTable* table, wKeyValuePair* pair, const void* key)
+static INLINE void setKey(wHashTable* table, wHashTableEntry* entry, const void* key)
 {
 	WINPR_ASSERT(table);
-	if (!pair)
+	if (!entry)
 		return;
-	disposeKey(table, pair->key);
+	disposeKey(table, entry->key);
 	if (table->key.fnObjectNew)
-		pair->key = table->key.fnObjectNew(key);
+		entry->key = table->key.fnObjectNew(key);
 	else
 	{
 		union
@@ -245,18 +320,18 @@ static INLINE void setKey(wHashTable* table, wKeyValuePair* pair, const void* ke
 			void* pv;
 		} cnv;
 		cnv.cpv = key;
-		pair->key = cnv.pv;
+		entry->key = cnv.pv;
 	}
 }
 
-static INLINE void setValue(wHashTable* table, wKeyValuePair* pair, const void* value)
+static INLINE void setValue(wHashTable* table, wHashTableEntry* entry, const void* value)
 {
 	WINPR_ASSERT(table);
-	if (!pair)
+	if (!entry)
 		return;
-	disposeValue(table, pair->value);
+	disposeValue(table, entry->value);
 	if (table->value.fnObjectNew)
-		pair->value = table->value.fnObjectNew(value);
+		entry->value = table->value.fnObjectNew(value);
 	else
 	{
 		union
@@ -265,8 +340,59 @@ static INLINE void setValue(wHashTable* table, wKeyValuePair* pair, const void*
 			void* pv;
 		} cnv;
 		cnv.cpv = value;
-		pair->value = cnv.pv;
+		entry->value = cnv.pv;
+	}
+}
+
+/* removes the entry referenced by the slot at pos, must not be called during a foreach */
+static INLINE void HashTable_RemoveAt(wHashTable* table, size_t pos)
+{
+	WINPR_ASSERT(table);
+	WINPR_ASSERT(table->foreachRecursionLevel == 0);
+
+	const size_t index = table->slots[pos].entry - 1;
+	const size_t last = table->numOfEntries - 1;
+
+	disposeEntry(table, &table->entries[index]);
+	HashTable_SlotRemove(table, pos);
+
+	if (index != last)
+	{
+		/* keep the entry array dense, move the last entry into the hole */
+		wHashTableEntry* moved = &table->entries[last];
+		const size_t mask = table->numOfSlots - 1;
+		size_t slot = moved->hash & mask;
+
+		while (table->slots[slot].entry != last + 1)
+			slot = (slot + 1) & mask;
+
+		table->slots[slot].entry = (UINT32)index + 1;
+		table->entries[index] = *moved;
+	}
+
+	table->numOfEntries--;
+}
+
+/* disposes the entries marked for removal once the last foreach returned */
+static INLINE void HashTable_Compact(wHashTable* table)
+{
+	size_t used = 0;
+
+	WINPR_ASSERT(table);
+
+	for (size_t index = 0; index < table->numOfEntries; index++)
+	{
+		wHashTableEntry* entry = &table->entries[index];
+
+		if (entry->markedForRemove)
+			disposeEntry(table, entry);
+		else
+			table->entries[used++] = *entry;
 	}
+
+	table->numOfEntries = used;
+	table->pendingRemoves = 0;
+	HashTable_Reindex(table);
 }
 
 /**
@@ -307,9 +433,6 @@ int HashTable_Add(wHashTable* table, const void* key, const void* value)
 BOOL HashTable_Insert(wHashTable* table, const void* key, const void* value)
 {
 	BOOL rc = FALSE;
-	UINT32 hashValue = 0;
-	wKeyValuePair* pair = NULL;
-	wKeyValuePair* newPair = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key || !value)
@@ -318,56 +441,48 @@ BOOL HashTable_Insert(wHashTable* table, const void* key, const void* value)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	hashValue = table->hash(key) % table->numOfBuckets;
-	pair = table->bucketArray[hashValue];
+	const UINT32 hash = HashTable_Hash(table, key);
+	const size_t pos = HashTable_Find(table, key, hash);
 
-	while (pair && !HashTable_Equals(table, pair, key))
-		pair = pair->next;
-
-	if (pair)
+	if (pos < table->numOfSlots)
 	{
-		if (pair->markedForRemove)
+		wHashTableEntry* entry = &table->entries[table->slots[pos].entry - 1];
+
+		if (entry->markedForRemove)
 		{
 			/* this entry was set to be removed but will be recycled instead */
 			table->pendingRemoves--;
-			pair->markedForRemove = FALSE;
+			entry->markedForRemove = FALSE;
 			table->numOfElements++;
 		}
 
-		if (pair->key != key)
+		if (entry->key != key)
 		{
-			setKey(table, pair, key);
+			setKey(table, entry, key);
 		}
 
-		if (pair->value != value)
+		if (entry->value != value)
 		{
-			setValue(table, pair, value);
+			setValue(table, entry, value);
 		}
 		rc = TRUE;
 	}
-	else
+	else if ((table->numOfEntries < table->maxEntries) ||
+	         HashTable_Resize(table, table->numOfSlots * 2))
 	{
-		newPair = (wKeyValuePair*)calloc(1, sizeof(wKeyValuePair));
-
-		if (newPair)
-		{
-			setKey(table, newPair, key);
-			setValue(table, newPair, value);
-			newPair->next = table->bucketArray[hashValue];
-			newPair->markedForRemove = FALSE;
-			table->bucketArray[hashValue] = newPair;
-			table->numOfElements++;
-
-			if (!table->foreachRecursionLevel && table->upperRehashThreshold > table->idealRatio)
-			{
-				float elementToBucketRatio =
-				    (float)table->numOfElements / (float)table->numOfBuckets;
-
-				if (elementToBucketRatio > table->upperRehashThreshold)
-					HashTable_Rehash(table, 0);
-			}
-			rc = TRUE;
-		}
+		const size_t index = table->numOfEntries;
+		wHashTableEntry* entry = &table->entries[index];
+
+		entry->key = NULL;
+		entry->value = NULL;
+		entry->hash = hash;
+		entry->markedForRemove = FALSE;
+		setKey(table, entry, key);
+		setValue(table, entry, value);
+		HashTable_SlotInsert(table, hash, index);
+		table->numOfEntries++;
+		table->numOfElements++;
+		rc = TRUE;
 	}
 
 	if (table->synchronized)
@@ -382,10 +497,7 @@ BOOL HashTable_Insert(wHashTable* table, const void* key, const void* value)
 
 BOOL HashTable_Remove(wHashTable* table, const void* key)
 {
-	UINT32 hashValue = 0;
 	BOOL status = TRUE;
-	wKeyValuePair* pair = NULL;
-	wKeyValuePair* previousPair = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
@@ -394,16 +506,9 @@ BOOL HashTable_Remove(wHashTable* table, const void* key)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	hashValue = table->hash(key) % table->numOfBuckets;
-	pair = table->bucketArray[hashValue];
+	const size_t pos = HashTable_Find(table, key, HashTable_Hash(table, key));
 
-	while (pair && !HashTable_Equals(table, pair, key))
-	{
-		previousPair = pair;
-		pair = pair->next;
-	}
-
-	if (!pair)
+	if (pos >= table->numOfSlots)
 	{
 		status = FALSE;
 		goto out;
@@ -412,28 +517,23 @@ BOOL HashTable_Remove(wHashTable* table, const void* key)
 	if (table->foreachRecursionLevel)
 	{
 		/* if we are running a HashTable_Foreach, just mark the entry for removal */
-		pair->markedForRemove = TRUE;
+		wHashTableEntry* entry = &table->entries[table->slots[pos].entry - 1];
+
+		if (entry->markedForRemove)
+		{
+			status = FALSE;
+			goto out;
+		}
+
+		entry->markedForRemove = TRUE;
 		table->pendingRemoves++;
 		table->numOfElements--;
 		goto out;
 	}
 
-	if (previousPair)
-		previousPair->next = pair->next;
-	else
-		table->bucketArray[hashValue] = pair->next;
-
-	disposePair(table, pair);
+	HashTable_RemoveAt(table, pos);
 	table->numOfElements--;
 
-	if (!table->foreachRecursionLevel && table->lowerRehashThreshold > 0.0f)
-	{
-		float elementToBucketRatio = (float)table->numOfElements / (float)table->numOfBuckets;
-
-		if (elementToBucketRatio < table->lowerRehashThreshold)
-			HashTable_Rehash(table, 0);
-	}
-
 out:
 	if (table->synchronized)
 		LeaveCriticalSection(&table->lock);
@@ -448,7 +548,7 @@ out:
 void* HashTable_GetItemValue(wHashTable* table, const void* key)
 {
 	void* value = NULL;
-	wKeyValuePair* pair = NULL;
+	wHashTableEntry* entry = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
@@ -457,10 +557,10 @@ void* HashTable_GetItemValue(wHashTable* table, const void* key)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	pair = HashTable_Get(table, key);
+	entry = HashTable_Get(table, key);
 
-	if (pair && !pair->markedForRemove)
-		value = pair->value;
+	if (entry && !entry->markedForRemove)
+		value = entry->value;
 
 	if (table->synchronized)
 		LeaveCriticalSection(&table->lock);
@@ -475,7 +575,7 @@ void* HashTable_GetItemValue(wHashTable* table, const void* key)
 BOOL HashTable_SetItemValue(wHashTable* table, const void* key, const void* value)
 {
 	BOOL status = TRUE;
-	wKeyValuePair* pair = NULL;
+	wHashTableEntry* entry = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
@@ -484,13 +584,13 @@ BOOL HashTable_SetItemValue(wHashTable* table, const void* key, const void* valu
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	pair = HashTable_Get(table, key);
+	entry = HashTable_Get(table, key);
 
-	if (!pair || pair->markedForRemove)
+	if (!entry || entry->markedForRemove)
 		status = FALSE;
 	else
 	{
-		setValue(table, pair, value);
+		setValue(table, entry, value);
 	}
 
 	if (table->synchronized)
@@ -505,40 +605,36 @@ BOOL HashTable_SetItemValue(wHashTable* table, const void* key, const void* valu
 
 void HashTable_Clear(wHashTable* table)
 {
-	wKeyValuePair* nextPair = NULL;
-
 	WINPR_ASSERT(table);
 
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	if (table->foreachRecursionLevel)
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
-
-		while (pair)
+		/* if we're in a foreach we just mark the entries for removal */
+		for (size_t index = 0; index < table->numOfEntries; index++)
 		{
-			nextPair = pair->next;
+			wHashTableEntry* entry = &table->entries[index];
 
-			if (table->foreachRecursionLevel)
+			if (!entry->markedForRemove)
 			{
-				/* if we're in a foreach we just mark the entry for removal */
-				pair->markedForRemove = TRUE;
+				entry->markedForRemove = TRUE;
 				table->pendingRemoves++;
 			}
-			else
-			{
-				disposePair(table, pair);
-				pair = nextPair;
-			}
 		}
+	}
+	else
+	{
+		for (size_t index = 0; index < table->numOfEntries; index++)
+			disposeEntry(table, &table->entries[index]);
 
-		table->bucketArray[index] = NULL;
+		table->numOfEntries = 0;
+		if (!HashTable_Resize(table, HASHTABLE_MIN_SLOTS))
+			HashTable_Reindex(table);
 	}
 
 	table->numOfElements = 0;
-	if (table->foreachRecursionLevel == 0)
-		HashTable_Rehash(table, 5);
 
 	if (table->synchronized)
 		LeaveCriticalSection(&table->lock);
@@ -553,7 +649,6 @@ size_t HashTable_GetKeys(wHashTable* table, ULONG_PTR** ppKeys)
 	size_t iKey = 0;
 	size_t count = 0;
 	ULONG_PTR* pKeys = NULL;
-	wKeyValuePair* nextPair = NULL;
 
 	WINPR_ASSERT(table);
 
@@ -583,17 +678,12 @@ size_t HashTable_GetKeys(wHashTable* table, ULONG_PTR** ppKeys)
 		return 0;
 	}
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	for (size_t index = 0; index < table->numOfEntries; index++)
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
+		const wHashTableEntry* entry = &table->entries[index];
 
-		while (pair)
-		{
-			nextPair = pair->next;
-			if (!pair->markedForRemove)
-				pKeys[iKey++] = (ULONG_PTR)pair->key;
-			pair = nextPair;
-		}
+		if (!entry->markedForRemove)
+			pKeys[iKey++] = (ULONG_PTR)entry->key;
 	}
 
 	if (table->synchronized)
@@ -617,47 +707,25 @@ BOOL HashTable_Foreach(wHashTable* table, HASH_TABLE_FOREACH_FN fn, VOID* arg)
 		EnterCriticalSection(&table->lock);
 
 	table->foreachRecursionLevel++;
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+
+	/* the callback may append entries and grow the array, so do not keep pointers into it */
+	for (size_t index = 0; index < table->numOfEntries; index++)
 	{
-		for (wKeyValuePair* pair = table->bucketArray[index]; pair; pair = pair->next)
+		const wHashTableEntry entry = table->entries[index];
+
+		if (!entry.markedForRemove && !fn(entry.key, entry.value, arg))
 		{
-			if (!pair->markedForRemove && !fn(pair->key, pair->value, arg))
-			{
-				ret = FALSE;
-				goto out;
-			}
+			ret = FALSE;
+			break;
 		}
 	}
+
 	table->foreachRecursionLevel--;
 
+	/* if we're the last recursive foreach call, let's do the cleanup if needed */
 	if (!table->foreachRecursionLevel && table->pendingRemoves)
-	{
-		/* if we're the last recursive foreach call, let's do the cleanup if needed */
-		wKeyValuePair** prevPtr = NULL;
-		for (size_t index = 0; index < table->numOfBuckets; index++)
-		{
-			wKeyValuePair* nextPair = NULL;
-			prevPtr = &table->bucketArray[index];
-			for (wKeyValuePair* pair = table->bucketArray[index]; pair;)
-			{
-				nextPair = pair->next;
-
-				if (pair->markedForRemove)
-				{
-					disposePair(table, pair);
-					*prevPtr = nextPair;
-				}
-				else
-				{
-					prevPtr = &pair->next;
-				}
-				pair = nextPair;
-			}
-		}
-		table->pendingRemoves = 0;
-	}
+		HashTable_Compact(table);
 
-out:
 	if (table->synchronized)
 		LeaveCriticalSection(&table->lock);
 	return ret;
@@ -670,7 +738,7 @@ out:
 BOOL HashTable_Contains(wHashTable* table, const void* key)
 {
 	BOOL status = 0;
-	wKeyValuePair* pair = NULL;
+	wHashTableEntry* entry = NULL;
 
 	WINPR_ASSERT(table);
 	if (!key)
@@ -679,8 +747,8 @@ BOOL HashTable_Contains(wHashTable* table, const void* key)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	pair = HashTable_Get(table, key);
-	status = (pair && !pair->markedForRemove);
+	entry = HashTable_Get(table, key);
+	status = (entry && !entry->markedForRemove);
 
 	if (table->synchronized)
 		LeaveCriticalSection(&table->lock);
@@ -694,23 +762,7 @@ BOOL HashTable_Contains(wHashTable* table, const void* key)
 
 BOOL HashTable_ContainsKey(wHashTable* table, const void* key)
 {
-	BOOL status = 0;
-	wKeyValuePair* pair = NULL;
-
-	WINPR_ASSERT(table);
-	if (!key)
-		return FALSE;
-
-	if (table->synchronized)
-		EnterCriticalSection(&table->lock);
-
-	pair = HashTable_Get(table, key);
-	status = (pair && !pair->markedForRemove);
-
-	if (table->synchronized)
-		LeaveCriticalSection(&table->lock);
-
-	return status;
+	return HashTable_Contains(table, key);
 }
 
 /**
@@ -728,23 +780,15 @@ BOOL HashTable_ContainsValue(wHashTable* table, const void* value)
 	if (table->synchronized)
 		EnterCriticalSection(&table->lock);
 
-	for (size_t index = 0; index < table->numOfBuckets; index++)
+	for (size_t index = 0; index < table->numOfEntries; index++)
 	{
-		wKeyValuePair* pair = table->bucketArray[index];
+		const wHashTableEntry* entry = &table->entries[index];
 
-		while (pair)
+		if (!entry->markedForRemove && table->value.fnObjectEquals(value, entry->value))
 		{
-			if (!pair->markedForRemove && HashTable_Equals(table, pair, value))
-			{
-				status = TRUE;
-				break;
-			}
-
-			pair = pair->next;
-		}
-
-		if (status)
+			status = TRUE;
 			break;
+		}
 	}
 
 	if (table->synchronized)
@@ -766,16 +810,10 @@ wHashTable* HashTable_New(BOOL synchronized)
 
 	table->synchronized = synchronized;
 	InitializeCriticalSectionAndSpinCount(&(table->lock), 4000);
-	table->numOfBuckets = 64;
-	table->numOfElements = 0;
-	table->bucketArray = (wKeyValuePair**)calloc(table->numOfBuckets, sizeof(wKeyValuePair*));
 
-	if (!table->bucketArray)
+	if (!HashTable_Resize(table, HASHTABLE_MIN_SLOTS))
 		goto fail;
 
-	table->idealRatio = 3.0f;
-	table->lowerRehashThreshold = 0.0f;
-	table->upperRehashThreshold = 15.0f;
 	table->hash = HashTable_PointerHash;
 	table->key.fnObjectEquals = HashTable_PointerCompare;
 	table->value.fnObjectEquals = HashTable_PointerCompare;
@@ -791,28 +829,16 @@ fail:
 
 void HashTable_Free(wHashTable* table)
 {
-	wKeyValuePair* pair = NULL;
-	wKeyValuePair* nextPair = NULL;
-
 	if (!table)
 		return;
 
-	if (table->bucketArray)
+	if (table->entries)
 	{
-		for (size_t index = 0; index < table->numOfBuckets; index++)
-		{
-			pair = table->bucketArray[index];
-
-			while (pair)
-			{
-				nextPair = pair->next;
-
-				disposePair(table, pair);
-				pair = nextPair;
-			}
-		}
-		free(table->bucketArray);
+		for (size_t index = 0; index < table->numOfEntries; index++)
+			disposeEntry(table, &table->entries[index]);
+		free(table->entries);
 	}
+	free(table->slots);
 	DeleteCriticalSection(&(table->lock));
 
 	free(table);
@@ -22,9 +22,21 @@
 #include <winpr/crt.h>
 #include <winpr/sysinfo.h>
 #include <winpr/assert.h>
+#include <winpr/interlocked.h>
 
 #include <winpr/collections.h>
 
+/* messages per block of a single consumer queue */
+#define WMQ_BLOCK_SIZE 64
+
+typedef struct s_wMessageBlock wMessageBlock;
+
+struct s_wMessageBlock
+{
+	wMessageBlock* volatile next;
+	wMessage messages[WMQ_BLOCK_SIZE];
+};
+
 struct s_wMessageQueue
 {
 	size_t head;
@@ -37,6 +49,18 @@ struct s_wMessageQueue
 	HANDLE event;
 
 	wObject object;
+
+	/**
+	 * WMQ_FLAG_SINGLE_CONSUMER: the lock only serializes the producers, the
+	 * consumer owns headBlock/headIndex and synchronizes through count.
+	 */
+	BOOL singleConsumer;
+	LONG volatile count;
+	wMessageBlock* headBlock;
+	size_t headIndex;
+	wMessageBlock* tailBlock;
+	size_t tailIndex;
+	wMessageBlock* volatile spare;
 };
 
 /**
@@ -71,6 +95,8 @@ HANDLE MessageQueue_Event(wMessageQueue* queue)
 size_t MessageQueue_Size(wMessageQueue* queue)
 {
 	WINPR_ASSERT(queue);
+	if (queue->singleConsumer)
+		return (size_t)InterlockedCompareExchange(&queue->count, 0, 0);
 	return queue->size;
 }
 
@@ -120,6 +146,104 @@ static BOOL MessageQueue_EnsureCapacity(wMessageQueue* queue, size_t count)
 	return TRUE;
 }
 
+/* the consumer hands its last drained block to the producers for reuse */
+static wMessageBlock* MessageQueue_ExchangeSpare(wMessageQueue* queue, wMessageBlock* block)
+{
+	wMessageBlock* cur =
+	    InterlockedCompareExchangePointer((PVOID volatile*)&queue->spare, NULL, NULL);
+
+	while (1)
+	{
+		wMessageBlock* prev =
+		    InterlockedCompareExchangePointer((PVOID volatile*)&queue->spare, block, cur);
+		if (prev == cur)
+			return cur;
+		cur = prev;
+	}
+}
+
+static BOOL MessageQueue_DispatchSingleConsumer(wMessageQueue* queue, const wMessage* message)
+{
+	BOOL ret = FALSE;
+
+	EnterCriticalSection(&queue->lock);
+
+	if (queue->closed)
+		goto out;
+
+	if (queue->tailIndex == WMQ_BLOCK_SIZE)
+	{
+		wMessageBlock* block = MessageQueue_ExchangeSpare(queue, NULL);
+		if (!block)
+			block = (wMessageBlock*)calloc(1, sizeof(wMessageBlock));
+		if (!block)
+			goto out;
+
+		block->next = NULL;
+		queue->tailBlock->next = block;
+		queue->tailBlock = block;
+		queue->tailIndex = 0;
+	}
+
+	wMessage* dst = &queue->tailBlock->messages[queue->tailIndex++];
+	*dst = *message;
+	dst->time = GetTickCount64();
+
+	/* publishes the message, only the transition from empty needs a wakeup */
+	if (InterlockedIncrement(&queue->count) == 1)
+		(void)SetEvent(queue->event);
+
+	if (message->id == WMQ_QUIT)
+		queue->closed = TRUE;
+
+	ret = TRUE;
+out:
+	LeaveCriticalSection(&queue->lock);
+	return ret;
+}
+
+/* consumer side of a single consumer queue, returns FALSE if it is empty */
+static BOOL MessageQueue_TakeSingleConsumer(wMessageQueue* queue, wMessage* message, BOOL remove)
+{
+	if (InterlockedCompareExchange(&queue->count, 0, 0) <= 0)
+	{
+		/* a producer might have set the event for a message we already took */
+		(void)ResetEvent(queue->event);
+		if (InterlockedCompareExchange(&queue->count, 0, 0) > 0)
+			(void)SetEvent(queue->event);
+		return FALSE;
+	}
+
+	if (queue->headIndex == WMQ_BLOCK_SIZE)
+	{
+		wMessageBlock* block = queue->headBlock;
+
+		/* the producer linked the next block before publishing into it */
+		queue->headBlock = block->next;
+		queue->headIndex = 0;
+		free(MessageQueue_ExchangeSpare(queue, block));
+	}
+
+	wMessage* src = &queue->headBlock->messages[queue->headIndex];
+	if (message)
+		*message = *src;
+
+	if (remove)
+	{
+		ZeroMemory(src, sizeof(wMessage));
+		queue->headIndex++;
+
+		if (InterlockedDecrement(&queue->count) == 0)
+		{
+			(void)ResetEvent(queue->event);
+			if (InterlockedCompareExchange(&queue->count, 0, 0) > 0)
+				(void)SetEvent(queue->event);
+		}
+	}
+
+	return TRUE;
+}
+
 BOOL MessageQueue_Dispatch(wMessageQueue* queue, const wMessage* message)
 {
 	wMessage* dst = NULL;
@@ -129,7 +253,9 @@ BOOL MessageQueue_Dispatch(wMessageQueue* queue, const wMessage* message)
 	if (!message)
 		return FALSE;
 
-	WINPR_ASSERT(queue);
+	if (queue->singleConsumer)
+		return MessageQueue_DispatchSingleConsumer(queue, message);
+
 	EnterCriticalSection(&queue->lock);
 
 	if (queue->closed)
@@ -179,6 +305,16 @@ int MessageQueue_Get(wMessageQueue* queue, wMessage* message)
 {
 	int status = -1;
 
+	if (queue->singleConsumer)
+	{
+		while (MessageQueue_Wait(queue))
+		{
+			if (MessageQueue_TakeSingleConsumer(queue, message, TRUE))
+				return (message->id != WMQ_QUIT) ? 1 : 0;
+		}
+		return status;
+	}
+
 	if (!MessageQueue_Wait(queue))
 		return status;
 
@@ -207,6 +343,9 @@ int MessageQueue_Peek(wMessageQueue* queue, wMessage* message, BOOL remove)
 	int status = 0;
 
 	WINPR_ASSERT(queue);
+	if (queue->singleConsumer)
+		return MessageQueue_TakeSingleConsumer(queue, message, remove) ? 1 : 0;
+
 	EnterCriticalSection(&queue->lock);
 
 	if (queue->size > 0)
@@ -235,6 +374,11 @@ int MessageQueue_Peek(wMessageQueue* queue, wMessage* message, BOOL remove)
  */
 
 wMessageQueue* MessageQueue_New(const wObject* callback)
+{
+	return MessageQueue_NewEx(callback, 0);
+}
+
+wMessageQueue* MessageQueue_NewEx(const wObject* callback, UINT32 flags)
 {
 	wMessageQueue* queue = NULL;
 
@@ -245,7 +389,15 @@ wMessageQueue* MessageQueue_New(const wObject* callback)
 	if (!InitializeCriticalSectionAndSpinCount(&queue->lock, 4000))
 		goto fail;
 
-	if (!MessageQueue_EnsureCapacity(queue, 32))
+	if (flags & WMQ_FLAG_SINGLE_CONSUMER)
+	{
+		queue->singleConsumer = TRUE;
+		queue->headBlock = (wMessageBlock*)calloc(1, sizeof(wMessageBlock));
+		if (!queue->headBlock)
+			goto fail;
+		queue->tailBlock = queue->headBlock;
+	}
+	else if (!MessageQueue_EnsureCapacity(queue, 32))
 		goto fail;
 
 	queue->event = CreateEvent(NULL, TRUE, FALSE, NULL);
@@ -276,6 +428,14 @@ void MessageQueue_Free(wMessageQueue* queue)
 	(void)CloseHandle(queue->event);
 	DeleteCriticalSection(&queue->lock);
 
+	while (queue->headBlock)
+	{
+		wMessageBlock* next = queue->headBlock->next;
+		free(queue->headBlock);
+		queue->headBlock = next;
+	}
+	free(queue->spare);
+
 	free(queue->array);
 	free(queue);
 }
@@ -287,6 +447,25 @@ int MessageQueue_Clear(wMessageQueue* queue)
 	WINPR_ASSERT(queue);
 	WINPR_ASSERT(queue->event);
 
+	if (queue->singleConsumer)
+	{
+		wMessage msg = { 0 };
+
+		while (MessageQueue_TakeSingleConsumer(queue, &msg, TRUE))
+		{
+			/* Free resources of message. */
+			if (queue->object.fnObjectUninit)
+				queue->object.fnObjectUninit(&msg);
+			if (queue->object.fnObjectFree)
+				queue->object.fnObjectFree(&msg);
+		}
+
+		EnterCriticalSection(&queue->lock);
+		queue->closed = FALSE;
+		LeaveCriticalSection(&queue->lock);
+		return status;
+	}
+
 	EnterCriticalSection(&queue->lock);
 
 	while (queue->size > 0)
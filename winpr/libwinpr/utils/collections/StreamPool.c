@@ -21,20 +21,38 @@
 
 #include <winpr/crt.h>
 #include <winpr/wlog.h>
+#include <winpr/interlocked.h>
 
 #include <winpr/collections.h>
 
 #include "../stream.h"
 
+#include "../../log.h"
+#define TAG WINPR_TAG("utils.streampool")
+
+/* one free list per power of two, bucket b holds streams with capacity in [2^b, 2^(b+1)) */
+#define STREAMPOOL_BUCKETS (sizeof(size_t) * 8)
+
+/**
+ * Streams handed out by the pool are allocated inside an entry. The wStream
+ * is the first member so Stream_Free releases the whole entry.
+ */
+typedef struct s_wStreamPoolEntry
+{
+	wStream s;
+	struct s_wStreamPoolEntry* next;
+	size_t usedIndex;
+	BOOL used;
+} wStreamPoolEntry;
+
 struct s_wStreamPool
 {
 	size_t aSize;
-	size_t aCapacity;
-	wStream** aArray;
+	wStreamPoolEntry* buckets[STREAMPOOL_BUCKETS];
 
 	size_t uSize;
 	size_t uCapacity;
-	wStream** uArray;
+	wStreamPoolEntry** uArray;
 
 	CRITICAL_SECTION lock;
 	BOOL synchronized;
@@ -63,38 +81,37 @@ static INLINE void StreamPool_Unlock(wStreamPool* pool)
 		LeaveCriticalSection(&pool->lock);
 }
 
-static BOOL StreamPool_EnsureCapacity(wStreamPool* pool, size_t count, BOOL usedOrAvailable)
+static INLINE wStreamPoolEntry* StreamPool_Entry(wStream* s)
 {
-	size_t new_cap = 0;
-	size_t* cap = NULL;
-	size_t* size = NULL;
-	wStream*** array = NULL;
+	return (wStreamPoolEntry*)s;
+}
+
+static INLINE size_t StreamPool_Bucket(size_t capacity)
+{
+	size_t bucket = 0;
+
+	while ((capacity >>= 1) != 0)
+		bucket++;
+	return bucket;
+}
 
+static BOOL StreamPool_EnsureUsedCapacity(wStreamPool* pool, size_t count)
+{
 	WINPR_ASSERT(pool);
 
-	cap = (usedOrAvailable) ? &pool->uCapacity : &pool->aCapacity;
-	size = (usedOrAvailable) ? &pool->uSize : &pool->aSize;
-	array = (usedOrAvailable) ? &pool->uArray : &pool->aArray;
-	if (*cap == 0)
-		new_cap = *size + count;
-	else if (*size + count > *cap)
-		new_cap = *cap * 2;
-	else if ((*size + count) < *cap / 3)
-		new_cap = *cap / 2;
-
-	if (new_cap > 0)
-	{
-		wStream** new_arr = NULL;
+	if (pool->uSize + count <= pool->uCapacity)
+		return TRUE;
 
-		if (*cap < *size + count)
-			*cap += count;
+	size_t new_cap = (pool->uCapacity > 0) ? pool->uCapacity * 2 : 32;
+	if (new_cap < pool->uSize + count)
+		new_cap = pool->uSize + count;
 
-		new_arr = (wStream**)realloc(*array, sizeof(wStream*) * new_cap);
-		if (!new_arr)
-			return FALSE;
-		*cap = new_cap;
-		*array = new_arr;
-	}
+	wStreamPoolEntry** new_arr =
+	    (wStreamPoolEntry**)realloc(pool->uArray, sizeof(wStreamPoolEntry*) * new_cap);
+	if (!new_arr)
+		return FALSE;
+	pool->uCapacity = new_cap;
+	pool->uArray = new_arr;
 	return TRUE;
 }
 
@@ -102,83 +119,100 @@ static BOOL StreamPool_EnsureCapacity(wStreamPool* pool, size_t count, BOOL used
  * Methods
  */
 
-static void StreamPool_ShiftUsed(wStreamPool* pool, size_t index, INT64 count)
-{
-	WINPR_ASSERT(pool);
-	if (count > 0)
-	{
-		const size_t pcount = (size_t)count;
-		StreamPool_EnsureCapacity(pool, pcount, TRUE);
-
-		MoveMemory(&pool->uArray[index + pcount], &pool->uArray[index],
-		           (pool->uSize - index) * sizeof(wStream*));
-		pool->uSize += pcount;
-	}
-	else if (count < 0)
-	{
-		const size_t pcount = (size_t)-count;
-		const size_t off = index + pcount;
-		if (pool->uSize > off)
-		{
-			MoveMemory(&pool->uArray[index], &pool->uArray[index + pcount],
-			           (pool->uSize - index - pcount) * sizeof(wStream*));
-		}
-
-		pool->uSize -= pcount;
-	}
-}
-
 /**
  * Adds a used stream to the pool.
  */
 
-static void StreamPool_AddUsed(wStreamPool* pool, wStream* s)
+static BOOL StreamPool_AddUsed(wStreamPool* pool, wStreamPoolEntry* entry)
 {
-	StreamPool_EnsureCapacity(pool, 1, TRUE);
-	pool->uArray[(pool->uSize)++] = s;
+	if (!StreamPool_EnsureUsedCapacity(pool, 1))
+		return FALSE;
+
+	entry->used = TRUE;
+	entry->usedIndex = pool->uSize;
+	pool->uArray[(pool->uSize)++] = entry;
+	return TRUE;
 }
 
 /**
- * Removes a used stream from the pool.
+ * Removes a used stream from the pool, the last used stream takes its slot.
  */
 
-static void StreamPool_RemoveUsed(wStreamPool* pool, wStream* s)
+static void StreamPool_RemoveUsed(wStreamPool* pool, wStreamPoolEntry* entry)
 {
 	WINPR_ASSERT(pool);
-	for (size_t index = 0; index < pool->uSize; index++)
+	WINPR_ASSERT(entry);
+	WINPR_ASSERT(entry->used);
+	WINPR_ASSERT(entry->usedIndex < pool->uSize);
+	WINPR_ASSERT(pool->uArray[entry->usedIndex] == entry);
+
+	wStreamPoolEntry* last = pool->uArray[--pool->uSize];
+	pool->uArray[entry->usedIndex] = last;
+	last->usedIndex = entry->usedIndex;
+	entry->used = FALSE;
+}
+
+static void StreamPool_PushAvailable(wStreamPool* pool, wStreamPoolEntry* entry)
+{
+	const size_t bucket = StreamPool_Bucket(Stream_Capacity(&entry->s));
+
+	entry->next = pool->buckets[bucket];
+	pool->buckets[bucket] = entry;
+	pool->aSize++;
+}
+
+static wStreamPoolEntry* StreamPool_PopAvailable(wStreamPool* pool, size_t size)
+{
+	size_t bucket = StreamPool_Bucket(size);
+	wStreamPoolEntry* entry = pool->buckets[bucket];
+
+	/* streams in the bucket of size itself may still be too small */
+	if (!entry || (Stream_Capacity(&entry->s) < size))
 	{
-		if (pool->uArray[index] == s)
+		entry = NULL;
+		for (bucket++; bucket < STREAMPOOL_BUCKETS; bucket++)
 		{
-			StreamPool_ShiftUsed(pool, index, -1);
-			break;
+			entry = pool->buckets[bucket];
+			if (entry)
+				break;
 		}
 	}
+
+	if (entry)
+	{
+		pool->buckets[bucket] = entry->next;
+		entry->next = NULL;
+		pool->aSize--;
+	}
+	return entry;
 }
 
-static void StreamPool_ShiftAvailable(wStreamPool* pool, size_t index, INT64 count)
+static wStreamPoolEntry* StreamPool_NewEntry(size_t size)
 {
-	WINPR_ASSERT(pool);
-	if (count > 0)
+	/* round up to the bucket size so the stream fits every later request of its class */
+	size_t capacity = size;
+	if (capacity <= (SIZE_MAX / 2))
 	{
-		const size_t pcount = (size_t)count;
-
-		StreamPool_EnsureCapacity(pool, pcount, FALSE);
-		MoveMemory(&pool->aArray[index + pcount], &pool->aArray[index],
-		           (pool->aSize - index) * sizeof(wStream*));
-		pool->aSize += pcount;
+		capacity = 1;
+		while (capacity < size)
+			capacity <<= 1;
 	}
-	else if (count < 0)
-	{
-		const size_t pcount = (size_t)-count;
-		const size_t off = index + pcount;
-		if (pool->aSize > off)
-		{
-			MoveMemory(&pool->aArray[index], &pool->aArray[index + pcount],
-			           (pool->aSize - index - pcount) * sizeof(wStream*));
-		}
 
-		pool->aSize -= pcount;
+	wStreamPoolEntry* entry = (wStreamPoolEntry*)calloc(1, sizeof(wStreamPoolEntry));
+	if (!entry)
+		return NULL;
+
+	BYTE* buffer = (BYTE*)malloc(capacity);
+	if (!buffer)
+	{
+		free(entry);
+		return NULL;
 	}
+
+	Stream_StaticInit(&entry->s, buffer, capacity);
+	entry->s.isAllocatedStream = TRUE;
+	entry->s.isOwner = TRUE;
+	return entry;
 }
 
 /**
@@ -187,49 +221,41 @@ static void StreamPool_ShiftAvailable(wStreamPool* pool, size_t index, INT64 cou
 
 wStream* StreamPool_Take(wStreamPool* pool, size_t size)
 {
-	SSIZE_T foundIndex = -1;
-	wStream* s = NULL;
+	wStreamPoolEntry* entry = NULL;
 
 	StreamPool_Lock(pool);
 
 	if (size == 0)
 		size = pool->defaultSize;
 
-	for (size_t index = 0; index < pool->aSize; index++)
-	{
-		s = pool->aArray[index];
-
-		if (Stream_Capacity(s) >= size)
-		{
-			foundIndex = index;
-			break;
-		}
-	}
+	entry = StreamPool_PopAvailable(pool, size);
 
-	if (foundIndex < 0)
+	if (!entry)
 	{
-		s = Stream_New(NULL, size);
-		if (!s)
+		entry = StreamPool_NewEntry(size);
+		if (!entry)
 			goto out_fail;
 	}
-	else if (s)
+	else
 	{
-		Stream_SetPosition(s, 0);
-		Stream_SetLength(s, Stream_Capacity(s));
-		StreamPool_ShiftAvailable(pool, foundIndex, -1);
+		Stream_SetPosition(&entry->s, 0);
+		Stream_SetLength(&entry->s, Stream_Capacity(&entry->s));
 	}
 
-	if (s)
+	if (!StreamPool_AddUsed(pool, entry))
 	{
-		s->pool = pool;
-		s->count = 1;
-		StreamPool_AddUsed(pool, s);
+		StreamPool_PushAvailable(pool, entry);
+		entry = NULL;
+		goto out_fail;
 	}
 
+	entry->s.pool = pool;
+	entry->s.count = 1;
+
 out_fail:
 	StreamPool_Unlock(pool);
 
-	return s;
+	return entry ? &entry->s : NULL;
 }
 
 /**
@@ -238,26 +264,22 @@ out_fail:
 
 static void StreamPool_Remove(wStreamPool* pool, wStream* s)
 {
-	StreamPool_EnsureCapacity(pool, 1, FALSE);
 	Stream_EnsureValidity(s);
-	for (size_t x = 0; x < pool->aSize; x++)
+
+	if (s->pool != pool)
 	{
-		wStream* cs = pool->aArray[x];
-		if (cs == s)
-			return;
+		WLog_WARN(TAG, "stream %p was not taken from pool %p, ignoring", (void*)s, (void*)pool);
+		return;
 	}
-	pool->aArray[(pool->aSize)++] = s;
-	StreamPool_RemoveUsed(pool, s);
-}
 
-static void StreamPool_ReleaseOrReturn(wStreamPool* pool, wStream* s)
-{
-	StreamPool_Lock(pool);
-	if (s->count > 0)
-		s->count--;
-	if (s->count == 0)
-		StreamPool_Remove(pool, s);
-	StreamPool_Unlock(pool);
+	wStreamPoolEntry* entry = StreamPool_Entry(s);
+
+	/* already returned */
+	if (!entry->used)
+		return;
+
+	StreamPool_RemoveUsed(pool, entry);
+	StreamPool_PushAvailable(pool, entry);
 }
 
 void StreamPool_Return(wStreamPool* pool, wStream* s)
@@ -279,11 +301,7 @@ void Stream_AddRef(wStream* s)
 {
 	WINPR_ASSERT(s);
 	if (s->pool)
-	{
-		StreamPool_Lock(s->pool);
-		s->count++;
-		StreamPool_Unlock(s->pool);
-	}
+		InterlockedIncrement((LONG volatile*)&s->count);
 }
 
 /**
@@ -293,8 +311,22 @@ void Stream_AddRef(wStream* s)
 void Stream_Release(wStream* s)
 {
 	WINPR_ASSERT(s);
-	if (s->pool)
-		StreamPool_ReleaseOrReturn(s->pool, s);
+	if (!s->pool)
+		return;
+
+	/* only the last reference touches the pool lock */
+	LONG volatile* count = (LONG volatile*)&s->count;
+	LONG cur = InterlockedCompareExchange(count, 0, 0);
+	while (cur > 0)
+	{
+		const LONG prev = InterlockedCompareExchange(count, cur - 1, cur);
+		if (prev == cur)
+			break;
+		cur = prev;
+	}
+
+	if (cur <= 1)
+		StreamPool_Return(s->pool, s);
 }
 
 /**
@@ -309,7 +341,7 @@ wStream* StreamPool_Find(wStreamPool* pool, const BYTE* ptr)
 
 	for (size_t index = 0; index < pool->uSize; index++)
 	{
-		wStream* cur = pool->uArray[index];
+		wStream* cur = &pool->uArray[index]->s;
 
 		if ((ptr >= Stream_Buffer(cur)) && (ptr < (Stream_Buffer(cur) + Stream_Capacity(cur))))
 		{
@@ -331,16 +363,21 @@ void StreamPool_Clear(wStreamPool* pool)
 {
 	StreamPool_Lock(pool);
 
-	while (pool->aSize > 0)
+	for (size_t x = 0; x < STREAMPOOL_BUCKETS; x++)
 	{
-		wStream* s = pool->aArray[--pool->aSize];
-		Stream_Free(s, s->isAllocatedStream);
+		while (pool->buckets[x])
+		{
+			wStreamPoolEntry* entry = pool->buckets[x];
+			pool->buckets[x] = entry->next;
+			Stream_Free(&entry->s, TRUE);
+		}
 	}
+	pool->aSize = 0;
 
 	while (pool->uSize > 0)
 	{
-		wStream* s = pool->uArray[--pool->uSize];
-		Stream_Free(s, s->isAllocatedStream);
+		wStreamPoolEntry* entry = pool->uArray[--pool->uSize];
+		Stream_Free(&entry->s, TRUE);
 	}
 
 	StreamPool_Unlock(pool);
@@ -361,9 +398,7 @@ wStreamPool* StreamPool_New(BOOL synchronized, size_t defaultSize)
 		pool->synchronized = synchronized;
 		pool->defaultSize = defaultSize;
 
-		if (!StreamPool_EnsureCapacity(pool, 32, FALSE))
-			goto fail;
-		if (!StreamPool_EnsureCapacity(pool, 32, TRUE))
+		if (!StreamPool_EnsureUsedCapacity(pool, 32))
 			goto fail;
 
 		InitializeCriticalSectionAndSpinCount(&pool->lock, 4000);
@@ -386,7 +421,6 @@ void StreamPool_Free(wStreamPool* pool)
 
 		DeleteCriticalSection(&pool->lock);
 
-		free(pool->aArray);
 		free(pool->uArray);
 
 		free(pool);
@@ -400,9 +434,8 @@ char* StreamPool_GetStatistics(wStreamPool* pool, char* buffer, size_t size)
 	if (!buffer || (size < 1))
 		return NULL;
 	(void)_snprintf(buffer, size - 1,
-	                "aSize    =%" PRIuz ", uSize    =%" PRIuz "aCapacity=%" PRIuz
-	                ", uCapacity=%" PRIuz,
-	                pool->aSize, pool->uSize, pool->aCapacity, pool->uCapacity);
+	                "aSize    =%" PRIuz ", uSize    =%" PRIuz ", uCapacity=%" PRIuz, pool->aSize,
+	                pool->uSize, pool->uCapacity);
 	buffer[size - 1] = '\0';
 	return buffer;
 }
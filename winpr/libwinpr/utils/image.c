@@ -268,7 +268,7 @@ fail:
  */
 
 static void* winpr_bitmap_write_buffer(const BYTE* data, size_t size, UINT32 width, UINT32 height,
-                                       UINT32 stride, UINT32 bpp, UINT32* pSize)
+                                       UINT32 stride, UINT32 bpp, BOOL bottomUp, UINT32* pSize)
 {
 	WINPR_ASSERT(data || (size == 0));
 
@@ -291,7 +291,8 @@ static void* winpr_bitmap_write_buffer(const BYTE* data, size_t size, UINT32 wid
 
 	for (size_t y = 0; y < height; y++)
 	{
-		const BYTE* line = &data[stride * y];
+		const size_t row = bottomUp ? (height - y - 1ull) : y;
+		const BYTE* line = &data[stride * row];
 
 		Stream_Write(s, line, stride);
 	}
@@ -322,7 +323,8 @@ int winpr_bitmap_write_ex(const char* filename, const BYTE* data, size_t stride,
 
 	UINT32 bmpsize = 0;
 	const size_t size = stride * 1ull * height;
-	void* bmpdata = winpr_bitmap_write_buffer(data, size, width, height, stride, bpp, &bmpsize);
+	void* bmpdata =
+	    winpr_bitmap_write_buffer(data, size, width, height, stride, bpp, FALSE, &bmpsize);
 	if (!bmpdata)
 		goto fail;
 
@@ -595,7 +597,7 @@ void winpr_image_free(wImage* image, BOOL bFreeBuffer)
 }
 
 static void* winpr_convert_to_jpeg(const void* data, size_t size, UINT32 width, UINT32 height,
-                                   UINT32 stride, UINT32 bpp, UINT32* pSize)
+                                   UINT32 stride, UINT32 bpp, BOOL bottomUp, UINT32* pSize)
 {
 	WINPR_ASSERT(data || (size == 0));
 	WINPR_ASSERT(pSize);
@@ -609,12 +611,10 @@ static void* winpr_convert_to_jpeg(const void* data, size_t size, UINT32 width,
 	unsigned long outsize = 0;
 	struct jpeg_compress_struct cinfo = { 0 };
 
-	const size_t expect1 = 1ull * stride * height;
 	const size_t bytes = (bpp + 7) / 8;
-	const size_t expect2 = 1ull * width * height * bytes;
-	if (expect1 != expect2)
+	if ((height == 0) || (stride < 1ull * width * bytes))
 		return NULL;
-	if (expect1 > size)
+	if (1ull * stride * (height - 1) + 1ull * width * bytes > size)
 		return NULL;
 
 	/* Set up the error handler. */
@@ -640,7 +640,8 @@ static void* winpr_convert_to_jpeg(const void* data, size_t size, UINT32 width,
 	const JSAMPLE* cdata = data;
 	for (size_t x = 0; x < height; x++)
 	{
-		const JDIMENSION offset = x * stride;
+		const size_t row = bottomUp ? (height - x - 1ull) : x;
+		const size_t offset = row * stride;
 
 		/* libjpeg is not const correct, we must cast here to avoid issues
 		 * with newer C compilers type check errors */
@@ -795,6 +796,7 @@ struct png_mem_encode
 {
 	char* buffer;
 	size_t size;
+	size_t capacity;
 };
 
 static void png_write_data(png_structp png_ptr, png_bytep data, png_size_t length)
@@ -804,14 +806,21 @@ static void png_write_data(png_structp png_ptr, png_bytep data, png_size_t lengt
 	    (struct png_mem_encode*)png_get_io_ptr(png_ptr); /* was png_ptr->io_ptr */
 	size_t nsize = p->size + length;
 
-	/* allocate or grow buffer */
-	if (p->buffer)
-		p->buffer = realloc(p->buffer, nsize);
-	else
-		p->buffer = malloc(nsize);
-
-	if (!p->buffer)
-		png_error(png_ptr, "Write Error");
+	/* grow the buffer geometrically, libpng hands out data in small chunks */
+	if (nsize > p->capacity)
+	{
+		size_t capacity = p->capacity * 2;
+		if (capacity < nsize)
+			capacity = nsize;
+		if (capacity < 4096)
+			capacity = 4096;
+
+		char* tmp = realloc(p->buffer, capacity);
+		if (!tmp)
+			png_error(png_ptr, "Write Error");
+		p->buffer = tmp;
+		p->capacity = capacity;
+	}
 
 	/* copy new bytes to end of buffer */
 	memcpy(p->buffer + p->size, data, length);
@@ -824,24 +833,38 @@ static void png_flush(png_structp png_ptr)
 }
 
 static SSIZE_T save_png_to_buffer(UINT32 bpp, UINT32 width, UINT32 height, const uint8_t* data,
-                                  size_t size, void** pDstData)
+                                  size_t size, UINT32 stride, UINT32 flags, void** pDstData)
 {
 	SSIZE_T rc = -1;
 	png_structp png_ptr = NULL;
 	png_infop info_ptr = NULL;
-	png_byte** row_pointers = NULL;
 	struct png_mem_encode state = { 0 };
 
+	WINPR_ASSERT(pDstData);
 	*pDstData = NULL;
 
 	if (!data || (size == 0))
 		return 0;
 
-	WINPR_ASSERT(pDstData);
+	int colorType = 0;
+	switch (bpp)
+	{
+		case 24:
+			colorType = PNG_COLOR_TYPE_RGB;
+			break;
+		case 32:
+			colorType = PNG_COLOR_TYPE_RGBA;
+			break;
+		default:
+			WLog_WARN(TAG, "unsupported color depth %" PRIu32 " for PNG", bpp);
+			return -1;
+	}
 
-	const size_t bytes_per_pixel = (bpp + 7) / 8;
-	const size_t bytes_per_row = width * bytes_per_pixel;
-	if (size < bytes_per_row * height)
+	const size_t bytes_per_row = 1ull * width * (bpp / 8);
+	if (stride == 0)
+		stride = (UINT32)bytes_per_row;
+	if ((height == 0) || (stride < bytes_per_row) ||
+	    (size < 1ull * stride * (height - 1) + bytes_per_row))
 		goto fail;
 
 	/* Initialize the write struct. */
@@ -859,48 +882,32 @@ static SSIZE_T save_png_to_buffer(UINT32 bpp, UINT32 width, UINT32 height, const
 		goto fail;
 
 	/* Set image attributes. */
-	int colorType = PNG_COLOR_TYPE_PALETTE;
-	if (bpp > 8)
-		colorType = PNG_COLOR_TYPE_RGB;
-	if (bpp > 16)
-		colorType = PNG_COLOR_TYPE_RGB;
-	if (bpp > 24)
-		colorType = PNG_COLOR_TYPE_RGBA;
-
 	png_set_IHDR(png_ptr, info_ptr, width, height, 8, colorType, PNG_INTERLACE_NONE,
 	             PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
-	/* Initialize rows of PNG. */
-	row_pointers = png_malloc(png_ptr, height * sizeof(png_byte*));
-	for (size_t y = 0; y < height; ++y)
+	if (flags & WINPR_IMAGE_WRITE_FAST)
 	{
-		uint8_t* row = png_malloc(png_ptr, sizeof(uint8_t) * bytes_per_row);
-		row_pointers[y] = (png_byte*)row;
-		for (size_t x = 0; x < width; ++x)
-		{
-
-			*row++ = *data++;
-			if (bpp > 8)
-				*row++ = *data++;
-			if (bpp > 16)
-				*row++ = *data++;
-			if (bpp > 24)
-				*row++ = *data++;
-		}
+		/* screen content does well with the sub filter alone, skip the adaptive filter search
+		 * and most of the deflate effort */
+		png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+		png_set_compression_level(png_ptr, 1);
 	}
 
-	/* Actually write the image data. */
 	png_set_write_fn(png_ptr, &state, png_write_data, png_flush);
-	png_set_rows(png_ptr, info_ptr, row_pointers);
-	png_write_png(png_ptr, info_ptr, PNG_TRANSFORM_BGR, NULL);
+	png_write_info(png_ptr, info_ptr);
+	png_set_bgr(png_ptr);
 
-	/* Cleanup. */
+	/* Stream the lines straight from the source, there is no intermediate copy. */
 	for (size_t y = 0; y < height; y++)
-		png_free(png_ptr, row_pointers[y]);
-	png_free(png_ptr, row_pointers);
+	{
+		const size_t row = (flags & WINPR_IMAGE_WRITE_BOTTOM_UP) ? (height - y - 1ull) : y;
+		png_write_row(png_ptr, &data[row * stride]);
+	}
+
+	png_write_end(png_ptr, info_ptr);
 
 	/* Finish writing. */
-	rc = state.size;
+	rc = (SSIZE_T)state.size;
 	*pDstData = state.buffer;
 fail:
 	png_destroy_write_struct(&png_ptr, &info_ptr);
@@ -931,15 +938,15 @@ static void read_data_memory(png_structp png_ptr, png_bytep data, size_t length)
 static void* winpr_read_png_from_buffer(const void* data, size_t SrcSize, size_t* pSize,
                                         UINT32* pWidth, UINT32* pHeight, UINT32* pBpp)
 {
-	void* rc = NULL;
+	/* modified after setjmp, must survive a longjmp */
+	BYTE* volatile rc = NULL;
+	png_bytepp volatile row_pointers = NULL;
 	png_uint_32 width = 0;
 	png_uint_32 height = 0;
 	int bit_depth = 0;
 	int color_type = 0;
 	int interlace_type = 0;
-	int transforms = PNG_TRANSFORM_IDENTITY;
 	MEMORY_READER_STATE memory_reader_state = { 0 };
-	png_bytepp row_pointers = NULL;
 	png_infop info_ptr = NULL;
 	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (!png_ptr)
@@ -948,14 +955,19 @@ static void* winpr_read_png_from_buffer(const void* data, size_t SrcSize, size_t
 	if (!info_ptr)
 		goto fail;
 
+	if (setjmp(png_jmpbuf(png_ptr)))
+		goto fail;
+
 	memory_reader_state.buffer = WINPR_CAST_CONST_PTR_AWAY(data, png_bytep);
 	memory_reader_state.bufsize = SrcSize;
 	memory_reader_state.current_pos = 0;
 
 	png_set_read_fn(png_ptr, &memory_reader_state, read_data_memory);
 
-	transforms |= PNG_TRANSFORM_BGR;
-	png_read_png(png_ptr, info_ptr, transforms, NULL);
+	png_read_info(png_ptr, info_ptr);
+	png_set_bgr(png_ptr);
+	(void)png_set_interlace_handling(png_ptr);
+	png_read_update_info(png_ptr, info_ptr);
 
 	if (png_get_IHDR(png_ptr, info_ptr, &width, &height, &bit_depth, &color_type, &interlace_type,
 	                 NULL, NULL) != 1)
@@ -964,39 +976,42 @@ static void* winpr_read_png_from_buffer(const void* data, size_t SrcSize, size_t
 	WINPR_ASSERT(bit_depth >= 0);
 	const png_byte channelcount = png_get_channels(png_ptr, info_ptr);
 	const size_t bpp = channelcount * (size_t)bit_depth;
+	const size_t stride = png_get_rowbytes(png_ptr, info_ptr);
+	if ((height == 0) || (stride == 0) || (height > SIZE_MAX / stride))
+		goto fail;
 
-	row_pointers = png_get_rows(png_ptr, info_ptr);
-	if (row_pointers)
-	{
-		const size_t stride = 1ULL * width * bpp / 8ull;
-		const size_t png_stride = png_get_rowbytes(png_ptr, info_ptr);
-		const size_t size = 1ULL * width * height * bpp / 8ull;
-		const size_t copybytes = stride > png_stride ? png_stride : stride;
+	/* Decode the lines directly into the result buffer. */
+	const size_t size = stride * height;
+	rc = malloc(size);
+	row_pointers = calloc(height, sizeof(png_bytep));
+	if (!rc || !row_pointers)
+		goto fail;
 
-		rc = malloc(size);
-		if (rc)
-		{
-			char* cur = rc;
-			for (int i = 0; i < height; i++)
-			{
-				memcpy(cur, row_pointers[i], copybytes);
-				cur += stride;
-			}
-			*pSize = size;
-			*pWidth = width;
-			*pHeight = height;
-			*pBpp = bpp;
-		}
-	}
-fail:
+	for (size_t y = 0; y < height; y++)
+		row_pointers[y] = &rc[y * stride];
 
+	png_read_image(png_ptr, row_pointers);
+	png_read_end(png_ptr, NULL);
+
+	free(row_pointers);
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+
+	*pSize = size;
+	*pWidth = width;
+	*pHeight = height;
+	*pBpp = (UINT32)bpp;
 	return rc;
+
+fail:
+	free(row_pointers);
+	free(rc);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	return NULL;
 }
 #endif
 
 static void* winpr_convert_to_png(const void* data, size_t size, UINT32 width, UINT32 height,
-                                  UINT32 stride, UINT32 bpp, UINT32* pSize)
+                                  UINT32 stride, UINT32 bpp, UINT32 flags, UINT32* pSize)
 {
 	WINPR_ASSERT(data || (size == 0));
 	WINPR_ASSERT(pSize);
@@ -1005,7 +1020,7 @@ static void* winpr_convert_to_png(const void* data, size_t size, UINT32 width, U
 
 #if defined(WINPR_UTILS_IMAGE_PNG)
 	void* dst = NULL;
-	SSIZE_T rc = save_png_to_buffer(bpp, width, height, data, size, &dst);
+	SSIZE_T rc = save_png_to_buffer(bpp, width, height, data, size, stride, flags, &dst);
 	if (rc <= 0)
 		return NULL;
 	*pSize = (UINT32)rc;
@@ -1016,6 +1031,9 @@ static void* winpr_convert_to_png(const void* data, size_t size, UINT32 width, U
 		size_t dstsize = 0;
 		unsigned rc = 1;
 
+		WINPR_UNUSED(stride);
+		WINPR_UNUSED(flags);
+
 		switch (bpp)
 		{
 			case 32:
@@ -1237,49 +1255,80 @@ const char* winpr_image_format_extension(UINT32 format)
 	}
 }
 
+/* a top down copy of a bottom up image for encoders that can not walk the lines backwards */
+static BYTE* winpr_image_flip_copy(const BYTE* data, size_t stride, size_t height)
+{
+	if ((height == 0) || (height > SIZE_MAX / stride))
+		return NULL;
+
+	BYTE* copy = malloc(stride * height);
+	if (!copy)
+		return NULL;
+
+	for (size_t y = 0; y < height; y++)
+		memcpy(&copy[y * stride], &data[(height - y - 1) * stride], stride);
+	return copy;
+}
+
 void* winpr_image_write_buffer(wImage* image, UINT32 format, size_t* psize)
+{
+	return winpr_image_write_buffer_ex(image, format, WINPR_IMAGE_WRITE_NO_FLAGS, psize);
+}
+
+void* winpr_image_write_buffer_ex(wImage* image, UINT32 format, UINT32 flags, size_t* psize)
 {
 	WINPR_ASSERT(image);
+	WINPR_ASSERT(psize);
+
+	void* data = NULL;
+	BYTE* flipped = NULL;
+	UINT32 outsize = 0;
+	const BYTE* src = image->data;
+	const size_t size = 1ull * image->height * image->scanline;
+	const BOOL bottomUp = (flags & WINPR_IMAGE_WRITE_BOTTOM_UP) != 0;
+
 	switch (format)
 	{
 		case WINPR_IMAGE_BITMAP:
-		{
-			UINT32 outsize = 0;
-			size_t size = 1ull * image->height * image->scanline;
-			void* data = winpr_bitmap_write_buffer(image->data, size, image->width, image->height,
-			                                       image->scanline, image->bitsPerPixel, &outsize);
-			*psize = outsize;
-			return data;
-		}
+			data = winpr_bitmap_write_buffer(src, size, image->width, image->height,
+			                                 image->scanline, image->bitsPerPixel, bottomUp,
+			                                 &outsize);
+			break;
 		case WINPR_IMAGE_WEBP:
-		{
-			UINT32 outsize = 0;
-			size_t size = 1ull * image->height * image->scanline;
-			void* data = winpr_convert_to_webp(image->data, size, image->width, image->height,
-			                                   image->scanline, image->bitsPerPixel, &outsize);
-			*psize = outsize;
-			return data;
-		}
+			if (bottomUp)
+			{
+				flipped = winpr_image_flip_copy(src, image->scanline, image->height);
+				if (!flipped)
+					break;
+				src = flipped;
+			}
+			data = winpr_convert_to_webp(src, size, image->width, image->height, image->scanline,
+			                             image->bitsPerPixel, &outsize);
+			break;
 		case WINPR_IMAGE_JPEG:
-		{
-			UINT32 outsize = 0;
-			size_t size = 1ull * image->height * image->scanline;
-			void* data = winpr_convert_to_jpeg(image->data, size, image->width, image->height,
-			                                   image->scanline, image->bitsPerPixel, &outsize);
-			*psize = outsize;
-			return data;
-		}
+			data = winpr_convert_to_jpeg(src, size, image->width, image->height, image->scanline,
+			                             image->bitsPerPixel, bottomUp, &outsize);
+			break;
 		case WINPR_IMAGE_PNG:
-		{
-			UINT32 outsize = 0;
-			size_t size = 1ull * image->height * image->scanline;
-			void* data = winpr_convert_to_png(image->data, size, image->width, image->height,
-			                                  image->scanline, image->bitsPerPixel, &outsize);
-			*psize = outsize;
-			return data;
-		}
+#if !defined(WINPR_UTILS_IMAGE_PNG)
+			/* lodepng only takes top down lines */
+			if (bottomUp)
+			{
+				flipped = winpr_image_flip_copy(src, image->scanline, image->height);
+				if (!flipped)
+					break;
+				src = flipped;
+				flags &= ~(UINT32)WINPR_IMAGE_WRITE_BOTTOM_UP;
+			}
+#endif
+			data = winpr_convert_to_png(src, size, image->width, image->height, image->scanline,
+			                            image->bitsPerPixel, flags, &outsize);
+			break;
 		default:
-			*psize = 0;
-			return NULL;
+			break;
 	}
+
+	free(flipped);
+	*psize = outsize;
+	return data;
 }
@@ -431,6 +431,58 @@ out:
 	return retCode;
 }
 
+static int test_hash_table_grow(void)
+{
+	int rc = -1;
+	const size_t count = 10000;
+	wHashTable* table = HashTable_New(FALSE);
+
+	if (!table)
+		return -1;
+
+	/* enough entries to resize the table several times */
+	for (size_t x = 1; x <= count; x++)
+	{
+		if (!HashTable_Insert(table, (void*)x, (void*)(x + 1)))
+			goto fail;
+	}
+
+	if (HashTable_Count(table) != count)
+		goto fail;
+
+	/* remove every other entry, the remaining ones must still be found */
+	for (size_t x = 1; x <= count; x += 2)
+	{
+		if (!HashTable_Remove(table, (void*)x))
+			goto fail;
+	}
+
+	if (HashTable_Count(table) != count / 2)
+		goto fail;
+
+	for (size_t x = 1; x <= count; x++)
+	{
+		void* value = HashTable_GetItemValue(table, (void*)x);
+
+		if ((x % 2) == 0)
+		{
+			if (value != (void*)(x + 1))
+				goto fail;
+		}
+		else if (value || HashTable_Remove(table, (void*)x))
+			goto fail;
+	}
+
+	HashTable_Clear(table);
+	if ((HashTable_Count(table) != 0) || HashTable_Contains(table, (void*)2))
+		goto fail;
+
+	rc = 0;
+fail:
+	HashTable_Free(table);
+	return rc;
+}
+
 int TestHashTable(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -444,5 +496,8 @@ int TestHashTable(int argc, char* argv[])
 
 	if (test_hash_foreach() < 0)
 		return 3;
+
+	if (test_hash_table_grow() < 0)
+		return 4;
 	return 0;
 }
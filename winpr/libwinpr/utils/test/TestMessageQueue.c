@@ -3,10 +3,14 @@
 #include <winpr/thread.h>
 #include <winpr/collections.h>
 
+/* spans several blocks of a single consumer queue */
+#define TEST_MESSAGE_COUNT 1000
+
 static DWORD WINAPI message_queue_consumer_thread(LPVOID arg)
 {
 	wMessage message = { 0 };
 	wMessageQueue* queue = (wMessageQueue*)arg;
+	UINT32 expected = 0;
 
 	while (MessageQueue_Wait(queue))
 	{
@@ -15,42 +19,70 @@ static DWORD WINAPI message_queue_consumer_thread(LPVOID arg)
 			if (message.id == WMQ_QUIT)
 				break;
 
-			printf("Message.Type: %" PRIu32 "\n", message.id);
+			if (message.id != expected++)
+			{
+				printf("Message.Type: %" PRIu32 ", expected %" PRIu32 "\n", message.id,
+				       expected - 1);
+				return 1;
+			}
 		}
 	}
 
-	return 0;
+	return (expected == TEST_MESSAGE_COUNT) ? 0 : 1;
 }
 
-int TestMessageQueue(int argc, char* argv[])
+static BOOL test_message_queue(UINT32 flags)
 {
+	BOOL rc = FALSE;
+	DWORD status = 1;
 	HANDLE thread = NULL;
 	wMessageQueue* queue = NULL;
 
-	WINPR_UNUSED(argc);
-	WINPR_UNUSED(argv);
-
-	if (!(queue = MessageQueue_New(NULL)))
+	if (!(queue = MessageQueue_NewEx(NULL, flags)))
 	{
 		printf("failed to create message queue\n");
-		return 1;
+		return FALSE;
 	}
 
 	if (!(thread = CreateThread(NULL, 0, message_queue_consumer_thread, (void*)queue, 0, NULL)))
 	{
 		printf("failed to create thread\n");
-		MessageQueue_Free(queue);
-		return 1;
+		goto fail;
 	}
 
-	if (!MessageQueue_Post(queue, NULL, 123, NULL, NULL) ||
-	    !MessageQueue_Post(queue, NULL, 456, NULL, NULL) ||
-	    !MessageQueue_Post(queue, NULL, 789, NULL, NULL) || !MessageQueue_PostQuit(queue, 0) ||
-	    WaitForSingleObject(thread, INFINITE) != WAIT_OBJECT_0)
-		return -1;
+	for (UINT32 x = 0; x < TEST_MESSAGE_COUNT; x++)
+	{
+		if (!MessageQueue_Post(queue, NULL, x, NULL, NULL))
+			goto fail;
+	}
 
+	if (!MessageQueue_PostQuit(queue, 0) || WaitForSingleObject(thread, INFINITE) != WAIT_OBJECT_0)
+		goto fail;
+
+	if (!GetExitCodeThread(thread, &status) || (status != 0))
+	{
+		printf("message queue [0x%08" PRIx32 "] lost or reordered messages\n", flags);
+		goto fail;
+	}
+
+	rc = TRUE;
+fail:
 	MessageQueue_Free(queue);
-	(void)CloseHandle(thread);
+	if (thread)
+		(void)CloseHandle(thread);
+	return rc;
+}
+
+int TestMessageQueue(int argc, char* argv[])
+{
+	WINPR_UNUSED(argc);
+	WINPR_UNUSED(argv);
+
+	if (!test_message_queue(0))
+		return -1;
+
+	if (!test_message_queue(WMQ_FLAG_SINGLE_CONSUMER))
+		return -1;
 
 	return 0;
 }
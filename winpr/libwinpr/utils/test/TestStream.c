@@ -643,6 +643,33 @@ out:
 	return rc;
 }
 
+static BOOL TestStream_ReadBulk(void)
+{
+	const BYTE src[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	                     0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e };
+	UINT16 u16[2] = { 0 };
+	UINT32 u32[2] = { 0 };
+	wStream sbuffer = { 0 };
+	wStream* s = Stream_StaticConstInit(&sbuffer, src, sizeof(src));
+
+	if (!s)
+		return FALSE;
+
+	const BYTE* span = Stream_ReadSpan(s, 2);
+	if ((span != src) || (Stream_GetPosition(s) != 2))
+		return FALSE;
+
+	Stream_ReadArray_UINT16(s, u16, ARRAYSIZE(u16));
+	if ((u16[0] != 0x0403) || (u16[1] != 0x0605) || (Stream_GetPosition(s) != 6))
+		return FALSE;
+
+	Stream_ReadArray_UINT32(s, u32, ARRAYSIZE(u32));
+	if ((u32[0] != 0x0a090807) || (u32[1] != 0x0e0d0c0b))
+		return FALSE;
+
+	return Stream_GetRemainingLength(s) == 0;
+}
+
 int TestStream(int argc, char* argv[])
 {
 	WINPR_UNUSED(argc);
@@ -684,5 +711,8 @@ int TestStream(int argc, char* argv[])
 	if (!TestStream_Static())
 		return 12;
 
+	if (!TestStream_ReadBulk())
+		return 13;
+
 	return 0;
 }
@@ -55,6 +55,21 @@ int TestWLog(int argc, char* argv[])
 	WLog_Print(logB, WLOG_ERROR, "we've got an error");
 	WLog_Print(logB, WLOG_TRACE, "leaving a trace behind");
 
+	/* cached levels must follow changes of the logger and its parents */
+	if (WLog_IsLevelActive(logA, WLOG_DEBUG) || !WLog_IsLevelActive(logA, WLOG_INFO))
+		goto out;
+	WLog_SetLogLevel(logA, WLOG_DEBUG);
+	if (!WLog_IsLevelActive(logA, WLOG_DEBUG))
+		goto out;
+	WLog_SetLogLevel(logA, WLOG_LEVEL_INHERIT);
+	WLog_SetLogLevel(root, WLOG_ERROR);
+	if (WLog_IsLevelActive(logA, WLOG_WARN) || (WLog_GetLogLevel(logA) != WLOG_ERROR))
+		goto out;
+	if (!WLog_AddStringLogFilters("com.test.ChannelA:TRACE"))
+		goto out;
+	if (!WLog_IsLevelActive(logA, WLOG_TRACE) || WLog_IsLevelActive(logB, WLOG_WARN))
+		goto out;
+
 	WLog_CloseAppender(root);
 
 	if ((wlog_file = GetCombinedPath(tmp_path, "test_w.log")))
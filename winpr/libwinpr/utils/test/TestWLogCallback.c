@@ -30,6 +30,8 @@ static BOOL check(const wLogMessage* msg)
 	BOOL rc = TRUE;
 	if (!msg)
 		rc = FALSE;
+	else if ((pos < 0) || ((size_t)pos >= ARRAYSIZE(messages)))
+		rc = FALSE;
 	else if (strcmp(msg->FileName, __FILE__) != 0)
 		rc = FALSE;
 	else if (strcmp(msg->FunctionName, function) != 0)
@@ -74,6 +76,19 @@ static BOOL CallbackAppenderPackage(const wLogMessage* msg)
 	return TRUE;
 }
 
+static void print_messages(wLog* logA, wLog* logB)
+{
+	function = __func__;
+	WLog_Print(logA, messages[0].level, messages[0].msg);
+	WLog_Print(logB, messages[1].level, messages[1].msg);
+	WLog_Print(logA, messages[2].level, messages[2].msg, 2, "test");
+	WLog_Print(logB, messages[3].level, messages[3].msg, 2, "time");
+	WLog_Print(logA, messages[4].level, messages[4].msg);
+	WLog_Print(logB, messages[5].level, messages[5].msg);
+	WLog_Print(logA, messages[6].level, messages[6].msg);
+	WLog_Print(logB, messages[7].level, messages[7].msg);
+}
+
 int TestWLogCallback(int argc, char* argv[])
 {
 	wLog* root = NULL;
@@ -86,8 +101,6 @@ int TestWLogCallback(int argc, char* argv[])
 	WINPR_UNUSED(argc);
 	WINPR_UNUSED(argv);
 
-	function = __func__;
-
 	root = WLog_GetRoot();
 
 	WLog_SetLogAppenderType(root, WLOG_APPENDER_CALLBACK);
@@ -113,14 +126,24 @@ int TestWLogCallback(int argc, char* argv[])
 	WLog_SetLogLevel(logA, WLOG_TRACE);
 	WLog_SetLogLevel(logB, WLOG_TRACE);
 
-	WLog_Print(logA, messages[0].level, messages[0].msg);
-	WLog_Print(logB, messages[1].level, messages[1].msg);
-	WLog_Print(logA, messages[2].level, messages[2].msg, 2, "test");
-	WLog_Print(logB, messages[3].level, messages[3].msg, 2, "time");
-	WLog_Print(logA, messages[4].level, messages[4].msg);
-	WLog_Print(logB, messages[5].level, messages[5].msg);
-	WLog_Print(logA, messages[6].level, messages[6].msg);
-	WLog_Print(logB, messages[7].level, messages[7].msg);
+	print_messages(logA, logB);
+
+	/* same messages through the async queue, disabling it flushes */
+	pos = 0;
+	if (!WLog_SetLogAppenderAsync(root, TRUE))
+		return -1;
+
+	print_messages(logA, logB);
+
+	if (!WLog_SetLogAppenderAsync(root, FALSE))
+		return -1;
+
+	if (pos != ARRAYSIZE(messages))
+	{
+		(void)fprintf(stderr, "async queue delivered %d of %" PRIuz " messages\n", pos,
+		              ARRAYSIZE(messages));
+		success = FALSE;
+	}
 
 	WLog_CloseAppender(root);
 
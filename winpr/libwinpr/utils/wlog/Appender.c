@@ -19,6 +19,9 @@
 
 #include <winpr/config.h>
 
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+
 #include "Appender.h"
 
 void WLog_Appender_Free(wLog* log, wLogAppender* appender)
@@ -26,6 +29,10 @@ void WLog_Appender_Free(wLog* log, wLogAppender* appender)
 	if (!appender)
 		return;
 
+	/* flushes the queue, needs the layout and lock still in place */
+	WLog_Async_Free(appender->async);
+	appender->async = NULL;
+
 	if (appender->Layout)
 	{
 		WLog_Layout_Free(log, appender->Layout);
@@ -36,6 +43,20 @@ void WLog_Appender_Free(wLog* log, wLogAppender* appender)
 	appender->Free(appender);
 }
 
+BOOL WLog_Appender_GetMessagePrefix(wLog* log, wLogAppender* appender, wLogMessage* message)
+{
+	WINPR_ASSERT(appender);
+	WINPR_ASSERT(message);
+
+	if (appender->PresetPrefix)
+	{
+		(void)_snprintf(message->PrefixString, WLOG_MAX_PREFIX_SIZE, "%s", appender->PresetPrefix);
+		return TRUE;
+	}
+
+	return WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+}
+
 wLogAppender* WLog_GetLogAppender(wLog* log)
 {
 	if (!log)
@@ -164,6 +185,31 @@ BOOL WLog_SetLogAppenderType(wLog* log, DWORD logAppenderType)
 	return log->Appender != NULL;
 }
 
+BOOL WLog_SetLogAppenderAsync(wLog* log, BOOL async)
+{
+	/* the queue reports to the logger owning the appender */
+	while (log && !log->Appender)
+		log = log->Parent;
+
+	if (!log)
+		return FALSE;
+
+	wLogAppender* appender = log->Appender;
+
+	if (!async)
+	{
+		WLog_Async_Free(appender->async);
+		appender->async = NULL;
+		return TRUE;
+	}
+
+	if (appender->async)
+		return TRUE;
+
+	appender->async = WLog_Async_New(log, appender, WLOG_ASYNC_DEFAULT_SLOTS);
+	return appender->async != NULL;
+}
+
 BOOL WLog_ConfigureAppender(wLogAppender* appender, const char* setting, void* value)
 {
 	/* Just check the settings string is not empty */
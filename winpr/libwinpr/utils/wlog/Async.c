@@ -0,0 +1,353 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * WinPR Logger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <winpr/config.h>
+
+#include <winpr/crt.h>
+#include <winpr/assert.h>
+#include <winpr/synch.h>
+#include <winpr/thread.h>
+#include <winpr/interlocked.h>
+
+#include "Async.h"
+
+/* records up to this size are stored inline, longer ones are copied to the heap */
+#define WLOG_ASYNC_INLINE_SIZE 512
+
+/* the writer thread polls at least this often, in ms */
+#define WLOG_ASYNC_POLL_INTERVAL 100
+
+enum
+{
+	WLOG_ASYNC_STOPPED,
+	WLOG_ASYNC_STARTING,
+	WLOG_ASYNC_RUNNING,
+	WLOG_ASYNC_STOPPING
+};
+
+/**
+ * A queue slot. sequence equals the enqueue position while the slot is free
+ * and position + 1 once a producer published a record in it.
+ */
+typedef struct
+{
+	LONG volatile sequence;
+
+	wLog* log;
+	DWORD level;
+	size_t line;
+
+	/* prefix, text, format, file and function, each '\0' terminated */
+	char* data;
+	size_t textOffset;
+	size_t formatOffset;
+	size_t fileOffset;
+	size_t functionOffset;
+	char inlineData[WLOG_ASYNC_INLINE_SIZE];
+} wLogAsyncRecord;
+
+struct s_wLogAsync
+{
+	wLog* log;
+	wLogAppender* appender;
+
+	wLogAsyncRecord* records;
+	ULONG mask;
+
+	LONG volatile tail;
+	ULONG head;
+
+	LONG volatile state;
+	LONG volatile sleeping;
+	LONG volatile dropped;
+	HANDLE event;
+	HANDLE thread;
+};
+
+static LONG async_load(LONG volatile* value)
+{
+	return InterlockedCompareExchange(value, 0, 0);
+}
+
+static void async_write_record(wLogAsync* async, wLogAsyncRecord* record)
+{
+	wLogAppender* appender = async->appender;
+	wLogMessage message = { 0 };
+
+	message.Type = WLOG_MESSAGE_TEXT;
+	message.Level = record->level;
+	message.LineNumber = record->line;
+	message.TextString = &record->data[record->textOffset];
+	message.FormatString = &record->data[record->formatOffset];
+	message.FileName = &record->data[record->fileOffset];
+	message.FunctionName = &record->data[record->functionOffset];
+
+	EnterCriticalSection(&appender->lock);
+	if (appender->WriteMessage && !appender->recursive)
+	{
+		/* the prefix was rendered by the logging thread, the appender must not redo it */
+		appender->PresetPrefix = record->data;
+		appender->recursive = TRUE;
+		(void)appender->WriteMessage(record->log, appender, &message);
+		appender->recursive = FALSE;
+		appender->PresetPrefix = NULL;
+	}
+	LeaveCriticalSection(&appender->lock);
+}
+
+static void async_report_dropped(wLogAsync* async)
+{
+	wLogAppender* appender = async->appender;
+	const LONG dropped = InterlockedExchange(&async->dropped, 0);
+	char text[64] = { 0 };
+	wLogMessage message = { 0 };
+
+	if (dropped <= 0)
+		return;
+
+	(void)_snprintf(text, sizeof(text), "async log queue full, dropped %" PRId32 " messages",
+	                dropped);
+	message.Type = WLOG_MESSAGE_TEXT;
+	message.Level = WLOG_WARN;
+	message.LineNumber = __LINE__;
+	message.FileName = __FILE__;
+	message.FunctionName = __func__;
+	message.FormatString = text;
+	message.TextString = text;
+
+	EnterCriticalSection(&appender->lock);
+	if (appender->WriteMessage && !appender->recursive)
+	{
+		appender->recursive = TRUE;
+		(void)appender->WriteMessage(async->log, appender, &message);
+		appender->recursive = FALSE;
+	}
+	LeaveCriticalSection(&appender->lock);
+}
+
+/* single consumer, called from the writer thread or after it was stopped */
+static BOOL async_drain(wLogAsync* async)
+{
+	BOOL drained = FALSE;
+
+	while (1)
+	{
+		wLogAsyncRecord* record = &async->records[async->head & async->mask];
+		const LONG sequence = async_load(&record->sequence);
+
+		if ((ULONG)sequence != async->head + 1)
+			break;
+
+		async_write_record(async, record);
+
+		if (record->data != record->inlineData)
+			free(record->data);
+		record->data = NULL;
+
+		(void)InterlockedExchange(&record->sequence, (LONG)(async->head + async->mask + 1));
+		async->head++;
+		drained = TRUE;
+	}
+
+	async_report_dropped(async);
+	return drained;
+}
+
+static DWORD WINAPI async_thread(LPVOID arg)
+{
+	wLogAsync* async = arg;
+
+	WINPR_ASSERT(async);
+
+	while (async_load(&async->state) == WLOG_ASYNC_RUNNING)
+	{
+		if (async_drain(async))
+			continue;
+
+		/* announce the nap and check once more, producers wake us only when we sleep.
+		 * The event is manual reset, a record posted before the reset is seen by the drain */
+		(void)InterlockedExchange(&async->sleeping, 1);
+		(void)ResetEvent(async->event);
+		if (!async_drain(async))
+			(void)WaitForSingleObject(async->event, WLOG_ASYNC_POLL_INTERVAL);
+		(void)InterlockedExchange(&async->sleeping, 0);
+	}
+
+	return 0;
+}
+
+static void async_start(wLogAsync* async)
+{
+	if (InterlockedCompareExchange(&async->state, WLOG_ASYNC_STARTING, WLOG_ASYNC_STOPPED) !=
+	    WLOG_ASYNC_STOPPED)
+		return;
+
+	async->thread = CreateThread(NULL, 0, async_thread, async, CREATE_SUSPENDED, NULL);
+	if (!async->thread)
+	{
+		(void)InterlockedExchange(&async->state, WLOG_ASYNC_STOPPED);
+		return;
+	}
+
+	(void)InterlockedExchange(&async->state, WLOG_ASYNC_RUNNING);
+	(void)ResumeThread(async->thread);
+}
+
+static size_t async_copy(char* dst, const char* src, size_t len)
+{
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+	return len + 1;
+}
+
+BOOL WLog_Async_Post(wLogAsync* async, wLog* log, wLogMessage* message)
+{
+	WINPR_ASSERT(async);
+	WINPR_ASSERT(message);
+	WINPR_ASSERT(message->PrefixString);
+
+	const char* file = message->FileName ? message->FileName : "";
+	const char* function = message->FunctionName ? message->FunctionName : "";
+	const char* text = message->TextString ? message->TextString : "";
+	const char* format = message->FormatString ? message->FormatString : "";
+	size_t prefixLen = strnlen(message->PrefixString, WLOG_MAX_PREFIX_SIZE - 1);
+	size_t textLen = strlen(text);
+	size_t formatLen = (format != text) ? strlen(format) : 0;
+	size_t fileLen = strlen(file);
+	size_t functionLen = strlen(function);
+	const size_t size = prefixLen + textLen + formatLen + fileLen + functionLen + 5;
+
+	if (async_load(&async->state) == WLOG_ASYNC_STOPPED)
+		async_start(async);
+
+	/* claim a slot */
+	wLogAsyncRecord* record = NULL;
+	ULONG pos = (ULONG)async_load(&async->tail);
+	while (1)
+	{
+		record = &async->records[pos & async->mask];
+		const LONG diff = (LONG)((ULONG)async_load(&record->sequence) - pos);
+
+		if (diff == 0)
+		{
+			const ULONG cur =
+			    (ULONG)InterlockedCompareExchange(&async->tail, (LONG)(pos + 1), (LONG)pos);
+			if (cur == pos)
+				break;
+			pos = cur;
+		}
+		else if (diff < 0)
+		{
+			(void)InterlockedIncrement(&async->dropped);
+			return FALSE;
+		}
+		else
+			pos = (ULONG)async_load(&async->tail);
+	}
+
+	record->log = log;
+	record->level = message->Level;
+	record->line = message->LineNumber;
+	record->data = record->inlineData;
+	if (size > sizeof(record->inlineData))
+		record->data = malloc(size);
+
+	if (!record->data)
+	{
+		/* out of memory, keep what fits inline */
+		record->data = record->inlineData;
+		formatLen = fileLen = functionLen = 0;
+		if (prefixLen + 5 > sizeof(record->inlineData))
+			prefixLen = 0;
+		if (prefixLen + textLen + 5 > sizeof(record->inlineData))
+			textLen = sizeof(record->inlineData) - prefixLen - 5;
+	}
+
+	size_t offset = async_copy(record->data, message->PrefixString, prefixLen);
+	record->textOffset = offset;
+	offset += async_copy(&record->data[offset], text, textLen);
+	/* plain messages use the text as format */
+	record->formatOffset = (formatLen > 0) ? offset : record->textOffset;
+	offset += async_copy(&record->data[offset], format, formatLen);
+	record->fileOffset = offset;
+	offset += async_copy(&record->data[offset], file, fileLen);
+	record->functionOffset = offset;
+	(void)async_copy(&record->data[offset], function, functionLen);
+
+	/* publish */
+	(void)InterlockedExchange(&record->sequence, (LONG)(pos + 1));
+
+	if (InterlockedCompareExchange(&async->sleeping, 0, 1) == 1)
+		(void)SetEvent(async->event);
+	return TRUE;
+}
+
+wLogAsync* WLog_Async_New(wLog* log, wLogAppender* appender, size_t slots)
+{
+	WINPR_ASSERT(appender);
+
+	/* the queue size must be a power of two */
+	size_t count = 2;
+	while ((count < slots) && (count < 0x10000))
+		count <<= 1;
+
+	wLogAsync* async = (wLogAsync*)calloc(1, sizeof(wLogAsync));
+	if (!async)
+		return NULL;
+
+	async->log = log;
+	async->appender = appender;
+	async->mask = (ULONG)(count - 1);
+	async->records = (wLogAsyncRecord*)calloc(count, sizeof(wLogAsyncRecord));
+	if (!async->records)
+		goto fail;
+
+	for (size_t x = 0; x < count; x++)
+		async->records[x].sequence = (LONG)x;
+
+	async->event = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!async->event)
+		goto fail;
+
+	return async;
+fail:
+	WLog_Async_Free(async);
+	return NULL;
+}
+
+void WLog_Async_Free(wLogAsync* async)
+{
+	if (!async)
+		return;
+
+	if (async->thread)
+	{
+		(void)InterlockedExchange(&async->state, WLOG_ASYNC_STOPPING);
+		(void)SetEvent(async->event);
+		(void)WaitForSingleObject(async->thread, INFINITE);
+		(void)CloseHandle(async->thread);
+	}
+
+	/* flush whatever is left on the calling thread */
+	if (async->records)
+		(void)async_drain(async);
+
+	if (async->event)
+		(void)CloseHandle(async->event);
+	free(async->records);
+	free(async);
+}
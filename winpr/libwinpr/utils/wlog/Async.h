@@ -0,0 +1,36 @@
+/**
+ * WinPR: Windows Portable Runtime
+ * WinPR Logger
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WINPR_WLOG_ASYNC_PRIVATE_H
+#define WINPR_WLOG_ASYNC_PRIVATE_H
+
+#include "wlog.h"
+
+#define WLOG_ASYNC_DEFAULT_SLOTS 1024
+
+void WLog_Async_Free(wLogAsync* async);
+
+WINPR_ATTR_MALLOC(WLog_Async_Free, 1)
+wLogAsync* WLog_Async_New(wLog* log, wLogAppender* appender, size_t slots);
+
+/**
+ * Queues a formatted text message for the background writer.
+ * Returns FALSE if the queue is full; the message is then counted as dropped.
+ */
+BOOL WLog_Async_Post(wLogAsync* async, wLog* log, wLogMessage* message);
+
+#endif /* WINPR_WLOG_ASYNC_PRIVATE_H */
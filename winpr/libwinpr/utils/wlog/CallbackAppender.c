@@ -48,7 +48,7 @@ static BOOL WLog_CallbackAppender_WriteMessage(wLog* log, wLogAppender* appender
 		return FALSE;
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 
 	callbackAppender = (wLogCallbackAppender*)appender;
 
@@ -68,7 +68,7 @@ static BOOL WLog_CallbackAppender_WriteDataMessage(wLog* log, wLogAppender* appe
 		return FALSE;
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 
 	callbackAppender = (wLogCallbackAppender*)appender;
 	if (callbackAppender->callbacks && callbackAppender->callbacks->data)
@@ -87,7 +87,7 @@ static BOOL WLog_CallbackAppender_WriteImageMessage(wLog* log, wLogAppender* app
 		return FALSE;
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 
 	callbackAppender = (wLogCallbackAppender*)appender;
 	if (callbackAppender->callbacks && callbackAppender->callbacks->image)
@@ -106,7 +106,7 @@ static BOOL WLog_CallbackAppender_WritePacketMessage(wLog* log, wLogAppender* ap
 		return FALSE;
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 
 	callbackAppender = (wLogCallbackAppender*)appender;
 	if (callbackAppender->callbacks && callbackAppender->callbacks->package)
@@ -60,7 +60,7 @@ static BOOL WLog_ConsoleAppender_WriteMessage(wLog* log, wLogAppender* appender,
 	consoleAppender = (wLogConsoleAppender*)appender;
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 
 #ifdef _WIN32
 	if (consoleAppender->outputStream == WLOG_CONSOLE_DEBUG)
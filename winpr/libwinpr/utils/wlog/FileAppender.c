@@ -142,7 +142,7 @@ static BOOL WLog_FileAppender_WriteMessage(wLog* log, wLogAppender* appender, wL
 		return FALSE;
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 	(void)fprintf(fp, "%s%s\n", message->PrefixString, message->TextString);
 	(void)fflush(fp); /* slow! */
 	return TRUE;
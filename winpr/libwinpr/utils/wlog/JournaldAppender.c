@@ -109,7 +109,7 @@ static BOOL WLog_JournaldAppender_WriteMessage(wLog* log, wLogAppender* appender
 	}
 
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 
 	if (message->Level != WLOG_OFF)
 		(void)fprintf(journaldAppender->stream, formatStr, message->PrefixString,
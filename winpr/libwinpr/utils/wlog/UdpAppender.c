@@ -98,7 +98,7 @@ static BOOL WLog_UdpAppender_WriteMessage(wLog* log, wLogAppender* appender, wLo
 
 	udpAppender = (wLogUdpAppender*)appender;
 	message->PrefixString = prefix;
-	WLog_Layout_GetMessagePrefix(log, appender->Layout, message);
+	WLog_Appender_GetMessagePrefix(log, appender, message);
 	(void)_sendto(udpAppender->sock, message->PrefixString,
 	              (int)strnlen(message->PrefixString, INT_MAX), 0, &udpAppender->targetAddr,
 	              udpAppender->targetAddrLen);
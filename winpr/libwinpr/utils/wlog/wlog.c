@@ -29,6 +29,7 @@
 #include <winpr/print.h>
 #include <winpr/debug.h>
 #include <winpr/environment.h>
+#include <winpr/interlocked.h>
 #include <winpr/wlog.h>
 
 #if defined(ANDROID)
@@ -47,6 +48,11 @@ typedef struct
 
 #define WLOG_FILTER_NOT_FILTERED (-1)
 #define WLOG_FILTER_NOT_INITIALIZED (-2)
+
+/* wLog::CachedLevel keeps the level in the low bits and the generation above */
+#define WLOG_CACHED_LEVEL_BITS 4
+#define WLOG_CACHED_LEVEL_MASK ((1 << WLOG_CACHED_LEVEL_BITS) - 1)
+#define WLOG_GENERATION_MASK (INT32_MAX >> WLOG_CACHED_LEVEL_BITS)
 /**
  * References for general logging concepts:
  *
@@ -63,6 +69,8 @@ static INIT_ONCE g_WLogInitialized = INIT_ONCE_STATIC_INIT;
 static DWORD g_FilterCount = 0;
 static wLogFilter* g_Filters = NULL;
 static wLog* g_RootLog = NULL;
+/* bumped whenever a level or filter changes, invalidates all cached levels */
+static LONG volatile g_LevelGeneration = 1;
 
 static wLog* WLog_New(LPCSTR name, wLog* rootLogger);
 static void WLog_Free(wLog* log);
@@ -84,6 +92,15 @@ static void WLog_Uninit_(void)
 	if (!root)
 		return;
 
+	/* queued messages reference the loggers, flush them while all are alive */
+	WLog_SetLogAppenderAsync(root, FALSE);
+	for (DWORD index = 0; index < root->ChildrenCount; index++)
+	{
+		child = root->Children[index];
+		if (child->Appender)
+			WLog_SetLogAppenderAsync(child, FALSE);
+	}
+
 	for (DWORD index = 0; index < root->ChildrenCount; index++)
 	{
 		child = root->Children[index];
@@ -112,6 +129,7 @@ static BOOL CALLBACK WLog_InitializeRoot(PINIT_ONCE InitOnce, PVOID Parameter, P
 	DWORD nSize = 0;
 	DWORD logAppenderType = 0;
 	LPCSTR appender = "WLOG_APPENDER";
+	LPCSTR async = "WLOG_ASYNC";
 
 	WINPR_UNUSED(InitOnce);
 	WINPR_UNUSED(Parameter);
@@ -164,6 +182,31 @@ static BOOL CALLBACK WLog_InitializeRoot(PINIT_ONCE InitOnce, PVOID Parameter, P
 	if (!WLog_SetLogAppenderType(g_RootLog, logAppenderType))
 		goto fail;
 
+	nSize = GetEnvironmentVariableA(async, NULL, 0);
+
+	if (nSize)
+	{
+		env = (LPSTR)malloc(nSize);
+
+		if (!env)
+			goto fail;
+
+		if (GetEnvironmentVariableA(async, env, nSize) != nSize - 1)
+		{
+			(void)fprintf(stderr, "%s environment variable modified in my back", async);
+			free(env);
+			goto fail;
+		}
+
+		if ((_stricmp(env, "0") != 0) && (_stricmp(env, "OFF") != 0))
+		{
+			if (!WLog_SetLogAppenderAsync(g_RootLog, TRUE))
+				(void)fprintf(stderr, "%s: failed to enable the async log queue\n", __func__);
+		}
+
+		free(env);
+	}
+
 	if (!WLog_ParseFilters(g_RootLog))
 		goto fail;
 
@@ -238,6 +281,16 @@ static BOOL WLog_Write(wLog* log, wLogMessage* message)
 		if (!WLog_OpenAppender(log))
 			return FALSE;
 
+	if (appender->async && appender->WriteMessage)
+	{
+		/* render the prefix here so time and thread id are the caller's */
+		char prefix[WLOG_MAX_PREFIX_SIZE] = { 0 };
+		message->PrefixString = prefix;
+		if (!WLog_Layout_GetMessagePrefix(log, appender->Layout, message))
+			return FALSE;
+		return WLog_Async_Post(appender->async, log, message);
+	}
+
 	EnterCriticalSection(&appender->lock);
 
 	if (appender->WriteMessage)
@@ -426,7 +479,7 @@ BOOL WLog_PrintMessage(wLog* log, DWORD type, DWORD level, size_t line, const ch
 	return status;
 }
 
-DWORD WLog_GetLogLevel(wLog* log)
+static DWORD WLog_GetLogLevel_int(wLog* log)
 {
 	if (!log)
 		return WLOG_OFF;
@@ -437,11 +490,43 @@ DWORD WLog_GetLogLevel(wLog* log)
 	if (log->FilterLevel > WLOG_FILTER_NOT_FILTERED)
 		return (DWORD)log->FilterLevel;
 	else if (log->Level == WLOG_LEVEL_INHERIT)
-		log->Level = WLog_GetLogLevel(log->Parent);
+		log->Level = WLog_GetLogLevel_int(log->Parent);
 
 	return log->Level;
 }
 
+static void WLog_InvalidateLevels(void)
+{
+	LONG generation = 0;
+	LONG next = 0;
+
+	do
+	{
+		generation = g_LevelGeneration;
+		next = (generation + 1) & WLOG_GENERATION_MASK;
+		/* 0 is the generation of a freshly allocated logger */
+		if (next == 0)
+			next = 1;
+	} while (InterlockedCompareExchange(&g_LevelGeneration, next, generation) != generation);
+}
+
+DWORD WLog_GetLogLevel(wLog* log)
+{
+	if (!log)
+		return WLOG_OFF;
+
+	/* read the generation first, a concurrent change leaves a stale entry behind */
+	const LONG generation = g_LevelGeneration;
+	const LONG cached = log->CachedLevel;
+
+	if ((cached >> WLOG_CACHED_LEVEL_BITS) == generation)
+		return (DWORD)(cached & WLOG_CACHED_LEVEL_MASK);
+
+	const DWORD level = WLog_GetLogLevel_int(log);
+	log->CachedLevel = (LONG)((generation << WLOG_CACHED_LEVEL_BITS) | (LONG)level);
+	return level;
+}
+
 BOOL WLog_IsLevelActive(wLog* _log, DWORD _log_level)
 {
 	DWORD level = 0;
@@ -550,7 +635,9 @@ static BOOL WLog_AddStringLogFilters_int(wLog* root, LPCSTR filter)
 
 	g_FilterCount = size;
 	free(cp);
-	return WLog_reset_log_filters(root);
+	const BOOL rc = WLog_reset_log_filters(root);
+	WLog_InvalidateLevels();
+	return rc;
 }
 
 BOOL WLog_AddStringLogFilters(LPCSTR filter)
@@ -600,7 +687,9 @@ BOOL WLog_SetLogLevel(wLog* log, DWORD logLevel)
 			return FALSE;
 	}
 
-	return WLog_reset_log_filters(log);
+	const BOOL rc = WLog_reset_log_filters(log);
+	WLog_InvalidateLevels();
+	return rc;
 }
 
 int WLog_ParseLogLevel(LPCSTR level)
@@ -25,6 +25,8 @@
 #define WLOG_MAX_PREFIX_SIZE 512
 #define WLOG_MAX_STRING_SIZE 8192
 
+typedef struct s_wLogAsync wLogAsync;
+
 typedef BOOL (*WLOG_APPENDER_OPEN_FN)(wLog* log, wLogAppender* appender);
 typedef BOOL (*WLOG_APPENDER_CLOSE_FN)(wLog* log, wLogAppender* appender);
 typedef BOOL (*WLOG_APPENDER_WRITE_MESSAGE_FN)(wLog* log, wLogAppender* appender,
@@ -55,7 +57,9 @@ typedef void (*WLOG_APPENDER_FREE)(wLogAppender* appender);
 	WLOG_APPENDER_WRITE_IMAGE_MESSAGE_FN WriteImageMessage;   \
 	WLOG_APPENDER_WRITE_PACKET_MESSAGE_FN WritePacketMessage; \
 	WLOG_APPENDER_FREE Free;                                  \
-	WLOG_APPENDER_SET Set
+	WLOG_APPENDER_SET Set;                                    \
+	wLogAsync* async;                                         \
+	LPCSTR PresetPrefix
 
 struct s_wLogAppender
 {
@@ -67,6 +71,8 @@ struct s_wLog
 	LPSTR Name;
 	LONG FilterLevel;
 	DWORD Level;
+	/* effective level, tagged with the level generation it was computed in */
+	LONG volatile CachedLevel;
 
 	BOOL IsRoot;
 	BOOL inherit;
@@ -85,8 +91,10 @@ struct s_wLog
 
 extern const char* WLOG_LEVELS[7];
 BOOL WLog_Layout_GetMessagePrefix(wLog* log, wLogLayout* layout, wLogMessage* message);
+BOOL WLog_Appender_GetMessagePrefix(wLog* log, wLogAppender* appender, wLogMessage* message);
 
 #include "Layout.h"
 #include "Appender.h"
+#include "Async.h"
 
 #endif /* WINPR_WLOG_PRIVATE_H */